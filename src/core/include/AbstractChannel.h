@@ -28,6 +28,7 @@
 #define ABSTRACTCHANNEL_H
 
 #include "itype.h"
+#include "Fail.h"
 
 namespace MFM
 {
@@ -75,6 +76,52 @@ namespace MFM
      */
     virtual u32 Read(bool byA, u8 * data, u32 length) = 0;
 
+    /**
+     * Set span to the start of contiguous writable space in A's (if
+     * byA) or B's (if not byA) output channel, and return its length.
+     * Bytes placed in the span are not written until CommitWrite.
+     * Channels that cannot expose their storage return 0.
+     */
+    virtual u32 ReserveWrite(bool byA, u8 * & span)
+    {
+      span = 0;
+      return 0;
+    }
+
+    /**
+     * Write the first length bytes of the span most recently returned
+     * by ReserveWrite.
+     *
+     * \fail ILLEGAL_ARGUMENT if length exceeds that span
+     */
+    virtual void CommitWrite(bool byA, u32 length)
+    {
+      MFM_API_ASSERT_ARG(length == 0);
+    }
+
+    /**
+     * Set span to the start of contiguous readable data in A's (if
+     * byA) or B's (if not byA) input channel, and return its length.
+     * The data stays in the channel until ConsumeRead.  Channels that
+     * cannot expose their storage return 0.
+     */
+    virtual u32 PeekRead(bool byA, const u8 * & span)
+    {
+      span = 0;
+      return 0;
+    }
+
+    /**
+     * Discard the first length bytes of the span most recently
+     * returned by PeekRead.
+     *
+     * \fail ILLEGAL_ARGUMENT if length exceeds that span
+     */
+    virtual void ConsumeRead(bool byA, u32 length)
+    {
+      MFM_API_ASSERT_ARG(length == 0);
+    }
+
   };
 }
 
@@ -181,6 +181,33 @@ namespace MFM
       return static_cast<T*>(this)->HasBeenRepairedImpl();
     }
 
+    /**
+     * Checks each of the \a count atoms at \a atoms with IsSane,
+     * repairing those it can with HasBeenRepaired.
+     *
+     * @returns the number of atoms that could not be repaired (and
+     * are left unchanged).
+     */
+    static u32 RepairAll(T * atoms, u32 count)
+    {
+      u32 insane = 0;
+      for (u32 i = 0; i < count; ++i)
+      {
+        insane += !atoms[i].IsSane();
+      }
+      if (insane == 0) return 0;  // Usual case, without a branch per atom
+
+      u32 unrepaired = 0;
+      for (u32 i = 0; i < count; ++i)
+      {
+        if (!atoms[i].IsSane() && !atoms[i].HasBeenRepaired())
+        {
+          ++unrepaired;
+        }
+      }
+      return unrepaired;
+    }
+
     /**
      * Gets the type of this Atom.
      *
@@ -320,16 +347,17 @@ namespace MFM
      * flipping.
      *
      * @param bitOdds The odds (one in these odds) that a particular
-     * bit will be flipped.
+     * bit will be flipped.  Only the bits that flip cost anything
+     * much, since we skip geometrically from one to the next.
      */
     void XRay(Random& rand, u32 bitOdds)
     {
-      for(u32 i = 0; i < BPA; i++)
+      for(u32 i = rand.GeometricSkip(bitOdds); i < BPA; )
       {
-        if(rand.OneIn(bitOdds))
-        {
-          m_bits.ToggleBit(i);
-        }
+        m_bits.ToggleBit(i);
+        const u32 skip = rand.GeometricSkip(bitOdds);
+        if (skip >= BPA) break;
+        i += skip + 1;
       }
     }
 
@@ -0,0 +1,164 @@
+/*                                              -*- mode:C++ -*-
+  AtomDump.h Compact binary dumps of many atoms
+  Copyright (C) 2020 The Living Computation Foundation.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+  USA
+*/
+
+/**
+  \file AtomDump.h Compact binary dumps of many atoms
+  \author David H. Ackley.
+  \date (C) 2020 All rights reserved.
+  \lgpl
+ */
+#ifndef ATOMDUMP_H
+#define ATOMDUMP_H
+
+#include "itype.h"
+#include "ByteSink.h"
+#include "Element.h"
+#include "UlamClassRegistry.h"
+
+namespace MFM
+{
+  /**
+     An atom dump is a header, then one fixed-size Record per atom,
+     then a dictionary naming each element type the records use, then
+     a Trailer.  All fields are in host byte order.
+
+     Writing one costs a copy of each atom's bits -- no type names
+     are parsed or printed -- so whole regions can be dumped from
+     running code.  AtomDumpReader turns a dump into text later,
+     given the same element classes.
+   */
+  struct AtomDumpFormat
+  {
+    enum
+    {
+      DUMP_MAGIC = 0x44414d4d,  // 'MMAD' read little-endian
+      DUMP_VERSION = 1,
+      MAX_ENTRIES = 256,        // As many types as an ElementTable holds
+      ENTRY_ULAM = 0x1          // Entry name is a mangled UlamClass name
+    };
+
+    struct Header
+    {
+      u32 m_magic;
+      u16 m_version;
+      u16 m_atomBits;
+    };
+
+    /* Followed by the atom's bits, as 32-bit words */
+    struct Record
+    {
+      u16 m_x;
+      u16 m_y;
+      u16 m_entry;
+      u16 m_unused;
+    };
+
+    /* Followed by m_nameBytes of name, padded to a multiple of 4 */
+    struct Entry
+    {
+      u32 m_type;
+      u16 m_nameBytes;
+      u16 m_flags;
+    };
+
+    struct Trailer
+    {
+      u32 m_recordCount;
+      u32 m_entryCount;
+      u32 m_magic;
+    };
+
+    static u32 Padded(u32 bytes)
+    {
+      return (bytes + 3) & ~3u;
+    }
+  };
+
+  /**
+     Writes an atom dump to a ByteSink.  Add() every atom, then
+     Finish() once.
+   */
+  template <class EC>
+  class AtomDumpWriter : public AtomDumpFormat
+  {
+    typedef typename EC::ATOM_CONFIG AC;
+    typedef typename AC::ATOM_TYPE T;
+    enum { BPA = AC::BITS_PER_ATOM, ATOM_WORDS = (BPA + 31) / 32 };
+
+  public:
+    AtomDumpWriter(ByteSink & out) ;
+
+    /**
+       Dump \c atom as being at (\c x, \c y), both of which must fit
+       in 16 bits.  \c elt, if non-null, is the element for its type
+       (it names the type in the dictionary); if null, the type is
+       dumped as unknown.
+     */
+    void Add(u32 x, u32 y, const T & atom, const Element<EC> * elt) ;
+
+    /** Write the dictionary and trailer.  Add nothing after this. */
+    void Finish() ;
+
+    u32 GetRecordCount() const { return m_recordCount; }
+
+  private:
+    ByteSink & m_out;
+    u32 m_recordCount;
+    u32 m_entryCount;
+    u32 m_lastEntry;
+    struct Seen
+    {
+      u32 m_type;
+      const Element<EC> * m_element;
+    } m_entries[MAX_ENTRIES];
+    bool m_finished;
+
+    u32 EntryFor(u32 type, const Element<EC> * elt) ;
+  };
+
+  /**
+     Prints atom dumps, typically offline in a tool that loads the
+     same element libraries as the dumping program.
+   */
+  template <class EC>
+  class AtomDumpReader : public AtomDumpFormat
+  {
+    typedef typename EC::ATOM_CONFIG AC;
+    typedef typename AC::ATOM_TYPE T;
+    enum { BPA = AC::BITS_PER_ATOM, ATOM_WORDS = (BPA + 31) / 32 };
+
+  public:
+    /**
+       Print the \c bytes of dump at \c dump to \c out, one atom per
+       line.  Atoms whose type names a class in \c ucr are printed
+       with \c printFlags as UlamElement::Print would; others get their
+       dictionary name and raw bits.
+
+       \returns false, having printed nothing, if \c dump isn't a
+       complete dump written for atoms of our size.
+     */
+    static bool Print(const u8 * dump, u32 bytes, ByteSink & out,
+                      const UlamClassRegistry<EC> & ucr, u32 printFlags) ;
+  };
+}
+
+#include "AtomDump.tcc"
+
+#endif /* ATOMDUMP_H */
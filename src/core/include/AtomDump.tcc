@@ -0,0 +1,190 @@
+/* -*- C++ -*- */
+#include "UlamElement.h"
+#include "AtomSerializer.h"
+#include "OverflowableCharBufferByteSink.h"
+#include <string.h>  /* For memcpy */
+
+namespace MFM
+{
+  template <class EC>
+  AtomDumpWriter<EC>::AtomDumpWriter(ByteSink & out)
+    : m_out(out)
+    , m_recordCount(0)
+    , m_entryCount(0)
+    , m_lastEntry(0)
+    , m_finished(false)
+  {
+    Header h;
+    h.m_magic = DUMP_MAGIC;
+    h.m_version = DUMP_VERSION;
+    h.m_atomBits = BPA;
+    m_out.WriteBytes((const u8 *) &h, sizeof(h));
+  }
+
+  template <class EC>
+  u32 AtomDumpWriter<EC>::EntryFor(u32 type, const Element<EC> * elt)
+  {
+    // Neighboring atoms are often alike, so try the last one first
+    if (m_lastEntry < m_entryCount && m_entries[m_lastEntry].m_type == type)
+      return m_lastEntry;
+
+    for (u32 i = 0; i < m_entryCount; ++i)
+    {
+      if (m_entries[i].m_type == type)
+        return m_lastEntry = i;
+    }
+
+    MFM_API_ASSERT_STATE(m_entryCount < MAX_ENTRIES);
+    m_entries[m_entryCount].m_type = type;
+    m_entries[m_entryCount].m_element = elt;
+    return m_lastEntry = m_entryCount++;
+  }
+
+  template <class EC>
+  void AtomDumpWriter<EC>::Add(u32 x, u32 y, const T & atom, const Element<EC> * elt)
+  {
+    MFM_API_ASSERT_STATE(!m_finished);
+    MFM_API_ASSERT_ARG(x <= U16_MAX && y <= U16_MAX);
+
+    u8 buf[sizeof(Record) + 4 * ATOM_WORDS];
+    Record r;
+    r.m_x = (u16) x;
+    r.m_y = (u16) y;
+    r.m_entry = (u16) EntryFor(atom.GetType(), elt);
+    r.m_unused = 0;
+    memcpy(buf, &r, sizeof(r));
+
+    u32 * words = (u32 *) (buf + sizeof(r));
+    for (u32 i = 0; i < ATOM_WORDS; ++i)
+    {
+      const u32 len = MIN(32u, BPA - 32 * i);
+      words[i] = atom.GetBits().Read(32 * i, len);
+    }
+    m_out.WriteBytes(buf, sizeof(buf));
+    ++m_recordCount;
+  }
+
+  template <class EC>
+  void AtomDumpWriter<EC>::Finish()
+  {
+    MFM_API_ASSERT_STATE(!m_finished);
+    m_finished = true;
+
+    for (u32 i = 0; i < m_entryCount; ++i)
+    {
+      const Element<EC> * elt = m_entries[i].m_element;
+      const UlamElement<EC> * uelt = elt ? elt->AsUlamElement() : 0;
+      OString512 name;
+      if (uelt)
+        name.Print(uelt->GetMangledClassName());
+      else if (elt)
+      {
+        UUID uuid = elt->GetUUID();
+        name.Printf("%@", &uuid);
+      }
+
+      Entry e;
+      e.m_type = m_entries[i].m_type;
+      e.m_nameBytes = (u16) name.GetLength();
+      e.m_flags = uelt ? ENTRY_ULAM : 0;
+      m_out.WriteBytes((const u8 *) &e, sizeof(e));
+      m_out.WriteBytes((const u8 *) name.GetZString(), e.m_nameBytes);
+      const u32 zeros = 0;
+      m_out.WriteBytes((const u8 *) &zeros, Padded(e.m_nameBytes) - e.m_nameBytes);
+    }
+
+    Trailer t;
+    t.m_recordCount = m_recordCount;
+    t.m_entryCount = m_entryCount;
+    t.m_magic = DUMP_MAGIC;
+    m_out.WriteBytes((const u8 *) &t, sizeof(t));
+  }
+
+  template <class EC>
+  bool AtomDumpReader<EC>::Print(const u8 * dump, u32 bytes, ByteSink & out,
+                                 const UlamClassRegistry<EC> & ucr, u32 printFlags)
+  {
+    MFM_API_ASSERT_NONNULL(dump);
+    const u32 recordBytes = sizeof(Record) + 4 * ATOM_WORDS;
+
+    Header h;
+    Trailer t;
+    if (bytes < sizeof(h) + sizeof(t)) return false;
+    memcpy(&h, dump, sizeof(h));
+    memcpy(&t, dump + bytes - sizeof(t), sizeof(t));
+    if (h.m_magic != DUMP_MAGIC || h.m_version != DUMP_VERSION ||
+        h.m_atomBits != BPA || t.m_magic != DUMP_MAGIC ||
+        t.m_entryCount > MAX_ENTRIES)
+      return false;
+
+    const u8 * const limit = dump + bytes - sizeof(t);
+    const u8 * const records = dump + sizeof(h);
+    if ((u64) t.m_recordCount * recordBytes > (u64) (limit - records))
+      return false;
+
+    // Index the dictionary
+    struct Named
+    {
+      u32 m_type;
+      const char * m_name;
+      u32 m_nameBytes;
+      const UlamClass<EC> * m_class;
+    } named[MAX_ENTRIES];
+
+    const u8 * at = records + t.m_recordCount * recordBytes;
+    for (u32 i = 0; i < t.m_entryCount; ++i)
+    {
+      Entry e;
+      if ((u32) (limit - at) < sizeof(e)) return false;
+      memcpy(&e, at, sizeof(e));
+      at += sizeof(e);
+      if ((u32) (limit - at) < Padded(e.m_nameBytes)) return false;
+
+      named[i].m_type = e.m_type;
+      named[i].m_name = (const char *) at;
+      named[i].m_nameBytes = e.m_nameBytes;
+      named[i].m_class = 0;
+      if (e.m_flags & ENTRY_ULAM)
+      {
+        OString512 mangled;
+        mangled.WriteBytes(at, e.m_nameBytes);
+        named[i].m_class = ucr.GetUlamClassByMangledName(mangled.GetZString());
+      }
+      at += Padded(e.m_nameBytes);
+    }
+    if (at != limit) return false;
+
+    for (u32 i = 0; i < t.m_recordCount; ++i)
+    {
+      const u8 * rp = records + i * recordBytes;
+      Record r;
+      memcpy(&r, rp, sizeof(r));
+      if (r.m_entry >= t.m_entryCount) return false;
+
+      T atom;
+      for (u32 w = 0; w < ATOM_WORDS; ++w)
+      {
+        u32 word;
+        memcpy(&word, rp + sizeof(r) + 4 * w, sizeof(word));
+        atom.GetBits().Write(32 * w, MIN(32u, BPA - 32 * w), word);
+      }
+
+      out.Printf("(%d,%d) ", r.m_x, r.m_y);
+      const Named & n = named[r.m_entry];
+      const UlamElement<EC> * uelt = n.m_class ? n.m_class->AsUlamElement() : 0;
+      if (uelt)
+        uelt->Print(ucr, out, atom, printFlags, T::ATOM_FIRST_STATE_BIT);
+      else
+      {
+        if (n.m_nameBytes > 0)
+          out.WriteBytes((const u8 *) n.m_name, n.m_nameBytes);
+        else
+          out.Printf("type 0x%x", n.m_type);
+        AtomSerializer<AC> as(atom);
+        out.Printf(":%@", &as);
+      }
+      out.Printf("\n");
+    }
+    return true;
+  }
+}
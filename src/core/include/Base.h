@@ -35,11 +35,84 @@
 namespace MFM {
 
   /**
-     A Base holds the non-mobile state of a Site.  It is
-     a template depending only on an AtomConfig (AC).
+     Optional per-site bookkeeping, as a bitmask: a Site or Base
+     built without a feature has no storage for it, and its updates
+     compile to nothing.  Configurations that never look at these,
+     such as headless runs without warp, can leave them out.
+   */
+  enum SiteFeature
+  {
+    SITE_FEATURES_NONE = 0,
+
+    /** Site event counts, write ages, and last event numbers */
+    SITE_FEATURE_EVENTS = 1,
+
+    /** Base touch sensors.  Touch recency is measured in site events,
+        so without SITE_FEATURE_EVENTS a touch never grows old */
+    SITE_FEATURE_TOUCH = 2,
+
+    /** Base paint */
+    SITE_FEATURE_PAINT = 4,
+
+    SITE_FEATURES_ALL =
+      SITE_FEATURE_EVENTS | SITE_FEATURE_TOUCH | SITE_FEATURE_PAINT
+  };
+
+  /**
+     Storage for a Base's SiteSensors, if it has them.
+   */
+  template <bool HAS_TOUCH>
+  struct BaseTouch
+  {
+    SiteSensors m_sensory;
+
+    const SiteSensors & GetSensory() const { return m_sensory; }
+    void Touch(SiteTouchType type, u64 eventCount) { m_sensory.Touch(type, eventCount); }
+    void ClearSensory() { m_sensory.Clear(); }
+  };
+
+  template <>
+  struct BaseTouch<false>
+  {
+    const SiteSensors & GetSensory() const
+    {
+      static const SiteSensors untouched = { { TOUCH_TYPE_NONE, 0 } };
+      return untouched;
+    }
+    void Touch(SiteTouchType, u64) { }
+    void ClearSensory() { }
+  };
+
+  /**
+     Storage for a Base's paint, if it has any.
+   */
+  template <bool HAS_PAINT>
+  struct BasePaint
+  {
+    u32 m_paint;
+
+    BasePaint() : m_paint(0xff000000) { }
+    u32 GetPaint() const { return m_paint; }
+    void SetPaint(u32 paint) { m_paint = paint; }
+  };
+
+  template <>
+  struct BasePaint<false>
+  {
+    u32 GetPaint() const { return 0xff000000; }
+    void SetPaint(u32) { }
+  };
+
+  /**
+     A Base holds the non-mobile state of a Site.  It is a template
+     depending on an AtomConfig (AC) and, optionally, the SiteFeature
+     bits it keeps; the SiteSensors and paint are held only if
+     SITE_FEATURE_TOUCH and SITE_FEATURE_PAINT are among them.
   */
-  template <class AC>
+  template <class AC, u32 FEATURES = SITE_FEATURES_ALL>
   class Base
+    : private BaseTouch<(FEATURES & SITE_FEATURE_TOUCH) != 0>
+    , private BasePaint<(FEATURES & SITE_FEATURE_PAINT) != 0>
   {
     /**
        Present the AtomConfig in use
@@ -49,23 +122,20 @@ namespace MFM {
     // Extract short names for parameter types
     typedef typename ATOM_CONFIG::ATOM_TYPE T;
 
+    typedef BaseTouch<(FEATURES & SITE_FEATURE_TOUCH) != 0> Touching;
+    typedef BasePaint<(FEATURES & SITE_FEATURE_PAINT) != 0> Painting;
+
     T m_base;
-    SiteSensors m_sensory;
-    u32 m_paint;
 
   public:
-    Base()
-      : m_paint(0xff000000)
-    { }
-
     u32 GetPaint() const
     {
-      return m_paint;
+      return Painting::GetPaint();
     }
 
     void SetPaint(u32 paint)
     {
-      m_paint = paint;
+      Painting::SetPaint(paint);
     }
 
     void SaveConfig(ByteSink& bs, AtomTypeFormatter<AC> & atf) const
@@ -77,9 +147,9 @@ namespace MFM {
         AtomSerializer<AC> as(tmp);
         bs.Printf(",%@", &as);
       }
-      bs.Printf(",#%08x",m_paint);
+      bs.Printf(",#%08x",GetPaint());
 
-      m_sensory.SaveConfig(bs, atf);
+      GetSensory().SaveConfig(bs, atf);
     }
 
     bool LoadConfig(LineCountingByteSource & bs, AtomTypeFormatter<AC> & atf)
@@ -104,21 +174,39 @@ namespace MFM {
       if (3 != bs.Scanf(",#%08x", &tmp_m_paint))
         return false;
 
-      if (!m_sensory.LoadConfig(bs, atf))
+      SiteSensors tmp_m_sensory;
+      if (!tmp_m_sensory.LoadConfig(bs, atf))
         return false;
 
       m_base = defaultAtom;
-      m_paint = tmp_m_paint;
+      SetPaint(tmp_m_paint);
+      Touch(tmp_m_sensory.m_touchSensor.m_touchType,
+            tmp_m_sensory.m_touchSensor.m_lastTouchEventCount);
 
       return true;
     }
 
+    /** True if \a other holds the same base atom, paint, and touch */
+    bool Equals(const Base & other) const
+    {
+      const SiteTouchSensor & a = GetSensory().m_touchSensor;
+      const SiteTouchSensor & b = other.GetSensory().m_touchSensor;
+      return m_base == other.m_base
+        && GetPaint() == other.GetPaint()
+        && a.m_touchType == b.m_touchType
+        && a.m_lastTouchEventCount == b.m_lastTouchEventCount;
+    }
+
     void PutBaseAtom(const T & newBase) { m_base = newBase; }
     T & GetBaseAtom() { return m_base; }
     const T & GetBaseAtom() const { return m_base; }
 
-    SiteSensors & GetSensory() { return m_sensory; }
-    const SiteSensors & GetSensory() const { return m_sensory; }
+    /** The touch sensors; always untouched without SITE_FEATURE_TOUCH */
+    const SiteSensors & GetSensory() const { return Touching::GetSensory(); }
+
+    void Touch(SiteTouchType type, u64 eventCount) { Touching::Touch(type, eventCount); }
+
+    void ClearSensory() { Touching::ClearSensory(); }
   };
 
 } /* namespace MFM */
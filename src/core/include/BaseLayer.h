@@ -0,0 +1,127 @@
+/*                                              -*- mode:C++ -*-
+  BaseLayer.h A tile's lazily allocated plane of site Bases
+  Copyright (C) 2014-2016 The Regents of the University of New Mexico.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+  USA
+*/
+
+/**
+  \file BaseLayer.h A tile's lazily allocated plane of site Bases
+  \date (C) 2014-2016 All rights reserved.
+  \lgpl
+ */
+#ifndef BASELAYER_H
+#define BASELAYER_H
+
+#include "itype.h"
+#include "Fail.h"
+
+namespace MFM
+{
+  /**
+     The Bases of a tile's PLANAR sites.  Until something writes one,
+     every site reads the same shared, empty Base and the layer costs
+     no memory; the first write copies that empty Base out to a
+     Base per site.  Many runs never write a Base at all.
+
+     The first write may come from a thread other than the tile's
+     (see Grid::SenseTouchAt), so allocation is published atomically.
+   */
+  template <class B>
+  class BaseLayer
+  {
+  public:
+    BaseLayer()
+      : m_bases(0)
+      , m_sites(0)
+    { }
+
+    ~BaseLayer()
+    {
+      delete [] m_bases;
+    }
+
+    /** Say how many sites the layer serves; before any Write */
+    void SetSiteCount(u32 sites)
+    {
+      MFM_API_ASSERT_STATE(!IsAllocated());
+      m_sites = sites;
+    }
+
+    u32 GetSiteCount() const
+    {
+      return m_sites;
+    }
+
+    bool IsAllocated() const
+    {
+      return __atomic_load_n(&m_bases, __ATOMIC_ACQUIRE) != 0;
+    }
+
+    /** The Base shared by all sites of all unwritten layers */
+    static const B & GetEmptyBase()
+    {
+      static const B empty = B();
+      return empty;
+    }
+
+    const B & Read(u32 site) const
+    {
+      const B * bases = __atomic_load_n(&m_bases, __ATOMIC_ACQUIRE);
+      return bases ? bases[site] : GetEmptyBase();
+    }
+
+    /** The Base of \a site, for writing; allocates the layer first if need be */
+    B & Write(u32 site)
+    {
+      B * bases = __atomic_load_n(&m_bases, __ATOMIC_ACQUIRE);
+      if (!bases)
+      {
+        bases = Allocate();
+      }
+      return bases[site];
+    }
+
+  private:
+    B * m_bases;
+    u32 m_sites;
+
+    B * Allocate()
+    {
+      MFM_API_ASSERT_STATE(m_sites > 0);
+      B * fresh = new B[m_sites];
+      for (u32 i = 0; i < m_sites; ++i)
+      {
+        fresh[i] = GetEmptyBase();
+      }
+
+      B * expected = 0;
+      if (!__atomic_compare_exchange_n(&m_bases, &expected, fresh, false,
+                                       __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+      {
+        delete [] fresh;     // Someone else got there first
+        return expected;
+      }
+      return fresh;
+    }
+
+    // Declare away
+    BaseLayer(const BaseLayer &) ;
+    BaseLayer & operator=(const BaseLayer &) ;
+  };
+} /* namespace MFM */
+
+#endif /* BASELAYER_H */
@@ -72,7 +72,7 @@ namespace MFM {
      */
     static u32 Read(const BV & bv)
     {
-      return bv.Read(START,LENGTH);
+      return bv.template ReadFixed<START,LENGTH>();
     }
 
     /**
@@ -83,7 +83,7 @@ namespace MFM {
      */
     static void Write(BV & bv, u32 val)
     {
-      bv.Write(START,LENGTH,val);
+      bv.template WriteFixed<START,LENGTH>(val);
     }
 
     /**
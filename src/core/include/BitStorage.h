@@ -120,11 +120,11 @@ namespace MFM {
     template<u32 LEN>
     void ReadBV(u32 pos, BitVector<LEN>& rtnbv) const
     {
-      u32 amt = 32;
+      u32 amt = 64;
       for (u32 i = 0; i < LEN; i += amt)
       {
         if (i + amt > LEN) amt = LEN - i;
-        rtnbv.Write(i, amt, this->Read(pos + i, amt));
+        rtnbv.WriteLong(i, amt, this->ReadLong(pos + i, amt));
       }
     }
 
@@ -135,11 +135,26 @@ namespace MFM {
     template<u32 LEN>
     void WriteBV(u32 pos, const BitVector<LEN>& val)
     {
-      u32 amt = 32;
+      u32 amt = 64;
       for (u32 i = 0; i < LEN; i += amt)
       {
         if (i + amt > LEN) amt = LEN - i;
-        this->Write(pos + i, amt, val.Read(i, amt));
+        this->WriteLong(pos + i, amt, val.ReadLong(i, amt));
+      }
+    }
+
+    /**
+       Copy \c len bits from \c srcPos of \c src to \c dstPos of
+       \c dst, a u64 per virtual call, for when neither storage's
+       type is known.  When both are, BitStorageCopy is faster.
+    */
+    static void CopyBits(const BitStorage<EC> & src, u32 srcPos, BitStorage<EC> & dst, u32 dstPos, u32 len)
+    {
+      u32 amt = 64;
+      for (u32 i = 0; i < len; i += amt)
+      {
+        if (i + amt > len) amt = len - i;
+        dst.WriteLong(dstPos + i, amt, src.ReadLong(srcPos + i, amt));
       }
     }
 
@@ -322,6 +337,50 @@ namespace MFM {
 
   }; //AtomBitStorage
 
+  /**
+     The BitVector underlying a BitStorage whose type is known, for
+     BitStorageCopy and BitStorageEquals
+   */
+  template <class EC, class BV>
+  inline BV & BitStorageBits(BitVectorBitStorage<EC,BV> & bs) { return bs.m_stg; }
+
+  template <class EC, class BV>
+  inline const BV & BitStorageBits(const BitVectorBitStorage<EC,BV> & bs) { return bs.m_stg; }
+
+  template <class EC>
+  inline BitVector<EC::ATOM_CONFIG::BITS_PER_ATOM> & BitStorageBits(AtomRefBitStorage<EC> & bs)
+  {
+    return bs.m_stg.GetBits();
+  }
+
+  template <class EC>
+  inline const BitVector<EC::ATOM_CONFIG::BITS_PER_ATOM> & BitStorageBits(const AtomRefBitStorage<EC> & bs)
+  {
+    return bs.m_stg.GetBits();
+  }
+
+  /**
+     Copy \c len bits from \c srcPos of \c src to \c dstPos of \c
+     dst, where each is an AtomRefBitStorage, AtomBitStorage, or
+     BitVectorBitStorage known at compile time: no virtual calls, and
+     a u64 at a time via BitVector::CopyBV.
+   */
+  template <class SRC, class DST>
+  inline void BitStorageCopy(const SRC & src, u32 srcPos, DST & dst, u32 dstPos, u32 len)
+  {
+    BitStorageBits(src).CopyBV(srcPos, dstPos, len, BitStorageBits(dst));
+  }
+
+  /**
+     As BitStorageCopy, but compare: \returns true iff the \c len
+     bits at \c pos1 of \c bs1 equal those at \c pos2 of \c bs2
+   */
+  template <class BS1, class BS2>
+  inline bool BitStorageEquals(const BS1 & bs1, u32 pos1, const BS2 & bs2, u32 pos2, u32 len)
+  {
+    return BitStorageBits(bs1).EqualsBV(pos1, pos2, len, BitStorageBits(bs2));
+  }
+
 } // MFM
 
 #include "BitStorage.tcc"
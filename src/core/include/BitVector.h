@@ -35,6 +35,12 @@
 #include <climits>  /* for CHAR_BIT */
 #include <stdlib.h> /* for abort */
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 namespace MFM {
 
   template <class EC> class BitRef; // FORWARD
@@ -80,8 +86,48 @@ namespace MFM {
 
   private:
     template <typename EC> friend class BitRef;
+    template <u32 OB> friend class BitVector;
     BitUnitType m_bits[ARRAY_LENGTH];
 
+    /**
+     * Low-level raw read of 1..64 bits starting anywhere, touching at
+     * most three units.  No checking is done: Caller guarantees
+     * startIdx + length <= B and 1 <= length <= 64.
+     */
+    inline u64 ReadUpTo64(const u32 startIdx, const u32 length) const {
+      const u32 idx = startIdx / BITS_PER_UNIT;
+      const u32 off = startIdx % BITS_PER_UNIT;
+      u64 window = ((u64) m_bits[idx]) << BITS_PER_UNIT;
+      if (idx + 1 < ARRAY_LENGTH) window |= m_bits[idx + 1];
+      u64 ret = (window << off) >> (64 - length);
+      const u32 inWindow = 64 - off;
+      if (length > inWindow && idx + 2 < ARRAY_LENGTH)
+        ret |= m_bits[idx + 2] >> (BITS_PER_UNIT - (length - inWindow));
+      return ret;
+    }
+
+    /**
+     * Low-level raw write of the low 1..64 bits of value starting
+     * anywhere, touching at most three units.  No checking is done:
+     * Caller guarantees startIdx + length <= B and 1 <= length <= 64.
+     */
+    inline void WriteUpTo64(const u32 startIdx, const u32 length, const u64 value) {
+      const u32 idx = startIdx / BITS_PER_UNIT;
+      const u32 off = startIdx % BITS_PER_UNIT;
+      const u64 field = value << (64 - length);      // Left-justified
+      const u64 mask = ~((u64) 0) << (64 - length);
+      const u32 m0 = (u32) (mask >> (BITS_PER_UNIT + off));
+      m_bits[idx] = (m_bits[idx] & ~m0) | ((u32) (field >> (BITS_PER_UNIT + off)) & m0);
+      if (off + length > BITS_PER_UNIT && idx + 1 < ARRAY_LENGTH) {
+        const u32 m1 = (u32) (mask >> off);
+        m_bits[idx + 1] = (m_bits[idx + 1] & ~m1) | ((u32) (field >> off) & m1);
+        if (off + length > 64 && idx + 2 < ARRAY_LENGTH) {      // Hence off > 0
+          const u32 m2 = (u32) ((mask << (64 - off)) >> BITS_PER_UNIT);
+          m_bits[idx + 2] = (m_bits[idx + 2] & ~m2) | ((u32) ((field << (64 - off)) >> BITS_PER_UNIT) & m2);
+        }
+      }
+    }
+
     /**
      * Low-level raw bitvector writing to a single array element.
      * startIdx==0 means the leftmost bit (MSB).  No checking is done:
@@ -272,6 +318,90 @@ namespace MFM {
 
     } //Write
 
+    /**
+     * Reads a field of \c LENGTH (up to 32) bits starting at bit \c
+     * START, both known at compile time, so the unit index, shifts,
+     * and masks all fold to constants and only the one or two units
+     * the field actually touches are loaded.  Equivalent to
+     * Read(START, LENGTH).
+     *
+     * @returns The bits read, right-justified.
+     *
+     * @sa Read, WriteFixed
+     */
+    template <u32 START, u32 LENGTH>
+    inline u32 ReadFixed() const
+    {
+      enum {
+        FIXED_ERROR_OVERFLOWED_BITS = (START+LENGTH+1)/((B+1)/(START+LENGTH+1)),
+        UNIT = START / BITS_PER_UNIT,
+        FIRST = START % BITS_PER_UNIT,
+        SPLIT = (FIRST + LENGTH) > BITS_PER_UNIT
+      };
+
+      if (LENGTH == 0) return 0;
+
+      if (LENGTH > BITS_PER_UNIT) return Read(START, LENGTH); // FAILs
+
+      // (The '% BITS_PER_UNIT's below only keep shift counts in
+      // range on dead paths, which would otherwise draw warnings.)
+      if (!SPLIT && UNIT < ARRAY_LENGTH)
+      {
+        const u32 shift = (BITS_PER_UNIT - (FIRST + LENGTH)) % BITS_PER_UNIT;
+        return (m_bits[UNIT] >> shift) & MakeMaskClip(LENGTH);
+      }
+
+      // See Write(u32,u32,u32) on the ARRAY_LENGTH guard
+      if (ARRAY_LENGTH > UNIT + 1)
+      {
+        const u32 firstLength = BITS_PER_UNIT - FIRST;
+        const u32 secondLength = (LENGTH - firstLength) % BITS_PER_UNIT;
+        return ((m_bits[UNIT] & MakeMaskClip(firstLength)) << secondLength)
+          | (m_bits[UNIT + 1] >> ((BITS_PER_UNIT - secondLength) % BITS_PER_UNIT));
+      }
+      return 0; // Not reached
+    }
+
+    /**
+     * Writes the bottom \c LENGTH (up to 32) bits of \c value to the
+     * field starting at bit \c START, both known at compile time.
+     * Equivalent to Write(START, LENGTH, value).
+     *
+     * @sa Write, ReadFixed
+     */
+    template <u32 START, u32 LENGTH>
+    inline void WriteFixed(const u32 value)
+    {
+      enum {
+        FIXED_ERROR_OVERFLOWED_BITS = (START+LENGTH+1)/((B+1)/(START+LENGTH+1)),
+        UNIT = START / BITS_PER_UNIT,
+        FIRST = START % BITS_PER_UNIT,
+        SPLIT = (FIRST + LENGTH) > BITS_PER_UNIT
+      };
+
+      if (LENGTH == 0) return;
+
+      if (LENGTH > BITS_PER_UNIT)
+      {
+        Write(START, LENGTH, value); // FAILs
+        return;
+      }
+
+      if (!SPLIT && UNIT < ARRAY_LENGTH)
+      {
+        WriteToUnit(UNIT, FIRST, LENGTH, value);
+        return;
+      }
+
+      if (ARRAY_LENGTH > UNIT + 1)
+      {
+        const u32 firstLength = BITS_PER_UNIT - FIRST;
+        const u32 secondLength = (LENGTH - firstLength) % BITS_PER_UNIT;
+        WriteToUnit(UNIT, FIRST, firstLength, value >> secondLength);
+        WriteToUnit(UNIT + 1, 0, secondLength, value);
+      }
+    }
+
     /**
      * Reads up to 64 bits of a particular section of this BitVector.
      *
@@ -286,14 +416,12 @@ namespace MFM {
      */
     inline u64 ReadLong(const u32 startIdx, const u32 length) const
     {
-      const u32 firstLen = MIN((const u32) 32,length);
-      const u32 secondLen = length - firstLen;
-      u64 ret = Read(startIdx + secondLen, firstLen);
-      if (secondLen > 0)
-	{
-	  ret |= ((u64) Read(startIdx, secondLen)) << firstLen;
-	}
-      return ret;
+      if (length == 0)
+	return 0;
+
+      MFM_API_ASSERT_ARG(startIdx + length <= B);
+      MFM_API_ASSERT_ARG(length <= 64);
+      return ReadUpTo64(startIdx, length);
     }
 
     /**
@@ -311,13 +439,11 @@ namespace MFM {
     // void WriteLong(const u32 startIdx, const u32 length, const u64 value);
     inline void WriteLong(const u32 startIdx, const u32 length, const u64 value)
     {
-      const u32 firstLen = MIN((const u32) 32,length);
-      const u32 secondLen = length - firstLen;
-      Write(startIdx + secondLen, firstLen, (u32) value);
-      if (secondLen > 0)
-	{
-	  Write(startIdx, secondLen, ((u32) (value >> firstLen)));
-	}
+      if (length == 0) return;
+
+      MFM_API_ASSERT_ARG(startIdx + length <= B);
+      MFM_API_ASSERT_ARG(length <= 64);
+      WriteUpTo64(startIdx, length, value);
     }
 
     /**
@@ -349,12 +475,43 @@ namespace MFM {
     inline void CopyBV(const u32 srcStartIdx, const u32 dstStartIdx, const u32 length, BitVector<DBITS> & dstbv) const
     {
       MFM_API_ASSERT_ARG(((void*) this) != ((void*) &dstbv)); // Ensure distinct ptrs; can't move within yourself
-      u32 amt = BITS_PER_UNIT;
+      if (length == 0) return;
+      MFM_API_ASSERT_ARG(srcStartIdx + length <= B);
+      MFM_API_ASSERT_ARG(dstStartIdx + length <= DBITS);
+      u32 amt = 64;             // A u64 at a time, not a Read per unit
+      for (u32 i = 0; i < length; i += amt)
+	{
+	  if (i + amt > length) amt = length - i;
+	  dstbv.WriteUpTo64(dstStartIdx + i, amt, this->ReadUpTo64(srcStartIdx + i, amt));
+	}
+    }
+
+    /**
+     * Compare an arbitrary subsection of this BitVector to one of
+     * \c otherbv, a u64 at a time.
+     *
+     * @returns true iff bits [startIdx, startIdx + length) of this
+     *          equal bits [otherStartIdx, otherStartIdx + length) of
+     *          otherbv
+     *
+     * @fails ILLEGAL_ARGUMENT if either range is out of bounds
+     *
+     * @sa CopyBV
+     */
+    template <u32 OBITS>
+    inline bool EqualsBV(const u32 startIdx, const u32 otherStartIdx, const u32 length, const BitVector<OBITS> & otherbv) const
+    {
+      if (length == 0) return true;
+      MFM_API_ASSERT_ARG(startIdx + length <= B);
+      MFM_API_ASSERT_ARG(otherStartIdx + length <= OBITS);
+      u32 amt = 64;
       for (u32 i = 0; i < length; i += amt)
 	{
 	  if (i + amt > length) amt = length - i;
-	  dstbv.Write(dstStartIdx + i, amt, this->Read(srcStartIdx + i, amt));
+	  if (this->ReadUpTo64(startIdx + i, amt) != otherbv.ReadUpTo64(otherStartIdx + i, amt))
+	    return false;
 	}
+      return true;
     }
 
     /**
@@ -626,8 +783,33 @@ namespace MFM {
      */
     bool ReadBytes(ByteSource& bs);
 
+    /**
+     * Whole-vector equality.  Compares 256 (AVX2) or 128 (SSE2) bits
+     * at a time where the build target allows, and otherwise ORs
+     * together the XORs of all the units, so there is no early-exit
+     * branch per unit.
+     */
     bool operator==(const BitVector & rhs) const;
 
+    bool operator!=(const BitVector & rhs) const
+    {
+      return !(*this == rhs);
+    }
+
+    /**
+     * Set \c diff to the bitwise XOR of this and \c rhs, so its 1 bits
+     * mark where the two differ.
+     *
+     * @returns \c true if any bit differs.
+     */
+    bool XorDiff(const BitVector & rhs, BitVector & diff) const;
+
+    /**
+     * Copy into this BitVector the bits of \c src at positions where
+     * \c mask is 1, leaving the others unchanged.
+     */
+    void MaskedCopy(const BitVector & src, const BitVector & mask);
+
     void ToArray(u32 array[ARRAY_LENGTH]) const;
 
     void FromArray(const u32 array[ARRAY_LENGTH]);
@@ -251,8 +251,101 @@ namespace MFM {
   template <u32 B>
   bool BitVector<B>::operator==(const BitVector & rhs) const
   {
-    return 0 == memcmp(m_bits, rhs.m_bits, sizeof(m_bits));
+    if (ARRAY_LENGTH == 2)
+    {
+      // A 64 bit atom: one compare
+      u64 a, b;
+      memcpy(&a, m_bits, sizeof(a));
+      memcpy(&b, rhs.m_bits, sizeof(b));
+      return a == b;
+    }
+    u32 i = 0;
+#if defined(__AVX2__)
+    for (; i + 8 <= ARRAY_LENGTH; i += 8)
+    {
+      __m256i a = _mm256_loadu_si256((const __m256i *) &m_bits[i]);
+      __m256i b = _mm256_loadu_si256((const __m256i *) &rhs.m_bits[i]);
+      __m256i x = _mm256_xor_si256(a, b);
+      if (!_mm256_testz_si256(x, x)) return false;
+    }
+#endif
+#if defined(__SSE2__)
+    for (; i + 4 <= ARRAY_LENGTH; i += 4)
+    {
+      __m128i a = _mm_loadu_si128((const __m128i *) &m_bits[i]);
+      __m128i b = _mm_loadu_si128((const __m128i *) &rhs.m_bits[i]);
+      if (_mm_movemask_epi8(_mm_cmpeq_epi8(a, b)) != 0xffff) return false;
+    }
+#endif
+    BitUnitType diff = 0;
+    for (; i < ARRAY_LENGTH; ++i)
+      diff |= m_bits[i] ^ rhs.m_bits[i];
+    return diff == 0;
+  }
+
+  template <u32 B>
+  bool BitVector<B>::XorDiff(const BitVector & rhs, BitVector & diff) const
+  {
+    u32 i = 0;
+    BitUnitType any = 0;
+#if defined(__AVX2__)
+    __m256i any256 = _mm256_setzero_si256();
+    for (; i + 8 <= ARRAY_LENGTH; i += 8)
+    {
+      __m256i a = _mm256_loadu_si256((const __m256i *) &m_bits[i]);
+      __m256i b = _mm256_loadu_si256((const __m256i *) &rhs.m_bits[i]);
+      __m256i x = _mm256_xor_si256(a, b);
+      _mm256_storeu_si256((__m256i *) &diff.m_bits[i], x);
+      any256 = _mm256_or_si256(any256, x);
+    }
+    if (!_mm256_testz_si256(any256, any256)) any = 1;
+#endif
+#if defined(__SSE2__)
+    __m128i any128 = _mm_setzero_si128();
+    for (; i + 4 <= ARRAY_LENGTH; i += 4)
+    {
+      __m128i a = _mm_loadu_si128((const __m128i *) &m_bits[i]);
+      __m128i b = _mm_loadu_si128((const __m128i *) &rhs.m_bits[i]);
+      __m128i x = _mm_xor_si128(a, b);
+      _mm_storeu_si128((__m128i *) &diff.m_bits[i], x);
+      any128 = _mm_or_si128(any128, x);
+    }
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(any128, _mm_setzero_si128())) != 0xffff) any = 1;
+#endif
+    for (; i < ARRAY_LENGTH; ++i)
+    {
+      diff.m_bits[i] = m_bits[i] ^ rhs.m_bits[i];
+      any |= diff.m_bits[i];
+    }
+    return any != 0;
+  }
 
+  template <u32 B>
+  void BitVector<B>::MaskedCopy(const BitVector & src, const BitVector & mask)
+  {
+    u32 i = 0;
+#if defined(__AVX2__)
+    for (; i + 8 <= ARRAY_LENGTH; i += 8)
+    {
+      __m256i d = _mm256_loadu_si256((const __m256i *) &m_bits[i]);
+      __m256i s = _mm256_loadu_si256((const __m256i *) &src.m_bits[i]);
+      __m256i m = _mm256_loadu_si256((const __m256i *) &mask.m_bits[i]);
+      d = _mm256_or_si256(_mm256_andnot_si256(m, d), _mm256_and_si256(m, s));
+      _mm256_storeu_si256((__m256i *) &m_bits[i], d);
+    }
+#endif
+#if defined(__SSE2__)
+    for (; i + 4 <= ARRAY_LENGTH; i += 4)
+    {
+      __m128i d = _mm_loadu_si128((const __m128i *) &m_bits[i]);
+      __m128i s = _mm_loadu_si128((const __m128i *) &src.m_bits[i]);
+      __m128i m = _mm_loadu_si128((const __m128i *) &mask.m_bits[i]);
+      d = _mm_or_si128(_mm_andnot_si128(m, d), _mm_and_si128(m, s));
+      _mm_storeu_si128((__m128i *) &m_bits[i], d);
+    }
+#endif
+    for (; i < ARRAY_LENGTH; ++i)
+      m_bits[i] = (m_bits[i] & ~mask.m_bits[i]) | (src.m_bits[i] & mask.m_bits[i]);
   }
 
   template <u32 B>
@@ -275,6 +368,18 @@ namespace MFM {
     const u32 end = MIN(B, startIdx + len);
     const u32 length = end - startIdx;
 
+    if (startIdx == 0 && end == ARRAY_LENGTH * BITS_PER_UNIT)
+    {
+      // Whole vector: count the units two at a time
+      u32 ones = 0;
+      u32 i = 0;
+      for (; i + 2 <= ARRAY_LENGTH; i += 2)
+        ones += PopCount64(((u64) m_bits[i] << 32) | m_bits[i + 1]);
+      if (i < ARRAY_LENGTH)
+        ones += PopCount(m_bits[i]);
+      return ones;
+    }
+
     if (length <= 32) return PopCount(Read(startIdx, length));
 
     // We are not going to end in the same word in which we started
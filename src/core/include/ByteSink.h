@@ -31,6 +31,7 @@
 #include "Fail.h"
 #include "Format.h"
 #include <stdarg.h>    /* For ... */
+#include <string.h>    /* For memset, memcpy */
 
 namespace MFM {
 
@@ -211,8 +212,29 @@ namespace MFM {
 
     void PrintLexDigits(u32 digits) ;
 
+    enum { PAD_CHUNK = 32 };  // Padding bytes formatted per WriteBytes
+
+    /**
+       Store the digits of \a num in \a base into \a buf, most
+       significant first, and return how many there were.  \a buf
+       must hold 8*sizeof(UNSIGNED_TYPE) bytes.
+     */
+    template <class UNSIGNED_TYPE>
+    static u32 FormatInBase(UNSIGNED_TYPE num, u32 base, u8 * buf) ;
+
+    /**
+       Print \a num in \a base, padded to \a width, with a single
+       WriteBytes for the usual field widths.
+     */
     template <class UNSIGNED_TYPE>
     void PrintInBase(UNSIGNED_TYPE num, u32 base, s32 width = 0, u8 pad = ' ') ;
+
+    /**
+       Print \a num as PrintLexDigits followed by PrintInBase would,
+       but formatted into one buffer and written with one WriteBytes.
+     */
+    template <class UNSIGNED_TYPE>
+    void PrintLexInBase(UNSIGNED_TYPE num, u32 base, s32 width, u8 pad) ;
   };
 
   /**
@@ -3,29 +3,71 @@
 namespace MFM {
 
   template <class UNSIGNED_TYPE>
-  void ByteSink::PrintInBase(UNSIGNED_TYPE n, u32 base, s32 width, u8 pad) {
+  u32 ByteSink::FormatInBase(UNSIGNED_TYPE n, u32 base, u8 * buf) {
     MFM_API_ASSERT_ARG(base >= 2 && base <= 36);
 
-    u8 buf[8 * sizeof(UNSIGNED_TYPE)]; // Worst case is binary at 8 u8's per byte
+    u8 rev[8 * sizeof(UNSIGNED_TYPE)]; // Worst case is binary at 8 u8's per byte
     u32 i = 0;
 
     do {
-      buf[i++] = (u8) (n % base);
+      const u32 dig = (u32) (n % base);
+      rev[i++] = dig < 10 ? '0' + dig : 'A' + dig - 10;
       n /= base;
     } while (n > 0);
 
-    if (width >= 0) {
-      u32 uwidth = (u32) width;
-      while (uwidth > i) {
-        WriteByte(pad);
-        --uwidth;
-      }
-    } /* XXX Left justified field widths NYI */
-
-    for (; i > 0; i--)
-      WriteByte(buf[i - 1] < 10 ?
-                '0' + buf[i - 1] :
-                'A' + buf[i - 1] - 10);
+    for (u32 j = 0; j < i; ++j)
+      buf[j] = rev[i - 1 - j];
+    return i;
+  }
+
+  template <class UNSIGNED_TYPE>
+  void ByteSink::PrintInBase(UNSIGNED_TYPE n, u32 base, s32 width, u8 pad) {
+    u8 buf[PAD_CHUNK + 8 * sizeof(UNSIGNED_TYPE)];
+    u8 digs[8 * sizeof(UNSIGNED_TYPE)];
+    const u32 len = FormatInBase(n, base, digs);
+
+    u32 pads = 0;
+    if (width > (s32) len)
+      pads = (u32) width - len;  /* XXX Left justified field widths NYI */
+
+    for (; pads > PAD_CHUNK; pads -= PAD_CHUNK) {
+      memset(buf, pad, PAD_CHUNK);
+      WriteBytes(buf, PAD_CHUNK);
+    }
+    memset(buf, pad, pads);
+    memcpy(buf + pads, digs, len);
+    WriteBytes(buf, pads + len);
+  }
+
+  template <class UNSIGNED_TYPE>
+  void ByteSink::PrintLexInBase(UNSIGNED_TYPE n, u32 base, s32 width, u8 pad) {
+    u8 digs[8 * sizeof(UNSIGNED_TYPE)];
+    const u32 len = FormatInBase(n, base, digs);
+
+    u32 digits = len;
+    if (width > (s32) digits)
+      digits = width;
+
+    // Header (at most '9' plus a lex32 of up to 99), padding, digits
+    u8 buf[4 + PAD_CHUNK + 8 * sizeof(UNSIGNED_TYPE)];
+    if (digits - len > PAD_CHUNK || digits > 99) {
+      PrintLexDigits(digits);    // Rare huge field; do it the long way
+      PrintInBase(n, base, width, pad);
+      return;
+    }
+
+    u32 at = 0;
+    if (digits > 8) {
+      buf[at++] = '9';
+      buf[at++] = digits > 9 ? '2' : '1';
+      at += FormatInBase(digits, 10, buf + at);
+    } else
+      buf[at++] = '0' + digits;
+
+    memset(buf + at, pad, digits - len);
+    at += digits - len;
+    memcpy(buf + at, digs, len);
+    WriteBytes(buf, at + len);
   }
 
 }
@@ -127,6 +127,73 @@ namespace MFM
      */
     virtual s32 ReadByte() = 0;
 
+    /**
+     * Reads up to \c len bytes into \c buf, as that many \c Read()
+     * calls would, including any \c Unread() byte, but fetching them
+     * with one \c ReadBytes() call.  Afterwards \c Unread() puts back
+     * the last byte read, or the end of input if fewer than \c len
+     * were available.
+     *
+     * @returns how many bytes were stored in \c buf; less than \c len
+     *          only at the end of input.
+     */
+    u32 Read(u8 * buf, u32 len)
+    {
+      if (len == 0)
+      {
+        return 0;
+      }
+
+      u32 got = 0;
+      if (m_unread)
+      {
+        m_unread = false;
+        if (m_lastRead < 0)
+        {
+          ++m_read;     // As Read() would: end of input again
+          return 0;
+        }
+        buf[got++] = (u8) m_lastRead;
+      }
+
+      got += ReadBytes(buf + got, len - got);
+      m_read += got;
+      if (got < len)
+      {
+        ++m_read;       // Counted like Read() returning end of input
+        m_lastRead = -1;
+      }
+      else
+      {
+        m_lastRead = buf[got - 1];
+      }
+      return got;
+    }
+
+    /**
+     * Gets up to the next \c len bytes from this ByteSource into \c
+     * buf, regardless of whether or not \c Unread() has been called.
+     * The default implementation loops over \c ReadByte(); subclasses
+     * that can copy a span at once should override it.
+     *
+     * @returns how many bytes were stored; less than \c len only at
+     *          the end of input.
+     */
+    virtual u32 ReadBytes(u8 * buf, u32 len)
+    {
+      u32 i;
+      for (i = 0; i < len; ++i)
+      {
+        s32 ch = ReadByte();
+        if (ch < 0)
+        {
+          break;
+        }
+        buf[i] = (u8) ch;
+      }
+      return i;
+    }
+
     /**
      * Deconstructs this ByteSource. Default implementation does nothing.
      */
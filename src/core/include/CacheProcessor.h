@@ -36,6 +36,7 @@
 #include "ChannelEnd.h"
 #include "MDist.h"  /* for EVENT_WINDOW_SITES */
 #include "Logger.h"
+#include "Probes.h"
 
 namespace MFM {
 
@@ -115,11 +116,12 @@ namespace MFM {
          MAX_CHECK_ODDS is the maximum value of m_checkOdds.
          1-in-MAX_CHECK_ODDS is the \e minimum amount of redundancy
          added to packet transfers to monitor remote cache quality.
-         If a cache failure is detected, m_checkOdds will be reduced
-         below this value, causing the \e actual redundancy to be
-         higher, at least temporarily.
+         Adaptive redundancy doubles m_checkOdds toward this value
+         while the link stays clean, and cuts it by CHECK_FAILURE_SHIFT
+         bits on each detected cache failure, so a clean link ends up
+         paying almost no redundant bytes.
        */
-      MAX_CHECK_ODDS = 20,
+      MAX_CHECK_ODDS = 256,
 
       /**
          INITIAL_CHECK_ODDS is the initial value of m_checkOdds.
@@ -127,7 +129,20 @@ namespace MFM {
          \sa MAX_CHECK_ODDS
          \sa m_checkOdds
        */
-      INITIAL_CHECK_ODDS = 1
+      INITIAL_CHECK_ODDS = 1,
+
+      /**
+         On a check failure, m_checkOdds is shifted right by this many
+         bits (but not below MIN_CHECK_ODDS).
+       */
+      CHECK_FAILURE_SHIFT = 2,
+
+      /**
+         The most m_checkFailureLevel can grow.  Each level doubles the
+         number of check atoms that must come back clean before
+         m_checkOdds is doubled.
+       */
+      MAX_CHECK_FAILURE_LEVEL = 6
     };
 
     /**
@@ -140,11 +155,21 @@ namespace MFM {
     u32 m_checkOdds;
 
     /**
-       The current number of consistent atoms acked since the last
-       possibility of increasing m_checkOdds.
+       The number of redundant check atoms confirmed consistent by the
+       remote cache since m_checkOdds last changed.
      */
     u32 m_remoteConsistentAtomCount;
 
+    /**
+       Recent flakiness of this link: incremented by each check
+       failure and decremented by each doubling of m_checkOdds, in
+       [0,MAX_CHECK_FAILURE_LEVEL].  Doubling m_checkOdds takes
+       SITE_COUNT << m_checkFailureLevel clean check atoms, so the
+       check bytes a link must spend to earn each backoff step grow
+       exponentially with its measured failure rate.
+     */
+    u32 m_checkFailureLevel;
+
     /**
        If true, automatically adjust m_checkOdds based on the reported
        accuracy of the remote cache content; otherwise leave
@@ -152,6 +177,15 @@ namespace MFM {
      */
     bool m_useAdaptiveRedundancy;
 
+    /** Redundant (unchanged) atoms this link has shipped as checks */
+    u32 m_checkAtomsShipped;
+
+    /** Cache update replies that confirmed every atom sent */
+    u32 m_cleanReplies;
+
+    /** Cache update replies that reported an inconsistent remote cache */
+    u32 m_failedReplies;
+
     u32 GetCheckOdds() const
     {
       return m_checkOdds;
@@ -159,23 +193,42 @@ namespace MFM {
 
     void ReportCheckFailure()
     {
+      ++m_failedReplies;
       if (m_useAdaptiveRedundancy)
       {
-        m_checkOdds = MIN_CHECK_ODDS;
+        m_checkOdds >>= CHECK_FAILURE_SHIFT;
+        if (m_checkOdds < MIN_CHECK_ODDS)
+        {
+          m_checkOdds = MIN_CHECK_ODDS;
+        }
+        if (m_checkFailureLevel < MAX_CHECK_FAILURE_LEVEL)
+        {
+          ++m_checkFailureLevel;
+        }
+        m_remoteConsistentAtomCount = 0;
       }
     }
 
-    void ReportCleanUpdate(u32 consistentAtoms)
+    void ReportCleanUpdate(u32 consistentCheckAtoms)
     {
+      ++m_cleanReplies;
       if (m_useAdaptiveRedundancy)
       {
-        m_remoteConsistentAtomCount += consistentAtoms;
-        if (m_remoteConsistentAtomCount >= SITE_COUNT)
+        m_remoteConsistentAtomCount += consistentCheckAtoms;
+        if (m_remoteConsistentAtomCount >= ((u32) SITE_COUNT << m_checkFailureLevel))
         {
-          m_remoteConsistentAtomCount -= SITE_COUNT;
+          m_remoteConsistentAtomCount = 0;
           if (m_checkOdds < MAX_CHECK_ODDS)
           {
-            ++m_checkOdds;
+            m_checkOdds <<= 1;
+            if (m_checkOdds > MAX_CHECK_ODDS)
+            {
+              m_checkOdds = MAX_CHECK_ODDS;
+            }
+          }
+          if (m_checkFailureLevel > 0)
+          {
+            --m_checkFailureLevel;
           }
         }
       }
@@ -196,6 +249,33 @@ namespace MFM {
      */
     bool IsCoordVisibleToPeer(const SPoint & local) ;
 
+    /**
+       Per-axis site masks, fixed by R: bit i of
+       m_siteAxisMasks[AXIS_X_GE][k] is set if site i's x offset is
+       at least k-R, and of [AXIS_X_LT][k] if it is less than k-R;
+       likewise for y.  Anding one of each gives the sites inside
+       any rectangle, so the peer's visible sites for an event
+       center are four lookups.  \sa UpdateVisibleSites
+     */
+    enum { AXIS_X_GE, AXIS_X_LT, AXIS_Y_GE, AXIS_Y_LT, AXIS_MASKS, AXIS_STEPS = 2 * R + 2 };
+    u64 m_siteAxisMasks[AXIS_MASKS][AXIS_STEPS];
+
+    /**
+       Bit i set iff site number i of the window around
+       m_eventCenter is visible to our peer.  \sa IsSiteNumberVisible
+     */
+    u64 m_visibleSites;
+
+    void InitSiteAxisMasks() ;
+
+    u64 GetSiteAxisMask(u32 axis, s32 threshold) const
+    {
+      const s32 k = threshold + R;
+      return m_siteAxisMasks[axis][k < 0 ? 0 : (k >= AXIS_STEPS ? AXIS_STEPS - 1 : k)];
+    }
+
+    void UpdateVisibleSites() ;
+
     struct CachePacketInfo {
       T m_atom;                // What to send
       u16 m_siteNumber;        // Where it lives
@@ -205,6 +285,107 @@ namespace MFM {
     u32 m_toSendCount;    // Used length of m_toSend
     u32 m_sentCount;      // Next index to send in m_toSend
 
+    enum {
+      /**
+         Largest packet we ship; the length byte preceding each packet
+         stays below 128.
+       */
+      MAX_PACKET_BYTES = 127,
+
+      /**
+         Bytes needed for one site in an UPDATE_BATCH packet: type,
+         site number, and the atom as BitVector::PrintBytes writes it.
+       */
+      BATCH_SITE_BYTES = 2 + 4 * ((AC::BITS_PER_ATOM + 31) / 32),
+
+      /**
+         Bytes of UPDATE_BATCH header: type, flags, and -- on the
+         first packet of an update -- the s16 center coordinates.
+       */
+      BATCH_HEADER_BYTES = 2,
+      BATCH_BEGIN_BYTES = 4,
+
+      /**
+         No site number is queued in m_toSend at this position of
+         m_toSendIndex.
+       */
+      NO_SEND_INDEX = 0xff
+    };
+
+    /**
+       If nonzero, ship cache updates using UPDATE_BATCH packets
+       carrying up to this many sites each (further limited by what
+       fits in a packet), with the update begin and end folded into
+       the first and last of them.  If zero, ship one packet per site
+       plus separate begin and end packets.
+     */
+    u32 m_cacheBatchLimit;
+
+    /**
+       True between StartShipping and the first UPDATE_BATCH packet of
+       an update, which must carry the update begin.
+     */
+    bool m_batchBeginPending;
+
+    /**
+       In batched mode, the position in m_toSend of each site number
+       queued in this update, or NO_SEND_INDEX.  Later MaybeSendAtoms
+       of the same site number overwrite the earlier one.
+     */
+    u8 m_toSendIndex[SITE_COUNT];
+
+    /**
+       If true, offer our peer compact cache updates, and accept its
+       offer.  \sa SetCompactCache
+     */
+    bool m_compactCache;
+
+    /**
+       True once this link has agreed to ship PacketType::UPDATE_COMPACT
+       both ways, which it then does for good.
+     */
+    bool m_compactAgreed;
+
+    /**
+       True if the update being received carried a
+       PacketType::BATCH_COMPACT_OFFER.
+     */
+    bool m_compactOfferReceived;
+
+    /**
+       Once compact, the last atom shipped either way over this link
+       for each site of our tile, indexed by full untransformed tile
+       coordinates; both ends keep theirs in step, as the reference
+       for COMPACT_SAME and COMPACT_WORDS sites.  Allocated when the
+       link agrees.
+     */
+    T * m_shippedAtoms;
+
+    /** Where site number \c siteNumber of the current window falls in m_shippedAtoms */
+    u32 GetShippedIndex(u16 siteNumber) const ;
+
+    /** Whether updates ship as UPDATE_BATCH or UPDATE_COMPACT packets */
+    bool IsShippingBatched() const
+    {
+      return m_cacheBatchLimit > 0 || m_compactCache || m_compactAgreed;
+    }
+
+    /**
+       Totals shipped by ShipBufferAsPacket, not counting the length
+       byte preceding each packet.
+     */
+    u32 m_packetsShipped;
+    u32 m_bytesShipped;
+
+    /**
+       TryLock calls that gave up with the lock still held elsewhere,
+       and those that got it only after spinning.
+     */
+    u32 m_lockFailures;
+    u32 m_lockSpinWins;
+
+    bool AdvanceShippingBatched() ;
+
     enum State
     {
       IDLE,         // Unlocked, not in use
@@ -326,11 +507,162 @@ namespace MFM {
         break;
       case ADAPTIVE:
         m_useAdaptiveRedundancy = true;
+        break;
       default:
         FAIL(ILLEGAL_ARGUMENT);
       }
     }
 
+    /**
+       Set the maximum number of sites per UPDATE_BATCH packet, or 0
+       to ship each site in its own packet.  Changing this is only
+       legal while the cache processor is not shipping.
+     */
+    void SetCacheBatchLimit(u32 maxSites)
+    {
+      MFM_API_ASSERT_STATE(m_cpState != LOADING && m_cpState != SHIPPING);
+      MFM_API_ASSERT(maxSites == 0 ||
+                     BATCH_HEADER_BYTES + BATCH_BEGIN_BYTES + BATCH_SITE_BYTES <= MAX_PACKET_BYTES,
+                     OUT_OF_ROOM);
+      m_cacheBatchLimit = maxSites;
+    }
+
+    u32 GetCacheBatchLimit() const
+    {
+      return m_cacheBatchLimit;
+    }
+
+    /**
+       Select whether to offer and accept compact cache updates (see
+       PacketType::UPDATE_COMPACT), which ship site number deltas,
+       one byte for an empty or unchanged atom, and only the changed
+       32-bit words of an atom.  An offering link ships batched (with
+       the batch limit, or as many sites as fit per packet if that is
+       0), putting the offer in each update's first packet until the
+       peer, also set compact, accepts in its reply.  After that both
+       ends ship compact for good, so turning this off only stops
+       links that haven't agreed.  Changing this is only legal while
+       the cache processor is not shipping or awaiting a reply.
+     */
+    void SetCompactCache(bool on)
+    {
+      MFM_API_ASSERT_STATE(m_cpState != LOADING && m_cpState != SHIPPING && m_cpState != RECEIVING);
+      m_compactCache = on;
+    }
+
+    bool IsCompactCache() const
+    {
+      return m_compactCache;
+    }
+
+    bool IsCompactAgreed() const
+    {
+      return m_compactAgreed;
+    }
+
+    /** Whether our updates should carry PacketType::BATCH_COMPACT_OFFER */
+    bool IsOfferingCompact() const
+    {
+      return m_compactCache && !m_compactAgreed;
+    }
+
+    /** Record that the update being received offers compact updates */
+    void NoteCompactOffer()
+    {
+      m_compactOfferReceived = true;
+    }
+
+    /**
+       Switch this link to compact updates, with every site's last
+       shipped atom starting out empty.
+     */
+    void AgreeCompact() ;
+
+    /**
+       The last atom shipped over this compact link for site number
+       \c siteNumber of the current window.  \sa SetShippedAtom
+     */
+    const T & GetShippedAtom(u16 siteNumber) const
+    {
+      MFM_API_ASSERT_STATE(m_compactAgreed);
+      return m_shippedAtoms[GetShippedIndex(siteNumber)];
+    }
+
+    void SetShippedAtom(u16 siteNumber, const T & atom)
+    {
+      MFM_API_ASSERT_STATE(m_compactAgreed);
+      m_shippedAtoms[GetShippedIndex(siteNumber)] = atom;
+    }
+
+    /** Heap bytes held by this CacheProcessor, for its compact link */
+    u64 GetStorageBytes() const
+    {
+      return m_shippedAtoms ? (u64) m_tile->TILE_WIDTH * m_tile->TILE_HEIGHT * sizeof(T) : 0;
+    }
+
+    u32 GetPacketsShipped() const
+    {
+      return m_packetsShipped;
+    }
+
+    u32 GetLockFailures() const
+    {
+      return m_lockFailures;
+    }
+
+    u32 GetLockSpinWins() const
+    {
+      return m_lockSpinWins;
+    }
+
+    u32 GetBytesShipped() const
+    {
+      return m_bytesShipped;
+    }
+
+    /** How many unchanged atoms this link has shipped as redundant checks */
+    u32 GetCheckAtomsShipped() const
+    {
+      return m_checkAtomsShipped;
+    }
+
+    /** The wire bytes spent on redundant check atoms (estimated per site) */
+    u32 GetCheckBytesShipped() const
+    {
+      return m_checkAtomsShipped * BATCH_SITE_BYTES;
+    }
+
+    /** How many cache update replies confirmed the remote cache consistent */
+    u32 GetCleanReplies() const
+    {
+      return m_cleanReplies;
+    }
+
+    /** How many cache update replies reported remote cache inconsistency */
+    u32 GetFailedReplies() const
+    {
+      return m_failedReplies;
+    }
+
+    /**
+       Access the index'th queued site of the update being shipped,
+       for PacketIO's use in building UPDATE_BATCH packets.
+     */
+    const T & GetPendingAtom(u32 index, PacketTypeCode & type, u16 & siteNumber) const
+    {
+      MFM_API_ASSERT_ARG(index < m_toSendCount);
+      const CachePacketInfo & cpi = m_toSend[index];
+      type = cpi.m_type;
+      siteNumber = cpi.m_siteNumber;
+      return cpi.m_atom;
+    }
+
+    /** How many sites the update being shipped has queued */
+    u32 GetPendingCount() const
+    {
+      return m_toSendCount;
+    }
+
     void ReportCacheProcessorStatus(Logger::Level level) ;
 
     /**
@@ -349,6 +681,16 @@ namespace MFM {
      */
     void StartLoading(const SPoint & eventCenter) ;
 
+    /**
+       Get the site numbers, as a bitmask, of the current event
+       window that our peer can see.  Sites outside it are ignored by
+       MaybeSendAtom.  Valid from StartLoading until StartShipping.
+     */
+    u64 GetVisibleSites() const
+    {
+      return m_visibleSites;
+    }
+
     /**
        Notify the CacheProcessor that m_toSend is now fully loaded and
        no more MaybeSendAtoms will occur for this event.
@@ -425,12 +767,31 @@ namespace MFM {
 
     bool ShipBufferAsPacket(PacketBuffer & pb) ;
 
-    bool TryLock(const u32 needed, const THREEDIR& eventlocks)
+    /**
+       Try to take the long-lived lock for an event needing \c needed
+       locks in \c eventlocks.  If it's held elsewhere, watch it for
+       up to \c spins more looks, retrying whenever it comes free,
+       before giving up.
+     */
+    bool TryLock(const u32 needed, const THREEDIR& eventlocks, u32 spins = 0)
     {
       MFM_API_ASSERT_STATE(m_locksNeeded == 0);
 
-      bool ret = GetLonglivedLock().TryLock(this);
-      if (ret)
+      LonglivedLock & lock = GetLonglivedLock();
+      bool ret = lock.TryLock(this);
+      for (u32 i = 0; !ret && i < spins; ++i)
+      {
+        if (lock.GetOwnerIndex() == 0 && lock.TryLock(this))
+        {
+          ret = true;
+          ++m_lockSpinWins;
+        }
+      }
+      if (!ret)
+      {
+        ++m_lockFailures;
+      }
+      else
       {
 	m_locksNeeded = needed;
 	for(u32 i = 0; i < needed; i++)
@@ -533,14 +894,41 @@ namespace MFM {
       , m_locksNeeded(0)
       , m_checkOdds(INITIAL_CHECK_ODDS)
       , m_remoteConsistentAtomCount(0)
+      , m_checkFailureLevel(0)
       , m_useAdaptiveRedundancy(true)
+      , m_checkAtomsShipped(0)
+      , m_cleanReplies(0)
+      , m_failedReplies(0)
+      , m_toSendCount(0)
+      , m_sentCount(0)
+      , m_cacheBatchLimit(0)
+      , m_batchBeginPending(false)
+      , m_compactCache(false)
+      , m_compactAgreed(false)
+      , m_compactOfferReceived(false)
+      , m_shippedAtoms(0)
+      , m_packetsShipped(0)
+      , m_bytesShipped(0)
+      , m_lockFailures(0)
+      , m_lockSpinWins(0)
       , m_cpState(UNCLAIMED)
       , m_eventCenter(0,0)
       , m_farSideOrigin(0,0)
     {
       m_lockRegions[0] = (Dir) -1;
+      m_visibleSites = 0;
+      InitSiteAxisMasks();
+    }
+
+    ~CacheProcessor()
+    {
+      delete [] m_shippedAtoms;
     }
 
+  private:
+    // Declare away
+    CacheProcessor(const CacheProcessor &) ;
+    CacheProcessor & operator=(const CacheProcessor &) ;
   };
 } /* namespace MFM */
 
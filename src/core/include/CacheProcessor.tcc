@@ -3,6 +3,7 @@
 #include "PacketIO.h"
 #include "CharBufferByteSource.h"
 #include "EventHistoryBuffer.h"
+#include "Element_Empty.h"
 
 namespace MFM
 {
@@ -23,9 +24,16 @@ namespace MFM
     LOG.Log(level,"    Address: %p", (void*) this);
     LOG.Log(level,"    State: %s", GetStateName(m_cpState));
     LOG.Log(level,"    EventCenter: (%d,%d)", m_eventCenter.GetX(), m_eventCenter.GetY());
-    LOG.Log(level,"    CheckOdds: %d", m_checkOdds);
+    LOG.Log(level,"    CheckOdds: %d (%s, failure level %d)", m_checkOdds,
+            m_useAdaptiveRedundancy ? "adaptive" : "fixed", m_checkFailureLevel);
+    LOG.Log(level,"    Checks:      %d atoms, %d bytes; %d clean, %d failed replies",
+            m_checkAtomsShipped, GetCheckBytesShipped(), m_cleanReplies, m_failedReplies);
     LOG.Log(level,"    ToSendCount: %d", m_toSendCount);
     LOG.Log(level,"    SentCount:   %d", m_sentCount);
+    LOG.Log(level,"    BatchLimit:  %d", m_cacheBatchLimit);
+    LOG.Log(level,"    Compact:     %s", m_compactAgreed ? "agreed" : (m_compactCache ? "offered" : "off"));
+    LOG.Log(level,"    Shipped:     %d packets, %d bytes", m_packetsShipped, m_bytesShipped);
+    LOG.Log(level,"    LockFails:   %d (%d more got it by spinning)", m_lockFailures, m_lockSpinWins);
 
     m_channelEnd.ReportChannelEndStatus(level);
   }
@@ -33,13 +41,43 @@ namespace MFM
   template <class EC>
   bool CacheProcessor<EC>::IsSiteNumberVisible(u16 siteNumber)
   {
+    return siteNumber < SITE_COUNT && ((m_visibleSites >> siteNumber) & 1);
+  }
+
+  template <class EC>
+  void CacheProcessor<EC>::InitSiteAxisMasks()
+  {
+    COMPILATION_REQUIREMENT< SITE_COUNT <= 64 >();
     const MDist<R> & md = MDist<R>::get();
+    for (u32 k = 0; k < AXIS_STEPS; ++k)
+    {
+      const s32 threshold = (s32) k - R;
+      for (u32 axis = 0; axis < AXIS_MASKS; ++axis)
+      {
+        m_siteAxisMasks[axis][k] = 0;
+      }
+      for (u32 i = 0; i < SITE_COUNT; ++i)
+      {
+        const SPoint & pt = md.GetPoint(i);
+        const u64 bit = ((u64) 1) << i;
+        m_siteAxisMasks[pt.GetX() >= threshold ? AXIS_X_GE : AXIS_X_LT][k] |= bit;
+        m_siteAxisMasks[pt.GetY() >= threshold ? AXIS_Y_GE : AXIS_Y_LT][k] |= bit;
+      }
+    }
+  }
+
+  template <class EC>
+  void CacheProcessor<EC>::UpdateVisibleSites()
+  {
+    Tile<EC> & tile = GetTile();
 
-    // Get site address in full untransformed tile coordinates
-    SPoint local = md.GetPoint(siteNumber) + m_eventCenter;
-    SPoint mdtmp = md.GetPoint(siteNumber);
-    MFM_LOG_DBG7(("site# %d, point(%d, %d), local(%d, %d)", siteNumber, mdtmp.GetX(), mdtmp.GetY(), local.GetX(), local.GetY()));
-    return IsCoordVisibleToPeer(local);
+    // Site i is visible iff 0 <= offset + m_eventCenter - m_farSideOrigin < size
+    const SPoint low = m_farSideOrigin - m_eventCenter;
+    m_visibleSites =
+      GetSiteAxisMask(AXIS_X_GE, low.GetX()) &
+      GetSiteAxisMask(AXIS_X_LT, low.GetX() + (s32) tile.TILE_WIDTH) &
+      GetSiteAxisMask(AXIS_Y_GE, low.GetY()) &
+      GetSiteAxisMask(AXIS_Y_LT, low.GetY() + (s32) tile.TILE_HEIGHT);
   }
 
   template <class EC>
@@ -62,6 +100,13 @@ namespace MFM
     // Now it's about shipping
     SetStateInternal(SHIPPING);
 
+    if (IsShippingBatched())
+    {
+      // The update begin rides along with the first batch
+      m_batchBeginPending = true;
+      return;
+    }
+
     PacketIO pbuffer;
     if (!pbuffer.SendUpdateBegin(*this, m_eventCenter))
     {
@@ -75,8 +120,16 @@ namespace MFM
     MFM_API_ASSERT_STATE(m_cpState == ACTIVE);
     SetStateInternal(LOADING);
     m_eventCenter = eventCenter;
+    UpdateVisibleSites();
     m_toSendCount = 0;
     m_sentCount = 0;
+    if (IsShippingBatched())
+    {
+      for (u32 i = 0; i < SITE_COUNT; ++i)
+      {
+        m_toSendIndex[i] = NO_SEND_INDEX;
+      }
+    }
   }
 
   template <class EC>
@@ -116,6 +169,23 @@ namespace MFM
                   99,
                   99));
 
+    if (IsShippingBatched() && siteNumber < SITE_COUNT)
+    {
+      // Last writer wins: supersede any earlier entry for this site
+      u8 & index = m_toSendIndex[siteNumber];
+      if (index != NO_SEND_INDEX)
+      {
+        CachePacketInfo & cpi = m_toSend[index];
+        cpi.m_atom = atom;
+        if (changed)
+        {
+          cpi.m_type = PacketType::UPDATE;
+        }
+        return;
+      }
+      index = (u8) m_toSendCount;
+    }
+
     // Allocate next struct
     CachePacketInfo & cpi = m_toSend[m_toSendCount++];
 
@@ -129,15 +199,15 @@ namespace MFM
   {
     MFM_API_ASSERT(!pb.HasOverflowed(), OUT_OF_ROOM);
 
-    u32 plen = pb.GetLength();
-    if (m_channelEnd.CanWrite() <= plen) // Total write will be plen+1
+    u32 plen = pb.GetLength();  // plen<128 since OString128..
+    if (!m_channelEnd.WritePacket((const u8 *) pb.GetBuffer(), plen))
     {
       return false;
     }
 
-    u8 byte = (u8) plen;  // plen<128 since OString128..
-    m_channelEnd.Write(&byte, 1);  // Packet length, then data
-    m_channelEnd.Write((const u8 *) pb.GetBuffer(), plen);
+    ++m_packetsShipped;
+    m_bytesShipped += plen;
+    MFM_PROBE3(cache__ship, (void *) m_tile, m_cacheDir, plen);
     return true;
   }
 
@@ -148,8 +218,37 @@ namespace MFM
 
     SetStateInternal(PASSIVE);
     m_eventCenter = onCenter;
+    UpdateVisibleSites();
     m_receivedSiteCount = 0;      // Nothing stashed so far
     m_consistentAtomCount = 0;
+    m_compactOfferReceived = false;
+  }
+
+  template <class EC>
+  void CacheProcessor<EC>::AgreeCompact()
+  {
+    Tile<EC> & t = GetTile();
+    const u32 sites = t.TILE_WIDTH * t.TILE_HEIGHT;
+    if (!m_shippedAtoms)
+    {
+      m_shippedAtoms = new T[sites];
+    }
+    const T & empty = Element_Empty<EC>::THE_INSTANCE.GetDefaultAtom();
+    for (u32 i = 0; i < sites; ++i)
+    {
+      m_shippedAtoms[i] = empty;
+    }
+    m_compactAgreed = true;
+  }
+
+  template <class EC>
+  u32 CacheProcessor<EC>::GetShippedIndex(u16 siteNumber) const
+  {
+    MFM_API_ASSERT_ARG(siteNumber < SITE_COUNT);
+    const SPoint loc = MDist<R>::get().GetPoint(siteNumber) + m_eventCenter;
+    MFM_API_ASSERT_STATE(loc.GetX() >= 0 && loc.GetX() < (s32) m_tile->TILE_WIDTH &&
+                         loc.GetY() >= 0 && loc.GetY() < (s32) m_tile->TILE_HEIGHT);
+    return loc.GetY() * m_tile->TILE_WIDTH + loc.GetX();
   }
 
   inline static u8 csgn(s32 n)
@@ -253,8 +352,17 @@ namespace MFM
     MFM_API_ASSERT_STATE(m_cpState == PASSIVE);
     MFM_LOG_DBG7(("Replying to UE, %d consistent",m_consistentAtomCount));
     ApplyCacheUpdate();
+
+    // Take up an offer of compact updates if we're game, starting
+    // both ends' shipped atoms after this update
+    const bool accept = m_compactOfferReceived && m_compactCache && !m_compactAgreed;
+    if (accept)
+    {
+      AgreeCompact();
+    }
+
     PacketIO pbuffer;
-    pbuffer.SendReply(m_consistentAtomCount, *this);
+    pbuffer.SendReply(m_consistentAtomCount, *this, accept);
     SetIdle();
   }
 
@@ -263,13 +371,23 @@ namespace MFM
   {
     MFM_API_ASSERT_STATE(m_cpState == RECEIVING);
 
+    u32 checkAtoms = 0;
+    for (u32 i = 0; i < m_toSendCount; ++i)
+    {
+      if (m_toSend[i].m_type == PacketType::CHECK)
+      {
+        ++checkAtoms;
+      }
+    }
+    m_checkAtomsShipped += checkAtoms;
+
     if (consistentCount != m_toSendCount)
     {
       ReportCheckFailure();
     }
     else
     {
-      ReportCleanUpdate(m_toSendCount);
+      ReportCleanUpdate(checkAtoms);
     }
     MFM_LOG_DBG7(("CP %s %s %d[%s %s %s] reply %d<->%d : %d",
                   GetTile().GetLabel(),
@@ -344,6 +462,11 @@ namespace MFM
 		  m_locksNeeded > 2? Dirs::GetName(m_lockRegions[2]) : "-",
                   m_farSideOrigin.GetX(),
                   m_farSideOrigin.GetY()));
+    if (IsShippingBatched())
+    {
+      return AdvanceShippingBatched();
+    }
+
     bool didWork = false;
     PacketIO pbuffer;
 
@@ -382,6 +505,76 @@ namespace MFM
     return didWork;
   }
 
+  template <class EC>
+  bool CacheProcessor<EC>::AdvanceShippingBatched()
+  {
+    bool didWork = false;
+    PacketIO pbuffer;
+
+    while (true)
+    {
+      u32 room = MAX_PACKET_BYTES - BATCH_HEADER_BYTES;
+      if (m_batchBeginPending)
+      {
+        room -= BATCH_BEGIN_BYTES;
+      }
+
+      // With no batch limit set, we're batching to go compact
+      const u32 limit = m_cacheBatchLimit > 0 ? m_cacheBatchLimit : SITE_COUNT;
+
+      u32 count;
+      if (m_compactAgreed)
+      {
+        // As many sites as fit, which depends on what they are
+        if (!pbuffer.SendCompactBatch(*this, m_eventCenter, m_batchBeginPending,
+                                      m_sentCount, limit, MAX_PACKET_BYTES, count))
+        {
+          return didWork;
+        }
+        for (u32 i = m_sentCount; i < m_sentCount + count; ++i)
+        {
+          SetShippedAtom(m_toSend[i].m_siteNumber, m_toSend[i].m_atom);
+        }
+      }
+      else
+      {
+        count = room / BATCH_SITE_BYTES;
+        if (count > limit)
+        {
+          count = limit;
+        }
+        if (count > m_toSendCount - m_sentCount)
+        {
+          count = m_toSendCount - m_sentCount;
+        }
+        if (!pbuffer.SendBatch(*this, m_eventCenter, m_batchBeginPending,
+                               m_sentCount + count == m_toSendCount, m_sentCount, count))
+        {
+          return didWork;
+        }
+      }
+      bool isEnd = (m_sentCount + count == m_toSendCount);
+      didWork = true;
+      m_batchBeginPending = false;
+      m_sentCount += count;
+
+      MFM_LOG_DBG7(("CP %s %s: Ship batch of %d (%d/%d)",
+                    GetTile().GetLabel(),
+                    Dirs::GetName(m_cacheDir),
+                    count,
+                    m_sentCount,
+                    m_toSendCount));
+
+      if (isEnd)
+      {
+        break;
+      }
+    }
+
+    SetStateInternal(RECEIVING);
+    return didWork;
+  }
+
   template <class EC>
   bool CacheProcessor<EC>::AdvanceReceiving()
   {
@@ -400,6 +593,7 @@ namespace MFM
         return didWork;
       }
       didWork = true;
+      MFM_PROBE3(cache__receive, (void *) m_tile, m_cacheDir, pb->GetLength());
       if (!pio.HandlePacket(*this, *pb))
       {
         FAIL(INCOMPLETE_CODE);
@@ -1755,6 +1755,237 @@ namespace MFM {
     return _Cu64ToBits64((cvala << shft), bitwidth);
   }
 
+  /*
+    Compile-time width variants.  Generated ulam code almost always
+    knows its bit widths statically, so these take them as template
+    arguments -- _Int32ToCs32<7>(val) rather than _Int32ToCs32(val, 7)
+    -- and reduce to a shift or a clamp against constants, with no
+    tests on the width left at runtime.  Results match the
+    runtime-width versions wherever those are well-defined; the
+    multiplies here also saturate correctly at widths where the
+    runtime versions overflow their C type first.
+  */
+
+  template <u32 WIDTH>
+  struct _CastWidth32
+  {
+    enum { SHIFT = 32 - WIDTH };
+    static u32 Ones() { return (u32) ((((u64) 1) << WIDTH) - 1); }
+    static s32 MaxS() { return (s32) ((((u64) 1) << (WIDTH - 1)) - 1); }
+    static s32 MinS() { return ~MaxS(); }
+    static void Check() { COMPILATION_REQUIREMENT<(WIDTH >= 1 && WIDTH <= 32)>(); }
+  };
+
+  template <u32 WIDTH>
+  struct _CastWidth64
+  {
+    enum { SHIFT = 64 - WIDTH };
+    static u64 Ones() { return WIDTH >= 64 ? ~((u64) 0) : (((u64) 1) << (WIDTH & 63)) - 1; }
+    static s64 MaxS() { return (s64) ((((u64) 1) << (WIDTH - 1)) - 1); }
+    static s64 MinS() { return ~MaxS(); }
+    static void Check() { COMPILATION_REQUIREMENT<(WIDTH >= 1 && WIDTH <= 64)>(); }
+  };
+
+  template <u32 WIDTH>
+  inline s32 _Int32ToCs32(u32 val)
+  {
+    typedef _CastWidth32<WIDTH> W;
+    W::Check();
+    return ((s32) (val << W::SHIFT)) >> W::SHIFT;
+  }
+
+  template <u32 WIDTH>
+  inline s64 _Int64ToCs64(u64 val)
+  {
+    typedef _CastWidth64<WIDTH> W;
+    W::Check();
+    return ((s64) (val << W::SHIFT)) >> W::SHIFT;
+  }
+
+  template <u32 WIDTH>
+  inline u32 _Cs32ToInt32(s32 val)
+  {
+    typedef _CastWidth32<WIDTH> W;
+    W::Check();
+    if (WIDTH == 32) return (u32) val;
+    return (u32) CLAMP<s32>(W::MinS(), W::MaxS(), val);
+  }
+
+  template <u32 WIDTH>
+  inline u64 _Cs64ToInt64(s64 val)
+  {
+    typedef _CastWidth64<WIDTH> W;
+    W::Check();
+    if (WIDTH == 64) return (u64) val;
+    return (u64) CLAMP<s64>(W::MinS(), W::MaxS(), val);
+  }
+
+  template <u32 WIDTH>
+  inline u32 _Unsigned32ToCu32(u32 val)
+  {
+    _CastWidth32<WIDTH>::Check();
+    return val;
+  }
+
+  template <u32 WIDTH>
+  inline u64 _Unsigned64ToCu64(u64 val)
+  {
+    _CastWidth64<WIDTH>::Check();
+    return val;
+  }
+
+  template <u32 WIDTH>
+  inline u32 _Cu32ToUnsigned32(u32 val)
+  {
+    typedef _CastWidth32<WIDTH> W;
+    W::Check();
+    if (WIDTH == 32) return val;
+    return MIN<u32>(val, W::Ones());
+  }
+
+  template <u32 WIDTH>
+  inline u64 _Cu64ToUnsigned64(u64 val)
+  {
+    typedef _CastWidth64<WIDTH> W;
+    W::Check();
+    if (WIDTH == 64) return val;
+    return MIN<u64>(val, W::Ones());
+  }
+
+  template <u32 WIDTH>
+  inline u32 _Cs32ToUnsigned32(s32 val)
+  {
+    return val <= 0 ? 0 : _Cu32ToUnsigned32<WIDTH>((u32) val);
+  }
+
+  template <u32 WIDTH>
+  inline u64 _Cs64ToUnsigned64(s64 val)
+  {
+    return val <= 0 ? 0 : _Cu64ToUnsigned64<WIDTH>((u64) val);
+  }
+
+  template <u32 SRCWIDTH, u32 DESTWIDTH>
+  inline u32 _Int32ToInt32(u32 val)
+  {
+    return _Cs32ToInt32<DESTWIDTH>(_Int32ToCs32<SRCWIDTH>(val));
+  }
+
+  template <u32 SRCWIDTH, u32 DESTWIDTH>
+  inline u64 _Int64ToInt64(u64 val)
+  {
+    return _Cs64ToInt64<DESTWIDTH>(_Int64ToCs64<SRCWIDTH>(val));
+  }
+
+  template <u32 SRCWIDTH, u32 DESTWIDTH>
+  inline u32 _Int32ToUnsigned32(u32 val)
+  {
+    return _Cs32ToUnsigned32<DESTWIDTH>(_Int32ToCs32<SRCWIDTH>(val));
+  }
+
+  template <u32 SRCWIDTH, u32 DESTWIDTH>
+  inline u32 _Unsigned32ToUnsigned32(u32 val)
+  {
+    return _Cu32ToUnsigned32<DESTWIDTH>(_Unsigned32ToCu32<SRCWIDTH>(val));
+  }
+
+  template <u32 SRCWIDTH, u32 DESTWIDTH>
+  inline u32 _Unsigned32ToInt32(u32 val)
+  {
+    const u32 maxs = (u32) _CastWidth32<DESTWIDTH>::MaxS();
+    return MIN<u32>(_Unsigned32ToCu32<SRCWIDTH>(val), maxs);
+  }
+
+  // Ariths on INT: below full width the exact result fits in the
+  // next larger C type, so there's nothing to check but the clamp
+
+  template <u32 WIDTH>
+  inline u32 _BinOpAddInt32(u32 vala, u32 valb)
+  {
+    const s32 cvala = _Int32ToCs32<WIDTH>(vala);
+    const s32 cvalb = _Int32ToCs32<WIDTH>(valb);
+    if (WIDTH == 32) return _BinOpAddCs32WithBoundsCheck(cvala, cvalb);
+    return _Cs32ToInt32<WIDTH>(cvala + cvalb);
+  }
+
+  template <u32 WIDTH>
+  inline u64 _BinOpAddInt64(u64 vala, u64 valb)
+  {
+    const s64 cvala = _Int64ToCs64<WIDTH>(vala);
+    const s64 cvalb = _Int64ToCs64<WIDTH>(valb);
+    if (WIDTH == 64) return _BinOpAddCs64WithBoundsCheck(cvala, cvalb);
+    return _Cs64ToInt64<WIDTH>(cvala + cvalb);
+  }
+
+  template <u32 WIDTH>
+  inline u32 _BinOpSubtractInt32(u32 vala, u32 valb)
+  {
+    const s32 cvala = _Int32ToCs32<WIDTH>(vala);
+    const s32 cvalb = _Int32ToCs32<WIDTH>(valb);
+    if (WIDTH == 32) return _BinOpSubtractCs32WithBoundsCheck(cvala, cvalb);
+    return _Cs32ToInt32<WIDTH>(cvala - cvalb);
+  }
+
+  template <u32 WIDTH>
+  inline u64 _BinOpSubtractInt64(u64 vala, u64 valb)
+  {
+    const s64 cvala = _Int64ToCs64<WIDTH>(vala);
+    const s64 cvalb = _Int64ToCs64<WIDTH>(valb);
+    if (WIDTH == 64) return _BinOpSubtractCs64WithBoundsCheck(cvala, cvalb);
+    return _Cs64ToInt64<WIDTH>(cvala - cvalb);
+  }
+
+  template <u32 WIDTH>
+  inline u32 _BinOpMultiplyInt32(u32 vala, u32 valb)
+  {
+    typedef _CastWidth32<WIDTH> W;
+    const s64 prod = ((s64) _Int32ToCs32<WIDTH>(vala)) * _Int32ToCs32<WIDTH>(valb);
+    return (u32) (s32) CLAMP<s64>(W::MinS(), W::MaxS(), prod);
+  }
+
+  // Ariths on UNSIGNED:
+
+  template <u32 WIDTH>
+  inline u32 _BinOpAddUnsigned32(u32 vala, u32 valb)
+  {
+    const u32 cvala = _Unsigned32ToCu32<WIDTH>(vala);
+    const u32 cvalb = _Unsigned32ToCu32<WIDTH>(valb);
+    if (WIDTH == 32) return _BinOpAddCu32WithBoundsCheck(cvala, cvalb);
+    return _Cu32ToUnsigned32<WIDTH>(cvala + cvalb);
+  }
+
+  template <u32 WIDTH>
+  inline u64 _BinOpAddUnsigned64(u64 vala, u64 valb)
+  {
+    const u64 cvala = _Unsigned64ToCu64<WIDTH>(vala);
+    const u64 cvalb = _Unsigned64ToCu64<WIDTH>(valb);
+    if (WIDTH == 64) return _BinOpAddCu64WithBoundsCheck(cvala, cvalb);
+    return _Cu64ToUnsigned64<WIDTH>(cvala + cvalb);
+  }
+
+  template <u32 WIDTH>
+  inline u32 _BinOpSubtractUnsigned32(u32 vala, u32 valb)
+  {
+    const u32 cvala = _Unsigned32ToCu32<WIDTH>(vala);
+    const u32 cvalb = _Unsigned32ToCu32<WIDTH>(valb);
+    return cvala <= cvalb ? 0 : cvala - cvalb;
+  }
+
+  template <u32 WIDTH>
+  inline u64 _BinOpSubtractUnsigned64(u64 vala, u64 valb)
+  {
+    const u64 cvala = _Unsigned64ToCu64<WIDTH>(vala);
+    const u64 cvalb = _Unsigned64ToCu64<WIDTH>(valb);
+    return cvala <= cvalb ? 0 : cvala - cvalb;
+  }
+
+  template <u32 WIDTH>
+  inline u32 _BinOpMultiplyUnsigned32(u32 vala, u32 valb)
+  {
+    typedef _CastWidth32<WIDTH> W;
+    const u64 prod = ((u64) _Unsigned32ToCu32<WIDTH>(vala)) * _Unsigned32ToCu32<WIDTH>(valb);
+    return (u32) MIN<u64>(prod, W::Ones());
+  }
+
 }
 
 #endif /* CASTOPS_H */
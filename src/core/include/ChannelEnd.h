@@ -126,6 +126,15 @@ namespace MFM
       return m_channel->Read(m_onSideA, data, length);
     }
 
+    /**
+       Write a length byte followed by length bytes of data, as one
+       packet, if there is room for all of it.  Serializes straight
+       into the channel's buffer when it offers a contiguous span.
+
+       \returns false, writing nothing, if the channel lacks room
+     */
+    bool WritePacket(const u8 * data, u32 length) ;
+
     s32 GetOwner() const
     {
       AssertConnected();
@@ -28,6 +28,7 @@
 #define CHARBUFFERBYTESOURCE_H
 
 #include "ByteSource.h"
+#include <string.h>     /* For memcpy */
 
 namespace MFM
 {
@@ -73,6 +74,18 @@ namespace MFM
       return (u8) m_input[m_read++]; // cast for non-negative result
     }
 
+    virtual u32 ReadBytes(u8 * buf, u32 len)
+    {
+      const u32 left = m_length - m_read;
+      if (len > left)
+      {
+        len = left;
+      }
+      memcpy(buf, m_input + m_read, len);
+      m_read += len;
+      return len;
+    }
+
     /**
      * Assigns a new char pointer to this CharBufferByteSource. Used
      * to reconstruct this CharBufferByteSource as needed.
@@ -44,6 +44,18 @@ namespace MFM
   class ColorMap
   {
    public:
+    /**
+     * Number of colors in each map's lookup table of interpolated
+     * colors.  \sa GetLUTColor
+     */
+    enum { LUT_SIZE = 1024 };
+
+    ColorMap()
+      : m_lutBuilt(false)
+    { }
+
+    virtual ~ColorMap() { }
+
     /**
      * Map value, which must be in the range of min..max to one of
      * five different colors.  If max<=min or value is out of range,
@@ -56,10 +68,24 @@ namespace MFM
      * Map value, which must be in the range of min..max to a color
      * interpolated linearly between five or six different colors
      * equally spaced from min to max.  If max<=min or value is out of
-     * range, return badColor.
+     * range, return badColor.  The color comes from the nearest of
+     * LUT_SIZE precomputed steps, so this costs a division and a
+     * lookup.
      */
     u32 GetInterpolatedColor(float value, float min, float max, u32 badColor) const;
 
+    /**
+     * The interpolated color lutIndex/(LUT_SIZE-1) of the way along
+     * this map, for callers that have already quantized their values
+     * to 0..LUT_SIZE-1.  lutIndex values past the end get the last
+     * color.
+     */
+    u32 GetLUTColor(u32 lutIndex) const
+    {
+      const u32 * lut = GetLUT();
+      return lut[lutIndex < LUT_SIZE ? lutIndex : LUT_SIZE - 1];
+    }
+
     /**
      * Gets the number of ColorMaps loaded into the system.
      *
@@ -80,6 +106,27 @@ namespace MFM
     virtual const u32 * GetColorArray() const = 0;
     virtual const char * GetName() const = 0;
     virtual u32 GetColorArrayLength() const = 0;
+
+    /**
+     * The color frac (0..1) of the way along the map, interpolated
+     * between its two nearest colors
+     */
+    u32 ComputeInterpolatedColor(float frac) const;
+
+    const u32 * GetLUT() const
+    {
+      if (!m_lutBuilt) BuildLUT();
+      return m_lut;
+    }
+
+    /**
+     * Fill m_lut.  Threads racing here all write the same colors, and
+     * only then set m_lutBuilt.
+     */
+    void BuildLUT() const;
+
+    mutable u32 m_lut[LUT_SIZE];
+    mutable volatile bool m_lutBuilt;
   };
 
 
@@ -0,0 +1,185 @@
+/*                                              -*- mode:C++ -*-
+  DatumQueues.h A tile's lock-free queues of external data
+  Copyright (C) 2014 The Regents of the University of New Mexico.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+  USA
+*/
+
+/**
+  \file DatumQueues.h A tile's lock-free queues of external data
+  \lgpl
+ */
+#ifndef DATUMQUEUES_H
+#define DATUMQUEUES_H
+
+#include "itype.h"
+#include "SPSCQueue.h"
+
+namespace MFM
+{
+  /**
+     A tile's connection to the outside world for streaming data: an
+     input queue of datums that emitters turn into atoms, and an
+     output queue of the datums consumers absorb.  An I/O thread (see
+     DatumStreamer) feeds the one and drains the other in batches, so
+     the tile side never blocks, and never does I/O.
+
+     The queues are SPSCQueues, but a tile can run events on several
+     threads at once (see Tile::SetEventWorkers), so the tile side
+     claims each queue with an atomic flag first.  A claim that finds
+     the flag taken just fails -- as if the queue were empty, or
+     full -- rather than wait.
+   */
+  class DatumQueues
+  {
+  public:
+    enum { QUEUE_BYTES = 1 << 12 };  // 1024 datums each way
+
+    DatumQueues()
+      : m_inClaim(0)
+      , m_outClaim(0)
+      , m_fed(0)
+      , m_taken(0)
+      , m_rejected(0)
+      , m_put(0)
+      , m_dropped(0)
+    { }
+
+    /**
+       Is there an input source behind this queue?  If not, emitters
+       make up their own data.  Tile side.
+     */
+    bool IsFed() const
+    {
+      return __atomic_load_n(&m_fed, __ATOMIC_RELAXED) != 0;
+    }
+
+    /**
+       Take the next input datum, if there's one and no other event
+       is taking one.  Tile side.
+
+       \returns true if \c datum was set
+     */
+    bool TakeInput(u32 & datum)
+    {
+      if (__atomic_exchange_n(&m_inClaim, 1, __ATOMIC_ACQUIRE))
+      {
+        return false;
+      }
+      const bool got = m_in.ReadAll((u8 *) &datum, sizeof(datum));
+      __atomic_store_n(&m_inClaim, 0, __ATOMIC_RELEASE);
+      if (got)
+      {
+        __atomic_add_fetch(&m_taken, 1, __ATOMIC_RELAXED);
+      }
+      return got;
+    }
+
+    /** Count an input datum the taker couldn't use.  Tile side. */
+    void RejectInput()
+    {
+      __atomic_add_fetch(&m_rejected, 1, __ATOMIC_RELAXED);
+    }
+
+    /**
+       Queue \c datum for output, unless the queue is full or another
+       event is putting one, in which case it's counted as dropped.
+       Tile side.
+
+       \returns true if it was queued
+     */
+    bool PutOutput(u32 datum)
+    {
+      bool put = false;
+      if (!__atomic_exchange_n(&m_outClaim, 1, __ATOMIC_ACQUIRE))
+      {
+        put = m_out.WriteAll((const u8 *) &datum, sizeof(datum));
+        __atomic_store_n(&m_outClaim, 0, __ATOMIC_RELEASE);
+      }
+      __atomic_add_fetch(put ? &m_put : &m_dropped, 1, __ATOMIC_RELAXED);
+      return put;
+    }
+
+    /** Say whether there's an input source.  I/O side. */
+    void SetFed(bool fed)
+    {
+      __atomic_store_n(&m_fed, fed ? 1 : 0, __ATOMIC_RELAXED);
+    }
+
+    /**
+       Queue as many of the \c count datums at \c datums as fit.  I/O
+       side.
+
+       \returns how many were queued
+     */
+    u32 FeedInput(const u32 * datums, u32 count)
+    {
+      const u32 room = m_in.GetWritable() / sizeof(u32);
+      const u32 n = count < room ? count : room;
+      if (n > 0)
+      {
+        m_in.WriteAll((const u8 *) datums, n * sizeof(u32));
+      }
+      return n;
+    }
+
+    /**
+       Take up to \c max queued output datums into \c datums.  I/O
+       side.
+
+       \returns how many were taken
+     */
+    u32 DrainOutput(u32 * datums, u32 max)
+    {
+      const u32 ready = m_out.GetReadable() / sizeof(u32);
+      const u32 n = max < ready ? max : ready;
+      if (n > 0)
+      {
+        m_out.ReadAll((u8 *) datums, n * sizeof(u32));
+      }
+      return n;
+    }
+
+    /** Input datums taken by the tile so far */
+    u64 GetInputTaken() const { return __atomic_load_n(&m_taken, __ATOMIC_RELAXED); }
+
+    /** Input datums taken but unusable, say out of range */
+    u64 GetInputRejected() const { return __atomic_load_n(&m_rejected, __ATOMIC_RELAXED); }
+
+    /** Output datums queued so far */
+    u64 GetOutputPut() const { return __atomic_load_n(&m_put, __ATOMIC_RELAXED); }
+
+    /** Output datums lost to a full or busy queue */
+    u64 GetOutputDropped() const { return __atomic_load_n(&m_dropped, __ATOMIC_RELAXED); }
+
+  private:
+    SPSCQueue<QUEUE_BYTES> m_in;
+    SPSCQueue<QUEUE_BYTES> m_out;
+    u32 m_inClaim;
+    u32 m_outClaim;
+    u32 m_fed;
+    u64 m_taken;
+    u64 m_rejected;
+    u64 m_put;
+    u64 m_dropped;
+
+    // Declare away
+    DatumQueues(const DatumQueues &) ;
+    DatumQueues & operator=(const DatumQueues &) ;
+  };
+}
+
+#endif /* DATUMQUEUES_H */
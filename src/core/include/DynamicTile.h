@@ -0,0 +1,134 @@
+/*                                              -*- mode:C++ -*-
+  DynamicTile.h A Tile sized at runtime
+  Copyright (C) 2020 The Living Computation Foundation.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+  USA
+*/
+
+/**
+  \file DynamicTile.h A Tile sized at runtime
+  \author David H. Ackley.
+  \date (C) 2020 All rights reserved.
+  \lgpl
+ */
+#ifndef DYNAMICTILE_H
+#define DYNAMICTILE_H
+
+#include "MFMSTile.h"
+
+namespace MFM
+{
+
+  /**
+     The heap-allocated site storage of a DynamicTile, constructed
+     before the Tile base for the same reason as SizedTileStorage.
+   */
+  template <class SITE>
+  struct DynamicTileStorage
+  {
+    typedef typename SITE::ATOM_CONFIG AC;
+    typedef typename AC::ATOM_TYPE T;
+    typedef typename SITE::BASE B;
+
+    SITE * m_sites;
+    T * m_atomPlane;
+    BaseLayer<B> m_baseLayer;
+
+    DynamicTileStorage(u32 sites)
+      : m_sites(new SITE[sites])
+      , m_atomPlane(SITE::IS_PLANAR ? new T[sites] : 0)
+      , m_baseLayer()
+    {
+      if (SITE::IS_PLANAR)
+      {
+        m_baseLayer.SetSiteCount(sites);
+        for (u32 i = 0; i < sites; ++i)
+        {
+          m_sites[i].BindPlanes(&m_atomPlane[i], &m_baseLayer, i);
+        }
+      }
+    }
+
+    ~DynamicTileStorage()
+    {
+      delete [] m_atomPlane;
+      delete [] m_sites;
+    }
+
+  private:
+    // Declare away; the storage is not copyable
+    DynamicTileStorage(const DynamicTileStorage &) ;
+    DynamicTileStorage & operator=(const DynamicTileStorage &) ;
+  };
+
+  /**
+     A DynamicTile is a completed Tile whose width and height are
+     chosen when it is constructed, say from the command line, rather
+     than by template arguments as with SizedTile.  Tile and
+     EventWindow are already written against a runtime TILE_WIDTH
+     and TILE_HEIGHT, and are specialized only on the EventConfig
+     (and so on the event window radius), so one instantiation of
+     them serves DynamicTiles of every size.
+
+     The price is the constant-folded geometry queries SizedTile
+     offers; the event path itself runs the same code either way.
+     See the 'Tile event' lines of 'mfmtest --bench'.
+   */
+  template <class EC>
+  class DynamicTile
+    : private DynamicTileStorage<typename EC::SITE>
+    , public MFMSTile<EC>
+  {
+    typedef DynamicTileStorage<typename EC::SITE> Storage;
+
+  public:
+    typedef typename EC::SITE SITE;
+
+    /**
+       Make a \c width by \c height tile, caches included, remembering
+       \c eventHistorySize events.  Like any Tile, fails with
+       ILLEGAL_ARGUMENT unless both sides are even and at least six
+       event window radii.
+     */
+    DynamicTile(u32 width, u32 height,
+                GridLayoutPattern layout = GRID_LAYOUT_CHECKERBOARD,
+                u32 eventHistorySize = 1000)
+      : Storage(width * height)
+      , MFMSTile<EC>(width, height, layout, Storage::m_sites, eventHistorySize, 0)
+    { }
+
+    /**
+       Add what this DynamicTile holds to \c account: its heap site
+       storage, and then what Tile::AccountMemory finds.
+     */
+    void AccountMemory(MemoryAccount & account) const
+    {
+      const u64 sites = (u64) this->TILE_WIDTH * this->TILE_HEIGHT;
+      account.Add(MemoryAccount::SITES,
+                  sites * (sizeof(SITE) + (SITE::IS_PLANAR ? sizeof(typename Storage::T) : 0)));
+      MFMSTile<EC>::AccountMemory(account);
+      account.Add(MemoryAccount::TILES, sizeof(*this) - sizeof(MFMSTile<EC>));
+    }
+
+  private:
+    // Declare away; the storage is not copyable
+    DynamicTile(const DynamicTile &) ;
+    DynamicTile & operator=(const DynamicTile &) ;
+  };
+
+} /* namespace MFM */
+
+#endif /*DYNAMICTILE_H*/
@@ -37,11 +37,13 @@
 #include "Dirs.h"
 #include "Logger.h"
 #include "BitField.h"
+#include "SweepRule.h"
 
 namespace MFM
 {
 
   template <class EC> class EventWindow; // FORWARD
+  template <class EC> class EventWindowBatch; // FORWARD
   template <class EC> class ElementTable; // FORWARD
   template <class EC> class UlamElement; // FORWARD
   template <class EC> class UlamClassRegistry; // FORWARD
@@ -99,6 +101,18 @@ namespace MFM
      */
     bool m_renderLowlight;
 
+    /**
+     * A flag declaring that Behavior does nothing, so events centered
+     * on this Element's atoms need not run at all.  \sa IsInert
+     */
+    bool m_inert;
+
+    /**
+     * A flag declaring that Diffusability always returns
+     * COMPLETE_DIFFUSABILITY.  \sa IsAlwaysDiffusable
+     */
+    bool m_alwaysDiffusable;
+
     /**
      * The basic, most generic Atom of this Element to be used when
      * placing a new Atom.
@@ -251,6 +265,32 @@ namespace MFM
       m_name = name;
     }
 
+    /**
+     * Declares that this Element's Behavior does nothing, for
+     * subclasses to call from their constructors.  Only declare it
+     * if Behavior never changes anything, since it won't be called.
+     *
+     * @param inert \c true if events on this Element's atoms may be
+     *              skipped.
+     */
+    void SetInert(bool inert)
+    {
+      m_inert = inert;
+    }
+
+    /**
+     * Declares that this Element never overrides the default
+     * Diffusability, for subclasses to call from their constructors,
+     * so EventWindow::Diffuse can skip asking it.
+     *
+     * @param always \c true if Diffusability always returns
+     *               COMPLETE_DIFFUSABILITY.
+     */
+    void SetAlwaysDiffusable(bool always)
+    {
+      m_alwaysDiffusable = always;
+    }
+
    public:
 
     /**
@@ -263,6 +303,8 @@ namespace MFM
     Element(const UUID & uuid) : m_UUID(uuid), m_type(0),
                                  m_hasType(false),
                                  m_renderLowlight(false),
+                                 m_inert(false),
+                                 m_alwaysDiffusable(false),
                                  m_atomicSymbol("!!"),
                                  m_name("UNNAMED")
     {
@@ -427,6 +469,75 @@ namespace MFM
      */
     virtual void Behavior(EventWindow<EC>& window) const = 0;
 
+    /**
+     * Checks whether this Element declared its Behavior a no-op.
+     * Events centered on an inert Element in a tile's hidden region
+     * are counted and recorded at their sites, but neither load an
+     * event window nor call Behavior.
+     *
+     * @returns \c true if this Element has been declared inert.
+     */
+    bool IsInert() const
+    {
+      return m_inert;
+    }
+
+    /**
+     * Checks whether this Element declared its Diffusability complete
+     * everywhere, for a cheap check before calling it.
+     *
+     * @returns \c true if this Element has been declared always
+     *          diffusable.
+     */
+    bool IsAlwaysDiffusable() const
+    {
+      return m_alwaysDiffusable;
+    }
+
+    /**
+     * Whether a tile running batched events (see
+     * Tile::SetEventBatchSize) may gather several events centered on
+     * this Element into one BatchBehavior call.  Worth saying true
+     * only for elements whose behavior is cheap next to the per-event
+     * dispatch, and only with a BatchBehavior that calls Behavior
+     * non-virtually.
+     */
+    virtual bool IsBatchable() const
+    {
+      return false;
+    }
+
+    /**
+     * Runs this Element's behavior on every event of \c batch, whose
+     * windows don't overlap.  Overrides should look like this one,
+     * but call their own class's Behavior by its qualified name so it
+     * can be inlined.
+     *
+     * @param batch The events to run, stepped through with Next.
+     */
+    virtual void BatchBehavior(EventWindowBatch<EC>& batch) const
+    {
+      while (batch.Next())
+      {
+        Behavior(batch.GetWindow());
+      }
+    }
+
+    /**
+     * Describes this Element's behavior as a SweepRule, if it is
+     * simple enough for one, so a TileSweeper can run its events as a
+     * data-parallel kernel.  Elements without one have their events
+     * run normally, through Behavior, instead.
+     *
+     * @param rule Filled in, if this returns \c true
+     *
+     * @returns \c true if this Element's behavior is \c rule
+     */
+    virtual bool GetSweepRule(SweepRule & rule) const
+    {
+      return false;
+    }
+
     /**
        Downcast an Element pointer to an UlamElement pointer, if
        possible.
@@ -533,6 +644,23 @@ namespace MFM
       return GetElementColor();
     }
 
+    /**
+     * Declares, for renderers that memoize atom colors, what
+     * GetAtomColor() depends on.  Return true only if, for this \c
+     * selector, GetAtomColor() is a pure function of the \c
+     * bitLength atom bits starting at \c firstBit (absolute bit
+     * positions, as for a BitField).  A \c bitLength of 0 means the
+     * color doesn't depend on the atom at all.  Fields longer than
+     * ElementColorCache::MAX_FIELD_BITS are not cached.
+     *
+     * The default returns false, so every atom's color is computed
+     * afresh.  Override this along with GetAtomColor().
+     */
+    virtual bool GetColorStateField(u32 selector, u32 & firstBit, u32 & bitLength) const
+    {
+      return false;
+    }
+
     /**
      * Gets the 32-bit ARGB color that represents a specific atom of
      * this Element, possibly computed on the fly, and possibly
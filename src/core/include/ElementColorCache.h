@@ -0,0 +1,152 @@
+/*                                              -*- mode:C++ -*-
+  ElementColorCache.h Memoized atom colors for rendering
+  Copyright (C) 2020 The Living Computation Foundation.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+  USA
+*/
+
+/**
+  \file ElementColorCache.h Memoized atom colors for rendering
+  \author David H. Ackley.
+  \date (C) 2020 All rights reserved.
+  \lgpl
+ */
+
+#ifndef ELEMENTCOLORCACHE_H
+#define ELEMENTCOLORCACHE_H
+
+#include "itype.h"
+#include "Element.h"
+
+namespace MFM {
+
+  /**
+     A direct-mapped cache of Element::GetDynamicColor() results, for
+     elements whose Element::GetColorStateField() says their color is
+     a pure function of a small field of the atom.  Other elements'
+     colors are computed every time.  Colors can still change with
+     user settings such as lowlighting, so Clear() the cache once per
+     frame.
+   */
+  template <class EC>
+  class ElementColorCache {
+  public:
+    typedef typename EC::ATOM_CONFIG AC;
+    typedef typename AC::ATOM_TYPE T;
+
+    enum {
+      MAX_FIELD_BITS = 16,
+
+      FIELD_SLOT_BITS = 6,
+      FIELD_SLOT_COUNT = 1<<FIELD_SLOT_BITS,
+      FIELD_SLOT_MASK = FIELD_SLOT_COUNT-1,
+
+      COLOR_SLOT_BITS = 10,
+      COLOR_SLOT_COUNT = 1<<COLOR_SLOT_BITS
+    };
+
+    ElementColorCache()
+      : m_hits(0)
+      , m_misses(0)
+    {
+      Clear();
+    }
+
+    void Clear()
+    {
+      for (u32 i = 0; i < FIELD_SLOT_COUNT; ++i) m_fields[i].m_element = 0;
+      for (u32 i = 0; i < COLOR_SLOT_COUNT; ++i) m_colors[i].m_element = 0;
+    }
+
+    /**
+       \returns elt.GetDynamicColor(et, ucr, atom, selector), from the
+       cache if possible.  \c atom must be sane and of \c elt's type.
+     */
+    u32 GetColor(const ElementTable<EC> & et, const UlamClassRegistry<EC> & ucr,
+                 const Element<EC> & elt, const T & atom, u32 selector)
+    {
+      const FieldSlot & fs = GetField(elt, selector);
+      if (!fs.m_cacheable)
+        return elt.GetDynamicColor(et, ucr, atom, selector);
+
+      const u32 value = fs.m_length ?
+        Element<EC>::GetBits(atom).Read(fs.m_firstBit, fs.m_length) : 0;
+      ColorSlot & cs = m_colors[GetColorSlot(elt.GetType(), selector, value)];
+      if (cs.m_element == &elt && cs.m_selector == selector && cs.m_value == value)
+      {
+        ++m_hits;
+        return cs.m_color;
+      }
+      ++m_misses;
+      cs.m_element = &elt;
+      cs.m_selector = selector;
+      cs.m_value = value;
+      cs.m_color = elt.GetDynamicColor(et, ucr, atom, selector);
+      return cs.m_color;
+    }
+
+    u32 GetHits() const { return m_hits; }
+    u32 GetMisses() const { return m_misses; }
+
+  private:
+    /** What an element has declared about one selector's colors */
+    struct FieldSlot {
+      const Element<EC> * m_element; // 0 if unused
+      u32 m_selector;
+      bool m_cacheable;
+      u32 m_firstBit;
+      u32 m_length;
+    };
+
+    struct ColorSlot {
+      const Element<EC> * m_element; // 0 if unused
+      u32 m_selector;
+      u32 m_value;
+      u32 m_color;
+    };
+
+    const FieldSlot & GetField(const Element<EC> & elt, u32 selector)
+    {
+      FieldSlot & fs = m_fields[(elt.GetType() * 4u + selector) & FIELD_SLOT_MASK];
+      if (fs.m_element != &elt || fs.m_selector != selector)
+      {
+        fs.m_element = &elt;
+        fs.m_selector = selector;
+        fs.m_firstBit = 0;
+        fs.m_length = 0;
+        fs.m_cacheable =
+          elt.GetColorStateField(selector, fs.m_firstBit, fs.m_length) &&
+          fs.m_length <= MAX_FIELD_BITS &&
+          fs.m_firstBit + fs.m_length <= AC::BITS_PER_ATOM;
+      }
+      return fs;
+    }
+
+    static u32 GetColorSlot(u32 type, u32 selector, u32 value)
+    {
+      const u32 h = (type * 4u + selector) * 65599u + value;
+      return (h * 2654435761u) >> (32 - COLOR_SLOT_BITS);
+    }
+
+    FieldSlot m_fields[FIELD_SLOT_COUNT];
+    ColorSlot m_colors[COLOR_SLOT_COUNT];
+    u32 m_hits;
+    u32 m_misses;
+  };
+
+} //MFM
+
+#endif /* ELEMENTCOLORCACHE_H */
@@ -0,0 +1,151 @@
+/*                                              -*- mode:C++ -*-
+  ElementProfile.h Per-element-type accounting of behavior time
+  Copyright (C) 2014-2016 The Regents of the University of New Mexico.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+  USA
+*/
+
+/**
+  \file ElementProfile.h Per-element-type accounting of behavior time
+  \date (C) 2014-2016 All rights reserved.
+  \lgpl
+ */
+#ifndef ELEMENTPROFILE_H
+#define ELEMENTPROFILE_H
+
+#include "itype.h"
+#include "EventPhaseTimer.h"  /* For ReadEventTimestamp */
+
+namespace MFM
+{
+  /**
+     An ElementProfile accumulates, for each element type whose
+     Behavior has run, how many times it ran, the total and maximum
+     timestamp ticks (see ReadEventTimestamp) each run took, and how
+     many sites its events wrote back.  Each Tile owns one, which its
+     EventWindow feeds while Tile::IsElementProfiling(); Grid totals
+     them.
+   */
+  class ElementProfile
+  {
+  public:
+    enum
+    {
+      SLOT_BITS = 8,
+      SLOT_COUNT = 1<<SLOT_BITS,  // Room for every type an ElementTable holds
+      SLOT_MASK = SLOT_COUNT-1
+    };
+
+    struct Entry
+    {
+      u32 m_type;
+      u64 m_calls;
+      u64 m_totalTicks;
+      u64 m_maxTicks;
+      u64 m_sitesWritten;
+
+      u64 GetMeanTicks() const
+      {
+        return m_calls ? m_totalTicks / m_calls : 0;
+      }
+    };
+
+    ElementProfile()
+    {
+      Reset();
+    }
+
+    void Reset() ;
+
+    /**
+       Credit one Behavior call of element \a type, taking \a ticks,
+       whose event wrote back \a sitesWritten sites.  Calls beyond
+       SLOT_COUNT distinct types are only counted by GetUnrecorded().
+     */
+    void Record(u32 type, u64 ticks, u32 sitesWritten)
+    {
+      Entry * e = FindOrAdd(type);
+      if (!e)
+      {
+        ++m_unrecorded;
+        return;
+      }
+      ++e->m_calls;
+      e->m_totalTicks += ticks;
+      if (ticks > e->m_maxTicks)
+      {
+        e->m_maxTicks = ticks;
+      }
+      e->m_sitesWritten += sitesWritten;
+    }
+
+    /** Fold \a other's counts into this profile, e.g., to total a grid */
+    void Add(const ElementProfile & other) ;
+
+    /** \returns the entry for element \a type, or NULL if it never ran */
+    const Entry * Find(u32 type) const ;
+
+    /** Number of distinct element types recorded */
+    u32 GetEntryCount() const { return m_entryCount; }
+
+    /** The \a index'th recorded entry, in no particular order */
+    const Entry & GetEntry(u32 index) const ;
+
+    /** Total ticks over all recorded types */
+    u64 GetTotalTicks() const ;
+
+    u64 GetUnrecorded() const { return m_unrecorded; }
+
+    /**
+       Fill \a out with pointers to up to \a max entries, most total
+       ticks first.  \returns how many were filled.
+     */
+    u32 GetTopByTicks(const Entry ** out, u32 max) const ;
+
+  private:
+    Entry m_entries[SLOT_COUNT];
+    u16 m_slotToEntry[SLOT_COUNT];  // Entry index + 1, or 0 if unused
+    u32 m_entryCount;
+    u64 m_unrecorded;
+
+    static u32 GetProbeStart(u32 type)
+    {
+      return (type * 2654435761u) >> (32 - SLOT_BITS);
+    }
+
+    Entry * FindOrAdd(u32 type)
+    {
+      u32 idx = GetProbeStart(type);
+      for (u32 p = 0; p < SLOT_COUNT; ++p, idx = (idx+1)&SLOT_MASK)
+      {
+        const u32 ent = m_slotToEntry[idx];
+        if (ent == 0)
+        {
+          return Add(type, idx);
+        }
+        if (m_entries[ent-1].m_type == type)
+        {
+          return &m_entries[ent-1];
+        }
+      }
+      return 0;
+    }
+
+    Entry * Add(u32 type, u32 slot) ;
+  };
+} /* namespace MFM */
+
+#endif /* ELEMENTPROFILE_H */
@@ -48,12 +48,19 @@ namespace MFM
     typedef typename AC::ATOM_TYPE T;
     enum { B = AC::ATOM_TYPE_BITS};
     enum { R = EC::EVENT_WINDOW_RADIUS};
-    //XXX currently deprecated    enum { ELEMENT_DATA_SLOTS = P::ELEMENT_DATA_SLOTS};
 
   public:
     // -3 to avoid 2**k and 2**k-1 sizes; they seem to beat against type assignments
     static const u32 SIZE = (1u<<(B/2)) - 3; // ~250
 
+    /**
+     * The most u64's of element-specific data an element may have.
+     * They live in the element's table entry, right after the
+     * element pointer that Lookup finds there, so reading them costs
+     * no more than the lookup does.
+     */
+    enum { ELEMENT_DATA_SLOTS = 6 };
+
     /**
      * Reinitialize this ElementTable to empty.
      */
@@ -90,6 +97,43 @@ namespace MFM
      */
     const Element<EC> * ReplaceEmptyElement(const Element<EC> & newEmptyElement) ;
 
+    /**
+     * Replace each registered element olds[i] with news[i], keeping
+     * its element-specific data, for i from 0 to count-1.  The new
+     * elements must already have types, which needn't match the old
+     * ones; olds that aren't registered here are ignored.  The table
+     * is rehashed, and refrozen if it was frozen.  This is for
+     * swapping in a reloaded element library, with the grid paused.
+     *
+     * @fails DUPLICATE_ENTRY, leaving the table unchanged, if two
+     * elements would end up with the same type
+     */
+    void ReplaceElements(const Element<EC> * const * olds,
+                         const Element<EC> * const * news,
+                         u32 count) ;
+
+    /**
+     * Build a collision-free dispatch table over the currently
+     * registered elements, so that Lookup(u32) -- and finding an
+     * element's data slots -- becomes a single indexed load plus a
+     * type check, with no probing.  A frozen
+     * table rebuilds its dispatch table on any later Insert,
+     * ReplaceEmptyElement, or ReplaceElements; Reinit thaws it.
+     *
+     * @returns \c true if a dispatch table was built, or \c false
+     *          (leaving the table thawed) if no perfect hash was
+     *          found within FROZEN_MAX_BITS.
+     */
+    bool Freeze() ;
+
+    /**
+     * Returns \c true if Lookup(u32) is using a frozen dispatch table.
+     */
+    bool IsFrozen() const
+    {
+      return m_isFrozen;
+    }
+
     /**
      * Gets the capacity of this ElementTable, in Elements that may be
      * registered.
@@ -118,6 +162,19 @@ namespace MFM
      */
     s32 GetIndex(u32 elementType) const ;
 
+    /**
+     * Gets the Element at a particular index of this ElementTable.
+     *
+     * @param index An index from 0..GetSize()-1, as from GetIndex.
+     *
+     * @returns The Element at \c index, or NULL if none is there.
+     */
+    const Element<EC> * GetElementAtIndex(u32 index) const
+    {
+      MFM_API_ASSERT_ARG(index < SIZE);
+      return m_hash[index].m_element;
+    }
+
     /**
      * Constructs and calls \c Reinit() on a new new ElementTable.
      */
@@ -225,10 +282,40 @@ namespace MFM
 
     u64 * GetElementDataSlotsFromType(const u32 elementType, const u32 slots) ;
 
+    /**
+     * The \c slots slots of element-specific data of \c elementType,
+     * allocating and zeroing them if it has none yet.
+     *
+     * @fails ILLEGAL_STATE if elementType is unregistered, has a
+     * different number of slots, or wants more than
+     * ELEMENT_DATA_SLOTS
+     */
     u64 * GetDataAndRegister(const u32 elementType, u32 slots) ;
 
     u64 * GetDataIfRegistered(const u32 elementType, u32 slots) ;
 
+    /**
+     * Slot \c slot of the element-specific data of \c elementType,
+     * which must have more than \c slot slots allocated.
+     *
+     * @fails ILLEGAL_ARGUMENT if it doesn't
+     */
+    u64 & GetElementDataSlot(const u32 elementType, const u32 slot) ;
+
+    /**
+     * The element-specific data of \c elementType viewed as a \c D,
+     * a struct of u64's no bigger than ELEMENT_DATA_SLOTS of them,
+     * allocated and zeroed on first use.  An element reading its data
+     * every event can keep it as a struct, with no slot arithmetic.
+     *
+     * @fails ILLEGAL_STATE as GetDataAndRegister
+     */
+    template <class D>
+    D & GetElementData(const u32 elementType)
+    {
+      return *(D *) GetDataAndRegister(elementType, (sizeof(D) + sizeof(u64) - 1) / sizeof(u64));
+    }
+
   private:
 
     /**
@@ -243,16 +330,45 @@ namespace MFM
      */
     u32 SlotFor(u32 elementType) const ;
 
+    /**
+     * The frozen dispatch table has 2**k slots for the smallest k <=
+     * FROZEN_MAX_BITS at which one of FROZEN_MULTIPLIER_TRIES
+     * multipliers hashes every registered type to its own slot.
+     */
+    enum { FROZEN_MAX_BITS = 10, FROZEN_MULTIPLIER_TRIES = 64 };
+
+    u32 FrozenSlotFor(u32 elementType) const
+    {
+      return (elementType * m_frozenMultiplier) >> m_frozenShift;
+    }
+
+    bool TryFreeze(u32 bits, u32 multiplier) ;
+
+    /**
+     * An element and its data, 64 bytes in all, so the data is
+     * usually on the element pointer's cache line.
+     */
     struct ElementEntry {
       void Clear() {
         m_element = 0;
-        m_elementDataStart = 0;
         m_elementDataLength = 0;
       }
       const Element<EC>* m_element;
-      u16 m_elementDataStart;
-      u16 m_elementDataLength;
-    } m_hash[SIZE];
+      u32 m_elementDataLength;
+      u64 m_elementData[ELEMENT_DATA_SLOTS];
+    };
+
+    /**
+     * The entry of registered \c elementType, or 0 if there's none
+     */
+    ElementEntry * FindEntry(u32 elementType) const ;
+
+    bool m_isFrozen;
+    u32 m_frozenMultiplier;
+    u32 m_frozenShift;
+    ElementEntry * m_frozen[1u << FROZEN_MAX_BITS]; // Into m_hash, which never moves
+
+    ElementEntry m_hash[SIZE];
     u32 m_hashSlotsInUse;
 
   };
@@ -48,6 +48,11 @@ namespace MFM {
       m_hash[slotFor].m_element = &theElement;
 
     }
+
+    if (m_isFrozen)
+    {
+      Freeze();
+    }
   }
 
   template <class EC>
@@ -66,16 +71,121 @@ namespace MFM {
 
     m_hash[eslot].m_element = &newEmptyElement; // And so the deed is done; have mercy on our souls.
 
+    if (m_isFrozen)
+    {
+      Freeze();
+    }
+
     return old;
   }
 
 
+  template <class EC>
+  void ElementTable<EC>::ReplaceElements(const Element<EC> * const * olds,
+                                         const Element<EC> * const * news,
+                                         u32 count)
+  {
+    MFM_API_ASSERT_NONNULL(olds);
+    MFM_API_ASSERT_NONNULL(news);
+
+    const bool wasFrozen = m_isFrozen;
+    const u32 inUse = m_hashSlotsInUse;
+    ElementEntry saved[SIZE];
+    for (u32 i = 0; i < SIZE; ++i)
+      saved[i] = m_hash[i];
+
+    Reinit();
+    for (u32 i = 0; i < SIZE; ++i)
+    {
+      const Element<EC> * elt = saved[i].m_element;
+      if (elt == 0) continue;
+      for (u32 j = 0; j < count; ++j)
+      {
+        if (olds[j] == elt)
+        {
+          elt = news[j];
+          break;
+        }
+      }
+
+      const u32 slot = SlotFor(elt->GetType());
+      if (m_hash[slot].m_element != 0)
+      {
+        for (u32 k = 0; k < SIZE; ++k)  // Put it all back
+          m_hash[k] = saved[k];
+        m_hashSlotsInUse = inUse;
+        if (wasFrozen) Freeze();
+        FAIL(DUPLICATE_ENTRY);
+      }
+      m_hash[slot] = saved[i];
+      m_hash[slot].m_element = elt;
+      ++m_hashSlotsInUse;
+    }
+
+    if (wasFrozen)
+    {
+      Freeze();
+    }
+  }
+
   template <class EC>
   const Element<EC> * ElementTable<EC>::Lookup(u32 elementType) const
   {
+    if (m_isFrozen)
+    {
+      const ElementEntry * entry = m_frozen[FrozenSlotFor(elementType)];
+      const Element<EC> * elt = entry ? entry->m_element : 0;
+      return (elt && elt->GetType() == elementType) ? elt : 0;
+    }
     return m_hash[SlotFor(elementType)].m_element;
   }
 
+  template <class EC>
+  bool ElementTable<EC>::TryFreeze(u32 bits, u32 multiplier)
+  {
+    m_frozenMultiplier = multiplier;
+    m_frozenShift = 32 - bits;
+    const u32 slots = 1u << bits;
+    for (u32 i = 0; i < slots; ++i)
+      m_frozen[i] = 0;
+
+    for (u32 i = 0; i < SIZE; ++i)
+    {
+      const Element<EC> * elt = m_hash[i].m_element;
+      if (elt == 0) continue;
+      u32 slot = FrozenSlotFor(elt->GetType());
+      if (m_frozen[slot] != 0)
+        return false;
+      m_frozen[slot] = &m_hash[i];
+    }
+    return true;
+  }
+
+  template <class EC>
+  bool ElementTable<EC>::Freeze()
+  {
+    m_isFrozen = false;  // Lookup must probe while we rebuild
+
+    u32 bits = 1;
+    while ((1u << bits) < 2 * m_hashSlotsInUse) ++bits;
+
+    for (; bits <= FROZEN_MAX_BITS; ++bits)
+    {
+      u32 multiplier = 0x9e3779b1;  // 2**32/phi: Fibonacci hashing first
+      for (u32 t = 0; t < FROZEN_MULTIPLIER_TRIES; ++t)
+      {
+        if (TryFreeze(bits, multiplier))
+        {
+          m_isFrozen = true;
+          return true;
+        }
+        multiplier = multiplier * 1664525 + 1013904223;
+        multiplier |= 1;
+      }
+    }
+    return false;
+  }
+
   template <class EC>
   const Element<EC> * ElementTable<EC>::Lookup(const u8 * symbol) const
   {
@@ -108,7 +218,19 @@ namespace MFM {
     Reinit();
   }
 
-#if 0
+  template <class EC>
+  typename ElementTable<EC>::ElementEntry * ElementTable<EC>::FindEntry(u32 elementType) const
+  {
+    if (m_isFrozen)
+    {
+      ElementEntry * entry = m_frozen[FrozenSlotFor(elementType)];
+      return (entry && entry->m_element->GetType() == elementType) ? entry : 0;
+    }
+    const u32 slot = SlotFor(elementType);
+    if (m_hash[slot].m_element == 0) return 0;
+    return const_cast<ElementEntry *>(&m_hash[slot]);
+  }
+
   template <class EC>
   bool ElementTable<EC>::AllocateElementDataSlots(const Element<EC>& e, u32 slots)
   {
@@ -119,19 +241,17 @@ namespace MFM {
   template <class EC>
   bool ElementTable<EC>::AllocateElementDataSlotsFromType(const u32 elementType, u32 slots)
   {
-    s32 index = GetIndex(elementType);
-    if (index < 0) return false;
+    ElementEntry * entry = FindEntry(elementType);
+    if (!entry) return false;
 
-    if (m_hash[index].m_elementDataLength != 0) {
-      if (m_hash[index].m_elementDataLength != slots)
+    if (entry->m_elementDataLength != 0) {
+      if (entry->m_elementDataLength != slots)
         return false;
     } else {
-      if (m_nextFreeElementDataIndex+slots > ELEMENT_DATA_SLOTS)
+      if (slots > ELEMENT_DATA_SLOTS)
         return false;
 
-      m_hash[index].m_elementDataLength = slots;
-      m_hash[index].m_elementDataStart = m_nextFreeElementDataIndex;
-      m_nextFreeElementDataIndex += slots;
+      entry->m_elementDataLength = slots;
     }
 
     return true;
@@ -147,12 +267,12 @@ namespace MFM {
   template <class EC>
   u64 * ElementTable<EC>::GetElementDataSlotsFromType(const u32 elementType, const u32 slots)
   {
-    s32 index = GetIndex(elementType);
-    if (index < 0) return 0;
+    ElementEntry * entry = FindEntry(elementType);
+    if (!entry) return 0;
 
-    if (m_hash[index].m_elementDataLength == 0) return 0;
-    if (m_hash[index].m_elementDataLength != slots) return 0;
-    return & m_elementData[m_hash[index].m_elementDataStart];
+    if (entry->m_elementDataLength == 0) return 0;
+    if (entry->m_elementDataLength != slots) return 0;
+    return entry->m_elementData;
   }
 
   template <class EC>
@@ -167,7 +287,7 @@ namespace MFM {
     {
 
       // Not yet registered.  If this fails, you probably need to up
-      // the EDS in your ParamConfig.
+      // ELEMENT_DATA_SLOTS.
       if (!AllocateElementDataSlotsFromType(elementType, slots))
         FAIL(ILLEGAL_STATE);
 
@@ -188,7 +308,14 @@ namespace MFM {
   {
     return GetElementDataSlotsFromType(elementType, slots);
   }
-#endif
+
+  template <class EC>
+  u64 & ElementTable<EC>::GetElementDataSlot(const u32 elementType, const u32 slot)
+  {
+    ElementEntry * entry = FindEntry(elementType);
+    MFM_API_ASSERT_ARG(entry && slot < entry->m_elementDataLength);
+    return entry->m_elementData[slot];
+  }
 
   template <class EC>
   void ElementTable<EC>::Reinit()
@@ -196,7 +323,7 @@ namespace MFM {
     m_hashSlotsInUse = 0;
     for (u32 i = 0; i < SIZE; ++i)
       m_hash[i].Clear();
-    //XXX    m_nextFreeElementDataIndex = 0;
+    m_isFrozen = false;
   }
 
 } /* namespace MFM */
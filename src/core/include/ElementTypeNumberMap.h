@@ -68,26 +68,48 @@ namespace MFM
     enum { SLOTS = 1<<BITS };
     const UUID *(m_uuids[SLOTS]);
 
+    u32 m_usedCount;
+
+    /** Type+1 of each non-empty type, by UUID handle; 0 if none */
+    u32 * m_typeOfHandle;
+    u32 m_typeOfHandleSize;
+
     u32 NextType() ;
 
+    s32 TypeOfHandle(u32 handle) const
+    {
+      if (handle >= m_typeOfHandleSize) return -1;
+      return (s32) m_typeOfHandle[handle] - 1;
+    }
+
+    void SetTypeOfHandle(u32 handle, u32 type) ;
+
     u32 AllocateTypeInternal(const UUID & forUUID, s32 useThisType) ;
 
   public:
     ElementTypeNumberMap()
       : m_counter(2)
+      , m_usedCount(0)
+      , m_typeOfHandle(0)
+      , m_typeOfHandleSize(0)
     {
       for (u32 i = 0; i < SLOTS; i++) {
         m_uuids[i] = 0;
       }
     }
 
+    ~ElementTypeNumberMap()
+    {
+      delete [] m_typeOfHandle;
+    }
+
     u32 AllocateType(const UUID & forUUID) ;
 
     u32 AllocateEmptyType(const UUID & forUUID) ;
 
     /**
      * Return the type assigned to \a forUUID, or -1 if the UUID is
-     * not found.  Note this is O(#types)!  Not for inner loop use!
+     * not found.  O(1), by UUID::GetHandle().
      */
     s32 TypeFromUUID(const UUID & forUUID) ;
 
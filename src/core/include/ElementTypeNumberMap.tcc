@@ -40,21 +40,32 @@ namespace MFM {
   }
 
   template <class EC>
-  u32 ElementTypeNumberMap<EC>::AllocateTypeInternal(const UUID & forUUID, s32 useThisType) {
-    u32 used = 0;
-    for (u32 i = 0; i < SLOTS; ++i) {
-      if (!m_uuids[i]) continue;
-      ++used;
-      if (i == ELEMENT_EMPTY_TYPE) continue;
+  void ElementTypeNumberMap<EC>::SetTypeOfHandle(u32 handle, u32 type) {
+    if (handle >= m_typeOfHandleSize) {
+      u32 size = m_typeOfHandleSize ? m_typeOfHandleSize : 64;
+      while (size <= handle) size *= 2;
+      u32 * grown = new u32[size];
+      for (u32 i = 0; i < size; ++i)
+        grown[i] = i < m_typeOfHandleSize ? m_typeOfHandle[i] : 0;
+      delete [] m_typeOfHandle;
+      m_typeOfHandle = grown;
+      m_typeOfHandleSize = size;
+    }
+    m_typeOfHandle[handle] = type + 1;
+  }
 
-      if (forUUID == *m_uuids[i]) {
-        if (useThisType >= 0 && useThisType != (s32) i)
-          FAIL(DUPLICATE_ENTRY);
-        return i;
-      }
+  template <class EC>
+  u32 ElementTypeNumberMap<EC>::AllocateTypeInternal(const UUID & forUUID, s32 useThisType) {
+    // The empty type is never matched here, so it can be reallocated
+    const u32 handle = forUUID.GetHandle();
+    const s32 existing = TypeOfHandle(handle);
+    if (existing >= 0) {
+      if (useThisType >= 0 && useThisType != existing)
+        FAIL(DUPLICATE_ENTRY);
+      return (u32) existing;
     }
 
-    if (used == SLOTS)
+    if (m_usedCount == SLOTS)
       FAIL(OUT_OF_ROOM);
 
     u32 type;
@@ -68,18 +79,22 @@ namespace MFM {
     if (type >= SLOTS)
       FAIL(ILLEGAL_STATE);
 
+    if (!m_uuids[type]) ++m_usedCount;
+    else if (type != ELEMENT_EMPTY_TYPE)
+      m_typeOfHandle[m_uuids[type]->GetHandle()] = 0; // Replaced
     m_uuids[type] = &forUUID;
+    if (type != ELEMENT_EMPTY_TYPE)
+      SetTypeOfHandle(handle, type);
     return type;
   }
 
   template <class EC>
   s32 ElementTypeNumberMap<EC>::TypeFromUUID(const UUID & forUUID) {
-    for (u32 i = 0; i < SLOTS; ++i) {
-      if (!m_uuids[i]) continue;
-      if (forUUID == *m_uuids[i])
-        return (s32) i;
-    }
-    return -1;
+    const u32 handle = forUUID.GetHandle();
+    const u32 empty = ELEMENT_EMPTY_TYPE;
+    if (m_uuids[empty] && m_uuids[empty]->GetHandle() == handle)
+      return (s32) empty;
+    return TypeOfHandle(handle);
   }
 
   template <class EC>
@@ -54,6 +54,8 @@ namespace MFM
       Element<EC>::AllocateEmptyType(); // A special method just for Empty!
       Element<EC>::SetAtomicSymbol("E");
       Element<EC>::SetName("Empty");
+      Element<EC>::SetAlwaysDiffusable(true);
+      Element<EC>::SetInert(true);
     }
 
     virtual u32 GetEventWindowBoundary() const
@@ -77,6 +79,12 @@ namespace MFM
       return 0x00000000;                    // Not black.. transparent
     }
 
+    virtual bool GetSweepRule(SweepRule & rule) const
+    {
+      rule.Clear();             // Does nothing
+      return true;
+    }
+
     virtual void Behavior(EventWindow<EC>& window) const
     { }
 
@@ -0,0 +1,221 @@
+/*                                              -*- mode:C++ -*-
+  EventAgeIndex.h Age-weighted event center selection
+  Copyright (C) 2014-2016 The Regents of the University of New Mexico.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+  USA
+*/
+
+/**
+  \file EventAgeIndex.h Age-weighted event center selection
+  \date (C) 2014-2016 All rights reserved.
+  \lgpl
+ */
+#ifndef EVENTAGEINDEX_H
+#define EVENTAGEINDEX_H
+
+#include "itype.h"
+#include "Random.h"
+
+namespace MFM
+{
+  /**
+     An EventAgeIndex picks event centers among a tile's SITES owned
+     sites with odds proportional to the warp weighting that
+     EventWindow::RejectOnRecency applies by rejection: a site whose
+     last event was AGE events ago weighs
+
+         MIN(AGE + WARP * SITES, 10 * SITES)
+
+     (but at least 1), so the draws that rejection would have thrown
+     away mostly never happen.
+
+     Sites are kept in one array, grouped by the band of
+     SITES/BANDS_PER_SWEEP event numbers their last events fell in.
+     The bands recent enough that their sites may still weigh less
+     than the cap are each a segment of the array; every older site
+     shares one 'saturated' segment at the front.  A pick draws a
+     segment by its size times the most any of its sites could weigh,
+     then a site in it uniformly, and then keeps it with the odds of
+     its actual weight over that bound, so the result is exact and
+     only the slack within one band is ever turned down.
+
+     Recording an event moves its site to the newest segment, in a
+     swap per segment passed; when the event count enters a new band,
+     the oldest recent segment just joins the saturated one.
+   */
+  class EventAgeIndex
+  {
+  public:
+    enum
+    {
+      /** Bands per SITES events; more means fewer turned down */
+      BANDS_PER_SWEEP = 4,
+
+      /** Warp factors run 0..MAX_WARP; MAX_WARP weighs all sites alike */
+      MAX_WARP = 10,
+
+      /** Segment weights are kept in units of SITES/WEIGHT_UNITS_PER_SITE ages */
+      WEIGHT_UNITS_PER_SITE = 64
+    };
+
+    EventAgeIndex() ;
+
+    ~EventAgeIndex() ;
+
+    /**
+       Size the index for \a sites sites, numbered 0..sites-1, each
+       last having had an event at event number 0, and weigh them by
+       \a warpFactor.  Use SetLastEvent and Rebuild to say otherwise.
+
+       @fails ILLEGAL_ARGUMENT if sites is 0 or warpFactor exceeds
+              MAX_WARP
+     */
+    void Init(u32 sites, u32 warpFactor) ;
+
+    bool IsInitted() const
+    {
+      return m_sites > 0;
+    }
+
+    u32 GetSiteCount() const
+    {
+      return m_sites;
+    }
+
+    /** Heap bytes held by the index; 0 until Init */
+    u64 GetStorageBytes() const
+    {
+      if (!IsInitted())
+      {
+        return 0;
+      }
+      return (u64) m_sites * (sizeof(u64) + 2 * sizeof(u32)) + (u64) (m_recent + 2) * sizeof(u32);
+    }
+
+    u32 GetWarpFactor() const
+    {
+      return m_warpFactor;
+    }
+
+    /** The latest event number the index has seen */
+    u64 GetNow() const
+    {
+      return m_now;
+    }
+
+    /**
+       Note that \a site last had an event at \a eventNumber, for the
+       next Rebuild.  Cheap, but nothing is reindexed until then.
+     */
+    void SetLastEvent(u32 site, u64 eventNumber)
+    {
+      MFM_API_ASSERT_ARG(site < m_sites);
+      m_lastEvent[site] = eventNumber;
+    }
+
+    u64 GetLastEvent(u32 site) const
+    {
+      MFM_API_ASSERT_ARG(site < m_sites);
+      return m_lastEvent[site];
+    }
+
+    /**
+       Reindex every site from its SetLastEvent event number, with
+       \a now the current event number and \a warpFactor the weighting.
+
+       @fails ILLEGAL_ARGUMENT if warpFactor exceeds MAX_WARP
+     */
+    void Rebuild(u32 warpFactor, u64 now) ;
+
+    /**
+       Record an event at \a site as event number \a eventNumber, which
+       also becomes the current event number.  Event numbers must not
+       go backwards; Rebuild after any that do.
+     */
+    void RecordEvent(u32 site, u64 eventNumber) ;
+
+    /**
+       Draw a site, taking \a now as the current event number, with
+       odds proportional to its weight.
+
+       @returns true and sets \a site, or false if the draw was turned
+                down, which happens only for a fraction of a band's
+                worth of age.
+
+       @fails ILLEGAL_STATE if not initted or if now is before
+              GetNow(); Rebuild first
+     */
+    bool Pick(Random & random, u64 now, u32 & site) ;
+
+    /**
+       The weight of \a site at the current event number, for tests.
+     */
+    u32 GetWeight(u32 site) const
+    {
+      MFM_API_ASSERT_ARG(site < m_sites);
+      return WeightOfAge(m_now >= m_lastEvent[site] ? m_now - m_lastEvent[site] : 0);
+    }
+
+  private:
+    u32 m_sites;
+    u32 m_warpFactor;
+    u32 m_band;             // Event numbers per band
+    u32 m_weightUnit;       // Ages per unit of segment weight
+    u32 m_recent;           // Recent band segments, after the saturated one
+    u64 m_now;
+    u64 m_newestBand;       // Band of m_now, and of the last segment
+
+    u64 * m_lastEvent;      // By site
+    u32 * m_order;          // Sites, grouped by segment
+    u32 * m_position;       // By site, its index in m_order
+    u32 * m_segmentStart;   // m_recent + 2 of them; the last is m_sites
+
+    u32 WeightOfAge(u64 age) const
+    {
+      const u64 cap = (u64) MAX_WARP * m_sites;
+      const u64 weight = age + (u64) m_warpFactor * m_sites;
+      if (weight == 0) return 1;  // Even at warp 0, an age-0 tile can't stall
+      return (u32) (weight < cap ? weight : cap);
+    }
+
+    /** The most any site in segment \a segment can weigh now */
+    u32 GetSegmentBound(u32 segment) const ;
+
+    /** Index of the segment holding position \a position of m_order */
+    u32 FindSegment(u32 position) const ;
+
+    void Swap(u32 positionA, u32 positionB)
+    {
+      const u32 a = m_order[positionA];
+      const u32 b = m_order[positionB];
+      m_order[positionA] = b;
+      m_position[b] = positionA;
+      m_order[positionB] = a;
+      m_position[a] = positionB;
+    }
+
+    /** Move the segments along until the newest is \a now's band */
+    void AdvanceTo(u64 now) ;
+
+    void Free() ;
+
+    // Declare away
+    EventAgeIndex(const EventAgeIndex &) ;
+    EventAgeIndex & operator=(const EventAgeIndex &) ;
+  };
+} /* namespace MFM */
+
+#endif /* EVENTAGEINDEX_H */
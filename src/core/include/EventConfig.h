@@ -50,6 +50,12 @@ namespace MFM {
      */
     typedef typename SITE::ATOM_CONFIG ATOM_CONFIG;
 
+    /**
+     * SITE_FEATURES are the SiteFeature bits the SITE keeps; see
+     * Site.h.  Choose a SITE without them to skip their bookkeeping.
+     */
+    enum { SITE_FEATURES = SITE::SITE_FEATURES };
+
     /**
      * EVENT_WINDOW_RADIUS is the size of the event window for this
      * EventConfig.
@@ -51,6 +51,7 @@ namespace MFM
     // Extract short names for parameter types
     typedef typename EC::ATOM_CONFIG AC;
     typedef typename EC::SITE S;
+    typedef typename S::BASE B;
     typedef typename AC::ATOM_TYPE T;
     enum { R = EC::EVENT_WINDOW_RADIUS };
   public:
@@ -61,15 +62,32 @@ namespace MFM
       BASE_PAINT
     };
 
+    /**
+       Every KEYFRAME_EVENTS recorded events, the words they changed
+       are gathered into a keyframe holding each word's value before
+       and after the whole interval.  From anywhere inside the
+       interval, writing those values puts the tile at either end of
+       it, so a long seek replays at most one interval's worth of
+       deltas at each end.
+     */
+    enum { KEYFRAME_EVENTS = 32 };
+
     /**
        Printing routine for debug
      */
     void Print(ByteSink & bs) const __attribute__ ((used)) ;
 
+    /**
+       Remember up to \c bufferSize items of history for \c forTile,
+       in \c buffer if it is non-null.  If \c buffer is null, the
+       items are allocated the first time an event is recorded, and
+       can be given back with ReleaseHistory.
+     */
     EventHistoryBuffer(Tile<EC> & forTile, u32 bufferSize, EventHistoryItem * buffer)
       : m_tile(forTile)
       , m_bufferSize(bufferSize)
       , m_historyBuffer(buffer)
+      , m_ownsBuffer(buffer == 0)
       , m_oldestEventStart(0)
       , m_newestEventEnd(1)
       , m_cursor(-1)
@@ -78,16 +96,32 @@ namespace MFM
       , m_itemsInEvent(0)
       , m_makingEvent(false)
       , m_makingEventStart(0)
+      , m_keyframes(0)
+      , m_keyframeCapacity(bufferSize / (3 * KEYFRAME_EVENTS) + 2) // Events take 3+ items
+      , m_keyframeOldest(0)
+      , m_keyframeCount(0)
+      , m_keyframeWords(0)
+      , m_keyframeWordCapacity(bufferSize / 2)
+      , m_keyframeWordNext(0)
+      , m_keyframeEvents(0)
+      , m_keyframeStartItem(0)
+      , m_keyframeStartEvent(0)
     {
-      MFM_API_ASSERT_NONNULL(buffer);
       MFM_API_ASSERT_ARG(m_bufferSize > 100); // ?? what is safe here, if we always want at least one event in the buffer??
-      for (u32 i = 0; i < m_bufferSize; ++i)
-        m_historyBuffer[i].MakeUnused();
-      // Load up a dummy event to establish the invariants
-      m_historyBuffer[m_oldestEventStart].MakeStart(SPoint(0,0), 0);
-      m_historyBuffer[m_oldestEventStart].mHeaderItem.m_count = 1;
-      m_historyBuffer[m_newestEventEnd].MakeEnd(m_historyBuffer[m_oldestEventStart], 1);
-      m_cursor = m_oldestEventStart;
+      if (m_historyBuffer)
+      {
+        InitBuffer();
+      }
+    }
+
+    ~EventHistoryBuffer()
+    {
+      if (m_ownsBuffer)
+      {
+        delete [] m_historyBuffer;
+      }
+      delete [] m_keyframes;
+      delete [] m_keyframeWords;
     }
 
     bool IsCursorAtAnEventEnd() const
@@ -109,37 +143,37 @@ namespace MFM
       return true;
     }
 
+    /**
+       Move the cursor \c distance steps newer, or older if negative,
+       as by that many MoveCursorNewer or MoveCursorOlder calls.  Long
+       moves jump over whole keyframed intervals (see KEYFRAME_EVENTS)
+       rather than replaying every delta in them.  \returns false if
+       history ran out first.
+     */
     bool MoveCursor(s32 distance)
     {
-      while (distance++ < 0)
-        if (!MoveCursorOlder()) return false;
-      while (--distance > 0)
-        if (!MoveCursorNewer()) return false;
-      return true;
+      if (distance < 0)
+        return SeekCursor(false, (u32) -distance);
+      return SeekCursor(true, (u32) distance);
     }
 
     bool MoveCursorToNewest()
     {
       if (m_cursor < 0) return false;
-      while (m_cursor != m_newestEventEnd)
-      {
-        if (!MoveCursorNewer()) return false;
-      }
-      return true;
+      SeekCursor(true, U32_MAX);
+      return m_cursor == (s32) m_newestEventEnd;
     }
 
     bool MoveCursorToOldest()
     {
       if (m_cursor < 0) return false;
-      while (m_cursor != m_oldestEventStart) 
-      {
-        if (!MoveCursorOlder()) return false;
-      }
-      return true;
+      SeekCursor(false, U32_MAX);
+      return m_cursor == (s32) m_oldestEventStart;
     }
 
     bool MoveCursorOlder()
     {
+      if (m_cursor < 0) return false;
       if (m_historyBuffer[m_cursor].IsEnd())
       {
         s32 start = StartOfEventEndedHere(m_cursor);
@@ -167,6 +201,7 @@ namespace MFM
 
     bool MoveCursorNewer()
     {
+      if (m_cursor < 0) return false;
       if (m_historyBuffer[m_cursor].IsStart())
       {
         s32 end = EndOfEventStartedHere(m_cursor);
@@ -196,38 +231,91 @@ namespace MFM
 
     void SetHistoryActive(bool active) { m_historyActive = active; }
 
+    /** true if the history items are currently allocated */
+    bool HasHistoryStorage() const { return m_historyBuffer != 0; }
+
+    /** Heap bytes held by the history items (if allocated here) and keyframes */
+    u64 GetStorageBytes() const
+    {
+      u64 bytes = 0;
+      if (m_historyBuffer && m_ownsBuffer)
+      {
+        bytes += (u64) m_bufferSize * sizeof(EventHistoryItem);
+      }
+      if (m_keyframes)
+      {
+        bytes += (u64) m_keyframeCapacity * sizeof(Keyframe);
+        bytes += (u64) m_keyframeWordCapacity * sizeof(KeyframeWord);
+      }
+      return bytes;
+    }
+
     /**
-       Adds all observable changes associated with \c ew and its tile.
-       Used for local events.
+       Deactivate history and, if the items were allocated here, free
+       them, forgetting all recorded events.  A later
+       SetHistoryActive(true) starts over with a fresh allocation at
+       the next recorded event.  Must not race with events on the
+       tile, so call it before the tile runs or while it is paused.
+     */
+    void ReleaseHistory() ;
+
+    /**
+       Adds all observable changes associated with \c ew and its tile,
+       by comparing every site of \c ew against the tile.  Local events
+       instead go through AddEventStart / AddEventAtom / AddEventBase /
+       AddEventEnd from EventWindow::StoreToTile, which already knows
+       which sites changed.
      */
     void AddEventWindow(const EventWindow<EC> & ew) ;
 
     /**
-       Begins a new event record.  Used for remote cache events.
+       Begins a new event record.  Used for local events and remote
+       cache events.
     */
     void AddEventStart(const SPoint ctr) ;
 
     /**
-      Adds an atom to an in-progress event record.  Used for remote cache events.
+      Adds an atom to an in-progress event record.  Only the 32-bit
+      words that differ between \c oldAtom and \c newAtom are stored.
     */
     void AddEventAtom(u32 siteInWindow, const T & oldAtom, const T & newAtom) ;
 
+    /**
+      Adds the center site's base changes to an in-progress event
+      record.  Used for local events.
+    */
+    void AddEventBase(const B & oldBase, const B & newBase) ;
+
     /**
        Completes a new event record.  Used for remote cache events.
     */
     void AddEventEnd() ;
 
+    /**
+       Counts the recorded events still in the buffer; zero if history
+       is inactive or its storage isn't allocated.
+     */
     u32 CountEventsInHistory() const ;
 
+    /** Keyframes currently held; some may have rolled out of reach */
+    u32 GetKeyframeCount() const { return m_keyframeCount; }
+
   private:
 
     void ApplyDelta(bool toNewer, EventHistoryItem::DeltaItem & di, Tile<EC>& tile, const SPoint ctr) ;
 
+    /** Write \c value to \c word of \c site in the event window
+        centered at \c ctr, as a DeltaItem would */
+    void WriteWord(Tile<EC>& tile, const SPoint ctr, u32 site, u32 word, u32 value) ;
+
+    /** MoveCursor's work, jumping by keyframes where it can */
+    bool SeekCursor(bool toNewer, u32 steps) ;
+
     // Updates m_itemsInEvent
     void RecordAtomChanges(u32 siteInWindow, const T& oldAtom, const T& newAtom) ;
 
     // Updates m_itemsInEvent
-    void RecordBaseChanges(const Base<AC>& oldBase, const Base<AC>& newBase) ;
+    void RecordBaseChanges(const B & oldBase, const B & newBase) ;
 
     // Updates m_itemsInEvent
     void RecordSensorChanges(const SiteSensors& oldSense, const SiteSensors& newBase) ;
@@ -257,9 +345,100 @@ namespace MFM
     bool StepBackward() ;
     bool StepForward() ;
 
+    /** Empties the buffer down to the dummy event the cursor needs */
+    void InitBuffer() ;
+
+    /** One word changed in a keyframed interval.  Atom words are
+        keyed by their site in the tile, with m_site 0; base words by
+        their event center and their base code as m_site. */
+    struct KeyframeWord
+    {
+      s16 m_x;
+      s16 m_y;
+      u8 m_site;
+      u8 m_word;
+      u16 m_order;              // Among the interval's deltas, for a stable sort
+      u32 m_before;
+      u32 m_after;
+    };
+
+    /** The words changed by the events after the END item at
+        m_startItem through the one at m_endItem */
+    struct Keyframe
+    {
+      u32 m_startItem;
+      u32 m_startEvent;
+      u32 m_endItem;
+      u32 m_endEvent;
+      u32 m_firstWord;          // In m_keyframeWords
+      u32 m_words;
+    };
+
+    /** Count the interval ended by the event just recorded, and
+        keyframe it if it's full */
+    void NoteEventRecorded()
+    {
+      if (++m_keyframeEvents >= KEYFRAME_EVENTS)
+      {
+        AddKeyframe();
+      }
+    }
+
+    void AddKeyframe() ;
+
+    /** Make room for \c words keyframe words, dropping the oldest
+        keyframes as needed.  \returns the first, or U32_MAX if they
+        can't fit at all */
+    u32 ReserveKeyframeWords(u32 words) ;
+
+    void DropOldestKeyframe()
+    {
+      m_keyframeOldest = (m_keyframeOldest + 1) % m_keyframeCapacity;
+      --m_keyframeCount;
+    }
+
+    Keyframe & GetKeyframe(u32 age) // 0 is the newest
+    {
+      return m_keyframes[(m_keyframeOldest + m_keyframeCount - 1 - age) % m_keyframeCapacity];
+    }
+
+    /** The keyframe whose interval holds the cursor, for moving it
+        newer or older, if that end of it is still in the buffer */
+    Keyframe * FindCursorKeyframe(bool toNewer) ;
+
+    /** Cursor steps from the header item at \c older to the one at
+        \c newer, or U32_MAX if that's not a short walk */
+    u32 CountSteps(u32 older, u32 newer) const ;
+
+    void ApplyKeyframe(const Keyframe & kf, bool toNewer) ;
+
+    static int CompareKeyframeWords(const void * a, const void * b) ;
+
+    static bool IsSameWord(const KeyframeWord & a, const KeyframeWord & b)
+    {
+      return a.m_x == b.m_x && a.m_y == b.m_y && a.m_site == b.m_site && a.m_word == b.m_word;
+    }
+
+    /** true if event number \c a is more recent than \c b */
+    static bool IsEventAfter(u32 a, u32 b)
+    {
+      return (s32) (a - b) > 0;
+    }
+
+    /** Allocates the items, if that hasn't happened yet */
+    void NeedBuffer()
+    {
+      if (!m_historyBuffer)
+      {
+        m_historyBuffer = new EventHistoryItem[m_bufferSize];
+        InitBuffer();
+      }
+    }
+
     Tile<EC> & m_tile;
     u32 m_bufferSize;
     EventHistoryItem * m_historyBuffer;
+    bool m_ownsBuffer;  // true if m_historyBuffer is ours to allocate and free
     u32 m_oldestEventStart;
     u32 m_newestEventEnd;
 
@@ -318,6 +497,17 @@ namespace MFM
     bool m_makingEvent;  // true between AddEventStart and AddEventEnd
     u32 m_makingEventStart;  // index of start item of in-progress event
 
+    Keyframe * m_keyframes;  // A ring, allocated with the history items
+    u32 m_keyframeCapacity;
+    u32 m_keyframeOldest;
+    u32 m_keyframeCount;
+    KeyframeWord * m_keyframeWords;  // Also a ring; each keyframe's are contiguous
+    u32 m_keyframeWordCapacity;
+    u32 m_keyframeWordNext;
+    u32 m_keyframeEvents;  // Recorded since the last keyframe
+    u32 m_keyframeStartItem;  // END item the next keyframe's interval follows
+    u32 m_keyframeStartEvent;
+
     u32 GetWrappedIndex(s32 index) const
     {
       while (index < 0) index += m_bufferSize;
@@ -344,8 +534,9 @@ namespace MFM
     }
 
     /**
-       Returns the start item index (which is >= 0), if \c endIndex is
-       at an END item that has a corresponding START item, else -1.
+       Returns the start item index (which is >= 0, wrapped into the
+       buffer), if \c endIndex is at an END item that has a
+       corresponding START item, else -1.
     */
     s32 StartOfEventEndedHere(s32 endIndex) const
     {
@@ -358,12 +549,13 @@ namespace MFM
       if (!ehiStart.IsStart() || ehiEnd.GetHeaderEventNumber() != ehiStart.GetHeaderEventNumber())
         return -1;
     
-      return startIndex;
+      return (s32) GetWrappedIndex(startIndex);
     }
 
     /**
-       Returns the end item index (which is >= 0), if \c startIndex is
-       at a START item that has a corresponding END item, else -1.
+       Returns the end item index (which is >= 0, wrapped into the
+       buffer), if \c startIndex is at a START item that has a
+       corresponding END item, else -1.
     */
     s32 EndOfEventStartedHere(s32 startIndex) const
     {
@@ -376,7 +568,7 @@ namespace MFM
       if (!ehiEnd.IsEnd() || ehiEnd.GetHeaderEventNumber() != ehiStart.GetHeaderEventNumber())
         return -1;
     
-      return endIndex;
+      return (s32) GetWrappedIndex(endIndex);
     }
 
   };
@@ -2,6 +2,7 @@
 
 #include "Fail.h"
 #include "EventWindow.h"
+#include <stdlib.h>  /* For qsort */
 #include "Tile.h"
 
 namespace MFM {
@@ -14,17 +15,61 @@ namespace MFM {
     FAIL(INCOMPLETE_CODE);
   }
 
+  template <class EC>
+  void EventHistoryBuffer<EC>::InitBuffer()
+  {
+    for (u32 i = 0; i < m_bufferSize; ++i)
+      m_historyBuffer[i].MakeUnused();
+    // Load up a dummy event to establish the invariants
+    m_oldestEventStart = 0;
+    m_newestEventEnd = 1;
+    m_historyBuffer[m_oldestEventStart].MakeStart(SPoint(0,0), 0);
+    m_historyBuffer[m_oldestEventStart].mHeaderItem.m_count = 1;
+    m_historyBuffer[m_newestEventEnd].MakeEnd(m_historyBuffer[m_oldestEventStart], 1);
+    m_cursor = m_oldestEventStart;
+
+    if (!m_keyframes)
+    {
+      m_keyframes = new Keyframe[m_keyframeCapacity];
+      m_keyframeWords = new KeyframeWord[m_keyframeWordCapacity];
+    }
+    m_keyframeOldest = 0;
+    m_keyframeCount = 0;
+    m_keyframeWordNext = 0;
+    m_keyframeEvents = 0;
+    m_keyframeStartItem = m_newestEventEnd;
+    m_keyframeStartEvent = 0;
+  }
+
+  template <class EC>
+  void EventHistoryBuffer<EC>::ReleaseHistory()
+  {
+    m_historyActive = false;
+    m_makingEvent = false;
+    if (m_ownsBuffer)
+    {
+      delete [] m_historyBuffer;
+      m_historyBuffer = 0;
+      m_cursor = -1;
+      delete [] m_keyframes;
+      m_keyframes = 0;
+      delete [] m_keyframeWords;
+      m_keyframeWords = 0;
+    }
+  }
+
   template <class EC>
   u32 EventHistoryBuffer<EC>::CountEventsInHistory() const
   {
-    if (!m_historyActive) return 0;
+    if (!m_historyActive || !m_historyBuffer) return 0;
     u32 events = 0;
     for (u32 i = m_oldestEventStart; i != m_newestEventEnd; )
     {
       EventHistoryItem & item = m_historyBuffer[i];
       if (item.IsStart())
       {
-        ++events;
+        if (item.GetHeaderEventNumber() != 0) // Skip InitBuffer's dummy
+          ++events;
         s32 next = EndOfEventStartedHere(i);
         MFM_API_ASSERT_STATE(next >= 0);
         i = (u32) next;
@@ -39,16 +84,19 @@ namespace MFM {
 
   template <class EC>
   void EventHistoryBuffer<EC>::ApplyDelta(bool toNewer, EventHistoryItem::DeltaItem & di, Tile<EC>& tile, const SPoint ctr)
+  {
+    WriteWord(tile, ctr, di.m_site, di.m_word, toNewer ? di.m_newValue : di.m_oldValue);
+  }
+
+  template <class EC>
+  void EventHistoryBuffer<EC>::WriteWord(Tile<EC>& tile, const SPoint ctr, u32 site, u32 word, u32 value)
   {
     const MDist<R> & md = MDist<R>::get();
-    u32 site = di.m_site;
     if (site < md.GetSiteCount())
     {
       const SPoint pt = md.GetPoint(site) + ctr;
       T& atom = *tile.GetWritableAtom(pt);
-      u32 idx = di.m_word;
-      u32 val = toNewer ? di.m_newValue : di.m_oldValue;
-      atom.GetBits().Write(idx*32, 32, val);
+      atom.GetBits().Write(word*32, 32, value);
     }
     else
     {
@@ -58,11 +106,240 @@ namespace MFM {
     tile.NeedAtomRecount();
   }
 
+  template <class EC>
+  bool EventHistoryBuffer<EC>::SeekCursor(bool toNewer, u32 steps)
+  {
+    bool jumping = true;
+    while (steps > 0)
+    {
+      if (m_cursor < 0) return false;
+      if (jumping && steps > 1)
+      {
+        const Keyframe * kf = FindCursorKeyframe(toNewer);
+        if (kf)
+        {
+          const u32 boundary = toNewer ? kf->m_endItem : kf->m_startItem;
+          const u32 distance = toNewer ?
+            CountSteps((u32) m_cursor, boundary) : CountSteps(boundary, (u32) m_cursor);
+          if (distance <= steps)
+          {
+            ApplyKeyframe(*kf, toNewer);
+            m_cursor = (s32) boundary;
+            steps -= distance;
+            continue;
+          }
+          jumping = false;  // The rest of the move stays inside this interval
+        }
+      }
+      if (!(toNewer ? MoveCursorNewer() : MoveCursorOlder())) return false;
+      --steps;
+    }
+    return true;
+  }
+
+  template <class EC>
+  typename EventHistoryBuffer<EC>::Keyframe * EventHistoryBuffer<EC>::FindCursorKeyframe(bool toNewer)
+  {
+    const EventHistoryItem & at = m_historyBuffer[m_cursor];
+    if (!at.IsHeader()) return 0;
+    const u32 event = at.GetHeaderEventNumber();
+
+    // At an END, the tile holds that event; at a START, just the ones
+    // before it.  Either way it's strictly inside an interval, or at
+    // its ends only in the direction away from the end.
+    const bool startOpen = toNewer && at.IsEnd();
+    for (u32 age = 0; age < m_keyframeCount; ++age)
+    {
+      Keyframe & kf = GetKeyframe(age);
+      const bool afterEnd = startOpen ?
+        !IsEventAfter(kf.m_endEvent, event) : IsEventAfter(event, kf.m_endEvent);
+      if (afterEnd) break;  // And so it is for all older keyframes
+      const bool afterStart = startOpen ?
+        !IsEventAfter(kf.m_startEvent, event) : IsEventAfter(event, kf.m_startEvent);
+      if (!afterStart) continue;
+
+      // Is the end we're going to still in the buffer?
+      const u32 item = toNewer ? kf.m_endItem : kf.m_startItem;
+      const u32 itemEvent = toNewer ? kf.m_endEvent : kf.m_startEvent;
+      const EventHistoryItem & boundary = m_historyBuffer[item];
+      const u32 oldest = m_historyBuffer[m_oldestEventStart].GetHeaderEventNumber();
+      if (!boundary.IsEnd() || boundary.GetHeaderEventNumber() != itemEvent ||
+          IsEventAfter(oldest, itemEvent))
+      {
+        return 0;
+      }
+      return &kf;
+    }
+    return 0;
+  }
+
+  template <class EC>
+  u32 EventHistoryBuffer<EC>::CountSteps(u32 older, u32 newer) const
+  {
+    const u32 MAX_STEPS = 2 * KEYFRAME_EVENTS + 2;
+    u32 steps = 0;
+    for (u32 i = older; i != newer; ++steps)
+    {
+      if (steps > MAX_STEPS) return U32_MAX;
+      const EventHistoryItem & item = m_historyBuffer[i];
+      if (item.IsStart())
+      {
+        const s32 end = EndOfEventStartedHere(i);
+        if (end < 0) return U32_MAX;
+        i = (u32) end;
+      }
+      else if (item.IsEnd())
+      {
+        i = Increment(i);
+      }
+      else return U32_MAX;
+    }
+    return steps;
+  }
+
+  template <class EC>
+  void EventHistoryBuffer<EC>::ApplyKeyframe(const Keyframe & kf, bool toNewer)
+  {
+    for (u32 i = 0; i < kf.m_words; ++i)
+    {
+      const KeyframeWord & w = m_keyframeWords[kf.m_firstWord + i];
+      WriteWord(m_tile, SPoint(w.m_x, w.m_y), w.m_site, w.m_word,
+                toNewer ? w.m_after : w.m_before);
+    }
+  }
+
+  template <class EC>
+  int EventHistoryBuffer<EC>::CompareKeyframeWords(const void * a, const void * b)
+  {
+    const KeyframeWord & wa = *(const KeyframeWord *) a;
+    const KeyframeWord & wb = *(const KeyframeWord *) b;
+    if (wa.m_x != wb.m_x) return wa.m_x < wb.m_x ? -1 : 1;
+    if (wa.m_y != wb.m_y) return wa.m_y < wb.m_y ? -1 : 1;
+    if (wa.m_site != wb.m_site) return wa.m_site < wb.m_site ? -1 : 1;
+    if (wa.m_word != wb.m_word) return wa.m_word < wb.m_word ? -1 : 1;
+    return wa.m_order < wb.m_order ? -1 : wa.m_order > wb.m_order ? 1 : 0;
+  }
+
+  template <class EC>
+  u32 EventHistoryBuffer<EC>::ReserveKeyframeWords(u32 words)
+  {
+    if (words > m_keyframeWordCapacity) return U32_MAX;
+    const u32 first =
+      m_keyframeWordNext + words <= m_keyframeWordCapacity ? m_keyframeWordNext : 0;
+
+    // Drop keyframes from the oldest until none overlaps [first, first+words)
+    while (m_keyframeCount > 0)
+    {
+      bool overlaps = m_keyframeCount == m_keyframeCapacity;  // No room for another
+      for (u32 age = 0; !overlaps && age < m_keyframeCount; ++age)
+      {
+        const Keyframe & kf = GetKeyframe(age);
+        overlaps = kf.m_firstWord < first + words && first < kf.m_firstWord + kf.m_words;
+      }
+      if (!overlaps) break;
+      DropOldestKeyframe();
+    }
+    m_keyframeWordNext = first + words;
+    return first;
+  }
+
+  template <class EC>
+  void EventHistoryBuffer<EC>::AddKeyframe()
+  {
+    const u32 startItem = m_keyframeStartItem;
+    const u32 startEvent = m_keyframeStartEvent;
+    const u32 endItem = m_newestEventEnd;
+    const u32 endEvent = m_historyBuffer[endItem].GetHeaderEventNumber();
+    m_keyframeEvents = 0;
+    m_keyframeStartItem = endItem;
+    m_keyframeStartEvent = endEvent;
+
+    // Skip it if the interval has already begun rolling out of the
+    // buffer
+    const EventHistoryItem & from = m_historyBuffer[startItem];
+    const u32 oldest = m_historyBuffer[m_oldestEventStart].GetHeaderEventNumber();
+    if (!from.IsEnd() || from.GetHeaderEventNumber() != startEvent ||
+        IsEventAfter(oldest, startEvent))
+    {
+      return;
+    }
+
+    COMPILATION_REQUIREMENT< KEYFRAME_EVENTS * 256 <= 65536 >();  // For m_order
+    u32 deltas = 0;
+    for (u32 i = startItem; i != endItem; )
+    {
+      const u32 start = Increment(i);
+      const s32 end = EndOfEventStartedHere(start);
+      MFM_API_ASSERT_STATE(end >= 0);
+      deltas += m_historyBuffer[start].GetHeaderItems() - 1;
+      i = (u32) end;
+    }
+    const u32 first = ReserveKeyframeWords(deltas);
+    if (first == U32_MAX) return;
+
+    // Gather every delta of the interval, then sort them by word and
+    // keep each word's first old value and last new value
+    const MDist<R> & md = MDist<R>::get();
+    KeyframeWord * words = &m_keyframeWords[first];
+    u32 count = 0;
+    for (u32 i = startItem; i != endItem; )
+    {
+      const u32 start = Increment(i);
+      const u32 end = (u32) EndOfEventStartedHere(start);
+      const SPoint ctr = m_historyBuffer[start].GetHeaderSiteInTile();
+      for (u32 d = Increment(start); d != end; d = Increment(d))
+      {
+        const EventHistoryItem::DeltaItem & di = m_historyBuffer[d].mDeltaItem;
+        const bool atom = di.m_site < md.GetSiteCount();
+        const SPoint at = atom ? md.GetPoint(di.m_site) + ctr : ctr;
+        KeyframeWord & w = words[count];
+        w.m_x = (s16) at.GetX();
+        w.m_y = (s16) at.GetY();
+        w.m_site = atom ? 0 : di.m_site;
+        w.m_word = di.m_word;
+        w.m_order = (u16) count;
+        w.m_before = di.m_oldValue;
+        w.m_after = di.m_newValue;
+        ++count;
+      }
+      i = end;
+    }
+    qsort(words, count, sizeof(KeyframeWord), CompareKeyframeWords);
+
+    u32 kept = 0;
+    for (u32 i = 0; i < count; ++i)
+    {
+      if (kept > 0 && IsSameWord(words[kept - 1], words[i]))
+      {
+        words[kept - 1].m_after = words[i].m_after;
+      }
+      else
+      {
+        words[kept++] = words[i];
+      }
+    }
+    m_keyframeWordNext = first + kept;
+
+    if (m_keyframeCount == m_keyframeCapacity)
+    {
+      DropOldestKeyframe();
+    }
+    ++m_keyframeCount;
+    Keyframe & kf = GetKeyframe(0);
+    kf.m_startItem = startItem;
+    kf.m_startEvent = startEvent;
+    kf.m_endItem = endItem;
+    kf.m_endEvent = endEvent;
+    kf.m_firstWord = first;
+    kf.m_words = kept;
+  }
+
   template <class EC>
   void EventHistoryBuffer<EC>::AddEventStart(const SPoint ctr) 
   {
     if (!m_historyActive) return;
     MFM_API_ASSERT_STATE(!m_makingEvent);
+    NeedBuffer();
     EventHistoryItem & s = AllocateNextItem();
     m_makingEventStart = m_newestEventEnd; // well that's confusing
     s.MakeStart(ctr, ++m_eventsAdded);
@@ -78,6 +355,14 @@ namespace MFM {
     RecordAtomChanges(siteInWindow, oldAtom, newAtom);
   }
 
+  template <class EC>
+  void EventHistoryBuffer<EC>::AddEventBase(const B & oldBase, const B & newBase)
+  {
+    if (!m_historyActive) return;
+    MFM_API_ASSERT_STATE(m_makingEvent);
+    RecordBaseChanges(oldBase, newBase);
+  }
+
   template <class EC>
   void EventHistoryBuffer<EC>::AddEventEnd()
   {
@@ -96,6 +381,7 @@ namespace MFM {
       e.MakeEnd(s, m_itemsInEvent);
       m_cursor = (s32) m_newestEventEnd;
       s.mHeaderItem.m_count = m_itemsInEvent;  // Point start header back to us
+      NoteEventRecorded();
     }
     m_makingEvent = false;
   }
@@ -104,6 +390,7 @@ namespace MFM {
   void EventHistoryBuffer<EC>::AddEventWindow(const EventWindow<EC> & ew) 
   {
     if (!m_historyActive) return;
+    NeedBuffer();
     const Tile<EC> & t = ew.GetTile();
 
     SPoint ctr = ew.GetCenterInTile();
@@ -131,12 +418,14 @@ namespace MFM {
        e.MakeEnd(s, m_itemsInEvent);
        m_cursor = (s32) m_newestEventEnd;
        s.mHeaderItem.m_count = m_itemsInEvent;  // Point start header back to us
+       NoteEventRecorded();
      }
    }
 
    template <class EC>
    void EventHistoryBuffer<EC>::RecordAtomChanges(u32 siteInWindow, const T& oldAtom, const T& newAtom) 
    {
+     if (oldAtom == newAtom) return;  // The usual case; skip the word-by-word diff
 
      for (u32 i = 0; i < 96/32; ++i) 
      {
@@ -152,7 +441,7 @@ namespace MFM {
    }
 
    template <class EC>
-   void EventHistoryBuffer<EC>::RecordBaseChanges(const Base<AC>& oldBase, const Base<AC>& newBase) 
+   void EventHistoryBuffer<EC>::RecordBaseChanges(const B & oldBase, const B & newBase) 
    {
      RecordAtomChanges(BASE_ATOM, oldBase.GetBaseAtom(), newBase.GetBaseAtom());
      RecordSensorChanges(oldBase.GetSensory(), newBase.GetSensory());
@@ -193,7 +482,7 @@ namespace MFM {
    {
      bs.Printf("[EventHistoryBuffer(%p)", (void*) this);
      bs.Printf(",active=%d", m_historyActive);
-     if (m_historyActive)
+     if (m_historyActive && m_historyBuffer)
      {
        for (u32 i = m_oldestEventStart; i != m_newestEventEnd; )
        {
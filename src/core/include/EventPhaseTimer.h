@@ -0,0 +1,157 @@
+/*                                              -*- mode:C++ -*-
+  EventPhaseTimer.h Compile-time optional timing of event phases
+  Copyright (C) 2014-2016 The Regents of the University of New Mexico.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+  USA
+*/
+
+/**
+  \file EventPhaseTimer.h Compile-time optional timing of event phases
+  \date (C) 2014-2016 All rights reserved.
+  \lgpl
+ */
+#ifndef EVENTPHASETIMER_H
+#define EVENTPHASETIMER_H
+
+#include "itype.h"
+#include "Logger.h"
+
+#if !defined(__i386__) && !defined(__x86_64__)
+#include <time.h>  /* for clock_gettime */
+#endif
+
+namespace MFM
+{
+  /**
+     A cheap, monotonic timestamp: TSC cycles on x86, nanoseconds
+     elsewhere.  Available whether or not MFM_EVENT_PHASE_TIMING is
+     defined, for other optional profiling (e.g., ElementProfile).
+   */
+  inline u64 ReadEventTimestamp()
+  {
+#if defined(__i386__) || defined(__x86_64__)
+    return __builtin_ia32_rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((u64) ts.tv_sec) * 1000000000 + ts.tv_nsec;
+#endif
+  }
+}
+
+#ifndef MFM_EVENT_PHASE_TIMING
+
+#define MFM_EVENT_PHASE_START(var) do { } while (0)
+#define MFM_EVENT_PHASE_STOP(var, timer, phase) do { } while (0)
+
+#else /* MFM_EVENT_PHASE_TIMING */
+
+/**
+   Note the start of an event phase in local u64 \a var.  Compiles
+   to nothing unless MFM_EVENT_PHASE_TIMING is defined.
+ */
+#define MFM_EVENT_PHASE_START(var) \
+  const u64 var = MFM::EventPhaseTimer::ReadTimestamp()
+
+/**
+   Credit the time since MFM_EVENT_PHASE_START(var) to \a phase of
+   EventPhaseTimer \a timer.  Compiles to nothing unless
+   MFM_EVENT_PHASE_TIMING is defined.
+ */
+#define MFM_EVENT_PHASE_STOP(var, timer, phase) \
+  (timer).Record(MFM::EventPhaseTimer::phase, MFM::EventPhaseTimer::ReadTimestamp() - (var))
+
+namespace MFM
+{
+  /**
+     An EventPhaseTimer accumulates, for each phase of an event, a
+     log2 histogram of how many timestamp ticks (TSC cycles on x86,
+     nanoseconds elsewhere) that phase took.  Each Tile owns one,
+     which its EventWindow feeds, when the build defines
+     MFM_EVENT_PHASE_TIMING (e.g., make
+     EXTERNAL_DEFINES=-DMFM_EVENT_PHASE_TIMING).  Otherwise neither
+     the timer nor the timestamp reads exist.
+   */
+  class EventPhaseTimer
+  {
+  public:
+    enum Phase
+    {
+      ACQUIRE_LOCKS,     ///< EventWindow::AcquireAllLocks
+      LOAD_FROM_TILE,    ///< EventWindow::LoadFromTile
+      EXECUTE_BEHAVIOR,  ///< EventWindow::ExecuteBehavior
+      STORE_TO_TILE,     ///< EventWindow::InitiateCommunications, incl. StoreToTile
+      PHASE_COUNT
+    };
+
+    /** Bucket b counts durations in [2^b, 2^(b+1)) ticks; bucket 0 also gets 0 */
+    enum { BUCKET_COUNT = 32 };
+
+    static const char * GetPhaseName(u32 phase) ;
+
+    static u64 ReadTimestamp()
+    {
+      return ReadEventTimestamp();
+    }
+
+    EventPhaseTimer()
+    {
+      Reset();
+    }
+
+    void Reset() ;
+
+    void Record(Phase phase, u64 ticks)
+    {
+      u32 bucket = ticks ? 63 - __builtin_clzll(ticks) : 0;
+      if (bucket >= BUCKET_COUNT)
+      {
+        bucket = BUCKET_COUNT - 1;
+      }
+      ++m_histogram[phase][bucket];
+      ++m_samples[phase];
+      m_totalTicks[phase] += ticks;
+    }
+
+    /** Fold \a other's counts into this timer, e.g., to total a grid */
+    void Add(const EventPhaseTimer & other) ;
+
+    u64 GetSamples(u32 phase) const { return m_samples[phase]; }
+
+    u64 GetTotalTicks(u32 phase) const { return m_totalTicks[phase]; }
+
+    u64 GetBucketCount(u32 phase, u32 bucket) const { return m_histogram[phase][bucket]; }
+
+    /**
+       The histogram bucket holding the \a percent'th percentile of
+       \a phase, so that percentile is under 2^(bucket+1) ticks; 0 if
+       no samples.
+     */
+    u32 GetPercentileBucket(u32 phase, u32 percent) const ;
+
+    /** Log one summary line per phase at \a level, prefixed by \a label */
+    void ReportPhaseTimes(Logger::Level level, const char * label) const ;
+
+  private:
+    u64 m_histogram[PHASE_COUNT][BUCKET_COUNT];
+    u64 m_samples[PHASE_COUNT];
+    u64 m_totalTicks[PHASE_COUNT];
+  };
+} /* namespace MFM */
+
+#endif /* MFM_EVENT_PHASE_TIMING */
+
+#endif /* EVENTPHASETIMER_H */
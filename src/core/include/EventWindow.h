@@ -37,11 +37,17 @@
 #include "Base.h"
 #include "ByteSink.h"
 #include "BitStorage.h"
+#include "EventPhaseTimer.h"
+#include "Probes.h"
+#include "Random.h"
+#include "Mutex.h"
 
 namespace MFM
 {
 
   template <class EC> class Tile; // FORWARD
+  template <class EC> class EventWindowBatch; // FORWARD
+  template <class EC> class EventWorkers; // FORWARD
   template <class EC> class CacheProcessor; // FORWARD
   template <class EC> class AtomBitStorage; // FORWARD
 
@@ -93,6 +99,7 @@ namespace MFM
     // Extract short names for parameter types
     typedef typename EC::ATOM_CONFIG AC;
     typedef typename EC::SITE S;
+    typedef typename S::BASE B;
     typedef typename AC::ATOM_TYPE T;
     enum { R = EC::EVENT_WINDOW_RADIUS };
   public:
@@ -115,6 +122,19 @@ namespace MFM
     u64 m_eventWindowsAttempted;
     u64 m_eventWindowsExecuted;
     u64 m_eventWindowSitesAccessed; // Sum of within-boundary sites
+    u32 m_sitesWritten;             // By the latest StoreToTile
+    u64 m_inertEvents;              // Counted but not run.  \sa SkipInertEventAt
+
+    Random * m_random;              // The tile's, unless a helper
+    Mutex * m_commitLock;           // Non-null iff a helper.  \sa MakeHelper
+
+    /** Holds a helper's commit lock, if any, while in scope */
+    struct CommitScope
+    {
+      Mutex * const m_lock;
+      CommitScope(Mutex * lock) : m_lock(lock) { if (m_lock) m_lock->Lock(); }
+      ~CommitScope() { if (m_lock) m_lock->Unlock(); }
+    };
 
     void RecordEventAtTileCoord(const SPoint tcoord) ;
 
@@ -127,7 +147,81 @@ namespace MFM
     AtomBitStorage<EC>  m_atomBuffer[SITE_COUNT];
     bool m_isLiveSite[SITE_COUNT];
 
-    Base<AC> m_centerBase;
+    /**
+     * For each element type present in the window, a bitmask of the
+     * live direct site numbers holding it, so WindowScanner searches
+     * by type and radius reduce to a few bit operations.  Built from
+     * m_atomBuffer on first use after LoadFromTile, and discarded by
+     * any write to m_atomBuffer.  \sa GetTypeSitesDirect
+     */
+    struct TypeSites
+    {
+      u32 m_type;
+      u64 m_sites;
+    };
+    mutable TypeSites m_typeSites[SITE_COUNT];
+    mutable u32 m_typeSitesCount;
+    mutable bool m_typeSitesValid;
+
+    void InvalidateTypeSites()
+    {
+      m_typeSitesValid = false;
+    }
+
+    /**
+     * Direct site numbers the behavior may have written since
+     * LoadFromTile, one bit each.  StoreToTile only compares and
+     * writes back these; every other site is known to match the tile.
+     */
+    u64 m_writtenSites;
+
+    void MarkWritten(u32 directSiteNumber)
+    {
+      InvalidateTypeSites();
+      m_writtenSites |= ((u64) 1) << directSiteNumber;
+    }
+
+    void BuildTypeSites() const ;
+
+    /**
+     * Offset of each event window site from the center site in the
+     * tile's site array (and atom plane, for PLANAR sites), fixed by
+     * the tile width, so loading and
+     * storing is a gather over this list rather than a point
+     * mapping per site.
+     */
+    s32 m_siteOffsets[SITE_COUNT];
+
+    /**
+     * Event window centers with both coordinates in
+     * [m_allLiveMin,m_allLiveMax) have every window site in the
+     * owned region, so all of them are live without checking.
+     */
+    u32 m_allLiveMin;
+    u32 m_allLiveMaxX;
+    u32 m_allLiveMaxY;
+
+    /**
+     * The tile atom at window site \c i, given the center's Site and
+     * atom.  PLANAR sites index the contiguous atom plane directly.
+     */
+    const T & TileAtomAt(const S * centerSite, const T * centerAtom, u32 i) const
+    {
+      return S::IS_PLANAR ?
+        centerAtom[m_siteOffsets[i]] :
+        centerSite[m_siteOffsets[i]].GetAtom();
+    }
+
+    bool IsAllLiveCenter(const SPoint & center) const
+    {
+      const u32 x = (u32) center.GetX();
+      const u32 y = (u32) center.GetY();
+      return
+        x >= m_allLiveMin && x < m_allLiveMaxX &&
+        y >= m_allLiveMin && y < m_allLiveMaxY;
+    }
+
+    B m_centerBase;
 
     SPoint m_center;
 
@@ -137,6 +231,12 @@ namespace MFM
 
     PointSymmetry m_sym;
 
+    /** The directions this event locked, a bit per Dir, for the FlightRecorder */
+    u32 m_lockDirs;
+
+    /** Did the last ExecuteBehavior FAIL? */
+    bool m_behaviorFailed;
+
     bool AcquireAllLocks(const SPoint& centerSite, const u32 eventWindowBoundary) ;
 
     bool AcquireRegionLocks(const u32 neededArg, const THREEDIR& lockRegionsArg);
@@ -156,10 +256,31 @@ namespace MFM
     {
       FREE,
       COMPUTE,
-      COMMUNICATE
+      COMMUNICATE,
+      PARKED        // Run optimistically, not yet stored
     };
     State m_ewState;
 
+    /** Change stamps noted by an optimistic event.  \sa TryOptimisticEventAt */
+    enum { MAX_PARKED_BLOCKS = 16 };
+    u32 m_parkedBlocks[MAX_PARKED_BLOCKS];
+    u32 m_parkedBlockStamps[MAX_PARKED_BLOCKS];
+    u32 m_parkedBlockCount;
+    u32 m_parkedChangeStamp;
+    u64 m_parkedCenterEvents;
+    u32 m_parkedConflicts;
+
+    u64 m_optimisticCommits;
+    u64 m_optimisticConflicts;
+    u64 m_optimisticDrops;
+
+    /** Load and run the event at \c center without locks, and park it */
+    bool RunOptimisticEventAt(const SPoint & center) ;
+
+    void NoteParkedStamps() ;
+
+    bool AreParkedStampsCurrent() const ;
+
     /**
      * Produce the absolute tile location for a given
      * eventwindow-relative coordinate loc.  Maps loc through the
@@ -191,6 +312,46 @@ namespace MFM
 
     bool RejectOnRecency(const SPoint tcoord) ;
 
+    /**
+       TryEventAt's filtering: count an attempt at \c tcenter and
+       \returns false if RejectOnRecency turns it down.
+     */
+    bool AcceptEventAt(const SPoint & tcenter)
+    {
+      CountEventAttempt();
+      return !RejectOnRecency(tcenter);
+    }
+
+    /**
+       Count an attempt at an event whose center was drawn some way
+       that needs no RejectOnRecency filtering.
+     */
+    void CountEventAttempt()
+    {
+      ++m_eventWindowsAttempted;
+    }
+
+    /**
+       The rest of TryEventAt: lock, load, run and store an event at
+       \c tcenter, which has already been counted as attempted.
+     */
+    bool ExecuteEventAt(const SPoint & tcenter) ;
+
+    /**
+       If \c tcenter is in the hidden region, where events need no
+       locks, and its atom is sane and of an inert Element, count and
+       record an event there without loading or running anything, and
+       \returns true.  Else \returns false.
+     */
+    bool SkipInertEventAt(const SPoint & tcenter) ;
+
+    /**
+       Hand \c batch to its element's BatchBehavior.  A behavior
+       failure empties that event's center, as ExecuteBehavior does,
+       and drops the rest of the batch.
+     */
+    void ExecuteBatch(EventWindowBatch<EC> & batch) ;
+
     void ExecuteEvent() ;
 
     void PrintEventSite(ByteSink & bs) ;
@@ -205,6 +366,8 @@ namespace MFM
 
     friend class EventWindow_Test;
     friend class Tile<EC>;
+    friend class EventWindowBatch<EC>;
+    friend class EventWorkers<EC>;
 
     /**
      * Attempt to lock the specified direction for use by this
@@ -239,6 +402,15 @@ namespace MFM
   public:
     bool TryForceEventAt(const SPoint & center) ;
 
+    /**
+     * Run an event at \c center anywhere in the owned region without
+     * taking any intertile locks, so the event's writes reach this
+     * tile's own sites (cache included) and nowhere else.  For a
+     * caller that has the whole neighborhood to itself and squares up
+     * the neighbors' copies afterwards.  \sa Grid::RunDeterministicStep
+     */
+    bool TryUnlockedEventAt(const SPoint & center) ;
+
     bool TryEventAtForTesting(const SPoint & center)
     {
       return TryEventAt(center);
@@ -260,17 +432,17 @@ namespace MFM
      */
     bool InitForEvent(const SPoint & center, bool tryForLocks = true) ;
 
-    const Site<AC> & GetSite() const
+    const S & GetSite() const
     {
       return GetTile().GetSite(m_center);
     }
 
-    const Base<AC> & GetBase() const
+    const B & GetBase() const
     {
       return m_centerBase;
     }
 
-    Base<AC> & GetBase()
+    B & GetBase()
     {
       return m_centerBase;
     }
@@ -290,6 +462,16 @@ namespace MFM
       return m_eventWindowSitesAccessed;
     }
 
+    /**
+       Get the number of events, included in GetEventWindowsExecuted,
+       that were centered on inert elements in the hidden region and
+       so skipped.
+     */
+    u64 GetInertEvents() const
+    {
+      return m_inertEvents;
+    }
+
     void SetEventWindowsAttempted(u64 attempts)
     {
       m_eventWindowsAttempted = attempts;
@@ -300,6 +482,119 @@ namespace MFM
       m_eventWindowsExecuted = executed;
     }
 
+    /**
+       Count \c events events as attempted and executed without
+       running them.  Used by sparse event selection for the empty-site
+       events it skips, so that event numbers and AEPS stay comparable
+       to plain uniform selection.
+     */
+    void CreditSkippedEvents(u64 events)
+    {
+      m_eventWindowsAttempted += events;
+      m_eventWindowsExecuted += events;
+    }
+
+    /**
+       Make this a helper window, running events alongside the tile's
+       own window and any other helpers, on footprints they have
+       claimed.  (\sa EventWorkers.)  A helper draws from \c random
+       rather than the tile's PRNG, and does its tile bookkeeping --
+       event counts and stamps, and storing back -- holding \c
+       commitLock.  Its executed events are counted by the tile's own
+       window, numbering them in the tile's single sequence; its other
+       counts are its own until AbsorbCounts.  A helper never
+       runs UlamElements, which reach the tile's window, PRNG and
+       transient arena through their UlamContext.
+     */
+    void MakeHelper(Random & random, Mutex & commitLock)
+    {
+      m_random = &random;
+      m_commitLock = &commitLock;
+    }
+
+    bool IsHelper() const
+    {
+      return m_commitLock != 0;
+    }
+
+    /**
+       Move \c other's attempt, site and inert event counts into ours.
+       (Executed events are always counted by the tile's own window.)
+     */
+    void AbsorbCounts(EventWindow<EC> & other)
+    {
+      m_eventWindowsAttempted += other.m_eventWindowsAttempted;
+      m_eventWindowSitesAccessed += other.m_eventWindowSitesAccessed;
+      m_inertEvents += other.m_inertEvents;
+      other.m_eventWindowsAttempted = 0;
+      other.m_eventWindowSitesAccessed = 0;
+      other.m_inertEvents = 0;
+    }
+
+    /**
+       Optimistically attempt an event at \c tcenter: after
+       RejectOnRecency filtering, load and run it without any
+       intertile locks, noting the change stamps of the tile blocks
+       under the window and the center's event count.  Then try to
+       commit it as AdvanceParkedEvent does.  \returns true if the
+       event was stored; false if it was rejected, or is left parked
+       for AdvanceParkedEvent because its locks were busy.
+
+       Only events that need locks gain anything by this; the tile
+       sends the hidden region's straight to TryEventAt.
+     */
+    bool TryOptimisticEventAt(const SPoint & tcenter) ;
+
+    /** true while an optimistic event waits to commit */
+    bool IsParked() const
+    {
+      return m_ewState == PARKED;
+    }
+
+    /**
+       Try to commit the parked event.  If any change stamp it noted
+       has moved -- an event of ours or a neighbor's cache update
+       touched its window, or its center had an event -- it is a
+       conflict, and the event is reloaded and rerun, up to
+       MAX_OPTIMISTIC_CONFLICTS times before it is dropped.  A valid
+       event then takes its locks, as TryEventAt would have at the
+       start, and if it gets them it's recorded and stored.  A
+       neighbor's events that could touch the window only release
+       their locks after their updates have reached us, so holding
+       the locks of a still-valid event means it saw the latest.
+       \returns true if the event was stored.
+     */
+    bool AdvanceParkedEvent() ;
+
+    /** Drop the parked event, if any, as if it had never been drawn */
+    void AbandonParkedEvent()
+    {
+      if (IsParked())
+      {
+        SetFree();
+      }
+    }
+
+    enum { MAX_OPTIMISTIC_CONFLICTS = 3 };
+
+    /** Optimistic events stored */
+    u64 GetOptimisticCommits() const
+    {
+      return m_optimisticCommits;
+    }
+
+    /** Optimistic events rerun because their window changed */
+    u64 GetOptimisticConflicts() const
+    {
+      return m_optimisticConflicts;
+    }
+
+    /** Optimistic events dropped after too many conflicts */
+    u64 GetOptimisticDrops() const
+    {
+      return m_optimisticDrops;
+    }
+
     void Diffuse() ;
 
     bool IsFree() const
@@ -392,8 +687,10 @@ namespace MFM
      */
     u32 MapIndexToIndexSymValid(const u32 siteNumber, PointSymmetry psym) const
     {
-      SPoint sym = MapToPointSymValid(siteNumber, psym);
-      return MapToIndexDirectValid(sym);
+      const MDist<R> & md = MDist<R>::get();
+      const u32 index = md.GetSymSiteNumber(siteNumber, psym);
+      MFM_API_ASSERT_ARG(index < m_boundedSiteCount);
+      return index;
     }
 
     /**
@@ -441,14 +738,16 @@ namespace MFM
 
     /**
      * Gets the Random object used by the Tile that this EventWindow
-     * is taking place inside.
+     * is taking place inside, or a helper window's own.
      *
      * @returns The PRNG used by the Tile that this EventWindow is
      *          taking place in.
+     *
+     * @sa MakeHelper
      */
     Random & GetRandom()
     {
-      return GetTile().GetRandom();
+      return *m_random;
     }
 
     /**
@@ -542,6 +841,43 @@ namespace MFM
       return m_isLiveSite[siteNumber];
     }
 
+    /**
+     * Direct site numbers the behavior may have written since the
+     * window was loaded, one bit each (bit 0 is the center).  Sites
+     * whose bits are clear still hold what was loaded, so code that
+     * mirrors the window elsewhere need only copy back these.
+     */
+    u64 GetWrittenSitesDirect() const
+    {
+      return m_writtenSites;
+    }
+
+    /**
+     * Gets the live sites of this EventWindow holding atoms of a
+     * given type, as a bitmask with bit \c i set for direct site
+     * number \c i (the center is bit 0), ignoring the current
+     * symmetry.
+     *
+     * @param type The element type to look for.
+     *
+     * @returns The sites holding \c type , or \c 0 if there are none.
+     */
+    u64 GetTypeSitesDirect(const u32 type) const
+    {
+      if (!m_typeSitesValid)
+      {
+        BuildTypeSites();
+      }
+      for (u32 i = 0; i < m_typeSitesCount; ++i)
+      {
+        if (m_typeSites[i].m_type == type)
+        {
+          return m_typeSites[i].m_sites;
+        }
+      }
+      return 0;
+    }
+
     /**
      * Constructs a new EventWindow which takes place on a specified
      * Tile with the default PointSymmetry of PSYM_NORMAL .
@@ -585,7 +921,9 @@ namespace MFM
      */
     AtomBitStorage<EC>& GetAtomBitStorage(u32 siteNumber)
     {
-      return m_atomBuffer[MapIndexToIndexSymValid(siteNumber)];
+      const u32 idx = MapIndexToIndexSymValid(siteNumber);
+      MarkWritten(idx);
+      return m_atomBuffer[idx];
     }
 
     /**
@@ -603,6 +941,7 @@ namespace MFM
      */
     AtomBitStorage<EC>& GetCenterAtomBitStorage()
     {
+      MarkWritten(0);
       return m_atomBuffer[0];
     }
 
@@ -658,6 +997,7 @@ namespace MFM
     void SetAtomDirect(u32 siteNumber, const T & newAtom)
     {
       MFM_API_ASSERT_ARG(siteNumber < SITE_COUNT);
+      MarkWritten(siteNumber);
       m_atomBuffer[siteNumber].WriteAtom(newAtom);
     }
 
@@ -667,7 +1007,9 @@ namespace MFM
      */
     void SetAtomSym(u32 siteNumber, const T & newAtom)
     {
-      m_atomBuffer[MapIndexToIndexSymValid(siteNumber)].WriteAtom(newAtom);
+      const u32 idx = MapIndexToIndexSymValid(siteNumber);
+      MarkWritten(idx);
+      m_atomBuffer[idx].WriteAtom(newAtom);
     }
 
     /**
@@ -679,6 +1021,7 @@ namespace MFM
      */
     void SetCenterAtomDirect(const T& atom)
     {
+      MarkWritten(0);
       m_atomBuffer[0].WriteAtom(atom);
     }
 
@@ -692,6 +1035,7 @@ namespace MFM
      */
     void SetCenterAtomSym(const T& atom)
     {
+      MarkWritten(0);
       m_atomBuffer[0].WriteAtom(atom);
     }
 
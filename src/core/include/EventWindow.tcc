@@ -5,7 +5,9 @@
 #include "ChannelEnd.h"
 #include "PacketIO.h"
 #include "EventHistoryBuffer.h"
+#include "FlightRecorder.h"
 #include "CacheProcessor.h"
+#include "EventWindowBatch.h"
 
 namespace MFM {
 
@@ -17,6 +19,38 @@ namespace MFM {
                   tcenter.GetY()));
     ++m_eventWindowsAttempted;
 
+    return ExecuteEventAt(tcenter);
+  }
+
+  template <class EC>
+  bool EventWindow<EC>::TryUnlockedEventAt(const SPoint & tcenter)
+  {
+    ++m_eventWindowsAttempted;
+
+    if (SkipInertEventAt(tcenter))
+    {
+      return true;
+    }
+
+    if (!InitForEvent(tcenter, false))
+    {
+      return false;
+    }
+
+    RecordEventAtTileCoord(tcenter);
+    ExecuteEvent();
+
+    return true;
+  }
+
+  template <class EC>
+  bool EventWindow<EC>::ExecuteEventAt(const SPoint & tcenter)
+  {
+    if (SkipInertEventAt(tcenter))
+    {
+      return true;
+    }
+
     if (!InitForEvent(tcenter))
     {
       return false;
@@ -28,6 +62,33 @@ namespace MFM {
     return true;
   }
 
+  template <class EC>
+  bool EventWindow<EC>::SkipInertEventAt(const SPoint & tcenter)
+  {
+    // Events near the edges stay real, to keep the neighbors' caches
+    // seeing their usual updates and redundancy spot checks
+    Tile<EC> & tile = GetTile();
+    if (!tile.IsInHidden(tcenter))
+    {
+      return false;
+    }
+
+    const T & atom = *tile.GetAtom(tcenter);
+    const Element<EC> * elt = tile.GetElementTable().Lookup(atom.GetType());
+    if (!elt || !elt->IsInert() || !atom.IsSane())
+    {
+      return false;
+    }
+
+    RecordEventAtTileCoord(tcenter);
+    ++m_inertEvents;
+    if (tile.IsElementProfiling())
+    {
+      tile.GetElementProfile().Record(elt->GetType(), 0, 0);
+    }
+    return true;
+  }
+
   template <class EC>
   bool EventWindow<EC>::TryEventAtForProfiling(const SPoint & tcenter)
   {
@@ -53,36 +114,175 @@ namespace MFM {
                   tcenter.GetY(),
 		  t.GetLabel()));
 
-    ++m_eventWindowsAttempted;
+    MFM_PROBE3(event__start, (void *) &t, tcenter.GetX(), tcenter.GetY());
+    const bool ran = AcceptEventAt(tcenter) && ExecuteEventAt(tcenter);
+    MFM_PROBE4(event__end, (void *) &t, tcenter.GetX(), tcenter.GetY(), ran);
+    return ran;
+  }
 
-    if (RejectOnRecency(tcenter))
+  template <class EC>
+  bool EventWindow<EC>::TryOptimisticEventAt(const SPoint & tcenter)
+  {
+    MFM_API_ASSERT_STATE(IsFree());
+    if (!AcceptEventAt(tcenter))
     {
       return false;
     }
 
-    if (!InitForEvent(tcenter))
+    m_parkedConflicts = 0;
+    if (!RunOptimisticEventAt(tcenter))
     {
       return false;
     }
+    return AdvanceParkedEvent();
+  }
 
-    RecordEventAtTileCoord(tcenter);
-    ExecuteEvent();
+  template <class EC>
+  bool EventWindow<EC>::RunOptimisticEventAt(const SPoint & center)
+  {
+    if (!InitForEvent(center, false))
+    {
+      return false;
+    }
+    NoteParkedStamps();
+    ExecuteBehavior();
+    m_ewState = PARKED;
+    return true;
+  }
+
+  template <class EC>
+  bool EventWindow<EC>::AdvanceParkedEvent()
+  {
+    MFM_API_ASSERT_STATE(IsParked());
+
+    if (!AreParkedStampsCurrent())
+    {
+      ++m_optimisticConflicts;
+      const SPoint center = m_center;
+      SetFree();
+      if (++m_parkedConflicts > MAX_OPTIMISTIC_CONFLICTS)
+      {
+        ++m_optimisticDrops;
+        return false;
+      }
+      if (!RunOptimisticEventAt(center))
+      {
+        return false;
+      }
+    }
+
+    if (!AcquireAllLocks(m_center, m_eventWindowBoundary))
+    {
+      return false;  // Still parked
+    }
+
+    m_ewState = COMPUTE;
+    RecordEventAtTileCoord(m_center);
+    InitiateCommunications();
+    ++m_optimisticCommits;
+    return true;
+  }
+
+  template <class EC>
+  void EventWindow<EC>::NoteParkedStamps()
+  {
+    Tile<EC> & t = GetTile();
+    const s32 shift = Tile<EC>::CHANGE_BLOCK_SHIFT;
+    const s32 r = m_eventWindowBoundary > 0 ? m_eventWindowBoundary - 1 : 0;
+    const s32 bx0 = MAX(m_center.GetX() - r, 0) >> shift;
+    const s32 bx1 = MIN(m_center.GetX() + r, (s32) t.TILE_WIDTH - 1) >> shift;
+    const s32 by0 = MAX(m_center.GetY() - r, 0) >> shift;
+    const s32 by1 = MIN(m_center.GetY() + r, (s32) t.TILE_HEIGHT - 1) >> shift;
+
+    m_parkedBlockCount = 0;
+    for (s32 by = by0; by <= by1; ++by)
+    {
+      for (s32 bx = bx0; bx <= bx1; ++bx)
+      {
+        MFM_API_ASSERT_STATE(m_parkedBlockCount < MAX_PARKED_BLOCKS);
+        const u32 block = by * t.GetChangeBlocksWide() + bx;
+        m_parkedBlocks[m_parkedBlockCount] = block;
+        m_parkedBlockStamps[m_parkedBlockCount] = t.GetChangeBlockStamp(block);
+        ++m_parkedBlockCount;
+      }
+    }
+    m_parkedChangeStamp = t.GetChangeStamp();
+    m_parkedCenterEvents = t.GetSite(m_center).GetEventCount();
+  }
 
+  template <class EC>
+  bool EventWindow<EC>::AreParkedStampsCurrent() const
+  {
+    const Tile<EC> & t = GetTile();
+    if (t.GetChangeStamp() != m_parkedChangeStamp ||
+        t.GetSite(m_center).GetEventCount() != m_parkedCenterEvents)
+    {
+      return false;
+    }
+    for (u32 i = 0; i < m_parkedBlockCount; ++i)
+    {
+      if (t.GetChangeBlockStamp(m_parkedBlocks[i]) != m_parkedBlockStamps[i])
+      {
+        return false;
+      }
+    }
     return true;
   }
 
+  template <class EC>
+  void EventWindow<EC>::ExecuteBatch(EventWindowBatch<EC> & batch)
+  {
+    Tile<EC> & t = GetTile();
+
+    unwind_protect_backtrace(LOG.IfLog(Logger::DEBUG),
+    {
+      if (!batch.IsInBehavior())
+      {
+        // Not the behavior's failure; pass it on as an unbatched
+        // event's store would
+        FAIL_BY_NUMBER(MFMThrownFailCode);
+      }
+
+      OString256 buff;
+      PrintEventSite(buff);
+      const char * failMsg = MFMFailCodeReason(MFMThrownFailCode);
+      MFM_LOG_DBG3(("%s: batched behave() failed at %s:%d: %s (site type 0x%04x)",
+                    buff.GetZString(),
+                    MFMThrownFromFile,
+                    MFMThrownFromLineNo,
+                    failMsg ? failMsg : "?",
+                    GetCenterAtomDirect().GetType()));
+      if (MFMThrownBacktraceSize > 0)
+        LogBacktrace(MFMThrownBacktraceArray, MFMThrownBacktraceSize);
+      SetCenterAtomDirect(t.GetEmptyAtom());
+    },
+    {
+      batch.GetElement().BatchBehavior(batch);
+    });
+
+    batch.Finish();
+  }
+
   template <class EC>
   void EventWindow<EC>::RecordEventAtTileCoord(const SPoint tcoord)
   {
     Tile<EC> & t = GetTile();
     MFM_API_ASSERT_STATE(!t.IsDummyTile()); //sanity
 
-    ++m_eventWindowsExecuted;
+    // Whichever window runs it, events are numbered by the tile's own
+    CommitScope commit(m_commitLock);
+    EventWindow<EC> & counter = t.GetEventWindow();
+    ++counter.m_eventWindowsExecuted;
 
     SPoint owned = Tile<EC>::TileCoordToOwned(tcoord);
     t.m_lastEventCenterOwned = owned;
+    t.NoteEventInBin(owned);
     //t.GetSite(owned).SetLastEventEventNumber(m_eventWindowsExecuted);
-    t.GetSite(tcoord).RecordEventAtSite(m_eventWindowsExecuted);
+    t.GetSite(tcoord).RecordEventAtSite(counter.m_eventWindowsExecuted);
+    if (t.m_agedEvents)
+    {
+      t.NoteAgedEvent(tcoord);
+    }
   }
 
   template <class EC>
@@ -103,9 +303,31 @@ namespace MFM {
     MFM_LOG_DBG6(("EW::ExecuteEvent %s", GetTile().GetLabel()));
     MFM_API_ASSERT_STATE(m_ewState == COMPUTE);
 
+    Tile<EC> & tile = GetTile();
+    const bool profiling = tile.IsElementProfiling();
+    const u32 type = m_element->GetType(); // Before behave() can change the center
+    u64 behaveTicks = ReadEventTimestamp();
+    FlightRecorder::Record & flight =
+      tile.GetFlightRecorder().Begin(m_center, type, m_lockDirs, behaveTicks);
+
+    MFM_EVENT_PHASE_START(behaveStart);
     ExecuteBehavior();
+    if (profiling)
+    {
+      behaveTicks = ReadEventTimestamp() - behaveTicks;
+    }
+    MFM_EVENT_PHASE_STOP(behaveStart, tile.GetEventPhaseTimer(), EXECUTE_BEHAVIOR);
 
+    flight.m_outcome = FlightRecorder::STORING;
+    MFM_EVENT_PHASE_START(storeStart);
     InitiateCommunications();
+    MFM_EVENT_PHASE_STOP(storeStart, tile.GetEventPhaseTimer(), STORE_TO_TILE);
+    flight.m_outcome = m_behaviorFailed ? FlightRecorder::FAILED : FlightRecorder::DONE;
+
+    if (profiling)
+    {
+      tile.GetElementProfile().Record(type, behaveTicks, m_sitesWritten);
+    }
   }
 
   template <class EC>
@@ -137,8 +359,12 @@ namespace MFM {
 
     MFM_LOG_DBG6(("EW::ExecuteBehavior %s",t.GetLabel()));
 
-    unwind_protect(
+    // Behavior failures are routine enough that their backtraces are
+    // only captured (and logged) at DEBUG and above
+    m_behaviorFailed = false;
+    unwind_protect_backtrace(LOG.IfLog(Logger::DEBUG),
     {
+      m_behaviorFailed = true;
       OString256 buff;
       PrintEventSite(buff);
       buff.Printf(":");
@@ -169,49 +395,63 @@ namespace MFM {
 		      MFMThrownFailCode,
 		      GetCenterAtomDirect().GetType()));
       }
-      LogBacktrace(MFMThrownBacktraceArray, MFMThrownBacktraceSize);
+      if (MFMThrownBacktraceSize > 0)
+        LogBacktrace(MFMThrownBacktraceArray, MFMThrownBacktraceSize);
       SetCenterAtomDirect(t.GetEmptyAtom());
     },
     {
       MFM_LOG_DBG6(("ET::Execute %s",t.GetLabel()));
       m_element->Behavior(*this);
     });
+
+    if (!IsHelper())  // Helpers never run ulam, and mustn't touch the arena
+    {
+      t.GetTransientArena().Reset(); // Whether behave() returned or failed
+    }
   }
 
   template <class EC>
   void EventWindow<EC>::Diffuse()
   {
-    EventWindow & window = *this;
-    Random & random = window.GetRandom();
-    Tile<EC>& tile = window.GetTile();
+    Random & random = GetRandom();
+    Tile<EC>& tile = GetTile();
 
     MFM_API_ASSERT_STATE(!tile.IsDummyTile()); //sanity
 
     const MDist<R> & md = MDist<R>::get();
 
-    SPoint sp;
-    md.FillRandomSingleDir(sp, random);
+    // The same draw as MDist::FillRandomSingleDir, as a site number
+    const u32 dir = random.Create(4);
+    u32 site = md.GetSingleDirSiteNumber(dir);
 
     // Don't diffuse stuff into the great nowhere, but consider
     // 'bouncing' off the edge of the universe
-    if (!window.IsLiveSiteDirect(sp)) {
-      sp *= -1;
-      if (!window.IsLiveSiteDirect(sp))  // Wow this is a tight universe!
+    if (site >= m_boundedSiteCount || !m_isLiveSite[site]) {
+      site = md.GetSingleDirSiteNumber(dir ^ 1);
+      if (site >= m_boundedSiteCount || !m_isLiveSite[site])  // Wow this is a tight universe!
         return;
     }
 
-    T us = window.GetCenterAtomDirect();
-    T other = window.GetRelativeAtomDirect(sp);
+    const T & us = GetCenterAtomDirect();
+    const T & other = GetAtomDirect(site);
     const Element<EC> * ourElt = tile.GetElement(us.GetType());
-    const Element<EC> * elt = tile.GetElement(other.GetType());
+    const Element<EC> * elt;
 
     if (!other.IsSane() || !(elt = tile.GetElement(other.GetType())))
       return;       // Any confusion, let the engine sort it out first
 
-    u32 thisWeight = elt->Diffusability(window, sp, SPoint(0,0));
-    u32 ourWeight = ourElt->Diffusability(window, SPoint(0,0), sp);
-    if (random.OddsOf(MIN(ourWeight, thisWeight), COMPLETE_DIFFUSABILITY))
-      window.SwapAtomsDirect(sp, SPoint(0, 0));
+    u32 weight = COMPLETE_DIFFUSABILITY;
+    if (!ourElt->IsAlwaysDiffusable() || !elt->IsAlwaysDiffusable())
+    {
+      const SPoint sp = md.GetPoint(site);
+      u32 thisWeight = elt->Diffusability(*this, sp, SPoint(0,0));
+      u32 ourWeight = ourElt->Diffusability(*this, SPoint(0,0), sp);
+      weight = MIN(ourWeight, thisWeight);
+    }
+
+    // Drawn even when certain, so seeded runs go as they always have
+    if (random.OddsOf(weight, COMPLETE_DIFFUSABILITY))
+      SwapAtomsDirect(site, 0u);
   }
 
   template <class EC>
@@ -222,6 +462,7 @@ namespace MFM {
     m_eventWindowBoundary = boundary;
     const MDist<R> & md = MDist<R>::get();
     m_boundedSiteCount = md.GetFirstIndex(m_eventWindowBoundary);
+    InvalidateTypeSites();
   }
 
   template <class EC>
@@ -271,7 +512,11 @@ namespace MFM {
 
     SetBoundary(m_element->GetEventWindowBoundary());
 
-    if (tryForLocks && !AcquireAllLocks(center, m_eventWindowBoundary))
+    MFM_EVENT_PHASE_START(lockStart);
+    m_lockDirs = 0;
+    const bool locked = !tryForLocks || AcquireAllLocks(center, m_eventWindowBoundary);
+    MFM_EVENT_PHASE_STOP(lockStart, tile.GetEventPhaseTimer(), ACQUIRE_LOCKS);
+    if (!locked)
     {
       MFM_LOG_DBG6(("EW::InitForEvent (%d,%d) %s - abandoned",
 		    center.GetX(),center.GetY(),
@@ -284,7 +529,9 @@ namespace MFM {
     m_ewState = COMPUTE;
     m_sym = PSYM_NORMAL;
 
+    MFM_EVENT_PHASE_START(loadStart);
     LoadFromTile();
+    MFM_EVENT_PHASE_STOP(loadStart, tile.GetEventPhaseTimer(), LOAD_FROM_TILE);
     return true;
   }
 
@@ -315,15 +562,17 @@ namespace MFM {
       MFM_LOG_DBG6(("EW::AcquireRegionLocks %s - fail: %s cp not idle",
 		    ewtile.GetLabel(),
                     Dirs::GetName(dir)));
+      MFM_PROBE2(lock__fail, (void *) &ewtile, (u32) dir);
       return LOCK_UNAVAILABLE;
     }
 
-    bool locked = cp.TryLock(neededLocks, lockRegions);
+    bool locked = cp.TryLock(neededLocks, lockRegions, ewtile.GetLockSpinCount());
     if (!locked)
     {
       MFM_LOG_DBG6(("EW::AcquireRegionLocks %s - fail: didn't get %s lock",
 		    ewtile.GetLabel(),
                     Dirs::GetName(dir)));
+      MFM_PROBE2(lock__fail, (void *) &ewtile, (u32) dir);
       return LOCK_UNAVAILABLE;
     }
     MFM_LOG_DBG6(("EW::AcquireRegionLocks %s, %s got lock"
@@ -353,23 +602,34 @@ namespace MFM {
       return true;  // Nobody is needed
     }
 
-    // At least one lock may be needed, to be shuffled
+    // At least one lock may be needed.  Take them in increasing
+    // order of lock address, a total order shared by every tile, so
+    // that spinning on one while holding others can never deadlock.
     u32 needed = neededArg;  //as flag
-    Dir lockDirs[MAX_LOCK_DIRS]; //to shuffle
+    Dir lockDirs[MAX_LOCK_DIRS]; //to sort
+    const void * lockKeys[MAX_LOCK_DIRS];
     for(u32 i = 0; i < needed; i++)
-      lockDirs[i] = lockRegionsArg[i];
+    {
+      Dir dir = lockRegionsArg[i];
+      CacheProcessor<EC> & cp = tile.GetCacheProcessor(dir);
+      const void * key = (cp.IsUnclaimed() || !cp.IsConnected()) ? 0 : &cp.GetLonglivedLock();
 
-    if(needed==3)
-      Shuffle<Dir,3>(GetRandom(),lockDirs);
-    else if (needed==2)
-      Shuffle<Dir,2>(GetRandom(),lockDirs);
+      u32 j = i;
+      for (; j > 0 && lockKeys[j - 1] > key; --j)
+      {
+        lockDirs[j] = lockDirs[j - 1];
+        lockKeys[j] = lockKeys[j - 1];
+      }
+      lockDirs[j] = dir;
+      lockKeys[j] = key;
+    }
 
     MFM_LOG_DBG6(("EW::AcquireRegionLocks %s - checking %d",
 		  tile.GetLabel(),
 		  needed));
 
     u32 got = 0;
-    for (s32 i = needed; --i >= 0; )
+    for (u32 i = 0; i < neededArg; ++i)
     {
       Dir dir = lockDirs[i];
       LockStatus ls = AcquireDirLock(dir, neededArg, lockRegionsArg);
@@ -468,6 +728,9 @@ namespace MFM {
     //try starting with only connected directions
     //u32 eventLocksNeeded = t.GetLockDirections(tileCenter, eventWindowBoundary, eventLockRegions);
     u32 eventLocksNeeded = t.GetAllLockDirections(tileCenter, eventWindowBoundary, eventLockRegions);
+    m_lockDirs = 0;
+    for (u32 i = 0; i < eventLocksNeeded; ++i)
+      m_lockDirs |= 1 << eventLockRegions[i];
 
     MFM_LOG_DBG7(("EW:: AcquireAllLocks %s %d[%s %s %s] for tilecenter(%2d,%2d)",
                   t.GetLabel(),
@@ -489,9 +752,25 @@ namespace MFM {
     , m_eventWindowsAttempted(0)
     , m_eventWindowsExecuted(0)
     , m_eventWindowSitesAccessed(0)
+    , m_sitesWritten(0)
+    , m_inertEvents(0)
+    , m_random(&tile.GetRandom())
+    , m_commitLock(0)
+    , m_typeSitesCount(0)
+    , m_typeSitesValid(false)
+    , m_writtenSites(0)
     , m_center(0,0)
     , m_sym(PSYM_NORMAL)
+    , m_lockDirs(0)
+    , m_behaviorFailed(false)
     , m_ewState(FREE)
+    , m_parkedBlockCount(0)
+    , m_parkedChangeStamp(0)
+    , m_parkedCenterEvents(0)
+    , m_parkedConflicts(0)
+    , m_optimisticCommits(0)
+    , m_optimisticConflicts(0)
+    , m_optimisticDrops(0)
   {
     m_cpli.Shuffle(GetRandom());
 
@@ -499,6 +778,19 @@ namespace MFM {
 
     for (u32 i = 0; i < MAX_CACHES_TO_UPDATE; m_cacheProcessorsLocked[i++] = 0);
 
+    const MDist<R> & md = MDist<R>::get();
+    for (u32 i = 0; i < SITE_COUNT; ++i)
+    {
+      const SPoint & pt = md.GetPoint(i);
+      m_siteOffsets[i] = pt.GetY() * (s32) tile.TILE_WIDTH + pt.GetX();
+    }
+
+    // Owned sites are R..SIDE-R-1, so windows centered at 2R..SIDE-2R-1
+    // stay inside them.
+    m_allLiveMin = 2 * R;
+    m_allLiveMaxX = tile.TILE_WIDTH > 2 * R ? tile.TILE_WIDTH - 2 * R : 0;
+    m_allLiveMaxY = tile.TILE_HEIGHT > 2 * R ? tile.TILE_HEIGHT - 2 * R : 0;
+
   }
 
   template <class EC>
@@ -511,7 +803,13 @@ namespace MFM {
   template <class EC>
   u32 EventWindow<EC>::MapToIndexSymValid(const SPoint & loc, PointSymmetry sym) const
   {
-    return MapToIndexDirectValid(SymMap(loc, sym, SPoint(2*R, 2*R)));
+    const MDist<R> & md = MDist<R>::get();
+    s32 direct = md.FromPoint(loc,R);
+    MFM_API_ASSERT_ARG(direct >= 0);
+    // Symmetries preserve length, so bounding before or after is the same
+    const u32 index = md.GetSymSiteNumber((u32) direct, sym);
+    MFM_API_ASSERT_ARG(index < m_boundedSiteCount);
+    return index;
   }
 
   template <class EC>
@@ -528,15 +826,67 @@ namespace MFM {
   {
     Tile<EC> & tile = GetTile();
 
-    m_centerBase = tile.GetSite(m_center).GetBase();
-    const MDist<R> & md = MDist<R>::get();
+    if (tile.m_foregroundRadiationEnabled)
+    {
+      FAIL(INCOMPLETE_CODE);  // As in Tile::GetAtomForEventWindow
+    }
+
+    const S * centerSite = &tile.GetSite(m_center);
+    const T * centerAtom = &centerSite->GetAtom();
+    m_centerBase = centerSite->GetBase();
+
+    for (u32 i = 0; i < m_boundedSiteCount; ++i)
+    {
+      m_atomBuffer[i].WriteAtom(TileAtomAt(centerSite, centerAtom, i));
+    }
+    InvalidateTypeSites();
+    m_writtenSites = 0;
+
+    if (IsAllLiveCenter(m_center))
+    {
+      for (u32 i = 0; i < m_boundedSiteCount; ++i)
+      {
+        m_isLiveSite[i] = true;
+      }
+    }
+    else
+    {
+      const MDist<R> & md = MDist<R>::get();
+      for (u32 i = 0; i < m_boundedSiteCount; ++i)
+      {
+        m_isLiveSite[i] = tile.IsLiveSite(md.GetPoint(i) + m_center);
+      }
+    }
+  }
+
+  template <class EC>
+  void EventWindow<EC>::BuildTypeSites() const
+  {
+    COMPILATION_REQUIREMENT< SITE_COUNT <= 64 >();
+
+    m_typeSitesCount = 0;
     for (u32 i = 0; i < m_boundedSiteCount; ++i)
     {
-      const SPoint & pt = md.GetPoint(i) + m_center;
-      //m_atomBuffer[i] = tile.GetAtomForEventWindow(pt);
-      m_atomBuffer[i].WriteAtom(tile.GetAtomForEventWindow(pt));
-      m_isLiveSite[i] = tile.IsLiveSite(pt);
+      if (!m_isLiveSite[i])
+      {
+        continue;
+      }
+
+      const u32 type = m_atomBuffer[i].GetAtom().GetType();
+      u32 t = 0;
+      while (t < m_typeSitesCount && m_typeSites[t].m_type != type)
+      {
+        ++t;
+      }
+      if (t == m_typeSitesCount)
+      {
+        m_typeSites[t].m_type = type;
+        m_typeSites[t].m_sites = 0;
+        ++m_typeSitesCount;
+      }
+      m_typeSites[t].m_sites |= ((u64) 1) << i;
     }
+    m_typeSitesValid = true;
   }
 
   template <class EC>
@@ -552,7 +902,12 @@ namespace MFM {
 
     MFM_LOG_DBG6(("EW::StoreToTile %s",tile.GetLabel()));
 
+    // Counts, change stamps and history are tile-wide
+    CommitScope commit(m_commitLock);
+
     // First initialize the cache processors
+    bool caching = false;
+    u64 visible = 0;   // To any of them
     for (m_cpli.ShuffleOrReset(random); m_cpli.HasNext(); )
     {
       u32 i = m_cpli.Next();
@@ -560,39 +915,84 @@ namespace MFM {
       if (m_cacheProcessorsLocked[i])
       {
         m_cacheProcessorsLocked[i]->StartLoading(m_center);
+        visible |= m_cacheProcessorsLocked[i]->GetVisibleSites();
+        caching = true;
       }
     }
 
-    // Record the event in the tile history
+    // Record the event in the tile history as we write it back,
+    // rather than rescanning the whole window for changes
     EventHistoryBuffer<EC> & ehb = tile.GetEventHistoryBuffer();
-    ehb.AddEventWindow(*this);
+    const bool recording = ehb.IsHistoryActive();
+    if (recording)
+    {
+      ehb.AddEventStart(m_center);
+    }
 
-    // Write back base changes if any
-    tile.GetSite(m_center).GetBase() = m_centerBase;
+    const S * centerSite = &tile.GetSite(m_center);
+    const T * centerAtom = &centerSite->GetAtom();
 
-    for (u32 i = 0; i < m_boundedSiteCount; ++i)
+    // Only written sites can differ from the tile.  But the CPs get
+    // to see some unwritten ones too, for spot checks, so visit the
+    // ones their peers can see as well.
+    COMPILATION_REQUIREMENT< SITE_COUNT <= 64 >();
+    const u64 bounded = m_boundedSiteCount >= 64 ?
+      ~((u64) 0) : (((u64) 1) << m_boundedSiteCount) - 1;
+    const u64 written = m_writtenSites & bounded;
+    u64 visit = written | (visible & bounded);
+
+    m_sitesWritten = 0;
+    while (visit)
     {
-      const SPoint & pt = md.GetPoint(i) + m_center;
+      const u32 i = __builtin_ctzll(visit); // GCC
+      visit &= visit - 1;
+
       bool dirty = false;
       if (m_isLiveSite[i])
       {
-        //if (m_atomBuffer[i] != *tile.GetAtom(pt))
-	if (m_atomBuffer[i].GetAtom() != *tile.GetAtom(pt))
+        const T & tileAtom = TileAtomAt(centerSite, centerAtom, i);
+        if ((written & (((u64) 1) << i)) && m_atomBuffer[i].GetAtom() != tileAtom)
         {
-          tile.PlaceAtom(m_atomBuffer[i].GetAtom(), pt);
+          if (recording)
+          {
+            ehb.AddEventAtom(i, tileAtom, m_atomBuffer[i].GetAtom());
+          }
+          tile.PlaceAtom(m_atomBuffer[i].GetAtom(), md.GetPoint(i) + m_center);
           dirty = true;
+          ++m_sitesWritten;
         }
 
         // Let the CPs see even some unchanged atoms, for spot checks
-        for (u32 j = 0; j < MAX_CACHES_TO_UPDATE; ++j)
+        for (u32 j = 0; caching && j < MAX_CACHES_TO_UPDATE; ++j)
         {
           if (m_cacheProcessorsLocked[j] != 0)
           {
-            m_cacheProcessorsLocked[j]->MaybeSendAtom( *tile.GetAtom(pt), dirty, i);
+            m_cacheProcessorsLocked[j]->MaybeSendAtom(tileAtom, dirty, i);
           }
         }
       }
     }
+    m_writtenSites = 0;
+
+    // Write back base changes if any
+    const B & tileBase = centerSite->GetBase();
+    if (recording)
+    {
+      ehb.AddEventBase(tileBase, m_centerBase);
+    }
+    if (!tileBase.Equals(m_centerBase))  // Most events leave it be
+    {
+      if (tileBase.GetBaseAtom() != m_centerBase.GetBaseAtom())
+      {
+        tile.NoteSiteChange(m_center);  // Only atoms are change tracked
+      }
+      tile.GetSite(m_center).GetBase() = m_centerBase;
+    }
+
+    if (recording)
+    {
+      ehb.AddEventEnd();
+    }
 
     MFM_LOG_DBG6(("EW::StoreToTile releasing %s",tile.GetLabel()));
     // Finally, release the cache processors to take it from here
@@ -615,6 +1015,7 @@ namespace MFM {
 
     if (m_isLiveSite[idx])
     {
+      MarkWritten(idx);
       //m_atomBuffer[idx] = atom;
       m_atomBuffer[idx].WriteAtom(atom); //a copy
       return true;
@@ -629,6 +1030,7 @@ namespace MFM {
 
     if (m_isLiveSite[idx])
     {
+      MarkWritten(idx);
       //m_atomBuffer[idx] = atom;
       m_atomBuffer[idx].WriteAtom(atom);
       return true;
@@ -683,6 +1085,8 @@ namespace MFM {
     MFM_API_ASSERT_ARG(idxa < m_boundedSiteCount);
     MFM_API_ASSERT_ARG(idxb < m_boundedSiteCount);
 
+    MarkWritten(idxa);
+    MarkWritten(idxb);
     T tmp = m_atomBuffer[idxa].GetAtom();
     //m_atomBuffer[idxa] = m_atomBuffer[idxb];
     //m_atomBuffer[idxb] = tmp;
@@ -0,0 +1,144 @@
+/*                                              -*- mode:C++ -*-
+  EventWindowBatch.h Several same-element events run through one call
+  Copyright (C) 2020 The Living Computation Foundation.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+  USA
+*/
+
+/**
+  \file EventWindowBatch.h Several same-element events run through one call
+  \author David H. Ackley.
+  \date (C) 2020 All rights reserved.
+  \lgpl
+ */
+#ifndef EVENTWINDOWBATCH_H
+#define EVENTWINDOWBATCH_H
+
+#include "itype.h"
+#include "Point.h"
+#include "EventWindow.h"
+
+namespace MFM
+{
+  template <class EC> class Element; // FORWARD
+
+  /**
+     A batch of event centers, all holding atoms of one Element, whose
+     event windows don't overlap, so the events can run in any order.
+     The tile hands a batch to Element::BatchBehavior, which steps
+     through it with Next, running its behavior on GetWindow() each
+     time Next returns true.  Each call to Next first stores the
+     previous event, if any, back to the tile.
+
+     There is still just the one EventWindow; what a batch saves is
+     the per-event element lookup, the virtual Behavior dispatch and
+     the behavior failure trap, which can outweigh a trivial behavior.
+   */
+  template <class EC>
+  class EventWindowBatch
+  {
+  public:
+    enum { MAX_EVENTS = 16 };
+
+    EventWindowBatch(EventWindow<EC> & window, const Element<EC> & element)
+      : m_window(window)
+      , m_element(element)
+      , m_count(0)
+      , m_next(0)
+      , m_executed(0)
+      , m_inBehavior(false)
+    { }
+
+    /**
+       Add an event at \c center, in tile coordinates.  The caller
+       promises its window overlaps no other in the batch.
+     */
+    void Add(const SPoint & center)
+    {
+      MFM_API_ASSERT_STATE(m_count < MAX_EVENTS);
+      m_centers[m_count++] = center;
+    }
+
+    u32 GetCount() const { return m_count; }
+
+    /** How many of the batch's events have actually started */
+    u32 GetExecuted() const { return m_executed; }
+
+    const Element<EC> & GetElement() const { return m_element; }
+
+    EventWindow<EC> & GetWindow() { return m_window; }
+
+    /**
+       Store the previous event, if any, and set up the next one.
+       \returns false when the batch is used up.  Centers whose locks
+       can't be had are skipped, as TryEventAt would abandon them.
+     */
+    bool Next()
+    {
+      Finish();
+      while (m_next < m_count)
+      {
+        const SPoint & center = m_centers[m_next++];
+        if (!m_window.InitForEvent(center))
+        {
+          continue;
+        }
+
+        m_window.RecordEventAtTileCoord(center);
+        ++m_executed;
+        if (m_window.m_element != &m_element)
+        {
+          // Repaired into something else since it was batched
+          m_window.ExecuteEvent();
+          continue;
+        }
+
+        m_inBehavior = true;
+        return true;
+      }
+      return false;
+    }
+
+    /**
+       Store the current event, if any, back to the tile.  Any
+       centers Next hasn't reached yet are dropped.
+     */
+    void Finish()
+    {
+      m_inBehavior = false;
+      if (!m_window.IsFree())
+      {
+        m_window.GetTile().GetTransientArena().Reset();
+        m_window.InitiateCommunications();
+      }
+    }
+
+    /** true between a successful Next and the following Finish */
+    bool IsInBehavior() const { return m_inBehavior; }
+
+  private:
+    EventWindow<EC> & m_window;
+    const Element<EC> & m_element;
+    SPoint m_centers[MAX_EVENTS];
+    u32 m_count;
+    u32 m_next;
+    u32 m_executed;
+    bool m_inBehavior;
+  };
+
+} /* namespace MFM */
+
+#endif /* EVENTWINDOWBATCH_H */
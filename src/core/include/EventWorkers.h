@@ -0,0 +1,170 @@
+/*                                              -*- mode:C++ -*-
+  EventWorkers.h Several event windows running at once in one tile
+  Copyright (C) 2020 The Living Computation Foundation.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+  USA
+*/
+
+/**
+  \file EventWorkers.h Several event windows running at once in one tile
+  \author David H. Ackley.
+  \date (C) 2020 All rights reserved.
+  \lgpl
+ */
+#ifndef EVENTWORKERS_H
+#define EVENTWORKERS_H
+
+#include <pthread.h>
+#include "itype.h"
+#include "Point.h"
+#include "Random.h"
+#include "Mutex.h"
+#include "TileSiteOwners.h"
+#include "EventWindow.h"
+
+namespace MFM
+{
+  template <class EC> class Tile; // FORWARD
+
+  /**
+     Intra-tile parallelism: a set of helper EventWindows (see
+     EventWindow::MakeHelper) that run a tile's hidden-region events
+     concurrently, so one big tile isn't bounded by one core.
+
+     The tile's thread runs the first helper itself and each of the
+     others has a thread of its own.  They run in rounds: in each,
+     every helper draws EVENTS_PER_ROUND event centers uniformly from
+     the owned sites, as the tile would.  A helper runs an event only
+     if its center is in the hidden region, where no intertile lock is
+     needed, and it can claim the window's footprint in a
+     TileSiteOwners shared by the helpers, so no two of their windows
+     overlap.  Any other draw -- near the tile edge, on a footprint
+     already held, or centered on an UlamElement or an insane or
+     unknown atom -- is deferred to the tile's own window, which runs
+     the deferred events one per AdvanceComputation between rounds,
+     with the usual CacheProcessor locking and communication between
+     them.  So the events still land uniformly, and the intertile
+     protocol is untouched.
+
+     Helpers do their tile bookkeeping (event counts, change stamps,
+     atom counts, history and storing back) holding one commit lock,
+     while their loads and behaviors overlap.
+   */
+  template <class EC>
+  class EventWorkers
+  {
+  public:
+    enum { MAX_WORKERS = 16 };
+    enum { EVENTS_PER_ROUND = 64 };
+
+    /** \c workers helpers for \c tile; FAILs with ILLEGAL_ARGUMENT
+        unless 2..MAX_WORKERS.  Starts workers - 1 threads. */
+    EventWorkers(Tile<EC> & tile, u32 workers) ;
+
+    /** Stops and joins the threads */
+    ~EventWorkers() ;
+
+    u32 GetWorkers() const
+    {
+      return m_workers;
+    }
+
+    /**
+       Run one deferred event on the tile's window if there are any,
+       else a round of helper events.  Called only from the tile's
+       thread, while it's active.  \returns true if any event ran.
+     */
+    bool Advance() ;
+
+    /** Deferred events not yet run on the tile's window */
+    u32 GetDeferredCount() const
+    {
+      return m_deferredCount;
+    }
+
+    /** Events run by helpers, rather than the tile's window */
+    u64 GetHelperEvents() const
+    {
+      return m_helperEvents;
+    }
+
+    /** Bytes held by these helpers, this object included */
+    u64 GetStorageBytes() const
+    {
+      return sizeof(*this) + m_workers * sizeof(Worker) + m_owners.GetStorageBytes();
+    }
+
+  private:
+    typedef typename EC::ATOM_CONFIG AC;
+    typedef typename AC::ATOM_TYPE T;
+    enum { R = EC::EVENT_WINDOW_RADIUS };
+
+    struct Worker
+    {
+      Worker(EventWorkers & owner, Tile<EC> & tile)
+        : m_owner(owner)
+        , m_window(tile)
+        , m_errorStackTop(0)
+        , m_deferredCount(0)
+        , m_executed(0)
+      { }
+
+      EventWorkers & m_owner;
+      EventWindow<EC> m_window;
+      Random m_random;
+      pthread_t m_thread;
+      MFMErrorEnvironmentPointer_t m_errorStackTop;
+      SPoint m_deferred[EVENTS_PER_ROUND];
+      u32 m_deferredCount;
+      u32 m_executed;
+    };
+
+    Tile<EC> & m_tile;
+    const u32 m_workers;
+    Worker * m_worker[MAX_WORKERS];
+    TileSiteOwners m_owners;
+    Mutex m_commitLock;
+
+    pthread_mutex_t m_roundLock;
+    pthread_cond_t m_roundStart;
+    pthread_cond_t m_roundDone;
+    u32 m_round;                // Bumped to start each round
+    u32 m_running;              // Threads yet to finish this round
+    bool m_stopRequested;
+
+    SPoint m_deferred[MAX_WORKERS * EVENTS_PER_ROUND];
+    u32 m_deferredCount;
+    u64 m_helperEvents;
+
+    void RunRound() ;
+
+    /** \c worker's share of a round */
+    void RunShare(Worker & worker) ;
+
+    /** Whether a helper may run the event at claimed \c center */
+    bool IsHelperEvent(const SPoint & center) const ;
+
+    static void * Run(void * arg) ;
+
+    // Declare away
+    EventWorkers(const EventWorkers &) ;
+    EventWorkers & operator=(const EventWorkers &) ;
+  };
+}
+
+#include "EventWorkers.tcc"
+
+#endif /* EVENTWORKERS_H */
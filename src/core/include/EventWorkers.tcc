@@ -0,0 +1,185 @@
+/* -*- C++ -*- */
+#include "Tile.h"
+#include "Element.h"
+#include "Logger.h"
+
+namespace MFM
+{
+  template <class EC>
+  EventWorkers<EC>::EventWorkers(Tile<EC> & tile, u32 workers)
+    : m_tile(tile)
+    , m_workers(workers)
+    , m_owners(tile.TILE_WIDTH, tile.TILE_HEIGHT)
+    , m_round(0)
+    , m_running(0)
+    , m_stopRequested(false)
+    , m_deferredCount(0)
+    , m_helperEvents(0)
+  {
+    MFM_API_ASSERT_ARG(workers >= 2 && workers <= MAX_WORKERS);
+    MFM_API_ASSERT(!pthread_mutex_init(&m_roundLock, NULL), LOCK_FAILURE);
+    MFM_API_ASSERT(!pthread_cond_init(&m_roundStart, NULL), LOCK_FAILURE);
+    MFM_API_ASSERT(!pthread_cond_init(&m_roundDone, NULL), LOCK_FAILURE);
+
+    for (u32 i = 0; i < m_workers; ++i)
+    {
+      Worker * w = new Worker(*this, tile);
+      w->m_random.SetSeed(tile.GetRandom().Create());
+      w->m_window.MakeHelper(w->m_random, m_commitLock);
+      m_worker[i] = w;
+    }
+
+    // The tile's thread is the first worker
+    for (u32 i = 1; i < m_workers; ++i)
+    {
+      MFM_API_ASSERT(!pthread_create(&m_worker[i]->m_thread, NULL, Run, m_worker[i]), LOCK_FAILURE);
+    }
+  }
+
+  template <class EC>
+  EventWorkers<EC>::~EventWorkers()
+  {
+    pthread_mutex_lock(&m_roundLock);
+    m_stopRequested = true;
+    pthread_cond_broadcast(&m_roundStart);
+    pthread_mutex_unlock(&m_roundLock);
+
+    for (u32 i = 1; i < m_workers; ++i)
+    {
+      pthread_join(m_worker[i]->m_thread, NULL);
+    }
+    for (u32 i = 0; i < m_workers; ++i)
+    {
+      delete m_worker[i];
+    }
+
+    pthread_cond_destroy(&m_roundDone);
+    pthread_cond_destroy(&m_roundStart);
+    pthread_mutex_destroy(&m_roundLock);
+  }
+
+  template <class EC>
+  void * EventWorkers<EC>::Run(void * arg)
+  {
+    Worker & w = *(Worker *) arg;
+    EventWorkers & ew = w.m_owner;
+    MFMPtrToErrEnvStackPtr = &w.m_errorStackTop;
+
+    u32 seen = 0;
+    while (true)
+    {
+      pthread_mutex_lock(&ew.m_roundLock);
+      while (ew.m_round == seen && !ew.m_stopRequested)
+      {
+        pthread_cond_wait(&ew.m_roundStart, &ew.m_roundLock);
+      }
+      const bool stop = ew.m_stopRequested;
+      seen = ew.m_round;
+      pthread_mutex_unlock(&ew.m_roundLock);
+
+      if (stop)
+      {
+        break;
+      }
+
+      ew.RunShare(w);
+
+      pthread_mutex_lock(&ew.m_roundLock);
+      if (--ew.m_running == 0)
+      {
+        pthread_cond_signal(&ew.m_roundDone);
+      }
+      pthread_mutex_unlock(&ew.m_roundLock);
+    }
+    return NULL;
+  }
+
+  template <class EC>
+  bool EventWorkers<EC>::Advance()
+  {
+    if (m_deferredCount == 0)
+    {
+      RunRound();
+      if (m_deferredCount == 0)
+      {
+        return true;  // Every draw ran on a helper
+      }
+    }
+
+    const SPoint center = m_deferred[--m_deferredCount];
+    return m_tile.GetEventWindow().TryEventAt(center);
+  }
+
+  template <class EC>
+  void EventWorkers<EC>::RunRound()
+  {
+    pthread_mutex_lock(&m_roundLock);
+    m_running = m_workers - 1;
+    ++m_round;
+    pthread_cond_broadcast(&m_roundStart);
+    pthread_mutex_unlock(&m_roundLock);
+
+    RunShare(*m_worker[0]);
+
+    pthread_mutex_lock(&m_roundLock);
+    while (m_running > 0)
+    {
+      pthread_cond_wait(&m_roundDone, &m_roundLock);
+    }
+    pthread_mutex_unlock(&m_roundLock);
+
+    // Gather up the helpers' results
+    EventWindow<EC> & window = m_tile.GetEventWindow();
+    for (u32 i = 0; i < m_workers; ++i)
+    {
+      Worker & w = *m_worker[i];
+      window.AbsorbCounts(w.m_window);
+      m_helperEvents += w.m_executed;
+      w.m_executed = 0;
+      for (u32 j = 0; j < w.m_deferredCount; ++j)
+      {
+        m_deferred[m_deferredCount++] = w.m_deferred[j];
+      }
+      w.m_deferredCount = 0;
+    }
+  }
+
+  template <class EC>
+  void EventWorkers<EC>::RunShare(Worker & w)
+  {
+    for (u32 i = 0; i < EVENTS_PER_ROUND; ++i)
+    {
+      const SPoint center =
+        Tile<EC>::OwnedCoordToTile(SPoint(w.m_random, m_tile.OWNED_WIDTH, m_tile.OWNED_HEIGHT));
+
+      if (!m_tile.IsInHidden(center) || !m_owners.TryClaim(center, R))
+      {
+        w.m_deferred[w.m_deferredCount++] = center;
+        continue;
+      }
+
+      if (!IsHelperEvent(center))
+      {
+        w.m_deferred[w.m_deferredCount++] = center;
+      }
+      else if (w.m_window.TryEventAt(center))
+      {
+        ++w.m_executed;
+      }
+      m_owners.Release(center, R);
+    }
+  }
+
+  template <class EC>
+  bool EventWorkers<EC>::IsHelperEvent(const SPoint & center) const
+  {
+    // Anything InitForEvent would repair or erase is the tile's to do
+    const T & atom = *m_tile.GetAtom(center);
+    if (!atom.IsSane())
+    {
+      return false;
+    }
+    const Element<EC> * elt = m_tile.GetElementTable().Lookup(atom.GetType());
+    return elt != 0 && elt->AsUlamElement() == 0;
+  }
+}
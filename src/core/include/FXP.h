@@ -183,6 +183,11 @@ namespace MFM {
   s32 fixrsqrt16(s32 a);
   s32 fixsqrt16(s32 a);
 
+  // Table-driven, with no divides or iteration.  For a > 0, within
+  // a relative error of 2^-16, plus one ulp of rounding, of the exact
+  // root; s32 inputs <= 0 give 0.
+  s32 fixsqrt16fast(s32 a);
+
   // The template argument p in all of the following functions refers to the
   // fixed point precision (e.g. p = 8 gives 24.8 fixed point functions).
 
@@ -287,6 +292,9 @@ namespace MFM {
   template <int p>
   inline FXP<p> Inv(FXP<p> a);
 
+  template <int p>
+  inline FXP<p> FastSqrt(FXP<p> a);
+
   template <int p>
   inline FXP<p> Abs(FXP<p> a)
   {
@@ -338,6 +346,66 @@ namespace MFM {
     return r;
   }
 
+  template <>
+  inline FXP<16> FastSqrt(FXP<16> a)
+  {
+    FXP<16> r;
+    r.intValue = fixsqrt16fast(a.intValue);
+    return r;
+  }
+
+  // Batch forms, for elements doing the same math over many sites:
+  // out[i] = op(a[i], b[i]) for 0 <= i < count.  The loops are
+  // branch-free over plain arrays so the compiler can vectorize them.
+  // out may be a or b, but must not otherwise overlap them.
+
+  template <int p>
+  inline void AddBatch(const FXP<p> * a, const FXP<p> * b, FXP<p> * out, u32 count)
+  {
+    for (u32 i = 0; i < count; ++i)
+      out[i].intValue = a[i].intValue + b[i].intValue;
+  }
+
+  template <int p>
+  inline void SubBatch(const FXP<p> * a, const FXP<p> * b, FXP<p> * out, u32 count)
+  {
+    for (u32 i = 0; i < count; ++i)
+      out[i].intValue = a[i].intValue - b[i].intValue;
+  }
+
+  template <int p>
+  inline void MulBatch(const FXP<p> * a, const FXP<p> * b, FXP<p> * out, u32 count)
+  {
+    for (u32 i = 0; i < count; ++i)
+      out[i].intValue = fixmul<p>(a[i].intValue, b[i].intValue);
+  }
+
+  // out[i] = a[i] * b
+  template <int p>
+  inline void MulBatch(const FXP<p> * a, FXP<p> b, FXP<p> * out, u32 count)
+  {
+    for (u32 i = 0; i < count; ++i)
+      out[i].intValue = fixmul<p>(a[i].intValue, b.intValue);
+  }
+
+  template <int p>
+  inline void DivBatch(const FXP<p> * a, const FXP<p> * b, FXP<p> * out, u32 count)
+  {
+    for (u32 i = 0; i < count; ++i)
+      out[i].intValue = fixdiv<p>(a[i].intValue, b[i].intValue);
+  }
+
+  // As FastSqrt, elementwise
+  void SqrtBatch(const FXP16 * a, FXP16 * out, u32 count);
+
+  // As Sin and Cos, using the same quarter-wave table: absolute error
+  // at most 2^-9 at any angle, mostly from quantizing the angle to
+  // 1/4096 of a turn.  A finer range reduction than Sin and Cos use
+  // keeps large angles within that bound too, and any angle, however
+  // negative, costs the same.
+  void SinBatch(const FXP16 * a, FXP16 * out, u32 count);
+  void CosBatch(const FXP16 * a, FXP16 * out, u32 count);
+
   // The multiply accumulate case can be optimized.
   template <int p>
   inline FXP<p> multiply_accumulate(
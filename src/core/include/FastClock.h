@@ -0,0 +1,156 @@
+/*                                              -*- mode:C++ -*-
+  FastClock.h Cheap calibrated monotonic and wall clock reads
+  Copyright (C) 2014-2016 The Regents of the University of New Mexico.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+  USA
+*/
+
+/**
+  \file FastClock.h Cheap calibrated monotonic and wall clock reads
+  \date (C) 2014-2016 All rights reserved.
+  \lgpl
+ */
+#ifndef FASTCLOCK_H
+#define FASTCLOCK_H
+
+#include "itype.h"
+#include <time.h>  /* For struct timespec, clock_gettime */
+
+namespace MFM
+{
+  /**
+     FastClock stands in for clock_gettime in loops that read the time
+     constantly, such as tile drivers advancing their transceivers
+     and the T2 time queue.  Where the CPU has a counter that runs at
+     a constant rate on every core -- the invariant TSC on x86, the
+     generic timer on ARM64 -- it reads that and scales it by a rate
+     calibrated (or, on ARM64, read) once, at first use.  Otherwise,
+     or after SetCounterEnabled(false), it calls clock_gettime.
+
+     The wall clock is the counter plus an offset taken from
+     CLOCK_REALTIME, refreshed about once a second, so NTP steps and
+     slews show up within a second.
+   */
+  class FastClock
+  {
+  public:
+    /** Read the monotonic clock into \a ts, as CLOCK_MONOTONIC would */
+    static void Monotonic(struct timespec & ts)
+    {
+      ToTimespec(MonotonicNanos(), ts);
+    }
+
+    /** Read the wall clock into \a ts, as CLOCK_REALTIME would */
+    static void Realtime(struct timespec & ts)
+    {
+      ToTimespec(RealtimeNanos(), ts);
+    }
+
+    /** Nanoseconds on the monotonic clock */
+    static u64 MonotonicNanos()
+    {
+      if (!IsCounterInUse())
+      {
+        return ReadSystemNanos(CLOCK_MONOTONIC);
+      }
+      s64 ticks = (s64) (ReadCounter() - m_state.m_baseTicks);
+      if (ticks < 0)
+      {
+        ticks = 0;  // A core a hair behind the one that calibrated
+      }
+      return m_state.m_baseNanos + (u64) (ticks * m_state.m_nanosPerTick);
+    }
+
+    /** Nanoseconds since the epoch on the wall clock */
+    static u64 RealtimeNanos() ;
+
+    /**
+       True if reads come from the CPU counter rather than
+       clock_gettime.  Calibrates on first call.
+     */
+    static bool IsCounterInUse()
+    {
+      if (!__atomic_load_n(&m_state.m_initted, __ATOMIC_ACQUIRE))
+      {
+        Init();
+      }
+      return m_state.m_useCounter;
+    }
+
+    /**
+       Use the CPU counter if \a enabled and it's usable here, else
+       clock_gettime.  Not for use while other threads read the clock.
+     */
+    static void SetCounterEnabled(bool enabled) ;
+
+    /** Counter ticks per second, or 0 if there is no usable counter */
+    static u64 GetCounterHz()
+    {
+      IsCounterInUse();
+      return m_state.m_counterHz;
+    }
+
+    /** The raw CPU counter, or 0 where there is none */
+    static u64 ReadCounter()
+    {
+#if defined(__i386__) || defined(__x86_64__)
+      return __builtin_ia32_rdtsc();
+#elif defined(__aarch64__)
+      u64 ticks;
+      __asm__ __volatile__("mrs %0, cntvct_el0" : "=r" (ticks));
+      return ticks;
+#else
+      return 0;
+#endif
+    }
+
+    static u64 ReadSystemNanos(clockid_t which)
+    {
+      struct timespec ts;
+      clock_gettime(which, &ts);
+      return ((u64) ts.tv_sec) * 1000000000 + ts.tv_nsec;
+    }
+
+    /** Calibration results and the wall clock offset; see FastClock.cpp */
+    struct State
+    {
+      bool m_initted;
+      bool m_useCounter;
+      u64 m_counterHz;
+      double m_nanosPerTick;
+      u64 m_baseTicks;           // Counter at calibration
+      u64 m_baseNanos;           // CLOCK_MONOTONIC at m_baseTicks
+      u64 m_realtimeOffset;      // CLOCK_REALTIME - monotonic, as of...
+      u64 m_realtimeAnchor;      // ...this monotonic time
+    };
+
+  private:
+    static State m_state;
+
+    /** Calibrate, once, whichever thread asks first */
+    static void Init() ;
+
+    static void CalibrateOnce() ;
+
+    static void ToTimespec(u64 nanos, struct timespec & ts)
+    {
+      ts.tv_sec = (time_t) (nanos / 1000000000);
+      ts.tv_nsec = (long) (nanos % 1000000000);
+    }
+  };
+} /* namespace MFM */
+
+#endif /* FASTCLOCK_H */
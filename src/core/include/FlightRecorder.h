@@ -0,0 +1,142 @@
+/*                                              -*- mode:C++ -*-
+  FlightRecorder.h An always-on ring of a tile's most recent events
+  Copyright (C) 2014 The Regents of the University of New Mexico.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+  USA
+*/
+
+/**
+  \file FlightRecorder.h An always-on ring of a tile's most recent events
+  \lgpl
+ */
+#ifndef FLIGHTRECORDER_H
+#define FLIGHTRECORDER_H
+
+#include "itype.h"
+#include "Point.h"
+
+namespace MFM
+{
+  /**
+     What a tile was doing just before it died.  Each tile keeps the
+     last RECORDS events it ran -- center, element type, the
+     directions it locked, a timestamp (see ReadEventTimestamp), and
+     how far it got -- in a fixed ring written with plain stores, so
+     it can stay on where an EventHistoryBuffer couldn't.
+
+     Every recorder is on one global list, and DumpAll writes them
+     all out, using nothing a signal handler can't; after
+     InstallCrashHandlers it runs by itself when the process aborts
+     (as an uncaught FAIL does) or faults.
+   */
+  class FlightRecorder
+  {
+  public:
+    enum {
+      RECORDS_SHIFT = 8,
+      RECORDS = 1 << RECORDS_SHIFT,
+      LABEL_BYTES = 16
+    };
+
+    /** How far an event got */
+    enum Outcome {
+      BEHAVING,  // Died in behave(), if this is the last word
+      STORING,   // Behaved, writing back to the tile
+      DONE,
+      FAILED     // behave() FAILed; the center was erased and stored
+    };
+
+    struct Record
+    {
+      u64 m_stamp;
+      u16 m_x;                  // Center, in tile coordinates
+      u16 m_y;
+      u16 m_type;               // Of the center atom, before behave()
+      u8 m_lockDirs;            // A bit per Dir
+      u8 m_outcome;             // An Outcome
+    };
+
+    FlightRecorder() ;
+
+    ~FlightRecorder() ;
+
+    /** Name the records' tile in dumps */
+    void SetLabel(const char * label) ;
+
+    /**
+       Start recording an event.  Tile-side; the returned record stays
+       this event's until RECORDS more have begun.
+     */
+    Record & Begin(const SPoint & center, u32 type, u32 lockDirs, u64 stamp)
+    {
+      // Relaxed, since a tile with event workers may begin several at once
+      const u32 n = __atomic_fetch_add(&m_begun, 1, __ATOMIC_RELAXED);
+      Record & r = m_records[n & (RECORDS - 1)];
+      r.m_stamp = stamp;
+      r.m_x = (u16) center.GetX();
+      r.m_y = (u16) center.GetY();
+      r.m_type = (u16) type;
+      r.m_lockDirs = (u8) lockDirs;
+      r.m_outcome = BEHAVING;
+      return r;
+    }
+
+    /** Events ever begun here */
+    u32 GetBegun() const
+    {
+      return __atomic_load_n(&m_begun, __ATOMIC_RELAXED);
+    }
+
+    /**
+       The \c age'th most recent record (0 is the newest); only
+       meaningful for \c age less than RECORDS and GetBegun().
+     */
+    const Record & GetRecent(u32 age) const
+    {
+      return m_records[(GetBegun() - 1 - age) & (RECORDS - 1)];
+    }
+
+    /** Write this ring to \c fd, oldest record first.  Signal safe. */
+    void Dump(int fd) const ;
+
+    /** Dump every recorder there is to \c fd.  Signal safe. */
+    static void DumpAll(int fd) ;
+
+    /**
+       Dump all recorders to stderr when a SIGABRT, SIGSEGV, SIGBUS,
+       SIGILL or SIGFPE arrives, then let the signal do what it
+       would have.
+     */
+    static void InstallCrashHandlers() ;
+
+    static const char * GetOutcomeName(u32 outcome) ;
+
+  private:
+    Record m_records[RECORDS];
+    u32 m_begun;
+    char m_label[LABEL_BYTES];
+    FlightRecorder * m_next;    // On the global list
+    FlightRecorder * m_prev;
+
+    static void HandleCrash(int sig) ;
+
+    // Declare away
+    FlightRecorder(const FlightRecorder &) ;
+    FlightRecorder & operator=(const FlightRecorder &) ;
+  };
+}
+
+#endif /* FLIGHTRECORDER_H */
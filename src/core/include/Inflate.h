@@ -0,0 +1,69 @@
+/*                                              -*- mode:C++ -*-
+  Inflate.h Decompressing raw DEFLATE streams
+  Copyright (C) 2020 The Living Computation Foundation.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+  USA
+*/
+
+/**
+  \file Inflate.h Decompressing raw DEFLATE streams
+  \lgpl
+ */
+#ifndef INFLATE_H
+#define INFLATE_H
+
+#include "itype.h"
+
+namespace MFM
+{
+  /**
+     Decompresses raw DEFLATE (RFC 1951) streams -- stored, fixed
+     Huffman and dynamic Huffman blocks -- as zip archives, and so
+     .mfz bundles, hold their members, and computes the zip CRC-32
+     to check what came out.  It only decodes, into a buffer the
+     caller sizes from the archive's directory, and keeps no state
+     between calls.
+   */
+  class Inflate
+  {
+  public:
+    enum {
+      MAX_BITS = 15,            // Longest Huffman code
+      MAX_LENGTH_CODES = 288,   // Literal/length alphabet
+      MAX_DISTANCE_CODES = 30,
+      WINDOW_BYTES = 32768      // Furthest back reference
+    };
+
+    /**
+       Decompress the raw DEFLATE stream of \c packedBytes bytes at \c
+       packed, which must come out to exactly \c rawBytes bytes, into
+       \c raw.  Never reads or writes out of bounds, however \c packed
+       was damaged.
+
+       \returns false if \c packed isn't a well-formed stream of \c
+       rawBytes bytes; then \c raw holds garbage
+     */
+    static bool Decompress(const u8 * packed, u32 packedBytes, u8 * raw, u32 rawBytes) ;
+
+    /**
+       Continue the CRC-32 (as zip, gzip and PNG use it) \c crc, which
+       starts at 0, over the \c length bytes at \c bytes.
+     */
+    static u32 CRC32(u32 crc, const u8 * bytes, u32 length) ;
+  };
+}
+
+#endif /* INFLATE_H */
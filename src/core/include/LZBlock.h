@@ -0,0 +1,82 @@
+/*                                              -*- mode:C++ -*-
+  LZBlock.h Fast LZ77 compression of independent blocks
+  Copyright (C) 2014 The Regents of the University of New Mexico.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+  USA
+*/
+
+/**
+  \file LZBlock.h Fast LZ77 compression of independent blocks
+  \lgpl
+ */
+#ifndef LZBLOCK_H
+#define LZBLOCK_H
+
+#include "itype.h"
+
+namespace MFM
+{
+  /**
+     Compresses and decompresses self-contained blocks of bytes, in
+     the LZ4 block format: runs of literal bytes alternating with
+     back references of at least four bytes, up to 64KB back, found
+     through a small hash table of recent positions.  It's built for
+     speed over ratio -- a block of mostly empty or repeated atoms
+     shrinks a lot, and quickly -- and holds no state between blocks,
+     so blocks can be compressed on separate threads and restored one
+     at a time.
+   */
+  class LZBlock
+  {
+  public:
+    enum {
+      HASH_BITS = 12,           // 16KB of hash table, on the stack
+      MIN_MATCH = 4,
+      MAX_OFFSET = 0xffff,
+      LAST_LITERALS = 5,        // Every block ends with this many literals,
+      MATCH_LIMIT = 12          // and no match starts closer to its end
+    };
+
+    /**
+       The most bytes compressing \c rawBytes bytes can take, however
+       incompressible they are.
+     */
+    static u32 GetMaxCompressedBytes(u32 rawBytes)
+    {
+      return rawBytes + rawBytes / 255 + 16;
+    }
+
+    /**
+       Compress the \c rawBytes bytes at \c raw into \c packed, which
+       must have room for GetMaxCompressedBytes(rawBytes).
+
+       \returns the number of compressed bytes
+     */
+    static u32 Compress(const u8 * raw, u32 rawBytes, u8 * packed) ;
+
+    /**
+       Decompress the \c packedBytes bytes at \c packed, which must
+       come out to exactly \c rawBytes bytes, into \c raw.  Never
+       reads or writes out of bounds, however \c packed was damaged.
+
+       \returns false if \c packed isn't a well-formed block of \c
+       rawBytes bytes; then \c raw holds garbage
+     */
+    static bool Decompress(const u8 * packed, u32 packedBytes, u8 * raw, u32 rawBytes) ;
+  };
+}
+
+#endif /* LZBLOCK_H */
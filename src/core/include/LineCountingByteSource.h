@@ -251,6 +251,33 @@ namespace MFM
       return byte;
     }
 
+    virtual u32 ReadBytes(u8 * buf, u32 len)
+    {
+      MFM_API_ASSERT_NONNULL(m_bs);
+
+      bool reread = IsUnread(*m_bs);
+
+      u32 got = m_bs->ReadBytes(buf, len);
+
+      if (!reread)  // Only update stats on new reads
+      {
+        for (u32 i = 0; i < got; ++i)
+        {
+          if (buf[i] == '\n')
+          {
+            ++m_lineNum;
+            m_prevLineBytes = m_byteNum;
+            m_byteNum = 0;
+          }
+          else
+          {
+            ++m_byteNum;
+          }
+        }
+      }
+      return got;
+    }
+
    private:
     ByteSource * m_bs;
     ByteSink * m_errs;
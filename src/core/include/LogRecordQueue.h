@@ -0,0 +1,102 @@
+/*                                              -*- mode:C++ -*-
+  LogRecordQueue.h Bounded lock-free queue of formatted log records
+  Copyright (C) 2020 The Living Computation Foundation.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+  USA
+*/
+
+/**
+  \file LogRecordQueue.h Bounded lock-free queue of formatted log records
+  \author David H. Ackley.
+  \date (C) 2020 All rights reserved.
+  \lgpl
+ */
+
+#ifndef LOGRECORDQUEUE_H
+#define LOGRECORDQUEUE_H
+
+#include "itype.h"
+
+namespace MFM
+{
+  /**
+     A fixed ring of RECORD_COUNT log records that any number of
+     threads may Push onto without taking a lock, and that one thread
+     at a time (whoever holds the Logger's lock) may Pop from.  Each
+     slot carries a sequence number saying whether it is free for the
+     next Push or holds a finished record for the next Pop, so a
+     pusher only needs one compare-and-swap to claim a slot.
+
+     When the ring is full, Push drops the record rather than waiting,
+     and counts it; see GetDroppedCount().
+   */
+  class LogRecordQueue
+  {
+  public:
+    enum {
+      RECORD_COUNT = 1024,  // Must be a power of two
+      TEXT_BYTES = 256
+    };
+
+    struct Record
+    {
+      volatile u32 m_sequence;
+      u8 m_level;
+      u8 m_includeFlags;
+      u16 m_length;
+      char m_text[TEXT_BYTES];
+    };
+
+    LogRecordQueue() ;
+
+    /**
+       Copy the first (up to TEXT_BYTES) \c length bytes of \c text
+       into a new record.  Safe to call from any thread.
+
+       \returns false if the queue was full and the record was dropped
+     */
+    bool Push(u32 level, u32 includeFlags, const char * text, u32 length) ;
+
+    /**
+       \returns the oldest finished record, or 0 if there is none.  It
+       stays in the queue until Pop().  Consumer only.
+     */
+    const Record * Front() const ;
+
+    /**
+       Release the record last returned by Front().  Consumer only.
+     */
+    void Pop() ;
+
+    /** How many records Push has dropped since construction */
+    u32 GetDroppedCount() const
+    {
+      return m_dropped;
+    }
+
+  private:
+    Record m_records[RECORD_COUNT];
+    volatile u32 m_enqueuePos;
+    u32 m_dequeuePos;
+    volatile u32 m_dropped;
+
+    // Declare away; the records are not copyable
+    LogRecordQueue(const LogRecordQueue &) ;
+    LogRecordQueue & operator=(const LogRecordQueue &) ;
+  };
+}
+
+#endif /* LOGRECORDQUEUE_H */
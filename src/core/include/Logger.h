@@ -33,6 +33,8 @@
 #include "ByteSerializable.h"
 #include "Util.h"
 #include "Mutex.h"
+#include "LogRecordQueue.h"
+#include <pthread.h>
 #include <stdarg.h>
 #include <strings.h> /* for strcasecmp */
 #include <stdlib.h>  /* for abort(), strtol() */
@@ -265,6 +267,7 @@ namespace MFM
      */
     ByteSink * SetByteSink(ByteSink & byteSink)
     {
+      Flush();  // Queued records belong to the old sink
       ByteSink * old = m_sink;
       m_sink = &byteSink;
       return old;
@@ -293,12 +296,54 @@ namespace MFM
       m_sink(&sink),
       m_logLevel(initialLevel),
       m_includeFlags(INCLUDE_ALL),
-      m_timeStamper(&m_defaultTimeStamper)
+      m_timeStamper(&m_defaultTimeStamper),
+      m_queue(0),
+      m_droppedReported(0),
+      m_writerExiting(false)
     {
     }
 
     ~Logger()
     {
+      SetAsync(false);
+    }
+
+    /**
+     * Start or stop logging asynchronously.  While asynchronous,
+     * messages below ERROR are formatted on the caller's thread into
+     * a bounded lock-free queue, and a background writer thread
+     * prints them (with their timestamps) to the ByteSink, so logging
+     * threads don't wait on each other or on the sink.  If the queue
+     * fills, messages are dropped and counted, and the writer notes
+     * how many.  ERROR messages, Log(Level,ByteSource&), and
+     * SetByteSink() drain the queue before proceeding, so output
+     * order is kept.  Stopping drains the queue.  Call this only while
+     * no other thread is logging.
+     */
+    void SetAsync(bool async) ;
+
+    bool IsAsync() const
+    {
+      return m_queue != 0;
+    }
+
+    /**
+     * Print everything queued so far, if logging asynchronously.
+     */
+    void Flush()
+    {
+      if (!m_queue) return;
+      Mutex::ScopeLock lock(m_mutex);
+      DrainQueue();
+    }
+
+    /**
+     * How many messages have been dropped because the asynchronous
+     * queue was full
+     */
+    u32 GetDroppedCount() const
+    {
+      return m_queue ? m_queue->GetDroppedCount() : 0;
     }
 
     /**
@@ -349,6 +394,7 @@ namespace MFM
       if (IfLog(level))
       {
         Mutex::ScopeLock lock(m_mutex); // Hold lock for this block
+        DrainQueue();
         unwind_protect(
         {
           abort(); // Logger is not prepared to handle failures during printing!
@@ -380,7 +426,14 @@ namespace MFM
     {
       if (IfLog(level))
       {
+        if (m_queue && level > ERROR)
+        {
+          Enqueue(level, format, ap);
+          return;
+        }
+
         Mutex::ScopeLock lock(m_mutex); // Hold lock for this block
+        DrainQueue();
         unwind_protect(
         {
           abort(); // Logger is not prepared to handle failures during printing!
@@ -488,6 +541,7 @@ namespace MFM
      */
     void SetTimeStamper(ByteSerializable * stamper)
     {
+      Flush();
       m_timeStamper = stamper? stamper : &m_defaultTimeStamper;
       m_defaultTimeStamper.Reset();
     }
@@ -524,6 +578,38 @@ namespace MFM
     } m_defaultTimeStamper;
     ByteSerializable * m_timeStamper;
 
+    /**
+     * While logging asynchronously, the queue of formatted records
+     * awaiting the writer thread, else 0
+     */
+    LogRecordQueue * m_queue;
+    u32 m_droppedReported;
+
+    pthread_t m_writer;
+    pthread_mutex_t m_writerLock;
+    pthread_cond_t m_writerWake;
+    volatile bool m_writerExiting;
+    MFMErrorEnvironmentPointer_t m_writerErrorStackTop;
+
+    enum { WRITER_WAIT_USEC = 20000 };
+
+    /**
+     * Format \c format and \c ap on this thread and queue the result
+     * for the writer.  Doesn't lock.
+     */
+    void Enqueue(Level level, const char * format, va_list & ap) ;
+
+    /**
+     * Print and release all queued records.  Caller holds m_mutex.
+     */
+    void DrainQueue() ;
+
+    static void * WriterRunner(void * arg) ;
+
+    // Declare away; the sink and writer thread are not copyable
+    Logger(const Logger &) ;
+    Logger & operator=(const Logger &) ;
+
   };
 
   extern Logger LOG;
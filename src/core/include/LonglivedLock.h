@@ -30,21 +30,30 @@
 
 #include "itype.h"
 #include "Fail.h"
-#include "Mutex.h"
 #include "Logger.h"
 
 namespace MFM
 {
   /**
    * An LonglivedLock mediates long-duration locking between a set of
-   * possible owners
+   * possible owners.
+   *
+   * Ownership is claimed and released by a single compare-and-swap
+   * on the owner pointer, so uncontended acquires and releases never
+   * touch a pthread mutex.  Attempt and contention counts are kept
+   * (also atomically) for reporting.
    */
   class LonglivedLock
   {
   private:
-    Mutex m_shortLivedLock;
-    void * m_longlivedLockOwner;
-    void * m_lastLonglivedLockOwner;
+    void * volatile m_longlivedLockOwner;
+    void * volatile m_lastLonglivedLockOwner;
+
+    /** Total TryLock calls */
+    volatile u32 m_lockAttempts;
+
+    /** TryLock calls that found the lock held by somebody else */
+    volatile u32 m_lockContended;
 
     enum ThreeWayResult { RESULT_TRUE, RESULT_FALSE, RESULT_FAIL };
 
@@ -63,30 +72,29 @@ namespace MFM
 
     ThreeWayResult TryLockInternal(void * arg)
     {
-      Mutex::ScopeLock scopeLock(m_shortLivedLock);
+      __sync_fetch_and_add(&m_lockAttempts, 1);
+
+      void * was = __sync_val_compare_and_swap(&m_longlivedLockOwner, (void *) 0, arg);
 
-      if (m_longlivedLockOwner == 0)
+      if (was == 0)
       {
-        m_longlivedLockOwner = arg;
-        m_lastLonglivedLockOwner = m_longlivedLockOwner;
+        m_lastLonglivedLockOwner = arg;
         return RESULT_TRUE;
       }
 
-      if (m_longlivedLockOwner == arg)
+      if (was == arg)
       {
         return RESULT_FAIL;
       }
 
+      __sync_fetch_and_add(&m_lockContended, 1);
       return RESULT_FALSE;
     }
 
     ThreeWayResult UnlockInternal(void * arg)
     {
-      Mutex::ScopeLock scopeLock(m_shortLivedLock);
-
-      if (m_longlivedLockOwner == arg)
+      if (__sync_bool_compare_and_swap(&m_longlivedLockOwner, arg, (void *) 0))
       {
-        m_longlivedLockOwner = 0;
         return RESULT_TRUE;
       }
 
@@ -100,6 +108,9 @@ namespace MFM
      */
     LonglivedLock()
       : m_longlivedLockOwner(0)
+      , m_lastLonglivedLockOwner(0)
+      , m_lockAttempts(0)
+      , m_lockContended(0)
     { }
 
     /**
@@ -117,7 +128,7 @@ namespace MFM
      */
     void * GetOwnerIndex()
     {
-      Mutex::ScopeLock scopeLock(m_shortLivedLock);
+      __sync_synchronize();
       return m_longlivedLockOwner;
     }
 
@@ -139,7 +150,7 @@ namespace MFM
      * Atomically check and possibly update the long-lived lock as
      * follows: If the lock is currently held by ownerIndex, unlock
      * the long-lived lock and return true.  Otherwise do not change
-     * the channel state and return false.
+     * the channel state and FAIL with LOCK_FAILURE.
      */
     bool Unlock(void * who)
     {
@@ -147,6 +158,35 @@ namespace MFM
       MFM_API_ASSERT(who != (void*) (intptr_t) -1,ILLEGAL_ARGUMENT);
       return DecodeResult(UnlockInternal(who));
     }
+
+    /**
+     * Get the number of TryLock calls made on this lock.  Advisory,
+     * like GetOwnerIndex().
+     */
+    u32 GetLockAttempts() const
+    {
+      return m_lockAttempts;
+    }
+
+    /**
+     * Get the number of TryLock calls that returned false because the
+     * lock was held by another owner.  Advisory, like
+     * GetOwnerIndex().
+     */
+    u32 GetLockContended() const
+    {
+      return m_lockContended;
+    }
+
+    /**
+     * Zero the attempt and contention counts.
+     */
+    void ResetLockCounts()
+    {
+      m_lockAttempts = 0;
+      m_lockContended = 0;
+      __sync_synchronize();
+    }
   };
 }
 
@@ -34,6 +34,8 @@
 #include "Point.h"
 #include "Random.h"
 #include "Dirs.h"
+#include "PSym.h"
+#include "MDistTables.h"
 
 namespace MFM
 {
@@ -64,12 +66,16 @@ namespace MFM
   /**
    * A singleton class consisting of many utilities used for
    * calculating Many-kinds-of Distances, including Manhattan distance
-   * and euclidean squared distance.
+   * and euclidean squared distance.  Its tables are precompiled into
+   * MDistTables.h by tools/MakeMDistTables, so they are constant
+   * from before startup and the singleton itself holds nothing.
    */
   template <u32 R>
   class MDist
   {
   private:
+    typedef MDistTables<R> TABLES;
+
     MDist(const MDist &) ;  // Singleton: Declare away copy ctor
     MDist & operator=(const MDist &) ; // Don't want this either
 
@@ -96,6 +102,21 @@ namespace MFM
      */
     void FillRandomSingleDir(SPoint& pt,Random & random) const;
 
+    /**
+     * Gets the site number of the Von Neumann unit vector that
+     * FillRandomSingleDir fills in for a draw of \c dir, by table
+     * lookup.  \c dir ^ 1 is always the opposite direction.
+     *
+     * @param dir A random.Create(4) draw, 0..3
+     */
+    u32 GetSingleDirSiteNumber(u32 dir) const
+    {
+      static const s32 DX[4] = {  0, 0, -1, 1 };
+      static const s32 DY[4] = { -1, 1,  0, 0 };
+      MFM_API_ASSERT_ARG(dir < 4);
+      return (u32) TABLES::POINT_TO_INDEX[R + DX[dir]][R + DY[dir]];
+    }
+
     /**
      * Gets the area of a Manhattan Distance circle of a given radius .
      *
@@ -114,8 +135,8 @@ namespace MFM
      */
     u32 GetFirstIndex(const u32 radius) const
     {
-      MFM_API_ASSERT_ARG(radius < sizeof(m_firstIndex)/sizeof(m_firstIndex[0]));
-      return m_firstIndex[radius];
+      MFM_API_ASSERT_ARG(radius < sizeof(TABLES::FIRST_INDEX)/sizeof(TABLES::FIRST_INDEX[0]));
+      return TABLES::FIRST_INDEX[radius];
     }
 
     /**
@@ -141,10 +162,10 @@ namespace MFM
      */
     u32 GetFirstESLIndex(const u32 eslRadius) const
     {
-      for (u32 i = 0; i < sizeof(m_firstESLValue)/sizeof(m_firstESLValue[0]); ++i)
+      for (u32 i = 0; i < sizeof(TABLES::FIRST_ESL_VALUE)/sizeof(TABLES::FIRST_ESL_VALUE[0]); ++i)
       {
-        if (m_firstESLValue[i] >= eslRadius)
-          return m_firstESLIndex[i];
+        if (TABLES::FIRST_ESL_VALUE[i] >= eslRadius)
+          return TABLES::FIRST_ESL_INDEX[i];
       }
       FAIL(UNREACHABLE_CODE);
     }
@@ -179,10 +200,11 @@ namespace MFM
        \sa GetSiteNumber
        \sa FromPoint
      */
-    const SPoint & GetPoint(const u32 siteNumber) const
+    SPoint GetPoint(const u32 siteNumber) const
     {
       MFM_API_ASSERT_ARG(siteNumber < ARRAY_LENGTH);
-      return m_indexToPoint[siteNumber];
+      return SPoint(TABLES::INDEX_TO_POINT[siteNumber][0],
+                    TABLES::INDEX_TO_POINT[siteNumber][1]);
     }
 
     /**
@@ -203,7 +225,7 @@ namespace MFM
     s32 GetSiteNumberFromRasterIndex(const u32 index) const
     {
       if (index >= ARRAY_LENGTH) return -1;
-      return m_rasterToSiteNum[index];
+      return TABLES::RASTER_TO_SITE_NUM[index];
     }
 
     /**
@@ -214,7 +236,22 @@ namespace MFM
     s32 GetRasterIndexFromSiteNumber(const u32 sitenum) const
     {
       if (sitenum >= ARRAY_LENGTH) return -1;
-      return m_siteNumToRaster[sitenum];
+      return TABLES::SITE_NUM_TO_RASTER[sitenum];
+    }
+
+    /**
+       Get the site number that \c siteNumber maps to under \c psym,
+       i.e., GetSiteNumber(SymMap(GetPoint(siteNumber), psym)), by a
+       single table lookup.  Symmetries preserve distance, so the
+       result is at the same Manhattan length as \c siteNumber.
+
+       \fails ILLEGAL_ARGUMENT if siteNumber is greater than or equal
+       to ARRAY_LENGTH, or psym is not a legal PointSymmetry
+     */
+    u32 GetSymSiteNumber(const u32 siteNumber, const PointSymmetry psym) const
+    {
+      MFM_API_ASSERT_ARG(siteNumber < ARRAY_LENGTH && (u32) psym < PSYM_SYMMETRY_COUNT);
+      return TABLES::SYM_SITE_NUM[psym][siteNumber];
     }
 
     /**
@@ -229,7 +266,7 @@ namespace MFM
      */
     void FillFromBits(SPoint& pt, u8 bits, u32 maxRadius) const;
 
-    MDist();
+    MDist() { }
 
   private:
     static const u32 ARRAY_LENGTH = EVENT_WINDOW_SITES(R);
@@ -238,28 +275,6 @@ namespace MFM
     {
       return EVENT_WINDOW_SITES(maxDistance);
     }
-
-    void InitRasterTables();
-    u8 m_rasterToSiteNum[ARRAY_LENGTH];
-    u8 m_siteNumToRaster[ARRAY_LENGTH];
-
-    void InitESLTables();
-    u8 m_siteNumToESLNum[ARRAY_LENGTH];
-    u8 m_eSLNumToSiteNum[ARRAY_LENGTH];
-    u8 m_firstESLValue[2*R+2];  // cutoff distances for ESL rings
-    u8 m_firstESLIndex[2*R+2];
-
-    Point<s32> m_indexToPoint[ARRAY_LENGTH];
-    s32 m_pointToIndex[EVENT_WINDOW_DIAMETER][EVENT_WINDOW_DIAMETER];
-
-    u32 m_firstIndex[R+2];  // m_firstIndex[R+1] holds 'lastIndex[R]'
-
-    void InitEscapesByDirTable();
-    u8 m_escapesByDirection[Dirs::DIR_COUNT][ARRAY_LENGTH];
-
-    void InitHorizonsByDirTable();
-    u8 m_horizonsByDirection[Dirs::DIR_COUNT][ARRAY_LENGTH];
-
   };
 
   template <u32 R>
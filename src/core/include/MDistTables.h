@@ -0,0 +1,251 @@
+/*                                              -*- mode:C++ -*-
+  MDistTables.h Precompiled MDist site tables
+  Copyright (C) 2014-2016 The Regents of the University of New Mexico.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+  USA
+*/
+
+/**
+  \file MDistTables.h Precompiled MDist site tables
+  \date (C) 2014-2016 All rights reserved.
+  \lgpl
+ */
+
+/* GENERATED by tools/MakeMDistTables/MakeMDistTables.cpp 4 -- DO NOT EDIT */
+
+#ifndef MDISTTABLES_H
+#define MDISTTABLES_H
+
+#include "itype.h"
+
+namespace MFM
+{
+  /**
+     Read-only site tables for MDist<R>.  Only the radii generated
+     below exist; using MDist at any other radius fails to compile.
+     DUMMY only makes these template members, so their values can
+     live in this header, visible to the optimizer, without
+     multiple definitions.
+   */
+  template <u32 R, class DUMMY = void> struct MDistTables;
+
+#define MDIST_TABLE_ALIGN __attribute__ ((aligned (64)))
+
+  template <class DUMMY>
+  struct MDistTables<4, DUMMY>
+  {
+    static const s8 INDEX_TO_POINT[41][2] MDIST_TABLE_ALIGN;     // (x,y) by site number
+    static const s8 POINT_TO_INDEX[9][9] MDIST_TABLE_ALIGN;      // [x+R][y+R], or -1
+    static const u8 FIRST_INDEX[6];                               // By Manhattan length; [R+1] is the site count
+    static const u8 RASTER_TO_SITE_NUM[41];
+    static const u8 SITE_NUM_TO_RASTER[41];
+    static const u8 SITE_NUM_TO_ESL_NUM[41];
+    static const u8 ESL_NUM_TO_SITE_NUM[41];
+    static const u8 FIRST_ESL_VALUE[10];                          // Cutoff distances for ESL rings
+    static const u8 FIRST_ESL_INDEX[10];
+    static const u8 ESCAPES_BY_DIRECTION[8][41] MDIST_TABLE_ALIGN;
+    static const u8 HORIZONS_BY_DIRECTION[8][41] MDIST_TABLE_ALIGN;
+    static const u8 SYM_SITE_NUM[8][41] MDIST_TABLE_ALIGN;            // [psym][site number]
+  };
+
+#undef MDIST_TABLE_ALIGN
+
+  template <class DUMMY>
+  const s8 MDistTables<4,DUMMY>::INDEX_TO_POINT[41][2] =
+  {
+    { 0, 0 },
+    { -1, 0 },
+    { 0, -1 },
+    { 0, 1 },
+    { 1, 0 },
+    { -1, -1 },
+    { -1, 1 },
+    { 1, -1 },
+    { 1, 1 },
+    { -2, 0 },
+    { 0, -2 },
+    { 0, 2 },
+    { 2, 0 },
+    { -2, -1 },
+    { -2, 1 },
+    { -1, -2 },
+    { -1, 2 },
+    { 1, -2 },
+    { 1, 2 },
+    { 2, -1 },
+    { 2, 1 },
+    { -3, 0 },
+    { 0, -3 },
+    { 0, 3 },
+    { 3, 0 },
+    { -2, -2 },
+    { -2, 2 },
+    { 2, -2 },
+    { 2, 2 },
+    { -3, -1 },
+    { -3, 1 },
+    { -1, -3 },
+    { -1, 3 },
+    { 1, -3 },
+    { 1, 3 },
+    { 3, -1 },
+    { 3, 1 },
+    { -4, 0 },
+    { 0, -4 },
+    { 0, 4 },
+    { 4, 0 }
+  };
+
+  template <class DUMMY>
+  const s8 MDistTables<4,DUMMY>::POINT_TO_INDEX[9][9] =
+  {
+    { -1, -1, -1, -1, 37, -1, -1, -1, -1 },
+    { -1, -1, -1, 29, 21, 30, -1, -1, -1 },
+    { -1, -1, 25, 13, 9, 14, 26, -1, -1 },
+    { -1, 31, 15, 5, 1, 6, 16, 32, -1 },
+    { 38, 22, 10, 2, 0, 3, 11, 23, 39 },
+    { -1, 33, 17, 7, 4, 8, 18, 34, -1 },
+    { -1, -1, 27, 19, 12, 20, 28, -1, -1 },
+    { -1, -1, -1, 35, 24, 36, -1, -1, -1 },
+    { -1, -1, -1, -1, 40, -1, -1, -1, -1 }
+  };
+
+  template <class DUMMY>
+  const u8 MDistTables<4,DUMMY>::FIRST_INDEX[6] =
+  { 0, 1, 5, 13, 25, 41 };
+
+  template <class DUMMY>
+  const u8 MDistTables<4,DUMMY>::RASTER_TO_SITE_NUM[41] =
+  { 38, 31, 22, 33, 25, 15, 10, 17, 27, 29, 13, 5, 2, 7, 19, 35,
+    37, 21, 9, 1, 0, 4, 12, 24, 40, 30, 14, 6, 3, 8, 20, 36,
+    26, 16, 11, 18, 28, 32, 23, 34, 39 };
+
+  template <class DUMMY>
+  const u8 MDistTables<4,DUMMY>::SITE_NUM_TO_RASTER[41] =
+  { 20, 19, 12, 28, 21, 11, 27, 13, 29, 18, 6, 34, 22, 10, 26, 5,
+    33, 7, 35, 14, 30, 17, 2, 38, 23, 4, 32, 8, 36, 9, 25, 1,
+    37, 3, 39, 15, 31, 16, 0, 40, 24 };
+
+  template <class DUMMY>
+  const u8 MDistTables<4,DUMMY>::SITE_NUM_TO_ESL_NUM[41] =
+  { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+    16, 17, 18, 19, 20, 25, 26, 27, 28, 21, 22, 23, 24, 29, 30, 31,
+    32, 33, 34, 35, 36, 37, 38, 39, 40 };
+
+  template <class DUMMY>
+  const u8 MDistTables<4,DUMMY>::ESL_NUM_TO_SITE_NUM[41] =
+  { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+    16, 17, 18, 19, 20, 25, 26, 27, 28, 21, 22, 23, 24, 29, 30, 31,
+    32, 33, 34, 35, 36, 37, 38, 39, 40 };
+
+  template <class DUMMY>
+  const u8 MDistTables<4,DUMMY>::FIRST_ESL_VALUE[10] =
+  { 0, 1, 2, 4, 5, 8, 9, 10, 16, 255 };
+
+  template <class DUMMY>
+  const u8 MDistTables<4,DUMMY>::FIRST_ESL_INDEX[10] =
+  { 0, 1, 5, 9, 13, 21, 25, 29, 37, 41 };
+
+  template <class DUMMY>
+  const u8 MDistTables<4,DUMMY>::ESCAPES_BY_DIRECTION[8][41] =
+  {
+    { 25, 27, 29, 31, 33, 35, 37, 38, 40, 13, 15, 17, 19, 21, 22, 24,
+      5, 7, 9, 10, 12, 30, 36, 1, 2, 4, 14, 20, 0, 6, 8, 26,
+      28, 3, 16, 18, 11, 32, 34, 23, 39 },
+    { 17, 19, 22, 24, 27, 33, 35, 38, 40, 2, 4, 7, 10, 12, 15, 20,
+      31, 36, 0, 1, 3, 5, 8, 13, 18, 25, 28, 6, 9, 11, 14, 16,
+      21, 23, 29, 34, 26, 30, 32, 37, 39 },
+    { 27, 28, 33, 34, 35, 36, 38, 39, 40, 17, 18, 19, 20, 22, 23, 24,
+      7, 8, 10, 11, 12, 31, 32, 2, 3, 4, 15, 16, 0, 5, 6, 25,
+      26, 1, 13, 14, 9, 29, 30, 21, 37 },
+    { 18, 20, 23, 24, 28, 34, 36, 39, 40, 3, 4, 8, 11, 12, 16, 19,
+      32, 35, 0, 1, 2, 6, 7, 14, 17, 26, 27, 5, 9, 10, 13, 15,
+      21, 22, 30, 33, 25, 29, 31, 37, 38 },
+    { 26, 28, 30, 32, 34, 36, 37, 39, 40, 14, 16, 18, 20, 21, 23, 24,
+      6, 8, 9, 11, 12, 29, 35, 1, 3, 4, 13, 19, 0, 5, 7, 25,
+      27, 2, 15, 17, 10, 31, 33, 22, 38 },
+    { 14, 16, 21, 23, 26, 30, 32, 37, 39, 1, 3, 6, 9, 11, 13, 18,
+      29, 34, 0, 2, 4, 5, 8, 15, 20, 25, 28, 7, 10, 12, 17, 19,
+      22, 24, 31, 36, 27, 33, 35, 38, 40 },
+    { 25, 26, 29, 30, 31, 32, 37, 38, 39, 13, 14, 15, 16, 21, 22, 23,
+      5, 6, 9, 10, 11, 33, 34, 1, 2, 3, 17, 18, 0, 7, 8, 27,
+      28, 4, 19, 20, 12, 35, 36, 24, 40 },
+    { 13, 15, 21, 22, 25, 29, 31, 37, 38, 1, 2, 5, 9, 10, 14, 17,
+      30, 33, 0, 3, 4, 6, 7, 16, 19, 26, 27, 8, 11, 12, 18, 20,
+      23, 24, 32, 35, 28, 34, 36, 39, 40 }
+  };
+
+  template <class DUMMY>
+  const u8 MDistTables<4,DUMMY>::HORIZONS_BY_DIRECTION[8][41] =
+  {
+    { 38, 22, 31, 33, 10, 15, 17, 25, 27, 2, 5, 7, 13, 19, 29, 35,
+      0, 1, 4, 9, 12, 21, 24, 37, 40, 3, 6, 8, 14, 20, 30, 36,
+      11, 16, 18, 26, 28, 23, 32, 34, 39 },
+    { 27, 33, 35, 38, 40, 17, 19, 22, 24, 7, 10, 12, 31, 36, 2, 4,
+      15, 20, 0, 5, 8, 25, 28, 1, 3, 13, 18, 6, 9, 11, 29, 34,
+      14, 16, 21, 23, 26, 30, 32, 37, 39 },
+    { 40, 24, 35, 36, 12, 19, 20, 27, 28, 4, 7, 8, 17, 18, 33, 34,
+      0, 2, 3, 10, 11, 22, 23, 38, 39, 1, 5, 6, 15, 16, 31, 32,
+      9, 13, 14, 25, 26, 21, 29, 30, 37 },
+    { 28, 34, 36, 39, 40, 18, 20, 23, 24, 8, 11, 12, 32, 35, 3, 4,
+      16, 19, 0, 6, 7, 26, 27, 1, 2, 14, 17, 5, 9, 10, 30, 33,
+      13, 15, 21, 22, 25, 29, 31, 37, 38 },
+    { 39, 23, 32, 34, 11, 16, 18, 26, 28, 3, 6, 8, 14, 20, 30, 36,
+      0, 1, 4, 9, 12, 21, 24, 37, 40, 2, 5, 7, 13, 19, 29, 35,
+      10, 15, 17, 25, 27, 22, 31, 33, 38 },
+    { 26, 30, 32, 37, 39, 14, 16, 21, 23, 6, 9, 11, 29, 34, 1, 3,
+      13, 18, 0, 5, 8, 25, 28, 2, 4, 15, 20, 7, 10, 12, 31, 36,
+      17, 19, 22, 24, 27, 33, 35, 38, 40 },
+    { 37, 21, 29, 30, 9, 13, 14, 25, 26, 1, 5, 6, 15, 16, 31, 32,
+      0, 2, 3, 10, 11, 22, 23, 38, 39, 4, 7, 8, 17, 18, 33, 34,
+      12, 19, 20, 27, 28, 24, 35, 36, 40 },
+    { 25, 29, 31, 37, 38, 13, 15, 21, 22, 5, 9, 10, 30, 33, 1, 2,
+      14, 17, 0, 6, 7, 26, 27, 3, 4, 16, 19, 8, 11, 12, 32, 35,
+      18, 20, 23, 24, 28, 34, 36, 39, 40 }
+  };
+
+  template <class DUMMY>
+  const u8 MDistTables<4,DUMMY>::SYM_SITE_NUM[8][41] =
+  {
+    { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+      16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31,
+      32, 33, 34, 35, 36, 37, 38, 39, 40 },
+    { 0, 2, 4, 1, 3, 7, 5, 8, 6, 10, 12, 9, 11, 17, 15, 19,
+      13, 20, 14, 18, 16, 22, 24, 21, 23, 27, 25, 28, 26, 33, 31, 35,
+      29, 36, 30, 34, 32, 38, 40, 37, 39 },
+    { 0, 4, 3, 2, 1, 8, 7, 6, 5, 12, 11, 10, 9, 20, 19, 18,
+      17, 16, 15, 14, 13, 24, 23, 22, 21, 28, 27, 26, 25, 36, 35, 34,
+      33, 32, 31, 30, 29, 40, 39, 38, 37 },
+    { 0, 3, 1, 4, 2, 6, 8, 5, 7, 11, 9, 12, 10, 16, 18, 14,
+      20, 13, 19, 15, 17, 23, 21, 24, 22, 26, 28, 25, 27, 32, 34, 30,
+      36, 29, 35, 31, 33, 39, 37, 40, 38 },
+    { 0, 1, 3, 2, 4, 6, 5, 8, 7, 9, 11, 10, 12, 14, 13, 16,
+      15, 18, 17, 20, 19, 21, 23, 22, 24, 26, 25, 28, 27, 30, 29, 32,
+      31, 34, 33, 36, 35, 37, 39, 38, 40 },
+    { 0, 2, 1, 4, 3, 5, 7, 6, 8, 10, 9, 12, 11, 15, 17, 13,
+      19, 14, 20, 16, 18, 22, 21, 24, 23, 25, 27, 26, 28, 31, 33, 29,
+      35, 30, 36, 32, 34, 38, 37, 40, 39 },
+    { 0, 4, 2, 3, 1, 7, 8, 5, 6, 12, 10, 11, 9, 19, 20, 17,
+      18, 15, 16, 13, 14, 24, 22, 23, 21, 27, 28, 25, 26, 35, 36, 33,
+      34, 31, 32, 29, 30, 40, 38, 39, 37 },
+    { 0, 3, 4, 1, 2, 8, 6, 7, 5, 11, 12, 9, 10, 18, 16, 20,
+      14, 19, 13, 17, 15, 23, 24, 21, 22, 28, 26, 27, 25, 34, 32, 36,
+      30, 35, 29, 33, 31, 39, 40, 37, 38 }
+  };
+
+} /* namespace MFM */
+
+#endif /* MDISTTABLES_H */
@@ -0,0 +1,195 @@
+/*                                              -*- mode:C++ -*-
+  MFZBundle.h Reading .mfz physics bundles in place
+  Copyright (C) 2020 The Living Computation Foundation.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+  USA
+*/
+
+/**
+  \file MFZBundle.h Reading .mfz physics bundles in place
+  \lgpl
+ */
+#ifndef MFZBUNDLE_H
+#define MFZBUNDLE_H
+
+#include "itype.h"
+#include "OverflowableCharBufferByteSink.h"
+
+namespace MFM
+{
+  /**
+     An MFZBundle reads the members of a .mfz physics bundle -- as
+     mfzmake packs them: an MFZ(version) line, then an outer zip of
+     the signature and MFZ.ZIP, the inner zip of the public key, the
+     bundle name, and the packed files -- without unpacking it.
+
+     Open maps the file and indexes both zips' central directories.
+     Only MFZ.ZIP is inflated up front, to reach the inner index;
+     every other member is inflated, and its CRC checked, the first
+     time GetMemberData asks for it, and kept for later calls.  A
+     stored member isn't copied at all.
+
+     What has to be a file -- an element library, for dlopen -- goes
+     through ExtractMember into a cache directory, named by its CRC
+     and length, so starting again from an unchanged bundle finds it
+     already there and writes nothing.
+
+     The signature isn't checked: there's no RSA here.  Check a
+     bundle from somewhere new with 'mfzrun BUNDLE verify' first.
+     An MFZBundle isn't thread safe.
+   */
+  class MFZBundle
+  {
+  public:
+    enum {
+      MAX_MEMBERS = 128,
+      MAX_HEADER_BYTES = 64     // The MFZ(version) line, newline included
+    };
+
+    MFZBundle() ;
+
+    ~MFZBundle() ;
+
+    /**
+       Map and index the bundle at \c path, closing any bundle already
+       open.
+
+       \returns NULL, or why the bundle couldn't be opened, in which
+       case none is
+     */
+    const char * Open(const char * path) ;
+
+    /** Unmap the bundle and drop its inflated members */
+    void Close() ;
+
+    bool IsOpen() const
+    {
+      return m_map != 0;
+    }
+
+    /** The path of the open bundle */
+    const char * GetPath() const
+    {
+      return m_path.GetZString();
+    }
+
+    /** The bundle name mfzmake recorded, or "" */
+    const char * GetBundleName() const
+    {
+      return m_bundleName.GetZString();
+    }
+
+    /**
+       How many members the inner zip holds, MFZPUBKEY.DAT and
+       MFZNAME.DAT included
+     */
+    u32 GetMemberCount() const
+    {
+      return m_memberCount;
+    }
+
+    /** The index'th member's path as packed, without a leading '/' */
+    const char * GetMemberName(u32 index) const ;
+
+    /** The index'th member's name after its last '/' */
+    const char * GetMemberBaseName(u32 index) const ;
+
+    /** How many bytes the index'th member inflates to */
+    u32 GetMemberBytes(u32 index) const ;
+
+    /** The index'th member's CRC-32, as its zip directory records it */
+    u32 GetMemberCRC(u32 index) const ;
+
+    /**
+       The index of the member whose path, or else whose base name,
+       is \c name, or -1
+     */
+    s32 FindMember(const char * name) const ;
+
+    /**
+       The index'th member's GetMemberBytes(index) bytes, inflating
+       them on the first call.
+
+       \returns NULL if the member is damaged or can't be inflated
+     */
+    const u8 * GetMemberData(u32 index) ;
+
+    /**
+       Make sure the index'th member is in the directory \c cacheDir,
+       creating it if needed, and put its path in \c path.  Writes
+       only if the member isn't there already.
+
+       \returns NULL, or why the member couldn't be extracted
+     */
+    const char * ExtractMember(u32 index, const char * cacheDir, ByteSink & path) ;
+
+    /**
+       Put the cache directory to extract into, if the caller has no
+       other preference, in \c dir: $HOME/.mfm/mfzcache, or under
+       $TMPDIR without a $HOME.
+     */
+    static void GetDefaultCacheDir(ByteSink & dir) ;
+
+    /** Is the file at \c path a .mfz physics bundle? */
+    static bool IsBundle(const char * path) ;
+
+  private:
+    struct Member
+    {
+      OString256 m_name;
+      u32 m_baseName;           // Index of the name after the last '/'
+      u32 m_method;             // 0 stored, 8 deflated
+      u32 m_packedBytes;
+      u32 m_rawBytes;
+      u32 m_crc;
+      const u8 * m_packed;      // Into the map, or into m_innerZip
+      u8 * m_inflated;          // NULL until needed, unless stored
+      bool m_checked;           // CRC matched
+    };
+
+    OString256 m_path;
+    OString256 m_bundleName;
+    u8 * m_map;
+    u32 m_mapBytes;
+    u8 * m_innerZip;            // NULL if MFZ.ZIP was stored
+    Member m_members[MAX_MEMBERS];
+    u32 m_memberCount;
+
+    /**
+       Index the zip of zipBytes bytes at zip into members, appending
+       to count.  Returns NULL or an error.
+     */
+    static const char * ReadDirectory(const u8 * zip, u32 zipBytes,
+                                      Member * members, u32 maxMembers, u32 & count) ;
+
+    /**
+       Inflate member, unless it's stored, and check its CRC, if that
+       hasn't been done.  Returns NULL or an error.
+     */
+    static const char * Unpack(Member & member) ;
+
+    static const u8 * GetBytes(const Member & member)
+    {
+      return member.m_inflated ? member.m_inflated : member.m_packed;
+    }
+
+    // Declare away
+    MFZBundle(const MFZBundle &) ;
+    MFZBundle & operator=(const MFZBundle &) ;
+  };
+}
+
+#endif /* MFZBUNDLE_H */
@@ -0,0 +1,92 @@
+/*                                              -*- mode:C++ -*-
+  MemoryAccount.h Bytes held, by simulator subsystem
+  Copyright (C) 2020 The Living Computation Foundation.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+  USA
+*/
+
+/**
+  \file MemoryAccount.h Bytes held, by simulator subsystem
+  \author David H. Ackley.
+  \date (C) 2020 All rights reserved.
+  \lgpl
+ */
+#ifndef MEMORYACCOUNT_H
+#define MEMORYACCOUNT_H
+
+#include "itype.h"
+#include "Logger.h"
+
+namespace MFM
+{
+  /**
+     A MemoryAccount totals the bytes held by each subsystem of a
+     simulation -- the footprints of the objects plus whatever they
+     have allocated -- so a big grid's memory can be broken down when
+     tuning it for a small node.  Nothing is tracked as it happens:
+     owners (Tile::AccountMemory, Grid::AccountMemory and so on) add
+     up what they hold whenever an account is drawn up.
+   */
+  class MemoryAccount
+  {
+  public:
+    enum Subsystem
+    {
+      SITES,            ///< Tile sites, their atom planes and base layers
+      EVENT_HISTORY,    ///< EventHistoryBuffer items and keyframes
+      CACHE_PROCESSORS, ///< CacheProcessors and their shipped-atom copies
+      TRANSCEIVERS,     ///< Tile drivers, their GridTransceivers, intertile locks
+      ELEMENTS,         ///< Per-tile ElementTables
+      TILE_INDEXES,     ///< Event selection indexes, change stamps, event bins
+      TILES,            ///< The rest of the Tiles, and their extra event windows
+      SURFACES,         ///< GUI screen and tile image surfaces
+      OTHER,            ///< Anything else an owner reports
+      SUBSYSTEM_COUNT
+    };
+
+    static const char * GetSubsystemName(u32 subsystem) ;
+
+    MemoryAccount()
+    {
+      Reset();
+    }
+
+    void Reset() ;
+
+    void Add(Subsystem subsystem, u64 bytes)
+    {
+      m_bytes[subsystem] += bytes;
+    }
+
+    /** Fold \a other's bytes into this account */
+    void Add(const MemoryAccount & other) ;
+
+    u64 GetBytes(u32 subsystem) const ;
+
+    u64 GetTotalBytes() const ;
+
+    /**
+       Log one line per subsystem holding anything, and a total, at
+       \a level, prefixed by \a label
+     */
+    void ReportMemory(Logger::Level level, const char * label) const ;
+
+  private:
+    u64 m_bytes[SUBSYSTEM_COUNT];
+  };
+} /* namespace MFM */
+
+#endif /* MEMORYACCOUNT_H */
@@ -0,0 +1,255 @@
+/*                                              -*- mode:C++ -*-
+  P1Atom.h 64 bit atom with built in error correcting
+  Copyright (C) 2014 The Regents of the University of New Mexico.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+  USA
+*/
+
+/**
+  \file P1Atom.h 64 bit atom with built in error correcting
+  \lgpl
+ */
+#ifndef P1ATOM_H
+#define P1ATOM_H
+
+#include <stdio.h>
+#include "itype.h"
+#include "Point.h"
+#include "BitField.h"
+#include "Atom.h"
+#include "Element.h"
+#include "AtomConfig.h"
+#include "Util.h"      /* For COMPILATION_REQUIREMENT */
+#include "Parity2D_4x4.h"
+#include "UlamClassRegistry.h"
+
+namespace MFM {
+
+  class P1Atom; // FORWARD
+
+  /**
+     A 64 bit atom for memory-bound runs: the P3Atom's 25 bit
+     parity-protected header with 39 state bits rather than 71, so
+     that an atom is a single 64 bit word.  The type field stays 16
+     bits, as element type numbers need all of them.  Atoms of the
+     two configurations aren't interchangeable -- ATOM_CATEGORY is
+     folded into element UUIDs -- so an element's physics must fit
+     in 39 bits to run on P1 sites.
+   */
+  struct P1AtomConfig : public AtomConfig {
+    typedef P1Atom ATOM_TYPE;
+    enum { ATOM_CATEGORY = 1 };
+    enum { BITS_PER_ATOM = 64 };
+    enum { ATOM_TYPE_BITS = 16 };
+    enum { ATOM_UNDEFINED_TYPE = 0x0000 };
+    enum { ATOM_EMPTY_TYPE = 0xffff };
+    enum { ATOM_FIRST_STATE_BIT = 25 };
+    enum { ATOM_LAST_STATE_BIT = BITS_PER_ATOM - 1 };
+  };
+
+  class P1Atom : public Atom< P1AtomConfig >
+  {
+    typedef P1AtomConfig AC;
+
+  public:
+    enum { ATOM_EMPTY_TYPE = AC::ATOM_EMPTY_TYPE };
+    enum { ATOM_UNDEFINED_TYPE = AC::ATOM_UNDEFINED_TYPE };
+
+    enum {
+      BITS = AC::BITS_PER_ATOM,
+
+      //////
+      // Same header as P3: in the low-bits end of the bitvector
+
+      P1_ECC_BITS_POS = 0,
+      P1_ECC_BITS_LEN = 9,
+
+      P1_TYPE_BITS_POS = P1_ECC_BITS_POS + P1_ECC_BITS_LEN,
+      P1_TYPE_BITS_LEN = 16,
+
+      P1_FIXED_HEADER_POS = P1_ECC_BITS_POS,
+      P1_FIXED_HEADER_LEN = P1_ECC_BITS_LEN + P1_TYPE_BITS_LEN,
+
+      P1_STATE_BITS_POS = P1_FIXED_HEADER_POS + P1_FIXED_HEADER_LEN,
+      P1_STATE_BITS_LEN = BITS - P1_STATE_BITS_POS,
+
+      //////
+      // Declarations required by the Atom contract
+      ATOM_FIRST_STATE_BIT = P1_STATE_BITS_POS,
+
+      //////
+      // Other constants
+      P1_TYPE_COUNT = 1<<P1_TYPE_BITS_LEN
+
+    };
+
+    typedef BitField<BitVector<BITS>,VD::U32,P1_FIXED_HEADER_LEN,P1_FIXED_HEADER_POS> AFFixedHeader;
+    typedef BitField<BitVector<BITS>,VD::U32,P1_TYPE_BITS_LEN,P1_TYPE_BITS_POS> AFTypeBits;
+    typedef BitField<BitVector<BITS>,VD::U32,P1_ECC_BITS_LEN,P1_ECC_BITS_POS> AFECCBits;
+
+  protected:
+
+    /* We really don't want to allow the public to change the type of a
+       P1Atom, since the type doesn't mean much without the atomic
+       header as well */
+
+    void SetType(u32 type) {
+
+      MFM_API_ASSERT_ARG(type < P1_TYPE_COUNT);
+
+      // Generate ECC and store all in header
+      AFFixedHeader::Write(this->m_bits,Parity2D_4x4::Add2DParity(type));
+    }
+
+  public:
+
+    explicit P1Atom(u32 type = ATOM_EMPTY_TYPE, u32 z1 = 0, u32 z2 = 0, u32 stateBits = 0)
+    {
+      COMPILATION_REQUIREMENT< 32 <= BITS-1 >();
+
+      MFM_API_ASSERT_ARG(z1 == 0 && z2 == 0);
+      MFM_API_ASSERT(stateBits <= P1_STATE_BITS_LEN, OUT_OF_ROOM);
+
+      SetType(type);
+    }
+
+    P1Atom(const P1Atom& p3atomref)
+    {
+      this->m_bits = p3atomref.m_bits; // explicitly for c++11, since op= is explicit.
+    }
+
+    u32 GetTypeImpl() const {
+      return AFTypeBits::Read(this->m_bits);
+    }
+
+    bool IsSaneImpl() const
+    {
+      u32 fixedHeader = AFFixedHeader::Read(this->m_bits);
+      return Parity2D_4x4::Check2DParity(fixedHeader);
+    }
+
+    void SetEmptyImpl()
+    {
+      SetType(ATOM_EMPTY_TYPE);
+    }
+
+    void SetUndefinedImpl()
+    {
+      SetType(ATOM_UNDEFINED_TYPE);
+    }
+
+    bool HasBeenRepairedImpl()
+    {
+      u32 fixedHeader = AFFixedHeader::Read(this->m_bits);
+      u32 repairedHeader =
+        Parity2D_4x4::Correct2DParityIfPossible(fixedHeader);
+
+      if (repairedHeader == 0) return false;
+
+      if (fixedHeader != repairedHeader)
+      {
+        AFFixedHeader::Write(this->m_bits, repairedHeader);
+      }
+
+      return true;
+    }
+
+    u32 GetMaxStateSize(u32 type) const {
+      return P1_STATE_BITS_LEN;
+    }
+
+    /**
+     * Index of first bit that isn't a state bit.
+     */
+    u32 EndStateBit() const
+    {
+      return BITS;
+    }
+
+    void WriteStateBitsImpl(ByteSink& ostream) const
+    {
+      for(u32 i = P1_STATE_BITS_POS; i < P1_STATE_BITS_POS + P1_STATE_BITS_LEN; i++)
+      {
+	ostream.Printf("%d", this->m_bits.ReadBit(i) ? 1 : 0);
+      }
+    }
+
+    void ReadStateBitsImpl(const char* stateStr)
+    {
+      for(u32 i = 0; i < P1_STATE_BITS_LEN; i++)
+      {
+	this->m_bits.WriteBit(P1_STATE_BITS_POS + i, stateStr[i] == '0' ? 0 : 1);
+      }
+    }
+
+    void ReadStateBitsImpl(const BitVector<BITS> & bv)
+    {
+      for(u32 i = 0; i < P1_STATE_BITS_LEN; i++)
+      {
+        u32 idx = P1_STATE_BITS_POS + i;
+	this->m_bits.WriteBit(idx, bv.ReadBit(idx));
+      }
+    }
+
+    /**
+     * Read stateWidth state bits starting at stateIndex, which counts
+     * toward the right with 0 meaning the leftmost state bit.
+     */
+    u32 GetStateField(u32 stateIndex, u32 stateWidth) const
+    {
+      MFM_API_ASSERT_ARG(stateWidth <= P1_STATE_BITS_LEN);
+      return this->m_bits.Read(P1_STATE_BITS_POS + stateIndex, stateWidth);
+    }
+
+    /**
+     * Store value into stateWidth state bits starting at stateIndex,
+     * which counts toward the right with 0 meaning the leftmost state
+     * bit.
+     */
+    void SetStateField(u32 stateIndex, u32 stateWidth, u32 value)
+    {
+      MFM_API_ASSERT_ARG(stateWidth <= P1_STATE_BITS_LEN);
+      return this->m_bits.Write(P1_STATE_BITS_POS + stateIndex, stateWidth, value);
+    }
+
+    void PrintBits(ByteSink & ostream) const
+    { this->m_bits.Print(ostream); }
+
+    void PrintImpl(ByteSink & ostream) const
+    {
+      u32 type = this->GetType();
+      ostream.Printf("P1[%x/",type);
+      u32 length = GetMaxStateSize(type);
+      for (u32 i = 0; i < length; i += 4) {
+        u32 nyb = this->GetStateField(i,4);
+        ostream.Printf("%x",nyb);
+      }
+      ostream.Printf("]");
+    }
+
+    P1Atom& operator=(const P1Atom & rhs)
+    {
+      if (this == &rhs) return *this;
+
+      this->m_bits = rhs.m_bits;
+
+      return *this;
+    }
+
+  };
+} /* namespace MFM */
+
+#endif /*P1ATOM_H*/
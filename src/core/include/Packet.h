@@ -84,6 +84,72 @@ namespace MFM
      */
     static const u8 UPDATE_ACK = 'a';
 
+    /**
+     * The PacketType when an updater is shipping several sites of an
+     * update in one packet, optionally opening and/or closing the
+     * update as well.  Format: UPDATE_BATCH + u8:FLAGS + [s16:CX +
+     * s16:CY if FLAGS has BATCH_BEGIN] + N*(u8:(UPDATE or CHECK) +
+     * u8:SITENO + T:ATOM), with an UPDATE_END implied after the last
+     * atom if FLAGS has BATCH_END.
+     */
+    static const u8 UPDATE_BATCH = 'B';
+
+    /**
+     * UPDATE_BATCH flag: This packet begins a new cache update
+     */
+    static const u8 BATCH_BEGIN = 0x01;
+
+    /**
+     * UPDATE_BATCH flag: This packet ends the current cache update
+     */
+    static const u8 BATCH_END = 0x02;
+
+    /**
+     * UPDATE_BATCH flag, on a packet with BATCH_BEGIN: The sender
+     * offers to switch this link to UPDATE_COMPACT, in both
+     * directions.  \sa UPDATE_ACK_COMPACT
+     */
+    static const u8 BATCH_COMPACT_OFFER = 0x04;
+
+    /**
+     * The PacketType when an updatee has received an UPDATE_END, in
+     * an update carrying a BATCH_COMPACT_OFFER that it accepts.  Both
+     * ends ship UPDATE_COMPACT from the next update on.  Format:
+     * UPDATE_ACK_COMPACT + u8:CONSISTENT_ATOM_COUNT
+     */
+    static const u8 UPDATE_ACK_COMPACT = 'A';
+
+    /**
+     * The PacketType of UPDATE_BATCH's compact form, used once both
+     * ends of a link agree to it.  Each end remembers the last atom
+     * shipped either way over the link for each site, as a reference
+     * for the next.  Format: UPDATE_COMPACT + u8:FLAGS (as
+     * UPDATE_BATCH) + [s16:CX + s16:CY if FLAGS has BATCH_BEGIN] +
+     * N*(u8:CODE + [varint:DELTA] + PAYLOAD).  CODE holds a
+     * COMPACT_XXX encoding in its low two bits, COMPACT_CHECK for a
+     * CHECK rather than an UPDATE, and, from COMPACT_DELTA_SHIFT up,
+     * the zigzagged difference between this site number and the
+     * previous one in the packet (or 0), or else COMPACT_DELTA_ESCAPE
+     * with that difference following as an LEB128 varint.
+     */
+    static const u8 UPDATE_COMPACT = 'C';
+
+    /**
+     * UPDATE_COMPACT site encodings.  COMPACT_FULL: PAYLOAD is T:ATOM.
+     * COMPACT_EMPTY: the empty atom, no PAYLOAD.  COMPACT_WORDS:
+     * PAYLOAD is u8:MASK + one BEU32 per MASK bit, replacing that
+     * 32-bit word of the reference atom.  COMPACT_SAME: the reference
+     * atom, no PAYLOAD.
+     */
+    static const u8 COMPACT_FULL = 0;
+    static const u8 COMPACT_EMPTY = 1;
+    static const u8 COMPACT_WORDS = 2;
+    static const u8 COMPACT_SAME = 3;
+    static const u8 COMPACT_ENCODING_MASK = 0x03;
+    static const u8 COMPACT_CHECK = 0x04;
+    static const u8 COMPACT_DELTA_SHIFT = 3;
+    static const u8 COMPACT_DELTA_ESCAPE = 0x1f;
+
   } /* namespace PacketType */
 
 } /* namespace MFM */
@@ -39,6 +39,46 @@ namespace MFM
 
   class PacketIO {
     PacketBuffer m_buffer;
+
+    /**
+       Append one UPDATE_COMPACT site, \c delta site numbers past the
+       previous one, encoding \c atom against \c shipped, the last
+       atom shipped for its site.
+     */
+    template <class EC>
+    static void PrintCompactSite(ByteSink & bs, PacketTypeCode ptype, s32 delta,
+                                 const typename EC::ATOM_CONFIG::ATOM_TYPE & atom,
+                                 const typename EC::ATOM_CONFIG::ATOM_TYPE & shipped) ;
+
+    static void PrintVarint(ByteSink & bs, u32 value)
+    {
+      while (value >= 0x80)
+      {
+        bs.WriteByte((u8) (value | 0x80));
+        value >>= 7;
+      }
+      bs.WriteByte((u8) value);
+    }
+
+    static bool ScanVarint(ByteSource & bs, u32 & value)
+    {
+      value = 0;
+      for (u32 shift = 0; shift < 32; shift += 7)
+      {
+        const s32 ch = bs.Read();
+        if (ch < 0)
+        {
+          return false;
+        }
+        value |= ((u32) (ch & 0x7f)) << shift;
+        if ((ch & 0x80) == 0)
+        {
+          return true;
+        }
+      }
+      return false;
+    }
+
   public:
     template <class EC>
     bool SendUpdateBegin(CacheProcessor<EC> & cxn, const SPoint & localCenter) ;
@@ -50,8 +90,34 @@ namespace MFM
     bool SendAtom(PacketTypeCode ptype, CacheProcessor<EC> & cxn,
                   u16 siteNumber, const typename EC::ATOM_CONFIG::ATOM_TYPE & atom) ;
 
+    /**
+       Ship sites [first, first+count) of cxn's pending update as a
+       single UPDATE_BATCH packet, preceded by the update begin if
+       isBegin and followed by the update end if isEnd.
+     */
     template <class EC>
-    bool SendReply(PacketTypeCode ptype, CacheProcessor<EC> & cxn) ;
+    bool SendBatch(CacheProcessor<EC> & cxn, const SPoint & localCenter,
+                   bool isBegin, bool isEnd, u32 first, u32 count) ;
+
+    /**
+       Ship sites of cxn's pending update, starting at first, as a
+       single UPDATE_COMPACT packet of at most maxBytes, preceded by
+       the update begin if isBegin.  Packs in up to maxCount sites, as
+       many as fit, and ends the update if that's all of them.  Sets
+       count to how many it packed.  Only legal once cxn's link has
+       agreed to compact updates; the caller records the shipped
+       atoms if this succeeds.
+     */
+    template <class EC>
+    bool SendCompactBatch(CacheProcessor<EC> & cxn, const SPoint & localCenter,
+                          bool isBegin, u32 first, u32 maxCount, u32 maxBytes, u32 & count) ;
+
+    /**
+       Ship the reply to an update, as UPDATE_ACK_COMPACT if
+       acceptCompact, else UPDATE_ACK.
+     */
+    template <class EC>
+    bool SendReply(u8 consistentCount, CacheProcessor<EC> & cxn, bool acceptCompact) ;
 
     /**
        Parse (and dispatch to ReceiveXXX methods herein) to deal with
@@ -67,6 +133,12 @@ namespace MFM
     template <class EC>
     bool ReceiveAtom(CacheProcessor<EC> & cxn, ByteSource & buf) ;
 
+    template <class EC>
+    bool ReceiveBatch(CacheProcessor<EC> & cxn, ByteSource & buf) ;
+
+    template <class EC>
+    bool ReceiveCompactBatch(CacheProcessor<EC> & cxn, ByteSource & buf) ;
+
     template <class EC>
     bool ReceiveUpdateEnd(CacheProcessor<EC> & cxn, ByteSource & buf) ;
 
@@ -2,6 +2,7 @@
 
 #include "CacheProcessor.h"
 #include "CharBufferByteSource.h"
+#include "Element_Empty.h"
 
 namespace MFM
 {
@@ -87,10 +88,306 @@ namespace MFM
   }
 
   template <class EC>
-  bool PacketIO::SendReply(u8 consistentCount, CacheProcessor<EC> & cxn)
+  bool PacketIO::SendBatch(CacheProcessor<EC> & cxn, const SPoint & localCenter,
+                           bool isBegin, bool isEnd, u32 first, u32 count)
   {
+    u8 flags = 0;
+    if (isBegin) flags |= PacketType::BATCH_BEGIN;
+    if (isEnd) flags |= PacketType::BATCH_END;
+    if (isBegin && cxn.IsOfferingCompact()) flags |= PacketType::BATCH_COMPACT_OFFER;
+
     m_buffer.Reset();
-    m_buffer.Printf("%c%c", PacketType::UPDATE_ACK, consistentCount);
+    m_buffer.Printf("%c%c", PacketType::UPDATE_BATCH, flags);
+    if (isBegin)
+    {
+      SPoint center = cxn.LocalToRemote(localCenter);
+      m_buffer.Printf("%h%h", center.GetX(), center.GetY());
+    }
+    for (u32 i = first; i < first + count; ++i)
+    {
+      PacketTypeCode ptype;
+      u16 siteNumber;
+      const typename EC::ATOM_CONFIG::ATOM_TYPE & atom =
+        cxn.GetPendingAtom(i, ptype, siteNumber);
+      m_buffer.Printf("%c%c",ptype,siteNumber);
+      Element<EC>::GetBits(atom).PrintBytes(m_buffer);
+    }
+    return cxn.ShipBufferAsPacket(m_buffer);
+  }
+
+  template <class EC>
+  bool PacketIO::ReceiveBatch(CacheProcessor<EC> & cxn, ByteSource & bs)
+  {
+    u8 ptype;
+    u8 flags;
+    if (bs.Scanf("%c%c", &ptype, &flags) != 2 || ptype != PacketType::UPDATE_BATCH)
+    {
+      return false;
+    }
+
+    if (flags & PacketType::BATCH_BEGIN)
+    {
+      s16 cx, cy;
+      if (bs.Scanf("%h%h", &cx, &cy) != 2)
+      {
+        return false;
+      }
+      cxn.BeginUpdate(SPoint(cx, cy));
+      if (flags & PacketType::BATCH_COMPACT_OFFER)
+      {
+        cxn.NoteCompactOffer();
+      }
+    }
+
+    while (bs.Peek() >= 0)
+    {
+      u8 site;
+      if (bs.Scanf("%c%c", &ptype, &site) != 2)
+      {
+        return false;
+      }
+      if (ptype != PacketType::UPDATE && ptype != PacketType::CHECK)
+      {
+        return false;
+      }
+
+      typename EC::ATOM_CONFIG::ATOM_TYPE atom;
+      if (!Element<EC>::GetBits(atom).ReadBytes(bs))
+      {
+        return false;
+      }
+
+      cxn.ReceiveAtom(ptype==PacketType::UPDATE, site, atom);
+    }
+
+    if (flags & PacketType::BATCH_END)
+    {
+      cxn.ReceiveUpdateEnd();
+    }
+    return true;
+  }
+
+  template <class EC>
+  void PacketIO::PrintCompactSite(ByteSink & bs, PacketTypeCode ptype, s32 delta,
+                                  const typename EC::ATOM_CONFIG::ATOM_TYPE & atom,
+                                  const typename EC::ATOM_CONFIG::ATOM_TYPE & shipped)
+  {
+    typedef typename EC::ATOM_CONFIG AC;
+    typedef BitVector<AC::BITS_PER_ATOM> BV;
+    enum { WORDS = BV::ARRAY_LENGTH };
+
+    u8 encoding = PacketType::COMPACT_FULL;
+    u32 words[WORDS];
+    u8 mask = 0;
+    if (atom == shipped)
+    {
+      encoding = PacketType::COMPACT_SAME;
+    }
+    else if (atom == Element_Empty<EC>::THE_INSTANCE.GetDefaultAtom())
+    {
+      encoding = PacketType::COMPACT_EMPTY;
+    }
+    else if (WORDS <= 8)
+    {
+      u32 old[WORDS];
+      Element<EC>::GetBits(atom).ToArray(words);
+      Element<EC>::GetBits(shipped).ToArray(old);
+      u32 changed = 0;
+      for (u32 w = 0; w < WORDS; ++w)
+      {
+        if (words[w] != old[w])
+        {
+          mask |= (u8) (1 << w);
+          ++changed;
+        }
+      }
+      if (1 + 4 * changed < 4 * WORDS)
+      {
+        encoding = PacketType::COMPACT_WORDS;
+      }
+    }
+
+    // Zigzag, so small steps either way stay small
+    const u32 zigzag = (((u32) delta) << 1) ^ (u32) (delta >> 31);
+    const u8 check = ptype == PacketType::CHECK ? PacketType::COMPACT_CHECK : 0;
+    if (zigzag < PacketType::COMPACT_DELTA_ESCAPE)
+    {
+      bs.WriteByte((u8) (encoding | check | (zigzag << PacketType::COMPACT_DELTA_SHIFT)));
+    }
+    else
+    {
+      bs.WriteByte((u8) (encoding | check |
+                         (PacketType::COMPACT_DELTA_ESCAPE << PacketType::COMPACT_DELTA_SHIFT)));
+      PrintVarint(bs, zigzag);
+    }
+
+    switch (encoding)
+    {
+    case PacketType::COMPACT_FULL:
+      Element<EC>::GetBits(atom).PrintBytes(bs);
+      break;
+
+    case PacketType::COMPACT_WORDS:
+      bs.WriteByte(mask);
+      for (u32 w = 0; w < WORDS; ++w)
+      {
+        if (mask & (1 << w))
+        {
+          bs.Print(words[w], Format::BEU32);
+        }
+      }
+      break;
+
+    default:
+      break;
+    }
+  }
+
+  template <class EC>
+  bool PacketIO::SendCompactBatch(CacheProcessor<EC> & cxn, const SPoint & localCenter,
+                                  bool isBegin, u32 first, u32 maxCount, u32 maxBytes, u32 & count)
+  {
+    const u32 pending = cxn.GetPendingCount();
+    MFM_API_ASSERT_ARG(first <= pending);
+
+    // Pack the sites first, since the flags depend on how many fit
+    const u32 headerBytes = isBegin ? 6 : 2;
+    PacketBuffer sites;
+    count = 0;
+    s32 prevSite = 0;
+    while (count < maxCount && first + count < pending)
+    {
+      PacketTypeCode ptype;
+      u16 siteNumber;
+      const typename EC::ATOM_CONFIG::ATOM_TYPE & atom =
+        cxn.GetPendingAtom(first + count, ptype, siteNumber);
+
+      PacketBuffer site;
+      PrintCompactSite<EC>(site, ptype, (s32) siteNumber - prevSite, atom,
+                           cxn.GetShippedAtom(siteNumber));
+      if (headerBytes + sites.GetLength() + site.GetLength() > maxBytes)
+      {
+        break;
+      }
+      sites.WriteBytes((const u8 *) site.GetBuffer(), site.GetLength());
+      prevSite = siteNumber;
+      ++count;
+    }
+    MFM_API_ASSERT_STATE(count > 0 || first == pending);
+
+    u8 flags = 0;
+    if (isBegin) flags |= PacketType::BATCH_BEGIN;
+    if (first + count == pending) flags |= PacketType::BATCH_END;
+
+    m_buffer.Reset();
+    m_buffer.Printf("%c%c", PacketType::UPDATE_COMPACT, flags);
+    if (isBegin)
+    {
+      SPoint center = cxn.LocalToRemote(localCenter);
+      m_buffer.Printf("%h%h", center.GetX(), center.GetY());
+    }
+    m_buffer.WriteBytes((const u8 *) sites.GetBuffer(), sites.GetLength());
+    return cxn.ShipBufferAsPacket(m_buffer);
+  }
+
+  template <class EC>
+  bool PacketIO::ReceiveCompactBatch(CacheProcessor<EC> & cxn, ByteSource & bs)
+  {
+    typedef typename EC::ATOM_CONFIG AC;
+    typedef typename AC::ATOM_TYPE T;
+    typedef BitVector<AC::BITS_PER_ATOM> BV;
+    enum { WORDS = BV::ARRAY_LENGTH };
+    enum { SITE_COUNT = EVENT_WINDOW_SITES(EC::EVENT_WINDOW_RADIUS) };
+
+    u8 ptype;
+    u8 flags;
+    if (bs.Scanf("%c%c", &ptype, &flags) != 2 || ptype != PacketType::UPDATE_COMPACT ||
+        !cxn.IsCompactAgreed())
+    {
+      return false;
+    }
+
+    if (flags & PacketType::BATCH_BEGIN)
+    {
+      s16 cx, cy;
+      if (bs.Scanf("%h%h", &cx, &cy) != 2)
+      {
+        return false;
+      }
+      cxn.BeginUpdate(SPoint(cx, cy));
+    }
+
+    s32 site = 0;
+    while (bs.Peek() >= 0)
+    {
+      const u8 code = (u8) bs.Read();
+      u32 zigzag = code >> PacketType::COMPACT_DELTA_SHIFT;
+      if (zigzag == PacketType::COMPACT_DELTA_ESCAPE && !ScanVarint(bs, zigzag))
+      {
+        return false;
+      }
+      site += (s32) (zigzag >> 1) ^ -(s32) (zigzag & 1);
+      if (site < 0 || site >= SITE_COUNT)
+      {
+        return false;
+      }
+
+      T atom;
+      switch (code & PacketType::COMPACT_ENCODING_MASK)
+      {
+      case PacketType::COMPACT_FULL:
+        if (!Element<EC>::GetBits(atom).ReadBytes(bs))
+        {
+          return false;
+        }
+        break;
+
+      case PacketType::COMPACT_EMPTY:
+        atom = Element_Empty<EC>::THE_INSTANCE.GetDefaultAtom();
+        break;
+
+      case PacketType::COMPACT_SAME:
+        atom = cxn.GetShippedAtom((u16) site);
+        break;
+
+      default: // COMPACT_WORDS
+      {
+        u32 words[WORDS];
+        Element<EC>::GetBits(cxn.GetShippedAtom((u16) site)).ToArray(words);
+        const s32 mask = bs.Read();
+        if (mask < 0 || mask >= (1 << (WORDS < 8 ? WORDS : 8)))
+        {
+          return false;
+        }
+        for (u32 w = 0; w < WORDS; ++w)
+        {
+          if ((mask & (1 << w)) && !bs.Scan(words[w], Format::BEU32))
+          {
+            return false;
+          }
+        }
+        Element<EC>::GetBits(atom).FromArray(words);
+        break;
+      }
+      }
+
+      cxn.SetShippedAtom((u16) site, atom);
+      cxn.ReceiveAtom((code & PacketType::COMPACT_CHECK) == 0, site, atom);
+    }
+
+    if (flags & PacketType::BATCH_END)
+    {
+      cxn.ReceiveUpdateEnd();
+    }
+    return true;
+  }
+
+  template <class EC>
+  bool PacketIO::SendReply(u8 consistentCount, CacheProcessor<EC> & cxn, bool acceptCompact)
+  {
+    m_buffer.Reset();
+    m_buffer.Printf("%c%c", acceptCompact ? PacketType::UPDATE_ACK_COMPACT : PacketType::UPDATE_ACK,
+                    consistentCount);
     return cxn.ShipBufferAsPacket(m_buffer);
   }
 
@@ -99,7 +396,21 @@ namespace MFM
   {
     u8 ptype;
     u8 consistentCount;
-    if (bs.Scanf("%c%c", &ptype, &consistentCount) != 2 || ptype != PacketType::UPDATE_ACK)
+    if (bs.Scanf("%c%c", &ptype, &consistentCount) != 2)
+    {
+      return false;
+    }
+
+    if (ptype == PacketType::UPDATE_ACK_COMPACT)
+    {
+      // Our offer's taken; go compact from the next update on
+      if (!cxn.IsOfferingCompact())
+      {
+        return false;
+      }
+      cxn.AgreeCompact();
+    }
+    else if (ptype != PacketType::UPDATE_ACK)
     {
       return false;
     }
@@ -121,10 +432,17 @@ namespace MFM
     case PacketType::CHECK:
       return ReceiveAtom(cxn, cbs);
 
+    case PacketType::UPDATE_BATCH:
+      return ReceiveBatch(cxn, cbs);
+
+    case PacketType::UPDATE_COMPACT:
+      return ReceiveCompactBatch(cxn, cbs);
+
     case PacketType::UPDATE_END:
       return ReceiveUpdateEnd(cxn, cbs);
 
     case PacketType::UPDATE_ACK:
+    case PacketType::UPDATE_ACK_COMPACT:
       return ReceiveReply(cxn, cbs);
 
     default:
@@ -47,6 +47,20 @@ namespace MFM
   template <class EC> class AtomicParameters; // FORWARD
   template <class EC> class ElementParameters; // FORWARD
 
+  /**
+   * A snapshot of one parameter value, with the parameter generation
+   * it was taken at.  Small enough to live in an element data slot
+   * (\sa ElementTable::GetElementData), so each tile can keep its own
+   * and read a plain value until the parameter next changes.  A
+   * zeroed cache is always stale.
+   */
+  template <class VTYPE>
+  struct ParameterCache
+  {
+    u32 m_generation;
+    VTYPE m_value;
+  };
+
   template <class EC>
   class Parameter : public ByteSerializable
   {
@@ -81,12 +95,53 @@ namespace MFM
      */
     const char * m_description;
 
+    /**
+     * Bumped after every change to this Parameter's value, so cached
+     * copies can tell they are stale.  Never 0.  Mutable since the
+     * atom-based setters are const.
+     */
+    mutable u32 m_generation;
+
+    void Touch() const
+    {
+      if (__atomic_add_fetch(&m_generation, 1, __ATOMIC_RELEASE) == 0)
+      {
+        __atomic_store_n(&m_generation, 1, __ATOMIC_RELEASE);
+      }
+    }
+
+    /**
+     * If \c generation is not this Parameter's current generation,
+     * make it so and return true: a value read next is at least that
+     * new, so the caller should refresh its copy.
+     */
+    bool Restamp(u32 & generation) const
+    {
+      const u32 current = GetGeneration();
+      if (generation == current)
+      {
+        return false;
+      }
+      generation = current;
+      return true;
+    }
+
   public:
     u32 GetType() const
     {
       return m_vDesc.m_type;
     }
 
+    /**
+     * The current generation of this Parameter's value.  Safe to call
+     * from any thread; a value read after seeing a generation is at
+     * least as new as that generation.
+     */
+    u32 GetGeneration() const
+    {
+      return __atomic_load_n(&m_generation, __ATOMIC_ACQUIRE);
+    }
+
     s32 GetMin() const
     {
       return m_vDesc.GetMin();
@@ -149,6 +204,7 @@ namespace MFM
           u32 val;
           if (!bs.Scan(val)) return false;
           m_vDesc.SetValueU32<T>(atom,val);
+          Touch();
           return true;
         }
       case VD::S32:
@@ -156,6 +212,7 @@ namespace MFM
           s32 val;
           if (!bs.Scan(val)) return false;
           m_vDesc.SetValueS32<T>(atom,val);
+          Touch();
           return true;
         }
       case VD::BOOL:
@@ -174,6 +231,7 @@ namespace MFM
           {
             return false;
           }
+          Touch();
           return true;
         }
       case VD::UNARY:
@@ -181,6 +239,7 @@ namespace MFM
           u32 val;
           if (!bs.Scan(val)) return false;
           m_vDesc.SetValueUnary<T>(atom,val);
+          Touch();
           return true;
         }
       default: FAIL(ILLEGAL_STATE);
@@ -195,6 +254,7 @@ namespace MFM
     void SetValueIntoType(T& atom, const u32 val) const
     {
       m_vDesc.StoreValueByType<T>(atom, val);
+      Touch();
     }
 
     /////////
@@ -208,6 +268,7 @@ namespace MFM
     void SetBitsAsS32(T& atom, const s32 val) const
     {
       m_vDesc.SetBitsAsS32<T>(atom, val);
+      Touch();
     }
 
     /////////
@@ -221,6 +282,7 @@ namespace MFM
     void SetBitsAsU64(T& atom, const u64 val) const
     {
       m_vDesc.SetBitsAsU64<T>(atom, val);
+      Touch();
     }
 
     /////////
@@ -244,6 +306,7 @@ namespace MFM
       if (this->GetType()==VD::U32)
       {
         this->m_vDesc.SetValueU32(atom, val);
+        Touch();
       }
     }
 
@@ -265,6 +328,7 @@ namespace MFM
       if (this->GetType()==VD::S32)
       {
         this->m_vDesc.SetValueS32(atom, val);
+        Touch();
       }
     }
 
@@ -286,6 +350,7 @@ namespace MFM
       if (this->GetType()==VD::BOOL)
       {
         this->m_vDesc.SetValueBool(atom, val);
+        Touch();
       }
     }
 
@@ -307,6 +372,7 @@ namespace MFM
       if (this->GetType()==VD::UNARY)
       {
         this->m_vDesc.SetValueUnary(atom, val);
+        Touch();
       }
     }
 
@@ -500,6 +566,7 @@ namespace MFM
     void SetValueU32(const u32 val)
     {
       FieldU32::SetValue(m_storage, val);
+      this->Touch();
     }
 
     /////////
@@ -513,6 +580,7 @@ namespace MFM
     void SetValueS32(const s32 val)
     {
       FieldS32::SetValue(m_storage, val);
+      this->Touch();
     }
 
     /////////
@@ -526,6 +594,7 @@ namespace MFM
     void SetValueBool(const bool val)
     {
       FieldBool::SetValue(m_storage, val);
+      this->Touch();
     }
 
     /////////
@@ -539,6 +608,7 @@ namespace MFM
     void SetValueUnary(const u32 val)
     {
       this->m_vDesc.StoreValueByType(m_storage, val);
+      this->Touch();
     }
 
     /////////
@@ -554,6 +624,7 @@ namespace MFM
     void SetValueBits(const u64 val)
     {
       FieldBits::SetValue(m_storage, val);
+      this->Touch();
     }
   };
 
@@ -570,6 +641,19 @@ namespace MFM
     {
       return this->GetValueU32();
     }
+
+    /**
+     * The value, as of the last change, through a per-tile \c cache
+     */
+    u32 GetValue(ParameterCache<u32> & cache) const
+    {
+      if (this->Restamp(cache.m_generation))
+      {
+        cache.m_value = GetValue();
+      }
+      return cache.m_value;
+    }
+
     void SetValue(u32 val)
     {
       return this->SetValueU32(val);
@@ -605,6 +689,19 @@ namespace MFM
     {
       return this->GetValueUnary();
     }
+
+    /**
+     * The value, as of the last change, through a per-tile \c cache
+     */
+    u32 GetValue(ParameterCache<u32> & cache) const
+    {
+      if (this->Restamp(cache.m_generation))
+      {
+        cache.m_value = GetValue();
+      }
+      return cache.m_value;
+    }
+
     void SetValue(u32 val)
     {
       return this->SetValueUnary(val);
@@ -640,6 +737,19 @@ namespace MFM
     {
       return this->GetValueS32();
     }
+
+    /**
+     * The value, as of the last change, through a per-tile \c cache
+     */
+    s32 GetValue(ParameterCache<s32> & cache) const
+    {
+      if (this->Restamp(cache.m_generation))
+      {
+        cache.m_value = GetValue();
+      }
+      return cache.m_value;
+    }
+
     void SetValue(s32 val)
     {
       return this->SetValueS32(val);
@@ -675,6 +785,19 @@ namespace MFM
     {
       return this->GetValueBool();
     }
+
+    /**
+     * The value, as of the last change, through a per-tile \c cache
+     */
+    bool GetValue(ParameterCache<bool> & cache) const
+    {
+      if (this->Restamp(cache.m_generation))
+      {
+        cache.m_value = GetValue();
+      }
+      return cache.m_value;
+    }
+
     void SetValue(bool val)
     {
       return this->SetValueBool(val);
@@ -735,15 +858,18 @@ namespace MFM
     void SetValue(u64 val)
     {
       FieldBitsLength::SetValue(this->GetAtom(), val);
+      this->Touch();
     }
 
     void ClearBit(u32 bitnum)
     {
       FieldBitsLength::ClearBit(this->GetAtom(), bitnum);
+      this->Touch();
     }
     void SetBit(u32 bitnum)
     {
       FieldBitsLength::SetBit(this->GetAtom(), bitnum);
+      this->Touch();
     }
     bool GetBit(u32 bitnum) const
     {
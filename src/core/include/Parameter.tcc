@@ -11,7 +11,8 @@ namespace MFM
     : m_vDesc(vd),
       m_tag(StripThroughHexSpaceIfExists(tag)),
       m_name(name),
-      m_description(description)
+      m_description(description),
+      m_generation(1)
   {
     MFM_API_ASSERT_NONNULL(m_tag);
     MFM_API_ASSERT_NONNULL(m_name);
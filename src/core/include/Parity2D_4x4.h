@@ -189,6 +189,24 @@ namespace MFM {
      */
     static u32 Correct2DParityIfPossible(u32 allBits);
 
+    /**
+       Count how many of the \a count values at \a allBits fail \ref
+       Check2DParity.  Each costs one table lookup, and there's no
+       branch on the outcome.
+     */
+    static u32 Count2DParityErrors(const u32 * allBits, u32 count);
+
+    /**
+       \ref CheckAndCorrect2DParity each of the \a count values at \a
+       allBits, in place.  Values that check are just counted past
+       (so a clean batch costs the same as \ref Count2DParityErrors);
+       values that can be corrected are; and values that can't be are
+       left unchanged.
+
+       \returns the number of values that could not be corrected
+     */
+    static u32 CheckAndCorrect2DParityBatch(u32 * allBits, u32 count);
+
     static const u8 indices2D[H + 1][W + 1];
 
   private:
@@ -0,0 +1,77 @@
+/*                                              -*- mode:C++ -*-
+  Probes.h Compile-time optional static tracepoints
+  Copyright (C) 2020 The Living Computation Foundation.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+  USA
+*/
+
+/**
+  \file Probes.h Compile-time optional static tracepoints
+  \author David H. Ackley.
+  \date (C) 2020 All rights reserved.
+  \lgpl
+ */
+#ifndef PROBES_H
+#define PROBES_H
+
+/*
+  Static tracepoints (USDT probes, as SystemTap's sys/sdt.h makes
+  them) at points whose timing matters, for bpftrace, perf or stap
+  to attach to in a running binary.  An unattached probe is a nop
+  instruction plus an ELF note, and its arguments are values already
+  at hand, so they may be left in production builds.
+
+  The probes exist only when the build defines MFM_USDT_PROBES
+  (e.g., make EXTERNAL_DEFINES=-DMFM_USDT_PROBES), which needs
+  sys/sdt.h (systemtap-sdt-dev on Debian).  Otherwise they compile
+  to nothing.  All are in provider 'mfm'; a double underscore in a
+  probe name reads as a dash, as usual, so e.g.
+
+    bpftrace -e 'usdt:./mfms:mfm:event-start { @s[tid] = nsecs; }
+                 usdt:./mfms:mfm:event-end /@s[tid]/ {
+                   @ns = hist(nsecs - @s[tid]); delete(@s[tid]); }'
+
+  gives the distribution of event latencies.
+
+  Probes (arguments in order):
+
+    event-start        tile, x, y           EventWindow::TryEventAt entered
+    event-end          tile, x, y, ran      EventWindow::TryEventAt leaving
+    lock-fail          tile, dir            An intertile lock wasn't gotten
+    cache-ship         tile, dir, bytes     CacheProcessor shipped a packet
+    cache-receive      tile, dir, bytes     CacheProcessor received a packet
+    itc-state          itc, dir, state      T2ITC::setITCSN
+    ew-state           ew, slot, state      T2EventWindow::setEWSN
+    timeout-expire     timeoutable, lateMS  TimeQueue::getEarliestExpired
+*/
+
+#ifdef MFM_USDT_PROBES
+
+#include <sys/sdt.h>
+
+#define MFM_PROBE2(name, a, b) DTRACE_PROBE2(mfm, name, a, b)
+#define MFM_PROBE3(name, a, b, c) DTRACE_PROBE3(mfm, name, a, b, c)
+#define MFM_PROBE4(name, a, b, c, d) DTRACE_PROBE4(mfm, name, a, b, c, d)
+
+#else /* MFM_USDT_PROBES */
+
+#define MFM_PROBE2(name, a, b) do { } while (0)
+#define MFM_PROBE3(name, a, b, c) do { } while (0)
+#define MFM_PROBE4(name, a, b, c, d) do { } while (0)
+
+#endif /* MFM_USDT_PROBES */
+
+#endif /* PROBES_H */
@@ -33,6 +33,7 @@
 
 #include "itype.h"
 #include "RandMT.h"
+#include "XoshiroRand.h"
 #include "BitVector.h"
 #include "FXP.h"
 #include "Fail.h"
@@ -54,7 +55,7 @@ namespace MFM
     Random()
     {
       static u32 counter = (u32) time(NULL);
-      SetSeed(++counter);
+      SetSeed(__atomic_add_fetch(&counter, 1, __ATOMIC_RELAXED)); // Tiles may be built in parallel
     }
 
     /**
@@ -73,7 +74,7 @@ namespace MFM
      */
     inline u32 Create()
     {
-      return _generator.randomMT();
+      return NextFrom(_generator);
     }
 
     /**
@@ -118,6 +119,25 @@ namespace MFM
 	  MFM_API_ASSERT_ARG(maxval==1);    // maxval==0 -> fail ILLEGAL_ARGUMENT
 	  return 0;
 	}
+#ifdef MFM_RANDOM_XOSHIRO
+      // Multiply-shift (Lemire 2019): the high word of 32x32 bits is
+      // uniform over [0,maxval) once the few low words that would
+      // bias it are rejected, which happens with chance < maxval/2**32.
+      // Only with xoshiro: under RandMT, seeded runs must keep drawing
+      // exactly what they always have.
+      u64 m = ((u64) Create()) * maxval;
+      u32 low = (u32) m;
+      if (low < maxval)
+	{
+	  u32 threshold = (u32) (-maxval) % maxval;
+	  while (low < threshold)
+	    {
+	      m = ((u64) Create()) * maxval;
+	      low = (u32) m;
+	    }
+	}
+      return (u32) (m >> 32);
+#else
       u32 nbits = _getLogBase2(maxval)+1; // +1: log2(2) == 1 -> need 2 bits
       u32 ret;
       do
@@ -126,6 +146,7 @@ namespace MFM
 	} while (ret >= maxval);
 
       return ret;
+#endif
     }
 
     /**
@@ -179,6 +200,49 @@ namespace MFM
       return OddsOf(thisMany.intValue, outOfThisMany.intValue);
     }
 
+    /**
+     * Return how many OneIn(odds) trials in a row would come up false
+     * before the next true one, with the same (geometric)
+     * distribution, but at the cost of one draw and one log.  Lets
+     * sparse sweeps jump straight from hit to hit.  Returns 0 when
+     * odds == 1, and at most U32_MAX.  FAILs ILLEGAL_ARGUMENT if odds
+     * is 0.
+     */
+    u32 GeometricSkip(u32 odds)
+    {
+      if (odds <= 1)
+      {
+        MFM_API_ASSERT_ARG(odds == 1);
+        return 0;
+      }
+      return GeometricSkip(1, odds);
+    }
+
+    /**
+     * Return how many OddsOf(thisMany,outOfThisMany) trials in a row
+     * would come up false before the next true one, as
+     * GeometricSkip(odds) does for OneIn(odds).  Returns 0 when
+     * thisMany >= outOfThisMany, and U32_MAX when thisMany == 0.
+     * FAILs ILLEGAL_ARGUMENT if outOfThisMany is 0.
+     */
+    u32 GeometricSkip(u32 thisMany, u32 outOfThisMany)
+    {
+      MFM_API_ASSERT_ARG(outOfThisMany > 0);
+      if (thisMany >= outOfThisMany)
+      {
+        return 0;
+      }
+      if (thisMany == 0)
+      {
+        return U32_MAX;
+      }
+      // u uniform on (0,1], so its log is finite
+      const double u = (Create() + 1.0) / 4294967296.0;
+      const double miss = 1.0 - ((double) thisMany) / outOfThisMany;
+      const double skip = log(u) / log(miss);
+      return skip >= (double) U32_MAX ? U32_MAX : (u32) skip;
+    }
+
     /**
      * Return a uniformly chosen pseudo-random signed number in the
      * range of min..max, with both endpoints included.  between(-1,1)
@@ -199,14 +263,26 @@ namespace MFM
      */
     void SetSeed(u32 seed)
     {
-      _generator.seedMT_MFM(seed);
+      SeedGenerator(_generator, seed);
       _bitsRemaining = 0;
     }
 
   private:
+
+#ifdef MFM_RANDOM_XOSHIRO
+    typedef XoshiroRand Generator;
+#else
+    typedef RandMT Generator;
+#endif
+
+    static inline u32 NextFrom(RandMT & gen) { return gen.randomMT(); }
+    static inline u32 NextFrom(XoshiroRand & gen) { return gen.Next(); }
+    static inline void SeedGenerator(RandMT & gen, u32 seed) { gen.seedMT_MFM(seed); }
+    static inline void SeedGenerator(XoshiroRand & gen, u32 seed) { gen.Seed(seed); }
+
     s32 _bitsRemaining;
     u32 _bitBuffer;
-    RandMT _generator;
+    Generator _generator;
 
   };
 
@@ -0,0 +1,160 @@
+/*                                              -*- mode:C++ -*-
+  SPSCQueue.h Lock-free single-producer single-consumer byte queue
+  Copyright (C) 2020 The Living Computation Foundation.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+  USA
+*/
+
+/**
+  \file SPSCQueue.h Lock-free single-producer single-consumer byte queue
+  \date (C) 2020 All rights reserved.
+  \lgpl
+ */
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+
+#include "itype.h"
+#include "Fail.h"
+#include "Util.h"      /* For COMPILATION_REQUIREMENT */
+#include <pthread.h>
+
+namespace MFM
+{
+  /**
+     A ring of CAPACITY bytes (a power of two) passed from exactly
+     one writing thread to exactly one reading thread, without locks.
+
+     The two sides each own one free-running index -- the writer
+     advances m_writeIndex, the reader m_readIndex -- which live on
+     separate cache lines along with each side's last look at the
+     other's index, so the sides only touch each other's line when
+     the ring seems full (or empty) by the stale view.  Reads and
+     writes move whole batches with at most two memcpys.
+
+     ReadBlocking and WriteBlocking wait on a condition variable when
+     there's nothing to do, and the other side only takes the lock to
+     signal it while somebody is actually waiting, so a queue that
+     never blocks never locks.
+   */
+  template <u32 CAPACITY>
+  class SPSCQueue
+  {
+  public:
+    enum { CACHE_LINE_BYTES = 64 };
+
+    SPSCQueue() ;
+
+    ~SPSCQueue() ;
+
+    u32 GetCapacity() const
+    {
+      return CAPACITY;
+    }
+
+    /** How many bytes the reader could Read now.  Reader side. */
+    u32 GetReadable() const
+    {
+      return __atomic_load_n(&m_writeIndex, __ATOMIC_ACQUIRE) - m_readIndex;
+    }
+
+    /** How many bytes the writer could Write now.  Writer side. */
+    u32 GetWritable() const
+    {
+      return CAPACITY - (m_writeIndex - __atomic_load_n(&m_readIndex, __ATOMIC_ACQUIRE));
+    }
+
+    /**
+       Append as many of the \c length bytes at \c bytes as there is
+       room for.  Writer side.
+
+       \returns the number of bytes written
+     */
+    u32 Write(const u8 * bytes, u32 length) ;
+
+    /**
+       Append all \c length bytes at \c bytes, or none of them if
+       there isn't room, so they reach the reader together.  Writer
+       side.
+
+       \returns true if they were written
+     */
+    bool WriteAll(const u8 * bytes, u32 length) ;
+
+    /**
+       Append all \c length bytes at \c bytes, waiting for the reader
+       to make room as needed.  \c length may exceed CAPACITY.
+       Writer side.
+     */
+    void WriteBlocking(const u8 * bytes, u32 length) ;
+
+    /**
+       Take up to \c length bytes into \c bytes.  Reader side.
+
+       \returns the number of bytes read
+     */
+    u32 Read(u8 * bytes, u32 length) ;
+
+    /**
+       Take exactly \c length bytes into \c bytes, or none if fewer
+       are available.  Reader side.
+
+       \returns true if they were read
+     */
+    bool ReadAll(u8 * bytes, u32 length) ;
+
+    /**
+       Take exactly \c length bytes into \c bytes, waiting for the
+       writer as needed.  \c length may exceed CAPACITY.  Reader
+       side.
+     */
+    void ReadBlocking(u8 * bytes, u32 length) ;
+
+  private:
+    /* Writer's line */
+    u32 m_writeIndex __attribute__ ((aligned (CACHE_LINE_BYTES)));
+    u32 m_readIndexSeen;        // Writer's last look at m_readIndex
+
+    /* Reader's line */
+    u32 m_readIndex __attribute__ ((aligned (CACHE_LINE_BYTES)));
+    u32 m_writeIndexSeen;       // Reader's last look at m_writeIndex
+
+    /* Only touched when blocking */
+    u32 m_readerWaiting __attribute__ ((aligned (CACHE_LINE_BYTES)));
+    u32 m_writerWaiting;
+    pthread_mutex_t m_waitLock;
+    pthread_cond_t m_readable;
+    pthread_cond_t m_writable;
+
+    u8 m_data[CAPACITY] __attribute__ ((aligned (CACHE_LINE_BYTES)));
+
+    void CopyIn(u32 at, const u8 * bytes, u32 length) ;
+    void CopyOut(u32 at, u8 * bytes, u32 length) const ;
+
+    /** Signal \c cond if the other side says it's waiting on it */
+    void Wake(u32 & waiting, pthread_cond_t & cond) ;
+
+    /** Wait on \c cond until this side has something to do */
+    void Wait(u32 & waiting, pthread_cond_t & cond, bool forReader) ;
+
+    // Declare away; the indices and sync objects are not copyable
+    SPSCQueue(const SPSCQueue &) ;
+    SPSCQueue & operator=(const SPSCQueue &) ;
+  };
+} /* namespace MFM */
+
+#include "SPSCQueue.tcc"
+
+#endif /* SPSCQUEUE_H */
@@ -0,0 +1,171 @@
+/* -*- C++ -*- */
+#include <string.h>  /* For memcpy */
+
+namespace MFM
+{
+  template <u32 CAPACITY>
+  SPSCQueue<CAPACITY>::SPSCQueue()
+    : m_writeIndex(0)
+    , m_readIndexSeen(0)
+    , m_readIndex(0)
+    , m_writeIndexSeen(0)
+    , m_readerWaiting(0)
+    , m_writerWaiting(0)
+  {
+    COMPILATION_REQUIREMENT<CAPACITY != 0 && (CAPACITY & (CAPACITY - 1)) == 0>();
+    MFM_API_ASSERT(!pthread_mutex_init(&m_waitLock, NULL), LOCK_FAILURE);
+    MFM_API_ASSERT(!pthread_cond_init(&m_readable, NULL), LOCK_FAILURE);
+    MFM_API_ASSERT(!pthread_cond_init(&m_writable, NULL), LOCK_FAILURE);
+  }
+
+  template <u32 CAPACITY>
+  SPSCQueue<CAPACITY>::~SPSCQueue()
+  {
+    pthread_cond_destroy(&m_writable);
+    pthread_cond_destroy(&m_readable);
+    pthread_mutex_destroy(&m_waitLock);
+  }
+
+  template <u32 CAPACITY>
+  void SPSCQueue<CAPACITY>::CopyIn(u32 at, const u8 * bytes, u32 length)
+  {
+    const u32 start = at & (CAPACITY - 1);
+    const u32 first = CAPACITY - start < length ? CAPACITY - start : length;
+    memcpy(&m_data[start], bytes, first);
+    memcpy(&m_data[0], bytes + first, length - first);
+  }
+
+  template <u32 CAPACITY>
+  void SPSCQueue<CAPACITY>::CopyOut(u32 at, u8 * bytes, u32 length) const
+  {
+    const u32 start = at & (CAPACITY - 1);
+    const u32 first = CAPACITY - start < length ? CAPACITY - start : length;
+    memcpy(bytes, &m_data[start], first);
+    memcpy(bytes + first, &m_data[0], length - first);
+  }
+
+  template <u32 CAPACITY>
+  void SPSCQueue<CAPACITY>::Wake(u32 & waiting, pthread_cond_t & cond)
+  {
+    // Pairs with the fence in Wait: either we see its flag, or it
+    // sees the index we just published
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (!__atomic_load_n(&waiting, __ATOMIC_RELAXED))
+    {
+      return;
+    }
+    pthread_mutex_lock(&m_waitLock);
+    pthread_cond_signal(&cond);
+    pthread_mutex_unlock(&m_waitLock);
+  }
+
+  template <u32 CAPACITY>
+  void SPSCQueue<CAPACITY>::Wait(u32 & waiting, pthread_cond_t & cond, bool forReader)
+  {
+    pthread_mutex_lock(&m_waitLock);
+    __atomic_store_n(&waiting, 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    while ((forReader ? GetReadable() : GetWritable()) == 0)
+    {
+      MFM_API_ASSERT(!pthread_cond_wait(&cond, &m_waitLock), LOCK_FAILURE);
+    }
+    __atomic_store_n(&waiting, 0, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&m_waitLock);
+  }
+
+  template <u32 CAPACITY>
+  u32 SPSCQueue<CAPACITY>::Write(const u8 * bytes, u32 length)
+  {
+    MFM_API_ASSERT_NONNULL(bytes);
+    const u32 w = m_writeIndex;
+    u32 room = CAPACITY - (w - m_readIndexSeen);
+    if (room < length)
+    {
+      m_readIndexSeen = __atomic_load_n(&m_readIndex, __ATOMIC_ACQUIRE);
+      room = CAPACITY - (w - m_readIndexSeen);
+    }
+    const u32 n = room < length ? room : length;
+    if (n == 0)
+    {
+      return 0;
+    }
+    CopyIn(w, bytes, n);
+    __atomic_store_n(&m_writeIndex, w + n, __ATOMIC_RELEASE);
+    Wake(m_readerWaiting, m_readable);
+    return n;
+  }
+
+  template <u32 CAPACITY>
+  bool SPSCQueue<CAPACITY>::WriteAll(const u8 * bytes, u32 length)
+  {
+    if (length > CAPACITY - (m_writeIndex - m_readIndexSeen))
+    {
+      m_readIndexSeen = __atomic_load_n(&m_readIndex, __ATOMIC_ACQUIRE);
+      if (length > CAPACITY - (m_writeIndex - m_readIndexSeen))
+      {
+        return false;
+      }
+    }
+    return Write(bytes, length) == length;
+  }
+
+  template <u32 CAPACITY>
+  void SPSCQueue<CAPACITY>::WriteBlocking(const u8 * bytes, u32 length)
+  {
+    u32 done = 0;
+    while (true)
+    {
+      done += Write(bytes + done, length - done);
+      if (done == length) break;
+      Wait(m_writerWaiting, m_writable, false);
+    }
+  }
+
+  template <u32 CAPACITY>
+  u32 SPSCQueue<CAPACITY>::Read(u8 * bytes, u32 length)
+  {
+    MFM_API_ASSERT_NONNULL(bytes);
+    const u32 r = m_readIndex;
+    u32 avail = m_writeIndexSeen - r;
+    if (avail < length)
+    {
+      m_writeIndexSeen = __atomic_load_n(&m_writeIndex, __ATOMIC_ACQUIRE);
+      avail = m_writeIndexSeen - r;
+    }
+    const u32 n = avail < length ? avail : length;
+    if (n == 0)
+    {
+      return 0;
+    }
+    CopyOut(r, bytes, n);
+    __atomic_store_n(&m_readIndex, r + n, __ATOMIC_RELEASE);
+    Wake(m_writerWaiting, m_writable);
+    return n;
+  }
+
+  template <u32 CAPACITY>
+  bool SPSCQueue<CAPACITY>::ReadAll(u8 * bytes, u32 length)
+  {
+    if (length > m_writeIndexSeen - m_readIndex)
+    {
+      m_writeIndexSeen = __atomic_load_n(&m_writeIndex, __ATOMIC_ACQUIRE);
+      if (length > m_writeIndexSeen - m_readIndex)
+      {
+        return false;
+      }
+    }
+    return Read(bytes, length) == length;
+  }
+
+  template <u32 CAPACITY>
+  void SPSCQueue<CAPACITY>::ReadBlocking(u8 * bytes, u32 length)
+  {
+    u32 done = 0;
+    while (true)
+    {
+      done += Read(bytes + done, length - done);
+      if (done == length) break;
+      Wait(m_readerWaiting, m_readable, true);
+    }
+  }
+} /* namespace MFM */
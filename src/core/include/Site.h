@@ -30,18 +30,170 @@
 #include "itype.h"
 #include "AtomConfig.h"
 #include "Base.h"
+#include "BaseLayer.h"
 #include "AtomSerializer.h"
 
 namespace MFM
 {
 
+  /**
+     How a Site's atom and Base are stored.  INTERLEAVED keeps them
+     inside each Site.  PLANAR keeps them in parallel arrays supplied
+     by the tile (see SizedTile), so the atoms of adjacent sites are
+     contiguous and event window loads touch no Base, sensor, or
+     paint cache lines; the Bases are a BaseLayer, allocated only
+     once one is written.
+   */
+  enum SiteLayout
+  {
+    SITE_LAYOUT_INTERLEAVED,
+    SITE_LAYOUT_PLANAR
+  };
+
+  /**
+     The layout-dependent part of a Site: where its atom and Base
+     live.
+   */
+  template <class AC, SiteLayout LAYOUT, u32 FEATURES>
+  struct SiteFields;
+
+  template <class AC, u32 FEATURES>
+  struct SiteFields<AC, SITE_LAYOUT_INTERLEAVED, FEATURES>
+  {
+    typedef typename AC::ATOM_TYPE T;
+    typedef Base<AC, FEATURES> B;
+
+    T m_atom;
+    B m_base;
+
+    T & Atom() { return m_atom; }
+    const T & Atom() const { return m_atom; }
+
+    B & GetBase() { return m_base; }
+    const B & GetBase() const { return m_base; }
+
+    bool HasOwnBase() const { return true; }
+
+    void BindPlanes(T *, BaseLayer<B> *, u32) { }
+  };
+
+  template <class AC, u32 FEATURES>
+  struct SiteFields<AC, SITE_LAYOUT_PLANAR, FEATURES>
+  {
+    typedef typename AC::ATOM_TYPE T;
+    typedef Base<AC, FEATURES> B;
+
+    T * m_atom;
+    BaseLayer<B> * m_baseLayer;
+    u32 m_baseIndex;
+
+    SiteFields()
+      : m_atom(0)
+      , m_baseLayer(0)
+      , m_baseIndex(0)
+    { }
+
+    /**
+       Assignment copies the atom and Base between the planes; each
+       SiteFields stays bound to its own slots.  Copying an unwritten
+       Base onto another leaves both layers unallocated.
+     */
+    SiteFields & operator=(const SiteFields & other)
+    {
+      *m_atom = *other.m_atom;
+      if (HasOwnBase() || other.HasOwnBase())
+      {
+        GetBase() = other.GetBase();
+      }
+      return *this;
+    }
+
+    T & Atom() { return *m_atom; }
+    const T & Atom() const { return *m_atom; }
+
+    /** Writable, so this allocates the tile's Base layer if need be */
+    B & GetBase() { return m_baseLayer->Write(m_baseIndex); }
+    const B & GetBase() const { return m_baseLayer->Read(m_baseIndex); }
+
+    bool HasOwnBase() const { return m_baseLayer->IsAllocated(); }
+
+    void BindPlanes(T * atom, BaseLayer<B> * baseLayer, u32 baseIndex)
+    {
+      m_atom = atom;
+      m_baseLayer = baseLayer;
+      m_baseIndex = baseIndex;
+    }
+
+  private:
+    SiteFields(const SiteFields &) ; // An unbound copy would alias its source
+  };
+
+  /**
+     Storage for a Site's event counts, if it has them.
+   */
+  template <bool HAS_EVENTS>
+  struct SiteEventCounts
+  {
+    u64 m_eventCount;
+    u64 m_lastChangedEventCount;  // in units of Site event count
+    u64 m_lastEventNumber;        // in units of total tile events
+
+    SiteEventCounts()
+      : m_eventCount(0)
+      , m_lastChangedEventCount(0)
+      , m_lastEventNumber(0)
+    { }
+
+    void RecordEvent(u64 eventNumber)
+    {
+      ++m_eventCount;
+      m_lastEventNumber = eventNumber;
+    }
+
+    void SetEventCounts(u64 count, u64 lastChanged, u64 lastEventNumber)
+    {
+      m_eventCount = count;
+      m_lastChangedEventCount = lastChanged;
+      m_lastEventNumber = lastEventNumber;
+    }
+
+    void ClearEventCounts()
+    {
+      m_eventCount = 0;
+      m_lastChangedEventCount = 0;
+    }
+
+    void MarkChangedEvent() { m_lastChangedEventCount = m_eventCount; }
+
+    u64 EventCount() const { return m_eventCount; }
+    u64 LastChangedEventCount() const { return m_lastChangedEventCount; }
+    u64 LastEventNumber() const { return m_lastEventNumber; }
+  };
+
+  template <>
+  struct SiteEventCounts<false>
+  {
+    void RecordEvent(u64) { }
+    void SetEventCounts(u64, u64, u64) { }
+    void ClearEventCounts() { }
+    void MarkChangedEvent() { }
+
+    u64 EventCount() const { return 0; }
+    u64 LastChangedEventCount() const { return 0; }
+    u64 LastEventNumber() const { return 0; }
+  };
+
   /**
      A Site holds a Base and an Atom, and all information associated
      with that Atom, such as access times, ages, and so forth.  It is
-     a template depending only on an AtomConfig (AC).
+     a template depending on an AtomConfig (AC) and, optionally, a
+     SiteLayout and the SiteFeature bits to keep.  Without
+     SITE_FEATURE_EVENTS, all event counts and ages read as 0, so
+     event window warp has nothing to go on.
    */
-  template <class AC>
-  class Site
+  template <class AC, SiteLayout LAYOUT = SITE_LAYOUT_INTERLEAVED,
+            u32 FEATURES = SITE_FEATURES_ALL>
+  class Site : private SiteEventCounts<(FEATURES & SITE_FEATURE_EVENTS) != 0>
   {
   public:
     /**
@@ -52,45 +204,48 @@ namespace MFM
     // Extract short names for parameter types
     typedef typename ATOM_CONFIG::ATOM_TYPE T;
 
+    /**
+       The Base type of this Site
+     */
+    typedef Base<AC, FEATURES> BASE;
+
+    enum { IS_PLANAR = (LAYOUT == SITE_LAYOUT_PLANAR) };
+
+    enum { SITE_FEATURES = FEATURES };
+
   private:
-    T m_atom;
-    Base<AC> m_base;
-    u64 m_eventCount;
-    u64 m_lastChangedEventCount;  // in units of Site event count
-    u64 m_lastEventNumber;        // in units of total tile events
+    typedef SiteEventCounts<(FEATURES & SITE_FEATURE_EVENTS) != 0> Counts;
+
+    SiteFields<AC, LAYOUT, FEATURES> m_fields;
     bool m_isLiveSite;
 
   public:
     Site()
-      : m_eventCount(0)
-      , m_lastChangedEventCount(0)
-      , m_lastEventNumber(0)
-      , m_isLiveSite(true)
+      : m_isLiveSite(true)
     { }
 
     void RecordEventAtSite(u64 eventNumber)
     {
-      ++m_eventCount;
-      m_lastEventNumber = eventNumber;
+      Counts::RecordEvent(eventNumber);
     }
 
     void SaveConfig(ByteSink& bs, AtomTypeFormatter<AC> & atf) const
     {
       bs.Printf(",%D", m_isLiveSite);
       // 64 bit stuff not yet exposed via Printf..
-      bs.Print(m_eventCount, Format::LXX64);
-      bs.Print(m_lastChangedEventCount, Format::LXX64);
-      bs.Print(m_lastEventNumber, Format::LXX64);
+      bs.Print(GetEventCount(), Format::LXX64);
+      bs.Print(GetLastChangedEventCount(), Format::LXX64);
+      bs.Print(GetLastEventNumber(), Format::LXX64);
 
       {
-        T tmp = m_atom;
+        T tmp = m_fields.Atom();
         bs.Printf(",");
         atf.PrintAtomType(tmp, bs);
         AtomSerializer<AC> as(tmp);
         bs.Printf(",%@", &as);
       }
 
-      m_base.SaveConfig(bs, atf);
+      m_fields.GetBase().SaveConfig(bs, atf);
     }
 
     bool LoadConfig(LineCountingByteSource& bs, AtomTypeFormatter<AC> & atf)
@@ -126,22 +281,22 @@ namespace MFM
         }
       }
 
-      if (!m_base.LoadConfig(bs, atf))
+      if (!m_fields.GetBase().LoadConfig(bs, atf))
         return false;
 
-      m_atom = defaultAtom;
+      m_fields.Atom() = defaultAtom;
 
       m_isLiveSite = tmp_m_isLiveSite;
-      m_eventCount = tmp_m_eventCount;
-      m_lastChangedEventCount = tmp_m_lastChangedEventCount;
-      m_lastEventNumber = tmp_m_lastEventNumber;
+      Counts::SetEventCounts(tmp_m_eventCount,
+                             tmp_m_lastChangedEventCount,
+                             tmp_m_lastEventNumber);
 
       return true;
     }
 
     void Sense(SiteTouchType stt)
     {
-      m_base.GetSensory().Touch(stt, m_eventCount);
+      m_fields.GetBase().Touch(stt, GetEventCount());
     }
 
     bool InRecentProximity() const
@@ -151,7 +306,7 @@ namespace MFM
 
     u32 RecentTouch() const
     {
-      return m_base.GetSensory().RecentTouch(m_eventCount);
+      return m_fields.GetBase().GetSensory().RecentTouch(GetEventCount());
     }
 
     bool HasRecentLightTouch()
@@ -159,12 +314,27 @@ namespace MFM
       return TOUCH_TYPE_LIGHT == RecentTouch();
     }
 
-    void PutAtom(const T & newAtom) { m_atom = newAtom; }
-    T & GetAtom() { return m_atom; }
-    const T & GetAtom() const { return m_atom; }
+    void PutAtom(const T & newAtom) { m_fields.Atom() = newAtom; }
+    T & GetAtom() { return m_fields.Atom(); }
+    const T & GetAtom() const { return m_fields.Atom(); }
+
+    BASE & GetBase() { return m_fields.GetBase(); }
+    const BASE & GetBase() const { return m_fields.GetBase(); }
+
+    /**
+       Attach a PLANAR site to its atom slot and its slot \a baseIndex
+       in \a baseLayer; a no-op for INTERLEAVED sites.
+     */
+    void BindPlanes(T * atom, BaseLayer<BASE> * baseLayer, u32 baseIndex)
+    {
+      m_fields.BindPlanes(atom, baseLayer, baseIndex);
+    }
 
-    Base<AC> & GetBase() { return m_base; }
-    const Base<AC> & GetBase() const { return m_base; }
+    /**
+       False while this PLANAR site reads its tile's shared empty Base
+       layer; non-const GetBase, SetPaint, and Sense change that.
+     */
+    bool HasOwnBase() const { return m_fields.HasOwnBase(); }
 
     u32 GetPaint() const {
       return GetBase().GetPaint();
@@ -175,30 +345,36 @@ namespace MFM
     }
 
     void Clear() {
-      m_atom.SetEmpty();
-      m_eventCount = 0;
-      m_lastChangedEventCount = 0;
-      m_base.GetSensory().Clear();
+      m_fields.Atom().SetEmpty();
+      Counts::ClearEventCounts();
+      if (m_fields.HasOwnBase())
+      {
+        m_fields.GetBase().ClearSensory();
+      }
     }
 
     u64 GetEventCount() const {
-      return m_eventCount;
+      return Counts::EventCount();
     }
 
     u64 GetLastChangedEventCount() const {
-      return m_lastChangedEventCount;
+      return Counts::LastChangedEventCount();
     }
 
     void MarkChanged() {
-      m_lastChangedEventCount = m_eventCount;
+      Counts::MarkChangedEvent();
     }
 
     u64 GetWriteAge() const {
-      return m_eventCount - m_lastChangedEventCount;
+      return GetEventCount() - GetLastChangedEventCount();
+    }
+
+    u64 GetLastEventNumber() const {
+      return Counts::LastEventNumber();
     }
 
     u64 GetEventAge(u64 currentEventNumber) const {
-      return m_lastEventNumber - currentEventNumber;
+      return GetLastEventNumber() - currentEventNumber;
     }
 
   };
@@ -34,20 +34,154 @@
 namespace MFM
 {
 
+  /**
+     The site storage of a SizedTile, constructed before the Tile base
+     so that the sites (and, for a PLANAR SiteLayout, their atom plane
+     and Base layer) are ready when Tile's constructor clears them.
+   */
+  template <class SITE, u32 SITES>
+  struct SizedTileStorage
+  {
+    typedef typename SITE::ATOM_CONFIG AC;
+    typedef typename AC::ATOM_TYPE T;
+    typedef typename SITE::BASE B;
+
+    enum { PLANE_SITES = SITE::IS_PLANAR ? SITES : 1 };
+
+    SITE m_sites[SITES];
+    T m_atomPlane[PLANE_SITES];
+    BaseLayer<B> m_baseLayer;
+
+    SizedTileStorage()
+    {
+      if (SITE::IS_PLANAR)
+      {
+        m_baseLayer.SetSiteCount(SITES);
+        for (u32 i = 0; i < SITES; ++i)
+        {
+          m_sites[i].BindPlanes(&m_atomPlane[i], &m_baseLayer, i);
+        }
+      }
+    }
+  };
+
   /**
      A SizedTile provides a completed Tile, possessing a size and site
      storage, and offering a default constructor so that arrays of
-     SizedTiles can be formed.
+     SizedTiles can be formed.  Its EVENTHISTORYSIZE items of event
+     history live on the heap, and only once history is recorded, so
+     tiles that never record it carry none.
    */
   template <class EC, u32 WIDTH, u32 HEIGHT, u32 EVENTHISTORYSIZE>
-  class SizedTile : public MFMSTile<EC>
+  class SizedTile
+    : private SizedTileStorage<typename EC::SITE, WIDTH * HEIGHT>
+    , public MFMSTile<EC>
   {
+    typedef SizedTileStorage<typename EC::SITE, WIDTH * HEIGHT> Storage;
+
+    typedef Tile<EC> Super;
+
   public:
     typedef typename EC::SITE SITE;
 
+    enum { R = EC::EVENT_WINDOW_RADIUS };
+
     enum { TILE_WIDTH = WIDTH };
     enum { TILE_HEIGHT = HEIGHT };
     enum { TILE_SITES = TILE_WIDTH * TILE_HEIGHT };
+    enum { OWNED_WIDTH = TILE_WIDTH - 2 * R };
+    enum { OWNED_HEIGHT = TILE_HEIGHT - 2 * R };
+
+    /*
+      Compile-time versions of Tile's geometry queries.  They hide
+      Tile's, which compare against its runtime TILE_WIDTH and
+      friends, so code holding a SizedTile (like Grid with its
+      GridTile) gets them constant-folded.  Same results, same
+      failures.
+     */
+
+    static bool IsInTile(const SPoint & pt)
+    {
+      // Unsigned so possible negative coords wrap around to big positives
+      return ((u32) pt.GetX()) < TILE_WIDTH && ((u32) pt.GetY()) < TILE_HEIGHT;
+    }
+
+    static bool IsInUncachedTile(const SPoint & pt)
+    {
+      return ((u32) pt.GetX()) < OWNED_WIDTH && ((u32) pt.GetY()) < OWNED_HEIGHT;
+    }
+
+    static bool IsInCache(const SPoint & pt)
+    {
+      MFM_API_ASSERT_ARG(IsInTile(pt));
+      return !IsInBand(pt, R);
+    }
+
+    static bool IsInShared(const SPoint & pt)
+    {
+      MFM_API_ASSERT_ARG(IsInTile(pt));
+      return !IsInBand(pt, 2 * R);
+    }
+
+    static bool IsInHidden(const SPoint & pt)
+    {
+      MFM_API_ASSERT_ARG(IsInTile(pt));
+      return IsInBand(pt, 3 * R);
+    }
+
+    static bool IsOwnedSite(const SPoint & pt)
+    {
+      return !IsInCache(pt);
+    }
+
+    static u32 GetSiteInTileNumber(const SPoint index)
+    {
+      MFM_API_ASSERT_ARG(IsInTile(index));
+      return ((u32) index.GetY()) * TILE_WIDTH + (u32) index.GetX();
+    }
+
+    static SPoint GetCoordOfSiteInTileNumber(u32 siteInTileNumber)
+    {
+      MFM_API_ASSERT_ARG(siteInTileNumber < TILE_SITES);
+      return SPoint(siteInTileNumber % TILE_WIDTH, siteInTileNumber / TILE_WIDTH);
+    }
+
+    static typename Super::Region RegionIn(const SPoint & pt)
+    {
+      return MIN(RegionFromIndex((u32) pt.GetX(), TILE_WIDTH),
+                 RegionFromIndex((u32) pt.GetY(), TILE_HEIGHT));
+    }
+
+    const SITE & GetSite(const SPoint index) const
+    {
+      return Storage::m_sites[GetSiteInTileNumber(index)];
+    }
+
+    SITE & GetSite(const SPoint index)
+    {
+      return Storage::m_sites[GetSiteInTileNumber(index)];
+    }
+
+    const SITE & GetUncachedSite(const SPoint index) const
+    {
+      return GetSite(index + SPoint(R, R));
+    }
+
+    SITE & GetUncachedSite(const SPoint index)
+    {
+      return GetSite(index + SPoint(R, R));
+    }
+
+    /**
+       Add what this SizedTile holds to \c account: its site storage,
+       and then what Tile::AccountMemory finds.
+     */
+    void AccountMemory(MemoryAccount & account) const
+    {
+      account.Add(MemoryAccount::SITES, sizeof(Storage));
+      Super::AccountMemory(account);
+      account.Add(MemoryAccount::TILES, sizeof(*this) - sizeof(Storage) - sizeof(Super));
+    }
 
     static void SetGridLayoutPattern(GridLayoutPattern layout){ m_ctorLayoutPattern = layout; }
 
@@ -55,14 +189,38 @@ namespace MFM
 
     static bool IsGridLayoutPatternStaggered() { return (m_ctorLayoutPattern == GRID_LAYOUT_STAGGERED); }
 
-    SizedTile(): MFMSTile<EC>(TILE_WIDTH, TILE_HEIGHT, m_ctorLayoutPattern, m_sites, EVENTHISTORYSIZE, m_items) { }
+    SizedTile()
+      : Storage()
+      , MFMSTile<EC>(TILE_WIDTH, TILE_HEIGHT, m_ctorLayoutPattern, Storage::m_sites, EVENTHISTORYSIZE, 0)
+    { }
 
 
   private:
-    SITE m_sites[TILE_SITES];
-    EventHistoryItem m_items[EVENTHISTORYSIZE];
     static GridLayoutPattern m_ctorLayoutPattern;
 
+    /** true if pt is at least \c indent sites in from every edge */
+    static bool IsInBand(const SPoint & pt, const s32 indent)
+    {
+      return
+        pt.GetX() >= indent && pt.GetX() < (s32) TILE_WIDTH - indent &&
+        pt.GetY() >= indent && pt.GetY() < (s32) TILE_HEIGHT - indent;
+    }
+
+    static typename Super::Region RegionFromIndex(const u32 index, const u32 tileSide)
+    {
+      MFM_API_ASSERT_ARG(index < tileSide);
+      const u32 hiddenDim = tileSide - R * 6;
+      if (index < R * Super::REGION_HIDDEN)
+      {
+        return (typename Super::Region) (index / R);
+      }
+      if (index >= R * Super::REGION_HIDDEN + hiddenDim)
+      {
+        return (typename Super::Region) ((tileSide - index - 1) / R);
+      }
+      return Super::REGION_HIDDEN;
+    }
+
   };
 
   //define static member for template instances here
@@ -0,0 +1,125 @@
+/*                                              -*- mode:C++ -*-
+  StatisticsRing.h Fixed-size ring of numeric statistics samples
+  Copyright (C) 2020 The Living Computation Foundation.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+  USA
+*/
+
+/**
+  \file StatisticsRing.h Fixed-size ring of numeric statistics samples
+  \author David H. Ackley.
+  \date (C) 2020 All rights reserved.
+  \lgpl
+ */
+
+#ifndef STATISTICSRING_H
+#define STATISTICSRING_H
+
+#include "itype.h"
+#include "Fail.h"
+
+namespace MFM {
+
+  /**
+     Up to SAMPLES samples, each of up to MAX_VALUES raw u64 values,
+     kept in place so capturing a sample costs no allocation and no
+     formatting.  Whoever owns the ring formats the samples only when
+     they're displayed or flushed.  When the ring is full, Append
+     overwrites the oldest sample, so owners that mustn't lose any
+     should flush when IsFull().
+   */
+  template <u32 SAMPLES, u32 MAX_VALUES>
+  class StatisticsRing {
+  public:
+    StatisticsRing()
+      : m_oldest(0)
+      , m_count(0)
+      , m_dropped(0)
+    { }
+
+    /**
+       @returns the values of a new sample, to be filled in by the
+       caller.  They start out zero.
+
+       @fails ILLEGAL_ARGUMENT if values exceeds MAX_VALUES
+     */
+    u64 * Append(u32 values)
+    {
+      MFM_API_ASSERT_ARG(values <= MAX_VALUES);
+      if (m_count == SAMPLES)
+      {
+        m_oldest = (m_oldest + 1) % SAMPLES;
+        --m_count;
+        ++m_dropped;
+      }
+      Sample & s = m_samples[(m_oldest + m_count) % SAMPLES];
+      ++m_count;
+      s.m_length = values;
+      for (u32 i = 0; i < values; ++i) s.m_values[i] = 0;
+      return s.m_values;
+    }
+
+    /**
+       The index'th sample still held, oldest first, with its number
+       of values in values.
+
+       @fails ARRAY_INDEX_OUT_OF_BOUNDS unless index < GetCount()
+     */
+    const u64 * Get(u32 index, u32 & values) const
+    {
+      if (index >= m_count) FAIL(ARRAY_INDEX_OUT_OF_BOUNDS);
+      const Sample & s = m_samples[(m_oldest + index) % SAMPLES];
+      values = s.m_length;
+      return s.m_values;
+    }
+
+    u32 GetCount() const
+    {
+      return m_count;
+    }
+
+    bool IsFull() const
+    {
+      return m_count == SAMPLES;
+    }
+
+    /** How many samples Append has overwritten before they were cleared */
+    u32 GetDroppedCount() const
+    {
+      return m_dropped;
+    }
+
+    void Clear()
+    {
+      m_oldest = 0;
+      m_count = 0;
+    }
+
+  private:
+    struct Sample {
+      u32 m_length;
+      u64 m_values[MAX_VALUES];
+    };
+
+    Sample m_samples[SAMPLES];
+    u32 m_oldest;
+    u32 m_count;
+    u32 m_dropped;
+  };
+
+} //MFM
+
+#endif /* STATISTICSRING_H */
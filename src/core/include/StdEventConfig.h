@@ -31,11 +31,25 @@
 #include "EventConfig.h"
 #include "Site.h"
 #include "P3Atom.h"
+#include "P1Atom.h"
 
 namespace MFM {
   typedef P3Atom StdAtom;
   typedef Site<P3AtomConfig> StdSite;
   typedef EventConfig<StdSite, 4> StdEventConfig;
+
+  typedef Site<P3AtomConfig, SITE_LAYOUT_PLANAR> StdPlanarSite;
+  typedef EventConfig<StdPlanarSite, 4> StdPlanarEventConfig;
+
+  /* No event counts, touch, or paint: for headless runs without warp */
+  typedef Site<P3AtomConfig, SITE_LAYOUT_INTERLEAVED, SITE_FEATURES_NONE> StdLeanSite;
+  typedef EventConfig<StdLeanSite, 4> StdLeanEventConfig;
+
+  /* 64 bit atoms in planar sites, for memory-bound physics that fit
+     in 39 state bits */
+  typedef P1Atom StdCompactAtom;
+  typedef Site<P1AtomConfig, SITE_LAYOUT_PLANAR> StdCompactSite;
+  typedef EventConfig<StdCompactSite, 4> StdCompactEventConfig;
 }
 
 #endif /* STDEVENTCONFIG_H */
@@ -0,0 +1,102 @@
+/*                                              -*- mode:C++ -*-
+  SweepRule.h A behavior simple enough to run as a data-parallel kernel
+  Copyright (C) 2020 The Living Computation Foundation.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+  USA
+*/
+
+/**
+  \file SweepRule.h A behavior simple enough to run as a data-parallel kernel
+  \date (C) 2020 All rights reserved.
+  \lgpl
+ */
+#ifndef SWEEPRULE_H
+#define SWEEPRULE_H
+
+#include "itype.h"
+#include "Fail.h"
+
+namespace MFM
+{
+  /**
+     The behavior of a simple, stateless element, described as data
+     so that a TileSweeper can run it over many non-overlapping event
+     windows at once, with no virtual calls and no EventWindow.  An
+     event under a SweepRule:
+
+       1. picks one Von Neumann neighbor of the center at random;
+
+       2. tries the rewrites in order, skipping those whose
+          m_fromType doesn't match the neighbor's type.  The first
+          match rewrites the neighbor to the default atom of
+          m_toType with odds 1 in m_oneIn (never, if m_oneIn is 0),
+          and ends the search unless it didn't fire and m_orElse is
+          set;
+
+       3. if m_diffuses, picks a second random Von Neumann neighbor
+          and swaps the center with it if it's empty.
+
+     Step 3 only approximates EventWindow::Diffuse, which weighs every
+     site in the window by its element's Diffusability.
+
+     A SweepRule is plain old data, so it could be copied as is to an
+     accelerator that knows how to apply it.
+   */
+  struct SweepRule
+  {
+    enum
+    {
+      MAX_REWRITES = 6,
+      ANY_TYPE = 0xffffffff       // A m_fromType matching every type
+    };
+
+    struct Rewrite
+    {
+      u32 m_fromType;
+      u32 m_toType;
+      u32 m_oneIn;
+      bool m_orElse;
+    };
+
+    Rewrite m_rewrites[MAX_REWRITES];
+    u32 m_rewriteCount;
+    bool m_diffuses;
+
+    void Clear()
+    {
+      m_rewriteCount = 0;
+      m_diffuses = false;
+    }
+
+    /**
+       Append a rewrite.
+
+       @fails OUT_OF_ROOM if there are MAX_REWRITES already
+     */
+    void AddRewrite(u32 fromType, u32 toType, u32 oneIn, bool orElse)
+    {
+      MFM_API_ASSERT(m_rewriteCount < MAX_REWRITES, OUT_OF_ROOM);
+      Rewrite & rw = m_rewrites[m_rewriteCount++];
+      rw.m_fromType = fromType;
+      rw.m_toType = toType;
+      rw.m_oneIn = oneIn;
+      rw.m_orElse = orElse;
+    }
+  };
+
+} /* namespace MFM */
+
+#endif /* SWEEPRULE_H */
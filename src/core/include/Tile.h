@@ -43,7 +43,15 @@
 #include "ElementTable.h"
 #include "CacheProcessor.h"
 #include "UlamClassRegistry.h"
+#include "UlamTransientArena.h"
 #include "LonglivedLock.h"
+#include "EventPhaseTimer.h"
+#include "MemoryAccount.h"
+#include "ElementProfile.h"
+#include "DatumQueues.h"
+#include "FlightRecorder.h"
+#include "EventAgeIndex.h"
+#include "TileParameters.h"
 #include "OverflowableCharBufferByteSink.h"  /* for OString16 */
 #include "LineCountingByteSource.h"
 
@@ -137,6 +145,11 @@ namespace MFM
       REGION_COUNT
     };
 
+    /**
+       Make a tile over \c sites.  Its event history holds \c
+       eventbuffersize items, kept in \c items if that is non-null
+       and otherwise allocated only once history is first recorded.
+     */
     Tile(const u32 tileWidth, const u32 tileHeight, const GridLayoutPattern gridlayout, S * sites, const u32 eventbuffersize, EventHistoryItem * items) ;
 
     virtual ~Tile() ;
@@ -149,10 +162,17 @@ namespace MFM
 
     void SetHistoryActive(bool active) { return GetEventHistoryBuffer().SetHistoryActive(active); }
 
+    void ReleaseHistory() { GetEventHistoryBuffer().ReleaseHistory(); }
+
     const EventHistoryBuffer<EC> & GetEventHistoryBuffer() const { return m_eventHistoryBuffer; }
 
     EventHistoryBuffer<EC> & GetEventHistoryBuffer() { return m_eventHistoryBuffer; }
 
+    /** The always-on record of this Tile's last few hundred events */
+    const FlightRecorder & GetFlightRecorder() const { return m_flightRecorder; }
+
+    FlightRecorder & GetFlightRecorder() { return m_flightRecorder; }
+
     /**
        Get the site-in-tile number of a given position \c index of the
        tile, \e including the caches, so index ranges from
@@ -202,6 +222,88 @@ namespace MFM
       return const_cast<S &>(static_cast<const Tile<EC>*>(this)->GetSite(index));
     }
 
+    /**
+       Get all TILE_WIDTH * TILE_HEIGHT sites of the tile, caches and
+       all, as one contiguous array in site number order (\sa
+       GetSiteInTileNumber).
+     */
+    const S * GetAllSites() const
+    {
+      return m_sites;
+    }
+
+    S * GetAllSites()
+    {
+      return m_sites;
+    }
+
+    /**
+       How many rows GetSiteSpan has: TILE_HEIGHT if \c all, including
+       the caches, else OWNED_HEIGHT.
+     */
+    u32 GetSiteSpanCount(bool all) const
+    {
+      return all ? TILE_HEIGHT : OWNED_HEIGHT;
+    }
+
+    /**
+       Get the contiguous sites of row \c row of the tile -- counting
+       from the top of the caches if \c all, else from the top of the
+       owned sites -- and set \c length to how many there are:
+       TILE_WIDTH if \c all, else OWNED_WIDTH.  A whole-tile sweep is
+       then a tight loop over each row's sites, with no coordinate
+       arithmetic or bounds checks per site:
+
+         for (u32 row = 0; row < tile.GetSiteSpanCount(all); ++row)
+         {
+           u32 length;
+           const S * sites = tile.GetSiteSpan(row, all, length);
+           for (u32 x = 0; x < length; ++x) ... sites[x] ...
+         }
+
+       The first site of the row is at tile coordinate
+       GetSiteSpanOrigin(row, all).
+     */
+    const S * GetSiteSpan(u32 row, bool all, u32 & length) const
+    {
+      const u32 indent = all ? 0 : EVENT_WINDOW_RADIUS;
+      MFM_API_ASSERT_ARG(row < TILE_HEIGHT - 2 * indent);
+      length = TILE_WIDTH - 2 * indent;
+      return &m_sites[(row + indent) * TILE_WIDTH + indent];
+    }
+
+    S * GetSiteSpan(u32 row, bool all, u32 & length)
+    {
+      return const_cast<S *>(static_cast<const Tile<EC>*>(this)->GetSiteSpan(row, all, length));
+    }
+
+    /**
+       The tile coordinate (\e including the caches) of the first site
+       of GetSiteSpan(row, all, ...)
+     */
+    SPoint GetSiteSpanOrigin(u32 row, bool all) const
+    {
+      const u32 indent = all ? 0 : EVENT_WINDOW_RADIUS;
+      return SPoint(indent, row + indent);
+    }
+
+    /**
+       Store into \c types the types of the \c count atoms starting at
+       tile coordinate \c start (\e including the caches) and running
+       in +x, which must all be in the same row.  The sites of a row
+       are contiguous, so this is just a stride through them reading
+       each atom's fixed type field.
+     */
+    void GetSiteTypes(const SPoint start, u32 count, u16 * types) const
+    {
+      MFM_API_ASSERT_ARG(count > 0 && start.GetX() + count <= TILE_WIDTH);
+      const S * site = &GetSite(start);
+      for (u32 i = 0; i < count; ++i)
+      {
+        types[i] = (u16) site[i].GetAtom().GetType();
+      }
+    }
+
     /**
        Get a const reference to the Site at position \c index of the
        tile, \e excluding the caches, so index ranges from
@@ -232,15 +334,330 @@ namespace MFM
       return OwnedCoordToTile(SPoint(GetRandom(), OWNED_WIDTH, OWNED_HEIGHT));
     }
 
+    /**
+       Enable or disable sparse event selection.  When enabled, this
+       tile keeps an index of its non-empty owned sites and
+       AdvanceComputation draws event centers from it directly.  The
+       empty-site events that uniform selection would have run in
+       between are counted (but not executed), so GetEventsExecuted
+       and AEPS are statistically unchanged.  Since empty sites then
+       never record events, their event ages grow without bound.
+     */
+    void SetSparseEvents(bool on) ;
+
+    bool IsUsingSparseEvents() const
+    {
+      return m_sparseEvents;
+    }
+
+    /**
+       Enable or disable age-weighted event selection.  When enabled
+       (and sparse events are not), this tile keeps an EventAgeIndex
+       of its owned sites, and AdvanceComputation draws event centers
+       from it with the odds RejectOnRecency would have filtered
+       uniform draws down to, skipping RejectOnRecency itself.  Few
+       draws are then turned down, however low the warp factor.
+     */
+    void SetAgedEvents(bool on) ;
+
+    bool IsUsingAgedEvents() const
+    {
+      return m_agedEvents;
+    }
+
+    /**
+       Set how many more looks an event gives an intertile lock held
+       by a neighbor before abandoning, retrying whenever it comes
+       free.  0 (the default) abandons on the first miss.  Since locks
+       are taken in a global order, spinning while holding some can't
+       deadlock.  \sa CacheProcessor::TryLock
+     */
+    void SetLockSpinCount(u32 spins)
+    {
+      m_lockSpinCount = spins;
+    }
+
+    u32 GetLockSpinCount() const
+    {
+      return m_lockSpinCount;
+    }
+
+    /**
+       Set how many event centers AdvanceComputation draws at once; 0
+       or 1 (the default) draws one per call.  A batch keeps only
+       centers that pass RejectOnRecency and whose windows don't
+       overlap an earlier keeper, so their events can run in any
+       order.  Centers on the same batchable Element (see
+       Element::IsBatchable) then go to it in one BatchBehavior call;
+       the rest run one by one.  Batches run unbatched while element
+       profiling is on.  FAILs with ILLEGAL_ARGUMENT above
+       EventWindowBatch::MAX_EVENTS.
+     */
+    void SetEventBatchSize(u32 size) ;
+
+    u32 GetEventBatchSize() const
+    {
+      return m_eventBatchSize;
+    }
+
+    /**
+       Run this tile's hidden-region events on \c workers event
+       windows at once, each on a thread of its own (the tile's thread
+       being one of them), claiming their footprints in a
+       TileSiteOwners.  0 or 1 (the default) runs every event on the
+       tile's one window, as usual.  (\sa EventWorkers.)  The workers
+       stand aside, leaving event selection as it would be without
+       them, while aged or sparse events, event batches or element
+       profiling are on.  Call only while the tile is not active.
+       FAILs with ILLEGAL_ARGUMENT above EventWorkers::MAX_WORKERS.
+     */
+    void SetEventWorkers(u32 workers) ;
+
+    u32 GetEventWorkers() const ;
+
+    /** Events run by helper windows.  \sa SetEventWorkers */
+    u64 GetHelperEvents() const ;
+
+    /**
+       Enable or disable optimistic events.  When enabled, an event
+       drawn outside the hidden region -- one that needs intertile
+       locks -- is loaded and run before any locks are taken, on a
+       second window of the tile's, which then takes them just to
+       store it back, as long as nothing under the window has changed
+       in the meantime.  If its locks are busy it stays parked, and
+       AdvanceComputation tries again first thing each time, rerunning
+       it if the window has changed, while other events -- including
+       lock-needing ones, by the usual pessimistic TryEventAt -- go
+       on.  (\sa EventWindow::TryOptimisticEventAt.)  Applies to
+       uniform and sparse one-at-a-time event selection; event
+       workers and batches take precedence, and aged events stay
+       pessimistic.  Disabling drops any parked event.
+     */
+    void SetOptimisticEvents(bool on) ;
+
+    bool IsOptimisticEvents() const
+    {
+      return m_optimisticEvents;
+    }
+
+    /** \sa EventWindow::GetOptimisticCommits */
+    u64 GetOptimisticCommits() const
+    {
+      return m_optimisticWindow ? m_optimisticWindow->GetOptimisticCommits() : 0;
+    }
+
+    /** \sa EventWindow::GetOptimisticConflicts */
+    u64 GetOptimisticConflicts() const
+    {
+      return m_optimisticWindow ? m_optimisticWindow->GetOptimisticConflicts() : 0;
+    }
+
+    /** \sa EventWindow::GetOptimisticDrops */
+    u64 GetOptimisticDrops() const
+    {
+      return m_optimisticWindow ? m_optimisticWindow->GetOptimisticDrops() : 0;
+    }
+
+    /**
+       Get the number of empty-site events skipped, and credited to
+       GetEventsExecuted, by sparse event selection.
+     */
+    u64 GetSkippedEmptyEvents() const
+    {
+      return m_skippedEmptyEvents;
+    }
+
+    /**
+       Check whether events on this tile would change nothing: it is
+       active (with no other state requested) and enabled, without
+       radiation, and every owned atom is empty or of an inert
+       Element.  A quiescent tile's events may be credited in bulk, by
+       CreditQuiescentEvents, rather than run, once its cache traffic
+       has been seen through (see IsCacheIdle and
+       AdvanceWhileQuiescent).  Call only from the thread driving this
+       tile, which first brings the atom counts up to date itself
+       (see RecountAtomsIfNeeded).
+     */
+    bool IsQuiescent() ;
+
+    /**
+       Get the number of owned sites whose events could change
+       something: those not holding an empty atom or an atom of an
+       inert Element.  \sa IsQuiescent
+     */
+    u32 GetLiveAtomCount() const ;
+
+    /**
+       Check whether every cache processor of this tile is idle or
+       unclaimed.  \sa IsQuiescent
+     */
+    bool IsCacheIdle() const ;
+
+    /**
+       Advance only this tile's cache processors, receiving and
+       answering intertile traffic without originating events, as a
+       quiescent tile does.  \returns true if anything was done
+     */
+    bool AdvanceWhileQuiescent()
+    {
+      return AdvanceCommunication();
+    }
+
+    /**
+       Count \c events as executed without running them, because this
+       tile is quiescent.  \sa IsQuiescent
+     */
+    void CreditQuiescentEvents(u64 events)
+    {
+      m_window.CreditSkippedEvents(events);
+      m_quiescentEvents += events;
+    }
+
+    /**
+       Get the number of events credited to GetEventsExecuted by
+       CreditQuiescentEvents.
+     */
+    u64 GetQuiescentEvents() const
+    {
+      return m_quiescentEvents;
+    }
+
+    /**
+       Count \c events as executed that a TileSweeper ran as a kernel,
+       outside this tile's EventWindow.  \sa TileSweeper
+     */
+    void CreditSweptEvents(u64 events)
+    {
+      m_window.CreditSkippedEvents(events);
+      m_sweptEvents += events;
+    }
+
+    /**
+       Get the number of events credited to GetEventsExecuted by
+       CreditSweptEvents.
+     */
+    u64 GetSweptEvents() const
+    {
+      return m_sweptEvents;
+    }
+
+    /**
+       Events are also tallied in EVENT_BIN_SIDE x EVENT_BIN_SIDE bins
+       of owned sites, so a coarse heatmap of where events happen can
+       be read in O(bins), without visiting every site.  Bins along
+       the right and bottom edges may be partial.
+     */
+    enum {
+      EVENT_BIN_SHIFT = 3,
+      EVENT_BIN_SIDE = 1<<EVENT_BIN_SHIFT
+    };
+
+    u32 GetEventBinsWide() const
+    {
+      return (OWNED_WIDTH + EVENT_BIN_SIDE - 1) >> EVENT_BIN_SHIFT;
+    }
+
+    u32 GetEventBinsHigh() const
+    {
+      return (OWNED_HEIGHT + EVENT_BIN_SIDE - 1) >> EVENT_BIN_SHIFT;
+    }
+
+    u32 GetEventBinCount() const
+    {
+      return GetEventBinsWide() * GetEventBinsHigh();
+    }
+
+    /**
+       Events centered in bin binNumber, numbered row by row, since
+       the last ResetEventBins
+     */
+    u64 GetEventBinEvents(u32 binNumber) const
+    {
+      MFM_API_ASSERT_ARG(binNumber < GetEventBinCount());
+      return m_eventBins[binNumber];
+    }
+
+    void ResetEventBins()
+    {
+      for (u32 i = 0; i < GetEventBinCount(); ++i)
+        m_eventBins[i] = 0;
+    }
+
+    /**
+       Sites are grouped into CHANGE_BLOCK_SIDE x CHANGE_BLOCK_SIDE
+       blocks, in tile coordinates, each with a stamp that changes
+       whenever an atom or base atom in the block is placed, so a
+       display can repaint just the blocks that changed.
+     */
+    enum {
+      CHANGE_BLOCK_SHIFT = 3,
+      CHANGE_BLOCK_SIDE = 1<<CHANGE_BLOCK_SHIFT
+    };
+
+    u32 GetChangeBlocksWide() const
+    {
+      return (TILE_WIDTH + CHANGE_BLOCK_SIDE - 1) >> CHANGE_BLOCK_SHIFT;
+    }
+
+    u32 GetChangeBlocksHigh() const
+    {
+      return (TILE_HEIGHT + CHANGE_BLOCK_SIDE - 1) >> CHANGE_BLOCK_SHIFT;
+    }
+
+    u32 GetChangeBlockCount() const
+    {
+      return GetChangeBlocksWide() * GetChangeBlocksHigh();
+    }
+
+    u32 GetChangeBlockStamp(u32 blockNumber) const
+    {
+      MFM_API_ASSERT_ARG(blockNumber < GetChangeBlockCount());
+      return m_changeBlockStamps[blockNumber];
+    }
+
+    /**
+       A stamp that changes whenever sites may have changed without
+       going through their block stamps, meaning every block should
+       be considered changed.
+     */
+    u32 GetChangeStamp() const
+    {
+      return __atomic_load_n(&m_changeStamp, __ATOMIC_ACQUIRE);
+    }
+
+    /**
+       Get the number of non-empty owned sites, according to the
+       sparse event index.  FAILs ILLEGAL_STATE if sparse event
+       selection is not enabled.
+     */
+    u32 GetOccupiedSiteCount() ;
+
+    /**
+       Get the number of owned sites holding \c atomType, or -1 if
+       it isn't in this Tile's element table.  Safe from any thread,
+       though while this Tile runs, the count may miss an event in
+       progress.
+     */
     u32 GetAtomCount(ElementType atomType) const
     {
       return m_cdata.GetAtomCount(atomType);
     }
 
+    /**
+       Rescan the owned sites into the atom counts, if anything has
+       called NeedAtomRecount since the last rescan.  Only for the
+       thread writing this Tile's owned sites; until it happens,
+       GetAtomCount scans for itself.
+     */
+    void RecountAtomsIfNeeded()
+    {
+      m_cdata.RecountIfNeeded();
+    }
+
     /**
      * The maximum number of tile parameters
      */
-    enum { MAX_TILE_PARAMETERS = 16 };
+    enum { MAX_TILE_PARAMETERS = TileParameterBlock::MAX_PARAMETERS };
 
     enum State
     {
@@ -312,14 +729,24 @@ namespace MFM
 
     UlamClassRegistry<EC> m_ucr;
 
+    /** Scratch storage for ulam transients, emptied after each event */
+    UlamTransientArena m_transientArena;
+
     s32 m_keyValues[MAX_TILE_PARAMETERS];
 
+    /** Where m_keyValues come from, if anywhere.  \sa SetTileParameterSource */
+    const TileParameterPublisher * m_parameterSource;
+
+    /** The generation of the block m_keyValues were last copied from */
+    u32 m_parameterGeneration;
+
     void ClearTileParameters()
     {
       for (u32 i = 0; i < MAX_TILE_PARAMETERS; ++i)
       {
         m_keyValues[i] = S32_MIN;
       }
+      m_parameterGeneration = 0;
     }
 
     void CopyTileParameters(const Tile & hero)
@@ -328,10 +755,10 @@ namespace MFM
       {
         m_keyValues[i] = hero.m_keyValues[i];
       }
+      m_parameterSource = hero.m_parameterSource;
+      m_parameterGeneration = hero.m_parameterGeneration;
     }
 
-    void TryToAddRegionAtReach(Dir d, u32& rtncount, THREEDIR & rtndirs, bool onlyConnected) const;
-
     friend class EventWindow<EC>;
     friend class CacheProcessor<EC>;
 
@@ -365,6 +792,8 @@ namespace MFM
 
     const UlamClassRegistry<EC> & GetUlamClassRegistry() const { return m_ucr; }
 
+    UlamTransientArena & GetTransientArena() { return m_transientArena; }
+
     /**
      * A minimal iterator over the Sites of a tile.  Access via Tile::begin().
      */
@@ -488,9 +917,29 @@ namespace MFM
 
   private:
 
+    /**
+       Per-type counts of the atoms in the owned sites of this Tile.
+
+       Only the thread writing this Tile's owned sites -- the one
+       running it, or whoever holds it while the grid is paused --
+       writes the counts: incrementally in PlaceAtomInSite, and by
+       rescanning in RecountIfNeeded.  Other threads only read them,
+       so queries cost O(1) per type.
+
+       Writes that bypass PlaceAtomInSite must call NeedAtomRecount,
+       from any thread.  That bumps m_recountsWanted, and until the
+       owner's next RecountIfNeeded catches m_recountsDone up, the
+       cached counts are stale: queries scan the owned sites
+       themselves, without writing anything, and placements leave
+       the counts alone.  A recount requested mid-rescan just leaves
+       the generations apart for next time.
+     */
     struct CountData {
       CountData(const Tile& t)
         : m_tile(t)
+        , m_illegalAtomCount(0)
+        , m_recountsWanted(1)
+        , m_recountsDone(0)
       { }
 
       const Tile & m_tile;
@@ -501,31 +950,68 @@ namespace MFM
 
       u32 m_illegalAtomCount;
 
-      /** false when the m_atomCount counts are known valid.*/
-      bool m_needRecount;
+      /** Bumped by NeedAtomRecount, from any thread */
+      u32 m_recountsWanted;
 
-      void RecountAtoms() ;
+      /** m_recountsWanted as of the owner's last rescan */
+      u32 m_recountsDone;
+
+      bool IsRecountPending() const
+      {
+        return __atomic_load_n(&m_recountsWanted, __ATOMIC_ACQUIRE) !=
+          __atomic_load_n(&m_recountsDone, __ATOMIC_ACQUIRE);
+      }
 
+      /** Owner only: rescan, if anyone asked since the last time */
       void RecountIfNeeded()
       {
-        if (m_needRecount)
+        const u32 wanted = __atomic_load_n(&m_recountsWanted, __ATOMIC_ACQUIRE);
+        if (wanted != m_recountsDone)
         {
           RecountAtoms();
+          __atomic_store_n(&m_recountsDone, wanted, __ATOMIC_RELEASE);
         }
-        m_needRecount = false;
       }
 
-      u32 GetIllegalAtomCount()
+      void RecountAtoms() ;
+
+      /** Count the owned sites holding \a type (illegal types if \a
+          idx < 0) by scanning, writing nothing */
+      u32 ScanAtomCount(s32 idx) const ;
+
+      u32 GetIllegalAtomCount() const
       {
-        RecountIfNeeded();
-        return m_illegalAtomCount;
+        if (IsRecountPending())
+        {
+          return ScanAtomCount(-1);
+        }
+        return __atomic_load_n(&m_illegalAtomCount, __ATOMIC_RELAXED);
       }
 
-      s32 GetAtomCount(u32 type) ;
+      s32 GetAtomCount(u32 type) const ;
 
       void NeedAtomRecount()
       {
-        m_needRecount = true;
+        __atomic_add_fetch(&m_recountsWanted, 1, __ATOMIC_RELEASE);
+      }
+
+      /** Owner only: an owned site's atom changed from \a oldType to
+          \a newType */
+      void CountAtomChange(u32 oldType, u32 newType)
+      {
+        if (oldType == newType || IsRecountPending())
+        {
+          return;  // Nothing to do, or the next rescan sees it
+        }
+        AdjustCount(oldType, -1);
+        AdjustCount(newType, 1);
+      }
+
+      void AdjustCount(u32 type, s32 delta)
+      {
+        s32 idx = m_tile.m_elementTable.GetIndex(type);
+        u32 & count = idx < 0 ? m_illegalAtomCount : m_atomCount[idx];
+        __atomic_store_n(&count, count + delta, __ATOMIC_RELAXED);  // Only we write it
       }
     };
 
@@ -540,6 +1026,17 @@ namespace MFM
     /** Total times we successfully acquired a lock in this Tile */
     u64 m_lockAttemptsSucceeded;
 
+#ifdef MFM_EVENT_PHASE_TIMING
+    /** Per-phase event timing histograms, fed by m_window */
+    EventPhaseTimer m_eventPhaseTimer;
+#endif
+
+    /** Whether m_window feeds m_elementProfile */
+    bool m_elementProfiling;
+
+    /** Per-element-type behavior accounting, when m_elementProfiling */
+    ElementProfile m_elementProfile;
+
     /**
      * The coord of the last event (the one that caused
      * m_lastEventEventNumber to change most recently).
@@ -593,6 +1090,20 @@ namespace MFM
      */
     State m_requestedState;
 
+    /**
+       How many times m_state has changed.  Written only by the
+       thread advancing this tile.
+     */
+    u32 m_stateChanges;
+
+    /**
+       How many times Advance() has been called, and how many of
+       those calls accomplished nothing (so the thread advancing this
+       tile went on to yield).  Written only by that thread.
+     */
+    u64 m_advances;
+    u64 m_idleAdvances;
+
     /**
        How much event window selection should maximize the AER vs the
        flatness of space, in the range of 0..10.  Value 0 adds
@@ -601,11 +1112,168 @@ namespace MFM
      */
     u32 m_warpFactor;
 
+    /**
+       true if event centers are drawn from m_occupiedSites
+     */
+    bool m_sparseEvents;
+
+    /** Extra looks at a busy intertile lock.  \sa SetLockSpinCount */
+    u32 m_lockSpinCount;
+
+    /** Event centers drawn per AdvanceComputation.  \sa SetEventBatchSize */
+    u32 m_eventBatchSize;
+
+    /** Helper event windows, if any.  \sa SetEventWorkers */
+    EventWorkers<EC> * m_eventWorkers;
+
+    /** Whether lock-needing events go optimistic.  \sa SetOptimisticEvents */
+    bool m_optimisticEvents;
+
+    /** Runs and parks optimistic events, once they've been turned on */
+    EventWindow<EC> * m_optimisticWindow;
+
+    /** External data in and out, if any.  \sa SetDatumQueues */
+    DatumQueues * m_datumQueues;
+
+    /** Run and maybe commit a lock-needing event at \c pt optimistically */
+    bool TryOptimisticEventAt(const SPoint & pt) ;
+
+    /**
+       Owned site numbers of the non-empty owned sites, in slots
+       0..m_occupiedCount-1, when m_sparseEvents.
+     */
+    u32 * m_occupiedSites;
+
+    /**
+       For each owned site number, 1 + its slot in m_occupiedSites,
+       or 0 if the site is empty.
+     */
+    u32 * m_occupiedSlots;
+
+    u32 m_occupiedCount;
+
+    /**
+       true if m_occupiedSites must be rebuilt from the sites, because
+       atoms may have changed without going through PlaceAtomInSite.
+       Set along with the atom recount flag, from any thread, so read
+       it with IsOccupancyStale.
+     */
+    mutable bool m_occupancyStale;
+
+    bool IsOccupancyStale() const
+    {
+      return __atomic_load_n(&m_occupancyStale, __ATOMIC_ACQUIRE);
+    }
+
+    /**
+       true if event centers are drawn from m_eventAges
+     */
+    bool m_agedEvents;
+
+    /**
+       Owned site numbers weighted by event age, when m_agedEvents.
+       Rebuilt from the sites whenever its event count or warp factor
+       disagrees with ours.
+     */
+    EventAgeIndex m_eventAges;
+
+    /**
+       Per-block change stamps, GetChangeBlockCount() of them, bumped
+       by PlaceAtomInSite.
+     */
+    u32 * m_changeBlockStamps;
+
+    /**
+       Bumped along with the atom recount flag.
+     */
+    mutable u32 m_changeStamp;
+
+    void NoteSiteChange(const SPoint & pt)
+    {
+      const u32 block =
+        (((u32) pt.GetY()) >> CHANGE_BLOCK_SHIFT) * GetChangeBlocksWide() +
+        (((u32) pt.GetX()) >> CHANGE_BLOCK_SHIFT);
+      ++m_changeBlockStamps[block];
+    }
+
+    u64 m_skippedEmptyEvents;
+
+    u64 m_quiescentEvents;
+
+    u64 m_sweptEvents;
+
+    /**
+       Per-bin event counts, GetEventBinCount() of them, bumped by
+       EventWindow::RecordEventAtTileCoord.
+     */
+    u64 * m_eventBins;
+
+    /**
+       RegionAtReach by table.  Which neighbors a site's region reaches
+       depends only on which band of the tile its x falls in (west,
+       middle west, center, middle east, east) and which its y does
+       (north, middle, south), so for each tabled reach -- R, for
+       CacheAt, and 2R..3R, for SharedAt, VisibleAt and the lock
+       directions of every event window boundary -- m_regionBands
+       holds a band number per column and then per row, and
+       m_regionDirs the ordered directions of each pair of bands, for
+       this tile's layout, packed by PackRegionDirs.
+     */
+    enum {
+      REGION_X_BANDS = 5,
+      REGION_Y_BANDS = 3,
+      REGION_REACHES = EVENT_WINDOW_RADIUS + 2
+    };
+    u8 * m_regionBands;
+    u16 m_regionDirs[REGION_X_BANDS][REGION_Y_BANDS];
+
+    /**
+       The directions IsConnected says are connected, as a bit per
+       Dir, plus CONNECTED_DIRS_VALID; or 0 if they need asking again.
+     */
+    enum { CONNECTED_DIRS_VALID = 1 << Dirs::DIR_COUNT };
+    mutable u32 m_connectedDirs;
+
+    static u16 PackRegionDirs(u32 count, Dir d0, Dir d1, Dir d2)
+    {
+      return (u16) (count | (d0 << 2) | (d1 << 5) | (d2 << 8));
+    }
+
+    /** The m_regionBands table for \c reach, or -1 if there's none */
+    s32 GetRegionTable(u32 reach) const
+    {
+      if (reach == EVENT_WINDOW_RADIUS) return 0;
+      if (reach >= 2 * EVENT_WINDOW_RADIUS && reach <= 3 * EVENT_WINDOW_RADIUS)
+        return reach - 2 * EVENT_WINDOW_RADIUS + 1;
+      return -1;
+    }
+
+    u32 GetRegionXBand(u32 x, u32 reach) const ;
+
+    u32 GetRegionYBand(u32 y, u32 reach) const ;
+
+    void InitRegionTables() ;
+
+    u32 GetConnectedDirs() const ;
+
+    void NoteEventInBin(const SPoint & owned)
+    {
+      const u32 bin =
+        (((u32) owned.GetY()) >> EVENT_BIN_SHIFT) * GetEventBinsWide() +
+        (((u32) owned.GetX()) >> EVENT_BIN_SHIFT);
+      ++m_eventBins[bin];
+    }
+
     /**
        Record of recent past events for debugging and such
      */
     EventHistoryBuffer<EC> m_eventHistoryBuffer;
 
+    /**
+       Cheap enough to leave on, for when history isn't
+     */
+    FlightRecorder m_flightRecorder;
+
     /**
      * Compute the coordinates of \c atomLoc in a neighboring tile.
      * (There may or may not actually be a Tile in the given \c
@@ -646,6 +1314,49 @@ namespace MFM
 
     bool AdvanceComputation() ;
 
+    /**
+       AdvanceComputation for an event batch size over one.  \returns
+       true if any event of the batch ran.
+     */
+    bool AdvanceBatchedComputation() ;
+
+    /**
+       Pick an event center among the occupied owned sites, first
+       crediting the empty-site events uniform selection would have
+       run before reaching one.  Returns false if there are no
+       occupied owned sites.
+     */
+    bool PickOccupiedCoord(SPoint & pt) ;
+
+    void RebuildOccupancy() ;
+
+    /**
+       Pick an event center by event age from m_eventAges.  Returns
+       false if the draw was turned down, which should be rare.
+     */
+    bool PickAgedCoord(SPoint & pt) ;
+
+    void RebuildEventAges() ;
+
+    /** Tell m_eventAges about an event at \c tcoord */
+    void NoteAgedEvent(const SPoint & tcoord)
+    {
+      const u64 now = GetEventsExecuted();
+      if (m_eventAges.IsInitted() && now >= m_eventAges.GetNow())
+      {
+        m_eventAges.RecordEvent(OwnedSiteNumber(tcoord), now);
+      }
+      /* else PickAgedCoord will rebuild */
+    }
+
+    void UpdateOccupancy(const SPoint & pt, bool occupied) ;
+
+    u32 OwnedSiteNumber(const SPoint & pt) const
+    {
+      SPoint owned = TileCoordToOwned(pt);
+      return (u32) (owned.GetY() * OWNED_WIDTH + owned.GetX());
+    }
+
     /**
        Advance the passive packet processing state machine in the
        Tile.  Return true if any possibly valuable work was done.
@@ -672,6 +1383,63 @@ namespace MFM
       }
     }
 
+    /**
+       Set the maximum number of sites per cache update packet for all
+       of this Tile's cache processors, or 0 for one packet per site.
+       \sa CacheProcessor::SetCacheBatchLimit
+     */
+    void SetCacheBatchLimit(u32 maxSites)
+    {
+      for (u32 d = 0; d < Dirs::DIR_COUNT; ++d)
+      {
+        m_cacheProcessors[d].SetCacheBatchLimit(maxSites);
+      }
+    }
+
+    /**
+       Select whether all of this Tile's cache processors offer and
+       accept compact cache updates.  \sa CacheProcessor::SetCompactCache
+     */
+    void SetCompactCache(bool on)
+    {
+      for (u32 d = 0; d < Dirs::DIR_COUNT; ++d)
+      {
+        m_cacheProcessors[d].SetCompactCache(on);
+      }
+    }
+
+    /**
+       Sum the packets and bytes shipped by this Tile's cache
+       processors.
+     */
+    void GetCacheShippedCounts(u64 & packets, u64 & bytes) const
+    {
+      packets = 0;
+      bytes = 0;
+      for (u32 d = 0; d < Dirs::DIR_COUNT; ++d)
+      {
+        const CacheProcessor<EC> & cp = m_cacheProcessors[d];
+        packets += cp.GetPacketsShipped();
+        bytes += cp.GetBytesShipped();
+      }
+    }
+
+    /**
+       Sum the intertile lock failures, and the spinning wins, of this
+       Tile's cache processors.  \sa SetLockSpinCount
+     */
+    void GetLockFailureCounts(u64 & failures, u64 & spinWins) const
+    {
+      failures = 0;
+      spinWins = 0;
+      for (u32 d = 0; d < Dirs::DIR_COUNT; ++d)
+      {
+        const CacheProcessor<EC> & cp = m_cacheProcessors[d];
+        failures += cp.GetLockFailures();
+        spinWins += cp.GetLockSpinWins();
+      }
+    }
+
     double GetAverageCacheRedundancy() const
     {
       u32 count = 0;
@@ -694,11 +1462,14 @@ namespace MFM
     }
 
     /**
-     * Flag that the atom counts in this tile may have changed
+     * Flag that the atom counts in this tile may have changed.  Safe
+     * from any thread; the thread driving this tile does the rework.
      */
     void NeedAtomRecount() const
     {
       m_cdata.NeedAtomRecount();
+      __atomic_store_n(&m_occupancyStale, true, __ATOMIC_RELEASE);
+      __atomic_add_fetch(&m_changeStamp, 1, __ATOMIC_RELEASE);
     }
 
     CacheProcessor<EC> & GetCacheProcessor(Dir toCache) ;
@@ -744,6 +1515,28 @@ namespace MFM
       return m_state;
     }
 
+    /**
+       How many state changes Advance() has made so far, so the
+       thread advancing this tile can tell, without locking, when a
+       call has changed its state.
+     */
+    u32 GetStateChangeCount() const
+    {
+      return m_stateChanges;
+    }
+
+    /** Calls to Advance() so far.  \sa GetIdleAdvanceCount */
+    u64 GetAdvanceCount() const
+    {
+      return m_advances;
+    }
+
+    /** Calls to Advance() so far that accomplished nothing. */
+    u64 GetIdleAdvanceCount() const
+    {
+      return m_idleAdvances;
+    }
+
     void SetRequestedState(State state) ;
 
     /**
@@ -775,6 +1568,12 @@ namespace MFM
       return m_window.GetSitesAccessed();
     }
 
+    /** \sa EventWindow::GetInertEvents */
+    u64 GetInertEvents() const
+    {
+      return m_window.GetInertEvents();
+    }
+
     EventWindow<EC> & GetEventWindow()
     {
       return m_window;
@@ -798,6 +1597,7 @@ namespace MFM
     {
       m_label.Reset();
       m_label.Print(label);
+      m_flightRecorder.SetLabel(m_label.GetZString());
     }
 
     /**
@@ -883,6 +1683,18 @@ namespace MFM
 
     const Element<EC> * ReplaceEmptyElement(const Element<EC>& newEmptyElement) ;
 
+    /**
+     * Swap elements in this Tile's ElementTable.
+     * \sa ElementTable::ReplaceElements
+     */
+    void ReplaceElements(const Element<EC> * const * olds,
+                         const Element<EC> * const * news,
+                         u32 count)
+    {
+      m_elementTable.ReplaceElements(olds, news, count);
+      NeedAtomRecount();  // Counts are indexed by element table slot
+    }
+
     /**
      * Returns an empty atom instance according to this Tile's ElementTable.
      */
@@ -920,6 +1732,16 @@ namespace MFM
      */
     virtual bool IsConnected(Dir dir) const = 0;
 
+    /**
+     * Forget which directions IsConnected said were connected, so the
+     * next region lookup asks again.  Call whenever a connection
+     * comes or goes.
+     */
+    void InvalidateConnectedDirs()
+    {
+      __atomic_store_n(&m_connectedDirs, 0, __ATOMIC_RELAXED);
+    }
+
     //bool HasAnyConnections(Dir regionDir) const; unused
 
     /**
@@ -1226,6 +2048,7 @@ namespace MFM
      */
     T* GetWritableAtom(const SPoint & pt)
     {
+      NeedAtomRecount();  // We can't see what the caller writes
       S & site = GetSite(pt);
       return &site.GetAtom();
     }
@@ -1499,6 +2322,43 @@ namespace MFM
 
     void ReportTileStatus(Logger::Level level) ;
 
+    /**
+       Add what this Tile holds to \c account: the Tile object itself,
+       split by subsystem, and what it has allocated.  Site storage
+       belongs to the SizedTile, which adds it; \sa
+       SizedTile::AccountMemory
+     */
+    void AccountMemory(MemoryAccount & account) const ;
+
+#ifdef MFM_EVENT_PHASE_TIMING
+    EventPhaseTimer & GetEventPhaseTimer() { return m_eventPhaseTimer; }
+
+    const EventPhaseTimer & GetEventPhaseTimer() const { return m_eventPhaseTimer; }
+#endif
+
+    /**
+     * Start or stop accounting, per element type, for the time spent
+     * in Behavior and the sites written by each event.  Existing
+     * counts are kept either way; see GetElementProfile().Reset().
+     */
+    void SetElementProfiling(bool on) { m_elementProfiling = on; }
+
+    bool IsElementProfiling() const { return m_elementProfiling; }
+
+    ElementProfile & GetElementProfile() { return m_elementProfile; }
+
+    const ElementProfile & GetElementProfile() const { return m_elementProfile; }
+
+    /**
+     * Connect this Tile's emitters and consumers to \c queues (which
+     * the caller owns) for external data, or disconnect them with 0.
+     * Call only while the tile is paused.
+     */
+    void SetDatumQueues(DatumQueues * queues) { m_datumQueues = queues; }
+
+    /** This Tile's external data queues, or 0 if it has none */
+    DatumQueues * GetDatumQueues() const { return m_datumQueues; }
+
     /**
      * Registers an Element into this Tile's ElementTable.
      *
@@ -1507,12 +2367,23 @@ namespace MFM
     void RegisterElement(const Element<EC> & anElement)
     {
       m_elementTable.RegisterElement(anElement);
+      NeedAtomRecount();  // Counts are indexed by element table slot
+    }
+
+    /**
+     * Switch this Tile's element lookups to a frozen dispatch table.
+     * \sa ElementTable::Freeze
+     */
+    bool FreezeElementTable()
+    {
+      return m_elementTable.Freeze();
     }
 
   public:
 
     /**
-     * Sets a parameter in this Tile
+     * Sets a parameter in this Tile, until the next block from its
+     * TileParameterPublisher, if it has one, replaces it
      *
      * @param key a small u32 specifying the parameter slot to set
      *
@@ -1524,6 +2395,42 @@ namespace MFM
       m_keyValues[key] = value;
     }
 
+    /**
+     * Take this Tile's parameters from the blocks published by \a
+     * source (or, if null, only from SetTileParameter), starting
+     * now.  Later blocks are picked up between events, while the
+     * Tile runs.
+     */
+    void SetTileParameterSource(const TileParameterPublisher * source)
+    {
+      m_parameterSource = source;
+      m_parameterGeneration = 0;
+      RefreshTileParameters();
+    }
+
+    /**
+     * Pick up the latest block from m_parameterSource, if it has
+     * changed since we last looked.  Called at event boundaries, so
+     * costs one atomic load per event when nothing has changed.
+     */
+    void RefreshTileParameters()
+    {
+      if (!m_parameterSource)
+      {
+        return;
+      }
+      const TileParameterBlock * block = m_parameterSource->GetCurrent();
+      if (block->m_generation == m_parameterGeneration)
+      {
+        return;
+      }
+      for (u32 i = 0; i < MAX_TILE_PARAMETERS; ++i)
+      {
+        m_keyValues[i] = block->m_values[i];
+      }
+      m_parameterGeneration = block->m_generation;
+    }
+
     /**
      * Gets a parameter in this Tile
      *
@@ -4,6 +4,8 @@
 #include "Logger.h"
 #include "AtomSerializer.h"
 #include "EventHistoryBuffer.h"
+#include "EventWindowBatch.h"
+#include "EventWorkers.h"
 
 #include "Util.h"
 
@@ -18,9 +20,12 @@ namespace MFM
     , GRID_LAYOUT(gridlayout)
     , DUMMY_TILE(false)
     , m_sites(sites)
+    , m_parameterSource(0)
+    , m_parameterGeneration(0)
     , m_cdata(*this)
     , m_lockAttempts(0)
     , m_lockAttemptsSucceeded(0)
+    , m_elementProfiling(false)
     , m_window(*this)
     , m_dirIterator(Dirs::DIR_COUNT)
     , m_state(OFF)
@@ -28,8 +33,32 @@ namespace MFM
     , m_backgroundRadiationEnabled(false)
     , m_foregroundRadiationEnabled(false)
     , m_requestedState(OFF)
+    , m_stateChanges(0)
+    , m_advances(0)
+    , m_idleAdvances(0)
     , m_warpFactor(3)
+    , m_sparseEvents(false)
+    , m_lockSpinCount(0)
+    , m_eventBatchSize(0)
+    , m_eventWorkers(0)
+    , m_optimisticEvents(false)
+    , m_optimisticWindow(0)
+    , m_datumQueues(0)
+    , m_occupiedSites(0)
+    , m_occupiedSlots(0)
+    , m_occupiedCount(0)
+    , m_occupancyStale(true)
+    , m_agedEvents(false)
+    , m_changeBlockStamps(0)
+    , m_changeStamp(0)
+    , m_skippedEmptyEvents(0)
+    , m_quiescentEvents(0)
+    , m_sweptEvents(0)
+    , m_eventBins(0)
+    , m_regionBands(0)
+    , m_connectedDirs(0)
     , m_eventHistoryBuffer(*this, eventbuffersize, items)
+    , m_flightRecorder()
   {
     // TILE sides can't be too small, and we must apparently have sites, but not necessarily hidden ones.
     // Effort to avoid simultaneous locks in opposite directions (e.g. East and West);
@@ -39,10 +68,19 @@ namespace MFM
     MFM_API_ASSERT_ARG(2 * TILE_WIDTH / 2 == TILE_WIDTH);
     MFM_API_ASSERT_ARG(2 * TILE_HEIGHT / 2 == TILE_HEIGHT);
 
+    m_changeBlockStamps = new u32[GetChangeBlockCount()];
+    for (u32 i = 0; i < GetChangeBlockCount(); ++i)
+      m_changeBlockStamps[i] = 0;
+
+    m_eventBins = new u64[GetEventBinCount()];
+    ResetEventBins();
+
+    InitRegionTables();
+
     //staggered grid layout ignores NORTH & SOUTH directions
     if(IsTileGridLayoutStaggered())
       {
-	static u32 staggeredindexes[Dirs::DIR_COUNT];
+	u32 staggeredindexes[Dirs::DIR_COUNT];
 	u32 counter = 0;
 	for(u32 d=0; d < Dirs::DIR_COUNT; d++)
 	  {
@@ -61,7 +99,16 @@ namespace MFM
   }
 
   template <class EC>
-  Tile<EC>::~Tile() {/* defined to avoid inline error */}
+  Tile<EC>::~Tile()
+  {
+    delete m_eventWorkers;
+    delete m_optimisticWindow;
+    delete [] m_occupiedSites;
+    delete [] m_occupiedSlots;
+    delete [] m_changeBlockStamps;
+    delete [] m_eventBins;
+    delete [] m_regionBands;
+  }
 
   template <class EC>
   void Tile<EC>::SaveTile(ByteSink & to) const
@@ -130,7 +177,9 @@ namespace MFM
   template <class EC>
   const Element<EC> * Tile<EC>::ReplaceEmptyElement(const Element<EC>& newEmptyElement)
   {
-    return m_elementTable.ReplaceEmptyElement(newEmptyElement);
+    const Element<EC> * ret = m_elementTable.ReplaceEmptyElement(newEmptyElement);
+    NeedAtomRecount();
+    return ret;
   }
 
   template <class EC>
@@ -150,27 +199,40 @@ namespace MFM
   void Tile<EC>::XRay(u32 siteOdds, u32 bitOdds)
   {
     Random & random = GetRandom();
-    for(iterator_type i = beginAll(); i != endAll(); ++i) { // hitting caches too
-      if (random.OneIn(siteOdds))
-        i->GetAtom().XRay(random, bitOdds);
+    const u32 sites = TILE_WIDTH * TILE_HEIGHT; // hitting caches too
+    for(u32 k = random.GeometricSkip(siteOdds); k < sites; )
+    {
+      m_sites[k].GetAtom().XRay(random, bitOdds);
+      const u32 skip = random.GeometricSkip(siteOdds);
+      if (skip >= sites) break;
+      k += skip + 1;
     }
+    NeedAtomRecount();
   }
 
   template <class EC>
   void Tile<EC>::Thin(u32 siteOdds)
   {
     Random & random = GetRandom();
-    for(iterator_type i = beginOwned(); i != endOwned(); ++i) {
-      if (random.OneIn(siteOdds))
-        i->Clear();
+    const u32 sites = OWNED_WIDTH * OWNED_HEIGHT;
+    for(u32 k = random.GeometricSkip(siteOdds); k < sites; )
+    {
+      u32 length;
+      GetSiteSpan(k / OWNED_WIDTH, false, length)[k % OWNED_WIDTH].Clear();
+      const u32 skip = random.GeometricSkip(siteOdds);
+      if (skip >= sites) break;
+      k += skip + 1;
     }
+    NeedAtomRecount();
   }
 
   template <class EC>
   void Tile<EC>::ClearAtoms()
   {
-    for(iterator_type i = beginAll(); i != endAll(); ++i) {
-      i->Clear();
+    const u32 sites = TILE_WIDTH * TILE_HEIGHT;
+    for (u32 k = 0; k < sites; ++k)
+    {
+      m_sites[k].Clear();
     }
     NeedAtomRecount();
   }
@@ -183,6 +245,7 @@ namespace MFM
     MFM_API_ASSERT_STATE(!cxn.IsConnected());
 
     cxn.ClaimCacheProcessor(*this, channel, lock, toCache);
+    InvalidateConnectedDirs();
   }
 
   template <class EC>
@@ -205,32 +268,77 @@ namespace MFM
   }
 
   template <class EC>
-  s32 Tile<EC>::CountData::GetAtomCount(u32 type)
+  s32 Tile<EC>::CountData::GetAtomCount(u32 type) const
   {
     s32 idx = m_tile.m_elementTable.GetIndex(type);
     if (idx < 0)
       return -1;
 
-    RecountIfNeeded();
+    if (IsRecountPending())
+    {
+      return (s32) ScanAtomCount(idx);
+    }
 
-    return m_atomCount[idx];
+    return (s32) __atomic_load_n(&m_atomCount[idx], __ATOMIC_RELAXED);
   }
 
   template <class EC>
-  void Tile<EC>::CountData::RecountAtoms()
+  u32 Tile<EC>::CountData::ScanAtomCount(s32 idx) const
   {
-    for(u32 i = 0; i < ELEMENT_TABLE_SIZE; i++) m_atomCount[i] = 0;
+    u32 count = 0;
+    const u32 rows = m_tile.GetSiteSpanCount(false);
+    for (u32 y = 0; y < rows; ++y)
+    {
+      u32 width;
+      const S * sites = m_tile.GetSiteSpan(y, false, width);
+      for (u32 x = 0; x < width; )
+      {
+        const u32 atype = sites[x].GetAtom().GetType();
+        u32 run = 1;
+        while (x + run < width && sites[x + run].GetAtom().GetType() == atype) ++run;
+        x += run;
 
-    m_illegalAtomCount = 0;
+        s32 aidx = m_tile.m_elementTable.GetIndex(atype);
+        if (aidx == idx || (idx < 0 && aidx < 0)) count += run;
+      }
+    }
+    return count;
+  }
 
-    for(const_iterator_type i = m_tile.beginOwned(); i != m_tile.endOwned(); ++i) {
+  template <class EC>
+  void Tile<EC>::CountData::RecountAtoms()
+  {
+    u32 counts[ELEMENT_TABLE_SIZE];
+    for(u32 i = 0; i < ELEMENT_TABLE_SIZE; i++) counts[i] = 0;
+
+    u32 illegal = 0;
 
-      u32 atype = i->GetAtom().GetType();
-      s32 idx = m_tile.m_elementTable.GetIndex(atype);
+    // A row of owned sites at a time, then one element lookup per
+    // run of like types -- mostly long runs of empty
+    const u32 rows = m_tile.GetSiteSpanCount(false);
+    for (u32 y = 0; y < rows; ++y)
+    {
+      u32 width;
+      const S * sites = m_tile.GetSiteSpan(y, false, width);
+      for (u32 x = 0; x < width; )
+      {
+        const u32 atype = sites[x].GetAtom().GetType();
+        u32 run = 1;
+        while (x + run < width && sites[x + run].GetAtom().GetType() == atype) ++run;
+        x += run;
+
+        s32 idx = m_tile.m_elementTable.GetIndex(atype);
+        if (idx < 0) illegal += run;
+        else counts[idx] += run;
+      }
+    }
 
-      if (idx < 0) ++m_illegalAtomCount;
-      else ++m_atomCount[idx];
+    // Readers may be looking, so no zeros in passing
+    for(u32 i = 0; i < ELEMENT_TABLE_SIZE; i++)
+    {
+      __atomic_store_n(&m_atomCount[i], counts[i], __ATOMIC_RELAXED);
     }
+    __atomic_store_n(&m_illegalAtomCount, illegal, __ATOMIC_RELAXED);
   }
 
   template <class EC>
@@ -307,139 +415,117 @@ namespace MFM
   }
 
   template <class EC>
-  u32 Tile<EC>::RegionAtReach(const SPoint& sp, const u32 REACH, THREEDIR& rtndirs, bool onlyConnected) const
+  u32 Tile<EC>::GetRegionXBand(u32 x, u32 reach) const
   {
-    u32 rtncount = 0;
-    bool isStaggered = IsTileGridLayoutStaggered();
+    if (x < reach) return 0;                       // West
+    if (x >= TILE_WIDTH - reach) return 1;         // East
+    if (x + reach >= TILE_WIDTH/2 && x < TILE_WIDTH/2 + reach) return 3; // Center
+    return x < TILE_WIDTH/2 ? 2 : 4;               // Middle west, middle east
+  }
 
-    MFM_API_ASSERT_ARG(IsInTile(sp));
+  template <class EC>
+  u32 Tile<EC>::GetRegionYBand(u32 y, u32 reach) const
+  {
+    if (y < reach) return 0;                       // North
+    if (y >= TILE_HEIGHT - reach) return 1;        // South
+    return 2;                                      // Middle
+  }
 
-    UPoint pt = MakeUnsigned(sp);
+  template <class EC>
+  void Tile<EC>::InitRegionTables()
+  {
+    const u32 sides = TILE_WIDTH + TILE_HEIGHT;
+    m_regionBands = new u8[REGION_REACHES * sides];
+    for (u32 t = 0; t < REGION_REACHES; ++t)
+    {
+      const u32 reach = t == 0 ? EVENT_WINDOW_RADIUS : 2 * EVENT_WINDOW_RADIUS + t - 1;
+      u8 * bands = &m_regionBands[t * sides];
+      for (u32 x = 0; x < TILE_WIDTH; ++x)
+        bands[x] = (u8) GetRegionXBand(x, reach);
+      for (u32 y = 0; y < TILE_HEIGHT; ++y)
+        bands[TILE_WIDTH + y] = (u8) GetRegionYBand(y, reach);
+    }
 
-    if(pt.GetX() < REACH)
+    // In the order the corners have always been reported: diagonal,
+    // then side, then (checkerboard only) north or south
+    const bool isStaggered = IsTileGridLayoutStaggered();
+    const Dir ns[2] = { Dirs::NORTH, Dirs::SOUTH };
+    const Dir west[2] = { Dirs::NORTHWEST, Dirs::SOUTHWEST };
+    const Dir east[2] = { Dirs::NORTHEAST, Dirs::SOUTHEAST };
+    for (u32 y = 0; y < 2; ++y)
+    {
+      const u32 corner = isStaggered ? 2 : 3;
+      m_regionDirs[0][y] = PackRegionDirs(corner, west[y], Dirs::WEST, ns[y]);
+      m_regionDirs[1][y] = PackRegionDirs(corner, east[y], Dirs::EAST, ns[y]);
+      if (isStaggered)
       {
-	if(pt.GetY() < REACH)
-	  {
-	    //NW corner
-	    TryToAddRegionAtReach(Dirs::NORTHWEST, rtncount, rtndirs, onlyConnected);
-
-	    TryToAddRegionAtReach(Dirs::WEST, rtncount, rtndirs, onlyConnected);
-
-	    if(!isStaggered)
-	      TryToAddRegionAtReach(Dirs::NORTH, rtncount, rtndirs, onlyConnected);
-	  }
-	else if(pt.GetY() >= TILE_HEIGHT - REACH)
-	  {
-	    //SW corner
-	    TryToAddRegionAtReach(Dirs::SOUTHWEST, rtncount, rtndirs, onlyConnected);
-
-	    TryToAddRegionAtReach(Dirs::WEST, rtncount, rtndirs, onlyConnected);
-
-	    if(!isStaggered)
-	      TryToAddRegionAtReach(Dirs::SOUTH, rtncount, rtndirs, onlyConnected);
-	  }
-	else
-	  {
-	    TryToAddRegionAtReach(Dirs::WEST, rtncount, rtndirs, onlyConnected);
-	  }
+        m_regionDirs[2][y] = PackRegionDirs(1, west[y], 0, 0);
+        m_regionDirs[3][y] = PackRegionDirs(2, west[y], east[y], 0);
+        m_regionDirs[4][y] = PackRegionDirs(1, east[y], 0, 0);
       }
-    else if(pt.GetX() >= TILE_WIDTH - REACH)
+      else
       {
-	if(pt.GetY() < REACH)
-	  {
-	    //NE corner
-	    TryToAddRegionAtReach(Dirs::NORTHEAST, rtncount, rtndirs, onlyConnected);
+        for (u32 x = 2; x < REGION_X_BANDS; ++x)
+          m_regionDirs[x][y] = PackRegionDirs(1, ns[y], 0, 0);
+      }
+    }
+    m_regionDirs[0][2] = PackRegionDirs(1, Dirs::WEST, 0, 0);
+    m_regionDirs[1][2] = PackRegionDirs(1, Dirs::EAST, 0, 0);
+    for (u32 x = 2; x < REGION_X_BANDS; ++x)
+      m_regionDirs[x][2] = PackRegionDirs(0, 0, 0, 0);
+  }
 
-	    TryToAddRegionAtReach(Dirs::EAST, rtncount, rtndirs, onlyConnected);
+  template <class EC>
+  u32 Tile<EC>::GetConnectedDirs() const
+  {
+    // Connections change only while the tile is being wired up, or
+    // on one thread (T2), so a racy refill can't cache a stale mask
+    u32 dirs = __atomic_load_n(&m_connectedDirs, __ATOMIC_RELAXED);
+    if (dirs == 0)
+    {
+      dirs = CONNECTED_DIRS_VALID;
+      for (Dir d = 0; d < Dirs::DIR_COUNT; ++d)
+        if (IsConnected(d))
+          dirs |= 1 << d;
+      __atomic_store_n(&m_connectedDirs, dirs, __ATOMIC_RELAXED);
+    }
+    return dirs;
+  }
 
-	    if(!isStaggered)
-	      TryToAddRegionAtReach(Dirs::NORTH, rtncount, rtndirs, onlyConnected);
-	  }
-	else if(pt.GetY() >= TILE_HEIGHT - REACH)
-	  {
-	    //SE corner
-	    TryToAddRegionAtReach(Dirs::SOUTHEAST, rtncount, rtndirs, onlyConnected);
+  template <class EC>
+  u32 Tile<EC>::RegionAtReach(const SPoint& sp, const u32 REACH, THREEDIR& rtndirs, bool onlyConnected) const
+  {
+    MFM_API_ASSERT_ARG(IsInTile(sp));
 
-	    TryToAddRegionAtReach(Dirs::EAST, rtncount, rtndirs, onlyConnected);
+    UPoint pt = MakeUnsigned(sp);
 
-	    if(!isStaggered)
-	      TryToAddRegionAtReach(Dirs::SOUTH, rtncount, rtndirs, onlyConnected);
-	  }
-	else
-	  {
-	    TryToAddRegionAtReach(Dirs::EAST, rtncount, rtndirs, onlyConnected);
-	  }
-      }
+    u32 xBand, yBand;
+    const s32 table = GetRegionTable(REACH);
+    if (table >= 0)
+    {
+      const u8 * bands = &m_regionBands[table * (TILE_WIDTH + TILE_HEIGHT)];
+      xBand = bands[pt.GetX()];
+      yBand = bands[TILE_WIDTH + pt.GetY()];
+    }
     else
-      {
-	if(isStaggered)
-	  {
-	    if((pt.GetX() >= TILE_WIDTH/2 - REACH) && (pt.GetX() < TILE_WIDTH/2 + REACH))
-	      {
-		//in the middle +/- REACH
-		if(pt.GetY() < REACH)
-		  {
-		    TryToAddRegionAtReach(Dirs::NORTHWEST, rtncount, rtndirs, onlyConnected);
-		    TryToAddRegionAtReach(Dirs::NORTHEAST, rtncount, rtndirs, onlyConnected);
-		  }
-		else if(pt.GetY() >= TILE_HEIGHT - REACH)
-		  {
-		    TryToAddRegionAtReach(Dirs::SOUTHWEST, rtncount, rtndirs, onlyConnected);
-		    TryToAddRegionAtReach(Dirs::SOUTHEAST, rtncount, rtndirs, onlyConnected);
-		  }
-		//else
-	      }
-	    else if(pt.GetX() < TILE_WIDTH/2)
-	      {
-		if(pt.GetY() < REACH)
-		  {
-		    TryToAddRegionAtReach(Dirs::NORTHWEST, rtncount, rtndirs, onlyConnected);
-		  }
-		else if(pt.GetY() >= TILE_HEIGHT - REACH)
-		  {
-		    TryToAddRegionAtReach(Dirs::SOUTHWEST, rtncount, rtndirs, onlyConnected);
-		  }
-	      }
-	    else
-	      {
-		MFM_API_ASSERT_STATE(pt.GetX() >=TILE_WIDTH/2); //sanity
-		if(pt.GetY() < REACH)
-		  {
-		    TryToAddRegionAtReach(Dirs::NORTHEAST, rtncount, rtndirs, onlyConnected);
-		  }
-		else if(pt.GetY() >= TILE_HEIGHT - REACH)
-		  {
-		    TryToAddRegionAtReach(Dirs::SOUTHEAST, rtncount, rtndirs, onlyConnected);
-		  }
-	      }
-	  }
-	else
-	  {
-	    //checkerboard configuration
-	    // X in neither east nor west reach
-	    if(pt.GetY() < REACH)
-	      {
-		TryToAddRegionAtReach(Dirs::NORTH, rtncount, rtndirs, onlyConnected);
-	      }
-	    else if(pt.GetY() >= TILE_HEIGHT - REACH)
-	      {
-		TryToAddRegionAtReach(Dirs::SOUTH, rtncount, rtndirs, onlyConnected);
-	      }
-	  }
-      }
+    {
+      xBand = GetRegionXBand(pt.GetX(), REACH);
+      yBand = GetRegionYBand(pt.GetY(), REACH);
+    }
+
+    const u32 packed = m_regionDirs[xBand][yBand];
+    const u32 count = packed & 3;
+    const u32 connected = onlyConnected ? GetConnectedDirs() : 0xff;
+    u32 rtncount = 0;
+    for (u32 i = 0; i < count; ++i)
+    {
+      const Dir d = (packed >> (2 + 3 * i)) & 7;
+      if (connected & (1 << d))
+        rtndirs[rtncount++] = d;
+    }
     return rtncount;
   } //RegionAtReach
 
-  template <class EC>
-  void Tile<EC>::TryToAddRegionAtReach(Dir d, u32& rtncount, THREEDIR & rtndirs, bool onlyConnected) const
-  {
-    if(!onlyConnected || IsConnected(d))
-      {
-	rtndirs[rtncount] = d;
-	rtncount++;
-      }
-  } //private helper
-
   template <class EC>
   u32 Tile<EC>::CacheAt(const SPoint& pt, THREEDIR & rtndirs, const bool onlyConnected) const
   {
@@ -504,7 +590,7 @@ namespace MFM
       return;
     }
 
-    Site<AC> & site = GetSite(pt);
+    S & site = GetSite(pt);
     T & oldAtom = placeInBase ? site.GetBase().GetBaseAtom() : site.GetAtom();
     T newAtom = atom;
     unwind_protect(
@@ -540,11 +626,21 @@ namespace MFM
 	    }
 	  else
 	    {
-	      NeedAtomRecount();
 	      if (owned)
+	      {
 		site.MarkChanged();
+		if (!placeInBase)
+		{
+		  m_cdata.CountAtomChange(oldAtom.GetType(), newAtom.GetType());
+		}
+		if (m_sparseEvents && !placeInBase && !IsOccupancyStale())
+		{
+		  UpdateOccupancy(pt, newAtom.GetType() != Element_Empty<EC>::THE_INSTANCE.GetType());
+		}
+	      }
 
 	      oldAtom = newAtom;
+	      NoteSiteChange(pt);
 	    }
 	}
     });
@@ -627,8 +723,10 @@ namespace MFM
   template <class EC>
   bool Tile<EC>::Advance()
   {
+    ++m_advances;
     if (!ConsiderStateChange())
     {
+      ++m_idleAdvances;
       return false;
     }
 
@@ -644,6 +742,7 @@ namespace MFM
     case OFF:
       break;
     case ACTIVE:
+      m_cdata.RecountIfNeeded();  // We're the owner here
       didWork |= AdvanceComputation();
       MFM_LOG_DBG6(("Tile %s: AdvanceComputation->%d",
                     this->GetLabel(),
@@ -655,6 +754,10 @@ namespace MFM
     default:
       FAIL(ILLEGAL_STATE);
     }
+    if (!didWork)
+    {
+      ++m_idleAdvances;
+    }
     return didWork;
   }
 
@@ -672,6 +775,60 @@ namespace MFM
     return true;
   }
 
+  template <class EC>
+  bool Tile<EC>::IsQuiescent()
+  {
+    if (!IsEnabled() || m_backgroundRadiationEnabled || m_foregroundRadiationEnabled)
+    {
+      return false;
+    }
+
+    {
+      // Staying active, too
+      Mutex::ScopeLock lock(m_stateAccess);
+      if (m_state != ACTIVE || m_requestedState != ACTIVE)
+      {
+        return false;
+      }
+    }
+
+    // Our own counts, not a reader's scan: we're the owner here, and
+    // a tile put to sleep with a live atom would stay so until
+    // outside traffic woke it
+    m_cdata.RecountIfNeeded();
+    return GetLiveAtomCount() == 0;
+  }
+
+  template <class EC>
+  u32 Tile<EC>::GetLiveAtomCount() const
+  {
+    // Whatever the inert atoms don't account for
+    const u32 emptyType = Element_Empty<EC>::THE_INSTANCE.GetType();
+    u32 inertAtoms = 0;
+    for (u32 i = 0; i < m_elementTable.GetSize(); ++i)
+    {
+      const Element<EC> * elt = m_elementTable.GetElementAtIndex(i);
+      if (elt && (elt->IsInert() || elt->GetType() == emptyType))
+      {
+        inertAtoms += (u32) m_cdata.GetAtomCount(elt->GetType());
+      }
+    }
+    return OWNED_WIDTH * OWNED_HEIGHT - MIN(inertAtoms, (u32) (OWNED_WIDTH * OWNED_HEIGHT));
+  }
+
+  template <class EC>
+  bool Tile<EC>::IsCacheIdle() const
+  {
+    for (u32 i = 0; i < Dirs::DIR_COUNT; ++i)
+    {
+      if (!m_cacheProcessors[i].IsIdle() && !m_cacheProcessors[i].IsUnclaimed())
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
   template <class EC>
   void Tile<EC>::SetBackgroundRadiationEnabled(bool on)
   {
@@ -718,18 +875,21 @@ namespace MFM
       if (m_state == OFF || m_state == PASSIVE)
       {
         m_state = m_requestedState;
+        ++m_stateChanges;
         return true;
       }
 
       if (AllCacheProcessorsIdle())
       {
         m_state = m_requestedState;
+        ++m_stateChanges;
         return true;
       }
       return false;
 
     case PASSIVE:
       m_state = m_requestedState;
+      ++m_stateChanges;
       return true;
 
     case OFF:
@@ -754,12 +914,342 @@ namespace MFM
       return false;
     }
 
+    RefreshTileParameters();
+
+    if (m_eventBatchSize > 1)
+    {
+      return AdvanceBatchedComputation();
+    }
+
+    if (m_eventWorkers && !m_agedEvents && !m_sparseEvents && !m_elementProfiling)
+    {
+      return m_eventWorkers->Advance();
+    }
+
+    // A parked optimistic event goes first, whatever else happens
+    bool committed = false;
+    if (m_optimisticEvents && m_optimisticWindow->IsParked())
+    {
+      committed = m_optimisticWindow->AdvanceParkedEvent();
+      m_window.AbsorbCounts(*m_optimisticWindow);
+    }
+
     //INITIATE_EVENT,
-    SPoint pt = GetRandomOwnedCoord(); //adjusted to range (0..Tile_Width, 0...Tile_Height)
+    SPoint pt;
+    if (m_agedEvents && !m_sparseEvents)
+    {
+      // Drawn with recency weighting already
+      m_window.CountEventAttempt();
+      return (PickAgedCoord(pt) && m_window.ExecuteEventAt(pt)) || committed;
+    }
+    if (!m_sparseEvents)
+    {
+      pt = GetRandomOwnedCoord(); //adjusted to range (0..Tile_Width, 0...Tile_Height)
+    }
+    else if (!PickOccupiedCoord(pt))
+    {
+      return true;  // An empty tile's event was credited
+    }
     if (RegionIn(pt) == REGION_CACHE)
       FAIL(ILLEGAL_STATE);
 
-    return m_window.TryEventAt(pt);
+    if (m_optimisticEvents && !IsInHidden(pt))
+    {
+      return TryOptimisticEventAt(pt) || committed;
+    }
+    return m_window.TryEventAt(pt) || committed;
+  }
+
+  template <class EC>
+  void Tile<EC>::SetOptimisticEvents(bool on)
+  {
+    if (on && !m_optimisticWindow)
+    {
+      m_optimisticWindow = new EventWindow<EC>(*this);
+    }
+    if (!on && m_optimisticWindow)
+    {
+      m_optimisticWindow->AbandonParkedEvent();
+    }
+    m_optimisticEvents = on;
+  }
+
+  template <class EC>
+  bool Tile<EC>::TryOptimisticEventAt(const SPoint & pt)
+  {
+    EventWindow<EC> & ow = *m_optimisticWindow;
+    bool stored;
+    if (ow.IsParked())
+    {
+      // One at a time; this one goes the usual way
+      stored = m_window.TryEventAt(pt);
+    }
+    else
+    {
+      stored = ow.TryOptimisticEventAt(pt);
+    }
+    m_window.AbsorbCounts(ow);
+    return stored;
+  }
+
+  template <class EC>
+  void Tile<EC>::SetEventBatchSize(u32 size)
+  {
+    MFM_API_ASSERT_ARG(size <= EventWindowBatch<EC>::MAX_EVENTS);
+    m_eventBatchSize = size;
+  }
+
+  template <class EC>
+  void Tile<EC>::SetEventWorkers(u32 workers)
+  {
+    MFM_API_ASSERT_ARG(workers <= EventWorkers<EC>::MAX_WORKERS);
+    MFM_API_ASSERT_STATE(!IsActive());
+    delete m_eventWorkers;
+    m_eventWorkers = workers > 1 ? new EventWorkers<EC>(*this, workers) : 0;
+  }
+
+  template <class EC>
+  u32 Tile<EC>::GetEventWorkers() const
+  {
+    return m_eventWorkers ? m_eventWorkers->GetWorkers() : 1;
+  }
+
+  template <class EC>
+  u64 Tile<EC>::GetHelperEvents() const
+  {
+    return m_eventWorkers ? m_eventWorkers->GetHelperEvents() : 0;
+  }
+
+  template <class EC>
+  bool Tile<EC>::AdvanceBatchedComputation()
+  {
+    enum { MAX_EVENTS = EventWindowBatch<EC>::MAX_EVENTS };
+    SPoint centers[MAX_EVENTS];
+    u32 types[MAX_EVENTS];
+    u32 count = 0;
+
+    // Draw the centers, keeping them sorted by type
+    const bool aged = m_agedEvents && !m_sparseEvents;
+    for (u32 i = 0; i < m_eventBatchSize; ++i)
+    {
+      SPoint pt;
+      if (aged)
+      {
+        m_window.CountEventAttempt();
+        if (!PickAgedCoord(pt))
+        {
+          continue;
+        }
+      }
+      else if (!m_sparseEvents)
+      {
+        pt = GetRandomOwnedCoord();
+      }
+      else if (!PickOccupiedCoord(pt))
+      {
+        continue;  // An empty tile's event was credited
+      }
+
+      bool overlaps = false;
+      for (u32 j = 0; j < count && !overlaps; ++j)
+      {
+        overlaps = (centers[j] - pt).GetManhattanLength() <= 2 * EVENT_WINDOW_RADIUS;
+      }
+      if (overlaps || (!aged && !m_window.AcceptEventAt(pt)))
+      {
+        continue;
+      }
+
+      const u32 type = GetAtom(pt)->GetType();
+      u32 j = count++;
+      for (; j > 0 && types[j - 1] > type; --j)
+      {
+        centers[j] = centers[j - 1];
+        types[j] = types[j - 1];
+      }
+      centers[j] = pt;
+      types[j] = type;
+    }
+
+    bool advanced = false;
+    for (u32 i = 0; i < count; )
+    {
+      u32 end = i + 1;
+      while (end < count && types[end] == types[i])
+      {
+        ++end;
+      }
+
+      const Element<EC> * elt = m_elementTable.Lookup(types[i]);
+      if (end - i > 1 && elt && elt->IsBatchable() && !elt->IsInert() && !m_elementProfiling)
+      {
+        EventWindowBatch<EC> batch(m_window, *elt);
+        for (; i < end; ++i)
+        {
+          batch.Add(centers[i]);
+        }
+        m_window.ExecuteBatch(batch);
+        advanced = advanced || batch.GetExecuted() > 0;
+      }
+      else
+      {
+        for (; i < end; ++i)
+        {
+          advanced = m_window.ExecuteEventAt(centers[i]) || advanced;
+        }
+      }
+    }
+    return advanced;
+  }
+
+  template <class EC>
+  void Tile<EC>::SetSparseEvents(bool on)
+  {
+    if (on && !m_occupiedSites)
+    {
+      m_occupiedSites = new u32[GetSites()];
+      m_occupiedSlots = new u32[GetSites()];
+    }
+    m_sparseEvents = on;
+    m_occupancyStale = true;
+  }
+
+  template <class EC>
+  void Tile<EC>::SetAgedEvents(bool on)
+  {
+    if (on && !m_eventAges.IsInitted())
+    {
+      m_eventAges.Init(OWNED_WIDTH * OWNED_HEIGHT, m_warpFactor);
+      RebuildEventAges();
+    }
+    m_agedEvents = on;
+  }
+
+  template <class EC>
+  void Tile<EC>::RebuildEventAges()
+  {
+    for (u32 y = 0; y < OWNED_HEIGHT; ++y)
+    {
+      for (u32 x = 0; x < OWNED_WIDTH; ++x)
+      {
+        const SPoint owned(x, y);
+        m_eventAges.SetLastEvent(y * OWNED_WIDTH + x, GetUncachedSite(owned).GetLastEventNumber());
+      }
+    }
+    m_eventAges.Rebuild(m_warpFactor, GetEventsExecuted());
+  }
+
+  template <class EC>
+  bool Tile<EC>::PickAgedCoord(SPoint & pt)
+  {
+    const u64 now = GetEventsExecuted();
+    if (now < m_eventAges.GetNow() || m_warpFactor != m_eventAges.GetWarpFactor())
+    {
+      RebuildEventAges();
+    }
+
+    u32 n;
+    if (!m_eventAges.Pick(m_random, now, n))
+    {
+      return false;
+    }
+    pt = OwnedCoordToTile(SPoint(n % OWNED_WIDTH, n / OWNED_WIDTH));
+    return true;
+  }
+
+  template <class EC>
+  u32 Tile<EC>::GetOccupiedSiteCount()
+  {
+    MFM_API_ASSERT_STATE(m_sparseEvents);
+    if (IsOccupancyStale())
+    {
+      RebuildOccupancy();
+    }
+    return m_occupiedCount;
+  }
+
+  template <class EC>
+  void Tile<EC>::RebuildOccupancy()
+  {
+    // Cleared first, so staleness flagged mid-scan sticks
+    __atomic_store_n(&m_occupancyStale, false, __ATOMIC_SEQ_CST);
+
+    const u32 emptyType = Element_Empty<EC>::THE_INSTANCE.GetType();
+    m_occupiedCount = 0;
+    for (u32 y = 0; y < OWNED_HEIGHT; ++y)
+    {
+      for (u32 x = 0; x < OWNED_WIDTH; ++x)
+      {
+        const u32 n = y * OWNED_WIDTH + x;
+        const SPoint pt = OwnedCoordToTile(SPoint(x, y));
+        if (GetAtom(pt)->GetType() == emptyType)
+        {
+          m_occupiedSlots[n] = 0;
+        }
+        else
+        {
+          m_occupiedSites[m_occupiedCount++] = n;
+          m_occupiedSlots[n] = m_occupiedCount;
+        }
+      }
+    }
+  }
+
+  template <class EC>
+  void Tile<EC>::UpdateOccupancy(const SPoint & pt, bool occupied)
+  {
+    const u32 n = OwnedSiteNumber(pt);
+    const u32 slot = m_occupiedSlots[n];
+    if (occupied && slot == 0)
+    {
+      m_occupiedSites[m_occupiedCount++] = n;
+      m_occupiedSlots[n] = m_occupiedCount;
+    }
+    else if (!occupied && slot != 0)
+    {
+      // Move the last entry into the vacated slot
+      const u32 last = m_occupiedSites[--m_occupiedCount];
+      m_occupiedSites[slot - 1] = last;
+      m_occupiedSlots[last] = slot;
+      m_occupiedSlots[n] = 0;
+    }
+  }
+
+  template <class EC>
+  bool Tile<EC>::PickOccupiedCoord(SPoint & pt)
+  {
+    if (IsOccupancyStale())
+    {
+      RebuildOccupancy();
+    }
+
+    const u32 sites = GetSites();
+    u64 skipped = 0;
+    if (m_occupiedCount == 0)
+    {
+      skipped = 1;
+    }
+    else
+    {
+      // Each uniform draw hits an occupied site with odds
+      // m_occupiedCount in sites; draw the misses before a hit at once
+      skipped = m_random.GeometricSkip(m_occupiedCount, sites);
+    }
+
+    if (skipped > 0)
+    {
+      m_window.CreditSkippedEvents(skipped);
+      m_skippedEmptyEvents += skipped;
+    }
+
+    if (m_occupiedCount == 0)
+    {
+      return false;
+    }
+
+    const u32 n = m_occupiedSites[m_random.Create(m_occupiedCount)];
+    pt = OwnedCoordToTile(SPoint(n % OWNED_WIDTH, n / OWNED_WIDTH));
+    return true;
   }
 
   template <class EC>
@@ -777,6 +1267,48 @@ namespace MFM
     return didWork;
   }
 
+  template <class EC>
+  void Tile<EC>::AccountMemory(MemoryAccount & account) const
+  {
+    u64 rest = sizeof(*this);
+
+    u64 cpBytes = sizeof(m_cacheProcessors);
+    for (u32 d = 0; d < Dirs::DIR_COUNT; ++d)
+    {
+      cpBytes += m_cacheProcessors[d].GetStorageBytes();
+    }
+    account.Add(MemoryAccount::CACHE_PROCESSORS, cpBytes);
+    rest -= sizeof(m_cacheProcessors);
+
+    account.Add(MemoryAccount::EVENT_HISTORY,
+                sizeof(m_eventHistoryBuffer) + m_eventHistoryBuffer.GetStorageBytes());
+    rest -= sizeof(m_eventHistoryBuffer);
+
+    account.Add(MemoryAccount::ELEMENTS, sizeof(m_elementTable));
+    rest -= sizeof(m_elementTable);
+
+    u64 indexBytes = sizeof(m_eventAges) + m_eventAges.GetStorageBytes();
+    indexBytes += (u64) GetChangeBlockCount() * sizeof(u32);
+    indexBytes += (u64) GetEventBinCount() * sizeof(u64);
+    if (m_occupiedSites)
+    {
+      indexBytes += 2 * (u64) GetSites() * sizeof(u32);
+    }
+    account.Add(MemoryAccount::TILE_INDEXES, indexBytes);
+    rest -= sizeof(m_eventAges);
+
+    u64 tileBytes = rest;
+    if (m_eventWorkers)
+    {
+      tileBytes += m_eventWorkers->GetStorageBytes();
+    }
+    if (m_optimisticWindow)
+    {
+      tileBytes += sizeof(*m_optimisticWindow);
+    }
+    account.Add(MemoryAccount::TILES, tileBytes);
+  }
+
   template <class EC>
   void Tile<EC>::ReportTileStatus(Logger::Level level)
   {
@@ -790,11 +1322,16 @@ namespace MFM
     LOG.Log(level,"   Error stack top: %p", (void*) m_errorEnvironmentStackTop);
 
     LOG.Log(level,"  ==Tile %s Atomic==", m_label.GetZString());
-    LOG.Log(level,"   Recount needed: %s", m_cdata.m_needRecount?"true":"false");
+    LOG.Log(level,"   Recount needed: %s", m_cdata.IsRecountPending()?"true":"false");
 
     LOG.Log(level,"  ==Tile %s Events==", m_label.GetZString());
     LOG.Log(level,"   Events: %dM (total)", (u32) (GetEventsExecuted() / 1000000));
 
+#ifdef MFM_EVENT_PHASE_TIMING
+    LOG.Log(level,"  ==Tile %s Event phases==", m_label.GetZString());
+    m_eventPhaseTimer.ReportPhaseTimes(level, "   ");
+#endif
+
     for (u32 d = Dirs::NORTH; d <= Dirs::NORTHWEST; ++d)
     {
       CacheProcessor<EC> & cp = GetCacheProcessor(d);
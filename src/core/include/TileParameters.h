@@ -0,0 +1,98 @@
+/*                                              -*- mode:C++ -*-
+  TileParameters.h Published tile parameter values
+  Copyright (C) 2020 The Living Computation Foundation.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+  USA
+*/
+
+/**
+  \file TileParameters.h Published tile parameter values
+  \author David H. Ackley.
+  \date (C) 2020 All rights reserved.
+  \lgpl
+ */
+
+#ifndef TILEPARAMETERS_H
+#define TILEPARAMETERS_H
+
+#include "itype.h"
+#include "Mutex.h"
+
+namespace MFM
+{
+  /**
+     One complete, never-modified set of tile parameter values.  Each
+     block published gets the next m_generation, so a reader can tell
+     whether it has seen it already.
+   */
+  struct TileParameterBlock
+  {
+    enum { MAX_PARAMETERS = 16 };
+
+    s32 m_values[MAX_PARAMETERS];
+    u32 m_generation;
+
+    /** The block this one replaced, kept until the publisher dies */
+    TileParameterBlock * m_retired;
+  };
+
+  /**
+     Holds the current TileParameterBlock for a set of running tiles.
+     A change copies the current block, modifies the copy, and then
+     publishes it with a single release store of m_current, so tiles
+     can pick it up at their next event boundary with an acquire load
+     -- no tile ever has to be paused, and a tile never sees a
+     half-updated set.
+
+     Replaced blocks are not freed until the publisher is, since a
+     tile may still be reading one.  Parameter changes are rare
+     operator actions, so the memory this holds stays small.
+   */
+  class TileParameterPublisher
+  {
+  public:
+    TileParameterPublisher() ;
+
+    ~TileParameterPublisher() ;
+
+    /**
+       Publish a block like the current one, but with \c value in slot
+       \c key.  Safe to call from any thread, while tiles run.
+     */
+    void Set(u32 key, s32 value) ;
+
+    /**
+       \returns the latest published block.  Safe to call from any
+       thread; the block is never changed or freed while this
+       publisher exists.
+     */
+    const TileParameterBlock * GetCurrent() const
+    {
+      return __atomic_load_n(&m_current, __ATOMIC_ACQUIRE);
+    }
+
+  private:
+    TileParameterBlock * m_current;
+
+    /** Serializes Set()s */
+    Mutex m_writeLock;
+
+    // Declare away copy ctor; tiles hold pointers to us
+    TileParameterPublisher(const TileParameterPublisher &) ;
+  };
+}
+
+#endif /* TILEPARAMETERS_H */
@@ -0,0 +1,93 @@
+/*                                              -*- mode:C++ -*-
+  TileSiteOwners.h Which tile sites some concurrent event is holding
+  Copyright (C) 2020 The Living Computation Foundation.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+  USA
+*/
+
+/**
+  \file TileSiteOwners.h Which tile sites some concurrent event is holding
+  \author David H. Ackley.
+  \date (C) 2020 All rights reserved.
+  \lgpl
+ */
+#ifndef TILESITEOWNERS_H
+#define TILESITEOWNERS_H
+
+#include "itype.h"
+#include "Point.h"
+#include "Mutex.h"
+
+namespace MFM
+{
+  /**
+     The sites of one tile held by events running at the same time
+     in it, one bit per site, a row at a time in 64-bit words, as in
+     the T2 tile's SiteOwnership.  An event claims the diamond
+     footprint of its window before loading it, and releases it
+     after storing back; a claim overlapping any held site fails
+     without holding anything.  Claims and releases are serialized
+     by an internal lock, so any thread may make them.
+   */
+  class TileSiteOwners
+  {
+  public:
+    TileSiteOwners(u32 width, u32 height) ;
+
+    ~TileSiteOwners() ;
+
+    bool IsOwned(const SPoint & site) const ;
+
+    /**
+       Hold every site within Manhattan distance \c radius of \c
+       center, clipped to the tile, if none of them is held already.
+       \returns false, holding nothing more, if any was.
+     */
+    bool TryClaim(const SPoint & center, u32 radius) ;
+
+    /**
+       Let go of a footprint TryClaim got.  FAILs with ILLEGAL_STATE
+       if any of its sites wasn't held.
+     */
+    void Release(const SPoint & center, u32 radius) ;
+
+    /** How many sites are held */
+    u32 GetOwnedCount() const ;
+
+    /** Heap bytes held by the owner bits */
+    u64 GetStorageBytes() const
+    {
+      return (u64) m_rowWords * m_height * sizeof(u64);
+    }
+
+  private:
+    const u32 m_width;
+    const u32 m_height;
+    const u32 m_rowWords;
+    u64 * m_rows;
+    Mutex m_lock;
+
+    /** Call \c visit(word, mask) on each word the footprint touches */
+    template <class VISITOR>
+    bool VisitFootprint(const SPoint & center, u32 radius, VISITOR & visit) ;
+
+    // Declare away
+    TileSiteOwners(const TileSiteOwners &) ;
+    TileSiteOwners & operator=(const TileSiteOwners &) ;
+  };
+}
+
+#endif /* TILESITEOWNERS_H */
@@ -0,0 +1,165 @@
+/*                                              -*- mode:C++ -*-
+  TileSweeper.h Running simple elements' events as a checkerboard kernel
+  Copyright (C) 2020 The Living Computation Foundation.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+  USA
+*/
+
+/**
+  \file TileSweeper.h Running simple elements' events as a checkerboard kernel
+  \date (C) 2020 All rights reserved.
+  \lgpl
+ */
+#ifndef TILESWEEPER_H
+#define TILESWEEPER_H
+
+#include "itype.h"
+#include "Point.h"
+#include "SweepRule.h"
+#include "ElementTable.h"
+
+namespace MFM
+{
+  template <class EC> class Tile; // FORWARD
+
+  /**
+     A TileSweeper runs a synchronous-phase approximation of a tile's
+     asynchronous events, shaped for data-parallel hardware.  One
+     Sweep gives every owned site one event, in PHASES phases: in
+     each, the event centers are the sites on a lattice SPACING apart,
+     whose radius-1 windows can't overlap, so all of a phase's events
+     could run at once.  Each event's random draws are a hash of the
+     seed, the phase and the center -- not a shared PRNG -- so they
+     don't depend on the order events run in.
+
+     Centers holding an element with a SweepRule (see
+     Element::GetSweepRule) run that rule in a first, kernel pass
+     over the phase.  Other centers then get an ordinary event
+     through the tile's EventWindow, in a second pass, so anything
+     the kernel can't express still behaves as usual -- just with
+     its usual, larger window.
+
+     The kernel pass is the part an accelerator would take over.
+     Here it runs on the calling thread.  Sweep results differ from
+     ordinary events: order within a phase is fixed, and SweepRule
+     diffusion is only an approximation.
+   */
+  template <class EC>
+  class TileSweeper
+  {
+    typedef typename EC::ATOM_CONFIG AC;
+    typedef typename AC::ATOM_TYPE T;
+    typedef typename EC::SITE S;
+    enum { R = EC::EVENT_WINDOW_RADIUS };
+    enum { EMPTY_TYPE = AC::ATOM_EMPTY_TYPE };
+
+  public:
+    enum
+    {
+      SPACING = 3,                // Radius-1 windows this far apart are disjoint
+      PHASES = SPACING * SPACING
+    };
+
+    TileSweeper() ;
+
+    /**
+       Collect the SweepRules of the elements in \c tile's element
+       table, resolving each rewrite to the default atom of its
+       target.  A rule with a target that isn't in the table isn't
+       used.  Call again whenever the table or the elements'
+       parameters may have changed.
+
+       @returns the number of elements whose rules will be used
+     */
+    u32 Prepare(const Tile<EC> & tile) ;
+
+    /**
+       Run one event at every owned site of \c tile -- PHASES calls
+       of SweepPhase -- drawing kernel randomness from \c seed.
+       Ordinary events draw from the tile's Random as usual.
+
+       @returns the number of events run
+     */
+    u32 Sweep(Tile<EC> & tile, u32 seed) ;
+
+    /**
+       Run the events of one phase of a Sweep.
+
+       @returns the number of events run
+     */
+    u32 SweepPhase(Tile<EC> & tile, u32 seed, u32 phase) ;
+
+    /** Events run as kernel events since construction */
+    u64 GetKernelEvents() const
+    {
+      return m_kernelEvents;
+    }
+
+    /** Events run as ordinary events since construction */
+    u64 GetFallbackEvents() const
+    {
+      return m_fallbackEvents;
+    }
+
+    /**
+       The \c draw'th random number for the event at \c site in a
+       phase seeded \c seed: a stateless integer hash, as a kernel
+       thread would use.
+     */
+    static u32 Draw(u32 seed, u32 site, u32 draw)
+    {
+      u32 h = seed ^ (site * 0x9e3779b9u) ^ (draw * 0x85ebca6bu);
+      h ^= h >> 16;
+      h *= 0x7feb352du;
+      h ^= h >> 15;
+      h *= 0x846ca68bu;
+      h ^= h >> 16;
+      return h;
+    }
+
+  private:
+    /** What a SweepRule becomes for one element table slot */
+    struct SlotRule
+    {
+      bool m_usable;
+      SweepRule m_rule;
+      T m_toAtoms[SweepRule::MAX_REWRITES];
+    };
+
+    SlotRule m_slots[ElementTable<EC>::SIZE];
+    u64 m_kernelEvents;
+    u64 m_fallbackEvents;
+
+    /** The rule for atoms of elementType, or NULL */
+    const SlotRule * FindRule(const ElementTable<EC> & et, u32 elementType) const
+    {
+      const s32 idx = et.GetIndex(elementType);
+      return idx >= 0 && m_slots[idx].m_usable ? &m_slots[idx] : 0;
+    }
+
+    /** Run rule as the event at tile coordinate center */
+    void RunKernelEvent(Tile<EC> & tile, const SlotRule & rule,
+                        const SPoint & center, u32 seed) ;
+
+    // Declare away
+    TileSweeper(const TileSweeper &) ;
+    TileSweeper & operator=(const TileSweeper &) ;
+  };
+} /* namespace MFM */
+
+#include "TileSweeper.tcc"
+
+#endif /* TILESWEEPER_H */
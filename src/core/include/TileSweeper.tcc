@@ -0,0 +1,164 @@
+/* -*- C++ -*- */
+#include "Tile.h"
+#include "Element.h"
+
+namespace MFM
+{
+  template <class EC>
+  TileSweeper<EC>::TileSweeper()
+    : m_kernelEvents(0)
+    , m_fallbackEvents(0)
+  {
+    for (u32 i = 0; i < ElementTable<EC>::SIZE; ++i)
+    {
+      m_slots[i].m_usable = false;
+    }
+  }
+
+  template <class EC>
+  u32 TileSweeper<EC>::Prepare(const Tile<EC> & tile)
+  {
+    const ElementTable<EC> & et = tile.GetElementTable();
+    u32 usable = 0;
+    for (u32 i = 0; i < et.GetSize(); ++i)
+    {
+      SlotRule & sr = m_slots[i];
+      const Element<EC> * elt = et.GetElementAtIndex(i);
+      sr.m_usable = elt && elt->GetSweepRule(sr.m_rule);
+      for (u32 j = 0; sr.m_usable && j < sr.m_rule.m_rewriteCount; ++j)
+      {
+        const Element<EC> * to = et.Lookup(sr.m_rule.m_rewrites[j].m_toType);
+        if (to)
+          sr.m_toAtoms[j] = to->GetDefaultAtom();
+        else
+          sr.m_usable = false;
+      }
+      if (sr.m_usable)
+        ++usable;
+    }
+    return usable;
+  }
+
+  template <class EC>
+  void TileSweeper<EC>::RunKernelEvent(Tile<EC> & tile, const SlotRule & rule,
+                                       const SPoint & center, u32 seed)
+  {
+    // In MDist::FillRandomSingleDir order
+    static const s32 DX[4] = {  0, 0, -1, 1 };
+    static const s32 DY[4] = { -1, 1,  0, 0 };
+
+    const SweepRule & sr = rule.m_rule;
+    const u32 site = (u32) ((center.GetY() << 16) | center.GetX());
+    u32 draw = 0;
+
+    if (sr.m_rewriteCount > 0)
+    {
+      const u32 dir = Draw(seed, site, draw++) & 3;
+      const SPoint at(center.GetX() + DX[dir], center.GetY() + DY[dir]);
+      if (tile.IsLiveSite(at))
+      {
+        const u32 type = tile.GetAtom(at)->GetType();
+        for (u32 i = 0; i < sr.m_rewriteCount; ++i)
+        {
+          const SweepRule::Rewrite & rw = sr.m_rewrites[i];
+          if (rw.m_fromType != (u32) SweepRule::ANY_TYPE && rw.m_fromType != type)
+          {
+            continue;
+          }
+          if (rw.m_oneIn > 0 && Draw(seed, site, draw++) % rw.m_oneIn == 0)
+          {
+            if (rw.m_toType != type)
+            {
+              tile.PlaceAtom(rule.m_toAtoms[i], at);
+            }
+            break;
+          }
+          if (!rw.m_orElse)
+          {
+            break;
+          }
+        }
+      }
+    }
+
+    if (sr.m_diffuses)
+    {
+      const u32 dir = Draw(seed, site, draw++) & 3;
+      const SPoint at(center.GetX() + DX[dir], center.GetY() + DY[dir]);
+      if (tile.IsLiveSite(at) && tile.GetAtom(at)->GetType() == EMPTY_TYPE)
+      {
+        const T moving = *tile.GetAtom(center);
+        const T empty = *tile.GetAtom(at);
+        tile.PlaceAtom(empty, center);
+        tile.PlaceAtom(moving, at);
+      }
+    }
+  }
+
+  template <class EC>
+  u32 TileSweeper<EC>::SweepPhase(Tile<EC> & tile, u32 seed, u32 phase)
+  {
+    MFM_API_ASSERT_ARG(phase < PHASES);
+
+    const ElementTable<EC> & et = tile.GetElementTable();
+    const u32 xEnd = tile.GetTileWidth() - R;
+    const u32 yEnd = tile.GetTileHeight() - R;
+    const u32 x0 = R + phase % SPACING;
+    const u32 y0 = R + phase / SPACING;
+    const u32 phaseSeed = Draw(seed, phase, 0);
+    u32 kernel = 0;
+    u32 fallback = 0;
+
+    // Kernel pass: no two of these windows overlap, so any order
+    // would do -- or all at once
+    for (u32 y = y0; y < yEnd; y += SPACING)
+    {
+      for (u32 x = x0; x < xEnd; x += SPACING)
+      {
+        const SPoint center(x, y);
+        const SlotRule * rule = FindRule(et, tile.GetAtom(center)->GetType());
+        if (!rule)
+        {
+          continue;
+        }
+        ++kernel;
+        if (rule->m_rule.m_rewriteCount > 0 || rule->m_rule.m_diffuses)
+        {
+          RunKernelEvent(tile, *rule, center, phaseSeed);
+        }
+      }
+    }
+
+    // Ordinary pass: kernel events change no other center, so the
+    // centers without rules are just as they were
+    EventWindow<EC> & ew = tile.GetEventWindow();
+    for (u32 y = y0; y < yEnd; y += SPACING)
+    {
+      for (u32 x = x0; x < xEnd; x += SPACING)
+      {
+        const SPoint center(x, y);
+        if (!FindRule(et, tile.GetAtom(center)->GetType()))
+        {
+          ew.TryUnlockedEventAt(center);
+          ++fallback;
+        }
+      }
+    }
+
+    tile.CreditSweptEvents(kernel);
+    m_kernelEvents += kernel;
+    m_fallbackEvents += fallback;
+    return kernel + fallback;
+  }
+
+  template <class EC>
+  u32 TileSweeper<EC>::Sweep(Tile<EC> & tile, u32 seed)
+  {
+    u32 events = 0;
+    for (u32 phase = 0; phase < PHASES; ++phase)
+    {
+      events += SweepPhase(tile, seed, phase);
+    }
+    return events;
+  }
+} /* namespace MFM */
@@ -42,6 +42,8 @@ namespace MFM {
    * A class representing a 'Universal Unique ID' for an Element.  A
    * UUID is meant to be a 'fingerprint' of an Element.
    */
+  struct UUIDInternTable; // FORWARD
+
   class UUID : public ByteSerializable {
   public:
     typedef OString256 OStringUUIDName;
@@ -57,7 +59,7 @@ namespace MFM {
      */
     static const u32 API_VERSION = 1;
 
-    UUID() : m_configurationCode(0), m_elementVersion(0), m_uuidVersion(1), m_hexDate(0), m_hexTime(0)
+    UUID() : m_configurationCode(0), m_elementVersion(0), m_uuidVersion(1), m_hexDate(0), m_hexTime(0), m_handle(0)
     {
       m_label.Reset();
     }
@@ -104,7 +106,8 @@ namespace MFM {
       : m_configurationCode(configCode),
         m_elementVersion(elementVersion),
         m_uuidVersion(API_VERSION),
-        m_hexDate(decDate), m_hexTime(decTime)
+        m_hexDate(decDate), m_hexTime(decTime),
+        m_handle(0)
     {
       MFM_API_ASSERT_NONNULL(label);
       MFM_API_ASSERT_ARG(LegalLabel(label));
@@ -183,6 +186,27 @@ namespace MFM {
       return *this == other;
     }
 
+    /**
+       A small nonzero integer that is the same for all UUIDs that are
+       == to this one, and different for all that aren't, for as long
+       as the program runs.  The first call interns this UUID in a
+       global table, under a lock; later calls (and copies made
+       afterwards) just return the saved handle.
+
+       \sa operator==
+     */
+    u32 GetHandle() const {
+      u32 handle = __atomic_load_n(&m_handle, __ATOMIC_RELAXED);
+      if (!handle)
+        handle = Intern();
+      return handle;
+    }
+
+    /**
+       UUIDs are equal if their labels, element versions, UUID
+       versions, dates and times are.  Two interned UUIDs are compared
+       by handle alone.
+     */
     bool operator==(const UUID & other) const ;
 
     bool operator!=(const UUID & other) const {
@@ -192,9 +216,16 @@ namespace MFM {
     virtual ~UUID() { }
 
   private:
+    friend struct UUIDInternTable;
 
     s32 CompareDateOnly(const UUID & other) const ;
 
+    bool EqualFields(const UUID & other) const ;
+
+    u32 HashFields() const ;
+
+    u32 Intern() const ;
+
     OStringUUIDName m_label;
     u32 m_configurationCode;
     u32 m_elementVersion;
@@ -202,6 +233,9 @@ namespace MFM {
     u32 m_hexDate;
     u32 m_hexTime;
 
+    /** 0 until GetHandle() is first called, and when fields change */
+    mutable u32 m_handle;
+
   };
 
 }
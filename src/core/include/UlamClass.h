@@ -428,6 +428,35 @@ namespace MFM
       FAIL(ILLEGAL_STATE);
     }
 
+    /**
+       What PrintClassMembers needs to know about one data member,
+       parsed from its mangled type and class names.  The pretty
+       names are offsets into m_memberFormatText.
+     */
+    struct MemberFormat
+    {
+      u32 m_bitSize;
+      u32 m_arrayLength;
+      u8 m_category;        // An UlamTypeInfo::Category
+      u8 m_primType;        // An UlamTypeInfoPrimitive::PrimType, if m_category is PRIM
+      bool m_zeroLengthArray;
+      u32 m_prettyType;
+      u32 m_prettyClass;
+    };
+
+    /**
+       Parse all the data member types of this class once, so that
+       PrintClassMembers no longer has to on every call.  Done by
+       UlamClassRegistry::RegisterUlamClass; later calls do nothing.
+       Not thread safe, so it must happen before any printing.
+     */
+    void CacheMemberFormats() ;
+
+    bool HasCachedMemberFormats() const
+    {
+      return m_memberFormats != 0;
+    }
+
     void PrintClassMembers(const UlamClassRegistry<EC> & ucr,
 			   ByteSink & bs,
 			   const BitStorage<EC>& stg,
@@ -449,9 +478,67 @@ namespace MFM
 
     virtual bool IsTheEmptyClass() const { return false; }
 
-    UlamClass() { }
+    /** The most virtual functions a class can mark final one by one */
+    enum { MAX_FINAL_FUNCTIONS = 64 };
+
+    /**
+       Devirtualization hints, for generated code to give when it
+       knows.  A final class has no subclasses, so as an effective
+       self nothing more specific can override it.  A final function
+       -- named by its index among the virtual functions this class
+       originates -- is overridden nowhere, and a final class's own
+       functions all are final.  The UlamRef virtual-call
+       constructors resolve such calls straight from one vtable,
+       with no callstack search and no cache.  A wrong hint makes
+       wrong calls.
+     */
+    void SetFinalClass()
+    {
+      m_isFinalClass = true;
+    }
+
+    bool IsFinalClass() const
+    {
+      return m_isFinalClass;
+    }
+
+    void SetFinalFunction(u32 vownedfuncidx)
+    {
+      MFM_API_ASSERT_ARG(vownedfuncidx < MAX_FINAL_FUNCTIONS);
+      m_finalFunctions |= ((u64) 1) << vownedfuncidx;
+    }
+
+    /**
+       Does every call of function \c vownedfuncidx, originating in
+       this class, reach this class's own vtable entry?
+     */
+    bool IsFinalFunction(u32 vownedfuncidx) const
+    {
+      return m_isFinalClass ||
+        (vownedfuncidx < MAX_FINAL_FUNCTIONS && ((m_finalFunctions >> vownedfuncidx) & 1));
+    }
+
+    UlamClass()
+      : m_memberFormats(0)
+      , m_memberFormatText(0)
+      , m_finalFunctions(0)
+      , m_isFinalClass(false)
+    { }
 
   private:
+    /** One per data member once cached, else 0.  Lives as long as we do. */
+    MemberFormat * m_memberFormats;
+
+    /** The pretty type and class names of m_memberFormats */
+    char * m_memberFormatText;
+
+    u64 m_finalFunctions;  // Bit per vownedfuncidx, \sa SetFinalFunction
+    bool m_isFinalClass;
+
+    static void ParseMemberFormat(const UlamClassDataMemberInfo & dmi,
+                                  MemberFormat & mf,
+                                  ByteSink & prettyType,
+                                  ByteSink & prettyClass) ;
   };
 
 } // MFM
@@ -81,18 +81,37 @@ namespace MFM {
     {
       bool opened = false;
       OString128 lastBaseClassName;
+      OString512 parsedType;
+      OString128 parsedClass;
       for (s32 i = 0; i < GetDataMemberCount(); ++i)
       {
         const UlamClassDataMemberInfo & dmi = GetDataMemberInfo((u32) i);
-	UlamTypeInfo utin;
-        if (!utin.InitFrom(dmi.m_mangledType))
-          FAIL(ILLEGAL_STATE);
+
+        // Use the formats cached at registration if we have them
+        MemberFormat parsed;
+        const MemberFormat * mf = &parsed;
+        const char * prettyType;
+        const char * className;
+        if (m_memberFormats)
+        {
+          mf = &m_memberFormats[i];
+          prettyType = m_memberFormatText + mf->m_prettyType;
+          className = m_memberFormatText + mf->m_prettyClass;
+        }
+        else
+        {
+          parsedType.Reset();
+          parsedClass.Reset();
+          ParseMemberFormat(dmi, parsed, parsedType, parsedClass);
+          prettyType = parsedType.GetZString();
+          className = parsedClass.GetZString();
+        }
 
         // Skip 0 length arrays period
-        if (utin.IsZeroLengthArray()) continue;
+        if (mf->m_zeroLengthArray) continue;
 
         // Skip size 0 members unless they reeeally want them
-        if (utin.GetBitSize() == 0 && !(flags & PRINT_SIZE0_MEMBERS)) continue;
+        if (mf->m_bitSize == 0 && !(flags & PRINT_SIZE0_MEMBERS)) continue;
 
         if (!opened)
         {
@@ -108,26 +127,21 @@ namespace MFM {
         }
         if (flags & PRINT_MEMBER_TYPES)
         {
-          utin.PrintPretty(bs,false);
-          bs.Printf(" ");
+          bs.Printf("%s ", prettyType);
         }
 
         if (true/*flags & PRINT_BASE_CLASS_NAMES*/)
         {
-          OString128 className;
-          UlamTypeInfo utin2;
-          if (!utin2.InitFrom(dmi.m_dataMemberClassName))
-            FAIL(ILLEGAL_STATE);
-          utin2.PrintPretty(className,true);
-          if (!className.Equals(lastBaseClassName))
+          if (!lastBaseClassName.Equals(className))
           {
             if (lastBaseClassName.GetLength() > 0)
             {
               bs.Printf(")");
             }
-            bs.Printf("%s(",className.GetZString());
+            bs.Printf("%s(",className);
             doNL(bs,flags,indent);
-            lastBaseClassName = className;
+            lastBaseClassName.Reset();
+            lastBaseClassName.Print(className);
           }
         }
 
@@ -141,12 +155,12 @@ namespace MFM {
         if (flags & PRINT_MEMBER_VALUES)
         {
           // For starters just dig out the bits and print them
-          u32 bitsize = utin.GetBitSize();
-          u32 arraysize = utin.GetArrayLength();
+          u32 bitsize = mf->m_bitSize;
+          u32 arraysize = mf->m_arrayLength;
 
           for (u32 idx = 0; idx < MAX(arraysize,1u); ++idx)
           {
-            if (utin.IsLocals()) break; // locals have no data members (and cannot be in arrays..)
+            if (mf->m_category == UlamTypeInfo::LOCALS) break; // locals have no data members (and cannot be in arrays..)
 
             if (arraysize > 0)
             {
@@ -167,7 +181,7 @@ namespace MFM {
               baseStatePos + dmi.m_bitPosition
               + offset + idx * bitsize;
 
-            if (utin.IsQuark() || utin.IsTransient())
+            if (mf->m_category == UlamTypeInfo::QUARK || mf->m_category == UlamTypeInfo::TRANSIENT)
             {
               if (flags & PRINT_RECURSE_QUARKS)
               {
@@ -197,9 +211,9 @@ namespace MFM {
               continue;
             }
 
-            if (!utin.IsPrimitive()) FAIL(ILLEGAL_STATE); // Can't happen now right?
+            if (mf->m_category != UlamTypeInfo::PRIM) FAIL(ILLEGAL_STATE); // Can't happen now right?
 
-            if (utin.m_utip.GetPrimType() == UlamTypeInfoPrimitive::ATOM) {
+            if (mf->m_primType == UlamTypeInfoPrimitive::ATOM) {
               // Just hex atoms for now
               bs.Printf("0x");
               stg.PrintHex(bs, startPos, bitsize);
@@ -207,7 +221,7 @@ namespace MFM {
             }
 
             u64 val = stg.ReadLong(startPos, bitsize);
-            switch (utin.m_utip.GetPrimType())
+            switch (mf->m_primType)
             {
             case UlamTypeInfoPrimitive::INT:
               {
@@ -277,6 +291,68 @@ namespace MFM {
     }
   } //PrintClassMembers
 
+  template <class EC>
+  void UlamClass<EC>::ParseMemberFormat(const UlamClassDataMemberInfo & dmi,
+                                        MemberFormat & mf,
+                                        ByteSink & prettyType,
+                                        ByteSink & prettyClass)
+  {
+    UlamTypeInfo utin;
+    if (!utin.InitFrom(dmi.m_mangledType))
+      FAIL(ILLEGAL_STATE);
+
+    mf.m_category = (u8) utin.m_category;
+    mf.m_primType = utin.IsPrimitive() ? utin.m_utip.m_primType : 0;
+    mf.m_zeroLengthArray = utin.IsZeroLengthArray();
+    mf.m_bitSize = utin.GetBitSize();
+    mf.m_arrayLength = utin.GetArrayLength();
+    utin.PrintPretty(prettyType, false);
+
+    UlamTypeInfo utin2;
+    if (!utin2.InitFrom(dmi.m_dataMemberClassName))
+      FAIL(ILLEGAL_STATE);
+    utin2.PrintPretty(prettyClass, true);
+  }
+
+  template <class EC>
+  void UlamClass<EC>::CacheMemberFormats()
+  {
+    if (m_memberFormats) return;
+    const s32 count = GetDataMemberCount();
+    if (count <= 0) return;
+
+    // First pass to size the text, second to keep it
+    MemberFormat * formats = new MemberFormat[count];
+    u32 textBytes = 0;
+    for (u32 pass = 0; pass < 2; ++pass)
+    {
+      u32 at = 0;
+      for (s32 i = 0; i < count; ++i)
+      {
+        OString512 prettyType;
+        OString128 prettyClass;
+        MemberFormat & mf = formats[i];
+        ParseMemberFormat(GetDataMemberInfo((u32) i), mf, prettyType, prettyClass);
+
+        mf.m_prettyType = at;
+        if (pass) memcpy(m_memberFormatText + at, prettyType.GetZString(), prettyType.GetLength() + 1);
+        at += prettyType.GetLength() + 1;
+
+        mf.m_prettyClass = at;
+        if (pass) memcpy(m_memberFormatText + at, prettyClass.GetZString(), prettyClass.GetLength() + 1);
+        at += prettyClass.GetLength() + 1;
+      }
+      if (!pass)
+      {
+        textBytes = at;
+        m_memberFormatText = new char[textBytes];
+      }
+      else
+        MFM_API_ASSERT_STATE(at == textBytes);
+    }
+    m_memberFormats = formats;
+  }
+
   template <class EC>
   void UlamClass<EC>::addHex(ByteSink & bs, u64 val)
   {
@@ -32,6 +32,7 @@
 #define ULAMCLASSREGISTRY_H
 
 #include "itype.h"
+#include "UlamVirtualCallCache.h"
 
 namespace MFM {
 
@@ -40,7 +41,14 @@ namespace MFM {
   template <class EC>
   struct UlamClassRegistry {
     enum {
-      TABLE_SIZE = 1000
+      TABLE_SIZE = 1000,
+      ELEMENT_TYPE_SLOT_BITS = 8,
+      ELEMENT_TYPE_SLOTS = 1<<ELEMENT_TYPE_SLOT_BITS,
+      ELEMENT_TYPE_SLOT_MASK = ELEMENT_TYPE_SLOTS-1,
+      NAME_INDEX_BITS = 11,     // > 2*TABLE_SIZE slots
+      NAME_INDEX_SIZE = 1<<NAME_INDEX_BITS,
+      NAME_INDEX_MASK = NAME_INDEX_SIZE-1,
+      NAME_INDEX_UNUSED = 0xffff
     };
 
     UlamClassRegistry()
@@ -48,6 +56,8 @@ namespace MFM {
       , m_ulamElementEmpty(0)
     {
       for(u32 i = 0; i < TABLE_SIZE; i++) m_registeredUlamClasses[i] = 0;
+      for(u32 i = 0; i < NAME_INDEX_SIZE; i++) m_nameIndex[i] = NAME_INDEX_UNUSED;
+      ClearElementTypes();
     }
 
     bool RegisterUlamClass(UlamClass<EC>& uc) ;
@@ -59,6 +69,18 @@ namespace MFM {
      */
     s32 RegisterUlamElementEmpty(UlamClass<EC>& uc) ;
 
+    /**
+       Swap in the count classes of ucs -- as from a reloaded element
+       library -- each at its registration number, in place of any
+       registered class of the same mangled name.  A Ue_10105Empty10
+       among them becomes the empty element.
+
+       @returns true if all were registered, or false, changing
+       nothing, if any registration number is out of range or held by
+       a class that isn't being replaced
+     */
+    bool ReplaceUlamClasses(UlamClass<EC> ** ucs, u32 count) ;
+
     s32 GetUlamClassIndex(const char *) const;
 
     bool IsRegisteredUlamClass(const char *mangledName) const;
@@ -71,10 +93,70 @@ namespace MFM {
 
     const UlamClass<EC> * GetUlamElementEmpty() const { return m_ulamElementEmpty; }
 
+    /** Memoized virtual call resolutions; emptied whenever a class
+        registers.  Mutable, since UlamRefs see only a const
+        registry -- but each Tile has its own registry copy, so no
+        two threads update the same one. */
+    UlamVirtualCallCache & GetVirtualCallCache() const { return m_vcallCache; }
+
+    /** @returns the UlamElement noted for element type etype, or NULL
+        if none has been.  One indexed load and a compare, for
+        resolving an UlamRef's effective self. */
+    const UlamClass<EC> * GetUlamElementOrNullByType(u32 etype) const
+    {
+      const ElementTypeSlot & s = m_elementTypes[etype & ELEMENT_TYPE_SLOT_MASK];
+      return s.m_type == etype ? s.m_uelt : 0;
+    }
+
+    /** Remember uelt as the UlamElement for element type etype, if
+        its slot is still free.  Element types are allocated after
+        classes register, so this fills in as types are first
+        resolved; const for the same reason as GetVirtualCallCache().
+        Slots are never overwritten, so a renderer reading this
+        registry from another thread sees either a miss or the right
+        answer. */
+    void NoteUlamElementType(u32 etype, const UlamClass<EC> & uelt) const
+    {
+      ElementTypeSlot & s = m_elementTypes[etype & ELEMENT_TYPE_SLOT_MASK];
+      if (s.m_type != U32_MAX) return; //taken, by etype or a collision
+      s.m_uelt = &uelt;
+      s.m_type = etype;
+    }
+
     UlamClass<EC> * m_registeredUlamClasses[TABLE_SIZE];
     u32 m_registeredUlamClassCount;
 
     UlamClass<EC> * m_ulamElementEmpty;
+
+    mutable UlamVirtualCallCache m_vcallCache;
+
+  private:
+    /** Open-addressed, linearly-probed registration numbers, hashed
+        by mangled class name */
+    u16 m_nameIndex[NAME_INDEX_SIZE];
+
+    static u32 HashMangledName(const char * mangledName) ;
+
+    /** @returns the registration number of the class named exactly
+        mangledName, or -1 */
+    s32 FindInNameIndex(const char * mangledName) const ;
+
+    void AddToNameIndex(const UlamClass<EC> & uc, u32 regnum) ;
+
+    struct ElementTypeSlot {
+      u32 m_type;               // Never a legal type when unused
+      const UlamClass<EC> * m_uelt;
+    };
+    mutable ElementTypeSlot m_elementTypes[ELEMENT_TYPE_SLOTS];
+
+    void ClearElementTypes()
+    {
+      for(u32 i = 0; i < ELEMENT_TYPE_SLOTS; i++)
+      {
+        m_elementTypes[i].m_type = U32_MAX;
+        m_elementTypes[i].m_uelt = 0;
+      }
+    }
   };
 
 } //MFM
@@ -4,11 +4,47 @@
 
 namespace MFM {
 
+  template <class EC>
+  u32 UlamClassRegistry<EC>::HashMangledName(const char * mangledName)
+  {
+    u32 h = 2166136261u; //FNV-1a
+    for (const char * p = mangledName; *p; ++p)
+      h = (h ^ (u8) *p) * 16777619u;
+    return h;
+  }
+
+  template <class EC>
+  s32 UlamClassRegistry<EC>::FindInNameIndex(const char * mangledName) const
+  {
+    for (u32 i = HashMangledName(mangledName) & NAME_INDEX_MASK; ; i = (i + 1) & NAME_INDEX_MASK)
+    {
+      const u32 regnum = m_nameIndex[i];
+      if (regnum == NAME_INDEX_UNUSED)
+        return -1;
+      if (!strcmp(m_registeredUlamClasses[regnum]->GetMangledClassName(), mangledName))
+        return (s32) regnum;
+    }
+  }
+
+  template <class EC>
+  void UlamClassRegistry<EC>::AddToNameIndex(const UlamClass<EC> & uc, u32 regnum)
+  {
+    u32 i = HashMangledName(uc.GetMangledClassName()) & NAME_INDEX_MASK;
+    while (m_nameIndex[i] != NAME_INDEX_UNUSED) //never full: > 2*TABLE_SIZE slots
+      i = (i + 1) & NAME_INDEX_MASK;
+    m_nameIndex[i] = (u16) regnum;
+  }
+
   template <class EC>
   s32 UlamClassRegistry<EC>::GetUlamClassIndex(const char *mangledName) const
   {
     if (!mangledName) FAIL(NULL_POINTER);
 
+    // Registered names are all scalar, so an exact match needs no parse
+    s32 idx = FindInNameIndex(mangledName);
+    if (idx >= 0)
+      return idx;
+
     // HACK: If mangledName is an array type, we need to get the
     // mangled name representing the underlying scalar type, for
     // lookup purposes.
@@ -21,17 +57,7 @@ namespace MFM {
 
       uti.MakeScalar();                // Stomp out the array length
       uti.PrintMangled(scalarName);    // Convert back to mangled name
-      mangledName = scalarName.GetZString(); // Update pointer
-    }
-
-    for (u32 i = 0; i < m_registeredUlamClassCount; ++i)
-    {
-      UlamClass<EC> * uc = m_registeredUlamClasses[i];
-      if (!uc) continue; //contiguous after all classes register
-
-      const char * mang = uc->GetMangledClassName();
-      if (!strcmp(mang, mangledName))
-        return (s32) i;
+      return FindInNameIndex(scalarName.GetZString());
     }
     return -1;
   }
@@ -56,9 +82,14 @@ namespace MFM {
       }
 
     m_registeredUlamClasses[myregnum] = &uc;
+    AddToNameIndex(uc, myregnum);
+    uc.CacheMemberFormats();    // So printing needn't parse
     if(myregnum >= m_registeredUlamClassCount)
       m_registeredUlamClassCount = myregnum + 1; //max + 1
 
+    m_vcallCache.Clear(); //resolutions may differ now
+    ClearElementTypes();
+
     return true;
   }
 
@@ -70,11 +101,62 @@ namespace MFM {
     if (!m_ulamElementEmpty)
     {
       m_ulamElementEmpty = &ue;
+      m_vcallCache.Clear();
+      ClearElementTypes();
       return 1;
     }
     return -1;
   }
 
+  template <class EC>
+  bool UlamClassRegistry<EC>::ReplaceUlamClasses(UlamClass<EC> ** ucs, u32 count)
+  {
+    MFM_API_ASSERT_NONNULL(ucs);
+
+    UlamClass<EC> * table[TABLE_SIZE];
+    for (u32 i = 0; i < TABLE_SIZE; ++i)
+      table[i] = m_registeredUlamClasses[i];
+
+    // Out with the old versions..
+    for (u32 i = 0; i < count; ++i)
+    {
+      MFM_API_ASSERT_NONNULL(ucs[i]);
+      s32 old = FindInNameIndex(ucs[i]->GetMangledClassName());
+      if (old >= 0)
+        table[old] = 0;
+    }
+
+    // ..and in with the new, if they fit
+    for (u32 i = 0; i < count; ++i)
+    {
+      u32 regnum = ucs[i]->GetRegistrationNumber();
+      if (regnum >= TABLE_SIZE || table[regnum] != 0)
+        return false;
+      table[regnum] = ucs[i];
+    }
+
+    m_registeredUlamClassCount = 0;
+    for (u32 i = 0; i < NAME_INDEX_SIZE; i++) m_nameIndex[i] = NAME_INDEX_UNUSED;
+    for (u32 i = 0; i < TABLE_SIZE; ++i)
+    {
+      m_registeredUlamClasses[i] = table[i];
+      if (!table[i]) continue;
+      AddToNameIndex(*table[i], i);
+      m_registeredUlamClassCount = i + 1;
+    }
+
+    for (u32 i = 0; i < count; ++i)
+    {
+      ucs[i]->CacheMemberFormats();
+      if (!strcmp(ucs[i]->GetMangledClassName(), "Ue_10105Empty10"))
+        m_ulamElementEmpty = ucs[i];
+    }
+
+    m_vcallCache.Clear();
+    ClearElementTypes();
+    return true;
+  }
+
   template <class EC>
   bool UlamClassRegistry<EC>::IsRegisteredUlamClass(const char *mangledName) const
   {
@@ -34,11 +34,11 @@
 #include "Fail.h"
 #include "Element.h"
 #include "EventWindowRenderer.h"
+#include "UlamTransientArena.h"
 
 namespace MFM
 {
-  template <class AC> class Base; // FORWARD
-  template <class AC> class Site; // FORWARD
+  template <class AC, u32 FEATURES> class Base; // FORWARD
   template <class EC> class EventWindow; // FORWARD
   template <class EC> class UlamClass; //FORWARD
   template <class EC> class UlamClassRegistry; //FORWARD
@@ -78,6 +78,11 @@ namespace MFM
     virtual bool HasEventWindowRenderer() const { return false; }
     virtual const EventWindowRenderer<EC> & GetEventWindowRenderer() const { FAIL(UNSUPPORTED_OPERATION); }
 
+    /** Per-event scratch storage, for generated code's transients;
+        const because generated code sees only a const UlamContext */
+    virtual bool HasTransientArena() const { return false; }
+    virtual UlamTransientArena & GetTransientArena() const { FAIL(UNSUPPORTED_OPERATION); }
+
     virtual const Element<EC> * LookupElementTypeFromContext(u32 etype) const ;
 
     virtual const char * GetContextLabel() const { return "Generic UlamContext"; }
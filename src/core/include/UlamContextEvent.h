@@ -83,6 +83,13 @@ namespace MFM
       return m_tile->GetUlamClassRegistry();
     }
 
+    virtual bool HasTransientArena() const { return m_tile; }
+    virtual UlamTransientArena & GetTransientArena() const
+    {
+      if (!m_tile) FAIL(UNSUPPORTED_OPERATION);
+      return m_tile->GetTransientArena();
+    }
+
     virtual const char * GetContextLabel() const { 
       if (m_tile) return m_tile->GetLabel();
       return "UlamContextEvent without Tile"; 
@@ -34,6 +34,7 @@
 #include "BitStorage.h"
 #include "ByteSink.h"
 #include "UlamVTableEntry.h"
+#include "UlamVirtualCallCache.h"
 
 namespace MFM
 {
@@ -247,6 +248,33 @@ namespace MFM
     */
     void InitUlamRefForVirtualFuncCall(const UlamRef<EC> & ur, const UlamClass<EC> * vtclassptr, u32 vownedfuncidx, u32 origclassregnum, VfuncPtr & vfuncref);
 
+    /** helper, as InitUlamRefForVirtualFuncCall but first consulting
+	the registry's UlamVirtualCallCache; a NULL vtclassptr means
+	search the callstack (from this ref) for the vtable class.
+    */
+    void InitUlamRefForVirtualFuncCallCached(const UlamRef<EC> & ur, const UlamClass<EC> * vtclassptr, u32 vownedfuncidx, u32 origclassregnum, VfuncPtr & vfuncref);
+
+    /** helper, the uncached work of InitUlamRefForVirtualFuncCall:
+	checks the call is legal and finds what it resolves to.
+    */
+    void ResolveVirtualFuncCall(const UlamRef<EC> & ur, const UlamClass<EC> * vtclassptr, u32 vownedfuncidx, u32 origclassregnum, UlamVirtualCallCache::Resolution & res) const;
+
+    /** helper, what the vfunc's entry in vtclassptr's vtable resolves
+	to, relative to the effective self of ur; no legality checks.
+    */
+    void ResolveFromVTable(const UlamRef<EC> & ur, const UlamClass<EC> * vtclassptr, u32 vownedfuncidx, u32 origclassregnum, UlamVirtualCallCache::Resolution & res) const;
+
+    /** helper, the devirtualized fast path of
+	InitUlamRefForVirtualFuncCallCached: if the call is provably
+	unique -- a final function, or a final effective self with no
+	other vtable class in the callstack -- apply it and return
+	true; else return false.  \sa UlamClass::SetFinalClass
+    */
+    bool TryDirectFuncCall(const UlamRef<EC> & ur, const UlamClass<EC> * vtclassptr, u32 vownedfuncidx, u32 origclassregnum, VfuncPtr & vfuncref);
+
+    /** helper, sets vfuncref, pos, len, and usage from res */
+    void ApplyVirtualFuncCall(const UlamRef<EC> & ur, const UlamVirtualCallCache::Resolution & res, VfuncPtr & vfuncref);
+
     /** helper, uses existing pos, effselfpos and new effselfoffset to set our
 	new m_pos and m_posToEff; m_len is also set;
 	m_pos + m_len - m_posToEff must fit in m_stg.
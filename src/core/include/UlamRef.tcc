@@ -253,14 +253,7 @@ namespace MFM {
     }
 
     const u32 origclassid = origclass.GetRegistrationNumber();
-    s32 candidate = -1;
-    findMostSpecificNonDominatedVTClassIdInCallstack(existing, vownedfuncidx, origclassid, candidate);
-    MFM_API_ASSERT(candidate>=0, NOT_FOUND);
-
-    const UlamClassRegistry<EC> & ucr = existing.m_uc.GetUlamClassRegistry();
-    const UlamClass<EC> * vtableclassptr = ucr.GetUlamClassOrNullByIndex(candidate);
-
-    InitUlamRefForVirtualFuncCall(existing, vtableclassptr, vownedfuncidx, origclassid, vfuncref);
+    InitUlamRefForVirtualFuncCallCached(existing, NULL, vownedfuncidx, origclassid, vfuncref);
   }
 
   template <class EC>
@@ -281,14 +274,8 @@ namespace MFM {
       m_vtableclassid = m_effSelf->GetRegistrationNumber();
     }
 
-    s32 candidate = -1;
-    findMostSpecificNonDominatedVTClassIdInCallstack(existing, vownedfuncidx, origclassregnum, candidate);
-    MFM_API_ASSERT(candidate>=0, NOT_FOUND);
-
-    const UlamClassRegistry<EC> & ucr = existing.m_uc.GetUlamClassRegistry();
-    const UlamClass<EC> * vtableclassptr = ucr.GetUlamClassOrNullByIndex(candidate);
     //applydelta is de-ambiguity arg
-    InitUlamRefForVirtualFuncCall(existing, vtableclassptr, vownedfuncidx, origclassregnum, vfuncref);
+    InitUlamRefForVirtualFuncCallCached(existing, NULL, vownedfuncidx, origclassregnum, vfuncref);
   }
 
   template <class EC>
@@ -307,7 +294,8 @@ namespace MFM {
       m_prevur = NULL;
     }
 
-    InitUlamRefForVirtualFuncCall(existing, vtclassptr, vownedfuncidx, origclassregnum, vfuncref);
+    MFM_API_ASSERT_NONNULL(vtclassptr);
+    InitUlamRefForVirtualFuncCallCached(existing, vtclassptr, vownedfuncidx, origclassregnum, vfuncref);
     m_vtableclassid = vtclassptr->GetRegistrationNumber(); //save!! newly specified vtable classid
   }
 
@@ -328,6 +316,64 @@ namespace MFM {
 
   template <class EC>
   void UlamRef<EC>::InitUlamRefForVirtualFuncCall(const UlamRef<EC> & ur, const UlamClass<EC> * vtclassptr, u32 vownedfuncidx, u32 origclassregnum, VfuncPtr & vfuncref)
+  {
+    UlamVirtualCallCache::Resolution res;
+    ResolveVirtualFuncCall(ur, vtclassptr, vownedfuncidx, origclassregnum, res);
+    ApplyVirtualFuncCall(ur, res, vfuncref);
+  } //InitUlamRefForVirtualFuncCall
+
+  template <class EC>
+  void UlamRef<EC>::InitUlamRefForVirtualFuncCallCached(const UlamRef<EC> & ur, const UlamClass<EC> * vtclassptr, u32 vownedfuncidx, u32 origclassregnum, VfuncPtr & vfuncref)
+  {
+    if(TryDirectFuncCall(ur, vtclassptr, vownedfuncidx, origclassregnum, vfuncref))
+      return;
+
+    const UlamClass<EC> * effSelf = ur.GetEffectiveSelf();
+    MFM_API_ASSERT_NONNULL(effSelf);
+
+    //the resolution depends only on these, given the registry
+    UlamVirtualCallCache::Key key;
+    key.m_effself = (u16) effSelf->GetRegistrationNumber();
+    key.m_origclass = (u16) origclassregnum;
+    key.m_funcidx = (u16) vownedfuncidx;
+    bool cacheable = true;
+    if(vtclassptr != NULL)
+      {
+	key.m_explicit = true;
+	key.AddChain(vtclassptr->GetRegistrationNumber());
+      }
+    else
+      {
+	for(const UlamRef<EC> * frame = this; frame != NULL && cacheable; frame = frame->m_prevur)
+	  cacheable = key.AddChain(frame->m_vtableclassid);
+      }
+
+    const UlamClassRegistry<EC> & ucr = ur.m_uc.GetUlamClassRegistry();
+    UlamVirtualCallCache & vcc = ucr.GetVirtualCallCache();
+    const UlamVirtualCallCache::Resolution * hit = cacheable ? vcc.Find(key) : NULL;
+    if(hit)
+      {
+	ApplyVirtualFuncCall(ur, *hit, vfuncref);
+	return;
+      }
+
+    if(vtclassptr == NULL)
+      {
+	s32 candidate = -1;
+	findMostSpecificNonDominatedVTClassIdInCallstack(ur, vownedfuncidx, origclassregnum, candidate);
+	MFM_API_ASSERT(candidate>=0, NOT_FOUND);
+	vtclassptr = ucr.GetUlamClassOrNullByIndex(candidate);
+      }
+
+    UlamVirtualCallCache::Resolution res;
+    ResolveVirtualFuncCall(ur, vtclassptr, vownedfuncidx, origclassregnum, res); //FAILs are not cached
+    ApplyVirtualFuncCall(ur, res, vfuncref);
+    if(cacheable)
+      vcc.Insert(key, res);
+  } //InitUlamRefForVirtualFuncCallCached
+
+  template <class EC>
+  void UlamRef<EC>::ResolveVirtualFuncCall(const UlamRef<EC> & ur, const UlamClass<EC> * vtclassptr, u32 vownedfuncidx, u32 origclassregnum, UlamVirtualCallCache::Resolution & res) const
   {
     MFM_API_ASSERT_NONNULL(vtclassptr); //could be same as effSelf
 
@@ -342,21 +388,76 @@ namespace MFM {
     if(!effSelf->internalCMethodImplementingIs(vtclassptr))
       FAIL(BAD_VIRTUAL_CALL);
 
+    ResolveFromVTable(ur, vtclassptr, vownedfuncidx, origclassregnum, res);
+  } //ResolveVirtualFuncCall
+
+  template <class EC>
+  void UlamRef<EC>::ResolveFromVTable(const UlamRef<EC> & ur, const UlamClass<EC> * vtclassptr, u32 vownedfuncidx, u32 origclassregnum, UlamVirtualCallCache::Resolution & res) const
+  {
+    const UlamClass<EC> * effSelf = ur.GetEffectiveSelf();
+
     //3 VTable accesses for: originating class' start, vfunc entry, and its override class
     const u32 origclassvtstart = vtclassptr->GetVTStartOffsetForClassByRegNum(origclassregnum);
-    vfuncref = vtclassptr->getVTableEntry(vownedfuncidx + origclassvtstart); //return ref to virtual function ptr
+    res.m_vfunc = vtclassptr->getVTableEntry(vownedfuncidx + origclassvtstart); //return ref to virtual function ptr
     const UlamClass<EC> * ovclassptr = vtclassptr->getVTableEntryUlamClassPtr(vownedfuncidx + origclassvtstart);
     MFM_API_ASSERT_NONNULL(ovclassptr);
 
     //relative to effSelf
-    const s32 ovclassrelpos = effSelf->internalCMethodImplementingGetRelativePositionOfBaseClass(ovclassptr);
+    const s32 ovclassrelpos = (ovclassptr == effSelf) ? 0 : effSelf->internalCMethodImplementingGetRelativePositionOfBaseClass(ovclassptr);
     MFM_API_ASSERT(ovclassrelpos >= 0, PURE_VIRTUAL_CALLED);
+    res.m_ovclassrelpos = (u32) ovclassrelpos;
 
-    const u32 ovclasslen = (ovclassptr == effSelf) ? ovclassptr->GetClassLength() : ovclassptr->GetClassDataMembersSize(); //use baseclass size when incomplete obj, not element.
-    ApplyDelta(ur.GetEffectiveSelfPos(), ovclassrelpos, ovclasslen);
+    res.m_ovclasslen = (ovclassptr == effSelf) ? ovclassptr->GetClassLength() : ovclassptr->GetClassDataMembersSize(); //use baseclass size when incomplete obj, not element.
+    res.m_elemental = ovclassptr->AsUlamElement() != NULL;
+  } //ResolveFromVTable
 
-    m_usage = ovclassptr->AsUlamElement() ? ELEMENTAL : CLASSIC;
-  } //InitUlamRefForVirtualFuncCall
+  template <class EC>
+  bool UlamRef<EC>::TryDirectFuncCall(const UlamRef<EC> & ur, const UlamClass<EC> * vtclassptr, u32 vownedfuncidx, u32 origclassregnum, VfuncPtr & vfuncref)
+  {
+    const UlamClass<EC> * effSelf = ur.GetEffectiveSelf();
+    MFM_API_ASSERT_NONNULL(effSelf);
+
+    const UlamClass<EC> * origclass =
+      (effSelf->GetRegistrationNumber() == origclassregnum) ? effSelf :
+      ur.m_uc.GetUlamClassRegistry().GetUlamClassOrNullByIndex(origclassregnum);
+
+    const UlamClass<EC> * resolver = NULL; //whose vtable settles it
+    if(origclass != NULL && origclass->IsFinalFunction(vownedfuncidx))
+      {
+	//overridden nowhere: any vtable related to origclass says the same
+	if(origclass != effSelf && !effSelf->internalCMethodImplementingIs(origclass))
+	  FAIL(BAD_VIRTUAL_CALL);
+	resolver = origclass;
+      }
+    else if(effSelf->IsFinalClass() && (vtclassptr == NULL || vtclassptr == effSelf))
+      {
+	//nothing is more specific than effSelf, so its vtable settles
+	//it, unless the callstack names some other vtable class
+	if(vtclassptr == NULL)
+	  {
+	    const u32 effselfid = effSelf->GetRegistrationNumber();
+	    for(const UlamRef<EC> * frame = this; frame != NULL; frame = frame->m_prevur)
+	      if(frame->m_vtableclassid != effselfid)
+		return false;
+	  }
+	resolver = effSelf;
+      }
+    else
+      return false;
+
+    UlamVirtualCallCache::Resolution res;
+    ResolveFromVTable(ur, resolver, vownedfuncidx, origclassregnum, res);
+    ApplyVirtualFuncCall(ur, res, vfuncref);
+    return true;
+  } //TryDirectFuncCall
+
+  template <class EC>
+  void UlamRef<EC>::ApplyVirtualFuncCall(const UlamRef<EC> & ur, const UlamVirtualCallCache::Resolution & res, VfuncPtr & vfuncref)
+  {
+    vfuncref = res.m_vfunc;
+    ApplyDelta(ur.GetEffectiveSelfPos(), (s32) res.m_ovclassrelpos, res.m_ovclasslen);
+    m_usage = res.m_elemental ? ELEMENTAL : CLASSIC;
+  } //ApplyVirtualFuncCall
 
   template <class EC>
   void UlamRef<EC>::ApplyDelta(s32 existingeffselfpos, s32 effselfoffset, u32 len)
@@ -448,8 +549,18 @@ namespace MFM {
     T a = ReadAtom();
     MFM_API_ASSERT(a.IsSane(),INCONSISTENT_ATOM);
     u32 etype = a.GetType();
-    const UlamClass<EC> * eltptr = m_uc.LookupUlamElementTypeFromContext(etype);
+    if (!m_uc.HasUlamClassRegistry())
+    {
+      const UlamClass<EC> * eltptr = m_uc.LookupUlamElementTypeFromContext(etype);
+      MFM_API_ASSERT_STATE(eltptr);
+      return eltptr;
+    }
+    const UlamClassRegistry<EC> & ucr = m_uc.GetUlamClassRegistry();
+    const UlamClass<EC> * eltptr = ucr.GetUlamElementOrNullByType(etype);
+    if (eltptr) return eltptr;
+    eltptr = m_uc.LookupUlamElementTypeFromContext(etype);
     MFM_API_ASSERT_STATE(eltptr);
+    ucr.NoteUlamElementType(etype, *eltptr);
     return eltptr;
   }
 
@@ -472,7 +583,7 @@ namespace MFM {
     if(!eltptr) FAIL(ILLEGAL_ARGUMENT);
     u32 len = eltptr->GetClassLength();
     AtomBitStorage<EC> atmp(eltptr->GetDefaultAtom());
-    atmp.WriteBig(0u + T::ATOM_FIRST_STATE_BIT, len, m_stg.ReadBig(GetEffectiveSelfPos(), len));
+    BitStorage<EC>::CopyBits(m_stg, GetEffectiveSelfPos(), atmp, 0u + T::ATOM_FIRST_STATE_BIT, len);
     return atmp.ReadAtom();
   }
 
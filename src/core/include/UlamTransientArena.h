@@ -0,0 +1,140 @@
+/*                                              -*- mode:C++ -*-
+  UlamTransientArena.h Per-event bump allocation for ulam transients
+  Copyright (C) 2020 The Living Computation Foundation.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+  USA
+*/
+
+/**
+  \file UlamTransientArena.h Per-event bump allocation for ulam transients
+  \author David H. Ackley.
+  \date (C) 2020 All rights reserved.
+  \lgpl
+ */
+
+#ifndef ULAMTRANSIENTARENA_H
+#define ULAMTRANSIENTARENA_H
+
+#include <new>      /* For placement new */
+#include "itype.h"
+#include "Fail.h"
+
+namespace MFM {
+
+  /**
+     A fixed block of scratch memory for the transients and temporary
+     BitStorages of one event.  Each Tile owns one, reachable through
+     UlamContext::GetTransientArena(), and EventWindow empties it when
+     each event's behavior returns or fails.  Allocation just bumps an
+     offset; GetMark() and ReleaseTo() give back everything allocated
+     since a mark, for scopes inside an event.
+
+     Nothing allocated here is ever destroyed, so only allocate
+     things whose destructors need not run -- bit vectors, and
+     BitStorages over them.
+   */
+  class UlamTransientArena {
+  public:
+    enum {
+      ARENA_BYTES = 16 * 1024,
+      ALIGN_BYTES = sizeof(u64)
+    };
+
+    UlamTransientArena()
+      : m_used(0)
+      , m_highWater(0)
+    { }
+
+    /**
+       @returns bytes of uninitialized storage, aligned for any member
+       type ulam uses
+
+       @fails OUT_OF_ROOM if fewer than bytes remain
+     */
+    void * Allocate(u32 bytes)
+    {
+      const u32 rounded = (bytes + ALIGN_BYTES - 1) & ~(ALIGN_BYTES - 1);
+      if (rounded < bytes || rounded > ARENA_BYTES - m_used)
+        FAIL(OUT_OF_ROOM);
+      void * ret = ((u8 *) m_storage) + m_used;
+      m_used += rounded;
+      if (m_used > m_highWater) m_highWater = m_used;
+      return ret;
+    }
+
+    /**
+       Allocate and default-construct an S, e.g. a
+       BitVectorBitStorage<EC,BitVector<N> > for a large transient.
+       S's destructor will never be run.
+     */
+    template <class S>
+    S & New()
+    {
+      return * new (Allocate(sizeof(S))) S();
+    }
+
+    /** As New(), but copy-constructed from init */
+    template <class S>
+    S & New(const S & init)
+    {
+      return * new (Allocate(sizeof(S))) S(init);
+    }
+
+    bool HasRoom(u32 bytes) const
+    {
+      return bytes <= ARENA_BYTES - m_used;
+    }
+
+    u32 GetMark() const
+    {
+      return m_used;
+    }
+
+    /** Free everything allocated since GetMark() returned mark */
+    void ReleaseTo(u32 mark)
+    {
+      MFM_API_ASSERT_ARG(mark <= m_used);
+      m_used = mark;
+    }
+
+    void Reset()
+    {
+      m_used = 0;
+    }
+
+    u32 GetUsedBytes() const
+    {
+      return m_used;
+    }
+
+    /** Most bytes ever in use at once, for sizing ARENA_BYTES */
+    u32 GetHighWaterBytes() const
+    {
+      return m_highWater;
+    }
+
+  private:
+    u64 m_storage[ARENA_BYTES / sizeof(u64)];
+    u32 m_used;
+    u32 m_highWater;
+
+    UlamTransientArena(const UlamTransientArena &); // Declare away
+    UlamTransientArena & operator=(const UlamTransientArena &); // Declare away
+  };
+
+} //MFM
+
+#endif /* ULAMTRANSIENTARENA_H */
@@ -0,0 +1,161 @@
+/*                                              -*- mode:C++ -*-
+  UlamVirtualCallCache.h Memoized ULAM virtual function resolutions
+  Copyright (C) 2020 The Living Computation Foundation.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+  USA
+*/
+
+/**
+  \file UlamVirtualCallCache.h Memoized ULAM virtual function resolutions
+  \author David H. Ackley.
+  \date (C) 2020 All rights reserved.
+  \lgpl
+ */
+
+#ifndef ULAMVIRTUALCALLCACHE_H
+#define ULAMVIRTUALCALLCACHE_H
+
+#include "itype.h"
+#include "UlamVTableEntry.h"
+
+namespace MFM {
+
+  /**
+     A direct-mapped cache of how virtual function calls resolve.
+     How an UlamRef virtual call resolves -- which function, and
+     where and how long its override class is relative to the
+     effective self -- depends only on the effective self class, the
+     originating class, the function index, and the vtable class ids
+     up the UlamRef callstack (or the explicitly specified vtable
+     class), so those make the key.  Only depends, that is, as long
+     as the UlamClassRegistry is unchanged: it clears its cache
+     whenever a class registers.
+   */
+  struct UlamVirtualCallCache {
+    enum {
+      MAX_CHAIN = 4,            // Deeper callstacks go uncached
+      SLOT_BITS = 8,
+      SLOT_COUNT = 1<<SLOT_BITS,
+      SLOT_MASK = SLOT_COUNT-1
+    };
+
+    struct Key {
+      Key()
+        : m_effself(0)
+        , m_origclass(0)
+        , m_funcidx(0)
+        , m_explicit(false)
+        , m_chainlen(0)
+      {
+        for (u32 i = 0; i < MAX_CHAIN; ++i) m_chain[i] = 0;
+      }
+
+      bool operator==(const Key & other) const
+      {
+        if (m_effself != other.m_effself ||
+            m_origclass != other.m_origclass ||
+            m_funcidx != other.m_funcidx ||
+            m_explicit != other.m_explicit ||
+            m_chainlen != other.m_chainlen) return false;
+        for (u32 i = 0; i < m_chainlen; ++i)
+          if (m_chain[i] != other.m_chain[i]) return false;
+        return true;
+      }
+
+      u32 GetSlot() const
+      {
+        u32 h = (m_effself * 31u + m_origclass) * 31u + m_funcidx;
+        h = h * 2u + (m_explicit ? 1u : 0u);
+        for (u32 i = 0; i < m_chainlen; ++i)
+          h = h * 31u + m_chain[i];
+        return (h * 2654435761u) >> (32 - SLOT_BITS);
+      }
+
+      /** Add the next vtable class id up the callstack, or the
+          explicit vtable class.  \returns false if the chain is
+          now too long to cache */
+      bool AddChain(u32 vtclassid)
+      {
+        if (m_chainlen >= MAX_CHAIN) return false;
+        m_chain[m_chainlen++] = (u16) vtclassid;
+        return true;
+      }
+
+      u16 m_effself;
+      u16 m_origclass;
+      u16 m_funcidx;
+      bool m_explicit;          // m_chain[0] is a specified vtable class
+      u8 m_chainlen;
+      u16 m_chain[MAX_CHAIN];
+    };
+
+    struct Resolution {
+      VfuncPtr m_vfunc;
+      u32 m_ovclassrelpos;      // Relative to the effective self
+      u32 m_ovclasslen;
+      bool m_elemental;         // Override class is an element
+    };
+
+    UlamVirtualCallCache()
+      : m_hits(0)
+      , m_misses(0)
+    {
+      Clear();
+    }
+
+    void Clear()
+    {
+      for (u32 i = 0; i < SLOT_COUNT; ++i) m_slots[i].m_used = false;
+    }
+
+    /** \returns the cached resolution for key, or NULL */
+    const Resolution * Find(const Key & key)
+    {
+      const Slot & s = m_slots[key.GetSlot()];
+      if (s.m_used && s.m_key == key) {
+        ++m_hits;
+        return &s.m_res;
+      }
+      ++m_misses;
+      return 0;
+    }
+
+    void Insert(const Key & key, const Resolution & res)
+    {
+      Slot & s = m_slots[key.GetSlot()];
+      s.m_used = true;
+      s.m_key = key;
+      s.m_res = res;
+    }
+
+    u32 GetHits() const { return m_hits; }
+    u32 GetMisses() const { return m_misses; }
+
+  private:
+    struct Slot {
+      bool m_used;
+      Key m_key;
+      Resolution m_res;
+    };
+
+    Slot m_slots[SLOT_COUNT];
+    u32 m_hits;
+    u32 m_misses;
+  };
+
+} //MFM
+
+#endif /* ULAMVIRTUALCALLCACHE_H */
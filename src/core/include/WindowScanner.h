@@ -289,6 +289,37 @@ namespace MFM
      */
     u32 CountVonNeumannNeighbors(const u32 type) const;
 
+    /**
+     * Sums the locations of all Atoms of a specified type within a
+     * given radius of the center, not counting the center itself,
+     * in the coordinates of the current symmetry.  Dividing the sum
+     * by the count gives their centroid.  This costs one step per
+     * matching Atom rather than one per window site.
+     *
+     * @param type The type of Atom to sum the locations of.
+     *
+     * @param radius The maximum distance from the center to look.
+     *
+     * @param outSum Output parameter, set to the sum of the matching
+     *               locations, or (0,0) if there are none.
+     *
+     * @returns The number of matching Atoms.
+     */
+    u32 SumLocationsOfType(const u32 type, const u32 radius, SPoint& outSum) const;
+
+    /**
+     * Finds the distance from the center to the nearest Atom of a
+     * specified type, not counting the center itself.
+     *
+     * @param type The type of Atom to look for.
+     *
+     * @param radius The maximum distance from the center to look.
+     *
+     * @returns The Manhattan distance to the nearest matching Atom, or
+     *          \c 0 if there is none within \c radius .
+     */
+    u32 GetNearestDistanceOfType(const u32 type, const u32 radius) const;
+
     /**
      * Scans the held EventWindow (discluding the center atom) for all
      * atoms of a specified type, filling a point with the location of
@@ -549,6 +580,27 @@ namespace MFM
 
     void FindRandomAtoms(const u32 radius, const u32 count, va_list& list) const;
 
+    /**
+     * Gets the direct site numbers from distance 1 through \c radius
+     * as a bitmask, in the form of EventWindow::GetTypeSitesDirect .
+     * FAILs with ILLEGAL_ARGUMENT unless \c 0 < \c radius <= R .
+     */
+    static u64 SitesWithin(const u32 radius);
+
+    /**
+     * Gets the direct site numbers of the sites adjacent to the
+     * center in the given directions, as a bitmask.
+     */
+    static u64 SitesInNeighborhood(const Dir* neighborhood, const u32 dirCount);
+
+    /**
+     * Picks one set bit of \c sites uniformly at random.  \c sites
+     * must not be 0.
+     *
+     * @returns The MDist point of the chosen site number.
+     */
+    SPoint PickSite(u64 sites) const;
+
   };
 
   const Dir MooreNeighborhood[8] =
@@ -54,42 +54,13 @@ namespace MFM
   template <class EC>
   bool WindowScanner<EC>::CanSeeAtomOfType(const u32 type, const u32 radius) const
   {
-    const MDist<R>& md = MDist<R>::get();
-
-    MFM_API_ASSERT_ARG(radius != 0 && radius <= R);
-
-    for(u32 i = md.GetFirstIndex(1); i <= md.GetLastIndex(radius); i++)
-    {
-      if(m_win.IsLiveSiteDirect(md.GetPoint(i)))
-      {
-        if(m_win.GetRelativeAtomDirect(md.GetPoint(i)).GetType() == type)
-        {
-          return true;
-        }
-      }
-    }
-    return false;
+    return (m_win.GetTypeSitesDirect(type) & SitesWithin(radius)) != 0;
   }
 
   template <class EC>
   u32 WindowScanner<EC>::CountAtomsOfType(const u32 type, const u32 radius) const
   {
-    const MDist<R>& md = MDist<R>::get();
-    u32 atomCount = 0;
-
-    MFM_API_ASSERT_ARG(radius != 0 && radius <= R);
-
-    for(u32 i = md.GetFirstIndex(1); i <= md.GetLastIndex(radius); i++)
-    {
-      if(m_win.IsLiveSiteDirect(md.GetPoint(i)))
-      {
-        if(m_win.GetRelativeAtomDirect(md.GetPoint(i)).GetType() == type)
-        {
-          atomCount++;
-        }
-      }
-    }
-    return atomCount;
+    return PopCount64(m_win.GetTypeSitesDirect(type) & SitesWithin(radius));
   }
 
   template <class EC>
@@ -103,21 +74,8 @@ namespace MFM
                                                   const Dir* neighborhood,
                                                   const u32 dirCount) const
   {
-    SPoint searchPt;
-    for(u32 i = 0; i < dirCount; i++)
-    {
-      Dirs::FillDir(searchPt, neighborhood[i], false);
-      searchPt /= 2; // Need undoubled coords for scanning
-
-      if(m_win.IsLiveSiteDirect(searchPt))
-      {
-        if(m_win.GetRelativeAtomDirect(searchPt).GetType() == type)
-        {
-          return true;
-        }
-      }
-    }
-    return false;
+    return (m_win.GetTypeSitesDirect(type) &
+            SitesInNeighborhood(neighborhood, dirCount)) != 0;
   }
 
   template <class EC>
@@ -141,22 +99,8 @@ namespace MFM
                                            const Dir* neighborhood,
                                            const u32 dirCount) const
   {
-    SPoint searchPt;
-    u32 atomCount = 0;
-    for(u32 i = 0; i < dirCount; i++)
-    {
-      Dirs::FillDir(searchPt, neighborhood[i], false);
-      searchPt /= 2; // Need undoubled coords for scanning
-
-      if(m_win.IsLiveSiteDirect(searchPt))
-      {
-        if(m_win.GetRelativeAtomDirect(searchPt).GetType() == type)
-        {
-          atomCount++;
-        }
-      }
-    }
-    return atomCount;
+    return PopCount64(m_win.GetTypeSitesDirect(type) &
+                      SitesInNeighborhood(neighborhood, dirCount));
   }
 
   template <class EC>
@@ -175,6 +119,36 @@ namespace MFM
                                VON_NEUMANN_NEIGHBORHOOD_SIZE);
   }
 
+  template <class EC>
+  u32 WindowScanner<EC>::SumLocationsOfType(const u32 type,
+                                            const u32 radius,
+                                            SPoint& outSum) const
+  {
+    const MDist<R>& md = MDist<R>::get();
+    u64 sites = m_win.GetTypeSitesDirect(type) & SitesWithin(radius);
+    const u32 count = PopCount64(sites);
+    SPoint sum(0, 0);
+    for (; sites != 0; sites &= sites - 1)
+    {
+      sum += md.GetPoint(__builtin_ctzll(sites));
+    }
+    /* Symmetries are linear, so the sum maps like any one point */
+    outSum.Set(SymMap(sum, SymInverse(m_win.GetSymmetry()), sum));
+    return count;
+  }
+
+  template <class EC>
+  u32 WindowScanner<EC>::GetNearestDistanceOfType(const u32 type, const u32 radius) const
+  {
+    /* Site numbers run outward by distance, so the lowest is nearest */
+    const u64 sites = m_win.GetTypeSitesDirect(type) & SitesWithin(radius);
+    if (sites == 0)
+    {
+      return 0;
+    }
+    return MDist<R>::get().GetPoint(__builtin_ctzll(sites)).GetManhattanLength();
+  }
+
   template <class EC>
   u32 WindowScanner<EC>::FindRandomLocationOfType(const u32 type, SPoint& outPoint) const
   {
@@ -186,26 +160,12 @@ namespace MFM
                                                   const u32 radius,
                                                   SPoint& outPoint) const
   {
-    const MDist<R>& md = MDist<R>::get();
-    u32 foundPts = 0;
-
-    MFM_API_ASSERT_ARG(radius != 0 && radius <= R);
-
-    for(u32 i = md.GetFirstIndex(1); i <= md.GetLastIndex(radius); i++)
+    const u64 sites = m_win.GetTypeSitesDirect(type) & SitesWithin(radius);
+    if (sites != 0)
     {
-      if(m_win.IsLiveSiteDirect(md.GetPoint(i)))
-      {
-        if(m_win.GetRelativeAtomDirect(md.GetPoint(i)).GetType() == type)
-        {
-          foundPts++;
-          if(m_rand.OneIn(foundPts))
-          {
-            outPoint.Set(md.GetPoint(i));
-          }
-        }
-      }
+      outPoint = PickSite(sites);
     }
-  return foundPts;
+    return PopCount64(sites);
   }
 
   template <class EC>
@@ -365,38 +325,57 @@ namespace MFM
     /* Can't ask for more than SITES things, right? */
     MFM_API_ASSERT_ARG(count <= SITES);
 
-    const MDist<R>& md = MDist<R>::get();
-    Random& rand = m_win.GetRandom();
-    SPoint* outPts[SITES];
-    u32 types[SITES];
-    u32* outCounts[SITES];
-
+    const u64 within = SitesWithin(radius);
     for(u32 i = 0; i < count; i++)
     {
-      outPts[i] = (SPoint*)va_arg(list, SPoint*);
-      types[i] = (u32)va_arg(list, u32);
-      outCounts[i] = (u32*)va_arg(list, u32*);
+      SPoint* outPt = (SPoint*)va_arg(list, SPoint*);
+      u32 type = (u32)va_arg(list, u32);
+      u32* outCount = (u32*)va_arg(list, u32*);
+
+      /* Symmetries preserve distance, so only the pick needs mapping */
+      const u64 sites = m_win.GetTypeSitesDirect(type) & within;
+      *outCount = PopCount64(sites);
+      if (sites != 0)
+      {
+        SPoint pt = PickSite(sites);
+        outPt->Set(SymMap(pt, SymInverse(m_win.GetSymmetry()), pt));
+      }
+    }
+  }
 
-      *outCounts[i] = 0;
+  template <class EC>
+  u64 WindowScanner<EC>::SitesWithin(const u32 radius)
+  {
+    MFM_API_ASSERT_ARG(radius != 0 && radius <= R);
+
+    const MDist<R>& md = MDist<R>::get();
+    const u32 last = md.GetLastIndex(radius);
+    const u64 upToLast = (last >= 63) ? ~(u64) 0 : (((u64) 1) << (last + 1)) - 1;
+    return upToLast & ~(((u64) 1 << md.GetFirstIndex(1)) - 1);
+  }
+
+  template <class EC>
+  u64 WindowScanner<EC>::SitesInNeighborhood(const Dir* neighborhood, const u32 dirCount)
+  {
+    const MDist<R>& md = MDist<R>::get();
+    u64 sites = 0;
+    SPoint searchPt;
+    for(u32 i = 0; i < dirCount; i++)
+    {
+      Dirs::FillDir(searchPt, neighborhood[i], false);
+      searchPt /= 2; // Need undoubled coords for scanning
+      sites |= ((u64) 1) << md.FromPoint(searchPt, R);
     }
+    return sites;
+  }
 
-    for(u32 i = md.GetFirstIndex(1); i <= md.GetLastIndex(radius); i++)
+  template <class EC>
+  SPoint WindowScanner<EC>::PickSite(u64 sites) const
+  {
+    for (u32 skip = m_rand.Create(PopCount64(sites)); skip > 0; --skip)
     {
-      SPoint pt = md.GetPoint(i);
-      if(m_win.IsLiveSiteSym(pt))
-      {
-        for(u32 j = 0; j < count; j++)
-        {
-          if(m_win.GetRelativeAtomSym(pt).GetType() == types[j])
-          {
-            (*(outCounts[j]))++;
-            if(rand.OneIn(*(outCounts[j])))
-            {
-              outPts[j]->Set(pt.GetX(), pt.GetY());
-            }
-          }
-        }
-      }
+      sites &= sites - 1;  // Drop the lowest set bit
     }
+    return MDist<R>::get().GetPoint(__builtin_ctzll(sites));
   }
 }
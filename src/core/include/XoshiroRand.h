@@ -0,0 +1,97 @@
+/*                                              -*- mode:C++ -*-
+  XoshiroRand.h Batched four-lane xoshiro128** PRNG
+  Copyright (C) 2020 The Living Computation Foundation.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+  USA
+*/
+
+/**
+  \file XoshiroRand.h Batched four-lane xoshiro128** PRNG
+  \date (C) 2020 All rights reserved.
+  \lgpl
+ */
+#ifndef XOSHIRORAND_H
+#define XOSHIRORAND_H
+
+#include "itype.h"
+
+namespace MFM {
+
+  /**
+   * Four independent xoshiro128** generators (Blackman & Vigna)
+   * stepped in lockstep, refilling a block of outputs at a time.
+   * The state is stored word-major (all four lanes of s[0], then all
+   * four of s[1], ...) so the per-lane update loops are plain
+   * element-wise operations on u32[4], which the compiler can keep
+   * in one SIMD register per word.
+   *
+   * Each output costs a few shifts, xors, and multiplies, against
+   * the MT19937 tempering plus a 624-word reload every 624 outputs;
+   * and the whole state fits in 64 bytes rather than 2.5KB.
+   */
+  class XoshiroRand
+  {
+  public:
+    enum {
+      LANES = 4,
+      STEPS_PER_REFILL = 4,
+      BATCH_SIZE = LANES * STEPS_PER_REFILL
+    };
+
+    XoshiroRand()
+    {
+      Seed(1);
+    }
+
+    XoshiroRand(u32 seed)
+    {
+      Seed(seed);
+    }
+
+    /**
+     * Reset all lanes deterministically from \c seed.  Unlike
+     * RandMT::seedMT, sequential seeds are fine.
+     */
+    void Seed(u32 seed) ;
+
+    /**
+     * Get the next 32 pseudo-random bits.
+     */
+    inline u32 Next()
+    {
+      if (m_next >= BATCH_SIZE)
+      {
+        Refill();
+      }
+      return m_batch[m_next++];
+    }
+
+  private:
+    static inline u32 Rotl(const u32 x, const u32 k)
+    {
+      return (x << k) | (x >> (32 - k));
+    }
+
+    void Refill() ;
+
+    u32 m_state[4][LANES];
+    u32 m_batch[BATCH_SIZE];
+    u32 m_next;
+  };
+
+} /* namespace MFM */
+
+#endif /* XOSHIRORAND_H */
@@ -298,23 +298,25 @@ XXX UPDATE
         if (code==Format::LXX32)
           base = 16;
 
-        u32 digits = CountDigits(num, base);
-        if (fieldWidth > (s32) digits)
-          digits = fieldWidth;
-
-        PrintLexDigits(digits);
-        Print(num, (Format::Type) base, fieldWidth, padChar);
+        PrintLexInBase(num, base, fieldWidth, padChar);
         break;
       }
 
     case Format::BEU32:  // padding makes no sense for binary
-      WriteByte((num>>24)&0xff);
-      WriteByte((num>>16)&0xff);
-      /* FALL THROUGH */
+      {
+        const u8 bytes[4] = {
+          (u8) (num>>24), (u8) (num>>16), (u8) (num>>8), (u8) num
+        };
+        WriteBytes(bytes, 4);
+      }
+      break;
 
     case Format::BEU16:
-      WriteByte((num>>8)&0xff);
-      /* FALL THROUGH */
+      {
+        const u8 bytes[2] = { (u8) (num>>8), (u8) num };
+        WriteBytes(bytes, 2);
+      }
+      break;
 
     case Format::BYTE:
       WriteByte((num>>0)&0xff);
@@ -357,26 +359,18 @@ XXX UPDATE
       if (code==Format::LXX64)
         base = 16;
 
-      u32 digits = CountDigits(num, base);
-      if (fieldWidth > (s32) digits)
-        digits = fieldWidth;
-
-      PrintLexDigits(digits);
-      PrintInBase(num, (Format::Type) base, fieldWidth, padChar);
+      PrintLexInBase(num, base, fieldWidth, padChar);
       break;
     }
 
     case Format::BEU64:
     case Format::BEU32:
-      WriteByte((num>>(24+32))&0xff);
-      WriteByte((num>>(16+32))&0xff);
-      WriteByte((num>>( 8+32))&0xff);
-      WriteByte((num>>( 0+32))&0xff);
-
-      WriteByte((num>>(24+ 0))&0xff);
-      WriteByte((num>>(16+ 0))&0xff);
-      WriteByte((num>>( 8+ 0))&0xff);
-      WriteByte((num>>( 0+ 0))&0xff);
+      {
+        u8 bytes[8];
+        for (u32 i = 0; i < 8; ++i)
+          bytes[i] = (u8) (num>>(56 - 8*i));
+        WriteBytes(bytes, 8);
+      }
       break;
 
     default:
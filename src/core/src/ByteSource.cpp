@@ -13,14 +13,12 @@ namespace MFM {
     {
     case Format::BEU64:
       {
+        u8 bytes[8];
+        if (Read(bytes, 8) < 8)
+          return false;
         u64 num = 0;
         for (u32 i = 0; i < 8; ++i)
-        {
-          s32 ch = Read();
-          if (ch < 0)
-            return false;
-          num = (num << 8) | ch;
-        }
+          num = (num << 8) | bytes[i];
         result = num;
       }
       return true;
@@ -33,24 +31,28 @@ namespace MFM {
         u32 len;
         if (!ScanLexDigits(len)) return false;
 
+        // Take the digits as spans; after a bad digit, the rest of
+        // its span has been consumed too
         u64 num = 0;
-        for (u32 i = 0; i < len; ++i)
+        u8 digits[32];
+        while (len > 0)
         {
-          s32 ch = Read();
-          if (ch < 0)
+          const u32 want = len < sizeof(digits) ? len : sizeof(digits);
+          if (Read(digits, want) < want)
             return false;
-          u8 uch = (u8) tolower(ch);
-          u32 dig;
-          if (uch >= '0' && uch <= '9')
-            dig = uch-'0';
-          else if (uch >= 'a' && uch < 'a'+base-10)
-            dig = uch-'a'+10;
-          else
+          for (u32 i = 0; i < want; ++i)
           {
-            Unread();
-            return false;
+            u8 uch = (u8) tolower(digits[i]);
+            u32 dig;
+            if (uch >= '0' && uch <= '9')
+              dig = uch-'0';
+            else if (uch >= 'a' && uch < 'a'+base-10)
+              dig = uch-'a'+10;
+            else
+              return false;
+            num = (num * base) + dig;
           }
-          num = (num * base) + dig;
+          len -= want;
         }
         result = num;
       }
@@ -73,12 +75,13 @@ namespace MFM {
     case Format::BYTE:
     case Format::BEU16:
     case Format::BEU32: {        // Handle raw formats
+      u8 bytes[4];
+      const u32 len = 1 << -((s32) code);
+      if (Read(bytes, len) < len)  // Raw formats ignore fieldWidth
+        return false;
       s32 num = 0;
-      for (int i = 1 << -((s32) code); i > 0; --i) {
-        if ((ch = Read()) < 0)   // Raw formats ignore fieldWidth
-          return false;
-        num = (num << 8) | ch;
-      }
+      for (u32 i = 0; i < len; ++i)
+        num = (num << 8) | bytes[i];
       result = num;
       return true;
     }
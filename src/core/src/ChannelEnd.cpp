@@ -1,5 +1,6 @@
 #include "ChannelEnd.h"
 #include "PacketIO.h"
+#include <string.h>  /* For memcpy */
 
 namespace MFM
 {
@@ -29,6 +30,18 @@ namespace MFM
     // Step 2: If a packet is not yet finished, try to read enough to finish it
     while (m_packetBuffer.GetLength() < (u32) m_packetLength)
     {
+      const u32 needed = (u32) m_packetLength - m_packetBuffer.GetLength();
+      const u8 * span;
+      u32 len = m_channel->PeekRead(m_onSideA, span);
+      if (len > 0)
+      {
+        // Take as much of the packet as the channel has contiguous
+        if (len > needed) len = needed;
+        m_packetBuffer.WriteBytes(span, len);
+        m_channel->ConsumeRead(m_onSideA, len);
+        continue;
+      }
+
       s32 byte = ReadByte();
       if (byte < 0)
       {
@@ -41,4 +54,29 @@ namespace MFM
     m_packetLength = -1;
     return & m_packetBuffer;
   }
+
+  bool ChannelEnd::WritePacket(const u8 * data, u32 length)
+  {
+    AssertConnected();
+    MFM_API_ASSERT_ARG(length <= 0xff);
+
+    u8 * span;
+    if (m_channel->ReserveWrite(m_onSideA, span) > length)
+    {
+      span[0] = (u8) length;   // Packet length, then data
+      memcpy(span + 1, data, length);
+      m_channel->CommitWrite(m_onSideA, length + 1);
+      return true;
+    }
+
+    if (CanWrite() <= length)  // Total write will be length+1
+    {
+      return false;
+    }
+
+    u8 byte = (u8) length;
+    Write(&byte, 1);
+    Write(data, length);
+    return true;
+  }
 }
@@ -160,11 +160,24 @@ XXB(CubeHelixRev)
   u32 ColorMap::GetInterpolatedColor(float value, float min, float max, u32 outOfRange) const {
     if (min >= max || value < min || value > max) return outOfRange;
 
+    float range = max-min;
+    u32 idx = (u32) ((value-min)/range*(LUT_SIZE-1)+0.5);
+    return GetLUTColor(idx);
+  }
+
+  void ColorMap::BuildLUT() const {
+    for (u32 i = 0; i < LUT_SIZE; ++i)
+      m_lut[i] = ComputeInterpolatedColor((float) i / (LUT_SIZE-1));
+    __sync_synchronize();
+    m_lutBuilt = true;
+  }
+
+  u32 ColorMap::ComputeInterpolatedColor(float frac) const {
     const u32 * map = GetColorArray();
     u32 maxIdx = GetColorArrayLength()-1;
 
-    float range = max-min;
-    float frac = (value-min)/range*maxIdx; // portion of full index range
+    frac *= maxIdx; // portion of full index range
+    if (frac > maxIdx) frac = maxIdx;
 
     u32 idx1 = (u32) frac;
     if (idx1==maxIdx)
@@ -0,0 +1,112 @@
+#include "ElementProfile.h"
+#include "Fail.h"
+
+namespace MFM
+{
+  void ElementProfile::Reset()
+  {
+    for (u32 i = 0; i < SLOT_COUNT; ++i)
+    {
+      m_slotToEntry[i] = 0;
+    }
+    m_entryCount = 0;
+    m_unrecorded = 0;
+  }
+
+  ElementProfile::Entry * ElementProfile::Add(u32 type, u32 slot)
+  {
+    if (m_entryCount >= SLOT_COUNT)
+    {
+      return 0;
+    }
+    Entry & e = m_entries[m_entryCount++];
+    e.m_type = type;
+    e.m_calls = 0;
+    e.m_totalTicks = 0;
+    e.m_maxTicks = 0;
+    e.m_sitesWritten = 0;
+    m_slotToEntry[slot] = (u16) m_entryCount;
+    return &e;
+  }
+
+  void ElementProfile::Add(const ElementProfile & other)
+  {
+    for (u32 i = 0; i < other.m_entryCount; ++i)
+    {
+      const Entry & o = other.m_entries[i];
+      Entry * e = FindOrAdd(o.m_type);
+      if (!e)
+      {
+        m_unrecorded += o.m_calls;
+        continue;
+      }
+      e->m_calls += o.m_calls;
+      e->m_totalTicks += o.m_totalTicks;
+      if (o.m_maxTicks > e->m_maxTicks)
+      {
+        e->m_maxTicks = o.m_maxTicks;
+      }
+      e->m_sitesWritten += o.m_sitesWritten;
+    }
+    m_unrecorded += other.m_unrecorded;
+  }
+
+  const ElementProfile::Entry * ElementProfile::Find(u32 type) const
+  {
+    u32 idx = GetProbeStart(type);
+    for (u32 p = 0; p < SLOT_COUNT; ++p, idx = (idx+1)&SLOT_MASK)
+    {
+      const u32 ent = m_slotToEntry[idx];
+      if (ent == 0)
+      {
+        return 0;
+      }
+      if (m_entries[ent-1].m_type == type)
+      {
+        return &m_entries[ent-1];
+      }
+    }
+    return 0;
+  }
+
+  const ElementProfile::Entry & ElementProfile::GetEntry(u32 index) const
+  {
+    MFM_API_ASSERT_ARG(index < m_entryCount);
+    return m_entries[index];
+  }
+
+  u64 ElementProfile::GetTotalTicks() const
+  {
+    u64 total = 0;
+    for (u32 i = 0; i < m_entryCount; ++i)
+    {
+      total += m_entries[i].m_totalTicks;
+    }
+    return total;
+  }
+
+  u32 ElementProfile::GetTopByTicks(const Entry ** out, u32 max) const
+  {
+    MFM_API_ASSERT_NONNULL(out);
+    u32 count = 0;
+    for (u32 i = 0; i < m_entryCount; ++i)
+    {
+      const Entry * e = &m_entries[i];
+      /* Insertion sort into the top max */
+      u32 pos = count < max ? count++ : max;
+      while (pos > 0 && out[pos-1]->m_totalTicks < e->m_totalTicks)
+      {
+        if (pos < max)
+        {
+          out[pos] = out[pos-1];
+        }
+        --pos;
+      }
+      if (pos < max)
+      {
+        out[pos] = e;
+      }
+    }
+    return count;
+  }
+} /* namespace MFM */
@@ -0,0 +1,210 @@
+#include "EventAgeIndex.h"
+#include "Fail.h"
+#include "Util.h"  /* For MAX */
+
+namespace MFM
+{
+  EventAgeIndex::EventAgeIndex()
+    : m_sites(0)
+    , m_warpFactor(0)
+    , m_band(1)
+    , m_weightUnit(1)
+    , m_recent(0)
+    , m_now(0)
+    , m_newestBand(0)
+    , m_lastEvent(0)
+    , m_order(0)
+    , m_position(0)
+    , m_segmentStart(0)
+  { }
+
+  EventAgeIndex::~EventAgeIndex()
+  {
+    Free();
+  }
+
+  void EventAgeIndex::Free()
+  {
+    delete [] m_lastEvent;
+    delete [] m_order;
+    delete [] m_position;
+    delete [] m_segmentStart;
+    m_lastEvent = 0;
+    m_order = 0;
+    m_position = 0;
+    m_segmentStart = 0;
+    m_sites = 0;
+  }
+
+  void EventAgeIndex::Init(u32 sites, u32 warpFactor)
+  {
+    MFM_API_ASSERT_ARG(sites > 0);
+    MFM_API_ASSERT_ARG(warpFactor <= MAX_WARP);
+
+    Free();
+    m_sites = sites;
+    m_lastEvent = new u64[sites];
+    m_order = new u32[sites];
+    m_position = new u32[sites];
+    for (u32 i = 0; i < sites; ++i)
+    {
+      m_lastEvent[i] = 0;
+    }
+    Rebuild(warpFactor, 0);
+  }
+
+  void EventAgeIndex::Rebuild(u32 warpFactor, u64 now)
+  {
+    MFM_API_ASSERT_STATE(IsInitted());
+    MFM_API_ASSERT_ARG(warpFactor <= MAX_WARP);
+
+    m_warpFactor = warpFactor;
+    m_band = MAX(1u, m_sites / BANDS_PER_SWEEP);
+    m_weightUnit = MAX(1u, m_sites / WEIGHT_UNITS_PER_SITE);
+
+    /* Sites last hit more than this many bands ago are saturated */
+    const u64 saturatedAge = (u64) (MAX_WARP - warpFactor) * m_sites;
+    m_recent = (u32) ((saturatedAge + m_band - 1) / m_band) + 1;
+    m_now = now;
+    m_newestBand = now / m_band;
+
+    delete [] m_segmentStart;
+    m_segmentStart = new u32[m_recent + 2];
+    for (u32 j = 0; j < m_recent + 2; ++j)
+    {
+      m_segmentStart[j] = 0;
+    }
+
+    /* Counting sort by segment, using the starts as counters */
+    for (u32 pass = 0; pass < 2; ++pass)
+    {
+      for (u32 s = 0; s < m_sites; ++s)
+      {
+        const u64 last = m_lastEvent[s] < now ? m_lastEvent[s] : now;
+        const u64 band = last / m_band;
+        const u32 segment = band + m_recent <= m_newestBand ? 0 :
+          (u32) (m_recent - (m_newestBand - band));
+        if (pass == 0)
+        {
+          ++m_segmentStart[segment + 1];
+        }
+        else
+        {
+          const u32 position = m_segmentStart[segment]++;
+          m_order[position] = s;
+          m_position[s] = position;
+        }
+      }
+
+      if (pass == 0)
+      {
+        for (u32 j = 1; j < m_recent + 2; ++j)  // Counts to starts
+        {
+          m_segmentStart[j] += m_segmentStart[j - 1];
+        }
+      }
+    }
+    /* Placing moved each start to its segment's end; shift back */
+    for (u32 j = m_recent + 1; j > 0; --j)
+    {
+      m_segmentStart[j] = m_segmentStart[j - 1];
+    }
+    m_segmentStart[0] = 0;
+  }
+
+  u32 EventAgeIndex::GetSegmentBound(u32 segment) const
+  {
+    if (segment == 0)
+    {
+      return WeightOfAge((u64) MAX_WARP * m_sites);
+    }
+    const u64 band = m_newestBand - (m_recent - segment);
+    return WeightOfAge(m_now - band * m_band);  // Age of the band's first event number
+  }
+
+  u32 EventAgeIndex::FindSegment(u32 position) const
+  {
+    u32 j = m_recent;
+    while (position < m_segmentStart[j])
+    {
+      --j;
+    }
+    return j;
+  }
+
+  void EventAgeIndex::AdvanceTo(u64 now)
+  {
+    if (now <= m_now)
+    {
+      return;
+    }
+    m_now = now;
+
+    const u64 band = now / m_band;
+    if (band == m_newestBand)
+    {
+      return;
+    }
+
+    /* The oldest recent segments join the saturated one; the rest
+       move down, and the new ones start out empty */
+    const u64 steps = band - m_newestBand;
+    for (u32 j = 1; j <= m_recent; ++j)
+    {
+      m_segmentStart[j] = j + steps <= m_recent ? m_segmentStart[j + steps] : m_sites;
+    }
+    m_newestBand = band;
+  }
+
+  void EventAgeIndex::RecordEvent(u32 site, u64 eventNumber)
+  {
+    MFM_API_ASSERT_ARG(site < m_sites);
+    MFM_API_ASSERT_ARG(eventNumber >= m_now);
+
+    AdvanceTo(eventNumber);
+    m_lastEvent[site] = eventNumber;
+
+    /* Bubble it up to the newest segment, one swap per boundary */
+    u32 position = m_position[site];
+    for (u32 j = FindSegment(position); j < m_recent; ++j)
+    {
+      const u32 last = m_segmentStart[j + 1] - 1;
+      Swap(position, last);
+      position = last;
+      --m_segmentStart[j + 1];
+    }
+  }
+
+  bool EventAgeIndex::Pick(Random & random, u64 now, u32 & site)
+  {
+    MFM_API_ASSERT_STATE(IsInitted());
+    MFM_API_ASSERT_STATE(now >= m_now);
+
+    AdvanceTo(now);
+
+    u32 total = 0;
+    for (u32 j = 0; j <= m_recent; ++j)
+    {
+      const u32 units = (GetSegmentBound(j) + m_weightUnit - 1) / m_weightUnit;
+      total += (m_segmentStart[j + 1] - m_segmentStart[j]) * units;
+    }
+
+    u32 draw = random.Create(total);
+    for (u32 j = 0; j <= m_recent; ++j)
+    {
+      const u32 count = m_segmentStart[j + 1] - m_segmentStart[j];
+      const u32 units = (GetSegmentBound(j) + m_weightUnit - 1) / m_weightUnit;
+      if (draw >= count * units)
+      {
+        draw -= count * units;
+        continue;
+      }
+
+      site = m_order[m_segmentStart[j] + draw / units];  // Uniform within the segment
+      const u64 last = m_lastEvent[site];
+      const u32 weight = WeightOfAge(now >= last ? now - last : 0);
+      return random.OddsOf(weight, units * m_weightUnit);
+    }
+    FAIL(UNREACHABLE_CODE);
+  }
+} /* namespace MFM */
@@ -0,0 +1,85 @@
+#include "EventPhaseTimer.h"
+
+#ifdef MFM_EVENT_PHASE_TIMING
+
+#include "Fail.h"
+
+namespace MFM
+{
+  const char * EventPhaseTimer::GetPhaseName(u32 phase)
+  {
+    switch (phase)
+    {
+    case ACQUIRE_LOCKS:    return "AcquireAllLocks";
+    case LOAD_FROM_TILE:   return "LoadFromTile";
+    case EXECUTE_BEHAVIOR: return "ExecuteBehavior";
+    case STORE_TO_TILE:    return "StoreToTile";
+    default: FAIL(ILLEGAL_ARGUMENT);
+    }
+  }
+
+  void EventPhaseTimer::Reset()
+  {
+    for (u32 p = 0; p < PHASE_COUNT; ++p)
+    {
+      for (u32 b = 0; b < BUCKET_COUNT; ++b)
+      {
+        m_histogram[p][b] = 0;
+      }
+      m_samples[p] = 0;
+      m_totalTicks[p] = 0;
+    }
+  }
+
+  void EventPhaseTimer::Add(const EventPhaseTimer & other)
+  {
+    for (u32 p = 0; p < PHASE_COUNT; ++p)
+    {
+      for (u32 b = 0; b < BUCKET_COUNT; ++b)
+      {
+        m_histogram[p][b] += other.m_histogram[p][b];
+      }
+      m_samples[p] += other.m_samples[p];
+      m_totalTicks[p] += other.m_totalTicks[p];
+    }
+  }
+
+  u32 EventPhaseTimer::GetPercentileBucket(u32 phase, u32 percent) const
+  {
+    MFM_API_ASSERT_ARG(phase < PHASE_COUNT && percent <= 100);
+    const u64 samples = m_samples[phase];
+    if (samples == 0)
+    {
+      return 0;
+    }
+
+    /* Nearest rank */
+    const u64 rank = (samples * percent + 99) / 100;
+    u64 seen = 0;
+    for (u32 b = 0; b < BUCKET_COUNT; ++b)
+    {
+      seen += m_histogram[phase][b];
+      if (seen >= rank && seen > 0)
+      {
+        return b;
+      }
+    }
+    return BUCKET_COUNT - 1;
+  }
+
+  void EventPhaseTimer::ReportPhaseTimes(Logger::Level level, const char * label) const
+  {
+    for (u32 p = 0; p < PHASE_COUNT; ++p)
+    {
+      const u64 samples = m_samples[p];
+      LOG.Log(level, "%s%s: %uK samples, mean %u ticks, p50 <2^%u, p99 <2^%u",
+              label, GetPhaseName(p),
+              (u32) (samples / 1000),
+              (u32) (samples ? m_totalTicks[p] / samples : 0),
+              GetPercentileBucket(p, 50) + 1,
+              GetPercentileBucket(p, 99) + 1);
+    }
+  }
+} /* namespace MFM */
+
+#endif /* MFM_EVENT_PHASE_TIMING */
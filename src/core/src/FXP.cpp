@@ -1153,4 +1153,92 @@ namespace MFM {
     return s;
   }
 
+  /* sqrt(k<<24)<<8, rounded, for k = 64..256, so adjacent entries
+     bracket sqrt(m)<<8 for any m in [2^30, 2^32) */
+  static const uint32_t sqrt_tab[] = {
+    0x800000, 0x80ff02, 0x81fc10, 0x82f734, 0x83f07b, 0x84e7ee, 0x85dd98, 0x86d182,
+    0x87c3b6, 0x88b43d, 0x89a320, 0x8a9067, 0x8b7c1a, 0x8c6641, 0x8d4ee4, 0x8e360b,
+    0x8f1bbd, 0x900000, 0x90e2dc, 0x91c456, 0x92a476, 0x938341, 0x9460be, 0x953cf2,
+    0x9617e3, 0x96f196, 0x97ca11, 0x98a15a, 0x997774, 0x9a4c65, 0x9b2032, 0x9bf2df,
+    0x9cc471, 0x9d94ec, 0x9e6455, 0x9f32af, 0xa00000, 0xa0cc4a, 0xa19792, 0xa261dc,
+    0xa32b2b, 0xa3f383, 0xa4bae7, 0xa5815a, 0xa646e1, 0xa70b7f, 0xa7cf36, 0xa8920a,
+    0xa953fd, 0xaa1514, 0xaad550, 0xab94b5, 0xac5345, 0xad1104, 0xadcdf3, 0xae8a16,
+    0xaf456f, 0xb00000, 0xb0b9cc, 0xb172d6, 0xb22b20, 0xb2e2ac, 0xb3997c, 0xb44f93,
+    0xb504f3, 0xb5b99e, 0xb66d96, 0xb720dd, 0xb7d375, 0xb88560, 0xb936a1, 0xb9e738,
+    0xba9728, 0xbb4673, 0xbbf51b, 0xbca321, 0xbd5087, 0xbdfd4e, 0xbea979, 0xbf5509,
+    0xc00000, 0xc0aa5f, 0xc15428, 0xc1fd5c, 0xc2a5fe, 0xc34e0d, 0xc3f58d, 0xc49c7e,
+    0xc542e1, 0xc5e8b9, 0xc68e06, 0xc732ca, 0xc7d706, 0xc87abc, 0xc91dec, 0xc9c098,
+    0xca62c2, 0xcb046a, 0xcba592, 0xcc463a, 0xcce665, 0xcd8613, 0xce2545, 0xcec3fc,
+    0xcf623a, 0xd00000, 0xd09d4e, 0xd13a26, 0xd1d689, 0xd27278, 0xd30df3, 0xd3a8fd,
+    0xd44395, 0xd4ddbc, 0xd57775, 0xd610bf, 0xd6a99b, 0xd7420b, 0xd7da10, 0xd871a9,
+    0xd908d9, 0xd99fa0, 0xda35fe, 0xdacbf5, 0xdb6186, 0xdbf6b1, 0xdc8b77, 0xdd1fd9,
+    0xddb3d7, 0xde4773, 0xdedaae, 0xdf6d87, 0xe00000, 0xe09219, 0xe123d4, 0xe1b531,
+    0xe24630, 0xe2d6d3, 0xe36719, 0xe3f704, 0xe48695, 0xe515cc, 0xe5a4a9, 0xe6332e,
+    0xe6c15a, 0xe74f2f, 0xe7dcae, 0xe869d6, 0xe8f6a9, 0xe98327, 0xea0f50, 0xea9b26,
+    0xeb26a9, 0xebb1d9, 0xec3cb7, 0xecc744, 0xed517f, 0xeddb6b, 0xee6507, 0xeeee53,
+    0xef7751, 0xf00000, 0xf08862, 0xf11076, 0xf1983e, 0xf21fba, 0xf2a6ea, 0xf32dcf,
+    0xf3b46a, 0xf43aba, 0xf4c0c0, 0xf5467e, 0xf5cbf2, 0xf6511e, 0xf6d603, 0xf75aa0,
+    0xf7def6, 0xf86305, 0xf8e6ce, 0xf96a52, 0xf9ed91, 0xfa708b, 0xfaf340, 0xfb75b1,
+    0xfbf7df, 0xfc79ca, 0xfcfb72, 0xfd7cd8, 0xfdfdfc, 0xfe7ede, 0xfeff7f, 0xff7fe0,
+    0x1000000,
+  };
+
+  int32_t fixsqrt16fast(int32_t a)
+  {
+    if (a <= 0) return 0;
+
+    /* Normalize by an even shift into [2^30, 2^32), so the root
+       just shifts back by half as much */
+    const uint32_t s = detail::CountLeadingZeros(a) & ~1u;
+    const uint32_t m = ((uint32_t) a) << s;
+
+    /* Interpolate on the top 8 bits, weighted by the next 16 */
+    const uint32_t i = (m >> 24) - 64;
+    const uint32_t lo = sqrt_tab[i];
+    const uint32_t v = lo + (uint32_t) (((uint64_t) (sqrt_tab[i + 1] - lo) * ((m >> 8) & 0xffff)) >> 16);
+
+    /* sqrt(a<<16) == (sqrt(m)<<8) >> (s/2) */
+    const uint32_t sh = s >> 1;
+    return (int32_t) (sh ? (v + (1u << (sh - 1))) >> sh : v);
+  }
+
+  /* As fixsin16 after its range reduction: turns holds a fraction
+     of a full turn in its low 16 bits */
+  static inline int32_t fixsinturns16(uint32_t turns)
+  {
+    turns = (turns & 0xffff) >> 4;
+    const int32_t v = (turns & 0x400) ? sin_tab[0x3ff - (turns & 0x3ff)] : sin_tab[turns & 0x3ff];
+    return (turns & 0x800) ? -v : v;
+  }
+
+  /* 2^32/(2*pi), so that ((int64_t) a * R2PI32) >> 32 is a 16.16
+     angle in 16.16 turns.  FIX16_R2PI is too coarse for this: its
+     rounding alone is off by 2^-9 radians by about 54 radians */
+  static const int64_t R2PI32 = 683565276;
+
+  static inline uint32_t fixturns16(int32_t a)
+  {
+    return (uint32_t) (((int64_t) a * R2PI32) >> 32);
+  }
+
+  void SinBatch(const FXP16 * a, FXP16 * out, u32 count)
+  {
+    /* Keeping only the fraction of the turns reduces any angle,
+       negative too, without fixsin16's loop */
+    for (u32 i = 0; i < count; ++i)
+      out[i].intValue = fixsinturns16(fixturns16(a[i].intValue));
+  }
+
+  void CosBatch(const FXP16 * a, FXP16 * out, u32 count)
+  {
+    for (u32 i = 0; i < count; ++i)
+      out[i].intValue = fixsinturns16(fixturns16(a[i].intValue) + 0x4000);
+  }
+
+  void SqrtBatch(const FXP16 * a, FXP16 * out, u32 count)
+  {
+    for (u32 i = 0; i < count; ++i)
+      out[i].intValue = fixsqrt16fast(a[i].intValue);
+  }
+
 } // end namespace MFM
@@ -0,0 +1,121 @@
+#include "FastClock.h"
+#include <pthread.h>  /* For pthread_once */
+#include <stdio.h>   /* For fopen, fgets */
+#include <string.h>  /* For strstr, strncmp */
+
+namespace MFM
+{
+  FastClock::State FastClock::m_state = { false, false, 0, 0.0, 0, 0, 0, 0 };
+
+  /** Rereading CLOCK_REALTIME this often bounds drift and NTP lag */
+  static const u64 REALTIME_REANCHOR_NANOS = 1000000000;
+
+  /** How long to watch the counter against CLOCK_MONOTONIC */
+  static const u64 CALIBRATION_NANOS = 5000000;
+
+#if defined(__i386__) || defined(__x86_64__)
+  /** Only an invariant TSC ticks at one rate on all cores, always */
+  static bool HasInvariantCounter()
+  {
+    FILE * fp = fopen("/proc/cpuinfo", "r");
+    if (!fp)
+    {
+      return false;
+    }
+    bool constant = false, nonstop = false;
+    char line[4096];
+    while (fgets(line, sizeof(line), fp))
+    {
+      if (!strncmp(line, "flags", 5))
+      {
+        constant = strstr(line, " constant_tsc") != 0;
+        nonstop = strstr(line, " nonstop_tsc") != 0;
+        break;
+      }
+    }
+    fclose(fp);
+    return constant && nonstop;
+  }
+
+  static u64 FindCounterHz()
+  {
+    if (!HasInvariantCounter())
+    {
+      return 0;
+    }
+    const u64 ns0 = FastClock::ReadSystemNanos(CLOCK_MONOTONIC);
+    const u64 t0 = FastClock::ReadCounter();
+    u64 ns1;
+    do
+    {
+      ns1 = FastClock::ReadSystemNanos(CLOCK_MONOTONIC);
+    } while (ns1 - ns0 < CALIBRATION_NANOS);
+    const u64 t1 = FastClock::ReadCounter();
+    return (u64) ((t1 - t0) * 1.0e9 / (ns1 - ns0) + 0.5);
+  }
+#elif defined(__aarch64__)
+  static u64 FindCounterHz()
+  {
+    u64 hz;
+    __asm__ __volatile__("mrs %0, cntfrq_el0" : "=r" (hz));
+    return hz;
+  }
+#else
+  static u64 FindCounterHz()
+  {
+    return 0;
+  }
+#endif
+
+  static void Calibrate(FastClock::State & state)
+  {
+    state.m_counterHz = FindCounterHz();
+    state.m_useCounter = state.m_counterHz > 0;
+    if (state.m_useCounter)
+    {
+      state.m_nanosPerTick = 1.0e9 / state.m_counterHz;
+      state.m_baseNanos = FastClock::ReadSystemNanos(CLOCK_MONOTONIC);
+      state.m_baseTicks = FastClock::ReadCounter();
+    }
+  }
+
+  static pthread_once_t calibrated = PTHREAD_ONCE_INIT;
+
+  void FastClock::CalibrateOnce()
+  {
+    Calibrate(m_state);
+    __atomic_store_n(&m_state.m_initted, true, __ATOMIC_RELEASE);
+  }
+
+  void FastClock::Init()
+  {
+    pthread_once(&calibrated, CalibrateOnce);
+  }
+
+  void FastClock::SetCounterEnabled(bool enabled)
+  {
+    Init();
+    m_state.m_useCounter = enabled && m_state.m_counterHz > 0;
+    __atomic_store_n(&m_state.m_realtimeAnchor, 0, __ATOMIC_RELAXED);
+  }
+
+  u64 FastClock::RealtimeNanos()
+  {
+    const u64 now = MonotonicNanos();
+    if (!m_state.m_useCounter)
+    {
+      return ReadSystemNanos(CLOCK_REALTIME);
+    }
+
+    const u64 anchor = __atomic_load_n(&m_state.m_realtimeAnchor, __ATOMIC_ACQUIRE);
+    if (anchor == 0 || now - anchor >= REALTIME_REANCHOR_NANOS)
+    {
+      /* Racing threads all compute about the same offset */
+      const u64 offset = ReadSystemNanos(CLOCK_REALTIME) - MonotonicNanos();
+      __atomic_store_n(&m_state.m_realtimeOffset, offset, __ATOMIC_RELAXED);
+      __atomic_store_n(&m_state.m_realtimeAnchor, now, __ATOMIC_RELEASE);
+      return now + offset;
+    }
+    return now + __atomic_load_n(&m_state.m_realtimeOffset, __ATOMIC_RELAXED);
+  }
+} /* namespace MFM */
@@ -0,0 +1,179 @@
+#include "FlightRecorder.h"
+#include "Dirs.h"
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
+#include <string.h>  /* For strncpy */
+
+namespace MFM
+{
+  static FlightRecorder * flightRecorders = 0;
+  static pthread_mutex_t flightRecordersLock = PTHREAD_MUTEX_INITIALIZER;
+  static u32 flightRecordersDumped = 0;
+
+  /* A line built with no allocation or stdio, for signal handlers */
+  struct DumpLine
+  {
+    char m_buf[160];
+    u32 m_len;
+
+    DumpLine() : m_len(0) { }
+
+    void Add(const char * s)
+    {
+      while (*s && m_len < sizeof(m_buf)) m_buf[m_len++] = *s++;
+    }
+
+    void AddNumber(u64 n, u32 base, u32 minDigits)
+    {
+      char digits[24];
+      u32 count = 0;
+      do
+      {
+        digits[count++] = "0123456789abcdef"[n % base];
+        n /= base;
+      } while (n > 0 && count < sizeof(digits));
+      while (count < minDigits && count < sizeof(digits)) digits[count++] = '0';
+      while (count > 0 && m_len < sizeof(m_buf)) m_buf[m_len++] = digits[--count];
+    }
+
+    void Write(int fd)
+    {
+      Add("\n");
+      const char * p = m_buf;
+      while (m_len > 0)
+      {
+        const ssize_t wrote = write(fd, p, m_len);
+        if (wrote <= 0) break;
+        p += wrote;
+        m_len -= wrote;
+      }
+      m_len = 0;
+    }
+  };
+
+  FlightRecorder::FlightRecorder()
+    : m_begun(0)
+    , m_next(0)
+    , m_prev(0)
+  {
+    memset(m_records, 0, sizeof(m_records));
+    m_label[0] = 0;
+
+    pthread_mutex_lock(&flightRecordersLock);
+    m_next = flightRecorders;
+    if (m_next) m_next->m_prev = this;
+    flightRecorders = this;
+    pthread_mutex_unlock(&flightRecordersLock);
+  }
+
+  FlightRecorder::~FlightRecorder()
+  {
+    pthread_mutex_lock(&flightRecordersLock);
+    if (m_prev) m_prev->m_next = m_next;
+    else flightRecorders = m_next;
+    if (m_next) m_next->m_prev = m_prev;
+    pthread_mutex_unlock(&flightRecordersLock);
+  }
+
+  void FlightRecorder::SetLabel(const char * label)
+  {
+    strncpy(m_label, label ? label : "", LABEL_BYTES - 1);
+    m_label[LABEL_BYTES - 1] = 0;
+  }
+
+  const char * FlightRecorder::GetOutcomeName(u32 outcome)
+  {
+    switch (outcome)
+    {
+    case BEHAVING: return "behaving";
+    case STORING: return "storing";
+    case DONE: return "done";
+    case FAILED: return "failed";
+    default: return "?";
+    }
+  }
+
+  void FlightRecorder::Dump(int fd) const
+  {
+    const u32 begun = GetBegun();
+    const u32 count = begun < RECORDS ? begun : RECORDS;
+    const u64 newest = count > 0 ? GetRecent(0).m_stamp : 0;
+
+    DumpLine line;
+    line.Add("Flight recorder, tile ");
+    line.Add(m_label[0] ? m_label : "?");
+    line.Add(": last ");
+    line.AddNumber(count, 10, 1);
+    line.Add(" of ");
+    line.AddNumber(begun, 10, 1);
+    line.Add(" events, oldest first; stamps are ticks before the newest");
+    line.Write(fd);
+
+    for (u32 age = count; age-- > 0; )
+    {
+      const Record & r = GetRecent(age);
+      line.Add("  -");
+      line.AddNumber(newest - r.m_stamp, 10, 1);
+      line.Add(" (");
+      line.AddNumber(r.m_x, 10, 1);
+      line.Add(",");
+      line.AddNumber(r.m_y, 10, 1);
+      line.Add(") type 0x");
+      line.AddNumber(r.m_type, 16, 4);
+      line.Add(" locks");
+      if (r.m_lockDirs == 0) line.Add(" none");
+      for (Dir d = 0; d < Dirs::DIR_COUNT; ++d)
+      {
+        if (r.m_lockDirs & (1 << d))
+        {
+          line.Add(" ");
+          line.Add(Dirs::GetCode(d));
+        }
+      }
+      line.Add(" ");
+      line.Add(GetOutcomeName(r.m_outcome));
+      line.Write(fd);
+    }
+  }
+
+  void FlightRecorder::DumpAll(int fd)
+  {
+    // No lock: this may be a signal handler, interrupting a thread
+    // that holds it.  Tiles come and go only at startup and shutdown.
+    for (const FlightRecorder * fr = flightRecorders; fr; fr = fr->m_next)
+    {
+      fr->Dump(fd);
+    }
+  }
+
+  void FlightRecorder::HandleCrash(int sig)
+  {
+    // Once, however many threads crash together
+    if (__atomic_exchange_n(&flightRecordersDumped, 1, __ATOMIC_ACQ_REL) == 0)
+    {
+      DumpLine line;
+      line.Add("\nSignal ");
+      line.AddNumber((u32) sig, 10, 1);
+      line.Add(": dumping flight recorders");
+      line.Write(STDERR_FILENO);
+      DumpAll(STDERR_FILENO);
+    }
+    // SA_RESETHAND restored the default; let it happen
+    raise(sig);
+  }
+
+  void FlightRecorder::InstallCrashHandlers()
+  {
+    static const int signals[] = { SIGABRT, SIGSEGV, SIGBUS, SIGILL, SIGFPE };
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = HandleCrash;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = SA_RESETHAND | SA_NODEFER;
+    for (u32 i = 0; i < sizeof(signals) / sizeof(signals[0]); ++i)
+    {
+      sigaction(signals[i], &sa, 0);
+    }
+  }
+}
@@ -0,0 +1,378 @@
+#include "Inflate.h"
+#include <string.h>  /* For memcpy */
+
+namespace MFM
+{
+  static const u16 LENGTH_BASE[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+  };
+  static const u8 LENGTH_EXTRA[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+  };
+  static const u16 DISTANCE_BASE[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+    8193, 12289, 16385, 24577
+  };
+  static const u8 DISTANCE_EXTRA[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+  };
+
+  /* The order code length code lengths arrive in */
+  static const u8 CODE_LENGTH_ORDER[19] = {
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+  };
+
+  /* The input bit by bit, least significant first, and the output */
+  struct InflateStream
+  {
+    const u8 * m_in;
+    u32 m_inBytes;
+    u32 m_inAt;
+    u32 m_bits;
+    u32 m_bitCount;
+    u8 * m_out;
+    u32 m_outBytes;
+    u32 m_outAt;
+    bool m_damaged;  // Ran off the end of the input
+
+    u32 Bits(u32 need)
+    {
+      u32 bits = m_bits;
+      while (m_bitCount < need)
+      {
+        if (m_inAt >= m_inBytes)
+        {
+          m_damaged = true;
+          return 0;
+        }
+        bits |= ((u32) m_in[m_inAt++]) << m_bitCount;
+        m_bitCount += 8;
+      }
+      m_bits = bits >> need;
+      m_bitCount -= need;
+      return bits & ((1u << need) - 1);
+    }
+  };
+
+  /* A canonical Huffman code, as the number of codes of each length
+     and the symbols in code order */
+  struct Huffman
+  {
+    u16 m_count[Inflate::MAX_BITS + 1];
+    u16 m_symbol[Inflate::MAX_LENGTH_CODES];
+  };
+
+  /* Build h from the code lengths of symbols 0..n-1.  Returns 0 for a
+     complete code, > 0 for an incomplete one, and < 0 for one that's
+     over-subscribed */
+  static s32 Build(Huffman & h, const u16 * lengths, u32 n)
+  {
+    for (u32 len = 0; len <= Inflate::MAX_BITS; ++len)
+    {
+      h.m_count[len] = 0;
+    }
+    for (u32 sym = 0; sym < n; ++sym)
+    {
+      ++h.m_count[lengths[sym]];
+    }
+    if (h.m_count[0] == n)
+    {
+      return 0;  // No codes at all, which is complete enough
+    }
+
+    s32 left = 1;
+    for (u32 len = 1; len <= Inflate::MAX_BITS; ++len)
+    {
+      left <<= 1;
+      left -= h.m_count[len];
+      if (left < 0)
+      {
+        return left;
+      }
+    }
+
+    u16 offsets[Inflate::MAX_BITS + 1];
+    offsets[1] = 0;
+    for (u32 len = 1; len < Inflate::MAX_BITS; ++len)
+    {
+      offsets[len + 1] = offsets[len] + h.m_count[len];
+    }
+    for (u32 sym = 0; sym < n; ++sym)
+    {
+      if (lengths[sym] != 0)
+      {
+        h.m_symbol[offsets[lengths[sym]]++] = (u16) sym;
+      }
+    }
+    return left;
+  }
+
+  /* The next symbol in h, or -1 */
+  static s32 Decode(InflateStream & s, const Huffman & h)
+  {
+    s32 code = 0;   // Bits read so far
+    s32 first = 0;  // First code of the current length
+    s32 index = 0;  // Its symbol's index
+    for (u32 len = 1; len <= Inflate::MAX_BITS; ++len)
+    {
+      code |= (s32) s.Bits(1);
+      if (s.m_damaged)
+      {
+        return -1;
+      }
+      const s32 count = h.m_count[len];
+      if (code - count < first)
+      {
+        return h.m_symbol[index + (code - first)];
+      }
+      index += count;
+      first += count;
+      first <<= 1;
+      code <<= 1;
+    }
+    return -1;
+  }
+
+  static bool Stored(InflateStream & s)
+  {
+    s.m_bits = 0;  // Stored blocks start on a byte
+    s.m_bitCount = 0;
+    if (s.m_inBytes - s.m_inAt < 4)
+    {
+      return false;
+    }
+    const u8 * at = s.m_in + s.m_inAt;
+    const u32 length = at[0] | (at[1] << 8);
+    const u32 check = at[2] | (at[3] << 8);
+    if (check != (~length & 0xffff))
+    {
+      return false;
+    }
+    s.m_inAt += 4;
+    if (length > s.m_inBytes - s.m_inAt || length > s.m_outBytes - s.m_outAt)
+    {
+      return false;
+    }
+    memcpy(s.m_out + s.m_outAt, s.m_in + s.m_inAt, length);
+    s.m_inAt += length;
+    s.m_outAt += length;
+    return true;
+  }
+
+  static bool Codes(InflateStream & s, const Huffman & lengthCode, const Huffman & distanceCode)
+  {
+    while (true)
+    {
+      s32 sym = Decode(s, lengthCode);
+      if (sym < 0)
+      {
+        return false;
+      }
+      if (sym < 256)
+      {
+        if (s.m_outAt >= s.m_outBytes)
+        {
+          return false;
+        }
+        s.m_out[s.m_outAt++] = (u8) sym;
+        continue;
+      }
+      if (sym == 256)
+      {
+        return true;  // End of block
+      }
+
+      sym -= 257;
+      if (sym >= 29)
+      {
+        return false;
+      }
+      const u32 length = LENGTH_BASE[sym] + s.Bits(LENGTH_EXTRA[sym]);
+      const s32 dsym = Decode(s, distanceCode);
+      if (dsym < 0 || dsym >= 30)
+      {
+        return false;
+      }
+      const u32 distance = DISTANCE_BASE[dsym] + s.Bits(DISTANCE_EXTRA[dsym]);
+      if (s.m_damaged || distance > s.m_outAt || length > s.m_outBytes - s.m_outAt)
+      {
+        return false;
+      }
+      // Byte by byte, since the copy may overlap itself
+      const u8 * from = s.m_out + s.m_outAt - distance;
+      u8 * to = s.m_out + s.m_outAt;
+      for (u32 i = 0; i < length; ++i)
+      {
+        to[i] = from[i];
+      }
+      s.m_outAt += length;
+    }
+  }
+
+  static bool Fixed(InflateStream & s)
+  {
+    u16 lengths[Inflate::MAX_LENGTH_CODES];
+    u32 sym = 0;
+    for (; sym < 144; ++sym) lengths[sym] = 8;
+    for (; sym < 256; ++sym) lengths[sym] = 9;
+    for (; sym < 280; ++sym) lengths[sym] = 7;
+    for (; sym < Inflate::MAX_LENGTH_CODES; ++sym) lengths[sym] = 8;
+    Huffman lengthCode, distanceCode;
+    Build(lengthCode, lengths, Inflate::MAX_LENGTH_CODES);
+
+    for (sym = 0; sym < Inflate::MAX_DISTANCE_CODES; ++sym) lengths[sym] = 5;
+    Build(distanceCode, lengths, Inflate::MAX_DISTANCE_CODES);
+
+    return Codes(s, lengthCode, distanceCode);
+  }
+
+  static bool Dynamic(InflateStream & s)
+  {
+    const u32 lengthCount = s.Bits(5) + 257;
+    const u32 distanceCount = s.Bits(5) + 1;
+    const u32 codeCount = s.Bits(4) + 4;
+    if (s.m_damaged || lengthCount > 286 || distanceCount > Inflate::MAX_DISTANCE_CODES)
+    {
+      return false;
+    }
+
+    u16 lengths[Inflate::MAX_LENGTH_CODES + Inflate::MAX_DISTANCE_CODES];
+    u32 i;
+    for (i = 0; i < codeCount; ++i)
+    {
+      lengths[CODE_LENGTH_ORDER[i]] = (u16) s.Bits(3);
+    }
+    for (; i < 19; ++i)
+    {
+      lengths[CODE_LENGTH_ORDER[i]] = 0;
+    }
+    Huffman lengthCode, distanceCode;
+    if (s.m_damaged || Build(lengthCode, lengths, 19) != 0)
+    {
+      return false;
+    }
+
+    // The literal/length and distance code lengths, run-length coded
+    for (i = 0; i < lengthCount + distanceCount; )
+    {
+      s32 sym = Decode(s, lengthCode);
+      if (sym < 0)
+      {
+        return false;
+      }
+      if (sym < 16)
+      {
+        lengths[i++] = (u16) sym;
+        continue;
+      }
+      u16 repeated = 0;
+      u32 times;
+      if (sym == 16)
+      {
+        if (i == 0)
+        {
+          return false;
+        }
+        repeated = lengths[i - 1];
+        times = 3 + s.Bits(2);
+      }
+      else if (sym == 17)
+      {
+        times = 3 + s.Bits(3);
+      }
+      else
+      {
+        times = 11 + s.Bits(7);
+      }
+      if (s.m_damaged || i + times > lengthCount + distanceCount)
+      {
+        return false;
+      }
+      while (times-- > 0)
+      {
+        lengths[i++] = repeated;
+      }
+    }
+    if (lengths[256] == 0)
+    {
+      return false;  // No end of block code
+    }
+
+    // Only a single-code distance code may be incomplete
+    s32 left = Build(lengthCode, lengths, lengthCount);
+    if (left < 0 || (left > 0 && lengthCount - lengthCode.m_count[0] != 1))
+    {
+      return false;
+    }
+    left = Build(distanceCode, lengths + lengthCount, distanceCount);
+    if (left < 0 || (left > 0 && distanceCount - distanceCode.m_count[0] != 1))
+    {
+      return false;
+    }
+
+    return Codes(s, lengthCode, distanceCode);
+  }
+
+  bool Inflate::Decompress(const u8 * packed, u32 packedBytes, u8 * raw, u32 rawBytes)
+  {
+    InflateStream s;
+    s.m_in = packed;
+    s.m_inBytes = packedBytes;
+    s.m_inAt = 0;
+    s.m_bits = 0;
+    s.m_bitCount = 0;
+    s.m_out = raw;
+    s.m_outBytes = rawBytes;
+    s.m_outAt = 0;
+    s.m_damaged = false;
+
+    bool last;
+    do
+    {
+      last = s.Bits(1) != 0;
+      const u32 type = s.Bits(2);
+      if (s.m_damaged)
+      {
+        return false;
+      }
+      bool ok;
+      switch (type)
+      {
+      case 0:  ok = Stored(s); break;
+      case 1:  ok = Fixed(s); break;
+      case 2:  ok = Dynamic(s); break;
+      default: ok = false; break;
+      }
+      if (!ok)
+      {
+        return false;
+      }
+    } while (!last);
+
+    return s.m_outAt == rawBytes;
+  }
+
+  /* CRC-32 of each nibble, for the reflected polynomial 0xedb88320 */
+  static const u32 CRC_NIBBLES[16] = {
+    0x00000000, 0x1db71064, 0x3b6e20c8, 0x26d930ac,
+    0x76dc4190, 0x6b6b51f4, 0x4db26158, 0x5005713c,
+    0xedb88320, 0xf00f9344, 0xd6d6a3e8, 0xcb61b38c,
+    0x9b64c2b0, 0x86d3d2d4, 0xa00ae278, 0xbdbdf21c
+  };
+
+  u32 Inflate::CRC32(u32 crc, const u8 * bytes, u32 length)
+  {
+    crc = ~crc;
+    for (u32 i = 0; i < length; ++i)
+    {
+      crc ^= bytes[i];
+      crc = (crc >> 4) ^ CRC_NIBBLES[crc & 15];
+      crc = (crc >> 4) ^ CRC_NIBBLES[crc & 15];
+    }
+    return ~crc;
+  }
+}
@@ -0,0 +1,171 @@
+#include "LZBlock.h"
+#include <string.h>  /* For memcpy */
+
+namespace MFM
+{
+  static inline u32 Read32(const u8 * at)
+  {
+    u32 word;
+    memcpy(&word, at, sizeof(word));
+    return word;
+  }
+
+  static inline u32 Hash(u32 word)
+  {
+    return (word * 2654435761u) >> (32 - LZBlock::HASH_BITS);
+  }
+
+  /* Lengths of 15 and up spill into 255s and a remainder */
+  static inline u8 * PutLength(u8 * out, u32 length)
+  {
+    for (length -= 15; length >= 255; length -= 255)
+    {
+      *out++ = 255;
+    }
+    *out++ = (u8) length;
+    return out;
+  }
+
+  static u8 * PutSequence(u8 * out, const u8 * literals, u32 literalCount, u32 offset, u32 matchLength)
+  {
+    u8 * token = out++;
+    *token = (u8) ((literalCount < 15 ? literalCount : 15) << 4);
+    if (literalCount >= 15)
+    {
+      out = PutLength(out, literalCount);
+    }
+    memcpy(out, literals, literalCount);
+    out += literalCount;
+
+    if (matchLength > 0)  // Else the last sequence, all literals
+    {
+      *out++ = (u8) offset;
+      *out++ = (u8) (offset >> 8);
+      const u32 extra = matchLength - LZBlock::MIN_MATCH;
+      *token |= (u8) (extra < 15 ? extra : 15);
+      if (extra >= 15)
+      {
+        out = PutLength(out, extra);
+      }
+    }
+    return out;
+  }
+
+  u32 LZBlock::Compress(const u8 * raw, u32 rawBytes, u8 * packed)
+  {
+    u32 table[1 << HASH_BITS];
+    memset(table, 0, sizeof(table));
+
+    u8 * out = packed;
+    u32 anchor = 0;
+    if (rawBytes > MATCH_LIMIT)
+    {
+      const u32 matchStartLimit = rawBytes - MATCH_LIMIT;
+      const u32 matchEndLimit = rawBytes - LAST_LITERALS;
+      u32 misses = 0;
+      u32 at = 1;  // Position 0 is the table's 'nothing here yet'
+      while (at < matchStartLimit)
+      {
+        const u32 word = Read32(raw + at);
+        const u32 h = Hash(word);
+        const u32 ref = table[h];
+        table[h] = at;
+        if (ref == 0 || at - ref > MAX_OFFSET || Read32(raw + ref) != word)
+        {
+          // Skip ahead faster through what isn't compressing
+          at += 1 + (misses++ >> 6);
+          continue;
+        }
+        misses = 0;
+
+        u32 length = MIN_MATCH;
+        while (at + length < matchEndLimit && raw[ref + length] == raw[at + length])
+        {
+          ++length;
+        }
+        out = PutSequence(out, raw + anchor, at - anchor, at - ref, length);
+        at += length;
+        anchor = at;
+      }
+    }
+    out = PutSequence(out, raw + anchor, rawBytes - anchor, 0, 0);
+    return (u32) (out - packed);
+  }
+
+  /* Adds spilled length bytes onto \c length, if \c in holds them */
+  static inline bool GetLength(const u8 * & in, const u8 * end, u32 & length)
+  {
+    u8 byte;
+    do
+    {
+      if (in >= end)
+      {
+        return false;
+      }
+      byte = *in++;
+      length += byte;
+      if (length > 0x7fffffff)
+      {
+        return false;
+      }
+    } while (byte == 255);
+    return true;
+  }
+
+  bool LZBlock::Decompress(const u8 * packed, u32 packedBytes, u8 * raw, u32 rawBytes)
+  {
+    const u8 * in = packed;
+    const u8 * const inEnd = packed + packedBytes;
+    u32 outAt = 0;
+
+    while (in < inEnd)
+    {
+      const u8 token = *in++;
+
+      u32 literalCount = token >> 4;
+      if (literalCount == 15 && !GetLength(in, inEnd, literalCount))
+      {
+        return false;
+      }
+      if (literalCount > (u32) (inEnd - in) || literalCount > rawBytes - outAt)
+      {
+        return false;
+      }
+      memcpy(raw + outAt, in, literalCount);
+      in += literalCount;
+      outAt += literalCount;
+
+      if (in == inEnd)
+      {
+        break;  // The last sequence has no match
+      }
+
+      if (inEnd - in < 2)
+      {
+        return false;
+      }
+      const u32 offset = in[0] | (in[1] << 8);
+      in += 2;
+      u32 matchLength = token & 15;
+      if (matchLength == 15 && !GetLength(in, inEnd, matchLength))
+      {
+        return false;
+      }
+      matchLength += MIN_MATCH;
+      if (offset == 0 || offset > outAt || matchLength > rawBytes - outAt)
+      {
+        return false;
+      }
+
+      // Byte at a time: the source may overlap what it's writing
+      const u8 * from = raw + outAt - offset;
+      u8 * to = raw + outAt;
+      for (u32 i = 0; i < matchLength; ++i)
+      {
+        to[i] = from[i];
+      }
+      outAt += matchLength;
+    }
+    return outAt == rawBytes;
+  }
+}
@@ -0,0 +1,67 @@
+#include "LogRecordQueue.h"
+#include <string.h>   /* For memcpy */
+
+namespace MFM
+{
+  LogRecordQueue::LogRecordQueue()
+    : m_enqueuePos(0)
+    , m_dequeuePos(0)
+    , m_dropped(0)
+  {
+    for (u32 i = 0; i < RECORD_COUNT; ++i)
+      m_records[i].m_sequence = i;
+  }
+
+  bool LogRecordQueue::Push(u32 level, u32 includeFlags, const char * text, u32 length)
+  {
+    u32 pos = m_enqueuePos;
+    Record * r;
+    while (true)
+    {
+      r = &m_records[pos & (RECORD_COUNT - 1)];
+      const s32 lag = (s32) (r->m_sequence - pos);
+      if (lag == 0)
+      {
+        // Slot is free for this position; try to claim it
+        const u32 was = __sync_val_compare_and_swap(&m_enqueuePos, pos, pos + 1);
+        if (was == pos) break;
+        pos = was;
+      }
+      else if (lag < 0)
+      {
+        // Slot still holds a record from a lap ago: we're full
+        __sync_fetch_and_add(&m_dropped, 1);
+        return false;
+      }
+      else
+        pos = m_enqueuePos;  // Somebody else claimed it; catch up
+    }
+
+    if (length > TEXT_BYTES) length = TEXT_BYTES;
+    r->m_level = (u8) level;
+    r->m_includeFlags = (u8) includeFlags;
+    r->m_length = (u16) length;
+    memcpy(r->m_text, text, length);
+
+    __sync_synchronize();
+    r->m_sequence = pos + 1;   // Publish to the consumer
+    return true;
+  }
+
+  const LogRecordQueue::Record * LogRecordQueue::Front() const
+  {
+    const Record & r = m_records[m_dequeuePos & (RECORD_COUNT - 1)];
+    if ((s32) (r.m_sequence - (m_dequeuePos + 1)) < 0)
+      return 0;                // Empty, or still being filled
+    __sync_synchronize();
+    return &r;
+  }
+
+  void LogRecordQueue::Pop()
+  {
+    Record & r = m_records[m_dequeuePos & (RECORD_COUNT - 1)];
+    __sync_synchronize();
+    r.m_sequence = m_dequeuePos + RECORD_COUNT;  // Free for the next lap
+    ++m_dequeuePos;
+  }
+}
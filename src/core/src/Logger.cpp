@@ -1,6 +1,119 @@
 #include "Logger.h"
+#include "OverflowableCharBufferByteSink.h"
+#include <sys/time.h>   /* For gettimeofday */
+#include <time.h>       /* For timespec */
 
 namespace MFM {
 
   Logger LOG(DevNullByteSink, Logger::ERROR);
+
+  void Logger::SetAsync(bool async)
+  {
+    if (async == IsAsync()) return;
+
+    if (async)
+    {
+      MFM_API_ASSERT(!pthread_mutex_init(&m_writerLock, NULL), LOCK_FAILURE);
+      MFM_API_ASSERT(!pthread_cond_init(&m_writerWake, NULL), LOCK_FAILURE);
+      m_writerExiting = false;
+      m_writerErrorStackTop = 0;
+      m_droppedReported = 0;
+      m_queue = new LogRecordQueue();
+      if (pthread_create(&m_writer, NULL, WriterRunner, this))
+      {
+        delete m_queue;
+        m_queue = 0;
+        FAIL(LOCK_FAILURE);
+      }
+      return;
+    }
+
+    pthread_mutex_lock(&m_writerLock);
+    m_writerExiting = true;
+    pthread_cond_signal(&m_writerWake);
+    pthread_mutex_unlock(&m_writerLock);
+    pthread_join(m_writer, NULL);
+
+    {
+      Mutex::ScopeLock lock(m_mutex);
+      DrainQueue();
+      delete m_queue;
+      m_queue = 0;
+    }
+    pthread_cond_destroy(&m_writerWake);
+    pthread_mutex_destroy(&m_writerLock);
+  }
+
+  void Logger::Enqueue(Level level, const char * format, va_list & ap)
+  {
+    OverflowableCharBufferByteSink<LogRecordQueue::TEXT_BYTES + 2> text;
+    unwind_protect(
+    {
+      abort(); // Logger is not prepared to handle failures during printing!
+    },
+    {
+      text.Vprintf(format, ap);
+    });
+    m_queue->Push(level, m_includeFlags, text.GetZString(), text.GetLength());
+  }
+
+  void Logger::DrainQueue()
+  {
+    if (!m_queue) return;
+    unwind_protect(
+    {
+      abort(); // Logger is not prepared to handle failures during printing!
+    },
+    {
+      const LogRecordQueue::Record * r;
+      while ((r = m_queue->Front()) != 0)
+      {
+        const u32 flags = r->m_includeFlags;
+        if (flags & INCLUDE_TIMESTAMP) m_sink->Printf("%@",m_timeStamper);
+        if (flags & INCLUDE_LEVEL) m_sink->Printf("%s", StrLevel((Level) r->m_level));
+        if (flags & INCLUDE_SEPARATOR) m_sink->Printf(": ");
+        if (flags & INCLUDE_TEXT) m_sink->WriteBytes((const u8 *) r->m_text, r->m_length);
+        if (flags & INCLUDE_NEWLINE) m_sink->Println();
+        m_queue->Pop();
+      }
+
+      const u32 dropped = m_queue->GetDroppedCount();
+      if (dropped != m_droppedReported)
+      {
+        if (m_includeFlags & INCLUDE_TIMESTAMP) m_sink->Printf("%@",m_timeStamper);
+        if (m_includeFlags & INCLUDE_LEVEL) m_sink->Printf("%s", StrLevel(WARNING));
+        if (m_includeFlags & INCLUDE_SEPARATOR) m_sink->Printf(": ");
+        m_sink->Printf("[%d log messages dropped]", dropped - m_droppedReported);
+        m_sink->Println();
+        m_droppedReported = dropped;
+      }
+    });
+  }
+
+  void * Logger::WriterRunner(void * arg)
+  {
+    Logger & log = *(Logger *) arg;
+
+    // Init error stack pointer (for this thread only)
+    MFMPtrToErrEnvStackPtr = &log.m_writerErrorStackTop;
+
+    pthread_mutex_lock(&log.m_writerLock);
+    while (!log.m_writerExiting)
+    {
+      struct timeval now;
+      gettimeofday(&now, NULL);
+      u64 usec = (u64) now.tv_usec + WRITER_WAIT_USEC;
+      struct timespec deadline;
+      deadline.tv_sec = now.tv_sec + (time_t) (usec / 1000000);
+      deadline.tv_nsec = (long) (usec % 1000000) * 1000;
+      pthread_cond_timedwait(&log.m_writerWake, &log.m_writerLock, &deadline);
+      pthread_mutex_unlock(&log.m_writerLock);
+
+      log.Flush();
+
+      pthread_mutex_lock(&log.m_writerLock);
+    }
+    pthread_mutex_unlock(&log.m_writerLock);
+    return 0;
+  }
 }
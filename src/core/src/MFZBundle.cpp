@@ -0,0 +1,476 @@
+#include "MFZBundle.h"
+#include "Inflate.h"
+#include "Fail.h"
+#include <stdio.h>      /* For fopen, fwrite, rename */
+#include <stdlib.h>     /* For getenv */
+#include <string.h>     /* For strcmp, memcmp, strerror */
+#include <errno.h>      /* For errno */
+#include <fcntl.h>      /* For open */
+#include <unistd.h>     /* For close, read, getpid, getuid, unlink */
+#include <sys/mman.h>   /* For mmap */
+#include <sys/stat.h>   /* For fstat, stat, mkdir */
+
+namespace MFM
+{
+  enum {
+    LOCAL_HEADER_SIG = 0x04034b50,
+    LOCAL_HEADER_BYTES = 30,
+    DIRECTORY_ENTRY_SIG = 0x02014b50,
+    DIRECTORY_ENTRY_BYTES = 46,
+    DIRECTORY_END_SIG = 0x06054b50,
+    DIRECTORY_END_BYTES = 22,
+    MAX_COMMENT_BYTES = 0xffff,
+    FLAG_ENCRYPTED = 0x0001,
+    METHOD_STORED = 0,
+    METHOD_DEFLATED = 8
+  };
+
+  static const char * MFZ_ZIP_NAME = "MFZ.ZIP";
+  static const char * MFZ_FILE_NAME = "MFZNAME.DAT";
+
+  /* Zips are little-endian throughout */
+  static inline u32 Get16(const u8 * at)
+  {
+    return at[0] | (at[1] << 8);
+  }
+
+  static inline u32 Get32(const u8 * at)
+  {
+    return at[0] | (at[1] << 8) | (at[2] << 16) | ((u32) at[3] << 24);
+  }
+
+  /* The length of the MFZ(version) line at the start of the bytes,
+     newline included, or 0 if there isn't one */
+  static u32 GetHeaderBytes(const u8 * bytes, u32 length)
+  {
+    if (length < 4 || memcmp(bytes, "MFZ(", 4))
+    {
+      return 0;
+    }
+    for (u32 i = 4; i < length && i < MFZBundle::MAX_HEADER_BYTES; ++i)
+    {
+      if (bytes[i] == '\n')
+      {
+        return i + 1;
+      }
+    }
+    return 0;
+  }
+
+  MFZBundle::MFZBundle()
+    : m_map(0)
+    , m_mapBytes(0)
+    , m_innerZip(0)
+    , m_memberCount(0)
+  { }
+
+  MFZBundle::~MFZBundle()
+  {
+    Close();
+  }
+
+  void MFZBundle::Close()
+  {
+    for (u32 i = 0; i < m_memberCount; ++i)
+    {
+      delete [] m_members[i].m_inflated;
+    }
+    m_memberCount = 0;
+    delete [] m_innerZip;
+    m_innerZip = 0;
+    if (m_map)
+    {
+      munmap(m_map, m_mapBytes);
+      m_map = 0;
+    }
+    m_mapBytes = 0;
+    m_path.Reset();
+    m_bundleName.Reset();
+  }
+
+  const char * MFZBundle::ReadDirectory(const u8 * zip, u32 zipBytes,
+                                        Member * members, u32 maxMembers, u32 & count)
+  {
+    if (zipBytes < DIRECTORY_END_BYTES)
+    {
+      return "Not a zip";
+    }
+
+    // The directory's end record is last, but for a comment
+    const u8 * end = 0;
+    const u32 lastStart = zipBytes - DIRECTORY_END_BYTES;
+    const u32 firstStart = lastStart > MAX_COMMENT_BYTES ? lastStart - MAX_COMMENT_BYTES : 0;
+    for (u32 at = lastStart + 1; at-- > firstStart; )
+    {
+      if (Get32(zip + at) == DIRECTORY_END_SIG)
+      {
+        end = zip + at;
+        break;
+      }
+    }
+    if (!end)
+    {
+      return "No zip directory";
+    }
+
+    const u32 entries = Get16(end + 10);
+    const u32 dirBytes = Get32(end + 12);
+    const u32 dirStart = Get32(end + 16);
+    if (dirStart > zipBytes || dirBytes > zipBytes - dirStart)
+    {
+      return "Damaged zip directory";
+    }
+
+    const u8 * entry = zip + dirStart;
+    const u8 * dirEnd = entry + dirBytes;
+    for (u32 e = 0; e < entries; ++e)
+    {
+      if (dirEnd - entry < DIRECTORY_ENTRY_BYTES || Get32(entry) != DIRECTORY_ENTRY_SIG)
+      {
+        return "Damaged zip directory";
+      }
+      const u32 flags = Get16(entry + 8);
+      const u32 method = Get16(entry + 10);
+      const u32 crc = Get32(entry + 16);
+      const u32 packedBytes = Get32(entry + 20);
+      const u32 rawBytes = Get32(entry + 24);
+      const u32 nameBytes = Get16(entry + 28);
+      const u32 extraBytes = Get16(entry + 30);
+      const u32 commentBytes = Get16(entry + 32);
+      const u32 localStart = Get32(entry + 42);
+      const u8 * name = entry + DIRECTORY_ENTRY_BYTES;
+      if ((u32) (dirEnd - name) < nameBytes + extraBytes + commentBytes)
+      {
+        return "Damaged zip directory";
+      }
+      entry = name + nameBytes + extraBytes + commentBytes;
+
+      if (nameBytes == 0 || name[nameBytes - 1] == '/')
+      {
+        continue;  // A directory
+      }
+      if (flags & FLAG_ENCRYPTED)
+      {
+        return "Encrypted zip member";
+      }
+      if (count >= maxMembers)
+      {
+        return "Too many zip members";
+      }
+
+      // The data follows the local header, whose extra field can differ
+      if (localStart > zipBytes || zipBytes - localStart < LOCAL_HEADER_BYTES ||
+          Get32(zip + localStart) != LOCAL_HEADER_SIG)
+      {
+        return "Damaged zip member";
+      }
+      const u8 * local = zip + localStart;
+      const u32 dataStart = localStart + LOCAL_HEADER_BYTES + Get16(local + 26) + Get16(local + 28);
+      if (dataStart > zipBytes || packedBytes > zipBytes - dataStart)
+      {
+        return "Damaged zip member";
+      }
+
+      Member & m = members[count];
+      m.m_name.Reset();
+      u32 skip = 0;
+      while (skip < nameBytes && name[skip] == '/')
+      {
+        ++skip;
+      }
+      m.m_name.WriteBytes(name + skip, nameBytes - skip);
+      if (m.m_name.HasOverflowed())
+      {
+        return "Zip member name too long";
+      }
+      const char * zname = m.m_name.GetZString();
+      const char * slash = strrchr(zname, '/');
+      m.m_baseName = slash ? (u32) (slash + 1 - zname) : 0;
+      m.m_method = method;
+      m.m_packedBytes = packedBytes;
+      m.m_rawBytes = rawBytes;
+      m.m_crc = crc;
+      m.m_packed = zip + dataStart;
+      m.m_inflated = 0;
+      m.m_checked = false;
+      ++count;
+    }
+    return 0;
+  }
+
+  const char * MFZBundle::Unpack(Member & member)
+  {
+    if (member.m_checked)
+    {
+      return 0;
+    }
+    if (member.m_method == METHOD_STORED)
+    {
+      if (member.m_packedBytes != member.m_rawBytes)
+      {
+        return "Damaged zip member";
+      }
+    }
+    else if (member.m_method == METHOD_DEFLATED)
+    {
+      u8 * raw = new u8[member.m_rawBytes ? member.m_rawBytes : 1];
+      if (!Inflate::Decompress(member.m_packed, member.m_packedBytes, raw, member.m_rawBytes))
+      {
+        delete [] raw;
+        return "Can't inflate zip member";
+      }
+      member.m_inflated = raw;
+    }
+    else
+    {
+      return "Unsupported zip compression method";
+    }
+
+    if (Inflate::CRC32(0, GetBytes(member), member.m_rawBytes) != member.m_crc)
+    {
+      delete [] member.m_inflated;
+      member.m_inflated = 0;
+      return "Zip member CRC mismatch";
+    }
+    member.m_checked = true;
+    return 0;
+  }
+
+  const char * MFZBundle::Open(const char * path)
+  {
+    MFM_API_ASSERT_NONNULL(path);
+    Close();
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+      return strerror(errno);
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+      const char * err = strerror(errno);
+      close(fd);
+      return err;
+    }
+    if (st.st_size <= 0 || (u64) st.st_size > 0xffffffffu)
+    {
+      close(fd);
+      return "Not a .mfz bundle";
+    }
+    void * map = mmap(0, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);  // The mapping keeps the file
+    if (map == MAP_FAILED)
+    {
+      return strerror(errno);
+    }
+    m_map = (u8 *) map;
+    m_mapBytes = (u32) st.st_size;
+    m_path.Printf("%s", path);
+
+    const u32 headerBytes = GetHeaderBytes(m_map, m_mapBytes);
+    if (headerBytes == 0)
+    {
+      Close();
+      return "Not a .mfz bundle";
+    }
+
+    // The outer zip holds just the signature and MFZ.ZIP
+    Member outer[4];
+    u32 outerCount = 0;
+    const char * err = ReadDirectory(m_map + headerBytes, m_mapBytes - headerBytes,
+                                     outer, 4, outerCount);
+    s32 inner = -1;
+    for (u32 i = 0; !err && i < outerCount; ++i)
+    {
+      if (!strcmp(outer[i].m_name.GetZString(), MFZ_ZIP_NAME))
+      {
+        inner = (s32) i;
+      }
+    }
+    if (!err && inner < 0)
+    {
+      err = "No MFZ.ZIP";
+    }
+    if (!err)
+    {
+      // A stored MFZ.ZIP is used in place, its members' CRCs checked
+      // as they're used, rather than all of it up front
+      if (outer[inner].m_method == METHOD_STORED)
+        outer[inner].m_rawBytes = outer[inner].m_packedBytes;
+      else
+        err = Unpack(outer[inner]);
+    }
+    if (!err)
+    {
+      m_innerZip = outer[inner].m_inflated;  // Ours now
+      err = ReadDirectory(GetBytes(outer[inner]), outer[inner].m_rawBytes,
+                          m_members, MAX_MEMBERS, m_memberCount);
+    }
+    if (err)
+    {
+      Close();
+      return err;
+    }
+
+    const s32 name = FindMember(MFZ_FILE_NAME);
+    const u8 * nameBytes = name >= 0 ? GetMemberData((u32) name) : 0;
+    if (nameBytes)
+    {
+      m_bundleName.WriteBytes(nameBytes, m_members[name].m_rawBytes);
+    }
+    return 0;
+  }
+
+  const char * MFZBundle::GetMemberName(u32 index) const
+  {
+    MFM_API_ASSERT_ARG(index < m_memberCount);
+    return m_members[index].m_name.GetZString();
+  }
+
+  const char * MFZBundle::GetMemberBaseName(u32 index) const
+  {
+    return GetMemberName(index) + m_members[index].m_baseName;
+  }
+
+  u32 MFZBundle::GetMemberBytes(u32 index) const
+  {
+    MFM_API_ASSERT_ARG(index < m_memberCount);
+    return m_members[index].m_rawBytes;
+  }
+
+  u32 MFZBundle::GetMemberCRC(u32 index) const
+  {
+    MFM_API_ASSERT_ARG(index < m_memberCount);
+    return m_members[index].m_crc;
+  }
+
+  s32 MFZBundle::FindMember(const char * name) const
+  {
+    MFM_API_ASSERT_NONNULL(name);
+    for (u32 i = 0; i < m_memberCount; ++i)
+    {
+      if (!strcmp(GetMemberName(i), name))
+      {
+        return (s32) i;
+      }
+    }
+    for (u32 i = 0; i < m_memberCount; ++i)
+    {
+      if (!strcmp(GetMemberBaseName(i), name))
+      {
+        return (s32) i;
+      }
+    }
+    return -1;
+  }
+
+  const u8 * MFZBundle::GetMemberData(u32 index)
+  {
+    MFM_API_ASSERT_ARG(index < m_memberCount);
+    Member & m = m_members[index];
+    return Unpack(m) ? 0 : GetBytes(m);
+  }
+
+  /* mkdir -p, more or less */
+  static bool MakeDirs(const char * dir)
+  {
+    OString512 partial;
+    for (const char * p = dir; ; ++p)
+    {
+      if ((*p == '/' || *p == 0) && partial.GetLength() > 0)
+      {
+        if (mkdir(partial.GetZString(), 0777) != 0 && errno != EEXIST)
+        {
+          return false;
+        }
+      }
+      if (*p == 0)
+      {
+        break;
+      }
+      partial.WriteByte((u8) *p);
+    }
+    return !partial.HasOverflowed();
+  }
+
+  const char * MFZBundle::ExtractMember(u32 index, const char * cacheDir, ByteSink & path)
+  {
+    MFM_API_ASSERT_ARG(index < m_memberCount);
+    MFM_API_ASSERT_NONNULL(cacheDir);
+    const Member & m = m_members[index];
+
+    OString512 cached;
+    cached.Printf("%s/%08x-%u-%s", cacheDir, m.m_crc, m.m_rawBytes, GetMemberBaseName(index));
+    if (cached.HasOverflowed())
+    {
+      return "Cache path too long";
+    }
+
+    struct stat st;
+    if (stat(cached.GetZString(), &st) != 0 || (u64) st.st_size != m.m_rawBytes)
+    {
+      const u8 * data = GetMemberData(index);
+      if (!data)
+      {
+        return Unpack(m_members[index]);
+      }
+      if (!MakeDirs(cacheDir))
+      {
+        return strerror(errno);
+      }
+
+      // Write beside it and rename, so a reader never sees half of it
+      OString512 temp;
+      temp.Printf("%s.%d.tmp", cached.GetZString(), (s32) getpid());
+      if (temp.HasOverflowed())
+      {
+        return "Cache path too long";
+      }
+      FILE * out = fopen(temp.GetZString(), "wb");
+      if (!out)
+      {
+        return strerror(errno);
+      }
+      bool ok = fwrite(data, 1, m.m_rawBytes, out) == m.m_rawBytes;
+      ok = !fclose(out) && ok;
+      if (!ok || rename(temp.GetZString(), cached.GetZString()) != 0)
+      {
+        const char * err = ok ? strerror(errno) : "Cache write failed";
+        unlink(temp.GetZString());
+        return err;
+      }
+    }
+
+    path.Printf("%s", cached.GetZString());
+    return 0;
+  }
+
+  void MFZBundle::GetDefaultCacheDir(ByteSink & dir)
+  {
+    const char * home = getenv("HOME");
+    if (home && *home)
+    {
+      dir.Printf("%s/.mfm/mfzcache", home);
+    }
+    else
+    {
+      const char * tmp = getenv("TMPDIR");
+      dir.Printf("%s/mfzcache-%d", tmp ? tmp : "/tmp", (s32) getuid());
+    }
+  }
+
+  bool MFZBundle::IsBundle(const char * path)
+  {
+    MFM_API_ASSERT_NONNULL(path);
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+      return false;
+    }
+    u8 header[MAX_HEADER_BYTES];
+    const ssize_t got = read(fd, header, sizeof(header));
+    close(fd);
+    return got > 0 && GetHeaderBytes(header, (u32) got) > 0;
+  }
+}
@@ -0,0 +1,67 @@
+#include "MemoryAccount.h"
+#include "Fail.h"
+
+namespace MFM
+{
+  const char * MemoryAccount::GetSubsystemName(u32 subsystem)
+  {
+    switch (subsystem)
+    {
+    case SITES:            return "Sites";
+    case EVENT_HISTORY:    return "Event history";
+    case CACHE_PROCESSORS: return "Cache processors";
+    case TRANSCEIVERS:     return "Transceivers";
+    case ELEMENTS:         return "Element tables";
+    case TILE_INDEXES:     return "Tile indexes";
+    case TILES:            return "Tiles";
+    case SURFACES:         return "Surfaces";
+    case OTHER:            return "Other";
+    default: FAIL(ILLEGAL_ARGUMENT);
+    }
+  }
+
+  void MemoryAccount::Reset()
+  {
+    for (u32 s = 0; s < SUBSYSTEM_COUNT; ++s)
+    {
+      m_bytes[s] = 0;
+    }
+  }
+
+  void MemoryAccount::Add(const MemoryAccount & other)
+  {
+    for (u32 s = 0; s < SUBSYSTEM_COUNT; ++s)
+    {
+      m_bytes[s] += other.m_bytes[s];
+    }
+  }
+
+  u64 MemoryAccount::GetBytes(u32 subsystem) const
+  {
+    MFM_API_ASSERT_ARG(subsystem < SUBSYSTEM_COUNT);
+    return m_bytes[subsystem];
+  }
+
+  u64 MemoryAccount::GetTotalBytes() const
+  {
+    u64 total = 0;
+    for (u32 s = 0; s < SUBSYSTEM_COUNT; ++s)
+    {
+      total += m_bytes[s];
+    }
+    return total;
+  }
+
+  void MemoryAccount::ReportMemory(Logger::Level level, const char * label) const
+  {
+    for (u32 s = 0; s < SUBSYSTEM_COUNT; ++s)
+    {
+      if (m_bytes[s] == 0)
+      {
+        continue;
+      }
+      LOG.Log(level, "%s%s: %uK", label, GetSubsystemName(s), (u32) ((m_bytes[s] + 1023) / 1024));
+    }
+    LOG.Log(level, "%sTotal: %uK", label, (u32) ((GetTotalBytes() + 1023) / 1024));
+  }
+} /* namespace MFM */
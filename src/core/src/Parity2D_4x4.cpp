@@ -38,6 +38,25 @@ namespace MFM {
 
     return res >> DATA_BITS;
   }
+
+  u32 Parity2D_4x4::Count2DParityErrors(const u32 * allBits, u32 count) {
+    u32 errors = 0;
+    for (u32 i = 0; i < count; ++i)
+      errors += !Check2DParity(allBits[i]);
+    return errors;
+  }
+
+  u32 Parity2D_4x4::CheckAndCorrect2DParityBatch(u32 * allBits, u32 count) {
+    u32 uncorrected = 0;
+    if (Count2DParityErrors(allBits, count) == 0) return 0; // Usual case
+    for (u32 i = 0; i < count; ++i) {
+      if (Check2DParity(allBits[i])) continue;
+      const u32 corrected = Correct2DParityIfPossible(allBits[i]);
+      if (corrected == 0) ++uncorrected;
+      else allBits[i] = corrected;
+    }
+    return uncorrected;
+  }
 }
 
 #ifndef WRITE_PARITY_TABLES
@@ -0,0 +1 @@
+#include "SPSCQueue.h"
@@ -0,0 +1,36 @@
+#include "TileParameters.h"
+#include "Fail.h"
+
+namespace MFM
+{
+  TileParameterPublisher::TileParameterPublisher()
+    : m_current(new TileParameterBlock)
+  {
+    for (u32 i = 0; i < TileParameterBlock::MAX_PARAMETERS; ++i)
+      m_current->m_values[i] = S32_MIN;
+    m_current->m_generation = 1;  // Tiles start having seen 0
+    m_current->m_retired = 0;
+  }
+
+  TileParameterPublisher::~TileParameterPublisher()
+  {
+    while (m_current)
+    {
+      TileParameterBlock * retired = m_current->m_retired;
+      delete m_current;
+      m_current = retired;
+    }
+  }
+
+  void TileParameterPublisher::Set(u32 key, s32 value)
+  {
+    MFM_API_ASSERT_ARG(key < TileParameterBlock::MAX_PARAMETERS);
+
+    Mutex::ScopeLock lock(m_writeLock);
+    TileParameterBlock * next = new TileParameterBlock(*m_current);
+    next->m_values[key] = value;
+    next->m_generation = m_current->m_generation + 1;
+    next->m_retired = m_current;
+    __atomic_store_n(&m_current, next, __ATOMIC_RELEASE);
+  }
+}
@@ -0,0 +1,118 @@
+#include "TileSiteOwners.h"
+#include "Fail.h"
+#include "Util.h"  /* For MIN, MAX */
+
+namespace MFM
+{
+  TileSiteOwners::TileSiteOwners(u32 width, u32 height)
+    : m_width(width)
+    , m_height(height)
+    , m_rowWords((width + 63) / 64)
+    , m_rows(new u64[m_rowWords * height])
+  {
+    MFM_API_ASSERT_ARG(width > 0 && height > 0);
+    for (u32 i = 0; i < m_rowWords * m_height; ++i)
+    {
+      m_rows[i] = 0;
+    }
+  }
+
+  TileSiteOwners::~TileSiteOwners()
+  {
+    delete [] m_rows;
+  }
+
+  bool TileSiteOwners::IsOwned(const SPoint & site) const
+  {
+    const UPoint us = MakeUnsigned(site);
+    MFM_API_ASSERT_ARG(us.GetX() < m_width && us.GetY() < m_height);
+    return (m_rows[us.GetY() * m_rowWords + us.GetX() / 64] >> (us.GetX() % 64)) & 1;
+  }
+
+  template <class VISITOR>
+  bool TileSiteOwners::VisitFootprint(const SPoint & center, u32 radius, VISITOR & visit)
+  {
+    const s32 r = (s32) radius;
+    for (s32 dy = -r; dy <= r; ++dy)
+    {
+      const s32 y = center.GetY() + dy;
+      if (y < 0 || y >= (s32) m_height)
+      {
+        continue;
+      }
+      const s32 half = r - (dy < 0 ? -dy : dy);
+      const s32 lo = MAX(center.GetX() - half, 0);
+      const s32 hi = MIN(center.GetX() + half, (s32) m_width - 1);
+      u64 * row = &m_rows[y * m_rowWords];
+      for (s32 x = lo; x <= hi; x = (x | 63) + 1)
+      {
+        const u32 first = x % 64;
+        const u32 last = MIN(hi - (x - (s32) first), 63);
+        const u64 mask = (last == 63 ? ~((u64) 0) : ((((u64) 1) << (last + 1)) - 1))
+          & ~((((u64) 1) << first) - 1);
+        if (!visit(row[x / 64], mask))
+        {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
+  namespace
+  {
+    struct IsFree
+    {
+      bool operator()(u64 & word, u64 mask) { return (word & mask) == 0; }
+    };
+
+    struct Hold
+    {
+      bool operator()(u64 & word, u64 mask) { word |= mask; return true; }
+    };
+
+    struct LetGo
+    {
+      bool operator()(u64 & word, u64 mask)
+      {
+        if ((word & mask) != mask) return false;
+        word &= ~mask;
+        return true;
+      }
+    };
+  }
+
+  bool TileSiteOwners::TryClaim(const SPoint & center, u32 radius)
+  {
+    Mutex::ScopeLock lock(m_lock);
+    IsFree isFree;
+    if (!VisitFootprint(center, radius, isFree))
+    {
+      return false;
+    }
+    Hold hold;
+    VisitFootprint(center, radius, hold);
+    return true;
+  }
+
+  void TileSiteOwners::Release(const SPoint & center, u32 radius)
+  {
+    bool held;
+    {
+      Mutex::ScopeLock lock(m_lock);
+      LetGo letGo;
+      held = VisitFootprint(center, radius, letGo);
+    }
+    MFM_API_ASSERT_STATE(held);
+  }
+
+  u32 TileSiteOwners::GetOwnedCount() const
+  {
+    u32 count = 0;
+    for (u32 i = 0; i < m_rowWords * m_height; ++i)
+    {
+      count += __builtin_popcountll(m_rows[i]); // GCC
+    }
+    return count;
+  }
+}
@@ -1,11 +1,13 @@
 #include "UUID.h"
 #include "Fail.h"
 #include "CharBufferByteSink.h"
+#include "Mutex.h"
 #include <string.h>    /* For strcmp, strncpy */
 
 namespace MFM {
 
   UUID::UUID(ByteSource & bs)
+    : m_handle(0)
   {
     MFM_API_ASSERT(ReadFrom(bs), ILLEGAL_INPUT);
   }
@@ -91,10 +93,23 @@ namespace MFM {
     m_configurationCode = configurationCode;
     m_hexDate = hexdate;
     m_hexTime = hextime;
+    m_handle = 0;
     return true;
   }
 
   bool UUID::operator==(const UUID & other) const
+  {
+    const u32 handle = __atomic_load_n(&m_handle, __ATOMIC_RELAXED);
+    if (handle != 0)
+    {
+      const u32 otherHandle = __atomic_load_n(&other.m_handle, __ATOMIC_RELAXED);
+      if (otherHandle != 0)
+        return handle == otherHandle;
+    }
+    return EqualFields(other);
+  }
+
+  bool UUID::EqualFields(const UUID & other) const
   {
     return
       m_uuidVersion == other.m_uuidVersion &&
@@ -104,4 +119,94 @@ namespace MFM {
       strcmp(GetLabel(),other.GetLabel())==0;
   }
 
+  u32 UUID::HashFields() const
+  {
+    // FNV-1a over the fields EqualFields compares
+    u32 hash = 2166136261u;
+    for (const char * p = GetLabel(); *p; ++p)
+      hash = (hash ^ (u8) *p) * 16777619u;
+    const u32 words[4] = { m_uuidVersion, m_elementVersion, m_hexDate, m_hexTime };
+    for (u32 i = 0; i < 4; ++i)
+      hash = (hash ^ words[i]) * 16777619u;
+    return hash;
+  }
+
+  /**
+     The global table of interned UUIDs: copies of each distinct UUID
+     in handle order (handle 1 is m_uuids[0]), and an open-addressed
+     index into them by HashFields.  It only grows.
+   */
+  struct UUIDInternTable
+  {
+    Mutex m_lock;
+    UUID * m_uuids;
+    u32 m_count;
+    u32 m_capacity;
+    u32 * m_index;      // Handles, 0 for empty; 2*m_capacity slots
+    u32 m_indexMask;
+
+    UUIDInternTable()
+      : m_uuids(0)
+      , m_count(0)
+      , m_capacity(0)
+      , m_index(0)
+      , m_indexMask(0)
+    { }
+
+    void Grow()
+    {
+      const u32 capacity = m_capacity ? 2 * m_capacity : 256;
+      UUID * uuids = new UUID[capacity];
+      for (u32 i = 0; i < m_count; ++i)
+        uuids[i] = m_uuids[i];
+      delete [] m_uuids;
+      m_uuids = uuids;
+      m_capacity = capacity;
+
+      delete [] m_index;
+      m_index = new u32[2 * capacity];
+      m_indexMask = 2 * capacity - 1;
+      for (u32 i = 0; i <= m_indexMask; ++i)
+        m_index[i] = 0;
+      for (u32 i = 0; i < m_count; ++i)
+        Insert(i + 1);
+    }
+
+    void Insert(u32 handle)
+    {
+      u32 slot = m_uuids[handle - 1].HashFields() & m_indexMask;
+      while (m_index[slot]) slot = (slot + 1) & m_indexMask;
+      m_index[slot] = handle;
+    }
+  };
+
+  u32 UUID::Intern() const
+  {
+    static UUIDInternTable table;
+    Mutex::ScopeLock lock(table.m_lock);
+
+    if (table.m_capacity > 0)
+    {
+      for (u32 slot = HashFields() & table.m_indexMask;
+           table.m_index[slot];
+           slot = (slot + 1) & table.m_indexMask)
+      {
+        const u32 handle = table.m_index[slot];
+        if (EqualFields(table.m_uuids[handle - 1]))
+        {
+          __atomic_store_n(&m_handle, handle, __ATOMIC_RELAXED);
+          return handle;
+        }
+      }
+    }
+
+    if (table.m_count == table.m_capacity)
+      table.Grow();
+    const u32 handle = ++table.m_count;
+    table.m_uuids[handle - 1] = *this;
+    table.m_uuids[handle - 1].m_handle = handle;
+    table.Insert(handle);
+    __atomic_store_n(&m_handle, handle, __ATOMIC_RELAXED);
+    return handle;
+  }
 }
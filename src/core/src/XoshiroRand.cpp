@@ -0,0 +1,66 @@
+#include "XoshiroRand.h"
+
+namespace MFM {
+
+  // -ansi has no 64 bit literals; build them as U64_MAX does
+#define XO_U64(hi,lo) ((((u64)(hi))<<32)|(lo))
+
+  // splitmix64, the seeding generator recommended for xoshiro
+  static u64 SplitMix64(u64 & x)
+  {
+    u64 z = (x += XO_U64(0x9e3779b9,0x7f4a7c15));
+    z = (z ^ (z >> 30)) * XO_U64(0xbf58476d,0x1ce4e5b9);
+    z = (z ^ (z >> 27)) * XO_U64(0x94d049bb,0x133111eb);
+    return z ^ (z >> 31);
+  }
+
+  void XoshiroRand::Seed(u32 seed)
+  {
+    u64 x = seed;
+    for (u32 lane = 0; lane < LANES; ++lane)
+    {
+      for (u32 w = 0; w < 4; w += 2)
+      {
+        u64 z = SplitMix64(x);
+        m_state[w][lane] = (u32) (z >> 32);
+        m_state[w + 1][lane] = (u32) z;
+      }
+    }
+    for (u32 lane = 0; lane < LANES; ++lane)
+    {
+      // An all-zero state is the one fixed point of xoshiro
+      if ((m_state[0][lane] | m_state[1][lane] |
+           m_state[2][lane] | m_state[3][lane]) == 0)
+      {
+        m_state[0][lane] = 1;
+      }
+    }
+    m_next = BATCH_SIZE;
+  }
+
+  void XoshiroRand::Refill()
+  {
+    u32 (&s)[4][LANES] = m_state;
+    for (u32 step = 0; step < STEPS_PER_REFILL; ++step)
+    {
+      u32 * out = &m_batch[step * LANES];
+      u32 t[LANES];
+      for (u32 i = 0; i < LANES; ++i)
+      {
+        out[i] = Rotl(s[1][i] * 5, 7) * 9;
+        t[i] = s[1][i] << 9;
+      }
+      for (u32 i = 0; i < LANES; ++i)
+      {
+        s[2][i] ^= s[0][i];
+        s[3][i] ^= s[1][i];
+        s[1][i] ^= s[2][i];
+        s[0][i] ^= s[3][i];
+        s[2][i] ^= t[i];
+        s[3][i] = Rotl(s[3][i], 11);
+      }
+    }
+    m_next = 0;
+  }
+
+} /* namespace MFM */
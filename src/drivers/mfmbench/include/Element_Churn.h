@@ -0,0 +1,71 @@
+/*                                              -*- mode:C++ -*- */
+/**
+  \file Element_Churn.h Boundary-stressing element for mfmbench
+ */
+#ifndef ELEMENT_CHURN_H
+#define ELEMENT_CHURN_H
+
+#include "Element.h"
+#include "EventWindow.h"
+#include "itype.h"
+
+namespace MFM
+{
+
+  /**
+   * A synthetic element that does nothing but write: every event it
+   * swaps itself with a uniformly chosen site anywhere in its full
+   * event window, occupied or not.  Packed along tile edges it keeps
+   * every event there locking neighbors and shipping cache updates,
+   * which is what mfmbench's boundary workload wants to measure.
+   */
+  template <class EC>
+  class Element_Churn : public Element<EC>
+  {
+  public:
+    virtual u32 GetTypeFromThisElement() const
+    {
+      return 0xCE21;
+    }
+
+    enum { CHURN_VERSION = 1 };
+
+    // Extract short names for parameter types
+    typedef typename EC::ATOM_CONFIG AC;
+    typedef typename AC::ATOM_TYPE T;
+
+    static Element_Churn THE_INSTANCE;
+
+    Element_Churn() : Element<EC>(MFM_UUID_FOR("Churn", CHURN_VERSION))
+    {
+      Element<EC>::SetAtomicSymbol("Ch");
+      Element<EC>::SetName("Churn");
+    }
+
+    virtual u32 GetElementColor() const
+    {
+      return 0xff3080c0;
+    }
+
+    virtual const char* GetDescription() const
+    {
+      return "Swaps itself with a random site in its whole event window, every event.";
+    }
+
+    virtual void Behavior(EventWindow<EC>& window) const
+    {
+      const u32 sites = window.GetBoundedSiteCount();
+      const u32 site = 1 + window.GetRandom().Create(sites - 1);
+      if (window.IsLiveSiteDirect(site))
+      {
+        window.SwapAtomsDirect(0, site);
+      }
+    }
+  };
+
+  template <class EC>
+  Element_Churn<EC> Element_Churn<EC>::THE_INSTANCE;
+
+}
+
+#endif /* ELEMENT_CHURN_H */
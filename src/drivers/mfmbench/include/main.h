@@ -0,0 +1,38 @@
+#ifndef MAIN_H
+#define MAIN_H
+
+#include <stdio.h>
+#include <unistd.h>   /* for sysconf */
+#include <sys/time.h> /* for gettimeofday */
+#include "itype.h"
+#include "Util.h"
+#include "Logger.h"
+#include "FileByteSink.h"
+#include "OverflowableCharBufferByteSink.h"
+#include "VArguments.h"
+#include "Utils.h"
+#include "P3Atom.h"
+#include "Site.h"
+#include "EventConfig.h"
+#include "GridConfig.h"
+#include "Grid.h"
+#include "ElementRegistry.h"
+#include "Element_Dreg.h"
+#include "Element_Res.h"
+#include "Element_ForkBomb1.h"
+#include "Element_City_Building.h"
+#include "Element_City_Car.h"
+#include "Element_City_Intersection.h"
+#include "Element_City_Park.h"
+#include "Element_City_Sidewalk.h"
+#include "Element_City_Street.h"
+#include "Element_Churn.h"
+#include "Element_Xtal_Sq1.h"
+#include "Element_Xtal_L12.h"
+#include "Element_Sorter.h"
+#include "Element_Data.h"
+#include "Element_Emitter.h"
+#include "Element_Consumer.h"
+#include "SortingWork.h"
+
+#endif  /* MAIN_H */
@@ -0,0 +1,814 @@
+#include "main.h"
+
+namespace MFM
+{
+  typedef EventConfig<Site<P3AtomConfig>,4> OurEventConfig;
+  typedef GridConfig<OurEventConfig, 40, 40, 1000> OurGridConfig;
+  typedef Grid<OurGridConfig> OurGrid;
+  typedef OurEventConfig::ATOM_CONFIG::ATOM_TYPE OurAtom;
+
+  /**
+     MFMBench runs a fixed matrix of canned workloads, grid sizes, and
+     thread counts headless, from a fixed seed, and reports the
+     throughput and inter-tile traffic of each combination as CSV
+     and/or JSON, so that changes to the event loop, cache protocol,
+     or tile scheduling can be compared run against run.
+
+     The boundary workload is the cache protocol's stress test: it
+     packs every tile's edges with Churn, which writes somewhere in
+     its window every event, so nearly every event locks a neighbor
+     and ships an update.  Run it across thread counts, and watch
+     lock_failures and check_failed -- cache checks that found a
+     neighbor's copy wrong -- along with throughput and bytes.
+
+     The sorting workload runs the Demon Horde Sort (see SortingWork),
+     and so does useful work that AEPS alone can't see: alongside
+     the usual columns, every workload reports the datums Sorters
+     passed along and Consumers took out, per second, and the mean
+     number of buckets off that consumed datums landed -- all zero
+     for workloads with nothing to sort.
+   */
+  class MFMBench
+  {
+  public:
+
+    enum
+    {
+      MAX_SIZES = 16,
+      MAX_THREADS = 16,
+      MAX_WORKLOADS = 8,
+      MAX_RESULTS = MAX_WORKLOADS * MAX_SIZES * MAX_THREADS
+    };
+
+    MFMBench()
+      : m_seed(1)
+      , m_runMS(1000)
+      , m_sizeCount(0)
+      , m_threadCount(0)
+      , m_workloadMask(0)
+      , m_libraryPath(0)
+      , m_csvPath(0)
+      , m_jsonPath(0)
+      , m_numaPlacement(false)
+      , m_hugePages(false)
+      , m_resultCount(0)
+    { }
+
+    void Init(int argc, const char** argv)
+    {
+      m_varguments.RegisterArgumentSection("Benchmark");
+      m_varguments.RegisterArgument("Set master PRNG seed to ARG (u32, default 1)",
+                                    "--seed", &SetSeedFromArgs, this, true);
+      m_varguments.RegisterArgument("Run each combination for ARG milliseconds (default 1000)",
+                                    "--ms", &SetRunMSFromArgs, this, true);
+      m_varguments.RegisterArgument("Run on grids of comma-separated WxH tiles ARG (default 1x1,2x2,4x3)",
+                                    "--sizes", &SetSizesFromArgs, this, true);
+      m_varguments.RegisterArgument("Run with comma-separated thread counts ARG; 0 means a thread per tile "
+                                    "(default 0,1,2,4)",
+                                    "--threads", &SetThreadsFromArgs, this, true);
+      m_varguments.RegisterArgument("Run comma-separated workloads ARG from empty,dregres,forkbomb,city,boundary,xtal,ulam,sorting "
+                                    "(default all)",
+                                    "--workloads", &SetWorkloadsFromArgs, this, true);
+      m_varguments.RegisterArgument("Load ulam element library ARG for the ulam workload",
+                                    "--library", &SetLibraryFromArgs, this, true);
+      m_varguments.RegisterArgument("Write CSV results to file ARG (default stdout)",
+                                    "--csv", &SetCSVPathFromArgs, this, true);
+      m_varguments.RegisterArgument("Write JSON results to file ARG",
+                                    "--json", &SetJSONPathFromArgs, this, true);
+      m_varguments.RegisterArgument("Pin tile threads to cpus and keep tile memory on their NUMA nodes",
+                                    "--numa", &SetNUMAPlacementFromArgs, this, false);
+      m_varguments.RegisterArgument("Back tile sites with 2MB huge pages",
+                                    "--hugepages", &SetHugePagesFromArgs, this, false);
+
+      m_varguments.ProcessArguments(argc, argv);
+
+      if (m_sizeCount == 0)
+      {
+        SetSizesFromArgs("1x1,2x2,4x3", this);
+      }
+      if (m_threadCount == 0)
+      {
+        SetThreadsFromArgs("0,1,2,4", this);
+      }
+      if (m_workloadMask == 0)
+      {
+        SetWorkloadsFromArgs("empty,dregres,forkbomb,city,boundary,xtal,ulam,sorting", this);
+      }
+    }
+
+    void Run()
+    {
+      for (u32 w = 0; w < WORKLOAD_COUNT; ++w)
+      {
+        if (!(m_workloadMask & (1 << w)))
+        {
+          continue;
+        }
+        if (w == WORKLOAD_ULAM && !m_libraryPath)
+        {
+          LOG.Warning("Skipping ulam workload: no --library given");
+          continue;
+        }
+        for (u32 s = 0; s < m_sizeCount; ++s)
+        {
+          for (u32 t = 0; t < m_threadCount; ++t)
+          {
+            RunOne((Workload) w, m_widths[s], m_heights[s], m_threads[t]);
+          }
+        }
+      }
+
+      if (m_csvPath)
+      {
+        FILE * file = fopen(m_csvPath, "w");
+        if (!file)
+        {
+          m_varguments.Die("Can't write CSV file '%s'", m_csvPath);
+        }
+        FileByteSink fbs(file);
+        WriteCSV(fbs);
+        fbs.Close();
+      }
+      else
+      {
+        WriteCSV(STDOUT);
+      }
+
+      if (m_jsonPath)
+      {
+        FILE * file = fopen(m_jsonPath, "w");
+        if (!file)
+        {
+          m_varguments.Die("Can't write JSON file '%s'", m_jsonPath);
+        }
+        FileByteSink fbs(file);
+        WriteJSON(fbs);
+        fbs.Close();
+      }
+    }
+
+  private:
+
+    enum Workload
+    {
+      WORKLOAD_EMPTY,
+      WORKLOAD_DREGRES,
+      WORKLOAD_FORKBOMB,
+      WORKLOAD_CITY,
+      WORKLOAD_BOUNDARY,
+      WORKLOAD_XTAL,
+      WORKLOAD_ULAM,
+      WORKLOAD_SORTING,
+      WORKLOAD_COUNT
+    };
+
+    static const char * GetWorkloadName(u32 workload)
+    {
+      switch (workload)
+      {
+      case WORKLOAD_EMPTY:    return "empty";
+      case WORKLOAD_DREGRES:  return "dregres";
+      case WORKLOAD_FORKBOMB: return "forkbomb";
+      case WORKLOAD_CITY:     return "city";
+      case WORKLOAD_BOUNDARY: return "boundary";
+      case WORKLOAD_XTAL:     return "xtal";
+      case WORKLOAD_ULAM:     return "ulam";
+      case WORKLOAD_SORTING:  return "sorting";
+      default: FAIL(ILLEGAL_ARGUMENT);
+      }
+    }
+
+    struct Result
+    {
+      u32 m_workload;
+      u32 m_width;
+      u32 m_height;
+      u32 m_threads;
+      u32 m_cores;
+      u32 m_elapsedMS;
+      u32 m_sites;
+      u64 m_events;
+      u64 m_skippedEvents;
+      u64 m_cachePackets;
+      u64 m_cacheBytes;
+      u64 m_lockAttempts;
+      u64 m_lockContended;
+      u64 m_lockFailures;
+      u64 m_checkClean;
+      u64 m_checkFailed;
+      u64 m_sorted;
+      u64 m_consumed;
+      double m_sortError;
+#ifdef MFM_EVENT_PHASE_TIMING
+      EventPhaseTimer m_phaseTimes;
+#endif
+
+      double GetAEPS() const
+      {
+        return ((double) m_events) / m_sites;
+      }
+
+      double GetAEPSPerSec() const
+      {
+        return m_elapsedMS ? GetAEPS() * 1000.0 / m_elapsedMS : 0.0;
+      }
+
+      double GetEventsPerSecPerCore() const
+      {
+        return m_elapsedMS ? ((double) m_events) * 1000.0 / m_elapsedMS / m_cores : 0.0;
+      }
+
+      double GetCacheBytesPerEvent() const
+      {
+        return m_events ? ((double) m_cacheBytes) / m_events : 0.0;
+      }
+
+      double GetLockContentionRate() const
+      {
+        return m_lockAttempts ? ((double) m_lockContended) / m_lockAttempts : 0.0;
+      }
+
+      double GetCheckFailureRate() const
+      {
+        const u64 checks = m_checkClean + m_checkFailed;
+        return checks ? ((double) m_checkFailed) / checks : 0.0;
+      }
+
+      double GetSortedPerSec() const
+      {
+        return m_elapsedMS ? ((double) m_sorted) * 1000.0 / m_elapsedMS : 0.0;
+      }
+
+      double GetConsumedPerSec() const
+      {
+        return m_elapsedMS ? ((double) m_consumed) * 1000.0 / m_elapsedMS : 0.0;
+      }
+    };
+
+    VArguments m_varguments;
+    u32 m_seed;
+    u32 m_runMS;
+    u32 m_widths[MAX_SIZES];
+    u32 m_heights[MAX_SIZES];
+    u32 m_sizeCount;
+    u32 m_threads[MAX_THREADS];
+    u32 m_threadCount;
+    u32 m_workloadMask;
+    const char * m_libraryPath;
+    const char * m_csvPath;
+    const char * m_jsonPath;
+    bool m_numaPlacement;
+    bool m_hugePages;
+    Result m_results[MAX_RESULTS];
+    u32 m_resultCount;
+
+    static u64 GetTicksSinceEpoch()
+    {
+      struct timeval tv;
+      gettimeofday(&tv, NULL);
+
+      /* cast since what's a time_t */
+      return ((u64) tv.tv_sec) * 1000 + tv.tv_usec / 1000;
+    }
+
+    /* Is \a siteInGrid within two event window radii -- close enough
+       that its events lock a neighbor -- of its tile's owned edge? */
+    static bool IsNearTileEdge(const OurGrid & grid, const SPoint & siteInGrid)
+    {
+      SPoint tileInGrid, siteInTile;
+      if (!grid.MapGridToUncachedTile(siteInGrid, tileInGrid, siteInTile))
+      {
+        return false;
+      }
+      const s32 band = 2 * OurEventConfig::EVENT_WINDOW_RADIUS;
+      const s32 x = siteInTile.GetX();
+      const s32 y = siteInTile.GetY();
+      return x < band || x >= (s32) OurGrid::OWNED_WIDTH - band
+        || y < band || y >= (s32) OurGrid::OWNED_HEIGHT - band;
+    }
+
+    static void Populate(OurGrid & grid, Workload workload)
+    {
+      const u32 w = grid.GetWidthSites();
+      const u32 h = grid.GetHeightSites();
+
+      switch (workload)
+      {
+      case WORKLOAD_EMPTY:
+        break;
+
+      case WORKLOAD_DREGRES:
+      {
+        Element<OurEventConfig> & dreg = Element_Dreg<OurEventConfig>::THE_INSTANCE;
+        Element<OurEventConfig> & res = Element_Res<OurEventConfig>::THE_INSTANCE;
+        grid.Needed(dreg);
+        grid.Needed(res);
+        for (u32 y = 0; y < h; ++y)
+        {
+          for (u32 x = 0; x < w; ++x)
+          {
+            if ((x % 2) == 0 && (y % 2) == 0)
+            {
+              OurAtom atom(((x + y) % 8) ? res.GetDefaultAtom() : dreg.GetDefaultAtom());
+              grid.PlaceAtom(atom, SPoint(x, y));
+            }
+          }
+        }
+        break;
+      }
+
+      case WORKLOAD_FORKBOMB:
+      {
+        Element<OurEventConfig> & fb = Element_ForkBomb1<OurEventConfig>::THE_INSTANCE;
+        grid.Needed(fb);
+        OurAtom atom(fb.GetDefaultAtom());
+        grid.PlaceAtom(atom, SPoint(w / 2, h / 2));
+        break;
+      }
+
+      case WORKLOAD_CITY:
+      {
+        grid.Needed(Element_City_Building<OurEventConfig>::THE_INSTANCE);
+        grid.Needed(Element_City_Car<OurEventConfig>::THE_INSTANCE);
+        grid.Needed(Element_City_Park<OurEventConfig>::THE_INSTANCE);
+        grid.Needed(Element_City_Sidewalk<OurEventConfig>::THE_INSTANCE);
+        grid.Needed(Element_City_Street<OurEventConfig>::THE_INSTANCE);
+        Element<OurEventConfig> & inter = Element_City_Intersection<OurEventConfig>::THE_INSTANCE;
+        grid.Needed(inter);
+
+        /* One intersection per tile; the city grows out from there */
+        for (u32 y = OurGrid::OWNED_HEIGHT / 2; y < h; y += OurGrid::OWNED_HEIGHT)
+        {
+          for (u32 x = OurGrid::OWNED_WIDTH / 2; x < w; x += OurGrid::OWNED_WIDTH)
+          {
+            OurAtom atom(inter.GetDefaultAtom());
+            grid.PlaceAtom(atom, SPoint(x, y));
+          }
+        }
+        break;
+      }
+
+      case WORKLOAD_BOUNDARY:
+      {
+        Element<OurEventConfig> & churn = Element_Churn<OurEventConfig>::THE_INSTANCE;
+        grid.Needed(churn);
+
+        /* Half-fill the edge bands so every swap has room to land */
+        for (u32 y = 0; y < h; ++y)
+        {
+          for (u32 x = 0; x < w; ++x)
+          {
+            const SPoint site(x, y);
+            if (((x + y) % 2) == 0 && IsNearTileEdge(grid, site))
+            {
+              OurAtom atom(churn.GetDefaultAtom());
+              grid.PlaceAtom(atom, site);
+            }
+          }
+        }
+        break;
+      }
+
+      case WORKLOAD_XTAL:
+      {
+        Element<OurEventConfig> & res = Element_Res<OurEventConfig>::THE_INSTANCE;
+        Element<OurEventConfig> & sq1 = Element_Xtal_Sq1<OurEventConfig>::THE_INSTANCE;
+        Element<OurEventConfig> & l12 = Element_Xtal_L12<OurEventConfig>::THE_INSTANCE;
+        grid.Needed(res);
+        grid.Needed(sq1);
+        grid.Needed(l12);
+
+        /* Res everywhere to grow from, and a seed of each kind per tile */
+        for (u32 y = 0; y < h; ++y)
+        {
+          for (u32 x = 0; x < w; ++x)
+          {
+            if (((x + y) % 3) == 0)
+            {
+              OurAtom atom(res.GetDefaultAtom());
+              grid.PlaceAtom(atom, SPoint(x, y));
+            }
+          }
+        }
+        for (u32 y = OurGrid::OWNED_HEIGHT / 2; y < h; y += OurGrid::OWNED_HEIGHT)
+        {
+          for (u32 x = OurGrid::OWNED_WIDTH / 4; x + 1 < w; x += OurGrid::OWNED_WIDTH / 2)
+          {
+            OurAtom atom(((x / (OurGrid::OWNED_WIDTH / 2)) % 2) ? l12.GetDefaultAtom() : sq1.GetDefaultAtom());
+            grid.PlaceAtom(atom, SPoint(x, y));
+          }
+        }
+        break;
+      }
+
+      case WORKLOAD_ULAM:
+      {
+        ElementRegistry<OurEventConfig> & er = grid.GetElementRegistry();
+        const u32 before = er.GetRegisteredElementCount();
+        er.Init(grid.GetUlamClassRegistry());
+        const u32 after = er.GetRegisteredElementCount();
+        if (after == before)
+        {
+          LOG.Warning("No elements loaded for the ulam workload");
+          break;
+        }
+
+        for (u32 i = before; i < after; ++i)
+        {
+          grid.Needed(*er.GetRegisteredElement(i));
+        }
+
+        /* Scatter the library's elements over every eighth site */
+        u32 next = before;
+        for (u32 y = 0; y < h; y += 4)
+        {
+          for (u32 x = 0; x < w; x += 2)
+          {
+            if (((x + y) % 8) == 0)
+            {
+              OurAtom atom(er.GetRegisteredElement(next)->GetDefaultAtom());
+              grid.PlaceAtom(atom, SPoint(x, y));
+              if (++next >= after)
+              {
+                next = before;
+              }
+            }
+          }
+        }
+        break;
+      }
+
+      case WORKLOAD_SORTING:
+      {
+        grid.Needed(Element_Dreg<OurEventConfig>::THE_INSTANCE);
+        grid.Needed(Element_Res<OurEventConfig>::THE_INSTANCE);
+        grid.Needed(Element_Sorter<OurEventConfig>::THE_INSTANCE);
+        grid.Needed(Element_Data<OurEventConfig>::THE_INSTANCE);
+        grid.Needed(Element_Emitter<OurEventConfig>::THE_INSTANCE);
+        grid.Needed(Element_Consumer<OurEventConfig>::THE_INSTANCE);
+        SortingWork<OurGridConfig>::Seed(grid);
+        break;
+      }
+
+      default:
+        FAIL(ILLEGAL_ARGUMENT);
+      }
+    }
+
+    void RunOne(Workload workload, u32 width, u32 height, u32 threads)
+    {
+      if (m_resultCount >= MAX_RESULTS)
+      {
+        FAIL(OUT_OF_ROOM);
+      }
+
+      ElementRegistry<OurEventConfig> er;
+      if (workload == WORKLOAD_ULAM)
+      {
+        er.AddLibraryPath(m_libraryPath);
+      }
+
+      OurGrid * gridp = new OurGrid(er, width, height, (GridLayoutPattern) GRID_LAYOUT_CHECKERBOARD);
+      OurGrid & grid = *gridp;
+
+      grid.SetSeed(m_seed);
+      if (threads > 0)
+      {
+        grid.SetTilePool(true, threads);
+      }
+      grid.SetNUMAPlacement(m_numaPlacement);
+      grid.SetHugePages(m_hugePages);
+      grid.Init();
+      Populate(grid, workload);
+      grid.InitThreads();
+      SleepMsec(10);  // Let the tile threads go passive
+
+      const u64 startMS = GetTicksSinceEpoch();
+      grid.Unpause();
+      SleepMsec(m_runMS);
+      grid.Pause();
+      const u64 stopMS = GetTicksSinceEpoch();
+
+      Result & r = m_results[m_resultCount++];
+      r.m_workload = workload;
+      r.m_width = width;
+      r.m_height = height;
+      r.m_threads = threads;
+
+      const u32 tiles = width * height;
+      const u32 online = (u32) sysconf(_SC_NPROCESSORS_ONLN);
+      r.m_cores = threads > 0 ? threads : tiles;
+      if (online > 0 && r.m_cores > online)
+      {
+        r.m_cores = online;
+      }
+
+      r.m_elapsedMS = (u32) (stopMS - startMS);
+      r.m_sites = grid.GetTotalSites();
+      r.m_events = grid.GetTotalEventsExecuted();
+      r.m_skippedEvents = grid.GetTotalSkippedEmptyEvents();
+      grid.GetCacheShippedCounts(r.m_cachePackets, r.m_cacheBytes);
+      grid.GetIntertileLockCounts(r.m_lockAttempts, r.m_lockContended);
+      u64 spinWins;
+      grid.GetLockFailureCounts(r.m_lockFailures, spinWins);
+      r.m_checkClean = 0;
+      r.m_checkFailed = 0;
+      for (u32 d = 0; d < Dirs::DIR_COUNT; ++d)
+      {
+        u64 atoms, bytes, clean, failed;
+        grid.GetCacheCheckCounts((Dir) d, atoms, bytes, clean, failed);
+        r.m_checkClean += clean;
+        r.m_checkFailed += failed;
+      }
+      SortingWork<OurGridConfig> work;
+      work.Capture(grid);
+      r.m_sorted = work.GetSorted();
+      r.m_consumed = work.GetConsumed();
+      r.m_sortError = work.GetSortError();
+#ifdef MFM_EVENT_PHASE_TIMING
+      grid.GetEventPhaseTimes(r.m_phaseTimes);
+#endif
+
+      grid.ShutdownTileThreads();
+      delete gridp;
+
+      LOG.Message("%s %dx%d threads %d: %f AEPS/sec",
+                  GetWorkloadName(workload), width, height, threads, r.GetAEPSPerSec());
+#ifdef MFM_EVENT_PHASE_TIMING
+      r.m_phaseTimes.ReportPhaseTimes(Logger::MESSAGE, "  ");
+#endif
+    }
+
+    void WriteCSV(ByteSink & out) const
+    {
+      out.Printf("workload,width,height,threads,cores,seed,ms,sites,"
+                 "events,skipped_events,aeps,aeps_per_sec,events_per_sec_per_core,"
+                 "cache_packets,cache_bytes,cache_bytes_per_event,"
+                 "lock_attempts,lock_contended,lock_contention_rate,lock_failures,"
+                 "check_clean,check_failed,check_failure_rate,"
+                 "datums_sorted,datums_consumed,sorted_per_sec,consumed_per_sec,sort_error\n");
+      for (u32 i = 0; i < m_resultCount; ++i)
+      {
+        const Result & r = m_results[i];
+        out.Printf("%s,%d,%d,%d,%d,%d,%d,%d,",
+                   GetWorkloadName(r.m_workload), r.m_width, r.m_height,
+                   r.m_threads, r.m_cores, m_seed, r.m_elapsedMS, r.m_sites);
+        out.Print(r.m_events);
+        out.Printf(",");
+        out.Print(r.m_skippedEvents);
+        out.Printf(",%f,%f,%f,", r.GetAEPS(), r.GetAEPSPerSec(), r.GetEventsPerSecPerCore());
+        out.Print(r.m_cachePackets);
+        out.Printf(",");
+        out.Print(r.m_cacheBytes);
+        out.Printf(",%f,", r.GetCacheBytesPerEvent());
+        out.Print(r.m_lockAttempts);
+        out.Printf(",");
+        out.Print(r.m_lockContended);
+        out.Printf(",%f,", r.GetLockContentionRate());
+        out.Print(r.m_lockFailures);
+        out.Printf(",");
+        out.Print(r.m_checkClean);
+        out.Printf(",");
+        out.Print(r.m_checkFailed);
+        out.Printf(",%f,", r.GetCheckFailureRate());
+        out.Print(r.m_sorted);
+        out.Printf(",");
+        out.Print(r.m_consumed);
+        out.Printf(",%f,%f,%f\n", r.GetSortedPerSec(), r.GetConsumedPerSec(), r.m_sortError);
+      }
+    }
+
+    void WriteJSON(ByteSink & out) const
+    {
+      out.Printf("[\n");
+      for (u32 i = 0; i < m_resultCount; ++i)
+      {
+        const Result & r = m_results[i];
+        out.Printf("  {\"workload\": \"%s\", \"width\": %d, \"height\": %d, "
+                   "\"threads\": %d, \"cores\": %d, \"seed\": %d, \"ms\": %d, \"sites\": %d, ",
+                   GetWorkloadName(r.m_workload), r.m_width, r.m_height,
+                   r.m_threads, r.m_cores, m_seed, r.m_elapsedMS, r.m_sites);
+        out.Printf("\"events\": ");
+        out.Print(r.m_events);
+        out.Printf(", \"skipped_events\": ");
+        out.Print(r.m_skippedEvents);
+        out.Printf(", \"aeps\": %f, \"aeps_per_sec\": %f, \"events_per_sec_per_core\": %f",
+                   r.GetAEPS(), r.GetAEPSPerSec(), r.GetEventsPerSecPerCore());
+        out.Printf(", \"cache_packets\": ");
+        out.Print(r.m_cachePackets);
+        out.Printf(", \"cache_bytes\": ");
+        out.Print(r.m_cacheBytes);
+        out.Printf(", \"cache_bytes_per_event\": %f", r.GetCacheBytesPerEvent());
+        out.Printf(", \"lock_attempts\": ");
+        out.Print(r.m_lockAttempts);
+        out.Printf(", \"lock_contended\": ");
+        out.Print(r.m_lockContended);
+        out.Printf(", \"lock_contention_rate\": %f", r.GetLockContentionRate());
+        out.Printf(", \"lock_failures\": ");
+        out.Print(r.m_lockFailures);
+        out.Printf(", \"check_clean\": ");
+        out.Print(r.m_checkClean);
+        out.Printf(", \"check_failed\": ");
+        out.Print(r.m_checkFailed);
+        out.Printf(", \"check_failure_rate\": %f", r.GetCheckFailureRate());
+        out.Printf(", \"datums_sorted\": ");
+        out.Print(r.m_sorted);
+        out.Printf(", \"datums_consumed\": ");
+        out.Print(r.m_consumed);
+        out.Printf(", \"sorted_per_sec\": %f, \"consumed_per_sec\": %f, \"sort_error\": %f",
+                   r.GetSortedPerSec(), r.GetConsumedPerSec(), r.m_sortError);
+#ifdef MFM_EVENT_PHASE_TIMING
+        WriteJSONPhases(out, r.m_phaseTimes);
+#endif
+        out.Printf("}%s\n", (i + 1 < m_resultCount) ? "," : "");
+      }
+      out.Printf("]\n");
+    }
+
+#ifdef MFM_EVENT_PHASE_TIMING
+    static void WriteJSONPhases(ByteSink & out, const EventPhaseTimer & ept)
+    {
+      out.Printf(", \"phases\": {");
+      for (u32 p = 0; p < EventPhaseTimer::PHASE_COUNT; ++p)
+      {
+        out.Printf("%s\"%s\": {\"samples\": ", p ? ", " : "", EventPhaseTimer::GetPhaseName(p));
+        out.Print(ept.GetSamples(p));
+        out.Printf(", \"ticks\": ");
+        out.Print(ept.GetTotalTicks(p));
+        out.Printf(", \"log2_histogram\": [");
+        for (u32 b = 0; b < EventPhaseTimer::BUCKET_COUNT; ++b)
+        {
+          if (b) out.Printf(",");
+          out.Print(ept.GetBucketCount(p, b));
+        }
+        out.Printf("]}");
+      }
+      out.Printf("}");
+    }
+#endif
+
+    /* Parse a comma-separated list of u32s (or, if \a second is
+       non-null, of WxH pairs) from \a arg into \a first (and \a
+       second).  Returns the number parsed, or dies on bad input. */
+    u32 ParseList(const char * arg, u32 * first, u32 * second, u32 max)
+    {
+      u32 count = 0;
+      const char * p = arg;
+      while (*p)
+      {
+        if (count >= max)
+        {
+          m_varguments.Die("Too many entries (max %d) in '%s'", max, arg);
+        }
+
+        char * end;
+        first[count] = (u32) strtoul(p, &end, 10);
+        if (end == p)
+        {
+          m_varguments.Die("Bad number in '%s'", arg);
+        }
+        p = end;
+
+        if (second)
+        {
+          if (*p != 'x' || first[count] == 0)
+          {
+            m_varguments.Die("Bad WxH size in '%s'", arg);
+          }
+          ++p;
+          second[count] = (u32) strtoul(p, &end, 10);
+          if (end == p || second[count] == 0)
+          {
+            m_varguments.Die("Bad WxH size in '%s'", arg);
+          }
+          p = end;
+        }
+        ++count;
+
+        if (*p == ',')
+        {
+          ++p;
+        }
+        else if (*p)
+        {
+          m_varguments.Die("Expected ',' in '%s'", arg);
+        }
+      }
+      return count;
+    }
+
+    static void SetSeedFromArgs(const char* seedstr, void* benchptr)
+    {
+      MFMBench& bench = *((MFMBench*)benchptr);
+      u32 seed;
+      if (bench.ParseList(seedstr, &seed, 0, 1) != 1)
+      {
+        bench.m_varguments.Die("Bad seed '%s'", seedstr);
+      }
+      bench.m_seed = seed;
+    }
+
+    static void SetRunMSFromArgs(const char* msstr, void* benchptr)
+    {
+      MFMBench& bench = *((MFMBench*)benchptr);
+      u32 ms;
+      if (bench.ParseList(msstr, &ms, 0, 1) != 1 || ms == 0)
+      {
+        bench.m_varguments.Die("Bad run length '%s'", msstr);
+      }
+      bench.m_runMS = ms;
+    }
+
+    static void SetSizesFromArgs(const char* sizes, void* benchptr)
+    {
+      MFMBench& bench = *((MFMBench*)benchptr);
+      bench.m_sizeCount = bench.ParseList(sizes, bench.m_widths, bench.m_heights, MAX_SIZES);
+    }
+
+    static void SetThreadsFromArgs(const char* threads, void* benchptr)
+    {
+      MFMBench& bench = *((MFMBench*)benchptr);
+      bench.m_threadCount = bench.ParseList(threads, bench.m_threads, 0, MAX_THREADS);
+    }
+
+    static void SetWorkloadsFromArgs(const char* workloads, void* benchptr)
+    {
+      MFMBench& bench = *((MFMBench*)benchptr);
+      bench.m_workloadMask = 0;
+
+      const char * p = workloads;
+      while (*p)
+      {
+        u32 len = 0;
+        while (p[len] && p[len] != ',')
+        {
+          ++len;
+        }
+
+        u32 w;
+        for (w = 0; w < WORKLOAD_COUNT; ++w)
+        {
+          const char * name = GetWorkloadName(w);
+          if (strlen(name) == len && !strncmp(name, p, len))
+          {
+            break;
+          }
+        }
+        if (w >= WORKLOAD_COUNT)
+        {
+          bench.m_varguments.Die("Unknown workload in '%s'", workloads);
+        }
+        bench.m_workloadMask |= 1 << w;
+
+        p += len;
+        if (*p == ',')
+        {
+          ++p;
+        }
+      }
+    }
+
+    static void SetLibraryFromArgs(const char* path, void* benchptr)
+    {
+      MFMBench& bench = *((MFMBench*)benchptr);
+      const char * err = Utils::ReadablePath(path);
+      if (err)
+      {
+        bench.m_varguments.Die("Bad element library path '%s': %s", path, err);
+      }
+      bench.m_libraryPath = path;
+    }
+
+    static void SetCSVPathFromArgs(const char* path, void* benchptr)
+    {
+      ((MFMBench*)benchptr)->m_csvPath = path;
+    }
+
+    static void SetJSONPathFromArgs(const char* path, void* benchptr)
+    {
+      ((MFMBench*)benchptr)->m_jsonPath = path;
+    }
+
+    static void SetNUMAPlacementFromArgs(const char* not_needed, void* benchptr)
+    {
+      ((MFMBench*)benchptr)->m_numaPlacement = true;
+    }
+
+    static void SetHugePagesFromArgs(const char* not_needed, void* benchptr)
+    {
+      ((MFMBench*)benchptr)->m_hugePages = true;
+    }
+  };
+}
+
+int main(int argc, const char** argv)
+{
+  MFM::LOG.SetByteSink(MFM::STDERR);
+  MFM::LOG.SetLevel(MFM::LOG.MESSAGE);
+
+  static MFM::MFMBench bench;  // Sizable; keep it off the stack
+  bench.Init(argc, argv);
+  bench.Run();
+
+  return 0;
+}
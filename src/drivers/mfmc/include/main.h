@@ -7,6 +7,7 @@
 #include "P3Atom.h"
 #include "GridConfig.h"
 #include "DateTimeStamp.h"
+#include "SortingWork.h"
 #include "Element_Dreg.h"
 #include "Element_Res.h"
 #include "Element_Creg.h"
@@ -1,6 +1,8 @@
 #include "main.h"
 
 #include <sys/resource.h>  // For getrlimit / setrlimit
+#include <sys/wait.h>      // For waitpid
+#include <unistd.h>        // For fork, pipe
 
 #ifdef ULAM_CUSTOM_ELEMENTS
 #include "UlamCustomElements.h"
@@ -15,6 +17,10 @@
 
 void * XXXDRIVER = 0;
 
+/* Where a --scaling child run reports its results, or -1 if this
+   isn't one */
+static int SCALING_REPORT_FD = -1;
+
 namespace MFM
 {
   template <class GC, u32 W, u32 H>
@@ -145,6 +151,9 @@ namespace MFM
   typedef GridConfig<OurEventConfigAll, B, C, EVENT_HISTORY_SIZE> OurGridConfigTile##A;
 #include "TileSizes.inc"
 #undef XX
+
+  // Sized at runtime by --tile-size; see DynamicTile
+  typedef GridConfig<OurEventConfigAll, 0, 0, EVENT_HISTORY_SIZE> OurGridConfigTileDynamic;
   /*
   typedef GridConfig<OurEventConfigAll, 24> OurGridConfigTileA; // 256 sites/tile
   typedef GridConfig<OurEventConfigAll, 32> OurGridConfigTileB; // 576 sites/tile
@@ -240,10 +249,33 @@ namespace MFM
         this->NeedElement(&Element_City_Sidewalk<EC>::THE_INSTANCE);//0xCE1f
         this->NeedElement(&Element_City_Street<EC>::THE_INSTANCE);//0xCE20
       }
+      else if (m_sorting)
+      {
+        this->NeedElement(&Element_Res<EC>::THE_INSTANCE);
+        this->NeedElement(&Element_Dreg<EC>::THE_INSTANCE);
+        this->NeedElement(&Element_Sorter<EC>::THE_INSTANCE);
+        this->NeedElement(&Element_Data<EC>::THE_INSTANCE);
+        this->NeedElement(&Element_Emitter<EC>::THE_INSTANCE);
+        this->NeedElement(&Element_Consumer<EC>::THE_INSTANCE);
+      }
     }
 
     ThreadStamper m_stamper;
 
+    /* --sorting: the work done as of the last epoch, and the rates
+       since the one before, for the time based data */
+    bool m_sorting;
+    SortingWork<GC> m_sortingWork;
+    u64 m_sortingMS;
+    double m_sortedPerSec;
+    double m_consumedPerSec;
+    double m_sortError;
+
+    static void SetSortingFromArgs(const char* not_needed, void* driverptr)
+    {
+      ((MFMCDriver*) driverptr)->m_sorting = true;
+    }
+
     static void PrintTileTypes(const char* not_needed, void* nullForShort)
     {
       fprintf(stderr, "Supported tile types\n");
@@ -252,16 +284,29 @@ namespace MFM
     fprintf(stderr, "  Type '%s': %d non-cache sites (%d x %d site storage)\n", #A, (B-8)*(C-8), B, C);
 #include "TileSizes.inc"
 #undef XX
+      fprintf(stderr, "  Or any WxH storage size, both even and at least %d, via --tile-size WxH\n",
+              6 * EC::EVENT_WINDOW_RADIUS);
 
       exit(0);
     }
 
+    static void NoteTileSize(const char* not_needed, void* nullForShort)
+    {
+      // MainDispatch has already chosen the tile size from this
+    }
+
 
   public:
 
-    MFMCDriver(u32 gridWidth, u32 gridHeight, GridLayoutPattern gridLayout)
-      : Super(gridWidth, gridHeight, gridLayout)
+    MFMCDriver(u32 gridWidth, u32 gridHeight, GridLayoutPattern gridLayout,
+               u32 tileWidth = GC::TILE_WIDTH, u32 tileHeight = GC::TILE_HEIGHT)
+      : Super(gridWidth, gridHeight, gridLayout, tileWidth, tileHeight)
       , m_stamper(*this)
+      , m_sorting(false)
+      , m_sortingMS(0)
+      , m_sortedPerSec(0)
+      , m_consumedPerSec(0)
+      , m_sortError(0)
     {
       MFM::LOG.SetTimeStamper(&m_stamper);
     }
@@ -269,6 +314,21 @@ namespace MFM
     virtual void DoEpochEvents(Grid<GC>& grid, u32 epochs, u32 epochAEPS)
     {
       /* Write custom epoch code here */
+      if (m_sorting)
+      {
+        SortingWork<GC> now;
+        now.Capture(grid);
+        const SortingWork<GC> epoch = now.Since(m_sortingWork);
+        const u64 ms = this->GetMsSpentRunning();
+        const double secs = (ms - m_sortingMS) / 1000.0;
+        m_sortedPerSec = secs > 0 ? epoch.GetSorted() / secs : 0.0;
+        m_consumedPerSec = secs > 0 ? epoch.GetConsumed() / secs : 0.0;
+        m_sortError = epoch.GetSortError();
+        m_sortingWork = now;
+        m_sortingMS = ms;
+        LOG.Message("Sorting: %f AEPS, %f sorted/sec, %f consumed/sec, %f sort error",
+                    this->GetAEPS(), m_sortedPerSec, m_consumedPerSec, m_sortError);
+      }
 
       /* Leave this line here so the Superclass can run as well. */
       Super::DoEpochEvents(grid, epochs, epochAEPS);
@@ -282,6 +342,13 @@ namespace MFM
       this->RegisterArgument("Display the supported tile types, then exit.",
                              "--tiles", &PrintTileTypes, NULL, false);
 
+      this->RegisterArgument("Use ARG (WxH, caches included) sized tiles instead of the "
+                             "tile code's, at some cost in speed.",
+                             "--tile-size", &NoteTileSize, NULL, true);
+
+      this->RegisterArgument("Seed the Demon Horde Sort, and report the work it does -- datums "
+                             "sorted and consumed per second, and sort error -- alongside AEPS.",
+                             "--sorting", &SetSortingFromArgs, this, false);
 
     }
 
@@ -290,11 +357,35 @@ namespace MFM
       Super::OnceOnly(args);
       if (this->m_includeCPPDemos && this->m_elementRegistry.GetLibraryPathsCount() > 0)
         args.Die("Cannot include ulam elements when using --cpp-demos");
+      if (m_sorting && this->m_elementRegistry.GetLibraryPathsCount() > 0)
+        args.Die("Cannot include ulam elements when using --sorting");
+    }
+
+    virtual void WriteTimeBasedCustomHeader(FileByteSink& fp)
+    {
+      if (m_sorting)
+        fp.Printf(" SortedPerSec ConsumedPerSec SortError1000");
+    }
+
+    virtual u32 CaptureTimeBasedCustomData(u64 * values, u32 maxValues)
+    {
+      if (!m_sorting || maxValues < 3)
+        return 0;
+      values[0] = (u64) m_sortedPerSec;
+      values[1] = (u64) m_consumedPerSec;
+      values[2] = (u64) (1000.0 * m_sortError);
+      return 3;
     }
 
     virtual void ReinitEden()
     {
       OurGrid & mainGrid = this->GetGrid();
+      if (m_sorting)
+      {
+        SortingWork<GC>::Seed(mainGrid);
+        m_sortingWork.Capture(mainGrid);
+        m_sortingMS = this->GetMsSpentRunning();
+      }
       { // Set up edenseed if any
         const u8 * edenSeedSymbol = this->GetEdenSeedSymbol();
         if (edenSeedSymbol != 0) {
@@ -355,17 +446,43 @@ namespace MFM
   };
 
   template <class CONFIG>
-  int SimRunner(int argc, const char** argv,u32 gridWidth,u32 gridHeight, GridLayoutPattern gridLayout)
+  void SetTileLayout(GridLayoutPattern gridLayout)
   {
-    SizedTile<typename CONFIG::EVENT_CONFIG, CONFIG::TILE_WIDTH, CONFIG::TILE_HEIGHT, CONFIG::EVENT_HISTORY_SIZE>::SetGridLayoutPattern(gridLayout); //static before sim (next line)
+    SizedTile<typename CONFIG::EVENT_CONFIG, CONFIG::TILE_WIDTH, CONFIG::TILE_HEIGHT, CONFIG::EVENT_HISTORY_SIZE>::SetGridLayoutPattern(gridLayout);
+  }
 
-    MFMCDriver<CONFIG> sim(gridWidth,gridHeight,gridLayout);
+  template <>
+  void SetTileLayout<OurGridConfigTileDynamic>(GridLayoutPattern gridLayout)
+  {
+    // DynamicTiles get their layout from the Grid
+  }
+
+  template <class CONFIG>
+  int SimRunner(int argc, const char** argv,u32 gridWidth,u32 gridHeight, GridLayoutPattern gridLayout,
+                u32 tileWidth, u32 tileHeight)
+  {
+    SetTileLayout<CONFIG>(gridLayout); //static before sim (next line)
+
+    MFMCDriver<CONFIG> sim(gridWidth,gridHeight,gridLayout,tileWidth,tileHeight);
     XXXDRIVER = &sim;
     SnapshotGlobalHook<CONFIG> sgh(sim);
     sim.ProcessArguments(argc, argv);
     sim.AddInternalLogging();
     sim.Init();
     sim.Run();
+
+    if (SCALING_REPORT_FD >= 0)
+    {
+      FILE * report = fdopen(SCALING_REPORT_FD, "w");
+      if (report)
+      {
+        fprintf(report, "%f %f %lu %u\n",
+                sim.GetAEPS(), sim.GetAER(),
+                (unsigned long) sim.GetMsSpentRunning(),
+                sim.GetGrid().GetTotalSites());
+        fclose(report);
+      }
+    }
     return 0;
   }
 
@@ -374,7 +491,8 @@ namespace MFM
      grid sizing (since we're not in core/ here).  But it shouldn't
      hurt anything so for now anyway we're leaving it in. */
   template <class CONFIG>
-  int SimCheckAndRun(int argc, const char** argv, u32 gridWidth, u32 gridHeight, GridLayoutPattern gridLayout)
+  int SimCheckAndRun(int argc, const char** argv, u32 gridWidth, u32 gridHeight, GridLayoutPattern gridLayout,
+                     u32 tileWidth = CONFIG::TILE_WIDTH, u32 tileHeight = CONFIG::TILE_HEIGHT)
   {
     struct rlimit lim;
     if (getrlimit(RLIMIT_STACK, &lim))
@@ -400,7 +518,7 @@ namespace MFM
       }
     }
 
-    return SimRunner<CONFIG>(argc,argv,gridWidth,gridHeight,gridLayout);
+    return SimRunner<CONFIG>(argc,argv,gridWidth,gridHeight,gridLayout,tileWidth,tileHeight);
   }
 
   int SimRunConfig(const GridConfigCode & gcc, int argc, const char** argv)
@@ -441,12 +559,255 @@ namespace MFM
 #endif
   }
 
+  /////
+  // Scaling benchmark: --scaling TILES GRIDS THREADS AEPS [ARGS..]
+
+  struct ScalingResult {
+    double aeps;
+    double aer;
+    unsigned long ms;
+    u32 sites;
+  };
+
+  static int ScalingUsage(const char * prog, const char * why)
+  {
+    fprintf(stderr,
+            "%s: %s\n"
+            "Usage: %s --scaling TILES GRIDS THREADS AEPS [ARGS..]\n"
+            "  TILES    tile codes to try, e.g. CE (see --tiles)\n"
+            "  GRIDS    comma-separated COLSxROWS, e.g. 1x1,2x2,4x4\n"
+            "  THREADS  comma-separated --tilepool sizes, 0 for a thread per tile\n"
+            "  AEPS     average events per site to run each configuration\n"
+            "  ARGS     passed to every run, e.g. -cp res/mfs/dreg-480x320.mfs\n",
+            prog, why, prog);
+    return 1;
+  }
+
+  /* Parse a comma-separated list of (pairs of) numbers into vals,
+     returning how many, or 0 on any error.  With pairs, entries are
+     AxB and fill vals[2*i] and vals[2*i+1]. */
+  static u32 ParseScalingList(const char * list, bool pairs, u32 * vals, u32 maxEntries)
+  {
+    u32 count = 0;
+    const char * p = list;
+    while (count < maxEntries)
+    {
+      char * end;
+      const u32 perEntry = pairs ? 2 : 1;
+      for (u32 i = 0; i < perEntry; ++i)
+      {
+        if (*p < '0' || *p > '9') return 0;
+        vals[count * perEntry + i] = (u32) strtoul(p, &end, 10);
+        p = end;
+        if (pairs && i == 0 && *p++ != 'x') return 0;
+      }
+      ++count;
+      if (*p == 0) return count;
+      if (*p++ != ',') return 0;
+    }
+    return 0;
+  }
+
+  /* Run one configuration in a child process, so each starts from a
+     fresh heap and fresh element registrations, as a normal run
+     would.  Returns false if the child didn't report. */
+  static bool RunScalingConfig(const GridConfigCode & gcc, u32 threads, u32 aeps,
+                               const char * prog, int extraArgc, const char ** extraArgv,
+                               ScalingResult & result)
+  {
+    char geometry[32];
+    char aepsArg[16];
+    char threadsArg[16];
+    char dirArg[64];
+    static u32 runNumber = 0;
+    snprintf(geometry, sizeof(geometry), "{%u%c%u}",
+             gcc.gridWidth, GridConfigCode::GetTileTypeCode(gcc.tileType), gcc.gridHeight);
+    snprintf(aepsArg, sizeof(aepsArg), "%u", aeps);
+    snprintf(threadsArg, sizeof(threadsArg), "%u", threads);
+    /* Runs can start within a second, so give each its own -d, lest
+       they collide on the timestamped simulation directory */
+    snprintf(dirArg, sizeof(dirArg), "/tmp/mfmscaling-%d-%u", (int) getpid(), ++runNumber);
+
+    const char ** childArgv = new const char * [extraArgc + 12];
+    int childArgc = 0;
+    childArgv[childArgc++] = prog;
+    childArgv[childArgc++] = geometry;
+    childArgv[childArgc++] = "--haltafteraeps";
+    childArgv[childArgc++] = aepsArg;
+    childArgv[childArgc++] = "-d";
+    childArgv[childArgc++] = dirArg;
+#ifdef MFM_GUI_DRIVER
+    childArgv[childArgc++] = "--no-gui";
+    childArgv[childArgc++] = "--run";
+#endif
+    if (threads > 0)
+    {
+      childArgv[childArgc++] = "--tilepool";
+      childArgv[childArgc++] = threadsArg;
+    }
+    for (int i = 0; i < extraArgc; ++i)
+      childArgv[childArgc++] = extraArgv[i];
+    childArgv[childArgc] = 0;
+
+    int fds[2];
+    if (pipe(fds) != 0)
+    {
+      perror("pipe");
+      delete [] childArgv;
+      return false;
+    }
+
+    fflush(stdout);
+    fflush(stderr);
+    pid_t pid = fork();
+    if (pid < 0)
+    {
+      perror("fork");
+      close(fds[0]);
+      close(fds[1]);
+      delete [] childArgv;
+      return false;
+    }
+
+    if (pid == 0)
+    {
+      close(fds[0]);
+      SCALING_REPORT_FD = fds[1];
+      _exit(SimRunConfig(gcc, childArgc, childArgv));
+    }
+
+    close(fds[1]);
+    delete [] childArgv;
+    FILE * report = fdopen(fds[0], "r");
+    bool ok = report &&
+      fscanf(report, "%lf %lf %lu %u",
+             &result.aeps, &result.aer, &result.ms, &result.sites) == 4;
+    if (report) fclose(report);
+    else close(fds[0]);
+
+    int status;
+    waitpid(pid, &status, 0);
+    return ok && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+  }
+
+  /* Sweep tile code x grid size x thread count, printing one CSV line
+     per configuration.  Efficiencies compare events per second per
+     tile against the first grid size (weak scaling), and per thread
+     against the first thread count (strong scaling), for the same
+     tile code. */
+  int ScalingBenchmark(int argc, const char** argv)
+  {
+    enum { MAX_ENTRIES = 32 };
+    const char * prog = argv[0];
+    if (argc < 6)
+      return ScalingUsage(prog, "--scaling needs TILES GRIDS THREADS AEPS");
+
+    const char * tiles = argv[2];
+    for (const char * t = tiles; *t; ++t)
+      if ((u8) *t < GridConfigCode::GetMinTypeCode() || (u8) *t > GridConfigCode::GetMaxTypeCode())
+        return ScalingUsage(prog, "unsupported tile code in TILES");
+
+    u32 grids[2 * MAX_ENTRIES];
+    const u32 gridCount = ParseScalingList(argv[3], true, grids, MAX_ENTRIES);
+    if (gridCount == 0)
+      return ScalingUsage(prog, "bad GRIDS list");
+
+    u32 threads[MAX_ENTRIES];
+    const u32 threadCount = ParseScalingList(argv[4], false, threads, MAX_ENTRIES);
+    if (threadCount == 0)
+      return ScalingUsage(prog, "bad THREADS list");
+
+    char * end;
+    const u32 aeps = (u32) strtoul(argv[5], &end, 10);
+    if (*end != 0 || aeps == 0)
+      return ScalingUsage(prog, "bad AEPS");
+
+    const int extraArgc = argc - 6;
+    const char ** extraArgv = argv + 6;
+
+    printf("tile,cols,rows,tiles,threads,aeps,ms,aer,eventsPerSec,weakEfficiency,threadEfficiency\n");
+    for (const char * t = tiles; *t; ++t)
+    {
+      const GridConfigCode::TileType tileType = (GridConfigCode::TileType)
+        ((*t - GridConfigCode::GetMinTypeCode()) + GridConfigCode::TileUNSPEC + 1);
+
+      double baseEventsPerTile[MAX_ENTRIES];   // By thread count, at grids[0]
+      for (u32 n = 0; n < threadCount; ++n)
+        baseEventsPerTile[n] = 0;
+      for (u32 g = 0; g < gridCount; ++g)
+      {
+        const u32 cols = grids[2 * g], rows = grids[2 * g + 1];
+        const u32 tileCount = cols * rows;
+        GridConfigCode gcc(tileType, cols, rows, GRID_LAYOUT_CHECKERBOARD);
+
+        double baseEventsPerThread = 0;
+        for (u32 n = 0; n < threadCount; ++n)
+        {
+          ScalingResult r;
+          if (!RunScalingConfig(gcc, threads[n], aeps, prog, extraArgc, extraArgv, r))
+          {
+            fprintf(stderr, "%s: run %c %ux%u threads %u failed\n",
+                    prog, *t, cols, rows, threads[n]);
+            printf("%c,%u,%u,%u,%u,,,,,,\n", *t, cols, rows, tileCount, threads[n]);
+            continue;
+          }
+
+          const double eventsPerSec = r.aer * r.sites;
+          const double eventsPerTile = eventsPerSec / tileCount;
+          const u32 threadsUsed = threads[n] > 0 ? threads[n] : tileCount;
+          const double eventsPerThread = eventsPerSec / threadsUsed;
+
+          if (g == 0) baseEventsPerTile[n] = eventsPerTile;
+          if (n == 0) baseEventsPerThread = eventsPerThread;
+
+          printf("%c,%u,%u,%u,%u,%f,%lu,%f,%f,%f,%f\n",
+                 *t, cols, rows, tileCount, threads[n],
+                 r.aeps, r.ms, r.aer, eventsPerSec,
+                 baseEventsPerTile[n] > 0 ? eventsPerTile / baseEventsPerTile[n] : 0,
+                 baseEventsPerThread > 0 ? eventsPerThread / baseEventsPerThread : 0);
+          fflush(stdout);
+        }
+      }
+    }
+    return 0;
+  }
+
+  /* Look for --tile-size WxH, which overrides the config code's tile
+     type: 1 if found and legal, -1 (having complained) if found and
+     not, and 0 if absent. */
+  int CheckForTileSize(u32 & width, u32 & height, int argc, const char ** argv)
+  {
+    for (int i = 1; i < argc; ++i)
+    {
+      if (strcmp(argv[i], "--tile-size"))
+        continue;
+
+      const u32 minSide = 6 * OurEventConfigAll::EVENT_WINDOW_RADIUS;
+      char junk;
+      if (i + 1 >= argc ||
+          sscanf(argv[i + 1], "%ux%u%c", &width, &height, &junk) != 2 ||
+          width < minSide || height < minSide || (width & 1) || (height & 1))
+      {
+        fprintf(stderr, "%s: --tile-size needs WxH, both even and at least %d\n",
+                argv[0], minSide);
+        return -1;
+      }
+      return 1;
+    }
+    return 0;
+  }
+
   int MainDispatch(int argc, const char** argv)
   {
     // Early early logging
     LOG.SetByteSink(STDERR);
     LOG.SetLevel(LOG.MESSAGE);
 
+    if (argc > 1 && !strcmp(argv[1], "--scaling"))
+    {
+      return ScalingBenchmark(argc, argv);
+    }
+
     GridConfigCode gcc;
     if (!CheckForConfigCode(gcc,argc,argv))
     {
@@ -457,7 +818,17 @@ namespace MFM
       gcc.SetGridHeight(2);
     }
 
-    return SimRunConfig(gcc, argc, argv);
+    u32 tileWidth, tileHeight;
+    switch (CheckForTileSize(tileWidth, tileHeight, argc, argv))
+    {
+    case -1:
+      return 1;
+    case 1:
+      return SimCheckAndRun<OurGridConfigTileDynamic>(argc, argv, gcc.gridWidth, gcc.gridHeight,
+                                                      gcc.gridLayout, tileWidth, tileHeight);
+    default:
+      return SimRunConfig(gcc, argc, argv);
+    }
   }
 }
 
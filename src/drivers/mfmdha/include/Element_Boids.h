@@ -3,6 +3,7 @@
 
 #include "Element.h"
 #include "EventWindow.h"
+#include "WindowScanner.h"
 #include "ElementTable.h"
 #include "Element_Empty.h"
 #include "Element_Res.h"
@@ -320,42 +321,19 @@ namespace MFM
       //Vector myHead = GetHeading(self);
       //      myHead.Print(stderr);
 
-      Vector avgHeading;
-      Vector avgPosition;
-      u32 countNgbr = 0;
+      // Same-type neighbors and Res come from the window's per-type
+      // site masks, so this costs per neighbor rather than per site.
+      // (Their headings would need a per-atom read, but nothing here
+      // steers by heading yet.)
+      WindowScanner<CC> scanner(window);
 
-      u32 minDist = R+1;
+      SPoint sumPosition;
+      const u32 countNgbr = scanner.SumLocationsOfType(selfType, R, sumPosition);
+      const u32 minDist = countNgbr > 0 ? scanner.GetNearestDistanceOfType(selfType, R) : R+1;
+      Vector avgPosition(sumPosition);
 
-      u32 resCount = 0;
       SPoint resAt;
-
-      const MDist<R> & md = MDist<R>::get();
-
-      // Scan event window outside self
-      for (u32 idx = md.GetFirstIndex(1); idx <= md.GetLastIndex(R); ++idx) {
-        const SPoint sp = md.GetPoint(idx);
-        const T other = window.GetRelativeAtom(sp);
-
-        const u32 otherType = other.GetType();
-
-        if (otherType == Element_Res<CC>::TYPE) {
-          if (random.OneIn(++resCount)) resAt = sp;
-          continue;
-        }
-
-        if (otherType != selfType) continue;
-
-        u32 dist = sp.GetManhattanLength();
-        if (dist < minDist)
-          minDist = dist;
-
-        Vector theirHead = GetHeading(other);
-
-        avgHeading += theirHead;
-        avgPosition += Vector(sp);
-
-        ++countNgbr;
-      }
+      const u32 resCount = scanner.FindRandomLocationOfType(Element_Res<CC>::TYPE, R, resAt);
 
       if (countNgbr > 0 && countNgbr < 3 && resCount > 0) {
         // Whatever else we do, if we're not alone and not too crowded
@@ -380,7 +358,6 @@ namespace MFM
         return;  // No diffusion if swap
 
       } else {
-        avgHeading /= countNgbr;
         avgPosition /= countNgbr;
 
         //        avgPosition.Print(stderr);
@@ -107,13 +107,10 @@ namespace MFM {
         {
           for(u32 y = 0; y < mainGrid.GetHeight(); y++)
             {
-              for(u32 z = 0; z < 4; z++)
-                {
-                  aloc.Set(10 + x * realWidth + z, 14 + y * realWidth);
-                  sloc.Set(11 + x * realWidth + z, 15 + y * realWidth);
-                  mainGrid.PlaceAtom(sorter, sloc);
-                  mainGrid.PlaceAtom(atom, aloc);
-                }
+              aloc.Set(10 + x * realWidth, 14 + y * realWidth);
+              sloc.Set(11 + x * realWidth, 15 + y * realWidth);
+              mainGrid.PlaceAtomsInRect(false, sorter, Rect(sloc, UPoint(4, 1)));
+              mainGrid.PlaceAtomsInRect(false, atom, Rect(aloc, UPoint(4, 1)));
             }
         }
       mainGrid.PlaceAtom(emtr, eloc);
@@ -75,6 +75,10 @@ namespace MFM {
     }
     s8 getYoink() const { return mYoinkValue; }
 
+    /** When our RING went out, per T2ITCStats::nowUsec() */
+    u32 getRungUsec() const { return mRungUsec; }
+    void setRungUsec(u32 usec) { mRungUsec = usec; }
+
     void bindCircuit(T2ITC& itc) ;
     void unbindCircuit() ;
 
@@ -92,6 +96,7 @@ namespace MFM {
     T2ITC * mITC;
     s8 mMaxUnshippedSN;
     s8 mYoinkValue;
+    u32 mRungUsec;
   };
 
 }
@@ -0,0 +1,79 @@
+/* -*- C++ -*- */
+#ifndef EVENTSITESAMPLER_H
+#define EVENTSITESAMPLER_H
+
+#include "itype.h"
+#include "Point.h"
+
+//Spike files
+#include "T2Constants.h"
+
+namespace MFM {
+
+  /** Tracks every owned site by whether an active EW could start
+      there, so a uniform random owned site -- and what sort it is --
+      costs one random number.  The sites are kept permuted so that
+      ranks [0,READY) are the ready sites, [READY,READY+BUSY) the
+      busy ones, and the rest empty; moving a site between sorts is
+      a swap or two. */
+  struct EventSiteSampler {
+    typedef enum siteclass {
+      SC_READY,                 // Non-empty and not held by any EW
+      SC_BUSY,                  // Non-empty but held by some EW
+      SC_EMPTY,                 // Nothing to do
+      SC_COUNT
+    } SiteClass;
+
+    enum {
+      SITE_COUNT = T2TILE_OWNED_WIDTH*T2TILE_OWNED_HEIGHT
+    };
+
+    EventSiteSampler() ;        // All empty
+
+    static bool isOwnedSite(UPoint tileSite) {
+      return
+        tileSite.GetX() >= CACHE_LINES && tileSite.GetX() < T2TILE_WIDTH-CACHE_LINES &&
+        tileSite.GetY() >= CACHE_LINES && tileSite.GetY() < T2TILE_HEIGHT-CACHE_LINES;
+    }
+
+    void setClass(UPoint tileSite, SiteClass sc) ;
+
+    SiteClass getClass(UPoint tileSite) const {
+      return getClassOfRank(mRank[getOwnedIndex(tileSite)]);
+    }
+
+    u32 getCount(SiteClass sc) const {
+      return mBound[sc+1] - mBound[sc];
+    }
+
+    SiteClass getClassOfRank(u32 rank) const {
+      MFM_API_ASSERT_ARG(rank < SITE_COUNT);
+      if (rank < mBound[SC_BUSY]) return SC_READY;
+      if (rank < mBound[SC_EMPTY]) return SC_BUSY;
+      return SC_EMPTY;
+    }
+
+    UPoint getSiteOfRank(u32 rank) const {
+      MFM_API_ASSERT_ARG(rank < SITE_COUNT);
+      const u32 idx = mOrder[rank];
+      return UPoint(idx % T2TILE_OWNED_WIDTH + CACHE_LINES,
+                    idx / T2TILE_OWNED_WIDTH + CACHE_LINES);
+    }
+
+  private:
+    static u32 getOwnedIndex(UPoint tileSite) {
+      MFM_API_ASSERT_ARG(isOwnedSite(tileSite));
+      return
+        (tileSite.GetY()-CACHE_LINES)*T2TILE_OWNED_WIDTH +
+        (tileSite.GetX()-CACHE_LINES);
+    }
+
+    void swapRanks(u32 r1, u32 r2) ;
+
+    u16 mOrder[SITE_COUNT];     // rank -> owned index
+    u16 mRank[SITE_COUNT];      // owned index -> rank
+    u32 mBound[SC_COUNT+1];     // First rank of each class, then SITE_COUNT
+  };
+}
+
+#endif /* EVENTSITESAMPLER_H */
@@ -0,0 +1,85 @@
+/* -*- C++ -*- */
+#ifndef FLASHSEENSET_H
+#define FLASHSEENSET_H
+
+#include "itype.h"
+
+//Spike files
+#include "FlashTraffic.h"
+
+namespace MFM {
+
+  /** The flash packets a tile has accepted, keyed by (command,
+      index, range) and origin, for constant-time duplicate checks
+      during a flood.  Accepted packets are PENDING until executed;
+      then they linger for LINGER_MS so late copies arriving by
+      longer paths are still recognized, after which their slots are
+      reused.  An open-addressed table of SLOT_COUNT slots probed at
+      most MAX_PROBES deep; if every probed slot is live, the
+      soonest-to-age one is evicted. */
+  struct FlashSeenSet {
+    typedef enum seenmatch {
+      SEEN_NONE,                // Nothing like it
+      SEEN_PENDING,             // Same packet, still awaiting execution
+      SEEN_LINGERING,           // Same packet, recently executed
+      SEEN_OTHER_ORIGIN         // Same command pending from a different origin
+    } SeenMatch;
+
+    enum {
+      SLOT_BITS = 7,
+      SLOT_COUNT = 1<<SLOT_BITS,
+      SLOT_MASK = SLOT_COUNT-1,
+      MAX_PROBES = 8,
+      LINGER_MS = 10*1000
+    };
+
+    FlashSeenSet() ;
+
+    SeenMatch find(const FlashTraffic & packet, u32 nowMS) const ;
+
+    /** Remember packet as pending, expecting to execute it at
+        untilMS.  \returns true if a still-live entry had to be
+        evicted to make room */
+    bool insertPending(const FlashTraffic & packet, u32 nowMS, u32 untilMS) ;
+
+    /** packet has been executed: let it linger from nowMS */
+    void retire(const FlashTraffic & packet, u32 nowMS) ;
+
+  private:
+    typedef enum slotstate {
+      SS_EMPTY,                 // Never used: ends a probe sequence
+      SS_PENDING,
+      SS_LINGERING              // Reusable once mUntilMS passes
+    } SlotState;
+
+    struct Slot {
+      u32 mCIR;                 // (command, index, range)
+      u16 mOrigin;
+      u8 mState;
+      u32 mUntilMS;             // Pending: expected execution; lingering: expiry
+    };
+
+    static u32 getCIR(const FlashTraffic & packet) {
+      return (((u32) packet.mCommand)<<16) | (((u32) packet.mIndex)<<8) | packet.mRange;
+    }
+
+    static u16 getOrigin(const FlashTraffic & packet) {
+      return (u16) ((((u8) packet.mOrigin.GetX())<<8) | ((u8) packet.mOrigin.GetY()));
+    }
+
+    static u32 getProbeStart(u32 cir) {
+      return (cir * 2654435761u) >> (32 - SLOT_BITS);
+    }
+
+    static bool isBefore(u32 a, u32 b) { return (s32) (a - b) < 0; }
+
+    bool isLive(const Slot & s, u32 nowMS) const {
+      return s.mState == SS_PENDING ||
+        (s.mState == SS_LINGERING && isBefore(nowMS, s.mUntilMS));
+    }
+
+    Slot mSlots[SLOT_COUNT];
+  };
+}
+
+#endif /* FLASHSEENSET_H */
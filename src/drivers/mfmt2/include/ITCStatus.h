@@ -45,6 +45,11 @@ namespace MFM {
     u32 mStats[ITC_STAT_COUNT];
     u32 mDeltas[ITC_STAT_COUNT];
 
+    // Our own circuit telemetry, as opposed to the LKM's packet counts
+    bool mHaveCircuitStats;
+    T2ITCStats mCircuitStats;
+    T2ITCStats mCircuitDeltas;
+
     const u32 getIconFaceIdx() const { return iconFaceIdx[mDir6Idx]; }
     const UPoint getScreenPos() const { return screenPos[mDir6Idx]; }
     const SPoint getSide1Offset() const { return side1Pos[mDir6Idx]; }
@@ -69,6 +74,13 @@ namespace MFM {
 
     void formatDeltasLine(ByteSink & bs) ;
 
+    void updateCircuitStats(const T2ITCStats & stats) ;
+
+    /** Brief recent-interval circuit summary for the panel.  Returns
+        false if there were no rings to summarize; sets isSlow if
+        most of them were refused */
+    bool formatCircuitSummary(ByteSink & bs, bool & isSlow) ;
+
     void drawStatus(Drawing & draw, ITCIcons & icons) ;
       
   };
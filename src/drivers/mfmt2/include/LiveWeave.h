@@ -0,0 +1,95 @@
+/* -*- C++ -*- */
+#ifndef LIVEWEAVE_H
+#define LIVEWEAVE_H
+
+#include <deque>
+#include <map>
+#include <vector>
+
+#include "itype.h"
+#include "FileByteSink.h"
+#include "Trace.h"
+
+namespace MFM {
+
+  /**
+     Weaves the trace streams of live tiles -- tiles started with
+     --trace tcp:HOST:PORT -- as they arrive, rather than after the
+     fact from files.
+
+     Each stream keeps a window of its recent records, at most
+     WINDOW_RECORDS, and the recent sync tags it has seen.  When a
+     tag turns up in two streams their clock disparity is measured
+     there, as Alignment does for files, and each stream connected to
+     the anchor -- the oldest stream still open -- through measured
+     pairs gets an offset onto the anchor's clock.  Aligned records
+     are printed in merged order once they're SETTLE_MS older than
+     the newest aligned record, giving the other streams time to
+     catch up.  A stream that can't be aligned yet holds its records
+     until it can, dropping the oldest beyond its window.
+   */
+  struct LiveWeave {
+    enum {
+      MAX_STREAMS = 64,
+      WINDOW_RECORDS = 1<<15,   // Per stream
+      MAX_SYNCS = 4096,         // Recent sync tags per stream
+      SETTLE_MS = 1000,
+      POLL_MS = 100
+    };
+
+    LiveWeave(u32 port, FileByteSink & out) ;
+    ~LiveWeave() ;
+
+    /** Accept and weave streams until the process is killed.  FAILs
+        if the port can't be listened on */
+    void run() ;
+
+  private:
+    struct LiveStream {
+      LiveStream(u32 num, int fd) ;
+      ~LiveStream() ;
+      const u32 mNum;
+      int mFD;                  // -1 once closed
+      TraceStreamDecoder mDecoder;
+      std::deque<Trace*> mWindow;
+      std::map<u32,s64> mSyncs; // |tag| -> local nsec
+      std::deque<u32> mSyncOrder;
+      s64 mNewestNsec;          // Local time of newest record
+      bool mAligned;
+      s64 mOffsetNsec;          // Local + this == anchor time
+      u32 mDropped;
+    };
+
+    struct Disparity {
+      u32 mCount;
+      double mSumNsec;          // Of (first's time - second's)
+    };
+    typedef std::pair<u32,u32> StreamPair; // Lower number first
+    typedef std::map<StreamPair,Disparity> DisparityMap;
+
+    void acceptStream() ;
+    bool readStream(LiveStream & ls) ; // False if it's done
+    void addTrace(LiveStream & ls, Trace * trace) ;
+    void noteSync(LiveStream & ls, u32 tag, s64 nsec) ;
+    void align() ;
+    void emit(bool all) ;
+    void closeStream(LiveStream & ls) ;
+    LiveStream * findStream(u32 num) ;
+
+    const u32 mPort;
+    FileByteSink & mOut;
+    int mListenFD;
+    std::vector<LiveStream*> mStreams;
+    u32 mNextStreamNum;
+    DisparityMap mDisparities;
+    bool mAlignmentChanged;
+    u32 mAnchor;                // U32_MAX if none
+    bool mHaveBase;
+    s64 mBaseNsec;              // Printed times are relative to this
+    u32 mEmitted;
+    u32 mLate;                  // Printed behind an already printed one
+    s64 mLastEmittedNsec;
+  };
+
+}
+#endif /* LIVEWEAVE_H */
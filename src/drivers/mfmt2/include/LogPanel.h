@@ -10,13 +10,40 @@ namespace MFM {
 
   typedef TextPanel<128,10> TextPanelForLogging;
 
+  /**
+     A TextPanel showing the tail of a growing file, such as a log.
+     Each update() reads whatever has been appended since the last
+     one, in chunks, into the panel's LineTailByteSink, which keeps
+     just the newest lines.  When the file has grown by more than
+     MAX_BACKLOG_BYTES since we last looked, we skip ahead to the
+     last MAX_BACKLOG_BYTES of it rather than churning through lines
+     that would scroll away anyway.
+
+     Where inotify is available, update() doesn't touch the file
+     unless it's been modified, and getNotifyFD() is readable when it
+     has been, so a caller with an FDReactor can update on demand.  A
+     file that's truncated, deleted, or renamed away (say, by log
+     rotation) is reopened from the start.
+   */
   struct LogPanel : public TextPanelForLogging {
+    enum {
+      READ_CHUNK_BYTES = 4096,
+      MAX_BACKLOG_BYTES = 4 * 128 * 10 // Plenty for the lines we show
+    };
+
     const char * mFilePathToTrack;
-    FILE * mFilePtr;
+    int mFD;                    // -1 if the file isn't open
+    int mNotifyFD;              // inotify instance, or -1 if none
+    int mWatchD;                // mNotifyFD's watch on the file, or -1
+    u64 mOffset;                // How far into the file we've read
+    u64 mInode;                 // Of the open file
     u32 mBytesToSkip;
     u32 mBytesInLine;
+    bool mChanged;              // Something to read, as far as we know
+    bool mReplaced;             // File moved or deleted out from under us
 
     void setPathToTrack(const char * path) {
+      closeFile();
       mFilePathToTrack = path;
     }
 
@@ -26,17 +53,34 @@ namespace MFM {
 
     LogPanel(const char * path = 0, u32 skipbytes = 0)
       : mFilePathToTrack(0)
-      , mFilePtr(0)
+      , mFD(-1)
+      , mNotifyFD(-1)
+      , mWatchD(-1)
+      , mOffset(0)
+      , mInode(0)
       , mBytesToSkip(0)
       , mBytesInLine(0)
+      , mChanged(false)
+      , mReplaced(false)
     {
       setPathToTrack(path);
       setBytesToSkipPerLine(skipbytes);
     }
 
+    /** The inotify fd that becomes readable when the tracked file
+        changes, or -1 if there isn't one (yet).  It stays the same
+        across reopens of the file. */
+    int getNotifyFD() const { return mNotifyFD; }
+
     void update() ;
 
-    virtual ~LogPanel() { }
+    virtual ~LogPanel() ;
+
+  private:
+    bool openFile() ;
+    void closeFile() ;
+    void drainNotifications() ;
+    void consume(const u8 * data, u32 len) ;
   };
 }
 
@@ -0,0 +1,169 @@
+/* -*- C++ -*- */
+#ifndef MAPPEDFILEBYTESOURCE_H
+#define MAPPEDFILEBYTESOURCE_H
+
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "ByteSource.h"
+
+namespace MFM
+{
+  /**
+     A ByteSource over a whole file mapped read-only into memory.
+     Offers the same Open/Close/Seek/Tell interface as
+     FileByteSource, and also hands out the mapped bytes directly
+     via GetBytes and Skip so decoders can work on a record at a
+     time rather than going through Read() per byte.
+   */
+  class MappedFileByteSource : public ByteSource
+  {
+  private:
+    const u8 * m_bytes;         // Null if not open or empty
+    long m_length;
+    long m_pos;
+    bool m_open;
+    bool m_lastAdvanced;        // Whether the latest ReadByte() consumed a byte
+
+    /** Bytes a pending Unread() has pushed back: 0 or 1 */
+    long UnreadCount() const
+    {
+      return IsUnread(*this) && m_lastAdvanced ? 1 : 0;
+    }
+
+  public:
+    MappedFileByteSource() :
+      ByteSource(),
+      m_bytes(0),
+      m_length(0),
+      m_pos(0),
+      m_open(false),
+      m_lastAdvanced(false)
+    { }
+
+    MappedFileByteSource(const char* filename) :
+      ByteSource(),
+      m_bytes(0),
+      m_length(0),
+      m_pos(0),
+      m_open(false),
+      m_lastAdvanced(false)
+    {
+      Open(filename);
+    }
+
+    ~MappedFileByteSource()
+    {
+      Close();
+    }
+
+    /**
+     * Map the file at filename, if this MappedFileByteSource is not
+     * already open.  Check IsOpen() afterwards.  The file contents
+     * are taken as of this call; later growth is not seen.
+     */
+    void Open(const char* filename)
+    {
+      if (m_open) return;
+      int fd = open(filename, O_RDONLY);
+      if (fd < 0) return;
+      struct stat statbuf;
+      if (fstat(fd, &statbuf) != 0) {
+        close(fd);
+        return;
+      }
+      m_length = statbuf.st_size;
+      m_pos = 0;
+      m_bytes = 0;
+      if (m_length > 0) {
+        void * mem = mmap(0, m_length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mem == MAP_FAILED) {
+          close(fd);
+          return;
+        }
+        madvise(mem, m_length, MADV_SEQUENTIAL);
+        m_bytes = (const u8 *) mem;
+      }
+      close(fd);                // The mapping keeps the file
+      m_open = true;
+      Reset();
+    }
+
+    bool IsOpen() const
+    {
+      return m_open;
+    }
+
+    void Close()
+    {
+      if (m_bytes)
+        munmap((void *) m_bytes, m_length);
+      m_bytes = 0;
+      m_length = 0;
+      m_pos = 0;
+      m_open = false;
+    }
+
+    virtual int ReadByte()
+    {
+      MFM_API_ASSERT_STATE(m_open);
+      m_lastAdvanced = m_pos < m_length;
+      if (!m_lastAdvanced) return -1;
+      return m_bytes[m_pos++];
+    }
+
+    /**
+     * Seek to the given position, fseek-style.  Drops any Unread()
+     * byte.  \return true iff the position is within the file
+     */
+    bool Seek(long offset, int whence) {
+      MFM_API_ASSERT_STATE(m_open);
+      long base = whence == SEEK_SET ? 0 : whence == SEEK_CUR ? Tell() : m_length;
+      long pos = base + offset;
+      if (pos < 0 || pos > m_length) return false;
+      m_pos = pos;
+      Reset();
+      return true;
+    }
+
+    /**
+     * Get the current position, counting an Unread() byte as not
+     * yet read
+     */
+    long Tell() const {
+      MFM_API_ASSERT_STATE(m_open);
+      return m_pos - UnreadCount();
+    }
+
+    /**
+     * Get the mapped bytes from Tell() onward, or null if fewer than
+     * len remain.  Pair with Skip() to consume them.
+     */
+    const u8 * GetBytes(u32 len)
+    {
+      MFM_API_ASSERT_STATE(m_open);
+      if (IsUnread(*this)) {    // Fold any unread byte back into m_pos
+        m_pos -= UnreadCount();
+        Reset();
+      }
+      if (m_length - m_pos < (long) len) return 0;
+      return m_bytes + m_pos;
+    }
+
+    /** Number of bytes from Tell() to the end of the file */
+    long GetRemaining() const {
+      return m_length - Tell();
+    }
+
+    /** Consume len bytes, or everything left if that's fewer */
+    void Skip(u32 len) {
+      GetBytes(0);              // Drop any unread byte
+      m_pos = (m_length - m_pos < (long) len) ? m_length : m_pos + len;
+    }
+  };
+}
+
+#endif /* MAPPEDFILEBYTESOURCE_H */
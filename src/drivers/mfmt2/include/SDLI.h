@@ -4,6 +4,9 @@
 
 #include <map>
 #include <signal.h>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
 
 #include "LineCountingByteSource.h"
 
@@ -41,6 +44,8 @@ namespace MFM {
 
     SDL_Surface* getScreen() { return mScreen; }
 
+    u32 getFramesSkipped() const { return mFramesSkipped; }
+
     void init() ;
 
     Panel & getRootPanel() ;
@@ -86,11 +91,33 @@ namespace MFM {
 
     void doEarlyStartup() ;
     SDL_Surface * doLateStartup() ;
-    
+
+    /* Frames are painted here on the main thread -- the panels read
+       live tile state -- but into one of two offscreen surfaces,
+       which the presenter thread then copies to mScreen and flips, so
+       a slow framebuffer flip doesn't hold up the ITCs.  A frame
+       finished while the last one is still waiting replaces it; if
+       the presenter holds both surfaces, redisplay skips the frame
+       rather than wait. */
+    void startPresenter() ;
+    void stopPresenter() ;
+    void runPresenter() ;
+    SDL_Surface * claimFrame() ;     // 0 if the presenter holds both
+    void presentFrame(SDL_Surface * frame) ;
+
     T2Tile & mTile;
     const u32 mScreenWidth;
     const u32 mScreenHeight;
-    SDL_Surface* mScreen;
+    SDL_Surface* mScreen;           // Only the presenter touches it once started
+
+    SDL_Surface* mFrames[2];
+    SDL_Surface* mPendingFrame;     // Painted, not yet picked up
+    SDL_Surface* mPresentingFrame;  // Being copied to mScreen
+    bool mStopPresenter;
+    u32 mFramesSkipped;
+    std::mutex mPresentLock;        // Guards the four above
+    std::condition_variable mPresentCV;
+    std::thread mPresenter;
 
     bool mShowCursor;
 
@@ -0,0 +1,74 @@
+/* -*- C++ -*- */
+#ifndef SITEOWNERSHIP_H
+#define SITEOWNERSHIP_H
+
+#include "itype.h"
+#include "Point.h"
+
+//Spike files
+#include "T2Constants.h"
+
+namespace MFM {
+
+  struct T2EventWindow; // FORWARD
+
+  /** Which tile sites some event window is holding, kept as one
+      64-bit word per row (bit x for column x), along with the
+      holders themselves.  An event window's diamond footprint is
+      claimed, released, or checked for availability a row at a time
+      with per-radius row masks precomputed at construction, so none
+      of those touch individual sites.  Finding *which* window holds
+      a site scans the holders, which is only needed when there's a
+      conflict to resolve. */
+  struct SiteOwnership {
+
+    SiteOwnership() ;           // Nothing held
+
+    bool isOwned(UPoint tileSite) const {
+      MFM_API_ASSERT_ARG(tileSite.GetX() < T2TILE_WIDTH &&
+                         tileSite.GetY() < T2TILE_HEIGHT);
+      return (mRows[tileSite.GetY()] >> tileSite.GetX()) & 1;
+    }
+
+    /** The bits of row \c y, clipped to the tile, covered by the
+        footprint of radius \c radius around \c center (which may
+        lie outside the tile) */
+    u64 getFootprintRow(SPoint center, u32 radius, s32 y) const ;
+
+    /** true if no site of the footprint is held */
+    bool isFootprintFree(SPoint center, u32 radius) const ;
+
+    /** Hold every site of \c ew's footprint, if none of them is held
+        already.  \returns false, changing nothing, if any was. */
+    bool claim(T2EventWindow * ew, SPoint center, u32 radius) ;
+
+    /** Let go of every site \c ew claimed.  \returns false, changing
+        nothing, if \c ew isn't holding anything. */
+    bool release(T2EventWindow * ew) ;
+
+    /** The window holding \c tileSite, or 0 if it's free */
+    T2EventWindow * getOwner(UPoint tileSite) const ;
+
+  private:
+    struct Holder {
+      T2EventWindow * mEW;
+      SPoint mCenter;
+      u32 mRadius;
+    };
+
+    enum {
+      MAX_RADIUS = MAX_EVENT_WINDOW_RADIUS,
+      MAX_HOLDERS = MAX_EWSLOT * (1 + DIR6_COUNT) // Actives + each ITC's passives
+    };
+
+    /** Bit dx+MAX_RADIUS set for each dx in row dy of a footprint of
+        radius r, indexed [r][dy+MAX_RADIUS] */
+    u64 mRadiusMasks[MAX_RADIUS+1][2*MAX_RADIUS+1];
+
+    u64 mRows[T2TILE_HEIGHT];
+    Holder mHolders[MAX_HOLDERS];
+    u32 mHolderCount;
+  };
+}
+
+#endif /* SITEOWNERSHIP_H */
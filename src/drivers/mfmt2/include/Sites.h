@@ -23,11 +23,30 @@ namespace MFM {
       return mTheSites[at.GetY()][at.GetX()];
     }
 
+    /** true if every site within \c radius of \c center is on the
+        tile, so getEWSite needs no clipping */
+    static bool isInterior(SPoint center, u32 radius) {
+      const s32 r = (s32) radius;
+      return
+        center.GetX() >= r && center.GetX() < T2TILE_WIDTH - r &&
+        center.GetY() >= r && center.GetY() < T2TILE_HEIGHT - r;
+    }
+
+    /** Site number \c sn of an event window at \c center, which must
+        be far enough inside that the site is on the tile.  A table
+        lookup and an add, with no MDist or bounds work per site. */
+    OurT2Site & getEWSite(UPoint center, u32 sn) {
+      MFM_API_ASSERT_ARG(sn < EW_SITES);
+      return getSiteArray()[center.GetY()*T2TILE_WIDTH + center.GetX() + mSNOffsets[sn]];
+    }
+
     Sites() ;
 
   private:
+    enum { EW_SITES = EVENT_WINDOW_SITES(MAX_EVENT_WINDOW_RADIUS) };
     typedef OurT2Site OurT2Sites[T2TILE_HEIGHT][T2TILE_WIDTH];
     OurT2Sites mTheSites;
+    s32 mSNOffsets[EW_SITES];   // getSiteArray() index delta by site number
   };
 }
 #endif /* SITES_H */
@@ -0,0 +1,175 @@
+/* -*- C++ -*- */
+#ifndef T2BULKTRANSFERMANAGER_H
+#define T2BULKTRANSFERMANAGER_H
+
+#include <string>
+#include <map>
+
+#include "T2Types.h"
+#include "TimeoutAble.h"
+#include "T2PacketBuffer.h"
+#include "dirdatamacro.h"  // For DIR6*
+
+namespace MFM {
+
+  /** Windowed, pipelined file distribution over ITC bulk packets.
+
+      A file published on one tile (by dropping it in
+      INJECTION_DIR) is offered to each neighbor, which pulls it in
+      CHUNK_BYTES chunks into STORE_DIR and, as soon as it holds any
+      of it, offers it onward -- so a file streams across the grid
+      hop by hop rather than waiting at each tile for the whole
+      thing.  Every tile checks the SHA256ish digest from the offer
+      once it has every chunk, and starts over on a mismatch.
+
+      Packets, after the routed service header and
+      PKT_HDR_BYTE1_BITMASK_BULK byte, are an op byte, the transfer
+      id (the digest's first four bytes, BEU32) and:
+
+        OFFER    length(BEU32) digest(32) namelen(1) name
+        REQUEST  from(BEU32) window(1) restart(1)
+        CHUNK    index(BEU32) payload(<= CHUNK_BYTES)
+        HAVE     (nothing)
+
+      A REQUEST acknowledges every chunk before \c from and grants
+      \c window more; the puller sends one every half window, and
+      with \c restart set when it sees a gap or goes quiet, which
+      sends the pusher back to \c from.  Partial files are kept by
+      id, so a restarted transfer picks up where it stopped.
+
+      Bulk packets go through their own device, which the LKM ranks
+      below MFM circuit traffic, and at most MAX_PACKETS_PER_TICK are
+      sent per timeout, stopping early whenever the device is full. */
+  struct T2BulkTransferManager : public TimeoutAble {
+    enum {
+      CHUNK_BYTES = 192,        // Payload per CHUNK packet
+      MAX_NAME_LENGTH = 64,
+      WINDOW_CHUNKS = 64,       // Granted per REQUEST
+      MAX_PACKETS_PER_TICK = 128,
+      BUSY_TICK_MS = 10,        // While anything's moving
+      IDLE_TICK_MS = 250,
+      OFFER_MS = 2000,          // Between offers to a quiet neighbor
+      RETRY_MS = 500,           // Quiet puller re-requests after this
+      SOURCE_TIMEOUT_MS = 5000  // .. and gives up on a source after this
+    };
+
+    typedef enum bulkop {
+      BULK_OP_OFFER = 1,
+      BULK_OP_REQUEST = 2,
+      BULK_OP_CHUNK = 3,
+      BULK_OP_HAVE = 4
+    } BulkOp;
+
+    T2BulkTransferManager() ;
+    virtual ~T2BulkTransferManager() ;
+
+    virtual const char * getName() const { return "BulkMgr"; }
+    virtual void onTimeout(TimeQueue& srcTQ) ;
+
+    /** Open the bulk device and start serving.  Logs and stays idle
+        if the device isn't there. */
+    void init() ;
+
+    int close() ;
+
+    /** Offer the file at \c path to the grid as \c name, copying it
+        into STORE_DIR.  \returns false if it couldn't be read */
+    bool publish(const char * path, const char * name) ;
+
+#define ALL_BULK_STATS()                                                \
+    XX(Published,"files published here")                                \
+    XX(Completed,"files received and verified")                         \
+    XX(DigestFailed,"files received with the wrong digest")             \
+    XX(OffersSent,"")                                                   \
+    XX(ChunksSent,"")                                                   \
+    XX(ChunksReceived,"in order")                                       \
+    XX(ChunksDiscarded,"duplicate or out of order")                     \
+    XX(Restarts,"restart requests sent")                                \
+    XX(Stalls,"sends that found the device full")                       \
+
+    typedef enum bulkstat {
+#define XX(NAME,DESC) BULKSTAT_##NAME,
+      ALL_BULK_STATS()
+#undef XX
+      BULKSTAT_COUNT
+    } BulkStat;
+
+    u32 getBulkStat(BulkStat bs) const {
+      MFM_API_ASSERT_ARG(bs < BULKSTAT_COUNT);
+      return mBulkStats[bs];
+    }
+
+    /** Print all the bulk stats on one line */
+    void reportBulkStats(ByteSink & bs) const ;
+
+  private:
+    static const char * const STORE_DIR;
+    static const char * const INJECTION_DIR;
+
+    struct Peer {
+      u32 mAcked;               // Chunks before this are theirs
+      u32 mNext;                // Next chunk to send them
+      u32 mGranted;             // They'll take chunks before this
+      u32 mLastOfferMS;
+      bool mWants;              // They've requested it
+      bool mHas;                // They have all of it
+    };
+
+    struct Transfer {
+      u32 mId;
+      std::string mName;
+      u32 mLength;
+      Bytes32 mDigest;
+      u32 mChunks;
+      u32 mHave;                // Contiguous chunks stored
+      bool mComplete;           // All stored and verified
+      int mFD;                  // The stored (or partial) file
+      s32 mSource;              // Dir6 we're pulling from, or -1
+      u32 mLastHeardMS;         // Last chunk from mSource
+      u32 mLastRequestMS;
+      u32 mRequestedThrough;    // Window end of our last REQUEST
+      Peer mPeers[DIR6_COUNT];
+    };
+
+    typedef std::map<u32,Transfer*> IdToTransfer;
+
+    void checkForInjection() ;
+    void handleInboundTraffic() ;
+    void handleInboundPacket(T2PacketBuffer & pb) ;
+    void handleOffer(Dir6 from, u32 id, CharBufferByteSource & cbbs) ;
+    void handleRequest(Dir6 from, Transfer & xfer, CharBufferByteSource & cbbs) ;
+    void handleChunk(Dir6 from, Transfer & xfer, u32 index, CharBufferByteSource & cbbs) ;
+
+    /** Ship chunks and offers; \returns true if anything's moving */
+    bool serviceTransfers(u32 now) ;
+    bool servicePeer(Transfer & xfer, Dir6 dir6, u32 now, u32 & budget) ;
+    void servicePull(Transfer & xfer, u32 now) ;
+
+    void sendOffer(Transfer & xfer, Dir6 to) ;
+    void sendRequest(Transfer & xfer, bool restart) ;
+    void sendHave(u32 id, Dir6 to) ;
+    bool sendChunk(Transfer & xfer, Dir6 to, u32 index) ;
+    void beginPacket(T2PacketBuffer & pb, Dir6 to, BulkOp op, u32 id) ;
+
+    /** Write \c pb to the bulk device.  \returns 1 if sent, 0 if the
+        device is full, -1 if there's no one there */
+    s32 sendPacket(const T2PacketBuffer & pb) ;
+
+    /** Hash the stored file; \returns true if it matches */
+    bool verify(Transfer & xfer) ;
+    void complete(Transfer & xfer) ;
+
+    Transfer * findTransfer(u32 id) ;
+    Transfer * newTransfer(u32 id, const char * name, u32 length, const Bytes32 digest) ;
+    static bool isSafeName(const char * name) ;
+    std::string partialPath(u32 id) const ;
+    std::string finalPath(const Transfer & xfer) const ;
+
+    IdToTransfer mTransfers;
+    u32 mBulkStats[BULKSTAT_COUNT];
+    bool mStalled;              // Device was full this tick
+    int mFD;
+  };
+}
+
+#endif /* T2BULKTRANSFERMANAGER_H */
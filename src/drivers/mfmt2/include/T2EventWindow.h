@@ -184,7 +184,21 @@ namespace MFM {
     void hogOrUnhogEWSites(T2EventWindow * ewOrNull) ;
     bool isHoggingSites() const { return mIsHoggingSites; }
     
-    bool tryReadEWAtom(ByteSource & in, u32 & sn, OurT2AtomBitVector & bv) ;
+    /** The (sn, atom) updates of one cache update packet */
+    struct CacheUpdateBatch {
+      enum { MAX_UPDATES = EVENT_WINDOW_SITES(MAX_EVENT_WINDOW_RADIUS) };
+      u32 mCount;
+      bool mFinal;               // Ended with the 0xff end-of-update flag
+      u8 mSNs[MAX_UPDATES];      // In the order shipped
+      OurT2AtomBitVector mBits[MAX_UPDATES];
+      CacheUpdateBatch() : mCount(0), mFinal(false) { }
+    };
+
+    /** Decode every update in \c in into \c batch, stopping at the
+        end of the packet, the end-of-update flag, or anything
+        malformed.  false if the packet ended early or held an sn
+        beyond this EW (what decoded before that is kept) */
+    bool decodeCacheUpdates(ByteSource & in, CacheUpdateBatch & batch) ;
 
     void initializeEW() ;
     void finalizeEW() ;
@@ -286,6 +300,15 @@ namespace MFM {
 
     void initPassive(SPoint ctr, u32 radius, bool yoink) ;
     bool checkSiteAvailabilityForPassive() ;
+
+    /** The common case of a RING: if no EW holds any site of the
+        footprint there is no race to resolve, so just hog it and go
+        to PWCACHE, skipping PRESOLVE and loadSites.  Received cache
+        updates are then written back one by one at commit, with no
+        whole-window saveSites.  false (and nothing done) if anything
+        is held; use checkSiteAvailabilityForPassive then. */
+    bool tryClaimFreeSitesForPassive() ;
+
     void commitPassiveEWAndHangUp() ;
     void applyCacheUpdatesPacket(T2PacketBuffer & pb, T2ITC & itc) ;
 
@@ -303,6 +326,13 @@ namespace MFM {
     bool trySendBusy() ;
 
     void resetPassiveEW() ;
+
+  private:
+    void saveUpdatedSites() ; // Updated EW sites only -> tile sites
+
+    bool mDirectUpdates;      // Claimed by tryClaimFreeSitesForPassive
+    u32 mUpdatedSNCount;      // If mDirectUpdates, how many mUpdatedSNs..
+    u8 mUpdatedSNs[EVENT_WINDOW_SITES(MAX_EVENT_WINDOW_RADIUS)]; // ..got cache updates
   };
 
   const char * getEWStateName(EWStateNumber sn) ;
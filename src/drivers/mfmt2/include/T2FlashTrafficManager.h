@@ -12,6 +12,7 @@
 #include "ITCIterator.h"
 #include "T2PacketBuffer.h"
 #include "FlashTraffic.h"
+#include "FlashSeenSet.h"
 #include "Panel.h"
 #include "dirdatamacro.h"  // For DIR6*
 #include "T2Utils.h"
@@ -36,6 +37,24 @@ namespace MFM {
   typedef std::multiset<TimedFlashTraffic> MultisetTimedFlashTraffic;
   typedef std::map<u16,FlashTraffic> OriginKeyToFlashTraffic;
 
+#define ALL_FLASH_STATS()                                               \
+  XX(Received,"packets arrived")                                        \
+  XX(BadChecksum,"rejected for checksum")                               \
+  XX(Accepted,"new commands accepted")                                  \
+  XX(CrossOrigin,"propagated but held from another origin")             \
+  XX(PendingDupe,"suppressed: same packet pending")                     \
+  XX(LingeringDupe,"suppressed: same packet recently executed")         \
+  XX(LateDupe,"suppressed: matches origin's previous command")          \
+  XX(Propagated,"copies sent to neighbors")                             \
+  XX(SeenEvicted,"live seen-set entries evicted for room")              \
+
+  typedef enum flashstat {
+#define XX(NAME,DESC) FLASHSTAT_##NAME,
+    ALL_FLASH_STATS()
+#undef XX
+    FLASHSTAT_COUNT
+  } FlashStat;
+
   struct T2FlashTrafficManager : public TimeoutAble {
     typedef TimeoutAble Super;
 
@@ -94,6 +113,14 @@ namespace MFM {
 
     int close() ;
 
+    u32 getFlashStat(FlashStat fs) const {
+      MFM_API_ASSERT_ARG(fs < FLASHSTAT_COUNT);
+      return mFlashStats[fs];
+    }
+
+    /** Print all the flash stats on one line */
+    void reportFlashStats(ByteSink & bs) const ;
+
   private:
 #if 0
     PanelSuffixToFlashCmd m_suffixToCmd;
@@ -131,6 +158,8 @@ namespace MFM {
     //    FlashTraffic mPreparedCmd;
     OriginKeyToFlashTraffic mOriginKeyToFlashTraffic;
     MultisetTimedFlashTraffic mMultisetTimedFlashTraffic;
+    FlashSeenSet mSeenSet;      // Mirrors mMultisetTimedFlashTraffic, and then some
+    u32 mFlashStats[FLASHSTAT_COUNT];
 
     int open() ;
     const char * path() const ;
@@ -20,6 +20,8 @@
 #include "TimeoutAble.h"
 #include "ITCIterator.h"
 #include "RectIterator.h"
+#include "Sites.h"
+#include "T2TileStats.h"
 
 #define ALL_CIRCUITS_BUSY 0xff
 
@@ -112,9 +114,7 @@ namespace MFM {
     const Rect & getVisibleAndCacheRect() const ;
     const Rect & getNeighborOwnedRect() const ;
 
-    u32 activeCircuitsInUse() const { return mActiveEWCircuitCount; }
-
-    s8 getYoinkVal(CircuitNum cn, bool forActive) const ;
+    u32 activeCircuitsInUse() const { return __builtin_popcount(mActiveEWCircuitBits); }
 
     void reset() ;             // Perform reset actions and enter ITCSN_INIT
 
@@ -144,6 +144,23 @@ namespace MFM {
 
     bool trySendPacket(T2PacketBuffer &pb) ;
 
+    /** Add pb to the outbound queue, flushing first if the queue is
+        full.  Returns false if there's still no room. */
+    bool queuePacket(const T2PacketBuffer &pb) ;
+
+    /** An empty packet at the tail of the outbound queue, to be built
+        in place and then queued by commitOutboundPacket -- or just
+        abandoned, by not committing it.  Flushes first if the queue is
+        full; returns 0 if there's still no room. */
+    T2PacketBuffer * beginOutboundPacket() ;
+    void commitOutboundPacket() ;
+
+    /** Ship as much of the outbound queue as the LKM will take, in a
+        single writev(2).  Returns the number of packets shipped. */
+    u32 flushPackets() ;
+
+    u32 getPacketsQueued() const { return mOutboundCount; }
+
     void hangUpPassiveEW(T2EventWindow & ew, CircuitNum cn) ;
 
 
@@ -165,13 +182,17 @@ namespace MFM {
 
     //// HELPERs
     u32 getPacketsShipped() const { return mPacketsShipped; }
+    T2ITCStats & getStats() ;
+    void noteRingSent(Circuit & ci) ;
+    void noteRingReplied(const Circuit & ci, bool answered) ;
     u32 getCompatibilityStatus() ; // 0 closed 1 unknown compat 2 known compat
     s32 resolveLeader(ITCStateNumber theirimputedsn) ;
     void leadFollowOrReset(ITCStateNumber theirimputedsn) ;
     void startCacheSync() ;
     bool sendVisibleAtoms(T2PacketBuffer & pb) ;
     bool recvCacheAtoms(T2PacketBuffer & pb) ;
-    bool tryReadAtom(ByteSource & in, UPoint & where, OurT2AtomBitVector & bv) ;
+    bool recvCacheDigest(ByteSource & in) ;
+    bool recvCacheSites(ByteSource & in) ;
     void initStatePacket(T2PacketBuffer & pb) const ;
 
     const char * path() const;
@@ -179,8 +200,31 @@ namespace MFM {
     int close() ;
     int getFD() const { return mFD; }
 
+    /** true if the FDReactor wakes the packet poller for our fd */
+    bool isFDWatched() const { return mFDWatched; }
+
+    /* CACHEXG packets: the ITC header alone marks the end of the
+       sync; otherwise one of these kinds follows it */
+    enum {
+      CACHEXG_DIGEST = 1,       // u8 first block, then u32 block hashes
+      CACHEXG_SITES = 2,        // u16 first site, then site runs
+
+      // Site run opcodes, low bits hold the run length
+      CACHEXG_RUN_ATOMS = 0x00, // len atoms follow, len < 0x40
+      CACHEXG_RUN_SAME = 0x40,  // len sites unchanged, len < 0x40
+      CACHEXG_RUN_EMPTY = 0x80, // len empty sites, len < 0x80
+
+      CACHE_BLOCK_SITES = 8,    // Sites per digest hash
+      MAX_CACHE_SYNC_SITES =
+        CACHE_LINES*(T2TILE_WIDTH > T2TILE_HEIGHT ? T2TILE_WIDTH : T2TILE_HEIGHT),
+      MAX_CACHE_BLOCKS = (MAX_CACHE_SYNC_SITES+CACHE_BLOCK_SITES-1)/CACHE_BLOCK_SITES,
+      MAX_DIGEST_WAITS = 8      // CACHEXG timeouts to wait for their digest
+    };
+
   private:
 
+    void notePacketShipped(const char * bytes, s32 len) ;
+
     u32 mPacketsShipped;
     ITCStateNumber mStateNumber;
     T2ITCStateOps & getT2ITCStateOps() {
@@ -191,17 +235,36 @@ namespace MFM {
     const T2ITCStateOps & getT2ITCStateOps() const;
 
     int mFD;
+    bool mFDWatched;
 
     Circuit *(mActiveEWCircuits[MAX_EWSLOT]); // Links to in-use active EWs
-    u32 mActiveEWCircuitCount;                // # of non-zero
+    u32 mActiveEWCircuitBits;                 // Bit cn set iff mActiveEWCircuits[cn]
     
     T2PassiveEventWindow * mPassiveEWs[MAX_EWSLOT]; // All our passive EWs
 
+    static u32 hashCacheBlock(Sites & sites, const Rect & rect, u32 block) ;
+    void queueCacheDigest(const T2PacketBuffer & pb) ;
+    u32 getCacheRunLength(u32 site, u32 & opcode) const ;
+
     u32 mCacheAtomsSent;
-    RectIterator mVisibleAtomsToSend;
+    u32 mCacheSiteToSend;       // Next visible site, in row-major order
+    bool mCacheDigestSent;
+    u32 mCacheDigestWaits;
+    u32 mPeerDigestBlocks;      // Valid leading entries of mPeerDigest
+    u32 mPeerDigest[MAX_CACHE_BLOCKS]; // Their cache is our visible
+    bool mSameBlock[MAX_CACHE_BLOCKS]; // Visible blocks they already have
     u32 mCacheAtomsReceived;
     bool mCacheReceiveComplete;
 
+    enum { MAX_OUTBOUND_PACKETS = 16 }; // Packets per writev(2)
+    T2PacketBuffer mOutbound[MAX_OUTBOUND_PACKETS]; // Ring, from mOutboundHead
+    u32 mOutboundHead;
+    u32 mOutboundCount;
+
+    T2PacketBuffer & getOutbound(u32 i) {
+      return mOutbound[(mOutboundHead + i) % MAX_OUTBOUND_PACKETS];
+    }
+
   };
 
 }
@@ -0,0 +1,132 @@
+/* -*- C++ -*- */
+#ifndef T2LOOP_H
+#define T2LOOP_H
+
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "itype.h"
+#include "Random.h"
+
+#include "T2Types.h"
+#include "T2TileStats.h"
+
+namespace MFM {
+
+  /** A packet in flight across a loopback link */
+  struct LoopPacket {
+    u64 mDueUsec;               // When it reaches the far end
+    u32 mLength;
+    u8 mBytes[255];
+  };
+
+  /** One tile's ITC in one direction: the socket T2Loop listens on
+      for it, the tile's connection if it has one, and the packets on
+      their way to it */
+  struct LoopEnd {
+    LoopEnd() ;
+    u32 mTile;                  // Index into T2Loop::mTiles
+    Dir6 mDir6;
+    s32 mPeer;                  // Linked end, or -1 at the grid edge
+    int mListenFD;
+    int mFD;                    // -1 unless the tile is connected
+    u64 mWireFreeUsec;          // When the wire toward us next goes idle
+    std::deque<LoopPacket> mInbound;
+  };
+
+  /** One tile in the loopback grid, and what we last saw of its
+      exported stats */
+  struct LoopTile {
+    LoopTile() ;
+    u32 mX;
+    u32 mY;
+    std::string mDir;           // What the tile gets as --loopback
+    int mStatusFD;
+    const u8 * mStats;          // Its T2StatsExporter map, once it has one
+    T2TileStats mLast;          // As of the last report
+    bool mHaveLast;
+  };
+
+  /** Relay counters, over one report interval or the whole run */
+  struct LoopCounts {
+    LoopCounts() ;
+    void add(const LoopCounts & other) ;
+    u64 mPackets;               // Delivered to a tile
+    u64 mBytes;
+    u64 mLost;                  // Dropped at random, by --loss
+    u64 mDown;                  // No tile on the far end to take it
+    u64 mFull;                  // Far end already had MAX_INBOUND waiting
+    u64 mLocal;                 // Not standard routed; the LKM's business
+  };
+
+  /** Runs a WxH grid of T2 tiles on one host, off the hardware.  Each
+      tile is an mfmt2 given --loopback DIR/tile-X-Y; T2Loop stands in
+      for the ITC kernel modules and the wires between them, relaying
+      every standard routed packet to the facing ITC of the
+      neighboring tile -- after a given latency, at a given
+      bandwidth, and with a given random loss -- and maintaining each
+      tile's ITC status file to match who's connected.  It reports
+      relay throughput plus the tiles' event rates and circuit RTTs,
+      as read from their stats exports.
+
+      Tiles sit in 'odd-r' hex rows, with odd rows shifted half a tile
+      east, so ET links to WT, NE to SW, and NW to SE. */
+  struct T2Loop {
+    enum {
+      MAX_TILES = 64,
+      MAX_INBOUND = 1024,       // Packets waiting on one end before we drop
+      MAX_PACKET_SIZE = 255
+    };
+
+    T2Loop() ;
+    ~T2Loop() ;
+
+    int main(int argc, char ** argv) ;
+
+  private:
+    void processArgs(int argc, char ** argv) ;
+    void setUp() ;
+    void tearDown() ;
+    void run() ;
+
+    s32 getNeighborTile(u32 tile, Dir6 dir6) const ;
+    bool isLinked(const LoopEnd & end) const ;
+
+    void acceptOn(LoopEnd & end) ;
+    void disconnect(LoopEnd & end) ;
+    void dropInbound(LoopEnd & end) ;
+    void readFrom(LoopEnd & end, u64 now) ;
+    void forward(LoopEnd & from, const u8 * bytes, u32 len, u64 now) ;
+    void deliverTo(LoopEnd & end, u64 now) ;
+    u64 getNextDueUsec() const ;
+
+    void writeStatus(u32 tile) ;
+    bool mapStats(LoopTile & tile) ;
+    bool sampleStats(LoopTile & tile, T2TileStats & stats) ;
+    void report(u64 now) ;
+
+    static u64 nowUsec() ;
+
+    const char * mDir;
+    u32 mWidth;
+    u32 mHeight;
+    u32 mLatencyUsec;
+    u32 mBandwidth;             // Bytes/sec per link direction, 0 for unlimited
+    u32 mLossPPM;
+    u32 mSeed;
+    u32 mReportSecs;
+    u32 mDurationSecs;          // 0 to run until killed
+    Random mRandom;
+
+    std::vector<LoopTile> mTiles;
+    std::vector<LoopEnd> mEnds; // DIR6_COUNT per tile
+
+    LoopCounts mInterval;
+    LoopCounts mTotal;
+    u64 mStartUsec;
+    u64 mLastReportUsec;
+  };
+}
+
+#endif /* T2LOOP_H */
@@ -0,0 +1,85 @@
+/* -*- C++ -*- */
+#ifndef T2STATSEXPORT_H
+#define T2STATSEXPORT_H
+
+#include "itype.h"
+
+//Spike files
+#include "T2TileStats.h"
+#include "TimeoutAble.h"
+
+namespace MFM {
+
+  /** Fixed binary layout of the exported stats.  A T2StatsExportHeader
+      is followed by the tile counters (in ALL_TILE_STAT_U64S order)
+      and then, for each Dir6, the ITC counters (in ALL_ITC_STAT_U64S
+      order, then mRTTSumUsec and the mRTTHist buckets), all u64s in
+      host byte order.  Bump T2STATS_EXPORT_VERSION whenever that
+      changes.
+
+      To take a consistent sample, a reader loads mSequence, skipping
+      the sample if it's odd (an update is in progress), copies what
+      it wants, and then checks that mSequence hasn't changed. */
+  enum {
+    T2STATS_EXPORT_MAGIC = 0x54325354, // 'T2ST'
+    T2STATS_EXPORT_VERSION = 1
+  };
+
+  struct T2StatsExportHeader {
+    u32 mMagic;
+    u16 mVersion;
+    u16 mHeaderBytes;           // Offset of the tile counters
+    u32 mSequence;              // Odd while being updated
+    u32 mTileCounters;          // u64s in the tile section
+    u32 mITCCounters;           // u64s in each ITC section
+    u32 mITCCount;              // ITC sections
+    u32 mResetSeconds;          // When the stats were last reset
+    u32 mUpdateSeconds;         // When this sample was written
+  };
+
+  /** Periodically copies the T2TileStats into a shared memory file,
+      in the T2StatsExportHeader layout, so outside collectors can
+      sample the counters by just mapping it -- no syscalls or locks
+      on our side, and nothing for them to wait on. */
+  struct T2StatsExporter : public TimeoutAble {
+    enum {
+      UPDATE_MS = 250,
+      TILE_COUNTERS = 0
+#define XX(NM,CM) + 1
+      ALL_TILE_STAT_U64S()
+#undef XX
+      ,
+      ITC_COUNTERS = 1 + T2ITCStats::RTT_BUCKETS // mRTTSumUsec and mRTTHist
+#define XX(NM,CM) + 1
+      ALL_ITC_STAT_U64S()
+#undef XX
+      ,
+      EXPORT_BYTES = sizeof(T2StatsExportHeader) +
+        8 * (TILE_COUNTERS + DIR6_COUNT * ITC_COUNTERS)
+    };
+
+    T2StatsExporter(const char * path) ;
+    ~T2StatsExporter() ;
+
+    virtual void onTimeout(TimeQueue& srctq) ;
+    virtual const char* getName() const { return "StatsExporter"; }
+
+    /** Write the sample \c stats into the export, opening it first if
+        need be.  \returns false if the export is unavailable. */
+    bool update(const T2TileStats & stats) ;
+
+    /** Export to \c path (which must outlive us) instead.  Only
+        before the first update. */
+    void setPath(const char * path) ;
+
+  private:
+    bool openExport() ;
+
+    const char * mPath;
+    T2StatsExportHeader * mHeader; // 0 until mapped
+    u64 * mCounters;               // Just past mHeader
+    bool mFailed;                  // Gave up on mapping
+  };
+}
+
+#endif /* T2STATSEXPORT_H */
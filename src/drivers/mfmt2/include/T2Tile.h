@@ -26,10 +26,14 @@
 #include "SDLI.h"
 #include "ADCCtl.h"
 #include "Sites.h"
+#include "EventSiteSampler.h"
+#include "SiteOwnership.h"
 #include "Trace.h"
 #include "CPUFreq.h"
 #include "T2TileStats.h"
+#include "T2StatsExport.h"
 #include "T2FlashTrafficManager.h"
+#include "T2BulkTransferManager.h"
 #include "T2UIComponents.h"
 #include "TraceLogInfo.h" /*for TraceLogInfo, TraceLogDirManager */
 #include "UlamEventSystem.h"
@@ -101,16 +105,82 @@ namespace MFM {
     u32 mInitiations;
   };
 
-  struct CoreTempChecker : public TimeoutAble {
-    CoreTempChecker() ;
+  /** Sets the CPU speed from the tile's recent load, within a
+      ceiling from the ADC readings.  Each check compares the
+      T2TileStats accrued since the last one: a tile launching
+      nonempty events for a good share of what it considers, or
+      ringing its neighbors a lot per event (i.e., busy at the
+      boundary), steps up a speed; a mostly empty one steps down.
+      The ceiling drops a step whenever the core is over its
+      temperature budget (settable with --cputemp), and more when the
+      core temperature or grid voltage levels say so. */
+  struct CPUGovernor : public TimeoutAble {
+    enum {
+      BUSY_PERMIL = 250,        // Nonempty per considered to speed up
+      IDLE_PERMIL = 50,         // .. and below which to slow down
+      BOUNDARY_PERMIL = 100     // Rings sent per nonempty to speed up
+    };
+    CPUGovernor() ;
     virtual void onTimeout(TimeQueue& srctq) ;
-    virtual const char* getName() const { return "CoreTempChk"; }
+    virtual const char* getName() const { return "CPUGovernor"; }
+
+    /** Slow down while the core is above \c degf (0 for no budget
+        beyond the core temperature levels) */
+    void setMaxCoreTemperature(double degf) { mMaxCoreDegF = degf; }
+
+  private:
+    CPUSpeed getCeiling(T2Tile & tile, CPUSpeed last) ;
+    CPUSpeed getDemand(const T2TileStats & samp, CPUSpeed last) ;
+
+    T2TileStats mLastStats;
+    bool mHaveLastStats;
+    double mMaxCoreDegF;
+  };
+
+  /** Rebalances the active EW pool against the passive side.  Every
+      passive EW is bound to a neighbor's active slot, so passives
+      can't be added; what pushes neighbors into BUSY is our actives
+      hogging the sites their passives need.  So when we refuse too
+      many of their rings we run fewer actives at once, and when we
+      are refusing few, and our own actives are running out with few
+      refusals coming back, we run more. */
+  struct EWPoolGovernor : public TimeoutAble {
+    enum {
+      MIN_ACTIVE_EWS = 2,
+      PASSIVE_BUSY_PERMIL = 200, // Busys sent per ring received to shrink
+      ACTIVE_BUSY_PERMIL = 100   // Busys received per ring sent to grow
+    };
+    EWPoolGovernor() ;
+    virtual void onTimeout(TimeQueue& srctq) ;
+    virtual const char* getName() const { return "EWPoolGovernor"; }
+
+  private:
+    u32 getDemand(const T2TileStats & samp, u64 refused, u32 last) ;
+
+    T2TileStats mLastStats;
+    bool mHaveLastStats;
+    u64 mLastRefused;
   };
 
+  /** Tracks the kernel ITC enable status per direction.  If the
+      driver sysfs_notify()s its status file, poll() flags each
+      change with POLLPRI -- which also has the FDReactor bump us --
+      and the status is only re-read then (plus an occasional safety
+      read); until a notification has been seen, every timeout
+      re-reads it as before. */
   struct KITCPoller : public TimeoutAble {
+    enum {
+      SAFETY_READ_INTERVAL = 30  // Timeouts between unprompted reads, once notifying
+    };
     virtual void onTimeout(TimeQueue& srctq) ;
     virtual const char* getName() const { return "KITCPoller"; }
     KITCPoller(T2Tile& tile) ;
+    /** Open the ITC status file -- the kernel's, or T2Loop's when
+        running on loopback ITCs -- and start polling it.  Called
+        once the command line has been processed. */
+    void init() ;
+    /** true once the status file has been seen to notify changes */
+    bool isNotifying() const { return mNotifying; }
     static u32 getKITCEnabledStatusFromStatus(u32 status, Dir8 dir8) {
       return (status>>(dir8<<2))&0xf;
     }
@@ -123,6 +193,12 @@ namespace MFM {
     ITCIteration mITCIteration;
     s32 mKITCStatusFD;
     u32 mKITCEnabledStatus;
+    bool mNotifying;
+    u32 mTimeoutsSinceRead;
+  private:
+    /** Has the status file changed since we last read it? */
+    bool statusChangeNotified() ;
+    void readKITCStatus() ;
   };
 
   typedef MDist<4> OurMDist;
@@ -185,6 +261,8 @@ namespace MFM {
     ADCCtl & getADCCtl() { return mADCCtl; }
 
     T2FlashTrafficManager & getFlashTrafficManager() { return mFlashTrafficManager; }
+    T2BulkTransferManager & getBulkTransferManager() { return mBulkTransferManager; }
+    T2ITCPacketPoller & getPacketPoller() { return mPacketPoller; }
 
     UlamEventSystem & getUlamEventSystem() { return mUlamEventSystem; }
     void setUlamLibraryPath(const char * path) ;
@@ -195,6 +273,51 @@ namespace MFM {
       return mTraceLoggerPtr != 0;
     }
 
+    /** True if a \c ttc record should be built and tlog'd now:
+        tracing is active, \c ttc is enabled, and this record is one
+        of its sample.  Call sites check this before constructing the
+        Trace, so a suppressed record costs a mask test and a
+        countdown.  Each false while tracing is active counts as
+        suppressed. */
+    bool isTracing(TraceTypeCode ttc) {
+      if (!mTraceLoggerPtr) return false;
+      if ((mTraceTypeMask & (1u<<ttc)) && mTraceSkip[ttc]-- == 0) {
+        mTraceSkip[ttc] = mTraceRandom.GeometricSkip(mTraceOneIn[ttc]);
+        return true;
+      }
+      ++mTraceSuppressed[ttc];
+      return false;
+    }
+
+    void setTraceTypeEnabled(TraceTypeCode ttc, bool enabled) ;
+    bool isTraceTypeEnabled(TraceTypeCode ttc) const {
+      MFM_API_ASSERT_ARG(ttc < TTC_COUNT);
+      return mTraceTypeMask & (1u<<ttc);
+    }
+
+    /** Trace about one in \c oneIn of the \c ttc records (1 for all) */
+    void setTraceSampling(TraceTypeCode ttc, u32 oneIn) ;
+    u32 getTraceSampling(TraceTypeCode ttc) const {
+      MFM_API_ASSERT_ARG(ttc < TTC_COUNT);
+      return mTraceOneIn[ttc];
+    }
+
+    /** Apply a comma-separated list of trace types to enable, each
+        either a whole group ('ITC') or one type ('ITC_PacketIn'), and
+        '-' prefixed to disable instead.  The first entry starts from
+        nothing enabled unless it's a disable.  \returns false, having
+        changed nothing, if any entry isn't a trace type */
+    bool parseTraceTypes(const char * list) ;
+
+    u64 getTraceSuppressed(TraceTypeCode ttc) const {
+      MFM_API_ASSERT_ARG(ttc < TTC_COUNT);
+      return mTraceSuppressed[ttc];
+    }
+    u64 getTraceSuppressedTotal() const ;
+
+    /** Print the suppressed counts of the types that have any */
+    void reportTraceSuppressed(ByteSink & bs) const ;
+
     bool tlog(const Trace & tb) ;
 
     TraceLogDirManager & getTraceLogDirManager() { return mTraceLogDirManager; }
@@ -210,6 +333,10 @@ namespace MFM {
     void traceEventStats() ;
 
     // HIGH LEVEL SEQUENCING
+    enum { MAX_IDLE_WAIT_MS = 100 }; // So isDone() gets checked
+
+    /** Run whatever's due off the TimeQueue, sleeping in the
+        FDReactor (at most MAX_IDLE_WAIT_MS) when nothing is */
     void main() ;
     void earlyInit() ;
     void initEverything(int argc, char **argv) ;
@@ -236,11 +363,31 @@ namespace MFM {
 
     void setWindowConfigPath(const char * path) ;
 
+    /** Run on the loopback ITCs that T2Loop serves under \c dir,
+        rather than the kernel's /dev/itc and its sysfs status */
+    void setLoopbackDir(const char * dir) ;
+    const char * getLoopbackDir() const { return mLoopbackDir; }
+    bool isLoopback() const { return mLoopbackDir != 0; }
+
     T2ActiveEventWindow & getActiveEW(u32 idx) {
       MFM_API_ASSERT_ARG(idx<MAX_EWSLOT);
       return *mEWs[idx];
     }
 
+    /** Most active EWs allowed in use at once; EWPoolGovernor moves
+        it between EWPoolGovernor::MIN_ACTIVE_EWS and MAX_EWSLOT */
+    u32 getActiveEWLimit() const { return mActiveEWLimit; }
+    void setActiveEWLimit(u32 limit) ;
+
+    u32 getActiveEWsInUse() const { return MAX_EWSLOT - mFree.mMembers.size(); }
+    u32 getActiveEWsHighWater() const { return mActiveEWsHighWater; }
+    u64 getActiveEWsRefused() const { return mActiveEWsRefused; }
+
+    u32 getPassiveEWsInUse() const { return mPassiveEWsInUse; }
+    u32 getPassiveEWsHighWater() const { return mPassiveEWsHighWater; }
+    void notePassiveEWStarted() ;
+    void notePassiveEWDone() ;
+
     T2ITC & getITC(u32 dir6) {
       MFM_API_ASSERT_ARG(dir6 < DIR6_COUNT);
       return mITCs[dir6];
@@ -267,21 +414,33 @@ namespace MFM {
     Sites& getSites() { return mSites; }
     OurMDist & getMDist() { return mMDist; }
     T2EventWindow * getSiteOwner(UPoint idx) {
-      MFM_API_ASSERT_ARG(idx.GetX() < T2TILE_WIDTH &&
-                         idx.GetY() < T2TILE_HEIGHT);
-      return mSiteOwners[idx.GetX()][idx.GetY()];
+      return mSiteOwnership.getOwner(idx);
     }
 
-    void setSiteOwner(UPoint idx,T2EventWindow * owner) {
-      // Stay in bounds
-      MFM_API_ASSERT_ARG(idx.GetX() < T2TILE_WIDTH &&
-                         idx.GetY() < T2TILE_HEIGHT);
-      // Only set when clear or clear when set
-      MFM_API_ASSERT_ARG((mSiteOwners[idx.GetX()][idx.GetY()] == 0) !=
-                         (owner == 0));
-      mSiteOwners[idx.GetX()][idx.GetY()] = owner;
+    bool isSiteOwned(UPoint idx) const {
+      return mSiteOwnership.isOwned(idx);
     }
 
+    bool isFootprintFree(SPoint center, u32 radius) const {
+      return mSiteOwnership.isFootprintFree(center, radius);
+    }
+
+    /** Hold the footprint of radius \c radius around \c center for
+        \c ew.  \returns false, holding nothing, if any of it is
+        held already */
+    bool hogSites(T2EventWindow * ew, SPoint center, u32 radius) ;
+
+    /** Release whatever \c ew is holding.  \returns false if it
+        held nothing */
+    bool unhogSites(T2EventWindow * ew, SPoint center, u32 radius) ;
+
+    /** Call after changing the atom at idx, to keep the
+        EventSiteSampler current */
+    void noteSiteChanged(UPoint idx) ;
+
+    /** noteSiteChanged for each owned site of a footprint */
+    void noteFootprintChanged(SPoint center, u32 radius) ;
+
     const Rect & getOwnedRect() const {
       return mOwnedRect;
     }
@@ -316,6 +475,8 @@ namespace MFM {
     const char * getWindowConfigPath() { return mWindowConfigPath; }
 
     CPUFreq & getCPUFreq() { return mCPUFreq; }
+    CPUGovernor & getCPUGovernor() { return mCPUGovernor; }
+    EWPoolGovernor & getEWPoolGovernor() { return mEWPoolGovernor; }
 
     void closeFDs() ;
 
@@ -323,6 +484,13 @@ namespace MFM {
     TraceLogger* mTraceLoggerPtr;
     TraceLogDirManager mTraceLogDirManager;
 
+    static_assert(TTC_COUNT <= 32, "mTraceTypeMask too small");
+    u32 mTraceTypeMask;            // Bit per TraceTypeCode
+    u32 mTraceOneIn[TTC_COUNT];
+    u32 mTraceSkip[TTC_COUNT];     // Records to suppress before the next
+    u64 mTraceSuppressed[TTC_COUNT];
+    Random mTraceRandom;           // Not the tile's, so sampling doesn't perturb events
+
     int mArgc;
     char ** mArgv;
     OString64 mMFZTag;
@@ -392,7 +560,9 @@ namespace MFM {
     T2ActiveEventWindow * mEWs[MAX_EWSLOT];
 
     u32 considerSiteForEW(UPoint idx) ;
-    u32 getRadius(const OurT2Atom & atom) ; // STUB UNTIL UCR EXISTS
+    /** Event window radius for \a atom's element, from its
+        GetEventWindowBoundary; 0 for empty */
+    u32 getRadius(const OurT2Atom & atom) ;
     void recordCompletedEvent(OurT2Site & site) ;
 
     const char * coordMap(u32 x, u32 y) const ;
@@ -402,6 +572,11 @@ namespace MFM {
     T2ActiveEventWindow * allocEW() ;
 
     EWSet mFree;
+    u32 mActiveEWLimit;
+    u32 mActiveEWsHighWater;
+    u64 mActiveEWsRefused;      // allocEW calls over the limit or out of EWs
+    u32 mPassiveEWsInUse;       // Over all ITCs
+    u32 mPassiveEWsHighWater;
     void initTimeQueueDrivers() ;
 
     SDLI mSDLI;
@@ -411,7 +586,8 @@ namespace MFM {
 
     Sites mSites;
 
-    T2EventWindow * mSiteOwners[T2TILE_WIDTH][T2TILE_HEIGHT];
+    SiteOwnership mSiteOwnership;
+    EventSiteSampler mEventSiteSampler; // Which owned sites could launch an aEW
     EWInitiator mEWInitiator;
     KITCPoller mKITCPoller;
     bool mLiving;
@@ -423,10 +599,16 @@ namespace MFM {
 
     //// STATS
     T2TileStats mT2TileStats;
+    T2StatsExporter mStatsExporter;
+
+    //// LOOPBACK ITCS (0 for the hardware ones)
+    const char * mLoopbackDir;
+    OString256 mLoopbackStatsPath;
 
     //// HW CONTROL & MISC
     CPUFreq mCPUFreq;
-    CoreTempChecker mCoreTempChecker;    
+    CPUGovernor mCPUGovernor;
+    EWPoolGovernor mEWPoolGovernor;
 
     //// Active Radio Groups
     MFMRunRadioGroup mMFMRunRadioGroup;
@@ -434,6 +616,9 @@ namespace MFM {
     //// FLASH TRAFFIC MANAGEMENT
     T2FlashTrafficManager mFlashTrafficManager;
 
+    //// BULK FILE DISTRIBUTION
+    T2BulkTransferManager mBulkTransferManager;
+
     void initRollingTraceDir(u32 targetMB) ;
     void rollTracing() ;
 
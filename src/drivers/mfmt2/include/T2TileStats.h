@@ -4,6 +4,9 @@
 
 #include "UniqueTime.h"
 
+#include "dirdatamacro.h"
+#include "T2Types.h" /* for Dir6 */
+
 #define ALL_TILE_STAT_U64S()                                       \
   XX(EventsConsidered,"whether or not an aEW launched")            \
   XX(EmptyEventsCommitted,"by doing nothing")                      \
@@ -11,9 +14,57 @@
   XX(NonemptyTransitionsStarted,"#executeEvent entries")           \
   XX(NonemptyEventsCommitted,"w/o failure during transition")      \
 
+#define ALL_ITC_STAT_U64S()                                        \
+  XX(RingsSent,"lock requests, as active side")                    \
+  XX(AnswersReceived,"rings granted")                              \
+  XX(BusysReceived,"rings refused")                                \
+  XX(DropsSent,"locks abandoned, as active side")                  \
+  XX(YoinkRacesWon,"crossed rings we kept")                        \
+  XX(YoinkRacesLost,"crossed rings we gave up")                    \
+  XX(RingsReceived,"lock requests, as passive side")               \
+  XX(BusysSent,"rings refused, as passive side")                   \
+
 namespace MFM {
+  /** Circuit telemetry for one ITC: counts by outcome, plus a log2
+      histogram of ring-to-answer (or ring-to-busy) times as seen by
+      our active side. */
+  struct T2ITCStats {
+    enum {
+      RTT_BUCKETS = 12,         // Last bucket is everything slower
+      RTT_MIN_USEC_BITS = 6     // Bucket 0 is under 64us, then doubling
+    };
+    void saveRaw(ByteSink& bs) const ;
+    bool loadRaw(ByteSource& bs) ;
+    void reset() ;
+    T2ITCStats operator-(const T2ITCStats & rhs) const ;
+
+    void recordRTT(u32 usec) ;
+    u64 getRTTCount() const ;
+    u64 getRTTBucketCount(u32 bucket) const ;
+    u32 getRTTMeanUsec() const ;
+
+    /** Upper edge of the bucket holding the qth quantile, or 0 with
+        no samples, or U32_MAX if it's in the last bucket */
+    u32 getRTTQuantileUsec(double q) const ;
+    static u32 getRTTBucketLimitUsec(u32 bucket) ; // exclusive
+    static u32 getRTTBucket(u32 usec) ;
+
+    static u32 nowUsec() ;      // Monotonic, wraps every ~71 minutes
+
+#define XX(NM,CM)                         \
+    u64 m##NM; /* CM */                   \
+    u64 get##NM() const { return m##NM; } \
+    void incr##NM() { ++m##NM; }          \
+
+    ALL_ITC_STAT_U64S()
+#undef XX
+    u64 mRTTSumUsec;
+    u64 mRTTHist[RTT_BUCKETS];
+  };
+
   struct T2TileStats {
-    void saveRaw(ByteSink& bs) ;
+    /** Saves the tile counters, then (if withITCs) each ITC's stats */
+    void saveRaw(ByteSink& bs, bool withITCs = true) ;
     bool loadRaw(ByteSource& bs) ;
     void reset() ;
     u32 getResetSeconds() const { return mResetSeconds; }
@@ -29,6 +80,16 @@ namespace MFM {
 
     ALL_TILE_STAT_U64S()
 #undef XX      
+
+    T2ITCStats & getITCStats(Dir6 dir6) {
+      MFM_API_ASSERT_ARG(dir6 < DIR6_COUNT);
+      return mITCStats[dir6];
+    }
+    const T2ITCStats & getITCStats(Dir6 dir6) const {
+      MFM_API_ASSERT_ARG(dir6 < DIR6_COUNT);
+      return mITCStats[dir6];
+    }
+    T2ITCStats mITCStats[DIR6_COUNT];
   };
 
 }
@@ -8,9 +8,13 @@
 #include <stdarg.h>
 
 #include <map>
+#include <atomic>
+#include <mutex>
+#include <thread>
 
 #include "itype.h"
 #include "FileByteSource.h"
+#include "MappedFileByteSource.h"
 #include "FileByteSink.h"
 #include "CharBufferByteSource.h"
 #include "OverflowableCharBufferByteSink.h"
@@ -36,6 +40,7 @@ namespace MFM {
   XX(EW,SCH,StateChange)                        \
   XX(EW,CTR,AssignCenter)                       \
   XX(EW,CSC,CircuitStateChange)                 \
+  XX(ITC,STS,StatsSnapshot) /*appended: codes are on disk*/ \
 
 
   enum TraceTypeCode {
@@ -160,6 +165,18 @@ namespace MFM {
     ~Trace() { }
 
     void printPretty(ByteSink& bs, bool includeTime) const ;
+
+    /* Payload field decoders, shared by printPretty and the weaver's
+       queries.  Each is false if this trace isn't of its type, or its
+       payload doesn't parse */
+    bool decodeStateChange(u8 & newstate) const ; // ITC or EW StateChange
+    bool decodeAssignCenter(s8 & cx, s8 & cy, u8 & radius, u8 & active) const ;
+    bool decodeCircuitStateChange(u8 & itcdir6, u8 & oldcs, u8 & newcs) const ;
+    bool isPacket() const {
+      return mTraceType == TTC_ITC_PacketIn || mTraceType == TTC_ITC_PacketOut;
+    }
+    const T2PacketBuffer & getPacket() const { return mData; } // if isPacket()
+
     Trace & printf(const char * format, ...) ;
 
     T2PacketBuffer & payloadWrite() { return mData; }
@@ -188,32 +205,86 @@ namespace MFM {
    */
   typedef OverflowableCharBufferByteSink<(1<<20)> OString1MB;  // Screw the +2
 
+  /** One Trace as captured on the hot path: raw fields, unformatted */
+  struct TraceRingRecord {
+    struct timespec mTime;
+    u8 mUniquer;
+    u8 mTraceType;
+    u8 mAddr[3];
+    u8 mPayloadLength;          // 255 means payload overflowed, ends 'X'
+    u8 mPayload[255];
+  };
+
+  /**
+     A fixed-size ring of TraceRingRecords in an mmap'd region.  The
+     single writer (the tile thread) copies each Trace in without
+     formatting it and publishes it by bumping mWritten; readers turn
+     records into the TraceLogger::log format later, off the hot
+     path.  A full ring overwrites its oldest records, and a reader
+     that finds its record overwritten while copying it drops it.
+   */
+  struct TraceRing {
+    enum {
+      RING_BITS = 13,           // ~2MB of records
+      RING_RECORDS = 1<<RING_BITS,
+      RING_MASK = RING_RECORDS-1
+    };
+    TraceRing() ;
+    ~TraceRing() ;
+
+    void log(const Trace & evt) ;
+
+    /** Sequence number of the next record to be written */
+    u32 getWritten() const { return mWritten.load(std::memory_order_acquire); }
+
+    /** Sequence number of the oldest record safely in the ring.  (The
+        slot after that is the next to be overwritten.) */
+    u32 getOldest() const {
+      u32 written = getWritten();
+      return written > RING_RECORDS-1 ? written - (RING_RECORDS-1) : 0;
+    }
+
+    /** Copy record seq out to rec.  False if seq has already been
+        overwritten (or not yet written). */
+    bool copy(u32 seq, TraceRingRecord & rec) const ;
+
+    /** Append record seq to bs in TraceLogger::log format.  False if
+        seq has already been overwritten (or not yet written). */
+    bool format(u32 seq, ByteSink & bs) const ;
+
+    /** What everything logged so far would occupy once formatted */
+    u64 getBytesLogged() const { return mBytesLogged.load(std::memory_order_relaxed); }
+
+  private:
+    static bool isRetained(u32 seq, u32 written) {
+      return written - seq - 1 < RING_RECORDS - 1;
+    }
+    TraceRing(const TraceRing &) ; // Not copyable
+    TraceRingRecord * mRecords;
+    std::atomic<u32> mWritten;
+    std::atomic<u64> mBytesLogged;
+  };
+
   struct TraceLoggerInMemory {
     OString32 mBufferName;
-    OString1MB mTraceBuffers[2];
-    u32 mCurBuf;
+    TraceRing mRing;
     s32 ftell() const {
-      return (s32)
-        (mTraceBuffers[0].GetLength() + mTraceBuffers[1].GetLength());
+      return (s32) mRing.getBytesLogged();
     }
 
+    /** Format whatever the ring still holds, oldest first */
     void dump(const char * path) ;
     
     TraceLoggerInMemory(const char * p)
       : mBufferName(p)
-      , mCurBuf(0)
     {
     }
 
-    ByteSink & getByteSink() {
-      if (mTraceBuffers[mCurBuf].CanWrite() < 300) { // Trace events top around ~275 bytes?
-        mCurBuf = 1-mCurBuf;
-        mTraceBuffers[mCurBuf].Reset();
-      }
-      return mTraceBuffers[mCurBuf];
-    }
+    void log(const Trace & evt) { mRing.log(evt); }
   };
 
+  /** Logs into a TraceRing, and a background thread formats the
+      records out to the file */
   struct TraceLoggerToFile {
     static FILE * openPath(const char * path) {
       MFM_API_ASSERT_NONNULL(path);
@@ -237,58 +308,190 @@ namespace MFM {
     TraceLoggerToFile(const char * path)
       : mFile(openPath(path))
       , mFBS(mFile)
+      , mFlushed(0)
+      , mLost(0)
+      , mStopping(false)
+      , mFlusher(&TraceLoggerToFile::runFlusher, this)
     {
     }
     ~TraceLoggerToFile() {
+      mStopping.store(true);
+      mFlusher.join();          // Which drains whatever's left
+      if (mLost > 0)
+        LOG.Warning("Trace flusher fell behind, %d records lost", mLost);
       mFBS.Close();
       mFile = 0;
     }
     
-    ByteSink & getByteSink() { 
-      MFM_API_ASSERT_NONNULL(mFile);
-      return mFBS;
-    }
+    void log(const Trace & evt) { mRing.log(evt); }
 
-    s32 flush() {
-      if (mFile) return fflush(mFile);
-      return -EBADF;
-    }
+    s32 flush() ;
 
-    s32 ftell() {
-      if (mFile) return ::ftell(mFile);
+    s32 ftell() const {
+      if (mFile) return (s32) mRing.getBytesLogged();
       return -EBADF;
     }
 
   private:
+    enum { FLUSH_INTERVAL_MS = 50 };
+    void runFlusher() ;
+    void drain() ;              // Caller holds mDrainLock
+    TraceRing mRing;
     FILE * mFile;
     FileByteSink mFBS;
+    u32 mFlushed;               // Next seq to format out
+    u32 mLost;
+    std::mutex mDrainLock;
+    std::atomic<bool> mStopping;
+    std::thread mFlusher;       // Last: starts running when constructed
+  };
+
+  /**
+     The compact encoding of TraceRingRecords used to stream traces
+     over the network.  A stream starts with a hello:
+
+       'T','2','T','S' version(1) namelen(1) name
+
+     naming the sending tile, then one record after another, each
+
+       flags(1) time uniquer(1) [address(3)] [type(1)] plen(1) payload
+
+     where time is a varint nanosecond delta from the previous
+     record if TS_NSEC_DELTA is set, and else sec(BEU32) nsec(BEU32),
+     and the address and type are left out if they're the same as
+     the previous record's.  Varints are little-endian base 128.
+   */
+  enum TraceStreamConstants {
+    TRACE_STREAM_VERSION = 0x01,
+    TRACE_STREAM_MAX_NAME = 64,
+    TS_SAME_ADDR  = 0x01,
+    TS_SAME_TYPE  = 0x02,
+    TS_NSEC_DELTA = 0x04,
+    TS_ALL_FLAGS  = 0x07,
+    // Largest encoded record: flags, full time, uniquer, address,
+    // type, length, payload
+    TRACE_STREAM_MAX_RECORD = 1 + 8 + 1 + 3 + 1 + 1 + 255
+  };
+
+  struct TraceStreamEncoder {
+    TraceStreamEncoder() { reset(); }
+
+    /** Forget the previous record, so the next is encoded in full.
+        For the start of each new stream. */
+    void reset() { mHavePrev = false; }
+
+    static void writeHello(ByteSink & bs, const char * name) ;
+    void encode(const TraceRingRecord & rec, ByteSink & bs) ;
+
+  private:
+    bool mHavePrev;
+    TraceRingRecord mPrev;      // Header fields only
+  };
+
+  /** Decodes one stream's bytes, delivered in arbitrary pieces, back
+      into Traces */
+  struct TraceStreamDecoder {
+    enum { BUFFER_BYTES = 1<<16 };
+    TraceStreamDecoder() ;
+
+    /** Room for this many more bytes in getInput() */
+    u32 getRoom() const { return BUFFER_BYTES - mLength; }
+    u8 * getInput() { return mBuffer + mLength; }
+
+    /** Note that count bytes have been placed at getInput() */
+    void added(u32 count) ;
+
+    bool hasHello() const { return mHasHello; }
+    const char * getName() const { return mName; }
+
+    /** The next complete record, or 0 if more bytes are needed.  Sets
+        bad and returns 0 if the stream doesn't parse. */
+    Trace * next(bool & bad) ;
+
+  private:
+    bool readHello(bool & bad) ;
+    u8 mBuffer[BUFFER_BYTES];
+    u32 mLength;
+    u32 mPos;
+    bool mHasHello;
+    char mName[TRACE_STREAM_MAX_NAME + 1];
+    bool mHavePrev;
+    TraceRingRecord mPrev;
+  };
+
+  /** Logs into a TraceRing, and a background thread streams the
+      records to a collector at "HOST:PORT" -- a Weaver running with
+      --listen, say -- reconnecting whenever it has to.  Records the
+      ring has overwritten before they could be sent are lost. */
+  struct TraceLoggerToNet {
+    TraceLoggerToNet(const char * hostport) ;
+    ~TraceLoggerToNet() ;
+
+    void log(const Trace & evt) { mRing.log(evt); }
+
+    s32 ftell() const { return (s32) mRing.getBytesLogged(); }
+
+  private:
+    enum {
+      SEND_INTERVAL_MS = 50,
+      RECONNECT_MS = 2000,
+      SEND_BUFFER_BYTES = 1<<16
+    };
+    void runSender() ;
+    bool connectCollector() ;
+    bool drain() ;              // False if the connection dropped
+    bool sendAll(const char * bytes, u32 length) ;
+    TraceRing mRing;
+    OString128 mHost;
+    OString16 mPort;
+    OString64 mName;            // What we tell the collector we are
+    int mFD;
+    TraceStreamEncoder mEncoder;
+    OverflowableCharBufferByteSink<SEND_BUFFER_BYTES> mSendBuffer;
+    u32 mSent;                  // Next seq to send
+    u32 mLost;
+    u32 mConnections;
+    std::atomic<bool> mStopping;
+    std::thread mSender;        // Started once the rest is set up
   };
 
   struct TraceLogger {
     TraceLoggerInMemory * mInMemory;
     TraceLoggerToFile * mToFile;
+    TraceLoggerToNet * mToNet;
+
+    /** Paths starting with this stream to a collector instead */
+    static bool isNetPath(const char * path) {
+      return path && !strncmp(path, "tcp:", 4);
+    }
+
     TraceLogger(const char * path, bool inMemory)
       : mInMemory(0)
       , mToFile(0)
+      , mToNet(0)
     {
-      if (inMemory) mInMemory = new TraceLoggerInMemory(path);
+      if (isNetPath(path)) mToNet = new TraceLoggerToNet(path + 4);
+      else if (inMemory) mInMemory = new TraceLoggerInMemory(path);
       else mToFile = new TraceLoggerToFile(path);
     }
 
     ~TraceLogger() {
       if (mInMemory) { delete mInMemory; mInMemory = 0; }
       if (mToFile) { delete mToFile; mToFile = 0; }
+      if (mToNet) { delete mToNet; mToNet = 0; }
     }
 
     s32 ftell() {
       if (mInMemory) return mInMemory->ftell();
       if (mToFile) return mToFile->ftell();
+      if (mToNet) return mToNet->ftell();
       return -EBADF;
     }
 
     void log(const Trace & evt) {
-      if (mInMemory) { log(mInMemory->getByteSink(),evt); }
-      if (mToFile) { log(mToFile->getByteSink(),evt); }
+      if (mInMemory) mInMemory->log(evt);
+      if (mToFile) mToFile->log(evt);
+      if (mToNet) mToNet->log(evt);
     }
 
     void dump(const char * path) {
@@ -301,9 +504,38 @@ namespace MFM {
 
 
   struct TraceLogReader {
+    enum {
+      // Start bytes, timestamp, uniquer, address, type, payload length
+      RECORD_HEADER_BYTES = 2 + 4 + 4 + 1 + 3 + 1 + 1
+    };
+
     static Trace * read(ByteSource & bs,
                         struct timespec basetime,     // Subtracts this
                         struct timespec timeoffset) ; // then adds this
+
+    /** Decode the record at mbs.Tell() straight from the mapped
+        bytes and skip past it.  Like read(ByteSource&,..) returns 0
+        on a bad start, having consumed the two start bytes, or at
+        end of file -- including a truncated last record, which is
+        skipped.  */
+    static Trace * read(MappedFileByteSource & mbs,
+                        struct timespec basetime,
+                        struct timespec timeoffset) ;
+
+    /** Decode one record from bytes[0..length).  Returns 0 if
+        that's not the start of a complete, valid record, else
+        returns the trace and sets used to the record length */
+    static Trace * read(const u8 * bytes, u32 length, u32 & used,
+                        struct timespec basetime,
+                        struct timespec timeoffset) ;
+
+  private:
+    static Trace * makeTrace(const UniqueTime & stamp,
+                             const TraceAddress & addr,
+                             u8 traceType,
+                             const u8 * payload, u32 plen,
+                             struct timespec basetime,
+                             struct timespec timeoffset) ;
   };
 
 }
@@ -0,0 +1,68 @@
+/* -*- C++ -*- */
+#ifndef WEAVEQUERY_H
+#define WEAVEQUERY_H
+
+#include <vector>
+
+#include "itype.h"
+#include "ByteSink.h"
+
+namespace MFM {
+  struct Trace; // FORWARD
+  struct Alignment; // FORWARD
+
+  /** One aggregate question asked of every trace in the weave, for
+      the weaver's --query batch mode.  Each file's traces are scanned
+      in file order by a query of its own, on a thread of its own, so
+      per-file state (like RINGs not yet answered) needs no locking.
+      The per-file queries are then merged, in file number order, into
+      the one that prints the table. */
+  struct WeaveQuery {
+    virtual ~WeaveQuery() { }
+
+    virtual const char * getName() const = 0;
+
+    /** A fresh, empty query of the same kind, for scanning one file */
+    virtual WeaveQuery * spawn() const = 0;
+
+    /** Take in the next trace of the file */
+    virtual void scan(const Trace & trace) = 0;
+
+    /** The file has no more traces */
+    virtual void finish() { }
+
+    /** Fold in \c other, a finished query spawned from this one */
+    virtual void merge(const WeaveQuery & other) = 0;
+
+    virtual void printTable(ByteSink & bs) const = 0;
+
+    /** A new query named \c name, or 0 if there's no such query */
+    static WeaveQuery * create(const char * name) ;
+
+    /** The query names create() accepts, for help and errors */
+    static const char * getNames() ;
+  };
+
+  /** The queries of one --query run, answered together in one pass
+      over each file's record index */
+  struct WeaveQueries {
+    WeaveQueries() { }
+    ~WeaveQueries() ;
+
+    /** False if there's no query named \c name */
+    bool add(const char * name) ;
+
+    bool isEmpty() const { return mQueries.empty(); }
+
+    /** Scan every file of \c align, which must already be indexed,
+        and print each query's table to \c bs */
+    void run(Alignment & align, ByteSink & bs) ;
+
+  private:
+    typedef std::vector<WeaveQuery*> QueryVector;
+    QueryVector mQueries;
+
+    WeaveQueries(const WeaveQueries &) ; // Not copyable
+  };
+}
+#endif /* WEAVEQUERY_H */
@@ -15,10 +15,11 @@
 #include "LineTailByteSink.h"
 
 #include "T2Constants.h"
-#include "FileByteSource.h"
+#include "MappedFileByteSource.h"
 
 #include "Trace.h"
 #include "T2EventWindow.h"
+#include "WeaveQuery.h"
 
 namespace MFM {
   struct Weaver; // FORWARD
@@ -28,7 +29,7 @@ namespace MFM {
   typedef long FilePos;
   typedef std::pair<FileNumber,FilePos> WLFNumAndFilePos;
 
-  typedef std::pair<FileByteSource*,u32> SourceAndNetFilePos;
+  typedef std::pair<MappedFileByteSource*,u32> SourceAndNetFilePos;
   typedef std::vector<SourceAndNetFilePos> SANFPVector;
 
   struct FileTrace {
@@ -64,6 +65,43 @@ namespace MFM {
       mHasEffectiveOffset = true;
     }
 
+    /** One record of the file: its raw local timestamp and where
+        it starts */
+    struct IndexEntry {
+      u32 mSec;
+      u32 mNsec;
+      u32 mFilePos;
+    };
+    typedef std::vector<IndexEntry> RecordIndex;
+
+    /** One sync trace of the file: where it starts and its tag */
+    struct SyncEntry {
+      u32 mFilePos;
+      s32 mTag;
+    };
+    typedef std::vector<SyncEntry> SyncIndex;
+
+    /** Load the record and sync indexes from the sidecar file at
+        getIndexPath() if that still matches the trace data, or else
+        parse the whole file once to build them and try to save
+        them there.  Touches nothing but this WeaverLogFile, so
+        different files may build their indexes concurrently. */
+    void buildIndex() ;
+
+    typedef enum indexstate {
+      INDEX_NONE,               // buildIndex not yet run
+      INDEX_LOADED,             // Read from the sidecar file
+      INDEX_SAVED,              // Built by parsing, and saved
+      INDEX_UNSAVED             // Built by parsing, but couldn't save
+    } IndexState;
+    IndexState getIndexState() const { return mIndexState; }
+    const RecordIndex & getRecordIndex() const {
+      MFM_API_ASSERT_STATE(mIndexState != INDEX_NONE);
+      return mRecordIndex;
+    }
+    u32 getSyncCount() const { return mSyncIndex.size(); }
+    std::string getIndexPath() const ;
+
     void findITCSyncs(Alignment &) ;
     s32 checkForSync(Trace & evt) ;
 
@@ -85,7 +123,12 @@ namespace MFM {
 
     void initDirectory() ;
     void initFileOrDirectory() ;
-    
+    void noteSourceStat(u64 bytes, u64 mtime) ;
+
+    bool loadIndex() ;
+    void scanIndex() ;
+    bool saveIndex() const ;
+
     const char * mFilePath;
     const FileNumber mFileNumber;
 
@@ -102,6 +145,11 @@ namespace MFM {
     CutMap mRollingCutPoints;
     u32 mLatestIndex;
     u32 mCurrentFilePos; // Aggregate across all indexes
+    u64 mSourceBytes;    // Total size of the trace data
+    u64 mSourceMTime;    // Latest modification time of the trace data
+    IndexState mIndexState;
+    RecordIndex mRecordIndex;
+    SyncIndex mSyncIndex;
   };
 
   struct EWModel {
@@ -120,6 +168,18 @@ namespace MFM {
       , mEWIdx(idx)
     { reset(); }
 
+    /** Take on all of other's mutable state */
+    void copyStateFrom(const EWModel & other) {
+      mRadius = other.mRadius;
+      mStateNum = other.mStateNum;
+      mCenter = other.mCenter;
+      mTraceLoc = other.mTraceLoc;
+      for (u32 cn = 0 ; cn < 2; ++cn) {
+        mCircuitDirs[cn] = other.mCircuitDirs[cn];
+        mCircuitState[cn] = other.mCircuitState[cn];
+      }
+    }
+
     void reset() {
       mRadius = 0;
       mStateNum = (EWStateNumber) U32_MAX;
@@ -185,6 +245,31 @@ namespace MFM {
     typedef std::map<Order,EWModel*> OrderEWModelMap;
     OrderEWModelMap & getOrderEWModelMap() { return mOrdersEWModel; }
   private:
+    enum {
+      MIN_CHECKPOINT_INTERVAL = 4096, // Trace locs between checkpoints, at least
+      MAX_CHECKPOINTS = 256           // Roughly, across all trace locs
+    };
+
+    /** Everything needed to put the map back as it was just before
+        some trace loc, with the models identified by getModelIndex
+        rather than by pointer */
+    struct Checkpoint {
+      typedef std::vector<EWModel> EWModelVector;
+      typedef std::vector<std::pair<u32,u32> > OrderVector;
+      EWModelVector mModels;
+      OrderVector mOrders;      // (Order, model index) pairs
+      std::set<u32> mFreeOrders;
+    };
+    typedef std::map<u32,Checkpoint> CheckpointMap; // trace loc -> state there
+    CheckpointMap mCheckpoints;
+    u32 mFileCount;
+
+    u32 getCheckpointInterval() const ;
+    u32 getModelIndex(const EWModel & ewm) const ;
+    EWModel & getModelAtIndex(u32 index) ;
+    void saveCheckpoint() ;
+    void restoreCheckpoint(const CheckpointMap::const_iterator & itr) ;
+
     typedef std::map<EWModel*,Order> EWModelOrderMap;
     EWModelOrderMap mEWModelOrders;
 
@@ -245,10 +330,6 @@ namespace MFM {
     u32 getTraceLocCount() const { return mTraceLocs.size(); }
     FileTrace * getTraceAtLoc(u32 traceLoc) ;
 
-    bool advanceToNextTraceIfNeededAndPossible(FileTracePtrPair & ftpp) ;
-    struct timespec nextEarliestTime(FileTracePtrPair & ftpp) ;
-    FileTrace * extractNextEarliestTrace(FileTracePtrPair & ftpp) ;
-
     u32 logFileCount() const ;
     void analyzeLogSync() ;
     void assignEffectiveOffsetsLaterThan(FileNumber fn) ;
@@ -264,10 +345,13 @@ namespace MFM {
     Weaver()
       : mAlignment()
       , mInteractive(false)
+      , mListenPort(0)
     { }
     
     Alignment mAlignment;
     bool mInteractive;
+    u32 mListenPort;            // Weave live streams instead of files, if > 0
+    WeaveQueries mQueries;      // --query tables to print, if any
     OurLogBuffer mLogBuffer;
     
     void processArgs(int argc, char ** argv) ;
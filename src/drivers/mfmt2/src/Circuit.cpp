@@ -87,10 +87,11 @@ namespace MFM {
     T2EventWindow & ew = getEW();
     T2Tile & tile = ew.getTile();
     T2ITC * pitc = getITCIfAny();
-    tile.tlog(Trace(ew,TTC_EW_CircuitStateChange,"%c%c%c",
-                    pitc ? pitc->mDir6 : 0xff,
-                    mState,
-                    cs));
+    if (tile.isTracing(TTC_EW_CircuitStateChange))
+      tile.tlog(Trace(ew,TTC_EW_CircuitStateChange,"%c%c%c",
+                      pitc ? pitc->mDir6 : 0xff,
+                      mState,
+                      cs));
     mState = cs;
   }
 
@@ -155,6 +156,7 @@ namespace MFM {
     mITC = 0;
     mMaxUnshippedSN = S8_MAX;
     mYoinkValue = -1;
+    mRungUsec = 0;
   }
 
   CircuitNum Circuit::getCircuitNum() const {
@@ -0,0 +1,40 @@
+#include "EventSiteSampler.h"
+
+namespace MFM {
+
+  EventSiteSampler::EventSiteSampler() {
+    for (u32 i = 0; i < SITE_COUNT; ++i)
+      mOrder[i] = mRank[i] = (u16) i;
+    mBound[SC_READY] = 0;
+    mBound[SC_BUSY] = 0;
+    mBound[SC_EMPTY] = 0;
+    mBound[SC_COUNT] = SITE_COUNT;
+  }
+
+  void EventSiteSampler::swapRanks(u32 r1, u32 r2) {
+    const u16 i1 = mOrder[r1], i2 = mOrder[r2];
+    mOrder[r1] = i2; mRank[i2] = (u16) r1;
+    mOrder[r2] = i1; mRank[i1] = (u16) r2;
+  }
+
+  void EventSiteSampler::setClass(UPoint tileSite, SiteClass sc) {
+    MFM_API_ASSERT_ARG(sc < SC_COUNT);
+    const u32 idx = getOwnedIndex(tileSite);
+    u32 cur = getClassOfRank(mRank[idx]);
+
+    // Walk across one class boundary at a time: swap to the edge of
+    // our current class, then move the boundary past us
+    while (cur < (u32) sc) {
+      const u32 lastOfCur = mBound[cur+1]-1;
+      swapRanks(mRank[idx], lastOfCur);
+      --mBound[cur+1];
+      ++cur;
+    }
+    while (cur > (u32) sc) {
+      const u32 firstOfCur = mBound[cur];
+      swapRanks(mRank[idx], firstOfCur);
+      ++mBound[cur];
+      --cur;
+    }
+  }
+}
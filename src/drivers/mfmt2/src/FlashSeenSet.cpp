@@ -0,0 +1,70 @@
+#include "FlashSeenSet.h"
+
+namespace MFM {
+
+  FlashSeenSet::FlashSeenSet() {
+    for (u32 i = 0; i < SLOT_COUNT; ++i) {
+      mSlots[i].mCIR = 0;
+      mSlots[i].mOrigin = 0;
+      mSlots[i].mState = SS_EMPTY;
+      mSlots[i].mUntilMS = 0;
+    }
+  }
+
+  FlashSeenSet::SeenMatch FlashSeenSet::find(const FlashTraffic & packet, u32 nowMS) const {
+    const u32 cir = getCIR(packet);
+    const u16 origin = getOrigin(packet);
+    SeenMatch ret = SEEN_NONE;
+    u32 idx = getProbeStart(cir);
+    for (u32 p = 0; p < MAX_PROBES; ++p, idx = (idx+1)&SLOT_MASK) {
+      const Slot & s = mSlots[idx];
+      if (s.mState == SS_EMPTY) break;
+      if (s.mCIR != cir || !isLive(s, nowMS)) continue;
+      if (s.mOrigin == origin)
+        return s.mState == SS_PENDING ? SEEN_PENDING : SEEN_LINGERING;
+      if (s.mState == SS_PENDING)
+        ret = SEEN_OTHER_ORIGIN; // Keep looking for an exact match
+    }
+    return ret;
+  }
+
+  bool FlashSeenSet::insertPending(const FlashTraffic & packet, u32 nowMS, u32 untilMS) {
+    const u32 cir = getCIR(packet);
+    Slot * victim = 0;
+    u32 idx = getProbeStart(cir);
+    for (u32 p = 0; p < MAX_PROBES; ++p, idx = (idx+1)&SLOT_MASK) {
+      Slot & s = mSlots[idx];
+      if (!isLive(s, nowMS)) { // Empty or aged out
+        victim = &s;
+        break;
+      }
+      // Otherwise prefer evicting whatever would age out soonest,
+      // lingering before pending
+      if (!victim ||
+          (s.mState == SS_LINGERING && victim->mState == SS_PENDING) ||
+          (s.mState == victim->mState && isBefore(s.mUntilMS, victim->mUntilMS)))
+        victim = &s;
+    }
+    const bool evicted = isLive(*victim, nowMS);
+    victim->mCIR = cir;
+    victim->mOrigin = getOrigin(packet);
+    victim->mState = SS_PENDING;
+    victim->mUntilMS = untilMS;
+    return evicted;
+  }
+
+  void FlashSeenSet::retire(const FlashTraffic & packet, u32 nowMS) {
+    const u32 cir = getCIR(packet);
+    const u16 origin = getOrigin(packet);
+    u32 idx = getProbeStart(cir);
+    for (u32 p = 0; p < MAX_PROBES; ++p, idx = (idx+1)&SLOT_MASK) {
+      Slot & s = mSlots[idx];
+      if (s.mState == SS_EMPTY) return;
+      if (s.mState == SS_PENDING && s.mCIR == cir && s.mOrigin == origin) {
+        s.mState = SS_LINGERING;
+        s.mUntilMS = nowMS + LINGER_MS;
+        return;
+      }
+    }
+  }
+}
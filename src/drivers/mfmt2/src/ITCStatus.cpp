@@ -61,11 +61,31 @@ namespace MFM {
     : mDir6Idx(U32_MAX)
     , mIsOpen(false)
     , mIsAlive(false)
+    , mHaveCircuitStats(false)
   {
     for (u32 i = 0; i < ITC_STAT_COUNT; ++i) {
       mStats[i] = 0;
       mDeltas[i] = U32_MAX; // flag that we're uninitted
     }
+    mCircuitStats.reset();
+    mCircuitDeltas.reset();
+  }
+
+  void ITCStatus::updateCircuitStats(const T2ITCStats & stats) {
+    if (mHaveCircuitStats) mCircuitDeltas = stats - mCircuitStats;
+    mCircuitStats = stats;
+    mHaveCircuitStats = true;
+  }
+
+  bool ITCStatus::formatCircuitSummary(ByteSink & bs, bool & isSlow) {
+    u64 replies = mCircuitDeltas.getRTTCount();
+    if (replies == 0) return false;
+    isSlow = 2*mCircuitDeltas.getBusysReceived() > replies;
+    u32 p50 = mCircuitDeltas.getRTTQuantileUsec(0.5);
+    if (p50 == U32_MAX) bs.Printf(">%um", T2ITCStats::getRTTBucketLimitUsec(T2ITCStats::RTT_BUCKETS-2)/1000);
+    else if (p50 < 1000) bs.Printf("<%uu", p50);
+    else bs.Printf("<%um", p50/1000);
+    return true;
   }
 
   void ITCStatus::updateStatsFromLine(ByteSource & bs) {
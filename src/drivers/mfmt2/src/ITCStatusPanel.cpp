@@ -24,5 +24,14 @@ namespace MFM {
   void ITCStatusPanel::PaintComponent(Drawing & draw) {
     MFM_API_ASSERT_STATE(mStatus != 0 && mIcons != 0);
     mStatus->drawStatus(draw, *mIcons);
+
+    // Median ring-to-reply time, red if mostly refused
+    OString16 buf;
+    bool isSlow = false;
+    if (mStatus->formatCircuitSummary(buf, isSlow)) {
+      draw.SetForeground(isSlow ? Drawing::RED : GetForeground());
+      draw.BlitBackedTextCentered(buf.GetZString(), SPoint(0,0),
+                                  UPoint(getWidth(), getHeight()));
+    }
   }
 }
@@ -0,0 +1,299 @@
+#include "LiveWeave.h"
+#include "SocketChannel.h"  /* For ListenTCP */
+#include "Logger.h"
+#include "UniqueTime.h"
+
+#include <sys/socket.h>
+#include <poll.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdio.h>  /* For snprintf */
+
+namespace MFM {
+
+  static s64 traceNsec(const Trace & trace) {
+    struct timespec ts = trace.getTimespec();
+    return (s64) ts.tv_sec*1000000000 + ts.tv_nsec;
+  }
+
+  LiveWeave::LiveStream::LiveStream(u32 num, int fd)
+    : mNum(num)
+    , mFD(fd)
+    , mDecoder()
+    , mWindow()
+    , mSyncs()
+    , mSyncOrder()
+    , mNewestNsec(0)
+    , mAligned(false)
+    , mOffsetNsec(0)
+    , mDropped(0)
+  { }
+
+  LiveWeave::LiveStream::~LiveStream() {
+    if (mFD >= 0) ::close(mFD);
+    mFD = -1;
+    while (mWindow.size() > 0) {
+      delete mWindow.front();
+      mWindow.pop_front();
+    }
+  }
+
+  LiveWeave::LiveWeave(u32 port, FileByteSink & out)
+    : mPort(port)
+    , mOut(out)
+    , mListenFD(-1)
+    , mStreams()
+    , mNextStreamNum(0)
+    , mDisparities()
+    , mAlignmentChanged(false)
+    , mAnchor(U32_MAX)
+    , mHaveBase(false)
+    , mBaseNsec(0)
+    , mEmitted(0)
+    , mLate(0)
+    , mLastEmittedNsec(0)
+  {
+    MFM_API_ASSERT_ARG(port > 0 && port <= 0xffff);
+  }
+
+  LiveWeave::~LiveWeave() {
+    while (mStreams.size() > 0) {
+      delete mStreams.back();
+      mStreams.pop_back();
+    }
+    if (mListenFD >= 0) ::close(mListenFD);
+    mListenFD = -1;
+  }
+
+  LiveWeave::LiveStream * LiveWeave::findStream(u32 num) {
+    for (u32 i = 0; i < mStreams.size(); ++i)
+      if (mStreams[i]->mNum == num) return mStreams[i];
+    return 0;
+  }
+
+  void LiveWeave::run() {
+    mListenFD = SocketChannel::ListenTCP((u16) mPort);
+    LOG.Message("Weaving live traces streamed to port %d", mPort);
+    while (true) {
+      std::vector<struct pollfd> pfds;
+      struct pollfd lfd;
+      lfd.fd = mListenFD;
+      lfd.events = POLLIN;
+      lfd.revents = 0;
+      pfds.push_back(lfd);
+      for (u32 i = 0; i < mStreams.size(); ++i) {
+        struct pollfd sfd;
+        sfd.fd = mStreams[i]->mFD; // Negative (closed) fds are skipped
+        sfd.events = POLLIN;
+        sfd.revents = 0;
+        pfds.push_back(sfd);
+      }
+      s32 ready = poll(&pfds[0], pfds.size(), POLL_MS);
+      if (ready < 0 && errno != EINTR) {
+        LOG.Error("Live weave poll failed: %s", strerror(errno));
+        FAIL(IO_ERROR);
+      }
+      if (ready > 0) {
+        // mStreams may grow below; pfds[1..] match its start
+        u32 polled = pfds.size() - 1;
+        for (u32 i = 0; i < polled; ++i) {
+          LiveStream & ls = *mStreams[i];
+          if (pfds[i+1].revents && !readStream(ls))
+            closeStream(ls);
+        }
+        if (pfds[0].revents & POLLIN)
+          acceptStream();
+      }
+      align();
+      bool anyOpen = false;
+      for (u32 i = 0; i < mStreams.size(); ++i)
+        if (mStreams[i]->mFD >= 0) anyOpen = true;
+      emit(!anyOpen);
+    }
+  }
+
+  void LiveWeave::acceptStream() {
+    int fd;
+    do {
+      fd = ::accept(mListenFD, NULL, NULL);
+    } while (fd < 0 && errno == EINTR);
+    if (fd < 0) {
+      LOG.Warning("Live weave accept failed: %s", strerror(errno));
+      return;
+    }
+    if (mStreams.size() >= MAX_STREAMS) {
+      LOG.Warning("Already weaving %d streams, refusing another", mStreams.size());
+      ::close(fd);
+      return;
+    }
+    LiveStream * ls = new LiveStream(mNextStreamNum++, fd);
+    mStreams.push_back(ls);
+  }
+
+  bool LiveWeave::readStream(LiveStream & ls) {
+    s32 got = ::read(ls.mFD, ls.mDecoder.getInput(), ls.mDecoder.getRoom());
+    if (got < 0 && errno == EINTR) return true;
+    if (got <= 0) return false;
+    const bool hadHello = ls.mDecoder.hasHello();
+    ls.mDecoder.added(got);
+    bool bad;
+    Trace * trace;
+    while ((trace = ls.mDecoder.next(bad)) != 0)
+      addTrace(ls, trace);
+    if (!hadHello && ls.mDecoder.hasHello())
+      LOG.Message("%d/ streaming from %s", ls.mNum, ls.mDecoder.getName());
+    if (bad) {
+      LOG.Error("%d/ sent a malformed trace stream", ls.mNum);
+      return false;
+    }
+    return true;
+  }
+
+  void LiveWeave::addTrace(LiveStream & ls, Trace * trace) {
+    const s64 nsec = traceNsec(*trace);
+    if (nsec > ls.mNewestNsec) ls.mNewestNsec = nsec;
+    s32 tag;
+    if (trace->reportSyncIfAny(tag))
+      noteSync(ls, (u32) (tag < 0 ? -tag : tag), nsec);
+    if (ls.mWindow.size() >= WINDOW_RECORDS) {
+      delete ls.mWindow.front();
+      ls.mWindow.pop_front();
+      ++ls.mDropped;
+    }
+    ls.mWindow.push_back(trace);
+  }
+
+  void LiveWeave::noteSync(LiveStream & ls, u32 tag, s64 nsec) {
+    for (u32 i = 0; i < mStreams.size(); ++i) {
+      LiveStream & other = *mStreams[i];
+      if (&other == &ls) continue;
+      std::map<u32,s64>::const_iterator itr = other.mSyncs.find(tag);
+      if (itr == other.mSyncs.end()) continue;
+      // The two traces happened together, whatever their clocks say
+      const bool lsFirst = ls.mNum < other.mNum;
+      StreamPair sp(lsFirst ? ls.mNum : other.mNum, lsFirst ? other.mNum : ls.mNum);
+      const s64 delta = lsFirst ? nsec - itr->second : itr->second - nsec;
+      Disparity & d = mDisparities[sp]; // Zeroed if new
+      ++d.mCount;
+      d.mSumNsec += delta;
+      mAlignmentChanged = true;
+    }
+    if (ls.mSyncs.find(tag) != ls.mSyncs.end()) return; // Only the first use
+    ls.mSyncs[tag] = nsec;
+    ls.mSyncOrder.push_back(tag);
+    if (ls.mSyncOrder.size() > MAX_SYNCS) {
+      ls.mSyncs.erase(ls.mSyncOrder.front());
+      ls.mSyncOrder.pop_front();
+    }
+  }
+
+  void LiveWeave::align() {
+    // The anchor is the oldest stream still open, or else still there
+    u32 anchor = U32_MAX;
+    for (u32 i = 0; i < mStreams.size() && anchor == U32_MAX; ++i)
+      if (mStreams[i]->mFD >= 0) anchor = mStreams[i]->mNum;
+    if (anchor == U32_MAX && findStream(mAnchor)) anchor = mAnchor;
+    if (anchor != mAnchor) {
+      if (anchor != U32_MAX)
+        LOG.Message("%d/ is now the anchor stream", anchor);
+      mAnchor = anchor;
+      mAlignmentChanged = true;
+    }
+    if (!mAlignmentChanged) return;
+    mAlignmentChanged = false;
+
+    for (u32 i = 0; i < mStreams.size(); ++i)
+      mStreams[i]->mAligned = false;
+    LiveStream * root = findStream(mAnchor);
+    if (!root) return;
+    root->mAligned = true;
+    root->mOffsetNsec = 0;
+    bool grew = true;
+    while (grew) {
+      grew = false;
+      for (DisparityMap::const_iterator itr = mDisparities.begin();
+           itr != mDisparities.end(); ++itr) {
+        LiveStream * first = findStream(itr->first.first);
+        LiveStream * second = findStream(itr->first.second);
+        if (!first || !second || first->mAligned == second->mAligned) continue;
+        const s64 avg = (s64) (itr->second.mSumNsec / itr->second.mCount);
+        if (first->mAligned)
+          second->mOffsetNsec = first->mOffsetNsec + avg;
+        else
+          first->mOffsetNsec = second->mOffsetNsec - avg;
+        first->mAligned = second->mAligned = true;
+        grew = true;
+      }
+    }
+  }
+
+  void LiveWeave::emit(bool all) {
+    s64 watermark = S64_MAX;
+    if (!all) {
+      bool any = false;
+      s64 newest = 0;
+      for (u32 i = 0; i < mStreams.size(); ++i) {
+        LiveStream & ls = *mStreams[i];
+        if (!ls.mAligned || ls.mWindow.size() == 0) continue;
+        const s64 at = ls.mNewestNsec + ls.mOffsetNsec;
+        if (!any || at > newest) newest = at;
+        any = true;
+      }
+      if (!any) return;
+      watermark = newest - (s64) SETTLE_MS*1000000;
+    }
+
+    while (true) {
+      LiveStream * pick = 0;
+      s64 pickNsec = 0;
+      for (u32 i = 0; i < mStreams.size(); ++i) {
+        LiveStream & ls = *mStreams[i];
+        if (!ls.mAligned || ls.mWindow.size() == 0) continue;
+        const s64 at = traceNsec(*ls.mWindow.front()) + ls.mOffsetNsec;
+        if (!pick || at < pickNsec) {
+          pick = &ls;
+          pickNsec = at;
+        }
+      }
+      if (!pick || pickNsec > watermark) break;
+
+      Trace * trace = pick->mWindow.front();
+      pick->mWindow.pop_front();
+      if (!mHaveBase) {
+        mBaseNsec = pickNsec;
+        mHaveBase = true;
+      }
+      if (mEmitted > 0 && pickNsec < mLastEmittedNsec) ++mLate;
+      else mLastEmittedNsec = pickNsec;
+      char buf[32];
+      snprintf(buf, sizeof(buf), "%0.5f ", (pickNsec - mBaseNsec)/1000000000.0);
+      mOut.Printf("%d %s", mEmitted++, buf);
+      for (u32 i = 0; i < pick->mNum; ++i)
+        mOut.Printf("        ");
+      mOut.Printf("%d/", pick->mNum);
+      trace->printPretty(mOut, false);
+      delete trace;
+    }
+    mOut.Flush();
+
+    // Let go of closed streams once everything they sent is out
+    for (u32 i = 0; i < mStreams.size(); ) {
+      LiveStream * ls = mStreams[i];
+      if (ls->mFD < 0 && (ls->mWindow.size() == 0 || all)) {
+        if (ls->mWindow.size() > 0)
+          LOG.Warning("%d/ closed with %d records never aligned",
+                      ls->mNum, ls->mWindow.size());
+        delete ls;
+        mStreams.erase(mStreams.begin() + i);
+      } else ++i;
+    }
+  }
+
+  void LiveWeave::closeStream(LiveStream & ls) {
+    if (ls.mFD < 0) return;
+    ::close(ls.mFD);
+    ls.mFD = -1;
+    LOG.Message("%d/ %s closed; %d records dropped unaligned, %d printed late so far",
+                ls.mNum, ls.mDecoder.getName(), ls.mDropped, mLate);
+  }
+}
@@ -1,28 +1,138 @@
 #include "LogPanel.h"
 
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+
 namespace MFM {
+  static const u32 NOTIFY_EVENTS = IN_MODIFY | IN_ATTRIB | IN_MOVE_SELF | IN_DELETE_SELF;
+
+  LogPanel::~LogPanel() {
+    closeFile();
+    if (mNotifyFD >= 0) ::close(mNotifyFD);
+  }
+
+  bool LogPanel::openFile() {
+    mFD = ::open(mFilePathToTrack, O_RDONLY | O_CLOEXEC);
+    if (mFD < 0) return false;
+
+    struct stat st;
+    mInode = (::fstat(mFD, &st) == 0) ? st.st_ino : 0;
+    mOffset = 0;
+    mBytesInLine = 0;
+    mChanged = true;            // Whatever's there already
+    mReplaced = false;
+
+    if (mNotifyFD < 0)
+      mNotifyFD = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (mNotifyFD >= 0)
+      mWatchD = ::inotify_add_watch(mNotifyFD, mFilePathToTrack, NOTIFY_EVENTS);
+    return true;
+  }
+
+  void LogPanel::closeFile() {
+    if (mWatchD >= 0) ::inotify_rm_watch(mNotifyFD, mWatchD);
+    mWatchD = -1;
+    if (mFD >= 0) ::close(mFD);
+    mFD = -1;
+    mBytesInLine = 0;
+  }
+
+  void LogPanel::drainNotifications() {
+    if (mWatchD < 0) {          // Can't be told, so always look
+      mChanged = true;
+      return;
+    }
+    char buf[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+    ssize_t len;
+    while ((len = ::read(mNotifyFD, buf, sizeof buf)) > 0) {
+      for (char * p = buf; p < buf + len; ) {
+        const struct inotify_event * ev = (const struct inotify_event *) p;
+        if (ev->wd == mWatchD) {
+          mChanged = true;
+          if (ev->mask & (IN_MOVE_SELF | IN_DELETE_SELF | IN_IGNORED))
+            mReplaced = true;
+        }
+        p += sizeof(struct inotify_event) + ev->len;
+      }
+    }
+  }
+
+  void LogPanel::consume(const u8 * data, u32 len) {
+    ByteSink & bs = GetByteSink();
+    const u8 * end = data + len;
+    while (data < end) {
+      const u8 * nl = (const u8 *) memchr(data, '\n', end - data);
+      const u8 * segEnd = nl ? nl + 1 : end;
+      const u32 seg = (u32) (segEnd - data);
+      u32 skip = 0;
+      if (mBytesInLine < mBytesToSkip)
+        skip = MIN(seg, mBytesToSkip - mBytesInLine);
+      if (seg > skip)
+        bs.WriteBytes(data + skip, seg - skip);
+      mBytesInLine = nl ? 0 : mBytesInLine + seg;
+      data = segEnd;
+    }
+  }
+
   void LogPanel::update() {
     if (mFilePathToTrack == 0) return;
-    if (mFilePtr == 0) {
-      	mFilePtr = fopen(mFilePathToTrack, "r");
-        //         if (mFilePtr != 0) fseek(mFilePtr, 0, SEEK_END);
+    if (mFD < 0 && !openFile()) return;
+
+    drainNotifications();
+    if (!mChanged) return;
+    mChanged = false;
+
+    struct stat st;
+    if (::fstat(mFD, &st) < 0) {
+      closeFile();
+      return;
+    }
+    if (st.st_nlink == 0) mReplaced = true;
+    if (mWatchD < 0 && !mReplaced) {
+      // No inotify to tell us about renames, so check the path
+      struct stat pst;
+      if (::stat(mFilePathToTrack, &pst) < 0 || pst.st_ino != mInode)
+        mReplaced = true;
+    }
+
+    const u64 size = (u64) st.st_size;
+    if (size < mOffset) {       // Truncated: start over
+      mOffset = 0;
+      mBytesInLine = 0;
     }
 
-    if (mFilePtr != 0) {
-      ByteSink & bs = GetByteSink();
-      s32 ch;
+    bool resync = false;
+    if (size - mOffset > MAX_BACKLOG_BYTES) {
+      mOffset = size - MAX_BACKLOG_BYTES;
+      resync = true;            // Landed mid-line, probably
+    }
 
-      while ((ch = fgetc(mFilePtr)) >= 0) {
-        if (mBytesInLine >= mBytesToSkip)
-          bs.WriteByte((u8) ch);
-        if (ch == '\n') mBytesInLine = 0; else ++mBytesInLine;
+    u8 buf[READ_CHUNK_BYTES];
+    while (true) {
+      ssize_t got = ::pread(mFD, buf, sizeof buf, (off_t) mOffset);
+      if (got < 0) {
+        if (errno == EINTR) continue;
+        closeFile();            // Reopen next time
+        return;
       }
+      if (got == 0) break;
+      mOffset += got;
 
-      if (ferror(mFilePtr)) {
-        fclose(mFilePtr);
-        mFilePtr = 0;
+      u32 start = 0;
+      if (resync) {             // Drop the partial line we landed in
+        while (start < (u32) got && buf[start] != '\n') ++start;
+        if (start == (u32) got) continue;
+        ++start;
+        resync = false;
         mBytesInLine = 0;
       }
+      consume(buf + start, (u32) got - start);
     }
+
+    if (mReplaced) closeFile(); // Got the last of it; reopen next time
   }
 }
@@ -44,6 +44,11 @@ namespace MFM
     , mScreenWidth(T2_SCREEN_WIDTH)
     , mScreenHeight(T2_SCREEN_HEIGHT)
     , mScreen(0)
+    , mFrames{ 0, 0 }
+    , mPendingFrame(0)
+    , mPresentingFrame(0)
+    , mStopPresenter(false)
+    , mFramesSkipped(0)
     , mShowCursor(false)
     , mMouseButtonsDown(0)
     , mKeyboardModifiers(0)
@@ -56,6 +61,7 @@ namespace MFM
   }
 
   SDLI::~SDLI() {
+    stopPresenter();
     for (auto itr = mPanels.begin(); itr != mPanels.end(); ++itr) {
       Panel * p = itr->second;
       delete p;
@@ -284,6 +290,70 @@ namespace MFM
     doEarlyStartup();
     mScreen = doLateStartup();
     mRootPanel = configureWindows();
+    startPresenter();
+  }
+
+  void SDLI::startPresenter() {
+    for (u32 i = 0; i < 2; ++i) {
+      mFrames[i] = SDL_DisplayFormat(mScreen);
+      if (!mFrames[i])
+        fatal("Can't make frame surface: %s", SDL_GetError());
+    }
+    mPresenter = std::thread(&SDLI::runPresenter, this);
+  }
+
+  void SDLI::stopPresenter() {
+    if (!mPresenter.joinable()) return;
+    {
+      std::lock_guard<std::mutex> guard(mPresentLock);
+      mStopPresenter = true;
+    }
+    mPresentCV.notify_one();
+    mPresenter.join();          // mScreen is ours again
+    for (u32 i = 0; i < 2; ++i) {
+      SDL_FreeSurface(mFrames[i]);
+      mFrames[i] = 0;
+    }
+  }
+
+  void SDLI::runPresenter() {
+    static u32 flips;
+    std::unique_lock<std::mutex> lock(mPresentLock);
+    while (true) {
+      mPresentCV.wait(lock, [this] { return mPendingFrame != 0 || mStopPresenter; });
+      if (mStopPresenter) break;
+      mPresentingFrame = mPendingFrame;
+      mPendingFrame = 0;
+      lock.unlock();
+
+      u32 before = SDL_GetTicks();
+      SDL_BlitSurface(mPresentingFrame, 0, mScreen, 0);
+      SDL_Flip(mScreen);
+      ++flips;
+      u32 after = SDL_GetTicks();
+      if (time_before(before+OVERFLOW_REDISPLAY_MS,after))
+        fprintf(stderr,"Big flip %d on #%d\n",after-before,flips);
+
+      lock.lock();
+      mPresentingFrame = 0;
+    }
+  }
+
+  SDL_Surface * SDLI::claimFrame() {
+    std::lock_guard<std::mutex> guard(mPresentLock);
+    for (u32 i = 0; i < 2; ++i)
+      if (mFrames[i] != mPendingFrame && mFrames[i] != mPresentingFrame)
+        return mFrames[i];
+    ++mFramesSkipped;
+    return 0;
+  }
+
+  void SDLI::presentFrame(SDL_Surface * frame) {
+    {
+      std::lock_guard<std::mutex> guard(mPresentLock);
+      mPendingFrame = frame;    // Any older pending frame is dropped
+    }
+    mPresentCV.notify_one();
   }
 
   Panel & SDLI::getRootPanel() {
@@ -650,6 +720,7 @@ namespace MFM
   }
   
   void SDLI::showFail(const char * file, int line, const char * msg) {
+    stopPresenter();            // Draw straight to the screen
     Drawing draw;
     draw.Reset(mScreen, FONT_ASSET_ELEMENT_MEDIUM);
     draw.Clear();
@@ -693,8 +764,10 @@ namespace MFM
   }
 
   void SDLI::redisplay() {
+    SDL_Surface * frame = claimFrame();
+    if (!frame) return;         // Presenter's behind; catch the next one
     Drawing draw;
-    draw.Reset(mScreen, FONT_ASSET_ELEMENT);
+    draw.Reset(frame, FONT_ASSET_ELEMENT);
     draw.Clear();
     Panel * root = mPanels["Root"];
     root->Paint(draw);
@@ -725,15 +798,7 @@ namespace MFM
       }
     }
 
-    {
-      static u32 flips;
-      u32 before = mTile.now();
-      SDL_Flip(mScreen);
-      ++flips;
-      u32 after = mTile.now();
-      if (time_before(before+OVERFLOW_REDISPLAY_MS,after))
-        fprintf(stderr,"Big flip %d on #%d\n",after-before,flips);
-    }
+    presentFrame(frame);
   }
 
   void SDLI::handleInput(u32 maxEvents) {
@@ -0,0 +1,96 @@
+#include <stdlib.h>  /* For abs */
+
+#include "SiteOwnership.h"
+#include "Util.h"      /* For COMPILATION_REQUIREMENT */
+
+namespace MFM {
+
+  SiteOwnership::SiteOwnership()
+    : mHolderCount(0)
+  {
+    COMPILATION_REQUIREMENT<T2TILE_WIDTH <= 64>();
+    for (s32 r = 0; r <= MAX_RADIUS; ++r) {
+      for (s32 dy = -MAX_RADIUS; dy <= MAX_RADIUS; ++dy) {
+        u64 mask = 0;
+        for (s32 dx = -MAX_RADIUS; dx <= MAX_RADIUS; ++dx)
+          if (abs(dx) + abs(dy) <= r)
+            mask |= ((u64) 1) << (dx + MAX_RADIUS);
+        mRadiusMasks[r][dy + MAX_RADIUS] = mask;
+      }
+    }
+    for (u32 y = 0; y < T2TILE_HEIGHT; ++y)
+      mRows[y] = 0;
+  }
+
+  u64 SiteOwnership::getFootprintRow(SPoint center, u32 radius, s32 y) const {
+    MFM_API_ASSERT_ARG(radius <= MAX_RADIUS);
+    const s32 dy = y - center.GetY();
+    if (y < 0 || y >= T2TILE_HEIGHT || dy < -MAX_RADIUS || dy > MAX_RADIUS)
+      return 0;
+
+    const u64 mask = mRadiusMasks[radius][dy + MAX_RADIUS];
+    const s32 shift = center.GetX() - MAX_RADIUS; // Where bit 0 of mask lands
+    u64 row;
+    if (shift >= 64 || shift <= -64) row = 0;
+    else if (shift >= 0) row = mask << shift;
+    else row = mask >> -shift;
+
+    const u64 tileRow = (T2TILE_WIDTH == 64) ? ~((u64) 0) : (((u64) 1) << T2TILE_WIDTH) - 1;
+    return row & tileRow;
+  }
+
+  bool SiteOwnership::isFootprintFree(SPoint center, u32 radius) const {
+    const s32 top = center.GetY() - (s32) radius;
+    const s32 bot = center.GetY() + (s32) radius;
+    for (s32 y = MAX(top, 0); y <= bot && y < T2TILE_HEIGHT; ++y)
+      if (mRows[y] & getFootprintRow(center, radius, y)) return false;
+    return true;
+  }
+
+  bool SiteOwnership::claim(T2EventWindow * ew, SPoint center, u32 radius) {
+    MFM_API_ASSERT_NONNULL(ew);
+    MFM_API_ASSERT_STATE(mHolderCount < MAX_HOLDERS);
+    if (!isFootprintFree(center, radius)) return false;
+
+    const s32 top = center.GetY() - (s32) radius;
+    const s32 bot = center.GetY() + (s32) radius;
+    for (s32 y = MAX(top, 0); y <= bot && y < T2TILE_HEIGHT; ++y)
+      mRows[y] |= getFootprintRow(center, radius, y);
+
+    Holder & h = mHolders[mHolderCount++];
+    h.mEW = ew;
+    h.mCenter = center;
+    h.mRadius = radius;
+    return true;
+  }
+
+  bool SiteOwnership::release(T2EventWindow * ew) {
+    for (u32 i = 0; i < mHolderCount; ++i) {
+      Holder & h = mHolders[i];
+      if (h.mEW != ew) continue;
+
+      const s32 top = h.mCenter.GetY() - (s32) h.mRadius;
+      const s32 bot = h.mCenter.GetY() + (s32) h.mRadius;
+      for (s32 y = MAX(top, 0); y <= bot && y < T2TILE_HEIGHT; ++y) {
+        const u64 row = getFootprintRow(h.mCenter, h.mRadius, y);
+        MFM_API_ASSERT_STATE((mRows[y] & row) == row); // Still all ours
+        mRows[y] &= ~row;
+      }
+
+      h = mHolders[--mHolderCount];
+      return true;
+    }
+    return false;
+  }
+
+  T2EventWindow * SiteOwnership::getOwner(UPoint tileSite) const {
+    if (!isOwned(tileSite)) return 0;
+    const SPoint site = MakeSigned(tileSite);
+    for (u32 i = 0; i < mHolderCount; ++i) {
+      const Holder & h = mHolders[i];
+      if ((u32) (site - h.mCenter).GetManhattanLength() <= h.mRadius)
+        return h.mEW;
+    }
+    FAIL(ILLEGAL_STATE); // Held by nobody?
+  }
+}
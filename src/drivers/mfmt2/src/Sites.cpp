@@ -4,5 +4,10 @@ namespace MFM {
   Sites::Sites()
   {
     LOG.Message("ctor Sites %p", this);
+    OurMDist md;
+    for (u32 sn = 0; sn < EW_SITES; ++sn) {
+      SPoint off = md.GetPoint(sn);
+      mSNOffsets[sn] = off.GetY()*T2TILE_WIDTH + off.GetX();
+    }
   }
 }
@@ -0,0 +1,541 @@
+#include <sys/epoll.h> // For EPOLLIN
+
+#include "T2BulkTransferManager.h"
+#include "T2Tile.h"
+#include "SHA256ish.h"
+#include "Logger.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <dirent.h>  /* For opendir, readdir, closedir */
+#include <unistd.h>  /* For pread, pwrite, ftruncate */
+
+#include <stdio.h>   /* For snprintf, rename */
+#include <string.h>  /* For strerror, memcmp, memcpy */
+
+namespace MFM {
+
+  const char * const T2BulkTransferManager::STORE_DIR = "/home/t2/mfmBulk";
+  const char * const T2BulkTransferManager::INJECTION_DIR = "/run/mfm/bulk";
+
+  static u32 getNow() {
+    return T2Tile::get().getTQ().now();
+  }
+
+  T2BulkTransferManager::T2BulkTransferManager()
+    : mTransfers()
+    , mStalled(false)
+    , mFD(-1)
+  {
+    for (u32 i = 0; i < BULKSTAT_COUNT; ++i)
+      mBulkStats[i] = 0;
+  }
+
+  T2BulkTransferManager::~T2BulkTransferManager() {
+    close();
+    for (IdToTransfer::iterator itr = mTransfers.begin(); itr != mTransfers.end(); ++itr) {
+      Transfer * xfer = itr->second;
+      if (xfer->mFD >= 0) ::close(xfer->mFD);
+      delete xfer;
+    }
+    mTransfers.clear();
+  }
+
+  void T2BulkTransferManager::reportBulkStats(ByteSink & bs) const {
+    const char * sep = "";
+#define XX(NAME,DESC) bs.Printf("%s" #NAME "=%d", sep, mBulkStats[BULKSTAT_##NAME]); sep = " ";
+    ALL_BULK_STATS()
+#undef XX
+  }
+
+  void T2BulkTransferManager::init() {
+    T2Tile & tile = T2Tile::get();
+    int ret = ::open("/dev/itc/bulk",O_RDWR|O_NONBLOCK);
+    if (ret < 0) {
+      // Older LKMs have no bulk device; everything else still works
+      LOG.Warning("No bulk transfers: %s", strerror(errno));
+      return;
+    }
+    mFD = ret;
+    tile.getFDReactor().watch(mFD, EPOLLIN, *this);
+    mkdir(STORE_DIR, 0755);
+    schedule(tile.getTQ(),0);
+  }
+
+  int T2BulkTransferManager::close() {
+    if (mFD < 0) return 0;
+    T2Tile::get().getFDReactor().unwatch(mFD);
+    int ret = ::close(mFD);
+    mFD = -1;
+    if (ret < 0) return -errno;
+    return ret;
+  }
+
+  void T2BulkTransferManager::onTimeout(TimeQueue& srcTQ) {
+    if (mFD < 0) return;
+    handleInboundTraffic();
+    checkForInjection();
+    const bool busy = serviceTransfers(srcTQ.now());
+    schedule(srcTQ, busy ? BUSY_TICK_MS : IDLE_TICK_MS);
+  }
+
+  bool T2BulkTransferManager::isSafeName(const char * name) {
+    if (!name || !*name || name[0] == '.') return false;
+    u32 len = 0;
+    for (const char * p = name; *p; ++p, ++len) {
+      if (*p == '/' || *p < ' ' || *p > '~') return false;
+    }
+    return len <= MAX_NAME_LENGTH;
+  }
+
+  std::string T2BulkTransferManager::partialPath(u32 id) const {
+    char buf[100];
+    snprintf(buf, sizeof(buf), "%s/.%08x.part", STORE_DIR, id);
+    return std::string(buf);
+  }
+
+  std::string T2BulkTransferManager::finalPath(const Transfer & xfer) const {
+    return std::string(STORE_DIR) + "/" + xfer.mName;
+  }
+
+  T2BulkTransferManager::Transfer * T2BulkTransferManager::findTransfer(u32 id) {
+    IdToTransfer::iterator itr = mTransfers.find(id);
+    if (itr == mTransfers.end()) return 0;
+    return itr->second;
+  }
+
+  T2BulkTransferManager::Transfer *
+  T2BulkTransferManager::newTransfer(u32 id, const char * name, u32 length, const Bytes32 digest) {
+    Transfer * xfer = new Transfer();
+    xfer->mId = id;
+    xfer->mName = name;
+    xfer->mLength = length;
+    memcpy(xfer->mDigest, digest, sizeof(xfer->mDigest));
+    xfer->mChunks = (length + CHUNK_BYTES - 1) / CHUNK_BYTES;
+    xfer->mHave = 0;
+    xfer->mComplete = false;
+    xfer->mFD = -1;
+    xfer->mSource = -1;
+    xfer->mLastHeardMS = 0;
+    xfer->mLastRequestMS = 0;
+    xfer->mRequestedThrough = 0;
+    for (u32 i = 0; i < DIR6_COUNT; ++i) {
+      Peer & p = xfer->mPeers[i];
+      p.mAcked = p.mNext = p.mGranted = 0;
+      p.mLastOfferMS = 0;
+      p.mWants = p.mHas = false;
+    }
+    mTransfers[id] = xfer;
+    return xfer;
+  }
+
+  bool T2BulkTransferManager::publish(const char * path, const char * name) {
+    if (!isSafeName(name)) {
+      LOG.Warning("Bulk: unusable name '%s'", name);
+      return false;
+    }
+    int in = ::open(path, O_RDONLY);
+    if (in < 0) {
+      LOG.Warning("Bulk: can't read %s: %s", path, strerror(errno));
+      return false;
+    }
+    const std::string tmp = std::string(STORE_DIR) + "/.publish.part";
+    int out = ::open(tmp.c_str(), O_RDWR|O_CREAT|O_TRUNC, 0644);
+    if (out < 0) {
+      LOG.Warning("Bulk: can't write %s: %s", tmp.c_str(), strerror(errno));
+      ::close(in);
+      return false;
+    }
+
+    SHA256ish sha;
+    u8 buf[4096];
+    u32 length = 0;
+    bool ok = true;
+    while (true) {
+      ssize_t got = read(in, buf, sizeof(buf));
+      if (got < 0) { ok = false; break; }
+      if (got == 0) break;
+      if (write(out, buf, got) != got) { ok = false; break; }
+      sha.addBytes(buf, (u32) got);
+      length += (u32) got;
+    }
+    ::close(in);
+    Bytes32 digest;
+    if (!ok || !sha.digest(digest) || length == 0) {
+      LOG.Warning("Bulk: couldn't copy %s", path);
+      ::close(out);
+      unlink(tmp.c_str());
+      return false;
+    }
+
+    const u32 id = ((u32) digest[0]<<24) | ((u32) digest[1]<<16) | ((u32) digest[2]<<8) | digest[3];
+    if (findTransfer(id)) {
+      LOG.Message("Bulk: %s (%08x) already here", name, id);
+      ::close(out);
+      unlink(tmp.c_str());
+      return true;
+    }
+    Transfer * xfer = newTransfer(id, name, length, digest);
+    if (rename(tmp.c_str(), finalPath(*xfer).c_str()) != 0) {
+      LOG.Warning("Bulk: can't store %s: %s", name, strerror(errno));
+      ::close(out);
+      unlink(tmp.c_str());
+      mTransfers.erase(id);
+      delete xfer;
+      return false;
+    }
+    xfer->mFD = out;
+    xfer->mHave = xfer->mChunks;
+    xfer->mComplete = true;
+    ++mBulkStats[BULKSTAT_Published];
+    LOG.Message("Bulk: published %s (%08x), %d bytes in %d chunks",
+                name, id, length, xfer->mChunks);
+    return true;
+  }
+
+  void T2BulkTransferManager::checkForInjection() {
+    DIR * dir = opendir(INJECTION_DIR);
+    if (!dir) return; // We're fine if there's no injection dir
+
+    struct dirent * ent;
+    while ((ent = readdir(dir)) != NULL) {
+      if (ent->d_name[0] == '.') continue;
+      std::string path = std::string(INJECTION_DIR) + "/" + ent->d_name;
+      publish(path.c_str(), ent->d_name);
+      // Unlink whether it worked or not, as flash injection does
+      if (unlink(path.c_str()))
+        LOG.Message("Couldn't unlink %s: %s", path.c_str(), strerror(errno));
+    }
+    closedir(dir);
+  }
+
+  void T2BulkTransferManager::handleInboundTraffic() {
+    while (true) {
+      T2PacketBuffer pb;
+      const u32 MAX_PACKET_SIZE = 255;
+      int len = pb.Read(mFD, MAX_PACKET_SIZE);
+
+      if (len == 0) {
+        LOG.Error("EOF on bulk %d", mFD);
+        FAIL(ILLEGAL_STATE);
+      }
+
+      if (len < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+          return;
+        }
+        FAIL(ILLEGAL_STATE);
+      }
+      handleInboundPacket(pb);
+    }
+  }
+
+  void T2BulkTransferManager::handleInboundPacket(T2PacketBuffer & pb) {
+    u8 dir8;
+    if (!isStandardBulk(pb) || !asStandardRouted(pb, &dir8)) {
+      LOG.Error("NOT BULK? 0x%02x+%d", pb.GetBuffer()[0], pb.GetLength());
+      return;
+    }
+    const Dir6 from = mapDir8ToDir6(dir8);
+    if (from >= DIR6_COUNT) return;
+
+    CharBufferByteSource cbbs = pb.AsByteSource();
+    u8 op;
+    u32 id;
+    if (cbbs.Scanf("%c%c%c%l", 0, 0, &op, &id) != 4) {
+      LOG.Error("SHORT BULK? +%d", pb.GetLength());
+      return;
+    }
+
+    if (op == BULK_OP_OFFER) {
+      handleOffer(from, id, cbbs);
+      return;
+    }
+
+    Transfer * xfer = findTransfer(id);
+    if (!xfer) return;          // Stale; they'll offer again
+
+    switch (op) {
+    case BULK_OP_REQUEST: handleRequest(from, *xfer, cbbs); break;
+    case BULK_OP_HAVE: xfer->mPeers[from].mHas = true; break;
+    case BULK_OP_CHUNK: {
+      u32 index;
+      if (cbbs.Scanf("%l", &index) == 1)
+        handleChunk(from, *xfer, index, cbbs);
+      break;
+    }
+    default:
+      LOG.Warning("Bulk op %d from %s, ignored", op, getDir6Name(from));
+    }
+  }
+
+  void T2BulkTransferManager::handleOffer(Dir6 from, u32 id, CharBufferByteSource & cbbs) {
+    u32 length;
+    Bytes32 digest;
+    u8 namelen;
+    char name[MAX_NAME_LENGTH + 1];
+    if (cbbs.Scanf("%l", &length) != 1 ||
+        cbbs.ReadBytes(digest, sizeof(digest)) != sizeof(digest) ||
+        cbbs.Scanf("%c", &namelen) != 1 ||
+        namelen > MAX_NAME_LENGTH ||
+        cbbs.ReadBytes((u8*) name, namelen) != namelen) {
+      LOG.Warning("Bad bulk offer from %s", getDir6Name(from));
+      return;
+    }
+    name[namelen] = '\0';
+    if (!isSafeName(name) || length == 0) return;
+
+    Transfer * xfer = findTransfer(id);
+    if (!xfer) {
+      xfer = newTransfer(id, name, length, digest);
+
+      // Already got it, from before a restart?
+      struct stat st;
+      const std::string fpath = finalPath(*xfer);
+      if (stat(fpath.c_str(), &st) == 0 && (u32) st.st_size == length) {
+        xfer->mFD = ::open(fpath.c_str(), O_RDONLY);
+        xfer->mHave = xfer->mChunks;
+        if (xfer->mFD >= 0 && verify(*xfer)) xfer->mComplete = true;
+        else {
+          if (xfer->mFD >= 0) ::close(xfer->mFD);
+          xfer->mFD = -1;
+          xfer->mHave = 0;
+        }
+      }
+
+      if (!xfer->mComplete) {
+        // Resume whatever whole chunks a partial file holds
+        const std::string ppath = partialPath(id);
+        xfer->mFD = ::open(ppath.c_str(), O_RDWR|O_CREAT, 0644);
+        if (xfer->mFD < 0) {
+          LOG.Warning("Bulk: can't write %s: %s", ppath.c_str(), strerror(errno));
+          mTransfers.erase(id);
+          delete xfer;
+          return;
+        }
+        if (fstat(xfer->mFD, &st) == 0)
+          xfer->mHave = MIN((u32) st.st_size / CHUNK_BYTES, xfer->mChunks);
+        LOG.Message("Bulk: receiving %s (%08x) from %s, %d/%d chunks here",
+                    name, id, getDir6Name(from), xfer->mHave, xfer->mChunks);
+      }
+    }
+
+    // Whoever offered it is at least getting it
+    xfer->mPeers[from].mHas = true;
+    if (xfer->mComplete) {
+      sendHave(id, from);
+      return;
+    }
+    if (xfer->mSource < 0) {
+      xfer->mSource = from;
+      xfer->mLastHeardMS = getNow();
+      sendRequest(*xfer, true);
+    }
+  }
+
+  void T2BulkTransferManager::handleRequest(Dir6 from, Transfer & xfer, CharBufferByteSource & cbbs) {
+    u32 fromChunk;
+    u8 window, restart;
+    if (cbbs.Scanf("%l%c%c", &fromChunk, &window, &restart) != 3) return;
+    Peer & p = xfer.mPeers[from];
+    p.mHas = false;             // They're asking, so not yet
+    p.mWants = true;
+    p.mAcked = MIN(fromChunk, xfer.mChunks);
+    p.mGranted = MIN(p.mAcked + window, xfer.mChunks);
+    if (restart || p.mNext < p.mAcked) p.mNext = p.mAcked;
+    if (p.mAcked == xfer.mChunks) {
+      p.mWants = false;
+      p.mHas = true;
+    }
+  }
+
+  void T2BulkTransferManager::handleChunk(Dir6 from, Transfer & xfer, u32 index, CharBufferByteSource & cbbs) {
+    if (xfer.mComplete || (s32) from != xfer.mSource) {
+      ++mBulkStats[BULKSTAT_ChunksDiscarded];
+      return;
+    }
+    const u32 now = getNow();
+    xfer.mLastHeardMS = now;
+    if (index != xfer.mHave) {
+      ++mBulkStats[BULKSTAT_ChunksDiscarded];
+      // A gap means something was dropped; go back for it, but
+      // don't ask again for each of the chunks behind it
+      if (index > xfer.mHave && (u32) (now - xfer.mLastRequestMS) >= BUSY_TICK_MS)
+        sendRequest(xfer, true);
+      return;
+    }
+
+    u8 buf[CHUNK_BYTES];
+    const u32 expect =
+      index + 1 < xfer.mChunks ? (u32) CHUNK_BYTES : xfer.mLength - index * CHUNK_BYTES;
+    if (cbbs.ReadBytes(buf, expect) != expect) {
+      ++mBulkStats[BULKSTAT_ChunksDiscarded];
+      return;
+    }
+    if (pwrite(xfer.mFD, buf, expect, (off_t) index * CHUNK_BYTES) != (ssize_t) expect) {
+      LOG.Error("Bulk: write failed on %s: %s", xfer.mName.c_str(), strerror(errno));
+      return;
+    }
+    ++mBulkStats[BULKSTAT_ChunksReceived];
+    ++xfer.mHave;
+
+    if (xfer.mHave == xfer.mChunks) complete(xfer);
+    else if ((s32) (xfer.mRequestedThrough - xfer.mHave) <= WINDOW_CHUNKS / 2)
+      sendRequest(xfer, false);  // Ack and open the window ahead of need
+  }
+
+  bool T2BulkTransferManager::verify(Transfer & xfer) {
+    SHA256ish sha;
+    u8 buf[4096];
+    for (u32 pos = 0; pos < xfer.mLength; ) {
+      const u32 want = MIN((u32) sizeof(buf), xfer.mLength - pos);
+      if (pread(xfer.mFD, buf, want, pos) != (ssize_t) want) return false;
+      sha.addBytes(buf, want);
+      pos += want;
+    }
+    Bytes32 digest;
+    return sha.digest(digest) && memcmp(digest, xfer.mDigest, sizeof(digest)) == 0;
+  }
+
+  void T2BulkTransferManager::complete(Transfer & xfer) {
+    sendRequest(xfer, false);   // Final ack: tells the source we're done
+    if (!verify(xfer)) {
+      ++mBulkStats[BULKSTAT_DigestFailed];
+      LOG.Error("Bulk: %s (%08x) failed its digest, starting over",
+                xfer.mName.c_str(), xfer.mId);
+      if (ftruncate(xfer.mFD, 0) != 0)
+        LOG.Error("Bulk: truncate failed: %s", strerror(errno));
+      xfer.mHave = 0;
+      for (u32 i = 0; i < DIR6_COUNT; ++i) {
+        Peer & p = xfer.mPeers[i];
+        p.mAcked = p.mNext = p.mGranted = 0;
+      }
+      sendRequest(xfer, true);
+      return;
+    }
+    if (rename(partialPath(xfer.mId).c_str(), finalPath(xfer).c_str()) != 0)
+      LOG.Error("Bulk: can't store %s: %s", xfer.mName.c_str(), strerror(errno));
+    xfer.mComplete = true;
+    xfer.mSource = -1;
+    ++mBulkStats[BULKSTAT_Completed];
+    LOG.Message("Bulk: received %s (%08x), %d bytes",
+                xfer.mName.c_str(), xfer.mId, xfer.mLength);
+  }
+
+  bool T2BulkTransferManager::serviceTransfers(u32 now) {
+    mStalled = false;
+    u32 budget = MAX_PACKETS_PER_TICK;
+    bool busy = false;
+    for (IdToTransfer::iterator itr = mTransfers.begin(); itr != mTransfers.end(); ++itr) {
+      Transfer & xfer = *itr->second;
+      if (!xfer.mComplete) {
+        servicePull(xfer, now);
+        busy = true;
+      }
+      for (u32 i = 0; i < DIR6_COUNT; ++i)
+        if (servicePeer(xfer, (Dir6) i, now, budget)) busy = true;
+    }
+    return busy;
+  }
+
+  void T2BulkTransferManager::servicePull(Transfer & xfer, u32 now) {
+    if (xfer.mSource < 0) return; // Waiting for someone to offer it
+    const u32 quiet = now - xfer.mLastHeardMS;
+    if (quiet >= SOURCE_TIMEOUT_MS) {
+      LOG.Message("Bulk: %s went quiet on %s",
+                  getDir6Name(xfer.mSource), xfer.mName.c_str());
+      xfer.mPeers[xfer.mSource].mHas = false;
+      xfer.mSource = -1;        // Next offer, from anyone, takes over
+      return;
+    }
+    if (quiet >= RETRY_MS && (u32) (now - xfer.mLastRequestMS) >= RETRY_MS)
+      sendRequest(xfer, true);
+  }
+
+  bool T2BulkTransferManager::servicePeer(Transfer & xfer, Dir6 dir6, u32 now, u32 & budget) {
+    Peer & p = xfer.mPeers[dir6];
+    if (p.mHas || xfer.mHave == 0) return false;
+    if (!p.mWants) {
+      if ((u32) (now - p.mLastOfferMS) >= OFFER_MS) {
+        p.mLastOfferMS = now;
+        sendOffer(xfer, dir6);
+      }
+      return false;
+    }
+    // Pipelined: serve whatever we hold, even while still receiving
+    const u32 limit = MIN(p.mGranted, xfer.mHave);
+    while (p.mNext < limit && budget > 0 && !mStalled) {
+      if (!sendChunk(xfer, dir6, p.mNext)) break;
+      ++p.mNext;
+      --budget;
+    }
+    return true;
+  }
+
+  void T2BulkTransferManager::beginPacket(T2PacketBuffer & pb, Dir6 to, BulkOp op, u32 id) {
+    pb.Reset();
+    pb.Printf("%c%c%c%l",
+              0x80|mapDir6ToDir8(to),
+              PKT_HDR_BYTE1_BITMASK_BULK,
+              op,
+              id);
+  }
+
+  s32 T2BulkTransferManager::sendPacket(const T2PacketBuffer & pb) {
+    ssize_t amt = write(mFD, pb.GetBuffer(), pb.GetLength());
+    if (amt == (ssize_t) pb.GetLength()) return 1;
+    if (amt < 0 && errno == EHOSTUNREACH) return -1;
+    // Full (EAGAIN) or partial: leave the rest for the next tick
+    mStalled = true;
+    ++mBulkStats[BULKSTAT_Stalls];
+    return 0;
+  }
+
+  void T2BulkTransferManager::sendOffer(Transfer & xfer, Dir6 to) {
+    T2PacketBuffer pb;
+    beginPacket(pb, to, BULK_OP_OFFER, xfer.mId);
+    pb.Printf("%l", xfer.mLength);
+    pb.WriteBytes(xfer.mDigest, sizeof(xfer.mDigest));
+    pb.Printf("%c", (u32) xfer.mName.length());
+    pb.WriteBytes((const u8*) xfer.mName.c_str(), xfer.mName.length());
+    if (sendPacket(pb) > 0) ++mBulkStats[BULKSTAT_OffersSent];
+  }
+
+  void T2BulkTransferManager::sendRequest(Transfer & xfer, bool restart) {
+    if (xfer.mSource < 0) return;
+    T2PacketBuffer pb;
+    beginPacket(pb, (Dir6) xfer.mSource, BULK_OP_REQUEST, xfer.mId);
+    pb.Printf("%l%c%c", xfer.mHave, WINDOW_CHUNKS, restart ? 1 : 0);
+    xfer.mLastRequestMS = getNow();
+    if (sendPacket(pb) > 0) {
+      xfer.mRequestedThrough = xfer.mHave + WINDOW_CHUNKS;
+      if (restart) ++mBulkStats[BULKSTAT_Restarts];
+    }
+  }
+
+  void T2BulkTransferManager::sendHave(u32 id, Dir6 to) {
+    T2PacketBuffer pb;
+    beginPacket(pb, to, BULK_OP_HAVE, id);
+    sendPacket(pb);
+  }
+
+  bool T2BulkTransferManager::sendChunk(Transfer & xfer, Dir6 to, u32 index) {
+    u8 buf[CHUNK_BYTES];
+    const u32 len =
+      index + 1 < xfer.mChunks ? (u32) CHUNK_BYTES : xfer.mLength - index * CHUNK_BYTES;
+    if (pread(xfer.mFD, buf, len, (off_t) index * CHUNK_BYTES) != (ssize_t) len) {
+      LOG.Error("Bulk: read failed on %s: %s", xfer.mName.c_str(), strerror(errno));
+      return false;
+    }
+    T2PacketBuffer pb;
+    beginPacket(pb, to, BULK_OP_CHUNK, xfer.mId);
+    pb.Printf("%l", index);
+    pb.WriteBytes(buf, len);
+    const s32 ret = sendPacket(pb);
+    if (ret < 0) xfer.mPeers[to].mWants = false; // Gone; offer again later
+    if (ret <= 0) return false;
+    ++mBulkStats[BULKSTAT_ChunksSent];
+    return true;
+  }
+}
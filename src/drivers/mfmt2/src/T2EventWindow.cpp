@@ -4,6 +4,7 @@
 #include "Packet.h"
 #include "Logger.h"
 #include "TraceTypes.h"
+#include "Probes.h"
 
 #include <algorithm>
 
@@ -11,7 +12,9 @@ namespace MFM {
 
   void T2EventWindow::setEWSN(EWStateNumber ewsn) {
     assert(ewsn >= 0 && ewsn < MAX_EW_STATE_NUMBER);
-    mTile.tlog(Trace(*this, TTC_EW_StateChange,"%c",ewsn));
+    if (mTile.isTracing(TTC_EW_StateChange))
+      mTile.tlog(Trace(*this, TTC_EW_StateChange,"%c",ewsn));
+    MFM_PROBE3(ew__state, (void *) this, (u32) mSlotNum, (u32) ewsn);
     mStateNum = ewsn;
   }
 
@@ -22,6 +25,13 @@ namespace MFM {
     const SPoint origin(0,0);
     const SPoint maxSite(T2TILE_WIDTH-1,T2TILE_HEIGHT-1);
 
+    if (Sites::isInterior(mCenter, mRadius)) { // Usual case: no clipping
+      const UPoint ucenter = MakeUnsigned(mCenter);
+      for (u32 sn = 0; sn <= mLastSN; ++sn)
+        mSites[sn] = sites.getEWSite(ucenter, sn);
+      return;
+    }
+
     for (u32 sn = 0; sn <= mLastSN; ++sn) {
       SPoint offset = md.GetPoint(sn);
       SPoint site = mCenter + offset;
@@ -37,21 +47,28 @@ namespace MFM {
     Sites & sites = tile.getSites();
     const SPoint origin(0,0);
     const SPoint maxSite(T2TILE_WIDTH-1,T2TILE_HEIGHT-1);
+    const bool interior = Sites::isInterior(mCenter, mRadius);
+    const UPoint ucenter = interior ? MakeUnsigned(mCenter) : UPoint(0,0);
 
     for (u32 sn = 0; sn <= mLastSN; ++sn) {
-      SPoint offset = md.GetPoint(sn);
-      SPoint site = mCenter + offset;
-      if (!site.BoundedBy(origin,maxSite)) continue;
-      UPoint usite = MakeUnsigned(site);
+      SPoint site;
+      if (!interior) {
+        site = mCenter + md.GetPoint(sn);
+        if (!site.BoundedBy(origin,maxSite)) continue;
+      }
 
-      OurT2Site & siteOnTile = sites.get(usite);
+      OurT2Site & siteOnTile =
+        interior ? sites.getEWSite(ucenter, sn) : sites.get(MakeUnsigned(site));
       OurT2Atom & atomOnTile = siteOnTile.GetAtom();
       
       const OurT2Site & siteInEW = mSites[sn];
       const OurT2Atom & atomInEW = siteInEW.GetAtom();
       
-      if (atomOnTile != atomInEW) 
+      if (atomOnTile != atomInEW) {
         atomOnTile = atomInEW;
+        if (interior) site = mCenter + md.GetPoint(sn); // Only needed now
+        tile.noteSiteChanged(MakeUnsigned(site));
+      }
 
       if (sn == 0) { // Udpate base layer for ew[0] only
         OurT2Base & baseOnTile = siteOnTile.GetBase();
@@ -167,6 +184,7 @@ namespace MFM {
               PKT_HDR_BITMASK_STANDARD_MFM | itc.mDir8,
               xitcByte1(XITC_CS_DROP,sn)
               );
+    itc.getStats().incrDropsSent();
     return itc.trySendPacket(pb);
   }
 
@@ -268,6 +286,7 @@ namespace MFM {
               PKT_HDR_BITMASK_STANDARD_MFM | itc.mDir8,
               xitcByte1(XITC_CS_BUSY,passiveCN)
               );
+    itc.getStats().incrBusysSent();
     return itc.trySendPacket(pb);
   }
 
@@ -355,11 +374,14 @@ namespace MFM {
 
         // Do yoink protocol between *this (passive for them) and ew (active by us)
         bool passiveWins = passiveWinsYoinkRace(*aew);
+        T2ITCStats & stats = mPassiveCircuit.getITC().getStats();
         if (passiveWins) {
+          stats.incrYoinkRacesLost();
           aew->sendDropsExceptTo(0); // Send drops to all in this case?
           aew->dropActiveEW(false);
           continue;
         }
+        stats.incrYoinkRacesWon();
       } 
 
       TLOG(DBG,"RRFP-2 %s BUSYed by %s",getName(), aew->getName());
@@ -405,13 +427,14 @@ namespace MFM {
 
     std::set<T2EventWindow *> conflicts;
     // First check if region is all available, accumulating any EWs
-    // this conflicts with
+    // this conflicts with (only worth looking up if any site is held)
+    const bool anyHeld = !tile.isFootprintFree(mCenter, mRadius);
     for (u32 sn = first; sn <= last; ++sn) {
       SPoint offset = md.GetPoint(sn);
       SPoint site = mCenter + offset;
       if (!site.BoundedBy(origin,maxSite)) continue;
       UPoint usite = MakeUnsigned(site);
-      T2EventWindow * rew = tile.getSiteOwner(usite);
+      T2EventWindow * rew = anyHeld ? tile.getSiteOwner(usite) : 0;
       if (rew != 0) {
         conflicts.insert(rew);
       } 
@@ -432,6 +455,36 @@ namespace MFM {
     return true;
   }
 
+  bool T2PassiveEventWindow::tryClaimFreeSitesForPassive() {
+    if (!getTile().isFootprintFree(mCenter, mRadius))
+      return false; // Someone's there: take the long way
+
+    // Nobody to race.  Hog the region on behalf of the remote active,
+    // but don't load sites: only those updated get saved back
+    hogEWSites();
+    mDirectUpdates = true;
+    mUpdatedSNCount = 0;
+    setEWSN(EWSN_PWCACHE);
+    return true;
+  }
+
+  void T2PassiveEventWindow::saveUpdatedSites() {
+    T2Tile & tile = getTile();
+    OurMDist & md = tile.getMDist();
+    Sites & sites = tile.getSites();
+
+    for (u32 i = 0; i < mUpdatedSNCount; ++i) {
+      const u32 sn = mUpdatedSNs[i];
+      const UPoint usite = MakeUnsigned(mCenter + md.GetPoint(sn)); // On tile: checked on receipt
+      OurT2Atom & atomOnTile = sites.get(usite).GetAtom();
+      const OurT2Atom & atomInEW = mSites[sn].GetAtom();
+      if (atomOnTile != atomInEW) {
+        atomOnTile = atomInEW;
+        tile.noteSiteChanged(usite);
+      }
+    }
+  }
+
   bool T2ActiveEventWindow::checkSiteAvailabilityForActive() {
     T2Tile & tile = getTile();
     OurMDist & md = tile.getMDist();
@@ -441,13 +494,14 @@ namespace MFM {
     const u32 last = mLastSN;
 
     // First check if region is all available
+    if (!tile.isFootprintFree(mCenter, mRadius))
+      return false; // It's not
+
     for (u32 sn = first; sn <= last; ++sn) {
       SPoint offset = md.GetPoint(sn);
       SPoint site = mCenter + offset;
       if (!site.BoundedBy(origin,maxSite)) continue;
       UPoint usite = MakeUnsigned(site);
-      if (tile.getSiteOwner(usite) != 0)
-        return false; // It's not
       if (!T2_SITE_IS_VISIBLE_OR_CACHE(usite.GetX(),usite.GetY())) {
         mSitesLive[sn] = true; // Hidden sites are good to go
         continue;
@@ -483,26 +537,15 @@ namespace MFM {
 
   void T2EventWindow::hogOrUnhogEWSites(T2EventWindow* ewOrNull) {
     T2Tile & tile = getTile();
-    OurMDist & md = tile.getMDist();
-    const SPoint origin(0,0);
-    const SPoint maxSite(T2TILE_WIDTH-1,T2TILE_HEIGHT-1);
-    const u32 first = 0;
-    const u32 last = mLastSN;
     // Mine mine mine
-    for (u32 sn = first; sn <= last; ++sn) {
-      SPoint offset = md.GetPoint(sn);
-      SPoint site = mCenter + offset;
-      if (!site.BoundedBy(origin,maxSite)) continue;
-      UPoint usite = MakeUnsigned(site);
-      T2EventWindow * curew = tile.getSiteOwner(usite);
-      if (!curew == !ewOrNull) {
-        TLOG(ERR,"%s: Bad hog cur %s vs arg %s",
-             getName(),
-             curew ? curew->getName() : "0",
-             ewOrNull ? ewOrNull->getName() : "0");
-        FAIL(ILLEGAL_STATE);
-      }
-      tile.setSiteOwner(usite,ewOrNull);
+    bool ok = ewOrNull ?
+      tile.hogSites(ewOrNull, mCenter, mRadius) :
+      tile.unhogSites(this, mCenter, mRadius);
+    if (!ok) {
+      TLOG(ERR,"%s: Bad %s",
+           getName(),
+           ewOrNull ? "hog (sites already held)" : "unhog (no sites held)");
+      FAIL(ILLEGAL_STATE);
     }
     mIsHoggingSites = ewOrNull != 0;
   }
@@ -516,11 +559,12 @@ namespace MFM {
     mRadius = radius;
     mLastSN = md.GetLastIndex(mRadius);
     setEWSN(activeNotPassive ? EWSN_AINIT : EWSN_PINIT);
-    tile.tlog(Trace(*this,TTC_EW_AssignCenter,"%c%c%c%c",
-                    tileSite.GetX(),
-                    tileSite.GetY(),
-                    mRadius,
-                    activeNotPassive?1:0));
+    if (tile.isTracing(TTC_EW_AssignCenter))
+      tile.tlog(Trace(*this,TTC_EW_AssignCenter,"%c%c%c%c",
+                      tileSite.GetX(),
+                      tileSite.GetY(),
+                      mRadius,
+                      activeNotPassive?1:0));
   }
 
   void T2PassiveEventWindow::initPassive(SPoint ctr, u32 radius, bool yoink) {
@@ -590,19 +634,23 @@ namespace MFM {
     return atomsShipped == 0 ? 1 : 0;
   }
 
-  bool T2EventWindow::tryReadEWAtom(ByteSource & in, u32 & sn, OurT2AtomBitVector & bv) {
-    u8 tmpsn;
-    if (in.Scanf("%c",&tmpsn) != 1) return false;
-    TLOG(DBG,"%s CUPSN#%d mLastSN %d", getName(), tmpsn, mLastSN);
-    if (tmpsn > mLastSN) {
-      if (tmpsn == 0xff) sn = tmpsn;  // Store 0xff EOC flag
-      return false;
+  bool T2EventWindow::decodeCacheUpdates(ByteSource & in, CacheUpdateBatch & batch) {
+    batch.mCount = 0;
+    batch.mFinal = false;
+    s32 ch;
+    while ((ch = in.Read()) >= 0) {
+      const u8 sn = (u8) ch;
+      if (sn == 0xff) {         // EOC flag
+        batch.mFinal = true;
+        return true;
+      }
+      if (sn > mLastSN || batch.mCount >= CacheUpdateBatch::MAX_UPDATES)
+        return false;
+      if (!batch.mBits[batch.mCount].ReadBytes(in))
+        return false;
+      batch.mSNs[batch.mCount++] = sn;
     }
-    OurT2AtomBitVector tmpbv;
-    if (!tmpbv.ReadBytes(in)) return false;
-    sn = tmpsn;
-    bv = tmpbv;
-    return true;
+    return true;                // Clean end of a non-final packet
   }
 
   void T2PassiveEventWindow::applyCacheUpdatesPacket(T2PacketBuffer & pb, T2ITC & itc) {
@@ -613,39 +661,46 @@ namespace MFM {
                 getName(), byte0, byte1);
       FAIL(INCOMPLETE_CODE);
     }
-    u32 sn;
-    OurT2Atom tmpatom;
-    OurT2AtomBitVector & tmpbv = tmpatom.GetBits();
-    u32 count = 0;
+
+    // Decode the whole packet first..
+    CacheUpdateBatch batch;
+    const bool wellFormed = decodeCacheUpdates(cbs, batch);
+
+    // ..then validate it in one go: every sn must land in what itc
+    // can see, so drop any that don't, keeping the rest in order
     OurMDist & md = mTile.getMDist();
     const Rect & cacheAndViz = itc.getVisibleAndCacheRect();
-    while (tryReadEWAtom(cbs, sn, tmpbv)) {
-      SPoint offset = md.GetPoint(sn);
-      SPoint tileSite = mCenter + offset;
-      if (!cacheAndViz.Contains(tileSite)) {
-        TLOG(WRN,"%s sn%d(%d,%d) not accessible by %s; ignored",
-             getName(),
-             sn,
-             tileSite.GetX(), tileSite.GetY(),
-             itc.getName()
-             );
-        continue;
+    u32 kept = 0;
+    for (u32 i = 0; i < batch.mCount; ++i) {
+      const u8 sn = batch.mSNs[i];
+      if (!cacheAndViz.Contains(mCenter + md.GetPoint(sn))) continue;
+      if (kept != i) {
+        batch.mSNs[kept] = sn;
+        batch.mBits[kept] = batch.mBits[i];
       }
-      OurT2Site & site = mSites[sn];
-      OurT2Atom & atom = site.GetAtom();
-      
-      TLOG(DBG,"RECV#%d sn%d (%d,%d) tt 0x%04x wt 0x%04x",
-           count,
-           sn, tileSite.GetX(), tileSite.GetY(),
-           atom.GetType(),  // Atom sitting in mSites
-           tmpatom.GetType()); // Inbound atom
-
-      OurT2AtomBitVector & bv = atom.GetBits();
-      bv = tmpbv;
-      ++count;
+      ++kept;
     }
-    
-    if (sn == 0xff) { // Recvd final update packet
+
+    // ..and apply it in a single pass
+    for (u32 i = 0; i < kept; ++i) {
+      const u8 sn = batch.mSNs[i];
+      mSites[sn].GetAtom().GetBits() = batch.mBits[i];
+      if (mDirectUpdates) {
+        MFM_API_ASSERT_STATE(mUpdatedSNCount < EVENT_WINDOW_SITES(MAX_EVENT_WINDOW_RADIUS));
+        mUpdatedSNs[mUpdatedSNCount++] = sn;
+      }
+    }
+
+    // One entry for the lot
+    TLOG(DBG,"%s RECV %d/%d updates via %s%s%s",
+         getName(), kept, batch.mCount, itc.getName(),
+         batch.mFinal ? " +EOC" : "",
+         wellFormed ? "" : " MALFORMED");
+    if (kept != batch.mCount)
+      TLOG(WRN,"%s %d updates not accessible by %s; ignored",
+           getName(), batch.mCount - kept, itc.getName());
+
+    if (batch.mFinal) { // Recvd final update packet
       commitPassiveEWAndHangUp(); 
       TLOG(DBG,"%s PASSIVE DONE",getName());
     }
@@ -662,13 +717,17 @@ namespace MFM {
     T2ITC & itc = ci.getITC();
     itc.hangUpPassiveEW(*this,cn); // XXX handle failure
 
-    saveSites();
+    if (mDirectUpdates) saveUpdatedSites();
+    else saveSites();
     unhogEWSites();
     resetPassiveEW(); // Clear gunk for next renter
   }
 
   void T2PassiveEventWindow::resetPassiveEW() {
+    if (getEWSN() != EWSN_IDLE) mTile.notePassiveEWDone();
     initializeEW(); // Clear gunk for next renter
+    mDirectUpdates = false;
+    mUpdatedSNCount = 0;
     setEWSN(EWSN_IDLE);
     getPassiveCircuit().resetCircuitForPassive();
   }
@@ -721,6 +780,7 @@ namespace MFM {
       if (!itc.trySendPacket(pb)) return false; // doh.
       ci.setYoink(yoinkBit);  // After we apparently succeeded
       ci.setCS(CS_RUNG);
+      itc.noteRingSent(ci);
     }
     return true;
   }
@@ -741,8 +801,11 @@ namespace MFM {
       setEWSN(EWSN_AWLOCKS);
       scheduleWait(WC_LONG);
     } else {
+      // Local-only: nothing to wait for, and our hogged sites keep
+      // everyone else out, so do it now instead of via the TQ
       setEWSN(EWSN_ABEHAVE);
-      scheduleWait(WC_NOW);
+      executeEvent(); // Return value ignored, as in ABEHAVE::timeout
+      commitAndReleaseActive();
     }
     return true;
   }
@@ -1120,6 +1183,8 @@ namespace MFM {
   T2PassiveEventWindow::T2PassiveEventWindow(T2Tile& tile, EWSlotNum ewsn, const char * category, T2ITC& itc)
     : T2EventWindow(tile, ewsn, category)
     , mPassiveCircuit(*this)
+    , mDirectUpdates(false)
+    , mUpdatedSNCount(0)
   {
     _setEWSNRaw(EWSN_IDLE);
     mPassiveCircuit.bindCircuitForPassive(itc);
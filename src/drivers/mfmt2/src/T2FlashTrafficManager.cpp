@@ -1,3 +1,5 @@
+#include <sys/epoll.h> // For EPOLLIN
+
 #include "T2FlashTrafficManager.h"
 #include "T2UIComponents.h"
 #include "T2Tile.h"
@@ -105,8 +107,18 @@ namespace MFM {
     : mTTL(8)
     , mLastIndex(-1)
       //    , mPreparedCmd()
+    , mSeenSet()
     , mFD(-1)
   {
+    for (u32 i = 0; i < FLASHSTAT_COUNT; ++i)
+      mFlashStats[i] = 0;
+  }
+
+  void T2FlashTrafficManager::reportFlashStats(ByteSink & bs) const {
+    const char * sep = "";
+#define XX(NAME,DESC) bs.Printf("%s" #NAME "=%d", sep, mFlashStats[FLASHSTAT_##NAME]); sep = " ";
+    ALL_FLASH_STATS()
+#undef XX
   }
 
   void T2FlashTrafficManager::init() {
@@ -133,10 +145,12 @@ namespace MFM {
     int ret = ::open(path(),O_RDWR|O_NONBLOCK);
     if (ret < 0) return -errno;
     mFD = ret;
+    T2Tile::get().getFDReactor().watch(mFD, EPOLLIN, *this); // Else just our 250ms
     return ret;
   }
 
   int T2FlashTrafficManager::close() {
+    if (mFD >= 0) T2Tile::get().getFDReactor().unwatch(mFD);
     int ret = ::close(mFD);
     mFD = -1;
     if (ret < 0) return -errno;
@@ -153,7 +167,8 @@ namespace MFM {
       if (!packet.canPropagateTo(dir8)) continue;
       FlashTraffic tosend(packet, dir8);
       ssize_t amt = write(mFD, (const char *) &tosend, sizeof(tosend));
-      if (amt < 0) {
+      if (amt >= 0) ++mFlashStats[FLASHSTAT_Propagated];
+      else {
         if (errno == EHOSTUNREACH) continue;
         if (errno == EAGAIN || errno == EWOULDBLOCK) {
           LOG.Message("Flash skipped %d", dir6);
@@ -201,17 +216,15 @@ namespace MFM {
   }
 
   bool T2FlashTrafficManager::matchesPacketInPQ(const FlashTraffic & packet, bool & diffOrigin) const {
-    for (MultisetTimedFlashTraffic::const_iterator itr = mMultisetTimedFlashTraffic.begin();
-         itr != mMultisetTimedFlashTraffic.end(); ++itr) {
-      if (packet.matchesCIRO(itr->mPacket)) {
-        diffOrigin = false;
-        return true;
-      }
-      if (packet.matchesCIR(itr->mPacket)) {  // Might be loopback or other nonsense
-        diffOrigin = true;
-        return true;
-      }
-
+    // mSeenSet holds everything in the pq, so no need to scan it
+    FlashSeenSet::SeenMatch seen = mSeenSet.find(packet, getNow());
+    if (seen == FlashSeenSet::SEEN_PENDING) {
+      diffOrigin = false;
+      return true;
+    }
+    if (seen == FlashSeenSet::SEEN_OTHER_ORIGIN) {  // Might be loopback or other nonsense
+      diffOrigin = true;
+      return true;
     }
     return false;
   }
@@ -225,7 +238,10 @@ namespace MFM {
   }
 
   void T2FlashTrafficManager::acceptPacket(const FlashTraffic & packet) {
-    mMultisetTimedFlashTraffic.insert(TimedFlashTraffic(packet));
+    TimedFlashTraffic tft(packet);
+    mMultisetTimedFlashTraffic.insert(tft);
+    if (mSeenSet.insertPending(packet, getNow(), tft.mWhen))
+      ++mFlashStats[FLASHSTAT_SeenEvicted];
     BPoint origin = packet.mOrigin;
     u16 key = (((u8) origin.GetX())<<8)|((u8) origin.GetY());
     mOriginKeyToFlashTraffic[key] = packet;
@@ -235,20 +251,39 @@ namespace MFM {
     OString32 buf;
     report(packet,buf);
     LOG.Message("rFP:%s",buf.GetZString());
+    ++mFlashStats[FLASHSTAT_Received];
     if (!packet.checksumValid()) {
+      ++mFlashStats[FLASHSTAT_BadChecksum];
       LOG.Error("CHECKSUM FAILURE, MESSAGE REJECTED");
       return;
     }
 
-    bool diffOrigin = false; // True if holding same command from different origin
-    if (matchesPacketInPQ(packet,diffOrigin) && !diffOrigin) return; // exact dupe
-    if (matchesPreviousFromOrigin(packet)) return; // late dupe?
+    FlashSeenSet::SeenMatch seen = mSeenSet.find(packet, getNow());
+    if (seen == FlashSeenSet::SEEN_PENDING) { // exact dupe
+      ++mFlashStats[FLASHSTAT_PendingDupe];
+      return;
+    }
+    if (seen == FlashSeenSet::SEEN_LINGERING) { // executed dupe
+      ++mFlashStats[FLASHSTAT_LingeringDupe];
+      return;
+    }
+    if (matchesPreviousFromOrigin(packet)) { // late dupe?
+      ++mFlashStats[FLASHSTAT_LateDupe];
+      return;
+    }
+
+    // True if holding same command from different origin
+    bool diffOrigin = (seen == FlashSeenSet::SEEN_OTHER_ORIGIN);
 
     // If we don't already have this command, accept and remember, it
     if (!diffOrigin) {
       acceptPacket(packet);                  // accept
       //      mPreparedCmd = packet;                 // remember
-    }
+      ++mFlashStats[FLASHSTAT_Accepted];
+      OString256 stats;
+      reportFlashStats(stats);
+      LOG.Message("Flash stats %s",stats.GetZString());
+    } else ++mFlashStats[FLASHSTAT_CrossOrigin];
     // And propagate anything that's not an exact dupe
     sendFlashPacket(packet);               // propagate
   }
@@ -325,6 +360,7 @@ namespace MFM {
       if (time_after_eq(elt.mWhen,srcTQ.now())) return;  // Execution time not yet reached
       const FlashTraffic ready = elt.mPacket;                    // Copy command
       mMultisetTimedFlashTraffic.erase(oldest);            // Delete oldest
+      mSeenSet.retire(ready, srcTQ.now());                 // Let it linger
       FlashTraffic::execute(ready);                        // Do it
       //      executeFlashTrafficCommand((T2FlashCmd) ready.mCommand); // Do it
     }
@@ -1,14 +1,20 @@
 #include "T2ITC.h"
 #include "T2Tile.h"
 #include "T2EventWindow.h"
+#include "Probes.h"
 
 #include <sys/types.h> 
 #include <sys/stat.h>
 #include <fcntl.h>
 
 #include <unistd.h>    // For close
+#include <sys/uio.h>   // For writev
+#include <sys/epoll.h> // For EPOLLIN
+#include <sys/socket.h> // For loopback ITCs
+#include <sys/un.h>     // For sockaddr_un
 #include <stdio.h>     // For snprintf
 #include <errno.h>     // For errno
+#include <string.h>    // For memset, strlen
 
 #include "dirdatamacro.h" 
 #include "TraceTypes.h" 
@@ -22,13 +28,18 @@ namespace MFM {
   { }
 
   void T2ITCPacketPoller::onTimeout(TimeQueue& srcTq) {
+    bool allWatched = true;
     for (ITCIterator itr = mIteration.begin(); itr.hasNext(); ) {
       u32 dir6 = itr.next();
       T2ITC & itc = mTile.getITC(dir6);
       itc.pollPackets(true);
+      itc.flushPackets(); // Retry anything the LKM had no room for
+      if (!itc.isFDWatched() || itc.getPacketsQueued() > 0)
+        allWatched = false;
     }
 
-    scheduleWait(WC_RANDOM_SHORT);
+    // If arriving packets will bump us, this is just a safety sweep
+    scheduleWait(allWatched ? WC_HALF : WC_RANDOM_SHORT);
   }
 
   bool T2ITC::isGingerDir6(Dir6 dir6) {
@@ -102,6 +113,7 @@ namespace MFM {
       initStatePacket(pb);
       ops.timeout(*this, pb, srcTq);
     }
+    flushPackets();
   }
 
   void T2ITC::pollPackets(bool dispatch) {
@@ -154,6 +166,9 @@ namespace MFM {
       FAIL(ILLEGAL_STATE);
     T2Tile & tile = T2Tile::get();
     T2ActiveEventWindow & aew = tile.getActiveEW(slotnum);
+    const Circuit * cp = aew.getActiveCircuitForITCIfAny(*this);
+    if (cp && cp->getCS() == CS_RUNG)
+      noteRingReplied(*cp, false);
     aew.handleBusy(*this);
   }
 
@@ -180,6 +195,7 @@ namespace MFM {
     u8 radius;
     if (!asCSRing(pb, &cn, &sx, &sy, &ayoink, &radius))
       FAIL(UNREACHABLE_CODE);
+    getStats().incrRingsReceived();
 
     SPoint theirCtr(sx,sy);
     SPoint theirOrigin = getMateITCOrigin();
@@ -199,12 +215,15 @@ namespace MFM {
     MFM_API_ASSERT_STATE(pEW.getEWSN() == EWSN_IDLE);
 
     pEW.initPassive(ourCtr, radius, ayoink);
-    pEW.setEWSN(EWSN_PRESOLVE);
-
-    if (!pEW.checkSiteAvailabilityForPassive()) { // false -> passive lost, busy sent
-      pEW.resetPassiveEW();
-      TLOG(DBG,"Passive cn %d released",cn);
-      return;
+    mTile.notePassiveEWStarted();
+
+    if (!pEW.tryClaimFreeSitesForPassive()) { // Usually free; else resolve races
+      pEW.setEWSN(EWSN_PRESOLVE);
+      if (!pEW.checkSiteAvailabilityForPassive()) { // false -> passive lost, busy sent
+        pEW.resetPassiveEW();
+        TLOG(DBG,"Passive cn %d released",cn);
+        return;
+      }
     }
 
     if (!trySendAnswerPacket(cn)) {
@@ -269,6 +288,22 @@ namespace MFM {
     passiveEW.applyCacheUpdatesPacket(pb, *this);
   }
 
+  T2ITCStats & T2ITC::getStats() {
+    return mTile.getStats().getITCStats(mDir6);
+  }
+
+  void T2ITC::noteRingSent(Circuit & ci) {
+    ci.setRungUsec(T2ITCStats::nowUsec());
+    getStats().incrRingsSent();
+  }
+
+  void T2ITC::noteRingReplied(const Circuit & ci, bool answered) {
+    T2ITCStats & stats = getStats();
+    if (answered) stats.incrAnswersReceived();
+    else stats.incrBusysReceived();
+    stats.recordRTT(T2ITCStats::nowUsec() - ci.getRungUsec());
+  }
+
   void T2ITC::hangUpPassiveEW(T2EventWindow & passiveEW, CircuitNum cn) {
     MFM_API_ASSERT_ARG(passiveEW.getEWSN() == EWSN_PWCACHE);
     MFM_API_ASSERT_ARG(cn < MAX_EWSLOT);
@@ -307,6 +342,7 @@ namespace MFM {
     }
 
     ci.setCS(CS_ANSWERED); // We have this lock
+    noteRingReplied(ci, true);
 
     T2EventWindow & ew = ci.getEW();
     T2ActiveEventWindow * aewp = ew.asActiveEW();
@@ -344,13 +380,21 @@ namespace MFM {
       }
       return false;
     }
+    if (len == 0 && mTile.isLoopback()) {
+      // T2Loop dropped our link.  It marks us down in its status
+      // too, so we'll be reset (and reconnected) soon enough
+      LOG.Warning("%s: loopback link closed", getName());
+      close();
+      return false;
+    }
     if (!dispatch) return true;
     if (len == 1)
       LOG.Debug("%s: Recv %d/0x%02x", getName(), len, packet[0]);
     else
       LOG.Debug("%s: Recv %d/0x%02x 0x%02x%s", getName(), len,
                 packet[0], packet[1], len > 2? " ..." : "");
-    if (true/*TRACEACTIVE*/) {
+    if ((mTile.isTracingActive() && asTagSync(pb, 0)) ||
+        mTile.isTracing(TTC_ITC_PacketIn)) {
       Trace evt(*this, TTC_ITC_PacketIn);
       evt.payloadWrite().WriteBytes((const u8*) packet, len);
       mTile.tlog(evt);
@@ -375,6 +419,8 @@ namespace MFM {
   }
 
   bool T2ITC::trySendPacket(T2PacketBuffer & pb) {
+    if (mOutboundCount > 0) flushPackets();
+    if (mOutboundCount > 0) return false; // Can't jump the queue
     s32 packetlen = pb.GetLength();
     const char * bytes = pb.GetBuffer();
     s32 len = ::write(mFD, bytes, packetlen);
@@ -396,23 +442,104 @@ namespace MFM {
       if (errno == ERESTART) return false; // Interrupted, try again
     }
     if (len != packetlen) return false;  // itcpkt LKM doesn't actually support partial write
-    if (true /*XXX TRACE ACTIVE*/) {
+    notePacketShipped(bytes, len);
+    return true;                         // 'the bird is away'
+  }
+
+  /* Sync packets skip trace sampling and masks: the weaver aligns
+     tiles' traces on them.  All are six bytes long. */
+  static bool isSyncPacket(const char * bytes, s32 len) {
+    if (len != 6) return false;
+    T2PacketBuffer pb;
+    pb.WriteBytes((const u8 *) bytes, len);
+    return asTagSync(pb, 0);
+  }
+
+  void T2ITC::notePacketShipped(const char * bytes, s32 len) {
+    if ((mTile.isTracingActive() && isSyncPacket(bytes, len)) ||
+        mTile.isTracing(TTC_ITC_PacketOut)) {
       Trace evt(*this, TTC_ITC_PacketOut);
       evt.payloadWrite().WriteBytes((const u8*) bytes,len);
       mTile.tlog(evt);
     }
-    ++mPacketsShipped;                   // another day, 
-    return true;                         // 'the bird is away'
+    ++mPacketsShipped;                   // another day,
+  }
+
+  bool T2ITC::queuePacket(const T2PacketBuffer & pb) {
+    T2PacketBuffer * opb = beginOutboundPacket();
+    if (!opb) return false;
+    opb->WriteBytes((const u8*) pb.GetBuffer(), pb.GetLength()); // Not all 256
+    commitOutboundPacket();
+    return true;
+  }
+
+  T2PacketBuffer * T2ITC::beginOutboundPacket() {
+    if (mOutboundCount == MAX_OUTBOUND_PACKETS) flushPackets();
+    if (mOutboundCount == MAX_OUTBOUND_PACKETS) return 0;
+    T2PacketBuffer & opb = getOutbound(mOutboundCount);
+    opb.Reset();
+    return &opb;
+  }
+
+  void T2ITC::commitOutboundPacket() {
+    MFM_API_ASSERT_STATE(mOutboundCount < MAX_OUTBOUND_PACKETS);
+    ++mOutboundCount;
+  }
+
+  u32 T2ITC::flushPackets() {
+    if (mOutboundCount == 0 || mFD < 0) return 0;
+
+    // The itcpkt LKM takes one packet per write(2).  It has no
+    // write_iter, so the kernel runs a writev(2) on it as one write
+    // per iovec, stopping at the first that fails -- so the byte
+    // count returned tells us how many whole packets got out.
+    struct iovec iov[MAX_OUTBOUND_PACKETS];
+    for (u32 i = 0; i < mOutboundCount; ++i) {
+      T2PacketBuffer & opb = getOutbound(i);
+      iov[i].iov_base = (void*) opb.GetBuffer();
+      iov[i].iov_len = opb.GetLength();
+    }
+    s32 len = 0;
+    if (mTile.isLoopback()) {
+      // But a loopback ITC is a seqpacket socket, which would take a
+      // writev(2) as one big packet, so there they go one by one
+      for (u32 i = 0; i < mOutboundCount; ++i) {
+        s32 wrote = ::write(mFD, iov[i].iov_base, iov[i].iov_len);
+        if (wrote != (s32) iov[i].iov_len) break;
+        len += wrote;
+      }
+    } else len = ::writev(mFD, iov, mOutboundCount);
+    LOG.Debug("  %s wrote %d packets == %d", getName(), mOutboundCount, len);
+    if (len <= 0) return 0;    // EAGAIN, ERESTART, ..: Try again later
+
+    u32 sent = 0;
+    while (sent < mOutboundCount && len >= (s32) iov[sent].iov_len) {
+      len -= iov[sent].iov_len;
+      notePacketShipped((const char *) iov[sent].iov_base, iov[sent].iov_len);
+      ++sent;
+    }
+
+    mOutboundHead = (mOutboundHead + sent) % MAX_OUTBOUND_PACKETS;
+    mOutboundCount -= sent;
+    return sent;
   }
 
   void T2ITC::setITCSN(ITCStateNumber itcsn) {
     MFM_API_ASSERT_ARG(itcsn >= 0 && itcsn < MAX_ITC_STATE_NUMBER);
-    mTile.tlog(Trace(*this, TTC_ITC_StateChange,"%c",(u8) itcsn));
+    if (mTile.isTracing(TTC_ITC_StateChange))
+      mTile.tlog(Trace(*this, TTC_ITC_StateChange,"%c",(u8) itcsn));
+    MFM_PROBE3(itc__state, (void *) this, (u32) mDir6, (u32) itcsn);
+    const bool wasOpen = mStateNumber == ITCSN_OPEN;
     mStateNumber = itcsn;
+    if ((itcsn == ITCSN_OPEN) != wasOpen)
+      mTile.InvalidateConnectedDirs(); // IsConnected just changed
   }
 
   void T2ITC::reset() {
     if (mFD >= 0) close();
+    mOutboundHead = 0;
+    mOutboundCount = 0;       // Stale once the ITC restarts
+    mPeerDigestBlocks = 0;
     initializeFD();
     abortAllActiveCircuits();
     mCacheReceiveComplete = false;
@@ -438,11 +565,15 @@ namespace MFM {
   }
 
   void T2ITC::abortAllActiveCircuits() {
-    for (u32 i = 0; i < MAX_EWSLOT; ++i) {
-      if (mActiveEWCircuits[i] != 0)
-        mActiveEWCircuits[i]->abortCircuit();
-      MFM_API_ASSERT_NULL(mActiveEWCircuits[i]);
+    // Visit just the in-use circuits; each abort clears its own bit
+    u32 bits = mActiveEWCircuitBits;
+    while (bits != 0) {
+      const u32 cn = __builtin_ctz(bits);
+      bits &= bits - 1;
+      mActiveEWCircuits[cn]->abortCircuit();
+      MFM_API_ASSERT_NULL(mActiveEWCircuits[cn]);
     }
+    MFM_API_ASSERT_STATE(mActiveEWCircuitBits == 0);
   }
 
   T2ITC::T2ITC(T2Tile& tile, Dir6 dir6, const char * name)
@@ -453,12 +584,21 @@ namespace MFM {
     , mPacketsShipped(0u)
     , mStateNumber(ITCSN_SHUT)
     , mFD(-1)
+    , mFDWatched(false)
     , mActiveEWCircuits{ 0 }
-    , mActiveEWCircuitCount(0)
+    , mActiveEWCircuitBits(0)
     , mPassiveEWs{ 0 }
-    , mVisibleAtomsToSend()
+    , mCacheAtomsSent(0)
+    , mCacheSiteToSend(0)
+    , mCacheDigestSent(false)
+    , mCacheDigestWaits(0)
+    , mPeerDigestBlocks(0)
+    , mCacheAtomsReceived(0)
     , mCacheReceiveComplete(false)
+    , mOutboundHead(0)
+    , mOutboundCount(0)
     {
+      COMPILATION_REQUIREMENT<MAX_EWSLOT <= 32>(); // mActiveEWCircuitBits
       for (u32 i = 0; i < MAX_EWSLOT; ++i) 
         mPassiveEWs[i] = new T2PassiveEventWindow(mTile, i, mName, *this);
     }
@@ -540,13 +680,6 @@ void T2ITCStateOps_##NAME::FUNC(T2ITC & ew, T2PacketBuffer & pb, TimeQueue& tq)
     return *ops;
   }
 
-  s8 T2ITC::getYoinkVal(CircuitNum cn, bool forActive) const {
-    FAIL(INCOMPLETE_CODE);
-    return -1;
-    //    MFM_API_ASSERT_ARG(cn < MAX_EWSLOT);
-    //    return mCircuits[forActive ? 1 : 0][cn].mYoinkVal;
-  }
-
   void T2ITC::registerActiveCircuitRaw(Circuit & ct) {
     const T2EventWindow & ew = ct.getEW();
     MFM_API_ASSERT_STATE(ew.isActiveEW());
@@ -555,7 +688,7 @@ void T2ITCStateOps_##NAME::FUNC(T2ITC & ew, T2PacketBuffer & pb, TimeQueue& tq)
     MFM_API_ASSERT_NULL(mActiveEWCircuits[sn]);
     MFM_API_ASSERT_STATE(isVisibleUsable());
     mActiveEWCircuits[sn] = &ct;
-    ++mActiveEWCircuitCount;
+    mActiveEWCircuitBits |= 1u<<sn;
   }
 
   void T2ITC::unregisterActiveCircuitRaw(Circuit & ct) {
@@ -564,28 +697,57 @@ void T2ITCStateOps_##NAME::FUNC(T2ITC & ew, T2PacketBuffer & pb, TimeQueue& tq)
     EWSlotNum sn = ew.getSlotNum();
     MFM_API_ASSERT_STATE(sn < MAX_EWSLOT);
     if (mActiveEWCircuits[sn] != 0) {
-      MFM_API_ASSERT_STATE(mActiveEWCircuitCount > 0);
+      MFM_API_ASSERT_STATE(mActiveEWCircuitBits & (1u<<sn));
       mActiveEWCircuits[sn] = 0;
-      --mActiveEWCircuitCount;
+      mActiveEWCircuitBits &= ~(1u<<sn);
     }
-    if (mActiveEWCircuitCount == 0 && getITCSN() == ITCSN_DRAIN)
+    if (mActiveEWCircuitBits == 0 && getITCSN() == ITCSN_DRAIN)
       scheduleWait(WC_NOW); // bump
   }
 
   const char * T2ITC::path() const {
-    static char buf[100];
-    snprintf(buf,100,"/dev/itc/mfm/%s",mName);
+    static char buf[256];
+    if (mTile.isLoopback())
+      snprintf(buf,256,"%s/%s",mTile.getLoopbackDir(),mName);
+    else
+      snprintf(buf,256,"/dev/itc/mfm/%s",mName);
     return buf;
   }
 
+  /* T2Loop listens on a seqpacket socket for each of our ITCs, so
+     reads and writes keep their packet boundaries like the LKM's */
+  static int openLoopback(const char * path) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path)) return -ENAMETOOLONG;
+    strcpy(addr.sun_path, path);
+    int fd = ::socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK, 0);
+    if (fd < 0) return -errno;
+    if (::connect(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+      int err = errno;
+      ::close(fd);
+      return -err;
+    }
+    return fd;
+  }
+
   int T2ITC::open() {
-    int ret = ::open(path(),O_RDWR|O_NONBLOCK);
-    if (ret < 0) return -errno;
+    int ret;
+    if (mTile.isLoopback()) ret = openLoopback(path());
+    else {
+      ret = ::open(path(),O_RDWR|O_NONBLOCK);
+      if (ret < 0) ret = -errno;
+    }
+    if (ret < 0) return ret;
     mFD = ret;
+    mFDWatched = mTile.getFDReactor().watch(mFD, EPOLLIN, mTile.getPacketPoller());
     return ret;
   }
 
   int T2ITC::close() {
+    if (mFDWatched) mTile.getFDReactor().unwatch(mFD);
+    mFDWatched = false;
     int ret = ::close(mFD);
     mFD = -1;
     if (ret < 0) return -errno;
@@ -593,53 +755,197 @@ void T2ITCStateOps_##NAME::FUNC(T2ITC & ew, T2PacketBuffer & pb, TimeQueue& tq)
   }
 
   void T2ITC::startCacheSync() {
-    mVisibleAtomsToSend.begin(getVisibleRect());
+    mCacheSiteToSend = 0;
+    mCacheDigestSent = false;
+    mCacheDigestWaits = 0;
     mCacheAtomsSent = 0;
     mCacheAtomsReceived = 0;
     setITCSN(ITCSN_CACHEXG);
     scheduleWait(WC_NOW);
   }
 
+  static void printU32(ByteSink & bs, u32 val) {
+    bs.Printf("%c%c%c%c", (u8) (val>>24), (u8) (val>>16), (u8) (val>>8), (u8) val);
+  }
+
+  static bool scanU32(ByteSource & in, u32 & val) {
+    u8 b0, b1, b2, b3;
+    if (in.Scanf("%c%c%c%c", &b0, &b1, &b2, &b3) != 4) return false;
+    val = (((u32) b0)<<24) | (((u32) b1)<<16) | (((u32) b2)<<8) | b3;
+    return true;
+  }
+
+  static SPoint getCacheSyncSite(const Rect & rect, u32 site) {
+    const u32 w = rect.GetWidth();
+    return rect.GetPosition() + SPoint(site % w, site / w);
+  }
+
+  static u32 getCacheSyncArea(const Rect & rect) {
+    return rect.GetWidth() * rect.GetHeight();
+  }
+
+  static u32 getCacheSyncBlocks(const Rect & rect) {
+    return (getCacheSyncArea(rect) + T2ITC::CACHE_BLOCK_SITES - 1) / T2ITC::CACHE_BLOCK_SITES;
+  }
+
+  u32 T2ITC::hashCacheBlock(Sites & sites, const Rect & rect, u32 block) {
+    const u32 first = block*CACHE_BLOCK_SITES;
+    const u32 end = MIN(first + CACHE_BLOCK_SITES, getCacheSyncArea(rect));
+    u32 hash = 2166136261u;     // FNV-1a over the atom bits, 32 at a time
+    for (u32 site = first; site < end; ++site) {
+      OurT2Site & s = sites.get(MakeUnsigned(getCacheSyncSite(rect, site)));
+      const OurT2AtomBitVector & bv = s.GetAtom().GetBits();
+      for (u32 i = 0; i < OurT2Atom::BPA; i += 32) {
+        hash ^= bv.Read(i, MIN(32u, (u32) OurT2Atom::BPA - i));
+        hash *= 16777619u;
+      }
+    }
+    return hash;
+  }
+
+  void T2ITC::queueCacheDigest(const T2PacketBuffer & pb) {
+    // Tell them what our cache -- their visible -- already holds
+    Sites & sites = mTile.getSites();
+    const Rect & cache = getCacheRect();
+    const u32 blocks = getCacheSyncBlocks(cache);
+    u32 block = 0;
+    while (block < blocks) {
+      T2PacketBuffer * opb = beginOutboundPacket();
+      if (!opb) FAIL(ILLEGAL_STATE); // Digests are small
+      opb->WriteBytes((const u8*) pb.GetBuffer(), pb.GetLength());
+      opb->Printf("%c%c", CACHEXG_DIGEST, (u8) block);
+      while (block < blocks && opb->CanWrite() >= 4)
+        printU32(*opb, hashCacheBlock(sites, cache, block++));
+      commitOutboundPacket();
+    }
+  }
+
+  u32 T2ITC::getCacheRunLength(u32 site, u32 & opcode) const {
+    // Sites from site on like site, up to what one opcode can say
+    Sites & sites = mTile.getSites();
+    const Rect & vis = getVisibleRect();
+    const u32 area = getCacheSyncArea(vis);
+    const OurT2Atom empty;
+    u32 len = 0;
+    for (u32 s = site; s < area; ++s) {
+      u32 op = CACHEXG_RUN_ATOMS;
+      if (mSameBlock[s/CACHE_BLOCK_SITES]) op = CACHEXG_RUN_SAME;
+      else {
+        OurT2Site & st = sites.get(MakeUnsigned(getCacheSyncSite(vis, s)));
+        if (st.GetAtom().GetBits() == empty.GetBits()) op = CACHEXG_RUN_EMPTY;
+      }
+      if (len == 0) opcode = op;
+      else if (op != opcode) break;
+      if (++len == (opcode == CACHEXG_RUN_EMPTY ? 0x7fu : 0x3fu)) break;
+    }
+    return len;
+  }
+
   bool T2ITC::sendVisibleAtoms(T2PacketBuffer & pb) { // Which presto-change-o arrive via recvCacheAtoms..
     const u32 BYTES_PER_ATOM = OurT2Atom::BPA/8; // Bits Per Atom/Bits Per Byte
-    const u32 BYTES_PER_DIM = 1; // Sending u8 dimensions inside visibleRect
-    const u32 BYTES_PER_COORD = 2*BYTES_PER_DIM;
-    const u32 BYTES_PER_SITE = BYTES_PER_COORD+BYTES_PER_ATOM;
     Sites & sites = mTile.getSites();
-    UPoint pos = MakeUnsigned(mVisibleAtomsToSend.getRect().GetPosition());
-    RectIterator hold = mVisibleAtomsToSend;
-    bool alreadyDone = !mVisibleAtomsToSend.hasNext();
-    u32 pending = 0;
-    while (mVisibleAtomsToSend.hasNext()) {
-      if (pb.CanWrite() < (s32) BYTES_PER_SITE) break;
-      SPoint coord = mVisibleAtomsToSend.next();
-      UPoint ucoord = MakeUnsigned(coord);
-      UPoint coordInVis = ucoord - pos;
-      pb.Printf("%c%c",(u8) coordInVis.GetX(), (u8) coordInVis.GetY());
-      
-      OurT2Site & site = sites.get(ucoord);
-      OurT2Atom & atom = site.GetAtom();
-      const OurT2AtomBitVector & bv = atom.GetBits();
-      bv.PrintBytes(pb);
-      ++pending;
-    }
-    if (trySendPacket(pb)) {
-      mCacheAtomsSent += pending;
-      return alreadyDone; // true when we just sent an empty CACHEXG
-    }
-    // Grrr
-    mVisibleAtomsToSend = hold; // All that work.
-    return false;
-  }
-
-  bool T2ITC::tryReadAtom(ByteSource & in, UPoint & where, OurT2AtomBitVector & bv) {
-    u8 x,y;
-    if (in.Scanf("%c%c",&x,&y) != 2) return false;
-    OurT2AtomBitVector tmpbv;
-    if (!tmpbv.ReadBytes(in)) return false;
-    where.SetX(x);
-    where.SetY(y);
-    bv = tmpbv;
+    const Rect & vis = getVisibleRect();
+    const u32 area = getCacheSyncArea(vis);
+    const u32 blocks = getCacheSyncBlocks(vis);
+    MFM_API_ASSERT_STATE(area <= MAX_CACHE_SYNC_SITES);
+
+    if (mOutboundCount > 0) flushPackets(); // Leftovers go first
+
+    if (!mCacheDigestSent) { // Trade digests before any sites
+      queueCacheDigest(pb);
+      mCacheDigestSent = true;
+    }
+
+    if (mCacheSiteToSend == 0 && mCacheAtomsSent == 0) {
+      if (mPeerDigestBlocks < blocks && mCacheDigestWaits++ < MAX_DIGEST_WAITS) {
+        flushPackets();
+        return false;           // Give their digest a chance to arrive
+      }
+      const bool known = mPeerDigestBlocks >= blocks;
+      for (u32 b = 0; b < blocks; ++b)
+        mSameBlock[b] = known && hashCacheBlock(sites, vis, b) == mPeerDigest[b];
+    }
+
+    // Fill the outbound queue with runs of unchanged, empty, and
+    // literal sites, ending with an empty CACHEXG once all are covered
+    bool done = false;
+    while (!done && mOutboundCount < MAX_OUTBOUND_PACKETS) {
+      // Built in place in the queue; pb holds just the CACHEXG header
+      T2PacketBuffer & opb = getOutbound(mOutboundCount);
+      opb.Reset();
+      opb.WriteBytes((const u8*) pb.GetBuffer(), pb.GetLength());
+      done = mCacheSiteToSend >= area;
+      if (!done) {
+        opb.Printf("%c%c%c", CACHEXG_SITES,
+                   (u8) (mCacheSiteToSend>>8), (u8) mCacheSiteToSend);
+        while (mCacheSiteToSend < area && opb.CanWrite() > 0) {
+          u32 opcode;
+          u32 len = getCacheRunLength(mCacheSiteToSend, opcode);
+          if (opcode == CACHEXG_RUN_ATOMS) {
+            const s32 room = (opb.CanWrite() - 1) / (s32) BYTES_PER_ATOM;
+            if (room <= 0) break;
+            if (len > (u32) room) len = room;
+          }
+          opb.Printf("%c", (u8) (opcode | len));
+          for (u32 i = 0; opcode == CACHEXG_RUN_ATOMS && i < len; ++i) {
+            OurT2Site & site = sites.get(MakeUnsigned(getCacheSyncSite(vis, mCacheSiteToSend + i)));
+            site.GetAtom().GetBits().PrintBytes(opb);
+          }
+          mCacheSiteToSend += len;
+          mCacheAtomsSent += len;
+        }
+      }
+      commitOutboundPacket();   // Loop guard said room
+    }
+    flushPackets();
+    return done && mOutboundCount == 0; // true when the empty CACHEXG is away
+  }
+
+  bool T2ITC::recvCacheDigest(ByteSource & in) {
+    u8 first;
+    if (in.Scanf("%c", &first) != 1) return false;
+    const u32 blocks = getCacheSyncBlocks(getVisibleRect());
+    if (first != mPeerDigestBlocks) return false; // Missed one; sync without
+    u32 hash;
+    while (scanU32(in, hash)) {
+      if (mPeerDigestBlocks >= blocks) return false;
+      mPeerDigest[mPeerDigestBlocks++] = hash;
+    }
+    return true;
+  }
+
+  bool T2ITC::recvCacheSites(ByteSource & in) {
+    u8 hi, lo;
+    if (in.Scanf("%c%c", &hi, &lo) != 2) return false;
+    Sites & sites = mTile.getSites();
+    const Rect & cache = getCacheRect();
+    const u32 area = getCacheSyncArea(cache);
+    OurT2Atom tmpatom;
+    OurT2AtomBitVector & tmpbv = tmpatom.GetBits();
+    u32 site = (((u32) hi)<<8) | lo;
+
+    u8 op;
+    while (in.Scanf("%c", &op) == 1) {
+      const u32 opcode = (op & CACHEXG_RUN_EMPTY) ? CACHEXG_RUN_EMPTY : (op & 0xc0);
+      const u32 len = op & (opcode == CACHEXG_RUN_EMPTY ? 0x7f : 0x3f);
+      if (len == 0 || site + len > area) {
+        LOG.Error("%s: %d+%d ATTEMPT TO ESCAPE CACHE", getName(), site, len);
+        return false;
+      }
+      for (u32 i = 0; i < len; ++i, ++site) {
+        OurT2Site & st = sites.get(MakeUnsigned(getCacheSyncSite(cache, site)));
+        if (opcode == CACHEXG_RUN_EMPTY) st.GetAtom() = OurT2Atom();
+        else if (opcode == CACHEXG_RUN_ATOMS) {
+          if (!tmpbv.ReadBytes(in)) return false;
+          if (!tmpatom.IsSane()) {
+            LOG.Error("%s: RECEIVED INSANE ATOM",getName());
+            return false;
+          }
+          st.GetAtom() = tmpatom;  // BAM
+        }
+        ++mCacheAtomsReceived;
+      }
+    }
     return true;
   }
 
@@ -655,34 +961,23 @@ void T2ITCStateOps_##NAME::FUNC(T2ITC & ew, T2PacketBuffer & pb, TimeQueue& tq)
       return true;
     }
 
-    Sites & sites = mTile.getSites();
-    const Rect cache = getCacheRect();
-    const SPoint pos = cache.GetPosition();
-    u32 count = 0;
-    UPoint offset;
-    OurT2Atom tmpatom;
-    OurT2AtomBitVector & tmpbv = tmpatom.GetBits();
+    u8 kind;
+    if (cbs.Scanf("%c",&kind) != 1) return true; // CACHEXG w/no kind means end
 
-    while (tryReadAtom(cbs, offset, tmpbv)) {
-      SPoint dest = pos+MakeSigned(offset);
-      if (!cache.Contains(dest)) {
-        LOG.Error("%s: (%d,%d) ATTEMPT TO ESCAPE CACHE",
-                  getName(), dest.GetX(), dest.GetY());
-        reset();
-        return true;
-      }
-      if (!tmpatom.IsSane()) {
-        LOG.Error("%s: RECEIVED INSANE ATOM",getName());
-        reset();
-        return true;
-      }
-      OurT2Site & site = sites.get(MakeUnsigned(dest));
-      OurT2Atom & atom = site.GetAtom();
-      atom = tmpatom;  // BAM
-      ++mCacheAtomsReceived;
-      ++count;
+    switch (kind) {
+    case CACHEXG_DIGEST:
+      if (!recvCacheDigest(cbs))
+        mPeerDigestBlocks = 0;  // Unusable; they'll just send everything
+      return false;
+    case CACHEXG_SITES:
+      if (recvCacheSites(cbs)) return false;
+      break;
+    default:
+      LOG.Error("%s: Bad CACHEXG kind %d", getName(), kind);
+      break;
     }
-    return count == 0; // CACHEXG w/no atoms means end
+    reset();
+    return true;
   }
 
   /////////////////// CUSTOM T2ITCStateOps HANDLERS
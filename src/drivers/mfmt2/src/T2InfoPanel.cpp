@@ -191,6 +191,7 @@ namespace MFM {
         ITCStateNumber itcsn = itc.getITCSN();
         mITCStatuses[dir6].setIsOpen(itcsn > ITCSN_SHUT);
         mITCStatuses[dir6].setIsAlive(itcsn >= ITCSN_OPEN);
+        mITCStatuses[dir6].updateCircuitStats(tile.getStats().getITCStats(dir6));
       }
     } while(0);
 
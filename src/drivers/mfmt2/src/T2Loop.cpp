@@ -0,0 +1,709 @@
+#include "T2Loop.h"
+
+#include <getopt.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>     // For strerror, memcpy
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>       // For clock_gettime
+#include <unistd.h>
+#include <sys/mman.h>   // For mmap
+#include <sys/socket.h>
+#include <sys/stat.h>   // For mkdir, fstat
+#include <sys/un.h>     // For sockaddr_un
+
+#include "dirdatamacro.h"
+
+#include "FileByteSink.h"  // For STDERR
+#include "Logger.h"
+#include "CharBufferByteSource.h"
+
+#include "T2Constants.h"
+#include "T2PacketBuffer.h"
+#include "T2StatsExport.h"
+
+namespace MFM {
+
+  LoopEnd::LoopEnd()
+    : mTile(0)
+    , mDir6(0)
+    , mPeer(-1)
+    , mListenFD(-1)
+    , mFD(-1)
+    , mWireFreeUsec(0)
+    , mInbound()
+  { }
+
+  LoopTile::LoopTile()
+    : mX(0)
+    , mY(0)
+    , mDir()
+    , mStatusFD(-1)
+    , mStats(0)
+    , mLast()
+    , mHaveLast(false)
+  { }
+
+  LoopCounts::LoopCounts()
+    : mPackets(0)
+    , mBytes(0)
+    , mLost(0)
+    , mDown(0)
+    , mFull(0)
+    , mLocal(0)
+  { }
+
+  void LoopCounts::add(const LoopCounts & other) {
+    mPackets += other.mPackets;
+    mBytes += other.mBytes;
+    mLost += other.mLost;
+    mDown += other.mDown;
+    mFull += other.mFull;
+    mLocal += other.mLocal;
+  }
+
+  static volatile sig_atomic_t sStopRequested = 0;
+
+  static void requestStop(int) { sStopRequested = 1; }
+
+  T2Loop::T2Loop()
+    : mDir(0)
+    , mWidth(2)
+    , mHeight(1)
+    , mLatencyUsec(0)
+    , mBandwidth(0)
+    , mLossPPM(0)
+    , mSeed(1)
+    , mReportSecs(5)
+    , mDurationSecs(0)
+    , mRandom()
+    , mTiles()
+    , mEnds()
+    , mInterval()
+    , mTotal()
+    , mStartUsec(0)
+    , mLastReportUsec(0)
+  { }
+
+  T2Loop::~T2Loop() {
+    tearDown();
+  }
+
+  u64 T2Loop::nowUsec() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((u64) ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+  }
+
+  s32 T2Loop::getNeighborTile(u32 tile, Dir6 dir6) const {
+    s32 x = mTiles[tile].mX;
+    s32 y = mTiles[tile].mY;
+    const s32 odd = y & 1;      // Odd rows sit half a tile east
+    switch (dir6) {
+    case DIR6_ET: ++x; break;
+    case DIR6_WT: --x; break;
+    case DIR6_NE: x += odd; --y; break;
+    case DIR6_NW: x += odd - 1; --y; break;
+    case DIR6_SE: x += odd; ++y; break;
+    case DIR6_SW: x += odd - 1; ++y; break;
+    default: FAIL(ILLEGAL_ARGUMENT);
+    }
+    if (x < 0 || y < 0 || x >= (s32) mWidth || y >= (s32) mHeight) return -1;
+    return y * mWidth + x;
+  }
+
+  bool T2Loop::isLinked(const LoopEnd & end) const {
+    return end.mFD >= 0 && end.mPeer >= 0 && mEnds[end.mPeer].mFD >= 0;
+  }
+
+  void T2Loop::setUp() {
+    if (::mkdir(mDir, 0755) < 0 && errno != EEXIST)
+      fatal("Can't make '%s': %s", mDir, strerror(errno));
+
+    const u32 count = mWidth * mHeight;
+    mTiles.resize(count);
+    mEnds.resize(count * DIR6_COUNT);
+    for (u32 t = 0; t < count; ++t) {
+      LoopTile & lt = mTiles[t];
+      lt.mX = t % mWidth;
+      lt.mY = t / mWidth;
+      OString256 dir;
+      dir.Printf("%s/tile-%d-%d", mDir, lt.mX, lt.mY);
+      lt.mDir = dir.GetZString();
+      if (::mkdir(lt.mDir.c_str(), 0755) < 0 && errno != EEXIST)
+        fatal("Can't make '%s': %s", lt.mDir.c_str(), strerror(errno));
+
+      OString256 status;
+      status.Printf("%s/status", lt.mDir.c_str());
+      lt.mStatusFD = ::open(status.GetZString(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+      if (lt.mStatusFD < 0)
+        fatal("Can't make '%s': %s", status.GetZString(), strerror(errno));
+    }
+
+    for (u32 t = 0; t < count; ++t) {
+      for (Dir6 dir6 = 0; dir6 < DIR6_COUNT; ++dir6) {
+        LoopEnd & end = mEnds[t * DIR6_COUNT + dir6];
+        end.mTile = t;
+        end.mDir6 = dir6;
+        const s32 nt = getNeighborTile(t, dir6);
+        const Dir6 facing = (dir6 + DIR6_COUNT/2) % DIR6_COUNT;
+        end.mPeer = nt < 0 ? -1 : (s32) (nt * DIR6_COUNT + facing);
+
+        struct sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        OString256 path;
+        path.Printf("%s/%s", mTiles[t].mDir.c_str(), getDir6Name(dir6));
+        const char * zpath = path.GetZString();
+        if (strlen(zpath) >= sizeof(addr.sun_path))
+          fatal("Socket path too long: '%s'", zpath);
+        strcpy(addr.sun_path, zpath);
+        ::unlink(zpath);          // Left from an earlier run, maybe
+
+        int fd = ::socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK, 0);
+        if (fd < 0 ||
+            ::bind(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0 ||
+            ::listen(fd, 4) < 0)
+          fatal("Can't listen on '%s': %s", zpath, strerror(errno));
+        end.mListenFD = fd;
+      }
+      writeStatus(t);
+    }
+
+    for (u32 t = 0; t < count; ++t)
+      printf("tile (%d,%d): mfmt2 --loopback %s\n",
+             mTiles[t].mX, mTiles[t].mY, mTiles[t].mDir.c_str());
+    fflush(stdout);
+  }
+
+  void T2Loop::tearDown() {
+    for (u32 i = 0; i < mEnds.size(); ++i) {
+      LoopEnd & end = mEnds[i];
+      if (end.mFD >= 0) ::close(end.mFD);
+      end.mFD = -1;
+      if (end.mListenFD >= 0) {
+        ::close(end.mListenFD);
+        OString256 path;
+        path.Printf("%s/%s", mTiles[end.mTile].mDir.c_str(), getDir6Name(end.mDir6));
+        ::unlink(path.GetZString());
+      }
+      end.mListenFD = -1;
+    }
+    for (u32 t = 0; t < mTiles.size(); ++t) {
+      LoopTile & lt = mTiles[t];
+      if (lt.mStatusFD >= 0) ::close(lt.mStatusFD);
+      lt.mStatusFD = -1;
+      if (lt.mStats) ::munmap((void *) lt.mStats, T2StatsExporter::EXPORT_BYTES);
+      lt.mStats = 0;
+    }
+  }
+
+  /* Same layout as /sys/class/itc_pkt/status, which is what the
+     tile's KITCPoller reads: a hex digit per Dir8, highest first.
+     '2' is enough for an ITC to open; we give it only while both
+     tiles of the link are connected. */
+  void T2Loop::writeStatus(u32 tile) {
+    char buf[DIR8_COUNT];
+    memset(buf, '0', sizeof(buf));
+    for (Dir6 dir6 = 0; dir6 < DIR6_COUNT; ++dir6) {
+      const LoopEnd & end = mEnds[tile * DIR6_COUNT + dir6];
+      buf[(DIR8_COUNT-1) - mapDir6ToDir8(dir6)] = isLinked(end) ? '2' : '0';
+    }
+    if (::pwrite(mTiles[tile].mStatusFD, buf, sizeof(buf), 0) != sizeof(buf))
+      LOG.Warning("Can't write status for %s: %s",
+                  mTiles[tile].mDir.c_str(), strerror(errno));
+  }
+
+  void T2Loop::dropInbound(LoopEnd & end) {
+    mInterval.mDown += end.mInbound.size();
+    end.mInbound.clear();
+    end.mWireFreeUsec = 0;
+  }
+
+  void T2Loop::acceptOn(LoopEnd & end) {
+    int fd = ::accept4(end.mListenFD, 0, 0, SOCK_NONBLOCK);
+    if (fd < 0) {
+      if (errno != EAGAIN && errno != EWOULDBLOCK)
+        LOG.Warning("Accept on %s/%s failed: %s", mTiles[end.mTile].mDir.c_str(),
+                    getDir6Name(end.mDir6), strerror(errno));
+      return;
+    }
+    // A reconnecting ITC has reset: whatever was in flight to its
+    // old connection is lost, as it would be on the hardware
+    if (end.mFD >= 0) ::close(end.mFD);
+    dropInbound(end);
+    end.mFD = fd;
+    LOG.Message("%s/%s connected", mTiles[end.mTile].mDir.c_str(), getDir6Name(end.mDir6));
+    writeStatus(end.mTile);
+    if (end.mPeer >= 0) writeStatus(mEnds[end.mPeer].mTile);
+  }
+
+  void T2Loop::disconnect(LoopEnd & end) {
+    if (end.mFD < 0) return;
+    ::close(end.mFD);
+    end.mFD = -1;
+    dropInbound(end);
+    LOG.Message("%s/%s disconnected", mTiles[end.mTile].mDir.c_str(), getDir6Name(end.mDir6));
+    writeStatus(end.mTile);
+    if (end.mPeer >= 0) writeStatus(mEnds[end.mPeer].mTile);
+  }
+
+  void T2Loop::readFrom(LoopEnd & end, u64 now) {
+    u8 buf[MAX_PACKET_SIZE + 1];
+    while (end.mFD >= 0) {
+      ssize_t len = ::read(end.mFD, buf, sizeof(buf));
+      if (len < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK) return;
+        if (errno == EINTR) continue;
+        LOG.Warning("Read on %s/%s failed: %s", mTiles[end.mTile].mDir.c_str(),
+                    getDir6Name(end.mDir6), strerror(errno));
+      }
+      if (len <= 0) {
+        disconnect(end);
+        return;
+      }
+      forward(end, buf, (u32) len, now);
+    }
+  }
+
+  void T2Loop::forward(LoopEnd & from, const u8 * bytes, u32 len, u64 now) {
+    T2PacketBuffer pb;
+    pb.WriteBytes(bytes, len);
+    if (!isStandardRouted(pb) || len > MAX_PACKET_SIZE) {
+      ++mInterval.mLocal;
+      return;
+    }
+    if (!isLinked(from)) {
+      ++mInterval.mDown;
+      return;
+    }
+    if (mLossPPM > 0 && mRandom.Create(1000000) < mLossPPM) {
+      ++mInterval.mLost;
+      return;
+    }
+    LoopEnd & to = mEnds[from.mPeer];
+    if (to.mInbound.size() >= MAX_INBOUND) {
+      ++mInterval.mFull;
+      return;
+    }
+
+    // Packets serialize onto the wire one after another, then fly
+    u64 done = MAX(now, to.mWireFreeUsec);
+    if (mBandwidth > 0) done += ((u64) len) * 1000000 / mBandwidth;
+    to.mWireFreeUsec = done;
+
+    LoopPacket lp;
+    lp.mDueUsec = done + mLatencyUsec;
+    lp.mLength = len;
+    memcpy(lp.mBytes, bytes, len);
+    to.mInbound.push_back(lp);
+  }
+
+  void T2Loop::deliverTo(LoopEnd & end, u64 now) {
+    while (end.mFD >= 0 && !end.mInbound.empty()) {
+      const LoopPacket & lp = end.mInbound.front();
+      if (lp.mDueUsec > now) return;
+      ssize_t len = ::write(end.mFD, lp.mBytes, lp.mLength);
+      if (len < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK) return; // Tile's behind
+        if (errno == EINTR) continue;
+        LOG.Warning("Write on %s/%s failed: %s", mTiles[end.mTile].mDir.c_str(),
+                    getDir6Name(end.mDir6), strerror(errno));
+        disconnect(end);
+        return;
+      }
+      ++mInterval.mPackets;
+      mInterval.mBytes += lp.mLength;
+      end.mInbound.pop_front();
+    }
+  }
+
+  u64 T2Loop::getNextDueUsec() const {
+    u64 next = U64_MAX;
+    for (u32 i = 0; i < mEnds.size(); ++i) {
+      const LoopEnd & end = mEnds[i];
+      if (end.mFD >= 0 && !end.mInbound.empty())
+        next = MIN(next, end.mInbound.front().mDueUsec);
+    }
+    return next;
+  }
+
+  bool T2Loop::mapStats(LoopTile & tile) {
+    if (tile.mStats) return true;
+    OString256 path;
+    path.Printf("%s/stats", tile.mDir.c_str());
+    int fd = ::open(path.GetZString(), O_RDONLY);
+    if (fd < 0) return false;   // Tile hasn't exported yet
+    struct stat st;
+    void * map = MAP_FAILED;
+    if (::fstat(fd, &st) == 0 && st.st_size >= T2StatsExporter::EXPORT_BYTES)
+      map = ::mmap(0, T2StatsExporter::EXPORT_BYTES, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED) return false;
+
+    const T2StatsExportHeader * hdr = (const T2StatsExportHeader *) map;
+    if (__atomic_load_n(&hdr->mMagic, __ATOMIC_ACQUIRE) != T2STATS_EXPORT_MAGIC ||
+        hdr->mVersion != T2STATS_EXPORT_VERSION ||
+        hdr->mTileCounters != T2StatsExporter::TILE_COUNTERS ||
+        hdr->mITCCounters != T2StatsExporter::ITC_COUNTERS ||
+        hdr->mITCCount != DIR6_COUNT) {
+      ::munmap(map, T2StatsExporter::EXPORT_BYTES);
+      return false;             // Not ready, or not from our build
+    }
+    tile.mStats = (const u8 *) map;
+    return true;
+  }
+
+  bool T2Loop::sampleStats(LoopTile & tile, T2TileStats & stats) {
+    if (!mapStats(tile)) return false;
+    const T2StatsExportHeader * hdr = (const T2StatsExportHeader *) tile.mStats;
+    const u64 * counters = (const u64 *) (tile.mStats + hdr->mHeaderBytes);
+    for (u32 tries = 0; tries < 10; ++tries) {
+      const u32 seq = __atomic_load_n(&hdr->mSequence, __ATOMIC_ACQUIRE);
+      if (seq & 1) continue;    // Mid-update
+      const u64 * in = counters;
+      stats.mResetSeconds = hdr->mResetSeconds;
+#define XX(NM,CM) stats.m##NM = *in++;
+      ALL_TILE_STAT_U64S()
+#undef XX
+      for (u32 i = 0; i < DIR6_COUNT; ++i) {
+        T2ITCStats & itc = stats.getITCStats((Dir6) i);
+#define XX(NM,CM) itc.m##NM = *in++;
+        ALL_ITC_STAT_U64S()
+#undef XX
+        itc.mRTTSumUsec = *in++;
+        for (u32 b = 0; b < T2ITCStats::RTT_BUCKETS; ++b)
+          itc.mRTTHist[b] = *in++;
+      }
+      __atomic_thread_fence(__ATOMIC_ACQUIRE);
+      if (__atomic_load_n(&hdr->mSequence, __ATOMIC_RELAXED) == seq) return true;
+    }
+    return false;
+  }
+
+  void T2Loop::report(u64 now) {
+    const double secs = (now - mLastReportUsec) / 1000000.0;
+    if (secs <= 0) return;
+
+    u64 events = 0;
+    u32 sampled = 0;
+    T2ITCStats rtt;
+    rtt.reset();
+    for (u32 t = 0; t < mTiles.size(); ++t) {
+      LoopTile & lt = mTiles[t];
+      T2TileStats cur;
+      if (!sampleStats(lt, cur)) continue;
+      if (lt.mHaveLast && cur.getResetSeconds() == lt.mLast.getResetSeconds()) {
+        T2TileStats delta = cur - lt.mLast;
+        events += delta.getEmptyEventsCommitted() + delta.getNonemptyEventsCommitted();
+        for (u32 i = 0; i < DIR6_COUNT; ++i) {
+          const T2ITCStats & itc = delta.getITCStats((Dir6) i);
+          rtt.mRTTSumUsec += itc.mRTTSumUsec;
+          for (u32 b = 0; b < T2ITCStats::RTT_BUCKETS; ++b)
+            rtt.mRTTHist[b] += itc.getRTTBucketCount(b);
+        }
+        ++sampled;
+      }
+      lt.mLast = cur;
+      lt.mHaveLast = true;
+    }
+
+    u32 linked = 0, links = 0;
+    for (u32 i = 0; i < mEnds.size(); ++i) {
+      if (mEnds[i].mPeer < 0) continue;
+      ++links;
+      if (isLinked(mEnds[i])) ++linked;
+    }
+
+    const u32 p99 = rtt.getRTTQuantileUsec(0.99);
+    OString32 p99buf;
+    if (p99 == U32_MAX) p99buf.Printf(">%d", T2ITCStats::getRTTBucketLimitUsec(T2ITCStats::RTT_BUCKETS - 2));
+    else p99buf.Printf("<%d", p99);
+    printf("%7.1fs %d/%d ends linked: %8.0f pkt/s %10.0f B/s"
+           " dropped %llu local %llu lost %llu down %llu full |"
+           " %d tiles %9.0f events/s rtt mean %dus p99 %sus\n",
+           (now - mStartUsec) / 1000000.0,
+           linked, links,
+           mInterval.mPackets / secs,
+           mInterval.mBytes / secs,
+           (unsigned long long) mInterval.mLocal,
+           (unsigned long long) mInterval.mLost,
+           (unsigned long long) mInterval.mDown,
+           (unsigned long long) mInterval.mFull,
+           sampled,
+           events / secs,
+           rtt.getRTTMeanUsec(),
+           p99 == 0 ? "-" : p99buf.GetZString());
+    fflush(stdout);
+
+    mTotal.add(mInterval);
+    mInterval = LoopCounts();
+    mLastReportUsec = now;
+  }
+
+  void T2Loop::run() {
+    mStartUsec = mLastReportUsec = nowUsec();
+    const u64 reportUsec = ((u64) mReportSecs) * 1000000;
+    const u64 stopUsec = mDurationSecs == 0 ? U64_MAX :
+      mStartUsec + ((u64) mDurationSecs) * 1000000;
+
+    std::vector<struct pollfd> pfds;
+    std::vector<u32> pfdEnds;
+    while (!sStopRequested) {
+      u64 now = nowUsec();
+      if (now >= stopUsec) break;
+
+      pfds.clear();
+      pfdEnds.clear();
+      for (u32 i = 0; i < mEnds.size(); ++i) {
+        const LoopEnd & end = mEnds[i];
+        struct pollfd pfd;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        pfd.fd = end.mListenFD;
+        pfds.push_back(pfd);
+        pfdEnds.push_back(i);
+        if (end.mFD >= 0) {
+          pfd.fd = end.mFD;
+          pfds.push_back(pfd);
+          pfdEnds.push_back(i);
+        }
+      }
+
+      const u64 wake = MIN(MIN(getNextDueUsec(), mLastReportUsec + reportUsec), stopUsec);
+      const u64 waitUsec = wake > now ? wake - now : 0;
+      struct timespec timeout;
+      timeout.tv_sec = waitUsec / 1000000;
+      timeout.tv_nsec = (waitUsec % 1000000) * 1000;
+      if (::ppoll(&pfds[0], pfds.size(), &timeout, 0) < 0 && errno != EINTR)
+        fatal("ppoll failed: %s", strerror(errno));
+
+      now = nowUsec();
+      for (u32 i = 0; i < pfds.size(); ++i) {
+        if (pfds[i].revents == 0) continue;
+        LoopEnd & end = mEnds[pfdEnds[i]];
+        if (pfds[i].fd == end.mListenFD) acceptOn(end);
+        else if (pfds[i].fd == end.mFD) readFrom(end, now); // Unless just replaced
+      }
+      for (u32 i = 0; i < mEnds.size(); ++i)
+        deliverTo(mEnds[i], now);
+
+      if (now >= mLastReportUsec + reportUsec) report(now);
+    }
+
+    report(nowUsec());
+    printf("TOTAL %llu packets %llu bytes in %.1fs;"
+           " dropped %llu local %llu lost %llu down %llu full\n",
+           (unsigned long long) mTotal.mPackets,
+           (unsigned long long) mTotal.mBytes,
+           (nowUsec() - mStartUsec) / 1000000.0,
+           (unsigned long long) mTotal.mLocal,
+           (unsigned long long) mTotal.mLost,
+           (unsigned long long) mTotal.mDown,
+           (unsigned long long) mTotal.mFull);
+    fflush(stdout);
+  }
+
+#define ALL_CMD_ARGS()                                          \
+  XX(bandwidth,b,R,BPS,"Carry at most BPS bytes/sec each way on each link (default unlimited)") \
+  XX(duration,d,R,SECS,"Exit after SECS seconds (default run until interrupted)") \
+  XX(help,h,N,,"Print this help")                               \
+  XX(latency,L,R,USEC,"Deliver each packet USEC microseconds after it's sent (default 0)") \
+  XX(log,l,O,LEVEL,"Set or increase logging")                   \
+  XX(loss,x,R,PPM,"Drop PPM of every million packets at random (default 0)") \
+  XX(report,r,R,SECS,"Report every SECS seconds (default 5)")   \
+  XX(seed,s,R,SEED,"Seed the packet loss (default 1)")          \
+  XX(tiles,t,R,WxH,"Relay for a W by H grid of tiles (default 2x1)") \
+  XX(version,v,N,,"Print version and exit")                     \
+
+//GENERATE SHORT OPTION STRING
+#define XXR ":"
+#define XXN ""
+#define XXO "::"
+#define XX(L,S,A,V,D) #S XX##A
+  static const char * CMD_LINE_SHORT_OPTIONS =
+    ALL_CMD_ARGS()
+    ;
+#undef XXR
+#undef XXN
+#undef XXO
+#undef XX
+
+//GENERATE LONG OPTION STRUCT
+#define XXR required_argument
+#define XXN no_argument
+#define XXO optional_argument
+#define XX(L,S,A,V,D) { #L, XX##A, 0, #S[0] },
+
+  static struct option CMD_LINE_LONG_OPTIONS[] =
+    {
+     ALL_CMD_ARGS()
+     {0,0,0,0}
+    };
+#undef XXR
+#undef XXN
+#undef XXO
+#undef XX
+
+//GENERATE HELP STRING
+#define XXR(v) #v " "
+#define XXN(v) ""
+#define XXO(v) "[" #v "] "
+#define XX(L,S,A,V,D) \
+  "  --" #L " " XX##A(V) "or -" #S XX##A(V) "\n\t " D "\n\n"
+static const char * CMD_HELP_STRING =
+  "USAGE: T2Loop [ARGUMENTS] DIR\n\n"
+  "COMMAND LINE ARGUMENTS:\n\n"
+  ALL_CMD_ARGS()
+  "\n"
+  ;
+#undef XXR
+#undef XXN
+#undef XXO
+#undef XX
+
+  static bool parseU32(const char * arg, u32 & val) {
+    CharBufferByteSource cbbs(arg,strlen(arg));
+    return cbbs.Scanf("%d",&val) == 1;
+  }
+
+  void T2Loop::processArgs(int argc, char ** argv) {
+    int c;
+    int option_index;
+    int fails = 0;
+    int loglevel = -1;
+    while ((c = getopt_long(argc,argv,
+                            CMD_LINE_SHORT_OPTIONS,
+                            CMD_LINE_LONG_OPTIONS,
+                            &option_index)) != -1) {
+      switch (c) {
+      case 'b':
+        if (!parseU32(optarg, mBandwidth)) {
+          error("'%s' not legal as bytes/sec", optarg);
+          ++fails;
+        }
+        break;
+
+      case 'd':
+        if (!parseU32(optarg, mDurationSecs)) {
+          error("'%s' not legal as seconds", optarg);
+          ++fails;
+        }
+        break;
+
+      case 'L':
+        if (!parseU32(optarg, mLatencyUsec)) {
+          error("'%s' not legal as microseconds", optarg);
+          ++fails;
+        }
+        break;
+
+      case 'x':
+        if (!parseU32(optarg, mLossPPM) || mLossPPM > 1000000) {
+          error("'%s' not legal as parts per million", optarg);
+          ++fails;
+        }
+        break;
+
+      case 'r':
+        if (!parseU32(optarg, mReportSecs) || mReportSecs == 0) {
+          error("'%s' not legal as seconds", optarg);
+          ++fails;
+        }
+        break;
+
+      case 's':
+        if (!parseU32(optarg, mSeed) || mSeed == 0) {
+          error("'%s' not legal as a seed", optarg);
+          ++fails;
+        }
+        break;
+
+      case 't':
+        if (sscanf(optarg, "%ux%u", &mWidth, &mHeight) != 2 ||
+            mWidth == 0 || mHeight == 0 || mWidth * mHeight > MAX_TILES) {
+          error("'%s' not legal as WxH tiles (at most %d)", optarg, MAX_TILES);
+          ++fails;
+        }
+        break;
+
+      case 'l':
+        if (optarg) {
+          s32 level = LOG.ParseLevel(optarg);
+          if (level < 0) {
+            error("Not a logging level '%s'",optarg);
+            ++fails;
+          } else loglevel = (Logger::Level) level;
+        } else ++loglevel;
+        break;
+
+      case 'h':
+        printf("%s",CMD_HELP_STRING);
+        exit(0);
+
+      case 'v':
+        printf("For MFM%d.%d.%d (%s)\nBuilt on %08x at %06x by %s\n",
+               MFM_VERSION_MAJOR, MFM_VERSION_MINOR, MFM_VERSION_REV,
+               xstr(MFM_TREE_VERSION),
+               MFM_BUILD_DATE, MFM_BUILD_TIME,
+               xstr(MFM_BUILT_BY));
+        exit(0);
+
+      case '?':
+        ++fails;
+        break;
+
+      default:
+        abort();
+      }
+    }
+    if (optind + 1 == argc) mDir = argv[optind];
+    else {
+      error("Need exactly one DIR to serve loopback ITCs under");
+      ++fails;
+    }
+    if (fails) {
+      fatal("%d command line problem%s",fails,fails==1?"":"s");
+    }
+    if (loglevel >= 0) {
+      LOG.SetLevel(loglevel);
+    }
+    mRandom.SetSeed(mSeed);
+  }
+
+  int T2Loop::main(int argc, char ** argv) {
+    processArgs(argc,argv);
+    signal(SIGINT, requestStop);
+    signal(SIGTERM, requestStop);
+    signal(SIGPIPE, SIG_IGN);   // A tile going away is just a disconnect
+    setUp();
+    run();
+    tearDown();
+    return 0;
+  }
+
+  static int loopMain(int argc, char** argv)
+  {
+    // Early early logging
+    LOG.SetByteSink(STDERR);
+    LOG.SetLevel(LOG.MESSAGE);
+    T2Loop loop;
+    return loop.main(argc,argv);
+  }
+}
+
+int main(int argc, char **argv) {
+  unwind_protect({
+      const char * file = (const char *) unwindProtect_FailException.mFile;
+      int line = unwindProtect_FailException.mLine;
+      int code = unwindProtect_FailException.mCode;
+
+      MFMPrintError(stderr,file,line,code);
+      fprintf(stderr,"Failed out of top level\n");
+      exit(99);
+  },{
+    return MFM::loopMain(argc,argv);
+  });
+}
@@ -0,0 +1,100 @@
+#include "T2StatsExport.h"
+#include "T2Tile.h"
+
+#include <sys/mman.h>  // For mmap
+#include <fcntl.h>     // For open
+#include <unistd.h>    // For ftruncate, close
+#include <errno.h>     // For errno
+#include <string.h>    // For strerror, memset
+
+namespace MFM {
+
+  T2StatsExporter::T2StatsExporter(const char * path)
+    : mPath(path)
+    , mHeader(0)
+    , mCounters(0)
+    , mFailed(false)
+  { }
+
+  T2StatsExporter::~T2StatsExporter() {
+    if (mHeader) ::munmap(mHeader, EXPORT_BYTES);
+  }
+
+  void T2StatsExporter::setPath(const char * path) {
+    MFM_API_ASSERT_NONNULL(path);
+    MFM_API_ASSERT_STATE(!mHeader);
+    mPath = path;
+    mFailed = false;
+  }
+
+  bool T2StatsExporter::openExport() {
+    if (mHeader) return true;
+    if (mFailed) return false;
+    mFailed = true;             // Until proven otherwise
+
+    int fd = ::open(mPath, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+      LOG.Warning("%s: can't open '%s': %s", getName(), mPath, strerror(errno));
+      return false;
+    }
+    if (::ftruncate(fd, EXPORT_BYTES) < 0) {
+      LOG.Warning("%s: can't size '%s': %s", getName(), mPath, strerror(errno));
+      ::close(fd);
+      return false;
+    }
+    void * map = ::mmap(0, EXPORT_BYTES, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);                // The mapping stays
+    if (map == MAP_FAILED) {
+      LOG.Warning("%s: can't map '%s': %s", getName(), mPath, strerror(errno));
+      return false;
+    }
+
+    memset(map, 0, EXPORT_BYTES);
+    mHeader = (T2StatsExportHeader *) map;
+    mCounters = (u64 *) (mHeader + 1);
+    mHeader->mHeaderBytes = sizeof(T2StatsExportHeader);
+    mHeader->mTileCounters = TILE_COUNTERS;
+    mHeader->mITCCounters = ITC_COUNTERS;
+    mHeader->mITCCount = DIR6_COUNT;
+    mHeader->mVersion = T2STATS_EXPORT_VERSION;
+    __atomic_store_n(&mHeader->mMagic, (u32) T2STATS_EXPORT_MAGIC, __ATOMIC_RELEASE); // Last
+    mFailed = false;
+    LOG.Message("%s: exporting stats to '%s'", getName(), mPath);
+    return true;
+  }
+
+  bool T2StatsExporter::update(const T2TileStats & stats) {
+    if (!openExport()) return false;
+
+    // Seqlock: odd while we write, even (and changed) when done
+    const u32 seq = mHeader->mSequence;
+    __atomic_store_n(&mHeader->mSequence, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    mHeader->mResetSeconds = stats.getResetSeconds();
+    mHeader->mUpdateSeconds = UniqueTime::now().tv_sec;
+    u64 * out = mCounters;
+#define XX(NM,CM) *out++ = stats.get##NM();
+    ALL_TILE_STAT_U64S()
+#undef XX
+    for (u32 i = 0; i < DIR6_COUNT; ++i) {
+      const T2ITCStats & itc = stats.getITCStats((Dir6) i);
+#define XX(NM,CM) *out++ = itc.get##NM();
+      ALL_ITC_STAT_U64S()
+#undef XX
+      *out++ = itc.mRTTSumUsec;
+      for (u32 b = 0; b < T2ITCStats::RTT_BUCKETS; ++b)
+        *out++ = itc.getRTTBucketCount(b);
+    }
+    MFM_API_ASSERT_STATE(out == mCounters + TILE_COUNTERS + DIR6_COUNT * ITC_COUNTERS);
+
+    __atomic_store_n(&mHeader->mSequence, seq + 2, __ATOMIC_RELEASE);
+    return true;
+  }
+
+  void T2StatsExporter::onTimeout(TimeQueue& srctq) {
+    if (update(T2Tile::get().getStats()))
+      insert(srctq, UPDATE_MS);
+    // Else the export is unavailable; stay off the queue
+  }
+}
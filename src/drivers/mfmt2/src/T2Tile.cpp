@@ -2,6 +2,8 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <dirent.h>
+#include <poll.h>
+#include <sys/epoll.h>
 
 #include "T2Tile.h"
 
@@ -24,26 +26,125 @@ namespace MFM {
     , mCustomGraphics(true)
   { }
   
-  CoreTempChecker::CoreTempChecker() {
+  CPUGovernor::CPUGovernor()
+    : mHaveLastStats(false)
+    , mMaxCoreDegF(0)
+  {
     LOG.Debug("%s",__PRETTY_FUNCTION__);
   }
 
-  void CoreTempChecker::onTimeout(TimeQueue& srctq) {
+  CPUSpeed CPUGovernor::getCeiling(T2Tile & tile, CPUSpeed last) {
+    ADCCtl & adc = tile.getADCCtl();
+    CPUFreq & cf = tile.getCPUFreq();
+    CPUSpeed ceiling = CPUSpeed_Fastest;
+
+    ResourceLevel ctmp = adc.mCoreTemperature.mLevel;
+    if (ctmp >= RL_VERY_HIGH) ceiling = CPUSpeed_Slowest;
+    else if (ctmp >= RL_HIGH ||
+             (mMaxCoreDegF > 0 &&
+              adc.mCoreTemperature.getChannelValue() > mMaxCoreDegF)) {
+      CPUSpeed slower = cf.getSlower(last);
+      ceiling = slower == CPUSpeed_UNKNOWN ? CPUSpeed_Slowest : slower;
+    }
+
+    ResourceLevel volts = adc.mGridVoltage.mLevel;
+    if (volts <= RL_VERY_LOW) ceiling = CPUSpeed_Slowest;
+    else if (volts <= RL_LOW) ceiling = MIN(ceiling, CPUSpeed_Slow);
+    return ceiling;
+  }
+
+  CPUSpeed CPUGovernor::getDemand(const T2TileStats & samp, CPUSpeed last) {
+    const CPUFreq & cf = T2Tile::get().getCPUFreq();
+    const u64 considered = samp.getEventsConsidered();
+    const u64 nonempty = samp.getNonemptyEventsStarted();
+    u64 rings = 0;
+    for (u32 i = 0; i < DIR6_COUNT; ++i)
+      rings += samp.getITCStats((Dir6) i).getRingsSent();
+
+    const u64 busyPermil = considered > 0 ? 1000 * nonempty / considered : 0;
+    const u64 boundaryPermil = nonempty > 0 ? 1000 * rings / nonempty : 0;
+
+    CPUSpeed want = last;
+    if (busyPermil >= BUSY_PERMIL || boundaryPermil >= BOUNDARY_PERMIL)
+      want = cf.getFaster(last);
+    else if (busyPermil < IDLE_PERMIL)
+      want = cf.getSlower(last);
+    return want == CPUSpeed_UNKNOWN ? last : want;
+  }
+
+  void CPUGovernor::onTimeout(TimeQueue& srctq) {
     T2Tile& tile = T2Tile::get();
-    CoreTemperatureWatcher & ctw = tile.getADCCtl().mCoreTemperature;
-    ResourceLevel ctmp = ctw.mLevel;
     CPUFreq & cf = tile.getCPUFreq();
     CPUSpeed last = cf.getLastSetSpeed();
-    
-    if (ctmp <= RL_ACCEPTABLE) {
-      if (last < CPUSpeed_Fastest) 
-        cf.setSpeed(cf.getFaster(last));
-    } else if (ctmp <= RL_HIGH) {
-      if (last > CPUSpeed_Slowest) {
-        cf.setSpeed(cf.getSlower(last));
-      }
+    const T2TileStats & cur = tile.getStats();
+
+    // Without a clean sample (first time, or stats were reset since)
+    // just hold the speed, unless it's over the ceiling
+    CPUSpeed next = last;
+    if (mHaveLastStats && mLastStats.getResetSeconds() == cur.getResetSeconds()) {
+      T2TileStats now = cur;
+      next = getDemand(now - mLastStats, last);
+    }
+    mLastStats = cur;
+    mHaveLastStats = true;
+
+    next = MIN(next, getCeiling(tile, last));
+    if (next != last) cf.setSpeed(next);
+    scheduleWait(WC_MEDIUM);
+  }
+
+  EWPoolGovernor::EWPoolGovernor()
+    : mHaveLastStats(false)
+    , mLastRefused(0)
+  {
+    LOG.Debug("%s",__PRETTY_FUNCTION__);
+  }
+
+  u32 EWPoolGovernor::getDemand(const T2TileStats & samp, u64 refused, u32 last) {
+    u64 ringsIn = 0, busysOut = 0, ringsOut = 0, busysIn = 0;
+    for (u32 i = 0; i < DIR6_COUNT; ++i) {
+      const T2ITCStats & is = samp.getITCStats((Dir6) i);
+      ringsIn += is.getRingsReceived();
+      busysOut += is.getBusysSent();
+      ringsOut += is.getRingsSent();
+      busysIn += is.getBusysReceived();
+    }
+    const u64 passivePermil = ringsIn > 0 ? 1000 * busysOut / ringsIn : 0;
+    const u64 activePermil = ringsOut > 0 ? 1000 * busysIn / ringsOut : 0;
+
+    if (passivePermil >= PASSIVE_BUSY_PERMIL)
+      return MAX(last - 1, (u32) MIN_ACTIVE_EWS);
+    if (refused > 0 &&
+        activePermil < ACTIVE_BUSY_PERMIL &&
+        passivePermil < PASSIVE_BUSY_PERMIL / 2)
+      return MIN(last + 1, (u32) MAX_EWSLOT);
+    return last;
+  }
+
+  void EWPoolGovernor::onTimeout(TimeQueue& srctq) {
+    T2Tile& tile = T2Tile::get();
+    const T2TileStats & cur = tile.getStats();
+    const u64 refused = tile.getActiveEWsRefused();
+    const u32 last = tile.getActiveEWLimit();
+
+    // As in CPUGovernor, hold steady without a clean sample
+    u32 next = last;
+    if (mHaveLastStats && mLastStats.getResetSeconds() == cur.getResetSeconds()) {
+      T2TileStats now = cur;
+      next = getDemand(now - mLastStats, refused - mLastRefused, last);
+    }
+    mLastStats = cur;
+    mLastRefused = refused;
+    mHaveLastStats = true;
+
+    if (next != last) {
+      tile.setActiveEWLimit(next);
+      LOG.Message("EW pool: active limit %d -> %d (high water active %d, passive %d)",
+                  last, next,
+                  tile.getActiveEWsHighWater(),
+                  tile.getPassiveEWsHighWater());
     }
-    scheduleWait(WC_LONG);
+    scheduleWait(WC_MEDIUM);
   }
 
   bool SiteRenderConfig::setTypeInNamedLayer(const char * layerSuffix, DrawSiteType newval) {
@@ -175,10 +276,20 @@ namespace MFM {
     }
   }
 
-  void KITCPoller::onTimeout(TimeQueue& srctq) {
+  bool KITCPoller::statusChangeNotified() {
+    struct pollfd pfd;
+    pfd.fd = mKITCStatusFD;
+    pfd.events = POLLPRI;
+    pfd.revents = 0;
+    if (::poll(&pfd, 1, 0) < 0) return false;
+    return (pfd.revents & POLLPRI) != 0;
+  }
+
+  void KITCPoller::readKITCStatus() {
     u8 buf[8];
     ::lseek(mKITCStatusFD, 0, SEEK_SET);
     if (read(mKITCStatusFD,buf,8) != 8) abort();
+    mTimeoutsSinceRead = 0;
     for (ITCIterator itr = mITCIteration.begin(); itr.hasNext(); ) {
       Dir6 dir6 = itr.next();
       Dir8 dir8 = mapDir6ToDir8(dir6);
@@ -192,6 +303,16 @@ namespace MFM {
         mTile.getITC(dir6).bump(); // Something's changed
       }        
     }
+  }
+
+  void KITCPoller::onTimeout(TimeQueue& srctq) {
+    const bool notified = statusChangeNotified();
+    if (notified && !mNotifying) {
+      LOG.Message("%s: status change notifications seen; reading on change", getName());
+      mNotifying = true;
+    }
+    if (!mNotifying || notified || ++mTimeoutsSinceRead >= SAFETY_READ_INTERVAL)
+      readKITCStatus();
     scheduleWait(WC_FULL);
   }
 
@@ -200,15 +321,27 @@ namespace MFM {
     , mITCIteration(mTile.getRandom(), 1000)
     , mKITCStatusFD(-1)
     , mKITCEnabledStatus(0)
-  {
-    const char * STATUS_PATH = "/sys/class/itc_pkt/status";
+    , mNotifying(false)
+    , mTimeoutsSinceRead(0)
+  { }
+
+  void KITCPoller::init() {
+    MFM_API_ASSERT_STATE(mKITCStatusFD < 0);
+    OString256 path;
+    if (mTile.isLoopback()) path.Printf("%s/status", mTile.getLoopbackDir());
+    else path.Printf("/sys/class/itc_pkt/status");
+    const char * STATUS_PATH = path.GetZString();
     int ret = ::open(STATUS_PATH, O_RDONLY);
     if (ret < 0) {
       LOG.Error("Can't open %s: %s",STATUS_PATH,strerror(errno));
       FAIL(ILLEGAL_STATE);
     }
     mKITCStatusFD = ret;
-    schedule(mTile.getTQ(),0);  // Not scheduleWait here: T2Tile ctor is running
+    // T2Loop's status is a plain file: epoll can't watch it, and
+    // poll never flags it, so there we just read on every timeout
+    if (!mTile.isLoopback())
+      mTile.getFDReactor().watch(mKITCStatusFD, EPOLLPRI, *this);
+    schedule(mTile.getTQ(),0);
   }
 
   u32 KITCPoller::updateKITCEnabledStatusFromStatus(u32 status, Dir8 dir8, u32 val) {
@@ -228,6 +361,7 @@ namespace MFM {
     ////XXXX
     OurT2Atom phonyDReg(type);
     ar = phonyDReg;
+    noteSiteChanged(MakeUnsigned(at));
   }
 
   void T2Tile::clearPrivateSites() {
@@ -252,6 +386,7 @@ namespace MFM {
         OurT2Site & site = sites.get(u);
         OurT2Atom & atom = site.GetAtom();
         atom.SetEmpty();
+        noteSiteChanged(u);
       }
     }
   }
@@ -267,6 +402,8 @@ namespace MFM {
                          EVENT_HISTORY_BUFFER_SIZE, mEventHistoryBuffer)
     , mTraceLoggerPtr(0)
     , mTraceLogDirManager()
+    , mTraceTypeMask((1u<<TTC_COUNT)-1)
+    , mTraceRandom()
     , mArgc(0)
     , mArgv(0)
     , mMFZTag()
@@ -328,20 +465,30 @@ namespace MFM {
       }
     , mEWs{ 0 }
     , mFree(*this)
+    , mActiveEWLimit(MAX_EWSLOT)
+    , mActiveEWsHighWater(0)
+    , mActiveEWsRefused(0)
+    , mPassiveEWsInUse(0)
+    , mPassiveEWsHighWater(0)
     , mSDLI(*this,"SDLI")
     , mADCCtl(*this)
     , mSites()    // Initted (for now) in earlyInit
-    , mSiteOwners() // Initted in earlyInit
+    , mSiteOwnership()
     , mEWInitiator()
     , mKITCPoller(*this)
     , mLiving(false)
     , mPacketPoller(*this)
     , mListening(false)
     , mMDist()
+    , mStatsExporter("/dev/shm/t2tile-stats")
+    , mLoopbackDir(0)
+    , mLoopbackStatsPath()
     , mCPUFreq(CPUSpeed_Fastest)
-    , mCoreTempChecker()
+    , mCPUGovernor()
+    , mEWPoolGovernor()
     , mMFMRunRadioGroup()
     , mFlashTrafficManager()
+    , mBulkTransferManager()
     , mRollingTraceDir()
     , mRollingTraceTargetKB(0)
     , mRollingTraceSpinner(0)
@@ -349,7 +496,14 @@ namespace MFM {
     , mUlamEventSystem(*this)
   {
     mT2TileStats.reset();
-    mCoreTempChecker.schedule(getTQ(),0);
+    for (u32 i = 0; i < TTC_COUNT; ++i) {
+      mTraceOneIn[i] = 1;
+      mTraceSkip[i] = 0;
+      mTraceSuppressed[i] = 0;
+    }
+    mCPUGovernor.schedule(getTQ(),0);
+    mEWPoolGovernor.schedule(getTQ(),0);
+    mStatsExporter.schedule(getTQ(),0);
     mDrawPanelManager.schedule(getTQ(),0);
   }
 
@@ -390,6 +544,7 @@ namespace MFM {
 
   void T2Tile::earlyInit() {
     processArgs();
+    mKITCPoller.init();
 
     openMFZIdDevice();
     
@@ -398,10 +553,6 @@ namespace MFM {
       mEWs[i]->insertInEWSet(&mFree);
     }
 
-    for (u32 x = 0; x < T2TILE_WIDTH; ++x)
-      for (u32 y = 0; y < T2TILE_HEIGHT; ++y) 
-        mSiteOwners[x][y] = 0;
-
 #if 0  // LEAVE INITIAL WORLD EMPTY   
     /////XXXXX MAKE A PHONYDREG
     OurT2Atom phonyDReg(T2_PHONY_DREG_TYPE);
@@ -427,13 +578,17 @@ namespace MFM {
 
 #define ALL_CMD_ARGS()                                          \
   XX(help,h,N,,"Print this help")                               \
-  XX(elements,e,R,PATH,"Specify libcue.so to load")             \
+  XX(cputemp,c,R,DEGF,"Slow the CPU above core temperature DEGF") \
+  XX(elements,e,R,PATH,"Specify libcue.so, or .mfz bundle holding one, to load")             \
   XX(log,l,O,LEVEL,"Set or increase logging")                   \
+  XX(loopback,b,R,DIR,"Use T2Loop's loopback ITCs under DIR")    \
   XX(map,m,O,CSV,"Print tile map [in CSV] and exit")            \
   XX(mfzid,z,R,MFZID,"Specify MFZID tag to use")                \
   XX(paused,p,N,,"Start up paused")                             \
-  XX(trace,t,O,PATH,"Trace output to PATH or default")          \
+  XX(trace,t,O,PATH,"Trace output to PATH or default, or stream to tcp:HOST:PORT") \
   XX(roll,r,O,MB,"Keep rolling trace files up to size MB")      \
+  XX(sample,s,R,ONEIN,"Trace about one in ONEIN ITC packets")   \
+  XX(tracetypes,y,R,LIST,"Trace only LIST, e.g. ITC,EW,-ITC_PacketIn") \
   XX(version,v,N,,"Print version and exit")                     \
   XX(wincfg,w,R,PATH,"Specify window configuration file")       \
 
@@ -516,6 +671,20 @@ static const char * CMD_HELP_STRING =
         setWindowConfigPath(optarg);
         break;
 
+      case 'b':
+        setLoopbackDir(optarg);
+        break;
+
+      case 'c': {
+        u32 degf = 0;
+        CharBufferByteSource cbbs(optarg,strlen(optarg));
+        if (1 != cbbs.Scanf("%d",&degf) || degf == 0) {
+          fatal("'%s' not legal as degrees F", optarg);
+        }
+        mCPUGovernor.setMaxCoreTemperature(degf);
+        break;
+      }
+
       case 'e':
         emessage = getUlamEventSystem().setUlamLibraryPath(optarg);
         break;
@@ -535,6 +704,23 @@ static const char * CMD_HELP_STRING =
         break;
       }
 
+      case 's': {
+        u32 onein = 0;
+        CharBufferByteSource cbbs(optarg,strlen(optarg));
+        if (1 != cbbs.Scanf("%d",&onein) || onein == 0) {
+          fatal("'%s' not legal as sampling odds", optarg);
+        }
+        setTraceSampling(TTC_ITC_PacketIn, onein);
+        setTraceSampling(TTC_ITC_PacketOut, onein);
+        break;
+      }
+
+      case 'y':
+        if (!parseTraceTypes(optarg)) {
+          fatal("'%s' not legal as trace types", optarg);
+        }
+        break;
+
       case 't': {
         if (traceSet) {
           fatal("Only one -t or -r allowed");
@@ -677,6 +863,17 @@ static const char * CMD_HELP_STRING =
     ::close(fd);
   }
 
+  void T2Tile::setLoopbackDir(const char * dir) {
+    MFM_API_ASSERT_NONNULL(dir);
+    if (mLoopbackDir) {
+      fatal("Duplicate --loopback");
+    }
+    mLoopbackDir = dir;
+    // Keep loopback tiles sharing a host from sharing a stats export
+    mLoopbackStatsPath.Printf("%s/stats", dir);
+    mStatsExporter.setPath(mLoopbackStatsPath.GetZString());
+  }
+
   void T2Tile::setWindowConfigPath(const char * path) {
     assert(path!=0);
     if (mWindowConfigPath) {
@@ -689,6 +886,7 @@ static const char * CMD_HELP_STRING =
     stopTracing();
     closeITCs();
     this->getFlashTrafficManager().close();
+    this->getBulkTransferManager().close();
   }
 
   T2Tile::~T2Tile() {
@@ -712,9 +910,32 @@ static const char * CMD_HELP_STRING =
     }
   }
 
+  void T2Tile::setActiveEWLimit(u32 limit) {
+    MFM_API_ASSERT_ARG(limit > 0 && limit <= MAX_EWSLOT);
+    mActiveEWLimit = limit;
+  }
+
+  void T2Tile::notePassiveEWStarted() {
+    ++mPassiveEWsInUse;
+    mPassiveEWsHighWater = MAX(mPassiveEWsHighWater, mPassiveEWsInUse);
+  }
+
+  void T2Tile::notePassiveEWDone() {
+    if (mPassiveEWsInUse > 0) --mPassiveEWsInUse;
+  }
+
   T2ActiveEventWindow * T2Tile::allocEW() {
+    // EWs in use past a lowered limit just drain; none are taken back
+    if (getActiveEWsInUse() >= mActiveEWLimit) {
+      ++mActiveEWsRefused;
+      return 0;
+    }
     EWLinks * el = mFree.removeRandom();
-    if (!el) return 0;
+    if (!el) {
+      ++mActiveEWsRefused;
+      return 0;
+    }
+    mActiveEWsHighWater = MAX(mActiveEWsHighWater, getActiveEWsInUse());
     T2EventWindow * ew = el->asEventWindow();
     T2ActiveEventWindow * aew = ew->as<T2ActiveEventWindow>();
     MFM_API_ASSERT_STATE(aew != 0);
@@ -761,21 +982,9 @@ static const char * CMD_HELP_STRING =
   void T2Tile::releaseEW(T2EventWindow * ew) {
     assert(ew != 0);
     assert(ew->isAssigned());
-    SPoint center = ew->getCenter();
-    u32 radius = ew->getRadius();
-    const SPoint origin(0,0);
-    const SPoint maxSite(T2TILE_WIDTH-1,T2TILE_HEIGHT-1);
-    const u32 first = mMDist.GetLastIndex(0);
-    const u32 last = mMDist.GetLastIndex(radius);
-
     // OK, unhog the region
-    for (u32 sn = first; sn <= last; ++sn) {
-      SPoint offset = mMDist.GetPoint(sn);
-      SPoint site = center + offset;
-      if (!site.BoundedBy(origin,maxSite)) continue;
-      assert(mSiteOwners[site.GetX()][site.GetY()] == ew);
-      mSiteOwners[site.GetX()][site.GetY()] = 0;
-    }
+    bool released = unhogSites(ew, ew->getCenter(), ew->getRadius());
+    assert(released);
 
     ew->releaseCenter();
     freeEW(*ew);
@@ -788,6 +997,7 @@ static const char * CMD_HELP_STRING =
     earlyInit();
     mSDLI.init();
     mFlashTrafficManager.init();
+    mBulkTransferManager.init();
     insertOnMasterTimeQueue(mSDLI, 0); // Live for display and input
     resetITCs();
     mUlamEventSystem.initUlamClasses();
@@ -847,8 +1057,17 @@ static const char * CMD_HELP_STRING =
   }
 
   u32 T2Tile::getRadius(const OurT2Atom & atom) {
-    if (atom.GetType() == OurT2Atom::ATOM_EMPTY_TYPE) return 0u;
-    return 4u;
+    const u32 type = atom.GetType();
+    if (type == OurT2Atom::ATOM_EMPTY_TYPE) return 0u;
+    // The window the element's behavior will actually see (the same
+    // boundary InitForEvent gives it), so small elements only hog,
+    // load and lock what they can touch.  Unknown types get the
+    // most, and everyone gets at least 1 so their behavior runs.
+    const OurElement * elt = GetElementTable().Lookup(type);
+    if (!elt) return MAX_EVENT_WINDOW_RADIUS;
+    const u32 boundary = elt->GetEventWindowBoundary();
+    if (boundary <= 1u) return 1u;
+    return MIN(boundary - 1u, (u32) MAX_EVENT_WINDOW_RADIUS);
   }
 
   void T2Tile::recordCompletedEvent(OurT2Site & site) {
@@ -859,7 +1078,7 @@ static const char * CMD_HELP_STRING =
     const SPoint origin(0,0);
     const SPoint maxSite(T2TILE_WIDTH-1,T2TILE_HEIGHT-1);
     MFM_API_ASSERT_ARG(MakeSigned(idx).BoundedBy(origin,maxSite));
-    if (mSiteOwners[idx.GetX()][idx.GetY()] != 0) return 0u;
+    if (mSiteOwnership.isOwned(idx)) return 0u;
     OurT2Site & site = mSites.get(idx);
     const OurT2Atom & atom = site.GetAtom();
     u32 radius = getRadius(atom);
@@ -868,23 +1087,76 @@ static const char * CMD_HELP_STRING =
     return radius;
   }
 
+  void T2Tile::noteSiteChanged(UPoint idx) {
+    if (!EventSiteSampler::isOwnedSite(idx)) return;
+    EventSiteSampler::SiteClass sc = EventSiteSampler::SC_EMPTY;
+    if (getRadius(mSites.get(idx).GetAtom()) > 0)
+      sc = mSiteOwnership.isOwned(idx) ?
+        EventSiteSampler::SC_BUSY : EventSiteSampler::SC_READY;
+    mEventSiteSampler.setClass(idx, sc);
+  }
+
+  bool T2Tile::hogSites(T2EventWindow * ew, SPoint center, u32 radius) {
+    if (!mSiteOwnership.claim(ew, center, radius)) return false;
+    noteFootprintChanged(center, radius);
+    return true;
+  }
+
+  bool T2Tile::unhogSites(T2EventWindow * ew, SPoint center, u32 radius) {
+    if (!mSiteOwnership.release(ew)) return false;
+    noteFootprintChanged(center, radius);
+    return true;
+  }
+
+  void T2Tile::noteFootprintChanged(SPoint center, u32 radius) {
+    const s32 top = center.GetY() - (s32) radius;
+    const s32 bot = center.GetY() + (s32) radius;
+    for (s32 y = MAX(top, CACHE_LINES); y <= bot && y < T2TILE_HEIGHT-CACHE_LINES; ++y) {
+      u64 row = mSiteOwnership.getFootprintRow(center, radius, y);
+      while (row != 0) {
+        const u32 x = (u32) __builtin_ctzll(row);
+        row &= row - 1;
+        noteSiteChanged(UPoint(x, (u32) y));
+      }
+    }
+  }
+
   bool T2Tile::maybeInitiateEW() {
     // Empty events drain here; they're cheap
     //    const u32 MAX_TRIES = T2TILE_OWNED_WIDTH*T2TILE_OWNED_HEIGHT; 
     const u32 MAX_TRIES = 250;
-    u32 radius = 0;
-    UPoint ctr;
+    // Local-only events complete inside tryAcquireEW, so keep doing
+    // them -- alongside whatever EWs are waiting on remote locks --
+    // until one has to wait on a neighbor, or this many are done
+    const u32 MAX_LOCAL_EVENTS = 16;
+    u32 localEvents = 0;
+    // Each try is still a uniform draw over all owned sites, so the
+    // empty event counts come out as before; the sampler just tells
+    // us what we drew without looking at the site
     for (u32 i = 0; i < MAX_TRIES; ++i) {
       getStats().incrEventsConsidered();
-      ctr =
-        UPoint(getRandom(), T2TILE_OWNED_WIDTH, T2TILE_OWNED_HEIGHT)
-        + UPoint(CACHE_LINES,CACHE_LINES);
-      radius = considerSiteForEW(ctr);
-      if (radius > 0) break;
+      const u32 rank = getRandom().Create(EventSiteSampler::SITE_COUNT);
+      const UPoint ctr = mEventSiteSampler.getSiteOfRank(rank);
+      switch (mEventSiteSampler.getClassOfRank(rank)) {
+      case EventSiteSampler::SC_READY: {
+        u32 radius = considerSiteForEW(ctr);
+        if (radius == 0) break;   // (considerSiteForEW recorded it)
+        const u64 committed = getStats().getNonemptyEventsCommitted();
+        if (!tryAcquireEW(ctr, radius, true)) return localEvents > 0;
+        if (getStats().getNonemptyEventsCommitted() == committed)
+          return true;            // Launched; now awaiting its locks
+        if (++localEvents >= MAX_LOCAL_EVENTS) return true;
+        continue;
+      }
+      case EventSiteSampler::SC_EMPTY:
+        recordCompletedEvent(mSites.get(ctr));  // That was easy
+        break;
+      default:                  // Held by some EW
+        break;
+      }
       getStats().incrEmptyEventsCommitted();
     }
-    if (radius == 0) return false;
-    return tryAcquireEW(ctr, radius, true);
+    return localEvents > 0;
   }
 
   void T2Tile::advanceITCs() { DIE_UNIMPLEMENTED(); }
@@ -899,7 +1171,7 @@ static const char * CMD_HELP_STRING =
     while (!isDone()) {
       TimeoutAble * ta = mTimeQueue.getEarliestExpired();
       if (!ta)
-        usleep(1000); // Or ??
+        mFDReactor.waitForWork(mTimeQueue, MAX_IDLE_WAIT_MS);
       else {
         //        LOG.Message("TO %s",ta->getName());
         ta->onTimeout(mTimeQueue);
@@ -996,6 +1268,74 @@ static const char * CMD_HELP_STRING =
     mTraceLoggerPtr->dump(buf.GetZString());
   }
 
+  static const char * const TRACE_TYPE_GROUPS[TTC_COUNT] = {
+#define XX(TYPE,BRIEF,NAME) #TYPE,
+    ALL_TRACE_TYPES_MACRO()
+#undef XX
+  };
+
+  static const char * const TRACE_TYPE_NAMES[TTC_COUNT] = {
+#define XX(TYPE,BRIEF,NAME) #TYPE "_" #NAME,
+    ALL_TRACE_TYPES_MACRO()
+#undef XX
+  };
+
+  void T2Tile::setTraceTypeEnabled(TraceTypeCode ttc, bool enabled) {
+    MFM_API_ASSERT_ARG(ttc < TTC_COUNT);
+    if (enabled) mTraceTypeMask |= 1u<<ttc;
+    else mTraceTypeMask &= ~(1u<<ttc);
+  }
+
+  void T2Tile::setTraceSampling(TraceTypeCode ttc, u32 oneIn) {
+    MFM_API_ASSERT_ARG(ttc < TTC_COUNT);
+    MFM_API_ASSERT_ARG(oneIn > 0);
+    mTraceOneIn[ttc] = oneIn;
+    mTraceSkip[ttc] = mTraceRandom.GeometricSkip(oneIn);
+  }
+
+  bool T2Tile::parseTraceTypes(const char * list) {
+    MFM_API_ASSERT_NONNULL(list);
+    u32 mask = (*list == '-') ? mTraceTypeMask : 0;
+    while (*list) {
+      const bool disable = (*list == '-');
+      if (disable) ++list;
+      const char * end = strchr(list, ',');
+      const u32 len = end ? end - list : strlen(list);
+      u32 bits = 0;
+      for (u32 i = 0; i < TTC_COUNT; ++i) {
+        if ((strlen(TRACE_TYPE_GROUPS[i]) == len &&
+             !strncmp(list, TRACE_TYPE_GROUPS[i], len)) ||
+            (strlen(TRACE_TYPE_NAMES[i]) == len &&
+             !strncmp(list, TRACE_TYPE_NAMES[i], len)))
+          bits |= 1u<<i;
+      }
+      if (bits == 0) return false;
+      if (disable) mask &= ~bits;
+      else mask |= bits;
+      list += len;
+      if (*list == ',') ++list;
+    }
+    mTraceTypeMask = mask;
+    return true;
+  }
+
+  u64 T2Tile::getTraceSuppressedTotal() const {
+    u64 total = 0;
+    for (u32 i = 0; i < TTC_COUNT; ++i)
+      total += mTraceSuppressed[i];
+    return total;
+  }
+
+  void T2Tile::reportTraceSuppressed(ByteSink & bs) const {
+    const char * sep = "";
+    for (u32 i = 0; i < TTC_COUNT; ++i) {
+      if (mTraceSuppressed[i] == 0) continue;
+      bs.Printf("%s%s=", sep, TRACE_TYPE_NAMES[i]);
+      bs.Print(mTraceSuppressed[i]);
+      sep = " ";
+    }
+  }
+
   bool T2Tile::tlog(const Trace & tb) {
     if (!mTraceLoggerPtr) return false; // If anybody cares
     mTraceLoggerPtr->log(tb);
@@ -1028,10 +1368,25 @@ static const char * CMD_HELP_STRING =
     if (mTraceLoggerPtr != 0) {
       // We might be rolling, so we need to avoid the T2Tile::trace
       OString128 buf;
-      getStats().saveRaw(buf);
+      getStats().saveRaw(buf, false); // ITCs won't fit; they go separately
       CharBufferByteSource cbbs = buf.AsByteSource();
       mTraceLoggerPtr->
         log(Trace(*this, TTC_Tile_EventStatsSnapshot, "%<", &cbbs));
+      for (u32 dir6 = DIR6_MIN; dir6 <= DIR6_MAX; ++dir6) {
+        T2ITC & itc = getITC(dir6);
+        OString256 ibuf;
+        itc.getStats().saveRaw(ibuf);
+        CharBufferByteSource icbbs = ibuf.AsByteSource();
+        mTraceLoggerPtr->
+          log(Trace(itc, TTC_ITC_StatsSnapshot, "%<", &icbbs));
+      }
+      if (getTraceSuppressedTotal() > 0) {
+        // So readers know what sampling and masks left out
+        Trace evt(TTC_Log_LogTrace, Logger::MESSAGE);
+        evt.payloadWrite().Printf("Suppressed ");
+        reportTraceSuppressed(evt.payloadWrite());
+        mTraceLoggerPtr->log(evt);
+      }
     }
   }
   void T2Tile::stopTracing(s32 syncTag) {
@@ -1144,7 +1499,7 @@ static const char * CMD_HELP_STRING =
     const Rect & h = getHiddenRect();
     for (u32 i = 0; i < 10000; ++i) {
       UPoint at(MakeUnsigned(h.PickRandom(r)));
-      if (getSiteOwner(at) == 0)
+      if (!isSiteOwned(at))
         return at;
     }
     FAIL(ILLEGAL_STATE);  // No way 32 AEWs can own EVERYTHING?
@@ -1163,6 +1518,7 @@ static const char * CMD_HELP_STRING =
     else {
       OurT2Atom atom = seed->GetDefaultAtom();
       ar = atom;
+      noteSiteChanged(at);
       traceSite(at);
       LOG.Message("Created '%s' at (%d,%d)",
                   seed->GetAtomicSymbol(),
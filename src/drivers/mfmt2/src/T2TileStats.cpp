@@ -1,5 +1,6 @@
 #include "T2TileStats.h"
 #include "T2Constants.h"
+#include "FastClock.h"
 #include <cmath> /*for nan() */
 
 namespace MFM {
@@ -10,19 +11,24 @@ namespace MFM {
 
     ALL_TILE_STAT_U64S()
 #undef XX      
+    for (u32 i = 0; i < DIR6_COUNT; ++i)
+      mITCStats[i].reset();
   }
 
   u32 T2TileStats::getAgeSeconds() const {
     return UniqueTime::now().tv_sec - mResetSeconds;
   }
 
-  void T2TileStats::saveRaw(ByteSink & bs) {
+  void T2TileStats::saveRaw(ByteSink & bs, bool withITCs) {
     struct timespec now = UniqueTime::now();
     bs.Printf("%l", now.tv_sec - mResetSeconds);
 #define XX(NM,CM) bs.Printf("%q", get##NM());
 
     ALL_TILE_STAT_U64S()
 #undef XX      
+    if (withITCs)
+      for (u32 i = 0; i < DIR6_COUNT; ++i)
+        mITCStats[i].saveRaw(bs);
   }
 
   bool T2TileStats::loadRaw(ByteSource & bs) {
@@ -35,6 +41,15 @@ namespace MFM {
     ALL_TILE_STAT_U64S()
 #undef XX
 
+    // ITC stats are optional (older snapshots, or !withITCs)
+    u32 i;
+    for (i = 0; i < DIR6_COUNT; ++i)
+      if (!tmp.mITCStats[i].loadRaw(bs)) break;
+    if (i == 0)
+      for (i = 0; i < DIR6_COUNT; ++i)
+        tmp.mITCStats[i].reset();
+    else if (i < DIR6_COUNT) return false;
+
     *this = tmp;
     return true;
   }
@@ -50,6 +65,8 @@ namespace MFM {
 
     ALL_TILE_STAT_U64S()
 #undef XX      
+    for (u32 i = 0; i < DIR6_COUNT; ++i)
+      ret.mITCStats[i] = mITCStats[i] - rhs.mITCStats[i];
     return ret;
   }
 
@@ -67,6 +84,107 @@ namespace MFM {
     return estAER;
   }
 
+  //// T2ITCStats
+
+  void T2ITCStats::reset() {
+#define XX(NM,CM) m##NM = 0;
+
+    ALL_ITC_STAT_U64S()
+#undef XX
+    mRTTSumUsec = 0;
+    for (u32 i = 0; i < RTT_BUCKETS; ++i)
+      mRTTHist[i] = 0;
+  }
+
+  void T2ITCStats::saveRaw(ByteSink & bs) const {
+#define XX(NM,CM) bs.Printf("%q", get##NM());
+
+    ALL_ITC_STAT_U64S()
+#undef XX
+    bs.Printf("%q", mRTTSumUsec);
+    for (u32 i = 0; i < RTT_BUCKETS; ++i)
+      bs.Printf("%q", mRTTHist[i]);
+  }
+
+  bool T2ITCStats::loadRaw(ByteSource & bs) {
+    T2ITCStats tmp;
+#define XX(NM,CM) if (1 != bs.Scanf("%q",&tmp.m##NM)) return false;
+
+    ALL_ITC_STAT_U64S()
+#undef XX
+    if (1 != bs.Scanf("%q",&tmp.mRTTSumUsec)) return false;
+    for (u32 i = 0; i < RTT_BUCKETS; ++i)
+      if (1 != bs.Scanf("%q",&tmp.mRTTHist[i])) return false;
+
+    *this = tmp;
+    return true;
+  }
+
+  T2ITCStats T2ITCStats::operator-(const T2ITCStats & rhs) const {
+    T2ITCStats ret;
+#define XX(NM,CM) ret.m##NM = get##NM() - rhs.get##NM();
 
+    ALL_ITC_STAT_U64S()
+#undef XX
+    ret.mRTTSumUsec = mRTTSumUsec - rhs.mRTTSumUsec;
+    for (u32 i = 0; i < RTT_BUCKETS; ++i)
+      ret.mRTTHist[i] = mRTTHist[i] - rhs.mRTTHist[i];
+    return ret;
+  }
+
+  u32 T2ITCStats::getRTTBucket(u32 usec) {
+    u32 bucket = 0;
+    for (u32 v = usec >> RTT_MIN_USEC_BITS; v != 0 && bucket < RTT_BUCKETS-1; v >>= 1)
+      ++bucket;
+    return bucket;
+  }
+
+  u32 T2ITCStats::getRTTBucketLimitUsec(u32 bucket) {
+    MFM_API_ASSERT_ARG(bucket < RTT_BUCKETS);
+    if (bucket == RTT_BUCKETS-1) return U32_MAX;
+    return 1u<<(RTT_MIN_USEC_BITS+bucket);
+  }
+
+  void T2ITCStats::recordRTT(u32 usec) {
+    mRTTSumUsec += usec;
+    ++mRTTHist[getRTTBucket(usec)];
+  }
+
+  u64 T2ITCStats::getRTTCount() const {
+    u64 count = 0;
+    for (u32 i = 0; i < RTT_BUCKETS; ++i)
+      count += mRTTHist[i];
+    return count;
+  }
+
+  u64 T2ITCStats::getRTTBucketCount(u32 bucket) const {
+    MFM_API_ASSERT_ARG(bucket < RTT_BUCKETS);
+    return mRTTHist[bucket];
+  }
+
+  u32 T2ITCStats::getRTTMeanUsec() const {
+    u64 count = getRTTCount();
+    if (count == 0) return 0;
+    return (u32) (mRTTSumUsec / count);
+  }
+
+  u32 T2ITCStats::getRTTQuantileUsec(double q) const {
+    u64 count = getRTTCount();
+    if (count == 0) return 0;
+    u64 want = (u64) (q * count);
+    if (want >= count) want = count - 1;
+    u64 seen = 0;
+    for (u32 i = 0; i < RTT_BUCKETS; ++i) {
+      seen += mRTTHist[i];
+      if (seen > want) return getRTTBucketLimitUsec(i);
+    }
+    return U32_MAX;             // NOT REACHED
+  }
+
+  u32 T2ITCStats::nowUsec() {
+    struct timespec now;
+    FastClock::Monotonic(now);
+    return (u32) (1000000u*now.tv_sec + now.tv_nsec/1000u);
+  }
 
 }
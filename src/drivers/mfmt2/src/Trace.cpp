@@ -5,6 +5,12 @@
 #include "T2EventWindow.h"
 #include "Circuit.h"
 #include "T2Utils.h" /* for printComma */
+
+#include <sys/mman.h> /* for mmap */
+#include <sys/socket.h> /* for socket, send */
+#include <netdb.h>      /* for getaddrinfo */
+#include <unistd.h>     /* for close, gethostname */
+#include <chrono>
                
 namespace MFM {
   ///// STATIC MEMBER DEFINITIONS
@@ -167,27 +173,53 @@ namespace MFM {
       return;
     } 
 
-    if (mTraceType == TTC_ITC_StateChange) {
+    if (mTraceType == TTC_ITC_StatsSnapshot) {
       CharBufferByteSource cbbs = mData.AsByteSource();
+      T2ITCStats stats;
+      if (!stats.loadRaw(cbbs)) bs.Printf("??stats load failed");
+      else {
+        bs.Printf(" rng=");
+        printComma(stats.getRingsSent(),bs);
+        bs.Printf("; ans=");
+        printComma(stats.getAnswersReceived(),bs);
+        bs.Printf("; bsy=");
+        printComma(stats.getBusysReceived(),bs);
+        bs.Printf("; drp=");
+        printComma(stats.getDropsSent(),bs);
+        bs.Printf("; yk=%u/%u",
+                  (u32) stats.getYoinkRacesWon(),
+                  (u32) stats.getYoinkRacesLost());
+        bs.Printf("; in=");
+        printComma(stats.getRingsReceived(),bs);
+        bs.Printf("/");
+        printComma(stats.getBusysSent(),bs);
+        bs.Printf("; rtt avg=%uus p50<%uus p99<%uus",
+                  stats.getRTTMeanUsec(),
+                  stats.getRTTQuantileUsec(0.5),
+                  stats.getRTTQuantileUsec(0.99));
+      }
+      bs.Printf("\n");
+      return;
+    }
+
+    if (mTraceType == TTC_ITC_StateChange) {
       u8 newstate;
-      if (1 == cbbs.Scanf("%c",&newstate)) bs.Printf("-> %s\n", getITCStateName((ITCStateNumber) newstate));
+      if (decodeStateChange(newstate)) bs.Printf("-> %s\n", getITCStateName((ITCStateNumber) newstate));
       else bs.Printf("???");
       return;
     } 
 
     if (mTraceType == TTC_EW_StateChange) {
-      CharBufferByteSource cbbs = mData.AsByteSource();
       u8 newstate;
-      if (1 == cbbs.Scanf("%c",&newstate)) bs.Printf("-> %s\n", getEWStateName((EWStateNumber) newstate));
+      if (decodeStateChange(newstate)) bs.Printf("-> %s\n", getEWStateName((EWStateNumber) newstate));
       else bs.Printf("???");
       return;
     } 
 
     if (mTraceType == TTC_EW_AssignCenter) {
-      CharBufferByteSource cbbs = mData.AsByteSource();
       s8 cx,cy;
       u8 radius, active;
-      if (4 == cbbs.Scanf("%c%c%c%c",&cx,&cy,&radius,&active))
+      if (decodeAssignCenter(cx,cy,radius,active))
         bs.Printf("%c@(%d,%d)+%d\n",
                   active?'a':'p',
                   (s32) cx, (s32) cy,
@@ -197,10 +229,8 @@ namespace MFM {
     } 
 
     if (mTraceType == TTC_EW_CircuitStateChange) {
-      CharBufferByteSource cbbs = mData.AsByteSource();
-
       u8 itcdir6, oldcs, newcs;
-      if (3 == cbbs.Scanf("%c%c%c",&itcdir6,&oldcs,&newcs))
+      if (decodeCircuitStateChange(itcdir6,oldcs,newcs))
         bs.Printf("%s CS_%s -> CS_%s\n",
                   itcdir6 == 0xff ? "--" : getDir6Name(itcdir6),
                   getCircuitStateName((CircuitState) oldcs),
@@ -228,6 +258,25 @@ namespace MFM {
     bs.Printf("\n");
   }
 
+  bool Trace::decodeStateChange(u8 & newstate) const {
+    if (mTraceType != TTC_ITC_StateChange && mTraceType != TTC_EW_StateChange)
+      return false;
+    CharBufferByteSource cbbs = mData.AsByteSource();
+    return 1 == cbbs.Scanf("%c",&newstate);
+  }
+
+  bool Trace::decodeAssignCenter(s8 & cx, s8 & cy, u8 & radius, u8 & active) const {
+    if (mTraceType != TTC_EW_AssignCenter) return false;
+    CharBufferByteSource cbbs = mData.AsByteSource();
+    return 4 == cbbs.Scanf("%c%c%c%c",&cx,&cy,&radius,&active);
+  }
+
+  bool Trace::decodeCircuitStateChange(u8 & itcdir6, u8 & oldcs, u8 & newcs) const {
+    if (mTraceType != TTC_EW_CircuitStateChange) return false;
+    CharBufferByteSource cbbs = mData.AsByteSource();
+    return 3 == cbbs.Scanf("%c%c%c",&itcdir6,&oldcs,&newcs);
+  }
+
   void TraceLoggerInMemory::dump(const char * path) {
     FILE * file = fopen(path,"w");
     if (file == 0) 
@@ -236,13 +285,411 @@ namespace MFM {
     else {
       FileByteSink fbs(file);
       TLOG(DBG,"Dumping to %s",path);         // Note to trace buffer
-      mTraceBuffers[1-mCurBuf].AppendTo(fbs); // Older first
-      mTraceBuffers[mCurBuf].AppendTo(fbs);   // Then current
+      const u32 end = mRing.getWritten();
+      for (u32 seq = mRing.getOldest(); seq != end; ++seq)
+        mRing.format(seq, fbs);               // Older first
       fbs.Close();
       LOG.Message("Trace dumped %s", path);   // Note to log
     }
   }
 
+  TraceRing::TraceRing()
+    : mRecords(0)
+    , mWritten(0)
+    , mBytesLogged(0)
+  {
+    void * mem = mmap(0, RING_RECORDS*sizeof(TraceRingRecord),
+                      PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS,
+                      -1, 0);
+    if (mem == MAP_FAILED) {
+      LOG.Error("Can't map trace ring: %s", strerror(errno));
+      FAIL(OUT_OF_RESOURCES);
+    }
+    mRecords = (TraceRingRecord *) mem;
+  }
+
+  TraceRing::~TraceRing() {
+    munmap(mRecords, RING_RECORDS*sizeof(TraceRingRecord));
+    mRecords = 0;
+  }
+
+  void TraceRing::log(const Trace & evt) {
+    const u32 seq = mWritten.load(std::memory_order_relaxed); // We're the only writer
+    TraceRingRecord & rec = mRecords[seq & RING_MASK];
+    rec.mTime = evt.mLocalTimestamp.getTimespec();
+    rec.mUniquer = evt.mLocalTimestamp.getUniquerValue();
+    rec.mTraceType = evt.mTraceType;
+    const TraceAddress addr = evt.getTraceAddress();
+    rec.mAddr[0] = addr.mAddrMode;
+    rec.mAddr[1] = addr.mArg1;
+    rec.mAddr[2] = addr.mArg2;
+    u32 plen = evt.payloadBufferLength();
+    if (plen > 255) {  // Overflowed; mark it as TraceLogger::log does
+      memcpy(rec.mPayload, evt.payloadBuffer(), 254);
+      rec.mPayload[254] = 'X';
+      plen = 255;
+    } else
+      memcpy(rec.mPayload, evt.payloadBuffer(), plen);
+    rec.mPayloadLength = (u8) plen;
+    mBytesLogged.store(getBytesLogged() + 2 + 9 + 3 + 2 + plen,
+                       std::memory_order_relaxed);
+    mWritten.store(seq + 1, std::memory_order_release);
+  }
+
+  bool TraceRing::copy(u32 seq, TraceRingRecord & rec) const {
+    if (!isRetained(seq, getWritten())) return false;
+    rec = mRecords[seq & RING_MASK];
+    // Recheck: the writer may have lapped us during the copy
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return isRetained(seq, getWritten());
+  }
+
+  bool TraceRing::format(u32 seq, ByteSink & bs) const {
+    TraceRingRecord rec;
+    if (!copy(seq, rec)) return false;
+
+    bs.Printf("%c%c%l%l%c%c%c%c%c%c",
+              TRACE_REC_START_BYTE1,
+              TRACE_REC_START_BYTE2,
+              (u32) rec.mTime.tv_sec,
+              (u32) rec.mTime.tv_nsec,
+              rec.mUniquer,
+              rec.mAddr[0], rec.mAddr[1], rec.mAddr[2],
+              rec.mTraceType,
+              rec.mPayloadLength);
+    bs.WriteBytes(rec.mPayload, rec.mPayloadLength);
+    return true;
+  }
+
+  s32 TraceLoggerToFile::flush() {
+    if (!mFile) return -EBADF;
+    std::lock_guard<std::mutex> guard(mDrainLock);
+    drain();
+    return fflush(mFile);
+  }
+
+  void TraceLoggerToFile::drain() {
+    const u32 end = mRing.getWritten();
+    const u32 oldest = mRing.getOldest();
+    if ((s32) (oldest - mFlushed) > 0) { // Lapped while we slept
+      mLost += oldest - mFlushed;
+      mFlushed = oldest;
+    }
+    for (; mFlushed != end; ++mFlushed)
+      if (!mRing.format(mFlushed, mFBS)) ++mLost;
+  }
+
+  void TraceLoggerToFile::runFlusher() {
+    while (!mStopping.load()) {
+      {
+        std::lock_guard<std::mutex> guard(mDrainLock);
+        drain();
+        fflush(mFile);
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(FLUSH_INTERVAL_MS));
+    }
+    std::lock_guard<std::mutex> guard(mDrainLock);
+    drain();
+  }
+
+  ////// Trace streaming
+
+  static u32 readBEU32(const u8 * p) {
+    return (((u32) p[0])<<24) | (((u32) p[1])<<16) | (((u32) p[2])<<8) | p[3];
+  }
+
+  static void writeBEU32(u8 * p, u32 val) {
+    p[0] = (u8) (val>>24);
+    p[1] = (u8) (val>>16);
+    p[2] = (u8) (val>>8);
+    p[3] = (u8) val;
+  }
+
+  static void writeVarint(ByteSink & bs, u32 val) {
+    while (val >= 0x80) {
+      bs.WriteByte((u8) (val | 0x80));
+      val >>= 7;
+    }
+    bs.WriteByte((u8) val);
+  }
+
+  /* Reads a varint from bytes[pos..length), advancing pos.  False if
+     it runs off the end (or past 32 bits) */
+  static bool readVarint(const u8 * bytes, u32 length, u32 & pos, u32 & val) {
+    val = 0;
+    for (u32 shift = 0; shift < 35; shift += 7) {
+      if (pos >= length) return false;
+      u8 byte = bytes[pos++];
+      val |= ((u32) (byte & 0x7f)) << shift;
+      if ((byte & 0x80) == 0) return true;
+    }
+    return false;
+  }
+
+  void TraceStreamEncoder::writeHello(ByteSink & bs, const char * name) {
+    MFM_API_ASSERT_NONNULL(name);
+    u32 len = strlen(name);
+    if (len > TRACE_STREAM_MAX_NAME) len = TRACE_STREAM_MAX_NAME;
+    bs.Printf("T2TS%c%c", TRACE_STREAM_VERSION, len);
+    bs.WriteBytes((const u8 *) name, len);
+  }
+
+  void TraceStreamEncoder::encode(const TraceRingRecord & rec, ByteSink & bs) {
+    u8 flags = 0;
+    if (mHavePrev) {
+      if (!memcmp(rec.mAddr, mPrev.mAddr, sizeof(rec.mAddr))) flags |= TS_SAME_ADDR;
+      if (rec.mTraceType == mPrev.mTraceType) flags |= TS_SAME_TYPE;
+      if (rec.mTime.tv_sec == mPrev.mTime.tv_sec &&
+          rec.mTime.tv_nsec >= mPrev.mTime.tv_nsec) flags |= TS_NSEC_DELTA;
+    }
+    bs.WriteByte(flags);
+    if (flags & TS_NSEC_DELTA)
+      writeVarint(bs, (u32) (rec.mTime.tv_nsec - mPrev.mTime.tv_nsec));
+    else
+      bs.Printf("%l%l", (u32) rec.mTime.tv_sec, (u32) rec.mTime.tv_nsec);
+    bs.WriteByte(rec.mUniquer);
+    if (!(flags & TS_SAME_ADDR))
+      bs.WriteBytes(rec.mAddr, sizeof(rec.mAddr));
+    if (!(flags & TS_SAME_TYPE))
+      bs.WriteByte(rec.mTraceType);
+    bs.WriteByte(rec.mPayloadLength);
+    bs.WriteBytes(rec.mPayload, rec.mPayloadLength);
+    mPrev.mTime = rec.mTime;
+    memcpy(mPrev.mAddr, rec.mAddr, sizeof(rec.mAddr));
+    mPrev.mTraceType = rec.mTraceType;
+    mHavePrev = true;
+  }
+
+  TraceStreamDecoder::TraceStreamDecoder()
+    : mLength(0)
+    , mPos(0)
+    , mHasHello(false)
+    , mHavePrev(false)
+  {
+    mName[0] = '\0';
+  }
+
+  void TraceStreamDecoder::added(u32 count) {
+    MFM_API_ASSERT_ARG(count <= getRoom());
+    mLength += count;
+  }
+
+  bool TraceStreamDecoder::readHello(bool & bad) {
+    const u32 avail = mLength - mPos;
+    if (avail < 6) return false;
+    const u8 * p = mBuffer + mPos;
+    if (memcmp(p, "T2TS", 4) || p[4] != TRACE_STREAM_VERSION ||
+        p[5] > TRACE_STREAM_MAX_NAME) {
+      bad = true;
+      return false;
+    }
+    const u32 len = p[5];
+    if (avail < 6 + len) return false;
+    memcpy(mName, p + 6, len);
+    mName[len] = '\0';
+    mPos += 6 + len;
+    mHasHello = true;
+    return true;
+  }
+
+  Trace * TraceStreamDecoder::next(bool & bad) {
+    bad = false;
+    if (!mHasHello && !readHello(bad)) return 0;
+
+    // Parse the header fields into rec without committing, in case
+    // the record isn't all here yet
+    const u8 * bytes = mBuffer;
+    u32 pos = mPos;
+    if (pos >= mLength) return 0;
+    const u8 flags = bytes[pos++];
+    if ((flags & ~TS_ALL_FLAGS) || (!mHavePrev && flags != 0)) {
+      bad = true;
+      return 0;
+    }
+    TraceRingRecord rec;
+    if (flags & TS_NSEC_DELTA) {
+      u32 delta;
+      if (!readVarint(bytes, mLength, pos, delta)) return 0;
+      rec.mTime.tv_sec = mPrev.mTime.tv_sec;
+      rec.mTime.tv_nsec = mPrev.mTime.tv_nsec + delta;
+    } else {
+      if (pos + 8 > mLength) return 0;
+      rec.mTime.tv_sec = readBEU32(bytes + pos);
+      rec.mTime.tv_nsec = readBEU32(bytes + pos + 4);
+      pos += 8;
+    }
+    const u32 addrlen = (flags & TS_SAME_ADDR) ? 0 : 3;
+    const u32 typelen = (flags & TS_SAME_TYPE) ? 0 : 1;
+    if (pos + 1 + addrlen + typelen + 1 > mLength) return 0;
+    rec.mUniquer = bytes[pos++];
+    if (addrlen) {
+      memcpy(rec.mAddr, bytes + pos, 3);
+      pos += 3;
+    } else memcpy(rec.mAddr, mPrev.mAddr, 3);
+    rec.mTraceType = typelen ? bytes[pos++] : mPrev.mTraceType;
+    rec.mPayloadLength = bytes[pos++];
+    if (pos + rec.mPayloadLength > mLength) return 0;
+
+    // Rebuild it in TraceLogger::log format and read that
+    u8 raw[TraceLogReader::RECORD_HEADER_BYTES + 255];
+    raw[0] = TRACE_REC_START_BYTE1;
+    raw[1] = TRACE_REC_START_BYTE2;
+    writeBEU32(raw + 2, (u32) rec.mTime.tv_sec);
+    writeBEU32(raw + 6, (u32) rec.mTime.tv_nsec);
+    raw[10] = rec.mUniquer;
+    memcpy(raw + 11, rec.mAddr, 3);
+    raw[14] = rec.mTraceType;
+    raw[15] = rec.mPayloadLength;
+    memcpy(raw + TraceLogReader::RECORD_HEADER_BYTES, bytes + pos, rec.mPayloadLength);
+    pos += rec.mPayloadLength;
+
+    struct timespec zero;
+    zero.tv_sec = 0;
+    zero.tv_nsec = 0;
+    u32 used;
+    Trace * ret = TraceLogReader::read(raw, TraceLogReader::RECORD_HEADER_BYTES + rec.mPayloadLength,
+                                       used, zero, zero);
+    MFM_API_ASSERT_NONNULL(ret);
+
+    mPrev = rec;
+    mHavePrev = true;
+    mPos = pos;
+    if (mPos > BUFFER_BYTES / 2) { // Slide the unread bytes down
+      memmove(mBuffer, mBuffer + mPos, mLength - mPos);
+      mLength -= mPos;
+      mPos = 0;
+    }
+    return ret;
+  }
+
+  TraceLoggerToNet::TraceLoggerToNet(const char * hostport)
+    : mRing()
+    , mHost()
+    , mPort()
+    , mName()
+    , mFD(-1)
+    , mEncoder()
+    , mSendBuffer()
+    , mSent(0)
+    , mLost(0)
+    , mConnections(0)
+    , mStopping(false)
+    , mSender()
+  {
+    MFM_API_ASSERT_NONNULL(hostport);
+    const char * colon = strrchr(hostport, ':');
+    if (!colon || colon == hostport || !colon[1]) {
+      LOG.Error("Want tcp:HOST:PORT, not tcp:%s", hostport);
+      FAIL(ILLEGAL_ARGUMENT);
+    }
+    mHost.WriteBytes((const u8 *) hostport, colon - hostport);
+    mPort.Printf("%s", colon + 1);
+    char host[TRACE_STREAM_MAX_NAME + 1];
+    if (gethostname(host, sizeof(host)) != 0) strcpy(host, "t2");
+    host[TRACE_STREAM_MAX_NAME] = '\0';
+    mName.Printf("%s", host);
+    mSender = std::thread(&TraceLoggerToNet::runSender, this);
+  }
+
+  TraceLoggerToNet::~TraceLoggerToNet() {
+    mStopping.store(true);
+    mSender.join();             // Which sends whatever's left, if it can
+    if (mFD >= 0) ::close(mFD);
+    mFD = -1;
+    // Reported only now: the sender thread leaves LOG to the tile thread
+    if (mConnections == 0)
+      LOG.Warning("Never reached trace collector %s:%s",
+                  mHost.GetZString(), mPort.GetZString());
+    if (mLost > 0)
+      LOG.Warning("Trace streaming fell behind, %d records lost", mLost);
+  }
+
+  bool TraceLoggerToNet::connectCollector() {
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo * res;
+    if (getaddrinfo(mHost.GetZString(), mPort.GetZString(), &hints, &res) != 0)
+      return false;
+    for (struct addrinfo * ai = res; ai; ai = ai->ai_next) {
+      int fd = ::socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+      if (fd < 0) continue;
+      if (::connect(fd, ai->ai_addr, ai->ai_addrlen) == 0) {
+        mFD = fd;
+        break;
+      }
+      ::close(fd);
+    }
+    freeaddrinfo(res);
+    if (mFD < 0) return false;
+
+    mEncoder.reset();
+    mSendBuffer.Reset();
+    TraceStreamEncoder::writeHello(mSendBuffer, mName.GetZString());
+    ++mConnections;
+    return true;
+  }
+
+  bool TraceLoggerToNet::sendAll(const char * bytes, u32 length) {
+    while (length > 0) {
+      ssize_t sent = ::send(mFD, bytes, length, MSG_NOSIGNAL);
+      if (sent < 0) {
+        if (errno == EINTR) continue;
+        return false;
+      }
+      bytes += sent;
+      length -= sent;
+    }
+    return true;
+  }
+
+  bool TraceLoggerToNet::drain() {
+    const u32 end = mRing.getWritten();
+    const u32 oldest = mRing.getOldest();
+    if ((s32) (oldest - mSent) > 0) { // Lapped while we slept
+      mLost += oldest - mSent;
+      mSent = oldest;
+    }
+    for (; mSent != end; ++mSent) {
+      TraceRingRecord rec;
+      if (!mRing.copy(mSent, rec)) {
+        ++mLost;
+        continue;
+      }
+      if (mSendBuffer.CanWrite() < TRACE_STREAM_MAX_RECORD + 2) {
+        if (!sendAll(mSendBuffer.GetBuffer(), mSendBuffer.GetLength()))
+          return false;
+        mSendBuffer.Reset();
+      }
+      mEncoder.encode(rec, mSendBuffer);
+    }
+    if (mSendBuffer.GetLength() > 0) {
+      if (!sendAll(mSendBuffer.GetBuffer(), mSendBuffer.GetLength()))
+        return false;
+      mSendBuffer.Reset();
+    }
+    return true;
+  }
+
+  void TraceLoggerToNet::runSender() {
+    u32 waitMS = 0;
+    while (true) {
+      const bool stopping = mStopping.load();
+      if (mFD < 0 && waitMS == 0) {
+        if (!connectCollector()) waitMS = RECONNECT_MS;
+      }
+      if (mFD >= 0 && !drain()) {
+        ::close(mFD);
+        mFD = -1;
+        waitMS = RECONNECT_MS;
+      }
+      if (stopping) break;
+      std::this_thread::sleep_for(std::chrono::milliseconds(SEND_INTERVAL_MS));
+      waitMS = waitMS > SEND_INTERVAL_MS ? waitMS - SEND_INTERVAL_MS : 0;
+    }
+  }
+
   void TraceLogger::log(ByteSink & bs, const Trace & evt) {
     bs.Printf("%c%c",
                 TRACE_REC_START_BYTE1,
@@ -300,22 +747,76 @@ namespace MFM {
                       &traceType,
                       &plen))
       return 0;
-    OString256 tmpData;
+    u8 tmpData[255];
     for (u32 i = 0; i < plen; ++i) {
       s32 ch = bs.Read();
       if (ch < 0) return 0;
-      tmpData.WriteByte((u8) ch);
+      tmpData[i] = (u8) ch;
     }
 
-    UniqueTime reltime(tmpTime
+    return makeTrace(tmpTime, tmpAddr, (u8) traceType, tmpData, plen,
+                     basetime, timeoffset);
+  }
+
+  Trace * TraceLogReader::read(MappedFileByteSource & mbs,
+                               struct timespec basetime,
+                               struct timespec timeoffset) {
+    long remaining = mbs.GetRemaining();
+    if (remaining <= 0) return 0;
+    const u8 * bytes = mbs.GetBytes(0);
+    u32 avail = remaining > RECORD_HEADER_BYTES + 255 ? RECORD_HEADER_BYTES + 255 : (u32) remaining;
+    u32 used;
+    Trace * ret = read(bytes, avail, used, basetime, timeoffset);
+    if (ret) mbs.Skip(used);
+    else if (avail >= 2 &&
+             (bytes[0] != TRACE_REC_START_BYTE1 ||
+              bytes[1] != TRACE_REC_START_BYTE2)) {
+      LOG.Error("Invalid trace rec header, wanted 0x%02x%02x found 0x%02x%02x",
+                TRACE_REC_START_BYTE1, TRACE_REC_START_BYTE2,
+                bytes[0], bytes[1]);
+      mbs.Skip(2);
+    } else mbs.Skip(avail);     // Truncated: treat as end of file
+    return ret;
+  }
+
+  Trace * TraceLogReader::read(const u8 * bytes, u32 length, u32 & used,
+                               struct timespec basetime,
+                               struct timespec timeoffset) {
+    if (length < RECORD_HEADER_BYTES) return 0;
+    if (bytes[0] != TRACE_REC_START_BYTE1 ||
+        bytes[1] != TRACE_REC_START_BYTE2)
+      return 0;
+    u32 plen = bytes[RECORD_HEADER_BYTES-1];
+    if (length < RECORD_HEADER_BYTES + plen) return 0;
+
+    struct timespec ts;
+    ts.tv_sec = readBEU32(bytes+2);
+    ts.tv_nsec = readBEU32(bytes+6);
+    UniqueTime stamp(ts, bytes[10]);
+    TraceAddress addr;
+    addr.mAddrMode = bytes[11];
+    addr.mArg1 = bytes[12];
+    addr.mArg2 = bytes[13];
+    u8 traceType = bytes[14];
+
+    used = RECORD_HEADER_BYTES + plen;
+    return makeTrace(stamp, addr, traceType, bytes + RECORD_HEADER_BYTES, plen,
+                     basetime, timeoffset);
+  }
+
+  Trace * TraceLogReader::makeTrace(const UniqueTime & stamp,
+                                    const TraceAddress & addr,
+                                    u8 traceType,
+                                    const u8 * payload, u32 plen,
+                                    struct timespec basetime,
+                                    struct timespec timeoffset) {
+    UniqueTime reltime(stamp
                        - UniqueTime(basetime,0)
                        + UniqueTime(timeoffset, 0));
                        
     Trace * ret = new Trace(traceType, reltime);
-    ret->setTraceAddress(tmpAddr);
-
-    CharBufferByteSource cbbs = tmpData.AsByteSource();
-    ret->payloadWrite().Copy(cbbs);
+    ret->setTraceAddress(addr);
+    ret->payloadWrite().WriteBytes(payload, plen);
 
     s32 tag;
     if (ret->reportSyncIfAny(tag)) {
@@ -109,7 +109,7 @@ namespace MFM {
 
   bool TRACEPrintf(Logger::Level level, const char * format, ...) {
     T2Tile & tile = T2Tile::get();
-    if (tile.isTracingActive()) {
+    if (tile.isTracing(TTC_Log_LogTrace)) {
       Trace evt(TTC_Log_LogTrace, level);
       va_list ap;
       va_start(ap, format);
@@ -1,6 +1,7 @@
 #include "UlamEventSystem.h"
 #include "T2Tile.h"
 #include "UlamElement.h"
+#include "MFZBundle.h"
 
 namespace MFM {
   UlamEventSystem::UlamEventSystem(T2Tile & tile)
@@ -14,15 +15,47 @@ namespace MFM {
     return mTile.GetUlamClassRegistry();
   }
 
+  // Cache the libcue.so in the bundle at bundlePath, if it isn't
+  // already, and put the cached copy's path in libPath
+  static const char * extractBundleLibrary(const char * bundlePath, ByteSink & libPath) {
+    MFZBundle bundle;
+    const char * ret = bundle.Open(bundlePath);
+    if (ret) return ret;
+    s32 idx = bundle.FindMember("libcue.so");
+    if (idx < 0) return "No libcue.so in bundle";
+    OString512 cacheDir;
+    MFZBundle::GetDefaultCacheDir(cacheDir);
+    return bundle.ExtractMember((u32) idx, cacheDir.GetZString(), libPath);
+  }
+
   const char * UlamEventSystem::setUlamLibraryPath(const char * path) {
     MFM_API_ASSERT_ARG(path!=0);
     if (mElementRegistry.GetLibraryPathsCount() > 0) 
       return "Multiple libraries illegal";
+    OString512 cached;
+    const bool bundled = MFZBundle::IsBundle(path);
+    if (bundled) {
+      const char * ret = extractBundleLibrary(path, cached);
+      if (ret) return ret;
+      path = cached.GetZString();
+    }
     const char * ret = mElementRegistry.AddLibraryPath(path);
     if (ret) return ret;
     mUlamLibDigest.Reset();
+    // A cached library never changes under its name, so neither
+    // does its digest: keep that beside it, rather than rereading
+    // the whole library every start
+    OString512 digestPath;
+    if (bundled) {
+      digestPath.Printf("%s.digest", path);
+      if (readOneLinerFile(digestPath.GetZString(), mUlamLibDigest) && mUlamLibDigest.GetLength() > 0)
+        return 0;
+      mUlamLibDigest.Reset();
+    }
     if (!digestWholeFile(path, mUlamLibDigest, true))
       return "Digest failed";
+    if (bundled) 
+      writeWholeFile(digestPath.GetZString(), mUlamLibDigest.GetZString()); // Best effort
     return 0;
   }
 
@@ -90,11 +123,15 @@ namespace MFM {
 
 
   void UlamEventSystem::saveOurEventWindow(T2ActiveEventWindow & aew) {
-    // Copy atoms and center site from mOurEventWindow to aew
+    // Copy center base and changed atoms from mOurEventWindow to aew
     aew.getCenterSite().GetBase() = mOurEventWindow.GetBase();
-    u32 sitecount = mOurEventWindow.GetBoundedSiteCount();
-    for (u32 sn = 0; sn < sitecount; ++sn) {
-      if (mOurEventWindow.IsLiveSiteDirect(sn)) 
+
+    // Only sites the behavior wrote can differ from what was loaded;
+    // usually that's a couple, not the whole window
+    u64 written = mOurEventWindow.GetWrittenSitesDirect();
+    const u32 sitecount = mOurEventWindow.GetBoundedSiteCount();
+    for (u32 sn = 0; written != 0 && sn < sitecount; ++sn, written >>= 1) {
+      if ((written & 1) && mOurEventWindow.IsLiveSiteDirect(sn))
         aew.getSiteAtom(sn) = mOurEventWindow.GetAtomDirect(sn);
     }
   }
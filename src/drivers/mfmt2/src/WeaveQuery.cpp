@@ -0,0 +1,305 @@
+#include "WeaveQuery.h"
+#include "Weaver.h"
+#include "Circuit.h"
+#include "TraceTypes.h"
+#include "T2Tile.h" /* for getDir6Name grrr */
+
+#include <string.h>  /*for strcmp*/
+
+#include <map>
+#include <thread>
+
+namespace MFM {
+
+  /** rtt: Time from sending a RING to receiving its ANSWER, by ITC.
+      A RING is paired with the next ANSWER or BUSY coming back on the
+      same ITC for the same circuit number; one still open when the
+      file ends counts as unanswered. */
+  struct RTTQuery : public WeaveQuery {
+    struct DirStats {
+      u32 mRings;
+      u32 mAnswers;
+      u32 mBusys;
+      u32 mUnanswered;
+      double mSumUsec;
+      double mMinUsec;
+      double mMaxUsec;
+      DirStats()
+        : mRings(0)
+        , mAnswers(0)
+        , mBusys(0)
+        , mUnanswered(0)
+        , mSumUsec(0)
+        , mMinUsec(0)
+        , mMaxUsec(0)
+      { }
+
+      void addLatency(double usec) {
+        if (mAnswers == 0 || usec < mMinUsec) mMinUsec = usec;
+        if (mAnswers == 0 || usec > mMaxUsec) mMaxUsec = usec;
+        mSumUsec += usec;
+        ++mAnswers;
+      }
+
+      void merge(const DirStats & other) {
+        if (other.mAnswers > 0) {
+          if (mAnswers == 0 || other.mMinUsec < mMinUsec) mMinUsec = other.mMinUsec;
+          if (mAnswers == 0 || other.mMaxUsec > mMaxUsec) mMaxUsec = other.mMaxUsec;
+        }
+        mRings += other.mRings;
+        mAnswers += other.mAnswers;
+        mBusys += other.mBusys;
+        mUnanswered += other.mUnanswered;
+        mSumUsec += other.mSumUsec;
+      }
+    };
+    DirStats mStats[DIR6_COUNT];
+
+    typedef std::map<u32,struct timespec> RungMap; // dir6<<8|cn -> when RING went out
+    RungMap mRung;
+
+    virtual const char * getName() const { return "rtt"; }
+    virtual WeaveQuery * spawn() const { return new RTTQuery(); }
+
+    virtual void scan(const Trace & trace) {
+      if (!trace.isPacket()) return;
+      const u8 dir6 = trace.getTraceAddress().getITCDir6();
+      if (dir6 >= DIR6_COUNT) return;
+      const T2PacketBuffer & pb = trace.getPacket();
+      DirStats & ds = mStats[dir6];
+      u8 cn;
+      if (trace.getTraceType() == TTC_ITC_PacketOut) {
+        if (asCSType<XITC_CS_RING>(pb, &cn)) {
+          ++ds.mRings;
+          mRung[dir6<<8|cn] = trace.getTimespec();
+        }
+        return;
+      }
+      const bool answer = asCSAnswer(pb, &cn);
+      if (!answer && !asCSBusy(pb, &cn)) return;
+      RungMap::iterator itr = mRung.find(dir6<<8|cn);
+      if (itr == mRung.end()) return; // Its RING was before this file
+      if (answer)
+        ds.addLatency(1000000.0 *
+                      UniqueTime::getIntervalSeconds(trace.getTimespec(), itr->second));
+      else
+        ++ds.mBusys;
+      mRung.erase(itr);
+    }
+
+    virtual void finish() {
+      for (RungMap::iterator itr = mRung.begin(); itr != mRung.end(); ++itr)
+        ++mStats[itr->first>>8].mUnanswered;
+      mRung.clear();
+    }
+
+    virtual void merge(const WeaveQuery & other) {
+      const RTTQuery & o = (const RTTQuery &) other;
+      for (u32 i = 0; i < DIR6_COUNT; ++i)
+        mStats[i].merge(o.mStats[i]);
+    }
+
+    static void printRow(ByteSink & bs, const char * label, const DirStats & ds) {
+      bs.Printf("%4s %9d %9d %9d %9d",
+                label, ds.mRings, ds.mAnswers, ds.mBusys, ds.mUnanswered);
+      if (ds.mAnswers > 0)
+        bs.Printf(" %9d %9d %9d\n",
+                  (u32) (ds.mSumUsec / ds.mAnswers + 0.5),
+                  (u32) (ds.mMinUsec + 0.5),
+                  (u32) (ds.mMaxUsec + 0.5));
+      else
+        bs.Printf(" %9s %9s %9s\n", "-", "-", "-");
+    }
+
+    virtual void printTable(ByteSink & bs) const {
+      bs.Printf("rtt: RING sent to ANSWER received, by ITC\n");
+      bs.Printf("%4s %9s %9s %9s %9s %9s %9s %9s\n",
+                "itc", "rings", "answers", "busys", "unanswrd",
+                "mean us", "min us", "max us");
+      DirStats all;
+      for (u32 i = 0; i < DIR6_COUNT; ++i) {
+        printRow(bs, getDir6Name(i), mStats[i]);
+        all.merge(mStats[i]);
+      }
+      printRow(bs, "all", all);
+    }
+  };
+
+  /** drops: Circuits dropped, by the state they were dropped from
+      and by ITC, from EW circuit state changes; then DROP packets
+      sent and received, by ITC */
+  struct DropsQuery : public WeaveQuery {
+    enum { NO_DIR = DIR6_COUNT, COLUMNS = DIR6_COUNT + 1 }; // EW trace may have no ITC
+    u32 mDropped[CS_STATE_COUNT][COLUMNS];
+    u32 mDropsSent[DIR6_COUNT];
+    u32 mDropsReceived[DIR6_COUNT];
+
+    DropsQuery() {
+      memset(mDropped, 0, sizeof(mDropped));
+      memset(mDropsSent, 0, sizeof(mDropsSent));
+      memset(mDropsReceived, 0, sizeof(mDropsReceived));
+    }
+
+    virtual const char * getName() const { return "drops"; }
+    virtual WeaveQuery * spawn() const { return new DropsQuery(); }
+
+    virtual void scan(const Trace & trace) {
+      u8 itcdir6, oldcs, newcs;
+      if (trace.decodeCircuitStateChange(itcdir6, oldcs, newcs)) {
+        if (newcs == CS_DROPPED && oldcs < CS_STATE_COUNT)
+          ++mDropped[oldcs][itcdir6 < DIR6_COUNT ? itcdir6 : (u8) NO_DIR];
+        return;
+      }
+      if (!trace.isPacket() || !asCSDrop(trace.getPacket(), 0)) return;
+      const u8 dir6 = trace.getTraceAddress().getITCDir6();
+      if (dir6 >= DIR6_COUNT) return;
+      if (trace.getTraceType() == TTC_ITC_PacketOut) ++mDropsSent[dir6];
+      else ++mDropsReceived[dir6];
+    }
+
+    virtual void merge(const WeaveQuery & other) {
+      const DropsQuery & o = (const DropsQuery &) other;
+      for (u32 cs = 0; cs < CS_STATE_COUNT; ++cs)
+        for (u32 col = 0; col < COLUMNS; ++col)
+          mDropped[cs][col] += o.mDropped[cs][col];
+      for (u32 i = 0; i < DIR6_COUNT; ++i) {
+        mDropsSent[i] += o.mDropsSent[i];
+        mDropsReceived[i] += o.mDropsReceived[i];
+      }
+    }
+
+    static void printRow(ByteSink & bs, const char * label, const u32 * counts, u32 columns) {
+      u32 total = 0;
+      bs.Printf("%11s", label);
+      for (u32 col = 0; col < COLUMNS; ++col) {
+        if (col < columns) {
+          bs.Printf(" %7d", counts[col]);
+          total += counts[col];
+        } else bs.Printf(" %7s", "");
+      }
+      bs.Printf(" %9d\n", total);
+    }
+
+    virtual void printTable(ByteSink & bs) const {
+      bs.Printf("drops: Circuits dropped, by state dropped from, and DROPs by ITC\n");
+      bs.Printf("%11s", "cause");
+      for (u32 i = 0; i < DIR6_COUNT; ++i)
+        bs.Printf(" %7s", getDir6Name(i));
+      bs.Printf(" %7s %9s\n", "--", "total");
+      for (u32 cs = 0; cs < CS_STATE_COUNT; ++cs) {
+        OString16 label;
+        label.Printf("CS_%s", getCircuitStateName((CircuitState) cs));
+        printRow(bs, label.GetZString(), mDropped[cs], COLUMNS);
+      }
+      printRow(bs, "DROP sent", mDropsSent, DIR6_COUNT);
+      printRow(bs, "DROP recvd", mDropsReceived, DIR6_COUNT);
+    }
+  };
+
+  /** types: Traces, by trace type */
+  struct TypesQuery : public WeaveQuery {
+    u32 mCounts[TTC_COUNT + 1]; // Last for unknown codes
+
+    TypesQuery() {
+      memset(mCounts, 0, sizeof(mCounts));
+    }
+
+    virtual const char * getName() const { return "types"; }
+    virtual WeaveQuery * spawn() const { return new TypesQuery(); }
+
+    virtual void scan(const Trace & trace) {
+      const u8 type = trace.getTraceType();
+      ++mCounts[type < TTC_COUNT ? type : (u8) TTC_COUNT];
+    }
+
+    virtual void merge(const WeaveQuery & other) {
+      const TypesQuery & o = (const TypesQuery &) other;
+      for (u32 i = 0; i <= TTC_COUNT; ++i)
+        mCounts[i] += o.mCounts[i];
+    }
+
+    virtual void printTable(ByteSink & bs) const {
+      bs.Printf("types: Traces by type\n");
+      bs.Printf("%24s %11s\n", "type", "count");
+      u32 total = 0;
+      for (u32 i = 0; i <= TTC_COUNT; ++i) {
+        if (mCounts[i] == 0) continue;
+        bs.Printf("%24s %11d\n",
+                  i < TTC_COUNT ? getTraceTypeName((TraceTypeCode) i) : "(unknown)",
+                  mCounts[i]);
+        total += mCounts[i];
+      }
+      bs.Printf("%24s %11d\n", "all", total);
+    }
+  };
+
+  WeaveQuery * WeaveQuery::create(const char * name) {
+    MFM_API_ASSERT_NONNULL(name);
+    if (!strcmp(name, "rtt")) return new RTTQuery();
+    if (!strcmp(name, "drops")) return new DropsQuery();
+    if (!strcmp(name, "types")) return new TypesQuery();
+    return 0;
+  }
+
+  const char * WeaveQuery::getNames() {
+    return "rtt, drops, types";
+  }
+
+  WeaveQueries::~WeaveQueries() {
+    for (u32 i = 0; i < mQueries.size(); ++i)
+      delete mQueries[i];
+  }
+
+  bool WeaveQueries::add(const char * name) {
+    WeaveQuery * query = WeaveQuery::create(name);
+    if (!query) return false;
+    mQueries.push_back(query);
+    return true;
+  }
+
+  /* Feed every record of wlf, in file order, to each of queries.
+     Touches nothing but wlf and queries */
+  static void scanFile(WeaverLogFile * wlf, std::vector<WeaveQuery*> * queries) {
+    const WeaverLogFile::RecordIndex & index = wlf->getRecordIndex();
+    if (index.size() > 0) wlf->seek(index[0].mFilePos);
+    for (u32 i = 0; i < index.size(); ++i) {
+      Trace * trace = wlf->readSequential(U32_MAX, false);
+      if (!trace) FAIL(ILLEGAL_STATE); // Trace data changed under us?
+      for (u32 q = 0; q < queries->size(); ++q)
+        (*queries)[q]->scan(*trace);
+      delete trace;
+    }
+    for (u32 q = 0; q < queries->size(); ++q)
+      (*queries)[q]->finish();
+  }
+
+  void WeaveQueries::run(Alignment & align, ByteSink & bs) {
+    const u32 files = align.mWeaverLogFiles.size();
+    std::vector<QueryVector> perFile(files);
+    for (u32 fn = 0; fn < files; ++fn)
+      for (u32 q = 0; q < mQueries.size(); ++q)
+        perFile[fn].push_back(mQueries[q]->spawn());
+
+    // Scan the files several at a time, as analyzeLogSync indexes them
+    u32 maxThreads = std::thread::hardware_concurrency();
+    if (maxThreads == 0) maxThreads = 1;
+    for (u32 base = 0; base < files; base += maxThreads) {
+      std::vector<std::thread> scanners;
+      for (u32 fn = base; fn < files && fn < base + maxThreads; ++fn)
+        scanners.push_back(std::thread(scanFile, align.mWeaverLogFiles[fn].first, &perFile[fn]));
+      for (u32 i = 0; i < scanners.size(); ++i)
+        scanners[i].join();
+    }
+
+    for (u32 fn = 0; fn < files; ++fn) {
+      for (u32 q = 0; q < mQueries.size(); ++q) {
+        mQueries[q]->merge(*perFile[fn][q]);
+        delete perFile[fn][q];
+      }
+    }
+    for (u32 q = 0; q < mQueries.size(); ++q) {
+      if (q > 0) bs.Printf("\n");
+      mQueries[q]->printTable(bs);
+    }
+  }
+}
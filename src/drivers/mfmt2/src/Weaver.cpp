@@ -1,11 +1,18 @@
 #include "Weaver.h"
 #include "IWeave.h"
+#include "WeaveQuery.h"
+#include "LiveWeave.h"
 
 #include <getopt.h>
 #include <time.h>
 #include <dirent.h>
+#include <string.h>  /*for memcmp*/
+#include <unistd.h>  /*for unlink*/
 
 #include <algorithm>
+#include <functional>
+#include <queue>
+#include <thread>
 
 #include "FileByteSink.h"  // For STDERR
 #include "Logger.h"
@@ -90,6 +97,7 @@ namespace MFM {
 
   EWSlotMap::EWSlotMap(Alignment & align, u32 filecount)
     : mAlignment(align)
+    , mFileCount(filecount)
   {
     for (u32 i = 0; i < 32; ++i) {
       mEWSlotVector.push_back(EWSlot(i, filecount));
@@ -105,6 +113,16 @@ namespace MFM {
   }
 
   void EWSlotMap::slewTo(u32 traceloc) {
+    // Start from the latest checkpoint at or before traceloc, if
+    // that's closer than wherever we are now
+    CheckpointMap::const_iterator itr = mCheckpoints.upper_bound(traceloc);
+    if (itr != mCheckpoints.begin()) {
+      --itr;
+      u32 fromHere =
+        mNextTraceLoc > traceloc ? mNextTraceLoc - traceloc : traceloc - mNextTraceLoc;
+      if (traceloc - itr->first < fromHere)
+        restoreCheckpoint(itr);
+    }
     while (mNextTraceLoc > traceloc) {
       if (mNextTraceLoc - traceloc > traceloc)
         reset();
@@ -125,9 +143,61 @@ namespace MFM {
     updateForRaw(*ft,forward);
     mNextTraceLoc += forward ? 1 : -1;
     delete ft;
+    if (forward &&
+        mNextTraceLoc % getCheckpointInterval() == 0 &&
+        mCheckpoints.find(mNextTraceLoc) == mCheckpoints.end())
+      saveCheckpoint();
     return true;
   }
 
+  u32 EWSlotMap::getCheckpointInterval() const {
+    u32 interval = mAlignment.getTraceLocCount() / MAX_CHECKPOINTS;
+    return interval < MIN_CHECKPOINT_INTERVAL ? (u32) MIN_CHECKPOINT_INTERVAL : interval;
+  }
+
+  u32 EWSlotMap::getModelIndex(const EWModel & ewm) const {
+    return (ewm.mSlotNum*mFileCount + ewm.mFileNum)*7 + ewm.mEWIdx;
+  }
+
+  EWModel & EWSlotMap::getModelAtIndex(u32 index) {
+    EWModel * ewmp = findEWModel(index/7/mFileCount, (index/7)%mFileCount, index%7);
+    MFM_API_ASSERT_NONNULL(ewmp);
+    return *ewmp;
+  }
+
+  void EWSlotMap::saveCheckpoint() {
+    Checkpoint & cp = mCheckpoints[mNextTraceLoc];
+    cp.mModels.clear();
+    for (u32 s = 0; s < mEWSlotVector.size(); ++s) { // In getModelIndex order
+      EWSlot & ews = mEWSlotVector[s];
+      for (u32 f = 0; f < ews.mEWFileSlotVector.size(); ++f) {
+        EWFileSlot & ewfs = ews.mEWFileSlotVector[f];
+        for (u32 i = 0; i < ewfs.mEWModelVector.size(); ++i)
+          cp.mModels.push_back(ewfs.mEWModelVector[i]);
+      }
+    }
+    cp.mOrders.clear();
+    for (OrderEWModelMap::iterator itr = mOrdersEWModel.begin();
+         itr != mOrdersEWModel.end(); ++itr)
+      cp.mOrders.push_back(std::make_pair(itr->first, getModelIndex(*itr->second)));
+    cp.mFreeOrders = mFreeOrders;
+  }
+
+  void EWSlotMap::restoreCheckpoint(const CheckpointMap::const_iterator & itr) {
+    const Checkpoint & cp = itr->second;
+    for (u32 i = 0; i < cp.mModels.size(); ++i)
+      getModelAtIndex(i).copyStateFrom(cp.mModels[i]);
+    mEWModelOrders.clear();
+    mOrdersEWModel.clear();
+    for (u32 i = 0; i < cp.mOrders.size(); ++i) {
+      EWModel * ewmp = &getModelAtIndex(cp.mOrders[i].second);
+      mOrdersEWModel[cp.mOrders[i].first] = ewmp;
+      mEWModelOrders[ewmp] = cp.mOrders[i].first;
+    }
+    mFreeOrders = cp.mFreeOrders;
+    mNextTraceLoc = itr->first;
+  }
+
   EWModel * EWFileSlot::findEWModel(u32 ewindex)
   {
     if (ewindex >= mEWModelVector.size()) return 0;
@@ -387,14 +457,151 @@ namespace MFM {
   void WeaverLogFile::reread() { seek(0u); }
 
   void WeaverLogFile::findITCSyncs(Alignment & a) {
-    reread();
-    FileTrace * ptr;
-    while ((ptr = read(U32_MAX, false)) != 0) { // TraceLoc not used here..
-      s32 tag;
-      if (ptr->getTrace().reportSyncIfAny(tag))
-        a.addSyncPoint(tag < 0 ? -tag : tag, this, ptr);
-      else delete ptr;
+    MFM_API_ASSERT_STATE(mIndexState != INDEX_NONE);
+    for (SyncIndex::const_iterator itr = mSyncIndex.begin();
+         itr != mSyncIndex.end(); ++itr) {
+      seek(itr->mFilePos);
+      FileTrace * ptr = read(U32_MAX, false); // TraceLoc not used here..
+      if (!ptr) FAIL(ILLEGAL_STATE); // Trace data changed under us?
+      s32 tag = itr->mTag;
+      a.addSyncPoint(tag < 0 ? -tag : tag, this, ptr);
+    }
+  }
+
+  std::string WeaverLogFile::getIndexPath() const {
+    std::string path(mFilePath);
+    if (mIsRollingDirectory)
+      return path + "/.weaver.widx"; // initDirectory skips dot files
+    std::string::size_type slash = path.rfind('/');
+    if (slash == std::string::npos)
+      return "." + path + ".widx";
+    return path.substr(0,slash+1) + "." + path.substr(slash+1) + ".widx";
+  }
+
+  /** Sidecar index file layout: this header, then the RecordIndex,
+      then the SyncIndex, all in host byte order -- it's a local
+      cache, not an interchange format */
+  struct WeaverIndexHeader {
+    char mMagic[8];
+    u32 mRecordEntrySize;
+    u32 mSyncEntrySize;
+    u64 mSourceBytes;
+    u64 mSourceMTime;
+    u32 mRecordCount;
+    u32 mSyncCount;
+  };
+  static const char WEAVER_INDEX_MAGIC[8] = { 'W','V','R','I','D','X','0','1' };
+
+  static void initWeaverIndexHeader(WeaverIndexHeader & hdr, u64 bytes, u64 mtime) {
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.mMagic, WEAVER_INDEX_MAGIC, sizeof(hdr.mMagic));
+    hdr.mRecordEntrySize = sizeof(WeaverLogFile::IndexEntry);
+    hdr.mSyncEntrySize = sizeof(WeaverLogFile::SyncEntry);
+    hdr.mSourceBytes = bytes;
+    hdr.mSourceMTime = mtime;
+  }
+
+  bool WeaverLogFile::loadIndex() {
+    std::string path = getIndexPath();
+    FILE * file = fopen(path.c_str(), "rb");
+    if (!file) return false;
+    WeaverIndexHeader want, hdr;
+    initWeaverIndexHeader(want, mSourceBytes, mSourceMTime);
+    bool ok =
+      fread(&hdr, sizeof(hdr), 1, file) == 1 &&
+      memcmp(hdr.mMagic, want.mMagic, sizeof(want.mMagic)) == 0 &&
+      hdr.mRecordEntrySize == want.mRecordEntrySize &&
+      hdr.mSyncEntrySize == want.mSyncEntrySize &&
+      hdr.mSourceBytes == want.mSourceBytes &&
+      hdr.mSourceMTime == want.mSourceMTime;
+    if (ok) {
+      mRecordIndex.resize(hdr.mRecordCount);
+      mSyncIndex.resize(hdr.mSyncCount);
+      ok =
+        (hdr.mRecordCount == 0 ||
+         fread(&mRecordIndex[0], sizeof(IndexEntry), hdr.mRecordCount, file) == hdr.mRecordCount) &&
+        (hdr.mSyncCount == 0 ||
+         fread(&mSyncIndex[0], sizeof(SyncEntry), hdr.mSyncCount, file) == hdr.mSyncCount);
+    }
+    fclose(file);
+    if (!ok) {
+      mRecordIndex.clear();
+      mSyncIndex.clear();
     }
+    return ok;
+  }
+
+  bool WeaverLogFile::saveIndex() const {
+    std::string path = getIndexPath();
+    std::string tmppath = path + ".tmp";
+    FILE * file = fopen(tmppath.c_str(), "wb");
+    if (!file) return false;
+    WeaverIndexHeader hdr;
+    initWeaverIndexHeader(hdr, mSourceBytes, mSourceMTime);
+    hdr.mRecordCount = mRecordIndex.size();
+    hdr.mSyncCount = mSyncIndex.size();
+    bool ok =
+      fwrite(&hdr, sizeof(hdr), 1, file) == 1 &&
+      (hdr.mRecordCount == 0 ||
+       fwrite(&mRecordIndex[0], sizeof(IndexEntry), hdr.mRecordCount, file) == hdr.mRecordCount) &&
+      (hdr.mSyncCount == 0 ||
+       fwrite(&mSyncIndex[0], sizeof(SyncEntry), hdr.mSyncCount, file) == hdr.mSyncCount);
+    ok = (fclose(file) == 0) && ok;
+    // Rename into place so a reader never sees a partial index
+    if (ok) ok = rename(tmppath.c_str(), path.c_str()) == 0;
+    if (!ok) unlink(tmppath.c_str());
+    return ok;
+  }
+
+  void WeaverLogFile::scanIndex() {
+    struct timespec zero;
+    zero.tv_sec = 0;
+    zero.tv_nsec = 0;
+    mRecordIndex.clear();
+    mSyncIndex.clear();
+    // Read each piece straight through, without seeking per record
+    for (u32 i = 0; i < mFileByteInfoVector.size(); ++i) {
+      SourceAndNetFilePos & snf = mFileByteInfoVector[i];
+      MappedFileByteSource & mbs = *snf.first;
+      if (!mbs.Seek(0, SEEK_SET)) FAIL(ILLEGAL_STATE);
+      while (true) {
+        u32 filepos = getCurrentFilePos(snf);
+        Trace * trace = TraceLogReader::read(mbs, zero, zero);
+        if (!trace) {
+          if (mbs.Read() < 0) break; /*hit EOF*/
+          FAIL(INCOMPLETE_CODE);
+        }
+        struct timespec ts = trace->getTimespec();
+        IndexEntry ie;
+        ie.mSec = (u32) ts.tv_sec;
+        ie.mNsec = (u32) ts.tv_nsec;
+        ie.mFilePos = filepos;
+        mRecordIndex.push_back(ie);
+        s32 tag;
+        if (trace->reportSyncIfAny(tag)) {
+          SyncEntry se;
+          se.mFilePos = filepos;
+          se.mTag = tag;
+          mSyncIndex.push_back(se);
+        }
+        delete trace;
+      }
+    }
+  }
+
+  void WeaverLogFile::buildIndex() {
+    if (mIndexState != INDEX_NONE) return;
+    if (loadIndex()) mIndexState = INDEX_LOADED;
+    else {
+      scanIndex();
+      mIndexState = saveIndex() ? INDEX_SAVED : INDEX_UNSAVED;
+    }
+    if (mRecordIndex.size() > 0) {
+      mFirstTimespec.tv_sec = mRecordIndex[0].mSec;
+      mFirstTimespec.tv_nsec = mRecordIndex[0].mNsec;
+      mHasFirstTimespec = true;
+    }
+    reread();
   }
 
   bool ends_with(std::string const & value, std::string const & ending) {
@@ -402,6 +609,15 @@ namespace MFM {
     return std::equal(ending.rbegin(), ending.rend(), value.rbegin());
   }
 
+  static MappedFileByteSource * openSource(const char * path) {
+    MappedFileByteSource * mbsp = new MappedFileByteSource(path);
+    if (!mbsp->IsOpen()) {
+      LOG.Error("Can't map '%s': %s", path, strerror(errno));
+      FAIL(ILLEGAL_STATE);
+    }
+    return mbsp;
+  }
+
   void WeaverLogFile::initDirectory() {
     DIR * dir = opendir(mFilePath);
     if (dir == 0) {
@@ -422,7 +638,7 @@ namespace MFM {
     for (StringVector::iterator i = files.begin(); i != files.end(); ++i) {
       std::string path = std::string(mFilePath)+"/"+*i;
       const char * cpath = path.c_str();
-      FileByteSource * fbsp = new FileByteSource(cpath);
+      MappedFileByteSource * fbsp = openSource(cpath);
       SourceAndNetFilePos sfp(fbsp,netFilePos);
       FBIVecIndex index = mFileByteInfoVector.size();
       mFileByteInfoVector.push_back(sfp);
@@ -433,6 +649,7 @@ namespace MFM {
         FAIL(ILLEGAL_STATE);
       }
       netFilePos += statbuf.st_size;
+      noteSourceStat(statbuf.st_size, statbuf.st_mtime);
     }
     mIsRollingDirectory = true;
   }
@@ -451,10 +668,16 @@ namespace MFM {
       mIsRollingDirectory = false;
       u32 filepos = 0;
       mRollingCutPoints[filepos] = 0;
-      mFileByteInfoVector.push_back(SourceAndNetFilePos(new FileByteSource(mFilePath),filepos));
+      mFileByteInfoVector.push_back(SourceAndNetFilePos(openSource(mFilePath),filepos));
       mLatestIndex = 0;
+      noteSourceStat(statbuf.st_size, statbuf.st_mtime);
     }
   }
+
+  void WeaverLogFile::noteSourceStat(u64 bytes, u64 mtime) {
+    mSourceBytes += bytes;
+    if (mtime > mSourceMTime) mSourceMTime = mtime;
+  }
   
   WeaverLogFile::WeaverLogFile(const char * filePath, u32 num)
     : mFilePath(filePath)
@@ -462,11 +685,19 @@ namespace MFM {
     , mFileByteInfoVector()
     , mAverageOffset(0)
     , mOutlierDistance(10e100)
+    , mHasFirstTimespec(false)
+    , mFirstTimespec()
     , mHasEffectiveOffset(false)
     , mEffectiveOffset()
     , mIsRollingDirectory(false)
     , mRollingCutPoints()
     , mLatestIndex(0)
+    , mCurrentFilePos(0)
+    , mSourceBytes(0)
+    , mSourceMTime(0)
+    , mIndexState(INDEX_NONE)
+    , mRecordIndex()
+    , mSyncIndex()
   {
     initFileOrDirectory();
   }
@@ -703,11 +934,30 @@ namespace MFM {
   }
 
   void Alignment::analyzeLogSync() {
+    // Index the files several at a time.  Each has its own
+    // MappedFileByteSources and buildIndex touches nothing shared
+    u32 maxThreads = std::thread::hardware_concurrency();
+    if (maxThreads == 0) maxThreads = 1;
+    for (u32 base = 0; base < mWeaverLogFiles.size(); base += maxThreads) {
+      std::vector<std::thread> builders;
+      for (u32 i = base; i < mWeaverLogFiles.size() && i < base + maxThreads; ++i)
+        builders.push_back(std::thread(&WeaverLogFile::buildIndex, mWeaverLogFiles[i].first));
+      for (u32 i = 0; i < builders.size(); ++i)
+        builders[i].join();
+    }
     for (WeaverLogFilePtrVector::iterator itr = mWeaverLogFiles.begin();
          itr != mWeaverLogFiles.end(); ++itr) {
       WeaverLogFile* ptr = itr->first;
+      WeaverLogFile::IndexState is = ptr->getIndexState();
+      std::string ipath = ptr->getIndexPath();
+      LOG.Message("%d/ %s index %s: %d records, %d syncs",
+                  ptr->getFileNum(),
+                  is == WeaverLogFile::INDEX_LOADED ? "loaded" :
+                  is == WeaverLogFile::INDEX_SAVED ? "built" : "built unsaved",
+                  ipath.c_str(),
+                  (u32) ptr->getRecordIndex().size(),
+                  ptr->getSyncCount());
       ptr->findITCSyncs(*this);
-     
     }
     for (SyncUseMap::iterator itr = mSyncUseMap.begin();
          itr != mSyncUseMap.end(); ++itr) {
@@ -778,6 +1028,10 @@ namespace MFM {
     }
   }
 
+  static s64 indexEntryNsec(const WeaverLogFile::IndexEntry & ie) {
+    return (s64) ie.mSec*1000000000 + ie.mNsec;
+  }
+
   void Alignment::reportLogs(bool print) {
     for (WeaverLogFilePtrVector::iterator it1 = mWeaverLogFiles.begin();
          it1 != mWeaverLogFiles.end(); ++it1) {
@@ -794,63 +1048,54 @@ namespace MFM {
       }
 
     }
-    bool somebodyLive = true;
-    struct timespec lastTime;
-    lastTime.tv_sec = 0;
-    lastTime.tv_nsec = 0;
-    while (somebodyLive) {
-      somebodyLive = false;
-      FileTracePtrPair * pftpp = 0;
-      for (WeaverLogFilePtrVector::iterator it1 = mWeaverLogFiles.begin();
-           it1 != mWeaverLogFiles.end(); ++it1) {
-        FileTracePtrPair & ftpp = *it1;
-
-        if (!pftpp) {
-          if (advanceToNextTraceIfNeededAndPossible(ftpp)) {
-            pftpp = &ftpp;
-            somebodyLive = true;
-          }
-        } else {
-          if (advanceToNextTraceIfNeededAndPossible(*pftpp)) {
-            FileTrace * existingt = pftpp->second;
-            MFM_API_ASSERT_NONNULL(existingt);
-            struct timespec existing = existingt->getTrace().getTimespec();
-
-            if (advanceToNextTraceIfNeededAndPossible(ftpp)) {
-              FileTrace * newt = ftpp.second;
-              MFM_API_ASSERT_NONNULL(newt);
-              struct timespec challenget = newt->getTrace().getTimespec();
-              if (UniqueTime(challenget,0) < UniqueTime(existing,0)) {
-                pftpp = &ftpp;
-                somebodyLive = true;
-              }
-            }
-          }
-        }
-      }
-      if (somebodyLive) {
-        WeaverLogFile & wlf = *(pftpp->first);
-        FileTrace * reportt = extractNextEarliestTrace(*pftpp);
-        u32 mergedRecNum = mTraceLocs.size();
-        mTraceLocs.push_back(reportt->getWLFNumAndFilePos());
+
+    // Merge the record indexes by effective time -- lowest file
+    // number first among ties -- reading traces only to print them
+    typedef std::pair<s64,u32> MergeKey; // (effective nsec, file number)
+    typedef std::priority_queue<MergeKey,std::vector<MergeKey>,std::greater<MergeKey> > MergeHeap;
+    MergeHeap heap;
+    std::vector<u32> nextRecord(mWeaverLogFiles.size(), 0);
+    std::vector<s64> shiftNsec(mWeaverLogFiles.size(), 0);
+    u32 total = 0;
+    for (u32 fn = 0; fn < mWeaverLogFiles.size(); ++fn) {
+      WeaverLogFile & wlf = *(mWeaverLogFiles[fn].first);
+      const WeaverLogFile::RecordIndex & ri = wlf.getRecordIndex();
+      total += ri.size();
+      if (ri.size() == 0) continue;
+      struct timespec first = wlf.getFirstTimespec();
+      struct timespec eo = wlf.getEffectiveOffset();
+      shiftNsec[fn] =
+        (s64) (eo.tv_sec - first.tv_sec)*1000000000 + (eo.tv_nsec - first.tv_nsec);
+      heap.push(MergeKey(indexEntryNsec(ri[0]) + shiftNsec[fn], fn));
+    }
+    mTraceLocs.reserve(total);
+    while (!heap.empty()) {
+      u32 fn = heap.top().second;
+      heap.pop();
+      WeaverLogFile & wlf = *(mWeaverLogFiles[fn].first);
+      const WeaverLogFile::RecordIndex & ri = wlf.getRecordIndex();
+      u32 filepos = ri[nextRecord[fn]].mFilePos;
+      if (++nextRecord[fn] < ri.size())
+        heap.push(MergeKey(indexEntryNsec(ri[nextRecord[fn]]) + shiftNsec[fn], fn));
+      u32 mergedRecNum = mTraceLocs.size();
+      mTraceLocs.push_back(WLFNumAndFilePos(fn, filepos));
+      if (print) {
+        wlf.seek(filepos);
+        FileTrace * reportt = wlf.read(mergedRecNum, true);
+        MFM_API_ASSERT_NONNULL(reportt);
         struct timespec thisTime = reportt->getTrace().getTimespec();
-        //double seconds = UniqueTime::getIntervalSeconds(thisTime,lastTime);
-        lastTime = thisTime;
-        if (print) {
-          printf("%d %0.5f ",
-                 mergedRecNum,
-                 UniqueTime::doubleFromTimespec(thisTime));
-          //        STDOUT.Printf("%d ",(u32) );
-          //STDOUT.Printf("%4d ",(u32) (1000*seconds));
-          for (u32 i = 0; i < wlf.getFileNum(); ++i) 
-            STDOUT.Printf("        ");
-          STDOUT.Printf("%d/",wlf.getFileNum());
-          reportt->getTrace().printPretty(STDOUT,false);
-        }
+        printf("%d %0.5f ",
+               mergedRecNum,
+               UniqueTime::doubleFromTimespec(thisTime));
+        for (u32 i = 0; i < wlf.getFileNum(); ++i) 
+          STDOUT.Printf("        ");
+        STDOUT.Printf("%d/",wlf.getFileNum());
+        reportt->getTrace().printPretty(STDOUT,false);
         delete reportt;
       }
     }
   }
+
   FileTrace * Alignment::getTraceAtLoc(u32 traceloc) {
     if (traceloc >= getTraceLocCount()) return 0;
     WLFNumAndFilePos wap = mTraceLocs[traceloc];
@@ -861,37 +1106,6 @@ namespace MFM {
     return wlf->read(traceloc, true);
   }
 
-  bool Alignment::advanceToNextTraceIfNeededAndPossible(FileTracePtrPair & ftpp) {
-    if (ftpp.second == 0) {
-      FileTrace * raw = ftpp.first->read(U32_MAX,true);
-      if (raw) {
-        ftpp.second = raw;        
-      }
-    }
-    return (ftpp.second != 0);    // False if trace needed but no more found
-  }
-
-  struct timespec Alignment::nextEarliestTime(FileTracePtrPair & ftpp) {
-    struct timespec ret;
-    if (!advanceToNextTraceIfNeededAndPossible(ftpp)) {
-      ret.tv_sec = S32_MAX;
-      ret.tv_nsec = 0;
-    } else {
-      ret = ftpp.second->getTrace().getTimespec();
-    }
-    return ret;
-  }
-
-  FileTrace * Alignment::extractNextEarliestTrace(FileTracePtrPair & ftpp) {
-    FileTrace * ret;
-    if (!advanceToNextTraceIfNeededAndPossible(ftpp)) {
-      FAIL(ILLEGAL_STATE);
-    }
-    ret = ftpp.second;
-    ftpp.second = 0;
-    return ret;
-  }
-
   bool Alignment::addLogFile(const char * path) {
     // Try opening it to frontload errors
     FILE * file = fopen(path, "r");
@@ -913,6 +1127,8 @@ namespace MFM {
   XX(tweak,t,O,FN/USEC,"Tweak file number FN timing by USEC")   \
   XX(version,v,N,,"Print version and exit")                     \
   XX(log,l,O,LEVEL,"Set or increase logging")                   \
+  XX(query,q,R,NAME,"Print the table of query NAME (rtt, drops, types) over all traces; repeatable") \
+  XX(listen,L,R,PORT,"Weave traces streamed live from tiles to PORT, instead of files") \
 
 #if 0
   XX(paused,p,N,,"Start up paused")                             \
@@ -1018,6 +1234,23 @@ static const char * CMD_HELP_STRING =
         } else ++loglevel;
         break;
 
+      case 'L': {
+        u32 port = 0;
+        CharBufferByteSource cbbs(optarg,strlen(optarg));
+        if (1 != cbbs.Scanf("%d",&port) || port == 0 || port > 0xffff) {
+          error("'%s' not legal as a port", optarg);
+          ++fails;
+        } else mListenPort = port;
+        break;
+      }
+
+      case 'q':
+        if (!mQueries.add(optarg)) {
+          error("No query '%s'; there's %s",optarg,WeaveQuery::getNames());
+          ++fails;
+        }
+        break;
+
       case 'h':
         printf("%s",CMD_HELP_STRING);
         exit(0);
@@ -1052,9 +1285,18 @@ static const char * CMD_HELP_STRING =
         ++fails;
       }
     }
+    if (mListenPort > 0 &&
+        (mAlignment.logFileCount() > 0 || mInteractive || !mQueries.isEmpty())) {
+      error("--listen weaves only live streams, and only to stdout");
+      ++fails;
+    }
     if (fails) {
       fatal("%d command line problem%s",fails,fails==1?"":"s");
     }
+    if (loglevel >= 0 && mListenPort > 0) {
+      LOG.SetLevel(loglevel);
+    }
+    if (mListenPort > 0) return;
     if (mAlignment.logFileCount() == 0)
       fatal("No log files supplied on command line");
       
@@ -1067,12 +1309,18 @@ static const char * CMD_HELP_STRING =
     }
     mAlignment.setPrintSyncMap(wantmap > 0);
     LOG.Message("WM %d", wantmap);
-    mAlignment.processLogs(!mInteractive);
+    mAlignment.processLogs(!mInteractive && mQueries.isEmpty());
+    if (!mQueries.isEmpty())
+      mQueries.run(mAlignment, STDOUT);
   }
 
   int Weaver::main(int argc, char ** argv) {
     //    LOG.SetByteSink(mLogBuffer);
     processArgs(argc,argv);
+    if (mListenPort > 0) {
+      LiveWeave lw(mListenPort, STDOUT);
+      lw.run();
+    }
     if (mInteractive) {
       IWeave iw(*this);
       iw.runInteractive();
@@ -1,4 +1,5 @@
 #include "main.h"
+#include <stdio.h>  /* For sscanf */
 
 void XXXCCH() { }
 
@@ -13,6 +14,18 @@ using namespace MFM;
 
 int main(int argc, char** argv)
 {
+  if (argc > 1 && !strcmp(argv[1], "--bench"))
+  {
+    u32 width = 0, height = 0;
+    if (argc > 2 && sscanf(argv[2], "%ux%u", &width, &height) != 2)
+    {
+      fprintf(stderr, "Usage: %s --bench [WxH]\n", argv[0]);
+      return 1;
+    }
+    CoreHotPath_Bench::Bench_RunBenches(STDOUT, width, height);
+    return 0;
+  }
+
   if (argc > 1)
   {
     MFM::LOG.SetByteSink(MFM::STDERR);
@@ -22,9 +35,20 @@ int main(int argc, char** argv)
   TEST(BitRef_Test);
   TEST(UlamRef_Test);
   TEST(UlamElement_Test);
+  TEST(UlamTransientArena_Test);
+  TEST(ElementProfile_Test);
+  TEST(ElementColorCache_Test);
+  TEST(StatisticsRing_Test);
+  TEST(FastClock_Test);
 
   TEST(GridTransceiver_Test);
+  TEST(SocketChannel_Test);
+  TEST(MetricsServer_Test);
+  TEST(EpochJobQueue_Test);
+  TEST(ViewServer_Test);
+  TEST(ShmChannel_Test);
   TEST(ElementRegistry_Test);
+  TEST(ElementTable_Test);
   TEST(ByteSource_Test);
   TEST(LineTailByteSink_Test);
   TEST(OverflowableCharBufferByteSink_Test);
@@ -36,28 +60,71 @@ int main(int argc, char** argv)
   TEST(PSym_Test);
 
   TEST(Fail_Test);
+  TEST(LonglivedLock_Test);
+  TEST(SPSCQueue_Test);
+  TEST(TileStatsTree_Test);
+  TEST(DatumStreamer_Test);
+  TEST(LZBlock_Test);
+  TEST(Inflate_Test);
+  TEST(MFZBundle_Test);
+  TEST(FlightRecorder_Test);
   TEST(FXP_Test);
+  TEST(CastOps_Test);
   TEST(ColorMap_Test);
   TEST(Random_Test);
   TEST(BitVector_Test);
+  TEST(Microbench_Test);
 
   Point_Test::Test_pointAdd();
   Point_Test::Test_pointMultiply();
 
   MDist_Test::Test_MDistConversion();
+  MDist_Test::Test_MDistSymmetryTables();
+  MDist_Test::Test_MDistPrecompiledTables();
 
-#if 0  /* DEPRECATED */
-  P1Atom_Test::Test_p1atomState();
-  P1Atom_Test::Test_p1atomLBCount();
-  P1Atom_Test::Test_p1atomReadBody();
-  P1Atom_Test::Test_p1atomAddLB();
-  P1Atom_Test::Test_p1atomAddSB();
-#endif
+  TEST(P1Atom_Test);
 
   TEST(EventWindow_Test);
   TEST(Tile_Test);
 
   Grid_Test::Test_gridPlaceAtom();
+  Grid_Test::Test_gridTilePool();
+  Grid_Test::Test_gridCacheBatch();
+  Grid_Test::Test_gridCompactCache();
+  Grid_Test::Test_gridDirectChannels();
+  Grid_Test::Test_gridCacheRedundancy();
+  Grid_Test::Test_gridNUMAPlacement();
+  Grid_Test::Test_gridHugePages();
+  Grid_Test::Test_gridOrderedTileControl();
+  Grid_Test::Test_gridLockSpin();
+  Grid_Test::Test_gridSparseEvents();
+  Grid_Test::Test_gridAgedEvents();
+  Grid_Test::Test_gridQuiescentSleep();
+  Grid_Test::Test_gridAtomCountsWhileRunning();
+  Grid_Test::Test_gridActivityScheduling();
+  Grid_Test::Test_gridMemoryAccount();
+  Grid_Test::Test_gridParallelInit();
+  Grid_Test::Test_gridEventBatches();
+  Grid_Test::Test_gridEventWorkers();
+  Grid_Test::Test_gridOptimisticEvents();
+  Grid_Test::Test_gridSnapshot();
+  Grid_Test::Test_gridSnapshotAsync();
+  Grid_Test::Test_gridSnapshotCompressed();
+  Grid_Test::Test_gridCheckpoint();
+  Grid_Test::Test_gridDiff();
+  Grid_Test::Test_gridEnsemble();
+  Grid_Test::Test_gridReseed();
+  Grid_Test::Test_gridEventBins();
+  Grid_Test::Test_gridTileJobs();
+  Grid_Test::Test_gridDeterministicSteps();
+  Grid_Test::Test_gridDumpAtoms();
+  Grid_Test::Test_gridVisibleSites();
+  Grid_Test::Test_gridPlaceAtomsInRect();
+  Grid_Test::Test_gridPattern();
+  Grid_Test::Test_gridTileStats();
+  Grid_Test::Test_gridSortingWork();
+  Grid_Test::Test_gridCoordMapping();
+  Grid_Test::Test_gridRuntimeTileSize();
 
   TEST(ExternalConfig_Test);
 
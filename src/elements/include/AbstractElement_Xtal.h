@@ -81,6 +81,18 @@ namespace MFM
 
     virtual void GetSites(T & atom, XtalSites & xites, EventWindow<EC>& window) const = 0;
 
+    /**
+     * Does this Xtal have the same sites whatever its atom holds?  If
+     * so, as by default, GetSites is consulted only once and its
+     * result compiled into a site mask; Xtals like
+     * Element_Xtal_General, whose sites live in the atom, override
+     * this to return false.
+     */
+    virtual bool HasFixedSites() const
+    {
+      return true;
+    }
+
     /**
      * Called when self and otherAtom are identical subtypes of
      * AbstractElement_Xtal, to check if there are any additional
@@ -96,8 +108,11 @@ namespace MFM
 
     virtual u32 GetSymI(T &atom, EventWindow<EC>& window) const = 0;
 
-    AbstractElement_Xtal(const UUID & uuid) : Element<EC>(uuid)
+    AbstractElement_Xtal(const UUID & uuid)
+      : Element<EC>(uuid)
+      , m_fixedMask(0)
     {
+      COMPILATION_REQUIREMENT< SITES <= 64 >();
     }
 
     /**
@@ -119,189 +134,168 @@ namespace MFM
       return dynamic_cast<const AbstractElement_Xtal<EC>*>(elt) != 0;
     }
 
-    struct SiteSampler {
-      Random & random;
-      u32 count;
-      SPoint sampleSite;
-      T sampleSiteContents;
-      SiteSampler(Random & rand) : random(rand), count(0) { }
-      void Sample(const SPoint & place, const T & content) {
-        if (random.OneIn(++count))
-        {
-          sampleSite = place;
-          sampleSiteContents = content;
-        }
+    /**
+     * Site masks hold one bit per event window site, MDist site
+     * number idx at bit SITES - 1 - idx, so they're XtalSites' leading
+     * bits read as a number.
+     */
+    static u64 SiteMaskBit(u32 idx)
+    {
+      return ((u64) 1) << (SITES - 1 - idx);
+    }
+
+    /**
+     * Pick one of the sites in \c mask, uniformly, and \returns its
+     * offset.  \c mask must be non-zero.
+     */
+    static SPoint PickSite(Random & random, u64 mask)
+    {
+      u32 skip = random.Create(PopCount64(mask));
+      while (skip-- > 0)
+      {
+        mask &= mask - 1;  // Drop the lowest
       }
-    };
+      const u32 bit = (u32) __builtin_ctzll(mask); // GCC
+      return MDist<R>::get().GetPoint(SITES - 1 - bit);
+    }
 
     virtual void Behavior(EventWindow<EC>& window) const
     {
       Random & random = window.GetRandom();
       const u32 ourType = this->GetType();
+      const u32 resType = Element_Res<EC>::TYPE();
       const MDist<R> & md = MDist<R>::get();
 
       T self = window.GetCenterAtomSym();
 
       // Find out what this Xtal looks like
-      XtalSites xtalSites;
-      GetSites(self, xtalSites, window);
+      const u64 pointMask = GetSiteMask(self, window);
 
       // Establish our symmetry before non-self access through window
       u32 symi = this->GetSymI(self, window);
       window.SetSymmetry((PointSymmetry) symi);
 
       // Xtal windows are considered to consist of two types of sites:
-      // (1) 'Point' sites, which should ideally be occupied by xtals like us
-      //      We count and sample empty, res, non-us-xtal and non-xtal point sites separately
-      u32 totalPointSiteCount = 0;
-      u32 totalConsistentPointSiteCount = 0;
-      SiteSampler inconsistentEmptyPointSites(random);
-      SiteSampler inconsistentResPointSites(random);
-      SiteSampler inconsistentXtalPointSites(random);
-      SiteSampler inconsistentNonxtalPointSites(random);
-
-      // (2) 'Field' sites, which should ideally be empty or Res, but
-      //      surely not xtal.  We count and sample empty, res, us,
-      //      and non-us-xtal field sites separately
-      u32 totalFieldSiteCount = 0;
-      SiteSampler emptyFieldSites(random);
-      SiteSampler resFieldSites(random);
-      SiteSampler usFieldSites(random);
-      SiteSampler nonusXtalFieldSites(random);
+      // (1) 'Point' sites, in pointMask, which should ideally be
+      //     occupied by xtals like us, and (2) 'Field' sites, which
+      //     should ideally be empty or Res, but surely not xtal.  Sort
+      //     the live sites by what's there, then match against the
+      //     pattern a mask at a time.
+      u64 emptyMask = 0;
+      u64 resMask = 0;
+      u64 usMask = 0;
+      u64 nonusXtalMask = 0;
+
+      // Windows mostly hold a few types; remember the last verdict
+      u32 lastOtherType = ourType;
+      bool lastOtherIsXtal = true;
 
       // Scan event window _including_ self site
       for (u32 idx = md.GetFirstIndex(0); idx <= md.GetLastIndex(R); ++idx) {
         const SPoint sp = md.GetPoint(idx);
 
-        // First question: Is this a live site?
         if (!window.IsLiveSiteSym(sp))
           continue;
 
-        // Second question: Is this a point site or a field site?
-        bool isPoint = xtalSites.ReadBit(idx) !=0 ;
-
-        const T other = window.GetRelativeAtomSym(sp);
+        const T & other = window.GetRelativeAtomSym(sp);
         const u32 otherType = other.GetType();
+        const u64 bit = SiteMaskBit(idx);
 
-        if (isPoint) {
-          ++totalPointSiteCount;
-
-          // Next question: Is point site empty and thus potential growth spot?
-
-          bool isEmpty = T::ATOM_EMPTY_TYPE==otherType;
-
-          if (isEmpty)
-          {
-            inconsistentEmptyPointSites.Sample(sp, other);
-          }
-          else
-          {
-            bool isRes = otherType == Element_Res<EC>::TYPE();
-            if (isRes)
-            {
-              inconsistentResPointSites.Sample(sp, other);
-            }
-            else
-            {
-              // Next question: Is occupied point site _really_ one of us?
-              if (otherType == ourType && this->IsSameXtal(self, other, window))
-              {
-                // Yes
-                ++totalConsistentPointSiteCount;
-              }
-              else
-              {
-                // They are not one of us.  Are they _any_ std xtal?
-                bool isXtal = IsAbstractXtalType(window, otherType);
-
-                if (isXtal)
-                {
-                  inconsistentXtalPointSites.Sample(sp, other);
-                }
-                else
-                {
-                  inconsistentNonxtalPointSites.Sample(sp, other);
-                }
-              }
-            }
-          }
+        if (otherType == T::ATOM_EMPTY_TYPE)
+        {
+          emptyMask |= bit;
+        }
+        else if (otherType == resType)
+        {
+          resMask |= bit;
+        }
+        else if (otherType == ourType && this->IsSameXtal(self, other, window))
+        {
+          usMask |= bit;
         }
         else
         {
-          // This is a field site.  We'd like it to be empty or Res,
-          // but we'd really like it not to be us-xtal
-          ++totalFieldSiteCount;
-
-          bool isRes = otherType == Element_Res<EC>::TYPE();
-          if (isRes)
+          if (otherType != lastOtherType)
           {
-            resFieldSites.Sample(sp, other);
+            lastOtherType = otherType;
+            lastOtherIsXtal = IsAbstractXtalType(window, otherType);
           }
-          else
+          if (lastOtherIsXtal)
           {
-            bool isEmpty = T::ATOM_EMPTY_TYPE==otherType;
-
-            if (isEmpty)
-            {
-              emptyFieldSites.Sample(sp, other);
-            }
-            else
-            {
-              // Neither res nor empty.  Are they us?
-              if (otherType == ourType && this->IsSameXtal(self, other, window))
-              {
-                usFieldSites.Sample(sp, other);
-              }
-              else
-              {
-                // No, are they any other std xtal?
-                bool isXtal = IsAbstractXtalType(window, otherType);
-                if (isXtal)
-                {
-                  nonusXtalFieldSites.Sample(sp, other);
-                }
-              }
-            }
+            nonusXtalMask |= bit;
           }
         }
       }
 
+      const u32 totalConsistentPointSiteCount = PopCount64(usMask & pointMask);
+      const u64 usFieldSites = usMask & ~pointMask;
+      const u64 inconsistentEmptyPointSites = emptyMask & pointMask;
+      const u64 inconsistentResPointSites = resMask & pointMask;
+      const u64 resFieldSites = resMask & ~pointMask;
+      const u64 inconsistentXtalPointSites = nonusXtalMask & pointMask;
+
       // Scan finished.  Let's decide what to do.
 
       // Cases in priority order: Do the first that applies, then
       // done.
       //
-      // (0) Are we strictly more inconsistent (usFieldSites.count)
-      //     than consistent (totalConsistentPointSiteCount) with our
-      //     own kind?  If so, assume we're the problem, and res out.
-      if (usFieldSites.count > totalConsistentPointSiteCount)
+      // (0) Are we strictly more inconsistent (usFieldSites) than
+      //     consistent (totalConsistentPointSiteCount) with our own
+      //     kind?  If so, assume we're the problem, and res out.
+      if (PopCount64(usFieldSites) > totalConsistentPointSiteCount)
       {
         window.SetCenterAtomSym(Element_Res<EC>::THE_INSTANCE.GetDefaultAtom());
       }
       // (1) Is there a field us and a point empty?  If so, swap them
-      else if (usFieldSites.count > 0 && inconsistentEmptyPointSites.count > 0)
+      else if (usFieldSites && inconsistentEmptyPointSites)
       {
-        window.SwapAtomsSym(usFieldSites.sampleSite, inconsistentEmptyPointSites.sampleSite);
+        window.SwapAtomsSym(PickSite(random, usFieldSites),
+                            PickSite(random, inconsistentEmptyPointSites));
       }
       // (2) Is there a point res?  If so, make it us
-      else if (inconsistentResPointSites.count > 0)
+      else if (inconsistentResPointSites)
       {
-        window.SetRelativeAtomSym(inconsistentResPointSites.sampleSite, self);
+        window.SetRelativeAtomSym(PickSite(random, inconsistentResPointSites), self);
       }
       // (3) Is there a point empty and a field res?  If so, swap and make the point us
-      else if (resFieldSites.count > 0 && inconsistentEmptyPointSites.count > 0)
+      else if (resFieldSites && inconsistentEmptyPointSites)
       {
-        window.SwapAtomsSym(resFieldSites.sampleSite, inconsistentEmptyPointSites.sampleSite);
-        window.SetRelativeAtomSym(inconsistentEmptyPointSites.sampleSite, self);
+        const SPoint point = PickSite(random, inconsistentEmptyPointSites);
+        window.SwapAtomsSym(PickSite(random, resFieldSites), point);
+        window.SetRelativeAtomSym(point, self);
       }
       // (4) Is there a point non-us-xtal?  If so, res it out
-      else if (inconsistentXtalPointSites.count > 0 && inconsistentEmptyPointSites.count > 0)
+      else if (inconsistentXtalPointSites && inconsistentEmptyPointSites)
       {
-        window.SetRelativeAtomSym(inconsistentXtalPointSites.sampleSite,
+        window.SetRelativeAtomSym(PickSite(random, inconsistentXtalPointSites),
                                   Element_Res<EC>::THE_INSTANCE.GetDefaultAtom());
       }
 
     }
+
+  private:
+
+    /**
+     * The point sites of \c atom as a site mask: compiled from
+     * GetSites once for fixed-site Xtals, else each time.
+     */
+    u64 GetSiteMask(T & atom, EventWindow<EC>& window) const
+    {
+      if (m_fixedMask)
+      {
+        return m_fixedMask;
+      }
+      XtalSites sites;
+      GetSites(atom, sites, window);
+      const u64 mask = sites.ReadLong(0, SITES);
+      if (HasFixedSites())
+      {
+        m_fixedMask = mask;  // Racing tiles all store the same mask
+      }
+      return mask;
+    }
+
+    mutable u64 m_fixedMask;     // 0 until compiled
   };
 }
 
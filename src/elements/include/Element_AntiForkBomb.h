@@ -87,10 +87,18 @@ namespace MFM
       m_maxDensity = 3;
       Element<EC>::SetAtomicSymbol("Af");
       Element<EC>::SetName("Anti-Fork Bomb");
+      Element<EC>::SetAlwaysDiffusable(true);
     }
 
     enum { DEFAULT_COLOR = 0xff333333 };
 
+    virtual bool GetColorStateField(u32 selector, u32 & firstBit, u32 & bitLength) const
+    {
+      firstBit = AFInflammationLevel::START;
+      bitLength = AFInflammationLevel::LENGTH;
+      return true;
+    }
+
     virtual u32 GetAtomColor(const ElementTable<EC> & et, const UlamClassRegistry<EC> & ucr, const T& atom, u32 selector) const
     {
       u32 level = AFInflammationLevel::Read(atom);  // 0..3
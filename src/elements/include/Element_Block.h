@@ -64,6 +64,7 @@ namespace MFM
     {
       Element<EC>::SetAtomicSymbol("B");
       Element<EC>::SetName("Block");
+      Element<EC>::SetInert(true);
     }
 
     virtual const T & GetDefaultAtom() const
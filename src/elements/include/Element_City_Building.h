@@ -169,6 +169,13 @@ namespace MFM
       return 0xff800000;
     }
 
+    virtual bool GetColorStateField(u32 selector, u32 & firstBit, u32 & bitLength) const
+    {
+      firstBit = AFSubType::START;
+      bitLength = AFSubType::LENGTH;
+      return true;
+    }
+
     virtual u32 GetAtomColor(const ElementTable<EC> & et, const UlamClassRegistry<EC> & ucr, const T& atom, u32 selector) const
     {
       switch(GetSubType(atom))
@@ -146,6 +146,13 @@ namespace MFM
       return 0xffffff00;
     }
 
+    virtual bool GetColorStateField(u32 selector, u32 & firstBit, u32 & bitLength) const
+    {
+      firstBit = AFDestType::START;
+      bitLength = AFDestType::LENGTH;
+      return true;
+    }
+
     virtual u32 GetAtomColor(const ElementTable<EC> & et, const UlamClassRegistry<EC> & ucr, const T& atom, u32 selector) const
     {
       switch(GetDestType(atom))
@@ -62,24 +62,31 @@ namespace MFM
       CANAL_MAP1_LEN = CityConstants::CITY_BUILDING_COUNT,
 
       CANAL_MAP2_POS = CANAL_MAP1_POS + CANAL_MAP1_LEN,
-      CANAL_MAP2_LEN = CityConstants::CITY_BUILDING_COUNT
+      CANAL_MAP2_LEN = CityConstants::CITY_BUILDING_COUNT,
+
+      CANAL_KNOWN_POS = CANAL_MAP2_POS + CANAL_MAP2_LEN,
+      CANAL_KNOWN_LEN = CityConstants::CITY_BUILDING_COUNT
     };
 
     typedef BitField<BitVector<BITS>, VD::U32, INITIALIZED_LEN, INITIALIZED_POS> AFInitBits;
 
+    /* The canal: For each destination building type, the direction
+     * cars bound there were last routed, as the high and low bits of
+     * Dir/2 in two maps.  Routing reuses it while that road lasts.
+     */
     typedef BitField<BitVector<BITS>, VD::U32, CANAL_MAP1_LEN, CANAL_MAP1_POS> AFCanal1;
     typedef BitField<BitVector<BITS>, VD::U32, CANAL_MAP2_LEN, CANAL_MAP2_POS> AFCanal2;
 
+    /* One bit per destination: Has its canal been routed yet? */
+    typedef BitField<BitVector<BITS>, VD::U32, CANAL_KNOWN_LEN, CANAL_KNOWN_POS> AFCanalKnown;
+
    private:
     ElementParameterS32<EC> m_minCreatedStreets;
+    ElementParameterS32<EC> m_canalRefreshOdds;
 
-    void RandomizeCanal(T& us, Random& rand) const
+    bool IsCanalKnown(const T& us, u32 destType) const
     {
-      for(u32 i = 0; i < CANAL_MAP1_LEN; i++)
-      {
-        AFCanal1::Write(this->GetBits(us), !!rand.CreateBool());
-        AFCanal2::Write(this->GetBits(us), !!rand.CreateBool());
-      }
+      return (AFCanalKnown::Read(this->GetBits(us)) & (1 << destType)) != 0;
     }
 
     Dir GetCanalDir(const T& us, u32 buildingType) const
@@ -140,6 +147,8 @@ namespace MFM
 
       AFCanal1::Write(this->GetBits(us), topWord);
       AFCanal2::Write(this->GetBits(us), botWord);
+      AFCanalKnown::Write(this->GetBits(us),
+                          AFCanalKnown::Read(this->GetBits(us)) | (1 << destType));
     }
 
    public:
@@ -169,7 +178,11 @@ namespace MFM
       Element<EC>(MFM_UUID_FOR("CityIntersection", CITY_VERSION)),
       m_minCreatedStreets(this, "minCreatedStreets",
                           "Minimum streets created",
-                          "Minimum streets created", 1, 4, 4)
+                          "Minimum streets created", 1, 4, 4),
+      m_canalRefreshOdds(this, "canalRefreshOdds",
+                         "Canal refresh odds",
+                         "Odds of rerouting a destination whose canal is still usable",
+                         1, 32, 1000)
     {
       Element<EC>::SetAtomicSymbol("In");
       Element<EC>::SetName("City Intersection");
@@ -228,9 +241,7 @@ namespace MFM
 
     u32 GetSidewalkType() const;
 
-    u32 IsRelDirCarOrStreet(EventWindow<EC> window, Dir d) const;
-
-    bool CanalIsValid(EventWindow<EC>& window, u32 destType) const;
+    bool IsRelDirCarOrStreet(EventWindow<EC>& window, Dir d) const;
 
     Dir FindBestRouteCanal(EventWindow<EC>& window, u32 destinationType,
                            Dir comingFrom) const;
@@ -251,7 +262,6 @@ namespace MFM
       {
         T newAtom = window.GetCenterAtomDirect();
         InitializeIntersection(newAtom, window);
-        RandomizeCanal(newAtom, window.GetRandom());
         SetInitialized(newAtom);
 
         window.SetCenterAtomDirect(newAtom);
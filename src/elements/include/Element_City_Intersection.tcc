@@ -25,148 +25,57 @@ namespace MFM
   }
 
   template <class EC>
-  u32 Element_City_Intersection<EC>::IsRelDirCarOrStreet(EventWindow<EC> window,
-                                                         Dir d) const
+  bool Element_City_Intersection<EC>::IsRelDirCarOrStreet(EventWindow<EC>& window,
+                                                          Dir d) const
   {
     SPoint dp;
     Dirs::FillDir(dp, d, false);
     dp /= 2;
-     const T& atom = window.GetRelativeAtom(dp);
-
-     return atom.GetType() == GetCarType() || atom.GetType() == GetStreetType();
-   }
-
-   template <class EC>
-   bool Element_City_Intersection<EC>::CanalIsValid(EventWindow<EC>& window,
-						    u32 destType) const
-   {
-     Dir canal = GetCanalDir(window.GetCenterAtom(), destType);
-     SPoint canalPt;
-     Dirs::FillDir(canalPt, canal, false);
-     canalPt /= 2;
-     return window.GetRelativeAtom(canalPt).GetType() == GetStreetType();
-   }
-
-   template <class EC>
-   Dir Element_City_Intersection<EC>::FindRandomRoute(EventWindow<EC>& window) const
-   {
-     return (Dir)((window.GetRandom().Create(4)) * 2);
-   }
-
-   template <class EC>
-   Dir Element_City_Intersection<EC>::FindBestRouteCanal(EventWindow<EC>& window,
-							 u32 destinationType,
-							 Dir comingFrom) const
-   {
-     Dir canal = GetCanalDir(window.GetCenterAtom(), destinationType);
-
-     /* First, see if the canal will help get him in the right
-      * direction.  If the canal points in a direction that he isn't
-      * coming from, route him towards the canal.
-      */
-
-     if (CanalIsValid(window, destinationType) &&
-	 canal != Dirs::OppositeDir(comingFrom))
-     {
-       return canal;
-     }
-
-
-     /*
-      * The canal seems to have been wrong... Let's go ahead and find
-      * another direction and set the canal accordingly.
-      */
-
-     u32 roadFitness[] = {100, 100, 100};
-     SPoint roads[3];
-     Dir dirs[3]; /* The non-canal directions */
-     u32 i = 0;
-     for (Dir d = Dirs::NORTH; d < Dirs::DIR_COUNT; d += 2)
-     {
-       if(d != Dirs::OppositeDir(comingFrom))
-       {
-	 dirs[i] = d;
-	 Dirs::FillDir(roads[i], dirs[i], false);
-         roads[i] /= 2;
-	 i++;
-       }
-     }
-
-     for(u32 i = 0; i < 3; i++)
-     {
-       if(window.IsLiveSite(roads[i]))
-       {
-	 if(window.GetRelativeAtom(roads[i]).GetType() != GetStreetType() &&
-	    window.GetRelativeAtom(roads[i]).GetType() != GetCarType())
-	 {
-	   roadFitness[i] += 100; /* That isn't a road! */
-	 }
-	 else
-	 {
-	   for(u32 j = 0; j < 2; j++)
-	   {
-	     SPoint edgeSidewalk;
-	     if(j == 0)
-	     {
-	       Dirs::FillDir(edgeSidewalk, Dirs::CWDir(Dirs::CWDir(dirs[i])), false);
-               edgeSidewalk /= 2;
-	     }
-	     else
-	     {
-	       Dirs::FillDir(edgeSidewalk, Dirs::CCWDir(Dirs::CCWDir(dirs[i])), false);
-               edgeSidewalk /= 2;
-	     }
-
-	     edgeSidewalk = edgeSidewalk + roads[i];
-	     if(window.GetRelativeAtom(edgeSidewalk).GetType() !=
-		Element_City_Sidewalk<EC>::THE_INSTANCE.GetType())
-	     {
-	       roadFitness[i] += 100; /* Don't want to go that way! */
-	     }
-	     else
-	     {
-	       if(Element_City_Sidewalk<EC>::THE_INSTANCE.
-		  IsReadyToBuild(window.GetRelativeAtom(edgeSidewalk)))
-	       {
-		 roadFitness[i] -=
-		 3 - (
-		 Element_City_Sidewalk<EC>::THE_INSTANCE.
-		 GetBuildingCount(window.
-				  GetRelativeAtom(edgeSidewalk), destinationType));
-	       }
-	       else
-	       {
-		 roadFitness[i]++;
-	       }
-	     }
-	   }
-	 }
-       }
-     }
+    if(!window.IsLiveSiteDirect(dp))
+    {
+      return false;
+    }
+    const T& atom = window.GetRelativeAtomDirect(dp);
 
-     u32 bestDirValue = MIN(roadFitness[0],
-			    MIN(roadFitness[1], roadFitness[2]));
-     u32 bestCount = 0;
-     Dir dirsOfMin[3];
+    return atom.GetType() == GetCarType() || atom.GetType() == GetStreetType();
+  }
 
-     for(u32 i = 0; i < 3; i++)
-     {
-       if(roadFitness[i] == bestDirValue)
-       {
-	 dirsOfMin[bestCount++] = dirs[i];
-       }
-     }
+  template <class EC>
+  Dir Element_City_Intersection<EC>::FindRandomRoute(EventWindow<EC>& window) const
+  {
+    return (Dir)((window.GetRandom().Create(4)) * 2);
+  }
 
-     Dir bestDir = dirsOfMin[window.GetRandom().Create(bestCount)];
+  template <class EC>
+  Dir Element_City_Intersection<EC>::FindBestRouteCanal(EventWindow<EC>& window,
+                                                        u32 destinationType,
+                                                        Dir comingFrom) const
+  {
+    const T& us = window.GetCenterAtomDirect();
+    Dir canal = GetCanalDir(us, destinationType);
+
+    /* If this destination has been routed before, and that road is
+     * still there and isn't where the car came from, send the car
+     * along it without looking around again.  Now and then look
+     * anyway, since sidewalks fill in with buildings over time.
+     */
+    if(IsCanalKnown(us, destinationType) &&
+       canal != Dirs::OppositeDir(comingFrom) &&
+       IsRelDirCarOrStreet(window, canal) &&
+       !window.GetRandom().OneIn(m_canalRefreshOdds.GetValue()))
+    {
+      return canal;
+    }
 
-     /* Now that we have this, reassign the canal. */
-     T newAtom = window.GetCenterAtom();
-     SetCanalDir(newAtom, destinationType, bestDir);
-     window.SetCenterAtom(newAtom);
+    Dir bestDir = FindBestRouteStandard(window, destinationType, comingFrom);
 
-     return bestDir;
-   }
+    /* Now that we have this, reassign the canal. */
+    T newAtom = us;
+    SetCanalDir(newAtom, destinationType, bestDir);
+    window.SetCenterAtomDirect(newAtom);
 
+    return bestDir;
+  }
 
    template <class EC>
    Dir Element_City_Intersection<EC>::FindBestRouteStandard(EventWindow<EC>& window,
@@ -358,15 +267,15 @@ namespace MFM
 
 #ifdef RANDOM_ROUTING
         bestRoute = FindRandomRoute(window);
-#elif defined CANAL_ROUTING
-        bestRoute = FindBestRouteCanal(
+#elif defined STANDARD_ROUTING
+        bestRoute = FindBestRouteStandard(
           window,
           Element_City_Car<EC>::THE_INSTANCE.
           GetDestType(window.GetRelativeAtomDirect(carToMove)),
           Element_City_Car<EC>::THE_INSTANCE.
           GetDirection(window.GetRelativeAtomDirect(carToMove)));
 #else
-        bestRoute = FindBestRouteStandard(
+        bestRoute = FindBestRouteCanal(
           window,
           Element_City_Car<EC>::THE_INSTANCE.
           GetDestType(window.GetRelativeAtomDirect(carToMove)),
@@ -69,6 +69,7 @@ namespace MFM
     {
       Element<EC>::SetAtomicSymbol("Pk");
       Element<EC>::SetName("City Park");
+      Element<EC>::SetInert(true);
     }
 
     virtual const T& GetDefaultAtom() const
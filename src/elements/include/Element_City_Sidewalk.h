@@ -228,6 +228,13 @@ namespace MFM
       return 0xff808080;
     }
 
+    virtual bool GetColorStateField(u32 selector, u32 & firstBit, u32 & bitLength) const
+    {
+      firstBit = AFBuildingFlag::START;
+      bitLength = AFBuildingFlag::LENGTH;
+      return true;
+    }
+
     virtual u32 GetAtomColor(const ElementTable<EC> & et, const UlamClassRegistry<EC> & ucr, const T& atom, u32 selector) const
     {
       if(IsReadyToBuild(atom))
@@ -44,6 +44,7 @@ namespace MFM
     {
       Element<EC>::SetAtomicSymbol("Pm");
       Element<EC>::SetName("Collector (PileMaker)");
+      Element<EC>::SetAlwaysDiffusable(true);
     }
 
     virtual const T & GetDefaultAtom() const
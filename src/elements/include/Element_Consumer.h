@@ -35,6 +35,7 @@
 #include "Element_Empty.h"
 #include "Element_Emitter.h" /* For DATA_MAXVAL, DATA_MINVAL */
 #include "AbstractElement_Reprovert.h"
+#include "DatumQueues.h"
 #include "itype.h"
 #include "Util.h"
 #include "Tile.h"
@@ -115,7 +116,8 @@ namespace MFM
     virtual const char* GetDescription() const
     {
       return "This vertically-reproducing Element consumes DATA atoms and holds "
-             "information on its position and the DATA consumed.";
+             "information on its position and the DATA consumed, which goes to the "
+             "tile's external output, if it has any.";
     }
 
     virtual void Behavior(EventWindow<EC>& window) const
@@ -154,17 +156,20 @@ namespace MFM
 
             u32 bucketsOff = diff / bucketSize;
 
-#if 0 //XXX  Fri Jan 30 22:13:11 2015 EDS unreimplemented
-
             Tile<EC> & tile = window.GetTile();
             ElementTable<EC> & et = tile.GetElementTable();
 
             u64 * datap = et.GetDataAndRegister(this->GetType(), DATA_SLOT_COUNT);
             ++datap[DATUMS_CONSUMED_SLOT];                 // Count datums consumed
             datap[TOTAL_BUCKET_ERROR_SLOT] += bucketsOff;  // Count total bucket error
-#endif
             LOG.Debug("Consumed %d bucketsOff",bucketsOff);
 
+            DatumQueues * dq = window.GetTile().GetDatumQueues();
+            if (dq)
+            {
+              dq->PutOutput(val);
+            }
+
             /*
               printf("[%d:%d:%d/bs %d>%d<%d=%d]Export!: %d %ld %ld %f\n",
               below,
@@ -59,6 +59,7 @@ namespace MFM
     {
       Element<EC>::SetAtomicSymbol("Dt");
       Element<EC>::SetName("Data");
+      Element<EC>::SetAlwaysDiffusable(true);
     }
 
     static Element_Data THE_INSTANCE;
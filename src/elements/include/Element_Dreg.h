@@ -30,6 +30,7 @@
 
 #include "Element.h"
 #include "EventWindow.h"
+#include "EventWindowBatch.h"
 #include "ElementTable.h"
 #include "itype.h"
 #include "Element_Res.h"  /* For Element_Res::TYPE */
@@ -61,6 +62,20 @@ namespace MFM
     ElementParameterS32<EC> m_dregCreateOdds;
     ElementParameterS32<EC> m_dregDeleteOdds;
 
+    /** Each tile's copies of the odds, kept in its element data */
+    struct OddsCache
+    {
+      ParameterCache<s32> m_res;
+      ParameterCache<s32> m_dregCreate;
+      ParameterCache<s32> m_dregDelete;
+    };
+
+    OddsCache & GetOddsCache(EventWindow<EC>& window) const
+    {
+      ElementTable<EC> & et = window.GetTile().GetElementTable();
+      return et.template GetElementData<OddsCache>(this->GetType());
+    }
+
   public:
 
     static Element_Dreg THE_INSTANCE;
@@ -74,6 +89,7 @@ namespace MFM
     {
       Element<EC>::SetAtomicSymbol("Dr");
       Element<EC>::SetName("Dreg");
+      Element<EC>::SetAlwaysDiffusable(true);
     }
 
     virtual u32 PercentMovable(const T& you,
@@ -93,7 +109,43 @@ namespace MFM
              "nearby Atoms by creating RES atoms and deleting nearby atoms.";
     }
 
+    virtual bool IsBatchable() const
+    {
+      return true;
+    }
+
+    virtual void BatchBehavior(EventWindowBatch<EC>& batch) const
+    {
+      OddsCache & odds = GetOddsCache(batch.GetWindow());
+      while (batch.Next())
+      {
+        Element_Dreg<EC>::Behave(batch.GetWindow(), odds);
+      }
+    }
+
+    virtual bool GetSweepRule(SweepRule & rule) const
+    {
+      const u32 empty = Element_Empty<EC>::THE_INSTANCE.GetType();
+      const u32 dreg = this->GetType();
+      const u32 deleteOdds = (u32) m_dregDeleteOdds.GetValue();
+      rule.Clear();
+      rule.AddRewrite(empty, dreg, (u32) m_dregCreateOdds.GetValue(), true);
+      rule.AddRewrite(empty, Element_Res<EC>::THE_INSTANCE.GetType(), (u32) m_resOdds.GetValue(), false);
+      rule.AddRewrite(dreg, empty, deleteOdds, false);
+      rule.AddRewrite(Element_Wall<EC>::TYPE(), empty, 0, false);
+      rule.AddRewrite(SweepRule::ANY_TYPE, empty, deleteOdds, false);
+      rule.m_diffuses = true;
+      return true;
+    }
+
     virtual void Behavior(EventWindow<EC>& window) const
+    {
+      Behave(window, GetOddsCache(window));
+    }
+
+  private:
+
+    void Behave(EventWindow<EC>& window, OddsCache & odds) const
     {
       Random & random = window.GetRandom();
 
@@ -107,23 +159,23 @@ namespace MFM
 
         if(Element_Empty<EC>::THE_INSTANCE.IsType(oldType))
         {
-          if(random.OneIn(m_dregCreateOdds.GetValue()))
+          if(random.OneIn(m_dregCreateOdds.GetValue(odds.m_dregCreate)))
           {
             atom = Element_Dreg<EC>::THE_INSTANCE.GetDefaultAtom();
           }
-          else if(random.OneIn(m_resOdds.GetValue()))
+          else if(random.OneIn(m_resOdds.GetValue(odds.m_res)))
           {
             atom = Element_Res<EC>::THE_INSTANCE.GetDefaultAtom();
           }
         }
         else if(oldType == Element_Dreg::THE_INSTANCE.GetType())
         {
-          if(random.OneIn(m_dregDeleteOdds.GetValue()))
+          if(random.OneIn(m_dregDeleteOdds.GetValue(odds.m_dregDelete)))
           {
             atom = Element_Empty<EC>::THE_INSTANCE.GetDefaultAtom();
           }
         }
-        else if(oldType != Element_Wall<EC>::TYPE() && random.OneIn(m_dregDeleteOdds.GetValue()))
+        else if(oldType != Element_Wall<EC>::TYPE() && random.OneIn(m_dregDeleteOdds.GetValue(odds.m_dregDelete)))
         {
           atom = Element_Empty<EC>::THE_INSTANCE.GetDefaultAtom();
         }
@@ -34,6 +34,7 @@
 #include "Element_Empty.h"
 #include "Element_Data.h"
 #include "AbstractElement_Reprovert.h"
+#include "DatumQueues.h"
 #include "itype.h"
 
 namespace MFM
@@ -92,7 +93,7 @@ namespace MFM
     virtual const char* GetDescription() const
     {
       return "This vertically-reproducing Element emits DATA atoms with randomly generated "
-             "payloads.";
+             "payloads, or with the tile's external input, if it has any.";
     }
 
     virtual void Behavior(EventWindow<EC>& window) const
@@ -101,15 +102,17 @@ namespace MFM
 
       this->ReproduceVertically(window);
 
-      if(random.OddsOf(DATA_CREATE_PER_1000,1000))
+      // Fed emitters emit as fast as their input arrives
+      DatumQueues * dq = window.GetTile().GetDatumQueues();
+      const bool fed = dq && dq->IsFed();
+
+      if(fed || random.OddsOf(DATA_CREATE_PER_1000,1000))
       {
-#if 0 //XXX Fri Jan 30 22:12:52 2015 EDS unreimplemented in v3
         Tile<EC> & tile = window.GetTile();
         ElementTable<EC> & et = tile.GetElementTable();
 
         u64 * datap = et.GetDataAndRegister(this->GetType(), DATA_SLOT_COUNT);
         ++datap[DATUMS_EMITTED_SLOT];                  // Count emission attempts
-#endif
 
         // Pick random nearest empty, if any
         const MDist<R> & md = MDist<R>::get();
@@ -132,14 +135,28 @@ namespace MFM
           }
           if (emptiesFound > 0)
           {
+            u32 datum;
+            if (!fed)
+            {
+              datum = random.Between(DATA_MINVAL, DATA_MAXVAL);
+            }
+            else if (!dq->TakeInput(datum))
+            {
+              return;  // Nothing to emit yet
+            }
+            else if (datum < DATA_MINVAL || datum > DATA_MAXVAL)
+            {
+              dq->RejectInput();
+              return;
+            }
             T atom = Element_Data<EC>::THE_INSTANCE.GetDefaultAtom();
-            Element_Data<EC>::THE_INSTANCE.SetDatum(atom,random.Between(DATA_MINVAL, DATA_MAXVAL));
+            Element_Data<EC>::THE_INSTANCE.SetDatum(atom,datum);
             window.SetRelativeAtomSym(emptyPoint, atom);
             return;
           }
         }
 
-        //XXX        ++datap[DATUMS_REJECTED_SLOT];  // Opps, no room at the inn
+        ++datap[DATUMS_REJECTED_SLOT];  // Opps, no room at the inn
       }
     }
   };
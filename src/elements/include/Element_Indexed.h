@@ -70,6 +70,7 @@ namespace MFM
     {
       Element<EC>::SetAtomicSymbol("Ix");
       Element<EC>::SetName("Indexed");
+      Element<EC>::SetAlwaysDiffusable(true);
     }
 
     virtual u32 PercentMovable(const T& you,
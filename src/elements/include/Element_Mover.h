@@ -59,6 +59,7 @@ namespace MFM
     {
       Element<EC>::SetAtomicSymbol("Mv");
       Element<EC>::SetName("Mover");
+      Element<EC>::SetAlwaysDiffusable(true);
     }
 
     virtual const T & GetDefaultAtom() const
@@ -30,6 +30,7 @@
 
 #include "Element.h"
 #include "EventWindow.h"
+#include "EventWindowBatch.h"
 #include "ElementTable.h"
 #include "itype.h"
 
@@ -66,6 +67,7 @@ namespace MFM
     {
       Element<EC>::SetAtomicSymbol("R");
       Element<EC>::SetName("Res");
+      Element<EC>::SetAlwaysDiffusable(true);
     }
 
     virtual u32 PercentMovable(const T& you,
@@ -86,6 +88,26 @@ namespace MFM
              "regulatory properties.";
     }
 
+    virtual bool IsBatchable() const
+    {
+      return true;
+    }
+
+    virtual void BatchBehavior(EventWindowBatch<EC>& batch) const
+    {
+      while (batch.Next())
+      {
+        Element_Res<EC>::Behavior(batch.GetWindow());
+      }
+    }
+
+    virtual bool GetSweepRule(SweepRule & rule) const
+    {
+      rule.Clear();
+      rule.m_diffuses = true;
+      return true;
+    }
+
     virtual void Behavior(EventWindow<EC>& window) const
     {
       window.Diffuse();
@@ -69,6 +69,12 @@ namespace MFM
     static const u32 STATE_THRESHOLD_LEN = 32;
     static const u32 STATE_BITS = STATE_THRESHOLD_LEN;
 
+    // Element Data Slot names
+    enum {
+      DATUMS_SORTED_SLOT,
+      DATA_SLOT_COUNT
+    };
+
     static const SPoint m_southeastSubWindow[4];
     static const SPoint m_northeastSubWindow[4];
     static const SPoint m_southwestSubWindow[4];
@@ -89,6 +95,7 @@ namespace MFM
     {
       Element<EC>::SetAtomicSymbol("Sr");
       Element<EC>::SetName("Sorter");
+      Element<EC>::SetAlwaysDiffusable(true);
     }
 
     u32 GetThreshold(const T &atom, u32 badType) const
@@ -211,6 +218,10 @@ namespace MFM
             SetThreshold(self, datum);
             window.SetCenterAtomSym(self);
             window.SwapAtomsSym(src, dst);
+
+            ElementTable<EC> & et = window.GetTile().GetElementTable();
+            u64 * datap = et.GetDataAndRegister(TYPE(), DATA_SLOT_COUNT);
+            ++datap[DATUMS_SORTED_SLOT];  // Count datums passed along
             break;
           }
         }
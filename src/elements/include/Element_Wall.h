@@ -61,6 +61,7 @@ namespace MFM
     {
       Element<EC>::SetAtomicSymbol("W");
       Element<EC>::SetName("Wall");
+      Element<EC>::SetInert(true);
     }
 
     virtual const T & GetDefaultAtom() const
@@ -92,6 +93,12 @@ namespace MFM
       return 0;
     }
 
+    virtual bool GetSweepRule(SweepRule & rule) const
+    {
+      rule.Clear();             // Stays put
+      return true;
+    }
+
     virtual void Behavior(EventWindow<EC>& window) const
     { }
   };
@@ -108,6 +108,11 @@ namespace MFM
         AFSites::ReadLong(this->GetBits(self)) == AFSites::ReadLong(this->GetBits(otherAtom));
     }
 
+    virtual bool HasFixedSites() const
+    {
+      return false;
+    }
+
     virtual void GetSites(T & atom, XtalSites & sites, EventWindow<EC>& window) const
     {
       u64 bits = AFSites::ReadLong(this->GetBits(atom));
@@ -52,6 +52,7 @@
 #include "ExternalConfigSectionGUI.h"
 #include "FileByteSource.h"
 #include "Camera.h"
+#include "ViewClient.h"
 #include "AbstractDriver.h"
 #include "VArguments.h"
 #include "SDL.h"
@@ -74,6 +75,8 @@ namespace MFM
     typedef AbstractDriver<GC> Super;
     typedef typename Super::OurGrid OurGrid;
     typedef typename GC::EVENT_CONFIG EC;
+    typedef typename EC::ATOM_CONFIG AC;
+    typedef typename AC::ATOM_TYPE T;
 
     OString512 m_startFile;
     bool m_startPaused;
@@ -93,6 +96,8 @@ namespace MFM
 
     bool m_renderStats;
 
+    bool m_overlapRendering; // Paint tile images while the grid runs
+
     bool m_batchMode;
     s32 m_backupStdout;
 
@@ -183,6 +188,12 @@ namespace MFM
     bool m_snapshotRequested;
     OString512 m_snapshotPath;
 
+    OString128 m_viewFromHost;      // Set with m_viewFromPort by --viewFrom
+    u32 m_viewFromPort;             // 0 unless --viewFrom
+    ViewClient m_viewClient;
+    u16 * m_viewShown;              // The site types last placed in our grid
+    T * m_viewRow;                  // A row of atoms to place
+
   public:
     static AbstractGUIDriver * getSelf() { return m_staticSelf; }
     
@@ -319,8 +330,68 @@ namespace MFM
       m_buttonPanel.Insert(&m_replayPanel,0);
     }
 
+    /**
+     * Under --viewFrom, make our (never running) grid look like the
+     * latest frame from the view server, placing default atoms of the
+     * types of just the sites that have changed, a run at a time.
+     */
+    void ShowRemoteView(OurGrid& grid)
+    {
+      if (!m_viewClient.Poll(0))
+      {
+        return;
+      }
+      const ViewFrameDecoder & frame = m_viewClient.GetDecoder();
+      const u32 width = grid.GetWidthSites();
+      const u32 height = grid.GetHeightSites();
+      if (frame.GetWidth() != width || frame.GetHeight() != height)
+      {
+        LOG.Error("Viewed grid is %dx%d sites but ours is %dx%d; run with the same grid geometry",
+                  frame.GetWidth(), frame.GetHeight(), width, height);
+        m_viewClient.Close();
+        return;
+      }
+
+      if (!m_viewShown)
+      {
+        m_viewShown = new u16[width * height];
+        m_viewRow = new T[width];
+        grid.GetSiteTypes(m_viewShown);
+      }
+
+      const Element<EC> * empty = grid.LookupElement(T::ATOM_EMPTY_TYPE);
+      const u16 * types = frame.GetTypes();
+      for (u32 y = 0; y < height; ++y)
+      {
+        u16 * shown = m_viewShown + y * width;
+        const u16 * want = types + y * width;
+        for (u32 x = 0; x < width; )
+        {
+          if (want[x] == shown[x])
+          {
+            ++x;
+            continue;
+          }
+          const u32 start = x;
+          for (; x < width && want[x] != shown[x]; ++x)
+          {
+            const Element<EC> * elt = grid.LookupElement(want[x]);
+            m_viewRow[x - start] = (elt ? elt : empty)->GetDefaultAtom();  // Unknown here: show Empty
+            shown[x] = want[x];
+          }
+          grid.PlaceAtomsInRow(false, m_viewRow, 1, SPoint(start, y), x - start);
+        }
+      }
+    }
+
     void Update(OurGrid& grid)
     {
+      if (m_viewFromPort > 0)
+      {
+        ShowRemoteView(grid);  // Our grid doesn't run; it shows another's
+        return;
+      }
+
       // XXX      TileRenderer& tileRenderer = m_grend.GetTileRenderer();
 
       if (m_singleStep)
@@ -329,14 +400,32 @@ namespace MFM
       }
 
       m_gridPaused = m_keyboardPaused || m_mousePaused;
-      if (!m_gridPaused)
+      const bool overlap = m_overlapRendering && !m_gridPaused &&
+        !m_batchMode && !m_screenUpdateDisabled && !m_captureScreenshots;
+      m_tileRenderer.SetPaintFromSnapshots(overlap);
+      if (overlap)
+      {
+        // Paint the tile images from snapshots while the grid runs,
+        // sleeping out whatever of its period that leaves
+        m_gridPanel.CaptureTiles();
+        Super::StartUpdateGrid(grid);
+        const u64 startMS = Super::GetTicks();
+        m_gridPanel.PrepareTiles();
+        const u64 spentUS = 1000 * (Super::GetTicks() - startMS);
+        const u64 periodUS = Super::GetMicrosSleepPerFrame();
+        if (spentUS < periodUS)
+          SleepUsec((u32) (periodUS - spentUS));
+        Super::FinishUpdateGrid(grid);
+      }
+      else if (!m_gridPaused)
       {
         Super::UpdateGrid(grid);
-        if (m_singleStep)
-        {
-          m_keyboardPaused = true;
-          m_singleStep = false;
-        }
+      }
+
+      if (!m_gridPaused && m_singleStep)
+      {
+        m_keyboardPaused = true;
+        m_singleStep = false;
       }
 
       // Slew camera
@@ -695,12 +784,25 @@ namespace MFM
       // Again to 'set' stuff?
       SetScreenSize(m_screenWidth, m_screenHeight);
 
+      if (m_viewFromPort > 0)
+      {
+        m_viewClient.Connect(m_viewFromHost.GetZString(), (u16) m_viewFromPort);
+      }
+
     }
 
   public:
     TileRenderer<EC> & GetTileRenderer() { return m_tileRenderer; }
     const TileRenderer<EC> & GetTileRenderer() const { return m_tileRenderer; }
 
+    virtual void AccountMemory(MemoryAccount & account) const
+    {
+      Super::AccountMemory(account);
+      m_tileRenderer.AccountMemory(account);
+      if (m_screen)
+        account.Add(MemoryAccount::SURFACES, (u64) m_screen->pitch * m_screen->h);
+    }
+
     void SetSingleStep(bool single) { m_singleStep = single; }
     bool IsSingleStep() const { return m_singleStep; }
 
@@ -858,8 +960,9 @@ namespace MFM
       return true;
     }
 
-    AbstractGUIDriver(u32 gridWidth, u32 gridHeight, GridLayoutPattern gridLayout)
-      : Super(gridWidth, gridHeight, gridLayout)
+    AbstractGUIDriver(u32 gridWidth, u32 gridHeight, GridLayoutPattern gridLayout,
+                      u32 tileWidth = GC::TILE_WIDTH, u32 tileHeight = GC::TILE_HEIGHT)
+      : Super(gridWidth, gridHeight, gridLayout, tileWidth, tileHeight)
       , m_startPaused(true)
       , m_thisUpdateIsEpoch(false)
       , m_bigText(false)
@@ -874,6 +977,7 @@ namespace MFM
       , m_gridPaused(false)
       , m_reinitRequested(false)
       , m_renderStats(false)
+      , m_overlapRendering(true)
       , m_batchMode(false)
       , m_backupStdout(-1)
       , m_screen(0)
@@ -934,18 +1038,26 @@ namespace MFM
       , m_increaseAEPSPerFrame(*this)
       , m_decreaseAEPSPerFrame(*this)
       , m_snapshotRequested(false)
+      , m_viewFromPort(0)
+      , m_viewShown(0)
+      , m_viewRow(0)
       , m_buttonPanel("ButtonPanel",false)
       , m_miniButtonPanel("miniButtonPanel",true)
       , m_externalConfigSectionGUI(AbstractDriver<GC>::GetExternalConfig(),*this)
     {
       m_snapshotPath.Reset();
       m_startFile.Reset();
+      m_viewFromHost.Reset();
       m_staticSelf = this;
       signal(SIGUSR1, AbstractGUIDriver::handleUSR1);
       signal(SIGUSR2, AbstractGUIDriver::handleUSR2);
     }
 
-    virtual ~AbstractGUIDriver() { }
+    virtual ~AbstractGUIDriver()
+    {
+      delete [] m_viewShown;
+      delete [] m_viewRow;
+    }
 
     virtual void ReinitUs()
     {
@@ -1047,6 +1159,29 @@ namespace MFM
       driver->SetRunLabel(label);
     }
 
+    static void SetViewFromFromArgs(const char* hostPort, void* driverptr)
+    {
+      AbstractGUIDriver& driver = *((AbstractGUIDriver<GC>*)driverptr);
+      VArguments& args = driver.m_varguments;
+
+      const char * colon = strrchr(hostPort, ':');
+      if (!colon || colon == hostPort)
+      {
+        args.Die("Bad view source '%s': expected HOST:PORT", hostPort);
+      }
+
+      s32 out;
+      const char * errmsg = AbstractDriver<GC>::GetNumberFromString(colon + 1, out, 1, 65535);
+      if (errmsg)
+      {
+        args.Die("Bad view port in '%s': %s", hostPort, errmsg);
+      }
+
+      driver.m_viewFromHost.Reset();
+      driver.m_viewFromHost.WriteBytes((const u8 *) hostPort, (u32) (colon - hostPort));
+      driver.m_viewFromPort = (u32) out;
+    }
+
     static void SetStartFileFromArgs(const char* path, void* driverptr)
     {
       AbstractGUIDriver& driver = *((AbstractGUIDriver<GC>*)driverptr);
@@ -1123,6 +1258,61 @@ namespace MFM
       driver.m_screenUpdateDisabled = value;
     }
 
+    static void SetPNGQueueDepthFromArgs(const char* str, void* driverptr)
+    {
+      AbstractGUIDriver* driver = (AbstractGUIDriver<GC>*)driverptr;
+      VArguments& args = driver->m_varguments;
+
+      s32 out;
+      const char * errmsg =
+        AbstractDriver<GC>::GetNumberFromString(str, out, 0, Camera::MAX_QUEUE_DEPTH);
+      if (errmsg)
+      {
+        args.Die("Bad png queue depth '%s': %s", str, errmsg);
+      }
+
+      driver->m_camera.SetQueueDepth((u32) out);
+    }
+
+    static void SetPNGWritersFromArgs(const char* str, void* driverptr)
+    {
+      AbstractGUIDriver* driver = (AbstractGUIDriver<GC>*)driverptr;
+      VArguments& args = driver->m_varguments;
+
+      s32 out;
+      const char * errmsg =
+        AbstractDriver<GC>::GetNumberFromString(str, out, 1, Camera::MAX_WRITERS);
+      if (errmsg)
+      {
+        args.Die("Bad png writer count '%s': %s", str, errmsg);
+      }
+
+      driver->m_camera.SetWriterCount((u32) out);
+    }
+
+    static void SetPaintThreadsFromArgs(const char* str, void* driverptr)
+    {
+      AbstractGUIDriver* driver = (AbstractGUIDriver<GC>*)driverptr;
+      VArguments& args = driver->m_varguments;
+
+      s32 out;
+      const char * errmsg =
+        AbstractDriver<GC>::GetNumberFromString(str, out, 0, TileRenderer<EC>::MAX_PAINT_THREADS);
+      if (errmsg)
+      {
+        args.Die("Bad paint threads '%s': %s", str, errmsg);
+      }
+
+      driver->m_tileRenderer.SetPaintThreads((u32) out);
+    }
+
+    static void SetLockstepRenderingFromArgs(const char* not_used, void* driverptr)
+    {
+      AbstractGUIDriver& driver = *((AbstractGUIDriver*)driverptr);
+
+      driver.m_overlapRendering = false;
+    }
+
     static void DontShowHelpPanelOnStart(const char* not_used, void* driverptr)
     {
       AbstractGUIDriver& driver = *((AbstractGUIDriver*)driverptr);
@@ -1172,9 +1362,21 @@ namespace MFM
       this->RegisterArgument("Record a png per epoch for playback at ARG fps",
                              "-p|--pngs", &SetRecordScreenshotPerAEPSFromArgs, this, true);
 
+      this->RegisterArgument("Buffer up to ARG recorded frames for a background png writer (0 to write inline)",
+                             "--png-queue", &SetPNGQueueDepthFromArgs, this, true);
+
+      this->RegisterArgument("Encode queued pngs on ARG background threads (default 2)",
+                             "--png-writers", &SetPNGWritersFromArgs, this, true);
+
       this->RegisterArgument("Simulation begins upon program startup.",
                              "--run", &SetStartPausedFromArgs, this, false);
 
+      this->RegisterArgument("Paint the grid only while it is paused between updates.",
+                             "--lockstep-render", &SetLockstepRenderingFromArgs, this, false);
+
+      this->RegisterArgument("Repaint tile images on ARG extra threads (default 0).",
+                             "--paint-threads", &SetPaintThreadsFromArgs, this, true);
+
       this->RegisterArgument("Help panel is not shown upon startup.",
                              "-n|--nohelp", &DontShowHelpPanelOnStart, this, false);
 
@@ -1187,6 +1389,9 @@ namespace MFM
       this->RegisterArgument("Specify alternate start-up file (use - for none).",
                              "--start-file", &SetStartFileFromArgs, this, true);
 
+      this->RegisterArgument("Show the grid served by a --viewPort run at HOST:PORT, instead of running this one",
+                             "--viewFrom", &SetViewFromFromArgs, this, true);
+
     }
 
     DriverButtonPanel m_buttonPanel, m_miniButtonPanel;
@@ -1400,6 +1605,17 @@ namespace MFM
         }
       }
 
+      m_camera.Flush();  // Finish writing any recorded frames
+      {
+        const Camera::Stats stats = m_camera.GetStats();
+        if (stats.m_framesQueued > 0)
+        {
+          LOG.Message("Wrote %d queued pngs (%d failed); queue peaked at %d, "
+                      "full %d times for %d ms",
+                      stats.m_framesWritten, stats.m_writeFailures, stats.m_maxQueued,
+                      stats.m_stalls, (u32) (stats.m_stallMicros / 1000));
+        }
+      }
       AssetManager::Destroy();
       SDL_FreeSurface(m_screen);
       TTF_Quit();
@@ -88,6 +88,15 @@ namespace MFM
       Grid<GC> & grid = this->GetGrid();
       grid.PlaceAtomInSite(this->IsSiteEdit(), elt->GetDefaultAtom(), MakeSigned(gridCoord));
     }
+
+    virtual void UpdateGridSpan(SPoint start, u32 length)
+    {
+      const Element<EC> * elt = this->GetSelectedElement();
+      MFM_API_ASSERT_NONNULL(elt);
+
+      Grid<GC> & grid = this->GetGrid();
+      grid.PlaceAtomsInRect(this->IsSiteEdit(), elt->GetDefaultAtom(), Rect(start, UPoint(length, 1)));
+    }
   };
 
   template<class GC>
@@ -114,6 +123,13 @@ namespace MFM
       Grid<GC> & grid = this->GetGrid();
       grid.PlaceAtomInSite(this->IsSiteEdit(), Element_Empty<EC>::THE_INSTANCE.GetDefaultAtom(), MakeSigned(gridCoord));
     }
+
+    virtual void UpdateGridSpan(SPoint start, u32 length)
+    {
+      Grid<GC> & grid = this->GetGrid();
+      grid.PlaceAtomsInRect(this->IsSiteEdit(), Element_Empty<EC>::THE_INSTANCE.GetDefaultAtom(),
+                            Rect(start, UPoint(length, 1)));
+    }
   };
 
   template<class GC>
@@ -142,6 +158,15 @@ namespace MFM
       Grid<GC> & grid = this->GetGrid();
       grid.PlaceAtomInSite(this->IsSiteEdit(), elt->GetDefaultAtom(), MakeSigned(gridCoord));
     }
+
+    virtual void UpdateGridSpan(SPoint start, u32 length)
+    {
+      const Element<EC> * elt = this->GetSelectedElement();
+      MFM_API_ASSERT_NONNULL(elt);
+
+      Grid<GC> & grid = this->GetGrid();
+      grid.PlaceAtomsInRect(this->IsSiteEdit(), elt->GetDefaultAtom(), Rect(start, UPoint(length, 1)));
+    }
   };
 
   template<class GC>
@@ -269,8 +269,122 @@ namespace MFM
 
   class AssetManager
   {
+  public:
+
+    enum
+    {
+      TEXT_CACHE_ENTRIES = 512,   // Rendered strings kept around
+      TEXT_CACHE_BUCKETS = 1024,  // Power of two
+      TEXT_CACHE_MAX_LENGTH = 95  // Longer strings aren't cached
+    };
+
+    struct TextCacheStats
+    {
+      u64 m_hits;
+      u64 m_misses;
+      u64 m_evictions;
+      u64 m_uncached;
+    };
+
   private:
 
+    /**
+       One rendered string: the (font, text, color) it was rendered
+       from, the surface TTF made of it, and when it was last used.
+       Entries are chained off TEXT_CACHE_BUCKETS by hash, with links
+       holding index + 1 so that zero-initialized buckets are empty.
+     */
+    struct TextCacheEntry
+    {
+      TTF_Font * m_font;        // NULL if this entry is free
+      SDL_Surface * m_surface;
+      u32 m_color;
+      u32 m_hash;
+      u32 m_lastUse;
+      u16 m_next;               // Next in bucket + 1, or 0
+      char m_text[TEXT_CACHE_MAX_LENGTH + 1];
+    };
+
+    static TextCacheEntry textCache[TEXT_CACHE_ENTRIES];
+
+    static u16 textCacheBuckets[TEXT_CACHE_BUCKETS];
+
+    static u32 textCacheUsed;
+
+    static u32 textCacheClock;
+
+    static TextCacheStats textCacheStats;
+
+    static u32 HashText(TTF_Font * font, const char * text, u32 color, u32 & length)
+    {
+      u32 h = 2166136261u;      // FNV-1a
+      u32 i;
+      for (i = 0; text[i] && i <= TEXT_CACHE_MAX_LENGTH; ++i)
+      {
+        h = (h ^ (u8) text[i]) * 16777619u;
+      }
+      length = i;
+      h = (h ^ color) * 16777619u;
+      h = (h ^ (u32) (((size_t) font) >> 4)) * 16777619u;
+      return h;
+    }
+
+    static void UnlinkTextEntry(u32 idx)
+    {
+      TextCacheEntry & e = textCache[idx];
+      u16 * link = &textCacheBuckets[e.m_hash & (TEXT_CACHE_BUCKETS - 1)];
+      while (*link != idx + 1)
+      {
+        if (*link == 0) FAIL(ILLEGAL_STATE);
+        link = &textCache[*link - 1].m_next;
+      }
+      *link = e.m_next;
+      SDL_FreeSurface(e.m_surface);
+      e.m_surface = NULL;
+      e.m_font = NULL;
+    }
+
+    /**
+       Find a slot for a new entry: a never-used one while there are
+       any, otherwise the least recently used, which is evicted.  The
+       scan only happens on a miss, which is paying for a TTF render
+       anyway.
+     */
+    static u32 AllocateTextEntry()
+    {
+      if (textCacheUsed < TEXT_CACHE_ENTRIES)
+      {
+        return textCacheUsed++;
+      }
+      u32 oldest = 0;
+      for (u32 i = 1; i < TEXT_CACHE_ENTRIES; ++i)
+      {
+        if (textCacheClock - textCache[i].m_lastUse >
+            textCacheClock - textCache[oldest].m_lastUse)
+        {
+          oldest = i;
+        }
+      }
+      UnlinkTextEntry(oldest);
+      ++textCacheStats.m_evictions;
+      return oldest;
+    }
+
+    static void FlushTextCache()
+    {
+      for (u32 i = 0; i < textCacheUsed; ++i)
+      {
+        SDL_FreeSurface(textCache[i].m_surface);
+        textCache[i].m_surface = NULL;
+        textCache[i].m_font = NULL;
+      }
+      for (u32 i = 0; i < TEXT_CACHE_BUCKETS; ++i)
+      {
+        textCacheBuckets[i] = 0;
+      }
+      textCacheUsed = 0;
+    }
+
     static SDL_Surface* surfaces[IMAGE_ASSET_COUNT];
 
     static TTF_Font* fonts[FONT_ASSET_COUNT];
@@ -384,6 +498,7 @@ namespace MFM
         fonts[FONT_ASSET_ELEMENT_MEDIUM] = LoadFont(ASSETMANAGER_FIX_FONT, 34);
 
         InitZFonts();
+        FlushTextCache();
         initialized = true;
       }
     }
@@ -413,6 +528,7 @@ namespace MFM
           TTF_CloseFont(zfonts[i][1]);
         }
 
+        FlushTextCache();  // Keyed by fonts that are now gone
         initialized = false;
       }
     }
@@ -486,6 +602,67 @@ namespace MFM
       return TTF_FontLineSkip(f);
     }
 
+    /**
+       Get \c text rendered (blended) in \c font and ARGB \c color,
+       rendering it only if it isn't already in the text cache.  The
+       surface belongs to the cache and is good only until the next
+       call here, so blit it and let it go.
+
+       \returns NULL if \c text is too long to cache (or \c font is
+       NULL), in which case the caller renders (and frees) it itself.
+     */
+    static SDL_Surface* GetRenderedText(TTF_Font * font, const char * text, u32 color)
+    {
+      MFM_API_ASSERT_NONNULL(text);
+      if (!font) return NULL;
+      u32 length;
+      const u32 hash = HashText(font, text, color, length);
+      if (length > TEXT_CACHE_MAX_LENGTH)
+      {
+        ++textCacheStats.m_uncached;
+        return NULL;
+      }
+
+      ++textCacheClock;
+      const u32 bucket = hash & (TEXT_CACHE_BUCKETS - 1);
+      for (u32 link = textCacheBuckets[bucket]; link != 0; link = textCache[link - 1].m_next)
+      {
+        TextCacheEntry & e = textCache[link - 1];
+        if (e.m_hash == hash && e.m_font == font && e.m_color == color &&
+            !strcmp(e.m_text, text))
+        {
+          e.m_lastUse = textCacheClock;
+          ++textCacheStats.m_hits;
+          return e.m_surface;
+        }
+      }
+
+      ++textCacheStats.m_misses;
+      SDL_Color sdl_color;
+      sdl_color.r = (color >> 16) & 0xff;
+      sdl_color.g = (color >> 8) & 0xff;
+      sdl_color.b = color & 0xff;
+      SDL_Surface * surface = TTF_RenderText_Blended(font, text, sdl_color);
+      if (!surface) return NULL;  // Nothing to cache; caller will fail too
+
+      const u32 idx = AllocateTextEntry();
+      TextCacheEntry & e = textCache[idx];
+      e.m_font = font;
+      e.m_surface = surface;
+      e.m_color = color;
+      e.m_hash = hash;
+      e.m_lastUse = textCacheClock;
+      memcpy(e.m_text, text, length + 1);
+      e.m_next = textCacheBuckets[bucket];
+      textCacheBuckets[bucket] = (u16) (idx + 1);
+      return surface;
+    }
+
+    static const TextCacheStats & GetTextCacheStats()
+    {
+      return textCacheStats;
+    }
+
     static UPoint GetFontTextSize(FontAsset font, const char * text)
     {
       MFM_API_ASSERT_NONNULL(text);
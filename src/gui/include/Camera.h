@@ -30,6 +30,7 @@
 
 #include "itype.h"
 #include "SDL.h"
+#include <pthread.h>
 
 namespace MFM
 {
@@ -43,9 +44,36 @@ namespace MFM
    * At the moment, this only supports writing 10 million frames. This
    * is a whole lot, but keep this in mind if wanting to make a really
    * long video.
+   *
+   * With a queue depth above zero, DrawSurface just copies the pixels
+   * into a bounded queue of recycled buffers, and a pool of
+   * background threads encodes and writes the PNGs, so recording a
+   * long run doesn't stall the render loop.  DrawSurface waits only
+   * when the queue is full, and GetStats says how often that was.
    */
   class Camera
   {
+  public:
+
+    enum {
+      MAX_QUEUE_DEPTH = 64,
+      DEFAULT_QUEUE_DEPTH = 8,
+      MAX_WRITERS = 8,
+      DEFAULT_WRITERS = 2,
+      FRAME_PATH_MAX_LENGTH = 512
+    };
+
+    /** How the background writers have kept up */
+    struct Stats
+    {
+      u32 m_framesQueued;    // Handed to the writers
+      u32 m_framesWritten;   // Including failures
+      u32 m_writeFailures;
+      u32 m_stalls;          // DrawSurface calls that waited for room
+      u64 m_stallMicros;     // Total time they waited
+      u32 m_maxQueued;       // Most frames queued or in progress at once
+    };
+
   private:
 
     static const u32 VIDEO_NAME_MAX_LENGTH = 64;
@@ -60,17 +88,105 @@ namespace MFM
 
     u32 SavePNG(const char* filename, SDL_Surface* sfc) const;
 
+    static u32 SavePNG(const char* filename, const u8* pixels,
+                       u32 width, u32 height, u32 pitch);
+
+    enum FrameState { FRAME_FREE, FRAME_QUEUED, FRAME_WRITING, FRAME_DONE };
+
+    /** One frame's pixels, copied off the screen, waiting to be written */
+    struct QueuedFrame
+    {
+      u8* m_pixels;
+      u32 m_capacity;      // Bytes allocated at m_pixels
+      u32 m_width;
+      u32 m_height;
+      u32 m_pitch;
+      FrameState m_state;
+      char m_path[FRAME_PATH_MAX_LENGTH];
+    };
+
+    /* Slots are filled in ring order and taken by writers in that
+       order, but writers can finish out of order, so a slot is only
+       freed once every one before it is DONE too. */
+    QueuedFrame m_frames[MAX_QUEUE_DEPTH];
+    u32 m_queueDepth;      // 0 to write each frame before DrawSurface returns
+    u32 m_queueHead;       // Oldest slot not yet FREE
+    u32 m_queueCount;      // Slots not FREE
+    u32 m_queueNext;       // Next QUEUED slot for a writer to take
+    u32 m_queueUnclaimed;  // QUEUED slots
+
+    Stats m_stats;
+
+    pthread_mutex_t m_lock;
+    pthread_cond_t m_frameQueued;
+    pthread_cond_t m_frameWritten;
+    pthread_t m_writerThreads[MAX_WRITERS];
+    u32 m_writerCount;     // Threads to start
+    u32 m_writersStarted;
+    bool m_writerExiting;
+
+    static void* WriterRunner(void* arg);
+
+    void StartWriter();
+
+    void StopWriter();
+
+    Camera(const Camera &); // Declare away
+    Camera & operator=(const Camera &); // Declare away
+
   public:
 
     Camera();
 
+    /**
+     * Writes out any frames still queued.
+     */
+    ~Camera();
+
     void ToggleRecord();
 
     bool IsRecording();
 
     void SetRecording(bool recording);
 
-    bool DrawSurface(SDL_Surface* sfc, const char * pngPath) const;
+    /**
+     * Write sfc as a PNG at pngPath, or queue it to be written, if the
+     * queue depth is above zero.  Returns false on failure; a queued
+     * frame reports problems writing it on stderr.
+     */
+    bool DrawSurface(SDL_Surface* sfc, const char * pngPath);
+
+    /**
+     * Buffer up to frames frames (at most MAX_QUEUE_DEPTH) for the
+     * background writer.  0 writes each frame synchronously.
+     */
+    void SetQueueDepth(u32 frames);
+
+    u32 GetQueueDepth() const
+    {
+      return m_queueDepth;
+    }
+
+    /**
+     * Encode and write queued frames on up to writers threads (at
+     * least 1, at most MAX_WRITERS).
+     */
+    void SetWriterCount(u32 writers);
+
+    u32 GetWriterCount() const
+    {
+      return m_writerCount;
+    }
+
+    /**
+     * Get a snapshot of the writer statistics since construction.
+     */
+    Stats GetStats();
+
+    /**
+     * Wait until every queued frame has been written.
+     */
+    void Flush();
   };
 }
 
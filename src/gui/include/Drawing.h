@@ -120,6 +120,16 @@ namespace MFM {
       return m_fontAsset;
     }
 
+    /**
+       Get the surface all drawing goes to, for writing pixels
+       directly.  Such writes must be clipped to GetWindow() by the
+       caller, and the surface locked if SDL_MUSTLOCK says so.
+     */
+    SDL_Surface * GetSurface() const
+    {
+      return m_dest;
+    }
+
     /**
        Fill the given rectangle with the given color, without changing
        the foreground color
@@ -69,7 +69,7 @@ namespace MFM
 
     typedef Grid<GC> OurGrid;
     typedef Tile<EC> OurTile;
-    typedef Site<AC> OurSite;
+    typedef typename EC::SITE OurSite;
     typedef TileRenderer<EC> OurTileRenderer;
     typedef GridTool<GC> OurGridTool;
     typedef AtomViewPanel<GC> OurAtomViewPanel;
@@ -609,6 +609,9 @@ namespace MFM
     void PaintTiles(Drawing & drawing)
     {
       GetTileRenderer().SetDrawBases(m_currentGridTool && m_currentGridTool->IsSiteEdit());
+      GetTileRenderer().ClearColorCache();
+      if (GetTileRenderer().GetPaintThreads() > 0)
+        PrepareTileBatch();  // So the loop below mostly just blits
       for (typename Grid<GC>::iterator_type i = m_mainGrid->begin(); i != m_mainGrid->end(); ++i)
       {
         SPoint tileCoord = i.At();
@@ -625,6 +628,43 @@ namespace MFM
       }
     }
 
+    /**
+       Snapshot every tile for painting while the grid runs.  The grid
+       must be paused.
+     */
+    void CaptureTiles()
+    {
+      GetTileRenderer().SetDrawBases(m_currentGridTool && m_currentGridTool->IsSiteEdit());
+      for (typename Grid<GC>::iterator_type i = m_mainGrid->begin(); i != m_mainGrid->end(); ++i)
+        GetTileRenderer().CaptureSnapshot(*i);
+    }
+
+    /**
+       Do as much of the next PaintTiles as the tile snapshots allow,
+       without drawing.  Safe while the grid runs.
+     */
+    void PrepareTiles()
+    {
+      if (!this->IsVisible()) return;
+      GetTileRenderer().ClearColorCache();
+      PrepareTileBatch();
+    }
+
+    /**
+       Bring every tile image up to date in one batch, so the
+       renderer's paint threads can share the work
+     */
+    void PrepareTileBatch()
+    {
+      GetTileRenderer().BeginTileBatch();
+      for (typename Grid<GC>::iterator_type i = m_mainGrid->begin(); i != m_mainGrid->end(); ++i)
+      {
+        Rect screenDitForTile = MapTileInGridToScreenDit(*i, i.At());
+        GetTileRenderer().PrepareTileAtDit(screenDitForTile.GetPosition(), *i);
+      }
+      GetTileRenderer().FinishTileBatch();
+    }
+
     void PaintAtomViewCallouts(Drawing & d, OurAtomViewPanel & avp)
     {
       if (!avp.IsVisible() || !avp.HasGridCoord()) return;
@@ -324,18 +324,36 @@ namespace MFM
     {
       u32 uradius = this->GetRadius();
       s32 radius = (s32) uradius;
-      for (s32 x = -radius; x <= radius; ++x)
-        for (s32 y = -radius; y <= radius; ++y)
+      for (s32 y = -radius; y <= radius; ++y)
+      {
+        // Hand over each row's runs of in-shape sites whole
+        s32 runStart = 0;
+        bool inRun = false;
+        for (s32 x = -radius; x <= radius + 1; ++x)
         {
-          const SPoint offset(x,y);
-
-          if (IsInShape(offset))
-          {
-            SPoint absolute = MakeSigned(gridCoord) + offset;
-            if (this->GetGrid().IsGridCoord(absolute))
-              UpdateGridCoord(MakeUnsigned(absolute));
-          }
+          const bool in = x <= radius && IsInShape(SPoint(x,y));
+          if (in && !inRun) runStart = x;
+          else if (!in && inRun)
+            UpdateGridSpan(MakeSigned(gridCoord) + SPoint(runStart, y), (u32) (x - runStart));
+          inRun = in;
         }
+      }
+    }
+
+    /**
+       Update the \c length sites starting at \c start and going
+       right, which may stray off the grid.  By default, just
+       UpdateGridCoord on each of them that is in the grid; tools
+       that treat every site alike can do the whole span at once.
+     */
+    virtual void UpdateGridSpan(SPoint start, u32 length)
+    {
+      for (u32 i = 0; i < length; ++i)
+      {
+        SPoint absolute = start + SPoint(i, 0);
+        if (this->GetGrid().IsGridCoord(absolute))
+          UpdateGridCoord(MakeUnsigned(absolute));
+      }
     }
 
     virtual void UpdateGridCoord(UPoint point) = 0;
@@ -66,6 +66,7 @@ namespace MFM
       Panel::SetName("HelpPanel");
       Panel::SetBackground(Drawing::DARK_PURPLE);
       Panel::SetForeground(Drawing::WHITE);
+      Panel::SetRetained(true);  // Static text; blit it
     }
 
     virtual ~HelpPanel() { } //avoid inline error
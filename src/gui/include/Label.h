@@ -235,6 +235,7 @@ namespace MFM
       MFM_API_ASSERT_NONNULL(text);
       m_text.Reset();
       m_text.Print(text);
+      Invalidate();
     }
 
     /**
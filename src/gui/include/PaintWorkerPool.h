@@ -0,0 +1,116 @@
+/*                                              -*- mode:C++ -*-
+  PaintWorkerPool.h Threads for painting independent pieces of a frame
+  Copyright (C) 2020 The Living Computation Foundation.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+  USA
+*/
+
+/**
+  \file PaintWorkerPool.h Threads for painting independent pieces of a frame
+  \author David H. Ackley.
+  \date (C) 2020 All rights reserved.
+  \lgpl
+ */
+#ifndef PAINTWORKERPOOL_H
+#define PAINTWORKERPOOL_H
+
+#include "itype.h"
+#include "Fail.h"
+#include <pthread.h>
+
+namespace MFM
+{
+  /**
+     A PaintWorkerPool keeps some threads waiting to help run a batch
+     of independent jobs, such as repainting separate tile images.
+     The thread calling Run() works too, as worker 0, and Run()
+     returns only when every job is done.  Jobs must not touch SDL
+     video, fonts, or anything else shared unless it is locked.
+   */
+  class PaintWorkerPool
+  {
+  public:
+    typedef void (* JobFunction)(void * arg, u32 worker, u32 job);
+
+    enum { MAX_THREADS = 32 };
+
+    PaintWorkerPool() ;
+
+    /**
+     * Stops and joins all the threads.
+     */
+    ~PaintWorkerPool() ;
+
+    /**
+     * Stop any current threads, and start \a threads new ones, at
+     * most MAX_THREADS.  With 0 threads, Run does everything itself.
+     */
+    void SetThreadCount(u32 threads) ;
+
+    u32 GetThreadCount() const
+    {
+      return m_threadCount;
+    }
+
+    /**
+     * Call \a fn(arg, worker, job) once for each job in 0..jobs-1,
+     * with \a worker from 0..GetThreadCount() saying which thread is
+     * calling.  Returns when all have returned.  Not reentrant.
+     */
+    void Run(JobFunction fn, void * arg, u32 jobs) ;
+
+  private:
+    struct Worker
+    {
+      PaintWorkerPool * m_pool;
+      u32 m_index;
+      pthread_t m_thread;
+      u32 m_generation;  // Of the last batch this thread ran
+      MFMErrorEnvironmentPointer_t m_errorStackTop;
+    };
+
+    Worker m_workers[MAX_THREADS];
+    u32 m_threadCount;
+
+    pthread_mutex_t m_lock;
+    pthread_cond_t m_workReady;
+    pthread_cond_t m_workDone;
+
+    JobFunction m_function;
+    void * m_arg;
+    u32 m_jobs;
+    u32 m_nextJob;
+    u32 m_busy;          // Threads still in the current batch
+    u32 m_generation;    // Bumped by each Run(), so threads see new work
+    bool m_exiting;
+
+    static void * WorkerRunner(void * arg) ;
+
+    /**
+     * Run jobs until none are left.  Called with m_lock held; returns
+     * with it held.
+     */
+    void RunJobs(u32 worker) ;
+
+    void StopThreads() ;
+
+    // Declare away; the threads are not copyable
+    PaintWorkerPool(const PaintWorkerPool &) ;
+    PaintWorkerPool & operator=(const PaintWorkerPool &) ;
+  };
+} /* namespace MFM */
+
+#endif /* PAINTWORKERPOOL_H */
@@ -191,6 +191,24 @@ namespace MFM
      */
     bool m_visible;
 
+    /**
+     * Retained mode (\sa SetRetained): m_backing holds this Panel's
+     * last full painting, children and all, which Paint just blits
+     * until m_dirty says it's stale.
+     */
+    bool m_retained;
+    bool m_dirty;
+    u32 m_retainedFrames;   // Blits since m_backing was last painted
+    SDL_Surface * m_backing;
+
+    /** Paint all of this Panel into \c drawing's current window */
+    void PaintContents(Drawing & drawing) ;
+
+    /** Repaint m_backing if need be, then blit it */
+    void PaintRetained(Drawing & drawing) ;
+
+    void FreeBacking() ;
+
     // A helper function to indent a line, that totally belongs elsewhere
     static void Indent(ByteSink& sink, u32 count) ;
 
@@ -246,9 +264,54 @@ namespace MFM
 
     void Remove(Panel* child) ;
 
-    void SetVisible(bool value){ m_visible = value; }
+    void SetVisible(bool value)
+    {
+      if (value != m_visible)
+      {
+        m_visible = value;
+        if (m_parent) m_parent->Invalidate();
+      }
+    }
     bool IsVisible() const { return m_visible; }
 
+    /**
+     * Even a retained Panel is repainted this often, in frames, in
+     * case something it shows changed without an Invalidate.
+     */
+    enum { RETAINED_REFRESH_FRAMES = 30 };
+
+    /**
+       Set whether this Panel paints in retained mode: painting itself
+       and its children once into a backing surface, and after that
+       just blitting the surface, until Invalidate -- or a resize, or
+       input it handles -- says it changed.  Worth it for panels that
+       are mostly static, like help text or a toolbox; panels that
+       change every frame should stay immediate, as they are by
+       default.
+     */
+    void SetRetained(bool retained)
+    {
+      m_retained = retained;
+      if (!retained) FreeBacking();
+      Invalidate();
+    }
+
+    bool IsRetained() const { return m_retained; }
+
+    /**
+       Note that this Panel looks different now, so that it, and any
+       retained ancestors, repaint next frame.
+     */
+    void Invalidate()
+    {
+      for (Panel * p = this; p; p = p->m_parent)
+      {
+        p->m_dirty = true;
+      }
+    }
+
+    bool IsDirty() const { return m_dirty; }
+
     /**
        Check if this window and all its ancestors up to the given \c
        panel are visible.  If \c panel is 0, check all ancestors of
@@ -350,6 +413,7 @@ namespace MFM
     {
       u32 old = m_bgColor;
       m_bgColor = color;
+      if (old != color) Invalidate();
       return old;
     }
 
@@ -368,6 +432,7 @@ namespace MFM
     {
       u32 old = m_bdColor;
       m_bdColor = color;
+      if (old != color) Invalidate();
       return old;
     }
 
@@ -386,6 +451,7 @@ namespace MFM
     {
       u32 old = m_fgColor;
       m_fgColor = color;
+      if (old != color) Invalidate();
       return old;
     }
 
@@ -401,7 +467,7 @@ namespace MFM
        panel.  If set, text drawing operations will use this font
        instead of the prevailing font (Drawing::GetFont()).
     */
-    void SetFontReal(TTF_Font * font) { m_ttfFont = font; }
+    void SetFontReal(TTF_Font * font) { m_ttfFont = font; Invalidate(); }
 
     FontAsset GetFont() const ;
 
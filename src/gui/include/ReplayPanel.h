@@ -55,7 +55,7 @@ namespace MFM
     typedef EventHistoryBuffer<EC> OurEventHistoryBuffer;
     typedef Tile<EC> OurTile;
 
-    typedef Site<AC> OurSite;
+    typedef typename EC::SITE OurSite;
 
     enum {
       R = EC::EVENT_WINDOW_RADIUS,
@@ -58,6 +58,7 @@ namespace MFM
       , m_displayVersionLine(1)
       , m_displayTimestampLine(1)
       , m_displayAEPS(1)
+      , m_displayElementProfile(5)
       , m_maxDisplayAER(5)
       , m_screenshotTargetFPS(-1)
         //      , m_registeredButtons(0)
@@ -297,6 +298,7 @@ namespace MFM
     u32 m_displayVersionLine;
     u32 m_displayTimestampLine;
     u32 m_displayAEPS;
+    u32 m_displayElementProfile; // Top element types by behavior time, when profiling
     u32 m_maxDisplayAER;
 
     OString64 m_runLabel;
@@ -411,6 +413,8 @@ namespace MFM
 
     void RenderGridStatistics(Drawing & drawing);
 
+    void RenderElementProfile(Drawing & drawing, u32 & baseY, u32 rowHeight);
+
   };
 } /* namespace MFM */
 
@@ -15,6 +15,7 @@ namespace MFM {
     sink.Printf(" PP(dvnl=%d)\n",m_displayVersionLine);
     sink.Printf(" PP(dtsl=%d)\n",m_displayTimestampLine);
     sink.Printf(" PP(daep=%d)\n",m_displayAEPS);
+    sink.Printf(" PP(dprf=%d)\n",m_displayElementProfile);
   }
 
   template <class GC>
@@ -24,6 +25,7 @@ namespace MFM {
     if (!strcmp("dvnl",key)) return 1 == source.Scanf("%?d", sizeof m_displayVersionLine, &m_displayVersionLine);
     if (!strcmp("dtsl",key)) return 1 == source.Scanf("%?d", sizeof m_displayTimestampLine, &m_displayTimestampLine);
     if (!strcmp("daep",key)) return 1 == source.Scanf("%?d", sizeof m_displayAEPS, &m_displayAEPS);
+    if (!strcmp("dprf",key)) return 1 == source.Scanf("%?d", sizeof m_displayElementProfile, &m_displayElementProfile);
     return false;
   }
 
@@ -212,6 +214,48 @@ namespace MFM {
         baseY += ROW_HEIGHT;
       }
     }
+
+    RenderElementProfile(drawing, baseY, ROW_HEIGHT);
+  }
+
+  template <class GC>
+  void StatisticsPanel<GC>::RenderElementProfile(Drawing & drawing, u32 & baseY, u32 rowHeight)
+  {
+    OurGrid& grid = this->GetDriver().GetGrid();
+    if (m_displayElementProfile == 0 || !grid.IsElementProfiling())
+    {
+      return;
+    }
+
+    ElementProfile profile;
+    grid.GetElementProfile(profile);
+
+    const u32 MAX_LINES = 16;
+    const ElementProfile::Entry * (top[MAX_LINES]);
+    const u32 count = profile.GetTopByTicks(top, MIN(MAX_LINES, m_displayElementProfile));
+    const u64 allTicks = profile.GetTotalTicks();
+    if (count == 0 || allTicks == 0)
+    {
+      return;
+    }
+
+    UPoint dims = this->GetDimensions();
+    baseY += rowHeight/3;
+    for (u32 i = 0; i < count; ++i)
+    {
+      const ElementProfile::Entry & e = *top[i];
+      const Element<EC> * elt = grid.LookupElement(e.m_type);
+      OString64 output;
+      output.Printf("%5.1f%% ", 100.0 * e.m_totalTicks / allTicks);
+      output.PrintAbbreviatedNumber(e.GetMeanTicks());
+      output.Printf("/call %s", elt ? elt->GetName() : "?");
+
+      drawing.SetForeground(Drawing::GREY80);
+      drawing.BlitText(output.GetZString(),
+                       SPoint(m_drawPoint.GetX(), baseY),
+                       UPoint(dims.GetX(), rowHeight));
+      baseY += rowHeight;
+    }
   }
 
 } /* namespace MFM */
@@ -33,6 +33,8 @@
 #include "Tile.h"
 #include "Site.h"
 #include "Drawing.h"
+#include "ElementColorCache.h"
+#include "PaintWorkerPool.h"
 #include "UlamContextEvent.h"
 
 namespace MFM
@@ -46,7 +48,7 @@ namespace MFM
     typedef typename AC::ATOM_TYPE T;
     typedef typename EC::SITE S;
     typedef Tile<EC> OurTile;
-    typedef Site<AC> OurSite;
+    typedef typename EC::SITE OurSite;
 
     enum { EWR = EC::EVENT_WINDOW_RADIUS };
 
@@ -111,13 +113,70 @@ namespace MFM
 
     TileRenderer();
 
+    ~TileRenderer();
+
     void PaintTileAtDit(Drawing & drawing,
                         const SPoint ditOrigin, OurTile & tile) ;
 
+    /**
+       Bring tile's image up to date, as the next PaintTileAtDit at
+       ditOrigin would, without drawing anything.  When painting from
+       snapshots this reads only the snapshot taken by
+       CaptureSnapshot, so it may run while the grid does; otherwise
+       the grid must be paused.  Does nothing if the image can't be
+       used.  Between BeginTileBatch and FinishTileBatch, the image is
+       just queued for FinishTileBatch to bring up to date.
+     */
+    void PrepareTileAtDit(const SPoint ditOrigin, const OurTile & tile) ;
+
+    /**
+       Queue the images of subsequent PrepareTileAtDit calls, instead
+       of preparing each on the spot.
+     */
+    void BeginTileBatch() ;
+
+    /**
+       Bring all the images queued since BeginTileBatch up to date --
+       across the paint threads, if there are any and no labels are
+       to be drawn, since each image is a separate surface.
+     */
+    void FinishTileBatch() ;
+
+    enum { MAX_PAINT_THREADS = PaintWorkerPool::MAX_THREADS };
+
+    /**
+       Use \a threads helper threads, plus the caller, in
+       FinishTileBatch.  0, the default, prepares everything in the
+       calling thread.
+     */
+    void SetPaintThreads(u32 threads) ;
+
+    u32 GetPaintThreads() const
+    {
+      return m_paintPool.GetThreadCount();
+    }
+
+    /**
+       Copy the sites of tile that have changed since its last
+       snapshot, for painting its image while the grid runs.  The
+       grid must be paused.  Does nothing if the current settings
+       don't use tile images.
+     */
+    void CaptureSnapshot(const OurTile & tile) ;
+
     void PaintSites(Drawing & drawing,
                     const DrawSiteType drawType, const DrawSiteShape shape,
                     const SPoint ditOrigin, const OurTile & tile) ;
 
+    /**
+       As PaintSites, but only for the sites in \c sites, given in
+       drawn-site coordinates -- i.e., relative to the first site
+       drawn, which is at \c ditOrigin.
+     */
+    void PaintSitesInRect(Drawing & drawing,
+                          const DrawSiteType drawType, const DrawSiteShape shape,
+                          const SPoint ditOrigin, const OurTile & tile, const Rect & sites) ;
+
     void PaintCustom(Drawing & drawing,
                      const SPoint ditOrigin, OurTile & tile) ;
 
@@ -129,6 +188,19 @@ namespace MFM
 
     void PaintBadAtomAtDit(Drawing & drawing, const SPoint ditOrigin) ;
 
+    /**
+       Paint the \c sites (in drawn-site coordinates, as for
+       PaintSitesInRect) with all three layers at once, by writing
+       each site's color straight into the drawing's surface, as if
+       every shape filled its site.  That's indistinguishable when
+       atoms are MAX_RASTER_ATOM_SIZE_DIT or smaller, and much
+       faster.  Returns false, having drawn nothing, if atoms are
+       larger or the surface isn't 32 bit.
+     */
+    bool RasterSitesInRect(Drawing & drawing, const SPoint ditOrigin,
+                           const OurTile & tile, const Rect & sites,
+                           const DrawSiteType backgroundType) ;
+
     void PaintUnderlays(Drawing & drawing, const SPoint ditOrigin, const Tile<EC> & tile) ;
 
     void PaintOverlays(Drawing & drawing, const SPoint ditOrigin, const OurTile & tile) ;
@@ -213,6 +285,73 @@ namespace MFM
       m_atomSizeDit = newdit;
     }
 
+    /**
+       When true (the default), PaintTileAtDit keeps a painted image
+       of each tile's sites, and each frame repaints only the blocks
+       of sites whose Tile change stamps have moved before blitting
+       the image.  Settings changes, such as zooming, repaint the
+       whole image; panning just blits it elsewhere.  Images are not
+       used while any layer draws site change ages or paint, which
+       change without changing the atoms.
+
+       Zoomed out to half a pixel per site or less, images are painted
+       from per-tile thumbnails instead: colors averaged over 2x2, 4x4
+       and 8x8 sites, kept up to date block by block like the images
+       themselves, so an overview costs about a pass over its pixels,
+       plus the changed sites, rather than one over every site.
+     */
+    bool IsCacheTileImages() const
+    {
+      return m_cacheTileImages;
+    }
+
+    void SetCacheTileImages(bool value)
+    {
+      m_cacheTileImages = value;
+      if (!value) FreeTileImages();
+    }
+
+    /**
+       When true, tile images are painted from the sites and change
+       stamps copied by the latest CaptureSnapshot, rather than from
+       the tiles themselves, so PrepareTileAtDit can run alongside the
+       grid.  Sites not painted through an image, and custom graphics
+       and overlays, are still painted from the tile.
+     */
+    bool IsPaintFromSnapshots() const
+    {
+      return m_paintFromSnapshots;
+    }
+
+    void SetPaintFromSnapshots(bool value)
+    {
+      m_paintFromSnapshots = value;
+    }
+
+    /**
+       Forget the atom colors remembered from earlier painting, so
+       changes such as lowlighting show.  Call once per frame.
+     */
+    void ClearColorCache()
+    {
+      m_colorCache.Clear();
+      for (u32 i = 0; i < m_painterCount; ++i)
+        m_painters[i]->ClearColorCache();
+    }
+
+    /**
+       Discard all tile images, so the next frame repaints everything.
+       Images are found by tile address, so this must be called if
+       tiles are ever reallocated.
+     */
+    void FreeTileImages() ;
+
+    /**
+       Add the tile images' surfaces, change stamps and snapshots to
+       \c account, as MemoryAccount::SURFACES
+     */
+    void AccountMemory(MemoryAccount & account) const ;
+
   private:
 
     void CallRenderGraphics(UlamContextEvent<EC> & uce,
@@ -221,12 +360,270 @@ namespace MFM
                             OurTile & tile) ;
 
 
+    /**
+       The settings a tile image was painted under.  If any differ
+       now, the whole image must be repainted.
+     */
+    struct TileImageKey
+    {
+      u32 m_atomSizeDit;
+      s32 m_drawLabels;
+      DrawSiteType m_backgroundType;
+      DrawSiteType m_midgroundType;
+      DrawSiteType m_foregroundType;
+      bool m_drawCacheSites;
+      SPoint m_subpixelDit;       // Where in its pixel the tile starts
+
+      bool operator==(const TileImageKey & other) const
+      {
+        return
+          m_atomSizeDit == other.m_atomSizeDit &&
+          m_subpixelDit == other.m_subpixelDit &&
+          m_drawLabels == other.m_drawLabels &&
+          m_backgroundType == other.m_backgroundType &&
+          m_midgroundType == other.m_midgroundType &&
+          m_foregroundType == other.m_foregroundType &&
+          m_drawCacheSites == other.m_drawCacheSites;
+      }
+    };
+
+    /**
+       The settings a tile's thumbnails were built under.  Zooming
+       doesn't change them, so they outlive the images painted from
+       them.
+     */
+    struct ThumbnailKey
+    {
+      DrawSiteType m_backgroundType;
+      DrawSiteType m_midgroundType;
+      DrawSiteType m_foregroundType;
+      bool m_drawCacheSites;
+
+      bool operator==(const ThumbnailKey & other) const
+      {
+        return
+          m_backgroundType == other.m_backgroundType &&
+          m_midgroundType == other.m_midgroundType &&
+          m_foregroundType == other.m_foregroundType &&
+          m_drawCacheSites == other.m_drawCacheSites;
+      }
+    };
+
+    /**
+       The painted sites of one tile, with the Tile change stamps
+       they were painted at, the tile's thumbnails, and its latest
+       snapshot.
+     */
+    struct TileImage
+    {
+      const OurTile * m_tile;   // 0 if the slot is unused
+      SDL_Surface * m_surface;
+      u32 * m_blockStamps;      // m_tile->GetChangeBlockCount() of them
+      u32 m_tileStamp;
+      TileImageKey m_key;
+      bool m_repaintAll;        // Surface or key changed since last painted
+      bool m_batched;           // Queued in the current tile batch
+
+      u32 * m_thumbnails;       // Levels 1..THUMBNAIL_LEVELS, or 0 if none built
+      u32 * m_thumbnailStamps;  // Block stamps the thumbnails were built at
+      u32 m_thumbnailTileStamp;
+      ThumbnailKey m_thumbnailKey;
+
+      S * m_snapshotSites;      // All the tile's sites, or 0 if none captured
+      u32 * m_snapshotStamps;   // Block stamps as of the capture
+      u32 m_snapshotTileStamp;
+    };
+
+    enum {
+      TILE_IMAGE_SLOT_BITS = 8,
+      TILE_IMAGE_SLOTS = 1<<TILE_IMAGE_SLOT_BITS,
+      TILE_IMAGE_SLOT_MASK = TILE_IMAGE_SLOTS-1,
+
+      /** Larger tiles, at high zoom, are painted directly */
+      MAX_TILE_IMAGE_PIXELS = 1<<20,
+
+      /** Where no layer paints, so the panel behind shows through.
+          A zero alpha byte keeps it distinct from all opaque colors */
+      TILE_IMAGE_CLEAR_COLOR = 0x00010203,
+
+      /** Thumbnail level L averages 2**L x 2**L sites per texel */
+      THUMBNAIL_LEVELS = 3,
+      THUMBNAIL_ALIGN = 1<<THUMBNAIL_LEVELS
+    };
+
+    enum { MAX_RASTER_ATOM_SIZE_DIT = 2 * Drawing::DIT_PER_PIX };
+
+    /**
+       Element lookups by type, for the duration of one
+       RasterSitesInRect.  Direct mapped; a miss just looks again.
+     */
+    struct RasterElementCache
+    {
+      enum {
+        SLOT_BITS = 6,
+        SLOT_COUNT = 1<<SLOT_BITS,
+        SLOT_MASK = SLOT_COUNT-1
+      };
+
+      RasterElementCache()
+      {
+        for (u32 i = 0; i < SLOT_COUNT; ++i) m_types[i] = U32_MAX;
+      }
+
+      const Element<EC> * Lookup(const OurTile & tile, u32 type)
+      {
+        const u32 slot = type & SLOT_MASK;
+        if (m_types[slot] != type)
+        {
+          m_types[slot] = type;
+          m_elements[slot] = tile.GetElementTable().Lookup(type);
+        }
+        return m_elements[slot];
+      }
+
+      u32 m_types[SLOT_COUNT];
+      const Element<EC> * m_elements[SLOT_COUNT];
+    };
+
+    /**
+       The color drawType would paint the site at siteInTile, in
+       tile coordinates, with.  Returns false if it paints nothing
+       there.
+     */
+    bool GetRasterColor(const DrawSiteType drawType, const OurTile & tile,
+                        const SPoint siteInTile, RasterElementCache & elements,
+                        u32 & color) ;
+
+    static u32 GetChangeAgeColor(const OurSite & site) ;
+
+    static bool IsImageableType(DrawSiteType t)
+    {
+      return t != DRAW_SITE_CHANGE_AGE && t != DRAW_SITE_PAINT;
+    }
+
+    /**
+       Find the image slot for tile, claiming an unused one if it has
+       none.  Returns 0 if every slot is taken by other tiles.
+     */
+    TileImage * FindTileImage(const OurTile & tile) ;
+
+    /**
+       Bring tile's image up to date and blit it at ditOrigin.
+       Returns false, having drawn nothing, if the image can't be used
+       with the current settings.
+     */
+    bool PaintTileImage(Drawing & drawing, const SPoint ditOrigin,
+                        const OurTile & tile, const DrawSiteType backgroundType) ;
+
+    /**
+       Find tile's image and size its surface for the current
+       settings, noting if it must be wholly repainted.  Returns 0 if
+       the image can't be used.  Main thread only.
+     */
+    TileImage * ReadyTileImage(const SPoint ditOrigin, const OurTile & tile,
+                               const DrawSiteType backgroundType) ;
+
+    /**
+       Repaint whatever parts of a readied image have changed.
+       Touches only image and this renderer, so painters can run this
+       on separate images at once.
+     */
+    void RefreshTileImage(TileImage & image, const FontAsset font, const OurTile & tile) ;
+
+    /**
+       The thumbnail level to paint images from at the current zoom,
+       or 0 to paint them from the sites
+     */
+    u32 GetThumbnailLevel() const
+    {
+      u32 level = 0;
+      while (level < THUMBNAIL_LEVELS && (m_atomSizeDit << (level + 1)) <= Drawing::DIT_PER_PIX)
+        ++level;
+      return level;
+    }
+
+    /** Texels across \c sites sites at thumbnail \c level */
+    static u32 GetThumbnailSide(u32 sites, u32 level)
+    {
+      return (sites + (1u << level) - 1) >> level;
+    }
+
+    /** Where thumbnail \c level of a drawnWidth x drawnHeight tile starts */
+    static u32 GetThumbnailOffset(u32 drawnWidth, u32 drawnHeight, u32 level)
+    {
+      u32 offset = 0;
+      for (u32 l = 1; l < level; ++l)
+        offset += GetThumbnailSide(drawnWidth, l) * GetThumbnailSide(drawnHeight, l);
+      return offset;
+    }
+
+    /**
+       Rebuild image's thumbnails wherever the tile's blocks have
+       changed since they were built, or everywhere if the layer
+       settings have.  Like RefreshTileImage, touches only image and
+       this renderer.
+     */
+    void RefreshThumbnails(TileImage & image, const OurTile & tile) ;
+
+    /**
+       Rebuild every thumbnail level over \c sites, in drawn
+       coordinates, which must start at multiples of THUMBNAIL_ALIGN
+     */
+    void BuildThumbnailRect(TileImage & image, const OurTile & tile, const Rect & sites) ;
+
+    /**
+       Like RasterSitesInRect, but painting each texel of thumbnail \c
+       level over the sites it covers
+     */
+    bool RasterThumbnailInRect(Drawing & drawing, const SPoint ditOrigin,
+                               const TileImage & image, const OurTile & tile,
+                               u32 level, const Rect & sites) ;
+
+    /** A PaintWorkerPool::JobFunction refreshing batch image \a job */
+    static void RefreshBatchJob(void * arg, u32 worker, u32 job) ;
+
+    /** Take on the settings that affect how tile images are painted */
+    void CopyPaintSettings(const TileRenderer & other) ;
+
+    bool IsDrawLabels() const
+    {
+      const u32 LABEL_ATOM_SIZE_DIT = Drawing::MapPixToDit(25);
+      return m_drawLabels > 0 || (m_drawLabels < 0 && m_atomSizeDit >= LABEL_ATOM_SIZE_DIT);
+    }
+
+    /** Can the current settings paint sites through tile images? */
+    bool UsesTileImages(const DrawSiteType backgroundType) const
+    {
+      return m_cacheTileImages && !m_drawEventWindow &&
+        IsImageableType(backgroundType) &&
+        IsImageableType(m_drawMidgroundType) &&
+        IsImageableType(m_drawForegroundType);
+    }
+
+    /**
+       The site at siteInTile, in tile coordinates, as it is to be
+       painted: from the snapshot while an image is being repainted
+       from one, otherwise live from tile.
+     */
+    const S & GetPaintSite(const OurTile & tile, const SPoint siteInTile) const
+    {
+      if (!m_paintSnapshot) return tile.GetSite(siteInTile);
+      return m_paintSnapshot->m_snapshotSites[tile.GetSiteInTileNumber(siteInTile)];
+    }
+
+    /**
+       Repaint the pixels of image covering the drawn sites in
+       \c block, plus any overhang from the sites around it
+     */
+    void RepaintTileImageBlock(TileImage & image, const FontAsset font,
+                               const OurTile & tile, const Rect & block) ;
+
     static bool IsDrawBase(DrawSiteType t)
     {
       return t >= DRAW_SITE_BASE && t <= DRAW_SITE_BASE_2;
     }
 
-    bool IsBaseVisible()
+    bool IsBaseVisible() const
     {
       return
         IsDrawBase(m_drawBackgroundType) ||
@@ -234,6 +631,12 @@ namespace MFM
         IsDrawBase(m_drawForegroundType);
     }
 
+    /** The background layer to draw, allowing for m_drawBases */
+    DrawSiteType GetEffectiveBackgroundType() const
+    {
+      return (m_drawBases && !IsBaseVisible()) ? DRAW_SITE_BASE : m_drawBackgroundType;
+    }
+
     DrawSiteType m_drawBackgroundType;
     DrawSiteType m_drawMidgroundType;
     DrawSiteType m_drawForegroundType;
@@ -256,6 +659,29 @@ namespace MFM
 
     u32 m_regionColors[Tile<EC>::REGION_COUNT];
 
+    bool m_cacheTileImages;
+
+    bool m_paintFromSnapshots;
+
+    const TileImage * m_paintSnapshot; // Where GetPaintSite reads, if not 0
+
+    TileImage m_tileImages[TILE_IMAGE_SLOTS];
+
+    ElementColorCache<EC> m_colorCache;
+
+    bool m_batching;
+    u32 m_batchCount;
+    TileImage * m_batch[TILE_IMAGE_SLOTS];
+
+    PaintWorkerPool m_paintPool;
+    u32 m_painterCount;
+    TileRenderer * m_painters[MAX_PAINT_THREADS + 1]; // One per pool worker
+
+    bool m_paintWorker;  // A painter, refreshing images off the main thread
+
+    TileRenderer(const TileRenderer &); // Declare away
+    TileRenderer & operator=(const TileRenderer &); // Declare away
+
     /* XXX
     u32 m_selectedHiddenColor;
     u32 m_selectedPausedColor;
@@ -19,13 +19,605 @@ namespace MFM
     , m_drawLabels(-1)
     , m_atomSizeDit(DEFAULT_ATOM_SIZE_DIT)
     , m_gridLineColor(Drawing::GREY30)
+    , m_cacheTileImages(true)
+    , m_paintFromSnapshots(false)
+    , m_paintSnapshot(0)
+    , m_batching(false)
+    , m_batchCount(0)
+    , m_painterCount(0)
+    , m_paintWorker(false)
   {
+    for (u32 i = 0; i < TILE_IMAGE_SLOTS; ++i)
+    {
+      m_tileImages[i].m_tile = 0;
+      m_tileImages[i].m_surface = 0;
+      m_tileImages[i].m_blockStamps = 0;
+      m_tileImages[i].m_thumbnails = 0;
+      m_tileImages[i].m_thumbnailStamps = 0;
+      m_tileImages[i].m_snapshotSites = 0;
+      m_tileImages[i].m_snapshotStamps = 0;
+    }
     m_regionColors[OurTile::REGION_CACHE] = InterpolateColors(Drawing::WHITE, Drawing::DARK_PURPLE, 100);
     m_regionColors[OurTile::REGION_SHARED] = InterpolateColors(Drawing::WHITE, Drawing::DARK_PURPLE, 92);
     m_regionColors[OurTile::REGION_VISIBLE] = InterpolateColors(Drawing::WHITE, Drawing::DARK_PURPLE, 84);
     m_regionColors[OurTile::REGION_HIDDEN] = InterpolateColors(Drawing::WHITE, Drawing::DARK_PURPLE, 76);
   }
 
+  template <class EC>
+  TileRenderer<EC>::~TileRenderer()
+  {
+    SetPaintThreads(0);
+    FreeTileImages();
+  }
+
+  template <class EC>
+  void TileRenderer<EC>::FreeTileImages()
+  {
+    for (u32 i = 0; i < TILE_IMAGE_SLOTS; ++i)
+    {
+      TileImage & ti = m_tileImages[i];
+      if (ti.m_surface) SDL_FreeSurface(ti.m_surface);
+      delete [] ti.m_blockStamps;
+      delete [] ti.m_thumbnails;
+      delete [] ti.m_thumbnailStamps;
+      delete [] ti.m_snapshotSites;
+      delete [] ti.m_snapshotStamps;
+      ti.m_tile = 0;
+      ti.m_surface = 0;
+      ti.m_blockStamps = 0;
+      ti.m_thumbnails = 0;
+      ti.m_thumbnailStamps = 0;
+      ti.m_snapshotSites = 0;
+      ti.m_snapshotStamps = 0;
+    }
+  }
+
+  template <class EC>
+  void TileRenderer<EC>::AccountMemory(MemoryAccount & account) const
+  {
+    u64 bytes = 0;
+    for (u32 i = 0; i < TILE_IMAGE_SLOTS; ++i)
+    {
+      const TileImage & ti = m_tileImages[i];
+      if (!ti.m_tile) continue;
+      const u64 blocks = ti.m_tile->GetChangeBlockCount();
+      bytes += blocks * sizeof(u32);
+      if (ti.m_surface)
+        bytes += (u64) ti.m_surface->pitch * ti.m_surface->h;
+      if (ti.m_thumbnails)
+        bytes += (u64) GetThumbnailOffset(ti.m_tile->TILE_WIDTH, ti.m_tile->TILE_HEIGHT,
+                                          THUMBNAIL_LEVELS + 1) * sizeof(u32) + blocks * sizeof(u32);
+      if (ti.m_snapshotSites)
+        bytes += (u64) ti.m_tile->TILE_WIDTH * ti.m_tile->TILE_HEIGHT * sizeof(S) + blocks * sizeof(u32);
+    }
+    account.Add(MemoryAccount::SURFACES, bytes);
+  }
+
+  template <class EC>
+  typename TileRenderer<EC>::TileImage * TileRenderer<EC>::FindTileImage(const Tile<EC> & tile)
+  {
+    u32 slot = (((u32) (((uptr) &tile) >> 4)) * 2654435761u) >> (32 - TILE_IMAGE_SLOT_BITS);
+    for (u32 probes = 0; probes < TILE_IMAGE_SLOTS; ++probes, slot = (slot + 1) & TILE_IMAGE_SLOT_MASK)
+    {
+      TileImage & ti = m_tileImages[slot];
+      if (ti.m_tile == &tile) return &ti;
+      if (ti.m_tile == 0)
+      {
+        ti.m_tile = &tile;
+        ti.m_surface = 0;
+        ti.m_blockStamps = new u32[tile.GetChangeBlockCount()];
+        ti.m_tileStamp = 0;
+        ti.m_repaintAll = true;
+        ti.m_batched = false;
+        ti.m_thumbnails = 0;
+        ti.m_thumbnailStamps = 0;
+        ti.m_snapshotSites = 0;
+        ti.m_snapshotStamps = 0;
+        return &ti;
+      }
+    }
+    return 0;
+  }
+
+  template <class EC>
+  void TileRenderer<EC>::CaptureSnapshot(const Tile<EC> & tile)
+  {
+    if (!UsesTileImages(GetEffectiveBackgroundType())) return;
+
+    TileImage * image = FindTileImage(tile);
+    if (!image) return;
+
+    const u32 blockCount = tile.GetChangeBlockCount();
+    const u32 tileStamp = tile.GetChangeStamp();
+    const bool copyAll = !image->m_snapshotSites || image->m_snapshotTileStamp != tileStamp;
+    if (!image->m_snapshotSites)
+    {
+      image->m_snapshotSites = new S[tile.TILE_WIDTH * tile.TILE_HEIGHT];
+      image->m_snapshotStamps = new u32[blockCount];
+    }
+    image->m_snapshotTileStamp = tileStamp;
+
+    const u32 blocksWide = tile.GetChangeBlocksWide();
+    const u32 side = OurTile::CHANGE_BLOCK_SIDE;
+    for (u32 b = 0; b < blockCount; ++b)
+    {
+      const u32 stamp = tile.GetChangeBlockStamp(b);
+      if (!copyAll && stamp == image->m_snapshotStamps[b]) continue;
+      image->m_snapshotStamps[b] = stamp;
+
+      const u32 x0 = (b % blocksWide) * side;
+      const u32 y0 = (b / blocksWide) * side;
+      const u32 x1 = MIN(x0 + side, tile.TILE_WIDTH);
+      const u32 y1 = MIN(y0 + side, tile.TILE_HEIGHT);
+      for (u32 y = y0; y < y1; ++y)
+        for (u32 x = x0; x < x1; ++x)
+          image->m_snapshotSites[y * tile.TILE_WIDTH + x] = tile.GetSite(SPoint(x, y));
+    }
+  }
+
+  template <class EC>
+  void TileRenderer<EC>::PrepareTileAtDit(const SPoint ditOrigin, const Tile<EC> & tile)
+  {
+    m_paintSnapshot = 0;
+    if (!tile.IsEnabled()) return;
+    unwind_protect({
+        m_paintSnapshot = 0;
+        LOG.Warning("Failure while preparing tile image");
+    },{
+        TileImage * image = ReadyTileImage(ditOrigin, tile, GetEffectiveBackgroundType());
+        if (image && m_batching)
+        {
+          if (!image->m_batched && m_batchCount < TILE_IMAGE_SLOTS)
+          {
+            image->m_batched = true;
+            m_batch[m_batchCount++] = image;
+          }
+        }
+        else if (image)
+          RefreshTileImage(*image, FONT_ASSET_ELEMENT, tile);
+    });
+  }
+
+  template <class EC>
+  void TileRenderer<EC>::BeginTileBatch()
+  {
+    m_batching = true;
+    m_batchCount = 0;
+  }
+
+  template <class EC>
+  void TileRenderer<EC>::FinishTileBatch()
+  {
+    m_batching = false;
+    if (m_batchCount == 0) return;
+
+    if (m_painterCount > 1 && !IsDrawLabels())
+    {
+      for (u32 i = 0; i < m_painterCount; ++i)
+        m_painters[i]->CopyPaintSettings(*this);
+      m_paintPool.Run(RefreshBatchJob, this, m_batchCount);
+    }
+    else
+    {
+      for (u32 i = 0; i < m_batchCount; ++i)
+        RefreshBatchJob(this, U32_MAX, i);
+    }
+
+    for (u32 i = 0; i < m_batchCount; ++i)
+      m_batch[i]->m_batched = false;
+    m_batchCount = 0;
+  }
+
+  template <class EC>
+  void TileRenderer<EC>::RefreshBatchJob(void * arg, u32 worker, u32 job)
+  {
+    TileRenderer & tr = *(TileRenderer *) arg;
+    TileRenderer & painter = worker == U32_MAX ? tr : *tr.m_painters[worker];
+    TileImage & image = *tr.m_batch[job];
+    unwind_protect({
+        painter.m_paintSnapshot = 0;
+        LOG.Warning("Failure while painting tile image");
+    },{
+        painter.RefreshTileImage(image, FONT_ASSET_ELEMENT, *image.m_tile);
+    });
+  }
+
+  template <class EC>
+  void TileRenderer<EC>::SetPaintThreads(u32 threads)
+  {
+    MFM_API_ASSERT_ARG(threads <= MAX_PAINT_THREADS);
+    m_paintPool.SetThreadCount(threads);
+    for (u32 i = 0; i < m_painterCount; ++i)
+      delete m_painters[i];
+    m_painterCount = 0;
+    if (threads == 0) return;
+
+    // One painter for each pool thread, plus one for the caller
+    m_painterCount = m_paintPool.GetThreadCount() + 1;
+    for (u32 i = 0; i < m_painterCount; ++i)
+    {
+      m_painters[i] = new TileRenderer();
+      m_painters[i]->m_paintWorker = true;
+    }
+  }
+
+  template <class EC>
+  void TileRenderer<EC>::CopyPaintSettings(const TileRenderer & other)
+  {
+    m_drawBackgroundType = other.m_drawBackgroundType;
+    m_drawMidgroundType = other.m_drawMidgroundType;
+    m_drawForegroundType = other.m_drawForegroundType;
+    m_drawEventWindow = other.m_drawEventWindow;
+    m_drawCacheSites = other.m_drawCacheSites;
+    m_drawBases = other.m_drawBases;
+    m_drawLabels = other.m_drawLabels;
+    m_atomSizeDit = other.m_atomSizeDit;
+    m_paintFromSnapshots = other.m_paintFromSnapshots;
+    for (u32 i = 0; i < OurTile::REGION_COUNT; ++i)
+      m_regionColors[i] = other.m_regionColors[i];
+  }
+
+  template <class EC>
+  bool TileRenderer<EC>::PaintTileImage(Drawing & drawing, const SPoint ditOrigin,
+                                        const Tile<EC> & tile, const DrawSiteType backgroundType)
+  {
+    TileImage * image = ReadyTileImage(ditOrigin, tile, backgroundType);
+    if (!image) return false;
+    RefreshTileImage(*image, drawing.GetFont(), tile);
+
+    const s32 PIX = (s32) Drawing::DIT_PER_PIX;
+    const SPoint blitPix = (ditOrigin - image->m_key.m_subpixelDit) / PIX;
+    drawing.BlitImage(image->m_surface, blitPix,
+                      UPoint(image->m_surface->w, image->m_surface->h));
+    return true;
+  }
+
+  template <class EC>
+  typename TileRenderer<EC>::TileImage *
+  TileRenderer<EC>::ReadyTileImage(const SPoint ditOrigin, const Tile<EC> & tile,
+                                   const DrawSiteType backgroundType)
+  {
+    if (!UsesTileImages(backgroundType)) return 0;
+
+    const u32 indent = m_drawCacheSites ? 0 : EWR;
+    const u32 drawnWidth = tile.TILE_WIDTH - 2 * indent;
+    const u32 drawnHeight = tile.TILE_HEIGHT - 2 * indent;
+    // Paint the image offset by the fraction of a pixel the tile
+    // starts at, so its sites round to the same pixels that painting
+    // directly would give them
+    const s32 PIX = (s32) Drawing::DIT_PER_PIX;
+    const SPoint subpixelDit(((ditOrigin.GetX() % PIX) + PIX) % PIX,
+                             ((ditOrigin.GetY() % PIX) + PIX) % PIX);
+    const u32 widthPix = Drawing::MapDitToPix(subpixelDit.GetX() + drawnWidth * m_atomSizeDit);
+    const u32 heightPix = Drawing::MapDitToPix(subpixelDit.GetY() + drawnHeight * m_atomSizeDit);
+    if (widthPix == 0 || heightPix == 0 || widthPix > MAX_TILE_IMAGE_PIXELS / heightPix)
+      return 0;
+
+    TileImage * image = FindTileImage(tile);
+    if (!image) return 0;
+
+    if (m_paintFromSnapshots && !image->m_snapshotSites) return 0;
+
+    TileImageKey key;
+    key.m_atomSizeDit = m_atomSizeDit;
+    key.m_drawLabels = m_drawLabels;
+    key.m_backgroundType = backgroundType;
+    key.m_midgroundType = m_drawMidgroundType;
+    key.m_foregroundType = m_drawForegroundType;
+    key.m_drawCacheSites = m_drawCacheSites;
+    key.m_subpixelDit = subpixelDit;
+
+    if (!(image->m_key == key)) image->m_repaintAll = true;
+
+    if (image->m_surface &&
+        ((u32) image->m_surface->w != widthPix || (u32) image->m_surface->h != heightPix))
+    {
+      SDL_FreeSurface(image->m_surface);
+      image->m_surface = 0;
+    }
+    if (!image->m_surface)
+    {
+      image->m_surface =
+        SDL_CreateRGBSurface(SDL_SWSURFACE, widthPix, heightPix, 32,
+                             0x00ff0000, 0x0000ff00, 0x000000ff, 0);
+      if (!image->m_surface) return 0;
+      SDL_SetColorKey(image->m_surface, SDL_SRCCOLORKEY, TILE_IMAGE_CLEAR_COLOR);
+      image->m_repaintAll = true;
+    }
+    image->m_key = key;
+    return image;
+  }
+
+  template <class EC>
+  void TileRenderer<EC>::RefreshTileImage(TileImage & ti, const FontAsset font, const Tile<EC> & tile)
+  {
+    TileImage * image = &ti;
+
+    // From a snapshot, its stamps say what it holds.  Otherwise read
+    // the stamps before painting, so any change made while we paint
+    // gets repainted next time
+    const TileImage * snapshot = m_paintFromSnapshots ? image : 0;
+    const u32 tileStamp = snapshot ? snapshot->m_snapshotTileStamp : tile.GetChangeStamp();
+    const bool repaintAll = image->m_repaintAll || image->m_tileStamp != tileStamp;
+    image->m_repaintAll = false;
+    image->m_tileStamp = tileStamp;
+
+    const u32 indent = image->m_key.m_drawCacheSites ? 0 : EWR;
+    const u32 drawnWidth = tile.TILE_WIDTH - 2 * indent;
+    const u32 drawnHeight = tile.TILE_HEIGHT - 2 * indent;
+
+    m_paintSnapshot = snapshot;
+    if (GetThumbnailLevel() > 0)
+      RefreshThumbnails(*image, tile);
+
+    const u32 blocksWide = tile.GetChangeBlocksWide();
+    const u32 blockCount = tile.GetChangeBlockCount();
+    if (repaintAll)
+    {
+      for (u32 b = 0; b < blockCount; ++b)
+        image->m_blockStamps[b] =
+          snapshot ? snapshot->m_snapshotStamps[b] : tile.GetChangeBlockStamp(b);
+      RepaintTileImageBlock(*image, font, tile, Rect(0, 0, drawnWidth, drawnHeight));
+    }
+    else
+    {
+      const s32 side = OurTile::CHANGE_BLOCK_SIDE;
+      for (u32 b = 0; b < blockCount; ++b)
+      {
+        const u32 stamp =
+          snapshot ? snapshot->m_snapshotStamps[b] : tile.GetChangeBlockStamp(b);
+        if (stamp == image->m_blockStamps[b]) continue;
+        image->m_blockStamps[b] = stamp;
+
+        // Blocks are in tile coordinates; clip to the drawn sites
+        const s32 bx = (s32) (b % blocksWide) * side - (s32) indent;
+        const s32 by = (s32) (b / blocksWide) * side - (s32) indent;
+        const s32 x0 = MAX(bx, 0);
+        const s32 y0 = MAX(by, 0);
+        const s32 x1 = MIN(bx + side, (s32) drawnWidth);
+        const s32 y1 = MIN(by + side, (s32) drawnHeight);
+        if (x0 >= x1 || y0 >= y1) continue;
+        RepaintTileImageBlock(*image, font, tile, Rect(x0, y0, x1 - x0, y1 - y0));
+      }
+    }
+    m_paintSnapshot = 0;
+  }
+
+  template <class EC>
+  void TileRenderer<EC>::RepaintTileImageBlock(TileImage & image, const FontAsset font,
+                                               const Tile<EC> & tile, const Rect & block)
+  {
+    const s32 atomDit = (s32) m_atomSizeDit;
+    const SPoint subpixelDit = image.m_key.m_subpixelDit;
+    const SPoint ulPix = Drawing::MapDitToPix(subpixelDit + block.GetPosition() * atomDit);
+    const SPoint lrPix = Drawing::MapDitToPix(subpixelDit + (block.GetPosition() + MakeSigned(block.GetSize())) * atomDit);
+
+    Drawing id(image.m_surface, font);
+    id.TransformWindow(Rect(ulPix, MakeUnsigned(lrPix - ulPix)));
+    id.FillRect(0, 0, lrPix.GetX() - ulPix.GetX(), lrPix.GetY() - ulPix.GetY(), TILE_IMAGE_CLEAR_COLOR);
+
+    // At fractional zooms sites can overhang their neighbors by a
+    // pixel, so repaint the ring of sites around the block too.  The
+    // window clips them to the block.
+    const u32 indent = image.m_key.m_drawCacheSites ? 0 : EWR;
+    const s32 drawnWidth = (s32) (tile.TILE_WIDTH - 2 * indent);
+    const s32 drawnHeight = (s32) (tile.TILE_HEIGHT - 2 * indent);
+    const s32 x0 = MAX(block.GetX() - 1, 0);
+    const s32 y0 = MAX(block.GetY() - 1, 0);
+    const s32 x1 = MIN(block.GetX() + (s32) block.GetWidth() + 1, drawnWidth);
+    const s32 y1 = MIN(block.GetY() + (s32) block.GetHeight() + 1, drawnHeight);
+    const Rect sites(x0, y0, x1 - x0, y1 - y0);
+
+    // Offset by whole pixels, so sites land exactly where a
+    // whole-image paint would put them
+    const SPoint ditOrigin = subpixelDit - Drawing::MapPixToDit(ulPix);
+
+    const u32 level = GetThumbnailLevel();
+    if (level > 0 && RasterThumbnailInRect(id, ditOrigin, image, tile, level, sites))
+      return;
+
+    if (RasterSitesInRect(id, ditOrigin, tile, sites, image.m_key.m_backgroundType))
+      return;
+
+    PaintSitesInRect(id, image.m_key.m_backgroundType, DRAW_SHAPE_FILL, ditOrigin, tile, sites);
+    PaintSitesInRect(id, image.m_key.m_midgroundType, DRAW_SHAPE_CIRCLE, ditOrigin, tile, sites);
+    PaintSitesInRect(id, image.m_key.m_foregroundType, DRAW_SHAPE_CDOT, ditOrigin, tile, sites);
+  }
+
+  template <class EC>
+  void TileRenderer<EC>::RefreshThumbnails(TileImage & image, const Tile<EC> & tile)
+  {
+    const TileImage * snapshot = m_paintSnapshot;
+    const u32 tileStamp = snapshot ? snapshot->m_snapshotTileStamp : tile.GetChangeStamp();
+
+    ThumbnailKey key;
+    key.m_backgroundType = image.m_key.m_backgroundType;
+    key.m_midgroundType = image.m_key.m_midgroundType;
+    key.m_foregroundType = image.m_key.m_foregroundType;
+    key.m_drawCacheSites = image.m_key.m_drawCacheSites;
+
+    const u32 blockCount = tile.GetChangeBlockCount();
+    const bool rebuildAll = !image.m_thumbnails ||
+      !(image.m_thumbnailKey == key) || image.m_thumbnailTileStamp != tileStamp;
+    if (!image.m_thumbnails)
+    {
+      // Sized for drawing the cache sites too, the larger case
+      image.m_thumbnails =
+        new u32[GetThumbnailOffset(tile.TILE_WIDTH, tile.TILE_HEIGHT, THUMBNAIL_LEVELS + 1)];
+      image.m_thumbnailStamps = new u32[blockCount];
+    }
+    image.m_thumbnailKey = key;
+    image.m_thumbnailTileStamp = tileStamp;
+
+    const u32 indent = key.m_drawCacheSites ? 0 : EWR;
+    const s32 drawnWidth = (s32) (tile.TILE_WIDTH - 2 * indent);
+    const s32 drawnHeight = (s32) (tile.TILE_HEIGHT - 2 * indent);
+    if (rebuildAll)
+    {
+      for (u32 b = 0; b < blockCount; ++b)
+        image.m_thumbnailStamps[b] =
+          snapshot ? snapshot->m_snapshotStamps[b] : tile.GetChangeBlockStamp(b);
+      BuildThumbnailRect(image, tile, Rect(0, 0, drawnWidth, drawnHeight));
+      return;
+    }
+
+    const u32 blocksWide = tile.GetChangeBlocksWide();
+    const s32 side = OurTile::CHANGE_BLOCK_SIDE;
+    const s32 align = THUMBNAIL_ALIGN;
+    for (u32 b = 0; b < blockCount; ++b)
+    {
+      const u32 stamp = snapshot ? snapshot->m_snapshotStamps[b] : tile.GetChangeBlockStamp(b);
+      if (stamp == image.m_thumbnailStamps[b]) continue;
+      image.m_thumbnailStamps[b] = stamp;
+
+      // Clip the block to the drawn sites, then round it out to whole
+      // texels at every level
+      const s32 bx = (s32) (b % blocksWide) * side - (s32) indent;
+      const s32 by = (s32) (b / blocksWide) * side - (s32) indent;
+      const s32 x0 = MAX(bx, 0);
+      const s32 y0 = MAX(by, 0);
+      const s32 x1 = MIN(bx + side, drawnWidth);
+      const s32 y1 = MIN(by + side, drawnHeight);
+      if (x0 >= x1 || y0 >= y1) continue;
+      const s32 ax0 = x0 & ~(align - 1);
+      const s32 ay0 = y0 & ~(align - 1);
+      const s32 ax1 = MIN((x1 + align - 1) & ~(align - 1), drawnWidth);
+      const s32 ay1 = MIN((y1 + align - 1) & ~(align - 1), drawnHeight);
+      BuildThumbnailRect(image, tile, Rect(ax0, ay0, ax1 - ax0, ay1 - ay0));
+    }
+  }
+
+  template <class EC>
+  void TileRenderer<EC>::BuildThumbnailRect(TileImage & image, const Tile<EC> & tile, const Rect & sites)
+  {
+    const ThumbnailKey & key = image.m_thumbnailKey;
+    const u32 indent = key.m_drawCacheSites ? 0 : EWR;
+    const u32 drawnWidth = tile.TILE_WIDTH - 2 * indent;
+    const u32 drawnHeight = tile.TILE_HEIGHT - 2 * indent;
+    const SPoint indentPt(indent, indent);
+
+    // Topmost first, as in RasterSitesInRect
+    const DrawSiteType layers[3] = { key.m_foregroundType, key.m_midgroundType, key.m_backgroundType };
+    RasterElementCache elements;
+
+    // Level 1 averages sites; each level after averages the one before
+    for (u32 level = 1; level <= THUMBNAIL_LEVELS; ++level)
+    {
+      u32 * texels = image.m_thumbnails + GetThumbnailOffset(drawnWidth, drawnHeight, level);
+      const u32 * below = level == 1 ? 0 :
+        image.m_thumbnails + GetThumbnailOffset(drawnWidth, drawnHeight, level - 1);
+      const s32 levelWidth = (s32) GetThumbnailSide(drawnWidth, level);
+      const s32 belowWidth = (s32) GetThumbnailSide(drawnWidth, level - 1);
+      const s32 belowHeight = (s32) GetThumbnailSide(drawnHeight, level - 1);
+
+      const s32 tx0 = sites.GetX() >> level;
+      const s32 ty0 = sites.GetY() >> level;
+      const s32 tx1 = (s32) GetThumbnailSide(sites.GetX() + sites.GetWidth(), level);
+      const s32 ty1 = (s32) GetThumbnailSide(sites.GetY() + sites.GetHeight(), level);
+      for (s32 ty = ty0; ty < ty1; ++ty)
+      {
+        for (s32 tx = tx0; tx < tx1; ++tx)
+        {
+          u32 r = 0, g = 0, b = 0, painted = 0, count = 0;
+          for (s32 y = 2 * ty; y < MIN(2 * ty + 2, belowHeight); ++y)
+          {
+            for (s32 x = 2 * tx; x < MIN(2 * tx + 2, belowWidth); ++x)
+            {
+              ++count;
+              u32 color = 0;
+              if (below)
+              {
+                color = below[y * belowWidth + x];
+                if (color == TILE_IMAGE_CLEAR_COLOR) continue;
+              }
+              else
+              {
+                u32 l = 0;
+                while (l < 3 && !GetRasterColor(layers[l], tile, SPoint(x, y) + indentPt, elements, color))
+                  ++l;
+                if (l == 3) continue;
+              }
+              r += (color >> 16) & 0xff;
+              g += (color >> 8) & 0xff;
+              b += color & 0xff;
+              ++painted;
+            }
+          }
+
+          // Mostly unpainted texels stay clear, so the panel shows through
+          texels[ty * levelWidth + tx] = 2 * painted < count ? (u32) TILE_IMAGE_CLEAR_COLOR :
+            0xff000000 | ((r / painted) << 16) | ((g / painted) << 8) | (b / painted);
+        }
+      }
+    }
+  }
+
+  template <class EC>
+  bool TileRenderer<EC>::RasterThumbnailInRect(Drawing & drawing,
+                                               const SPoint ditOrigin,
+                                               const TileImage & image,
+                                               const Tile<EC> & tile,
+                                               u32 level,
+                                               const Rect & sites)
+  {
+    SDL_Surface * surface = drawing.GetSurface();
+    if (!image.m_thumbnails || !surface || surface->format->BytesPerPixel != 4) return false;
+
+    Rect window;
+    drawing.GetWindow(window);
+    const s32 clipX0 = MAX(window.GetX(), 0);
+    const s32 clipY0 = MAX(window.GetY(), 0);
+    const s32 clipX1 = MIN(window.GetX() + (s32) window.GetWidth(), surface->w);
+    const s32 clipY1 = MIN(window.GetY() + (s32) window.GetHeight(), surface->h);
+    if (clipX0 >= clipX1 || clipY0 >= clipY1) return true;
+
+    if (SDL_MUSTLOCK(surface) && SDL_LockSurface(surface) < 0) return false;
+
+    const u32 indent = image.m_thumbnailKey.m_drawCacheSites ? 0 : EWR;
+    const s32 drawnWidth = (s32) (tile.TILE_WIDTH - 2 * indent);
+    const s32 drawnHeight = (s32) (tile.TILE_HEIGHT - 2 * indent);
+    const u32 * texels = image.m_thumbnails + GetThumbnailOffset(drawnWidth, drawnHeight, level);
+    const s32 levelWidth = (s32) GetThumbnailSide(drawnWidth, level);
+    const s32 span = 1 << level;
+    const s32 atomDit = (s32) m_atomSizeDit;
+
+    const s32 tx0 = sites.GetX() >> level;
+    const s32 ty0 = sites.GetY() >> level;
+    const s32 tx1 = (s32) GetThumbnailSide(sites.GetX() + sites.GetWidth(), level);
+    const s32 ty1 = (s32) GetThumbnailSide(sites.GetY() + sites.GetHeight(), level);
+    for (s32 ty = ty0; ty < ty1; ++ty)
+    {
+      // Each texel covers the pixels its sites would
+      const s32 y0 = ty * span;
+      const s32 y1 = MIN(y0 + span, drawnHeight);
+      const s32 py0 = MAX(window.GetY() + Drawing::MapDitToPix(ditOrigin.GetY() + y0 * atomDit), clipY0);
+      const s32 py1 = MIN(window.GetY() + Drawing::MapDitToPix(ditOrigin.GetY() + y1 * atomDit), clipY1);
+      if (py0 >= py1) continue;
+
+      for (s32 tx = tx0; tx < tx1; ++tx)
+      {
+        const s32 x0 = tx * span;
+        const s32 x1 = MIN(x0 + span, drawnWidth);
+        const s32 px0 = MAX(window.GetX() + Drawing::MapDitToPix(ditOrigin.GetX() + x0 * atomDit), clipX0);
+        const s32 px1 = MIN(window.GetX() + Drawing::MapDitToPix(ditOrigin.GetX() + x1 * atomDit), clipX1);
+        if (px0 >= px1) continue;
+
+        const u32 color = texels[ty * levelWidth + tx];
+        if (color == TILE_IMAGE_CLEAR_COLOR) continue;
+
+        for (s32 py = py0; py < py1; ++py)
+        {
+          u32 * row = (u32 *) (((u8 *) surface->pixels) + py * surface->pitch);
+          for (s32 px = px0; px < px1; ++px)
+            row[px] = color;
+        }
+      }
+    }
+
+    if (SDL_MUSTLOCK(surface)) SDL_UnlockSurface(surface);
+    return true;
+  }
+
   template <class EC>
   SPoint TileRenderer<EC>::ComputeDrawSizeDit(const Tile<EC> & tile, u32 tileRegion) const
   {
@@ -42,6 +634,19 @@ namespace MFM
                                     const DrawSiteShape shape,
                                     const SPoint ditOrigin,
                                     const Tile<EC> & tile)
+  {
+    const u32 indent = m_drawCacheSites ? 0 : EWR;
+    PaintSitesInRect(drawing, drawType, shape, ditOrigin, tile,
+                     Rect(0, 0, tile.TILE_WIDTH - 2 * indent, tile.TILE_HEIGHT - 2 * indent));
+  }
+
+  template <class EC>
+  void TileRenderer<EC>::PaintSitesInRect(Drawing & drawing,
+                                          const DrawSiteType drawType,
+                                          const DrawSiteShape shape,
+                                          const SPoint ditOrigin,
+                                          const Tile<EC> & tile,
+                                          const Rect & sites)
   {
     // First deal with the whole-tile cases
     switch (drawType)
@@ -75,12 +680,18 @@ namespace MFM
     }
 
     // Here we need to iterate over the sites
-    typename OurTile::const_iterator_type end = tile.end(m_drawCacheSites);
-    for (typename OurTile::const_iterator_type i = tile.begin(m_drawCacheSites); i != end; ++i)
+    const SPoint indent = m_drawCacheSites ? SPoint(0, 0) : SPoint(EWR, EWR);
+    const s32 xEnd = sites.GetX() + (s32) sites.GetWidth();
+    const s32 yEnd = sites.GetY() + (s32) sites.GetHeight();
+    for (s32 y = sites.GetY(); y < yEnd; ++y)
     {
-      SPoint siteInTileCoord = i.At();
-      SPoint screenDitForSite = ditOrigin + siteInTileCoord * m_atomSizeDit;
-      PaintSiteAtDit(drawing, drawType, shape, screenDitForSite, *i, tile);
+      for (s32 x = sites.GetX(); x < xEnd; ++x)
+      {
+        SPoint siteInDrawnCoord(x, y);
+        SPoint screenDitForSite = ditOrigin + siteInDrawnCoord * m_atomSizeDit;
+        PaintSiteAtDit(drawing, drawType, shape, screenDitForSite,
+                       GetPaintSite(tile, siteInDrawnCoord + indent), tile);
+      }
     }
   }
 
@@ -157,57 +768,63 @@ namespace MFM
 
     // Here we need to iterate over the sites
     const Tile<EC> & ctile = tile;
-    typename OurTile::const_iterator_type end = ctile.end(m_drawCacheSites);
-    for (typename OurTile::const_iterator_type i = ctile.begin(m_drawCacheSites); i != end; ++i)
+    const u32 rows = ctile.GetSiteSpanCount(m_drawCacheSites);
+    for (u32 row = 0; row < rows; ++row)
     {
-      SPoint siteInTileCoord = i.AtSite(); // Absolute (0,0) is always in cache
-      SPoint siteInVisibleCoord = i.At();  // (0,0) is least visible pos (cache if m_drawCacheSites, else owned)
-      SPoint siteOriginDit = tileDitOrigin + siteInVisibleCoord * m_atomSizeDit + SPoint(m_atomSizeDit/2,m_atomSizeDit/2); // Center of site
+      u32 length;
+      const S * sites = ctile.GetSiteSpan(row, m_drawCacheSites, length);
+      const SPoint rowOrigin = ctile.GetSiteSpanOrigin(row, m_drawCacheSites);
+      for (u32 x = 0; x < length; ++x)
+      {
+        SPoint siteInTileCoord = rowOrigin + SPoint(x, 0); // Absolute (0,0) is always in cache
+        SPoint siteInVisibleCoord(x, row);  // (0,0) is least visible pos (cache if m_drawCacheSites, else owned)
+        SPoint siteOriginDit = tileDitOrigin + siteInVisibleCoord * m_atomSizeDit + SPoint(m_atomSizeDit/2,m_atomSizeDit/2); // Center of site
 
-      AtomBitStorage<EC> abs(i->GetAtom());
-      const T& atom = abs.GetAtom();
-      if (!atom.IsSane()) continue;
+        AtomBitStorage<EC> abs(sites[x].GetAtom());
+        const T& atom = abs.GetAtom();
+        if (!atom.IsSane()) continue;
 
-      u32 type = atom.GetType();
-      if (type == T::ATOM_EMPTY_TYPE) continue;
+        u32 type = atom.GetType();
+        if (type == T::ATOM_EMPTY_TYPE) continue;
 
-      const Element<EC> * elt = tile.GetElementTable().Lookup(type);
-      if (!elt) continue; // ???
+        const Element<EC> * elt = tile.GetElementTable().Lookup(type);
+        if (!elt) continue; // ???
 
-      const UlamElement<EC> * uelt = elt->AsUlamElement();
-      if (uelt) { // Custom is only for uelts
+        const UlamElement<EC> * uelt = elt->AsUlamElement();
+        if (uelt) { // Custom is only for uelts
 
-        EventWindow<EC> & ew = tile.GetEventWindow();
-        if (ew.InitForEvent(siteInTileCoord, false)) {
-          drawable.Reset();
-          drawable.SetDitOrigin(siteOriginDit);
-          drawable.SetDitsPerSite(m_atomSizeDit);
+          EventWindow<EC> & ew = tile.GetEventWindow();
+          if (ew.InitForEvent(siteInTileCoord, false)) {
+            drawable.Reset();
+            drawable.SetDitOrigin(siteOriginDit);
+            drawable.SetDitsPerSite(m_atomSizeDit);
 
-          // We have to defend ourselves here.  Even though we know atom
-          // IsSane as far as the parity of the atomic header, anything
-          // might be wrong down in the user bits, and arbitrary rendering
-          // code, even given just a temp eventwindow that will never be
-          // committed, can easily blow up.
+            // We have to defend ourselves here.  Even though we know atom
+            // IsSane as far as the parity of the atomic header, anything
+            // might be wrong down in the user bits, and arbitrary rendering
+            // code, even given just a temp eventwindow that will never be
+            // committed, can easily blow up.
 
-          unwind_protect(
-          {
-            const char * failFile = MFMThrownFromFile;
-            const unsigned lineno = MFMThrownFromLineNo;
-            const char * failMsg = MFMFailCodeReason(MFMThrownFailCode);
-            OString256 buff;
-            SPointSerializer ssp(siteInTileCoord);
-            buff.Printf("T%s@S%@: Render failed: %s (%s:%d)",
-                        tile.GetLabel(),
-                        &ssp,
-                        failMsg,
-                        failFile,
-                        lineno);
-            LOG.Message("%s",buff.GetZString());
-          },
-          {
-            CallRenderGraphics(ucs,*uelt,abs,tile);
-          });
-          ew.SetFree();
+            unwind_protect(
+            {
+              const char * failFile = MFMThrownFromFile;
+              const unsigned lineno = MFMThrownFromLineNo;
+              const char * failMsg = MFMFailCodeReason(MFMThrownFailCode);
+              OString256 buff;
+              SPointSerializer ssp(siteInTileCoord);
+              buff.Printf("T%s@S%@: Render failed: %s (%s:%d)",
+                          tile.GetLabel(),
+                          &ssp,
+                          failMsg,
+                          failFile,
+                          lineno);
+              LOG.Message("%s",buff.GetZString());
+            },
+            {
+              CallRenderGraphics(ucs,*uelt,abs,tile);
+            });
+            ew.SetFree();
+          }
         }
       }
     }
@@ -224,17 +841,29 @@ namespace MFM
 
         return;
     }
+    m_paintSnapshot = 0;
     unwind_protect({
+        m_paintSnapshot = 0;
         LOG.Warning("Failure during painting; incomplete grid render");
     },{
-        PaintSites(drawing,
-                   (m_drawBases && !IsBaseVisible()) ? DRAW_SITE_BASE : m_drawBackgroundType,
-                   DRAW_SHAPE_FILL, ditOrigin, tile);
-        PaintUnderlays(drawing, ditOrigin, tile);  // E.g. an event window
+        const DrawSiteType backgroundType = GetEffectiveBackgroundType();
+
+        const u32 indent = m_drawCacheSites ? 0 : EWR;
+        const Rect allSites(0, 0, tile.TILE_WIDTH - 2 * indent, tile.TILE_HEIGHT - 2 * indent);
+
+        bool painted = PaintTileImage(drawing, ditOrigin, tile, backgroundType);
+        if (!painted && !m_drawEventWindow)
+          painted = RasterSitesInRect(drawing, ditOrigin, tile, allSites, backgroundType);
+
+        if (!painted)
+        {
+          PaintSites(drawing, backgroundType, DRAW_SHAPE_FILL, ditOrigin, tile);
+          PaintUnderlays(drawing, ditOrigin, tile);  // E.g. an event window
 
-        PaintSites(drawing, m_drawMidgroundType, DRAW_SHAPE_CIRCLE, ditOrigin, tile);
+          PaintSites(drawing, m_drawMidgroundType, DRAW_SHAPE_CIRCLE, ditOrigin, tile);
 
-        PaintSites(drawing, m_drawForegroundType, DRAW_SHAPE_CDOT, ditOrigin, tile);
+          PaintSites(drawing, m_drawForegroundType, DRAW_SHAPE_CDOT, ditOrigin, tile);
+        }
 
         if (m_drawCustom)
           PaintCustom(drawing, ditOrigin, tile);
@@ -281,7 +910,7 @@ namespace MFM
                                         const DrawSiteType drawType,
                                         const DrawSiteShape shape,
                                         const SPoint ditOrigin,
-                                        const Site<AC> & site,
+                                        const OurSite & site,
                                         const Tile<EC> & inTile)
   {
     u32 selector = 0;
@@ -300,20 +929,7 @@ namespace MFM
       return;
 
     case DRAW_SITE_CHANGE_AGE:
-      {
-        const u32 writeAge = site.GetWriteAge();
-        const u32 MAX_IDX = 10000;       // Potential (interpolated) colors
-        const u32 AGE_PER_AEPS = 1; // Counting site events directly.., was: tile.GetSites();
-        const double MAX_EXPT = 4.0;     // 10**4.0 == 10kAEPS for fully black
-        const double LOG_SCALER = MAX_IDX/MAX_EXPT;
-        const double writeAgeAEPS = 1.0 * writeAge / AGE_PER_AEPS + 1;
-        const u32 colorIndex = MIN(MAX_IDX, (u32) (LOG_SCALER*log10(writeAgeAEPS)));
-        const u32 color =
-          ColorMap_CubeHelixRev::THE_INSTANCE.
-          GetInterpolatedColor(colorIndex,0,MAX_IDX,0xffff0000);
-
-        PaintShapeForSite(drawing, shape, ditOrigin, color);
-      }
+      PaintShapeForSite(drawing, shape, ditOrigin, GetChangeAgeColor(site));
       return;
 
     case DRAW_SITE_PAINT:
@@ -364,8 +980,7 @@ namespace MFM
       return;
     }
 
-    const u32 LABEL_ATOM_SIZE_DIT = Drawing::MapPixToDit(25);
-    if (m_drawLabels > 0 || (m_drawLabels < 0 && m_atomSizeDit >= LABEL_ATOM_SIZE_DIT))
+    if (IsDrawLabels())
     {
       elementLabel = elt->GetAtomicSymbol();
     }
@@ -376,7 +991,7 @@ namespace MFM
     }
     else
     {
-      drawColor = elt->GetDynamicColor(inTile.GetElementTable(), inTile.GetUlamClassRegistry(), atom, selector);
+      drawColor = m_colorCache.GetColor(inTile.GetElementTable(), inTile.GetUlamClassRegistry(), *elt, atom, selector);
     }
     PaintShapeForSite(drawing, shape, ditOrigin, drawColor);
 
@@ -399,6 +1014,166 @@ namespace MFM
     }
   }
 
+  template <class EC>
+  u32 TileRenderer<EC>::GetChangeAgeColor(const OurSite & site)
+  {
+    const u32 writeAge = site.GetWriteAge();
+    const u32 MAX_IDX = 10000;       // Potential (interpolated) colors
+    const u32 AGE_PER_AEPS = 1; // Counting site events directly.., was: tile.GetSites();
+    const double MAX_EXPT = 4.0;     // 10**4.0 == 10kAEPS for fully black
+    const double LOG_SCALER = MAX_IDX/MAX_EXPT;
+    const double writeAgeAEPS = 1.0 * writeAge / AGE_PER_AEPS + 1;
+    const u32 colorIndex = MIN(MAX_IDX, (u32) (LOG_SCALER*log10(writeAgeAEPS)));
+    return
+      ColorMap_CubeHelixRev::THE_INSTANCE.
+      GetInterpolatedColor(colorIndex,0,MAX_IDX,0xffff0000);
+  }
+
+  template <class EC>
+  bool TileRenderer<EC>::GetRasterColor(const DrawSiteType drawType,
+                                        const Tile<EC> & tile,
+                                        const SPoint siteInTile,
+                                        RasterElementCache & elements,
+                                        u32 & color)
+  {
+    u32 selector = 0;
+    bool fromBase = false;
+    switch (drawType)
+    {
+    default:
+      FAIL(ILLEGAL_STATE);
+
+    case DRAW_SITE_NONE:
+      return false;
+
+    case DRAW_SITE_DARK_TILE:
+    case DRAW_SITE_LIGHT_TILE:
+      {
+        // The region is how many event window radii in from the edge
+        const s32 x = siteInTile.GetX(), y = siteInTile.GetY();
+        const s32 in = MIN(MIN(x, (s32) tile.TILE_WIDTH - 1 - x),
+                           MIN(y, (s32) tile.TILE_HEIGHT - 1 - y));
+        const u32 region = MIN((u32) (in / EWR), (u32) OurTile::REGION_HIDDEN);
+        if (drawType == DRAW_SITE_LIGHT_TILE)
+        {
+          color = m_regionColors[region];
+          return true;
+        }
+        if (region < OurTile::REGION_VISIBLE) return false;
+        color = Drawing::GREY20;
+        return true;
+      }
+
+    case DRAW_SITE_CHANGE_AGE:
+      color = GetChangeAgeColor(GetPaintSite(tile, siteInTile));
+      return true;
+
+    case DRAW_SITE_PAINT:
+      color = GetPaintSite(tile, siteInTile).GetPaint();
+      return true;
+
+    case DRAW_SITE_BLACK:  color = 0xff000000; return true;
+    case DRAW_SITE_DARK:   color = 0xff101010; return true;
+    case DRAW_SITE_WHITE:  color = 0xffffffff; return true;
+    case DRAW_SITE_ELEMENT: break;
+    case DRAW_SITE_ATOM_1: selector = 1; break;
+    case DRAW_SITE_ATOM_2: selector = 2; break;
+
+    case DRAW_SITE_BASE: fromBase = true; break;
+    case DRAW_SITE_BASE_1: fromBase = true; selector = 1; break;
+    case DRAW_SITE_BASE_2: fromBase = true; selector = 2; break;
+    }
+
+    const OurSite & site = GetPaintSite(tile, siteInTile);
+    const T & atom = fromBase ? site.GetBase().GetBaseAtom() : site.GetAtom();
+    if (!atom.IsSane())
+    {
+      color = Drawing::RED;  // Too small for the error icon
+      return true;
+    }
+
+    const u32 type = atom.GetType();
+    if (type == T::ATOM_EMPTY_TYPE) return false;
+
+    const Element<EC> * elt = elements.Lookup(tile, type);
+    if (!elt)
+    {
+      color = Drawing::RED;
+      return true;
+    }
+
+    if (selector == 0)
+      color = elt->GetStaticColor();
+    else
+      color = m_colorCache.GetColor(tile.GetElementTable(), tile.GetUlamClassRegistry(), *elt, atom, selector);
+    return true;
+  }
+
+  template <class EC>
+  bool TileRenderer<EC>::RasterSitesInRect(Drawing & drawing,
+                                           const SPoint ditOrigin,
+                                           const Tile<EC> & tile,
+                                           const Rect & sites,
+                                           const DrawSiteType backgroundType)
+  {
+    if (m_atomSizeDit > MAX_RASTER_ATOM_SIZE_DIT) return false;
+
+    SDL_Surface * surface = drawing.GetSurface();
+    if (!surface || surface->format->BytesPerPixel != 4) return false;
+
+    // Pixels are written in surface coordinates, clipped to both the
+    // window and the surface
+    Rect window;
+    drawing.GetWindow(window);
+    const s32 clipX0 = MAX(window.GetX(), 0);
+    const s32 clipY0 = MAX(window.GetY(), 0);
+    const s32 clipX1 = MIN(window.GetX() + (s32) window.GetWidth(), surface->w);
+    const s32 clipY1 = MIN(window.GetY() + (s32) window.GetHeight(), surface->h);
+    if (clipX0 >= clipX1 || clipY0 >= clipY1) return true;
+
+    if (SDL_MUSTLOCK(surface) && SDL_LockSurface(surface) < 0) return false;
+
+    // Topmost first: the first layer that paints a site hides the rest
+    const DrawSiteType layers[3] = { m_drawForegroundType, m_drawMidgroundType, backgroundType };
+    const SPoint indent = m_drawCacheSites ? SPoint(0, 0) : SPoint(EWR, EWR);
+    const s32 atomDit = (s32) m_atomSizeDit;
+    const s32 xEnd = sites.GetX() + (s32) sites.GetWidth();
+    const s32 yEnd = sites.GetY() + (s32) sites.GetHeight();
+    RasterElementCache elements;
+
+    for (s32 y = sites.GetY(); y < yEnd; ++y)
+    {
+      // Each site runs to where the next starts, so fractional atom
+      // sizes leave no gaps
+      const s32 py0 = MAX(window.GetY() + Drawing::MapDitToPix(ditOrigin.GetY() + y * atomDit), clipY0);
+      const s32 py1 = MIN(window.GetY() + Drawing::MapDitToPix(ditOrigin.GetY() + (y + 1) * atomDit), clipY1);
+      if (py0 >= py1) continue;
+
+      for (s32 x = sites.GetX(); x < xEnd; ++x)
+      {
+        const s32 px0 = MAX(window.GetX() + Drawing::MapDitToPix(ditOrigin.GetX() + x * atomDit), clipX0);
+        const s32 px1 = MIN(window.GetX() + Drawing::MapDitToPix(ditOrigin.GetX() + (x + 1) * atomDit), clipX1);
+        if (px0 >= px1) continue;
+
+        u32 color = 0;
+        u32 l = 0;
+        while (l < 3 && !GetRasterColor(layers[l], tile, SPoint(x, y) + indent, elements, color))
+          ++l;
+        if (l == 3) continue;
+
+        for (s32 py = py0; py < py1; ++py)
+        {
+          u32 * row = (u32 *) (((u8 *) surface->pixels) + py * surface->pitch);
+          for (s32 px = px0; px < px1; ++px)
+            row[px] = color;
+        }
+      }
+    }
+
+    if (SDL_MUSTLOCK(surface)) SDL_UnlockSurface(surface);
+    return true;
+  }
+
   template <class EC>
   void TileRenderer<EC>::PaintShapeForSite(Drawing & drawing, const DrawSiteShape shape, const SPoint ditOrigin, u32 color)
   {
@@ -434,6 +1209,12 @@ namespace MFM
   template <class EC>
   void TileRenderer<EC>::PaintBadAtomAtDit(Drawing & drawing, const SPoint ditOrigin)
   {
+    if (m_paintWorker)
+    {
+      // Icons are shared surfaces, so not for painting off the main thread
+      drawing.FillRectDit(Rect(ditOrigin, UPoint(m_atomSizeDit, m_atomSizeDit)), Drawing::RED);
+      return;
+    }
     Rect r(Drawing::MapDitToPix(ditOrigin), Drawing::MapDitToPix(UPoint(m_atomSizeDit, m_atomSizeDit)));
     IconAsset ia;
     ia.SetIconSlot(ZSLOT_ICON_ERROR);
@@ -702,6 +702,9 @@ namespace MFM
         str.Printf("Neighborhood%D",i);
         m_neighborhoods[i].SetName(str.GetZString());
       }
+
+      // Changes mostly come by clicking it, which invalidates it
+      SetRetained(true);
     }
 
     virtual ~ToolboxPanel() { } //avoid inline error
@@ -10,4 +10,14 @@ namespace MFM
   TTF_Font* AssetManager::zfonts[ZFONT_HEIGHT_COUNT][2] = { NULL };
 
   bool AssetManager::initialized = false;
+
+  AssetManager::TextCacheEntry AssetManager::textCache[TEXT_CACHE_ENTRIES];
+
+  u16 AssetManager::textCacheBuckets[TEXT_CACHE_BUCKETS] = { 0 };
+
+  u32 AssetManager::textCacheUsed = 0;
+
+  u32 AssetManager::textCacheClock = 0;
+
+  AssetManager::TextCacheStats AssetManager::textCacheStats = { 0, 0, 0, 0 };
 }
@@ -1,8 +1,10 @@
 #include "Camera.h"
 
 #include <stdlib.h>    /* for malloc, free */
+#include <string.h>    /* for memcpy, strlen */
 #include <png.h>
 #include <errno.h>     /* for errno */
+#include <sys/time.h>  /* for gettimeofday */
 
 /* libpng is ghetto and needs these */
 static void libpng_warning(png_structp context, png_const_charp msg)
@@ -17,8 +19,36 @@ static void libpng_error(png_structp context, png_const_charp msg)
 namespace MFM
 {
   Camera::Camera()
+    : m_queueDepth(DEFAULT_QUEUE_DEPTH)
+    , m_queueHead(0)
+    , m_queueCount(0)
+    , m_queueNext(0)
+    , m_queueUnclaimed(0)
+    , m_writerCount(DEFAULT_WRITERS)
+    , m_writersStarted(0)
+    , m_writerExiting(false)
   {
     m_recording = false;
+    for (u32 i = 0; i < MAX_QUEUE_DEPTH; ++i)
+    {
+      m_frames[i].m_pixels = 0;
+      m_frames[i].m_capacity = 0;
+      m_frames[i].m_state = FRAME_FREE;
+    }
+    memset(&m_stats, 0, sizeof(m_stats));
+    pthread_mutex_init(&m_lock, NULL);
+    pthread_cond_init(&m_frameQueued, NULL);
+    pthread_cond_init(&m_frameWritten, NULL);
+  }
+
+  Camera::~Camera()
+  {
+    StopWriter();
+    for (u32 i = 0; i < MAX_QUEUE_DEPTH; ++i)
+      free(m_frames[i].m_pixels);
+    pthread_cond_destroy(&m_frameWritten);
+    pthread_cond_destroy(&m_frameQueued);
+    pthread_mutex_destroy(&m_lock);
   }
 
   void Camera::ToggleRecord()
@@ -40,15 +70,179 @@ namespace MFM
     }
   }
 
-  bool Camera::DrawSurface(SDL_Surface* sfc, const char * pngDirPath) const
+  bool Camera::DrawSurface(SDL_Surface* sfc, const char * pngDirPath)
+  {
+    if (m_queueDepth > 0)
+      StartWriter();
+    if (m_queueDepth == 0)
+    {
+      // m_currentFrame++
+      bool ret = SavePNG(pngDirPath, sfc) == 0;
+
+      //    SDL_Flip(sfc);
+      return ret;
+    }
+
+    if (strlen(pngDirPath) >= FRAME_PATH_MAX_LENGTH)
+    {
+      fprintf(stderr, "[Camera::DrawSurface] Path too long: %s\n", pngDirPath);
+      return false;
+    }
+
+    pthread_mutex_lock(&m_lock);
+    if (m_queueCount >= m_queueDepth)
+    {
+      struct timeval start, end;
+      gettimeofday(&start, NULL);
+      while (m_queueCount >= m_queueDepth)
+        pthread_cond_wait(&m_frameWritten, &m_lock);
+      gettimeofday(&end, NULL);
+      ++m_stats.m_stalls;
+      m_stats.m_stallMicros +=
+        (u64) (end.tv_sec - start.tv_sec) * 1000000 + end.tv_usec - start.tv_usec;
+    }
+    QueuedFrame & frame = m_frames[(m_queueHead + m_queueCount) % m_queueDepth];
+    pthread_mutex_unlock(&m_lock);
+
+    // Writers never touch a FREE slot, and we're the only producer,
+    // so copy into it unlocked
+    const u32 bytes = sfc->h * sfc->pitch;
+    if (frame.m_capacity < bytes)
+    {
+      free(frame.m_pixels);
+      frame.m_capacity = 0;
+      frame.m_pixels = (u8*) malloc(bytes);
+      if (!frame.m_pixels)
+      {
+        fprintf(stderr, "[Camera::DrawSurface] Can't allocate %u bytes.\n", bytes);
+        return false;
+      }
+      frame.m_capacity = bytes;
+    }
+    memcpy(frame.m_pixels, sfc->pixels, bytes);
+    frame.m_width = sfc->w;
+    frame.m_height = sfc->h;
+    frame.m_pitch = sfc->pitch;
+    strcpy(frame.m_path, pngDirPath);
+
+    pthread_mutex_lock(&m_lock);
+    frame.m_state = FRAME_QUEUED;
+    ++m_queueCount;
+    ++m_queueUnclaimed;
+    ++m_stats.m_framesQueued;
+    if (m_queueCount > m_stats.m_maxQueued)
+      m_stats.m_maxQueued = m_queueCount;
+    pthread_cond_signal(&m_frameQueued);
+    pthread_mutex_unlock(&m_lock);
+    return true;
+  }
+
+  void Camera::SetQueueDepth(u32 frames)
+  {
+    Flush();
+    pthread_mutex_lock(&m_lock);
+    m_queueHead = 0;
+    m_queueNext = 0;
+    m_queueDepth = frames > MAX_QUEUE_DEPTH ? MAX_QUEUE_DEPTH : frames;
+    pthread_mutex_unlock(&m_lock);
+  }
+
+  void Camera::SetWriterCount(u32 writers)
   {
-    // m_currentFrame++
-    bool ret = SavePNG(pngDirPath, sfc);
+    StopWriter();  // Restarted at the next queued frame
+    if (writers < 1) writers = 1;
+    m_writerCount = writers > MAX_WRITERS ? MAX_WRITERS : writers;
+  }
 
-    //    SDL_Flip(sfc);
+  Camera::Stats Camera::GetStats()
+  {
+    pthread_mutex_lock(&m_lock);
+    Stats ret = m_stats;
+    pthread_mutex_unlock(&m_lock);
     return ret;
   }
 
+  void Camera::Flush()
+  {
+    if (!m_writersStarted) return;
+    pthread_mutex_lock(&m_lock);
+    while (m_queueCount > 0)
+      pthread_cond_wait(&m_frameWritten, &m_lock);
+    pthread_mutex_unlock(&m_lock);
+  }
+
+  void Camera::StartWriter()
+  {
+    if (m_writersStarted) return;
+    m_writerExiting = false;
+    while (m_writersStarted < m_writerCount)
+    {
+      if (pthread_create(&m_writerThreads[m_writersStarted], NULL, WriterRunner, this))
+        break;
+      ++m_writersStarted;
+    }
+    if (!m_writersStarted)
+    {
+      fprintf(stderr, "[Camera::StartWriter] Can't start writer threads; writing frames directly.\n");
+      m_queueDepth = 0;
+    }
+  }
+
+  void Camera::StopWriter()
+  {
+    if (!m_writersStarted) return;
+    Flush();
+    pthread_mutex_lock(&m_lock);
+    m_writerExiting = true;
+    pthread_cond_broadcast(&m_frameQueued);
+    pthread_mutex_unlock(&m_lock);
+    for (u32 i = 0; i < m_writersStarted; ++i)
+      pthread_join(m_writerThreads[i], NULL);
+    m_writersStarted = 0;
+  }
+
+  void* Camera::WriterRunner(void* arg)
+  {
+    Camera& cam = *(Camera*) arg;
+    pthread_mutex_lock(&cam.m_lock);
+    while (true)
+    {
+      while (cam.m_queueUnclaimed == 0 && !cam.m_writerExiting)
+        pthread_cond_wait(&cam.m_frameQueued, &cam.m_lock);
+      if (cam.m_queueUnclaimed == 0) break;  // Exiting, and nothing left
+
+      // Still counted while we write it, so DrawSurface leaves it be
+      QueuedFrame & frame = cam.m_frames[cam.m_queueNext];
+      cam.m_queueNext = (cam.m_queueNext + 1) % cam.m_queueDepth;
+      --cam.m_queueUnclaimed;
+      frame.m_state = FRAME_WRITING;
+      pthread_mutex_unlock(&cam.m_lock);
+
+      const u32 ret =
+        SavePNG(frame.m_path, frame.m_pixels, frame.m_width, frame.m_height, frame.m_pitch);
+
+      pthread_mutex_lock(&cam.m_lock);
+      frame.m_state = FRAME_DONE;
+      ++cam.m_stats.m_framesWritten;
+      if (ret != 0)
+        ++cam.m_stats.m_writeFailures;
+
+      // Free whatever is finished at the head, in order
+      bool freed = false;
+      while (cam.m_queueCount > 0 && cam.m_frames[cam.m_queueHead].m_state == FRAME_DONE)
+      {
+        cam.m_frames[cam.m_queueHead].m_state = FRAME_FREE;
+        cam.m_queueHead = (cam.m_queueHead + 1) % cam.m_queueDepth;
+        --cam.m_queueCount;
+        freed = true;
+      }
+      if (freed)
+        pthread_cond_broadcast(&cam.m_frameWritten);
+    }
+    pthread_mutex_unlock(&cam.m_lock);
+    return 0;
+  }
+
   // Currently unused..
   u32 Camera::GetPNGColorType(SDL_Surface* sfc)
   {
@@ -67,6 +261,12 @@ namespace MFM
   }
 
   u32 Camera::SavePNG(const char* filename, SDL_Surface* sfc) const
+  {
+    return SavePNG(filename, (const u8*) sfc->pixels, sfc->w, sfc->h, sfc->pitch);
+  }
+
+  u32 Camera::SavePNG(const char* filename, const u8* pixels,
+                      u32 width, u32 height, u32 pitch)
   {
     FILE* fp = fopen(filename, "wb");
     if(fp == NULL)
@@ -105,18 +305,18 @@ namespace MFM
 
     //    u32 ctype = GetPNGColorType(sfc);
     u32 ctype = PNG_COLOR_TYPE_RGB_ALPHA;
-    png_set_IHDR(png_ptr, info_ptr, sfc->w, sfc->h, 8, ctype, PNG_INTERLACE_NONE,
+    png_set_IHDR(png_ptr, info_ptr, width, height, 8, ctype, PNG_INTERLACE_NONE,
 		 PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
 
     png_write_info(png_ptr, info_ptr);
     png_set_bgr(png_ptr);
     png_set_packing(png_ptr);
 
-    png_bytep* rows = (png_bytep*)malloc(sizeof(png_bytep) * sfc->h);
+    png_bytep* rows = (png_bytep*)malloc(sizeof(png_bytep) * height);
 
-    for(s32 i = 0; i < sfc->h; i++)
+    for(u32 i = 0; i < height; i++)
     {
-      rows[i] = (png_bytep)((u8*)sfc->pixels + i * sfc->pitch);
+      rows[i] = (png_bytep)(pixels + i * pitch);
     }
     png_write_image(png_ptr, rows);
     png_write_end(png_ptr, info_ptr);
@@ -94,10 +94,17 @@ namespace MFM
       ttfont = AssetManager::GetZFont(AssetManager::GetZFontPSC(m_fontAsset),scaledSize);
     }
 
-    SDL_Color sdl_color;
-    SetSDLColor(sdl_color,m_fgColor);
-
-    SDL_Surface* text = TTF_RenderText_Blended(ttfont, message, sdl_color);
+    // Usually the same few labels in the same few colors, frame after
+    // frame, so reuse the rendering when we can
+    SDL_Surface* text = AssetManager::GetRenderedText(ttfont, message, m_fgColor);
+    bool owned = false;
+    if (!text)
+    {
+      SDL_Color sdl_color;
+      SetSDLColor(sdl_color,m_fgColor);
+      text = TTF_RenderText_Blended(ttfont, message, sdl_color);
+      owned = true;
+    }
 
     SDL_Rect rect;
     rect.x = loc.GetX() + m_rect.GetX();
@@ -111,7 +118,7 @@ namespace MFM
     SDL_SetClipRect(m_dest, &clip);
     SDL_BlitSurface(text, NULL, m_dest, &rect);
 
-    SDL_FreeSurface(text);
+    if (owned) SDL_FreeSurface(text);
   }
 
   void Drawing::BlitBackedText(const char* message, SPoint loc, UPoint size, TTF_Font * infont)
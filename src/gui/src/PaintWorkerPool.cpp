@@ -0,0 +1,124 @@
+#include "PaintWorkerPool.h"
+#include "Logger.h"
+#include "Util.h"      /* For MIN */
+
+namespace MFM
+{
+  PaintWorkerPool::PaintWorkerPool()
+    : m_threadCount(0)
+    , m_function(0)
+    , m_arg(0)
+    , m_jobs(0)
+    , m_nextJob(0)
+    , m_busy(0)
+    , m_generation(0)
+    , m_exiting(false)
+  {
+    MFM_API_ASSERT(!pthread_mutex_init(&m_lock, NULL), LOCK_FAILURE);
+    MFM_API_ASSERT(!pthread_cond_init(&m_workReady, NULL), LOCK_FAILURE);
+    MFM_API_ASSERT(!pthread_cond_init(&m_workDone, NULL), LOCK_FAILURE);
+  }
+
+  PaintWorkerPool::~PaintWorkerPool()
+  {
+    StopThreads();
+    pthread_cond_destroy(&m_workDone);
+    pthread_cond_destroy(&m_workReady);
+    pthread_mutex_destroy(&m_lock);
+  }
+
+  void PaintWorkerPool::SetThreadCount(u32 threads)
+  {
+    StopThreads();
+
+    threads = MIN(threads, (u32) MAX_THREADS);
+    for (u32 i = 0; i < threads; ++i)
+    {
+      Worker & w = m_workers[m_threadCount];
+      w.m_pool = this;
+      w.m_index = m_threadCount + 1;   // The caller of Run is worker 0
+      w.m_generation = m_generation;
+      w.m_errorStackTop = 0;
+      if (pthread_create(&w.m_thread, NULL, WorkerRunner, &w))
+      {
+        LOG.Warning("Only %d of %d paint threads started", m_threadCount, threads);
+        break;
+      }
+      ++m_threadCount;
+    }
+  }
+
+  void PaintWorkerPool::StopThreads()
+  {
+    if (m_threadCount == 0) return;
+
+    pthread_mutex_lock(&m_lock);
+    m_exiting = true;
+    pthread_cond_broadcast(&m_workReady);
+    pthread_mutex_unlock(&m_lock);
+
+    for (u32 i = 0; i < m_threadCount; ++i)
+      pthread_join(m_workers[i].m_thread, NULL);
+
+    m_threadCount = 0;
+    m_exiting = false;
+  }
+
+  void PaintWorkerPool::Run(JobFunction fn, void * arg, u32 jobs)
+  {
+    MFM_API_ASSERT_NONNULL(fn);
+    if (jobs == 0) return;
+
+    pthread_mutex_lock(&m_lock);
+    m_function = fn;
+    m_arg = arg;
+    m_jobs = jobs;
+    m_nextJob = 0;
+    m_busy = m_threadCount;
+    ++m_generation;
+    pthread_cond_broadcast(&m_workReady);
+
+    RunJobs(0);
+
+    while (m_busy > 0)
+      pthread_cond_wait(&m_workDone, &m_lock);
+    m_function = 0;
+    pthread_mutex_unlock(&m_lock);
+  }
+
+  void PaintWorkerPool::RunJobs(u32 worker)
+  {
+    while (m_nextJob < m_jobs)
+    {
+      const u32 job = m_nextJob++;
+      pthread_mutex_unlock(&m_lock);
+      m_function(m_arg, worker, job);
+      pthread_mutex_lock(&m_lock);
+    }
+  }
+
+  void * PaintWorkerPool::WorkerRunner(void * arg)
+  {
+    Worker & w = *(Worker *) arg;
+    PaintWorkerPool & pool = *w.m_pool;
+
+    // Init error stack pointer (for this thread only)
+    MFMPtrToErrEnvStackPtr = &w.m_errorStackTop;
+
+    pthread_mutex_lock(&pool.m_lock);
+    while (true)
+    {
+      while (!pool.m_exiting && pool.m_generation == w.m_generation)
+        pthread_cond_wait(&pool.m_workReady, &pool.m_lock);
+      if (pool.m_exiting) break;
+      w.m_generation = pool.m_generation;
+
+      pool.RunJobs(w.m_index);
+
+      if (--pool.m_busy == 0)
+        pthread_cond_signal(&pool.m_workDone);
+    }
+    pthread_mutex_unlock(&pool.m_lock);
+    return 0;
+  }
+} /* namespace MFM */
@@ -34,6 +34,10 @@ namespace MFM {
 
   Panel::Panel(u32 width, u32 height)
     : m_ttfFont(0)
+    , m_retained(false)
+    , m_dirty(true)
+    , m_retainedFrames(0)
+    , m_backing(0)
   {
     SetDimensions(width, height);
     SetDesiredSize(U32_MAX, U32_MAX);  // Wish for a lot by default.
@@ -63,6 +67,17 @@ namespace MFM {
     // Eject us from our parent
     if (m_parent)
       m_parent->Remove(this);
+
+    FreeBacking();
+  }
+
+  void Panel::FreeBacking()
+  {
+    if (m_backing)
+    {
+      SDL_FreeSurface(m_backing);
+      m_backing = 0;
+    }
   }
 
   void Panel::Indent(ByteSink & sink, u32 count)
@@ -315,6 +330,7 @@ namespace MFM {
     }
 
     child->m_parent = this;
+    Invalidate();
   }
 
   void Panel::Remove(Panel * child)
@@ -333,6 +349,7 @@ namespace MFM {
     child->m_parent = 0;
     child->m_forward = 0;
     child->m_backward = 0;
+    Invalidate();
   }
 
   TTF_Font* Panel::GetFontReal() const {
@@ -347,6 +364,7 @@ namespace MFM {
   FontAsset  Panel::SetFont(FontAsset newFont) {
     FontAsset old = m_fontAsset;
     m_fontAsset = newFont;
+    if (old != newFont) Invalidate();
     return old;
   }
 
@@ -354,6 +372,7 @@ namespace MFM {
   {
     m_rect.SetWidth(width);
     m_rect.SetHeight(height);
+    Invalidate();
   }
 
   void Panel::SetDesiredSize(u32 width, u32 height)
@@ -380,6 +399,7 @@ namespace MFM {
   {
     m_rect.SetPosition(renderPt);
     m_desiredLocation.Set(renderPt.GetX(), renderPt.GetY()); // XXX Is this right?
+    if (m_parent) m_parent->Invalidate();
   }
 
   SPoint Panel::GetAbsoluteLocation()
@@ -399,40 +419,91 @@ namespace MFM {
 
     if(m_visible)
     {
-      Rect old, cur;
+      Rect old;
       drawing.GetWindow(old);
       drawing.TransformWindow(m_rect);
-      drawing.GetWindow(cur);
 
-      FontAsset oldFont = FONT_ASSET_NONE;
-      FontAsset font = GetFont();
-      if (font != FONT_ASSET_NONE)
+      if (m_retained)
+        PaintRetained(drawing);
+      else
+        PaintContents(drawing);
+
+      drawing.SetWindow(old);
+    }
+  }
+
+  void Panel::PaintRetained(Drawing & drawing)
+  {
+    const u32 width = m_rect.GetWidth();
+    const u32 height = m_rect.GetHeight();
+    if (width == 0 || height == 0)
+      return;
+
+    if (!m_backing || (u32) m_backing->w != width || (u32) m_backing->h != height)
+    {
+      FreeBacking();
+      const SDL_Surface * screen = drawing.GetSurface();
+      if (screen)
+      {
+        // Opaque, in the screen's format, so the blit is a plain copy
+        const SDL_PixelFormat * fmt = screen->format;
+        m_backing = SDL_CreateRGBSurface(SDL_SWSURFACE, width, height, fmt->BitsPerPixel,
+                                         fmt->Rmask, fmt->Gmask, fmt->Bmask, 0);
+      }
+      if (!m_backing)
       {
-        oldFont = drawing.SetFont(font);
+        // No backing to be had; just paint in place
+        PaintContents(drawing);
+        return;
       }
+      m_dirty = true;
+    }
 
-      const u32 oldfg = drawing.GetForeground();
-      const u32 oldbg = drawing.GetForeground();
-      drawing.SetForeground(m_fgColor);
-      drawing.SetBackground(m_bgColor);
+    if (m_dirty || ++m_retainedFrames >= RETAINED_REFRESH_FRAMES)
+    {
+      Drawing backing(m_backing, drawing.GetFont());
+      backing.SetZoomDits(drawing.GetZoomDits());
+      backing.SetForeground(drawing.GetForeground());
+      backing.SetBackground(drawing.GetBackground());
+      PaintContents(backing);
+      m_dirty = false;
+      m_retainedFrames = 0;
+    }
 
-      PaintComponent(drawing);
-      PaintBorder(drawing);
+    drawing.BlitImage(m_backing, SPoint(0, 0), UPoint(width, height));
+  }
 
-      drawing.SetWindow(cur);
-      PaintChildren(drawing);
+  void Panel::PaintContents(Drawing & drawing)
+  {
+    Rect cur;
+    drawing.GetWindow(cur);
 
-      drawing.SetWindow(cur);
-      PaintFloat(drawing);
+    FontAsset oldFont = FONT_ASSET_NONE;
+    FontAsset font = GetFont();
+    if (font != FONT_ASSET_NONE)
+    {
+      oldFont = drawing.SetFont(font);
+    }
 
-      drawing.SetWindow(old);
+    const u32 oldfg = drawing.GetForeground();
+    const u32 oldbg = drawing.GetForeground();
+    drawing.SetForeground(m_fgColor);
+    drawing.SetBackground(m_bgColor);
 
-      if (oldFont)
-        drawing.SetFont(oldFont);
+    PaintComponent(drawing);
+    PaintBorder(drawing);
 
-      drawing.SetForeground(oldfg);
-      drawing.SetBackground(oldbg);
-    }
+    drawing.SetWindow(cur);
+    PaintChildren(drawing);
+
+    drawing.SetWindow(cur);
+    PaintFloat(drawing);
+
+    if (oldFont)
+      drawing.SetFont(oldFont);
+
+    drawing.SetForeground(oldfg);
+    drawing.SetBackground(oldbg);
   }
 
   void Panel::PaintFloat(Drawing & drawing)
@@ -492,6 +563,8 @@ namespace MFM {
   {
     /* Try to make myself as big as I can, then call on my children. */
 
+    Invalidate();
+
     if(m_desiredSize.GetX() > parentSize.GetX())
     {
       m_rect.SetX(0);
@@ -569,10 +642,12 @@ namespace MFM {
         if (oldFocus)
         {
           oldFocus->OnMouseExit();
+          oldFocus->Invalidate();
         }
         if (newFocus)
         {
           newFocus->OnMouseEnter();
+          newFocus->Invalidate();
         }
       }
       m_focusedChild = newFocus;
@@ -585,7 +660,11 @@ namespace MFM {
 
     // Here the hit is in us and none of our descendants wanted it.
     // So it's ours if we do.
-    return event.Handle(*this);
+    if (!event.Handle(*this))
+      return false;
+
+    Invalidate();
+    return true;
   }
 
   SPoint Panel::GetTextSize(FontAsset font, const char * text)
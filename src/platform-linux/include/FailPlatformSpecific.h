@@ -14,6 +14,7 @@ struct MFMErrorEnvironment {
   volatile const char * file;   /* the file name of the original failure */
   volatile int lineno;          /* the line number of the original failure */
   volatile int thrown;          /* Return value(s) from setjmp call */
+  volatile int backtraceWanted; /* If zero, FAIL skips the costly backtrace */
   void * backtraceArray[MAX_BACKTRACE_LEVELS]; /* Where we were when we threw */
   unsigned backtraceSize;       /* Number of entries used in backtraceArray */
   MFMErrorEnvironmentPointer_t prev; /* Back link to previous error environment */
@@ -42,8 +43,9 @@ extern "C" const char * MFMFailCodeReason(int failCode) ;
    ((*MFMPtrToErrEnvStackPtr)->file = __FILE__,                    \
     (*MFMPtrToErrEnvStackPtr)->lineno = __LINE__,                  \
     (*MFMPtrToErrEnvStackPtr)->backtraceSize =                     \
-      backtrace((*MFMPtrToErrEnvStackPtr)->backtraceArray,         \
-                MAX_BACKTRACE_LEVELS),                             \
+      ((*MFMPtrToErrEnvStackPtr)->backtraceWanted ?                \
+       backtrace((*MFMPtrToErrEnvStackPtr)->backtraceArray,        \
+                 MAX_BACKTRACE_LEVELS) : 0),                       \
     MFMLongJmpHere((*MFMPtrToErrEnvStackPtr)->buffer,              \
                    number),0) :                                    \
    (MFMFailHere(__FILE__,__LINE__,                                 \
@@ -100,8 +102,21 @@ extern "C" const char * MFMFailCodeReason(int failCode) ;
 
  */
 #define unwind_protect(cleanup,block)                                         \
+  unwind_protect_backtrace(1,cleanup,block)
+
+/**
+   As unwind_protect, except that a FAIL in 'block' records a
+   backtrace (in MFMThrownBacktraceArray and MFMThrownBacktraceSize)
+   only if 'wanted' is nonzero.  Entering 'block' is cheap either
+   way (one setjmp, around 2ns); it's capturing the backtrace that
+   makes a FAIL cost most of a microsecond, so hot paths that catch
+   routine failures and don't print their backtraces can skip it.
+ */
+#define unwind_protect_backtrace(wanted,cleanup,block)                        \
 do {									      \
   MFMErrorEnvironment unwindProtect_errorEnvironment;			      \
+  unwindProtect_errorEnvironment.backtraceWanted = (wanted);                 \
+  unwindProtect_errorEnvironment.backtraceSize = 0;                           \
   unwindProtect_errorEnvironment.prev = (*MFMPtrToErrEnvStackPtr);	      \
   (*MFMPtrToErrEnvStackPtr) = &unwindProtect_errorEnvironment;                \
   unwindProtect_errorEnvironment.thrown = setjmp(unwindProtect_errorEnvironment.buffer); \
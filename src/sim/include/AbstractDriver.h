@@ -34,6 +34,9 @@
 #include <sys/time.h>  /* for gettimeofday */
 #include <sys/types.h> /* for mkdir */
 #include <errno.h>     /* for errno */
+#include <unistd.h>    /* for unlink, fork */
+#include <sys/wait.h>  /* for waitpid */
+#include <time.h>      /* for time */
 #include "Util.h"
 #include "Utils.h"     /* for GetDateTimeNow, Sleep */
 #include "ExternalConfig.h"
@@ -42,13 +45,26 @@
 #include "OverflowableCharBufferByteSink.h"
 #include "FileByteSource.h"
 #include "FileByteSink.h"
+#include "CharBufferByteSource.h"
 #include "TeeByteSink.h"
+#include "MFZBundle.h"
 #include "itype.h"
 #include "Grid.h"
+#include "GridSnapshot.h"
+#include "GridCheckpoint.h"
+#include "GridDiff.h"
+#include "GridEnsemble.h"
+#include "EpochJobQueue.h"
+#include "MetricsServer.h"
+#include "ViewServer.h"
+#include "DatumStreamer.h"
+#include "FlightRecorder.h"
+#include "StatisticsRing.h"
 #include "ElementTable.h"
 #include "VArguments.h"
 /* #include "StdElements.h" XXX NO LONGER USING? */
 #include "ElementRegistry.h"
+#include "ElementReloader.h"
 #include "Version.h"
 #include "DebugTools.h"
 
@@ -175,72 +191,143 @@ namespace MFM
     virtual void WriteTimeBasedCustomHeader(FileByteSink& fp)
     { }
 
-    virtual void WriteTimeBasedCustomData(FileByteSink& fp)
-    { }
-
-    void WriteTimeBasedData(FileByteSink& fp, bool exists)
+    /**
+     * Store up to maxValues custom numbers for this epoch's
+     * tbd/data.dat line in values, returning how many were stored.
+     * They are printed, as integers, after the element counts.
+     */
+    virtual u32 CaptureTimeBasedCustomData(u64 * values, u32 maxValues)
     {
+      return 0;
+    }
 
-      if(!exists)
+    void WriteTimeBasedHeader(FileByteSink& fp)
+    {
+      fp.Printf("# AEPS AEPS/Frame AER100 Overhead100");
+      for(u32 i = 0; i < m_neededElementCount; i++)
       {
-        fp.Printf("# AEPS AEPS/Frame AER100 Overhead100");
-        for(u32 i = 0; i < m_neededElementCount; i++)
+        fp.WriteByte(' ');
+        for(const char* p = m_neededElements[i]->GetName(); *p; p++)
         {
-          fp.WriteByte(' ');
-          for(const char* p = m_neededElements[i]->GetName(); *p; p++)
+          if(isspace(*p))
           {
-            if(isspace(*p))
-            {
-              fp.WriteByte('_');
-            }
-            else
-            {
-              fp.WriteByte(*p);
-            }
+            fp.WriteByte('_');
+          }
+          else
+          {
+            fp.WriteByte(*p);
           }
         }
-        WriteTimeBasedCustomHeader(fp);
-        fp.Println();
+      }
+      WriteTimeBasedCustomHeader(fp);
+      fp.Println();
+    }
+
+    enum {
+      TBD_RING_SAMPLES = 32,
+      TBD_FIXED_VALUES = 4,      // AEPS, AEPS/Frame, AER100, Overhead100
+      TBD_MAX_CUSTOM_VALUES = 16,
+      TBD_MAX_VALUES = TBD_FIXED_VALUES + MAX_NEEDED_ELEMENTS + TBD_MAX_CUSTOM_VALUES
+    };
+
+    /**
+     * Sample this epoch's time based data, as numbers, into the
+     * ring.  Nothing is formatted or written until the ring fills or
+     * FlushTimeBasedData is called.
+     */
+    void WriteTimeBasedData()
+    {
+      if (m_timeBasedData.IsFull())
+      {
+        FlushTimeBasedData();
       }
 
-      fp.Print((u64)GetAEPS());
-      fp.WriteByte(' ');
-      fp.Print(GetAEPSPerFrame());
-      fp.WriteByte(' ');
-      fp.Print((u64)(100.0 * GetAER()));
-      fp.WriteByte(' ');
-      fp.Print((u64)(100.0 * GetOverheadPercent()));
+      u64 values[TBD_MAX_VALUES];
+      u32 n = 0;
+      values[n++] = (u64) GetAEPS();
+      values[n++] = GetAEPSPerFrame();
+      values[n++] = (u64)(100.0 * GetAER());
+      values[n++] = (u64)(100.0 * GetOverheadPercent());
 
       for(u32 i = 0; i < m_neededElementCount; i++)
       {
-        fp.WriteByte(' ');
-        fp.Print((u32)GetGrid().GetAtomCount(m_neededElements[i]->GetType()));
+        values[n++] = GetGrid().GetAtomCount(m_neededElements[i]->GetType());
       }
 
-      WriteTimeBasedCustomData(fp);
-      fp.Println();
+      n += MIN((u32) TBD_MAX_CUSTOM_VALUES,
+               CaptureTimeBasedCustomData(&values[n], TBD_MAX_CUSTOM_VALUES));
+
+      u64 * sample = m_timeBasedData.Append(n);
+      for (u32 i = 0; i < n; ++i)
+      {
+        sample[i] = values[i];
+      }
     }
 
-    void WriteTimeBasedData()
+    /**
+     * Format every sampled line, and queue them to be appended to
+     * tbd/data.dat, starting it with a header if it is new, and
+     * empty the ring.
+     */
+    void FlushTimeBasedData()
     {
-      const char* path = GetSimDirPathTemporary("tbd/data.dat");
-      bool exists = true;
+      if (m_timeBasedData.GetCount() == 0)
       {
-        FILE* fp = fopen(path, "r");
-        if (!fp)
-        {
-          exists = false;
-        }
-        else
+        return;
+      }
+
+      m_epochJobs.BeginFile(GetSimDirPathTemporary("tbd/data.dat"), true);
+      WriteTimeBasedHeader(m_epochJobs.GetHeaderSink());
+      FileByteSink & fbs = m_epochJobs.GetSink();
+
+      for (u32 s = 0; s < m_timeBasedData.GetCount(); ++s)
+      {
+        u32 n;
+        const u64 * sample = m_timeBasedData.Get(s, n);
+        for (u32 i = 0; i < n; ++i)
         {
-          fclose(fp);
+          if (i > 0)
+          {
+            fbs.WriteByte(' ');
+          }
+          fbs.Print(sample[i]);
         }
+        fbs.Println();
       }
-      FILE* fp = fopen(path, "a");
-      FileByteSink fbs(fp);
+      m_epochJobs.EndFile();
+      m_timeBasedData.Clear();
+    }
 
-      WriteTimeBasedData(fbs, exists);
-      fclose(fp);
+    /**
+     * Queue a rewrite of tbd/elementprofile.csv with the grid's
+     * element profile so far, if --elementprofile is on.
+     */
+    void WriteElementProfile()
+    {
+      if (!m_grid.IsElementProfiling())
+      {
+        return;
+      }
+      m_epochJobs.BeginFile(GetSimDirPathTemporary("tbd/elementprofile.csv"), false);
+      m_grid.WriteElementProfileCSV(m_epochJobs.GetSink());
+      m_epochJobs.EndFile();
+    }
+
+    /**
+     * Queue this epoch's per-tile statistics to be appended to
+     * tbd/tilestats.csv, starting it with a header if it is new, if
+     * --tileStats is on.
+     */
+    void WriteTileStats(u32 epochAEPS)
+    {
+      if (!m_tileStats)
+      {
+        return;
+      }
+      m_epochJobs.BeginFile(GetSimDirPathTemporary("tbd/tilestats.csv"), true);
+      OurGrid::WriteTileStatsHeader(m_epochJobs.GetHeaderSink());
+      m_grid.WriteTileStatsRecord(m_epochJobs.GetSink(), epochAEPS);
+      m_epochJobs.EndFile();
     }
 
     void XXXCHECKCACHES() { m_grid.CheckCaches(); }
@@ -255,21 +342,55 @@ namespace MFM
      */
     void UpdateGrid(OurGrid& grid)
     {
-      grid.Unpause();  // pausing and unpausing should be overhead!
+      StartUpdateGrid(grid);
+      if (!IsStepping())
+        SleepUsec(m_microsSleepPerFrame);
+      FinishUpdateGrid(grid);
+    }
+
+    /**
+     * The first half of UpdateGrid(): unpauses \c grid and starts
+     * timing the update period.  A caller with other work to overlap
+     * with the running grid -- like a GUI preparing the next frame --
+     * can do it between this and FinishUpdateGrid(), sleeping out
+     * whatever remains of GetMicrosSleepPerFrame().  Under
+     * --deterministic the grid stays paused, and FinishUpdateGrid()
+     * runs one Grid::RunDeterministicStep instead -- or, under
+     * --sweep, one Grid::RunSweepStep.
+     */
+    void StartUpdateGrid(OurGrid& grid)
+    {
+      if (!IsStepping())
+        grid.Unpause();  // pausing and unpausing should be overhead!
 
-      u64 startMS = GetTicks();  // So get the ticks after unpausing
+      m_ticksLastStarted = GetTicks();  // So get the ticks after unpausing
       if (m_ticksLastStopped != 0)
-        m_msSpentOverhead += startMS - m_ticksLastStopped;
+        m_msSpentOverhead += m_ticksLastStarted - m_ticksLastStopped;
       else
         m_msSpentOverhead = 0;
+    }
 
-      SleepUsec(m_microsSleepPerFrame);
+    /**
+     * The second half of UpdateGrid(): pauses \c grid, then updates
+     * the statistics and AEPS-per-frame pacing and handles any epoch
+     * that has come due.
+     */
+    void FinishUpdateGrid(OurGrid& grid)
+    {
+      if (m_deterministicEvents)
+        grid.RunDeterministicStep(m_deterministicEvents);
+      else if (m_sweepsPerStep)
+        grid.RunSweepStep(m_sweepsPerStep);
 
       m_ticksLastStopped = GetTicks(); // and before pausing
 
-      grid.Pause();
+      if (!IsStepping())
+        grid.Pause();
 
-      u32 thisPeriodMS = m_ticksLastStopped - startMS;
+      if (m_reloadLibraries)
+        ReloadChangedLibraries();
+
+      u32 thisPeriodMS = m_ticksLastStopped - m_ticksLastStarted;
       m_msSpentRunning += thisPeriodMS;
 
       if (thisPeriodMS == 0) {
@@ -337,9 +458,108 @@ namespace MFM
 
       CheckEpochProcessing(grid);
 
+      PublishMetrics(grid);
+
+      PublishView(grid);
+
       PostUpdate();
     }
 
+    enum { METRICS_PUBLISH_MS = 1000 };
+
+    /**
+     * If --metricsPort is serving, and it's been METRICS_PUBLISH_MS
+     * since the last time, format the current rates, atom counts and
+     * cache traffic into a fresh metrics page.  Scrapes only ever
+     * read the published page, so they never touch the grid, and
+     * the counts come from the tiles' published stats (see
+     * Grid::GetPublishedTotal), so neither does this.
+     */
+    void PublishMetrics(OurGrid& grid)
+    {
+      if (!m_metricsServer.IsRunning())
+      {
+        return;
+      }
+      const u64 now = GetTicks();
+      if (m_metricsPublishedTicks != 0 && now < m_metricsPublishedTicks + METRICS_PUBLISH_MS)
+      {
+        return;
+      }
+      m_metricsPublishedTicks = now;
+
+      m_metricsServer.BeginUpdate();
+      ByteSink & bs = m_metricsServer.GetUpdateSink();
+
+      bs.Printf("# TYPE mfm_aeps gauge\nmfm_aeps %f\n", m_AEPS);
+      bs.Printf("# TYPE mfm_aer gauge\nmfm_aer %f\n", m_AER);
+      bs.Printf("# TYPE mfm_recent_aer gauge\nmfm_recent_aer %f\n", m_recentAER);
+      bs.Printf("# TYPE mfm_overhead_percent gauge\nmfm_overhead_percent %f\n", m_overheadPercent);
+      bs.Printf("# TYPE mfm_epochs counter\nmfm_epochs %d\n", m_epochCount);
+      bs.Printf("# TYPE mfm_next_epoch_aeps gauge\nmfm_next_epoch_aeps %d\n", m_nextEpochAEPS);
+      bs.Printf("# TYPE mfm_aeps_per_epoch gauge\nmfm_aeps_per_epoch %d\n", m_AEPSPerEpoch);
+      bs.Printf("# TYPE mfm_epoch_stall_ms_total counter\nmfm_epoch_stall_ms_total ");
+      bs.Print(m_totalEpochStallMS);
+      bs.Println();
+      bs.Printf("# TYPE mfm_epoch_stall_ms_max gauge\nmfm_epoch_stall_ms_max ");
+      bs.Print(m_maxEpochStallMS);
+      bs.Println();
+
+      bs.Printf("# TYPE mfm_events_total counter\nmfm_events_total ");
+      bs.Print(grid.GetPublishedTotal(TileStatsTree::EVENTS));
+      bs.Println();
+
+      bs.Printf("# TYPE mfm_cache_packets_shipped_total counter\nmfm_cache_packets_shipped_total ");
+      bs.Print(grid.GetPublishedTotal(TileStatsTree::CACHE_PACKETS_SHIPPED));
+      bs.Printf("\n# TYPE mfm_cache_bytes_shipped_total counter\nmfm_cache_bytes_shipped_total ");
+      bs.Print(grid.GetPublishedTotal(TileStatsTree::CACHE_BYTES_SHIPPED));
+      bs.Println();
+
+      bs.Printf("# TYPE mfm_atoms gauge\n");
+      for (u32 i = 0; i < m_neededElementCount; ++i)
+      {
+        const Element<EC> * elt = m_neededElements[i];
+        bs.Printf("mfm_atoms{element=\"%s\"} %d\n",
+                  elt->GetName(), grid.GetPublishedAtomCount(elt->GetType()));
+      }
+
+      m_metricsServer.EndUpdate();
+    }
+
+    enum { VIEW_PUBLISH_MS = 100 };
+
+    /**
+     * If --viewPort is serving someone, and it's been VIEW_PUBLISH_MS
+     * since the last time, hand the grid's site types to the view
+     * server, which codes and sends them on its own thread.  With no
+     * viewers connected this costs nothing.
+     */
+    void PublishView(OurGrid& grid)
+    {
+      if (!m_viewServer.IsRunning() || m_viewServer.GetViewerCount() == 0)
+      {
+        return;
+      }
+      const u64 now = GetTicks();
+      if (m_viewPublishedTicks != 0 && now < m_viewPublishedTicks + VIEW_PUBLISH_MS)
+      {
+        return;
+      }
+      m_viewPublishedTicks = now;
+
+      grid.GetSiteTypes(m_viewServer.BeginPublish(grid.GetWidthSites(), grid.GetHeightSites()));
+      m_viewServer.EndPublish();
+    }
+
+    /**
+     * How long each UpdateGrid() currently lets the grid run, as
+     * tuned to approach \c m_aepsPerFrame AEPS per update.
+     */
+    u32 GetMicrosSleepPerFrame() const
+    {
+      return (u32) m_microsSleepPerFrame;
+    }
+
     /**
      * Reduce the \c m_aepsPerFrame (or, the number of AEPS which
      * should elapse every call to \c UpdateGrid() ), keeping it above
@@ -399,6 +619,8 @@ namespace MFM
       }
 
       PostReinitPhysics();
+
+      GetGrid().FreezeElementTables();
     }
 
     /**
@@ -471,6 +693,109 @@ namespace MFM
       }
 #endif
       
+      MakeSimDirs(args);
+
+      if (m_replicas > 0 && (m_metricsPort || m_viewPort || m_streamIn || m_streamOut))
+      {
+        args.Die("--replicas can't share ports or datum streams between replicas");
+      }
+
+      if (m_deterministicEvents && m_sweepsPerStep)
+      {
+        args.Die("Pick one of --deterministic and --sweep");
+      }
+
+      if (m_metricsPort > 0)
+      {
+        m_metricsServer.Start((u16) m_metricsPort);
+      }
+
+      if (m_viewPort > 0)
+      {
+        m_viewServer.Start((u16) m_viewPort);
+      }
+
+      NoteStartupPhase("simulation directories");
+
+      m_elementRegistry.Init(m_grid.GetUlamClassRegistry());
+      NoteLibraryMTimes();
+      NoteStartupPhase("library loading");
+
+      u32 dlcount = m_elementRegistry.GetRegisteredElementCount();
+      const UlamClass<EC> * uempty = m_grid.GetUlamClassRegistry().GetUlamElementEmpty();
+      for (u32 i = 0; i < dlcount; ++i)
+      {
+        Element<EC> * elt = m_elementRegistry.GetRegisteredElement(i);
+        // Lazily, everything but Empty waits until something names it
+        if (!m_lazyElements || (uempty && elt->AsUlamElement() == uempty))
+          NeedElement(elt);
+      }
+      if (m_lazyElements)
+      {
+        LOG.Message("Deferring %d library element(s) until named", dlcount);
+        m_grid.SetDeferredElements(&m_elementRegistry);
+      }
+
+      DefineNeededElements();
+      NoteStartupPhase("element registration");
+    }
+
+    /**
+     * Remember when each element library was last modified, so
+     * --reload-libraries can tell when one is rebuilt.
+     */
+    void NoteLibraryMTimes()
+    {
+      for (u32 i = 0; i < m_elementRegistry.GetLibraryPathsCount(); ++i)
+      {
+        struct stat st;
+        m_libraryMTimes[i] =
+          stat(m_elementRegistry.GetLibraryPath(i), &st) ? 0 : st.st_mtime;
+      }
+    }
+
+    /**
+     * Under --reload-libraries, at most once a second, reload each
+     * element library rebuilt since it was last loaded -- once its
+     * file has sat untouched for a second, so it isn't caught half
+     * written.  A library that fails to reload is retried only when
+     * it changes again.  The grid must be paused.
+     */
+    void ReloadChangedLibraries()
+    {
+      const u64 now = GetTicks();
+      if (now < m_ticksLastReloadCheck + 1000)
+        return;
+      m_ticksLastReloadCheck = now;
+
+      const time_t secs = time(0);
+      for (u32 i = 0; i < m_elementRegistry.GetLibraryPathsCount(); ++i)
+      {
+        const char * path = m_elementRegistry.GetLibraryPath(i);
+        struct stat st;
+        if (stat(path, &st) || st.st_mtime == m_libraryMTimes[i] || st.st_mtime >= secs - 1)
+          continue;             // Gone, unchanged, or maybe still being written
+        m_libraryMTimes[i] = st.st_mtime;
+
+        if (m_elementReloader.Reload(path) < 0)
+          continue;
+        for (u32 j = 0; j < m_elementReloader.GetReplacedCount(); ++j)
+        {
+          for (u32 k = 0; k < m_neededElementCount; ++k)
+          {
+            if (m_neededElements[k] == m_elementReloader.GetOldElement(j))
+              m_neededElements[k] = m_elementReloader.GetNewElement(j);
+          }
+        }
+      }
+    }
+
+    /**
+     * Make the simulation directory and its sub-directories, dying
+     * (via \a args) if any of them can't be made.
+     */
+    void MakeSimDirs(VArguments& args)
+    {
       const char* (subs[]) =
       {
         "", "vid", "eps", "tbd", "teps", "save", "screenshot", "autosave", "log"
@@ -485,15 +810,6 @@ namespace MFM
                    path, strerror(errno));
         }
       }
-
-      m_elementRegistry.Init(m_grid.GetUlamClassRegistry());
-      u32 dlcount = m_elementRegistry.GetRegisteredElementCount();
-      for (u32 i = 0; i < dlcount; ++i)
-      {
-        NeedElement(m_elementRegistry.GetRegisteredElement(i));
-      }
-
-      DefineNeededElements();
     }
 
     /**
@@ -522,13 +838,25 @@ namespace MFM
          )
       {
         // Free final save if halting on --halt*.  Hope for good-looking corpse.
+        if (m_compressedSave)
+        {
+          const char* filename =
+            GetSimDirPathTemporary("save/final-%D-%D.mfz", m_epochCount, (u32) m_AEPS);
+          SaveGridCompressedAsync(filename);
+        }
+        else
         {
           const char* filename =
             GetSimDirPathTemporary("save/final-%D-%D.mfs", m_epochCount, (u32) m_AEPS);
           SaveGrid(filename);
         }
+        m_snapshotWriter.Finish();
         WriteTimeBasedData();
+        FlushTimeBasedData();
+        WriteElementProfile();
+        m_epochJobs.Finish();
         m_grid.ShutdownTileThreads();
+        m_datumStreamer.Stop();
         return false;
       }
       return true;
@@ -851,6 +1179,58 @@ namespace MFM
       ((AbstractDriver*)driver)->m_tileImages = 1;
     }
 
+    static void SetEPSBins(const char* not_needed, void* driver)
+    {
+      ((AbstractDriver*)driver)->m_epsBins = true;
+    }
+
+    static void SetTileStats(const char* not_needed, void* driver)
+    {
+      ((AbstractDriver*)driver)->m_tileStats = true;
+    }
+
+    static void SetMetricsPortFromArgs(const char* port, void* driverptr)
+    {
+      AbstractDriver& driver = *((AbstractDriver*)driverptr);
+      VArguments& args = driver.m_varguments;
+
+      s32 out;
+      const char * errmsg = AbstractDriver<GC>::GetNumberFromString(port, out, 1, 65535);
+      if (errmsg)
+      {
+        args.Die("Bad metrics port '%s': %s", port, errmsg);
+      }
+
+      driver.m_metricsPort = (u32) out;
+    }
+
+    static void SetViewPortFromArgs(const char* port, void* driverptr)
+    {
+      AbstractDriver& driver = *((AbstractDriver*)driverptr);
+      VArguments& args = driver.m_varguments;
+
+      s32 out;
+      const char * errmsg = AbstractDriver<GC>::GetNumberFromString(port, out, 1, 65535);
+      if (errmsg)
+      {
+        args.Die("Bad view port '%s': %s", port, errmsg);
+      }
+
+      driver.m_viewPort = (u32) out;
+    }
+
+    static void SetStreamInFromArgs(const char* spec, void* driverptr)
+    {
+      AbstractDriver& driver = *((AbstractDriver*)driverptr);
+      driver.m_streamIn = spec;
+    }
+
+    static void SetStreamOutFromArgs(const char* spec, void* driverptr)
+    {
+      AbstractDriver& driver = *((AbstractDriver*)driverptr);
+      driver.m_streamOut = spec;
+    }
+
     static void SetDataDirFromArgs(const char* dirPath, void* driverPtr)
     {
       AbstractDriver& driver = *((AbstractDriver*)driverPtr);
@@ -898,6 +1278,16 @@ namespace MFM
       }
     }
 
+    static void SetLazyElementsFromArgs(const char* not_needed, void* driver)
+    {
+      ((AbstractDriver*)driver)->m_lazyElements = true;
+    }
+
+    static void SetReloadLibrariesFromArgs(const char* not_needed, void* driver)
+    {
+      ((AbstractDriver*)driver)->m_reloadLibraries = true;
+    }
+
     static void IgnoreComment(const char* kv, void* driverptr)
     {
       // A Good Job Well Done!
@@ -931,6 +1321,42 @@ namespace MFM
       driver.m_haltAfterAEPS = (u32) out;
     }
 
+    static void SetDeterministicFromArgs(const char* events, void* driverptr)
+    {
+      AbstractDriver& driver = *((AbstractDriver*)driverptr);
+      VArguments& args = driver.m_varguments;
+
+      s32 out;
+      const char * errmsg = AbstractDriver<GC>::GetNumberFromString(events, out, 1, S32_MAX);
+      if (errmsg)
+      {
+        args.Die("Bad events per tile '%s': %s", events, errmsg);
+      }
+
+      driver.m_deterministicEvents = (u32) out;
+    }
+
+    static void SetSweepFromArgs(const char* sweeps, void* driverptr)
+    {
+      AbstractDriver& driver = *((AbstractDriver*)driverptr);
+      VArguments& args = driver.m_varguments;
+
+      s32 out;
+      const char * errmsg = AbstractDriver<GC>::GetNumberFromString(sweeps, out, 1, S32_MAX);
+      if (errmsg)
+      {
+        args.Die("Bad sweeps per tile '%s': %s", sweeps, errmsg);
+      }
+
+      driver.m_sweepsPerStep = (u32) out;
+    }
+
+    /** True if the grid runs in paused lockstep steps, not free-running */
+    bool IsStepping() const
+    {
+      return m_deterministicEvents || m_sweepsPerStep;
+    }
+
     static void SetEdenSeedFromArgs(const char* symbol, void* driverptr)
     {
       AbstractDriver& driver = *((AbstractDriver*)driverptr);
@@ -977,30 +1403,324 @@ namespace MFM
       driver.m_grid.SetWarpFactor(out);
     }
 
-    static void LoadFromConfigFile(const char* path, void* driverptr)
+    static void SetTilePoolFromArgs(const char* threads, void* driverptr)
     {
       AbstractDriver& driver = *((AbstractDriver*)driverptr);
       VArguments& args = driver.m_varguments;
 
-      if (driver.m_configurationPathCount >= MAX_CONFIGURATION_PATHS)
+      s32 out;
+      const char * errmsg = AbstractDriver<GC>::GetNumberFromString(threads, out, 0, OurGrid::MAX_TILES_SUPPORTED);
+      if (errmsg)
       {
-        args.Die("Too many configuration paths, max %d, for '%s'",
-                 MAX_CONFIGURATION_PATHS,
-                 path);
+        args.Die("Bad tile pool thread count '%s': %s", threads, errmsg);
       }
-      driver.m_configurationPaths[driver.m_configurationPathCount] = path;
-      ++driver.m_configurationPathCount;
+
+      driver.m_grid.SetTilePool(true, (u32) out);
     }
 
-    void CheckEpochProcessing(OurGrid& grid)
+    static void SetInitThreadsFromArgs(const char* threads, void* driverptr)
     {
-      if (m_AEPSPerEpoch >= 0 || m_accelerateAfterEpochs > 0 || m_surgeAfterEpochs > 0)
+      AbstractDriver& driver = *((AbstractDriver*)driverptr);
+      VArguments& args = driver.m_varguments;
+
+      s32 out;
+      const char * errmsg = AbstractDriver<GC>::GetNumberFromString(threads, out, 0, OurGrid::MAX_TILES_SUPPORTED);
+      if (errmsg)
       {
-        if (m_AEPS >= m_nextEpochAEPS)
-        {
-          DoEpochEvents(grid, m_epochCount, m_nextEpochAEPS);
-          m_nextEpochAEPS += m_AEPSPerEpoch;
-          ++m_epochCount;
+        args.Die("Bad init thread count '%s': %s", threads, errmsg);
+      }
+
+      driver.m_grid.SetInitThreads((u32) out);
+    }
+
+    static void SetSiteThreadsFromArgs(const char* threads, void* driverptr)
+    {
+      AbstractDriver& driver = *((AbstractDriver*)driverptr);
+      VArguments& args = driver.m_varguments;
+
+      s32 out;
+      const char * errmsg =
+        AbstractDriver<GC>::GetNumberFromString(threads, out, 0,
+                                                ExternalConfigSectionGrid<GC>::MAX_SITE_THREADS);
+      if (errmsg)
+      {
+        args.Die("Bad site thread count '%s': %s", threads, errmsg);
+      }
+
+      driver.m_externalConfigSectionGrid.SetSiteThreads((u32) out);
+    }
+
+    static void SetAsyncLogging(const char* not_needed, void* driver)
+    {
+      LOG.SetAsync(true);
+    }
+
+    static void SetNUMAPlacement(const char* not_needed, void* driver)
+    {
+      ((AbstractDriver*)driver)->m_grid.SetNUMAPlacement(true);
+    }
+
+    static void SetHugePages(const char* not_needed, void* driver)
+    {
+      ((AbstractDriver*)driver)->m_grid.SetHugePages(true);
+    }
+
+    static void SetOrderedTileControl(const char* not_needed, void* driver)
+    {
+      ((AbstractDriver*)driver)->m_grid.SetOrderedTileControl(true);
+    }
+
+    static void SetDirectChannels(const char* not_needed, void* driver)
+    {
+      ((AbstractDriver*)driver)->m_grid.SetDirectChannels(true);
+    }
+
+    static void SetSparseEvents(const char* not_needed, void* driver)
+    {
+      ((AbstractDriver*)driver)->m_grid.SetSparseEvents(true);
+    }
+
+    static void SetOptimisticEvents(const char* not_needed, void* driver)
+    {
+      ((AbstractDriver*)driver)->m_grid.SetOptimisticEvents(true);
+    }
+
+    static void SetCompactCache(const char* not_needed, void* driver)
+    {
+      ((AbstractDriver*)driver)->m_grid.SetCompactCache(true);
+    }
+
+    static void SetQuiescentSleep(const char* not_needed, void* driver)
+    {
+      ((AbstractDriver*)driver)->m_grid.SetQuiescentSleep(true);
+    }
+
+    static void SetActivityScheduling(const char* not_needed, void* driver)
+    {
+      ((AbstractDriver*)driver)->m_grid.SetActivityScheduling(true);
+    }
+
+    static void SetAgedEvents(const char* not_needed, void* driver)
+    {
+      ((AbstractDriver*)driver)->m_grid.SetAgedEvents(true);
+    }
+
+    static void SetElementProfiling(const char* not_needed, void* driver)
+    {
+      ((AbstractDriver*)driver)->m_grid.SetElementProfiling(true);
+    }
+
+    static void SetBinaryAutosave(const char* not_needed, void* driver)
+    {
+      ((AbstractDriver*)driver)->m_binaryAutosave = true;
+    }
+
+    static void SetCompressedSave(const char* not_needed, void* driver)
+    {
+      ((AbstractDriver*)driver)->m_compressedSave = true;
+    }
+
+    static void SetDeltaAutosaveFromArgs(const char* arg, void* driverptr)
+    {
+      AbstractDriver& driver = *((AbstractDriver*)driverptr);
+      VArguments& args = driver.m_varguments;
+
+      s32 out;
+      const char * errmsg = AbstractDriver<GC>::GetNumberFromString(arg, out, 1, S32_MAX);
+      if (errmsg)
+      {
+        args.Die("Bad delta autosave count '%s': %s", arg, errmsg);
+      }
+
+      driver.m_deltaAutosave = (u32) out;
+    }
+
+    static void SetMFSCache(const char* not_needed, void* driver)
+    {
+      ((AbstractDriver*)driver)->m_mfsCache = true;
+    }
+
+    static void SetDiffPathFromArgs(const char* path, void* driver)
+    {
+      ((AbstractDriver*)driver)->m_diffPath = path;
+    }
+
+    static void SetReplicasFromArgs(const char* count, void* driverptr)
+    {
+      AbstractDriver& driver = *((AbstractDriver*)driverptr);
+      VArguments& args = driver.m_varguments;
+
+      s32 out;
+      const char * errmsg = AbstractDriver<GC>::GetNumberFromString(count, out, 1, MAX_REPLICAS);
+      if (errmsg)
+      {
+        args.Die("Bad replica count '%s': %s", count, errmsg);
+      }
+
+      driver.m_replicas = (u32) out;
+    }
+
+    static void SetEnsemblePathFromArgs(const char* path, void* driver)
+    {
+      ((AbstractDriver*)driver)->m_ensemblePath = path;
+    }
+
+    static void SetEnsembleThreadsFromArgs(const char* threads, void* driverptr)
+    {
+      AbstractDriver& driver = *((AbstractDriver*)driverptr);
+      VArguments& args = driver.m_varguments;
+
+      s32 out;
+      const char * errmsg =
+        AbstractDriver<GC>::GetNumberFromString(threads, out, 0, GridEnsemble<GC>::MAX_RUNS);
+      if (errmsg)
+      {
+        args.Die("Bad ensemble thread count '%s': %s", threads, errmsg);
+      }
+
+      driver.m_ensembleThreads = (u32) out;
+    }
+
+    static void SetCacheBatchFromArgs(const char* sites, void* driverptr)
+    {
+      AbstractDriver& driver = *((AbstractDriver*)driverptr);
+      VArguments& args = driver.m_varguments;
+
+      s32 out;
+      const char * errmsg = AbstractDriver<GC>::GetNumberFromString(sites, out, 0, EVENT_WINDOW_SITES(OurGrid::R));
+      if (errmsg)
+      {
+        args.Die("Bad cache batch size '%s': %s", sites, errmsg);
+      }
+
+      driver.m_grid.SetCacheBatchLimit((u32) out);
+    }
+
+    static void SetLockSpinFromArgs(const char* spins, void* driverptr)
+    {
+      AbstractDriver& driver = *((AbstractDriver*)driverptr);
+      VArguments& args = driver.m_varguments;
+
+      s32 out;
+      const char * errmsg = AbstractDriver<GC>::GetNumberFromString(spins, out, 0, 100000);
+      if (errmsg)
+      {
+        args.Die("Bad lock spin count '%s': %s", spins, errmsg);
+      }
+
+      driver.m_grid.SetLockSpinCount((u32) out);
+    }
+
+    static void SetEventBatchFromArgs(const char* size, void* driverptr)
+    {
+      AbstractDriver& driver = *((AbstractDriver*)driverptr);
+      VArguments& args = driver.m_varguments;
+
+      s32 out;
+      const char * errmsg = AbstractDriver<GC>::GetNumberFromString(size, out, 0, EventWindowBatch<EC>::MAX_EVENTS);
+      if (errmsg)
+      {
+        args.Die("Bad event batch size '%s': %s", size, errmsg);
+      }
+
+      driver.m_grid.SetEventBatchSize((u32) out);
+    }
+
+    static void SetEventWorkersFromArgs(const char* workers, void* driverptr)
+    {
+      AbstractDriver& driver = *((AbstractDriver*)driverptr);
+      VArguments& args = driver.m_varguments;
+
+      s32 out;
+      const char * errmsg = AbstractDriver<GC>::GetNumberFromString(workers, out, 0, EventWorkers<EC>::MAX_WORKERS);
+      if (errmsg)
+      {
+        args.Die("Bad event worker count '%s': %s", workers, errmsg);
+      }
+
+      driver.m_grid.SetEventWorkers((u32) out);
+    }
+
+    static void LoadFromConfigFile(const char* path, void* driverptr)
+    {
+      AbstractDriver& driver = *((AbstractDriver*)driverptr);
+      VArguments& args = driver.m_varguments;
+
+      if (driver.m_configurationPathCount >= MAX_CONFIGURATION_PATHS)
+      {
+        args.Die("Too many configuration paths, max %d, for '%s'",
+                 MAX_CONFIGURATION_PATHS,
+                 path);
+      }
+      driver.m_configurationPaths[driver.m_configurationPathCount] = path;
+      ++driver.m_configurationPathCount;
+    }
+
+    /**
+     * Use the .mfz physics bundle at \a path as mfzrun would, but
+     * without unpacking it: its libcue.so is added as an element
+     * library, extracted only if the bundle's copy isn't cached
+     * already, and its .mfs configurations are added as
+     * configuration paths, read straight out of the bundle.
+     */
+    static void LoadFromBundle(const char* path, void* driverptr)
+    {
+      AbstractDriver& driver = *((AbstractDriver*)driverptr);
+      VArguments& args = driver.m_varguments;
+      MFZBundle & bundle = driver.m_bundle;
+
+      if (bundle.IsOpen())
+      {
+        args.Die("Only one --mfz allowed");
+      }
+      const char * err = bundle.Open(path);
+      if (err)
+      {
+        args.Die("Can't open bundle '%s': %s", path, err);
+      }
+
+      OString512 cacheDir;
+      MFZBundle::GetDefaultCacheDir(cacheDir);
+      for (u32 i = 0; i < bundle.GetMemberCount(); ++i)
+      {
+        const char * name = bundle.GetMemberBaseName(i);
+        const u32 len = strlen(name);
+        if (!strcmp(name, "libcue.so"))
+        {
+          OString512 libPath;
+          err = bundle.ExtractMember(i, cacheDir.GetZString(), libPath);
+          if (err)
+          {
+            args.Die("Can't extract '%s' from bundle '%s': %s", bundle.GetMemberName(i), path, err);
+          }
+          RegisterElementLibraryPath(libPath.GetZString(), driverptr);
+        }
+        else if (len > 4 && !strcmp(name + len - 4, ".mfs"))
+        {
+          // The member's name stands for it; see LoadMFS
+          LoadFromConfigFile(bundle.GetMemberName(i), driverptr);
+        }
+        else if (!strcmp(name, "args.txt"))
+        {
+          LOG.Warning("Ignoring '%s' in bundle '%s'; give its arguments on the command line",
+                      bundle.GetMemberName(i), path);
+        }
+      }
+      LOG.Message("Using bundle '%s' (%s), %d member(s)",
+                  path, bundle.GetBundleName(), bundle.GetMemberCount());
+    }
+
+    void CheckEpochProcessing(OurGrid& grid)
+    {
+      if (m_AEPSPerEpoch >= 0 || m_accelerateAfterEpochs > 0 || m_surgeAfterEpochs > 0)
+      {
+        if (m_AEPS >= m_nextEpochAEPS)
+        {
+          const u64 startMS = GetTicksSinceEpoch();
+          DoEpochEvents(grid, m_epochCount, m_nextEpochAEPS);
+          NoteEpochStall(startMS);
+          m_nextEpochAEPS += m_AEPSPerEpoch;
+          ++m_epochCount;
         }
       }
     }
@@ -1156,9 +1876,58 @@ namespace MFM
 
     void AutosaveGrid(u32 epochs)
     {
+      if (m_deltaAutosave > 0)
+      {
+        AutosaveCheckpoint(epochs);
+        return;
+      }
+      if (m_compressedSave)
+      {
+        const char* filename =
+          GetSimDirPathTemporary("autosave/%D-%D.mfz", epochs, (u32) m_AEPS);
+        SaveGridCompressedAsync(filename);
+        return;
+      }
+      if (m_binaryAutosave)
+      {
+        const char* filename =
+          GetSimDirPathTemporary("autosave/%D-%D.mfb", epochs, (u32) m_AEPS);
+        SaveGridSnapshotAsync(filename);
+        return;
+      }
       const char* filename =
         GetSimDirPathTemporary("autosave/%D-%D.mfs", epochs, (u32) m_AEPS);
-      SaveGrid(filename);
+      SaveGridAsync(filename);
+    }
+
+    /**
+     * Autosave a full .mfb snapshot every m_deltaAutosave autosaves,
+     * and in between just the blocks changed since the last one, as
+     * a .mfd delta chained to it.  Loading the latest .mfd restores
+     * the whole chain.
+     */
+    void AutosaveCheckpoint(u32 epochs)
+    {
+      const u64 startMS = GetTicksSinceEpoch();
+      if (!m_checkpoint.HasChain() || m_checkpoint.GetChainLength() + 1 >= m_deltaAutosave)
+      {
+        const char* filename =
+          GetSimDirPathTemporary("autosave/%D-%D.mfb", epochs, (u32) m_AEPS);
+        LOG.Message("Saving snapshot to: %s", filename);
+        m_checkpoint.SaveBase(m_grid, filename);
+      }
+      else
+      {
+        const char* filename =
+          GetSimDirPathTemporary("autosave/%D-%D.mfd", epochs, (u32) m_AEPS);
+        LOG.Message("Saving delta to: %s", filename);
+        if (m_checkpoint.SaveDelta(m_grid, filename))
+        {
+          LOG.Message("Delta saved %d of %d blocks",
+                      m_checkpoint.GetLastBlocksSaved(), m_checkpoint.GetBlockCount());
+        }
+      }
+      NoteSaveStall(startMS);
     }
 
     ExternalConfig<GC> & GetExternalConfig()
@@ -1170,11 +1939,143 @@ namespace MFM
     {
 
       LOG.Message("Saving to: %s", filename);
+      const u64 startMS = GetTicksSinceEpoch();
       FILE* fp = fopen(filename, "w");
       FileByteSink fs(fp);
+      fs.SetBufferBytes(FileByteSink::LARGE_BUFFER_BYTES);
 
       m_externalConfig.Write(fs);
       fs.Close();
+      NoteSaveStall(startMS);
+    }
+
+    /**
+     * Render the (paused) grid as .mfs text in memory, and queue it
+     * to be written to \a filename with the other epoch output, so
+     * the grid is held up only for the rendering.
+     */
+    void SaveGridAsync(const char* filename)
+    {
+      LOG.Message("Saving to: %s", filename);
+      const u64 startMS = GetTicksSinceEpoch();
+      m_epochJobs.BeginFile(filename, false);
+      m_externalConfig.Write(m_epochJobs.GetSink());
+      m_epochJobs.EndFile();
+      NoteSaveStall(startMS);
+    }
+
+    bool SaveGridSnapshot(const char* filename)
+    {
+      LOG.Message("Saving snapshot to: %s", filename);
+      const u64 startMS = GetTicksSinceEpoch();
+      bool ret = GridSnapshot<GC>::Save(m_grid, filename);
+      NoteSaveStall(startMS);
+      return ret;
+    }
+
+    /**
+     * Copy the (paused) grid into the snapshot staging arena and
+     * write it to \a filename on a background thread, so the grid
+     * is held up only for the copy.  Waits first for any previous
+     * background write to finish.
+     */
+    bool SaveGridSnapshotAsync(const char* filename)
+    {
+      LOG.Message("Capturing snapshot for: %s", filename);
+      const u64 startMS = GetTicksSinceEpoch();
+      u32 bytes;
+      bool ret = GridSnapshot<GC>::Capture(m_grid, m_snapshotWriter, bytes);
+      if (ret)
+      {
+        m_snapshotWriter.StartWrite(filename, bytes);
+      }
+      NoteSaveStall(startMS);
+      return ret;
+    }
+
+    /**
+     * Copy the (paused) grid into the snapshot staging arena, as
+     * SaveGridSnapshotAsync does, and compress and write it tile by
+     * tile on background threads as a .mfz compressed snapshot.
+     */
+    bool SaveGridCompressedAsync(const char* filename)
+    {
+      LOG.Message("Capturing compressed snapshot for: %s", filename);
+      const u64 startMS = GetTicksSinceEpoch();
+      bool ret = GridSnapshot<GC>::StartCompressedSave(m_grid, m_snapshotWriter, filename);
+      NoteSaveStall(startMS);
+      return ret;
+    }
+
+    /**
+     * Milliseconds the grid was held paused by the most recent save
+     */
+    u64 GetLastSaveStallMS() const
+    {
+      return m_lastSaveStallMS;
+    }
+
+    /**
+     * Total milliseconds the grid has been held paused by saves
+     */
+    u64 GetTotalSaveStallMS() const
+    {
+      return m_totalSaveStallMS;
+    }
+
+    void NoteSaveStall(u64 startMS)
+    {
+      m_lastSaveStallMS = GetTicksSinceEpoch() - startMS;
+      m_totalSaveStallMS += m_lastSaveStallMS;
+      LOG.Message("Save stalled grid %d ms (%d ms total)",
+                  (u32) m_lastSaveStallMS, (u32) m_totalSaveStallMS);
+    }
+
+    /**
+     * Milliseconds the grid was held paused by the most recent
+     * end-of-epoch processing, saves included
+     */
+    u64 GetLastEpochStallMS() const
+    {
+      return m_lastEpochStallMS;
+    }
+
+    /**
+     * Longest the grid has been held paused by end-of-epoch processing
+     */
+    u64 GetMaxEpochStallMS() const
+    {
+      return m_maxEpochStallMS;
+    }
+
+    /**
+     * Total milliseconds the grid has been held paused by end-of-epoch
+     * processing
+     */
+    u64 GetTotalEpochStallMS() const
+    {
+      return m_totalEpochStallMS;
+    }
+
+    void NoteEpochStall(u64 startMS)
+    {
+      m_lastEpochStallMS = GetTicksSinceEpoch() - startMS;
+      m_totalEpochStallMS += m_lastEpochStallMS;
+      m_maxEpochStallMS = MAX(m_maxEpochStallMS, m_lastEpochStallMS);
+      LOG.Debug("Epoch %d stalled grid %d ms (%d ms total, %d files pending)",
+                m_epochCount, (u32) m_lastEpochStallMS, (u32) m_totalEpochStallMS,
+                m_epochJobs.GetPendingCount());
+    }
+
+    /**
+       Log, at DEBUG, how long startup phase \c phase took, since the
+       last phase ended, and start the next one.
+     */
+    void NoteStartupPhase(const char * phase)
+    {
+      const u64 now = GetTicksSinceEpoch();
+      LOG.Debug("Startup %s: %d ms", phase, (u32) (now - m_startupPhaseMS));
+      m_startupPhaseMS = now;
     }
 
     void LoadFromConfigurationPath()
@@ -1202,8 +2103,44 @@ namespace MFM
       LoadMFS(path);
     }
 
+    /**
+     * The --mfz bundle member whose name \a path is -- the string
+     * LoadFromBundle registered, not just an equal one -- or -1.
+     */
+    s32 FindBundleConfiguration(const char * path) const
+    {
+      for (u32 i = 0; i < m_bundle.GetMemberCount(); ++i)
+      {
+        if (m_bundle.GetMemberName(i) == path)
+          return (s32) i;
+      }
+      return -1;
+    }
+
+    bool LoadBundleMFS(u32 member)
+    {
+      const char * name = m_bundle.GetMemberName(member);
+      const u8 * text = m_bundle.GetMemberData(member);
+      if (!text)
+      {
+        LOG.Error("Can't read configuration '%s' from bundle '%s'", name, m_bundle.GetPath());
+        return false;
+      }
+
+      LOG.Message("Loading configuration '%s' from bundle '%s'", name, m_bundle.GetPath());
+      CharBufferByteSource cbbs((const char *) text, m_bundle.GetMemberBytes(member));
+      m_externalConfig.SetByteSource(cbbs, name);
+      m_externalConfig.Read();
+      LOG.Message("Loaded configuration '%s'", name);
+      return true;
+    }
+
     bool LoadMFS(const char * path)
     {
+      const s32 member = FindBundleConfiguration(path);
+      if (member >= 0)
+        return LoadBundleMFS((u32) member);
+
       OString512 buf;
       // Accept absolute paths and check resource dirs for relative paths
       if (path[0] == '/' || !Utils::GetReadableResourceFile(path, buf))
@@ -1212,15 +2149,42 @@ namespace MFM
       }
       /* else buf filled with resource path */
 
+      const u32 len = buf.GetLength();
+      if (len > 4 && (!strcmp(buf.GetZString() + len - 4, ".mfb") ||
+                      !strcmp(buf.GetZString() + len - 4, ".mfz")))
+      {
+        LOG.Message("Loading snapshot '%s'", buf.GetZString());
+        if (!GridSnapshot<GC>::Load(m_grid, buf.GetZString()))
+          return false;
+        LOG.Message("Loaded snapshot '%s'", buf.GetZString());
+        return true;
+      }
+
+      if (len > 4 && !strcmp(buf.GetZString() + len - 4, ".mfd"))
+      {
+        LOG.Message("Loading delta chain '%s'", buf.GetZString());
+        if (!m_checkpoint.Restore(m_grid, buf.GetZString()))
+          return false;
+        LOG.Message("Loaded delta chain '%s'", buf.GetZString());
+        return true;
+      }
+
+      u64 hash = 0, bytes = 0;
+      const bool cacheable = m_mfsCache && HashConfigFile(buf.GetZString(), hash, bytes);
+      if (cacheable && LoadMFSCache(buf.GetZString(), hash, bytes))
+        return true;
+
       LOG.Message("Loading configuration '%s'", buf.GetZString());
 
       FileByteSource fs(buf.GetZString());
       if (fs.IsOpen())
       {
         m_externalConfig.SetByteSource(fs, buf.GetZString());
-        m_externalConfig.Read();
+        const bool ok = m_externalConfig.Read();
         fs.Close();
         LOG.Message("Loaded configuration '%s'", buf.GetZString());
+        if (cacheable && ok)
+          SaveMFSCache(buf.GetZString(), hash, bytes);
         return true;
       }
 
@@ -1229,6 +2193,131 @@ namespace MFM
     }
 
 
+    enum { MFS_CACHE_VERSION = 1 };
+
+    /**
+     * Computes the 64-bit FNV-1a \a hash of the contents of the file
+     * at \a path, and its length in \a bytes.
+     *
+     * @returns false if the file can't be read.
+     */
+    static bool HashConfigFile(const char * path, u64 & hash, u64 & bytes)
+    {
+      FILE * fp = fopen(path, "r");
+      if (!fp)
+        return false;
+
+      u8 chunk[1 << 16];
+      hash = HexU64(0xcbf29ce4, 0x84222325);  // FNV offset basis
+      bytes = 0;
+      size_t got;
+      while ((got = fread(chunk, 1, sizeof(chunk), fp)) > 0)
+      {
+        for (size_t i = 0; i < got; ++i)
+        {
+          hash ^= chunk[i];
+          hash *= HexU64(0x100, 0x000001b3);  // FNV prime
+        }
+        bytes += got;
+      }
+      const bool ok = !ferror(fp);
+      fclose(fp);
+      return ok;
+    }
+
+    /**
+     * With --mfscache, a .mfs configuration that loaded cleanly is
+     * cached beside it in two files.  PATH.cache.mfb is a GridSnapshot
+     * of the grid as loaded, and PATH.cache is the configuration
+     * rewritten without its Site() calls, after a key line recording
+     * the source's hash and length and the snapshot's length.  The
+     * snapshot is written first and the key last, so a cache is
+     * never used with a partially-written snapshot.
+     */
+    void SaveMFSCache(const char * path, u64 hash, u64 bytes)
+    {
+      OString512 cachePath, snapPath;
+      cachePath.Printf("%s.cache", path);
+      snapPath.Printf("%s.cache.mfb", path);
+
+      unlink(cachePath.GetZString());
+      struct stat st;
+      if (!GridSnapshot<GC>::Save(m_grid, snapPath.GetZString()) ||
+          stat(snapPath.GetZString(), &st) != 0)
+        return;
+
+      FILE * fp = fopen(cachePath.GetZString(), "w");
+      if (!fp)
+      {
+        LOG.Warning("Can't write configuration cache '%s': %s",
+                    cachePath.GetZString(), strerror(errno));
+        return;
+      }
+      FileByteSink fbs(fp);
+      fbs.Printf("MFSCACHE/%D", MFS_CACHE_VERSION);
+      fbs.Print(hash, Format::LXX64);
+      fbs.Print(bytes, Format::LXX64);
+      fbs.Print((u64) st.st_size, Format::LXX64);
+      fbs.Printf("\n");
+
+      m_externalConfigSectionGrid.SetWriteSites(false);
+      m_externalConfig.Write(fbs);
+      m_externalConfigSectionGrid.SetWriteSites(true);
+      fbs.Close();
+      LOG.Message("Cached configuration '%s' in '%s'", path, cachePath.GetZString());
+    }
+
+    /**
+     * Loads the configuration at \a path from its --mfscache files,
+     * if they exist and were made from a file with this \a hash and
+     * length.  Only the short rewritten configuration is parsed; the
+     * sites come from the snapshot, so, as with any .mfb, site paint,
+     * sensor readings and event statistics come back cleared.
+     *
+     * @returns false if the cache is missing, stale or unusable, in
+     *          which case the caller should parse \a path itself.
+     */
+    bool LoadMFSCache(const char * path, u64 hash, u64 bytes)
+    {
+      OString512 cachePath, snapPath;
+      cachePath.Printf("%s.cache", path);
+      snapPath.Printf("%s.cache.mfb", path);
+
+      struct stat st;
+      if (stat(snapPath.GetZString(), &st) != 0)
+        return false;
+
+      FileByteSource fs(cachePath.GetZString());
+      if (!fs.IsOpen())
+        return false;
+
+      m_externalConfig.SetByteSource(fs, cachePath.GetZString());
+      LineCountingByteSource & in = m_externalConfig.GetByteSource();
+      u32 version;
+      u64 cachedHash, cachedBytes, snapBytes;
+      if (10 != in.Scanf("MFSCACHE/%D", &version) || version != MFS_CACHE_VERSION ||
+          !in.Scan(cachedHash, Format::LXX64) ||
+          !in.Scan(cachedBytes, Format::LXX64) ||
+          !in.Scan(snapBytes, Format::LXX64) ||
+          cachedHash != hash || cachedBytes != bytes || snapBytes != (u64) st.st_size)
+      {
+        fs.Close();
+        LOG.Message("Configuration cache '%s' is stale", cachePath.GetZString());
+        return false;
+      }
+
+      LOG.Message("Loading configuration '%s' from cache", path);
+      const bool ok = m_externalConfig.Read();
+      fs.Close();
+      if (!ok || !GridSnapshot<GC>::Load(m_grid, snapPath.GetZString()))
+      {
+        LOG.Warning("Configuration cache '%s' unusable", cachePath.GetZString());
+        return false;
+      }
+      LOG.Message("Loaded configuration '%s' from cache", path);
+      return true;
+    }
+
     /**
      * Method to do end-of-epoch processing.  Base class recounts the
      * grid and handles --gridImage and --tileImage processing here,
@@ -1240,23 +2329,29 @@ namespace MFM
       LOG.Debug("Epoch %d: %d AEPS", epochs, epochAEPS);
 
       WriteTimeBasedData();
+      WriteElementProfile();
+      WriteTileStats(epochAEPS);
 
       if (m_gridImages)
       {
-        const char * path = GetSimDirPathTemporary("eps/%010d.ppm", epochAEPS);
-        FILE* fp = fopen(path, "w");
-        FileByteSink fbs(fp);
-        grid.WriteEPSImage(fbs);
-        fclose(fp);
+        m_epochJobs.BeginFile(GetSimDirPathTemporary("eps/%010d.ppm", epochAEPS), false);
+        grid.WriteEPSImage(m_epochJobs.GetSink());
+        m_epochJobs.EndFile();
       }
 
       if (m_tileImages)
       {
-        const char * path = GetSimDirPathTemporary("teps/%010d-average.ppm", epochAEPS);
-        FILE* fp = fopen(path, "w");
-        FileByteSink fbs2(fp);
-        grid.WriteEPSAverageImage(fbs2);
-        fclose(fp);
+        m_epochJobs.BeginFile(GetSimDirPathTemporary("teps/%010d-average.ppm", epochAEPS), false);
+        grid.WriteEPSAverageImage(m_epochJobs.GetSink());
+        m_epochJobs.EndFile();
+      }
+
+      if (m_epsBins)
+      {
+        m_epochJobs.BeginFile(GetSimDirPathTemporary("eps/bins.dat"), true);
+        grid.WriteEventBinsRecord(m_epochJobs.GetSink(), epochAEPS);
+        m_epochJobs.EndFile();
+        grid.ResetEPSCounts();  // Each record covers one epoch
       }
 
       if (m_autosavePerEpochs > 0 && (epochs % m_autosavePerEpochs) == 0)
@@ -1277,16 +2372,29 @@ namespace MFM
       }
     }
 
-    AbstractDriver(u32 gridWidth, u32 gridHeight, GridLayoutPattern gridLayout)
+    /**
+     * \c tileWidth and \c tileHeight size the grid's tiles when \c
+     * GC is runtime-sized, and must match \c GC's otherwise; see
+     * Grid::Grid.
+     */
+    AbstractDriver(u32 gridWidth, u32 gridHeight, GridLayoutPattern gridLayout,
+                   u32 tileWidth = GC::TILE_WIDTH, u32 tileHeight = GC::TILE_HEIGHT)
       : GRID_WIDTH(gridWidth)
       , GRID_HEIGHT(gridHeight)
       , GRID_LAYOUT(gridLayout)
       , m_neededElementCount(0)
-      , m_grid(m_elementRegistry, GRID_WIDTH, GRID_HEIGHT, GRID_LAYOUT)
+      , m_streamIn(0)
+      , m_streamOut(0)
+      , m_datumStreamer()
+      , m_grid(m_elementRegistry, GRID_WIDTH, GRID_HEIGHT, GRID_LAYOUT, tileWidth, tileHeight)
+      , m_elementReloader(m_grid, &m_elementRegistry)
+      , m_ticksLastStarted(0)
       , m_ticksLastStopped(0)
       , m_totalPriorTicks(0)
       , m_currentTickBasis(0)
       , m_haltAfterAEPS(0)
+      , m_deterministicEvents(0)
+      , m_sweepsPerStep(0)
       , m_haltOnExtinctionOf(false) // if true, m_extinctionSymbol has (unvalidated) content
       , m_createEdenSeed(false) // if true, m_edenSeedSymbol has (unvalidated) content
       , m_haltOnEmpty(false)
@@ -1294,6 +2402,9 @@ namespace MFM
       , m_suppressStdElements(true)
       , m_includeUEDemos(false)
       , m_includeCPPDemos(false)
+      , m_lazyElements(false)
+      , m_reloadLibraries(false)
+      , m_ticksLastReloadCheck(0)
       , m_msSpentRunning(0)
       , m_msSpentOverhead(0)
       , m_microsSleepPerFrame(1000)
@@ -1302,12 +2413,33 @@ namespace MFM
       , m_aepsPerFrame(INITIAL_AEPS_PER_FRAME)
       , m_AEPSPerEpoch(100)
       , m_autosavePerEpochs(10)
+      , m_binaryAutosave(false)
+      , m_compressedSave(false)
+      , m_deltaAutosave(0)
+      , m_mfsCache(false)
+      , m_diffPath(0)
+      , m_replicas(0)
+      , m_ensemblePath(0)
+      , m_ensembleThreads(0)
+      , m_lastSaveStallMS(0)
+      , m_totalSaveStallMS(0)
+      , m_lastEpochStallMS(0)
+      , m_maxEpochStallMS(0)
+      , m_totalEpochStallMS(0)
+      , m_startupBeginMS(0)
+      , m_startupPhaseMS(0)
       , m_accelerateAfterEpochs(0)
       , m_acceleration(1)
       , m_surgeAfterEpochs(0)
       , m_maxEpochLength(0)
       , m_gridImages(false)
       , m_tileImages(false)
+      , m_epsBins(false)
+      , m_tileStats(false)
+      , m_metricsPort(0)
+      , m_metricsPublishedTicks(0)
+      , m_viewPort(0)
+      , m_viewPublishedTicks(0)
       , m_AEPS(0.0)
       , m_AER(0.0)
       , m_recentAER(0)
@@ -1322,6 +2454,7 @@ namespace MFM
       , m_externalConfigSectionGrid(m_externalConfig, m_grid)
     {
       InitTicks(0); // Overwritten later on -cp load
+      m_startupBeginMS = m_startupPhaseMS = GetTicksSinceEpoch();
     }
 
     virtual ~AbstractDriver() {} //avoid inline error
@@ -1377,7 +2510,13 @@ namespace MFM
 
       m_varguments.ProcessArguments(argc, argv);
 
+      // Now that -l has set the level
+      LOG.Debug("Startup tile construction: %d ms", m_grid.GetTileConstructionMS());
+      NoteStartupPhase("argument parsing");
+
       OnceOnly(m_varguments);
+
+      NoteStartupPhase("driver setup");
     }
 
     VArguments & GetVArguments()
@@ -1453,6 +2592,24 @@ namespace MFM
       RegisterArgument("Each epoch, write tile AEPS image to per-sim teps/ directory",
                        "--tileImages", &SetTileImages, this, false);
 
+      RegisterArgument("Each epoch, append per-bin event counts to per-sim eps/bins.dat",
+                       "--epsBins", &SetEPSBins, this, false);
+
+      RegisterArgument("Each epoch, append per-tile events, idle advances and lock failures to per-sim tbd/tilestats.csv",
+                       "--tileStats", &SetTileStats, this, false);
+
+      RegisterArgument("Serve live metrics over HTTP on port ARG, in Prometheus text format",
+                       "--metricsPort", &SetMetricsPortFromArgs, this, true);
+
+      RegisterArgument("Stream the grid's site types on port ARG, for a --viewFrom viewer elsewhere",
+                       "--viewPort", &SetViewPortFromArgs, this, true);
+
+      RegisterArgument("Feed emitters the datums read from ARG: a file, - for stdin, or tcp:HOST:PORT",
+                       "--streamIn", &SetStreamInFromArgs, this, true);
+
+      RegisterArgument("Write the datums consumers absorb to ARG: a file, - for stdout, or tcp:HOST:PORT",
+                       "--streamOut", &SetStreamOutFromArgs, this, true);
+
       RegisterArgument("Place one atom of element ARG in the grid.",
                        "--edenseed", &SetEdenSeedFromArgs, this, true);
 
@@ -1483,12 +2640,109 @@ namespace MFM
       RegisterArgument("Add ARG as the path to the element library (.so)",
                        "-ep|--elementpath", &RegisterElementLibraryPath, this, true);
 
+      RegisterArgument("Run the .mfz physics bundle ARG in place: load its libcue.so, cached, and its .mfs configs",
+                       "--mfz", &LoadFromBundle, this, true);
+
+      RegisterArgument("Add library elements to the grid only once a config, snapshot, or symbol names them",
+                       "--lazy-elements", &SetLazyElementsFromArgs, this, false);
+
+      RegisterArgument("While running, reload each element library when its file is rebuilt",
+                       "--reload-libraries", &SetReloadLibrariesFromArgs, this, false);
+
       RegisterArgument("Load initial configuration from file at path ARG (string)",
                        "-cp|--configpath", &LoadFromConfigFile, this, true);
 
       RegisterArgument("Set warp factor 0..10 (0: flattest space; 10: highest AER)",
                        "-wf|--warpfactor", &SetWarpFactorFromArgs, this, true);
 
+      RegisterArgument("Drive tiles with a work-stealing pool of ARG threads (0: one per core)",
+                       "--tilepool", &SetTilePoolFromArgs, this, true);
+
+      RegisterArgument("Run reproducibly, in lockstep steps of ARG events per tile (same seed, same run)",
+                       "--deterministic", &SetDeterministicFromArgs, this, true);
+
+      RegisterArgument("(Experimental) Run in lockstep steps of ARG checkerboard sweeps per tile, "
+                       "with simple elements run as data-parallel kernels",
+                       "--sweep", &SetSweepFromArgs, this, true);
+
+      RegisterArgument("Save and load .mfs sites on ARG threads, by tile (0: one per core)",
+                       "--sitethreads", &SetSiteThreadsFromArgs, this, true);
+
+      RegisterArgument("Initialize tiles on ARG threads at startup (0: one per core)",
+                       "--initthreads", &SetInitThreadsFromArgs, this, true);
+
+      RegisterArgument("Pin tile threads to cpus and keep tile memory on their NUMA nodes",
+                       "--numa", &SetNUMAPlacement, this, false);
+
+      RegisterArgument("Back tile sites with 2MB huge pages",
+                       "--hugepages", &SetHugePages, this, false);
+
+      RegisterArgument("Pause, run and control tiles in a fixed cache-friendly order",
+                       "--orderedtiles", &SetOrderedTileControl, this, false);
+
+      RegisterArgument("Log from a background thread, dropping messages if it falls behind",
+                       "--asynclog", &SetAsyncLogging, this, false);
+
+      RegisterArgument("Pass intertile bytes directly, without simulated transmission",
+                       "--directchannels", &SetDirectChannels, this, false);
+
+      RegisterArgument("Ship up to ARG sites per cache update packet (0: one per packet)",
+                       "--cachebatch", &SetCacheBatchFromArgs, this, true);
+
+      RegisterArgument("Ship cache updates compactly: site deltas, one-byte empty or unchanged atoms, and changed words only",
+                       "--compactcache", &SetCompactCache, this, false);
+
+      RegisterArgument("Look up to ARG more times at a busy intertile lock before abandoning an event",
+                       "--lockspin", &SetLockSpinFromArgs, this, true);
+
+      RegisterArgument("Pick event centers only from non-empty sites, crediting skipped empty events",
+                       "--sparseevents", &SetSparseEvents, this, false);
+
+      RegisterArgument("Run edge events before taking their intertile locks, storing them if their windows haven't changed",
+                       "--optimisticevents", &SetOptimisticEvents, this, false);
+
+      RegisterArgument("Sleep tiles holding only inert atoms, crediting their events, until traffic or a placed atom wakes them",
+                       "--quiescentsleep", &SetQuiescentSleep, this, false);
+
+      RegisterArgument("Give busy tiles more cpu than nearly empty ones, trading equal AEPS for throughput",
+                       "--activityscheduling", &SetActivityScheduling, this, false);
+
+      RegisterArgument("Draw event centers weighted by event age, rather than filtering uniform draws",
+                       "--agedevents", &SetAgedEvents, this, false);
+
+      RegisterArgument("Draw ARG event centers at a time, running cheap elements' events in batches",
+                       "--eventbatch", &SetEventBatchFromArgs, this, true);
+
+      RegisterArgument("Run each tile's hidden-region events on ARG event windows and threads at once",
+                       "--eventworkers", &SetEventWorkersFromArgs, this, true);
+
+      RegisterArgument("Time each element's behavior; each epoch, write totals to tbd/elementprofile.csv",
+                       "--elementprofile", &SetElementProfiling, this, false);
+
+      RegisterArgument("Autosave binary .mfb grid snapshots instead of .mfs text",
+                       "--binaryautosave", &SetBinaryAutosave, this, false);
+
+      RegisterArgument("Autosave, and save on --halt*, tile-by-tile compressed .mfz grid snapshots",
+                       "--compressedsave", &SetCompressedSave, this, false);
+
+      RegisterArgument("Autosave a full .mfb snapshot every ARG autosaves, and .mfd deltas of changed sites between",
+                       "--deltaAutosave", &SetDeltaAutosaveFromArgs, this, true);
+
+      RegisterArgument("Cache loaded .mfs configurations as snapshots beside them, to skip parsing on reload",
+                       "--mfscache", &SetMFSCache, this, false);
+
+      RegisterArgument("Compare the loaded grid with the grid file ARG (.mfs, .mfb, .mfz or .mfd), print the differences, and exit",
+                       "--diff", &SetDiffPathFromArgs, this, true);
+
+      RegisterArgument("Initialize and load once, then fork ARG replicas seeded from the master seed on up, each with its own directory",
+                       "--replicas", &SetReplicasFromArgs, this, true);
+
+      RegisterArgument("Run each 'SEED AEPS [CONFIGPATH]' line of file ARG as its own grid, print each result, and exit",
+                       "--ensemble", &SetEnsemblePathFromArgs, this, true);
+
+      RegisterArgument("Do --ensemble runs on ARG threads (0: one per core)",
+                       "--ensembleThreads", &SetEnsembleThreadsFromArgs, this, true);
+
       RegisterArgument("Add a key=value pair to simulation parameters (string)",
                        "-kv|--keyvalue", &RegisterKeyValue, this, true);
 
@@ -1581,6 +2835,23 @@ namespace MFM
     OurGrid & GetGrid() { return m_grid; }
     const OurGrid & GetGrid() const { return m_grid; }
 
+    /**
+       Add what this driver holds to \a account: its grid, and, in
+       drivers that draw it, whatever they draw with.
+     */
+    virtual void AccountMemory(MemoryAccount & account) const
+    {
+      m_grid.AccountMemory(account);
+    }
+
+    /** Log what AccountMemory finds at \a level */
+    void ReportMemory(Logger::Level level) const
+    {
+      MemoryAccount account;
+      AccountMemory(account);
+      account.ReportMemory(level, "Memory ");
+    }
+
     void SetSeed(u32 seed)
     {
       if(!seed)
@@ -1590,15 +2861,44 @@ namespace MFM
       m_grid.SetSeed(seed);
     }
 
+    /**
+       Give every tile a set of DatumQueues and start streaming data
+       through them, if --streamIn or --streamOut asked for it.
+     */
+    void StartDatumStreamer()
+    {
+      if ((!m_streamIn && !m_streamOut) || m_datumStreamer.IsRunning())
+      {
+        return;
+      }
+      for (typename OurGrid::iterator_type i = m_grid.begin(); i != m_grid.end(); ++i)
+      {
+        i->SetDatumQueues(&m_datumStreamer.AddQueues());
+      }
+      m_datumStreamer.Start(m_streamIn, m_streamOut);
+      NoteStartupPhase("data streaming");
+    }
+
     void Init()
     {
       m_lastFrameAEPS = 0;
 
+      // So a crashing tile leaves word of its last events
+      FlightRecorder::InstallCrashHandlers();
+
       ReinitUs();
 
       m_grid.Init();
+      NoteStartupPhase("Grid::Init");
 
-      m_grid.InitThreads();
+      // Replicas start their threads after the fork
+      if (!m_replicas)
+      {
+        m_grid.InitThreads();
+        NoteStartupPhase("InitThreads");
+
+        StartDatumStreamer();
+      }
 
       // No longer needed?  Only needed in cpp-elt situations??  We shall see
       //      NeedElement(&Element_Empty<EC>::THE_INSTANCE);
@@ -1608,11 +2908,229 @@ namespace MFM
       ReinitEden();
 
       PostReinit(m_varguments);
+      NoteStartupPhase("physics and eden");
+
+      if (m_ensemblePath)
+      {
+        EnsembleAndExit();
+      }
 
       LoadFromConfigurationPath();
+      NoteStartupPhase("configuration loading");
+
+      if (m_replicas)
+      {
+        ForkReplicas();  // Returns only in the replicas
+        m_grid.InitThreads();
+        NoteStartupPhase("InitThreads");
+      }
+
+      LOG.Debug("Startup total: %d ms",
+                (u32) (GetTicksSinceEpoch() - m_startupBeginMS + m_grid.GetTileConstructionMS()));
+
+      ReportMemory(Logger::MESSAGE);
 
       m_grid.SetGridRunning(false);
 
+      if (m_diffPath)
+      {
+        DiffAndExit();
+      }
+    }
+
+    enum { MAX_DIFF_SITES_PRINTED = 100 };
+
+    /**
+     * For --diff: compare the grid as the configuration left it (the
+     * 'before') with the grid as m_diffPath, in any format LoadMFS
+     * takes, leaves it (the 'after').  Prints the differences to
+     * stdout, then exits 0 if there were none, 1 if there were, and 2
+     * if m_diffPath couldn't be loaded.
+     */
+    void DiffAndExit()
+    {
+      GridDiff<GC> diff;
+      diff.Capture(m_grid, 0);
+      m_grid.Clear();
+      if (!LoadMFS(m_diffPath))
+      {
+        LOG.Error("Can't load '%s' to compare with", m_diffPath);
+        exit(2);
+      }
+      const u64 differing = diff.Compare(m_grid, 0);
+      diff.Print(m_grid, STDOUT, MAX_DIFF_SITES_PRINTED);
+      STDOUT.Flush();
+      exit(differing ? 1 : 0);
+    }
+
+    enum { MAX_REPLICAS = 256 };
+
+    /**
+     * For --replicas: fork m_replicas copies of this fully loaded but
+     * still unthreaded driver, which share its pages copy-on-write.
+     * Replica i reseeds the grid with the master seed plus i and
+     * writes to the sub-directory replica-i of the simulation
+     * directory, then returns to go on as a normal run.  This process
+     * waits for them all, then exits 0 if they all exited 0, and 1
+     * otherwise.
+     */
+    void ForkReplicas()
+    {
+      const bool async = LOG.IsAsync();
+      if (async)
+      {
+        LOG.SetAsync(false);  // No writer thread to fork
+      }
+      STDOUT.Flush();
+      STDERR.Flush();
+
+      const u32 baseSeed = m_grid.GetSeed();
+      pid_t pids[MAX_REPLICAS];
+      u32 forked = 0;
+      for (; forked < m_replicas; ++forked)
+      {
+        const pid_t pid = fork();
+        if (pid == 0)
+        {
+          BecomeReplica(forked, baseSeed + forked);
+          if (async)
+          {
+            LOG.SetAsync(true);
+          }
+          return;
+        }
+        if (pid < 0)
+        {
+          LOG.Error("Forked only %d of %d replicas: %s", forked, m_replicas, strerror(errno));
+          break;
+        }
+        pids[forked] = pid;
+      }
+      LOG.Message("Forked %d replicas, seeds %d..%d", forked, baseSeed, baseSeed + forked - 1);
+
+      u32 failed = m_replicas - forked;
+      for (u32 i = 0; i < forked; ++i)
+      {
+        s32 status = 0;
+        if (waitpid(pids[i], &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        {
+          LOG.Error("Replica %d (pid %d) failed, status 0x%x", i, (s32) pids[i], status);
+          ++failed;
+        }
+      }
+      LOG.Message("Replicas done: %d of %d failed", failed, m_replicas);
+      exit(failed ? 1 : 0);
+    }
+
+    /**
+     * In a newly forked replica: move to its own simulation directory
+     * and reseed.
+     */
+    void BecomeReplica(u32 replica, u32 seed)
+    {
+      char * end = m_simDirBasePath + m_simDirBasePathLength;
+      const u32 room = MAX_PATH_LENGTH - m_simDirBasePathLength;
+      const s32 len = snprintf(end, room, "replica-%d/", replica);
+      if (len < 0 || (u32) len >= room ||
+          m_simDirBasePathLength + len >= MAX_PATH_LENGTH - MIN_PATH_RESERVED_LENGTH)
+      {
+        FAIL(OUT_OF_ROOM);
+      }
+      m_simDirBasePathLength += len;
+      MakeSimDirs(m_varguments);
+
+      m_grid.Reseed(seed ? seed : 1);  // 0 only by wrapping around
+      LOG.Message("Replica %d: seed %d, writing to '%s'", replica, m_grid.GetSeed(),
+                  GetSimDirPathTemporary(""));
+    }
+
+    /**
+     * The --ensemble runs' grids get the elements this driver needs,
+     * and their configurations load as LoadMFS would load them,
+     * except for .mfd delta chains and the driver's own sections.
+     */
+    struct DriverEnsemble : public GridEnsemble<GC>
+    {
+      AbstractDriver & m_driver;
+
+      DriverEnsemble(AbstractDriver & driver)
+        : GridEnsemble<GC>(driver.m_elementRegistry, driver.GRID_WIDTH, driver.GRID_HEIGHT,
+                           driver.GRID_LAYOUT,
+                           driver.m_grid.GetTileWidth(), driver.m_grid.GetTileHeight())
+        , m_driver(driver)
+      { }
+
+      virtual void SetUpGrid(OurGrid & grid)
+      {
+        for (u32 i = 0; i < m_driver.m_neededElementCount; ++i)
+        {
+          grid.Needed(*m_driver.m_neededElements[i]);
+        }
+        grid.FreezeElementTables();
+      }
+
+      virtual bool LoadConfiguration(OurGrid & grid, const char * path)
+      {
+        OString512 buf;
+        if (path[0] == '/' || !Utils::GetReadableResourceFile(path, buf))
+        {
+          buf.Printf("%s",path);
+        }
+
+        const u32 len = buf.GetLength();
+        if (len > 4 && (!strcmp(buf.GetZString() + len - 4, ".mfb") ||
+                        !strcmp(buf.GetZString() + len - 4, ".mfz")))
+        {
+          return GridEnsemble<GC>::LoadConfiguration(grid, buf.GetZString());
+        }
+
+        FileByteSource fs(buf.GetZString());
+        if (!fs.IsOpen())
+        {
+          LOG.Error("Can't read configuration file '%s'", buf.GetZString());
+          return false;
+        }
+
+        ExternalConfig<GC> config(m_driver);
+        ExternalConfigSectionDriver<GC> driverSection(config, m_driver);
+        ExternalConfigSectionGrid<GC> gridSection(config, grid);
+        driverSection.SetEnabled(false);  // This run's settings are its line's
+        config.RegisterSection(driverSection);
+        config.RegisterSection(gridSection);
+        config.SetByteSource(fs, buf.GetZString());
+        const bool ok = config.Read();
+        fs.Close();
+        return ok;
+      }
+
+      virtual void ResultWritten(ByteSink & results)
+      {
+        STDOUT.Flush();  // Stream results as runs finish
+      }
+    };
+
+    /**
+     * For --ensemble: run each line of m_ensemblePath on its own grid,
+     * m_ensembleThreads at a time, printing each result to stdout as
+     * it finishes.  Then exits 0 if every run succeeded, 1 if any
+     * failed, and 2 if m_ensemblePath couldn't be read.
+     */
+    void EnsembleAndExit()
+    {
+      DriverEnsemble ensemble(*this);
+      if (m_deterministicEvents)
+      {
+        ensemble.SetEventsPerStep(m_deterministicEvents);
+      }
+      if (!ensemble.ReadRuns(m_ensemblePath))
+      {
+        exit(2);
+      }
+      LOG.Message("Running %d ensemble runs from '%s'", ensemble.GetRunCount(), m_ensemblePath);
+      const u32 failures = ensemble.RunAll(m_ensembleThreads, &STDOUT);
+      STDOUT.Flush();
+      LOG.Message("Ensemble done: %d of %d runs failed", failures, ensemble.GetRunCount());
+      exit(failures ? 1 : 0);
     }
 
     static void AbstractDriverRunFailMessage() {
@@ -1630,6 +3148,8 @@ namespace MFM
        },
        {
          RunHelper();
+         FlushTimeBasedData();
+         m_epochJobs.Finish();
          LOG.Message("Simulation driver exiting");
        });
     }
@@ -1641,15 +3161,24 @@ namespace MFM
     Element<EC>* m_neededElements[MAX_NEEDED_ELEMENTS];
     u32 m_neededElementCount;
 
+    StatisticsRing<TBD_RING_SAMPLES, TBD_MAX_VALUES> m_timeBasedData;
+
 #if 0
     OurStdElements m_se;
 #endif
+    const char * m_streamIn;        // 0 unless --streamIn
+    const char * m_streamOut;       // 0 unless --streamOut
+    DatumStreamer m_datumStreamer;  // Before m_grid, so it outlives the tiles
     OurGrid m_grid;
+    ElementReloader<GC> m_elementReloader;
 
+    u64 m_ticksLastStarted;
     u64 m_ticksLastStopped;
     u64 m_totalPriorTicks;
     u64 m_currentTickBasis;
     u32 m_haltAfterAEPS;
+    u32 m_deterministicEvents;  // Per tile per step; 0 unless --deterministic
+    u32 m_sweepsPerStep;        // Per tile per step; 0 unless --sweep
     bool m_haltOnExtinctionOf;
     u8 m_extinctionSymbol[3];
     u8 m_edenSeedSymbol[3];
@@ -1659,6 +3188,10 @@ namespace MFM
     bool m_suppressStdElements;
     bool m_includeUEDemos;
     bool m_includeCPPDemos;
+    bool m_lazyElements;
+    bool m_reloadLibraries;
+    u64 m_ticksLastReloadCheck;
+    time_t m_libraryMTimes[OurElementRegistry::MAX_PATHS];  // As of their last load
 
     u64 m_msSpentRunning;
     u64 m_msSpentOverhead;
@@ -1669,6 +3202,24 @@ namespace MFM
 
     s32 m_AEPSPerEpoch;
     u32 m_autosavePerEpochs;
+    bool m_binaryAutosave;
+    bool m_compressedSave;
+    u32 m_deltaAutosave;
+    GridCheckpoint<GC> m_checkpoint;
+    bool m_mfsCache;
+    const char * m_diffPath;        // --diff: compare the loaded grid with this, then exit
+    u32 m_replicas;                 // --replicas: fork this many after loading
+    const char * m_ensemblePath;    // --ensemble: run these instead, then exit
+    u32 m_ensembleThreads;          // --ensembleThreads
+    GridSnapshotWriter m_snapshotWriter;
+    u64 m_lastSaveStallMS;
+    u64 m_totalSaveStallMS;
+    EpochJobQueue m_epochJobs;      // Epoch output, written off the grid's time
+    u64 m_lastEpochStallMS;
+    u64 m_maxEpochStallMS;
+    u64 m_totalEpochStallMS;
+    u64 m_startupBeginMS;   // After the grid was constructed
+    u64 m_startupPhaseMS;   // When the current startup phase began
     u32 m_accelerateAfterEpochs;
     u32 m_acceleration;
     u32 m_surgeAfterEpochs;
@@ -1676,6 +3227,16 @@ namespace MFM
 
     bool m_gridImages;
     bool m_tileImages;
+    bool m_epsBins;    // Not saved with the driver state
+    bool m_tileStats;  // Not saved with the driver state
+
+    u32 m_metricsPort;              // 0 unless --metricsPort
+    u64 m_metricsPublishedTicks;    // When PublishMetrics last did
+    MetricsServer m_metricsServer;
+
+    u32 m_viewPort;                 // 0 unless --viewPort
+    u64 m_viewPublishedTicks;       // When PublishView last did
+    ViewServer m_viewServer;
 
     double m_AEPS;
 
@@ -1705,6 +3266,8 @@ namespace MFM
     u32 m_currentConfigurationPath;
     const char* (m_configurationPaths[MAX_CONFIGURATION_PATHS]);
 
+    MFZBundle m_bundle;         // From --mfz, if any
+
     char m_simDirBasePath[MAX_PATH_LENGTH];
     u32 m_simDirBasePathLength;
 
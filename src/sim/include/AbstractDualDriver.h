@@ -55,7 +55,9 @@ namespace MFM
 
   protected:
 
-    AbstractDualDriver(u32 gridWidth, u32 gridHeight, GridLayoutPattern gridLayout) : Super(gridWidth, gridHeight, gridLayout)
+    AbstractDualDriver(u32 gridWidth, u32 gridHeight, GridLayoutPattern gridLayout,
+                       u32 tileWidth = GC::TILE_WIDTH, u32 tileHeight = GC::TILE_HEIGHT)
+      : Super(gridWidth, gridHeight, gridLayout, tileWidth, tileHeight)
     { }
 
     virtual void AddDriverArguments()
@@ -52,8 +52,9 @@ namespace MFM
   protected:
     typedef typename Super::OurGrid OurGrid;
 
-    AbstractHeadlessDriver(u32 gridWidth, u32 gridHeight)
-      : AbstractDriver<GC>(gridWidth, gridHeight)
+    AbstractHeadlessDriver(u32 gridWidth, u32 gridHeight, GridLayoutPattern gridLayout,
+                           u32 tileWidth = GC::TILE_WIDTH, u32 tileHeight = GC::TILE_HEIGHT)
+      : AbstractDriver<GC>(gridWidth, gridHeight, gridLayout, tileWidth, tileHeight)
     { }
 
     virtual void AddDriverArguments()
@@ -64,6 +65,9 @@ namespace MFM
     virtual void OnceOnly(VArguments& args)
     {
       Super::OnceOnly(args);
+
+      // Nothing headless ever rewinds or displays event history
+      Super::GetGrid().ReleaseEventHistory();
     }
 
     virtual void PostUpdate()
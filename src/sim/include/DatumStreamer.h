@@ -0,0 +1,149 @@
+/*                                              -*- mode:C++ -*-
+  DatumStreamer.h Stream external data through tiles' DatumQueues
+  Copyright (C) 2014 The Regents of the University of New Mexico.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+  USA
+*/
+
+/**
+  \file DatumStreamer.h Stream external data through tiles' DatumQueues
+  \lgpl
+ */
+#ifndef DATUMSTREAMER_H
+#define DATUMSTREAMER_H
+
+#include "itype.h"
+#include "Fail.h"
+#include "DatumQueues.h"
+#include <vector>
+#include <pthread.h>
+
+namespace MFM
+{
+  /**
+     Runs the grid as a streaming processor: on its own thread, reads
+     datums -- unsigned decimal numbers separated by whitespace --
+     from an input, and spreads them over the input queues of the
+     tiles' DatumQueues, batch by batch, round robin; and collects
+     the tiles' output datums and writes them, one per line.
+
+     Inputs and outputs are named like files: a path, "-" for stdin
+     or stdout, or tcp:HOST:PORT to connect to a server.  When the
+     tiles fall behind, the streamer stops reading, so a socket
+     source is pushed back on; it never blocks a tile.
+   */
+  class DatumStreamer
+  {
+  public:
+    enum {
+      BATCH_DATUMS = 256,       // Most fed to one tile at a time
+      PENDING_DATUMS = 1 << 14, // Read ahead of the tiles
+      POLL_MSEC = 10
+    };
+
+    DatumStreamer() ;
+
+    /** Stops the streamer if it's running, and frees its queues */
+    ~DatumStreamer() ;
+
+    /**
+       A new set of queues for one tile to use (\sa
+       Tile::SetDatumQueues), which this streamer owns.  Call only
+       before Start.
+     */
+    DatumQueues & AddQueues() ;
+
+    /**
+       Open \c input and \c output -- either may be 0, but not both --
+       and start the streamer thread.
+
+       \fail IO_ERROR if either can't be opened
+       \fail ILLEGAL_STATE if already running, or no queues were added
+     */
+    void Start(const char * input, const char * output) ;
+
+    /**
+       Stop the streamer thread, writing out whatever output the tiles
+       have queued first, and close the input and output.
+     */
+    void Stop() ;
+
+    bool IsRunning() const
+    {
+      return m_running;
+    }
+
+    /** Has the input run out (and been entirely queued)? */
+    bool IsInputDone() const
+    {
+      return __atomic_load_n(&m_inputDone, __ATOMIC_RELAXED) != 0;
+    }
+
+    /** Datums read from the input so far */
+    u64 GetDatumsRead() const
+    {
+      return __atomic_load_n(&m_datumsRead, __ATOMIC_RELAXED);
+    }
+
+    /** Datums collected from the tiles so far, and written if there's an output */
+    u64 GetDatumsWritten() const
+    {
+      return __atomic_load_n(&m_datumsWritten, __ATOMIC_RELAXED);
+    }
+
+  private:
+    std::vector<DatumQueues *> m_queues;
+    s32 m_inFd;                 // -1 if none or closed
+    s32 m_outFd;                // -1 if none
+    bool m_closeIn;             // Not stdin
+    bool m_closeOut;            // Not stdout
+    bool m_running;
+    u32 m_stopRequested;
+    u32 m_inputDone;
+    u64 m_datumsRead;
+    u64 m_datumsWritten;
+    pthread_t m_thread;
+
+    /* Streamer thread only */
+    u32 m_pending[PENDING_DATUMS];
+    u32 m_pendingStart;
+    u32 m_pendingEnd;
+    u32 m_partial;              // Digits of a number split across reads
+    bool m_inNumber;
+    u32 m_nextQueue;
+
+    static s32 Open(const char * spec, bool forOutput, bool & closeIt) ;
+
+    static void * Run(void * arg) ;
+
+    /** Read and parse what input there is room for */
+    void ReadInput() ;
+
+    /** Feed pending datums to the tiles; \returns true if any went */
+    bool FeedTiles() ;
+
+    /** Write the tiles' output; \returns true if there was any */
+    bool DrainTiles() ;
+
+    void WriteAll(const char * bytes, u32 length) ;
+
+    // Declare away
+    DatumStreamer(const DatumStreamer &) ;
+    DatumStreamer & operator=(const DatumStreamer &) ;
+  };
+}
+
+#endif /* DATUMSTREAMER_H */
@@ -31,6 +31,42 @@ namespace MFM {
        return 0;
     }
 
+    /**
+     * As Open, but binding the library's symbols to its own
+     * definitions first, and not offering them to libraries opened
+     * later -- so a rebuilt copy of an already-loaded library gets
+     * its own elements instead of the loaded ones.  Template statics
+     * compiled as GNU unique symbols are merged regardless; build a
+     * reloadable library with -fno-gnu-unique.
+     */
+    const char * OpenIsolated(ZStringableByteSink & path)
+    {
+       int flags = RTLD_NOW|RTLD_LOCAL;
+#ifdef RTLD_DEEPBIND
+       flags |= RTLD_DEEPBIND;
+#endif
+       m_dlHandle = dlopen(path.GetZString(), flags);
+
+       const char * err = dlerror();
+       if (!m_dlHandle) {
+         if (!err)
+           err = "Unspecified dlopen error";
+         return err;
+       }
+       return 0;
+    }
+
+    /**
+     * Forget the opened library without closing it, for when its
+     * elements are staying in use.  Returns its handle.
+     */
+    void * Release()
+    {
+      void * ret = m_dlHandle;
+      m_dlHandle = 0;
+      return ret;
+    }
+
     const char * LoadLibrary(ElementLibrary<EC> ** elpp)
     {
       if (!m_dlHandle)
@@ -33,6 +33,8 @@
 #include "UlamElement.h"
 #include "UlamClassRegistry.h"
 #include "OverflowableCharBufferByteSink.h"
+#include "ElementLibraryLoader.h"
+#include <pthread.h>
 
 namespace MFM {
 
@@ -46,7 +48,10 @@ namespace MFM {
 
    * It is meant for use only during simulation initialization and is
    * therefore dog slow.  It maintains a list of .so files from which
-   * it will dynamically load elements, during initialization.
+   * it will dynamically load elements, during initialization.  The
+   * libraries are opened concurrently, but their contents are
+   * registered one library at a time, in the order their paths were
+   * added.
    */
   template <class EC>
   class ElementRegistry
@@ -56,8 +61,8 @@ namespace MFM {
     typedef OString256 LibraryPathString;
 
     enum {
-      TABLE_SIZE = 100,
-      MAX_PATHS = 1
+      TABLE_SIZE = 256,
+      MAX_PATHS = 16
     };
 
   private:
@@ -72,6 +77,37 @@ namespace MFM {
      */
     s32 LoadLibrary(UlamClassRegistry<EC> & ucr, LibraryPathString & librarypath) ;
 
+    /**
+       Register the elements and other ulam classes of an opened
+       library.  Returns the number of elements and quarks loaded
+     */
+    s32 RegisterLibrary(UlamClassRegistry<EC> & ucr, ElementLibrary<EC> & el, LibraryPathString & librarypath) ;
+
+    /**
+       One library being opened on its own thread by LoadLibraries
+     */
+    struct LibraryOpening {
+      ElementLibraryLoader<EC> m_loader;
+      LibraryPathString * m_path;
+      ElementLibrary<EC> * m_library;
+      const char * m_openError;
+      const char * m_loadError;
+      pthread_t m_thread;
+      bool m_threaded;
+
+      LibraryOpening()
+        : m_path(0)
+        , m_library(0)
+        , m_openError(0)
+        , m_loadError(0)
+        , m_threaded(false)
+      { }
+
+      void Open() ;
+    };
+
+    static void * LibraryOpeningRunner(void * arg) ;
+
   public:
 
   
@@ -85,6 +121,13 @@ namespace MFM {
 
     u32 GetLibraryPathsCount() const;
 
+    /**
+     * The normalized path of the index'th library added by
+     * AddLibraryPath.  Fails with ILLEGAL_ARGUMENT if there's no such
+     * library.
+     */
+    const char * GetLibraryPath(u32 index) const;
+
     Element<EC> * GetRegisteredElement(u32 index) ;
 
     bool IsRegistered(const UUID & uuid) const;
@@ -97,6 +140,15 @@ namespace MFM {
 
     Element<EC> * LookupCompatible(const UUID & uuid) const;
 
+    /**
+     * Make the entry of loaded element old refer to neu instead,
+     * under neu's UUID, as when a library is reloaded.
+     *
+     * @returns false if old isn't loaded here, or some other entry
+     * already has neu's UUID
+     */
+    bool ReplaceElement(const Element<EC> & old, Element<EC> & neu) ;
+
     /**
      * Add a library path to the registry paths, if it is not already
      * there.  Fails with NULL_POINTER if path is null.  Returns 0 if
@@ -108,8 +160,9 @@ namespace MFM {
     /**
      * Load all the libraries that were previously added with
      * AddLibraryPath, and 'Need' all the elements contained therein.
-     * Returns negative on error, otherwise the number of elements
-     * loaded.
+     * The dlopen and symbol lookup for each library run on their own
+     * thread.  Returns negative on error, otherwise the number of
+     * elements loaded.
      */
     s32 LoadLibraries(UlamClassRegistry<EC> & ucr) ;
 
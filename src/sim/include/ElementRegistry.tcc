@@ -2,8 +2,6 @@
 #include <stdlib.h> /* For getenv */
 #include <errno.h>  /* For errno */
 #include <string.h> /* For strerror */
-#include <dirent.h> /* For opendir */
-#include "ElementLibraryLoader.h"
 #include "Utils.h"
 #include "Fail.h"
 
@@ -34,6 +32,14 @@ namespace MFM
     return m_libraryPathsCount;
   }
 
+  template <class EC>
+  const char * ElementRegistry<EC>::GetLibraryPath(u32 index) const
+  {
+    if (index >= m_libraryPathsCount)
+      FAIL(ILLEGAL_ARGUMENT);
+    return m_libraryPaths[index].GetZString();
+  }
+
   template <class EC>
   Element<EC> * ElementRegistry<EC>::GetRegisteredElement(u32 index)
   {
@@ -91,6 +97,22 @@ namespace MFM
     return m_registeredElements[index].m_element;
   }
 
+  template <class EC>
+  bool ElementRegistry<EC>::ReplaceElement(const Element<EC> & old, Element<EC> & neu)
+  {
+    const ElementEntry * other = FindMatching(neu.GetUUID());
+    for (u32 i = 0; i < m_registeredElementsCount; ++i) {
+      ElementEntry & ee = m_registeredElements[i];
+      if (ee.m_element != &old) continue;
+      if (other && other != &ee)
+        return false;
+      ee.m_uuid = neu.GetUUID();
+      ee.m_element = &neu;
+      return true;
+    }
+    return false;
+  }
+
   template <class EC>
   bool ElementRegistry<EC>::IsRegistered(const UUID & uuid) const
   {
@@ -139,12 +161,55 @@ namespace MFM
     return 0;
   }
 
+  template <class EC>
+  void ElementRegistry<EC>::LibraryOpening::Open()
+  {
+    m_openError = m_loader.Open(*m_path);
+    if (!m_openError)
+      m_loadError = m_loader.LoadLibrary(&m_library);
+  }
+
+  template <class EC>
+  void * ElementRegistry<EC>::LibraryOpeningRunner(void * arg)
+  {
+    ((LibraryOpening *) arg)->Open();
+    return 0;
+  }
+
   template <class EC>
   s32 ElementRegistry<EC>::LoadLibraries(UlamClassRegistry<EC> & ucr)
   {
+    if (m_libraryPathsCount == 1)
+      return LoadLibrary(ucr, m_libraryPaths[0]);
+
+    // Open everything at once -- relocating big libraries is the
+    // slow part -- keeping the loaders until registration is done
+    LibraryOpening openings[MAX_PATHS];
+    for (u32 i = 0; i < m_libraryPathsCount; ++i) {
+      LibraryOpening & lo = openings[i];
+      lo.m_path = &m_libraryPaths[i];
+      lo.m_threaded = !pthread_create(&lo.m_thread, NULL, LibraryOpeningRunner, &lo);
+      if (!lo.m_threaded)
+        lo.Open();              // No thread?  Do it ourselves
+    }
+    for (u32 i = 0; i < m_libraryPathsCount; ++i) {
+      LibraryOpening & lo = openings[i];
+      if (lo.m_threaded)
+        MFM_API_ASSERT(!pthread_join(lo.m_thread, NULL), LOCK_FAILURE);
+    }
+
     u32 elementCount = 0;
     for (u32 i = 0; i < m_libraryPathsCount; ++i) {
-      s32 ret = LoadLibrary(ucr, m_libraryPaths[i]);
+      LibraryOpening & lo = openings[i];
+      if (lo.m_openError) {
+        LOG.Error("Dynamic library failure on %s", lo.m_openError);
+        return -1;
+      }
+      if (lo.m_loadError) {
+        LOG.Error("ElementLibrary not loadable from %s", lo.m_loadError);
+        return -1;
+      }
+      s32 ret = RegisterLibrary(ucr, *lo.m_library, *lo.m_path);
       if (ret < 0) return ret;
       elementCount += (u32) ret;
     }
@@ -169,6 +234,13 @@ namespace MFM
       LOG.Error("ElementLibrary not loadable from %s", err);
       return -1;
     }
+    return RegisterLibrary(ucr, *el, libraryPath);
+  }
+
+  template <class EC>
+  s32 ElementRegistry<EC>::RegisterLibrary(UlamClassRegistry<EC> & ucr, ElementLibrary<EC> & library, OString256 & libraryPath)
+  {
+    ElementLibrary<EC> * el = &library;
     u32 count = el->m_elementCount;
     for (u32 i = 0; i < count; ++i) {
       ElementLibraryStub<EC> * els = el->m_elementStubPtrArray[i];
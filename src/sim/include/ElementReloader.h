@@ -0,0 +1,151 @@
+/*                                              -*- mode:C++ -*-
+  ElementReloader.h Swapping a rebuilt element library into a paused grid
+  Copyright (C) 2014-2016 The Regents of the University of New Mexico.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+  USA
+*/
+
+/**
+  \file ElementReloader.h Swapping a rebuilt element library into a paused grid
+  \date (C) 2014-2016 All rights reserved.
+  \lgpl
+ */
+#ifndef ELEMENTRELOADER_H
+#define ELEMENTRELOADER_H
+
+#include "itype.h"
+#include "Grid.h"
+#include "ElementRegistry.h"
+
+namespace MFM
+{
+  /**
+     An ElementReloader loads a new build of an element library into
+     a grid that's already running it, without restarting: edit the
+     ulam, rebuild the .so, pause, Reload, and carry on with the
+     atoms already on the grid.
+
+     Each element of the new build replaces the loaded element with
+     the same UUID label, in every tile's element table, the ulam
+     class registries, and the element registries, so the next event
+     an atom gets runs the new code.  Atoms whose element's type
+     changed are retyped, keeping their state bits; ulam classes are
+     swapped by mangled name.  Elements new to the build are
+     registered as if they had been loaded at startup.
+
+     The old build stays mapped, since it's cheaper to leak than to
+     prove nothing points into it.  For a rebuilt library to get its
+     own elements instead of aliases of the loaded ones, it must be
+     built with -fno-gnu-unique; Reload detects and refuses one that
+     wasn't.
+   */
+  template <class GC>
+  class ElementReloader
+  {
+    typedef typename GC::EVENT_CONFIG EC;
+    typedef typename EC::ATOM_CONFIG AC;
+    typedef typename AC::ATOM_TYPE T;
+    typedef typename EC::SITE S;
+
+  public:
+
+    enum
+    {
+      MAX_ELEMENTS = ElementRegistry<EC>::TABLE_SIZE
+    };
+
+    /**
+       Reload into \c grid.  If \c libraries isn't NULL it holds every
+       library element, Needed or not -- as the AbstractDriver's
+       registry does -- and is kept up to date too; otherwise the
+       grid's own registry is all there is to match against.
+     */
+    ElementReloader(Grid<GC> & grid, ElementRegistry<EC> * libraries) ;
+
+    /**
+       Load the element library at \c path and swap it in.  The grid
+       must not be running.
+
+       @returns the number of elements replaced or added, or -1 if
+       the library couldn't be loaded or doesn't fit, in which case
+       nothing has changed
+     */
+    s32 Reload(const char * path) ;
+
+    /** How many elements the last Reload replaced */
+    u32 GetReplacedCount() const
+    {
+      return m_replaced;
+    }
+
+    /** The index'th element the last Reload replaced */
+    Element<EC> * GetOldElement(u32 index) const
+    {
+      MFM_API_ASSERT_ARG(index < m_replaced);
+      return m_olds[index];
+    }
+
+    /** What the last Reload replaced GetOldElement(index) with */
+    Element<EC> * GetNewElement(u32 index) const
+    {
+      MFM_API_ASSERT_ARG(index < m_replaced);
+      return m_news[index];
+    }
+
+  private:
+    Grid<GC> & m_grid;
+    ElementRegistry<EC> * m_libraries;
+    u32 m_reloads;                       // For unique copy names
+
+    Element<EC> * m_olds[MAX_ELEMENTS];  // Replaced..
+    Element<EC> * m_news[MAX_ELEMENTS];  // ..by these
+    u32 m_replaced;
+
+    Element<EC> * m_added[MAX_ELEMENTS]; // No old version
+    u32 m_addedCount;
+
+    ElementRegistry<EC> & GetLibraries()
+    {
+      return m_libraries ? *m_libraries : m_grid.m_er;
+    }
+
+    /** The loaded element whose UUID has the label of uuid, or NULL */
+    Element<EC> * FindOld(const UUID & uuid) ;
+
+    /**
+       Copy the library at path to a fresh file, naming it in copy,
+       since dlopen hands back the loaded library for a path -- or
+       inode -- it already has open.  Returns 0 or an error message.
+     */
+    const char * CopyLibrary(const char * path, OString256 & copy) ;
+
+    /** Check that swapping won't give two of tile's elements one type */
+    bool TypesStayUnique(const Tile<EC> & tile) const ;
+
+    /** Give atom its new element's type, if that changed */
+    void Retype(T & atom) const ;
+
+    void RetypeAtoms(Tile<EC> & tile) const ;
+
+    // Declare away
+    ElementReloader(const ElementReloader &) ;
+    ElementReloader & operator=(const ElementReloader &) ;
+  };
+} /* namespace MFM */
+
+#include "ElementReloader.tcc"
+
+#endif /* ELEMENTRELOADER_H */
@@ -0,0 +1,268 @@
+/* -*- C++ -*- */
+#include <stdio.h>      /* For fopen, fread, fwrite */
+#include <stdlib.h>     /* For getenv */
+#include <string.h>     /* For strrchr, strcmp, strerror */
+#include <errno.h>      /* For errno */
+#include <unistd.h>     /* For getpid, unlink */
+#include "ElementLibraryLoader.h"
+
+namespace MFM
+{
+  template <class GC>
+  ElementReloader<GC>::ElementReloader(Grid<GC> & grid, ElementRegistry<EC> * libraries)
+    : m_grid(grid)
+    , m_libraries(libraries)
+    , m_reloads(0)
+    , m_replaced(0)
+    , m_addedCount(0)
+  { }
+
+  template <class GC>
+  Element<typename GC::EVENT_CONFIG> * ElementReloader<GC>::FindOld(const UUID & uuid)
+  {
+    ElementRegistry<EC> & er = GetLibraries();
+    for (u32 i = 0; i < er.GetEntryCount(); ++i)
+    {
+      if (er.GetEntryUUID(i).CompatibleLabel(uuid))
+        return er.GetRegisteredElement(i);
+    }
+    return 0;
+  }
+
+  template <class GC>
+  const char * ElementReloader<GC>::CopyLibrary(const char * path, OString256 & copy)
+  {
+    const char * tmp = getenv("TMPDIR");
+    const char * base = strrchr(path, '/');
+    copy.Reset();
+    copy.Printf("%s/mfm-reload-%d-%d-%s",
+                tmp ? tmp : "/tmp", (s32) getpid(), m_reloads, base ? base + 1 : path);
+    if (copy.HasOverflowed())
+      return "Copy path too long";
+
+    FILE * in = fopen(path, "rb");
+    if (!in)
+      return strerror(errno);
+    FILE * out = fopen(copy.GetZString(), "wb");
+    if (!out)
+    {
+      const char * err = strerror(errno);
+      fclose(in);
+      return err;
+    }
+
+    bool ok = true;
+    char buf[1<<16];
+    size_t len;
+    while (ok && (len = fread(buf, 1, sizeof(buf), in)) > 0)
+      ok = fwrite(buf, 1, len, out) == len;
+    ok = ok && !ferror(in);
+    fclose(in);
+    ok = !fclose(out) && ok;
+    if (!ok)
+    {
+      unlink(copy.GetZString());
+      return "Copy failed";
+    }
+    return 0;
+  }
+
+  template <class GC>
+  bool ElementReloader<GC>::TypesStayUnique(const Tile<EC> & tile) const
+  {
+    const ElementTable<EC> & et = tile.GetElementTable();
+    u32 types[ElementTable<EC>::SIZE + MAX_ELEMENTS];
+    u32 count = 0;
+    for (u32 i = 0; i < et.GetSize(); ++i)
+    {
+      const Element<EC> * elt = et.GetElementAtIndex(i);
+      if (!elt) continue;
+      for (u32 j = 0; j < m_replaced; ++j)
+      {
+        if (m_olds[j] == elt)
+        {
+          elt = m_news[j];
+          break;
+        }
+      }
+      types[count++] = elt->GetType();
+    }
+    for (u32 j = 0; j < m_addedCount; ++j)
+      types[count++] = m_added[j]->GetType();
+
+    for (u32 i = 0; i < count; ++i)
+    {
+      for (u32 j = i + 1; j < count; ++j)
+      {
+        if (types[i] == types[j])
+          return false;
+      }
+    }
+    return true;
+  }
+
+  template <class GC>
+  void ElementReloader<GC>::Retype(T & atom) const
+  {
+    const u32 type = atom.GetType();
+    for (u32 j = 0; j < m_replaced; ++j)
+    {
+      if (m_olds[j]->GetType() != type) continue;
+      if (m_news[j]->GetType() != type)
+      {
+        T fresh = m_news[j]->GetDefaultAtom();
+        fresh.ReadStateBits(atom.GetBits());
+        atom = fresh;
+      }
+      return;
+    }
+  }
+
+  template <class GC>
+  void ElementReloader<GC>::RetypeAtoms(Tile<EC> & tile) const
+  {
+    for (u32 row = 0; row < tile.GetSiteSpanCount(true); ++row)
+    {
+      u32 length;
+      S * sites = tile.GetSiteSpan(row, true, length);
+      for (u32 x = 0; x < length; ++x)
+      {
+        Retype(sites[x].GetAtom());
+        Retype(sites[x].GetBase().GetBaseAtom());
+      }
+    }
+  }
+
+  template <class GC>
+  s32 ElementReloader<GC>::Reload(const char * path)
+  {
+    MFM_API_ASSERT_NONNULL(path);
+    MFM_API_ASSERT_STATE(!m_grid.m_threadsInitted || m_grid.AreTileThreadsPaused());
+
+    m_replaced = 0;
+    m_addedCount = 0;
+
+    OString256 copy;
+    const char * err = CopyLibrary(path, copy);
+    if (err)
+    {
+      LOG.Error("Can't reload %s: %s", path, err);
+      return -1;
+    }
+
+    ElementLibraryLoader<EC> loader;
+    err = loader.OpenIsolated(copy);
+    unlink(copy.GetZString());    // The mapping outlives the name
+    ElementLibrary<EC> * el = 0;
+    if (!err)
+      err = loader.LoadLibrary(&el);
+    if (err)
+    {
+      LOG.Error("Can't reload %s: %s", path, err);
+      return -1;
+    }
+
+    const u32 count = el->m_elementCount;
+    const u32 ocount = el->m_otherUlamClassCount;
+    if (count > MAX_ELEMENTS || count + ocount > UlamClassRegistry<EC>::TABLE_SIZE)
+    {
+      LOG.Error("Can't reload %s: Too many elements or classes", path);
+      return -1;
+    }
+
+    UlamClass<EC> * ucs[UlamClassRegistry<EC>::TABLE_SIZE];
+    u32 ucCount = 0;
+    for (u32 i = 0; i < count; ++i)
+    {
+      ElementLibraryStub<EC> * els = el->m_elementStubPtrArray[i];
+      Element<EC> * elt = els ? els->GetElement() : 0;
+      if (!elt)
+      {
+        LOG.Error("Can't reload %s: No element %d", path, i);
+        return -1;
+      }
+
+      const UUID & uuid = elt->GetUUID();
+      UlamElement<EC> * uelt = elt->AsUlamElement();
+      if (uelt && !strcmp(uelt->GetMangledClassName(), "Ue_10105Empty10"))
+        elt->AllocateEmptyType();
+      else
+        elt->AllocateType();
+
+      Element<EC> * old = FindOld(uuid);
+      if (old == elt)
+      {
+        LOG.Error("Can't reload %s: %@ resolved to the loaded copy; "
+                  "build the library with -fno-gnu-unique", path, &uuid);
+        return -1;
+      }
+      if (old)
+      {
+        if (!uuid.Compatible(old->GetUUID()))
+          LOG.Warning("Reloading %@ over incompatible %@", &uuid, &old->GetUUID());
+        m_olds[m_replaced] = old;
+        m_news[m_replaced++] = elt;
+      }
+      else
+        m_added[m_addedCount++] = elt;
+
+      if (uelt)
+        ucs[ucCount++] = uelt;
+    }
+    for (u32 i = 0; i < ocount; ++i)
+    {
+      UlamClass<EC> * ucp = el->m_otherUlamClassPtrArray[i];
+      if (!ucp)
+      {
+        LOG.Error("Can't reload %s: No ulam class %d", path, i);
+        return -1;
+      }
+      ucs[ucCount++] = ucp;
+    }
+
+    if (!TypesStayUnique(m_grid.Get00Tile()))
+    {
+      LOG.Error("Can't reload %s: Element types would collide", path);
+      return -1;
+    }
+
+    // Last check, and first change
+    UlamClassRegistry<EC> & ucr = m_grid.GetUlamClassRegistry();
+    if (!ucr.ReplaceUlamClasses(ucs, ucCount))
+    {
+      LOG.Error("Can't reload %s: Ulam class numbers collide with loaded classes", path);
+      return -1;
+    }
+
+    bool retyping = false;
+    for (u32 j = 0; j < m_replaced; ++j)
+      retyping = retyping || m_olds[j]->GetType() != m_news[j]->GetType();
+
+    for (typename Grid<GC>::iterator_type i = m_grid.begin(); i != m_grid.end(); ++i)
+    {
+      i->ReplaceElements(m_olds, m_news, m_replaced);
+      i->GetUlamClassRegistry() = ucr;
+      if (retyping)
+        RetypeAtoms(*i);
+    }
+
+    for (u32 j = 0; j < m_replaced; ++j)
+    {
+      GetLibraries().ReplaceElement(*m_olds[j], *m_news[j]);
+      if (m_libraries)
+        m_grid.m_er.ReplaceElement(*m_olds[j], *m_news[j]);  // If it was Needed
+    }
+    for (u32 j = 0; j < m_addedCount; ++j)
+    {
+      GetLibraries().RegisterElement(*m_added[j]);
+      if (!m_grid.m_deferredElements)
+        m_grid.Needed(*m_added[j]);
+    }
+
+    loader.Release();             // Its elements are ours now
+    ++m_reloads;
+    LOG.Message("Reloaded %s: %d element(s) replaced, %d added, %d ulam class(es)%s",
+                path, m_replaced, m_addedCount, ucCount, retyping ? ", atoms retyped" : "");
+    return (s32) (m_replaced + m_addedCount);
+  }
+} /* namespace MFM */
@@ -0,0 +1,136 @@
+/*                                              -*- mode:C++ -*-
+  EpochJobQueue.h Background writer for end-of-epoch output
+  Copyright (C) 2020 The Living Computation Foundation.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+  USA
+*/
+
+/**
+  \file EpochJobQueue.h Background writer for end-of-epoch output
+  \author David H. Ackley.
+  \date (C) 2020 All rights reserved.
+  \lgpl
+ */
+#ifndef EPOCHJOBQUEUE_H
+#define EPOCHJOBQUEUE_H
+
+#include "itype.h"
+#include "FileByteSink.h"
+#include "OverflowableCharBufferByteSink.h"
+#include <pthread.h>
+
+namespace MFM
+{
+  /**
+     An EpochJobQueue takes the files written at the end of an epoch
+     -- data logs, images, autosaves -- off the driver's thread.  The
+     driver formats each file's contents into memory while the grid
+     is paused, which is all the snapshot the output needs, and a
+     background thread writes the queued files to disk in order
+     after the grid has resumed.
+
+     A file is captured between BeginFile and EndFile, through
+     GetSink.  An appended file may also have a header, captured
+     through GetHeaderSink, that is written first only if the file
+     doesn't exist yet when its turn comes.  At most
+     MAX_PENDING_FILES wait at once; EndFile waits for room beyond
+     that, so a slow disk slows epochs rather than filling memory.
+   */
+  class EpochJobQueue
+  {
+  public:
+    enum { MAX_PENDING_FILES = 64 };
+
+    EpochJobQueue() ;
+
+    /** Writes whatever is still queued, then stops the thread */
+    ~EpochJobQueue() ;
+
+    /**
+       Start capturing the contents of \a path, to replace it or, if
+       \a append, to be added to its end.  FAILs with ILLEGAL_STATE
+       if a capture is already under way.
+     */
+    void BeginFile(const char * path, bool append) ;
+
+    /** Where the contents of the file being captured go */
+    FileByteSink & GetSink() ;
+
+    /** Where the header of the appended file being captured goes */
+    FileByteSink & GetHeaderSink() ;
+
+    /** Queue the file captured since BeginFile for writing */
+    void EndFile() ;
+
+    /** Wait until every queued file has been written */
+    void Finish() ;
+
+    /** Files queued and not yet written */
+    u32 GetPendingCount() ;
+
+    /** Files written since construction */
+    u32 GetWrittenCount() ;
+
+    /** Files that couldn't be written, since construction */
+    u32 GetFailedCount() ;
+
+  private:
+    struct Job
+    {
+      OString512 m_path;
+      bool m_append;
+      char * m_header;      // From open_memstream, or 0
+      size_t m_headerLength;
+      char * m_text;        // From open_memstream
+      size_t m_length;
+      Job * m_next;
+    };
+
+    /* The capture under way, if any */
+    Job * m_capture;
+    FileByteSink * m_sink;
+    FileByteSink * m_headerSink;
+
+    /* Queued jobs, oldest first, under m_lock */
+    pthread_mutex_t m_lock;
+    pthread_cond_t m_queued;     // Signaled when a job is added or m_stopping
+    pthread_cond_t m_written;    // Signaled when a job is finished
+    Job * m_head;
+    Job * m_tail;
+    u32 m_pending;               // Queued or being written
+    u32 m_writtenCount;
+    u32 m_failedCount;
+    bool m_stopping;
+
+    pthread_t m_thread;
+    bool m_threadStarted;
+
+    static void * WriterRunner(void * arg) ;
+
+    void RunWriter() ;
+
+    /** Write \a job's file.  \returns false if that failed */
+    static bool WriteJob(const Job & job) ;
+
+    static void FreeJob(Job * job) ;
+
+    // Declare away; the queue and thread are not copyable
+    EpochJobQueue(const EpochJobQueue &) ;
+    EpochJobQueue & operator=(const EpochJobQueue &) ;
+  };
+} /* namespace MFM */
+
+#endif /* EPOCHJOBQUEUE_H */
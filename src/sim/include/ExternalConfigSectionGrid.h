@@ -31,6 +31,8 @@
 #define EXTERNALCONFIGSECTIONGRID_H
 
 #include "ExternalConfig.h"
+#include <stdio.h>     /* For FILE */
+#include <pthread.h>
 
 namespace MFM
 {
@@ -141,6 +143,8 @@ namespace MFM
      */
     ExternalConfigSectionGrid(ExternalConfig<GC>& ec, Grid<GC>& grid);
 
+    virtual ~ExternalConfigSectionGrid() ;
+
     virtual void Reset() ;
 
     virtual void WriteSection(ByteSink & byteSink);
@@ -171,6 +175,46 @@ namespace MFM
       return m_grid;
     }
 
+    enum { MAX_SITE_THREADS = 64 };
+
+    /**
+     * Use up to \a threads threads (0: one per cpu; 1: just the
+     * caller) to format the Site() calls, a tile row at a time, when
+     * writing this section, and to parse them, a tile at a time,
+     * when reading it.  The file contents are the same either way.
+     */
+    void SetSiteThreads(u32 threads) ;
+
+    u32 GetSiteThreads() const
+    {
+      return m_siteThreads;
+    }
+
+    /**
+     * Include the Site() calls when writing this section (the
+     * default), or leave them out, so the section describes the grid
+     * and its elements but not what's in it.
+     */
+    void SetWriteSites(bool writeSites)
+    {
+      m_writeSites = writeSites;
+    }
+
+    /**
+     * Set aside the rest of a Site(x,y... call, up to its closing
+     * paren, to be parsed along with the other sites of its tile by
+     * LoadDeferredSites().  \returns false, having read nothing, if
+     * sites aren't being deferred or \a siteInGrid isn't in a tile.
+     */
+    bool DeferSite(const SPoint & siteInGrid, LineCountingByteSource & in) ;
+
+    /**
+     * Parse all the sites set aside by DeferSite(), on up to
+     * GetSiteThreads() threads.  Sites that fail to load are warned
+     * about and skipped, as when loading sequentially.
+     */
+    void LoadDeferredSites() ;
+
   private:
 
     /**
@@ -201,6 +245,51 @@ namespace MFM
     FunctionCallSite<GC> m_fcSite;
     FunctionCallSetElementParameter<GC> m_fcSetElementParameter;
 
+    u32 m_siteThreads;
+
+    bool m_writeSites;
+
+    /** The Site() calls of one tile row (writing) or tile (reading) */
+    struct SiteSpan {
+      char * m_text;        // From open_memstream, or 0
+      size_t m_length;
+      FILE * m_fp;          // Non-null while the text is being added to
+      u32 m_failures;       // Sites that failed to load
+      SPoint m_firstFailure;
+    };
+
+    SiteSpan * m_siteSpans;
+    u32 m_siteSpanCount;
+    u32 m_deferredSites;
+
+    typedef void (ExternalConfigSectionGrid::* SpanJob)(u32 span);
+
+    struct SpanWorker {
+      ExternalConfigSectionGrid * m_ecsg;
+      SpanJob m_job;
+      u32 m_first;          // Spans m_first, m_first+m_stride, ..
+      u32 m_stride;
+      pthread_t m_thread;
+      MFMErrorEnvironmentPointer_t m_errorStackTop;
+
+      void RunJobs() ;
+    };
+
+    static void * SpanWorkerRunner(void * arg) ;
+
+    /** Run \a job on each span, spread over up to m_siteThreads threads */
+    void RunSpanJobs(SpanJob job) ;
+
+    void AllocateSiteSpans(u32 count) ;
+
+    void FreeSiteSpans() ;
+
+    void WriteSiteRows(ByteSink & byteSink, u32 firstY, u32 lastY) ;
+
+    void WriteSiteBand(u32 span) ;
+
+    void LoadSiteSpan(u32 span) ;
+
   };
 }
 
@@ -1,8 +1,12 @@
 /* -*- C++ -*- */
 #include "ConfigFunctionCall.h"
 #include "AtomSerializer.h"
+#include "CharBufferByteSource.h"
+#include "FileByteSink.h"
 #include <string.h>
 #include <ctype.h>
+#include <stdlib.h>  /* For free */
+#include <unistd.h>  /* For sysconf */
 
 namespace MFM
 {
@@ -128,6 +132,8 @@ namespace MFM
 
     if (!pelt) return false; // error message already issued
 
+    ec.LoadDeferredSites();  // Earlier Site()s come first
+
     s32 x, y;
 
     OString128 hexData;
@@ -177,6 +183,8 @@ namespace MFM
     Grid<GC> & grid = ec.GetGrid();
     in.SkipWhitespace();
 
+    ec.LoadDeferredSites();  // Earlier Site()s come first
+
     u32 x, y;
     if (3 != in.Scanf("%d,%d",&x,&y))
       return false;
@@ -210,6 +218,9 @@ namespace MFM
     if (3 != in.Scanf("%d,%d",&tmp_x,&tmp_y))
       return false;
 
+    if (ec.DeferSite(SPoint(tmp_x,tmp_y), in))
+      return in.Scanf(")") == 1;
+
     if (!ec.GetGrid().LoadSite(SPoint(tmp_x,tmp_y), in, ec)) {
       in.Msg(Logger::WARNING, "Loading site (%d,%d) failed, trying to continue", tmp_x, tmp_y);
       in.SkipSet("[^)]");
@@ -280,8 +291,19 @@ namespace MFM
     , m_fcGA(*this)
     , m_fcSite(*this)
     , m_fcSetElementParameter(*this)
+    , m_siteThreads(1)
+    , m_writeSites(true)
+    , m_siteSpans(0)
+    , m_siteSpanCount(0)
+    , m_deferredSites(0)
   { }
 
+  template<class GC>
+  ExternalConfigSectionGrid<GC>::~ExternalConfigSectionGrid()
+  {
+    FreeSiteSpans();
+  }
+
   template<class GC>
   void ExternalConfigSectionGrid<GC>::Reset()
   {
@@ -292,12 +314,17 @@ namespace MFM
   bool ExternalConfigSectionGrid<GC>::ReadInit()
   {
     m_grid.Clear();
+    FreeSiteSpans();
+    if (m_siteThreads != 1)
+      AllocateSiteSpans(m_grid.GetWidth() * m_grid.GetHeight());
     return true;
   }
 
   template<class GC>
   bool ExternalConfigSectionGrid<GC>::ReadFinalize()
   {
+    LoadDeferredSites();
+    FreeSiteSpans();
     m_grid.RefreshAllCaches();
     m_grid.RecountAtoms();
     return true;
@@ -357,16 +384,42 @@ namespace MFM
 	byteSink.Printf(")\n");
       }
 
-    /* Then, write ALL the damn sites, */
-    /* and GA all live atoms. */
+    if (!m_writeSites)
+      return;
+
+    /* Then, write ALL the damn sites, a tile row of sites at a time */
+    const u32 gridHeight = m_grid.GetHeightSites();
+    const u32 bandHeight = m_grid.GetOwnedHeight();
+    const u32 bands = (gridHeight + bandHeight - 1) / bandHeight;
+
+    if (m_siteThreads == 1 || bands < 2)
+      WriteSiteRows(byteSink, 0, gridHeight);
+    else
+    {
+      AllocateSiteSpans(bands);
+      RunSpanJobs(&ExternalConfigSectionGrid<GC>::WriteSiteBand);
+      for (u32 b = 0; b < bands; ++b)
+      {
+        SiteSpan & ss = m_siteSpans[b];
+        if (ss.m_text)
+          byteSink.WriteBytes((const u8 *) ss.m_text, (u32) ss.m_length);
+        else  // Couldn't buffer it; write it here
+          WriteSiteRows(byteSink, b * bandHeight, MIN((b + 1) * bandHeight, gridHeight));
+      }
+      FreeSiteSpans();
+    }
+    byteSink.WriteNewline();
+  }
 
+  template<class GC>
+  void ExternalConfigSectionGrid<GC>::WriteSiteRows(ByteSink & byteSink, u32 firstY, u32 lastY)
+  {
     /* The grid size in sites excluding caches */
     /* The grid size in sites including staggered dummy tiles */
     const u32 gridWidth = m_grid.GetWidthSites();
-    const u32 gridHeight = m_grid.GetHeightSites();
     const bool isStaggeredGrid = m_grid.IsGridLayoutStaggered();
 
-    for(u32 y = 0; y < gridHeight; y++)
+    for(u32 y = firstY; y < lastY; y++)
       {
 	for(u32 x = 0; x < gridWidth; x++)
 	  {
@@ -406,7 +459,211 @@ namespace MFM
 
 	  }
       }
-    byteSink.WriteNewline();
+  }
+
+  template<class GC>
+  void ExternalConfigSectionGrid<GC>::WriteSiteBand(u32 span)
+  {
+    SiteSpan & ss = m_siteSpans[span];
+    ss.m_fp = open_memstream(&ss.m_text, &ss.m_length);
+    if (!ss.m_fp) return;  // WriteSection will do this band itself
+
+    const u32 bandHeight = m_grid.GetOwnedHeight();
+    const u32 firstY = span * bandHeight;
+    FileByteSink fbs(ss.m_fp);
+    WriteSiteRows(fbs, firstY, MIN(firstY + bandHeight, m_grid.GetHeightSites()));
+    fclose(ss.m_fp);
+    ss.m_fp = 0;
+  }
+
+  template<class GC>
+  void ExternalConfigSectionGrid<GC>::SetSiteThreads(u32 threads)
+  {
+    MFM_API_ASSERT_ARG(threads <= MAX_SITE_THREADS);
+    m_siteThreads = threads;
+  }
+
+  template<class GC>
+  bool ExternalConfigSectionGrid<GC>::DeferSite(const SPoint & siteInGrid, LineCountingByteSource & in)
+  {
+    if (!m_siteSpans || !m_grid.IsGridCoord(siteInGrid))
+      return false;
+
+    SPoint tileInGrid, siteInTile;
+    if (!m_grid.MapGridToTile(siteInGrid, tileInGrid, siteInTile))
+      return false;
+
+    const u32 span = tileInGrid.GetY() * m_grid.GetWidth() + tileInGrid.GetX();
+    MFM_API_ASSERT_STATE(span < m_siteSpanCount);
+
+    SiteSpan & ss = m_siteSpans[span];
+    if (!ss.m_fp)
+    {
+      free(ss.m_text);   // Already loaded, if any
+      ss.m_text = 0;
+      ss.m_fp = open_memstream(&ss.m_text, &ss.m_length);
+      if (!ss.m_fp) return false;  // Load this one now
+    }
+
+    FileByteSink fbs(ss.m_fp);
+    fbs.Printf("%d,%d", siteInGrid.GetX(), siteInGrid.GetY());
+    in.Scanf("%[^)]", &fbs);
+    fbs.Printf(")");
+    ++m_deferredSites;
+    return true;
+  }
+
+  template<class GC>
+  void ExternalConfigSectionGrid<GC>::LoadDeferredSites()
+  {
+    if (m_deferredSites == 0) return;
+
+    for (u32 i = 0; i < m_siteSpanCount; ++i)
+    {
+      SiteSpan & ss = m_siteSpans[i];
+      if (ss.m_fp)
+      {
+        fclose(ss.m_fp);
+        ss.m_fp = 0;
+      }
+      ss.m_failures = 0;
+    }
+
+    RunSpanJobs(&ExternalConfigSectionGrid<GC>::LoadSiteSpan);
+
+    LineCountingByteSource & in = this->GetByteSource();
+    for (u32 i = 0; i < m_siteSpanCount; ++i)
+    {
+      SiteSpan & ss = m_siteSpans[i];
+      if (ss.m_failures > 0)
+        in.Msg(Logger::WARNING, "Loading %u site(s) of tile %u failed, first (%d,%d), continuing",
+               ss.m_failures, i, ss.m_firstFailure.GetX(), ss.m_firstFailure.GetY());
+      free(ss.m_text);
+      ss.m_text = 0;
+      ss.m_length = 0;
+    }
+    m_deferredSites = 0;
+  }
+
+  template<class GC>
+  void ExternalConfigSectionGrid<GC>::LoadSiteSpan(u32 span)
+  {
+    SiteSpan & ss = m_siteSpans[span];
+    if (!ss.m_text) return;
+
+    CharBufferByteSource cbs(ss.m_text, (u32) ss.m_length);
+    LineCountingByteSource in;
+    in.SetByteSource(cbs);
+
+    s32 x, y;
+    while (3 == in.Scanf("%d,%d", &x, &y))
+    {
+      const SPoint site(x, y);
+      volatile bool loaded = false;
+      unwind_protect(
+      {
+        loaded = false;
+      },
+      {
+        loaded = m_grid.LoadSite(site, in, *this);
+      });
+
+      if (!loaded)
+      {
+        if (ss.m_failures++ == 0)
+          ss.m_firstFailure = site;
+        in.SkipSet("[^)]");
+      }
+      if (in.Scanf(")") != 1)
+        break;
+    }
+  }
+
+  template<class GC>
+  void ExternalConfigSectionGrid<GC>::AllocateSiteSpans(u32 count)
+  {
+    FreeSiteSpans();
+    m_siteSpans = new SiteSpan[count];
+    m_siteSpanCount = count;
+    for (u32 i = 0; i < count; ++i)
+    {
+      SiteSpan & ss = m_siteSpans[i];
+      ss.m_text = 0;
+      ss.m_length = 0;
+      ss.m_fp = 0;
+      ss.m_failures = 0;
+    }
+  }
+
+  template<class GC>
+  void ExternalConfigSectionGrid<GC>::FreeSiteSpans()
+  {
+    for (u32 i = 0; i < m_siteSpanCount; ++i)
+    {
+      SiteSpan & ss = m_siteSpans[i];
+      if (ss.m_fp) fclose(ss.m_fp);
+      free(ss.m_text);
+    }
+    delete [] m_siteSpans;
+    m_siteSpans = 0;
+    m_siteSpanCount = 0;
+    m_deferredSites = 0;
+  }
+
+  template<class GC>
+  void ExternalConfigSectionGrid<GC>::SpanWorker::RunJobs()
+  {
+    for (u32 s = m_first; s < m_ecsg->m_siteSpanCount; s += m_stride)
+      (m_ecsg->*m_job)(s);
+  }
+
+  template<class GC>
+  void * ExternalConfigSectionGrid<GC>::SpanWorkerRunner(void * arg)
+  {
+    SpanWorker & w = *(SpanWorker *) arg;
+
+    // Init error stack pointer (for this thread only)
+    MFMPtrToErrEnvStackPtr = &w.m_errorStackTop;
+
+    w.RunJobs();
+    return 0;
+  }
+
+  template<class GC>
+  void ExternalConfigSectionGrid<GC>::RunSpanJobs(SpanJob job)
+  {
+    u32 threads = m_siteThreads;
+    if (threads == 0)
+    {
+      long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+      threads = cpus > 0 ? (u32) cpus : 1;
+    }
+    threads = MIN(threads, MIN(m_siteSpanCount, (u32) MAX_SITE_THREADS));
+
+    SpanWorker workers[MAX_SITE_THREADS];
+    u32 started = 1;  // The caller is worker 0
+    for (u32 t = 0; t < threads; ++t)
+    {
+      SpanWorker & w = workers[t];
+      w.m_ecsg = this;
+      w.m_job = job;
+      w.m_first = t;
+      w.m_stride = threads;
+      w.m_errorStackTop = 0;
+      if (t > 0 && started == t)
+      {
+        if (pthread_create(&w.m_thread, NULL, SpanWorkerRunner, &w) == 0)
+          ++started;
+      }
+    }
+
+    // Spans of any threads that didn't start are run here too
+    for (u32 t = started; t < threads; ++t)
+      workers[t].RunJobs();
+    workers[0].RunJobs();
+
+    for (u32 t = 1; t < started; ++t)
+      pthread_join(workers[t].m_thread, NULL);
   }
 
   template<class GC>
@@ -414,23 +671,17 @@ namespace MFM
   {
     LineCountingByteSource & lcbs = this->GetByteSource();
     Element<EC> * elt = m_elementRegistry.Lookup(uuid);
-    const UUID * puuid = 0;
+    if (!elt)
+      elt = m_grid.NeedDeferredElement(uuid); // Exact or compatible, if deferring
     if (!elt) {
-
       elt =  m_elementRegistry.LookupCompatible(uuid);
       if (!elt)
         return lcbs.Msg(Logger::WARNING, "No alternatives found for unknown/unregistered element '%@'", &uuid);
-
-      puuid = &elt->GetUUID();
-      lcbs.Msg(Logger::WARNING, "Using more recent '%@' for '%@'", puuid, &uuid);
-    }
-    else
-    {
-      puuid = &elt->GetUUID();
     }
 
-    if (!puuid)
-      FAIL(NULL_POINTER);
+    const UUID * puuid = &elt->GetUUID();
+    if (!puuid->Equals(uuid))
+      lcbs.Msg(Logger::WARNING, "Using more recent '%@' for '%@'", puuid, &uuid);
 
     for (u32 i = 0; i < m_registeredElementCount; ++i) {
       RegElt & re = m_registeredElements[i];
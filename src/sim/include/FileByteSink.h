@@ -30,6 +30,7 @@
 
 #include "itype.h"
 #include <stdio.h>
+#include <string.h>  /* For memcpy */
 #include "ByteSink.h"
 
 namespace MFM
@@ -37,6 +38,13 @@ namespace MFM
   /**
    * A ByteSink that wraps a stdio.h FILE * pointer for disk file
    * output.
+   *
+   * By default every WriteBytes goes straight to fwrite.  For big
+   * outputs, SetBufferBytes gives the sink its own buffer, so the
+   * many small writes a Printf makes cost a memcpy each and the file
+   * sees only buffer-sized writes; Flush and Close drain it.  On top
+   * of that, SetDirectIO sends the buffer to the file descriptor
+   * with O_DIRECT, bypassing the page cache, in aligned blocks.
    */
   class FileByteSink : public ByteSink
   {
@@ -48,7 +56,28 @@ namespace MFM
     FILE * m_file;
     bool m_lineBuffered;  //< If true, flush after each \n written
 
+    u8 * m_buffer;        //< Our own output buffer, or 0 for none
+    u32 m_bufferBytes;    //< Size of m_buffer
+    u32 m_used;           //< Bytes waiting in m_buffer
+    bool m_direct;        //< If true, m_buffer goes out with O_DIRECT
+
+    /** Write out m_buffer; with O_DIRECT, all but any partial block
+     *  unless \a all.  FAILs IO_ERROR if the write fails. */
+    void DrainBuffer(bool all) ;
+
+    /** Write \a len bytes to the fd with O_DIRECT on or off */
+    void WriteDescriptor(const u8 * data, u32 len) ;
+
+    void FreeBuffer() ;
+
   public:
+    enum {
+      /** Block size and alignment used for O_DIRECT writes */
+      DIRECT_IO_ALIGN = 4096,
+
+      /** A reasonable SetBufferBytes for saves and data files */
+      LARGE_BUFFER_BYTES = 1<<20
+    };
 
     /**
      * Constructs a new FileByteSink which writes bytes to a given
@@ -64,6 +93,10 @@ namespace MFM
     FileByteSink(FILE * file, bool buffered = false)
       : m_file(file)
       , m_lineBuffered(buffered)
+      , m_buffer(0)
+      , m_bufferBytes(0)
+      , m_used(0)
+      , m_direct(false)
     {
       if (!file)
       {
@@ -71,23 +104,25 @@ namespace MFM
       }
     }
 
+    /**
+     * Drains any buffered output, if still open.  Close explicitly to
+     * find out about write errors.
+     */
+    ~FileByteSink() ;
+
     /** Determines if this FileByteSink is currently 'line buffered',
      *  meaning it will automatically flush after each '\n' is
      *  printed.
      */
     bool IsLineBuffered() const { return m_lineBuffered; }
 
-    /** Flush the underlying FILE* now.
+    /** Flush the underlying FILE* now, first writing out our own
+     *  buffer, if any.  With direct I/O, a final partial block stays
+     *  buffered until Close.
      *
      * Fail NULL_POINTER if closed
      */
-    void Flush() {
-      if(!m_file)
-      {
-	FAIL(NULL_POINTER);
-      }
-      fflush(m_file);
-    }
+    void Flush() ;
 
     /** Set the line buffering on this FileByteSink.
      *
@@ -96,13 +131,50 @@ namespace MFM
      */
     void SetLineBuffered(bool doLineBuffering) { m_lineBuffered = doLineBuffering; }
 
+    /**
+     * Buffer up to \a bytes of output in this FileByteSink before
+     * writing it to the file, or, if \a bytes is 0, stop buffering.
+     * Anything already buffered is written out first.  Line buffered
+     * sinks don't use the buffer.  With direct I/O, \a bytes is
+     * rounded up to a multiple of DIRECT_IO_ALIGN.
+     *
+     * Fail NULL_POINTER if closed
+     */
+    void SetBufferBytes(u32 bytes) ;
+
+    u32 GetBufferBytes() const { return m_bufferBytes; }
+
+    /**
+     * Write our buffer with O_DIRECT, for large files that needn't
+     * stay in the page cache.  Gives this sink a LARGE_BUFFER_BYTES
+     * buffer if it has none.  Direct I/O needs the file's current
+     * offset to be block aligned and the file system to support it;
+     * if either isn't so, this logs nothing, changes nothing, and
+     * returns false.  Line buffering is ignored while direct.
+     *
+     * Fail NULL_POINTER if closed
+     */
+    bool SetDirectIO(bool direct) ;
+
+    bool IsDirectIO() const { return m_direct; }
+
     virtual void WriteBytes(const u8 * data, const u32 len)
     {
       if(!m_file)
       {
 	FAIL(NULL_POINTER);
       }
-      if (!m_lineBuffered)
+      if (m_buffer && (!m_lineBuffered || m_direct))
+      {
+        if (len <= m_bufferBytes - m_used)
+        {
+          memcpy(m_buffer + m_used, data, len);
+          m_used += len;
+          return;
+        }
+        WriteBuffered(data, len);
+      }
+      else if (!m_lineBuffered)
       {
         size_t wrote = fwrite(data, 1, len, m_file);
         if (wrote != len)
@@ -110,32 +182,34 @@ namespace MFM
       }
       else
       {
-        for (u32 i = 0; i < len; ++i)
-        {
-          u8 ch = data[i];
-          size_t wrote = fwrite(&ch, 1, 1, m_file);
-          if (wrote != 1)
-            FAIL(IO_ERROR);
-          if (ch == '\n')
-            fflush(m_file);
-        }
+        WriteLines(data, len);
       }
     }
 
     /**
-     * Closes the FILE* backing this FileByteSink. This FileByteSink
-     * will no longer be able to be used after this is called.
+     * Closes the FILE* backing this FileByteSink, first writing out
+     * anything still buffered. This FileByteSink will no longer be
+     * able to be used after this is called.
+     *
+     * Fail IO_ERROR if buffered output can't be written
      */
-    void Close()
-    {
-      fclose(m_file);
-      m_file = NULL;
-    }
+    void Close() ;
 
     virtual s32 CanWrite()
     {
       return (m_file != NULL) ? 1 : -1; /* Can't write to a closed stream */
     }
+
+  private:
+    /** WriteBytes when \a data won't fit in what's left of m_buffer */
+    void WriteBuffered(const u8 * data, u32 len) ;
+
+    /** WriteBytes when line buffered: one write, then a flush, per line */
+    void WriteLines(const u8 * data, u32 len) ;
+
+    // Declare away
+    FileByteSink(const FileByteSink &) ;
+    FileByteSink & operator=(const FileByteSink &) ;
   };
 
   extern FileByteSink STDOUT;
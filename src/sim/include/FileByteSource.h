@@ -29,15 +29,29 @@
 #define FILEBYTESOURCE_H
 
 #include <stdio.h>
+#include <string.h>  /* For memcpy */
 #include "ByteSource.h"
 
 namespace MFM
 {
   /**
    * A ByteSource which uses a file descriptor as its reading source.
+   *
+   * Reads go through a large buffer of our own, filled by plain
+   * read(2) calls on a descriptor that's been advised it will be read
+   * sequentially, rather than through stdio one locked fgetc at a
+   * time.  GetByte is the inline, non-virtual way to take the next
+   * byte when the caller knows it has a FileByteSource; ReadBytes
+   * copies straight out of the buffer.
    */
   class FileByteSource : public ByteSource
   {
+  public:
+    enum {
+      /** Bytes requested from the file per refill */
+      BUFFER_BYTES = 1<<18
+    };
+
   private:
     /**
      * The file descriptor which backs this ByteSource. Is this is not
@@ -45,6 +59,13 @@ namespace MFM
      */
     FILE* m_fp;
 
+    u8 * m_buffer;  //< BUFFER_BYTES of read-ahead, once opened
+    u32 m_pos;      //< Next byte of m_buffer to hand out
+    u32 m_end;      //< End of the valid bytes in m_buffer
+
+    /** Refill m_buffer and return its first byte, or -1 at the end */
+    s32 Refill() ;
+
   public:
     /**
      * Constructs a new FileByteSource which is not ready for reading
@@ -52,7 +73,10 @@ namespace MFM
      */
     FileByteSource() :
       ByteSource(),
-      m_fp(NULL)
+      m_fp(NULL),
+      m_buffer(NULL),
+      m_pos(0),
+      m_end(0)
     { }
 
     /**
@@ -65,11 +89,19 @@ namespace MFM
      */
     FileByteSource(const char* filename) :
       ByteSource(),
-      m_fp(NULL)
+      m_fp(NULL),
+      m_buffer(NULL),
+      m_pos(0),
+      m_end(0)
     {
       Open(filename);
     }
 
+    /**
+     * Releases the read-ahead buffer.  Does not close the file.
+     */
+    virtual ~FileByteSource() ;
+
     /**
      * Opens the file at a given path and allows this FileByteSource
      * to begin reading from it. If this FileByteSource is already
@@ -80,13 +112,7 @@ namespace MFM
      * @param filename The string representing the path to the file
      *        wished to back this FileByteSource .
      */
-    void Open(const char* filename)
-    {
-      if(!m_fp)
-      {
-	m_fp = fopen(filename, "r");
-      }
-    }
+    void Open(const char* filename) ;
 
     /**
      * Checks to see if this FileByteSource is backed by a valid file
@@ -111,6 +137,21 @@ namespace MFM
 	fclose(m_fp);
 	m_fp = NULL;
       }
+      m_pos = m_end = 0;
+    }
+
+    /**
+     * Gets the next byte from the file, or -1 at the end, without a
+     * virtual call or any \c Unread() handling; see ByteSource::Read
+     * for that.
+     */
+    s32 GetByte()
+    {
+      if (m_pos < m_end)
+      {
+        return m_buffer[m_pos++];
+      }
+      return Refill();
     }
 
     virtual int ReadByte()
@@ -119,17 +160,44 @@ namespace MFM
       {
         FAIL(ILLEGAL_STATE);
       }
-      return fgetc(m_fp);
+      return GetByte();
+    }
+
+    virtual u32 ReadBytes(u8 * buf, u32 len)
+    {
+      if (!m_fp)
+      {
+        FAIL(ILLEGAL_STATE);
+      }
+      u32 got = 0;
+      while (got < len)
+      {
+        if (m_pos == m_end)
+        {
+          s32 ch = Refill();
+          if (ch < 0)
+          {
+            break;
+          }
+          --m_pos;   // Put it back; we copy it below
+        }
+        u32 chunk = m_end - m_pos;
+        if (chunk > len - got)
+        {
+          chunk = len - got;
+        }
+        memcpy(buf + got, m_buffer + m_pos, chunk);
+        m_pos += chunk;
+        got += chunk;
+      }
+      return got;
     }
 
     /**
      * Attempt to seek this FileByteSource to the given position.
      * \return true iff the seek succeeded
      */
-    bool Seek(long offset, int whence) {
-      MFM_API_ASSERT_STATE(m_fp);
-      return fseek(m_fp,offset,whence) == 0;
-    }
+    bool Seek(long offset, int whence) ;
 
     /**
      * Get the current file position of this FileByteSource
@@ -137,10 +205,12 @@ namespace MFM
      *
      * \sa Seek
      */
-    long Tell() const {
-      MFM_API_ASSERT_STATE(m_fp);
-      return ftell(m_fp);
-    }
+    long Tell() const ;
+
+  private:
+    // Declare away
+    FileByteSource(const FileByteSource &) ;
+    FileByteSource & operator=(const FileByteSource &) ;
   };
 }
 
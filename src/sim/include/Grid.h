@@ -32,18 +32,64 @@
 
 #include "itype.h"
 #include "SizedTile.h"
+#include "DynamicTile.h"
 #include "ElementTable.h"
 #include "Random.h"
 #include "Sense.h"
 #include "GridConfig.h"
 #include "GridTransceiver.h"
+#include "NUMAPlacement.h"
+#include "HugePageMemory.h"
 #include "ElementRegistry.h"
 #include "Logger.h"
+#include "MemoryAccount.h"
 #include "LineCountingByteSource.h"
+#include "AtomDump.h"
+#include "Rect.h"
+#include "FastClock.h"
+#include "TileSweeper.h"
+#include "TileStatsTree.h"
 #include <time.h>  /* For struct timespec, clock_gettime */
+#include <new>     /* For placement new */
+#include <pthread.h>
 
 namespace MFM {
 
+  template <class GC> class GridDiff; // FORWARD
+  template <class GC> class GridEnsemble; // FORWARD
+  template <class GC> class ElementReloader; // FORWARD
+
+  /**
+     How a Grid makes its tiles: SizedTiles of the GridConfig's
+     compile-time size, constructed as SizedTile's statics say.
+   */
+  template <class EC, u32 WIDTH, u32 HEIGHT, u32 HISTORYSIZE>
+  struct GridTileMaker
+  {
+    typedef SizedTile<EC,WIDTH,HEIGHT,HISTORYSIZE> TileType;
+
+    static TileType * Construct(void * at, u32 width, u32 height, GridLayoutPattern)
+    {
+      MFM_API_ASSERT_ARG(width == WIDTH && height == HEIGHT);
+      return new (at) TileType();
+    }
+  };
+
+  /**
+     For a GridConfig with a 0 by 0 tile size, DynamicTiles, sized
+     when the Grid is constructed (say, by --tile-size).
+   */
+  template <class EC, u32 HISTORYSIZE>
+  struct GridTileMaker<EC,0,0,HISTORYSIZE>
+  {
+    typedef DynamicTile<EC> TileType;
+
+    static TileType * Construct(void * at, u32 width, u32 height, GridLayoutPattern layout)
+    {
+      return new (at) TileType(width, height, layout, HISTORYSIZE);
+    }
+  };
+
   /**
    * A two-dimensional grid of simulated Tiles.
    */
@@ -59,20 +105,31 @@ namespace MFM {
     enum { MAX_TILES_SUPPORTED = 500 };  // Yeah right.  Used for sizing m_rgi
 
     enum { R = EC::EVENT_WINDOW_RADIUS};
+    /* The compile-time tile size, or 0 for a grid whose tile size is
+       chosen at runtime.  Use GetTileWidth() and friends, which are
+       right either way. */
     enum { TILE_WIDTH = GC::TILE_WIDTH};
     enum { TILE_HEIGHT = GC::TILE_HEIGHT};
     enum { EVENT_HISTORY_SIZE = GC::EVENT_HISTORY_SIZE};
-    enum { OWNED_WIDTH = TILE_WIDTH - 2 * R }; // Duplicating the OWNED_SIDE computation in Tile.tcc!
-    enum { OWNED_HEIGHT = TILE_HEIGHT - 2 * R }; // Duplicating the OWNED_SIDE computation in Tile.tcc!
+    enum { OWNED_WIDTH = TILE_WIDTH > 0 ? TILE_WIDTH - 2 * R : 0 }; // Duplicating the OWNED_SIDE computation in Tile.tcc!
+    enum { OWNED_HEIGHT = TILE_HEIGHT > 0 ? TILE_HEIGHT - 2 * R : 0 }; // Duplicating the OWNED_SIDE computation in Tile.tcc!
+    enum { IS_RUNTIME_SIZED = TILE_WIDTH == 0 };
     enum { MAX_LOCKS_OWNED_PER_TILE = 3}; //checkboard: E,SE,S  staggered: NE,E,SE
 
-    typedef SizedTile<EC,TILE_WIDTH,TILE_HEIGHT,EVENT_HISTORY_SIZE> GridTile;
+    typedef GridTileMaker<EC,TILE_WIDTH,TILE_HEIGHT,EVENT_HISTORY_SIZE> GridTileMakerType;
+    typedef typename GridTileMakerType::TileType GridTile;
 
   private:
     Random m_random;
 
     u32 m_seed;
 
+    /** How many RunDeterministicStep calls this grid has made */
+    u32 m_deterministicStep;
+
+    /** How many RunSweepStep calls this grid has made */
+    u32 m_sweepStep;
+
     void InitSeed();
 
     void InitDummyTiles();
@@ -81,10 +138,15 @@ namespace MFM {
 
     const GridLayoutPattern m_layout;
 
+    const u32 m_tileWidth, m_tileHeight;
+
     SPoint m_lastEventTile;
 
     ElementTypeNumberMap<EC> m_elementTypeNumberMap;
 
+    /** How long constructing m_tiles took.  \sa GetTileConstructionMS */
+    u32 m_tileConstructionMS;
+
     GridTile * const m_tiles;
     GridTile & _getTile(u32 x, u32 y) { return m_tiles[x*m_height + y]; }
     const GridTile & _getTile(u32 x, u32 y) const { return m_tiles[x*m_height + y]; }
@@ -98,7 +160,9 @@ namespace MFM {
     LonglivedLock & GetIntertileLockCheckerboard(u32 xtile, u32 ytile, Dir dir);
 
 
-    GridTile m_heroTile;    // Model for the actual m_tiles
+    GridTile & m_heroTile;  // Model for the actual m_tiles
+
+    TileParameterPublisher m_tileParameters;  // Shared by all m_tiles
 
     /**
        Get the long-lived lock controlling cache activity going in
@@ -106,21 +170,127 @@ namespace MFM {
      */
     LonglivedLock & GetIntertileLock(u32 xtile, u32 ytile, Dir dir, bool isStaggered) ;
 
-    struct TileDriver {
+    struct TileDriver : public GridTransceiver::WriteListener {
       enum State { PAUSED, ADVANCING, EXIT_REQUEST };
       Mutex m_stateLock;
       State m_state;
       SPoint m_loc;
       Grid* m_gridPtr;
       pthread_t m_threadId;
+      u32 m_numaNode;  // Node index holding this tile, under NUMA placement
+      u32 m_tileJobGeneration; // Of the last TileJob this tile's thread ran
+      u32 m_statsAdvances;     // Since this tile last published its stats
       GridTransceiver m_channels[4]; // 4: NE, E, SE, S == dir-Dirs::NORTHEAST
+
+      /**
+         The tile's cumulative counters as of the last
+         WriteTileStatsRecord, so each record can report deltas
+       */
+      struct StatsMark {
+        u64 m_events;
+        u64 m_advances;
+        u64 m_idleAdvances;
+        u64 m_lockFailures;
+        u64 m_lockSpinWins;
+      } m_statsMark;
+
+      /**
+         Whether the tile is asleep, being quiescent (see
+         KeepTileAsleep).  Only the thread driving the tile changes
+         it; writers to the tile's transceivers read it to decide
+         whether to wake the tile.
+       */
+      volatile u32 m_asleep;
+
+      /** Set, under the grid's m_driverLock, to end m_asleep early */
+      volatile u32 m_wakeRequested;
+
+      /** What a sleeping tile thread waits on */
+      pthread_cond_t m_quiescentWake;
+
+      /** Every transceiver connecting this tile to a neighbor, and
+          which side of each is this tile's */
+      GridTransceiver * m_adjacent[Dirs::DIR_COUNT];
+      bool m_adjacentSideA[Dirs::DIR_COUNT];
+      u32 m_adjacentCount;
+
+      /**
+         How the tile's quiescence was last seen, and, while asleep,
+         the rate at which its skipped events are credited
+       */
+      struct QuietMark {
+        u32 m_advances;        // Since the last quiescence check
+        u64 m_sinceNanos;      // When first seen quiescent, or 0
+        u64 m_sinceEvents;     // Events executed then
+        double m_eventsPerNano;
+        double m_carry;        // Fraction of an event not yet credited
+        u64 m_creditedNanos;   // When events were last credited
+      } m_quiet;
+
+      /**
+         The tile's recent activity, for activity scheduling: a moving
+         average, out of ACTIVITY_ONE, of the fraction of its owned
+         sites whose events can change something.  \sa
+         SetActivityScheduling
+       */
+      struct ActivityMark {
+        u32 m_advances;        // Since the last sample
+        u32 m_weight;
+        u32 m_credit;          // Toward this tile thread's next unyielded advance
+      } m_activity;
+
       TileDriver()
         : m_state(PAUSED)
         , m_loc(-1,-1)
         , m_gridPtr(0)
-      { }
+        , m_numaNode(0)
+        , m_tileJobGeneration(0)
+        , m_asleep(0)
+        , m_wakeRequested(0)
+        , m_adjacentCount(0)
+      {
+        m_statsMark.m_events = 0;
+        m_statsMark.m_advances = 0;
+        m_statsMark.m_idleAdvances = 0;
+        m_statsMark.m_lockFailures = 0;
+        m_statsMark.m_lockSpinWins = 0;
+        m_activity.m_advances = 0;
+        m_activity.m_weight = ACTIVITY_ONE;  // Busy until shown otherwise
+        m_activity.m_credit = 0;
+        m_statsAdvances = 0;
+        ClearQuietMark();
+        MFM_API_ASSERT(!pthread_cond_init(&m_quiescentWake, NULL), LOCK_FAILURE);
+      }
+
+      ~TileDriver()
+      {
+        pthread_cond_destroy(&m_quiescentWake);
+      }
+
+      void ClearQuietMark()
+      {
+        m_quiet.m_advances = 0;
+        m_quiet.m_sinceNanos = 0;
+        m_quiet.m_sinceEvents = 0;
+        m_quiet.m_eventsPerNano = 0;
+        m_quiet.m_carry = 0;
+        m_quiet.m_creditedNanos = 0;
+      }
+
+      void AddAdjacent(GridTransceiver & gt, bool onSideA)
+      {
+        MFM_API_ASSERT_STATE(m_adjacentCount < Dirs::DIR_COUNT);
+        m_adjacent[m_adjacentCount] = &gt;
+        m_adjacentSideA[m_adjacentCount] = onSideA;
+        ++m_adjacentCount;
+        gt.SetWriteListener(onSideA, this);
+      }
 
-      ~TileDriver() {} //avoid inline error
+      /** A neighbor wrote to us; wake us if we're asleep */
+      virtual void BytesWritten()
+      {
+        m_gridPtr->WakeQuiescentTile(*this);
+      }
 
       State GetState()
       {
@@ -149,11 +319,442 @@ namespace MFM {
     bool m_threadsInitted;
     static void * TileDriverRunner(void *) ;
 
+    /**
+       Tile threads whose TileDriver is PAUSED wait on m_driverWake,
+       which is broadcast whenever the drivers' states are changed.
+       DoTileDriverControl waits on m_tileStateChanged, which is
+       broadcast whenever a tile thread sees its tile change state,
+       and m_tileStateGeneration counts those changes.  All three are
+       guarded by m_driverLock.
+     */
+    pthread_mutex_t m_driverLock;
+    pthread_cond_t m_driverWake;
+    pthread_cond_t m_tileStateChanged;
+    u32 m_tileStateGeneration;
+
+    struct TileJob;
+
+    /**
+       The TileJob (if any) that paused tile threads should run, which
+       of the RunOnEveryTile phases it's in, and how many tiles have
+       yet to run it.  m_tileJobGeneration is bumped for each new
+       job; a TileDriver whose own generation lags has a job waiting.
+       Guarded by m_driverLock, though tile threads peek at
+       m_tileJobGeneration without it.
+     */
+    TileJob * m_tileJob;
+    u32 m_tileJobPhase;
+    u32 m_tileJobsPending;
+    volatile u32 m_tileJobGeneration;
+
+    /** Wake every tile thread waiting on a PAUSED TileDriver */
+    void WakeTileDrivers() ;
+
+    /** Wait, up to \a maxUsec at a time, while \a td stays PAUSED */
+    void WaitWhilePaused(TileDriver & td, u32 maxUsec) ;
+
+    /**
+       If true, tile threads put quiescent tiles to sleep.
+       \sa SetQuiescentSleep
+     */
+    bool m_quiescentSleep;
+
+    /**
+       If true, tiles are driven in proportion to their activity,
+       rather than equally.  \sa SetActivityScheduling
+     */
+    bool m_activityScheduling;
+
+    /**
+       Resample \a td's tile activity every ACTIVITY_SAMPLE_ADVANCES
+       advances.  Call only from the thread driving the tile.
+     */
+    void NoteTileActivity(TileDriver & td) ;
+
+    /**
+       Under activity scheduling, whether \a td's tile thread should
+       give up the cpu after an advance that did work, which it does
+       on all but about GetTileActivity() / ACTIVITY_ONE of them.
+     */
+    bool IsActivityYield(TileDriver & td) ;
+
+    /**
+       How many advances a pool worker gives \a td's tile per turn:
+       TILE_POOL_ADVANCES_PER_TURN, or, under activity scheduling, 1
+       up to TILE_POOL_MAX_ADVANCES_PER_TURN by its activity.
+     */
+    u32 GetTilePoolAdvances(const TileDriver & td) const ;
+
+    /**
+       Decide whether \a td's tile should sleep, or keep sleeping,
+       rather than be advanced.  Every QUIESCENCE_CHECK_ADVANCES
+       advances of an awake tile, this checks Tile::IsQuiescent.  A
+       tile seen quiescent at two checks in a row goes to sleep, and
+       is then credited events at the rate it ran them between those
+       checks.  A write from a neighbor, or an atom placed in it,
+       wakes a sleeping tile just to answer any traffic (setting \a
+       didWork if that did anything); it stays awake only if it is
+       then no longer quiescent.  Pausing its TileDriver wakes it for
+       good.  Call only from the thread driving \a td.
+     */
+    bool KeepTileAsleep(TileDriver & td, bool & didWork) ;
+
+    /**
+       The tiles' counters, each tile publishing to its own leaf.
+       \sa GetPublishedTotal
+     */
+    TileStatsTree m_tileStats;
+
+    /** How often, in advances, a running tile publishes its stats */
+    enum { STATS_PUBLISH_ADVANCES = 64 };
+
+    /** \a tile's leaf in m_tileStats */
+    u32 GetTileStatsLeaf(const SPoint & tileInGrid) const
+    {
+      return (u32) (tileInGrid.GetX() * m_height + tileInGrid.GetY());
+    }
+
+    /**
+       Publish the counters of the tile at \a tileInGrid to its
+       m_tileStats leaf.  Call only from the thread driving the tile,
+       or with no tile threads at all.
+     */
+    void PublishTileStats(const SPoint & tileInGrid) ;
+
+    /** Whether \a td's tile has no intertile traffic left to handle */
+    bool IsTileDriverQuiet(TileDriver & td) ;
+
+    /** Credit \a td's sleeping tile the events it would have run by \a nowNanos */
+    void CreditQuiescentEvents(TileDriver & td, u64 nowNanos) ;
+
+    /** End \a td's sleep, if it's asleep */
+    void WakeQuiescentTile(TileDriver & td) ;
+
+    /** Wait, up to \a maxUsec, while \a td is asleep and still ADVANCING */
+    void WaitWhileQuiescent(TileDriver & td, u32 maxUsec) ;
+
+    void NoteTileStateChange() ;
+
+    u32 GetTileStateGeneration() ;
+
+    /**
+       Wait up to \a maxUsec for a tile state change after \a
+       generation (from GetTileStateGeneration()).
+     */
+    void WaitForTileStateChange(u32 generation, u32 maxUsec) ;
+
+    /**
+     * How many times a pool worker calls Tile::Advance on a tile it
+     * has dequeued before putting the tile back on its deque.
+     */
+    enum { TILE_POOL_ADVANCES_PER_TURN = 16 };
+
+    /**
+     * Longest a tile thread waits on a PAUSED TileDriver before
+     * checking it again, and longest DoTileDriverControl waits for a
+     * tile state change before rechecking them all.  Both are woken
+     * early by the changes they're waiting for; these only bound the
+     * cost of a missed or unsignalled change.  Waiting that long
+     * CONTROL_STUCK_LOOPS times in a row (about two minutes) counts as
+     * being stuck.
+     */
+    enum {
+      PAUSED_WAIT_USEC = 100000,
+      CONTROL_WAIT_USEC = 1000,
+      CONTROL_STUCK_LOOPS = 120000
+    };
+
+    /**
+     * How many advances an awake tile makes between quiescence
+     * checks, and how often a sleeping tile's thread wakes to credit
+     * its skipped events.  \sa KeepTileAsleep
+     */
+    enum {
+      QUIESCENCE_CHECK_ADVANCES = 1024,
+      QUIESCENT_CREDIT_USEC = 10000
+    };
+
+    /**
+     * One thread of the work-stealing tile pool.  Each TileWorker
+     * holds a deque of TileDrivers.  It takes tiles from the front of
+     * its own deque and returns them to the back; when a full pass
+     * over its tiles accomplishes nothing, it steals a tile from the
+     * front of a more heavily loaded worker's deque.  A TileDriver is
+     * in at most one deque, or held by at most one worker, at any
+     * moment, so each Tile is still advanced by only one thread at a
+     * time.
+     */
+    struct TileWorker {
+      Mutex m_dequeLock;
+      TileDriver * m_deque[MAX_TILES_SUPPORTED];
+      u32 m_head;
+      u32 m_count;
+      u32 m_index;
+      Grid* m_gridPtr;
+      pthread_t m_threadId;
+      Random m_random;
+
+      TileWorker()
+        : m_head(0)
+        , m_count(0)
+        , m_index(0)
+        , m_gridPtr(0)
+      { }
+
+      ~TileWorker() {} //avoid inline error
+
+      u32 GetCount()
+      {
+        Mutex::ScopeLock lock(m_dequeLock);
+        return m_count;
+      }
+
+      void PushBack(TileDriver * td)
+      {
+        Mutex::ScopeLock lock(m_dequeLock);
+        MFM_API_ASSERT_STATE(m_count < MAX_TILES_SUPPORTED);
+        m_deque[(m_head + m_count) % MAX_TILES_SUPPORTED] = td;
+        ++m_count;
+      }
+
+      bool PopFront(TileDriver * & td)
+      {
+        Mutex::ScopeLock lock(m_dequeLock);
+        if (m_count == 0)
+          return false;
+        td = m_deque[m_head];
+        m_head = (m_head + 1) % MAX_TILES_SUPPORTED;
+        --m_count;
+        return true;
+      }
+
+      /**
+         Give up a tile to a thief, but only if we have more than \c
+         thiefCount + 1 tiles, so tiles don't ping-pong between two
+         equally loaded workers.  Takes from the front, which is the
+         tile this worker would otherwise get to next.
+       */
+      bool StealFrom(TileDriver * & td, u32 thiefCount)
+      {
+        Mutex::ScopeLock lock(m_dequeLock);
+        if (m_count <= thiefCount + 1)
+          return false;
+        td = m_deque[m_head];
+        m_head = (m_head + 1) % MAX_TILES_SUPPORTED;
+        --m_count;
+        return true;
+      }
+    };
+
+    /**
+     * If true, InitThreads starts m_tilePoolThreads TileWorkers
+     * rather than one thread per TileDriver.
+     */
+    bool m_useTilePool;
+
+    /**
+     * Number of TileWorkers to start in pool mode, or 0 for one per
+     * online processor.
+     */
+    u32 m_tilePoolThreads;
+
+    TileWorker * m_tileWorkers;
+    u32 m_tileWorkerCount;
+
+    /**
+     * Number of TileDrivers still being scheduled by the pool.
+     * Decremented (atomically) as workers retire tiles that have
+     * reached TileDriver::EXIT_REQUEST.
+     */
+    volatile u32 m_tilePoolLiveTiles;
+
+    /**
+     * If true, Init puts the intertile GridTransceivers in direct
+     * mode.  \sa GridTransceiver::SetDirectMode
+     */
+    bool m_directChannels;
+
+    /**
+     * If true, InitThreads pins tile threads (or pool workers) to
+     * cpus and moves each tile's memory to its thread's NUMA node.
+     */
+    bool m_numaPlacement;
+
+    /**
+     * If true, InitThreads asks for m_tiles to be backed by huge
+     * pages and reports how much of it was.
+     */
+    bool m_hugePages;
+
+    void InitHugePages() ;
+
+    /**
+     * Threads Init spreads the tiles' initialization over, or 0 for
+     * one per online processor.  \sa SetInitThreads
+     */
+    u32 m_initThreads;
+
+    enum { MAX_INIT_THREADS = 64 };
+
+    /**
+     * Setup work over indexes 0..count-1, for RunInParallel.
+     */
+    struct IndexJob
+    {
+      virtual ~IndexJob() { }
+
+      /** Do the work for \c index.  Called once per index, on any thread */
+      virtual void RunOnIndex(u32 index) = 0;
+    };
+
+    struct IndexJobRunner
+    {
+      IndexJob * m_job;
+      u32 m_first;          // Indexes m_first, m_first+m_stride, ..
+      u32 m_stride;
+      u32 m_count;
+      pthread_t m_thread;
+      MFMErrorEnvironmentPointer_t m_errorStackTop;
+
+      void RunJobs()
+      {
+        for (u32 i = m_first; i < m_count; i += m_stride)
+          m_job->RunOnIndex(i);
+      }
+    };
+
+    static void * RunIndexJob(void * arg) ;
+
+    /**
+     * Run \c job on indexes 0..count-1 using up to \c threads threads
+     * (0 for one per online processor) that exist only for this call,
+     * the calling thread among them, and return when all are done.
+     * For setup before the tile threads exist, such as constructing
+     * and initializing the tiles.
+     */
+    static void RunInParallel(IndexJob & job, u32 count, u32 threads) ;
+
+    struct ConstructTileJob : public IndexJob
+    {
+      GridTile * m_tiles;
+
+      u32 m_width, m_height;
+      GridLayoutPattern m_layout;
+
+      ConstructTileJob(GridTile * tiles, u32 width, u32 height, GridLayoutPattern layout)
+        : m_tiles(tiles)
+        , m_width(width)
+        , m_height(height)
+        , m_layout(layout)
+      { }
+
+      virtual void RunOnIndex(u32 index)
+      {
+        GridTileMakerType::Construct(&m_tiles[index], m_width, m_height, m_layout);
+      }
+    };
+
+    /**
+     * Construct \c count \c width by \c height GridTiles in
+     * HugePageMemory, so that they can be moved onto huge pages if
+     * SetHugePages asks for that, on one thread per online processor.
+     * Sets \c msec to how long that took.  (A DynamicTile's sites are
+     * allocated separately, on whatever thread constructs it.)
+     */
+    static GridTile * NewTiles(u32 count, u32 width, u32 height, GridLayoutPattern layout, u32 & msec)
+    {
+      const u64 start = FastClock::MonotonicNanos();
+      void * mem = HugePageMemory::Allocate(count * (u64) sizeof(GridTile));
+      GridTile * tiles = (GridTile *) mem;
+      ConstructTileJob job(tiles, width, height, layout);
+      RunInParallel(job, count, 0);
+      msec = (u32) ((FastClock::MonotonicNanos() - start) / 1000000);
+      return tiles;
+    }
+
+    struct InitTileJob : public IndexJob
+    {
+      Grid & m_grid;
+      SPoint m_order[MAX_TILES_SUPPORTED];
+      u32 m_count;
+
+      InitTileJob(Grid & grid) : m_grid(grid), m_count(0) { }
+
+      virtual void RunOnIndex(u32 index)
+      {
+        m_grid.InitTile(m_order[index]);
+      }
+    };
+
+    /** Init the tile at \c tpt and its TileDriver, for Init */
+    void InitTile(const SPoint & tpt) ;
+
+    static void DeleteTiles(GridTile * tiles, u32 count)
+    {
+      for (u32 i = 0; i < count; ++i)
+      {
+        tiles[i].~GridTile();
+      }
+      HugePageMemory::Free(tiles, count * (u64) sizeof(GridTile));
+    }
+
+    static GridTile & NewHeroTile(u32 width, u32 height, GridLayoutPattern layout)
+    {
+      return *GridTileMakerType::Construct(::operator new(sizeof(GridTile)), width, height, layout);
+    }
+
+    static void DeleteHeroTile(GridTile & hero)
+    {
+      hero.~GridTile();
+      ::operator delete(&hero);
+    }
+
+    /**
+     * If true, tile control loops whose order doesn't matter walk the
+     * tiles in m_ogi's fixed order rather than m_rgi's occasional
+     * shuffles.  \sa StartTileControlLoop
+     */
+    bool m_orderedTileControl;
+
+    NUMAPlacement m_numa;
+
+    void InitNUMAPlacement() ;
+
+    /**
+     * The node whose band of pool workers, [n*workers/nodes,
+     * (n+1)*workers/nodes), includes worker \c w.
+     */
+    static u32 GetTilePoolWorkerNode(u32 w, u32 workers, u32 nodes)
+    {
+      for (u32 n = 0; n + 1 < nodes; ++n)
+      {
+        if (w < (n + 1) * workers / nodes)
+          return n;
+      }
+      return nodes - 1;
+    }
+
+    static void * TileWorkerRunner(void *) ;
+
+    void InitTilePoolThreads();
+
+    /**
+     * Advance \c td as its TileDriver::State dictates.  Returns false
+     * if td has reached EXIT_REQUEST and should not be rescheduled,
+     * otherwise returns true and sets didWork to whether anything of
+     * possible value was accomplished.
+     */
+    bool AdvanceTileDriver(TileDriver & td, bool & didWork, bool & paused) ;
+
     bool m_backgroundRadiationEnabled; // shadows value pushed to tiles
     bool m_foregroundRadiationEnabled; // shadows value pushed to tiles
 
     ElementRegistry<EC> m_er;
 
+    /** Library elements not yet Needed, if registering them is being
+        deferred until something names them; else NULL */
+    ElementRegistry<EC> * m_deferredElements;
+
     s32 m_xraySiteOdds;
 
     /**
@@ -242,7 +843,6 @@ namespace MFM {
       virtual void MakeRequest(TileDriver & td)
       {
         Tile<EC> & tile = td.GetTile();
-        tile.NeedAtomRecount();
         tile.RequestStateActive();
       }
       virtual bool CheckIfReady(TileDriver & td)
@@ -264,101 +864,570 @@ namespace MFM {
       {
       }
 
-    };
+    };
+
+    /**
+     * Synchronized operations driver.
+     */
+    void DoTileDriverControl(TileDriverControl & tc);
+
+    /**
+     * Work to be done once per tile, such as clearing it or
+     * refreshing caches from it.  \sa RunOnEveryTile
+     */
+    struct TileJob
+    {
+      virtual ~TileJob() { }
+
+      /**
+         Do the job for the tile at \c tileInGrid.  Called on that
+         tile's own thread while the grid is paused, so it may touch
+         that tile freely -- and its neighbors, too, if the job was
+         run with touchesNeighbors.
+       */
+      virtual void RunOnTile(Grid & grid, const SPoint & tileInGrid) = 0;
+    };
+
+    /**
+     * Phases of a RunOnEveryTile that touches neighbors: tiles whose
+     * coordinates are congruent mod 3 in both x and y are three or
+     * more apart, so their neighborhoods (which reach one tile in
+     * each direction, staggered or not) never overlap.
+     */
+    enum { TILE_JOB_NEIGHBORLY_PHASES = 3 * 3 };
+
+    /**
+     * Run \c job on every tile and return when all are done.  If the
+     * tile threads are up and the grid is paused, each tile's thread
+     * runs its own piece, in parallel; otherwise (e.g., before
+     * InitThreads, or while running) the calling thread does them
+     * all in turn, as before.  If \c touchesNeighbors, the job may
+     * also write into its neighbor tiles, and the tiles are run in
+     * TILE_JOB_NEIGHBORLY_PHASES rounds so no two tiles in a round
+     * share a neighbor.
+     */
+    void RunOnEveryTile(TileJob & job, bool touchesNeighbors) ;
+
+    /** \returns true if every TileDriver is PAUSED with a thread */
+    bool AreTileThreadsPaused() ;
+
+    static u32 GetTileJobPhase(const SPoint & tileInGrid)
+    {
+      return (u32) (tileInGrid.GetX() % 3 + 3 * (tileInGrid.GetY() % 3));
+    }
+
+    /**
+     * Run the pending TileJob, if any, for \c td, on its thread.
+     * \returns true if it found one
+     */
+    bool RunPendingTileJob(TileDriver & td) ;
+
+    /**
+     * The grid coordinates of \c siteInTile, an owned-site (cache
+     * excluding) index in the tile at \c tileInGrid.  The inverse of
+     * MapGridToUncachedTile.
+     */
+    SPoint MapUncachedTileToGrid(const SPoint & tileInGrid, const SPoint & siteInTile) const
+    {
+      SPoint siteInGrid(tileInGrid.GetX() * GetOwnedWidth() + siteInTile.GetX(),
+                        tileInGrid.GetY() * GetOwnedHeight() + siteInTile.GetY());
+      if (IsGridRowStaggered(siteInGrid))
+        siteInGrid += SPoint(GetOwnedWidth()/2, 0);
+      return siteInGrid;
+    }
+
+    /**
+     * Copy the placement of \c atom at \c siteInTile, in \c owner at
+     * \c tileInGrid, into the caches of whichever connected
+     * neighbors share that site.
+     */
+    void PlaceAtomInSharingTiles(Tile<EC> & owner, const SPoint & tileInGrid,
+                                 bool placeInBase, const T& atom,
+                                 const SPoint & siteInTile, bool checkOnly) ;
+
+    struct ClearTileJob ;
+    struct RecountAtomsTileJob ;
+    struct CacheTileJob ;
+    struct NukeTileJob ;
+    struct DeterministicTileJob ;
+    struct SweepTileJob ;
+
+  public:
+    struct GridTouchEvent {
+      SiteTouchType m_touchType;
+      SPoint m_gridAtomCoord;
+      GridTouchEvent()
+        : m_touchType(TOUCH_TYPE_NONE)
+        , m_gridAtomCoord(0,0)
+      { }
+    };
+
+    void SenseTouchAround(const GridTouchEvent & gridTouchEvent) ;
+
+  private:
+    void SenseTouchAt(const SPoint gridCoord, SiteTouchType touch) ;
+
+  public:
+
+    UlamClassRegistry<EC> & GetUlamClassRegistry()
+    {
+      return m_heroTile.GetUlamClassRegistry();
+    }
+
+    const UlamClassRegistry<EC> & GetUlamClassRegistry() const
+    {
+      return m_heroTile.GetUlamClassRegistry();
+    }
+
+    s32 GetWarpFactor() const
+    {
+      return m_heroTile.GetWarpFactor();
+    }
+
+    void SetWarpFactor(s32 wf)
+    {
+      if (wf < 0 || wf > 10)
+      {
+        FAIL(ILLEGAL_ARGUMENT);
+      }
+
+      m_heroTile.SetWarpFactor(wf);
+    }
+
+    double GetAverageCacheRedundancy() const;
+    void SetCacheRedundancy(u32 redundancyOddsType) ;
+
+    /**
+       Sum, over the cache processors of all tiles facing direction
+       \a dir, the redundant check atoms shipped and their estimated
+       bytes, and the clean and failed cache update replies.
+     */
+    void GetCacheCheckCounts(Dir dir, u64 & checkAtoms, u64 & checkBytes,
+                             u64 & cleanReplies, u64 & failedReplies) const;
+
+    /**
+       Ship intertile cache updates with up to maxSites sites per
+       packet, or one site per packet if maxSites is 0.  Call only
+       while the grid is paused.
+     */
+    void SetCacheBatchLimit(u32 maxSites) ;
+
+    /**
+       Offer and accept compact cache updates on every intertile link,
+       which cut the bytes each update ships.  Call only while the
+       grid is paused.  \sa CacheProcessor::SetCompactCache
+     */
+    void SetCompactCache(bool on) ;
+
+    /**
+       Sum the cache update packets and bytes shipped over all tiles.
+     */
+    void GetCacheShippedCounts(u64 & packets, u64 & bytes) const;
+
+    /**
+       Give every tile's events \c spins extra looks at a busy
+       intertile lock before they abandon.  \sa Tile::SetLockSpinCount
+     */
+    void SetLockSpinCount(u32 spins) ;
+
+    /**
+       Sum the intertile lock failures and spinning wins over all
+       tiles.  \sa Tile::GetLockFailureCounts
+     */
+    void GetLockFailureCounts(u64 & failures, u64 & spinWins) const;
+
+    /**
+       Draw event centers only from non-empty sites in every tile,
+       crediting the skipped empty-site events.  Call only while the
+       grid is paused.  \sa Tile::SetSparseEvents
+     */
+    void SetSparseEvents(bool on) ;
+
+    /**
+       Draw event centers by event age in every tile, with the odds
+       warp filtering would otherwise reach by rejecting uniform
+       draws.  Call only while the grid is paused.
+       \sa Tile::SetAgedEvents
+     */
+    void SetAgedEvents(bool on) ;
+
+    /**
+       Have every tile draw \c size event centers at a time, running
+       those on batchable elements together.  Call only while the
+       grid is paused.  \sa Tile::SetEventBatchSize
+     */
+    void SetEventBatchSize(u32 size) ;
+
+    /**
+       Have every tile run its hidden-region events on \c workers
+       event windows at once.  Call only while the grid is paused.
+       \sa Tile::SetEventWorkers
+     */
+    void SetEventWorkers(u32 workers) ;
+
+    /**
+       Enable or disable optimistic lock-needing events in every tile.
+       Call only while the grid is paused.
+       \sa Tile::SetOptimisticEvents
+     */
+    void SetOptimisticEvents(bool on) ;
+
+    /**
+       Start or stop per-element-type behavior accounting in every
+       tile.  \sa Tile::SetElementProfiling
+     */
+    void SetElementProfiling(bool on) ;
+
+    bool IsElementProfiling() const
+    {
+      return Get00Tile().IsElementProfiling();
+    }
+
+    /** Zero the element profiles of all the tiles in this grid */
+    void ResetElementProfiles() ;
+
+    /**
+       Total the element profiles of all the tiles in this grid into
+       \a total, which is reset first.
+     */
+    void GetElementProfile(ElementProfile & total) const;
+
+    /**
+       Write the grid-wide element profile to \a out as CSV, one
+       line per element type that has behaved, most time first.
+     */
+    void WriteElementProfileCSV(ByteSink & out) const;
+
+    void ReportGridStatus(Logger::Level level) ;
+
+    /**
+       Sum the TryLock attempt and contention counts over all the
+       intertile locks in this grid.
+     */
+    void GetIntertileLockCounts(u64 & attempts, u64 & contended) const;
+
+    /**
+       Add what this grid holds to \a account, by subsystem: its
+       tiles, tile drivers and intertile locks, and the Grid object
+       itself.  Counts what is allocated now, so event history, for
+       one, grows once it's recorded.
+     */
+    void AccountMemory(MemoryAccount & account) const;
+
+    /** Log what AccountMemory finds at \a level */
+    void ReportMemory(Logger::Level level) const;
+
+#ifdef MFM_EVENT_PHASE_TIMING
+    /**
+       Total the per-phase event timings of all the tiles in this
+       grid into \a total, which is reset first.
+     */
+    void GetEventPhaseTimes(EventPhaseTimer & total) const;
+#endif
+
+    Random& GetRandom() { return m_random; }
+
+    friend class GridRenderer;
+    friend class GridDiff<GC>;
+    friend class GridEnsemble<GC>;
+    friend class ElementReloader<GC>;
+
+    void SetSeed(u32 seed);
+
+    u32 GetSeed() const { return m_seed; }
+
+    /**
+       Give a grid that has been Init'ed, but whose threads haven't
+       been started, the new \c seed, reseeding its PRNG and its
+       tiles' from it.  Two grids reseeded alike run alike from there,
+       however they were seeded before, so replicas forked from one
+       loaded grid each go their own way.
+     */
+    void Reseed(u32 seed)
+    {
+      MFM_API_ASSERT_ARG(seed != 0);
+      MFM_API_ASSERT_STATE(!m_threadsInitted);
+      SetSeed(seed);
+      InitSeed();
+    }
+
+    /**
+     * A \c width by \c height grid of tiles, each \c tileWidth by \c
+     * tileHeight sites, caches included.  The tile size must be the
+     * GridConfig's, unless that is 0 by 0 (IS_RUNTIME_SIZED); then
+     * any size a DynamicTile accepts will do.
+     */
+    Grid(ElementRegistry<EC>& elts, u32 width, u32 height, GridLayoutPattern layout,
+         u32 tileWidth = TILE_WIDTH, u32 tileHeight = TILE_HEIGHT)
+      : m_random()
+      , m_seed(0)
+      , m_deterministicStep(0)
+      , m_sweepStep(0)
+      , m_width(width)
+      , m_height(height)
+      , m_layout(layout)
+      , m_tileWidth(tileWidth)
+      , m_tileHeight(tileHeight)
+      , m_tileConstructionMS(0)
+      , m_tiles(NewTiles(m_width * m_height, m_tileWidth, m_tileHeight, m_layout, m_tileConstructionMS))
+      , m_intertileLocks(new LonglivedLock[m_width * m_height * MAX_LOCKS_OWNED_PER_TILE])
+      , m_heroTile(NewHeroTile(m_tileWidth, m_tileHeight, m_layout))
+      , m_tileDrivers(new TileDriver[m_width * m_height * MAX_LOCKS_OWNED_PER_TILE])
+      , m_threadsInitted(false)
+      , m_tileStateGeneration(0)
+      , m_tileJob(0)
+      , m_tileJobPhase(0)
+      , m_tileJobsPending(0)
+      , m_tileJobGeneration(0)
+      , m_quiescentSleep(false)
+      , m_activityScheduling(false)
+      , m_useTilePool(false)
+      , m_tilePoolThreads(0)
+      , m_tileWorkers(0)
+      , m_tileWorkerCount(0)
+      , m_tilePoolLiveTiles(0)
+      , m_directChannels(false)
+      , m_numaPlacement(false)
+      , m_hugePages(false)
+      , m_initThreads(0)
+      , m_orderedTileControl(false)
+      , m_backgroundRadiationEnabled(false)
+      , m_foregroundRadiationEnabled(false)
+      , m_er(elts)
+      , m_deferredElements(0)
+      , m_xraySiteOdds(100)
+      , m_rgi(m_width * m_height)
+      , m_ogi(m_width * m_height)
+    {
+      InitOrderedIterator();
+      //dummy tiles not set for iterator use!!! avoid illegal tile coord.
+      //for (iterator_type i = begin(); i != end(); ++i)
+      //	  LOG.Debug("Tile[%d][%d] @ %p", i.GetX(), i.GetY(), &(*i));
+      MFM_API_ASSERT(!pthread_mutex_init(&m_driverLock, NULL), LOCK_FAILURE);
+      MFM_API_ASSERT(!pthread_cond_init(&m_driverWake, NULL), LOCK_FAILURE);
+      MFM_API_ASSERT(!pthread_cond_init(&m_tileStateChanged, NULL), LOCK_FAILURE);
+    }
+
+    s32* GetXraySiteOddsPtr()
+    {
+      return &m_xraySiteOdds;
+    }
+
+    void Init();
+
+    /**
+       Init the 'TileDriver' threads.  This is done separately from
+       (and should happen after) Init() so that we can use a Grid
+       (e.g., for testing) without necessarily dealing with all the
+       threading.
+     */
+    void InitThreads();
+
+    /**
+       Select how InitThreads() will drive the tiles.  If \c usePool is
+       false (the default), each tile gets its own thread.  If true, a
+       pool of \c threads work-stealing worker threads shares all the
+       tiles, with \c threads == 0 meaning one worker per online
+       processor.  FAILs with ILLEGAL_STATE if the threads have
+       already been started.
+     */
+    void SetTilePool(bool usePool, u32 threads)
+    {
+      if (m_threadsInitted)
+      {
+        FAIL(ILLEGAL_STATE);
+      }
+      m_useTilePool = usePool;
+      m_tilePoolThreads = threads;
+    }
+
+    /**
+       Spread Init's tile initialization (clearing the sites, resetting
+       the element tables, copying the hero tile) over \c threads
+       threads, or one per online processor if 0.  1 initializes the
+       tiles one after another on the calling thread.
+     */
+    void SetInitThreads(u32 threads)
+    {
+      m_initThreads = threads;
+    }
+
+    u32 GetInitThreads() const
+    {
+      return m_initThreads;
+    }
+
+    /** How long the constructor took to construct the tiles */
+    u32 GetTileConstructionMS() const
+    {
+      return m_tileConstructionMS;
+    }
+
+    /**
+       Select whether InitThreads pins tile threads (or, with a tile
+       pool, its workers) to cpus, and binds each tile's sites to
+       the NUMA node of the cpus driving it.  Bands
+       of neighboring tiles share a node to keep intertile traffic
+       local.  FAILs with ILLEGAL_STATE if the threads have already
+       been started.
+     */
+    void SetNUMAPlacement(bool numaPlacement)
+    {
+      if (m_threadsInitted)
+      {
+        FAIL(ILLEGAL_STATE);
+      }
+      m_numaPlacement = numaPlacement;
+    }
+
+    bool IsUsingNUMAPlacement() const
+    {
+      return m_numaPlacement;
+    }
+
+    /**
+       Select whether InitThreads moves the tiles' sites onto 2MB
+       transparent huge pages, logging how much of
+       the tile memory actually ended up there.  FAILs with
+       ILLEGAL_STATE if the threads have already been started.
+     */
+    void SetHugePages(bool hugePages)
+    {
+      if (m_threadsInitted)
+      {
+        FAIL(ILLEGAL_STATE);
+      }
+      m_hugePages = hugePages;
+    }
+
+    bool IsUsingHugePages() const
+    {
+      return m_hugePages;
+    }
 
     /**
-     * Synchronized operations driver.
+       Turn off event history in every tile and free its storage, for
+       runs where nothing will ever rewind or display it.  Tiles
+       allocate history storage at their first recorded event, so
+       doing this before the grid runs means none is ever allocated.
+       Don't call it while tiles are running events.
      */
-    void DoTileDriverControl(TileDriverControl & tc);
-
-  public:
-    struct GridTouchEvent {
-      SiteTouchType m_touchType;
-      SPoint m_gridAtomCoord;
-      GridTouchEvent()
-        : m_touchType(TOUCH_TYPE_NONE)
-        , m_gridAtomCoord(0,0)
-      { }
-    };
-
-    void SenseTouchAround(const GridTouchEvent & gridTouchEvent) ;
-
-  private:
-    void SenseTouchAt(const SPoint gridCoord, SiteTouchType touch) ;
+    void ReleaseEventHistory() ;
 
-  public:
+    /**
+       Select whether loops that just hand every tile the same request
+       (SetGridRunning and DoTileDriverControl) visit the tiles in a
+       fixed Morton order, so neighboring tiles and their drivers are
+       touched together, instead of in m_rgi's randomized order.
+       Loops where the order is part of the semantics, like dealing
+       tiles to pool workers, stay randomized either way.
+     */
+    void SetOrderedTileControl(bool ordered)
+    {
+      m_orderedTileControl = ordered;
+    }
 
-    UlamClassRegistry<EC> & GetUlamClassRegistry()
+    bool IsUsingOrderedTileControl() const
     {
-      return m_heroTile.GetUlamClassRegistry();
+      return m_orderedTileControl;
     }
 
-    const UlamClassRegistry<EC> & GetUlamClassRegistry() const
+    bool IsUsingTilePool() const
     {
-      return m_heroTile.GetUlamClassRegistry();
+      return m_useTilePool;
     }
 
-    s32 GetWarpFactor() const
+    /**
+       Return the number of tile pool workers actually started, or 0 if
+       the tiles are being driven one thread per tile (or not at all).
+     */
+    u32 GetTilePoolWorkerCount() const
     {
-      return m_heroTile.GetWarpFactor();
+      return m_tileWorkerCount;
     }
 
-    void SetWarpFactor(s32 wf)
+    /**
+       Select whether Init() connects the tiles with direct-mode
+       GridTransceivers, which hand bytes straight from writer to
+       reader without simulating a data rate or taking a mutex.
+       FAILs with ILLEGAL_STATE if the threads have already been
+       started.
+     */
+    void SetDirectChannels(bool direct)
     {
-      if (wf < 0 || wf > 10)
+      if (m_threadsInitted)
       {
-        FAIL(ILLEGAL_ARGUMENT);
+        FAIL(ILLEGAL_STATE);
       }
-
-      m_heroTile.SetWarpFactor(wf);
+      m_directChannels = direct;
     }
 
-    double GetAverageCacheRedundancy() const;
-    void SetCacheRedundancy(u32 redundancyOddsType) ;
+    bool IsUsingDirectChannels() const
+    {
+      return m_directChannels;
+    }
 
-    void ReportGridStatus(Logger::Level level) ;
+    /**
+       Select whether tile threads put tiles with nothing to do to
+       sleep, crediting the events they skip, until inbound cache
+       traffic or a placed atom wakes them.  Under a tile pool, a
+       sleeping tile just takes no turns.  Call only while the grid
+       is paused.  \sa Tile::IsQuiescent
+     */
+    void SetQuiescentSleep(bool on)
+    {
+      m_quiescentSleep = on;
+    }
 
-    Random& GetRandom() { return m_random; }
+    bool IsUsingQuiescentSleep() const
+    {
+      return m_quiescentSleep;
+    }
 
-    friend class GridRenderer;
+    /**
+       Get the number of tiles now asleep.  \sa SetQuiescentSleep
+     */
+    u32 GetQuiescentTileCount() ;
 
-    void SetSeed(u32 seed);
+    /**
+     * Tile activity is measured out of ACTIVITY_ONE, and resampled
+     * every ACTIVITY_SAMPLE_ADVANCES advances.  Under activity
+     * scheduling, the busiest tiles get up to
+     * TILE_POOL_MAX_ADVANCES_PER_TURN advances per pool turn.
+     */
+    enum {
+      ACTIVITY_ONE = 256,
+      ACTIVITY_SAMPLE_ADVANCES = 256,
+      TILE_POOL_MAX_ADVANCES_PER_TURN = 64
+    };
 
-    Grid(ElementRegistry<EC>& elts, u32 width, u32 height, GridLayoutPattern layout)
-      : m_random()
-      , m_seed(0)
-      , m_width(width)
-      , m_height(height)
-      , m_layout(layout)
-      , m_tiles(new GridTile[m_width * m_height] )
-      , m_intertileLocks(new LonglivedLock[m_width * m_height * MAX_LOCKS_OWNED_PER_TILE])
-      , m_tileDrivers(new TileDriver[m_width * m_height * MAX_LOCKS_OWNED_PER_TILE])
-      , m_threadsInitted(false)
-      , m_backgroundRadiationEnabled(false)
-      , m_foregroundRadiationEnabled(false)
-      , m_er(elts)
-      , m_xraySiteOdds(100)
-      , m_rgi(m_width * m_height)
+    /**
+       Select how tile threads (or the tile pool) share the cpus.  If
+       \c on is false (the default), every tile is driven alike, so
+       the tiles run events at the same average rate, as the MFM
+       semantics assume.  If true, tiles are driven in proportion to
+       their recent activity -- the fraction of their owned sites
+       holding atoms that are neither empty nor inert -- so busy tiles
+       get more turns and nearly empty ones fewer.  That maximizes
+       useful events overall, at the cost of unequal AEPS across the
+       grid.  May be changed while running.
+     */
+    void SetActivityScheduling(bool on)
     {
-      //dummy tiles not set for iterator use!!! avoid illegal tile coord.
-      //for (iterator_type i = begin(); i != end(); ++i)
-      //	  LOG.Debug("Tile[%d][%d] @ %p", i.GetX(), i.GetY(), &(*i));
+      m_activityScheduling = on;
     }
 
-    s32* GetXraySiteOddsPtr()
+    bool IsUsingActivityScheduling() const
     {
-      return &m_xraySiteOdds;
+      return m_activityScheduling;
     }
 
-    void Init();
-
     /**
-       Init the 'TileDriver' threads.  This is done separately from
-       (and should happen after) Init() so that we can use a Grid
-       (e.g., for testing) without necessarily dealing with all the
-       threading.
+       Get the recent activity of the tile at \a tileLoc, out of
+       ACTIVITY_ONE.  Only tracked under activity scheduling.
+       \sa SetActivityScheduling
      */
-    void InitThreads();
+    u32 GetTileActivity(const SPoint & tileLoc) ;
 
     /**
        Enable or disable the tiles and the transceivers.
@@ -379,11 +1448,53 @@ namespace MFM {
       return Get00Tile().GetElementTable().Lookup(symbol);
     }
 
+    /**
+     * As the const version, but also Needs a deferred element with
+     * that symbol if no registered element has it
+     */
     Element<EC> * LookupElementFromSymbol(const u8 * symbol) 
     {
       // Safe. But, barf.
-      return
+      Element<EC> * elt =
         const_cast<Element<EC> *>(static_cast<const Grid<GC>*>(this)->LookupElementFromSymbol(symbol));
+      if (!elt && m_deferredElements)
+      {
+        for (u32 i = 0; i < m_deferredElements->GetEntryCount(); ++i)
+        {
+          Element<EC> * e = m_deferredElements->GetRegisteredElement(i);
+          if (!e || strcmp(e->GetAtomicSymbol(), (const char *) symbol)) continue;
+          if (elt) return 0;    // multiple hits
+          elt = e;
+        }
+        if (elt) Needed(*elt);
+      }
+      return elt;
+    }
+
+    /**
+     * Defer registering the elements of er until something names
+     * them -- see NeedDeferredElement and LookupElementFromSymbol --
+     * rather than Needing them all up front.  er must outlive this
+     * Grid.
+     */
+    void SetDeferredElements(ElementRegistry<EC> * er)
+    {
+      m_deferredElements = er;
+    }
+
+    /**
+     * Need the deferred element matching uuid, exactly or else
+     * compatibly, if there is one.
+     *
+     * @returns the element Needed, or NULL if elements are not
+     *          deferred or none matches
+     */
+    Element<EC> * NeedDeferredElement(const UUID & uuid)
+    {
+      if (!m_deferredElements) return 0;
+      Element<EC> * elt = m_deferredElements->LookupCompatible(uuid);
+      if (elt) Needed(*elt);
+      return elt;
     }
 
 
@@ -403,13 +1514,63 @@ namespace MFM {
       LOG.Message("Type 0x%04x is %@",anElement.GetType(),&anElement.GetUUID());
     }
 
+    /**
+     * Freeze every tile's element table once all needed elements are
+     * registered, so per-event element lookup needs no probing.
+     * Later registrations still work, and refreeze the tables.
+     */
+    void FreezeElementTables()
+    {
+      for (iterator_type i = begin(); i != end(); ++i)
+      {
+        if (!i->FreezeElementTable())
+        {
+          LOG.Warning("Tile %s: no perfect element hash, probing instead", i->GetLabel());
+        }
+      }
+    }
+
+    /**
+     * Publish \a value for tile parameter \a key to all tiles.  Safe
+     * while the grid runs: each tile picks the change up at its next
+     * event, without pausing.
+     */
     void SetTileParameter(u32 key, s32 value)
     {
-      m_heroTile.SetTileParameter(key, value);
+      m_tileParameters.Set(key, value);
       LOG.Message("Tile parameter key %d set to value %d", key, value);
     }
 
     RandomIterator<MAX_TILES_SUPPORTED> m_rgi;
+
+    /**
+     * The tiles in Morton (Z-curve) order of their grid coordinates.
+     * Only ever Reset, never shuffled.
+     */
+    RandomIterator<MAX_TILES_SUPPORTED> m_ogi;
+
+    /**
+     * Fill m_ogi from m_rgi's tiles, sorted into Morton order
+     */
+    void InitOrderedIterator() ;
+
+    /**
+     * Start a pass over the tiles for a control loop, and \returns
+     * the iterator to use: m_ogi if ordered tile control is on, else
+     * m_rgi, after its usual ShuffleOrReset.
+     * \sa SetOrderedTileControl
+     */
+    RandomIterator<MAX_TILES_SUPPORTED> & StartTileControlLoop()
+    {
+      if (m_orderedTileControl)
+      {
+        m_ogi.Reset();
+        return m_ogi;
+      }
+      m_rgi.ShuffleOrReset(m_random);
+      return m_rgi;
+    }
+
     SPoint IteratorIndexToCoord(const u32 idx) const
     {
       return SPoint(idx % m_width, idx / m_width);
@@ -492,9 +1653,14 @@ namespace MFM {
 
     ~Grid()
     {
-      delete [] m_tiles;
+      DeleteTiles(m_tiles, m_width * m_height);
+      DeleteHeroTile(m_heroTile);
       delete [] m_intertileLocks;
       delete [] m_tileDrivers;
+      delete [] m_tileWorkers;
+      pthread_cond_destroy(&m_tileStateChanged);
+      pthread_cond_destroy(&m_driverWake);
+      pthread_mutex_destroy(&m_driverLock);
     }
 
     /**
@@ -549,6 +1715,34 @@ namespace MFM {
      */
     void RefreshAllCaches();
 
+    /**
+     * Run one reproducible step of \c eventsPerTile events on every
+     * tile, with the grid paused.  Each tile reseeds its Random from
+     * the grid seed, the step number and its own position, runs its
+     * events without intertile locks, and then pushes its edge sites
+     * out to its neighbors, in the RunOnEveryTile rounds that keep
+     * neighborhoods apart.  Given the same seed and starting grid, a
+     * run of steps comes out bit-for-bit the same however many tile
+     * threads (or none) do the work.
+     */
+    void RunDeterministicStep(u32 eventsPerTile);
+
+    /** How many RunDeterministicStep calls this grid has made */
+    u32 GetDeterministicStep() const { return m_deterministicStep; }
+
+    /**
+     * Run one step of \c sweepsPerTile TileSweeper sweeps on every
+     * tile, with the grid paused -- one event per owned site per
+     * sweep, with elements that have a SweepRule run by the sweep
+     * kernel and the rest as ordinary events.  Tiles are seeded,
+     * separated and squared up with their neighbors just as in
+     * RunDeterministicStep, so sweeps are reproducible too.
+     */
+    void RunSweepStep(u32 sweepsPerTile);
+
+    /** How many RunSweepStep calls this grid has made */
+    u32 GetSweepStep() const { return m_sweepStep; }
+
     /**
      * Return true iff tileInGrid is a legal tile coordinate in this
      * grid, meaning it's in the range (0,0) to (tilesWide-1,
@@ -611,6 +1805,102 @@ namespace MFM {
      */
     bool MapGridToUncachedTile(const SPoint & siteInGrid, SPoint & tileInGrid, SPoint & siteInTile) const;
 
+    /**
+     * MapGridToTile each of the \c count sites at \c sitesInGrid,
+     * into \c tilesInGrid and \c sitesInTile.  A site that doesn't
+     * map gets a tileInGrid of (-1,-1).  Runs of sites in the same row
+     * share the row's mapping, so a row is cheaper mapped in one go.
+     *
+     * @returns how many of the sites mapped
+     */
+    u32 MapGridToTiles(const SPoint * sitesInGrid, u32 count,
+                       SPoint * tilesInGrid, SPoint * sitesInTile) const;
+
+    /**
+     * A grid site, mapped to its owning tile once, that can then Move
+     * to nearby sites without mapping again until it leaves that
+     * tile's owned sites.  Where there's no site -- off the grid, or
+     * in a staggered grid's gap -- it's invalid, until moved back
+     * onto one.  Good for walking rows, or the neighborhood of a
+     * hovered site.
+     */
+    class SiteCursor
+    {
+    public:
+      SiteCursor(Grid & grid, const SPoint & siteInGrid)
+        : m_grid(grid)
+        , m_tile(0)
+      {
+        MoveTo(siteInGrid);
+      }
+
+      /** Map \c siteInGrid from scratch */
+      void MoveTo(const SPoint & siteInGrid)
+      {
+        m_siteInGrid = siteInGrid;
+        m_tile = m_grid.MapGridToTile(siteInGrid, m_tileInGrid, m_siteInTile) ?
+          &m_grid.GetTile(m_tileInGrid) : 0;
+      }
+
+      /** Step by \c dx, \c dy grid sites */
+      void Move(s32 dx, s32 dy)
+      {
+        const s32 x = m_siteInTile.GetX() + dx;
+        const s32 y = m_siteInTile.GetY() + dy;
+        m_siteInGrid += SPoint(dx, dy);
+        if (m_tile && x >= R && x < R + (s32) m_grid.GetOwnedWidth() &&
+            y >= R && y < R + (s32) m_grid.GetOwnedHeight())
+          m_siteInTile.Set(x, y);  // Same tile, same stagger
+        else
+          MoveTo(m_siteInGrid);
+      }
+
+      bool IsValid() const
+      {
+        return m_tile != 0;
+      }
+
+      const SPoint & GetSiteInGrid() const
+      {
+        return m_siteInGrid;
+      }
+
+      /** Only meaningful if IsValid() */
+      const SPoint & GetTileInGrid() const
+      {
+        return m_tileInGrid;
+      }
+
+      /** In 'including cache' coordinates, like MapGridToTile; only meaningful if IsValid() */
+      const SPoint & GetSiteInTile() const
+      {
+        return m_siteInTile;
+      }
+
+      Tile<EC> & GetTile() const
+      {
+        MFM_API_ASSERT_STATE(m_tile);
+        return *m_tile;
+      }
+
+      typename EC::SITE & GetSite() const
+      {
+        return GetTile().GetSite(m_siteInTile);
+      }
+
+      const T * GetAtom(bool getFromBase = false) const
+      {
+        return GetTile().GetAtomInSite(getFromBase, m_siteInTile);
+      }
+
+    private:
+      Grid & m_grid;
+      SPoint m_siteInGrid;
+      SPoint m_tileInGrid;
+      SPoint m_siteInTile;
+      Tile<EC> * m_tile;        // 0 if there's no site here
+    };
+
     /**
      * Return the Grid height in Tiles
      */
@@ -621,12 +1911,33 @@ namespace MFM {
      */
     u32 GetWidth() const { return m_width; }
 
+    /**
+     * Return the width of each tile in sites, caches included: the
+     * compile-time TILE_WIDTH, unless IS_RUNTIME_SIZED
+     */
+    u32 GetTileWidth() const { return IS_RUNTIME_SIZED ? m_tileWidth : (u32) TILE_WIDTH; }
+
+    /**
+     * Return the height of each tile in sites, caches included
+     */
+    u32 GetTileHeight() const { return IS_RUNTIME_SIZED ? m_tileHeight : (u32) TILE_HEIGHT; }
+
+    /**
+     * Return the width of each tile in (non-cache) sites
+     */
+    u32 GetOwnedWidth() const { return GetTileWidth() - 2 * R; }
+
+    /**
+     * Return the height of each tile in (non-cache) sites
+     */
+    u32 GetOwnedHeight() const { return GetTileHeight() - 2 * R; }
+
     /**
      * Return the Grid height in (non-cache) sites
      */
     u32 GetHeightSites() const
     {
-      return GetHeight() * OWNED_HEIGHT;
+      return GetHeight() * GetOwnedHeight();
     }
 
     /**
@@ -636,8 +1947,8 @@ namespace MFM {
     u32 GetWidthSites() const
     {
       if(IsGridLayoutStaggered())
-	return GetWidth() * OWNED_WIDTH + OWNED_WIDTH/2;
-      return GetWidth() * OWNED_WIDTH;
+	return GetWidth() * GetOwnedWidth() + GetOwnedWidth()/2;
+      return GetWidth() * GetOwnedWidth();
     }
 
     /**
@@ -661,7 +1972,7 @@ namespace MFM {
      */
     bool IsGridRowStaggered(const SPoint & siteInGrid) const
     {
-      return IsGridLayoutStaggered() && ((siteInGrid.GetY()/OWNED_HEIGHT)%2 > 0);
+      return IsGridLayoutStaggered() && ((siteInGrid.GetY()/(s32) GetOwnedHeight())%2 > 0);
     }
 
     /**
@@ -675,6 +1986,7 @@ namespace MFM {
         TileDriver & td = _getTileDriver(i.GetX(),i.GetY());
         td.SetState(TileDriver::EXIT_REQUEST);
       }
+      WakeTileDrivers();
       SleepMsec(500);
     }
 
@@ -708,6 +2020,29 @@ namespace MFM {
 
     void PlaceAtomInSite(bool placeInBase, const T& atom, const SPoint& location, bool checkOnly=false);
 
+    /**
+     * Place \a atom in every site of \a rectInGrid, clipped to the
+     * grid and skipping a staggered grid's gaps.  Rather than mapping
+     * each site to its tile separately, as PlaceAtomInSite does, this
+     * maps each tile's run of each row once, and only looks for
+     * neighbor caches to update near the tile's edges.
+     *
+     * @returns the number of sites placed
+     */
+    u32 PlaceAtomsInRect(bool placeInBase, const T& atom, const Rect& rectInGrid);
+
+    /**
+     * Place the \a length atoms starting at \a atoms into the sites
+     * starting at \a start and going right, the same way
+     * PlaceAtomsInRect does.  Successive sites take every \a
+     * atomStride'th atom, so a stride of 0 places atoms[0]
+     * throughout.
+     *
+     * @returns the number of sites placed
+     */
+    u32 PlaceAtomsInRow(bool placeInBase, const T * atoms, u32 atomStride,
+                        const SPoint & start, u32 length);
+
     void XRayAtom(const SPoint& location);
 
     void MaybeXRayAtom(const SPoint& location);
@@ -744,6 +2079,45 @@ namespace MFM {
       return GetAtomInSite(false, loc);
     }
 
+    /**
+     * Write the event layer atoms of the sites in \a region (in grid
+     * site coordinates, clipped to the grid) to \a out as an atom
+     * dump, for AtomDumpReader to print later.  Far cheaper than
+     * printing them here, since no type names are parsed or
+     * formatted.  The grid should be paused.
+     *
+     * @returns the number of atoms dumped
+     */
+    u32 DumpAtoms(ByteSink & out, const Rect & region)
+    {
+      AtomDumpWriter<EC> dump(out);
+      const s32 right = MIN(region.GetX() + (s32) region.GetWidth(), (s32) GetWidthSites());
+      const s32 bottom = MIN(region.GetY() + (s32) region.GetHeight(), (s32) GetHeightSites());
+      const s32 left = MAX(region.GetX(), 0);
+      for (s32 y = MAX(region.GetY(), 0); y < bottom; ++y)
+      {
+        SiteCursor site(*this, SPoint(left, y));
+        for (s32 x = left; x < right; ++x, site.Move(1, 0))
+        {
+          if (!site.IsValid()) continue;  // A staggered grid's gap
+          const T * atom = site.GetAtom();
+          dump.Add((u32) x, (u32) y, *atom, LookupElement(atom->GetType()));
+        }
+      }
+      dump.Finish();
+      return dump.GetRecordCount();
+    }
+
+    /**
+     * Copy the type of the event layer atom in every site of the
+     * grid, row by row, into \a types, which must hold
+     * GetWidthSites() * GetHeightSites() of them.  A staggered grid's
+     * gaps read as Empty.  Like PlaceAtomsInRow, this maps each
+     * tile's run of each row once, rather than every site.  The grid
+     * should be paused.
+     */
+    void GetSiteTypes(u16 * types) ;
+
     const T* GetAtomInSite(bool getFromBase, SPoint& siteInGrid)
     {
       SPoint tileInGrid, siteInTile;
@@ -790,6 +2164,26 @@ namespace MFM {
       return GetTile(pt.GetX(), pt.GetY());
     }
 
+    /**
+       Like GetTile, but as the GridTile it really is, so its geometry
+       queries (GetSite, IsInCache, RegionIn, ...) fold to constants.
+     */
+    inline GridTile & GetGridTile(const SPoint& pt)
+    {
+      return const_cast<GridTile &>(static_cast<const Grid<GC>*>(this)->GetGridTile(pt));
+    }
+
+    inline const GridTile & GetGridTile(const SPoint& pt) const
+    {
+      if (!IsLegalTileIndex(pt))
+      {
+        LOG.Error("Can't get grid tile at (%d,%d); illegal tile index.",
+                  pt.GetX(), pt.GetY());
+        FAIL(ILLEGAL_ARGUMENT);
+      }
+      return _getTile(pt.GetX(), pt.GetY());
+    }
+
     inline Tile<EC> & GetTile(u32 x, u32 y)
     { return _getTile(x,y); }
 
@@ -798,22 +2192,114 @@ namespace MFM {
 
     /* Don't count caches! Don't count staggered undef ends!! */
     inline const u32 GetTotalSites()
-    { return GetWidth() * OWNED_WIDTH * GetHeightSites(); }
+    { return GetWidth() * GetOwnedWidth() * GetHeightSites(); }
 
     u64 GetTotalEventsExecuted() const;
 
     u64 GetTotalSitesAccessed() const;
 
+    /**
+       Sum the empty-site events skipped (and credited) by sparse
+       event selection over all tiles.
+     */
+    u64 GetTotalSkippedEmptyEvents() const;
+
+    /**
+       Sum the events credited to sleeping tiles over all tiles.
+       \sa SetQuiescentSleep
+     */
+    u64 GetTotalQuiescentEvents() const;
+
+    /**
+       Sum the events on inert elements, counted but not run, over all
+       tiles.  \sa EventWindow::GetInertEvents
+     */
+    u64 GetTotalInertEvents() const;
+
+    /**
+       The grid-wide total of \a counter as of the tiles' last
+       published stats.  Unlike the GetTotal methods this neither
+       locks, pauses nor visits any tile, so it's cheap to poll while
+       the grid runs.  Running tiles publish every
+       STATS_PUBLISH_ADVANCES advances, when they see they are paused,
+       and after each TileJob, so totals lag by no more than that.
+       \sa PublishAllTileStats
+     */
+    u64 GetPublishedTotal(TileStatsTree::Counter counter) const
+    {
+      return m_tileStats.GetTotal(counter);
+    }
+
+    /** The published count of \a atomType atoms.  \sa GetPublishedTotal */
+    u32 GetPublishedAtomCount(ElementType atomType) const ;
+
+    /**
+       Publish every tile's stats now, from this thread, as tile
+       threads do for themselves.  For grids driven without tile
+       threads; FAILs ILLEGAL_STATE if they're running.
+     */
+    void PublishAllTileStats() ;
+
     void WriteEPSImage(ByteSink & outstrm) const;
 
     void WriteEPSAverageImage(ByteSink & outstrm) const;
 
+    /**
+       The grid is covered by the tiles' event bins (see
+       Tile::EVENT_BIN_SIDE), laid out by tile position, so the grid
+       has GetEventBinsWide() x GetEventBinsHigh() of them.
+     */
+    u32 GetEventBinsWide() const;
+
+    u32 GetEventBinsHigh() const;
+
+    /**
+       Events in grid bin (binX,binY) since the last ResetEPSCounts.
+       0 for bins of dummy tiles.  O(1), so a heatmap costs O(bins).
+     */
+    u64 GetEventBinEvents(u32 binX, u32 binY) const;
+
+    /**
+       Append one record of the binary event bin time series to
+       outstrm: BEU32 aeps, BEU16 bins wide, BEU16 bins high, BEU16
+       bin side in sites, and then each bin's events, row by row, as
+       BEU32s (saturating).
+     */
+    void WriteEventBinsRecord(ByteSink & outstrm, u32 aeps) const;
+
+    /**
+       Zero the event bins of every tile.  Site event counts are not
+       affected.
+     */
     void ResetEPSCounts();
 
+    /**
+       Write the column names of WriteTileStatsRecord, as one CSV line.
+     */
+    static void WriteTileStatsHeader(ByteSink & outstrm);
+
+    /**
+       Append one CSV line per tile to outstrm: aeps, the tile's
+       position, and the events it executed, the Advance() calls its
+       thread made and how many of those were idle, and its intertile
+       lock failures and spin wins, each counted since the previous
+       record.  Hot tiles show high events; starving ones show a high
+       idle fraction or many lock failures.
+     */
+    void WriteTileStatsRecord(ByteSink & outstrm, u32 aeps);
+
     u32 GetAtomCount(ElementType atomType) const;
 
     s32 GetAtomCountFromSymbol(const u8 * elementSymbol) const;
 
+    /**
+     * Sum \a elementType's element data slot \a slot, out of \a
+     * slots, over all tiles -- as an element like Element_Consumer
+     * keeps its counts.  Tiles that have no data for it count zero.
+     * Read while the grid is paused for exact sums.
+     */
+    u64 GetElementDataTotal(u32 elementType, u32 slot, u32 slots) ;
+
     /**
      * Counts the number of sites which are occupied in this Grid and
      * gets a percentage, in the range [0.0 , 1.0] , describing the
@@ -825,7 +2311,7 @@ namespace MFM {
     {
       // Avoid using GetWidthSites, because it includes missing sites if the grid is staggered.
       return 1.0 - ((double)GetAtomCount(Element_Empty<EC>::THE_INSTANCE.GetType()) /
-                    (double)(GetHeight() * OWNED_HEIGHT * GetWidth() * OWNED_WIDTH));
+                    (double)(GetHeight() * GetOwnedHeight() * GetWidth() * GetOwnedWidth()));
     }
 
     //    void SurroundRectangleWithWall(s32 x, s32 y, s32 w, s32 h, s32 thickness);
@@ -3,6 +3,7 @@
 #include "Grid.h"
 #include "Utils.h"   /* For Sleep */
 #include "FileByteSink.h"
+#include <unistd.h>  /* For sysconf */
 
 #define XRAY_BIT_ODDS 100
 
@@ -99,26 +100,21 @@ namespace MFM {
     /* Reseed grid PRNG and push seeds to the tile PRNGs */
     InitSeed();
 
+    m_tileStats.Init(m_width * m_height, ElementTable<EC>::SIZE);
+
     /* Give the tile iterator an initial shuffle */
     m_rgi.Shuffle(m_random);
 
     m_backgroundRadiationEnabled = false;
 
-    /* Init the (non-dummy) tiles */
-    for (m_rgi.ShuffleOrReset(m_random); m_rgi.HasNext(); )
+    /* Init the (non-dummy) tiles, several at a time */
     {
-      SPoint tpt = IteratorIndexToCoord(m_rgi.Next());
-      Tile<EC> & ctile = GetTile(tpt);
-
-      MFM_API_ASSERT_ARG(!ctile.IsDummyTile());
-      ctile.Init(); //again
-
-      OString16 tbs;
-      tbs.Printf("[%d,%d]", tpt.GetX(), tpt.GetY());
-      LOG.Message("[%d,%d]", tpt.GetX(), tpt.GetY());
-      ctile.SetLabel(tbs.GetZString());
-
-      ctile.CopyHero(m_heroTile); //copies hero to ctile
+      InitTileJob job(*this);
+      for (m_rgi.ShuffleOrReset(m_random); m_rgi.HasNext(); )
+      {
+        job.m_order[job.m_count++] = IteratorIndexToCoord(m_rgi.Next());
+      }
+      RunInParallel(job, job.m_count, m_initThreads);
     }
 
     // Connect up (non-dummy) tiles
@@ -165,13 +161,104 @@ namespace MFM {
 	    ctile.Connect(gt, ctl, d);
 	    otile.Connect(gt, otl, odir);
 
+	    td.AddAdjacent(gt, true);
+	    _getTileDriver(npt.GetX(),npt.GetY()).AddAdjacent(gt, false);
+
 	    gt.SetEnabled(true);
 	    gt.SetDataRate(100000000);
 	    gt.SetMaxInFlight(0);
+	    gt.SetDirectMode(m_directChannels);
 	  } //direction loop
       } //tile loop
+
+    PublishAllTileStats();
   } //Init
 
+  template <class GC>
+  void Grid<GC>::InitTile(const SPoint & tpt)
+  {
+    Tile<EC> & ctile = GetTile(tpt);
+
+    MFM_API_ASSERT_ARG(!ctile.IsDummyTile());
+    ctile.Init(); //again
+
+    OString16 tbs;
+    tbs.Printf("[%d,%d]", tpt.GetX(), tpt.GetY());
+    LOG.Message("[%d,%d]", tpt.GetX(), tpt.GetY());
+    ctile.SetLabel(tbs.GetZString());
+
+    ctile.CopyHero(m_heroTile); //copies hero to ctile
+    ctile.SetTileParameterSource(&m_tileParameters);
+
+    TileDriver & td = _getTileDriver(tpt.GetX(),tpt.GetY());
+    td.m_loc = tpt;
+    td.m_gridPtr = this;
+    td.m_adjacentCount = 0;
+  }
+
+  template <class GC>
+  void * Grid<GC>::RunIndexJob(void * arg)
+  {
+    IndexJobRunner & r = *(IndexJobRunner *) arg;
+
+    // Init error stack pointer (for this thread only)
+    MFMPtrToErrEnvStackPtr = &r.m_errorStackTop;
+
+    r.RunJobs();
+    return 0;
+  }
+
+  template <class GC>
+  void Grid<GC>::RunInParallel(IndexJob & job, u32 count, u32 threads)
+  {
+    if (threads == 0)
+    {
+      long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+      threads = cpus > 0 ? (u32) cpus : 1;
+    }
+    threads = MAX(1u, MIN(threads, MIN(count, (u32) MAX_INIT_THREADS)));
+
+    IndexJobRunner runners[MAX_INIT_THREADS];
+    u32 started = 1;  // The caller is runner 0
+    for (u32 t = 0; t < threads; ++t)
+    {
+      IndexJobRunner & r = runners[t];
+      r.m_job = &job;
+      r.m_first = t;
+      r.m_stride = threads;
+      r.m_count = count;
+      r.m_errorStackTop = 0;
+      if (t > 0 && started == t)
+      {
+        if (pthread_create(&r.m_thread, NULL, RunIndexJob, &r) == 0)
+          ++started;
+      }
+    }
+
+    // Indexes of any threads that didn't start are run here too
+    for (u32 t = started; t < threads; ++t)
+      runners[t].RunJobs();
+    runners[0].RunJobs();
+
+    for (u32 t = 1; t < started; ++t)
+      pthread_join(runners[t].m_thread, NULL);
+  }
+
+  template <class GC>
+  void Grid<GC>::ReleaseEventHistory()
+  {
+    for(u32 x = 0; x < m_width; x++)
+    {
+      for(u32 y = 0; y < m_height; y++)
+      {
+	if(!IsLegalTileIndex(SPoint(x,y)))
+	  continue;
+
+        GetTile(x,y).ReleaseHistory();
+      }
+    }
+  }
+
   template <class GC>
   double Grid<GC>::GetAverageCacheRedundancy() const
   {
@@ -181,7 +268,7 @@ namespace MFM {
     {
       for(u32 y = 0; y < m_height; y++)
       {
-	if(!IsLegalTileIndex(x,y))
+	if(!IsLegalTileIndex(SPoint(x,y)))
 	  continue;
 
         const Tile<EC> & tile = GetTile(x,y);
@@ -199,74 +286,899 @@ namespace MFM {
     }
     if (count == 0)
     {
-      return -1.0;
+      return -1.0;
+    }
+    return sum / count;
+  }
+
+  template <class GC>
+  void Grid<GC>::SetCacheRedundancy(u32 redundancyOddsType)
+  {
+    for(u32 x = 0; x < m_width; x++)
+    {
+      for(u32 y = 0; y < m_height; y++)
+      {
+	if(!IsLegalTileIndex(SPoint(x,y)))
+	  continue;
+
+        Tile<EC> & tile = GetTile(x,y);
+
+	if(tile.IsDummyTile())
+	  continue;
+
+        tile.SetCacheRedundancy(redundancyOddsType);
+      }
+    }
+  }
+
+  template <class GC>
+  void Grid<GC>::GetCacheCheckCounts(Dir dir, u64 & checkAtoms, u64 & checkBytes,
+                                     u64 & cleanReplies, u64 & failedReplies) const
+  {
+    checkAtoms = 0;
+    checkBytes = 0;
+    cleanReplies = 0;
+    failedReplies = 0;
+    for(u32 x = 0; x < m_width; x++)
+    {
+      for(u32 y = 0; y < m_height; y++)
+      {
+        if(!IsLegalTileIndex(SPoint(x,y)))
+          continue;
+
+        const Tile<EC> & tile = GetTile(x,y);
+
+        if(tile.IsDummyTile())
+          continue;
+
+        const CacheProcessor<EC> & cp = tile.GetCacheProcessor(dir);
+        checkAtoms += cp.GetCheckAtomsShipped();
+        checkBytes += cp.GetCheckBytesShipped();
+        cleanReplies += cp.GetCleanReplies();
+        failedReplies += cp.GetFailedReplies();
+      }
+    }
+  }
+
+  template <class GC>
+  void Grid<GC>::SetCacheBatchLimit(u32 maxSites)
+  {
+    for(u32 x = 0; x < m_width; x++)
+    {
+      for(u32 y = 0; y < m_height; y++)
+      {
+        if(!IsLegalTileIndex(SPoint(x,y)))
+          continue;
+
+        Tile<EC> & tile = GetTile(x,y);
+
+        if(tile.IsDummyTile())
+          continue;
+
+        tile.SetCacheBatchLimit(maxSites);
+      }
+    }
+  }
+
+  template <class GC>
+  void Grid<GC>::SetCompactCache(bool on)
+  {
+    for(u32 x = 0; x < m_width; x++)
+    {
+      for(u32 y = 0; y < m_height; y++)
+      {
+        if(!IsLegalTileIndex(SPoint(x,y)))
+          continue;
+
+        Tile<EC> & tile = GetTile(x,y);
+
+        if(tile.IsDummyTile())
+          continue;
+
+        tile.SetCompactCache(on);
+      }
+    }
+  }
+
+  template <class GC>
+  void Grid<GC>::SetSparseEvents(bool on)
+  {
+    for(u32 x = 0; x < m_width; x++)
+    {
+      for(u32 y = 0; y < m_height; y++)
+      {
+        if(!IsLegalTileIndex(SPoint(x,y)))
+          continue;
+
+        Tile<EC> & tile = GetTile(x,y);
+
+        if(tile.IsDummyTile())
+          continue;
+
+        tile.SetSparseEvents(on);
+      }
+    }
+  }
+
+  template <class GC>
+  void Grid<GC>::SetAgedEvents(bool on)
+  {
+    for(u32 x = 0; x < m_width; x++)
+    {
+      for(u32 y = 0; y < m_height; y++)
+      {
+        if(!IsLegalTileIndex(SPoint(x,y)))
+          continue;
+
+        Tile<EC> & tile = GetTile(x,y);
+
+        if(tile.IsDummyTile())
+          continue;
+
+        tile.SetAgedEvents(on);
+      }
+    }
+  }
+
+  template <class GC>
+  void Grid<GC>::SetEventBatchSize(u32 size)
+  {
+    for(u32 x = 0; x < m_width; x++)
+    {
+      for(u32 y = 0; y < m_height; y++)
+      {
+        if(!IsLegalTileIndex(SPoint(x,y)))
+          continue;
+
+        Tile<EC> & tile = GetTile(x,y);
+
+        if(tile.IsDummyTile())
+          continue;
+
+        tile.SetEventBatchSize(size);
+      }
+    }
+  }
+
+  template <class GC>
+  void Grid<GC>::SetEventWorkers(u32 workers)
+  {
+    for(u32 x = 0; x < m_width; x++)
+    {
+      for(u32 y = 0; y < m_height; y++)
+      {
+        if(!IsLegalTileIndex(SPoint(x,y)))
+          continue;
+
+        Tile<EC> & tile = GetTile(x,y);
+
+        if(tile.IsDummyTile())
+          continue;
+
+        tile.SetEventWorkers(workers);
+      }
+    }
+  }
+
+  template <class GC>
+  void Grid<GC>::SetOptimisticEvents(bool on)
+  {
+    for(u32 x = 0; x < m_width; x++)
+    {
+      for(u32 y = 0; y < m_height; y++)
+      {
+        if(!IsLegalTileIndex(SPoint(x,y)))
+          continue;
+
+        Tile<EC> & tile = GetTile(x,y);
+
+        if(tile.IsDummyTile())
+          continue;
+
+        tile.SetOptimisticEvents(on);
+      }
+    }
+  }
+
+  template <class GC>
+  void Grid<GC>::SetElementProfiling(bool on)
+  {
+    for(u32 x = 0; x < m_width; x++)
+    {
+      for(u32 y = 0; y < m_height; y++)
+      {
+        if(!IsLegalTileIndex(SPoint(x,y)))
+          continue;
+
+        Tile<EC> & tile = GetTile(x,y);
+
+        if(tile.IsDummyTile())
+          continue;
+
+        tile.SetElementProfiling(on);
+      }
+    }
+  }
+
+  template <class GC>
+  void Grid<GC>::ResetElementProfiles()
+  {
+    for(u32 x = 0; x < m_width; x++)
+    {
+      for(u32 y = 0; y < m_height; y++)
+      {
+        if(!IsLegalTileIndex(SPoint(x,y)))
+          continue;
+
+        Tile<EC> & tile = GetTile(x,y);
+
+        if(tile.IsDummyTile())
+          continue;
+
+        tile.GetElementProfile().Reset();
+      }
+    }
+  }
+
+  template <class GC>
+  void Grid<GC>::GetElementProfile(ElementProfile & total) const
+  {
+    total.Reset();
+    for(u32 x = 0; x < m_width; x++)
+    {
+      for(u32 y = 0; y < m_height; y++)
+      {
+        if(!IsLegalTileIndex(SPoint(x,y)))
+          continue;
+
+        const Tile<EC> & tile = GetTile(x,y);
+
+        if(tile.IsDummyTile())
+          continue;
+
+        total.Add(tile.GetElementProfile());
+      }
+    }
+  }
+
+  template <class GC>
+  void Grid<GC>::WriteElementProfileCSV(ByteSink & out) const
+  {
+    ElementProfile total;
+    GetElementProfile(total);
+
+    const ElementProfile::Entry * (sorted[ElementProfile::SLOT_COUNT]);
+    const u32 count = total.GetTopByTicks(sorted, ElementProfile::SLOT_COUNT);
+    const u64 allTicks = total.GetTotalTicks();
+
+    out.Printf("type,symbol,name,calls,total_ticks,mean_ticks,max_ticks,sites_written,pct_ticks\n");
+    for (u32 i = 0; i < count; ++i)
+    {
+      const ElementProfile::Entry & e = *sorted[i];
+      const Element<EC> * elt = LookupElement(e.m_type);
+      out.Printf("0x%04x,%s,\"%s\",", e.m_type,
+                 elt ? elt->GetAtomicSymbol() : "?",
+                 elt ? elt->GetName() : "?");
+      out.Print(e.m_calls);
+      out.Printf(",");
+      out.Print(e.m_totalTicks);
+      out.Printf(",");
+      out.Print(e.GetMeanTicks());
+      out.Printf(",");
+      out.Print(e.m_maxTicks);
+      out.Printf(",");
+      out.Print(e.m_sitesWritten);
+      out.Printf(",%f\n", allTicks ? 100.0 * e.m_totalTicks / allTicks : 0.0);
+    }
+  }
+
+  template <class GC>
+  void Grid<GC>::GetCacheShippedCounts(u64 & packets, u64 & bytes) const
+  {
+    packets = 0;
+    bytes = 0;
+    for(u32 x = 0; x < m_width; x++)
+    {
+      for(u32 y = 0; y < m_height; y++)
+      {
+        if(!IsLegalTileIndex(SPoint(x,y)))
+          continue;
+
+        const Tile<EC> & tile = GetTile(x,y);
+
+        if(tile.IsDummyTile())
+          continue;
+
+        u64 tp, tb;
+        tile.GetCacheShippedCounts(tp, tb);
+        packets += tp;
+        bytes += tb;
+      }
+    }
+  }
+
+  template <class GC>
+  void Grid<GC>::SetLockSpinCount(u32 spins)
+  {
+    for(u32 x = 0; x < m_width; x++)
+    {
+      for(u32 y = 0; y < m_height; y++)
+      {
+        if(!IsLegalTileIndex(SPoint(x,y)))
+          continue;
+
+        Tile<EC> & tile = GetTile(x,y);
+
+        if(tile.IsDummyTile())
+          continue;
+
+        tile.SetLockSpinCount(spins);
+      }
+    }
+  }
+
+  template <class GC>
+  void Grid<GC>::GetLockFailureCounts(u64 & failures, u64 & spinWins) const
+  {
+    failures = 0;
+    spinWins = 0;
+    for(u32 x = 0; x < m_width; x++)
+    {
+      for(u32 y = 0; y < m_height; y++)
+      {
+        if(!IsLegalTileIndex(SPoint(x,y)))
+          continue;
+
+        const Tile<EC> & tile = GetTile(x,y);
+
+        if(tile.IsDummyTile())
+          continue;
+
+        u64 tf, tw;
+        tile.GetLockFailureCounts(tf, tw);
+        failures += tf;
+        spinWins += tw;
+      }
+    }
+  }
+
+  template <class GC>
+  void Grid<GC>::InitThreads()
+  {
+    if (m_threadsInitted)
+    {
+      FAIL(ILLEGAL_STATE);
+    }
+
+    if (m_numaPlacement)
+    {
+      InitNUMAPlacement();
+    }
+
+    /* Next cpu to use on each node, when pinning tile threads */
+    u32 nodeThreads[NUMAPlacement::MAX_NODES] = { 0 };
+
+    /* Init the tile thread drivers */
+    for (m_rgi.ShuffleOrReset(m_random); m_rgi.HasNext(); )
+    {
+      SPoint tpt = IteratorIndexToCoord(m_rgi.Next());
+      MFM_API_ASSERT_STATE(IsLegalTileIndex(tpt));
+
+      TileDriver & td = _getTileDriver(tpt.GetX(),tpt.GetY());
+      td.m_loc = tpt; //init m_loc before a GetTile call
+      td.m_gridPtr = this;
+      td.SetState(TileDriver::PAUSED);
+      MFM_API_ASSERT_STATE(!td.GetTile().IsDummyTile());
+
+      if (m_useTilePool)
+      {
+        continue;  // Pool workers are started below
+      }
+
+      if (m_numaPlacement)
+      {
+        m_numa.BindMemory(&_getTile(tpt.GetX(),tpt.GetY()), sizeof(GridTile), td.m_numaNode);
+      }
+
+      if (pthread_create(&td.m_threadId, NULL, TileDriverRunner, &td))
+      {
+        FAIL(ILLEGAL_STATE);
+      }
+
+      if (m_numaPlacement)
+      {
+        NUMAPlacement::PinThread(td.m_threadId,
+                                 m_numa.GetCPU(td.m_numaNode, nodeThreads[td.m_numaNode]++));
+      }
+    }
+
+    if (m_useTilePool)
+    {
+      InitTilePoolThreads();
+    }
+
+    /* After any NUMA binding, which could split huge pages */
+    if (m_hugePages)
+    {
+      InitHugePages();
+    }
+
+    m_threadsInitted = true;
+  }
+
+  template <class GC>
+  void Grid<GC>::InitHugePages()
+  {
+    const u64 bytes = m_width * m_height * (u64) sizeof(GridTile);
+    if (!HugePageMemory::Advise(m_tiles, bytes))
+    {
+      m_hugePages = false;
+      return;
+    }
+
+    u64 resident, huge;
+    if (HugePageMemory::GetResidency(m_tiles, bytes, resident, huge))
+    {
+      LOG.Message("Tile memory: %ldKB resident, %ldKB (%d%%) on huge pages",
+                  (long) (resident / 1024), (long) (huge / 1024),
+                  resident ? (s32) (100 * huge / resident) : 0);
+    }
+  }
+
+  template <class GC>
+  void Grid<GC>::InitNUMAPlacement()
+  {
+    if (!m_numa.Discover())
+    {
+      LOG.Warning("No cpus found; not using NUMA placement");
+      m_numaPlacement = false;
+      return;
+    }
+
+    for (iterator_type i = begin(); i != end(); ++i)
+    {
+      TileDriver & td = _getTileDriver(i.GetX(), i.GetY());
+      td.m_numaNode = m_numa.GetNodeForTile(i.GetX(), i.GetY(), m_width, m_height);
+    }
+  }
+
+  template <class GC>
+  void Grid<GC>::InitTilePoolThreads()
+  {
+    u32 workers = m_tilePoolThreads;
+    if (workers == 0)
+    {
+      long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+      workers = cpus > 0 ? (u32) cpus : 1;
+    }
+
+    u32 tiles = 0;
+    for (iterator_type i = begin(); i != end(); ++i)
+      ++tiles;
+
+    workers = MIN(workers, MAX(tiles, 1u));
+
+    m_tileWorkerCount = workers;
+    m_tileWorkers = new TileWorker[m_tileWorkerCount];
+    m_tilePoolLiveTiles = tiles;
+
+    /* Under NUMA placement, node n's workers are those in
+       [n*W/N, (n+1)*W/N), for W workers and N nodes */
+    const u32 nodes = m_numaPlacement ? m_numa.GetNodeCount() : 1;
+    u32 nodeDealt[NUMAPlacement::MAX_NODES] = { 0 };
+
+    /* Deal the tiles out round robin, in shuffled order */
+    u32 next = 0;
+    for (m_rgi.ShuffleOrReset(m_random); m_rgi.HasNext(); )
+    {
+      SPoint tpt = IteratorIndexToCoord(m_rgi.Next());
+      TileDriver & td = _getTileDriver(tpt.GetX(),tpt.GetY());
+
+      // Done by TileDriverRunner in the thread-per-tile case
+      td.GetTile().RequestStatePassive();
+
+      if (m_numaPlacement)
+      {
+        /* Keep the tile with its node's workers, if it has any */
+        const u32 n = td.m_numaNode;
+        const u32 first = n * workers / nodes;
+        const u32 count = (n + 1) * workers / nodes - first;
+        next = count > 0 ? first + nodeDealt[n]++ % count : MIN(first, workers - 1);
+        td.m_numaNode = GetTilePoolWorkerNode(next, workers, nodes);
+        m_numa.BindMemory(&_getTile(tpt.GetX(),tpt.GetY()), sizeof(GridTile), td.m_numaNode);
+      }
+
+      m_tileWorkers[next].PushBack(&td);
+      next = (next + 1) % m_tileWorkerCount;
+    }
+
+    u32 nodeThreads[NUMAPlacement::MAX_NODES] = { 0 };
+    for (u32 w = 0; w < m_tileWorkerCount; ++w)
+    {
+      TileWorker & tw = m_tileWorkers[w];
+      tw.m_index = w;
+      tw.m_gridPtr = this;
+      tw.m_random.SetSeed(m_random.Create());
+      if (pthread_create(&tw.m_threadId, NULL, TileWorkerRunner, &tw))
+      {
+        FAIL(ILLEGAL_STATE);
+      }
+
+      if (m_numaPlacement)
+      {
+        const u32 n = GetTilePoolWorkerNode(w, workers, nodes);
+        NUMAPlacement::PinThread(tw.m_threadId, m_numa.GetCPU(n, nodeThreads[n]++));
+      }
+    }
+
+    LOG.Message("Tile pool: %d workers driving %d tiles", m_tileWorkerCount, tiles);
+  }
+
+  template <class GC>
+  void Grid<GC>::SetGridRunning(bool running)
+  {
+    /* Notify the Tiles */
+    for (RandomIterator<MAX_TILES_SUPPORTED> & it = StartTileControlLoop(); it.HasNext(); )
+    {
+      SPoint tpt = IteratorIndexToCoord(it.Next());
+      MFM_API_ASSERT_STATE(IsLegalTileIndex(tpt));
+
+      TileDriver & td = _getTileDriver(tpt.GetX(),tpt.GetY());
+      MFM_API_ASSERT_STATE(!td.GetTile().IsDummyTile());
+
+      td.SetState(running? TileDriver::ADVANCING : TileDriver::PAUSED);
+    }
+    WakeTileDrivers();
+  }
+
+  template <class GC>
+  void Grid<GC>::WakeTileDrivers()
+  {
+    pthread_mutex_lock(&m_driverLock);
+    pthread_cond_broadcast(&m_driverWake);
+    for (iterator_type i = begin(); i != end(); ++i)
+    {
+      // Sleeping tiles wake to see their new state
+      pthread_cond_signal(&_getTileDriver(i.GetX(), i.GetY()).m_quiescentWake);
+    }
+    pthread_mutex_unlock(&m_driverLock);
+  }
+
+  /* An absolute CLOCK_REALTIME deadline \a usec from now, for pthread_cond_timedwait */
+  static inline timespec GridDeadlineAfterUsec(u32 usec)
+  {
+    timespec when;
+    clock_gettime(CLOCK_REALTIME, &when);
+    u64 nsec = (u64) when.tv_nsec + (u64) 1000 * usec;
+    when.tv_sec += nsec / 1000000000;
+    when.tv_nsec = nsec % 1000000000;
+    return when;
+  }
+
+  template <class GC>
+  void Grid<GC>::WaitWhilePaused(TileDriver & td, u32 maxUsec)
+  {
+    pthread_mutex_lock(&m_driverLock);
+    if (td.GetState() == TileDriver::PAUSED &&
+        td.m_tileJobGeneration == m_tileJobGeneration)
+    {
+      // SetState happens before WakeTileDrivers takes the lock, so
+      // checking under it can't miss a wakeup
+      timespec deadline = GridDeadlineAfterUsec(maxUsec);
+      pthread_cond_timedwait(&m_driverWake, &m_driverLock, &deadline);
+    }
+    pthread_mutex_unlock(&m_driverLock);
+  }
+
+  template <class GC>
+  bool Grid<GC>::KeepTileAsleep(TileDriver & td, bool & didWork)
+  {
+    Tile<EC> & tile = td.GetTile();
+    const u64 now = FastClock::MonotonicNanos();
+    if (td.m_asleep)
+    {
+      CreditQuiescentEvents(td, now);
+      if (!__atomic_load_n(&td.m_wakeRequested, __ATOMIC_ACQUIRE))
+      {
+        return true;
+      }
+
+      // Answer whatever woke us, without originating events.  Any
+      // write from here on requests another wake.
+      __atomic_store_n(&td.m_wakeRequested, 0, __ATOMIC_SEQ_CST);
+      didWork = tile.AdvanceWhileQuiescent();
+      if (!IsTileDriverQuiet(td))
+      {
+        __atomic_store_n(&td.m_wakeRequested, 1, __ATOMIC_RELAXED);  // Not done yet
+        return true;
+      }
+      if (tile.IsQuiescent())
+      {
+        return true;
+      }
+
+      // Something live arrived
+      __atomic_store_n(&td.m_asleep, 0, __ATOMIC_SEQ_CST);
+      td.ClearQuietMark();
+      return false;
+    }
+
+    if (!m_quiescentSleep || ++td.m_quiet.m_advances < QUIESCENCE_CHECK_ADVANCES)
+    {
+      return false;
+    }
+    td.m_quiet.m_advances = 0;
+
+    if (!tile.IsQuiescent())
+    {
+      td.ClearQuietMark();
+      return false;
+    }
+
+    const u64 events = tile.GetEventsExecuted();
+    if (td.m_quiet.m_sinceNanos == 0)
+    {
+      td.m_quiet.m_sinceNanos = now;
+      td.m_quiet.m_sinceEvents = events;
+      return false;
+    }
+
+    // Quiescent at two checks in a row: sleep, crediting events at
+    // the rate we ran them in between
+    td.m_quiet.m_eventsPerNano =
+      now > td.m_quiet.m_sinceNanos ?
+      (events - td.m_quiet.m_sinceEvents) / (double) (now - td.m_quiet.m_sinceNanos) : 0;
+    td.m_quiet.m_carry = 0;
+    td.m_quiet.m_creditedNanos = now;
+
+    // Declare sleep before looking at the transceivers, so a
+    // neighbor's write either shows up in the look or sees us asleep
+    // and requests a wake
+    __atomic_store_n(&td.m_wakeRequested, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&td.m_asleep, 1, __ATOMIC_SEQ_CST);
+    if (!IsTileDriverQuiet(td))
+    {
+      __atomic_store_n(&td.m_wakeRequested, 1, __ATOMIC_RELAXED);  // Answer that first
+    }
+    return true;
+  }
+
+  template <class GC>
+  bool Grid<GC>::IsTileDriverQuiet(TileDriver & td)
+  {
+    for (u32 i = 0; i < td.m_adjacentCount; ++i)
+    {
+      // Bytes in transit either way are ours to move only on the
+      // transceivers we drive, where we're side A
+      GridTransceiver & gt = *td.m_adjacent[i];
+      const bool sideA = td.m_adjacentSideA[i];
+      if (gt.GetUnreadBytes(sideA) > 0 || (sideA && gt.IsInTransit()))
+      {
+        return false;
+      }
+    }
+    return td.GetTile().IsCacheIdle();
+  }
+
+  template <class GC>
+  void Grid<GC>::CreditQuiescentEvents(TileDriver & td, u64 nowNanos)
+  {
+    if (nowNanos <= td.m_quiet.m_creditedNanos)
+    {
+      return;
+    }
+    const double due =
+      td.m_quiet.m_eventsPerNano * (nowNanos - td.m_quiet.m_creditedNanos) + td.m_quiet.m_carry;
+    const u64 events = (u64) due;
+    td.m_quiet.m_carry = due - events;
+    td.m_quiet.m_creditedNanos = nowNanos;
+    if (events > 0)
+    {
+      td.GetTile().CreditQuiescentEvents(events);
+    }
+  }
+
+  template <class GC>
+  void Grid<GC>::WakeQuiescentTile(TileDriver & td)
+  {
+    // Whatever woke us is in place before we look at m_asleep
+    __sync_synchronize();
+    if (!__atomic_load_n(&td.m_asleep, __ATOMIC_RELAXED))
+    {
+      return;
+    }
+    pthread_mutex_lock(&m_driverLock);
+    __atomic_store_n(&td.m_wakeRequested, 1, __ATOMIC_RELEASE);
+    pthread_cond_signal(&td.m_quiescentWake);
+    pthread_mutex_unlock(&m_driverLock);
+  }
+
+  template <class GC>
+  void Grid<GC>::WaitWhileQuiescent(TileDriver & td, u32 maxUsec)
+  {
+    pthread_mutex_lock(&m_driverLock);
+    if (!td.m_wakeRequested && td.GetState() == TileDriver::ADVANCING)
+    {
+      // As in WaitWhilePaused, checking under the lock can't miss a
+      // WakeQuiescentTile or WakeTileDrivers
+      timespec deadline = GridDeadlineAfterUsec(maxUsec);
+      pthread_cond_timedwait(&td.m_quiescentWake, &m_driverLock, &deadline);
+    }
+    pthread_mutex_unlock(&m_driverLock);
+  }
+
+  template <class GC>
+  void Grid<GC>::NoteTileActivity(TileDriver & td)
+  {
+    if (++td.m_activity.m_advances < ACTIVITY_SAMPLE_ADVANCES)
+    {
+      return;
+    }
+    td.m_activity.m_advances = 0;
+
+    const Tile<EC> & tile = td.GetTile();
+    const u32 sites = tile.OWNED_WIDTH * tile.OWNED_HEIGHT;
+    const u32 sample = (u32) (((u64) tile.GetLiveAtomCount() * ACTIVITY_ONE + sites - 1) / sites);
+
+    // Mostly what it's been lately, so one sample doesn't swing it
+    const u32 weight = (3 * td.m_activity.m_weight + sample + 3) / 4;
+    __atomic_store_n(&td.m_activity.m_weight, MIN(weight, (u32) ACTIVITY_ONE), __ATOMIC_RELAXED);
+  }
+
+  template <class GC>
+  bool Grid<GC>::IsActivityYield(TileDriver & td)
+  {
+    if (!m_activityScheduling)
+    {
+      return false;
+    }
+    td.m_activity.m_credit += td.m_activity.m_weight;
+    if (td.m_activity.m_credit < ACTIVITY_ONE)
+    {
+      return true;
+    }
+    td.m_activity.m_credit -= ACTIVITY_ONE;
+    return false;
+  }
+
+  template <class GC>
+  u32 Grid<GC>::GetTilePoolAdvances(const TileDriver & td) const
+  {
+    if (!m_activityScheduling)
+    {
+      return TILE_POOL_ADVANCES_PER_TURN;
     }
-    return sum / count;
+    return 1 + (TILE_POOL_MAX_ADVANCES_PER_TURN - 1) * td.m_activity.m_weight / ACTIVITY_ONE;
   }
 
   template <class GC>
-  void Grid<GC>::SetCacheRedundancy(u32 redundancyOddsType)
+  u32 Grid<GC>::GetTileActivity(const SPoint & tileLoc)
   {
-    for(u32 x = 0; x < m_width; x++)
+    MFM_API_ASSERT_ARG(IsLegalTileIndex(tileLoc));
+    const TileDriver & td = _getTileDriver(tileLoc.GetX(), tileLoc.GetY());
+    return __atomic_load_n(&td.m_activity.m_weight, __ATOMIC_RELAXED);
+  }
+
+  template <class GC>
+  u32 Grid<GC>::GetQuiescentTileCount()
+  {
+    u32 count = 0;
+    for (iterator_type i = begin(); i != end(); ++i)
     {
-      for(u32 y = 0; y < m_height; y++)
+      if (__atomic_load_n(&_getTileDriver(i.GetX(), i.GetY()).m_asleep, __ATOMIC_RELAXED))
       {
-	if(!IsLegalTileIndex(x,y))
-	  continue;
-
-        const Tile<EC> & tile = GetTile(x,y);
-
-	if(tile.IsDummyTile())
-	  continue;
-
-        tile.SetCacheRedundancy(redundancyOddsType);
+        ++count;
       }
     }
+    return count;
   }
 
   template <class GC>
-  void Grid<GC>::InitThreads()
+  void Grid<GC>::NoteTileStateChange()
   {
-    if (m_threadsInitted)
+    pthread_mutex_lock(&m_driverLock);
+    ++m_tileStateGeneration;
+    pthread_cond_broadcast(&m_tileStateChanged);
+    pthread_mutex_unlock(&m_driverLock);
+  }
+
+  template <class GC>
+  u32 Grid<GC>::GetTileStateGeneration()
+  {
+    pthread_mutex_lock(&m_driverLock);
+    u32 generation = m_tileStateGeneration;
+    pthread_mutex_unlock(&m_driverLock);
+    return generation;
+  }
+
+  template <class GC>
+  void Grid<GC>::WaitForTileStateChange(u32 generation, u32 maxUsec)
+  {
+    pthread_mutex_lock(&m_driverLock);
+    if (m_tileStateGeneration == generation)
     {
-      FAIL(ILLEGAL_STATE);
+      timespec deadline = GridDeadlineAfterUsec(maxUsec);
+      while (m_tileStateGeneration == generation &&
+             pthread_cond_timedwait(&m_tileStateChanged, &m_driverLock, &deadline) == 0)
+      { }
     }
+    pthread_mutex_unlock(&m_driverLock);
+  }
 
-    /* Init the tile thread drivers */
-    for (m_rgi.ShuffleOrReset(m_random); m_rgi.HasNext(); )
+  template <class GC>
+  bool Grid<GC>::AdvanceTileDriver(TileDriver & td, bool & didWork, bool & paused)
+  {
+    didWork = false;
+    paused = false;
+
+    switch (td.GetState())
     {
-      SPoint tpt = IteratorIndexToCoord(m_rgi.Next());
-      MFM_API_ASSERT_STATE(IsLegalTileIndex(tpt));
+    case TileDriver::EXIT_REQUEST:
+      return false;
 
-      TileDriver & td = _getTileDriver(tpt.GetX(),tpt.GetY());
-      td.m_loc = tpt; //init m_loc before a GetTile call
-      td.m_gridPtr = this;
-      td.SetState(TileDriver::PAUSED);
-      MFM_API_ASSERT_STATE(!td.GetTile().IsDummyTile());
+    case TileDriver::ADVANCING:
+    {
+      if (++td.m_statsAdvances >= STATS_PUBLISH_ADVANCES)
+      {
+        PublishTileStats(td.m_loc);
+      }
 
-      if (pthread_create(&td.m_threadId, NULL, TileDriverRunner, &td))
+      // Drive this tile's transceivers
+      timespec now;
+      FastClock::Monotonic(now);
+      for (u32 c = 0; c < 4; ++c)
       {
-        FAIL(ILLEGAL_STATE);
+        if(td.m_channels[c].IsEnabled()) //esa
+          td.m_channels[c].AdvanceToTime(now);
       }
-    }
 
-    m_threadsInitted = true;
-  }
+      if (KeepTileAsleep(td, didWork))
+      {
+        break;
+      }
 
-  template <class GC>
-  void Grid<GC>::SetGridRunning(bool running)
-  {
-    /* Notify the Tiles */
-    for (m_rgi.ShuffleOrReset(m_random); m_rgi.HasNext(); )
-    {
-      SPoint tpt = IteratorIndexToCoord(m_rgi.Next());
-      MFM_API_ASSERT_STATE(IsLegalTileIndex(tpt));
+      // Drive the tile itself, telling any waiting
+      // DoTileDriverControl if that changed its state
+      Tile<EC> & tile = td.GetTile();
+      const u32 stateChanges = tile.GetStateChangeCount();
+      didWork = tile.Advance();
+      if (tile.GetStateChangeCount() != stateChanges)
+      {
+        NoteTileStateChange();
+      }
+      if (m_activityScheduling)
+      {
+        NoteTileActivity(td);
+      }
+      break;
+    }
 
-      TileDriver & td = _getTileDriver(tpt.GetX(),tpt.GetY());
-      MFM_API_ASSERT_STATE(!td.GetTile().IsDummyTile());
+    case TileDriver::PAUSED:
+      paused = true;
+      if (td.m_asleep)
+      {
+        // Whatever's done while paused could wake us; start over awake
+        __atomic_store_n(&td.m_asleep, 0, __ATOMIC_SEQ_CST);
+      }
+      td.ClearQuietMark();
+      if (td.m_tileJobGeneration != m_tileJobGeneration)
+      {
+        didWork = RunPendingTileJob(td);
+        if (didWork)
+        {
+          td.m_statsAdvances = 1;  // Whatever it did, publish it
+        }
+      }
+      if (td.m_statsAdvances > 0)
+      {
+        PublishTileStats(td.m_loc);
+      }
+      break;
 
-      td.SetState(running? TileDriver::ADVANCING : TileDriver::PAUSED);
+    default:
+      FAIL(ILLEGAL_STATE);
     }
+    return true;
   }
 
   template <class GC>
@@ -290,49 +1202,149 @@ namespace MFM {
 
     ctile.RequestStatePassive();
 
-    bool running = true;
-    u32 pauseUsec = 0;
-    while (running)
+    bool didWork, paused;
+    while (td->m_gridPtr->AdvanceTileDriver(*td, didWork, paused))
     {
-      switch (td->GetState())
+      if (paused)
       {
-      case TileDriver::EXIT_REQUEST:
-        running = false;
-        break;
+        // Wait to be woken by a state change
+        td->m_gridPtr->WaitWhilePaused(*td, PAUSED_WAIT_USEC);
+        continue;
+      }
+
+      if (td->m_asleep)
+      {
+        // Park until woken, or it's time to credit more events
+        td->m_gridPtr->WaitWhileQuiescent(*td, QUIESCENT_CREDIT_USEC);
+        continue;
+      }
+
+      if (!didWork)
+      {
+        // We accomplished nothing.  Let somebody else try
+        sched_yield();
+      }
+      else if (td->m_gridPtr->IsActivityYield(*td))
+      {
+        // Leave the cpu to busier tiles
+        sched_yield();
+      }
+    }
+    MFM_LOG_DBG4(("Tile %s thread exiting", ctile.GetLabel()));
+    return NULL;
+  }
+
+  template <class GC>
+  void* Grid<GC>::TileWorkerRunner(void * arg)
+  {
+    TileWorker * tw = (TileWorker*) arg;
+    Grid & grid = *tw->m_gridPtr;
+
+    MFM_LOG_DBG4(("TileWorker %d init", tw->m_index));
+
+    u32 idleTurns = 0;    // Consecutive turns without useful work
+    u32 pausedTurns = 0;  // Consecutive turns on paused tiles
+
+    while (grid.m_tilePoolLiveTiles > 0)
+    {
+      TileDriver * td;
+      if (!tw->PopFront(td))
+      {
+        td = 0;
+      }
 
-      case TileDriver::ADVANCING:
+      // If our whole deque came up idle (or empty), try to steal
+      if (!td || idleTurns > tw->GetCount())
       {
-        // Drive this tile's transceivers
-        timespec now;
-        clock_gettime(CLOCK_MONOTONIC, &now);
-        for (u32 c = 0; c < 4; ++c)
+        TileDriver * stolen = 0;
+        u32 mine = tw->GetCount() + (td ? 1 : 0);
+        u32 start = tw->m_random.Create(grid.m_tileWorkerCount);
+        for (u32 i = 0; i < grid.m_tileWorkerCount; ++i)
         {
-	  if(td->m_channels[c].IsEnabled()) //esa
-	    td->m_channels[c].AdvanceToTime(now);
+          TileWorker & victim = grid.m_tileWorkers[(start + i) % grid.m_tileWorkerCount];
+          if (&victim != tw && victim.StealFrom(stolen, mine))
+          {
+            break;
+          }
         }
-
-        // Drive the tile itself
-        if (!ctile.Advance())
+        if (stolen)
         {
-          // We accomplished nothing.  Let somebody else try
+          if (td)
+          {
+            tw->PushBack(td);
+          }
+          td = stolen;
+        }
+        else if (td)
+        {
+          // Neither our tiles nor stealing produced anything
           sched_yield();
         }
-        pauseUsec = 0;
-        break;
+        idleTurns = 0;
       }
 
-      case TileDriver::PAUSED:
-        // Sleep a little
-        if (pauseUsec < 100000)
-          pauseUsec += ctile.GetRandom().Between(10,100);
-        SleepUsec(pauseUsec);
-        break;
+      if (!td)
+      {
+        sched_yield();
+        continue;
+      }
 
-      default:
-        FAIL(ILLEGAL_STATE);
+      Tile<EC> & ctile = td->GetTile();
+
+      // Point the error stack at the tile we're about to run
+      MFMPtrToErrEnvStackPtr = ctile.GetErrorEnvironmentStackTop();
+
+      bool live = true, turnWork = false, paused = false;
+      const u32 advances = grid.GetTilePoolAdvances(*td);
+      for (u32 n = 0; n < advances; ++n)
+      {
+        bool didWork;
+        live = grid.AdvanceTileDriver(*td, didWork, paused);
+        if (live && didWork)
+        {
+          turnWork = true;
+        }
+        if (!live || paused || !didWork)
+        {
+          break;
+        }
       }
+
+      if (!live)
+      {
+        // Retire this tile
+        MFM_LOG_DBG4(("Tile %s retired by TileWorker %d", ctile.GetLabel(), tw->m_index));
+        __sync_fetch_and_sub(&grid.m_tilePoolLiveTiles, 1);
+        continue;
+      }
+
+      tw->PushBack(td);
+
+      if (paused)
+      {
+        // Only wait once every tile we hold has come up paused
+        // (with no TileJob to run).  Drivers change state all
+        // together, so waiting on this one is as good as waiting on
+        // all of them.
+        if (turnWork)
+        {
+          pausedTurns = 0;
+        }
+        else if (++pausedTurns > tw->GetCount())
+        {
+          grid.WaitWhilePaused(*td, PAUSED_WAIT_USEC);
+          pausedTurns = 0;
+        }
+        continue;
+      }
+
+      pausedTurns = 0;
+      if (turnWork)
+        idleTurns = 0;
+      else
+        ++idleTurns;
     }
-    MFM_LOG_DBG4(("Tile %s thread exiting", ctile.GetLabel()));
+    MFM_LOG_DBG4(("TileWorker %d thread exiting", tw->m_index));
     return NULL;
   }
 
@@ -410,6 +1422,37 @@ namespace MFM {
   }
 
 
+  template <class GC>
+  void Grid<GC>::InitOrderedIterator()
+  {
+    const u32 count = m_width * m_height;
+    MFM_API_ASSERT_STATE(count <= MAX_TILES_SUPPORTED);
+
+    u32 order[MAX_TILES_SUPPORTED];
+    u32 keys[MAX_TILES_SUPPORTED];
+    for (u32 idx = 0; idx < count; ++idx)
+    {
+      const SPoint tpt = IteratorIndexToCoord(idx);
+      u32 key = 0;
+      for (u32 bit = 0; bit < 16; ++bit)
+      {
+        key |= ((tpt.GetX() >> bit) & 1) << (2 * bit);
+        key |= ((tpt.GetY() >> bit) & 1) << (2 * bit + 1);
+      }
+
+      // Insertion sort; this happens once per grid
+      u32 i = idx;
+      for (; i > 0 && keys[i - 1] > key; --i)
+      {
+        keys[i] = keys[i - 1];
+        order[i] = order[i - 1];
+      }
+      keys[i] = key;
+      order[i] = idx;
+    }
+    m_ogi.Reinit(count, order);
+  }
+
   template <class GC>
   void Grid<GC>::SetTileEnabled(const SPoint& tileLoc, bool isEnabled)
   {
@@ -505,7 +1548,7 @@ namespace MFM {
     }
 
     Tile<EC> & owner = GetTile(tileInGrid);
-    Site<AC> & site = owner.GetSite(siteInTile);
+    typename EC::SITE & site = owner.GetSite(siteInTile);
 
     //////// NOTE WE ARE RACING AGAINST THE TILE THREADS HERE!
     //
@@ -526,13 +1569,13 @@ namespace MFM {
       return false;  // ain't no touch
     }
 
-    Tile<EC> & owner = GetTile(tileInGrid);
+    GridTile & owner = GetGridTile(tileInGrid);
 
     MFM_API_ASSERT_ARG(!owner.IsDummyTile());
 
     if (owner.IsActive()) return false;  // Not paused?  Is this how we check?
 
-    if (owner.RegionIn(siteInTile) != owner.REGION_HIDDEN)
+    if (owner.RegionIn(siteInTile) != GridTile::REGION_HIDDEN)
       return false;           // Cache involvment not allowed
 
     EventWindow<EC> & ew = owner.GetEventWindow();
@@ -560,50 +1603,196 @@ namespace MFM {
   {
     //Cache coords are not distinct in terms of the grid (only known by
     //gridpanel); OWNED_ is used here, instead of TILE_ dimensions;
+    SPoint tileInGrid, siteInTile;
+    return MapGridToUncachedTile(siteInGrid, tileInGrid, siteInTile);
+  }
+
+  template <class GC>
+  bool Grid<GC>::MapGridToUncachedTile(const SPoint & siteInGrid, SPoint & tileInGrid, SPoint & siteInTile) const
+  {
     if (siteInGrid.GetX() < 0 || siteInGrid.GetY() < 0)
       return false;
 
-    SPoint offset;
-    if(IsGridRowStaggered(siteInGrid))
-      offset.Set(-OWNED_WIDTH/2,0);
-    const SPoint ownedp(OWNED_WIDTH, OWNED_HEIGHT);
-
-    const SPoint t = siteInGrid + offset;
-    if(t.GetX() < 0 || t.GetX() > (OWNED_WIDTH * (s32) GetWidth()))
+    // One divide per axis, unsigned and -- unless IS_RUNTIME_SIZED --
+    // by a compile-time side, so it's a shift when the owned side is
+    // a power of two, and a multiply by the reciprocal otherwise
+    const u32 ownedWidth = GetOwnedWidth();
+    const u32 ownedHeight = GetOwnedHeight();
+    const u32 y = siteInGrid.GetY();
+    const u32 tileY = y / ownedHeight;
+    if (tileY >= m_height)
       return false;
 
-    SPoint tileCoord = t / ownedp;
-    if(!IsLegalTileIndex(tileCoord))
+    s32 x = siteInGrid.GetX();
+    if (IsGridLayoutStaggered() && (tileY & 1))
+      x -= (s32) (ownedWidth/2);
+    if (x < 0)
+      return false;
+    const u32 tileX = (u32) x / ownedWidth;
+    if (tileX >= m_width || _getTile(tileX, tileY).IsDummyTile())
       return false;
 
-    const Tile<EC>& tile = GetTile(tileCoord);
-    if(tile.IsDummyTile())
+    tileInGrid.Set(tileX, tileY);
+    siteInTile.Set(x - tileX * ownedWidth, y - tileY * ownedHeight);  // get index into just 'owned' sites
+    return true;
+  }
+
+  template <class GC>
+  u32 Grid<GC>::MapGridToTiles(const SPoint * sitesInGrid, u32 count,
+                               SPoint * tilesInGrid, SPoint * sitesInTile) const
+  {
+    MFM_API_ASSERT_NONNULL(sitesInGrid);
+    MFM_API_ASSERT_NONNULL(tilesInGrid);
+    MFM_API_ASSERT_NONNULL(sitesInTile);
+
+    const u32 ownedWidth = GetOwnedWidth();
+    const u32 ownedHeight = GetOwnedHeight();
+    u32 mapped = 0;
+    s32 rowY = -1;              // The row mapped last
+    u32 tileY = 0, siteY = 0;
+    s32 offset = 0;
+    for (u32 i = 0; i < count; ++i)
+    {
+      const SPoint & site = sitesInGrid[i];
+      tilesInGrid[i].Set(-1, -1);
+      if (site.GetX() < 0 || site.GetY() < 0)
+        continue;
+      if (site.GetY() != rowY)
+      {
+        rowY = site.GetY();
+        tileY = (u32) rowY / ownedHeight;
+        siteY = (u32) rowY - tileY * ownedHeight + R;
+        offset = IsGridLayoutStaggered() && (tileY & 1) ? -(s32) (ownedWidth/2) : 0;
+      }
+      const s32 x = site.GetX() + offset;
+      if (tileY >= m_height || x < 0)
+        continue;
+      const u32 tileX = (u32) x / ownedWidth;
+      if (tileX >= m_width || _getTile(tileX, tileY).IsDummyTile())
+        continue;
+      tilesInGrid[i].Set(tileX, tileY);
+      sitesInTile[i].Set(x - tileX * ownedWidth + R, siteY);
+      ++mapped;
+    }
+    return mapped;
+  }
+
+  template <class GC>
+  bool Grid<GC>::AreTileThreadsPaused()
+  {
+    if (!m_threadsInitted)
+    {
       return false;
+    }
+    for (m_rgi.Reset(); m_rgi.HasNext(); )
+    {
+      SPoint tpt = IteratorIndexToCoord(m_rgi.Next());
+      TileDriver & td = _getTileDriver(tpt.GetX(),tpt.GetY());
+      if (td.GetState() != TileDriver::PAUSED)
+      {
+        return false;
+      }
+    }
     return true;
   }
 
   template <class GC>
-  bool Grid<GC>::MapGridToUncachedTile(const SPoint & siteInGrid, SPoint & tileInGrid, SPoint & siteInTile) const
+  void Grid<GC>::RunOnEveryTile(TileJob & job, bool touchesNeighbors)
+  {
+    if (!AreTileThreadsPaused())
+    {
+      // Same rounds as the threads would run, so neighborly jobs
+      // whose results depend on order come out the same either way
+      const u32 phases = touchesNeighbors ? TILE_JOB_NEIGHBORLY_PHASES : 1;
+      for (u32 phase = 0; phase < phases; ++phase)
+      {
+        for (iterator_type i = begin(); i != end(); ++i)
+        {
+          if (!touchesNeighbors || GetTileJobPhase(i.At()) == phase)
+            job.RunOnTile(*this, i.At());
+        }
+      }
+      return;
+    }
+
+    u32 tiles = 0;
+    for (m_rgi.Reset(); m_rgi.HasNext(); m_rgi.Next())
+    {
+      ++tiles;
+    }
+
+    const u32 phases = touchesNeighbors ? TILE_JOB_NEIGHBORLY_PHASES : 1;
+    for (u32 phase = 0; phase < phases; ++phase)
+    {
+      pthread_mutex_lock(&m_driverLock);
+      m_tileJob = &job;
+      m_tileJobPhase = touchesNeighbors ? phase : (u32) TILE_JOB_NEIGHBORLY_PHASES;
+      m_tileJobsPending = tiles;
+      ++m_tileJobGeneration;
+      pthread_cond_broadcast(&m_driverWake);
+
+      // Every tile thread checks in, whether or not it's in this phase
+      while (m_tileJobsPending > 0)
+      {
+        timespec deadline = GridDeadlineAfterUsec(PAUSED_WAIT_USEC);
+        pthread_cond_timedwait(&m_tileStateChanged, &m_driverLock, &deadline);
+      }
+      m_tileJob = 0;
+      pthread_mutex_unlock(&m_driverLock);
+    }
+  }
+
+  template <class GC>
+  bool Grid<GC>::RunPendingTileJob(TileDriver & td)
   {
-    if(!IsGridCoord(siteInGrid))
+    pthread_mutex_lock(&m_driverLock);
+    const u32 generation = m_tileJobGeneration;
+    TileJob * job = m_tileJob;
+    const u32 phase = m_tileJobPhase;
+    pthread_mutex_unlock(&m_driverLock);
+
+    if (td.m_tileJobGeneration == generation || !job)
+    {
       return false;
+    }
 
-    SPoint offset;
-    if(IsGridRowStaggered(siteInGrid))
-      offset.Set(-OWNED_WIDTH/2,0);
-    const SPoint ownedp(OWNED_WIDTH, OWNED_HEIGHT);
+    if (phase == TILE_JOB_NEIGHBORLY_PHASES || phase == GetTileJobPhase(td.m_loc))
+    {
+      job->RunOnTile(*this, td.m_loc);
+    }
 
-    // Set up return values
-    tileInGrid = (siteInGrid + offset)/ownedp;;
-    siteInTile = (siteInGrid + offset) % ownedp;  // get index into just 'owned' sites
+    pthread_mutex_lock(&m_driverLock);
+    td.m_tileJobGeneration = generation;
+    if (--m_tileJobsPending == 0)
+    {
+      pthread_cond_broadcast(&m_tileStateChanged);
+    }
+    pthread_mutex_unlock(&m_driverLock);
     return true;
   }
 
+  template <class GC>
+  struct Grid<GC>::RecountAtomsTileJob : public Grid<GC>::TileJob
+  {
+    bool m_holdingTiles;  // Else the tile threads will recount
+
+    virtual void RunOnTile(Grid & grid, const SPoint & tileInGrid)
+    {
+      Tile<EC> & tile = grid.GetTile(tileInGrid);
+      tile.NeedAtomRecount();
+      if (m_holdingTiles)
+      {
+        tile.RecountAtomsIfNeeded();
+      }
+    }
+  };
+
   template <class GC>
   void Grid<GC>::RecountAtoms()
   {
-    for (iterator_type i = begin(); i != end(); ++i)
-      i->NeedAtomRecount();
+    RecountAtomsTileJob job;
+    job.m_holdingTiles = !m_threadsInitted || AreTileThreadsPaused();
+    RunOnEveryTile(job, false);
   }
 
   template <class GC>
@@ -636,7 +1825,15 @@ namespace MFM {
     MFM_API_ASSERT_ARG(!owner.IsDummyTile());
 
     owner.PlaceAtomInSite(placeInBase, atom, siteInTile, checkOnly);
+    WakeQuiescentTile(_getTileDriver(tileInGrid.GetX(), tileInGrid.GetY()));
+    PlaceAtomInSharingTiles(owner, tileInGrid, placeInBase, atom, siteInTile, checkOnly);
+  }
 
+  template <class GC>
+  void Grid<GC>::PlaceAtomInSharingTiles(Tile<EC> & owner, const SPoint & tileInGrid,
+                                         bool placeInBase, const T& atom,
+                                         const SPoint & siteInTile, bool checkOnly)
+  {
     THREEDIR connectedDirs;
     u32 dircount = owner.SharedAt(siteInTile, connectedDirs, YESCHKCONNECT);
 
@@ -654,16 +1851,116 @@ namespace MFM {
 
       if (other.IsDummyTile()) continue;  // edge of grid
 
-      // siteInTile is in tileInGrid's shared region, indexed with
-      // including-cache coords.  Offsetting by the owned size
-      // (excluding caches) maps into including-cache coords on their
-      // side.  Hmm.
-      SPoint siteOffset;
-      Dirs::FillDir(siteOffset,dir, isStaggered);
-      const SPoint ownedph(OWNED_WIDTH/2, OWNED_HEIGHT/2);
-      SPoint otherIndex = siteInTile - siteOffset * ownedph;
+      // siteInTile is in tileInGrid's shared region, indexed with
+      // including-cache coords.  Offsetting by the owned size
+      // (excluding caches) maps into including-cache coords on their
+      // side.  Hmm.
+      SPoint siteOffset;
+      Dirs::FillDir(siteOffset,dir, isStaggered);
+      const SPoint ownedph(GetOwnedWidth()/2, GetOwnedHeight()/2);
+      SPoint otherIndex = siteInTile - siteOffset * ownedph;
+
+      other.PlaceAtomInSite(placeInBase, atom, otherIndex, checkOnly);
+      WakeQuiescentTile(_getTileDriver(otherTileIndex.GetX(), otherTileIndex.GetY()));
+    }
+  }
+
+  template <class GC>
+  u32 Grid<GC>::PlaceAtomsInRect(bool placeInBase, const T& atom, const Rect& rectInGrid)
+  {
+    const s32 top = MAX(rectInGrid.GetY(), 0);
+    const s32 bottom = MIN(rectInGrid.GetY() + (s32) rectInGrid.GetHeight(), (s32) GetHeightSites());
+    u32 placed = 0;
+    for (s32 y = top; y < bottom; ++y)
+    {
+      placed += PlaceAtomsInRow(placeInBase, &atom, 0,
+                                SPoint(rectInGrid.GetX(), y), rectInGrid.GetWidth());
+    }
+    return placed;
+  }
+
+  template <class GC>
+  u32 Grid<GC>::PlaceAtomsInRow(bool placeInBase, const T * atoms, u32 atomStride,
+                                const SPoint & start, u32 length)
+  {
+    MFM_API_ASSERT_NONNULL(atoms);
+    const s32 y = start.GetY();
+    if (y < 0 || y >= (s32) GetHeightSites())
+    {
+      return 0;
+    }
+    const s32 left = MAX(start.GetX(), 0);
+    const s32 right = MIN(start.GetX() + (s32) length, (s32) GetWidthSites());
+
+    // Owned sites this close to a tile edge are in some neighbor's cache
+    const s32 SHARED = 2 * R;
+    const s32 ownedWidth = (s32) GetOwnedWidth();
+    const s32 ownedHeight = (s32) GetOwnedHeight();
+    const s32 offset = IsGridRowStaggered(SPoint(0, y)) ? -ownedWidth/2 : 0;
+    const s32 tileY = y / ownedHeight;
+    const s32 siteY = y % ownedHeight + R;
+    const bool rowShared = siteY < SHARED || siteY >= (s32) GetTileHeight() - SHARED;
+
+    // One run per tile the row crosses
+    u32 placed = 0;
+    for (s32 x = left; x < right; )
+    {
+      const s32 t = x + offset;
+      const s32 runEnd = MIN(right, t < 0 ? -offset : (t / ownedWidth + 1) * ownedWidth - offset);
+      if (!IsGridCoord(SPoint(x, y)))  // A staggered grid's gap
+      {
+        x = runEnd;
+        continue;
+      }
+
+      const SPoint tileInGrid(t / ownedWidth, tileY);
+      Tile<EC> & owner = GetTile(tileInGrid);
+      MFM_API_ASSERT_ARG(!owner.IsDummyTile());
+
+      for (s32 siteX = t % ownedWidth + R; x < runEnd; ++x, ++siteX)
+      {
+        const T & atom = atoms[(x - start.GetX()) * atomStride];
+        const SPoint siteInTile(siteX, siteY);
+        owner.PlaceAtomInSite(placeInBase, atom, siteInTile);
+        if (rowShared || siteX < SHARED || siteX >= (s32) GetTileWidth() - SHARED)
+          PlaceAtomInSharingTiles(owner, tileInGrid, placeInBase, atom, siteInTile, false);
+        ++placed;
+      }
+      WakeQuiescentTile(_getTileDriver(tileInGrid.GetX(), tileInGrid.GetY()));
+    }
+    return placed;
+  }
+
+  template <class GC>
+  void Grid<GC>::GetSiteTypes(u16 * types)
+  {
+    MFM_API_ASSERT_NONNULL(types);
+    const s32 width = (s32) GetWidthSites();
+    const s32 height = (s32) GetHeightSites();
+    const s32 ownedWidth = (s32) GetOwnedWidth();
+    const s32 ownedHeight = (s32) GetOwnedHeight();
+    for (s32 y = 0; y < height; ++y)
+    {
+      const s32 offset = IsGridRowStaggered(SPoint(0, y)) ? -ownedWidth/2 : 0;
+      const s32 tileY = y / ownedHeight;
+      const s32 siteY = y % ownedHeight + R;
+      for (s32 x = 0; x < width; )
+      {
+        const s32 t = x + offset;
+        const s32 runEnd = MIN(width, t < 0 ? -offset : (t / ownedWidth + 1) * ownedWidth - offset);
+        if (!IsGridCoord(SPoint(x, y)))  // A staggered grid's gap
+        {
+          for (; x < runEnd; ++x)
+            *types++ = T::ATOM_EMPTY_TYPE;
+          continue;
+        }
 
-      other.PlaceAtomInSite(placeInBase, atom, otherIndex, checkOnly);
+        const Tile<EC> & owner = GetTile(SPoint(t / ownedWidth, tileY));
+        u32 length;
+        const typename EC::SITE * sites = owner.GetSiteSpan(siteY - R, false, length);
+        for (s32 siteX = t % ownedWidth; x < runEnd; ++x, ++siteX)
+          *types++ = (u16) sites[siteX].GetAtom().GetType();
+      }
     }
   }
 
@@ -705,6 +2002,39 @@ namespace MFM {
     LOG.Log(level," Last event tile: (%d, %d)", m_lastEventTile.GetX(), m_lastEventTile.GetY());
     LOG.Log(level," Background radiation: %s", m_backgroundRadiationEnabled?"true":"false");
     LOG.Log(level," Xray odds: %d", m_xraySiteOdds);
+    {
+      u64 attempts, contended;
+      GetIntertileLockCounts(attempts, contended);
+      LOG.Log(level," Intertile locks: %d attempts, %d contended",
+              (u32) attempts, (u32) contended);
+    }
+    {
+      u64 packets, bytes;
+      GetCacheShippedCounts(packets, bytes);
+      LOG.Log(level," Cache updates: %d packets, %d bytes",
+              (u32) packets, (u32) bytes);
+    }
+    for (u32 d = Dirs::NORTH; d <= Dirs::NORTHWEST; ++d)
+    {
+      u64 atoms, bytes, clean, failed;
+      GetCacheCheckCounts((Dir) d, atoms, bytes, clean, failed);
+      if (clean + failed == 0)
+        continue;
+      LOG.Log(level," Cache checks %s: %d atoms, %d bytes; %d clean, %d failed replies",
+              Dirs::GetName((Dir) d), (u32) atoms, (u32) bytes, (u32) clean, (u32) failed);
+    }
+    ReportMemory(level);
+    LOG.Log(level," Skipped empty events: %dM",
+            (u32) (GetTotalSkippedEmptyEvents() / 1000000));
+    LOG.Log(level," Skipped inert events: %dM",
+            (u32) (GetTotalInertEvents() / 1000000));
+#ifdef MFM_EVENT_PHASE_TIMING
+    {
+      EventPhaseTimer total;
+      GetEventPhaseTimes(total);
+      total.ReportPhaseTimes(level, " Event phase ");
+    }
+#endif
 
     for (iterator_type i = begin(); i != end(); ++i)
     {
@@ -715,6 +2045,67 @@ namespace MFM {
     }
   }
 
+  template <class GC>
+  void Grid<GC>::GetIntertileLockCounts(u64 & attempts, u64 & contended) const
+  {
+    attempts = 0;
+    contended = 0;
+    const u32 locks = m_width * m_height * MAX_LOCKS_OWNED_PER_TILE;
+    for (u32 i = 0; i < locks; ++i)
+    {
+      attempts += m_intertileLocks[i].GetLockAttempts();
+      contended += m_intertileLocks[i].GetLockContended();
+    }
+  }
+
+  template <class GC>
+  void Grid<GC>::AccountMemory(MemoryAccount & account) const
+  {
+    const u32 tiles = m_width * m_height;
+    for (u32 i = 0; i < tiles; ++i)
+    {
+      m_tiles[i].AccountMemory(account);
+    }
+    m_heroTile.AccountMemory(account);
+
+    const u32 drivers = tiles * MAX_LOCKS_OWNED_PER_TILE;
+    account.Add(MemoryAccount::TRANSCEIVERS,
+                (u64) drivers * (sizeof(TileDriver) + sizeof(LonglivedLock)));
+
+    account.Add(MemoryAccount::OTHER, sizeof(*this));
+  }
+
+  template <class GC>
+  void Grid<GC>::ReportMemory(Logger::Level level) const
+  {
+    MemoryAccount account;
+    AccountMemory(account);
+    account.ReportMemory(level, " Memory ");
+  }
+
+#ifdef MFM_EVENT_PHASE_TIMING
+  template <class GC>
+  void Grid<GC>::GetEventPhaseTimes(EventPhaseTimer & total) const
+  {
+    total.Reset();
+    for(u32 x = 0; x < m_width; x++)
+    {
+      for(u32 y = 0; y < m_height; y++)
+      {
+        if(!IsLegalTileIndex(SPoint(x,y)))
+          continue;
+
+        const Tile<EC> & tile = GetTile(x,y);
+
+        if(tile.IsDummyTile())
+          continue;
+
+        total.Add(tile.GetEventPhaseTimer());
+      }
+    }
+  }
+#endif
+
   template <class GC>
   void Grid<GC>::DoTileDriverControl(TileDriverControl & tc)
   {
@@ -722,9 +2113,9 @@ namespace MFM {
     tc.PreGridControl(*this);
 
     // Ensure everybody is ready for the request
-    for (m_rgi.ShuffleOrReset(m_random); m_rgi.HasNext(); )
+    for (RandomIterator<MAX_TILES_SUPPORTED> & it = StartTileControlLoop(); it.HasNext(); )
     {
-      SPoint i = IteratorIndexToCoord(m_rgi.Next());
+      SPoint i = IteratorIndexToCoord(it.Next());
       MFM_API_ASSERT_STATE(IsLegalTileIndex(i));
 
       u32 x = i.GetX();
@@ -742,9 +2133,9 @@ namespace MFM {
     }
 
     // Issue request to all
-    for (m_rgi.ShuffleOrReset(m_random); m_rgi.HasNext(); )
+    for (RandomIterator<MAX_TILES_SUPPORTED> & it = StartTileControlLoop(); it.HasNext(); )
     {
-      SPoint i = IteratorIndexToCoord(m_rgi.Next());
+      SPoint i = IteratorIndexToCoord(it.Next());
       MFM_API_ASSERT_STATE(IsLegalTileIndex(i));
 
       u32 x = i.GetX();
@@ -752,40 +2143,22 @@ namespace MFM {
       TileDriver & td = _getTileDriver(x,y);
       MFM_API_ASSERT_STATE(!td.GetTile().IsDummyTile());
       tc.MakeRequest(td);
+      WakeQuiescentTile(td);  // A sleeping tile wouldn't see the request
     }
 
-    // Wait until all acknowledge
+    // Wait until all acknowledge, rechecking whenever a tile thread
+    // reports a state change (or every CONTROL_WAIT_USEC regardless)
     u32 loops = 0;
     u32 notReady = 0;
-    s32 sleepTimer = 100000000; // XXX m_random.Between(1000,10000);
-    do
+    while (true)
     {
-      if (++loops >= 1000000)
-      {
-        LOG.Error("%s control looped %d times, but %d still not ready, killing",
-                  tc.GetName(), loops, notReady);
-        ReportGridStatus(Logger::ERROR);
-        LOG.Error("%s control: Sleeping", tc.GetName());
-        SleepUsec(60*1000000);  // 1 minute
-        LOG.Error("%s control: Resetting", tc.GetName());
-        loops = 0;
-      }
-
-      if (--sleepTimer < 0)
-      {
-        SleepUsec(m_random.Between(10,1000));  // 0.01ms..1ms
-        sleepTimer = m_random.Create(10000);
-      }
-      else
-      {
-        sched_yield();
-      }
+      const u32 generation = GetTileStateGeneration();
 
       notReady = 0;
 
-      for (m_rgi.ShuffleOrReset(m_random); m_rgi.HasNext(); )
+      for (RandomIterator<MAX_TILES_SUPPORTED> & it = StartTileControlLoop(); it.HasNext(); )
       {
-        SPoint i = IteratorIndexToCoord(m_rgi.Next());
+        SPoint i = IteratorIndexToCoord(it.Next());
 	MFM_API_ASSERT_STATE(IsLegalTileIndex(i));
 
         u32 x = i.GetX();
@@ -796,11 +2169,27 @@ namespace MFM {
         if (!tc.CheckIfReady(td))
         {
           ++notReady;
-          sched_yield();
         }
       }
 
-    } while (notReady > 0);
+      if (notReady == 0)
+      {
+        break;
+      }
+
+      if (++loops >= CONTROL_STUCK_LOOPS)
+      {
+        LOG.Error("%s control waited %d times, but %d still not ready, killing",
+                  tc.GetName(), loops, notReady);
+        ReportGridStatus(Logger::ERROR);
+        LOG.Error("%s control: Sleeping", tc.GetName());
+        SleepUsec(60*1000000);  // 1 minute
+        LOG.Error("%s control: Resetting", tc.GetName());
+        loops = 0;
+      }
+
+      WaitForTileStateChange(generation, CONTROL_WAIT_USEC);
+    }
 
     if (loops > 5000)
     {
@@ -809,9 +2198,9 @@ namespace MFM {
     }
 
     // Release the hounds
-    for (m_rgi.ShuffleOrReset(m_random); m_rgi.HasNext(); )
+    for (RandomIterator<MAX_TILES_SUPPORTED> & it = StartTileControlLoop(); it.HasNext(); )
     {
-      SPoint i = IteratorIndexToCoord(m_rgi.Next());
+      SPoint i = IteratorIndexToCoord(it.Next());
       MFM_API_ASSERT_STATE(IsLegalTileIndex(i));
 
       u32 x = i.GetX();
@@ -852,6 +2241,87 @@ namespace MFM {
     return total;
   }
 
+  template <class GC>
+  u64 Grid<GC>::GetTotalSkippedEmptyEvents() const
+  {
+    u64 total = 0;
+    for (const_iterator_type i = begin(); i != end(); ++i)
+      total += i->GetSkippedEmptyEvents();
+
+    return total;
+  }
+
+  template <class GC>
+  u64 Grid<GC>::GetTotalQuiescentEvents() const
+  {
+    u64 total = 0;
+    for (const_iterator_type i = begin(); i != end(); ++i)
+      total += i->GetQuiescentEvents();
+
+    return total;
+  }
+
+  template <class GC>
+  u64 Grid<GC>::GetTotalInertEvents() const
+  {
+    u64 total = 0;
+    for (const_iterator_type i = begin(); i != end(); ++i)
+      total += i->GetInertEvents();
+
+    return total;
+  }
+
+  template <class GC>
+  void Grid<GC>::PublishTileStats(const SPoint & tileInGrid)
+  {
+    Tile<EC> & tile = GetTile(tileInGrid);
+    u64 values[TileStatsTree::STANDARD_COUNTERS + ElementTable<EC>::SIZE];
+    values[TileStatsTree::EVENTS] = tile.GetEventsExecuted();
+    values[TileStatsTree::SITES_ACCESSED] = tile.GetSitesAccessed();
+    values[TileStatsTree::SKIPPED_EMPTY_EVENTS] = tile.GetSkippedEmptyEvents();
+    values[TileStatsTree::QUIESCENT_EVENTS] = tile.GetQuiescentEvents();
+    values[TileStatsTree::INERT_EVENTS] = tile.GetInertEvents();
+    values[TileStatsTree::ADVANCES] = tile.GetAdvanceCount();
+    values[TileStatsTree::IDLE_ADVANCES] = tile.GetIdleAdvanceCount();
+    tile.GetLockFailureCounts(values[TileStatsTree::LOCK_FAILURES],
+                              values[TileStatsTree::LOCK_SPIN_WINS]);
+    tile.GetCacheShippedCounts(values[TileStatsTree::CACHE_PACKETS_SHIPPED],
+                               values[TileStatsTree::CACHE_BYTES_SHIPPED]);
+
+    // Atom counts go by element table index, which all tiles share
+    const ElementTable<EC> & et = tile.GetElementTable();
+    u64 * atoms = &values[TileStatsTree::STANDARD_COUNTERS];
+    for (u32 i = 0; i < ElementTable<EC>::SIZE; ++i)
+    {
+      const Element<EC> * elt = i < et.GetSize() ? et.GetElementAtIndex(i) : 0;
+      atoms[i] = elt ? tile.GetAtomCount(elt->GetType()) : 0;
+    }
+
+    m_tileStats.Publish(GetTileStatsLeaf(tileInGrid), values);
+    _getTileDriver(tileInGrid.GetX(), tileInGrid.GetY()).m_statsAdvances = 0;
+  }
+
+  template <class GC>
+  u32 Grid<GC>::GetPublishedAtomCount(ElementType atomType) const
+  {
+    const s32 idx = Get00Tile().GetElementTable().GetIndex(atomType);
+    if (idx < 0)
+    {
+      return 0;
+    }
+    return (u32) m_tileStats.GetTotal(TileStatsTree::STANDARD_COUNTERS + idx);
+  }
+
+  template <class GC>
+  void Grid<GC>::PublishAllTileStats()
+  {
+    MFM_API_ASSERT_STATE(!m_threadsInitted);
+    for (iterator_type i = begin(); i != end(); ++i)
+    {
+      PublishTileStats(i.At());
+    }
+  }
+
   template <class GC>
   void Grid<GC>::WriteEPSImage(ByteSink & outstrm) const
   {
@@ -881,8 +2351,8 @@ namespace MFM {
   void Grid<GC>::WriteEPSAverageImage(ByteSink & outstrm) const
   {
     u64 max = 1; //avoid division by zero
-    const u32 swidth = OWNED_WIDTH;
-    const u32 sheight = OWNED_HEIGHT;
+    const u32 swidth = GetOwnedWidth();
+    const u32 sheight = GetOwnedHeight();
     const u32 tileCt = GetHeight() * GetWidth();
 
     for(u32 pass = 0; pass < 2; pass++)
@@ -922,6 +2392,97 @@ namespace MFM {
     }
   }
 
+  template <class GC>
+  u32 Grid<GC>::GetEventBinsWide() const
+  {
+    return GetWidth() * ((GetOwnedWidth() + Tile<EC>::EVENT_BIN_SIDE - 1) >> Tile<EC>::EVENT_BIN_SHIFT);
+  }
+
+  template <class GC>
+  u32 Grid<GC>::GetEventBinsHigh() const
+  {
+    return GetHeight() * ((GetOwnedHeight() + Tile<EC>::EVENT_BIN_SIDE - 1) >> Tile<EC>::EVENT_BIN_SHIFT);
+  }
+
+  template <class GC>
+  u64 Grid<GC>::GetEventBinEvents(u32 binX, u32 binY) const
+  {
+    MFM_API_ASSERT_ARG(binX < GetEventBinsWide() && binY < GetEventBinsHigh());
+    const u32 tileBinsWide = GetEventBinsWide() / GetWidth();
+    const u32 tileBinsHigh = GetEventBinsHigh() / GetHeight();
+    const SPoint tileInGrid(binX / tileBinsWide, binY / tileBinsHigh);
+    if (!IsLegalTileIndex(tileInGrid)) return 0;
+    const Tile<EC> & tile = GetTile(tileInGrid);
+    if (tile.IsDummyTile()) return 0;
+    return tile.GetEventBinEvents((binY % tileBinsHigh) * tileBinsWide + binX % tileBinsWide);
+  }
+
+  template <class GC>
+  void Grid<GC>::WriteEventBinsRecord(ByteSink & outstrm, u32 aeps) const
+  {
+    const u32 binsWide = GetEventBinsWide();
+    const u32 binsHigh = GetEventBinsHigh();
+    outstrm.Print(aeps, Format::BEU32);
+    outstrm.Print(binsWide, Format::BEU16);
+    outstrm.Print(binsHigh, Format::BEU16);
+    outstrm.Print((u32) Tile<EC>::EVENT_BIN_SIDE, Format::BEU16);
+    for (u32 y = 0; y < binsHigh; ++y)
+    {
+      for (u32 x = 0; x < binsWide; ++x)
+      {
+        const u64 events = GetEventBinEvents(x, y);
+        outstrm.Print((u32) MIN(events, (u64) U32_MAX), Format::BEU32);
+      }
+    }
+  }
+
+  template <class GC>
+  void Grid<GC>::ResetEPSCounts()
+  {
+    for (iterator_type i = begin(); i != end(); ++i)
+      i->ResetEventBins();
+  }
+
+  template <class GC>
+  void Grid<GC>::WriteTileStatsHeader(ByteSink & outstrm)
+  {
+    outstrm.Printf("aeps,tileX,tileY,events,advances,idleAdvances,lockFailures,lockSpinWins\n");
+  }
+
+  template <class GC>
+  void Grid<GC>::WriteTileStatsRecord(ByteSink & outstrm, u32 aeps)
+  {
+    for (u32 y = 0; y < m_height; ++y)
+    {
+      for (u32 x = 0; x < m_width; ++x)
+      {
+        TileDriver & td = _getTileDriver(x, y);
+        const Tile<EC> & tile = GetTile(x, y);
+        if (tile.IsDummyTile()) continue;
+
+        typename TileDriver::StatsMark now;
+        now.m_events = tile.GetEventsExecuted();
+        now.m_advances = tile.GetAdvanceCount();
+        now.m_idleAdvances = tile.GetIdleAdvanceCount();
+        tile.GetLockFailureCounts(now.m_lockFailures, now.m_lockSpinWins);
+
+        const typename TileDriver::StatsMark & was = td.m_statsMark;
+        outstrm.Printf("%d,%d,%d,", aeps, x, y);
+        outstrm.Print(now.m_events - was.m_events);
+        outstrm.WriteByte(',');
+        outstrm.Print(now.m_advances - was.m_advances);
+        outstrm.WriteByte(',');
+        outstrm.Print(now.m_idleAdvances - was.m_idleAdvances);
+        outstrm.WriteByte(',');
+        outstrm.Print(now.m_lockFailures - was.m_lockFailures);
+        outstrm.WriteByte(',');
+        outstrm.Print(now.m_lockSpinWins - was.m_lockSpinWins);
+        outstrm.Println();
+        td.m_statsMark = now;
+      }
+    }
+  }
+
   template <class GC>
   u32 Grid<GC>::GetAtomCount(ElementType atomType) const
   {
@@ -932,6 +2493,20 @@ namespace MFM {
     return total;
   }
 
+  template <class GC>
+  u64 Grid<GC>::GetElementDataTotal(u32 elementType, u32 slot, u32 slots)
+  {
+    MFM_API_ASSERT_ARG(slot < slots);
+    u64 total = 0;
+    for (iterator_type i = begin(); i != end(); ++i)
+    {
+      const u64 * datap = i->GetElementTable().GetDataIfRegistered(elementType, slots);
+      if (datap)
+        total += datap[slot];
+    }
+    return total;
+  }
+
   template <class GC>
   s32 Grid<GC>::GetAtomCountFromSymbol(const u8 * symbol) const
   {
@@ -940,80 +2515,233 @@ namespace MFM {
     return (s32) this->GetAtomCount(elt->GetType());
   }
 
+  /**
+     Empty every owned site of a tile within m_radius of m_center
+     (grid coordinates), and its copies in neighbors' caches
+   */
+  template <class GC>
+  struct Grid<GC>::NukeTileJob : public Grid<GC>::TileJob
+  {
+    SPoint m_center;
+    u32 m_radius;
+
+    virtual void RunOnTile(Grid & grid, const SPoint & tileInGrid)
+    {
+      const SPoint origin = grid.MapUncachedTileToGrid(tileInGrid, SPoint(0, 0));
+      const s32 r = (s32) m_radius;
+      if (origin.GetX() >= m_center.GetX() + r ||
+          origin.GetX() + (s32) grid.GetOwnedWidth() <= m_center.GetX() - r ||
+          origin.GetY() >= m_center.GetY() + r ||
+          origin.GetY() + (s32) grid.GetOwnedHeight() <= m_center.GetY() - r)
+      {
+        return;  // Nowhere near
+      }
+
+      T atom(Element_Empty<EC>::THE_INSTANCE.GetDefaultAtom());
+      for (u32 y = 0; y < grid.GetOwnedHeight(); ++y)
+      {
+        for (u32 x = 0; x < grid.GetOwnedWidth(); ++x)
+        {
+          SPoint siteInGrid = grid.MapUncachedTileToGrid(tileInGrid, SPoint(x, y));
+          if (DISTANCE(siteInGrid.GetX(), siteInGrid.GetY(),
+                       m_center.GetX(), m_center.GetY()) < m_radius)
+          {
+            grid.PlaceAtom(atom, siteInGrid);
+          }
+        }
+      }
+    }
+  };
+
   template <class GC>
   void Grid<GC>::RandomNuke()
   {
     Random& rand = m_random;
 
-    u32 gw = m_width * TILE_WIDTH;
-    u32 gh = m_height * TILE_HEIGHT;
-    SPoint center(rand.Create(gw), rand.Create(gh));
+    u32 gw = m_width * GetTileWidth();
+    u32 gh = m_height * GetTileHeight();
 
-    u32 radius = rand.Between(5, MIN(gw,gh)/3); //up to a third of smaller grid dim
-    T atom(Element_Empty<EC>::THE_INSTANCE.GetDefaultAtom());
+    NukeTileJob job;
+    job.m_center = SPoint(rand.Create(gw), rand.Create(gh));
+    job.m_radius = rand.Between(5, MIN(gw,gh)/3); //up to a third of smaller grid dim
+    RunOnEveryTile(job, true);
+  }
 
-    SPoint siteInGrid, tileInGrid, siteInTile;
-    for(s32 x = center.GetX() - radius; x < (s32)(center.GetX() + radius); x++)
+  template <class GC>
+  struct Grid<GC>::ClearTileJob : public Grid<GC>::TileJob
+  {
+    virtual void RunOnTile(Grid & grid, const SPoint & tileInGrid)
     {
-      for(s32 y = center.GetY() - radius; y < (s32)(center.GetY() + radius); y++)
-      {
-	siteInGrid.Set(x, y);
-	if(DISTANCE(x, y, center.GetX(), center.GetY()) < radius)
-	{
-	  if(MapGridToTile(siteInGrid, tileInGrid, siteInTile))
-	  {
-	    PlaceAtom(atom, siteInGrid);
-	  }
-	}
-      }
+      grid.EmptyTile(tileInGrid);
     }
-  }
+  };
 
   template <class GC>
   void Grid<GC>::Clear()
   {
-    for (iterator_type i = begin(); i != end(); ++i)
-      EmptyTile(i.At());
+    ClearTileJob job;
+    RunOnEveryTile(job, false);
   }
 
+  /**
+     Re-place (or with m_checkOnly, check) each owned atom of a tile,
+     which updates (or checks) its copies in the neighbors' caches
+   */
   template <class GC>
-  void Grid<GC>::CheckCaches()
+  struct Grid<GC>::CacheTileJob : public Grid<GC>::TileJob
   {
-    const u32 gridWidth = this->GetWidthSites(); //includes dummy tiles in scattered grid
-    const u32 gridHeight = this->GetHeightSites();
+    bool m_checkOnly;
 
-    for(u32 y = 0; y < gridHeight; y++)
+    virtual void RunOnTile(Grid & grid, const SPoint & tileInGrid)
     {
-      for(u32 x = 0; x < gridWidth; x++)
+      for (u32 y = 0; y < grid.GetOwnedHeight(); ++y)
       {
-        SPoint siteInGrid(x, y);
-	if(this->IsGridCoord(siteInGrid))
-	  {
-	    T atom = *this->GetAtom(siteInGrid);
-	    this->CheckAtom(atom, siteInGrid);  // This checks caches
-	  }
+        for (u32 x = 0; x < grid.GetOwnedWidth(); ++x)
+        {
+          SPoint siteInGrid = grid.MapUncachedTileToGrid(tileInGrid, SPoint(x, y));
+          T atom = *grid.GetAtom(siteInGrid);
+          if (m_checkOnly)
+            grid.CheckAtom(atom, siteInGrid);  // This checks caches
+          else
+            grid.PlaceAtom(atom, siteInGrid);  // This updates caches
+        }
       }
     }
+  };
+
+  template <class GC>
+  void Grid<GC>::CheckCaches()
+  {
+    CacheTileJob job;
+    job.m_checkOnly = true;
+    RunOnEveryTile(job, true);
   } //CheckCaches
 
   template <class GC>
   void Grid<GC>::RefreshAllCaches()
   {
-    const u32 gridWidth = this->GetWidthSites(); //includes dummy tiles in scattered grid
-    const u32 gridHeight = this->GetHeightSites();
+    CacheTileJob job;
+    job.m_checkOnly = false;
+    RunOnEveryTile(job, true);
+  }
+
+  /**
+     Run one deterministic step's events on a tile, then re-place its
+     edge atoms -- the shared ones it owns and the cached ones it may
+     have written -- through the grid, which squares up the owners
+     and every cache holding a copy
+   */
+  template <class GC>
+  struct Grid<GC>::DeterministicTileJob : public Grid<GC>::TileJob
+  {
+    u32 m_seed;
+    u32 m_eventsPerTile;
 
-    for(u32 y = 0; y < gridHeight; y++)
+    virtual void RunOnTile(Grid & grid, const SPoint & tileInGrid)
     {
-      for(u32 x = 0; x < gridWidth; x++)
+      Tile<EC> & tile = grid.GetTile(tileInGrid);
+      const u32 index = (u32) (tileInGrid.GetX() * grid.GetHeight() + tileInGrid.GetY());
+      tile.GetRandom().SetSeed(m_seed ^ (index * 0x9e3779b9u));
+
+      EventWindow<EC> & ew = tile.GetEventWindow();
+      for (u32 i = 0; i < m_eventsPerTile; ++i)
       {
-        SPoint siteInGrid(x, y);
-	if(this->IsGridCoord(siteInGrid))
-	  {
-	    T atom = *this->GetAtom(siteInGrid);
-	    this->PlaceAtom(atom, siteInGrid);  // This updates caches
-	  }
+        ew.TryUnlockedEventAt(tile.GetRandomOwnedCoord());
+      }
+
+      PushEdgeSites(grid, tileInGrid);
+    }
+
+    static void PushEdgeSites(Grid & grid, const SPoint & tileInGrid)
+    {
+      Tile<EC> & tile = grid.GetTile(tileInGrid);
+
+      // Stagger shifts whole tiles, so cache rows line up with the
+      // owned rows of this tile's origin, not their own grid rows
+      const SPoint origin = grid.MapUncachedTileToGrid(tileInGrid, SPoint(0, 0));
+      for (u32 y = 0; y < grid.GetTileHeight(); ++y)
+      {
+        for (u32 x = 0; x < grid.GetTileWidth(); ++x)
+        {
+          const SPoint siteInTile(x, y);
+          const typename Tile<EC>::Region region = tile.RegionIn(siteInTile);
+          if (region != Tile<EC>::REGION_CACHE && region != Tile<EC>::REGION_SHARED)
+          {
+            continue;
+          }
+
+          const SPoint siteInGrid = origin + siteInTile - SPoint(R, R);
+          if (grid.IsGridCoord(siteInGrid))
+          {
+            T atom = *tile.GetAtom(siteInTile);
+            grid.PlaceAtom(atom, siteInGrid);
+          }
+        }
+      }
+    }
+  };
+
+  template <class GC>
+  void Grid<GC>::RunDeterministicStep(u32 eventsPerTile)
+  {
+    if (m_deterministicStep == 0)
+    {
+      RefreshAllCaches();  // Start from caches that match their owners
+    }
+
+    Random stepRandom(m_seed + m_deterministicStep);
+    DeterministicTileJob job;
+    job.m_seed = stepRandom.Create();
+    job.m_eventsPerTile = eventsPerTile;
+    RunOnEveryTile(job, true);
+
+    ++m_deterministicStep;
+  }
+
+  /**
+     Run one sweep step on a tile, then push its edges out like a
+     deterministic step.  Each tile gets its own TileSweeper, since
+     tiles run at once and each has its own element table.
+   */
+  template <class GC>
+  struct Grid<GC>::SweepTileJob : public Grid<GC>::TileJob
+  {
+    u32 m_seed;
+    u32 m_sweepsPerTile;
+
+    virtual void RunOnTile(Grid & grid, const SPoint & tileInGrid)
+    {
+      Tile<EC> & tile = grid.GetTile(tileInGrid);
+      const u32 index = (u32) (tileInGrid.GetX() * grid.GetHeight() + tileInGrid.GetY());
+      const u32 tileSeed = m_seed ^ (index * 0x9e3779b9u);
+      tile.GetRandom().SetSeed(tileSeed);
+
+      TileSweeper<EC> sweeper;
+      sweeper.Prepare(tile);
+      for (u32 i = 0; i < m_sweepsPerTile; ++i)
+      {
+        sweeper.Sweep(tile, tileSeed + i);
       }
+
+      DeterministicTileJob::PushEdgeSites(grid, tileInGrid);
     }
+  };
+
+  template <class GC>
+  void Grid<GC>::RunSweepStep(u32 sweepsPerTile)
+  {
+    if (m_sweepStep == 0)
+    {
+      RefreshAllCaches();  // Start from caches that match their owners
+    }
+
+    Random stepRandom(m_seed + m_sweepStep);
+    SweepTileJob job;
+    job.m_seed = stepRandom.Create();
+    job.m_sweepsPerTile = sweepsPerTile;
+    RunOnEveryTile(job, true);
+
+    ++m_sweepStep;
   }
 
   template <class GC>
@@ -1062,3 +2790,4 @@ namespace MFM {
   }
 
 } /* namespace MFM */
+
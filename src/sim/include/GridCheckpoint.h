@@ -0,0 +1,231 @@
+/*                                              -*- mode:C++ -*-
+  GridCheckpoint.h Incremental grid checkpoints over GridSnapshots
+  Copyright (C) 2014-2016 The Regents of the University of New Mexico.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+  USA
+*/
+
+/**
+  \file GridCheckpoint.h Incremental grid checkpoints over GridSnapshots
+  \date (C) 2014-2016 All rights reserved.
+  \lgpl
+ */
+#ifndef GRIDCHECKPOINT_H
+#define GRIDCHECKPOINT_H
+
+#include "itype.h"
+#include "Grid.h"
+#include "GridSnapshot.h"
+
+namespace MFM
+{
+  /**
+     A GridCheckpoint saves a grid as a chain: a full GridSnapshot
+     (the base), then any number of deltas, each holding only the
+     Tile change blocks whose stamps have moved since the previous
+     link, plus every tile's event counts.  In a mostly static world
+     a delta is a tiny fraction of a snapshot.
+
+     Each delta records the file name of the link before it (in the
+     same directory) and its place in the chain, so Restore, given
+     the last link, walks back to the base, loads it, and replays
+     the deltas in order.
+
+     A block counts as changed if any atom or base atom in it was
+     placed since the last link, or if its tile's change stamp moved
+     -- which happens whenever sites were written some way that
+     doesn't track blocks, such as radiation or a load, and makes the
+     whole tile go out.  As with snapshots, deltas are only for the
+     same build and grid geometry, and the grid should not be running
+     while a link is saved or restored.
+   */
+  template <class GC>
+  class GridCheckpoint
+  {
+    typedef typename GC::EVENT_CONFIG EC;
+    typedef typename EC::ATOM_CONFIG AC;
+    typedef typename AC::ATOM_TYPE T;
+    typedef typename EC::SITE S;
+    typedef GridSnapshot<GC> Snapshot;
+
+  public:
+
+    enum
+    {
+      /** First word of every delta ('MFMD' read little-endian) */
+      DELTA_MAGIC = 0x444d464d,
+
+      /** Bump whenever the layout below changes */
+      DELTA_VERSION = 1,
+
+      /** Longest link file name accepted */
+      MAX_LINK_BYTES = 256,
+
+      /** Longest chain Restore will follow */
+      MAX_CHAIN_LENGTH = 1024
+    };
+
+    GridCheckpoint() ;
+
+    ~GridCheckpoint() ;
+
+    /**
+     * Writes a full snapshot of \a grid to \a path and starts a new
+     * chain from it.
+     *
+     * @returns true on success, false (with a logged error) if the
+     *          snapshot could not be written; then there is no chain.
+     */
+    bool SaveBase(Grid<GC> & grid, const char * path);
+
+    /**
+     * Writes the blocks of \a grid changed since the last link of the
+     * current chain to \a path, as the chain's next link.
+     *
+     * @returns true on success, false (with a logged error) if the
+     *          delta could not be written, in which case the chain is
+     *          ended and the next save must be a base.
+     *
+     * @fails ILLEGAL_STATE if there is no current chain
+     */
+    bool SaveDelta(Grid<GC> & grid, const char * path);
+
+    /** Whether there is a chain for SaveDelta to extend */
+    bool HasChain() const
+    {
+      return m_lastLink[0] != '\0';
+    }
+
+    /** Deltas saved (or restored) since the current chain's base */
+    u32 GetChainLength() const
+    {
+      return m_chainIndex;
+    }
+
+    /** Change blocks written by the last SaveDelta */
+    u32 GetLastBlocksSaved() const
+    {
+      return m_lastBlocksSaved;
+    }
+
+    /** Change blocks in the whole grid */
+    u32 GetBlockCount() const
+    {
+      return m_tileCount * m_blocksPerTile;
+    }
+
+    /**
+     * Replaces the contents of \a grid with the chain ending at
+     * \a path , which may be a delta or a plain GridSnapshot, and
+     * continues that chain, so the next SaveDelta follows on from
+     * \a path .
+     *
+     * @returns true on success.  Returns false (with a logged error)
+     *          if any link is missing, unreadable, from a different
+     *          chain or grid, or out of order.  The grid may then
+     *          hold a partial restore, and there is no chain.
+     */
+    bool Restore(Grid<GC> & grid, const char * path);
+
+  private:
+
+    struct DeltaHeader
+    {
+      u32 m_magic;
+      u32 m_version;
+      u32 m_byteOrder;
+      u32 m_atomBytes;
+      u32 m_tileWidth;
+      u32 m_tileHeight;
+      u32 m_gridWidth;
+      u32 m_gridHeight;
+      u32 m_blockSide;
+      u32 m_tileCount;
+      u32 m_elementCount;
+      u32 m_chainIndex;         // 1 for the delta right after the base
+      u32 m_chainIdLow;         // Same for every link of a chain
+      u32 m_chainIdHigh;
+      u32 m_previousBytes;      // Then the previous link's name, padded
+    };
+
+    /* Followed by m_blockCount block numbers, then each block's
+       event-layer atoms, then its base atoms, both row by row */
+    struct DeltaTileHeader
+    {
+      u32 m_tileX;
+      u32 m_tileY;
+      u64 m_eventsExecuted;
+      u64 m_eventsAttempted;
+      u32 m_blockCount;
+      u32 m_pad;
+    };
+
+    u64 m_chainId;
+    u32 m_chainIndex;
+    char m_lastLink[MAX_LINK_BYTES];  // File name only; "" if no chain
+
+    u32 m_tileCount;            // Slots in the stamp arrays
+    u32 m_blocksPerTile;
+    u32 * m_tileStamps;         // Each tile's change stamp, at the last link
+    u32 * m_blockStamps;        // And each of its blocks' stamps
+    u32 m_lastBlocksSaved;
+
+    u32 TileSlot(Grid<GC> & grid, const SPoint & tileInGrid) const
+    {
+      return (u32) (tileInGrid.GetY() * grid.GetWidth() + tileInGrid.GetX());
+    }
+
+    /** Record every tile's stamps as of now, as the latest link */
+    void Mark(Grid<GC> & grid, const char * path) ;
+
+    void EndChain()
+    {
+      m_lastLink[0] = '\0';
+      m_chainIndex = 0;
+    }
+
+    /**
+     * The sites of change block \a block of \a tile , as a rectangle
+     * in tile coordinates.
+     */
+    static Rect GetBlockRect(const Tile<EC> & tile, u32 block) ;
+
+    static u32 GetBlockSites(const Tile<EC> & tile, u32 block)
+    {
+      const Rect r = GetBlockRect(tile, block);
+      return r.GetWidth() * r.GetHeight();
+    }
+
+    /**
+     * Reads the chain index and previous link name of the delta at
+     * \a path , if it is one.
+     *
+     * @returns false if \a path is not a delta (including if it is
+     *          unreadable)
+     */
+    static bool ReadLink(const char * path, u32 & chainIndex, OString512 & previous) ;
+
+    bool ApplyDelta(Grid<GC> & grid, const char * path, u32 expectedIndex, u64 & chainId) ;
+
+    // Declare away
+    GridCheckpoint(const GridCheckpoint &) ;
+    GridCheckpoint & operator=(const GridCheckpoint &) ;
+  };
+} /* namespace MFM */
+
+#include "GridCheckpoint.tcc"
+
+#endif /* GRIDCHECKPOINT_H */
@@ -0,0 +1,521 @@
+/* -*- C++ -*- */
+#include "Logger.h"
+#include <string.h>     /* For memcpy, strrchr */
+#include <errno.h>
+#include <time.h>       /* For time */
+#include <fcntl.h>      /* For open */
+#include <unistd.h>     /* For close, write, getpid */
+#include <sys/mman.h>   /* For mmap */
+#include <sys/stat.h>   /* For fstat */
+
+namespace MFM
+{
+  template <class GC>
+  GridCheckpoint<GC>::GridCheckpoint()
+    : m_chainId(0)
+    , m_chainIndex(0)
+    , m_tileCount(0)
+    , m_blocksPerTile(0)
+    , m_tileStamps(0)
+    , m_blockStamps(0)
+    , m_lastBlocksSaved(0)
+  {
+    m_lastLink[0] = '\0';
+  }
+
+  template <class GC>
+  GridCheckpoint<GC>::~GridCheckpoint()
+  {
+    delete [] m_tileStamps;
+    delete [] m_blockStamps;
+  }
+
+  template <class GC>
+  Rect GridCheckpoint<GC>::GetBlockRect(const Tile<EC> & tile, u32 block)
+  {
+    const u32 side = Tile<EC>::CHANGE_BLOCK_SIDE;
+    const u32 x = (block % tile.GetChangeBlocksWide()) * side;
+    const u32 y = (block / tile.GetChangeBlocksWide()) * side;
+    return Rect(x, y, MIN(side, tile.TILE_WIDTH - x), MIN(side, tile.TILE_HEIGHT - y));
+  }
+
+  template <class GC>
+  void GridCheckpoint<GC>::Mark(Grid<GC> & grid, const char * path)
+  {
+    const u32 tileCount = grid.GetWidth() * grid.GetHeight();
+    const u32 blocksPerTile = grid.begin()->GetChangeBlockCount();
+    if (tileCount != m_tileCount || blocksPerTile != m_blocksPerTile)
+    {
+      delete [] m_tileStamps;
+      delete [] m_blockStamps;
+      m_tileCount = tileCount;
+      m_blocksPerTile = blocksPerTile;
+      m_tileStamps = new u32[m_tileCount];
+      m_blockStamps = new u32[m_tileCount * m_blocksPerTile];
+    }
+
+    for (typename Grid<GC>::iterator_type i = grid.begin(); i != grid.end(); ++i)
+    {
+      const Tile<EC> & tile = *i;
+      const u32 slot = TileSlot(grid, i.At());
+      m_tileStamps[slot] = tile.GetChangeStamp();
+      for (u32 b = 0; b < m_blocksPerTile; ++b)
+      {
+        m_blockStamps[slot * m_blocksPerTile + b] = tile.GetChangeBlockStamp(b);
+      }
+    }
+
+    const char * name = strrchr(path, '/');
+    name = name ? name + 1 : path;
+    strncpy(m_lastLink, name, MAX_LINK_BYTES - 1);
+    m_lastLink[MAX_LINK_BYTES - 1] = '\0';
+  }
+
+  template <class GC>
+  bool GridCheckpoint<GC>::SaveBase(Grid<GC> & grid, const char * path)
+  {
+    MFM_API_ASSERT_NONNULL(path);
+
+    EndChain();
+    if (!Snapshot::Save(grid, path))
+    {
+      return false;
+    }
+
+    m_chainId = (((u64) time(0)) << 32) ^ (((u64) getpid()) << 16) ^ (m_chainId + 1);
+    Mark(grid, path);
+    return true;
+  }
+
+  template <class GC>
+  bool GridCheckpoint<GC>::SaveDelta(Grid<GC> & grid, const char * path)
+  {
+    MFM_API_ASSERT_NONNULL(path);
+    MFM_API_ASSERT_STATE(HasChain());
+
+    typename Snapshot::FileHeader fh;
+    u8 * table = new u8[Snapshot::GetMaxTableBytes(grid)];
+    u32 tableBytes;
+    if (!Snapshot::BuildPreamble(grid, fh, table, tableBytes))
+    {
+      delete [] table;
+      EndChain();
+      return false;
+    }
+
+    const u32 previousBytes = strlen(m_lastLink);
+    const u32 paddedPrevious = Snapshot::Padded(previousBytes);
+
+    DeltaHeader header;
+    header.m_magic = DELTA_MAGIC;
+    header.m_version = DELTA_VERSION;
+    header.m_byteOrder = Snapshot::SNAPSHOT_BYTE_ORDER;
+    header.m_atomBytes = sizeof(T);
+    header.m_tileWidth = fh.m_tileWidth;
+    header.m_tileHeight = fh.m_tileHeight;
+    header.m_gridWidth = fh.m_gridWidth;
+    header.m_gridHeight = fh.m_gridHeight;
+    header.m_blockSide = Tile<EC>::CHANGE_BLOCK_SIDE;
+    header.m_tileCount = fh.m_tileCount;
+    header.m_elementCount = fh.m_elementCount;
+    header.m_chainIndex = m_chainIndex + 1;
+    header.m_chainIdLow = (u32) m_chainId;
+    header.m_chainIdHigh = (u32) (m_chainId >> 32);
+    header.m_previousBytes = previousBytes;
+
+    /* Header, link name and element table go out as one piece */
+    const u32 preambleBytes = sizeof(header) + paddedPrevious + tableBytes;
+    u8 * preamble = new u8[preambleBytes];
+    memcpy(preamble, &header, sizeof(header));
+    memset(preamble + sizeof(header), 0, paddedPrevious);
+    memcpy(preamble + sizeof(header), m_lastLink, previousBytes);
+    memcpy(preamble + sizeof(header) + paddedPrevious, table, tableBytes);
+    delete [] table;
+
+    s32 fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+      LOG.Error("Can't create delta '%s': %s", path, strerror(errno));
+      delete [] preamble;
+      EndChain();
+      return false;
+    }
+
+    bool ok = write(fd, preamble, preambleBytes) == (ssize_t) preambleBytes;
+    delete [] preamble;
+
+    /* Each tile record is staged whole, at most every block's worth */
+    const u32 blocksPerTile = grid.begin()->GetChangeBlockCount();
+    const u32 tileSites = header.m_tileWidth * header.m_tileHeight;
+    u8 * record = new u8[sizeof(DeltaTileHeader) + blocksPerTile * sizeof(u32) + 2 * tileSites * sizeof(T)];
+    u32 blocksSaved = 0;
+
+    for (typename Grid<GC>::iterator_type i = grid.begin(); ok && i != grid.end(); ++i)
+    {
+      typename Grid<GC>::GridTile & tile = grid.GetGridTile(i.At());
+      const u32 slot = TileSlot(grid, i.At());
+      const bool allChanged = tile.GetChangeStamp() != m_tileStamps[slot];
+
+      u32 * blocks = (u32 *) (record + sizeof(DeltaTileHeader));
+      u32 blockCount = 0;
+      u32 siteCount = 0;
+      for (u32 b = 0; b < blocksPerTile; ++b)
+      {
+        if (allChanged || tile.GetChangeBlockStamp(b) != m_blockStamps[slot * blocksPerTile + b])
+        {
+          blocks[blockCount++] = b;
+          siteCount += GetBlockSites(tile, b);
+        }
+      }
+
+      T * atoms = (T *) (blocks + blockCount);
+      T * bases = atoms + siteCount;
+      for (u32 k = 0; k < blockCount; ++k)
+      {
+        const Rect r = GetBlockRect(tile, blocks[k]);
+        for (s32 y = r.GetY(); y < r.GetY() + (s32) r.GetHeight(); ++y)
+        {
+          for (s32 x = r.GetX(); x < r.GetX() + (s32) r.GetWidth(); ++x)
+          {
+            const S & site = tile.GetSite(SPoint(x, y));
+            *atoms++ = site.GetAtom();
+            *bases++ = site.GetBase().GetBaseAtom();
+          }
+        }
+      }
+
+      DeltaTileHeader th;
+      th.m_tileX = (u32) i.At().GetX();
+      th.m_tileY = (u32) i.At().GetY();
+      th.m_eventsExecuted = tile.GetEventWindow().GetEventWindowsExecuted();
+      th.m_eventsAttempted = tile.GetEventWindow().GetEventWindowsAttempted();
+      th.m_blockCount = blockCount;
+      th.m_pad = 0;
+      memcpy(record, &th, sizeof(th));
+
+      const u32 recordBytes = (u8 *) bases - record;
+      ok = write(fd, record, recordBytes) == (ssize_t) recordBytes;
+      blocksSaved += blockCount;
+    }
+
+    delete [] record;
+
+    if (!ok)
+    {
+      LOG.Error("Can't write delta '%s': %s", path, strerror(errno));
+    }
+
+    if (close(fd) != 0 && ok)
+    {
+      LOG.Error("Can't close delta '%s': %s", path, strerror(errno));
+      ok = false;
+    }
+
+    if (!ok)
+    {
+      EndChain();
+      return false;
+    }
+
+    m_lastBlocksSaved = blocksSaved;
+    ++m_chainIndex;
+    Mark(grid, path);
+    return true;
+  }
+
+  template <class GC>
+  bool GridCheckpoint<GC>::ReadLink(const char * path, u32 & chainIndex, OString512 & previous)
+  {
+    s32 fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+      return false;
+    }
+
+    DeltaHeader header;
+    char name[MAX_LINK_BYTES];
+    bool ok = read(fd, &header, sizeof(header)) == (ssize_t) sizeof(header) &&
+      header.m_magic == DELTA_MAGIC &&
+      header.m_previousBytes < MAX_LINK_BYTES &&
+      read(fd, name, header.m_previousBytes) == (ssize_t) header.m_previousBytes;
+    close(fd);
+
+    if (ok)
+    {
+      name[header.m_previousBytes] = '\0';
+      chainIndex = header.m_chainIndex;
+      previous.Reset();
+      previous.Printf("%s", name);
+    }
+    return ok;
+  }
+
+  template <class GC>
+  bool GridCheckpoint<GC>::ApplyDelta(Grid<GC> & grid, const char * path, u32 expectedIndex, u64 & chainId)
+  {
+    s32 fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+      LOG.Error("Can't open delta '%s': %s", path, strerror(errno));
+      return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (u64) st.st_size < sizeof(DeltaHeader))
+    {
+      LOG.Error("Delta '%s' is truncated", path);
+      close(fd);
+      return false;
+    }
+
+    const u64 fileBytes = (u64) st.st_size;
+    void * mapped = mmap(0, fileBytes, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);  // The mapping holds its own reference
+
+    if (mapped == MAP_FAILED)
+    {
+      LOG.Error("Can't map delta '%s': %s", path, strerror(errno));
+      return false;
+    }
+
+    const u8 * const limit = (const u8 *) mapped + fileBytes;
+    const u8 * at = (const u8 *) mapped;
+
+    DeltaHeader header;
+    memcpy(&header, at, sizeof(header));
+    at += sizeof(header);
+
+    const Tile<EC> & first = *grid.begin();
+    const u64 headerChainId = (((u64) header.m_chainIdHigh) << 32) | header.m_chainIdLow;
+    bool ok = true;
+    if (header.m_magic != DELTA_MAGIC ||
+        header.m_version != DELTA_VERSION ||
+        header.m_byteOrder != Snapshot::SNAPSHOT_BYTE_ORDER)
+    {
+      LOG.Error("'%s' is not a version 0x%08x grid delta", path, DELTA_VERSION);
+      ok = false;
+    }
+    else if (header.m_atomBytes != sizeof(T) ||
+             header.m_tileWidth != first.TILE_WIDTH ||
+             header.m_tileHeight != first.TILE_HEIGHT ||
+             header.m_gridWidth != grid.GetWidth() ||
+             header.m_gridHeight != grid.GetHeight() ||
+             header.m_blockSide != Tile<EC>::CHANGE_BLOCK_SIDE)
+    {
+      LOG.Error("Delta '%s' is for a different grid", path);
+      ok = false;
+    }
+    else if (header.m_chainIndex != expectedIndex ||
+             (expectedIndex > 1 && headerChainId != chainId))
+    {
+      LOG.Error("Delta '%s' is link %d of chain %08x%08x, expected link %d of %08x%08x",
+                path, header.m_chainIndex, header.m_chainIdHigh, header.m_chainIdLow,
+                expectedIndex, (u32) (chainId >> 32), (u32) chainId);
+      ok = false;
+    }
+    chainId = headerChainId;
+
+    const u32 paddedPrevious = Snapshot::Padded(header.m_previousBytes);
+    if (ok && (u64) (limit - at) < paddedPrevious)
+    {
+      LOG.Error("Delta '%s' is truncated", path);
+      ok = false;
+    }
+    at += ok ? paddedPrevious : 0;
+
+    typedef typename Snapshot::TypeMapping TypeMapping;
+    TypeMapping * mappings = new TypeMapping[header.m_elementCount > 0 ? header.m_elementCount : 1];
+    ok = ok && Snapshot::ReadElementTable(grid, at, limit, header.m_elementCount, mappings, path);
+
+    /* Check every tile record fits before touching the grid */
+    const u32 blocksPerTile = first.GetChangeBlockCount();
+    const u8 * const tiles = at;
+    for (u32 t = 0; ok && t < header.m_tileCount; ++t)
+    {
+      DeltaTileHeader th;
+      if ((u64) (limit - at) < sizeof(th))
+      {
+        LOG.Error("Delta '%s' is truncated", path);
+        ok = false;
+        break;
+      }
+      memcpy(&th, at, sizeof(th));
+      at += sizeof(th);
+
+      const SPoint tileInGrid(th.m_tileX, th.m_tileY);
+      if (!grid.IsLegalTileIndex(tileInGrid) || grid.GetTile(tileInGrid).IsDummyTile() ||
+          th.m_blockCount > blocksPerTile ||
+          (u64) (limit - at) < th.m_blockCount * sizeof(u32))
+      {
+        LOG.Error("Delta '%s' has a bad record for tile (%d,%d)", path, th.m_tileX, th.m_tileY);
+        ok = false;
+        break;
+      }
+
+      u64 siteCount = 0;
+      for (u32 k = 0; ok && k < th.m_blockCount; ++k)
+      {
+        u32 block;
+        memcpy(&block, at + k * sizeof(u32), sizeof(block));
+        if (block >= blocksPerTile)
+        {
+          LOG.Error("Delta '%s' has bad block %d in tile (%d,%d)", path, block, th.m_tileX, th.m_tileY);
+          ok = false;
+        }
+        else
+        {
+          siteCount += GetBlockSites(first, block);
+        }
+      }
+      at += th.m_blockCount * sizeof(u32);
+
+      if (ok && (u64) (limit - at) < 2 * siteCount * sizeof(T))
+      {
+        LOG.Error("Delta '%s' is truncated", path);
+        ok = false;
+      }
+      at += ok ? 2 * siteCount * sizeof(T) : 0;
+    }
+
+    if (ok && at != limit)
+    {
+      LOG.Error("Delta '%s' has trailing bytes", path);
+      ok = false;
+    }
+
+    at = tiles;
+    for (u32 t = 0; ok && t < header.m_tileCount; ++t)
+    {
+      DeltaTileHeader th;
+      memcpy(&th, at, sizeof(th));
+      at += sizeof(th);
+
+      typename Grid<GC>::GridTile & tile = grid.GetGridTile(SPoint(th.m_tileX, th.m_tileY));
+      const u8 * blocks = at;
+      at += th.m_blockCount * sizeof(u32);
+
+      u32 siteCount = 0;
+      for (u32 k = 0; k < th.m_blockCount; ++k)
+      {
+        u32 block;
+        memcpy(&block, blocks + k * sizeof(u32), sizeof(block));
+        siteCount += GetBlockSites(tile, block);
+      }
+
+      /* Padded to 4 bytes throughout, as in a snapshot */
+      const T * atoms = (const T *) at;
+      const T * bases = atoms + siteCount;
+      for (u32 k = 0; k < th.m_blockCount; ++k)
+      {
+        u32 block;
+        memcpy(&block, blocks + k * sizeof(u32), sizeof(block));
+        const Rect r = GetBlockRect(tile, block);
+        for (s32 y = r.GetY(); y < r.GetY() + (s32) r.GetHeight(); ++y)
+        {
+          for (s32 x = r.GetX(); x < r.GetX() + (s32) r.GetWidth(); ++x)
+          {
+            S & site = tile.GetSite(SPoint(x, y));
+
+            T atom = *atoms++;
+            Snapshot::RemapType(atom, mappings, header.m_elementCount);
+            site.GetAtom() = atom;
+
+            T baseAtom = *bases++;
+            Snapshot::RemapType(baseAtom, mappings, header.m_elementCount);
+            if (((const S &) site).GetBase().GetBaseAtom() != baseAtom)
+            {
+              site.GetBase().PutBaseAtom(baseAtom);  // Else leave any Base layer unwritten
+            }
+          }
+        }
+      }
+      at = (const u8 *) bases;
+
+      tile.GetEventWindow().SetEventWindowsExecuted(th.m_eventsExecuted);
+      tile.GetEventWindow().SetEventWindowsAttempted(th.m_eventsAttempted);
+    }
+
+    delete [] mappings;
+    munmap(mapped, fileBytes);
+
+    return ok;
+  }
+
+  template <class GC>
+  bool GridCheckpoint<GC>::Restore(Grid<GC> & grid, const char * path)
+  {
+    MFM_API_ASSERT_NONNULL(path);
+
+    EndChain();
+
+    /* Links name their predecessors relative to path's directory */
+    const char * slash = strrchr(path, '/');
+    const u32 dirBytes = slash ? (u32) (slash - path + 1) : 0;
+
+    /* Walk back from path to the base, remembering each link */
+    OString512 * links = new OString512[MAX_CHAIN_LENGTH + 1];
+    links[0].Printf("%s", path);
+    u32 deltas = 0;
+    bool ok = true;
+    for (u32 chainIndex = 0; ok; )
+    {
+      OString512 previous;
+      if (!ReadLink(links[deltas].GetZString(), chainIndex, previous))
+      {
+        break;  // Not a delta, so it had better be the base
+      }
+
+      if (deltas >= MAX_CHAIN_LENGTH || chainIndex == 0)
+      {
+        LOG.Error("Delta '%s' is in a chain too long to restore", links[deltas].GetZString());
+        ok = false;
+        break;
+      }
+
+      ++deltas;
+      links[deltas].WriteBytes((const u8 *) path, dirBytes);
+      links[deltas].Print(previous.GetZString());
+      if (links[deltas].HasOverflowed())
+      {
+        LOG.Error("Delta '%s' names a predecessor path too long", links[deltas - 1].GetZString());
+        ok = false;
+      }
+      if (chainIndex == 1)
+      {
+        break;  // Its predecessor is the base
+      }
+    }
+
+    /* Then forward from the base */
+    if (ok)
+    {
+      LOG.Message("Restoring '%s' and %d delta(s)", links[deltas].GetZString(), deltas);
+      ok = Snapshot::Load(grid, links[deltas].GetZString());
+    }
+
+    u64 chainId = 0;
+    for (u32 k = 1; ok && k <= deltas; ++k)
+    {
+      ok = ApplyDelta(grid, links[deltas - k].GetZString(), k, chainId);
+    }
+
+    if (ok)
+    {
+      if (deltas > 0)
+      {
+        grid.RefreshAllCaches();
+        grid.RecountAtoms();
+      }
+      else
+      {
+        chainId = (((u64) time(0)) << 32) ^ (((u64) getpid()) << 16) ^ (m_chainId + 1);
+      }
+      m_chainId = chainId;
+      m_chainIndex = deltas;
+      Mark(grid, path);
+    }
+
+    delete [] links;
+    return ok;
+  }
+} /* namespace MFM */
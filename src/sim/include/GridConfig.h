@@ -52,7 +52,8 @@ namespace MFM {
 
     /**
      * TILE_WIDTH is the number of sites wide for a tile in
-     * this GridConfig
+     * this GridConfig.  A 0 x 0 GridConfig is runtime-sized: its
+     * Grid builds DynamicTiles whose size is given to Grid::Grid
      */
     enum { TILE_WIDTH = WIDTH };
 
@@ -70,15 +71,15 @@ namespace MFM {
 
     /**
      * OWNED_WIDTH is the number of sites wide for a tile in
-     * this GridConfig, excluding the caches
+     * this GridConfig, excluding the caches (0 if runtime-sized)
      */
-    enum { OWNED_WIDTH = TILE_WIDTH - 2 * EC::EVENT_WINDOW_RADIUS };
+    enum { OWNED_WIDTH = TILE_WIDTH > 0 ? TILE_WIDTH - 2 * EC::EVENT_WINDOW_RADIUS : 0 };
 
     /**
      * OWNED_HEIGHT is the number of sites high for a tile in
-     * this GridConfig, excluding the caches
+     * this GridConfig, excluding the caches (0 if runtime-sized)
      */
-    enum { OWNED_HEIGHT = TILE_HEIGHT - 2 * EC::EVENT_WINDOW_RADIUS };
+    enum { OWNED_HEIGHT = TILE_HEIGHT > 0 ? TILE_HEIGHT - 2 * EC::EVENT_WINDOW_RADIUS : 0 };
 
 
   };
@@ -0,0 +1,162 @@
+/*                                              -*- mode:C++ -*-
+  GridDiff.h Site-by-site comparison of two states of a grid
+  Copyright (C) 2014-2016 The Regents of the University of New Mexico.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+  USA
+*/
+
+/**
+  \file GridDiff.h Site-by-site comparison of two states of a grid
+  \date (C) 2014-2016 All rights reserved.
+  \lgpl
+ */
+#ifndef GRIDDIFF_H
+#define GRIDDIFF_H
+
+#include "itype.h"
+#include "Grid.h"
+#include "ByteSink.h"
+
+namespace MFM
+{
+  /**
+     A GridDiff compares two states of one grid -- typically two
+     saved runs, or a run and its golden output, loaded one after the
+     other -- without going through text.  Capture copies the owned
+     event-layer atoms of every tile aside as the 'before' state;
+     Compare then checks the grid as it is now, the 'after' state,
+     against that copy.
+
+     Both passes go tile by tile on several threads, comparing and
+     hashing the raw atoms of each row of sites, so even large grids
+     diff in about the time it takes to read them.  The results are
+     the differing sites, per-element-type count deltas, and a 64-bit
+     FNV-1a hash of each tile's atoms in each state, so two runs can
+     also be compared later just by their hashes.
+
+     Base atoms, cache sites, and everything but atoms are ignored.
+     The grid must not be running during either pass.
+   */
+  template <class GC>
+  class GridDiff
+  {
+    typedef typename GC::EVENT_CONFIG EC;
+    typedef typename EC::ATOM_CONFIG AC;
+    typedef typename AC::ATOM_TYPE T;
+    typedef typename EC::SITE S;
+
+  public:
+
+    enum
+    {
+      /** Element types are 16 bits */
+      MAX_TYPES = 1 << 16
+    };
+
+    /** What Compare found in one tile */
+    struct TileReport
+    {
+      u64 m_hashBefore;     // FNV-1a of the captured owned atoms
+      u64 m_hashAfter;      // FNV-1a of the compared owned atoms
+      u32 m_differing;      // Owned sites whose atoms differ
+      SPoint m_firstSite;   // In owned coordinates, if m_differing > 0
+    };
+
+    GridDiff() ;
+
+    ~GridDiff() ;
+
+    /**
+       Copy the owned atoms of every tile of \c grid aside as the
+       'before' state, on up to \c threads threads (0 for one per
+       online processor).
+     */
+    void Capture(Grid<GC> & grid, u32 threads) ;
+
+    /**
+       Compare the owned atoms of \c grid, which must have the shape
+       it had at Capture, with the captured ones, on up to \c threads
+       threads.
+
+       @returns the number of differing sites in the whole grid
+
+       @fails ILLEGAL_STATE if nothing was captured, or the grid has
+              changed shape since
+     */
+    u64 Compare(Grid<GC> & grid, u32 threads) ;
+
+    /** The differing sites found by the last Compare */
+    u64 GetDifferingSites() const
+    {
+      return m_differing;
+    }
+
+    /** What the last Compare found in the tile at \c tileInGrid */
+    const TileReport & GetTileReport(const SPoint & tileInGrid) const ;
+
+    /**
+       How many more atoms of \c type there were after than before, as
+       of the last Compare
+     */
+    s32 GetTypeDelta(u32 type) const
+    {
+      MFM_API_ASSERT_ARG(type < MAX_TYPES);
+      return m_typeDeltas ? m_typeDeltas[type] : 0;
+    }
+
+    /**
+       Print the results of the last Compare: the overall count, the
+       non-zero type deltas, each tile's hashes and differences, and
+       up to \c maxSites differing sites in grid coordinates.
+     */
+    void Print(Grid<GC> & grid, ByteSink & bs, u32 maxSites) const ;
+
+  private:
+    u32 m_width;             // Grid shape at Capture, in tiles
+    u32 m_height;
+    u32 m_tileSites;         // Owned sites per tile
+    T * m_atoms;             // Captured, m_tileSites per tile, row by row
+    TileReport * m_reports;  // One per tile, x fastest
+    s32 * m_typeDeltas;      // MAX_TYPES of them
+    u64 m_differing;
+
+    u32 GetTileIndex(const SPoint & tileInGrid) const
+    {
+      return (u32) (tileInGrid.GetY() * m_width + tileInGrid.GetX());
+    }
+
+    T * GetCapturedAtoms(u32 tileIndex) const
+    {
+      return m_atoms + tileIndex * (u64) m_tileSites;
+    }
+
+    static u64 Hash(u64 hash, const T & atom) ;
+
+    struct TileJob ;
+
+    void RunOnTiles(Grid<GC> & grid, bool capture, u32 threads) ;
+
+    void CountTypeDeltas(Grid<GC> & grid, const SPoint & tileInGrid) ;
+
+    // Declare away
+    GridDiff(const GridDiff &) ;
+    GridDiff & operator=(const GridDiff &) ;
+  };
+} /* namespace MFM */
+
+#include "GridDiff.tcc"
+
+#endif /* GRIDDIFF_H */
@@ -0,0 +1,260 @@
+/* -*- C++ -*- */
+#include <string.h>     /* For memcmp, memset */
+
+namespace MFM
+{
+  template <class GC>
+  GridDiff<GC>::GridDiff()
+    : m_width(0)
+    , m_height(0)
+    , m_tileSites(0)
+    , m_atoms(0)
+    , m_reports(0)
+    , m_typeDeltas(0)
+    , m_differing(0)
+  { }
+
+  template <class GC>
+  GridDiff<GC>::~GridDiff()
+  {
+    delete [] m_atoms;
+    delete [] m_reports;
+    delete [] m_typeDeltas;
+  }
+
+  template <class GC>
+  u64 GridDiff<GC>::Hash(u64 hash, const T & atom)
+  {
+    const u8 * bytes = (const u8 *) &atom;
+    for (u32 i = 0; i < sizeof(T); ++i)
+    {
+      hash ^= bytes[i];
+      hash *= HexU64(0x100, 0x000001b3);  // FNV prime
+    }
+    return hash;
+  }
+
+  /**
+     Capture or compare the owned atoms of one tile, by tile index
+   */
+  template <class GC>
+  struct GridDiff<GC>::TileJob : public Grid<GC>::IndexJob
+  {
+    GridDiff & m_diff;
+    Grid<GC> & m_grid;
+    bool m_capture;
+
+    TileJob(GridDiff & diff, Grid<GC> & grid, bool capture)
+      : m_diff(diff)
+      , m_grid(grid)
+      , m_capture(capture)
+    { }
+
+    virtual void RunOnIndex(u32 index)
+    {
+      const SPoint tileInGrid(index % m_diff.m_width, index / m_diff.m_width);
+      TileReport & report = m_diff.m_reports[index];
+      const u64 basis = HexU64(0xcbf29ce4, 0x84222325);  // FNV offset basis
+      if (m_capture)
+        report.m_hashBefore = basis;
+      report.m_hashAfter = basis;
+      report.m_differing = 0;
+      report.m_firstSite = SPoint(0, 0);
+
+      if (!m_grid.IsLegalTileIndex(tileInGrid))
+        return;
+
+      const Tile<EC> & tile = m_grid.GetTile(tileInGrid);
+      T * saved = m_diff.GetCapturedAtoms(index);
+      u64 hash = basis;
+      for (u32 row = 0; row < tile.GetSiteSpanCount(false); ++row)
+      {
+        u32 length;
+        const S * sites = tile.GetSiteSpan(row, false, length);
+        if (m_capture)
+        {
+          for (u32 x = 0; x < length; ++x)
+          {
+            saved[x] = sites[x].GetAtom();
+            hash = Hash(hash, saved[x]);
+          }
+        }
+        else
+        {
+          for (u32 x = 0; x < length; ++x)
+          {
+            const T & atom = sites[x].GetAtom();
+            hash = Hash(hash, atom);
+            if (memcmp(&atom, &saved[x], sizeof(T)))
+            {
+              if (report.m_differing++ == 0)
+                report.m_firstSite = SPoint(x, row);
+            }
+          }
+        }
+        saved += length;
+      }
+
+      if (m_capture)
+        report.m_hashBefore = hash;
+      else
+        report.m_hashAfter = hash;
+    }
+  };
+
+  template <class GC>
+  void GridDiff<GC>::RunOnTiles(Grid<GC> & grid, bool capture, u32 threads)
+  {
+    TileJob job(*this, grid, capture);
+    Grid<GC>::RunInParallel(job, m_width * m_height, threads);
+  }
+
+  template <class GC>
+  void GridDiff<GC>::Capture(Grid<GC> & grid, u32 threads)
+  {
+    const u32 tileSites = grid.GetOwnedWidth() * grid.GetOwnedHeight();
+    const u32 tiles = grid.GetWidth() * grid.GetHeight();
+    if (!m_atoms || grid.GetWidth() != m_width || grid.GetHeight() != m_height)
+    {
+      delete [] m_atoms;
+      delete [] m_reports;
+      m_atoms = new T[tiles * (u64) tileSites];
+      m_reports = new TileReport[tiles];
+    }
+    m_width = grid.GetWidth();
+    m_height = grid.GetHeight();
+    m_tileSites = tileSites;
+    m_differing = 0;
+    delete [] m_typeDeltas;
+    m_typeDeltas = 0;
+
+    RunOnTiles(grid, true, threads);
+  }
+
+  template <class GC>
+  u64 GridDiff<GC>::Compare(Grid<GC> & grid, u32 threads)
+  {
+    MFM_API_ASSERT_STATE(m_atoms != 0);
+    MFM_API_ASSERT_STATE(grid.GetWidth() == m_width && grid.GetHeight() == m_height);
+
+    RunOnTiles(grid, false, threads);
+
+    if (!m_typeDeltas)
+      m_typeDeltas = new s32[MAX_TYPES];
+    memset(m_typeDeltas, 0, MAX_TYPES * sizeof(m_typeDeltas[0]));
+
+    // Only differing sites move the type counts, so only tiles
+    // holding some need a second look
+    m_differing = 0;
+    for (u32 y = 0; y < m_height; ++y)
+    {
+      for (u32 x = 0; x < m_width; ++x)
+      {
+        const SPoint tileInGrid(x, y);
+        const TileReport & report = m_reports[GetTileIndex(tileInGrid)];
+        if (report.m_differing > 0)
+        {
+          m_differing += report.m_differing;
+          CountTypeDeltas(grid, tileInGrid);
+        }
+      }
+    }
+    return m_differing;
+  }
+
+  template <class GC>
+  void GridDiff<GC>::CountTypeDeltas(Grid<GC> & grid, const SPoint & tileInGrid)
+  {
+    const Tile<EC> & tile = grid.GetTile(tileInGrid);
+    const T * saved = GetCapturedAtoms(GetTileIndex(tileInGrid));
+    for (u32 row = 0; row < tile.GetSiteSpanCount(false); ++row)
+    {
+      u32 length;
+      const S * sites = tile.GetSiteSpan(row, false, length);
+      for (u32 x = 0; x < length; ++x)
+      {
+        const T & atom = sites[x].GetAtom();
+        if (memcmp(&atom, &saved[x], sizeof(T)))
+        {
+          --m_typeDeltas[(u16) saved[x].GetType()];
+          ++m_typeDeltas[(u16) atom.GetType()];
+        }
+      }
+      saved += length;
+    }
+  }
+
+  template <class GC>
+  const typename GridDiff<GC>::TileReport & GridDiff<GC>::GetTileReport(const SPoint & tileInGrid) const
+  {
+    MFM_API_ASSERT_STATE(m_reports != 0);
+    MFM_API_ASSERT_ARG(tileInGrid.GetX() >= 0 && (u32) tileInGrid.GetX() < m_width &&
+                       tileInGrid.GetY() >= 0 && (u32) tileInGrid.GetY() < m_height);
+    return m_reports[GetTileIndex(tileInGrid)];
+  }
+
+  template <class GC>
+  void GridDiff<GC>::Print(Grid<GC> & grid, ByteSink & bs, u32 maxSites) const
+  {
+    MFM_API_ASSERT_STATE(m_typeDeltas != 0);
+
+    bs.Print(m_differing);
+    bs.Printf(" differing sites in %dx%d tiles\n", m_width, m_height);
+
+    for (u32 type = 0; type < MAX_TYPES; ++type)
+    {
+      const s32 delta = m_typeDeltas[type];
+      if (delta == 0)
+        continue;
+      const Element<EC> * elt = grid.LookupElement(type);
+      bs.Printf("type 0x%04x %s %s%d\n", type,
+                elt ? elt->GetAtomicSymbol() : "?", delta > 0 ? "+" : "", delta);
+    }
+
+    for (u32 y = 0; y < m_height; ++y)
+    {
+      for (u32 x = 0; x < m_width; ++x)
+      {
+        const TileReport & report = m_reports[GetTileIndex(SPoint(x, y))];
+        bs.Printf("tile (%d,%d) ", x, y);
+        bs.Print(report.m_hashBefore, Format::HEX, 16, '0');
+        bs.Printf(" ");
+        bs.Print(report.m_hashAfter, Format::HEX, 16, '0');
+        bs.Printf(" %d\n", report.m_differing);
+      }
+    }
+
+    u32 printed = 0;
+    for (u32 y = 0; y < m_height && printed < maxSites; ++y)
+    {
+      for (u32 x = 0; x < m_width && printed < maxSites; ++x)
+      {
+        const SPoint tileInGrid(x, y);
+        if (m_reports[GetTileIndex(tileInGrid)].m_differing == 0)
+          continue;
+
+        const Tile<EC> & tile = grid.GetTile(tileInGrid);
+        const T * saved = GetCapturedAtoms(GetTileIndex(tileInGrid));
+        for (u32 row = 0; row < tile.GetSiteSpanCount(false) && printed < maxSites; ++row)
+        {
+          u32 length;
+          const S * sites = tile.GetSiteSpan(row, false, length);
+          for (u32 sx = 0; sx < length && printed < maxSites; ++sx)
+          {
+            const T & atom = sites[sx].GetAtom();
+            if (!memcmp(&atom, &saved[sx], sizeof(T)))
+              continue;
+            const SPoint siteInGrid = grid.MapUncachedTileToGrid(tileInGrid, SPoint(sx, row));
+            const Element<EC> * before = grid.LookupElement(saved[sx].GetType());
+            const Element<EC> * after = grid.LookupElement(atom.GetType());
+            bs.Printf("site (%d,%d) %s -> %s\n", siteInGrid.GetX(), siteInGrid.GetY(),
+                      before ? before->GetAtomicSymbol() : "?",
+                      after ? after->GetAtomicSymbol() : "?");
+            ++printed;
+          }
+          saved += length;
+        }
+      }
+    }
+  }
+} /* namespace MFM */
@@ -0,0 +1,215 @@
+/*                                              -*- mode:C++ -*-
+  GridEnsemble.h Many small independent simulations in one process
+  Copyright (C) 2014-2016 The Regents of the University of New Mexico.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+  USA
+*/
+
+/**
+  \file GridEnsemble.h Many small independent simulations in one process
+  \date (C) 2014-2016 All rights reserved.
+  \lgpl
+ */
+#ifndef GRIDENSEMBLE_H
+#define GRIDENSEMBLE_H
+
+#include <pthread.h>
+#include "itype.h"
+#include "Grid.h"
+#include "ByteSink.h"
+#include "OverflowableCharBufferByteSink.h"
+
+namespace MFM
+{
+  /**
+     A GridEnsemble runs many independent simulations -- parameter
+     sweeps, seed studies -- in one process, so the element libraries,
+     the registry and the rest of the startup cost are paid once
+     rather than once per run.
+
+     Each run gets its own Grid, of the ensemble's shape, with its own
+     seed and optional starting configuration, and runs for a given
+     number of AEPS in deterministic steps (\sa
+     Grid::RunDeterministicStep) with no tile threads at all.  A pool
+     of worker threads takes runs off a shared list, one at a time,
+     so long runs and short ones balance out; as each finishes, a
+     one-line result is written to the results ByteSink.  Since the
+     steps are deterministic, a run's result depends only on its seed,
+     configuration and length, never on the thread or order it ran in.
+
+     Setting up a grid and loading its configuration happen one run at
+     a time, under a lock; only the stepping runs in parallel.  Element
+     parameters belong to the elements, not the grids, so runs that
+     set different parameter values should go in different ensembles.
+   */
+  template <class GC>
+  class GridEnsemble
+  {
+    typedef typename GC::EVENT_CONFIG EC;
+
+  public:
+
+    enum
+    {
+      /** The most runs one ensemble holds */
+      MAX_RUNS = 1024,
+
+      /** Longest configuration path, including the null */
+      MAX_CONFIG_PATH = 256
+    };
+
+    /** One run: what to do, then what came of it */
+    struct Run
+    {
+      u32 m_seed;
+      u32 m_aeps;
+      OverflowableCharBufferByteSink<MAX_CONFIG_PATH> m_configPath; // Empty for none
+
+      bool m_done;
+      bool m_ok;            // Set up, loaded and ran without failing
+      u32 m_steps;          // Deterministic steps run
+      u64 m_events;         // Events executed
+      u32 m_atoms;          // Non-empty sites at the end
+      u64 m_hash;           // Of the final owned atoms, tile by tile
+      u64 m_ms;             // Wall-clock time, setup included
+    };
+
+    /**
+       Each run gets a fresh \c width x \c height grid of tiles laid
+       out per \c layout.  \c tileWidth and \c tileHeight only
+       matter when \c GC is runtime-sized; see Grid::Grid.
+     */
+    GridEnsemble(ElementRegistry<EC> & registry, u32 width, u32 height,
+                 GridLayoutPattern layout,
+                 u32 tileWidth = GC::TILE_WIDTH,
+                 u32 tileHeight = GC::TILE_HEIGHT) ;
+
+    virtual ~GridEnsemble() ;
+
+    /**
+       Give each tile \c eventsPerTile events per deterministic step;
+       0, the default, gives each step one AEPS.
+     */
+    void SetEventsPerStep(u32 eventsPerTile)
+    {
+      m_eventsPerStep = eventsPerTile;
+    }
+
+    /**
+       Add a run of \c aeps AEPS from \c seed (which must be nonzero),
+       starting from the configuration at \c configPath, or from an
+       empty grid if it is null or empty.
+
+       @returns false if the ensemble is full or the path too long
+     */
+    bool AddRun(u32 seed, u32 aeps, const char * configPath) ;
+
+    /**
+       Add the runs listed in the file at \c path, one per line as
+       'SEED AEPS [CONFIGPATH]'.  Blank lines, and everything after a
+       '#', are ignored.
+
+       @returns false (after logging why) if the file can't be read or
+                a line can't be added
+     */
+    bool ReadRuns(const char * path) ;
+
+    u32 GetRunCount() const
+    {
+      return m_runCount;
+    }
+
+    const Run & GetRun(u32 index) const
+    {
+      MFM_API_ASSERT_ARG(index < m_runCount);
+      return m_runs[index];
+    }
+
+    /**
+       Do every run not yet done, on up to \c threads threads (0 for
+       one per online processor), writing each one's result line to
+       \c results, if non-null, as it finishes.
+
+       @returns the number of runs that failed
+     */
+    u32 RunAll(u32 threads, ByteSink * results) ;
+
+    /** Write a result line for run \c index */
+    void PrintRun(ByteSink & bs, u32 index) const ;
+
+  protected:
+
+    /**
+       Ready a new, initialized \c grid for a run: register elements,
+       freeze its tables, and so on.  Called under the setup lock.
+       Does nothing by default.
+     */
+    virtual void SetUpGrid(Grid<GC> & grid)
+    { }
+
+    /**
+       Load the configuration at \c path into \c grid, after SetUpGrid.
+       Called under the setup lock.  By default, only .mfb and .mfz
+       snapshots are understood.
+
+       @returns false if it couldn't be loaded
+     */
+    virtual bool LoadConfiguration(Grid<GC> & grid, const char * path) ;
+
+    /**
+       Called after each result line is written to \c results, say to
+       flush it.  Called under the results lock.  Does nothing by
+       default.
+     */
+    virtual void ResultWritten(ByteSink & results)
+    { }
+
+  private:
+    ElementRegistry<EC> & m_registry;
+    const u32 m_width;
+    const u32 m_height;
+    const GridLayoutPattern m_layout;
+    const u32 m_tileWidth;
+    const u32 m_tileHeight;
+    u32 m_eventsPerStep;
+
+    Run * m_runs;
+    u32 m_runCount;
+    u32 m_nextRun;          // Next run for a worker to take; atomic
+    u32 m_failures;         // Atomic
+
+    pthread_mutex_t m_setupLock;
+    pthread_mutex_t m_resultsLock;
+    ByteSink * m_results;
+
+    struct WorkerJob ;
+
+    /** Take and do runs until there are none left */
+    void Work() ;
+
+    void DoRun(u32 index) ;
+
+    static u64 GetTicks() ;
+
+    // Declare away
+    GridEnsemble(const GridEnsemble &) ;
+    GridEnsemble & operator=(const GridEnsemble &) ;
+  };
+} /* namespace MFM */
+
+#include "GridEnsemble.tcc"
+
+#endif /* GRIDENSEMBLE_H */
@@ -0,0 +1,276 @@
+/* -*- C++ -*- */
+#include <stdio.h>      /* For fopen, fgets */
+#include <string.h>     /* For strlen, strcmp, strchr */
+#include <sys/time.h>   /* For gettimeofday */
+#include "GridDiff.h"
+#include "GridSnapshot.h"
+
+namespace MFM
+{
+  template <class GC>
+  GridEnsemble<GC>::GridEnsemble(ElementRegistry<EC> & registry, u32 width, u32 height,
+                                 GridLayoutPattern layout,
+                                 u32 tileWidth, u32 tileHeight)
+    : m_registry(registry)
+    , m_width(width)
+    , m_height(height)
+    , m_layout(layout)
+    , m_tileWidth(tileWidth)
+    , m_tileHeight(tileHeight)
+    , m_eventsPerStep(0)
+    , m_runs(new Run[MAX_RUNS])
+    , m_runCount(0)
+    , m_nextRun(0)
+    , m_failures(0)
+    , m_results(0)
+  {
+    pthread_mutex_init(&m_setupLock, NULL);
+    pthread_mutex_init(&m_resultsLock, NULL);
+  }
+
+  template <class GC>
+  GridEnsemble<GC>::~GridEnsemble()
+  {
+    pthread_mutex_destroy(&m_resultsLock);
+    pthread_mutex_destroy(&m_setupLock);
+    delete [] m_runs;
+  }
+
+  template <class GC>
+  bool GridEnsemble<GC>::AddRun(u32 seed, u32 aeps, const char * configPath)
+  {
+    MFM_API_ASSERT_ARG(seed != 0);
+    if (m_runCount >= MAX_RUNS)
+      return false;
+
+    Run & run = m_runs[m_runCount];
+    run.m_seed = seed;
+    run.m_aeps = aeps;
+    run.m_configPath.Reset();
+    if (configPath)
+      run.m_configPath.Printf("%s", configPath);
+    if (run.m_configPath.HasOverflowed())
+      return false;
+
+    run.m_done = false;
+    run.m_ok = false;
+    run.m_steps = 0;
+    run.m_events = 0;
+    run.m_atoms = 0;
+    run.m_hash = 0;
+    run.m_ms = 0;
+    ++m_runCount;
+    return true;
+  }
+
+  template <class GC>
+  bool GridEnsemble<GC>::ReadRuns(const char * path)
+  {
+    FILE * fp = fopen(path, "r");
+    if (!fp)
+    {
+      LOG.Error("Can't read ensemble runs '%s'", path);
+      return false;
+    }
+
+    char line[MAX_CONFIG_PATH + 64];
+    u32 lineNo = 0;
+    bool ok = true;
+    while (ok && fgets(line, sizeof(line), fp))
+    {
+      ++lineNo;
+      char * hash = strchr(line, '#');
+      if (hash)
+        *hash = '\0';
+
+      u32 seed, aeps;
+      char config[MAX_CONFIG_PATH];
+      config[0] = '\0';
+      s32 fields = sscanf(line, "%u %u %255s", &seed, &aeps, config);
+      if (fields <= 0)
+        continue;  // Blank or comment
+      if (fields < 2 || seed == 0)
+      {
+        LOG.Error("%s:%d: Expected 'SEED AEPS [CONFIGPATH]', with SEED nonzero", path, lineNo);
+        ok = false;
+      }
+      else if (!AddRun(seed, aeps, config))
+      {
+        LOG.Error("%s:%d: Can't add run (more than %d, or path too long)", path, lineNo, MAX_RUNS);
+        ok = false;
+      }
+    }
+    fclose(fp);
+    return ok;
+  }
+
+  template <class GC>
+  bool GridEnsemble<GC>::LoadConfiguration(Grid<GC> & grid, const char * path)
+  {
+    const u32 len = strlen(path);
+    if (len > 4 && (!strcmp(path + len - 4, ".mfb") || !strcmp(path + len - 4, ".mfz")))
+      return GridSnapshot<GC>::Load(grid, path);
+
+    LOG.Error("Can't load '%s': only .mfb and .mfz snapshots here", path);
+    return false;
+  }
+
+  template <class GC>
+  u64 GridEnsemble<GC>::GetTicks()
+  {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return ((u64) tv.tv_sec) * 1000 + tv.tv_usec / 1000;
+  }
+
+  /**
+     One worker of the pool, which is just RunAll's threads each
+     taking runs until they're gone
+   */
+  template <class GC>
+  struct GridEnsemble<GC>::WorkerJob : public Grid<GC>::IndexJob
+  {
+    GridEnsemble & m_ensemble;
+
+    WorkerJob(GridEnsemble & ensemble) : m_ensemble(ensemble) { }
+
+    virtual void RunOnIndex(u32 index)
+    {
+      m_ensemble.Work();
+    }
+  };
+
+  template <class GC>
+  u32 GridEnsemble<GC>::RunAll(u32 threads, ByteSink * results)
+  {
+    m_results = results;
+    m_nextRun = 0;
+    m_failures = 0;
+
+    if (threads == 0)
+    {
+      long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+      threads = cpus > 0 ? (u32) cpus : 1;
+    }
+    threads = MIN(threads, m_runCount);
+
+    if (threads > 0)
+    {
+      WorkerJob job(*this);
+      Grid<GC>::RunInParallel(job, threads, threads);
+    }
+
+    m_results = 0;
+    return m_failures;
+  }
+
+  template <class GC>
+  void GridEnsemble<GC>::Work()
+  {
+    while (true)
+    {
+      const u32 index = __atomic_fetch_add(&m_nextRun, 1, __ATOMIC_RELAXED);
+      if (index >= m_runCount)
+        return;
+      if (m_runs[index].m_done)
+        continue;
+
+      DoRun(index);
+
+      if (!m_runs[index].m_ok)
+        __atomic_fetch_add(&m_failures, 1, __ATOMIC_RELAXED);
+
+      if (m_results)
+      {
+        pthread_mutex_lock(&m_resultsLock);
+        PrintRun(*m_results, index);
+        ResultWritten(*m_results);
+        pthread_mutex_unlock(&m_resultsLock);
+      }
+    }
+  }
+
+  template <class GC>
+  void GridEnsemble<GC>::DoRun(u32 index)
+  {
+    Run & run = m_runs[index];
+    const u64 startMS = GetTicks();
+    Grid<GC> * volatile grid = 0;
+    volatile bool ok = false;
+
+    // Setup, one run at a time
+    pthread_mutex_lock(&m_setupLock);
+    unwind_protect(
+    {
+      LOG.Error("Ensemble run %d failed in setup", index);
+    },
+    {
+      grid = new Grid<GC>(m_registry, m_width, m_height, m_layout,
+                          m_tileWidth, m_tileHeight);
+      grid->SetSeed(run.m_seed);
+      grid->SetInitThreads(1);
+      grid->Init();
+      SetUpGrid(*grid);
+      ok = run.m_configPath.GetLength() == 0 ||
+        LoadConfiguration(*grid, run.m_configPath.GetZString());
+    });
+    pthread_mutex_unlock(&m_setupLock);
+
+    // Then the stepping, in parallel with everyone else's
+    if (ok)
+    {
+      ok = false;
+      unwind_protect(
+      {
+        LOG.Error("Ensemble run %d failed after %d steps", index, run.m_steps);
+      },
+      {
+        const u32 tileSites = grid->GetOwnedWidth() * grid->GetOwnedHeight();
+        const u32 eventsPerStep = m_eventsPerStep ? m_eventsPerStep : tileSites;
+        const u64 steps = ((u64) run.m_aeps * tileSites + eventsPerStep - 1) / eventsPerStep;
+        for (run.m_steps = 0; run.m_steps < steps; ++run.m_steps)
+          grid->RunDeterministicStep(eventsPerStep);
+
+        run.m_events = grid->GetTotalEventsExecuted();
+        run.m_atoms = grid->GetTotalSites() -
+          grid->GetAtomCount(Element_Empty<EC>::THE_INSTANCE.GetType());
+
+        // Combine the tile hashes in grid order
+        GridDiff<GC> diff;
+        diff.Capture(*grid, 1);
+        u64 hash = HexU64(0xcbf29ce4, 0x84222325);  // FNV offset basis
+        for (u32 y = 0; y < m_height; ++y)
+        {
+          for (u32 x = 0; x < m_width; ++x)
+          {
+            hash ^= diff.GetTileReport(SPoint(x, y)).m_hashBefore;
+            hash *= HexU64(0x100, 0x000001b3);  // FNV prime
+          }
+        }
+        run.m_hash = hash;
+        ok = true;
+      });
+    }
+
+    delete grid;
+    run.m_ok = ok;
+    run.m_done = true;
+    run.m_ms = GetTicks() - startMS;
+  }
+
+  template <class GC>
+  void GridEnsemble<GC>::PrintRun(ByteSink & bs, u32 index) const
+  {
+    const Run & run = GetRun(index);
+    bs.Printf("run %d seed %d aeps %d %s steps %d events ",
+              index, run.m_seed, run.m_aeps,
+              !run.m_done ? "pending" : (run.m_ok ? "ok" : "FAILED"),
+              run.m_steps);
+    bs.Print(run.m_events);
+    bs.Printf(" atoms %d hash ", run.m_atoms);
+    bs.Print(run.m_hash, Format::HEX, 16, '0');
+    bs.Printf(" ms ");
+    bs.Print(run.m_ms);
+    bs.Printf(" config %s\n", run.m_configPath.GetLength() ? run.m_configPath.GetZString() : "-");
+  }
+} /* namespace MFM */
@@ -0,0 +1,171 @@
+/*                                              -*- mode:C++ -*-
+  GridPattern.h Captured grid regions for stamping
+  Copyright (C) 2014-2016 The Regents of the University of New Mexico.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+  USA
+*/
+
+/**
+  \file GridPattern.h Captured grid regions for stamping
+  \date (C) 2014-2016 All rights reserved.
+  \lgpl
+ */
+#ifndef GRIDPATTERN_H
+#define GRIDPATTERN_H
+
+#include "itype.h"
+#include "Grid.h"
+#include "AtomSerializer.h"
+
+namespace MFM
+{
+  /**
+     A GridPattern is a rectangle of atoms copied out of a Grid, which
+     can then be stamped back into that or any other grid with the
+     same atom configuration, as often and wherever you like -- to
+     tile a world with a test pattern, say, or to seed it.
+
+     Stamping goes a row at a time through Grid::PlaceAtomsInRow, so
+     each tile's part of each row is mapped once and neighbor caches
+     are only visited near tile edges.  Sites that weren't in the
+     grid when the pattern was captured (off its edge, or in a
+     staggered grid's gaps) are absent from the pattern, and stamping
+     leaves whatever is under them alone.
+
+     Patterns save and load as text, with each atom written as a .mfs
+     Site's is: its type via an AtomTypeFormatter, and then its bits.
+   */
+  template <class GC>
+  class GridPattern
+  {
+    typedef typename GC::EVENT_CONFIG EC;
+    typedef typename EC::ATOM_CONFIG AC;
+    typedef typename AC::ATOM_TYPE T;
+
+  public:
+
+    GridPattern()
+      : m_width(0)
+      , m_height(0)
+      , m_presentCount(0)
+      , m_atoms(0)
+      , m_present(0)
+    { }
+
+    ~GridPattern()
+    {
+      Resize(0, 0);
+    }
+
+    u32 GetWidth() const { return m_width; }
+
+    u32 GetHeight() const { return m_height; }
+
+    /** @returns the number of sites present in the pattern */
+    u32 GetPresentCount() const { return m_presentCount; }
+
+    bool IsPresent(u32 x, u32 y) const
+    {
+      MFM_API_ASSERT_ARG(x < m_width && y < m_height);
+      const u32 i = y * m_width + x;
+      return (m_present[i / 32] >> (i % 32)) & 1;
+    }
+
+    const T & GetAtom(u32 x, u32 y) const
+    {
+      MFM_API_ASSERT_ARG(x < m_width && y < m_height);
+      return m_atoms[y * m_width + x];
+    }
+
+    /**
+     * Replaces this pattern with a copy of the atoms in \a region of
+     * \a grid -- its event layer atoms, or its base atoms if \a
+     * fromBase.  The grid should not be running.
+     *
+     * @returns the number of sites captured, which is fewer than the
+     *          region's area if some of it is outside the grid.
+     */
+    u32 Capture(Grid<GC> & grid, const Rect & region, bool fromBase = false);
+
+    /**
+     * Writes this pattern into \a grid with its top left corner at \a
+     * at, into the event layer or, if \a toBase, the base.  Parts
+     * falling outside the grid are dropped.  The grid should not be
+     * running.
+     *
+     * @returns the number of sites written
+     */
+    u32 Stamp(Grid<GC> & grid, const SPoint & at, bool toBase = false) const
+    {
+      return StampClipped(grid, at, m_width, m_height, toBase);
+    }
+
+    /**
+     * Repeats this pattern across \a area of \a grid, starting from
+     * its top left corner, with the copies at its right and bottom
+     * edges cut short to fit.
+     *
+     * @returns the number of sites written
+     */
+    u32 StampTiled(Grid<GC> & grid, const Rect & area, bool toBase = false) const;
+
+    /**
+     * Writes this pattern to \a bs as text, naming atom types via \a
+     * atf.
+     */
+    void Save(ByteSink & bs, AtomTypeFormatter<AC> & atf) const;
+
+    /**
+     * Replaces this pattern with one read from \a bs, as written by
+     * Save, using \a atf to map the type names back to types.
+     *
+     * @returns true on success; on false (with \a bs having issued
+     *          whatever complaints) this pattern is left empty.
+     */
+    bool Load(LineCountingByteSource & bs, AtomTypeFormatter<AC> & atf);
+
+  private:
+
+    u32 m_width;
+    u32 m_height;
+    u32 m_presentCount;
+    T * m_atoms;       // m_width * m_height, row major
+    u32 * m_present;   // One bit per atom
+
+    GridPattern(const GridPattern &) ;  // Declared but not defined
+    GridPattern & operator=(const GridPattern &) ;  // Declared but not defined
+
+    /** Reallocate to \a width by \a height, all sites absent */
+    void Resize(u32 width, u32 height);
+
+    void SetAtom(u32 x, u32 y, const T & atom)
+    {
+      const u32 i = y * m_width + x;
+      if (!((m_present[i / 32] >> (i % 32)) & 1))
+      {
+        m_present[i / 32] |= 1u << (i % 32);
+        ++m_presentCount;
+      }
+      m_atoms[i] = atom;
+    }
+
+    u32 StampClipped(Grid<GC> & grid, const SPoint & at, u32 width, u32 height, bool toBase) const;
+  };
+} /* namespace MFM */
+
+#include "GridPattern.tcc"
+
+#endif /* GRIDPATTERN_H */
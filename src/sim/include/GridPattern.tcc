@@ -0,0 +1,161 @@
+/* -*- C++ -*- */
+#include "OverflowableCharBufferByteSink.h"
+
+namespace MFM
+{
+  template <class GC>
+  void GridPattern<GC>::Resize(u32 width, u32 height)
+  {
+    delete [] m_atoms;
+    delete [] m_present;
+    m_atoms = 0;
+    m_present = 0;
+    m_width = width;
+    m_height = height;
+    m_presentCount = 0;
+
+    const u32 sites = width * height;
+    if (sites == 0) return;
+    m_atoms = new T[sites];
+    const u32 words = (sites + 31) / 32;
+    m_present = new u32[words];
+    for (u32 i = 0; i < words; ++i)
+    {
+      m_present[i] = 0;
+    }
+  }
+
+  template <class GC>
+  u32 GridPattern<GC>::Capture(Grid<GC> & grid, const Rect & region, bool fromBase)
+  {
+    Resize(region.GetWidth(), region.GetHeight());
+    for (u32 y = 0; y < m_height; ++y)
+    {
+      for (u32 x = 0; x < m_width; ++x)
+      {
+        SPoint site = region.GetPosition() + SPoint(x, y);
+        if (!grid.IsGridCoord(site)) continue;
+        SetAtom(x, y, *grid.GetAtomInSite(fromBase, site));
+      }
+    }
+    return m_presentCount;
+  }
+
+  template <class GC>
+  u32 GridPattern<GC>::StampClipped(Grid<GC> & grid, const SPoint & at,
+                                    u32 width, u32 height, bool toBase) const
+  {
+    u32 placed = 0;
+    for (u32 y = 0; y < height; ++y)
+    {
+      // Each run of present sites goes in as one row
+      u32 x = 0;
+      while (x < width)
+      {
+        while (x < width && !IsPresent(x, y)) ++x;
+        const u32 runStart = x;
+        while (x < width && IsPresent(x, y)) ++x;
+        if (x > runStart)
+        {
+          placed += grid.PlaceAtomsInRow(toBase, &m_atoms[y * m_width + runStart], 1,
+                                         at + SPoint(runStart, y), x - runStart);
+        }
+      }
+    }
+    return placed;
+  }
+
+  template <class GC>
+  u32 GridPattern<GC>::StampTiled(Grid<GC> & grid, const Rect & area, bool toBase) const
+  {
+    if (m_width == 0 || m_height == 0) return 0;
+    u32 placed = 0;
+    for (u32 y = 0; y < area.GetHeight(); y += m_height)
+    {
+      const u32 height = MIN(m_height, area.GetHeight() - y);
+      for (u32 x = 0; x < area.GetWidth(); x += m_width)
+      {
+        const u32 width = MIN(m_width, area.GetWidth() - x);
+        placed += StampClipped(grid, area.GetPosition() + SPoint(x, y), width, height, toBase);
+      }
+    }
+    return placed;
+  }
+
+  template <class GC>
+  void GridPattern<GC>::Save(ByteSink & bs, AtomTypeFormatter<AC> & atf) const
+  {
+    bs.Printf("GridPattern(%d,%d,%d)\n", m_width, m_height, m_presentCount);
+    for (u32 y = 0; y < m_height; ++y)
+    {
+      for (u32 x = 0; x < m_width; ++x)
+      {
+        if (!IsPresent(x, y)) continue;
+        T tmp = GetAtom(x, y);
+        bs.Printf("%d,%d,", x, y);
+        atf.PrintAtomType(tmp, bs);
+        AtomSerializer<AC> as(tmp);
+        bs.Printf(",%@\n", &as);
+      }
+    }
+  }
+
+  template <class GC>
+  bool GridPattern<GC>::Load(LineCountingByteSource & bs, AtomTypeFormatter<AC> & atf)
+  {
+    enum { MAX_SIDE = 1 << 14 };  // Far bigger than any sane pattern
+
+    Resize(0, 0);
+    OString16 tag;
+    u32 width, height, count;
+    if (!bs.ScanIdentifier(tag) || !tag.Equals("GridPattern") ||
+        7 != bs.Scanf("(%d,%d,%d)", &width, &height, &count))
+    {
+      bs.Msg(Logger::ERROR, "Expected 'GridPattern(width,height,count)'");
+      return false;
+    }
+    if (width > MAX_SIDE || height > MAX_SIDE || count > width * height)
+    {
+      bs.Msg(Logger::ERROR, "Bad pattern size %dx%d with %d sites", width, height, count);
+      return false;
+    }
+
+    Resize(width, height);
+    for (u32 i = 0; i < count; ++i)
+    {
+      u32 x, y;
+      bs.SkipWhitespace();
+      if (4 != bs.Scanf("%d,%d,", &x, &y) || x >= width || y >= height)
+      {
+        bs.Msg(Logger::ERROR, "Bad pattern site");
+        Resize(0, 0);
+        return false;
+      }
+
+      // As in Site::LoadConfig: the type comes from the formatter,
+      // the state bits from the serialized atom
+      T atom;
+      T bits;
+      AtomSerializer<AC> as(bits);
+      if (!atf.ParseAtomType(bs, atom) || 2 != bs.Scanf(",%@", &as))
+      {
+        bs.Msg(Logger::ERROR, "Bad atom at pattern site (%d,%d)", x, y);
+        Resize(0, 0);
+        return false;
+      }
+      for (u32 b = T::ATOM_FIRST_STATE_BIT; b < T::BPA; ++b)
+      {
+        atom.GetBits().StoreBit(b, bits.GetBits().ReadBit(b));
+      }
+      SetAtom(x, y, atom);
+    }
+
+    if (m_presentCount != count)
+    {
+      bs.Msg(Logger::ERROR, "Pattern repeats sites");
+      Resize(0, 0);
+      return false;
+    }
+    return true;
+  }
+} /* namespace MFM */
@@ -0,0 +1,257 @@
+/*                                              -*- mode:C++ -*-
+  GridSnapshot.h Binary, mmap-able grid snapshots
+  Copyright (C) 2014-2016 The Regents of the University of New Mexico.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+  USA
+*/
+
+/**
+  \file GridSnapshot.h Binary, mmap-able grid snapshots
+  \date (C) 2014-2016 All rights reserved.
+  \lgpl
+ */
+#ifndef GRIDSNAPSHOT_H
+#define GRIDSNAPSHOT_H
+
+#include "itype.h"
+#include "Grid.h"
+#include "GridSnapshotWriter.h"
+
+namespace MFM
+{
+  /**
+     A GridSnapshot writes and reads a binary image of a Grid: a
+     fixed header, a table mapping each saved element type to its
+     UUID, and then one record per tile holding that tile's raw
+     event-layer atoms followed by its raw base atoms, both in site
+     number order and including the cache sites.
+
+     Each tile record goes out in a single writev(2) and a snapshot is
+     read back by mmap(2)ing the whole file, so saving and restoring
+     a grid costs little more than copying its atoms.  The price is
+     portability: a snapshot can only be loaded by a build with the
+     same atom size, tile size, grid size and byte order, which the
+     header records and Load checks.  The .mfs text format written by
+     ExternalConfig remains the interchange format; snapshots are for
+     fast autosaves and restarts of the same simulation.
+
+     A compressed snapshot (conventionally .mfz) has the same header,
+     under SNAPSHOT_Z_MAGIC, and element table, followed by an index
+     of GridSnapshotWriter::BlockIndexEntry records and then each tile
+     record compressed on its own by LZBlock.  Mostly empty or
+     repetitive grids shrink many times over; tiles are compressed in
+     parallel, on the writer's threads, and any one tile can be
+     restored without inflating the rest (see LoadTile).
+
+     Only atoms and per-tile event counts are stored.  Base sensor
+     readings, paint, and per-site event statistics are not, and come
+     back cleared.
+   */
+  template <class GC>
+  class GridSnapshot
+  {
+    typedef typename GC::EVENT_CONFIG EC;
+    typedef typename EC::ATOM_CONFIG AC;
+    typedef typename AC::ATOM_TYPE T;
+    typedef typename EC::SITE S;
+
+  public:
+
+    enum
+    {
+      /** First word of every snapshot ('MFMS' read little-endian) */
+      SNAPSHOT_MAGIC = 0x534d464d,
+
+      /** First word of a compressed snapshot ('MFMZ') */
+      SNAPSHOT_Z_MAGIC = 0x5a4d464d,
+
+      /** Bump whenever the layout below changes */
+      SNAPSHOT_VERSION = 1,
+
+      /** Reads back differently on a machine of the other byte order */
+      SNAPSHOT_BYTE_ORDER = 0x01020304,
+
+      /** Longest UUID string accepted in the element table */
+      MAX_UUID_BYTES = 512
+    };
+
+    /**
+     * Writes a snapshot of \a grid to the file \a path, replacing any
+     * existing file.  The grid should not be running.
+     *
+     * @returns true on success, false (with a logged error) if the
+     *          file could not be written.
+     */
+    static bool Save(Grid<GC> & grid, const char * path);
+
+    /**
+     * Copies a snapshot image of \a grid into the staging arena of
+     * \a writer, laid out byte-for-byte as Save would write it, so
+     * that writer.StartWrite(path, imageBytes) can put it on disk
+     * after the grid has resumed.  Only the copy happens here; this
+     * is the entire cost of an asynchronous save to a paused grid.
+     *
+     * @returns true on success, setting \a imageBytes to the size of
+     *          the captured image; false (with a logged error) if the
+     *          grid cannot be described in a snapshot.
+     */
+    static bool Capture(Grid<GC> & grid, GridSnapshotWriter & writer, u32 & imageBytes);
+
+    /**
+     * Copies \a grid into the staging arena of \a writer, as
+     * Capture does, and starts \a writer compressing it tile by tile
+     * and writing it to \a path as a compressed snapshot.  Call
+     * writer.Finish() for the outcome, and its statistics.
+     *
+     * @returns false (with a logged error) if the grid cannot be
+     *          described in a snapshot; then nothing is written.
+     */
+    static bool StartCompressedSave(Grid<GC> & grid, GridSnapshotWriter & writer, const char * path);
+
+    /**
+     * Writes a compressed snapshot of \a grid to \a path, waiting
+     * for it to be written.  The grid should not be running.
+     *
+     * @returns true on success
+     */
+    static bool SaveCompressed(Grid<GC> & grid, const char * path);
+
+    /**
+     * Replaces the contents of \a grid with the snapshot in the file
+     * \a path.  Saved element types are mapped to the current types
+     * of the same (or a compatible) UUID in the grid's
+     * ElementRegistry.  The grid should not be running.
+     *
+     * @returns true on success.  Returns false (with a logged error)
+     *          if the file is unreadable, was written for a different
+     *          grid geometry or atom configuration, doesn't hold
+     *          exactly one record for each of the grid's tiles, or
+     *          names an element that cannot be found; in that case \a
+     *          grid is unchanged.
+     */
+    static bool Load(Grid<GC> & grid, const char * path);
+
+    /**
+     * Replaces just the tile at \a tileInGrid with its contents in
+     * the (plain or compressed) snapshot \a path, leaving the rest of
+     * the grid alone; of a compressed snapshot, only that tile is
+     * inflated.  The grid should not be running.
+     *
+     * @returns true on success; false (with a logged error), with the
+     *          grid unchanged, for the reasons Load would, or if
+     *          \a tileInGrid isn't a live tile.
+     */
+    static bool LoadTile(Grid<GC> & grid, const char * path, const SPoint & tileInGrid);
+
+  private:
+    /* Deltas share our element table and type remapping */
+    template <class> friend class GridCheckpoint;
+
+    struct FileHeader
+    {
+      u32 m_magic;
+      u32 m_version;
+      u32 m_byteOrder;
+      u32 m_atomBytes;
+      u32 m_tileWidth;
+      u32 m_tileHeight;
+      u32 m_gridWidth;
+      u32 m_gridHeight;
+      u32 m_tileCount;
+      u32 m_elementCount;
+    };
+
+    /* Followed by m_uuidBytes of UUID text, padded to a multiple of 4 */
+    struct ElementHeader
+    {
+      u32 m_type;
+      u32 m_uuidBytes;
+    };
+
+    /* Followed by tile sites' event-layer atoms, then their base atoms */
+    struct TileHeader
+    {
+      u32 m_tileX;
+      u32 m_tileY;
+      u64 m_eventsExecuted;
+      u64 m_eventsAttempted;
+    };
+
+    struct TypeMapping
+    {
+      u32 m_savedType;
+      const Element<EC> * m_element;
+    };
+
+    static u32 Padded(u32 bytes)
+    {
+      return (bytes + 3) & ~3u;
+    }
+
+    static u32 GetMaxTableBytes(Grid<GC> & grid);
+
+    static bool BuildPreamble(Grid<GC> & grid, FileHeader & header, u8 * table, u32 & tableBytes);
+
+    static void FillTileHeader(Grid<GC> & grid, const SPoint & tileInGrid, TileHeader & th);
+
+    /**
+     * Lays a snapshot image of \a grid, headed by \a magic, into
+     * \a writer's arena: the header and element table (\a
+     * prefixBytes), then \a tileCount tile records of \a recordBytes.
+     */
+    static bool CaptureImage(Grid<GC> & grid, GridSnapshotWriter & writer, u32 magic,
+                             u32 & prefixBytes, u32 & recordBytes, u32 & tileCount);
+
+    /**
+     * mmaps all of \a path, setting \a fileBytes; \returns 0
+     * (with a logged error) if it's unreadable or too short to hold a
+     * FileHeader.
+     */
+    static const u8 * MapFile(const char * path, u64 & fileBytes);
+
+    /**
+     * Finds tile record \a t of the snapshot mapped at \a base,
+     * whose tile records (or block index, if \a compressed) begin at
+     * \a tiles.  A compressed record is inflated into \a scratch.
+     *
+     * @returns the record, or 0 (with a logged error) if it's
+     *          missing or damaged
+     */
+    static const u8 * GetTileRecord(const FileHeader & header, bool compressed,
+                                    const u8 * base, const u8 * tiles, const u8 * limit,
+                                    u32 t, u8 * scratch, const char * path);
+
+    /** Puts tile record \a record's atoms and event counts in \a grid */
+    static void ApplyTileRecord(Grid<GC> & grid, const u8 * record, u32 tileSites,
+                                const TypeMapping * mappings, u32 mappingCount);
+
+    static bool CheckHeader(const Grid<GC> & grid, const FileHeader & header, const char * path);
+
+    /**
+     * Reads \a elementCount ElementHeaders and their UUIDs from \a at
+     * (advancing it, but never past \a limit ), mapping each saved
+     * type to an element known now.
+     */
+    static bool ReadElementTable(Grid<GC> & grid, const u8 * & at, const u8 * limit,
+                                 u32 elementCount, TypeMapping * mappings, const char * path);
+
+    static void RemapType(T & atom, const TypeMapping * mappings, u32 mappingCount);
+  };
+} /* namespace MFM */
+
+#include "GridSnapshot.tcc"
+
+#endif /* GRIDSNAPSHOT_H */
@@ -0,0 +1,650 @@
+/* -*- C++ -*- */
+#include "CharBufferByteSource.h"
+#include "OverflowableCharBufferByteSink.h"
+#include "Logger.h"
+#include "LZBlock.h"
+#include <string.h>     /* For memcpy */
+#include <errno.h>
+#include <fcntl.h>      /* For open */
+#include <unistd.h>     /* For close */
+#include <sys/mman.h>   /* For mmap */
+#include <sys/stat.h>   /* For fstat */
+#include <sys/uio.h>    /* For writev */
+
+namespace MFM
+{
+  template <class GC>
+  u32 GridSnapshot<GC>::GetMaxTableBytes(Grid<GC> & grid)
+  {
+    const u32 bytes = grid.GetElementRegistry().GetEntryCount() * (sizeof(ElementHeader) + MAX_UUID_BYTES);
+    return bytes > 0 ? bytes : 1;
+  }
+
+  template <class GC>
+  bool GridSnapshot<GC>::BuildPreamble(Grid<GC> & grid, FileHeader & header, u8 * table, u32 & tableBytes)
+  {
+    ElementRegistry<EC> & er = grid.GetElementRegistry();
+    const u32 entries = er.GetEntryCount();
+
+    tableBytes = 0;
+    u32 elementCount = 0;
+    for (u32 i = 0; i < entries; ++i)
+    {
+      const Element<EC> * elt = er.GetEntryElement(i);
+      if (!elt) continue;  // Registered but not loaded; no atoms can have its type
+
+      OverflowableCharBufferByteSink<MAX_UUID_BYTES> uuidText;
+      er.GetEntryUUID(i).Print(uuidText);
+      if (uuidText.HasOverflowed())
+      {
+        LOG.Error("UUID '%@' too long for snapshot", &er.GetEntryUUID(i));
+        return false;
+      }
+
+      ElementHeader eh;
+      eh.m_type = elt->GetType();
+      eh.m_uuidBytes = uuidText.GetLength();
+      memcpy(table + tableBytes, &eh, sizeof(eh));
+      tableBytes += sizeof(eh);
+      memset(table + tableBytes, 0, Padded(eh.m_uuidBytes));
+      memcpy(table + tableBytes, uuidText.GetZString(), eh.m_uuidBytes);
+      tableBytes += Padded(eh.m_uuidBytes);
+      ++elementCount;
+    }
+
+    const Tile<EC> & first = *grid.begin();
+
+    header.m_magic = SNAPSHOT_MAGIC;
+    header.m_version = SNAPSHOT_VERSION;
+    header.m_byteOrder = SNAPSHOT_BYTE_ORDER;
+    header.m_atomBytes = sizeof(T);
+    header.m_tileWidth = first.TILE_WIDTH;
+    header.m_tileHeight = first.TILE_HEIGHT;
+    header.m_gridWidth = grid.GetWidth();
+    header.m_gridHeight = grid.GetHeight();
+    header.m_tileCount = 0;
+    header.m_elementCount = elementCount;
+    for (typename Grid<GC>::iterator_type i = grid.begin(); i != grid.end(); ++i)
+      ++header.m_tileCount;
+
+    return true;
+  }
+
+  template <class GC>
+  void GridSnapshot<GC>::FillTileHeader(Grid<GC> & grid, const SPoint & tileInGrid, TileHeader & th)
+  {
+    const Tile<EC> & tile = grid.GetTile(tileInGrid);
+    th.m_tileX = (u32) tileInGrid.GetX();
+    th.m_tileY = (u32) tileInGrid.GetY();
+    th.m_eventsExecuted = tile.GetEventWindow().GetEventWindowsExecuted();
+    th.m_eventsAttempted = tile.GetEventWindow().GetEventWindowsAttempted();
+  }
+
+  template <class GC>
+  bool GridSnapshot<GC>::Save(Grid<GC> & grid, const char * path)
+  {
+    MFM_API_ASSERT_NONNULL(path);
+
+    FileHeader header;
+    u8 * table = new u8[GetMaxTableBytes(grid)];
+    u32 tableBytes;
+    if (!BuildPreamble(grid, header, table, tableBytes))
+    {
+      delete [] table;
+      return false;
+    }
+
+    const u32 tileSites = header.m_tileWidth * header.m_tileHeight;
+
+    s32 fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+      LOG.Error("Can't create snapshot '%s': %s", path, strerror(errno));
+      delete [] table;
+      return false;
+    }
+
+    bool ok = true;
+    {
+      struct iovec iov[2];
+      iov[0].iov_base = &header;
+      iov[0].iov_len = sizeof(header);
+      iov[1].iov_base = table;
+      iov[1].iov_len = tableBytes;
+      ok = writev(fd, iov, 2) == (ssize_t) (sizeof(header) + tableBytes);
+    }
+    delete [] table;
+
+    /* Planar sites already keep the event layer contiguous, so it
+       can go out straight from the tile; anything else is gathered */
+    T * atomScratch = S::IS_PLANAR ? 0 : new T[tileSites];
+    T * baseScratch = new T[tileSites];
+
+    for (typename Grid<GC>::iterator_type i = grid.begin(); ok && i != grid.end(); ++i)
+    {
+      typename Grid<GC>::GridTile & tile = grid.GetGridTile(i.At());
+
+      TileHeader th;
+      FillTileHeader(grid, i.At(), th);
+
+      const S * sites = tile.GetAllSites();
+      T * atoms = atomScratch;
+      if (S::IS_PLANAR)
+      {
+        atoms = &tile.GetAllSites()[0].GetAtom();
+      }
+      for (u32 sn = 0; sn < tileSites; ++sn)
+      {
+        const S & site = sites[sn];
+        if (!S::IS_PLANAR)
+        {
+          atomScratch[sn] = site.GetAtom();
+        }
+        baseScratch[sn] = site.GetBase().GetBaseAtom();
+      }
+
+      struct iovec iov[3];
+      iov[0].iov_base = &th;
+      iov[0].iov_len = sizeof(th);
+      iov[1].iov_base = atoms;
+      iov[1].iov_len = tileSites * sizeof(T);
+      iov[2].iov_base = baseScratch;
+      iov[2].iov_len = tileSites * sizeof(T);
+      ok = writev(fd, iov, 3) == (ssize_t) (sizeof(th) + 2 * tileSites * sizeof(T));
+    }
+
+    delete [] atomScratch;
+    delete [] baseScratch;
+
+    if (!ok)
+    {
+      LOG.Error("Can't write snapshot '%s': %s", path, strerror(errno));
+    }
+
+    if (close(fd) != 0 && ok)
+    {
+      LOG.Error("Can't close snapshot '%s': %s", path, strerror(errno));
+      ok = false;
+    }
+
+    return ok;
+  }
+
+  template <class GC>
+  bool GridSnapshot<GC>::CaptureImage(Grid<GC> & grid, GridSnapshotWriter & writer, u32 magic,
+                                      u32 & prefixBytes, u32 & recordBytes, u32 & tileCount)
+  {
+    FileHeader header;
+    u8 * table = new u8[GetMaxTableBytes(grid)];
+    u32 tableBytes;
+    if (!BuildPreamble(grid, header, table, tableBytes))
+    {
+      delete [] table;
+      return false;
+    }
+    header.m_magic = magic;
+
+    const u32 tileSites = header.m_tileWidth * header.m_tileHeight;
+    recordBytes = sizeof(TileHeader) + 2 * tileSites * sizeof(T);
+    prefixBytes = sizeof(header) + tableBytes;
+    tileCount = header.m_tileCount;
+
+    /* Lay the image out exactly as Save writes it */
+    u8 * at = writer.BeginCapture(prefixBytes + tileCount * recordBytes);
+    memcpy(at, &header, sizeof(header));
+    at += sizeof(header);
+    memcpy(at, table, tableBytes);
+    at += tableBytes;
+    delete [] table;
+
+    for (typename Grid<GC>::iterator_type i = grid.begin(); i != grid.end(); ++i)
+    {
+      typename Grid<GC>::GridTile & tile = grid.GetGridTile(i.At());
+
+      TileHeader th;
+      FillTileHeader(grid, i.At(), th);
+      memcpy(at, &th, sizeof(th));
+      at += sizeof(th);
+
+      const S * sites = tile.GetAllSites();
+      T * atoms = (T *) at;
+      T * bases = atoms + tileSites;
+      for (u32 sn = 0; sn < tileSites; ++sn)
+      {
+        const S & site = sites[sn];
+        atoms[sn] = site.GetAtom();
+        bases[sn] = site.GetBase().GetBaseAtom();
+      }
+      at += 2 * tileSites * sizeof(T);
+    }
+
+    return true;
+  }
+
+  template <class GC>
+  bool GridSnapshot<GC>::Capture(Grid<GC> & grid, GridSnapshotWriter & writer, u32 & imageBytes)
+  {
+    u32 prefixBytes, recordBytes, tileCount;
+    if (!CaptureImage(grid, writer, SNAPSHOT_MAGIC, prefixBytes, recordBytes, tileCount))
+    {
+      return false;
+    }
+    imageBytes = prefixBytes + tileCount * recordBytes;
+    return true;
+  }
+
+  template <class GC>
+  bool GridSnapshot<GC>::StartCompressedSave(Grid<GC> & grid, GridSnapshotWriter & writer,
+                                             const char * path)
+  {
+    MFM_API_ASSERT_NONNULL(path);
+    u32 prefixBytes, recordBytes, tileCount;
+    if (!CaptureImage(grid, writer, SNAPSHOT_Z_MAGIC, prefixBytes, recordBytes, tileCount))
+    {
+      return false;
+    }
+    writer.StartCompressedWrite(path, prefixBytes, recordBytes, tileCount);
+    return true;
+  }
+
+  template <class GC>
+  bool GridSnapshot<GC>::SaveCompressed(Grid<GC> & grid, const char * path)
+  {
+    GridSnapshotWriter writer;
+    return StartCompressedSave(grid, writer, path) && writer.Finish();
+  }
+
+  template <class GC>
+  bool GridSnapshot<GC>::CheckHeader(const Grid<GC> & grid, const FileHeader & header, const char * path)
+  {
+    if (header.m_magic != SNAPSHOT_MAGIC && header.m_magic != SNAPSHOT_Z_MAGIC)
+    {
+      LOG.Error("'%s' is not a grid snapshot", path);
+      return false;
+    }
+
+    if (header.m_byteOrder != SNAPSHOT_BYTE_ORDER || header.m_version != SNAPSHOT_VERSION)
+    {
+      LOG.Error("Snapshot '%s' is version 0x%08x/0x%08x, need 0x%08x/0x%08x",
+                path, header.m_version, header.m_byteOrder,
+                SNAPSHOT_VERSION, SNAPSHOT_BYTE_ORDER);
+      return false;
+    }
+
+    const Tile<EC> & first = *grid.begin();
+    if (header.m_atomBytes != sizeof(T) ||
+        header.m_tileWidth != first.TILE_WIDTH ||
+        header.m_tileHeight != first.TILE_HEIGHT ||
+        header.m_gridWidth != grid.GetWidth() ||
+        header.m_gridHeight != grid.GetHeight())
+    {
+      LOG.Error("Snapshot '%s' is for a %dx%d grid of %dx%d tiles with %d byte atoms, "
+                "not %dx%d of %dx%d with %d",
+                path,
+                header.m_gridWidth, header.m_gridHeight,
+                header.m_tileWidth, header.m_tileHeight, header.m_atomBytes,
+                grid.GetWidth(), grid.GetHeight(),
+                first.TILE_WIDTH, first.TILE_HEIGHT, (u32) sizeof(T));
+      return false;
+    }
+
+    u32 tileCount = 0;
+    for (typename Grid<GC>::const_iterator_type i = grid.begin(); i != grid.end(); ++i)
+      ++tileCount;
+    if (header.m_tileCount != tileCount)
+    {
+      LOG.Error("Snapshot '%s' holds %d tiles, not the grid's %d",
+                path, header.m_tileCount, tileCount);
+      return false;
+    }
+    return true;
+  }
+
+  template <class GC>
+  void GridSnapshot<GC>::RemapType(T & atom, const TypeMapping * mappings, u32 mappingCount)
+  {
+    const u32 type = atom.GetType();
+    for (u32 i = 0; i < mappingCount; ++i)
+    {
+      if (mappings[i].m_savedType != type) continue;
+
+      const Element<EC> * elt = mappings[i].m_element;
+      if (elt->GetType() == type) return;
+
+      /* Same trick as Site::LoadConfig: new type, old state bits */
+      T remapped = elt->GetDefaultAtom();
+      for (u32 b = T::ATOM_FIRST_STATE_BIT; b < T::BPA; ++b)
+      {
+        remapped.GetBits().StoreBit(b, atom.GetBits().ReadBit(b));
+      }
+      atom = remapped;
+      return;
+    }
+  }
+
+  template <class GC>
+  bool GridSnapshot<GC>::ReadElementTable(Grid<GC> & grid, const u8 * & at, const u8 * limit,
+                                          u32 elementCount, TypeMapping * mappings, const char * path)
+  {
+    ElementRegistry<EC> & er = grid.GetElementRegistry();
+    for (u32 i = 0; i < elementCount; ++i)
+    {
+      ElementHeader eh;
+      if ((u64) (limit - at) < sizeof(eh))
+      {
+        LOG.Error("Snapshot '%s' element table is truncated", path);
+        return false;
+      }
+      memcpy(&eh, at, sizeof(eh));
+      at += sizeof(eh);
+
+      if (eh.m_uuidBytes > MAX_UUID_BYTES || (u64) (limit - at) < Padded(eh.m_uuidBytes))
+      {
+        LOG.Error("Snapshot '%s' element table is truncated", path);
+        return false;
+      }
+
+      CharBufferByteSource cbs((const char *) at, eh.m_uuidBytes);
+      at += Padded(eh.m_uuidBytes);
+
+      UUID uuid;
+      if (!uuid.Read(cbs))
+      {
+        LOG.Error("Bad UUID in snapshot '%s' element table", path);
+        return false;
+      }
+
+      const Element<EC> * elt = er.Lookup(uuid);
+      if (!elt)
+        elt = grid.NeedDeferredElement(uuid);
+      if (!elt)
+        elt = er.LookupCompatible(uuid);
+      if (!elt)
+      {
+        LOG.Error("Snapshot '%s' needs unknown element '%@'", path, &uuid);
+        return false;
+      }
+
+      mappings[i].m_savedType = eh.m_type;
+      mappings[i].m_element = elt;
+    }
+    return true;
+  }
+
+  template <class GC>
+  const u8 * GridSnapshot<GC>::MapFile(const char * path, u64 & fileBytes)
+  {
+    s32 fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+      LOG.Error("Can't open snapshot '%s': %s", path, strerror(errno));
+      return 0;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (u64) st.st_size < sizeof(FileHeader))
+    {
+      LOG.Error("Snapshot '%s' is truncated", path);
+      close(fd);
+      return 0;
+    }
+
+    fileBytes = (u64) st.st_size;
+    void * mapped = mmap(0, fileBytes, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);  // The mapping holds its own reference
+
+    if (mapped == MAP_FAILED)
+    {
+      LOG.Error("Can't map snapshot '%s': %s", path, strerror(errno));
+      return 0;
+    }
+    return (const u8 *) mapped;
+  }
+
+  template <class GC>
+  const u8 * GridSnapshot<GC>::GetTileRecord(const FileHeader & header, bool compressed,
+                                             const u8 * base, const u8 * tiles, const u8 * limit,
+                                             u32 t, u8 * scratch, const char * path)
+  {
+    const u32 tileSites = header.m_tileWidth * header.m_tileHeight;
+    const u64 recordBytes = sizeof(TileHeader) + 2 * (u64) tileSites * sizeof(T);
+
+    if (!compressed)
+    {
+      if ((u64) (limit - tiles) < (t + 1) * recordBytes)
+      {
+        LOG.Error("Snapshot '%s' is truncated", path);
+        return 0;
+      }
+      return tiles + t * recordBytes;
+    }
+
+    typedef GridSnapshotWriter::BlockIndexEntry BlockIndexEntry;
+    const u64 indexBytes = (u64) header.m_tileCount * sizeof(BlockIndexEntry);
+    if ((u64) (limit - tiles) < indexBytes)
+    {
+      LOG.Error("Snapshot '%s' is truncated", path);
+      return 0;
+    }
+
+    BlockIndexEntry bie;
+    memcpy(&bie, tiles + t * sizeof(bie), sizeof(bie));
+    const u64 fileBytes = (u64) (limit - base);
+    if (bie.m_rawBytes != recordBytes ||
+        bie.m_offset < (u64) (tiles - base) + indexBytes ||
+        bie.m_offset > fileBytes ||
+        bie.m_packedBytes > fileBytes - bie.m_offset ||
+        !LZBlock::Decompress(base + bie.m_offset, bie.m_packedBytes, scratch, bie.m_rawBytes))
+    {
+      LOG.Error("Snapshot '%s' tile record %d is damaged", path, t);
+      return 0;
+    }
+    return scratch;
+  }
+
+  template <class GC>
+  void GridSnapshot<GC>::ApplyTileRecord(Grid<GC> & grid, const u8 * record, u32 tileSites,
+                                         const TypeMapping * mappings, u32 mappingCount)
+  {
+    TileHeader th;
+    memcpy(&th, record, sizeof(th));
+
+    typename Grid<GC>::GridTile & tile = grid.GetGridTile(SPoint(th.m_tileX, th.m_tileY));
+    /* Everything in the file is padded to 4 bytes, which is all
+       the alignment an atom's bit vector needs */
+    const T * atoms = (const T *) (record + sizeof(th));
+    const T * bases = atoms + tileSites;
+
+    S * sites = tile.GetAllSites();
+    for (u32 sn = 0; sn < tileSites; ++sn)
+    {
+      S & site = sites[sn];
+
+      T atom = atoms[sn];
+      RemapType(atom, mappings, mappingCount);
+      site.GetAtom() = atom;
+
+      T baseAtom = bases[sn];
+      RemapType(baseAtom, mappings, mappingCount);
+      if (((const S &) site).GetBase().GetBaseAtom() != baseAtom)
+      {
+        site.GetBase().PutBaseAtom(baseAtom);  // Else leave any Base layer unwritten
+      }
+    }
+
+    tile.GetEventWindow().SetEventWindowsExecuted(th.m_eventsExecuted);
+    tile.GetEventWindow().SetEventWindowsAttempted(th.m_eventsAttempted);
+  }
+
+  template <class GC>
+  bool GridSnapshot<GC>::Load(Grid<GC> & grid, const char * path)
+  {
+    MFM_API_ASSERT_NONNULL(path);
+
+    u64 fileBytes;
+    const u8 * const base = MapFile(path, fileBytes);
+    if (!base)
+    {
+      return false;
+    }
+    const u8 * const limit = base + fileBytes;
+    const u8 * at = base;
+
+    FileHeader header;
+    memcpy(&header, at, sizeof(header));
+    at += sizeof(header);
+
+    bool ok = CheckHeader(grid, header, path);
+    const bool compressed = header.m_magic == SNAPSHOT_Z_MAGIC;
+
+    /* Map each saved type to an element known now */
+    TypeMapping * mappings = new TypeMapping[header.m_elementCount > 0 ? header.m_elementCount : 1];
+    ok = ok && ReadElementTable(grid, at, limit, header.m_elementCount, mappings, path);
+
+    /* Check every tile record fits before touching the grid */
+    const u32 tileSites = header.m_tileWidth * header.m_tileHeight;
+    const u64 recordBytes = sizeof(TileHeader) + 2 * (u64) tileSites * sizeof(T);
+    const u8 * const tiles = at;
+    if (ok && !compressed && (u64) (limit - tiles) != header.m_tileCount * recordBytes)
+    {
+      LOG.Error("Snapshot '%s' is truncated", path);
+      ok = false;
+    }
+
+    /* A compressed snapshot is inflated whole, up front, so a damaged
+       block is found before the grid is touched */
+    const u32 tileCount = ok ? header.m_tileCount : 0;
+    const u8 ** records = new const u8 * [tileCount > 0 ? tileCount : 1];
+    u8 * inflated = compressed && tileCount > 0 ? new u8[tileCount * recordBytes] : 0;
+    for (u32 t = 0; ok && t < tileCount; ++t)
+    {
+      records[t] = GetTileRecord(header, compressed, base, tiles, limit,
+                                 t, inflated + t * recordBytes, path);
+      ok = records[t] != 0;
+    }
+
+    /* With the count matching, no repeats means every tile is there */
+    bool * seen = new bool[grid.GetWidth() * grid.GetHeight()];
+    memset(seen, 0, grid.GetWidth() * grid.GetHeight() * sizeof(bool));
+    for (u32 t = 0; ok && t < tileCount; ++t)
+    {
+      TileHeader th;
+      memcpy(&th, records[t], sizeof(th));
+      const SPoint tileInGrid(th.m_tileX, th.m_tileY);
+      if (!grid.IsLegalTileIndex(tileInGrid) || grid.GetTile(tileInGrid).IsDummyTile())
+      {
+        LOG.Error("Snapshot '%s' has illegal tile (%d,%d)", path, th.m_tileX, th.m_tileY);
+        ok = false;
+      }
+      else if (seen[th.m_tileY * grid.GetWidth() + th.m_tileX])
+      {
+        LOG.Error("Snapshot '%s' has tile (%d,%d) twice", path, th.m_tileX, th.m_tileY);
+        ok = false;
+      }
+      else
+      {
+        seen[th.m_tileY * grid.GetWidth() + th.m_tileX] = true;
+      }
+    }
+    delete [] seen;
+
+    if (ok)
+    {
+      grid.Clear();
+
+      for (u32 t = 0; t < tileCount; ++t)
+      {
+        ApplyTileRecord(grid, records[t], tileSites, mappings, header.m_elementCount);
+      }
+
+      grid.RefreshAllCaches();
+      grid.RecountAtoms();
+    }
+
+    delete [] inflated;
+    delete [] records;
+    delete [] mappings;
+    munmap((void *) base, fileBytes);
+
+    return ok;
+  }
+
+  template <class GC>
+  bool GridSnapshot<GC>::LoadTile(Grid<GC> & grid, const char * path, const SPoint & tileInGrid)
+  {
+    MFM_API_ASSERT_NONNULL(path);
+
+    if (!grid.IsLegalTileIndex(tileInGrid) || grid.GetTile(tileInGrid).IsDummyTile())
+    {
+      LOG.Error("No tile (%d,%d) to load from snapshot '%s'",
+                tileInGrid.GetX(), tileInGrid.GetY(), path);
+      return false;
+    }
+
+    /* Records are in grid iteration order */
+    u32 t = 0;
+    for (typename Grid<GC>::iterator_type i = grid.begin(); i != grid.end() && i.At() != tileInGrid; ++i)
+    {
+      ++t;
+    }
+
+    u64 fileBytes;
+    const u8 * const base = MapFile(path, fileBytes);
+    if (!base)
+    {
+      return false;
+    }
+    const u8 * const limit = base + fileBytes;
+    const u8 * at = base;
+
+    FileHeader header;
+    memcpy(&header, at, sizeof(header));
+    at += sizeof(header);
+
+    bool ok = CheckHeader(grid, header, path);
+    const bool compressed = header.m_magic == SNAPSHOT_Z_MAGIC;
+
+    TypeMapping * mappings = new TypeMapping[header.m_elementCount > 0 ? header.m_elementCount : 1];
+    ok = ok && ReadElementTable(grid, at, limit, header.m_elementCount, mappings, path);
+
+    const u32 tileSites = header.m_tileWidth * header.m_tileHeight;
+    const u64 recordBytes = sizeof(TileHeader) + 2 * (u64) tileSites * sizeof(T);
+    u8 * scratch = compressed ? new u8[recordBytes] : 0;
+    const u8 * record = 0;
+    if (ok && t >= header.m_tileCount)
+    {
+      LOG.Error("Snapshot '%s' has no record for tile (%d,%d)",
+                path, tileInGrid.GetX(), tileInGrid.GetY());
+      ok = false;
+    }
+    if (ok)
+    {
+      record = GetTileRecord(header, compressed, base, at, limit, t, scratch, path);
+      ok = record != 0;
+    }
+    if (ok)
+    {
+      TileHeader th;
+      memcpy(&th, record, sizeof(th));
+      if (SPoint(th.m_tileX, th.m_tileY) != tileInGrid)
+      {
+        LOG.Error("Snapshot '%s' record %d is for tile (%d,%d), not (%d,%d)",
+                  path, t, th.m_tileX, th.m_tileY, tileInGrid.GetX(), tileInGrid.GetY());
+        ok = false;
+      }
+    }
+
+    if (ok)
+    {
+      ApplyTileRecord(grid, record, tileSites, mappings, header.m_elementCount);
+      grid.RefreshAllCaches();
+      grid.RecountAtoms();
+    }
+
+    delete [] scratch;
+    delete [] mappings;
+    munmap((void *) base, fileBytes);
+
+    return ok;
+  }
+} /* namespace MFM */
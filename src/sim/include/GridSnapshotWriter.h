@@ -0,0 +1,179 @@
+/*                                              -*- mode:C++ -*-
+  GridSnapshotWriter.h Background writer for captured grid snapshots
+  Copyright (C) 2014-2016 The Regents of the University of New Mexico.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+  USA
+*/
+
+/**
+  \file GridSnapshotWriter.h Background writer for captured grid snapshots
+  \date (C) 2014-2016 All rights reserved.
+  \lgpl
+ */
+#ifndef GRIDSNAPSHOTWRITER_H
+#define GRIDSNAPSHOTWRITER_H
+
+#include "itype.h"
+#include "OverflowableCharBufferByteSink.h"
+#include <pthread.h>
+
+namespace MFM
+{
+  /**
+     A GridSnapshotWriter owns a staging arena that a paused grid is
+     copied into (by GridSnapshot::Capture), and a background thread
+     that writes the arena to disk after the grid has resumed.  Only
+     one write is in flight at a time: starting a new capture first
+     waits for the previous write to finish, so the arena is never
+     overwritten while it is being written.
+
+     A compressed write treats the arena as a prefix followed by
+     equal-sized blocks, and compresses each block independently with
+     LZBlock, spread over COMPRESS_THREADS threads, before writing the
+     prefix, an index of BlockIndexEntry records locating each block,
+     and the compressed blocks, each padded to a multiple of 4 bytes.
+   */
+  class GridSnapshotWriter
+  {
+  public:
+
+    enum { COMPRESS_THREADS = 4 };
+
+    /** Where one block of a compressed write went */
+    struct BlockIndexEntry
+    {
+      u64 m_offset;             // From the start of the file
+      u32 m_rawBytes;
+      u32 m_packedBytes;
+    };
+
+    GridSnapshotWriter() ;
+
+    /**
+     * Waits for any write in progress, then frees the arena.
+     */
+    ~GridSnapshotWriter() ;
+
+    /**
+     * Waits for any write in progress, then returns an arena of at
+     * least \a bytes bytes for the next snapshot image.
+     */
+    u8 * BeginCapture(u32 bytes) ;
+
+    /**
+     * Starts writing the first \a bytes bytes of the arena to the
+     * file \a path on a background thread, and returns immediately.
+     * The arena must have been filled by a preceding BeginCapture.
+     */
+    void StartWrite(const char * path, u32 bytes) ;
+
+    /**
+     * Like StartWrite, but the arena holds \a prefixBytes bytes
+     * followed by \a blockCount blocks of \a blockBytes each, which
+     * are compressed on the background thread as they are written.
+     */
+    void StartCompressedWrite(const char * path, u32 prefixBytes, u32 blockBytes, u32 blockCount) ;
+
+    /**
+     * Waits for any write in progress.
+     *
+     * @returns false if the most recent write failed, else true.
+     */
+    bool Finish() ;
+
+    /**
+     * Is a background write still (possibly) in progress?
+     */
+    bool IsWriting() const
+    {
+      return m_writing;
+    }
+
+    /**
+     * Bytes the most recent write had to write before any
+     * compression.  Like the other statistics of the most recent
+     * write, meaningful only after Finish.
+     */
+    u64 GetLastRawBytes() const
+    {
+      return m_lastRawBytes;
+    }
+
+    /**
+     * Bytes the most recent write put on disk
+     */
+    u64 GetLastFileBytes() const
+    {
+      return m_lastFileBytes;
+    }
+
+    /**
+     * Milliseconds the most recent write spent compressing; 0 if it
+     * wasn't compressed
+     */
+    u32 GetLastCompressMS() const
+    {
+      return m_lastCompressMS;
+    }
+  private:
+    u8 * m_arena;
+    u32 m_arenaCapacity;
+    u32 m_writeBytes;
+    OString512 m_path;
+
+    /* A compressed write's layout, and its scratch */
+    u32 m_blockBytes;           // 0 if not compressing
+    u32 m_blockCount;
+    u8 * m_packed;              // A slot of GetPackedSlotBytes() per block
+    u32 m_packedCapacity;
+    BlockIndexEntry * m_index;
+    u32 m_indexCapacity;
+
+    u64 m_lastRawBytes;
+    u64 m_lastFileBytes;
+    u32 m_lastCompressMS;
+
+    pthread_t m_thread;
+    bool m_writing;
+    bool m_lastWriteOk;
+
+    void SetPath(const char * path) ;
+
+    /** Write the arena on the background thread, or here if need be */
+    void Launch() ;
+
+    static void * WriterRunner(void * arg) ;
+
+    bool WriteArena() ;
+
+    u32 GetPackedSlotBytes() const ;
+
+    /** Compress every \a stride 'th block, starting at \a first */
+    void CompressBlocks(u32 first, u32 stride) ;
+
+    void CompressAllBlocks() ;
+
+    static void * CompressRunner(void * arg) ;
+
+    static bool WriteAll(s32 fd, const u8 * at, u64 bytes, const char * path) ;
+
+    // Declare away; the arena and thread are not copyable
+    GridSnapshotWriter(const GridSnapshotWriter &) ;
+    GridSnapshotWriter & operator=(const GridSnapshotWriter &) ;
+  };
+} /* namespace MFM */
+
+#endif /* GRIDSNAPSHOTWRITER_H */
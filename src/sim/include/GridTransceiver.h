@@ -28,6 +28,7 @@
 #define GRIDTRANSCEIVER_H
 
 #include "Mutex.h"
+#include "Util.h"  // For MIN
 #include "AbstractChannel.h"
 
 namespace MFM
@@ -202,6 +203,14 @@ namespace MFM
     If we set the in-flight data limit to 0, then v will track t
     exactly.
 
+    For in-process simulations that don't need any of that, \e direct
+    mode (SetDirectMode) collapses w, t, and v into one index: written
+    bytes are readable at once, Advance does nothing, and since each
+    direction then has one writer (moving w) and one reader (moving
+    r), the access mutex is skipped in favor of memory barriers.  The
+    ReserveWrite/CommitWrite and PeekRead/ConsumeRead spans work in
+    either mode, letting callers fill and drain the buffers in place.
+
    */
   class GridTransceiver : public AbstractChannel
   {
@@ -218,6 +227,11 @@ namespace MFM
     {
       FailUnlessEnabled();
 
+      if (m_directMode)
+      {
+        return GetOutputChannel(byA).CanWrite();
+      }
+
       Mutex::ScopeLock lock(m_access);
       return GetOutputChannel(byA).CanWrite();
     }
@@ -230,8 +244,18 @@ namespace MFM
     {
       FailUnlessEnabled();
 
-      Mutex::ScopeLock lock(m_access);
-      return GetOutputChannel(byA).Write(data, length);
+      u32 written;
+      if (m_directMode)
+      {
+        written = GetOutputChannel(byA).Write(data, length, true);
+      }
+      else
+      {
+        Mutex::ScopeLock lock(m_access);
+        written = GetOutputChannel(byA).Write(data, length, false);
+      }
+      NoteWritten(byA, written);
+      return written;
     }
 
     /**
@@ -242,6 +266,11 @@ namespace MFM
     {
       FailUnlessEnabled();
 
+      if (m_directMode)
+      {
+        return GetInputChannel(byA).CanRead();
+      }
+
       Mutex::ScopeLock lock(m_access);
       return GetInputChannel(byA).CanRead();
     }
@@ -254,15 +283,140 @@ namespace MFM
     {
       FailUnlessEnabled();
 
+      if (m_directMode)
+      {
+        return GetInputChannel(byA).Read(data, length);
+      }
+
       Mutex::ScopeLock lock(m_access);
       return GetInputChannel(byA).Read(data, length);
     }
 
+    /**
+       \copydoc AbstractChannel::ReserveWrite
+       \fail ILLEGAL_STATE if the GridTransceiver is not enabled
+    */
+    virtual u32 ReserveWrite(bool byA, u8 * & span)
+    {
+      FailUnlessEnabled();
+
+      if (m_directMode)
+      {
+        return GetOutputChannel(byA).ReserveWrite(span);
+      }
+
+      Mutex::ScopeLock lock(m_access);
+      return GetOutputChannel(byA).ReserveWrite(span);
+    }
+
+    /**
+       \copydoc AbstractChannel::CommitWrite
+       \fail ILLEGAL_STATE if the GridTransceiver is not enabled
+    */
+    virtual void CommitWrite(bool byA, u32 length)
+    {
+      FailUnlessEnabled();
+
+      if (m_directMode)
+      {
+        GetOutputChannel(byA).CommitWrite(length, true);
+      }
+      else
+      {
+        Mutex::ScopeLock lock(m_access);
+        GetOutputChannel(byA).CommitWrite(length, false);
+      }
+      NoteWritten(byA, length);
+    }
+
+    /**
+       \copydoc AbstractChannel::PeekRead
+       \fail ILLEGAL_STATE if the GridTransceiver is not enabled
+    */
+    virtual u32 PeekRead(bool byA, const u8 * & span)
+    {
+      FailUnlessEnabled();
+
+      if (m_directMode)
+      {
+        return GetInputChannel(byA).PeekRead(span);
+      }
+
+      Mutex::ScopeLock lock(m_access);
+      return GetInputChannel(byA).PeekRead(span);
+    }
+
+    /**
+       \copydoc AbstractChannel::ConsumeRead
+       \fail ILLEGAL_STATE if the GridTransceiver is not enabled
+    */
+    virtual void ConsumeRead(bool byA, u32 length)
+    {
+      FailUnlessEnabled();
+
+      if (m_directMode)
+      {
+        GetInputChannel(byA).ConsumeRead(length);
+        return;
+      }
+
+      Mutex::ScopeLock lock(m_access);
+      GetInputChannel(byA).ConsumeRead(length);
+    }
+
     // END AbstractChannel interface
     ////
 
+    /**
+       Something to tell when bytes are written toward one side of a
+       GridTransceiver, so a reader that has stopped polling can be
+       woken.  \sa SetWriteListener
+     */
+    struct WriteListener
+    {
+      virtual ~WriteListener() { }
+
+      /** Called by the writing thread, after its bytes are committed */
+      virtual void BytesWritten() = 0;
+    };
+
     GridTransceiver() ;
 
+    /**
+       Tell \c listener (or, if it is 0, nobody) whenever bytes are
+       written toward side \c onSideA.  Set listeners before traffic
+       starts.
+     */
+    void SetWriteListener(bool onSideA, WriteListener * listener)
+    {
+      m_listeners[IdxOf(onSideA)] = listener;
+    }
+
+    /**
+       Get the number of bytes written toward side \c onSideA that it
+       has not yet read, whether or not they have arrived.
+     */
+    u32 GetUnreadBytes(bool onSideA)
+    {
+      if (m_directMode)
+      {
+        return GetInputChannel(onSideA).Unread();
+      }
+
+      Mutex::ScopeLock lock(m_access);
+      return GetInputChannel(onSideA).Unread();
+    }
+
+    /**
+       Return true iff any bytes, in either direction, have been
+       written but are not yet readable.  Never true in direct mode.
+     */
+    bool IsInTransit()
+    {
+      Mutex::ScopeLock lock(m_access);
+      return IsInTransitLocked();
+    }
+
     /**
        Enable or disable this GridTransceiver.  When a GridTransceiver
        is disabled, the only AbstractChannel interface method that can
@@ -286,6 +440,42 @@ namespace MFM
       return m_enabled;
     }
 
+    /**
+       Enable or disable direct mode, in which written bytes are
+       immediately readable by the far side, with no simulated data
+       rate or bytes in flight, and without taking the access mutex.
+       Direct mode requires a single writer and a single reader per
+       direction, and may only be changed while no bytes are in
+       transit, or in flight, in either direction.
+
+       \fail ILLEGAL_STATE if bytes are between writer and reader
+
+       \sa IsDirectMode
+     */
+    void SetDirectMode(bool direct)
+    {
+      bool inTransit;
+      {
+        Mutex::ScopeLock lock(m_access);
+        inTransit = IsInTransitLocked();
+        if (!inTransit)
+        {
+          m_directMode = direct;
+        }
+      }
+      MFM_API_ASSERT_STATE(!inTransit);  // FAIL only once unlocked
+    }
+
+    /**
+       Return true iff this GridTransceiver is in direct mode.
+
+       \sa SetDirectMode
+     */
+    bool IsDirectMode() const
+    {
+      return m_directMode;
+    }
+
     /**
        Simulate channel communications given the actual wall clock
        time is now.  Return true if any communications occurred.
@@ -349,6 +539,25 @@ namespace MFM
 
     Mutex m_access;
 
+    WriteListener * m_listeners[2];
+
+    /** Tell the far side's listener, if any, that \c byA wrote \c length bytes */
+    void NoteWritten(bool byA, u32 length)
+    {
+      WriteListener * listener = m_listeners[IdxOf(!byA)];
+      if (listener && length > 0)
+      {
+        listener->BytesWritten();
+      }
+    }
+
+    bool IsInTransitLocked()
+    {
+      return
+        m_channelAtoB.CanXmit() > 0 || m_channelAtoB.CanRcv() > 0 ||
+        m_channelBtoA.CanXmit() > 0 || m_channelBtoA.CanRcv() > 0;
+    }
+
     bool Transceive(u32 maxBytes, u32 maxInFlight)
     {
       bool didWork = false;
@@ -365,6 +574,9 @@ namespace MFM
     };
 
     bool m_enabled;
+
+    bool m_directMode;
+
     void FailUnlessEnabled()
     {
       if (!m_enabled)
@@ -388,7 +600,7 @@ namespace MFM
         return (idxHi + BUFFER_SIZE - idxLo) % BUFFER_SIZE;
       }
 
-      static void Increment(u32 & var, u32 amount = 1)
+      static void Increment(volatile u32 & var, u32 amount = 1)
       {
         var = (var + amount) % BUFFER_SIZE;
       }
@@ -428,29 +640,56 @@ namespace MFM
         return BytesBetween(m_xmitIndex, m_rcvIndex);
       }
 
-      u32 Write(const u8 * data, u32 length) ;
+      u32 Unread()
+      {
+        return BytesBetween(m_writeIndex, m_readIndex);
+      }
+
+      /**
+       * Append up to length bytes.  If direct, they are immediately
+       * readable; otherwise they await Transceive.
+       */
+      u32 Write(const u8 * data, u32 length, bool direct) ;
 
       u32 Read(u8 * data, u32 length) ;
 
+      u32 ReserveWrite(u8 * & span)
+      {
+        span = &m_data[m_writeIndex];
+        return MIN(CanWrite(), BUFFER_SIZE - m_writeIndex);
+      }
+
+      void CommitWrite(u32 length, bool direct) ;
+
+      u32 PeekRead(const u8 * & span)
+      {
+        u32 avail = CanRead();  // Fetch rcv index before the data
+        __sync_synchronize();
+        span = &m_data[m_readIndex];
+        return MIN(avail, BUFFER_SIZE - m_readIndex);
+      }
+
+      void ConsumeRead(u32 length) ;
+
       /**
        * Next data byte to be written goes here
        */
-      u32 m_writeIndex;
+      volatile u32 m_writeIndex;
 
       /**
        * Next written byte to be transmitted is here
        */
-      u32 m_xmitIndex;
+      volatile u32 m_xmitIndex;
 
       /**
        * Next transmitted byte to be received goes here
        */
-      u32 m_rcvIndex;
+      volatile u32 m_rcvIndex;
 
       /**
        * Next received byte to be read is here
        */
-      u32 m_readIndex;
+      volatile u32 m_readIndex;
 
       u8 m_data[BUFFER_SIZE];
     };
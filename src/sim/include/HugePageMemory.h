@@ -0,0 +1,78 @@
+/*                                              -*- mode:C++ -*-
+  HugePageMemory.h Big allocations that can be backed by huge pages
+  Copyright (C) 2020 The Living Computation Foundation.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+  USA
+*/
+
+/**
+  \file HugePageMemory.h Big allocations that can be backed by huge pages
+  \author David H. Ackley.
+  \date (C) 2020 All rights reserved.
+  \lgpl
+ */
+#ifndef HUGEPAGEMEMORY_H
+#define HUGEPAGEMEMORY_H
+
+#include "itype.h"
+#include "Fail.h"
+
+namespace MFM
+{
+  /**
+     Anonymous memory mapped on HUGE_PAGE_SIZE boundaries, so that all
+     of it can later be moved onto transparent huge pages.  Grid keeps
+     its tiles here: a grid's tiles are one big array, mostly sites,
+     and on small pages its random event windows
+     spend a lot of time missing the TLB.
+
+     Mapping aligned costs nothing by itself; pages stay small until
+     Advise asks for huge ones.
+   */
+  class HugePageMemory
+  {
+  public:
+    enum { HUGE_PAGE_SIZE = 2 * 1024 * 1024 };
+
+    /**
+       Map \a bytes of zeroed memory starting on a HUGE_PAGE_SIZE
+       boundary.  \fail OUT_OF_RESOURCES if it can't be had.
+     */
+    static void * Allocate(u64 bytes) ;
+
+    /** Unmap \a bytes at \a addr, as returned by Allocate(bytes) */
+    static void Free(void * addr, u64 bytes) ;
+
+    /**
+       Ask for [\a addr, \a addr + \a bytes) to be backed by
+       transparent huge pages, collapsing any already-touched pages
+       right away where the kernel supports that (else khugepaged
+       gets to them eventually).  \returns false (with a logged
+       warning) if the kernel refuses.
+     */
+    static bool Advise(void * addr, u64 bytes) ;
+
+    /**
+       Add up, from /proc/self/smaps, how much of [\a addr, \a addr +
+       \a bytes) is resident, and how much of that is on huge pages.
+       \returns false if smaps can't be read.
+     */
+    static bool GetResidency(const void * addr, u64 bytes,
+                             u64 & residentBytes, u64 & hugeBytes) ;
+  };
+} /* namespace MFM */
+
+#endif /* HUGEPAGEMEMORY_H */
@@ -0,0 +1,146 @@
+/*                                              -*- mode:C++ -*-
+  MetricsServer.h Serve live simulation metrics over HTTP
+  Copyright (C) 2020 The Living Computation Foundation.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+  USA
+*/
+
+/**
+  \file MetricsServer.h Serve live simulation metrics over HTTP
+  \author David H. Ackley.
+  \date (C) 2020 All rights reserved.
+  \lgpl
+ */
+#ifndef METRICSSERVER_H
+#define METRICSSERVER_H
+
+#include "itype.h"
+#include "Fail.h"
+#include "OverflowableCharBufferByteSink.h"
+#include <pthread.h>
+
+namespace MFM
+{
+  /**
+     A minimal HTTP server, on its own thread, answering every GET
+     with the latest published metrics page -- Prometheus text
+     exposition format, say.
+
+     The simulation side writes a fresh page into GetUpdateSink()
+     between BeginUpdate() and EndUpdate(), which copies it into the
+     published page under a sequence count.  Scrapes copy the
+     published page out and retry if the count moved meanwhile, so
+     neither side ever waits for the other, and a slow or stuck
+     client can't hold up the simulation.
+   */
+  class MetricsServer
+  {
+  public:
+    enum {
+      PAGE_BYTES = 16384,
+      POLL_MSEC = 200,          // How often the server checks for Stop
+      CLIENT_TIMEOUT_SEC = 2,   // For reading a request, or writing a reply
+      REQUEST_BYTES = 2048      // Longest request we'll read
+    };
+
+    MetricsServer() ;
+
+    /** Stops the server if it's running */
+    ~MetricsServer() ;
+
+    /**
+       Listen on TCP \c port (0 for any free port) of all local
+       interfaces, and start the server thread.
+
+       \fail IO_ERROR if the port can't be opened
+       \fail ILLEGAL_STATE if already running
+     */
+    void Start(u16 port) ;
+
+    /** Stop the server thread and close the port, if running */
+    void Stop() ;
+
+    bool IsRunning() const
+    {
+      return m_listenFd >= 0;
+    }
+
+    /** The port actually being listened on, once running */
+    u16 GetPort() const
+    {
+      return m_port;
+    }
+
+    /** GET requests answered so far */
+    u64 GetScrapeCount() const
+    {
+      return __atomic_load_n(&m_scrapes, __ATOMIC_RELAXED);
+    }
+
+    /**
+       Start composing a new page into GetUpdateSink().  Only one
+       thread may publish.
+     */
+    void BeginUpdate()
+    {
+      m_staging.Reset();
+    }
+
+    ByteSink & GetUpdateSink()
+    {
+      return m_staging;
+    }
+
+    /**
+       Publish the page composed since BeginUpdate.  A page that
+       overflowed PAGE_BYTES is published truncated.
+     */
+    void EndUpdate() ;
+
+    /**
+       Copy the latest published page into \c buf , of \c size
+       bytes, null-terminated.  \returns its length, less any that
+       didn't fit.  Safe from any thread.
+     */
+    u32 CopyPage(char * buf, u32 size) const ;
+
+  private:
+    OverflowableCharBufferByteSink<PAGE_BYTES> m_staging;
+
+    /* The published page, guarded by the m_sequence seqlock */
+    u32 m_sequence;             // Odd while EndUpdate is copying
+    u32 m_pageLength;
+    char m_page[PAGE_BYTES];
+
+    s32 m_listenFd;             // -1 when not running
+    u16 m_port;
+    u32 m_stopRequested;
+    u64 m_scrapes;
+    pthread_t m_thread;
+
+    static void * Run(void * arg) ;
+
+    void Serve(s32 fd) ;
+
+    static bool WriteAll(s32 fd, const char * data, u32 length) ;
+
+    // Declare away
+    MetricsServer(const MetricsServer &) ;
+    MetricsServer & operator=(const MetricsServer &) ;
+  };
+}
+
+#endif /* METRICSSERVER_H */
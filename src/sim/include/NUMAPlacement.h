@@ -0,0 +1,104 @@
+/*                                              -*- mode:C++ -*-
+  NUMAPlacement.h Pinning tile threads and memory to NUMA nodes
+  Copyright (C) 2014-2016 The Regents of the University of New Mexico.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+  USA
+*/
+
+/**
+  \file NUMAPlacement.h Pinning tile threads and memory to NUMA nodes
+  \date (C) 2014-2016 All rights reserved.
+  \lgpl
+ */
+#ifndef NUMAPLACEMENT_H
+#define NUMAPLACEMENT_H
+
+#include "itype.h"
+#include <pthread.h>
+
+namespace MFM
+{
+  /**
+     A NUMAPlacement holds the machine's NUMA topology, as read from
+     /sys/devices/system/node, and knows how to pin a thread to a cpu
+     and move a range of memory onto a node.  Grid uses one, when
+     asked, to put each tile's thread on a cpu of the node that holds
+     the tile's sites and event history, assigning nodes to bands of
+     neighboring tiles so that most intertile traffic stays on one
+     socket.
+
+     Without NUMA information (or on a single node machine) every
+     online cpu is treated as belonging to node 0, which still pins
+     threads but moves no memory.
+   */
+  class NUMAPlacement
+  {
+  public:
+    enum
+    {
+      MAX_NODES = 64,
+      MAX_CPUS = 1024
+    };
+
+    NUMAPlacement() ;
+
+    /**
+       Read the NUMA topology.  \returns true if at least one cpu was
+       found; otherwise this NUMAPlacement is empty.
+     */
+    bool Discover() ;
+
+    u32 GetNodeCount() const
+    {
+      return m_nodeCount;
+    }
+
+    u32 GetCPUCount(u32 nodeIndex) const ;
+
+    /** The \a index'th cpu of node \a nodeIndex, modulo GetCPUCount */
+    u32 GetCPU(u32 nodeIndex, u32 index) const ;
+
+    /**
+       The node index (in [0,GetNodeCount())) for the tile at (\a x,
+       \a y) in a \a width by \a height grid. Nodes get equal bands of
+       tiles cut across the longer grid dimension.
+     */
+    u32 GetNodeForTile(u32 x, u32 y, u32 width, u32 height) const ;
+
+    /**
+       Restrict \a thread to run only on \a cpu.  \returns false (with
+       a logged warning) on failure.
+     */
+    static bool PinThread(pthread_t thread, u32 cpu) ;
+
+    /**
+       Bind the whole pages within [\a addr, \a addr + \a bytes) to
+       node \a nodeIndex, moving any already-touched pages there.
+       \returns false (with a logged warning) on failure.
+     */
+    bool BindMemory(void * addr, u64 bytes, u32 nodeIndex) const ;
+
+  private:
+    u32 m_nodeCount;
+    u32 m_nodeIds[MAX_NODES];         // System node number of each node index
+    u32 m_nodeFirstCPU[MAX_NODES + 1]; // Node i's cpus are m_cpus[first[i]..first[i+1])
+    u32 m_cpus[MAX_CPUS];
+
+    bool ParseCPUList(const char * list) ;
+  };
+} /* namespace MFM */
+
+#endif /* NUMAPLACEMENT_H */
@@ -0,0 +1,166 @@
+/*                                              -*- mode:C++ -*-
+  ShmChannel.h An AbstractChannel in POSIX shared memory
+  Copyright (C) 2020 The Living Computation Foundation.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+  USA
+*/
+
+/**
+  \file ShmChannel.h An AbstractChannel in POSIX shared memory
+  \author David H. Ackley.
+  \date (C) 2020 All rights reserved.
+  \lgpl
+ */
+#ifndef SHMCHANNEL_H
+#define SHMCHANNEL_H
+
+#include "itype.h"
+#include "Fail.h"
+#include "AbstractChannel.h"
+
+namespace MFM
+{
+  /**
+     An AbstractChannel whose two rings (A to B, and B to A) live in a
+     named POSIX shared memory object, so its A and B sides can be
+     used by different processes on one host.  Each process maps the
+     same name, one with \c create, and uses only its own side.
+
+     Like a direct-mode GridTransceiver, written bytes are readable at
+     once, and each ring has one writer and one reader, so no lock is
+     needed.  ReserveWrite and PeekRead spans point straight into the
+     shared rings, so bytes placed there are never copied again.  A
+     reader with nothing to do can sleep in WaitForInput, on a futex
+     that writers wake only when somebody is waiting.
+   */
+  class ShmChannel : public AbstractChannel
+  {
+  public:
+    enum { BUFFER_SIZE = 8192 };
+
+    /**
+       Map the shared memory object \c name (which should start with
+       '/').  If \c create, make it (it must not already exist) and
+       initialize it, else open one somebody else created.
+
+       \fail IO_ERROR if the object can't be created, opened, or
+       mapped, or if it isn't a ShmChannel
+     */
+    ShmChannel(const char * name, bool create) ;
+
+    /** Unmaps the rings.  Doesn't Unlink */
+    virtual ~ShmChannel() ;
+
+    /**
+       Remove the name, so no more processes can open it.  Already
+       mapped channels keep working.
+     */
+    void Unlink() ;
+
+    ////
+    // BEGIN AbstractChannel interface
+
+    /** \copydoc AbstractChannel::CanWrite */
+    virtual u32 CanWrite(bool byA) ;
+
+    /** \copydoc AbstractChannel::Write */
+    virtual u32 Write(bool byA, const u8 * data, u32 length) ;
+
+    /** \copydoc AbstractChannel::CanRead */
+    virtual u32 CanRead(bool byA) ;
+
+    /** \copydoc AbstractChannel::Read */
+    virtual u32 Read(bool byA, u8 * data, u32 length) ;
+
+    /** \copydoc AbstractChannel::ReserveWrite */
+    virtual u32 ReserveWrite(bool byA, u8 * & span) ;
+
+    /** \copydoc AbstractChannel::CommitWrite */
+    virtual void CommitWrite(bool byA, u32 length) ;
+
+    /** \copydoc AbstractChannel::PeekRead */
+    virtual u32 PeekRead(bool byA, const u8 * & span) ;
+
+    /** \copydoc AbstractChannel::ConsumeRead */
+    virtual void ConsumeRead(bool byA, u32 length) ;
+
+    // END AbstractChannel interface
+    ////
+
+    /**
+       Sleep until A (if byA) or B (if not) has something to read, or
+       \c maxUsec passes.  \returns CanRead(byA).
+     */
+    u32 WaitForInput(bool byA, u32 maxUsec) ;
+
+  private:
+    /**
+       One direction.  m_writeIndex is only moved by the writing side
+       and m_readIndex only by the reading side; m_waiters counts
+       readers asleep on m_writeIndex.
+     */
+    struct Ring
+    {
+      volatile u32 m_readIndex;
+      volatile u32 m_writeIndex;
+      volatile u32 m_waiters;
+      u8 m_pad[64 - 3 * sizeof(u32)];  // Keep the data off the indices' cache line
+      u8 m_data[BUFFER_SIZE];
+
+      u32 CanRead() const
+      {
+        return (m_writeIndex + BUFFER_SIZE - m_readIndex) % BUFFER_SIZE;
+      }
+
+      u32 CanWrite() const
+      {
+        return BUFFER_SIZE - 1 - CanRead();
+      }
+    };
+
+    struct Shared
+    {
+      u32 m_magic;
+      u32 m_size;
+      Ring m_aToB;
+      Ring m_bToA;
+    };
+
+    enum { SHARED_MAGIC = 0x4d464d43 }; // 'MFMC'
+
+    Ring & GetOutputRing(bool byA)
+    {
+      return byA ? m_shared->m_aToB : m_shared->m_bToA;
+    }
+
+    Ring & GetInputRing(bool byA)
+    {
+      return byA ? m_shared->m_bToA : m_shared->m_aToB;
+    }
+
+    /** Wake any reader sleeping on \c ring */
+    static void WakeReaders(Ring & ring) ;
+
+    Shared * m_shared;
+    char m_name[64];
+
+    // Declare away; the mapping is not copyable
+    ShmChannel(const ShmChannel &) ;
+    ShmChannel & operator=(const ShmChannel &) ;
+  };
+}
+
+#endif /* SHMCHANNEL_H */
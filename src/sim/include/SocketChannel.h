@@ -0,0 +1,225 @@
+/*                                              -*- mode:C++ -*-
+  SocketChannel.h An AbstractChannel to a tile in another process
+  Copyright (C) 2020 The Living Computation Foundation.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+  USA
+*/
+
+/**
+  \file SocketChannel.h An AbstractChannel to a tile in another process
+  \author David H. Ackley.
+  \date (C) 2020 All rights reserved.
+  \lgpl
+ */
+#ifndef SOCKETCHANNEL_H
+#define SOCKETCHANNEL_H
+
+#include "itype.h"
+#include "Fail.h"
+#include "AbstractChannel.h"
+
+namespace MFM
+{
+  /**
+     One end of an AbstractChannel whose other end is in another
+     process, across a connected stream socket.  Only the local side
+     (A or B, as given to the constructor) may be used here; the
+     remote process holds a SocketChannel for the other side.
+
+     Writes land in an output buffer and reads come from an input
+     buffer, exactly as with a direct-mode GridTransceiver.  Pump()
+     moves the bytes: it ships everything buffered for output in one
+     send(), and takes in whatever input has arrived in one recv(),
+     never blocking.  So packets written between pumps go out as one
+     batch.  Call Pump() from the thread driving the local tile,
+     where a GridTransceiver would be advanced; no locking is done.
+   */
+  class SocketChannel : public AbstractChannel
+  {
+  public:
+    enum { BUFFER_SIZE = 8192 };
+
+    /**
+       Take over \c fd, a connected stream socket, making it
+       nonblocking.  The local tile is side A if \c localIsA.
+
+       \fail IO_ERROR if \c fd cannot be made nonblocking
+     */
+    SocketChannel(s32 fd, bool localIsA) ;
+
+    /** Closes the socket */
+    virtual ~SocketChannel() ;
+
+    ////
+    // BEGIN AbstractChannel interface
+
+    /**
+       \copydoc AbstractChannel::CanWrite
+       \fail ILLEGAL_ARGUMENT if byA is the remote side
+    */
+    virtual u32 CanWrite(bool byA) ;
+
+    /**
+       \copydoc AbstractChannel::Write
+       \fail ILLEGAL_ARGUMENT if byA is the remote side
+    */
+    virtual u32 Write(bool byA, const u8 * data, u32 length) ;
+
+    /**
+       \copydoc AbstractChannel::CanRead
+       \fail ILLEGAL_ARGUMENT if byA is the remote side
+    */
+    virtual u32 CanRead(bool byA) ;
+
+    /**
+       \copydoc AbstractChannel::Read
+       \fail ILLEGAL_ARGUMENT if byA is the remote side
+    */
+    virtual u32 Read(bool byA, u8 * data, u32 length) ;
+
+    /**
+       \copydoc AbstractChannel::ReserveWrite
+       \fail ILLEGAL_ARGUMENT if byA is the remote side
+    */
+    virtual u32 ReserveWrite(bool byA, u8 * & span) ;
+
+    /**
+       \copydoc AbstractChannel::CommitWrite
+       \fail ILLEGAL_ARGUMENT if byA is the remote side
+    */
+    virtual void CommitWrite(bool byA, u32 length) ;
+
+    /**
+       \copydoc AbstractChannel::PeekRead
+       \fail ILLEGAL_ARGUMENT if byA is the remote side
+    */
+    virtual u32 PeekRead(bool byA, const u8 * & span) ;
+
+    /**
+       \copydoc AbstractChannel::ConsumeRead
+       \fail ILLEGAL_ARGUMENT if byA is the remote side
+    */
+    virtual void ConsumeRead(bool byA, u32 length) ;
+
+    // END AbstractChannel interface
+    ////
+
+    /**
+       Send buffered output and receive available input, without
+       blocking.  \returns true if any bytes moved.  Once the remote
+       end has closed (or the socket has failed), does nothing and
+       returns false.  \sa IsOpen
+     */
+    bool Pump() ;
+
+    /** false once the remote end has closed or the socket has failed */
+    bool IsOpen() const
+    {
+      return m_fd >= 0;
+    }
+
+    bool IsLocalSideA() const
+    {
+      return m_localIsA;
+    }
+
+    u64 GetBytesSent() const
+    {
+      return m_bytesSent;
+    }
+
+    u64 GetBytesReceived() const
+    {
+      return m_bytesReceived;
+    }
+
+    /**
+       \returns a socket listening for TCP connections on \c port of
+       all local interfaces
+
+       \fail IO_ERROR if that can't be done
+     */
+    static s32 ListenTCP(u16 port) ;
+
+    /**
+       Wait for and \returns the next connection to \c listenFd
+
+       \fail IO_ERROR on failure
+     */
+    static s32 AcceptTCP(s32 listenFd) ;
+
+    /**
+       \returns a socket connected to \c port on \c host (a name or
+       a numeric address), with Nagle's algorithm off, since Pump
+       already batches.
+
+       \fail IO_ERROR if no connection can be made
+     */
+    static s32 ConnectTCP(const char * host, u16 port) ;
+
+  private:
+    /**
+       A ring of bytes with one writer and one reader, holding at most
+       BUFFER_SIZE-1
+     */
+    struct Ring
+    {
+      u32 m_readIndex;
+      u32 m_writeIndex;
+      u8 m_data[BUFFER_SIZE];
+
+      Ring()
+        : m_readIndex(0)
+        , m_writeIndex(0)
+      { }
+
+      u32 CanRead() const
+      {
+        return (m_writeIndex + BUFFER_SIZE - m_readIndex) % BUFFER_SIZE;
+      }
+
+      u32 CanWrite() const
+      {
+        return BUFFER_SIZE - 1 - CanRead();
+      }
+
+      u32 ReserveWrite(u8 * & span) ;
+      void CommitWrite(u32 length) ;
+      u32 PeekRead(const u8 * & span) ;
+      void ConsumeRead(u32 length) ;
+    };
+
+    void FailUnlessLocal(bool byA) const
+    {
+      MFM_API_ASSERT_ARG(byA == m_localIsA);
+    }
+
+    void Close() ;
+
+    s32 m_fd;
+    const bool m_localIsA;
+    Ring m_output;
+    Ring m_input;
+    u64 m_bytesSent;
+    u64 m_bytesReceived;
+
+    // Declare away; the socket is not copyable
+    SocketChannel(const SocketChannel &) ;
+    SocketChannel & operator=(const SocketChannel &) ;
+  };
+}
+
+#endif /* SOCKETCHANNEL_H */
@@ -0,0 +1,168 @@
+/*                                              -*- mode:C++ -*-
+  SortingWork.h Useful work done by the Demon Horde Sort
+  Copyright (C) 2020 The Living Computation Foundation.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+  USA
+*/
+
+/**
+  \file SortingWork.h Useful work done by the Demon Horde Sort
+  \date (C) 2020 All rights reserved.
+  \lgpl
+ */
+#ifndef SORTINGWORK_H
+#define SORTINGWORK_H
+
+#include "itype.h"
+#include "Grid.h"
+#include "Element_Dreg.h"
+#include "Element_Res.h"
+#include "Element_Sorter.h"
+#include "Element_Data.h"
+#include "Element_Emitter.h"
+#include "Element_Consumer.h"
+
+namespace MFM
+{
+  /**
+     A SortingWork is a snapshot of the work the Demon Horde Sort has
+     done on a grid: Emitters inject Data on the east edge, Sorters
+     pass it along, and Consumers on the west edge take it out,
+     scoring how far each datum landed from its bucket.  Unlike
+     AEPS, which counts events whether they got anything done or
+     not, data sorted and consumed per second only go up when the
+     engine does more useful work -- so they're the better yardstick
+     for engine optimizations.
+
+     The counts are the elements' own element data, summed over the
+     grid's tiles by Capture, and are cumulative; Since gives the
+     work between two snapshots.
+   */
+  template <class GC>
+  class SortingWork
+  {
+    typedef typename GC::EVENT_CONFIG EC;
+    typedef typename EC::ATOM_CONFIG AC;
+    typedef typename AC::ATOM_TYPE T;
+
+  public:
+    SortingWork()
+      : m_emitted(0)
+      , m_rejected(0)
+      , m_sorted(0)
+      , m_consumed(0)
+      , m_bucketError(0)
+    { }
+
+    /** Sum the sorting elements' counts over \c grid's tiles */
+    void Capture(Grid<GC> & grid)
+    {
+      const u32 emitter = Element_Emitter<EC>::THE_INSTANCE.GetType();
+      const u32 consumer = Element_Consumer<EC>::THE_INSTANCE.GetType();
+      m_emitted = grid.GetElementDataTotal(emitter,
+                                           Element_Emitter<EC>::DATUMS_EMITTED_SLOT,
+                                           Element_Emitter<EC>::DATA_SLOT_COUNT);
+      m_rejected = grid.GetElementDataTotal(emitter,
+                                            Element_Emitter<EC>::DATUMS_REJECTED_SLOT,
+                                            Element_Emitter<EC>::DATA_SLOT_COUNT);
+      m_sorted = grid.GetElementDataTotal(Element_Sorter<EC>::TYPE(),
+                                          Element_Sorter<EC>::DATUMS_SORTED_SLOT,
+                                          Element_Sorter<EC>::DATA_SLOT_COUNT);
+      m_consumed = grid.GetElementDataTotal(consumer,
+                                            Element_Consumer<EC>::DATUMS_CONSUMED_SLOT,
+                                            Element_Consumer<EC>::DATA_SLOT_COUNT);
+      m_bucketError = grid.GetElementDataTotal(consumer,
+                                               Element_Consumer<EC>::TOTAL_BUCKET_ERROR_SLOT,
+                                               Element_Consumer<EC>::DATA_SLOT_COUNT);
+    }
+
+    /** The work done between \c earlier and this */
+    SortingWork Since(const SortingWork & earlier) const
+    {
+      SortingWork diff;
+      diff.m_emitted = m_emitted - earlier.m_emitted;
+      diff.m_rejected = m_rejected - earlier.m_rejected;
+      diff.m_sorted = m_sorted - earlier.m_sorted;
+      diff.m_consumed = m_consumed - earlier.m_consumed;
+      diff.m_bucketError = m_bucketError - earlier.m_bucketError;
+      return diff;
+    }
+
+    /** Data emission attempts, including rejected ones */
+    u64 GetEmitted() const { return m_emitted; }
+
+    /** Data emission attempts that found no room */
+    u64 GetRejected() const { return m_rejected; }
+
+    /** Data moves made by Sorters */
+    u64 GetSorted() const { return m_sorted; }
+
+    /** Data taken out by Consumers */
+    u64 GetConsumed() const { return m_consumed; }
+
+    /** Buckets off, summed over the data consumed */
+    u64 GetBucketError() const { return m_bucketError; }
+
+    /** Mean buckets off per datum consumed, or 0 if none were */
+    double GetSortError() const
+    {
+      return m_consumed ? ((double) m_bucketError) / m_consumed : 0.0;
+    }
+
+    /**
+       Lay out the benchmark configuration on \c grid, whose needed
+       elements must include Dreg, Res, Sorter, Data, Emitter and
+       Consumer: a short row of Sorters, with Dregs above them for
+       the Res they grow on, in the middle of each tile's worth of
+       sites, an Emitter midway down the east edge and a Consumer
+       midway down the west.
+     */
+    static void Seed(Grid<GC> & grid)
+    {
+      const u32 w = grid.GetWidthSites();
+      const u32 h = grid.GetHeightSites();
+      const u32 ow = grid.GetOwnedWidth();
+      const u32 oh = grid.GetOwnedHeight();
+
+      T sorter(Element_Sorter<EC>::THE_INSTANCE.GetDefaultAtom());
+      Element_Sorter<EC>::THE_INSTANCE.SetThreshold(sorter, DATA_MINVAL);
+      T dreg(Element_Dreg<EC>::THE_INSTANCE.GetDefaultAtom());
+
+      for (u32 y = oh / 2; y < h; y += oh)
+      {
+        for (u32 x = ow / 2; x < w; x += ow)
+        {
+          grid.PlaceAtomsInRect(false, dreg, Rect(SPoint(x - 2, y - 1), UPoint(4, 1)));
+          grid.PlaceAtomsInRect(false, sorter, Rect(SPoint(x - 1, y), UPoint(4, 1)));
+        }
+      }
+
+      T emitter(Element_Emitter<EC>::THE_INSTANCE.GetDefaultAtom());
+      T consumer(Element_Consumer<EC>::THE_INSTANCE.GetDefaultAtom());
+      grid.PlaceAtom(emitter, SPoint(w - 2, h / 2));
+      grid.PlaceAtom(consumer, SPoint(0, h / 2));
+    }
+
+  private:
+    u64 m_emitted;
+    u64 m_rejected;
+    u64 m_sorted;
+    u64 m_consumed;
+    u64 m_bucketError;
+  };
+} /* namespace MFM */
+
+#endif /* SORTINGWORK_H */
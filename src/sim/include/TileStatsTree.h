@@ -0,0 +1,148 @@
+/*                                              -*- mode:C++ -*-
+  TileStatsTree.h Lock-free grid-wide sums of per-tile counters
+  Copyright (C) 2020 The Living Computation Foundation.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+  USA
+*/
+
+/**
+  \file TileStatsTree.h Lock-free grid-wide sums of per-tile counters
+  \date (C) 2020 All rights reserved.
+  \lgpl
+ */
+#ifndef TILESTATSTREE_H
+#define TILESTATSTREE_H
+
+#include "itype.h"
+#include "Fail.h"
+
+namespace MFM
+{
+  /**
+     A TileStatsTree sums cumulative per-tile counters so that any
+     thread can read grid-wide totals at any time, without locks and
+     without pausing or visiting the tiles.
+
+     Each tile owns one leaf, which only that tile's thread writes,
+     by Publish()ing all its counters at once.  Publish stores the
+     new values in the leaf and adds each counter's change since the
+     last Publish to every node on the leaf's path to the root, with
+     atomic adds.  Nodes have up to FANOUT children, so a grid of N
+     tiles has about log(N)/log(FANOUT) levels above the leaves, and
+     tiles publishing at once mostly contend on the lower nodes, not
+     the root.  Every node is padded out to whole cache lines.
+
+     Totals lag the tiles by whatever they haven't published yet, and
+     counters are summed independently, so two totals read together
+     may not come from one moment.  Counters may go down as well as
+     up -- atom counts do -- since changes are summed modulo 2^64.
+   */
+  class TileStatsTree
+  {
+  public:
+    enum
+    {
+      FANOUT = 8,
+      CACHE_LINE_BYTES = 64
+    };
+
+    /** The counters every leaf has, before any extra ones */
+    enum Counter
+    {
+      EVENTS,               // Tile::GetEventsExecuted
+      SITES_ACCESSED,       // Tile::GetSitesAccessed
+      SKIPPED_EMPTY_EVENTS, // Tile::GetSkippedEmptyEvents
+      QUIESCENT_EVENTS,     // Tile::GetQuiescentEvents
+      INERT_EVENTS,         // Tile::GetInertEvents
+      ADVANCES,             // Tile::GetAdvanceCount
+      IDLE_ADVANCES,        // Tile::GetIdleAdvanceCount
+      LOCK_FAILURES,        // Tile::GetLockFailureCounts
+      LOCK_SPIN_WINS,
+      CACHE_PACKETS_SHIPPED, // Tile::GetCacheShippedCounts
+      CACHE_BYTES_SHIPPED,
+      STANDARD_COUNTERS
+    };
+
+    TileStatsTree() ;
+
+    ~TileStatsTree() ;
+
+    /**
+       Make a tree of \c leaves leaves of STANDARD_COUNTERS + \c
+       extraCounters counters each, all zero, discarding any old
+       tree.  Not thread-safe: nobody may Publish or read meanwhile.
+     */
+    void Init(u32 leaves, u32 extraCounters) ;
+
+    u32 GetLeafCount() const
+    {
+      return m_leaves;
+    }
+
+    u32 GetCounterCount() const
+    {
+      return m_counters;
+    }
+
+    /** How many nodes are on the path from a leaf to the root */
+    u32 GetDepth() const
+    {
+      return m_depth;
+    }
+
+    /**
+       Set \c leaf's counters to the GetCounterCount() \c values.
+       Only one thread may Publish to any one leaf.
+     */
+    void Publish(u32 leaf, const u64 * values) ;
+
+    /** The total of \c counter over all leaves, as last published */
+    u64 GetTotal(u32 counter) const
+    {
+      MFM_API_ASSERT_ARG(counter < m_counters);
+      return __atomic_load_n(&Node(m_root)[counter], __ATOMIC_RELAXED);
+    }
+
+    /** \c leaf's \c counter as last published */
+    u64 GetLeafValue(u32 leaf, u32 counter) const
+    {
+      MFM_API_ASSERT_ARG(leaf < m_leaves && counter < m_counters);
+      return __atomic_load_n(&Node(leaf)[counter], __ATOMIC_RELAXED);
+    }
+
+  private:
+    u64 * m_nodes;      // Node n is m_stride u64s at m_nodes + n * m_stride
+    u32 * m_parents;    // Of each node; the root's is itself
+    u32 m_leaves;       // Nodes 0..m_leaves-1
+    u32 m_root;
+    u32 m_depth;
+    u32 m_counters;
+    u32 m_stride;
+
+    u64 * Node(u32 n) const
+    {
+      return m_nodes + n * m_stride;
+    }
+
+    void Free() ;
+
+    // Declare away
+    TileStatsTree(const TileStatsTree &) ;
+    TileStatsTree & operator=(const TileStatsTree &) ;
+  };
+} /* namespace MFM */
+
+#endif /* TILESTATSTREE_H */
@@ -0,0 +1,100 @@
+/*                                              -*- mode:C++ -*-
+  ViewClient.h Receive grid frames from a ViewServer
+  Copyright (C) 2020 The Living Computation Foundation.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+  USA
+*/
+
+/**
+  \file ViewClient.h Receive grid frames from a ViewServer
+  \author David H. Ackley.
+  \date (C) 2020 All rights reserved.
+  \lgpl
+ */
+#ifndef VIEWCLIENT_H
+#define VIEWCLIENT_H
+
+#include "itype.h"
+#include "Fail.h"
+#include "ViewFrame.h"
+
+namespace MFM
+{
+  /**
+     The viewing end of a ViewServer connection.  Poll() takes in
+     whatever has arrived and decodes every whole frame in it, leaving
+     the latest site types in GetDecoder().  It runs on the caller's
+     thread and waits no longer than asked.
+   */
+  class ViewClient
+  {
+  public:
+    ViewClient() ;
+
+    /** Closes any connection */
+    ~ViewClient() ;
+
+    /**
+       Connect to the ViewServer on \c port of \c host.
+
+       \fail IO_ERROR if no connection can be made
+       \fail ILLEGAL_STATE if already connected
+     */
+    void Connect(const char * host, u16 port) ;
+
+    void Close() ;
+
+    /** false until Connect, and once the server has gone away */
+    bool IsOpen() const
+    {
+      return m_fd >= 0;
+    }
+
+    /**
+       Wait up to \c waitMsec for input, then decode any whole frames
+       received.  \returns true if the latest frame changed.  Closes
+       the connection if the server hangs up or sends garbage.
+     */
+    bool Poll(u32 waitMsec) ;
+
+    const ViewFrameDecoder & GetDecoder() const
+    {
+      return m_decoder;
+    }
+
+    u64 GetBytesReceived() const
+    {
+      return m_bytesReceived;
+    }
+
+  private:
+    s32 m_fd;
+    ViewFrameDecoder m_decoder;
+
+    u8 * m_input;               // Received but not yet decoded
+    u32 m_inputCapacity;
+    u32 m_inputLength;
+    u64 m_bytesReceived;
+
+    bool DecodeInput() ;
+
+    // Declare away
+    ViewClient(const ViewClient &) ;
+    ViewClient & operator=(const ViewClient &) ;
+  };
+}
+
+#endif /* VIEWCLIENT_H */
@@ -0,0 +1,185 @@
+/*                                              -*- mode:C++ -*-
+  ViewFrame.h Delta-coded grid type frames for remote viewers
+  Copyright (C) 2020 The Living Computation Foundation.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+  USA
+*/
+
+/**
+  \file ViewFrame.h Delta-coded grid type frames for remote viewers
+  \author David H. Ackley.
+  \date (C) 2020 All rights reserved.
+  \lgpl
+ */
+#ifndef VIEWFRAME_H
+#define VIEWFRAME_H
+
+#include "itype.h"
+#include "Fail.h"
+
+namespace MFM
+{
+  /**
+     The wire format shared by ViewFrameEncoder and ViewFrameDecoder.
+     A frame is the element type of every site of a grid, row by row,
+     sent as its changes from the previous frame.  Each frame is
+
+       HEADER_BYTES: "MFV" VERSION, u32 frame number, u16 width,
+                     u16 height, u8 flags, three zero bytes,
+                     u32 payload length
+       payload:      runs, until the last changed site
+
+     all big-endian.  A run is a varint count of unchanged sites to
+     skip, then a varint of (changed count << 1 | repeat), then
+     either one u16 type for all of them (repeat) or a u16 type for
+     each.  A KEYFRAME is coded against a grid of all BLANK_TYPE, so
+     a viewer can start on one.
+   */
+  struct ViewFrame
+  {
+    enum {
+      VERSION = 1,
+      HEADER_BYTES = 20,
+      FLAG_KEYFRAME = 1,
+      BLANK_TYPE = 0xffff,  // Empty's type, so empty keyframe sites cost nothing
+      MIN_REPEAT = 4        // Shortest run of one type worth coding as a repeat
+    };
+  };
+
+  /**
+     Codes successive frames, each against the one before.
+   */
+  class ViewFrameEncoder
+  {
+  public:
+    ViewFrameEncoder() ;
+
+    ~ViewFrameEncoder() ;
+
+    /**
+       Code \c types, \c width by \c height of them, as frame number
+       \c frameNumber.  It's a keyframe if \c keyframe, or if it's the
+       first frame or the size has changed.  \returns the coded frame,
+       GetEncodedLength() bytes long, valid until the next Encode.
+     */
+    const u8 * Encode(const u16 * types, u32 width, u32 height,
+                      u32 frameNumber, bool keyframe) ;
+
+    u32 GetEncodedLength() const
+    {
+      return m_length;
+    }
+
+  private:
+    u16 * m_previous;
+    u32 m_width;
+    u32 m_height;
+
+    u8 * m_out;
+    u32 m_outCapacity;
+    u32 m_length;
+
+    void Reserve(u32 bytes) ;
+
+    void PutByte(u8 byte)
+    {
+      m_out[m_length++] = byte;
+    }
+
+    void PutVarint(u32 value) ;
+
+    void PutU16(u32 value)
+    {
+      PutByte((u8) (value >> 8));
+      PutByte((u8) value);
+    }
+
+    void PutU32At(u32 at, u32 value) ;
+
+    // Declare away
+    ViewFrameEncoder(const ViewFrameEncoder &) ;
+    ViewFrameEncoder & operator=(const ViewFrameEncoder &) ;
+  };
+
+  /**
+     Rebuilds the types of each frame coded by a ViewFrameEncoder.
+   */
+  class ViewFrameDecoder
+  {
+  public:
+    ViewFrameDecoder() ;
+
+    ~ViewFrameDecoder() ;
+
+    /**
+       \returns the length of the frame starting at \c data, if all
+       \c length bytes there contain a whole frame, else 0.
+
+       \fail ILLEGAL_ARGUMENT if \c data doesn't start a frame
+     */
+    static u32 GetFrameLength(const u8 * data, u32 length) ;
+
+    /**
+       Apply the whole frame at \c data, of GetFrameLength bytes.  A
+       frame other than a keyframe applies only to the frame before
+       it, so a decoder can't begin mid-stream.
+
+       \fail ILLEGAL_ARGUMENT if the frame is malformed
+       \fail ILLEGAL_STATE if a delta frame arrives first, or changes
+       the size
+     */
+    void Decode(const u8 * data, u32 length) ;
+
+    /** false until the first keyframe */
+    bool HasFrame() const
+    {
+      return m_types != 0;
+    }
+
+    u32 GetWidth() const
+    {
+      return m_width;
+    }
+
+    u32 GetHeight() const
+    {
+      return m_height;
+    }
+
+    u32 GetFrameNumber() const
+    {
+      return m_frameNumber;
+    }
+
+    /** The types of the latest frame, row by row */
+    const u16 * GetTypes() const
+    {
+      return m_types;
+    }
+
+  private:
+    u16 * m_types;
+    u32 m_width;
+    u32 m_height;
+    u32 m_frameNumber;
+
+    // Declare away
+    ViewFrameDecoder(const ViewFrameDecoder &) ;
+    ViewFrameDecoder & operator=(const ViewFrameDecoder &) ;
+  };
+}
+
+#endif /* VIEWFRAME_H */
@@ -0,0 +1,182 @@
+/*                                              -*- mode:C++ -*-
+  ViewServer.h Stream grid frames to remote viewers
+  Copyright (C) 2020 The Living Computation Foundation.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+  USA
+*/
+
+/**
+  \file ViewServer.h Stream grid frames to remote viewers
+  \author David H. Ackley.
+  \date (C) 2020 All rights reserved.
+  \lgpl
+ */
+#ifndef VIEWSERVER_H
+#define VIEWSERVER_H
+
+#include "itype.h"
+#include "Fail.h"
+#include "ViewFrame.h"
+#include <pthread.h>
+
+namespace MFM
+{
+  /**
+     Serves the site types of a running grid, on its own thread, to
+     up to MAX_VIEWERS ViewClients connected over TCP.  Each viewer
+     gets a keyframe when it connects, and after that just the
+     changes, coded by its own ViewFrameEncoder (see ViewFrame.h).
+
+     The simulation side fills BeginPublish()'s buffer and hands it
+     over with EndPublish(), which only swaps buffers under a lock,
+     so the simulation never waits on the network.  The server thread
+     sends only the latest frame: a viewer that falls behind skips
+     frames rather than queueing them, and one that stops reading
+     for CLIENT_TIMEOUT_SEC is dropped.
+   */
+  class ViewServer
+  {
+  public:
+    enum {
+      MAX_VIEWERS = 4,
+      POLL_MSEC = 50,           // How often the server checks for frames and Stop
+      CLIENT_TIMEOUT_SEC = 5    // For writing a frame
+    };
+
+    ViewServer() ;
+
+    /** Stops the server if it's running */
+    ~ViewServer() ;
+
+    /**
+       Listen on TCP \c port (0 for any free port) of all local
+       interfaces, and start the server thread.
+
+       \fail IO_ERROR if the port can't be opened
+       \fail ILLEGAL_STATE if already running
+     */
+    void Start(u16 port) ;
+
+    /** Stop the server thread, closing the port and any viewers */
+    void Stop() ;
+
+    bool IsRunning() const
+    {
+      return m_listenFd >= 0;
+    }
+
+    /** The port actually being listened on, once running */
+    u16 GetPort() const
+    {
+      return m_port;
+    }
+
+    /**
+       Viewers currently connected.  With none, there's no need to
+       publish at all.
+     */
+    u32 GetViewerCount() const
+    {
+      return __atomic_load_n(&m_viewerCount, __ATOMIC_RELAXED);
+    }
+
+    /** Frames sent so far, to all viewers */
+    u64 GetFramesSent() const
+    {
+      return __atomic_load_n(&m_framesSent, __ATOMIC_RELAXED);
+    }
+
+    /** Bytes sent so far, to all viewers */
+    u64 GetBytesSent() const
+    {
+      return __atomic_load_n(&m_bytesSent, __ATOMIC_RELAXED);
+    }
+
+    /**
+       \returns a buffer for the \c width by \c height types of the
+       next frame, row by row.  Only one thread may publish.
+     */
+    u16 * BeginPublish(u32 width, u32 height) ;
+
+    /** Publish the frame filled in since BeginPublish */
+    void EndPublish() ;
+
+  private:
+    struct Frame
+    {
+      u16 * m_types;
+      u32 m_capacity;
+      u32 m_width;
+      u32 m_height;
+      u32 m_number;
+
+      Frame()
+        : m_types(0)
+        , m_capacity(0)
+        , m_width(0)
+        , m_height(0)
+        , m_number(0)
+      { }
+    };
+
+    struct Viewer
+    {
+      s32 m_fd;                 // -1 if this slot is free
+      ViewFrameEncoder m_encoder;
+      bool m_needsKeyframe;
+
+      Viewer()
+        : m_fd(-1)
+        , m_needsKeyframe(true)
+      { }
+    };
+
+    /* Triple buffered: the publisher fills m_staging, the server
+       thread sends m_sending, and they swap through m_published
+       under m_lock */
+    Frame m_staging;
+    Frame m_published;
+    Frame m_sending;
+    u32 m_frameNumber;
+    pthread_mutex_t m_lock;
+
+    Viewer m_viewers[MAX_VIEWERS];
+    u32 m_viewerCount;
+
+    s32 m_listenFd;             // -1 when not running
+    u16 m_port;
+    u32 m_stopRequested;
+    u64 m_framesSent;
+    u64 m_bytesSent;
+    pthread_t m_thread;
+
+    static void * Run(void * arg) ;
+
+    void AcceptViewer() ;
+
+    void CheckViewers() ;
+
+    void SendFrame() ;
+
+    void DropViewer(Viewer & viewer) ;
+
+    // Declare away
+    ViewServer(const ViewServer &) ;
+    ViewServer & operator=(const ViewServer &) ;
+  };
+}
+
+#endif /* VIEWSERVER_H */
@@ -0,0 +1,317 @@
+#include "DatumStreamer.h"
+#include "SocketChannel.h"  /* For ConnectTCP */
+#include "Logger.h"
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdio.h>          /* For snprintf */
+#include <stdlib.h>         /* For strtoul, posix_memalign */
+#include <new>              /* For placement new */
+#include <string.h>         /* For strncmp, memmove */
+
+namespace MFM
+{
+  DatumStreamer::DatumStreamer()
+    : m_inFd(-1)
+    , m_outFd(-1)
+    , m_closeIn(false)
+    , m_closeOut(false)
+    , m_running(false)
+    , m_stopRequested(0)
+    , m_inputDone(0)
+    , m_datumsRead(0)
+    , m_datumsWritten(0)
+    , m_pendingStart(0)
+    , m_pendingEnd(0)
+    , m_partial(0)
+    , m_inNumber(false)
+    , m_nextQueue(0)
+  { }
+
+  DatumStreamer::~DatumStreamer()
+  {
+    Stop();
+    for (u32 i = 0; i < m_queues.size(); ++i)
+    {
+      m_queues[i]->~DatumQueues();
+      free(m_queues[i]);
+    }
+  }
+
+  DatumQueues & DatumStreamer::AddQueues()
+  {
+    MFM_API_ASSERT_STATE(!m_running);
+    // SPSCQueue wants its indices cache-line aligned, which plain
+    // new doesn't promise
+    void * space;
+    if (posix_memalign(&space, SPSCQueue<DatumQueues::QUEUE_BYTES>::CACHE_LINE_BYTES,
+                       sizeof(DatumQueues)))
+    {
+      FAIL(OUT_OF_RESOURCES);
+    }
+    DatumQueues * dq = new (space) DatumQueues();
+    m_queues.push_back(dq);
+    return *dq;
+  }
+
+  s32 DatumStreamer::Open(const char * spec, bool forOutput, bool & closeIt)
+  {
+    closeIt = true;
+    if (!strcmp(spec, "-"))
+    {
+      closeIt = false;
+      return forOutput ? STDOUT_FILENO : STDIN_FILENO;
+    }
+    if (!strncmp(spec, "tcp:", 4))
+    {
+      const char * host = spec + 4;
+      const char * colon = strrchr(host, ':');
+      char * end;
+      const unsigned long port = colon ? strtoul(colon + 1, &end, 10) : 0;
+      if (!colon || colon == host || *end || port == 0 || port > 0xffff
+          || (u32) (colon - host) >= 256)
+      {
+        LOG.Error("Bad data stream '%s': expected tcp:HOST:PORT", spec);
+        FAIL(IO_ERROR);
+      }
+      char hostName[256];
+      memcpy(hostName, host, colon - host);
+      hostName[colon - host] = 0;
+      return SocketChannel::ConnectTCP(hostName, (u16) port);
+    }
+    const s32 fd = forOutput ?
+      open(spec, O_WRONLY | O_CREAT | O_TRUNC, 0644) :
+      open(spec, O_RDONLY);
+    if (fd < 0)
+    {
+      LOG.Error("Can't open data stream '%s': %s", spec, strerror(errno));
+      FAIL(IO_ERROR);
+    }
+    return fd;
+  }
+
+  void DatumStreamer::Start(const char * input, const char * output)
+  {
+    MFM_API_ASSERT_STATE(!m_running && m_queues.size() > 0);
+    MFM_API_ASSERT_ARG(input || output);
+
+    if (input)
+    {
+      m_inFd = Open(input, false, m_closeIn);
+    }
+    if (output)
+    {
+      unwind_protect(
+      {
+        if (m_inFd >= 0 && m_closeIn) close(m_inFd);
+        m_inFd = -1;
+        FAIL_BY_NUMBER(MFMThrownFailCode);
+      },
+      {
+        m_outFd = Open(output, true, m_closeOut);
+      });
+    }
+
+    for (u32 i = 0; i < m_queues.size(); ++i)
+    {
+      m_queues[i]->SetFed(m_inFd >= 0);
+    }
+    m_pendingStart = m_pendingEnd = 0;
+    m_partial = 0;
+    m_inNumber = false;
+    __atomic_store_n(&m_inputDone, m_inFd < 0 ? 1 : 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&m_stopRequested, 0, __ATOMIC_RELAXED);
+
+    if (pthread_create(&m_thread, NULL, Run, this))
+    {
+      if (m_inFd >= 0 && m_closeIn) close(m_inFd);
+      if (m_outFd >= 0 && m_closeOut) close(m_outFd);
+      m_inFd = m_outFd = -1;
+      FAIL(IO_ERROR);
+    }
+    m_running = true;
+    LOG.Message("Streaming data through %d tiles", m_queues.size());
+  }
+
+  void DatumStreamer::Stop()
+  {
+    if (!m_running)
+    {
+      return;
+    }
+    __atomic_store_n(&m_stopRequested, 1, __ATOMIC_RELAXED);
+    pthread_join(m_thread, NULL);
+    m_running = false;
+
+    while (DrainTiles())
+    {
+      /* Whatever's left */
+    }
+    for (u32 i = 0; i < m_queues.size(); ++i)
+    {
+      m_queues[i]->SetFed(false);
+    }
+    if (m_inFd >= 0 && m_closeIn) close(m_inFd);
+    if (m_outFd >= 0 && m_closeOut) close(m_outFd);
+    m_inFd = m_outFd = -1;
+    LOG.Message("Streamed %d datums in, %d out",
+                (u32) GetDatumsRead(), (u32) GetDatumsWritten());
+  }
+
+  void * DatumStreamer::Run(void * arg)
+  {
+    DatumStreamer & ds = *(DatumStreamer *) arg;
+    while (!__atomic_load_n(&ds.m_stopRequested, __ATOMIC_RELAXED))
+    {
+      const bool fed = ds.FeedTiles();
+      const bool drained = ds.DrainTiles();
+      const bool busy = fed || drained;
+
+      if (ds.m_inFd >= 0 && PENDING_DATUMS - ds.m_pendingEnd + ds.m_pendingStart >= 2)
+      {
+        struct pollfd pfd;
+        pfd.fd = ds.m_inFd;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        if (poll(&pfd, 1, busy ? 0 : POLL_MSEC) > 0)
+        {
+          ds.ReadInput();
+        }
+      }
+      else if (!busy)
+      {
+        usleep(POLL_MSEC * 1000);
+      }
+
+      if (ds.m_inFd < 0 && ds.m_pendingStart == ds.m_pendingEnd)
+      {
+        __atomic_store_n(&ds.m_inputDone, 1, __ATOMIC_RELAXED);
+      }
+    }
+    return NULL;
+  }
+
+  void DatumStreamer::ReadInput()
+  {
+    if (m_pendingStart > 0)
+    {
+      memmove(&m_pending[0], &m_pending[m_pendingStart],
+              (m_pendingEnd - m_pendingStart) * sizeof(m_pending[0]));
+      m_pendingEnd -= m_pendingStart;
+      m_pendingStart = 0;
+    }
+
+    // Each datum takes at least a digit and a separator, save maybe
+    // one begun last time, so this can't overfill m_pending
+    char buf[1 << 14];
+    u32 want = 2 * (PENDING_DATUMS - m_pendingEnd - 1);
+    if (want > sizeof(buf)) want = sizeof(buf);
+
+    ssize_t got;
+    do
+    {
+      got = read(m_inFd, buf, want);
+    } while (got < 0 && errno == EINTR);
+
+    if (got <= 0)
+    {
+      if (got < 0)
+      {
+        LOG.Error("Reading data stream failed: %s", strerror(errno));
+      }
+      if (m_inNumber)
+      {
+        m_pending[m_pendingEnd++] = m_partial;
+        m_inNumber = false;
+        __atomic_add_fetch(&m_datumsRead, 1, __ATOMIC_RELAXED);
+      }
+      if (m_closeIn) close(m_inFd);
+      m_inFd = -1;
+      return;
+    }
+
+    const u32 before = m_pendingEnd;
+    for (ssize_t i = 0; i < got; ++i)
+    {
+      const char c = buf[i];
+      if (c >= '0' && c <= '9')
+      {
+        const u32 digit = c - '0';
+        m_partial = m_partial > (U32_MAX - digit) / 10 ? U32_MAX : m_partial * 10 + digit;
+        m_inNumber = true;
+      }
+      else if (m_inNumber)
+      {
+        m_pending[m_pendingEnd++] = m_partial;
+        m_partial = 0;
+        m_inNumber = false;
+      }
+    }
+    __atomic_add_fetch(&m_datumsRead, m_pendingEnd - before, __ATOMIC_RELAXED);
+  }
+
+  bool DatumStreamer::FeedTiles()
+  {
+    bool any = false;
+    const u32 queues = m_queues.size();
+    for (u32 tries = 0; tries < queues && m_pendingStart < m_pendingEnd; ++tries)
+    {
+      u32 count = m_pendingEnd - m_pendingStart;
+      if (count > BATCH_DATUMS) count = BATCH_DATUMS;
+      const u32 fed = m_queues[m_nextQueue]->FeedInput(&m_pending[m_pendingStart], count);
+      m_pendingStart += fed;
+      any = any || fed > 0;
+      m_nextQueue = (m_nextQueue + 1) % queues;
+    }
+    if (m_pendingStart == m_pendingEnd)
+    {
+      m_pendingStart = m_pendingEnd = 0;
+    }
+    return any;
+  }
+
+  bool DatumStreamer::DrainTiles()
+  {
+    bool any = false;
+    u32 datums[BATCH_DATUMS];
+    char text[BATCH_DATUMS * 11];   // Ten digits and a newline each
+    for (u32 i = 0; i < m_queues.size(); ++i)
+    {
+      const u32 count = m_queues[i]->DrainOutput(datums, BATCH_DATUMS);
+      if (count == 0)
+      {
+        continue;
+      }
+      any = true;
+      u32 length = 0;
+      for (u32 d = 0; d < count; ++d)
+      {
+        length += snprintf(&text[length], sizeof(text) - length, "%u\n", datums[d]);
+      }
+      WriteAll(text, length);
+      __atomic_add_fetch(&m_datumsWritten, count, __ATOMIC_RELAXED);
+    }
+    return any;
+  }
+
+  void DatumStreamer::WriteAll(const char * bytes, u32 length)
+  {
+    while (m_outFd >= 0 && length > 0)
+    {
+      const ssize_t wrote = write(m_outFd, bytes, length);
+      if (wrote < 0 && errno == EINTR) continue;
+      if (wrote <= 0)
+      {
+        LOG.Error("Writing data stream failed: %s; discarding output", strerror(errno));
+        if (m_closeOut) close(m_outFd);
+        m_outFd = -1;
+        return;
+      }
+      bytes += wrote;
+      length -= wrote;
+    }
+  }
+}
@@ -0,0 +1,249 @@
+#include "EpochJobQueue.h"
+#include "Logger.h"
+#include "Fail.h"
+#include <stdlib.h>     /* For free */
+#include <string.h>     /* For strerror */
+#include <errno.h>
+#include <sys/stat.h>   /* For stat */
+
+namespace MFM
+{
+  EpochJobQueue::EpochJobQueue()
+    : m_capture(0)
+    , m_sink(0)
+    , m_headerSink(0)
+    , m_head(0)
+    , m_tail(0)
+    , m_pending(0)
+    , m_writtenCount(0)
+    , m_failedCount(0)
+    , m_stopping(false)
+    , m_threadStarted(false)
+  {
+    MFM_API_ASSERT(!pthread_mutex_init(&m_lock, NULL), LOCK_FAILURE);
+    MFM_API_ASSERT(!pthread_cond_init(&m_queued, NULL), LOCK_FAILURE);
+    MFM_API_ASSERT(!pthread_cond_init(&m_written, NULL), LOCK_FAILURE);
+  }
+
+  EpochJobQueue::~EpochJobQueue()
+  {
+    if (m_threadStarted)
+    {
+      pthread_mutex_lock(&m_lock);
+      m_stopping = true;
+      pthread_cond_signal(&m_queued);
+      pthread_mutex_unlock(&m_lock);
+      pthread_join(m_thread, NULL);
+    }
+
+    delete m_sink;
+    delete m_headerSink;
+    FreeJob(m_capture);
+
+    pthread_cond_destroy(&m_written);
+    pthread_cond_destroy(&m_queued);
+    pthread_mutex_destroy(&m_lock);
+  }
+
+  void EpochJobQueue::BeginFile(const char * path, bool append)
+  {
+    MFM_API_ASSERT_NONNULL(path);
+    MFM_API_ASSERT_STATE(!m_capture);
+
+    Job * job = new Job();
+    job->m_path.Print(path);
+    MFM_API_ASSERT(!job->m_path.HasOverflowed(), OUT_OF_ROOM);
+    job->m_append = append;
+    job->m_header = 0;
+    job->m_headerLength = 0;
+    job->m_text = 0;
+    job->m_length = 0;
+    job->m_next = 0;
+
+    FILE * fp = open_memstream(&job->m_text, &job->m_length);
+    if (!fp)
+    {
+      delete job;
+      FAIL(OUT_OF_RESOURCES);
+    }
+    m_capture = job;
+    m_sink = new FileByteSink(fp);
+  }
+
+  FileByteSink & EpochJobQueue::GetSink()
+  {
+    MFM_API_ASSERT_STATE(m_sink);
+    return *m_sink;
+  }
+
+  FileByteSink & EpochJobQueue::GetHeaderSink()
+  {
+    MFM_API_ASSERT_STATE(m_capture && m_capture->m_append);
+    if (!m_headerSink)
+    {
+      FILE * fp = open_memstream(&m_capture->m_header, &m_capture->m_headerLength);
+      if (!fp)
+      {
+        FAIL(OUT_OF_RESOURCES);
+      }
+      m_headerSink = new FileByteSink(fp);
+    }
+    return *m_headerSink;
+  }
+
+  void EpochJobQueue::EndFile()
+  {
+    MFM_API_ASSERT_STATE(m_capture);
+
+    // Closing the memstreams settles their buffers and lengths
+    m_sink->Close();
+    delete m_sink;
+    m_sink = 0;
+    if (m_headerSink)
+    {
+      m_headerSink->Close();
+      delete m_headerSink;
+      m_headerSink = 0;
+    }
+    Job * job = m_capture;
+    m_capture = 0;
+
+    if (!m_threadStarted)
+    {
+      m_threadStarted = !pthread_create(&m_thread, NULL, WriterRunner, this);
+      if (!m_threadStarted)
+      {
+        // No thread; write it ourselves
+        if (!WriteJob(*job)) ++m_failedCount;
+        else ++m_writtenCount;
+        FreeJob(job);
+        return;
+      }
+    }
+
+    pthread_mutex_lock(&m_lock);
+    while (m_pending >= MAX_PENDING_FILES)
+    {
+      pthread_cond_wait(&m_written, &m_lock);
+    }
+    if (m_tail) m_tail->m_next = job;
+    else m_head = job;
+    m_tail = job;
+    ++m_pending;
+    pthread_cond_signal(&m_queued);
+    pthread_mutex_unlock(&m_lock);
+  }
+
+  void EpochJobQueue::Finish()
+  {
+    pthread_mutex_lock(&m_lock);
+    while (m_pending > 0)
+    {
+      pthread_cond_wait(&m_written, &m_lock);
+    }
+    pthread_mutex_unlock(&m_lock);
+  }
+
+  u32 EpochJobQueue::GetPendingCount()
+  {
+    pthread_mutex_lock(&m_lock);
+    const u32 pending = m_pending;
+    pthread_mutex_unlock(&m_lock);
+    return pending;
+  }
+
+  u32 EpochJobQueue::GetWrittenCount()
+  {
+    pthread_mutex_lock(&m_lock);
+    const u32 written = m_writtenCount;
+    pthread_mutex_unlock(&m_lock);
+    return written;
+  }
+
+  u32 EpochJobQueue::GetFailedCount()
+  {
+    pthread_mutex_lock(&m_lock);
+    const u32 failed = m_failedCount;
+    pthread_mutex_unlock(&m_lock);
+    return failed;
+  }
+
+  void * EpochJobQueue::WriterRunner(void * arg)
+  {
+    ((EpochJobQueue *) arg)->RunWriter();
+    return 0;
+  }
+
+  void EpochJobQueue::RunWriter()
+  {
+    pthread_mutex_lock(&m_lock);
+    while (true)
+    {
+      while (!m_head && !m_stopping)
+      {
+        pthread_cond_wait(&m_queued, &m_lock);
+      }
+      if (!m_head)
+      {
+        break;  // Stopping, and everything's written
+      }
+
+      // Leave it queued while it's written, so Finish waits for it
+      Job * job = m_head;
+      pthread_mutex_unlock(&m_lock);
+      const bool ok = WriteJob(*job);
+      pthread_mutex_lock(&m_lock);
+
+      m_head = job->m_next;
+      if (!m_head) m_tail = 0;
+      --m_pending;
+      if (ok) ++m_writtenCount;
+      else ++m_failedCount;
+      FreeJob(job);
+      pthread_cond_broadcast(&m_written);
+    }
+    pthread_mutex_unlock(&m_lock);
+  }
+
+  bool EpochJobQueue::WriteJob(const Job & job)
+  {
+    const char * path = job.m_path.GetZString();
+    struct stat st;
+    const bool exists = job.m_append && stat(path, &st) == 0;
+
+    FILE * fp = fopen(path, job.m_append ? "a" : "w");
+    if (!fp)
+    {
+      LOG.Error("Couldn't write '%s': %s", path, strerror(errno));
+      return false;
+    }
+    bool ok = true;
+    if (!exists && job.m_headerLength > 0)
+    {
+      ok = fwrite(job.m_header, 1, job.m_headerLength, fp) == job.m_headerLength;
+    }
+    if (ok && job.m_length > 0)
+    {
+      ok = fwrite(job.m_text, 1, job.m_length, fp) == job.m_length;
+    }
+    if (fclose(fp) != 0)
+    {
+      ok = false;
+    }
+    if (!ok)
+    {
+      LOG.Error("Writing '%s' failed: %s", path, strerror(errno));
+    }
+    return ok;
+  }
+
+  void EpochJobQueue::FreeJob(Job * job)
+  {
+    if (job)
+    {
+      free(job->m_header);
+      free(job->m_text);
+      delete job;
+    }
+  }
+}
@@ -1,7 +1,236 @@
 #include "FileByteSink.h"
 #include <stdio.h>
+#include <stdlib.h>  /* For posix_memalign, free */
+#include <string.h>  /* For memcpy, memmove, memchr */
+#include <errno.h>
+#include <fcntl.h>   /* For fcntl, O_DIRECT */
+#include <unistd.h>  /* For write, lseek */
 
 namespace MFM {
   FileByteSink STDOUT(stdout);
   FileByteSink STDERR(stderr);
+
+  FileByteSink::~FileByteSink()
+  {
+    if (m_file && m_used > 0)
+    {
+      DrainBuffer(true);  // Errors go unreported; see Close
+    }
+    FreeBuffer();
+  }
+
+  void FileByteSink::FreeBuffer()
+  {
+    free(m_buffer);
+    m_buffer = 0;
+    m_bufferBytes = 0;
+    m_used = 0;
+  }
+
+  void FileByteSink::WriteDescriptor(const u8 * data, u32 len)
+  {
+    const int fd = fileno(m_file);
+    while (len > 0)
+    {
+      ssize_t wrote = write(fd, data, len);
+      if (wrote < 0 && errno == EINTR)
+      {
+        continue;
+      }
+      if (wrote <= 0)
+      {
+        FAIL(IO_ERROR);
+      }
+      data += wrote;
+      len -= (u32) wrote;
+    }
+  }
+
+  void FileByteSink::DrainBuffer(bool all)
+  {
+    if (m_used == 0)
+    {
+      return;
+    }
+
+    if (!m_direct)
+    {
+      const u32 len = m_used;
+      m_used = 0;
+      if (fwrite(m_buffer, 1, len, m_file) != len)
+      {
+        FAIL(IO_ERROR);
+      }
+      return;
+    }
+
+    /* O_DIRECT takes whole aligned blocks from an aligned buffer */
+    const u32 whole = m_used - m_used % DIRECT_IO_ALIGN;
+    const u32 tail = m_used - whole;
+    m_used = 0;
+    WriteDescriptor(m_buffer, whole);
+    memmove(m_buffer, m_buffer + whole, tail);
+    m_used = tail;
+
+    if (all && tail > 0)
+    {
+      /* The last partial block goes out normally, after which the
+         offset is unaligned and direct I/O is over */
+      const int fd = fileno(m_file);
+      fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_DIRECT);
+      m_direct = false;
+      m_used = 0;
+      WriteDescriptor(m_buffer, tail);
+    }
+  }
+
+  void FileByteSink::Flush()
+  {
+    if(!m_file)
+    {
+      FAIL(NULL_POINTER);
+    }
+    DrainBuffer(false);
+    fflush(m_file);
+  }
+
+  void FileByteSink::SetBufferBytes(u32 bytes)
+  {
+    if(!m_file)
+    {
+      FAIL(NULL_POINTER);
+    }
+
+    if (m_direct)
+    {
+      MFM_API_ASSERT_ARG(bytes > 0);  // SetDirectIO(false) first
+      bytes = (bytes + DIRECT_IO_ALIGN - 1) / DIRECT_IO_ALIGN * DIRECT_IO_ALIGN;
+    }
+
+    DrainBuffer(false);  // Leaves at most a partial direct block
+
+    if (bytes == 0)
+    {
+      FreeBuffer();
+      return;
+    }
+
+    void * fresh;
+    if (posix_memalign(&fresh, DIRECT_IO_ALIGN, bytes) != 0)
+    {
+      FAIL(OUT_OF_RESOURCES);
+    }
+    const u32 used = m_used;
+    if (used > 0)
+    {
+      memcpy(fresh, m_buffer, used);
+    }
+    FreeBuffer();
+    m_buffer = (u8 *) fresh;
+    m_bufferBytes = bytes;
+    m_used = used;
+  }
+
+  bool FileByteSink::SetDirectIO(bool direct)
+  {
+    if(!m_file)
+    {
+      FAIL(NULL_POINTER);
+    }
+
+    if (direct == m_direct)
+    {
+      return true;
+    }
+
+    const int fd = fileno(m_file);
+    if (!direct)
+    {
+      DrainBuffer(false);
+      fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_DIRECT);
+      m_direct = false;
+      return true;
+    }
+
+    /* Everything so far goes out the ordinary way first */
+    DrainBuffer(true);
+    fflush(m_file);
+
+    const off_t at = lseek(fd, 0, SEEK_CUR);
+    if (at < 0 || at % DIRECT_IO_ALIGN != 0)
+    {
+      return false;
+    }
+
+    const int flags = fcntl(fd, F_GETFL);
+    if (flags < 0 || fcntl(fd, F_SETFL, flags | O_DIRECT) != 0)
+    {
+      return false;
+    }
+
+    m_direct = true;
+    SetBufferBytes(m_buffer ? m_bufferBytes : (u32) LARGE_BUFFER_BYTES);
+    return true;
+  }
+
+  void FileByteSink::WriteBuffered(const u8 * data, u32 len)
+  {
+    DrainBuffer(false);
+
+    if (!m_direct && len >= m_bufferBytes)
+    {
+      /* Too big to be worth copying */
+      if (fwrite(data, 1, len, m_file) != len)
+      {
+        FAIL(IO_ERROR);
+      }
+      return;
+    }
+
+    while (len > 0)
+    {
+      const u32 room = m_bufferBytes - m_used;
+      const u32 chunk = len < room ? len : room;
+      memcpy(m_buffer + m_used, data, chunk);
+      m_used += chunk;
+      data += chunk;
+      len -= chunk;
+      if (m_used == m_bufferBytes)
+      {
+        DrainBuffer(false);
+      }
+    }
+  }
+
+  void FileByteSink::WriteLines(const u8 * data, u32 len)
+  {
+    DrainBuffer(true);  // In case buffering came first
+
+    while (len > 0)
+    {
+      const u8 * newline = (const u8 *) memchr(data, '\n', len);
+      const u32 chunk = newline ? (u32) (newline - data) + 1 : len;
+      if (fwrite(data, 1, chunk, m_file) != chunk)
+      {
+        FAIL(IO_ERROR);
+      }
+      if (newline)
+      {
+        fflush(m_file);
+      }
+      data += chunk;
+      len -= chunk;
+    }
+  }
+
+  void FileByteSink::Close()
+  {
+    if (m_file)
+    {
+      DrainBuffer(true);
+      fclose(m_file);
+    }
+    m_file = NULL;
+    FreeBuffer();
+  }
 }
@@ -1,2 +1,78 @@
 /* -*- C++ -*- */
 #include "FileByteSource.h"
+#include <errno.h>
+#include <fcntl.h>   /* For posix_fadvise */
+#include <unistd.h>  /* For read, lseek */
+
+namespace MFM
+{
+  FileByteSource::~FileByteSource()
+  {
+    delete [] m_buffer;
+  }
+
+  void FileByteSource::Open(const char* filename)
+  {
+    if(!m_fp)
+    {
+      m_fp = fopen(filename, "r");
+      m_pos = m_end = 0;
+      if (m_fp)
+      {
+        /* We do our own reading; the kernel may as well read ahead */
+        posix_fadvise(fileno(m_fp), 0, 0, POSIX_FADV_SEQUENTIAL);
+        if (!m_buffer)
+        {
+          m_buffer = new u8[BUFFER_BYTES];
+        }
+      }
+    }
+  }
+
+  s32 FileByteSource::Refill()
+  {
+    if (!m_fp)
+    {
+      FAIL(ILLEGAL_STATE);
+    }
+    m_pos = m_end = 0;
+    ssize_t got;
+    do
+    {
+      got = read(fileno(m_fp), m_buffer, BUFFER_BYTES);
+    } while (got < 0 && errno == EINTR);
+
+    if (got <= 0)
+    {
+      return -1;
+    }
+    m_end = (u32) got;
+    return m_buffer[m_pos++];
+  }
+
+  bool FileByteSource::Seek(long offset, int whence)
+  {
+    MFM_API_ASSERT_STATE(m_fp);
+    if (whence == SEEK_CUR)
+    {
+      offset -= (long) (m_end - m_pos);  // The descriptor is ahead of us
+    }
+    if (lseek(fileno(m_fp), offset, whence) < 0)
+    {
+      return false;
+    }
+    m_pos = m_end = 0;
+    return true;
+  }
+
+  long FileByteSource::Tell() const
+  {
+    MFM_API_ASSERT_STATE(m_fp);
+    const off_t at = lseek(fileno(m_fp), 0, SEEK_CUR);
+    if (at < 0)
+    {
+      return -1;
+    }
+    return (long) at - (long) (m_end - m_pos);
+  }
+}
@@ -0,0 +1,4 @@
+#include "GridSnapshot.h"
+
+namespace MFM {
+} /* namespace MFM */
@@ -0,0 +1,269 @@
+#include "GridSnapshotWriter.h"
+#include "LZBlock.h"
+#include "FastClock.h"
+#include "Logger.h"
+#include <string.h>     /* For strerror */
+#include <errno.h>
+#include <fcntl.h>      /* For open */
+#include <unistd.h>     /* For write, close */
+
+namespace MFM
+{
+  GridSnapshotWriter::GridSnapshotWriter()
+    : m_arena(0)
+    , m_arenaCapacity(0)
+    , m_writeBytes(0)
+    , m_blockBytes(0)
+    , m_blockCount(0)
+    , m_packed(0)
+    , m_packedCapacity(0)
+    , m_index(0)
+    , m_indexCapacity(0)
+    , m_lastRawBytes(0)
+    , m_lastFileBytes(0)
+    , m_lastCompressMS(0)
+    , m_writing(false)
+    , m_lastWriteOk(true)
+  { }
+
+  GridSnapshotWriter::~GridSnapshotWriter()
+  {
+    Finish();
+    delete [] m_arena;
+    delete [] m_packed;
+    delete [] m_index;
+  }
+
+  u8 * GridSnapshotWriter::BeginCapture(u32 bytes)
+  {
+    Finish();
+    if (bytes > m_arenaCapacity)
+    {
+      delete [] m_arena;
+      m_arena = new u8[bytes];
+      m_arenaCapacity = bytes;
+    }
+    return m_arena;
+  }
+
+  void GridSnapshotWriter::SetPath(const char * path)
+  {
+    MFM_API_ASSERT_NONNULL(path);
+    MFM_API_ASSERT_STATE(!m_writing);
+
+    m_path.Reset();
+    m_path.Print(path);
+    MFM_API_ASSERT(!m_path.HasOverflowed(), OUT_OF_ROOM);
+  }
+
+  void GridSnapshotWriter::Launch()
+  {
+    m_writing = true;
+    if (pthread_create(&m_thread, NULL, WriterRunner, this))
+    {
+      // No thread; write it ourselves
+      m_writing = false;
+      m_lastWriteOk = WriteArena();
+    }
+  }
+
+  void GridSnapshotWriter::StartWrite(const char * path, u32 bytes)
+  {
+    SetPath(path);
+    MFM_API_ASSERT_ARG(bytes <= m_arenaCapacity);
+    m_writeBytes = bytes;
+    m_blockBytes = 0;
+    m_blockCount = 0;
+    Launch();
+  }
+
+  u32 GridSnapshotWriter::GetPackedSlotBytes() const
+  {
+    return (LZBlock::GetMaxCompressedBytes(m_blockBytes) + 3) & ~3u;
+  }
+
+  void GridSnapshotWriter::StartCompressedWrite(const char * path, u32 prefixBytes,
+                                                u32 blockBytes, u32 blockCount)
+  {
+    SetPath(path);
+    MFM_API_ASSERT_ARG(blockBytes > 0);
+    MFM_API_ASSERT_ARG((u64) prefixBytes + (u64) blockBytes * blockCount <= m_arenaCapacity);
+
+    m_blockBytes = blockBytes;
+    m_blockCount = blockCount;
+    m_writeBytes = prefixBytes;
+
+    const u64 packedBytes = (u64) GetPackedSlotBytes() * blockCount;
+    MFM_API_ASSERT(packedBytes <= U32_MAX, OUT_OF_ROOM);
+    if (packedBytes > m_packedCapacity)
+    {
+      delete [] m_packed;
+      m_packed = new u8[packedBytes];
+      m_packedCapacity = (u32) packedBytes;
+    }
+    if (blockCount > m_indexCapacity)
+    {
+      delete [] m_index;
+      m_index = new BlockIndexEntry[blockCount];
+      m_indexCapacity = blockCount;
+    }
+    Launch();
+  }
+
+  bool GridSnapshotWriter::Finish()
+  {
+    if (m_writing)
+    {
+      MFM_API_ASSERT(!pthread_join(m_thread, NULL), LOCK_FAILURE);
+      m_writing = false;
+    }
+    return m_lastWriteOk;
+  }
+
+  void * GridSnapshotWriter::WriterRunner(void * arg)
+  {
+    GridSnapshotWriter & gsw = *(GridSnapshotWriter *) arg;
+    gsw.m_lastWriteOk = gsw.WriteArena();
+    return 0;
+  }
+
+  void GridSnapshotWriter::CompressBlocks(u32 first, u32 stride)
+  {
+    const u8 * blocks = m_arena + m_writeBytes;
+    const u32 slotBytes = GetPackedSlotBytes();
+    for (u32 b = first; b < m_blockCount; b += stride)
+    {
+      BlockIndexEntry & bie = m_index[b];
+      bie.m_rawBytes = m_blockBytes;
+      bie.m_packedBytes = LZBlock::Compress(blocks + b * m_blockBytes, m_blockBytes,
+                                            m_packed + b * slotBytes);
+    }
+  }
+
+  struct CompressJob
+  {
+    GridSnapshotWriter * m_writer;
+    u32 m_first;
+    u32 m_stride;
+  };
+
+  void * GridSnapshotWriter::CompressRunner(void * arg)
+  {
+    CompressJob & job = *(CompressJob *) arg;
+    job.m_writer->CompressBlocks(job.m_first, job.m_stride);
+    return 0;
+  }
+
+  void GridSnapshotWriter::CompressAllBlocks()
+  {
+    // This thread takes the first share, helpers the rest
+    const u32 threads = m_blockCount < COMPRESS_THREADS ? m_blockCount : COMPRESS_THREADS;
+    pthread_t helpers[COMPRESS_THREADS];
+    CompressJob jobs[COMPRESS_THREADS];
+    bool started[COMPRESS_THREADS];
+    for (u32 t = 1; t < threads; ++t)
+    {
+      jobs[t].m_writer = this;
+      jobs[t].m_first = t;
+      jobs[t].m_stride = threads;
+      started[t] = !pthread_create(&helpers[t], NULL, CompressRunner, &jobs[t]);
+    }
+    CompressBlocks(0, threads > 0 ? threads : 1);
+    for (u32 t = 1; t < threads; ++t)
+    {
+      if (started[t])
+      {
+        pthread_join(helpers[t], NULL);
+      }
+      else
+      {
+        CompressBlocks(t, threads);
+      }
+    }
+  }
+
+  bool GridSnapshotWriter::WriteAll(s32 fd, const u8 * at, u64 bytes, const char * path)
+  {
+    while (bytes > 0)
+    {
+      ssize_t wrote = write(fd, at, bytes);
+      if (wrote < 0 && errno == EINTR) continue;
+      if (wrote <= 0)
+      {
+        LOG.Error("Can't write snapshot '%s': %s", path, strerror(errno));
+        return false;
+      }
+      at += wrote;
+      bytes -= (u64) wrote;
+    }
+    return true;
+  }
+
+  bool GridSnapshotWriter::WriteArena()
+  {
+    const char * path = m_path.GetZString();
+    m_lastRawBytes = m_writeBytes + (u64) m_blockBytes * m_blockCount;
+    m_lastFileBytes = 0;
+    m_lastCompressMS = 0;
+
+    if (m_blockBytes > 0)
+    {
+      const u64 startNanos = FastClock::MonotonicNanos();
+      CompressAllBlocks();
+      m_lastCompressMS = (u32) ((FastClock::MonotonicNanos() - startNanos) / 1000000);
+
+      u64 offset = m_writeBytes + (u64) m_blockCount * sizeof(BlockIndexEntry);
+      for (u32 b = 0; b < m_blockCount; ++b)
+      {
+        m_index[b].m_offset = offset;
+        offset += (m_index[b].m_packedBytes + 3) & ~3u;
+      }
+    }
+
+    s32 fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+      LOG.Error("Can't create snapshot '%s': %s", path, strerror(errno));
+      return false;
+    }
+
+    bool ok = WriteAll(fd, m_arena, m_writeBytes, path);
+    m_lastFileBytes = m_writeBytes;
+    if (ok && m_blockBytes > 0)
+    {
+      const u64 indexBytes = (u64) m_blockCount * sizeof(BlockIndexEntry);
+      ok = WriteAll(fd, (const u8 *) m_index, indexBytes, path);
+      m_lastFileBytes += indexBytes;
+
+      const u32 slotBytes = GetPackedSlotBytes();
+      for (u32 b = 0; ok && b < m_blockCount; ++b)
+      {
+        u8 * packed = m_packed + b * slotBytes;
+        const u32 bytes = m_index[b].m_packedBytes;
+        const u32 padded = (bytes + 3) & ~3u;
+        memset(packed + bytes, 0, padded - bytes);  // The slot has room
+        ok = WriteAll(fd, packed, padded, path);
+        m_lastFileBytes += padded;
+      }
+    }
+
+    if (close(fd) != 0 && ok)
+    {
+      LOG.Error("Can't close snapshot '%s': %s", path, strerror(errno));
+      ok = false;
+    }
+
+    if (ok && m_blockBytes > 0)
+    {
+      LOG.Message("Wrote compressed snapshot '%s' (%d bytes, %d%% of %d, compressed in %d ms)",
+                  path, (u32) m_lastFileBytes,
+                  (u32) (100 * m_lastFileBytes / (m_lastRawBytes > 0 ? m_lastRawBytes : 1)),
+                  (u32) m_lastRawBytes, m_lastCompressMS);
+    }
+    else if (ok)
+    {
+      LOG.Message("Wrote snapshot '%s' (%d bytes)", path, m_writeBytes);
+    }
+    return ok;
+  }
+} /* namespace MFM */
@@ -1,17 +1,22 @@
 #include "GridTransceiver.h"
 #include "Util.h"  // For MIN
+#include "FastClock.h"
+#include <string.h>  // For memcpy
 
 namespace MFM
 {
   GridTransceiver::GridTransceiver()
     : m_enabled(false)
+    , m_directMode(false)
     , m_bytesPerSecond(500000) // default ~500KBps == ~4Mbps
     , m_maxBytesInFlight(1)
     , m_excessNanoseconds(0)
   {
     timespec now;
-    clock_gettime(CLOCK_MONOTONIC, &now);
+    FastClock::Monotonic(now);  // The clock Grid drives us by
     m_lastAdvanced = now;
+    m_listeners[0] = 0;
+    m_listeners[1] = 0;
   }
 
   bool GridTransceiver::AdvanceToTime(const timespec & now)
@@ -29,6 +34,11 @@ namespace MFM
 
   bool GridTransceiver::Advance(u32 nanoseconds)
   {
+    if (m_directMode)
+    {
+      return false;  // Nothing is ever in transit
+    }
+
     Mutex::ScopeLock lock(m_access);
 
     const u64 ONE_BILLION = 1000000000;
@@ -55,13 +65,17 @@ namespace MFM
     return rcvable > 0 || sndable > 0;
   }
 
-  u32 GridTransceiver::ByteChannel::Write(const u8 * data, u32 length)
+  u32 GridTransceiver::ByteChannel::Write(const u8 * data, u32 length, bool direct)
   {
     const u32 count = MIN(CanWrite(), length);
-    for (u32 i = 0; i < count; ++i)
+    u32 done = 0;
+    while (done < count)
     {
-      m_data[m_writeIndex] = data[i];
-      Increment(m_writeIndex);
+      u8 * span;
+      u32 len = MIN(ReserveWrite(span), count - done);
+      memcpy(span, data + done, len);
+      CommitWrite(len, direct);
+      done += len;
     }
     return count;
   }
@@ -69,12 +83,43 @@ namespace MFM
   u32 GridTransceiver::ByteChannel::Read(u8 * data, u32 length)
   {
     const u32 count = MIN(CanRead(), length);
-    for (u32 i = 0; i < count; ++i)
+    u32 done = 0;
+    while (done < count)
     {
-      data[i] = m_data[m_readIndex];
-      Increment(m_readIndex);
+      const u8 * span;
+      u32 len = MIN(PeekRead(span), count - done);
+      memcpy(data + done, span, len);
+      ConsumeRead(len);
+      done += len;
     }
     return count;
   }
 
+  void GridTransceiver::ByteChannel::CommitWrite(u32 length, bool direct)
+  {
+    MFM_API_ASSERT_ARG(length <= MIN(CanWrite(), BUFFER_SIZE - m_writeIndex));
+
+    // Data must land before any index that exposes it
+    __sync_synchronize();
+    u32 idx = (m_writeIndex + length) % BUFFER_SIZE;
+    m_writeIndex = idx;
+    if (direct)
+    {
+      // Collapse w, t, and v: written is received.  Only the writer
+      // moves these indices, and the reader looks only at v, so
+      // plain stores in this order suffice.
+      m_xmitIndex = idx;
+      m_rcvIndex = idx;
+    }
+  }
+
+  void GridTransceiver::ByteChannel::ConsumeRead(u32 length)
+  {
+    MFM_API_ASSERT_ARG(length <= MIN(CanRead(), BUFFER_SIZE - m_readIndex));
+
+    // Finish with the data before letting the writer reuse it
+    __sync_synchronize();
+    Increment(m_readIndex, length);
+  }
+
 }
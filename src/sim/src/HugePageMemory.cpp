@@ -0,0 +1,110 @@
+#include "HugePageMemory.h"
+#include "Logger.h"
+#include <sys/mman.h>
+#include <errno.h>
+#include <stdio.h>          /* For fopen, fgets, sscanf */
+#include <string.h>         /* For strerror, strncmp */
+
+#ifndef MADV_HUGEPAGE
+#define MADV_HUGEPAGE 14
+#endif
+
+#ifndef MADV_COLLAPSE
+#define MADV_COLLAPSE 25    /* Linux 6.1 and up */
+#endif
+
+namespace MFM
+{
+  static u64 RoundUpToHugePage(u64 bytes)
+  {
+    const u64 hp = HugePageMemory::HUGE_PAGE_SIZE;
+    return (bytes + hp - 1) / hp * hp;
+  }
+
+  void * HugePageMemory::Allocate(u64 bytes)
+  {
+    const u64 hp = HUGE_PAGE_SIZE;
+    const u64 size = RoundUpToHugePage(bytes);
+
+    // Over-map by one huge page, then trim both ends to the boundary
+    void * mem = mmap(NULL, size + hp, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED)
+    {
+      LOG.Error("Can't map %ld bytes: %s", (long) (size + hp), strerror(errno));
+      FAIL(OUT_OF_RESOURCES);
+    }
+
+    const u64 base = (u64) mem;
+    const u64 start = (base + hp - 1) / hp * hp;
+    if (start > base)
+    {
+      munmap(mem, start - base);
+    }
+    munmap((void *) (start + size), base + hp - start);
+    return (void *) start;
+  }
+
+  void HugePageMemory::Free(void * addr, u64 bytes)
+  {
+    if (addr)
+    {
+      munmap(addr, RoundUpToHugePage(bytes));
+    }
+  }
+
+  bool HugePageMemory::Advise(void * addr, u64 bytes)
+  {
+    const u64 size = RoundUpToHugePage(bytes);
+    if (madvise(addr, size, MADV_HUGEPAGE))
+    {
+      LOG.Warning("Can't use transparent huge pages: %s", strerror(errno));
+      return false;
+    }
+
+    // Best effort: older kernels leave it to khugepaged
+    if (madvise(addr, size, MADV_COLLAPSE))
+    {
+      LOG.Debug("Huge page collapse not done now: %s", strerror(errno));
+    }
+    return true;
+  }
+
+  bool HugePageMemory::GetResidency(const void * addr, u64 bytes,
+                                    u64 & residentBytes, u64 & hugeBytes)
+  {
+    FILE * smaps = fopen("/proc/self/smaps", "r");
+    if (!smaps)
+    {
+      return false;
+    }
+
+    const u64 lo = (u64) addr;
+    const u64 hi = lo + RoundUpToHugePage(bytes);
+    residentBytes = hugeBytes = 0;
+
+    bool inRange = false;
+    char line[256];
+    while (fgets(line, sizeof(line), smaps))
+    {
+      unsigned long start, end;
+      unsigned long kb;
+      if (sscanf(line, "%lx-%lx ", &start, &end) == 2)
+      {
+        // A new mapping; smaps gives only its totals, so count
+        // mappings lying within the range
+        inRange = start >= lo && end <= hi;
+      }
+      else if (inRange && sscanf(line, "Rss: %lu kB", &kb) == 1)
+      {
+        residentBytes += (u64) kb * 1024;
+      }
+      else if (inRange && sscanf(line, "AnonHugePages: %lu kB", &kb) == 1)
+      {
+        hugeBytes += (u64) kb * 1024;
+      }
+    }
+    fclose(smaps);
+    return true;
+  }
+} /* namespace MFM */
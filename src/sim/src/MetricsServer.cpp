@@ -0,0 +1,191 @@
+#include "MetricsServer.h"
+#include "SocketChannel.h"  /* For ListenTCP */
+#include "Logger.h"
+#include "Util.h"          /* For MIN */
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/time.h>       /* For struct timeval */
+#include <netinet/in.h>
+#include <poll.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>         /* For memcpy, strncmp, strstr, strerror */
+#include <stdio.h>          /* For snprintf */
+#include <sched.h>          /* For sched_yield */
+
+namespace MFM
+{
+  MetricsServer::MetricsServer()
+    : m_sequence(0)
+    , m_pageLength(0)
+    , m_listenFd(-1)
+    , m_port(0)
+    , m_stopRequested(0)
+    , m_scrapes(0)
+  {
+    m_page[0] = '\0';
+  }
+
+  MetricsServer::~MetricsServer()
+  {
+    Stop();
+  }
+
+  void MetricsServer::Start(u16 port)
+  {
+    MFM_API_ASSERT_STATE(!IsRunning());
+    const s32 fd = SocketChannel::ListenTCP(port);
+
+    struct sockaddr_in addr;
+    socklen_t addrLen = sizeof(addr);
+    if (getsockname(fd, (struct sockaddr *) &addr, &addrLen) < 0)
+    {
+      close(fd);
+      FAIL(IO_ERROR);
+    }
+    m_port = ntohs(addr.sin_port);
+    m_listenFd = fd;
+    __atomic_store_n(&m_stopRequested, 0, __ATOMIC_RELAXED);
+
+    if (pthread_create(&m_thread, NULL, Run, this))
+    {
+      close(m_listenFd);
+      m_listenFd = -1;
+      FAIL(IO_ERROR);
+    }
+    LOG.Message("Serving metrics on port %d", m_port);
+  }
+
+  void MetricsServer::Stop()
+  {
+    if (!IsRunning())
+    {
+      return;
+    }
+    __atomic_store_n(&m_stopRequested, 1, __ATOMIC_RELAXED);
+    pthread_join(m_thread, NULL);
+    close(m_listenFd);
+    m_listenFd = -1;
+  }
+
+  void MetricsServer::EndUpdate()
+  {
+    const u32 seq = m_sequence;
+    __atomic_store_n(&m_sequence, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    const u32 length = MIN(m_staging.GetLength(), (u32) PAGE_BYTES - 1);
+    memcpy(m_page, m_staging.GetZString(), length);
+    m_page[length] = '\0';
+    m_pageLength = length;
+
+    __atomic_store_n(&m_sequence, seq + 2, __ATOMIC_RELEASE);
+  }
+
+  u32 MetricsServer::CopyPage(char * buf, u32 size) const
+  {
+    MFM_API_ASSERT_NONNULL(buf);
+    MFM_API_ASSERT_ARG(size > 0);
+    while (true)
+    {
+      const u32 before = __atomic_load_n(&m_sequence, __ATOMIC_ACQUIRE);
+      if (before & 1)
+      {
+        sched_yield();          // EndUpdate is mid-copy
+        continue;
+      }
+      const u32 length = MIN(m_pageLength, size - 1);
+      memcpy(buf, m_page, length);
+      __atomic_thread_fence(__ATOMIC_ACQUIRE);
+      if (__atomic_load_n(&m_sequence, __ATOMIC_RELAXED) == before)
+      {
+        buf[length] = '\0';
+        return length;
+      }
+    }
+  }
+
+  void * MetricsServer::Run(void * arg)
+  {
+    MetricsServer & ms = *(MetricsServer *) arg;
+    while (!__atomic_load_n(&ms.m_stopRequested, __ATOMIC_RELAXED))
+    {
+      struct pollfd pfd;
+      pfd.fd = ms.m_listenFd;
+      pfd.events = POLLIN;
+      pfd.revents = 0;
+      if (poll(&pfd, 1, POLL_MSEC) <= 0)
+      {
+        continue;               // Timeout or EINTR
+      }
+      const s32 fd = accept(ms.m_listenFd, NULL, NULL);
+      if (fd < 0)
+      {
+        continue;
+      }
+      ms.Serve(fd);
+      close(fd);
+    }
+    return NULL;
+  }
+
+  bool MetricsServer::WriteAll(s32 fd, const char * data, u32 length)
+  {
+    while (length > 0)
+    {
+      const ssize_t sent = send(fd, data, length, MSG_NOSIGNAL);
+      if (sent < 0 && errno == EINTR) continue;
+      if (sent <= 0) return false;
+      data += sent;
+      length -= sent;
+    }
+    return true;
+  }
+
+  void MetricsServer::Serve(s32 fd)
+  {
+    struct timeval tv;
+    tv.tv_sec = CLIENT_TIMEOUT_SEC;
+    tv.tv_usec = 0;
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+    // Read through the end of the request headers; we don't need them
+    char request[REQUEST_BYTES];
+    u32 got = 0;
+    while (got < sizeof(request) - 1)
+    {
+      const ssize_t n = recv(fd, request + got, sizeof(request) - 1 - got, 0);
+      if (n < 0 && errno == EINTR) continue;
+      if (n <= 0) break;
+      got += n;
+      request[got] = '\0';
+      if (strstr(request, "\r\n\r\n") || strstr(request, "\n\n")) break;
+    }
+    request[got] = '\0';
+
+    const bool isGet = !strncmp(request, "GET ", 4);
+    const char * status = isGet ? "200 OK" : "405 Method Not Allowed";
+
+    char page[PAGE_BYTES];
+    const u32 length = isGet ? CopyPage(page, sizeof(page)) : 0;
+
+    char header[256];
+    const int headerLength =
+      snprintf(header, sizeof(header),
+               "HTTP/1.0 %s\r\n"
+               "Content-Type: text/plain; version=0.0.4\r\n"
+               "Content-Length: %u\r\n"
+               "Connection: close\r\n"
+               "\r\n",
+               status, length);
+    if (WriteAll(fd, header, headerLength) && length > 0)
+    {
+      WriteAll(fd, page, length);
+    }
+    if (isGet)
+    {
+      __atomic_add_fetch(&m_scrapes, 1, __ATOMIC_RELAXED);
+    }
+  }
+}
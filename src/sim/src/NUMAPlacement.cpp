@@ -0,0 +1,184 @@
+#include "NUMAPlacement.h"
+#include "Logger.h"
+#include "Fail.h"
+#include <stdio.h>
+#include <stdlib.h>       /* For strtoul */
+#include <string.h>       /* For strerror */
+#include <errno.h>
+#include <sched.h>        /* For cpu_set_t */
+#include <unistd.h>       /* For syscall, sysconf */
+#include <sys/syscall.h>  /* For SYS_mbind */
+
+namespace MFM
+{
+  /* From linux/mempolicy.h, which libc doesn't export without libnuma */
+  enum
+  {
+    LINUX_MPOL_BIND = 2,
+    LINUX_MPOL_MF_MOVE = 1 << 1
+  };
+
+  NUMAPlacement::NUMAPlacement()
+    : m_nodeCount(0)
+  {
+    m_nodeFirstCPU[0] = 0;
+  }
+
+  bool NUMAPlacement::ParseCPUList(const char * list)
+  {
+    const char * p = list;
+    while (*p && *p != '\n')
+    {
+      char * end;
+      u32 lo = (u32) strtoul(p, &end, 10);
+      if (end == p)
+      {
+        return false;
+      }
+      u32 hi = lo;
+      p = end;
+      if (*p == '-')
+      {
+        ++p;
+        hi = (u32) strtoul(p, &end, 10);
+        if (end == p || hi < lo)
+        {
+          return false;
+        }
+        p = end;
+      }
+      for (u32 cpu = lo; cpu <= hi; ++cpu)
+      {
+        u32 & count = m_nodeFirstCPU[m_nodeCount + 1];
+        if (count >= MAX_CPUS)
+        {
+          return false;
+        }
+        m_cpus[count++] = cpu;
+      }
+      if (*p == ',')
+      {
+        ++p;
+      }
+    }
+    return true;
+  }
+
+  bool NUMAPlacement::Discover()
+  {
+    m_nodeCount = 0;
+    m_nodeFirstCPU[0] = 0;
+
+    for (u32 id = 0; id < 4 * MAX_NODES && m_nodeCount < MAX_NODES; ++id)
+    {
+      char path[64];
+      snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", id);
+      FILE * file = fopen(path, "r");
+      if (!file)
+      {
+        continue;
+      }
+      char list[1024];
+      bool ok = fgets(list, sizeof(list), file) != 0;
+      fclose(file);
+
+      m_nodeFirstCPU[m_nodeCount + 1] = m_nodeFirstCPU[m_nodeCount];
+      if (!ok || !ParseCPUList(list))
+      {
+        LOG.Warning("Ignoring unreadable %s", path);
+        continue;
+      }
+      if (m_nodeFirstCPU[m_nodeCount + 1] > m_nodeFirstCPU[m_nodeCount])
+      {
+        m_nodeIds[m_nodeCount++] = id;     // Keep only nodes with cpus
+      }
+    }
+
+    if (m_nodeCount == 0)
+    {
+      long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+      if (cpus <= 0)
+      {
+        return false;
+      }
+      m_nodeIds[0] = 0;
+      m_nodeFirstCPU[0] = 0;
+      m_nodeFirstCPU[1] = 0;
+      for (u32 cpu = 0; cpu < (u32) cpus && cpu < MAX_CPUS; ++cpu)
+      {
+        m_cpus[m_nodeFirstCPU[1]++] = cpu;
+      }
+      m_nodeCount = 1;
+    }
+
+    LOG.Message("NUMA placement: %d node(s), %d cpu(s)",
+                m_nodeCount, m_nodeFirstCPU[m_nodeCount]);
+    return true;
+  }
+
+  u32 NUMAPlacement::GetCPUCount(u32 nodeIndex) const
+  {
+    MFM_API_ASSERT_ARG(nodeIndex < m_nodeCount);
+    return m_nodeFirstCPU[nodeIndex + 1] - m_nodeFirstCPU[nodeIndex];
+  }
+
+  u32 NUMAPlacement::GetCPU(u32 nodeIndex, u32 index) const
+  {
+    return m_cpus[m_nodeFirstCPU[nodeIndex] + index % GetCPUCount(nodeIndex)];
+  }
+
+  u32 NUMAPlacement::GetNodeForTile(u32 x, u32 y, u32 width, u32 height) const
+  {
+    MFM_API_ASSERT_STATE(m_nodeCount > 0);
+    MFM_API_ASSERT_ARG(x < width && y < height);
+    if (width >= height)
+    {
+      return x * m_nodeCount / width;
+    }
+    return y * m_nodeCount / height;
+  }
+
+  bool NUMAPlacement::PinThread(pthread_t thread, u32 cpu)
+  {
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(cpu, &cpus);
+    int err = pthread_setaffinity_np(thread, sizeof(cpus), &cpus);
+    if (err)
+    {
+      LOG.Warning("Can't pin thread to cpu %d: %s", cpu, strerror(err));
+      return false;
+    }
+    return true;
+  }
+
+  bool NUMAPlacement::BindMemory(void * addr, u64 bytes, u32 nodeIndex) const
+  {
+    MFM_API_ASSERT_ARG(nodeIndex < m_nodeCount);
+    if (m_nodeCount == 1)
+    {
+      return true;  // Nowhere else for it to be
+    }
+
+    const u64 page = (u64) sysconf(_SC_PAGESIZE);
+    const u64 start = ((u64) addr + page - 1) / page * page;
+    const u64 end = ((u64) addr + bytes) / page * page;
+    if (end <= start)
+    {
+      return true;  // No whole pages; leave them with their neighbors
+    }
+
+    const u32 BITS_PER_LONG = 8 * sizeof(unsigned long);
+    unsigned long mask[4 * MAX_NODES / (8 * sizeof(unsigned long))] = { 0 };
+    const u32 node = m_nodeIds[nodeIndex];
+    mask[node / BITS_PER_LONG] |= 1ul << (node % BITS_PER_LONG);
+
+    if (syscall(SYS_mbind, start, end - start, LINUX_MPOL_BIND,
+                mask, (unsigned long) (sizeof(mask) * 8), LINUX_MPOL_MF_MOVE))
+    {
+      LOG.Warning("Can't bind memory to node %d: %s", node, strerror(errno));
+      return false;
+    }
+    return true;
+  }
+} /* namespace MFM */
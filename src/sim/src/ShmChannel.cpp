@@ -0,0 +1,180 @@
+#include "ShmChannel.h"
+#include "Logger.h"
+#include "Util.h"          /* For MIN */
+#include <sys/mman.h>       /* For shm_open, mmap */
+#include <sys/stat.h>
+#include <sys/syscall.h>    /* For SYS_futex */
+#include <linux/futex.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>         /* For memcpy, strncpy, strerror */
+#include <time.h>
+
+namespace MFM
+{
+  ShmChannel::ShmChannel(const char * name, bool create)
+    : m_shared(0)
+  {
+    MFM_API_ASSERT_NONNULL(name);
+    MFM_API_ASSERT_ARG(strlen(name) < sizeof(m_name));
+    strncpy(m_name, name, sizeof(m_name));
+
+    int fd = create ?
+      shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600) :
+      shm_open(name, O_RDWR, 0);
+    if (fd < 0)
+    {
+      LOG.Error("Can't %s shared channel %s: %s",
+                create ? "create" : "open", name, strerror(errno));
+      FAIL(IO_ERROR);
+    }
+
+    if (create && ftruncate(fd, sizeof(Shared)) < 0)
+    {
+      close(fd);
+      shm_unlink(name);
+      FAIL(IO_ERROR);
+    }
+
+    void * mem = mmap(NULL, sizeof(Shared), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mem == MAP_FAILED)
+    {
+      if (create) shm_unlink(name);
+      FAIL(IO_ERROR);
+    }
+    m_shared = (Shared *) mem;
+
+    if (create)
+    {
+      // Fresh objects are zero-filled, so the rings start empty
+      m_shared->m_size = sizeof(Shared);
+      __sync_synchronize();
+      m_shared->m_magic = SHARED_MAGIC;
+    }
+    else if (m_shared->m_magic != SHARED_MAGIC || m_shared->m_size != sizeof(Shared))
+    {
+      LOG.Error("%s is not a shared channel", name);
+      munmap(m_shared, sizeof(Shared));
+      m_shared = 0;
+      FAIL(IO_ERROR);
+    }
+  }
+
+  ShmChannel::~ShmChannel()
+  {
+    if (m_shared)
+      munmap(m_shared, sizeof(Shared));
+  }
+
+  void ShmChannel::Unlink()
+  {
+    shm_unlink(m_name);
+  }
+
+  u32 ShmChannel::CanWrite(bool byA)
+  {
+    return GetOutputRing(byA).CanWrite();
+  }
+
+  u32 ShmChannel::Write(bool byA, const u8 * data, u32 length)
+  {
+    u32 written = 0;
+    while (written < length)
+    {
+      u8 * span;
+      const u32 room = MIN(ReserveWrite(byA, span), length - written);
+      if (room == 0) break;
+      memcpy(span, data + written, room);
+      CommitWrite(byA, room);
+      written += room;
+    }
+    return written;
+  }
+
+  u32 ShmChannel::CanRead(bool byA)
+  {
+    return GetInputRing(byA).CanRead();
+  }
+
+  u32 ShmChannel::Read(bool byA, u8 * data, u32 length)
+  {
+    u32 read = 0;
+    while (read < length)
+    {
+      const u8 * span;
+      const u32 avail = MIN(PeekRead(byA, span), length - read);
+      if (avail == 0) break;
+      memcpy(data + read, span, avail);
+      ConsumeRead(byA, avail);
+      read += avail;
+    }
+    return read;
+  }
+
+  u32 ShmChannel::ReserveWrite(bool byA, u8 * & span)
+  {
+    Ring & r = GetOutputRing(byA);
+    const u32 w = r.m_writeIndex;
+    span = &r.m_data[w];
+    return MIN(r.CanWrite(), BUFFER_SIZE - w);
+  }
+
+  void ShmChannel::CommitWrite(bool byA, u32 length)
+  {
+    Ring & r = GetOutputRing(byA);
+    const u32 w = r.m_writeIndex;
+    MFM_API_ASSERT_ARG(length <= MIN(r.CanWrite(), BUFFER_SIZE - w));
+    if (length == 0) return;
+
+    __sync_synchronize();      // Data before index
+    r.m_writeIndex = (w + length) % BUFFER_SIZE;
+    __sync_synchronize();      // Index before checking for sleepers
+    if (r.m_waiters)
+      WakeReaders(r);
+  }
+
+  u32 ShmChannel::PeekRead(bool byA, const u8 * & span)
+  {
+    Ring & r = GetInputRing(byA);
+    const u32 rd = r.m_readIndex;
+    const u32 avail = r.CanRead();
+    __sync_synchronize();      // Index before data
+    span = &r.m_data[rd];
+    return MIN(avail, BUFFER_SIZE - rd);
+  }
+
+  void ShmChannel::ConsumeRead(bool byA, u32 length)
+  {
+    Ring & r = GetInputRing(byA);
+    const u32 rd = r.m_readIndex;
+    MFM_API_ASSERT_ARG(length <= MIN(r.CanRead(), BUFFER_SIZE - rd));
+    __sync_synchronize();      // Done with the data before freeing it
+    r.m_readIndex = (rd + length) % BUFFER_SIZE;
+  }
+
+  void ShmChannel::WakeReaders(Ring & ring)
+  {
+    syscall(SYS_futex, &ring.m_writeIndex, FUTEX_WAKE, 0x7fffffff, NULL, NULL, 0);
+  }
+
+  u32 ShmChannel::WaitForInput(bool byA, u32 maxUsec)
+  {
+    Ring & r = GetInputRing(byA);
+    const u32 seen = r.m_writeIndex;
+    if (r.CanRead() > 0)
+      return r.CanRead();
+
+    __sync_fetch_and_add(&r.m_waiters, 1);
+    // The futex sleeps only if m_writeIndex is still what we saw, so
+    // a write landing after that check can't be missed
+    struct timespec timeout;
+    timeout.tv_sec = maxUsec / 1000000;
+    timeout.tv_nsec = (maxUsec % 1000000) * 1000;
+    syscall(SYS_futex, &r.m_writeIndex, FUTEX_WAIT, seen, &timeout, NULL, 0);
+    __sync_fetch_and_sub(&r.m_waiters, 1);
+
+    return r.CanRead();
+  }
+}
@@ -0,0 +1,281 @@
+#include "SocketChannel.h"
+#include "Logger.h"
+#include "Util.h"          /* For MIN */
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/uio.h>        /* For readv, writev */
+#include <netinet/in.h>
+#include <netinet/tcp.h>    /* For TCP_NODELAY */
+#include <netdb.h>          /* For getaddrinfo */
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>         /* For memcpy, memset, strerror */
+#include <stdio.h>          /* For snprintf */
+
+namespace MFM
+{
+  SocketChannel::SocketChannel(s32 fd, bool localIsA)
+    : m_fd(fd)
+    , m_localIsA(localIsA)
+    , m_bytesSent(0)
+    , m_bytesReceived(0)
+  {
+    MFM_API_ASSERT_ARG(fd >= 0);
+    const int flags = fcntl(m_fd, F_GETFL, 0);
+    if (flags < 0 || fcntl(m_fd, F_SETFL, flags | O_NONBLOCK) < 0)
+    {
+      FAIL(IO_ERROR);
+    }
+  }
+
+  SocketChannel::~SocketChannel()
+  {
+    Close();
+  }
+
+  void SocketChannel::Close()
+  {
+    if (m_fd >= 0)
+    {
+      close(m_fd);
+      m_fd = -1;
+    }
+  }
+
+  u32 SocketChannel::CanWrite(bool byA)
+  {
+    FailUnlessLocal(byA);
+    return m_output.CanWrite();
+  }
+
+  u32 SocketChannel::Write(bool byA, const u8 * data, u32 length)
+  {
+    FailUnlessLocal(byA);
+    u32 written = 0;
+    while (written < length)
+    {
+      u8 * span;
+      const u32 room = MIN(m_output.ReserveWrite(span), length - written);
+      if (room == 0) break;
+      memcpy(span, data + written, room);
+      m_output.CommitWrite(room);
+      written += room;
+    }
+    return written;
+  }
+
+  u32 SocketChannel::CanRead(bool byA)
+  {
+    FailUnlessLocal(byA);
+    return m_input.CanRead();
+  }
+
+  u32 SocketChannel::Read(bool byA, u8 * data, u32 length)
+  {
+    FailUnlessLocal(byA);
+    u32 read = 0;
+    while (read < length)
+    {
+      const u8 * span;
+      const u32 avail = MIN(m_input.PeekRead(span), length - read);
+      if (avail == 0) break;
+      memcpy(data + read, span, avail);
+      m_input.ConsumeRead(avail);
+      read += avail;
+    }
+    return read;
+  }
+
+  u32 SocketChannel::ReserveWrite(bool byA, u8 * & span)
+  {
+    FailUnlessLocal(byA);
+    return m_output.ReserveWrite(span);
+  }
+
+  void SocketChannel::CommitWrite(bool byA, u32 length)
+  {
+    FailUnlessLocal(byA);
+    m_output.CommitWrite(length);
+  }
+
+  u32 SocketChannel::PeekRead(bool byA, const u8 * & span)
+  {
+    FailUnlessLocal(byA);
+    return m_input.PeekRead(span);
+  }
+
+  void SocketChannel::ConsumeRead(bool byA, u32 length)
+  {
+    FailUnlessLocal(byA);
+    m_input.ConsumeRead(length);
+  }
+
+  u32 SocketChannel::Ring::ReserveWrite(u8 * & span)
+  {
+    span = &m_data[m_writeIndex];
+    return MIN(CanWrite(), BUFFER_SIZE - m_writeIndex);
+  }
+
+  void SocketChannel::Ring::CommitWrite(u32 length)
+  {
+    MFM_API_ASSERT_ARG(length <= MIN(CanWrite(), BUFFER_SIZE - m_writeIndex));
+    m_writeIndex = (m_writeIndex + length) % BUFFER_SIZE;
+  }
+
+  u32 SocketChannel::Ring::PeekRead(const u8 * & span)
+  {
+    span = &m_data[m_readIndex];
+    return MIN(CanRead(), BUFFER_SIZE - m_readIndex);
+  }
+
+  void SocketChannel::Ring::ConsumeRead(u32 length)
+  {
+    MFM_API_ASSERT_ARG(length <= MIN(CanRead(), BUFFER_SIZE - m_readIndex));
+    m_readIndex = (m_readIndex + length) % BUFFER_SIZE;
+  }
+
+  bool SocketChannel::Pump()
+  {
+    if (!IsOpen()) return false;
+
+    bool moved = false;
+
+    // Ship all buffered output, both pieces if it wraps, in one call
+    u32 pending = m_output.CanRead();
+    if (pending > 0)
+    {
+      struct iovec iov[2];
+      const u32 first = MIN(pending, BUFFER_SIZE - m_output.m_readIndex);
+      iov[0].iov_base = &m_output.m_data[m_output.m_readIndex];
+      iov[0].iov_len = first;
+      iov[1].iov_base = &m_output.m_data[0];
+      iov[1].iov_len = pending - first;
+
+      ssize_t sent = writev(m_fd, iov, iov[1].iov_len ? 2 : 1);
+      if (sent > 0)
+      {
+        m_output.m_readIndex = (m_output.m_readIndex + (u32) sent) % BUFFER_SIZE;
+        m_bytesSent += (u64) sent;
+        moved = true;
+      }
+      else if (sent < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+      {
+        LOG.Warning("SocketChannel %p send failed: %s", (void *) this, strerror(errno));
+        Close();
+        return moved;
+      }
+    }
+
+    // Take in whatever input fits
+    u32 room = m_input.CanWrite();
+    if (room > 0)
+    {
+      struct iovec iov[2];
+      const u32 first = MIN(room, BUFFER_SIZE - m_input.m_writeIndex);
+      iov[0].iov_base = &m_input.m_data[m_input.m_writeIndex];
+      iov[0].iov_len = first;
+      iov[1].iov_base = &m_input.m_data[0];
+      iov[1].iov_len = room - first;
+
+      ssize_t got = readv(m_fd, iov, iov[1].iov_len ? 2 : 1);
+      if (got > 0)
+      {
+        m_input.m_writeIndex = (m_input.m_writeIndex + (u32) got) % BUFFER_SIZE;
+        m_bytesReceived += (u64) got;
+        moved = true;
+      }
+      else if (got == 0)
+      {
+        LOG.Message("SocketChannel %p closed by peer", (void *) this);
+        Close();
+      }
+      else if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+      {
+        LOG.Warning("SocketChannel %p receive failed: %s", (void *) this, strerror(errno));
+        Close();
+      }
+    }
+    return moved;
+  }
+
+  s32 SocketChannel::ListenTCP(u16 port)
+  {
+    s32 fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) FAIL(IO_ERROR);
+
+    int on = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+    if (bind(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0 || listen(fd, 8) < 0)
+    {
+      LOG.Error("Can't listen on port %d: %s", port, strerror(errno));
+      close(fd);
+      FAIL(IO_ERROR);
+    }
+    return fd;
+  }
+
+  s32 SocketChannel::AcceptTCP(s32 listenFd)
+  {
+    s32 fd;
+    do
+    {
+      fd = accept(listenFd, NULL, NULL);
+    } while (fd < 0 && errno == EINTR);
+    if (fd < 0)
+    {
+      LOG.Error("Accept failed: %s", strerror(errno));
+      FAIL(IO_ERROR);
+    }
+    int on = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    return fd;
+  }
+
+  s32 SocketChannel::ConnectTCP(const char * host, u16 port)
+  {
+    MFM_API_ASSERT_NONNULL(host);
+
+    char service[8];
+    snprintf(service, sizeof(service), "%u", (u32) port);
+
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    struct addrinfo * found;
+    int err = getaddrinfo(host, service, &hints, &found);
+    if (err)
+    {
+      LOG.Error("Can't find %s:%d: %s", host, port, gai_strerror(err));
+      FAIL(IO_ERROR);
+    }
+
+    s32 fd = -1;
+    for (struct addrinfo * ai = found; ai; ai = ai->ai_next)
+    {
+      fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+      if (fd < 0) continue;
+      if (connect(fd, ai->ai_addr, ai->ai_addrlen) == 0) break;
+      close(fd);
+      fd = -1;
+    }
+    freeaddrinfo(found);
+
+    if (fd < 0)
+    {
+      LOG.Error("Can't connect to %s:%d", host, port);
+      FAIL(IO_ERROR);
+    }
+    int on = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    return fd;
+  }
+}
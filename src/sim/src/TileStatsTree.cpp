@@ -0,0 +1,101 @@
+#include "TileStatsTree.h"
+#include <stdlib.h>     /* For posix_memalign, free */
+#include <string.h>     /* For memset */
+
+namespace MFM
+{
+  TileStatsTree::TileStatsTree()
+    : m_nodes(0)
+    , m_parents(0)
+    , m_leaves(0)
+    , m_root(0)
+    , m_depth(0)
+    , m_counters(0)
+    , m_stride(0)
+  { }
+
+  TileStatsTree::~TileStatsTree()
+  {
+    Free();
+  }
+
+  void TileStatsTree::Free()
+  {
+    free(m_nodes);
+    delete [] m_parents;
+    m_nodes = 0;
+    m_parents = 0;
+    m_leaves = 0;
+    m_root = 0;
+    m_depth = 0;
+    m_counters = 0;
+    m_stride = 0;
+  }
+
+  void TileStatsTree::Init(u32 leaves, u32 extraCounters)
+  {
+    MFM_API_ASSERT_ARG(leaves > 0);
+    Free();
+
+    // Count the nodes, level by level, up to a single root
+    u32 nodes = leaves;
+    u32 depth = 1;
+    for (u32 level = leaves; level > 1; level = (level + FANOUT - 1) / FANOUT)
+    {
+      nodes += (level + FANOUT - 1) / FANOUT;
+      ++depth;
+    }
+
+    const u32 perLine = CACHE_LINE_BYTES / sizeof(u64);
+    m_counters = STANDARD_COUNTERS + extraCounters;
+    m_stride = (m_counters + perLine - 1) / perLine * perLine;
+
+    void * mem;
+    const size_t bytes = (size_t) nodes * m_stride * sizeof(u64);
+    MFM_API_ASSERT(!posix_memalign(&mem, CACHE_LINE_BYTES, bytes), OUT_OF_ROOM);
+    memset(mem, 0, bytes);
+    m_nodes = (u64 *) mem;
+    m_parents = new u32[nodes];
+
+    // Link each level to the one above it
+    u32 first = 0;
+    u32 count = leaves;
+    while (count > 1)
+    {
+      const u32 above = first + count;
+      for (u32 i = 0; i < count; ++i)
+      {
+        m_parents[first + i] = above + i / FANOUT;
+      }
+      first = above;
+      count = (count + FANOUT - 1) / FANOUT;
+    }
+    m_parents[first] = first;
+
+    m_leaves = leaves;
+    m_root = first;
+    m_depth = depth;
+  }
+
+  void TileStatsTree::Publish(u32 leaf, const u64 * values)
+  {
+    MFM_API_ASSERT_ARG(leaf < m_leaves);
+    MFM_API_ASSERT_NONNULL(values);
+
+    u64 * mine = Node(leaf);
+    for (u32 c = 0; c < m_counters; ++c)
+    {
+      const u64 delta = values[c] - mine[c];  // Only we write mine
+      if (delta == 0)
+      {
+        continue;
+      }
+      __atomic_store_n(&mine[c], values[c], __ATOMIC_RELAXED);
+      for (u32 n = leaf; n != m_root; )
+      {
+        n = m_parents[n];
+        __atomic_fetch_add(&Node(n)[c], delta, __ATOMIC_RELAXED);
+      }
+    }
+  }
+} /* namespace MFM */
@@ -0,0 +1,118 @@
+#include "ViewClient.h"
+#include "SocketChannel.h"  /* For ConnectTCP */
+#include "Logger.h"
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <poll.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdlib.h>         /* For realloc, free */
+#include <string.h>         /* For memmove */
+
+namespace MFM
+{
+  ViewClient::ViewClient()
+    : m_fd(-1)
+    , m_input(0)
+    , m_inputCapacity(0)
+    , m_inputLength(0)
+    , m_bytesReceived(0)
+  { }
+
+  ViewClient::~ViewClient()
+  {
+    Close();
+    free(m_input);
+  }
+
+  void ViewClient::Connect(const char * host, u16 port)
+  {
+    MFM_API_ASSERT_STATE(!IsOpen());
+    m_fd = SocketChannel::ConnectTCP(host, port);
+    m_inputLength = 0;
+    LOG.Message("Viewing %s:%d", host, port);
+  }
+
+  void ViewClient::Close()
+  {
+    if (m_fd >= 0)
+    {
+      close(m_fd);
+      m_fd = -1;
+    }
+  }
+
+  bool ViewClient::Poll(u32 waitMsec)
+  {
+    if (!IsOpen())
+    {
+      return false;
+    }
+
+    struct pollfd pfd;
+    pfd.fd = m_fd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    if (poll(&pfd, 1, (int) waitMsec) <= 0)
+    {
+      return false;             // Timeout or EINTR
+    }
+
+    bool changed = false;
+    while (true)
+    {
+      if (m_inputCapacity - m_inputLength < 65536)
+      {
+        const u32 capacity = m_inputCapacity ? 2 * m_inputCapacity : 131072;
+        u8 * grown = (u8 *) realloc(m_input, capacity);
+        if (!grown) FAIL(OUT_OF_RESOURCES);
+        m_input = grown;
+        m_inputCapacity = capacity;
+      }
+
+      const ssize_t got =
+        recv(m_fd, m_input + m_inputLength, m_inputCapacity - m_inputLength, MSG_DONTWAIT);
+      if (got < 0 && errno == EINTR) continue;
+      if (got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+      if (got <= 0)
+      {
+        LOG.Message("View server hung up");
+        Close();
+        break;
+      }
+      m_inputLength += got;
+      m_bytesReceived += got;
+
+      volatile bool decoded = false;
+      unwind_protect(
+      {
+        LOG.Error("Bad frame from view server");
+        Close();
+      },
+      {
+        decoded = DecodeInput();
+      });
+      changed = changed || decoded;
+      if (!IsOpen())
+      {
+        break;
+      }
+    }
+    return changed;
+  }
+
+  bool ViewClient::DecodeInput()
+  {
+    // Decode every whole frame, keeping any partial one
+    u32 used = 0;
+    u32 length;
+    while ((length = ViewFrameDecoder::GetFrameLength(m_input + used, m_inputLength - used)) > 0)
+    {
+      m_decoder.Decode(m_input + used, length);
+      used += length;
+    }
+    memmove(m_input, m_input + used, m_inputLength - used);
+    m_inputLength -= used;
+    return used > 0;
+  }
+}
@@ -0,0 +1,239 @@
+#include "ViewFrame.h"
+#include <stdlib.h>  /* For malloc, realloc, free */
+
+namespace MFM
+{
+  ViewFrameEncoder::ViewFrameEncoder()
+    : m_previous(0)
+    , m_width(0)
+    , m_height(0)
+    , m_out(0)
+    , m_outCapacity(0)
+    , m_length(0)
+  { }
+
+  ViewFrameEncoder::~ViewFrameEncoder()
+  {
+    free(m_previous);
+    free(m_out);
+  }
+
+  void ViewFrameEncoder::PutVarint(u32 value)
+  {
+    while (value >= 0x80)
+    {
+      PutByte((u8) (value | 0x80));
+      value >>= 7;
+    }
+    PutByte((u8) value);
+  }
+
+  void ViewFrameEncoder::Reserve(u32 bytes)
+  {
+    const u32 need = m_length + bytes;
+    if (need <= m_outCapacity)
+    {
+      return;
+    }
+    u32 capacity = m_outCapacity ? m_outCapacity : 4096;
+    while (capacity < need) capacity *= 2;
+    u8 * grown = (u8 *) realloc(m_out, capacity);
+    if (!grown) FAIL(OUT_OF_RESOURCES);
+    m_out = grown;
+    m_outCapacity = capacity;
+  }
+
+  void ViewFrameEncoder::PutU32At(u32 at, u32 value)
+  {
+    m_out[at] = (u8) (value >> 24);
+    m_out[at + 1] = (u8) (value >> 16);
+    m_out[at + 2] = (u8) (value >> 8);
+    m_out[at + 3] = (u8) value;
+  }
+
+  const u8 * ViewFrameEncoder::Encode(const u16 * types, u32 width, u32 height,
+                                      u32 frameNumber, bool keyframe)
+  {
+    MFM_API_ASSERT_NONNULL(types);
+    MFM_API_ASSERT_ARG(width > 0 && width <= 0xffff && height > 0 && height <= 0xffff);
+    const u32 sites = width * height;
+
+    if (!m_previous || width != m_width || height != m_height)
+    {
+      free(m_previous);
+      m_previous = (u16 *) malloc(sites * sizeof(u16));
+      if (!m_previous) FAIL(OUT_OF_RESOURCES);
+      m_width = width;
+      m_height = height;
+      keyframe = true;
+    }
+    if (keyframe)
+    {
+      for (u32 i = 0; i < sites; ++i)
+        m_previous[i] = ViewFrame::BLANK_TYPE;
+    }
+
+    m_length = 0;
+    Reserve(ViewFrame::HEADER_BYTES);
+    PutByte('M');
+    PutByte('F');
+    PutByte('V');
+    PutByte(ViewFrame::VERSION);
+    PutU16(frameNumber >> 16);
+    PutU16(frameNumber & 0xffff);
+    PutU16(width);
+    PutU16(height);
+    PutByte(keyframe ? ViewFrame::FLAG_KEYFRAME : 0);
+    while (m_length < ViewFrame::HEADER_BYTES)
+    {
+      PutByte(0);  // The payload length goes last, below
+    }
+
+    for (u32 i = 0; i < sites; )
+    {
+      u32 skip = i;
+      while (skip < sites && types[skip] == m_previous[skip]) ++skip;
+      if (skip == sites) break;
+
+      // A repeat may run on over unchanged sites; a literal run stops
+      // at the first unchanged site, or where a repeat could start
+      const u32 start = skip;
+      const u16 type = types[start];
+      u32 end = start + 1;
+      while (end < sites && types[end] == type) ++end;
+      const bool repeat = end - start >= ViewFrame::MIN_REPEAT;
+      if (!repeat)
+      {
+        for (end = start + 1; end < sites && types[end] != m_previous[end]; ++end)
+        {
+          u32 same = 1;
+          while (same < ViewFrame::MIN_REPEAT && end + same < sites &&
+                 types[end + same] == types[end]) ++same;
+          if (same == ViewFrame::MIN_REPEAT) break;
+        }
+      }
+      const u32 count = end - start;
+
+      Reserve(10 + 2 * (repeat ? 1 : count));  // Two varints and the types
+      PutVarint(start - i);
+      PutVarint(count << 1 | (repeat ? 1 : 0));
+      if (repeat)
+      {
+        PutU16(type);
+      }
+      for (u32 s = start; s < end; ++s)
+      {
+        if (!repeat) PutU16(types[s]);
+        m_previous[s] = types[s];
+      }
+      i = end;
+    }
+
+    PutU32At(ViewFrame::HEADER_BYTES - 4, m_length - ViewFrame::HEADER_BYTES);
+    return m_out;
+  }
+
+  ViewFrameDecoder::ViewFrameDecoder()
+    : m_types(0)
+    , m_width(0)
+    , m_height(0)
+    , m_frameNumber(0)
+  { }
+
+  ViewFrameDecoder::~ViewFrameDecoder()
+  {
+    free(m_types);
+  }
+
+  static u32 GetU16(const u8 * at)
+  {
+    return (u32) at[0] << 8 | at[1];
+  }
+
+  static u32 GetU32(const u8 * at)
+  {
+    return GetU16(at) << 16 | GetU16(at + 2);
+  }
+
+  u32 ViewFrameDecoder::GetFrameLength(const u8 * data, u32 length)
+  {
+    MFM_API_ASSERT_NONNULL(data);
+    const u8 magic[4] = { 'M', 'F', 'V', ViewFrame::VERSION };
+    for (u32 i = 0; i < 4 && i < length; ++i)
+    {
+      MFM_API_ASSERT_ARG(data[i] == magic[i]);
+    }
+    if (length < ViewFrame::HEADER_BYTES)
+    {
+      return 0;
+    }
+    const u32 frameLength =
+      ViewFrame::HEADER_BYTES + GetU32(data + ViewFrame::HEADER_BYTES - 4);
+    return frameLength <= length ? frameLength : 0;
+  }
+
+  /* Read a varint from data[at..end), advancing at */
+  static u32 GetVarint(const u8 * data, u32 & at, u32 end)
+  {
+    u32 value = 0;
+    for (u32 shift = 0; ; shift += 7)
+    {
+      MFM_API_ASSERT_ARG(at < end && shift < 32);
+      const u8 byte = data[at++];
+      value |= (u32) (byte & 0x7f) << shift;
+      if (!(byte & 0x80)) return value;
+    }
+  }
+
+  void ViewFrameDecoder::Decode(const u8 * data, u32 length)
+  {
+    MFM_API_ASSERT_ARG(GetFrameLength(data, length) == length);
+
+    const u32 width = GetU16(data + 8);
+    const u32 height = GetU16(data + 10);
+    const bool keyframe = data[12] & ViewFrame::FLAG_KEYFRAME;
+    const u32 sites = width * height;
+
+    if (keyframe)
+    {
+      if (!m_types || width != m_width || height != m_height)
+      {
+        free(m_types);
+        m_types = (u16 *) malloc(sites * sizeof(u16));
+        if (!m_types) FAIL(OUT_OF_RESOURCES);
+        m_width = width;
+        m_height = height;
+      }
+      for (u32 i = 0; i < sites; ++i)
+        m_types[i] = ViewFrame::BLANK_TYPE;
+    }
+    else
+    {
+      MFM_API_ASSERT_STATE(m_types && width == m_width && height == m_height);
+    }
+
+    u32 site = 0;
+    for (u32 at = ViewFrame::HEADER_BYTES; at < length; )
+    {
+      site += GetVarint(data, at, length);
+      const u32 run = GetVarint(data, at, length);
+      const u32 count = run >> 1;
+      MFM_API_ASSERT_ARG(count <= sites && site <= sites - count);
+      if (run & 1)
+      {
+        MFM_API_ASSERT_ARG(at + 2 <= length);
+        const u16 type = (u16) GetU16(data + at);
+        at += 2;
+        for (u32 i = 0; i < count; ++i)
+          m_types[site++] = type;
+      }
+      else
+      {
+        MFM_API_ASSERT_ARG(at + 2 * count <= length);
+        for (u32 i = 0; i < count; ++i, at += 2)
+          m_types[site++] = (u16) GetU16(data + at);
+      }
+    }
+    m_frameNumber = GetU32(data + 4);
+  }
+}
@@ -0,0 +1,231 @@
+#include "ViewServer.h"
+#include "SocketChannel.h"  /* For ListenTCP */
+#include "Logger.h"
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/time.h>       /* For struct timeval */
+#include <netinet/in.h>
+#include <poll.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdlib.h>         /* For realloc, free */
+
+namespace MFM
+{
+  ViewServer::ViewServer()
+    : m_frameNumber(0)
+    , m_viewerCount(0)
+    , m_listenFd(-1)
+    , m_port(0)
+    , m_stopRequested(0)
+    , m_framesSent(0)
+    , m_bytesSent(0)
+  {
+    pthread_mutex_init(&m_lock, NULL);
+  }
+
+  ViewServer::~ViewServer()
+  {
+    Stop();
+    free(m_staging.m_types);
+    free(m_published.m_types);
+    free(m_sending.m_types);
+    pthread_mutex_destroy(&m_lock);
+  }
+
+  void ViewServer::Start(u16 port)
+  {
+    MFM_API_ASSERT_STATE(!IsRunning());
+    const s32 fd = SocketChannel::ListenTCP(port);
+
+    struct sockaddr_in addr;
+    socklen_t addrLen = sizeof(addr);
+    if (getsockname(fd, (struct sockaddr *) &addr, &addrLen) < 0)
+    {
+      close(fd);
+      FAIL(IO_ERROR);
+    }
+    m_port = ntohs(addr.sin_port);
+    m_listenFd = fd;
+    __atomic_store_n(&m_stopRequested, 0, __ATOMIC_RELAXED);
+
+    if (pthread_create(&m_thread, NULL, Run, this))
+    {
+      close(m_listenFd);
+      m_listenFd = -1;
+      FAIL(IO_ERROR);
+    }
+    LOG.Message("Serving grid view on port %d", m_port);
+  }
+
+  void ViewServer::Stop()
+  {
+    if (!IsRunning())
+    {
+      return;
+    }
+    __atomic_store_n(&m_stopRequested, 1, __ATOMIC_RELAXED);
+    pthread_join(m_thread, NULL);
+    for (u32 i = 0; i < MAX_VIEWERS; ++i)
+    {
+      if (m_viewers[i].m_fd >= 0)
+      {
+        DropViewer(m_viewers[i]);
+      }
+    }
+    close(m_listenFd);
+    m_listenFd = -1;
+  }
+
+  u16 * ViewServer::BeginPublish(u32 width, u32 height)
+  {
+    MFM_API_ASSERT_ARG(width > 0 && width <= 0xffff && height > 0 && height <= 0xffff);
+    const u32 sites = width * height;
+    if (sites > m_staging.m_capacity)
+    {
+      u16 * grown = (u16 *) realloc(m_staging.m_types, sites * sizeof(u16));
+      if (!grown) FAIL(OUT_OF_RESOURCES);
+      m_staging.m_types = grown;
+      m_staging.m_capacity = sites;
+    }
+    m_staging.m_width = width;
+    m_staging.m_height = height;
+    return m_staging.m_types;
+  }
+
+  void ViewServer::EndPublish()
+  {
+    MFM_API_ASSERT_STATE(m_staging.m_types);
+    m_staging.m_number = ++m_frameNumber;
+
+    pthread_mutex_lock(&m_lock);
+    const Frame fresh = m_staging;
+    m_staging = m_published;  // Unsent, if it was never taken; refilled next time
+    m_published = fresh;
+    pthread_mutex_unlock(&m_lock);
+  }
+
+  void * ViewServer::Run(void * arg)
+  {
+    ViewServer & vs = *(ViewServer *) arg;
+    while (!__atomic_load_n(&vs.m_stopRequested, __ATOMIC_RELAXED))
+    {
+      struct pollfd pfd;
+      pfd.fd = vs.m_listenFd;
+      pfd.events = POLLIN;
+      pfd.revents = 0;
+      if (poll(&pfd, 1, POLL_MSEC) > 0)
+      {
+        vs.AcceptViewer();
+      }
+      vs.CheckViewers();
+      vs.SendFrame();
+    }
+    return NULL;
+  }
+
+  void ViewServer::AcceptViewer()
+  {
+    const s32 fd = accept(m_listenFd, NULL, NULL);
+    if (fd < 0)
+    {
+      return;
+    }
+    for (u32 i = 0; i < MAX_VIEWERS; ++i)
+    {
+      Viewer & viewer = m_viewers[i];
+      if (viewer.m_fd < 0)
+      {
+        struct timeval tv;
+        tv.tv_sec = CLIENT_TIMEOUT_SEC;
+        tv.tv_usec = 0;
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+        viewer.m_fd = fd;
+        viewer.m_needsKeyframe = true;
+        __atomic_add_fetch(&m_viewerCount, 1, __ATOMIC_RELAXED);
+        LOG.Message("Viewer connected to port %d", m_port);
+        return;
+      }
+    }
+    LOG.Warning("Refusing viewer: already serving %d", MAX_VIEWERS);
+    close(fd);
+  }
+
+  void ViewServer::CheckViewers()
+  {
+    // Viewers don't talk; anything readable means input to discard,
+    // or a hangup
+    for (u32 i = 0; i < MAX_VIEWERS; ++i)
+    {
+      Viewer & viewer = m_viewers[i];
+      if (viewer.m_fd < 0)
+      {
+        continue;
+      }
+      u8 discard[256];
+      const ssize_t got = recv(viewer.m_fd, discard, sizeof(discard), MSG_DONTWAIT);
+      if (got == 0 || (got < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+      {
+        DropViewer(viewer);
+      }
+    }
+  }
+
+  void ViewServer::DropViewer(Viewer & viewer)
+  {
+    close(viewer.m_fd);
+    viewer.m_fd = -1;
+    __atomic_sub_fetch(&m_viewerCount, 1, __ATOMIC_RELAXED);
+    LOG.Message("Viewer disconnected from port %d", m_port);
+  }
+
+  void ViewServer::SendFrame()
+  {
+    pthread_mutex_lock(&m_lock);
+    const bool fresh = m_published.m_number != m_sending.m_number;
+    if (fresh)
+    {
+      const Frame latest = m_published;
+      m_published = m_sending;
+      m_sending = latest;
+    }
+    pthread_mutex_unlock(&m_lock);
+
+    if (!m_sending.m_types)
+    {
+      return;  // Nothing published yet
+    }
+
+    for (u32 i = 0; i < MAX_VIEWERS; ++i)
+    {
+      Viewer & viewer = m_viewers[i];
+      if (viewer.m_fd < 0 || (!fresh && !viewer.m_needsKeyframe))
+      {
+        continue;
+      }
+
+      const u8 * data =
+        viewer.m_encoder.Encode(m_sending.m_types, m_sending.m_width, m_sending.m_height,
+                                m_sending.m_number, viewer.m_needsKeyframe);
+      u32 length = viewer.m_encoder.GetEncodedLength();
+      viewer.m_needsKeyframe = false;
+
+      __atomic_add_fetch(&m_bytesSent, length, __ATOMIC_RELAXED);
+      while (length > 0)
+      {
+        const ssize_t sent = send(viewer.m_fd, data, length, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR) continue;
+        if (sent <= 0) break;
+        data += sent;
+        length -= sent;
+      }
+      if (length > 0)
+      {
+        DropViewer(viewer);  // Timed out or failed; it can reconnect
+        continue;
+      }
+      __atomic_add_fetch(&m_framesSent, 1, __ATOMIC_RELAXED);
+    }
+  }
+}
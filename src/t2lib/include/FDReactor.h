@@ -0,0 +1,69 @@
+/* -*- C++ -*- */
+#ifndef FDREACTOR_H
+#define FDREACTOR_H
+
+#include "itype.h"
+
+// Spike files
+#include "TimeoutAble.h"
+
+namespace MFM {
+  struct TimeQueue; // FORWARD
+
+  /**
+     An epoll set of file descriptors, each tied to the TimeoutAble
+     that services it.  When a watched fd becomes ready, its
+     TimeoutAble is bump()ed, so it runs at once off the TimeQueue
+     like anything else that's due.
+
+     Watches are one-shot: an fd that fired is re-armed at the next
+     waitForWork, by which time its TimeoutAble has had its turn --
+     but only while that TimeoutAble is on a TimeQueue, since one
+     that isn't (say, a poller that's been shut off) couldn't be
+     bumped and would just keep waking us.
+
+     A main loop with nothing due calls waitForWork instead of
+     sleeping a fixed tick: that blocks until a watched fd is ready
+     or the TimeQueue's next timeout comes, whichever is first.
+   */
+  struct FDReactor {
+    enum {
+      MAX_WATCHES = 16
+    };
+
+    FDReactor() ;
+    ~FDReactor() ;
+
+    /** Bump \c ta whenever \c fd has any of \c events (EPOLLIN,
+        EPOLLPRI, ..) pending.  \returns false if \c fd can't be
+        watched (e.g., a device without poll support), in which case
+        \c ta must keep polling on its own schedule. */
+    bool watch(int fd, u32 events, TimeoutAble & ta) ;
+
+    /** Stop watching \c fd.  Call before closing it. */
+    void unwatch(int fd) ;
+
+    u32 getWatchCount() const { return mWatchCount; }
+
+    /** Block until a watched fd is ready or \c tq's next timeout
+        (but at most \c maxMS), and bump whatever became ready.
+        \returns the number of fds that did. */
+    u32 waitForWork(TimeQueue & tq, u32 maxMS) ;
+
+  private:
+    struct Watch {
+      int mFD;                  // -1 if this slot is free
+      u32 mEvents;
+      TimeoutAble * mTA;
+      bool mArmed;
+    };
+
+    bool rearm(Watch & w, u32 index) ;
+
+    int mEpollFD;
+    u32 mWatchCount;
+    Watch mWatches[MAX_WATCHES];
+  };
+}
+
+#endif /* FDREACTOR_H */
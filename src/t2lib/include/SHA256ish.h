@@ -70,7 +70,7 @@ private:
     return rotr(x, 17) ^ rotr(x, 19) ^ (x >> 10);
   }
 
-  void transform();
+  void transform(const u8 * block); // Mix one 64 byte block into m_state
   void pad();
   void revert(u8 * hash);
 };
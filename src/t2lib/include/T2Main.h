@@ -9,6 +9,7 @@
 #include "FileByteSink.h"
 
 #include "TimeQueue.h"
+#include "FDReactor.h"
 
 namespace MFM {
   /// Base class of all T2 main programs, supplying basic services such as random numbers and time queues
@@ -17,6 +18,7 @@ namespace MFM {
 
     u32 now() const { return mTimeQueue.now(); }
     TimeQueue & getTQ() { return mTimeQueue; }
+    FDReactor & getFDReactor() { return mFDReactor; }
     Random & getRandom() { return mRandom; }
 
     static inline T2Main & get() {
@@ -40,6 +42,7 @@ namespace MFM {
     T2Main()
       : mRandom()
       , mTimeQueue(this->getRandom())
+      , mFDReactor()
     {
       MFM_API_ASSERT_NULL(mTheInstance);
       mTheInstance = this;
@@ -48,6 +51,7 @@ namespace MFM {
 
     Random mRandom;
     TimeQueue mTimeQueue;
+    FDReactor mFDReactor;
 
   private:
     static T2Main * mTheInstance;
@@ -3,7 +3,6 @@
 #define TIMEQUEUE_H
 
 #include <assert.h>
-#include <set>
 
 // Core files
 #include "Random.h"
@@ -19,27 +18,93 @@ namespace MFM {
     }
   };
 
-  typedef std::set<TimeoutAble*,TimeoutAblePtrComparator> SetOfTimeoutAble;
+  /**
+     A hierarchical timing wheel of TimeoutAbles, with 1ms ticks.
 
+     Level L of the wheel has WHEEL_SLOTS slots, each spanning
+     WHEEL_SLOTS^L ticks, so the four levels together reach
+     2^(4*WHEEL_BITS) ms (about 4.6 hours) ahead; anything further
+     out parks in the last slot of the top level and is re-filed
+     when that slot comes due.  Each slot is an intrusive list
+     threaded through the TimeoutAbles themselves, so insertRaw and
+     removeRaw are O(1) and allocate nothing.
+
+     Expiry is batched: getEarliestExpired first advances the wheel
+     to now(), cascading higher-level slots down as their time
+     comes and moving every due tick's entries onto a ready list,
+     and then hands out the ready list one TimeoutAble at a time.
+     The ready list is kept in (mTimeMS, mNonce) order, so expired
+     TimeoutAbles come out in the same order -- random tie breaks
+     included -- as they would from a totally ordered queue.
+   */
   struct TimeQueue {
+    enum {
+      WHEEL_BITS = 6,
+      WHEEL_SLOTS = 1<<WHEEL_BITS,
+      WHEEL_MASK = WHEEL_SLOTS-1,
+      WHEEL_LEVELS = 4,
+      WHEEL_SPAN_BITS = WHEEL_BITS*WHEEL_LEVELS,
+      BUCKET_READY = WHEEL_LEVELS*WHEEL_SLOTS // mTQBucket of ready list entries
+    };
+
     TimeQueue(Random & r)
       : mRandom(r)
       , mExpiredCount(0)
-    { }
+      , mSize(0)
+      , mWheelTime(0)
+      , mWheelStarted(false)
+      , mReadyHead(0)
+      , mReadyTail(0)
+    {
+      for (u32 i = 0; i < WHEEL_LEVELS*WHEEL_SLOTS; ++i)
+        mSlots[i] = 0;
+      for (u32 i = 0; i < WHEEL_LEVELS; ++i)
+        mLevelCount[i] = 0;
+    }
 
     u32 getExpiredCount() const { return mExpiredCount; }
     void dumpQueue() ;
     void dumpQueue(ByteSink& bs) ;
-    u32 size() const { return mPQ.size(); }
+    u32 size() const { return mSize; }
     bool isEmpty() const { return size() == 0; }
     u32 now() const ;
     TimeoutAble * getEarliestExpired() ;
+
+    /** How many ms from now until something might come due, capped
+        at maxMS.  Never later than the true next timeout, though it
+        may be earlier: when level 0 of the wheel is empty, it's the
+        next level 0 wrap, where higher levels cascade down. */
+    u32 msToNextExpiry(u32 maxMS) const ;
     void insertRaw(TimeoutAble& ta) ;
     void removeRaw(TimeoutAble& ta) ;
-    SetOfTimeoutAble mPQ;
     Random & getRandom() { return mRandom; }
     Random & mRandom;
     u32 mExpiredCount;
+
+  private:
+    /** File ta in the wheel slot covering its timeout, or on the
+        ready list if that has already passed */
+    void file(TimeoutAble & ta) ;
+
+    /** Insert ta into the ready list in (mTimeMS, mNonce) order */
+    void fileReady(TimeoutAble & ta) ;
+
+    /** Unlink ta from whichever slot or ready list it is on */
+    void unlink(TimeoutAble & ta) ;
+
+    /** Move every entry of slot (level,idx) back through file() */
+    void cascade(u32 level, u32 idx) ;
+
+    /** Process every tick up to and including untilMS */
+    void advanceTo(u32 untilMS) ;
+
+    u32 mSize;
+    u32 mWheelTime;             // Next tick to process
+    bool mWheelStarted;
+    TimeoutAble * mSlots[WHEEL_LEVELS*WHEEL_SLOTS];
+    u32 mLevelCount[WHEEL_LEVELS];
+    TimeoutAble * mReadyHead;
+    TimeoutAble * mReadyTail;
   };
 }
 #endif /* TIMEQUEUE_H */
@@ -103,6 +103,11 @@ namespace MFM {
     u32 mNonce;
     TimeQueue * mOnTQ;
 
+    // TimeQueue wheel linkage: which slot we're in, and our neighbors there
+    TimeoutAble * mTQNext;
+    TimeoutAble * mTQPrev;
+    u32 mTQBucket;
+
     bool operator<(const TimeoutAble & rhs) const {
       // Round 0: Shortcut identity
       if (this == &rhs) return false;
@@ -8,6 +8,7 @@
 #include "itype.h"
 #include "ByteSink.h"
 #include "ByteSource.h"
+#include "FastClock.h"
 
 namespace MFM {
 
@@ -66,7 +67,7 @@ namespace MFM {
     }
     static struct timespec now() {
       struct timespec time; 
-      clock_gettime(CLOCK_REALTIME, &time);
+      FastClock::Realtime(time);
       return time;
     }
 
@@ -74,6 +75,8 @@ namespace MFM {
       return mLocalTimestamp;
     }
 
+    u8 getUniquerValue() const { return mUniquer; } // As stored
+
     u8 getUniquer() const {
       u8 ret = 0;
       if (this != &mStaticLast &&
@@ -0,0 +1,111 @@
+#include <sys/epoll.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "FDReactor.h"
+#include "TimeQueue.h"
+#include "Logger.h"
+
+namespace MFM {
+  FDReactor::FDReactor()
+    : mEpollFD(::epoll_create1(EPOLL_CLOEXEC))
+    , mWatchCount(0)
+  {
+    if (mEpollFD < 0) {
+      LOG.Error("epoll_create1 failed: %s", strerror(errno));
+      FAIL(ILLEGAL_STATE);
+    }
+    for (u32 i = 0; i < MAX_WATCHES; ++i) {
+      mWatches[i].mFD = -1;
+      mWatches[i].mTA = 0;
+      mWatches[i].mArmed = false;
+    }
+  }
+
+  FDReactor::~FDReactor() {
+    ::close(mEpollFD);
+  }
+
+  bool FDReactor::watch(int fd, u32 events, TimeoutAble & ta) {
+    MFM_API_ASSERT_ARG(fd >= 0);
+    u32 index = 0;
+    while (index < MAX_WATCHES && mWatches[index].mFD >= 0) ++index;
+    if (index == MAX_WATCHES) {
+      LOG.Warning("%s: no room to watch fd %d; polling on timer instead",
+                  ta.getName(), fd);
+      return false;
+    }
+
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = events | EPOLLONESHOT;
+    ev.data.u32 = index;
+    if (::epoll_ctl(mEpollFD, EPOLL_CTL_ADD, fd, &ev) < 0) {
+      LOG.Warning("%s: can't watch fd %d: %s; polling on timer instead",
+                  ta.getName(), fd, strerror(errno));
+      return false;
+    }
+
+    Watch & w = mWatches[index];
+    w.mFD = fd;
+    w.mEvents = events;
+    w.mTA = &ta;
+    w.mArmed = true;
+    ++mWatchCount;
+    return true;
+  }
+
+  void FDReactor::unwatch(int fd) {
+    for (u32 i = 0; i < MAX_WATCHES; ++i) {
+      Watch & w = mWatches[i];
+      if (w.mFD != fd) continue;
+      ::epoll_ctl(mEpollFD, EPOLL_CTL_DEL, fd, 0);
+      w.mFD = -1;
+      w.mTA = 0;
+      w.mArmed = false;
+      --mWatchCount;
+      return;
+    }
+  }
+
+  bool FDReactor::rearm(Watch & w, u32 index) {
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = w.mEvents | EPOLLONESHOT;
+    ev.data.u32 = index;
+    if (::epoll_ctl(mEpollFD, EPOLL_CTL_MOD, w.mFD, &ev) < 0) {
+      LOG.Warning("%s: can't rearm fd %d: %s",
+                  w.mTA->getName(), w.mFD, strerror(errno));
+      return false;
+    }
+    w.mArmed = true;
+    return true;
+  }
+
+  u32 FDReactor::waitForWork(TimeQueue & tq, u32 maxMS) {
+    for (u32 i = 0; i < MAX_WATCHES; ++i) {
+      Watch & w = mWatches[i];
+      if (w.mFD >= 0 && !w.mArmed && w.mTA->isOnTQ())
+        rearm(w, i);
+    }
+
+    struct epoll_event evs[MAX_WATCHES];
+    const u32 waitMS = tq.msToNextExpiry(maxMS);
+    int ret = ::epoll_wait(mEpollFD, evs, MAX_WATCHES, (int) waitMS);
+    if (ret < 0) {
+      if (errno != EINTR)
+        LOG.Warning("epoll_wait failed: %s", strerror(errno));
+      return 0;
+    }
+    for (int i = 0; i < ret; ++i) {
+      const u32 index = evs[i].data.u32;
+      MFM_API_ASSERT_STATE(index < MAX_WATCHES);
+      Watch & w = mWatches[index];
+      if (w.mFD < 0) continue; // Unwatched since it fired
+      w.mArmed = false;
+      w.mTA->bump();
+    }
+    return (u32) ret;
+  }
+}
@@ -5,7 +5,7 @@
 #include <iomanip>
 
 namespace MFM {
-  static constexpr std::array<u32, 64> K =
+  static const u32 K[64] =
     {
      0x428a2f98,0x71374491,0xb5c0fbcf,0xe9b5dba5,
      0x3956c25b,0x59f111f1,0x923f82a4,0xab1c5ed5,
@@ -42,16 +42,26 @@ namespace MFM {
 
   void SHA256ish::addBytes(const u8 * data, u32 length) {
     MFM_API_ASSERT_STATE(!m_digested);
-    for (u32 i = 0 ; i < length ; i++) {
-      m_data[m_blocklen++] = data[i];
-      if (m_blocklen == 64) {
-        transform();
-
-        // End of the block
-        m_bitlen += 512;
-        m_blocklen = 0;
-      }
+    if (m_blocklen > 0) {       // Top off a partial block first
+      u32 take = 64 - m_blocklen;
+      if (take > length) take = length;
+      memcpy(m_data + m_blocklen, data, take);
+      m_blocklen += take;
+      data += take;
+      length -= take;
+      if (m_blocklen < 64) return;
+      transform(m_data);
+      m_bitlen += 512;
+      m_blocklen = 0;
+    }
+    while (length >= 64) {      // Whole blocks straight from the caller
+      transform(data);
+      m_bitlen += 512;
+      data += 64;
+      length -= 64;
     }
+    memcpy(m_data, data, length); // Save any tail for next time
+    m_blocklen = length;
   }
 
   bool SHA256ish::digest(ByteSink& out, bool ashex) {
@@ -76,12 +86,12 @@ namespace MFM {
     return true;
   }
 
-  void SHA256ish::transform() {
+  void SHA256ish::transform(const u8 * block) {
     u32 maj, xorA, ch, xorE, sum, newA, newE, m[64];
     u32 state[8];
 
     for (u8 i = 0, j = 0; i < 16; i++, j += 4) { // Split data in 32 bit blocks for the 16 first words
-      m[i] = (m_data[j] << 24) | (m_data[j + 1] << 16) | (m_data[j + 2] << 8) | (m_data[j + 3]);
+      m[i] = (block[j] << 24) | (block[j + 1] << 16) | (block[j + 2] << 8) | (block[j + 3]);
     }
 
     for (u8 k = 16 ; k < 64; k++) { // Remaining 48 blocks
@@ -130,7 +140,7 @@ namespace MFM {
     }
 
     if(m_blocklen >= 56) {
-      transform();
+      transform(m_data);
       memset(m_data, 0, 56);
     }
 
@@ -144,7 +154,7 @@ namespace MFM {
     m_data[58] = m_bitlen >> 40;
     m_data[57] = m_bitlen >> 48;
     m_data[56] = m_bitlen >> 56;
-    transform();
+    transform(m_data);
   }
 
   void SHA256ish::revert(u8 * hash) {
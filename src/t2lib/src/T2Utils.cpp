@@ -57,9 +57,10 @@ namespace MFM {
     FileByteSource fbs(path);
     if (!fbs.IsOpen()) return false;
     SHA256ish hash;
-    s32 ch;
-    while ((ch = fbs.ReadByte()) >= 0) {
-      hash.addByte((u8) ch);
+    u8 buf[4096];
+    u32 len;
+    while ((len = fbs.ReadBytes(buf, sizeof(buf))) > 0) {
+      hash.addBytes(buf, len);
     }
     fbs.Close();
     if (!hash.digest(digestout, ashex)) // This can't be false, right??
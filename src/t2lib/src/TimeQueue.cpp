@@ -1,6 +1,11 @@
 #include "TimeQueue.h"
 #include "FileByteSink.h"
 #include "T2Utils.h"
+#include "FastClock.h"
+#include "Probes.h"
+
+#include <vector>
+#include <algorithm>
 
 namespace MFM {
   void TimeQueue::dumpQueue() {
@@ -10,7 +15,18 @@ namespace MFM {
   void TimeQueue::dumpQueue(ByteSink& bs) {
     printComma(getExpiredCount(), bs);
     bs.Printf(" [%d]\n", size());
-    for (auto itr = mPQ.begin(); itr != mPQ.end(); ++itr) {
+
+    // The wheel only orders what's due; sort a copy for display
+    std::vector<TimeoutAble*> all;
+    all.reserve(size());
+    for (TimeoutAble * ta = mReadyHead; ta != 0; ta = ta->mTQNext)
+      all.push_back(ta);
+    for (u32 i = 0; i < WHEEL_LEVELS*WHEEL_SLOTS; ++i)
+      for (TimeoutAble * ta = mSlots[i]; ta != 0; ta = ta->mTQNext)
+        all.push_back(ta);
+    std::sort(all.begin(), all.end(), TimeoutAblePtrComparator());
+
+    for (auto itr = all.begin(); itr != all.end(); ++itr) {
       TimeoutAble * ta = *itr;
       ta->printTimeout(bs);
       bs.Printf(" %s\n", ta->getName());
@@ -19,29 +35,168 @@ namespace MFM {
 
   TimeoutAble * TimeQueue::getEarliestExpired() {
     //dumpQueue();
-    SetOfTimeoutAble::iterator min = mPQ.begin();
-    if (min != mPQ.end()) {
-      TimeoutAble* ta = *min;
-      if (time_before_eq(ta->getTimeout(), now())) {
-        ta->remove();
-        ++mExpiredCount;
-        return ta;
-      }
+    if (mWheelStarted)
+      advanceTo(now());
+    TimeoutAble * ta = mReadyHead;
+    if (ta != 0) {
+      MFM_PROBE2(timeout__expire, (void *) ta, now() - ta->getTimeout());
+      ta->remove();
+      ++mExpiredCount;
+      return ta;
     }
     return 0;
   }
+
+  u32 TimeQueue::msToNextExpiry(u32 maxMS) const {
+    if (mReadyHead != 0) return 0;
+    if (!mWheelStarted || mSize == 0) return maxMS;
+
+    // Level 0 entries are all due within WHEEL_SLOTS ticks of
+    // mWheelTime, one tick per slot; past that, only a cascade at
+    // the next wrap can bring anything due
+    u32 due = (mWheelTime | WHEEL_MASK) + 1;
+    if (mLevelCount[0] > 0) {
+      for (u32 d = 0; d < WHEEL_SLOTS; ++d) {
+        const u32 t = mWheelTime + d;
+        if (mSlots[t & WHEEL_MASK] != 0) {
+          if (mSize == mLevelCount[0] || time_before(t, due)) due = t;
+          break;
+        }
+      }
+    }
+
+    const s32 ms = (s32) (due - now());
+    if (ms <= 0) return 0;
+    return (u32) ms < maxMS ? (u32) ms : maxMS;
+  }
+
   void TimeQueue::insertRaw(TimeoutAble & ta) {
     assert(ta.mOnTQ == this);
-    mPQ.insert(&ta);
+    if (!mWheelStarted) {
+      mWheelTime = now();
+      mWheelStarted = true;
+    }
+    file(ta);
+    ++mSize;
   }
+
   void TimeQueue::removeRaw(TimeoutAble & ta) {
     assert(ta.mOnTQ == this);
-    mPQ.erase(&ta);
+    unlink(ta);
+    --mSize;
+  }
+
+  void TimeQueue::file(TimeoutAble & ta) {
+    const s32 delta = (s32) (ta.mTimeMS - mWheelTime);
+    if (delta < 0) {
+      fileReady(ta);            // Tick already processed: it's due
+      return;
+    }
+
+    u32 level = 0;
+    while (level < WHEEL_LEVELS-1 && (u32) delta >= (1u<<(WHEEL_BITS*(level+1))))
+      ++level;
+
+    // Beyond the top level: park in its farthest slot and re-file from there
+    u32 when = ta.mTimeMS;
+    if ((u32) delta >= (1u<<WHEEL_SPAN_BITS))
+      when = mWheelTime + (1u<<WHEEL_SPAN_BITS) - 1;
+
+    const u32 bucket = level*WHEEL_SLOTS + ((when>>(WHEEL_BITS*level)) & WHEEL_MASK);
+    TimeoutAble * head = mSlots[bucket];
+    ta.mTQPrev = 0;
+    ta.mTQNext = head;
+    if (head) head->mTQPrev = &ta;
+    mSlots[bucket] = &ta;
+    ta.mTQBucket = bucket;
+    ++mLevelCount[level];
+  }
+
+  void TimeQueue::fileReady(TimeoutAble & ta) {
+    // Newcomers are nearly always latest, so search from the tail
+    TimeoutAble * after = mReadyTail;
+    while (after != 0 && ta < *after)
+      after = after->mTQPrev;
+
+    ta.mTQPrev = after;
+    ta.mTQNext = after ? after->mTQNext : mReadyHead;
+    if (ta.mTQNext) ta.mTQNext->mTQPrev = &ta;
+    else mReadyTail = &ta;
+    if (after) after->mTQNext = &ta;
+    else mReadyHead = &ta;
+    ta.mTQBucket = BUCKET_READY;
+  }
+
+  void TimeQueue::unlink(TimeoutAble & ta) {
+    const u32 bucket = ta.mTQBucket;
+    if (bucket == BUCKET_READY) {
+      if (ta.mTQPrev) ta.mTQPrev->mTQNext = ta.mTQNext;
+      else mReadyHead = ta.mTQNext;
+      if (ta.mTQNext) ta.mTQNext->mTQPrev = ta.mTQPrev;
+      else mReadyTail = ta.mTQPrev;
+    } else {
+      assert(bucket < WHEEL_LEVELS*WHEEL_SLOTS);
+      if (ta.mTQPrev) ta.mTQPrev->mTQNext = ta.mTQNext;
+      else mSlots[bucket] = ta.mTQNext;
+      if (ta.mTQNext) ta.mTQNext->mTQPrev = ta.mTQPrev;
+      --mLevelCount[bucket/WHEEL_SLOTS];
+    }
+    ta.mTQNext = ta.mTQPrev = 0;
+  }
+
+  void TimeQueue::cascade(u32 level, u32 idx) {
+    const u32 bucket = level*WHEEL_SLOTS + idx;
+    TimeoutAble * ta = mSlots[bucket];
+    mSlots[bucket] = 0;
+    while (ta != 0) {
+      TimeoutAble * next = ta->mTQNext;
+      --mLevelCount[level];
+      file(*ta);
+      ta = next;
+    }
+  }
+
+  void TimeQueue::advanceTo(u32 untilMS) {
+    while ((s32) (mWheelTime - untilMS) <= 0) {
+      const u32 t = mWheelTime;
+      const u32 idx = t & WHEEL_MASK;
+
+      // Level 0 wrapped: pull the next slot down from each level that did
+      if (idx == 0) {
+        for (u32 level = 1; level < WHEEL_LEVELS; ++level) {
+          const u32 lidx = (t>>(WHEEL_BITS*level)) & WHEEL_MASK;
+          if (mLevelCount[level] > 0)
+            cascade(level, lidx);
+          if (lidx != 0) break;
+        }
+      }
+
+      // Everything in a level 0 slot is due at exactly tick t
+      TimeoutAble * ta = mSlots[idx];
+      mSlots[idx] = 0;
+      while (ta != 0) {
+        TimeoutAble * next = ta->mTQNext;
+        --mLevelCount[0];
+        fileReady(*ta);
+        ta = next;
+      }
+
+      if (mLevelCount[0] > 0) {
+        mWheelTime = t + 1;
+        continue;
+      }
+
+      // Level 0 is empty: skip straight to its next wrap
+      u32 next = (t | WHEEL_MASK) + 1;
+      if ((s32) (next - (untilMS + 1)) > 0)
+        next = untilMS + 1;
+      mWheelTime = next;
+    }
   }
 
   u32 TimeQueue::now() const {
-    struct timespec time; 
-    clock_gettime(CLOCK_REALTIME, &time); 
+    struct timespec time;
+    FastClock::Realtime(time);
     u32 msnow = (u32) (1000u*time.tv_sec + time.tv_nsec/(1000u*1000u));
     static u32 lastmsnow = 0;
     if (lastmsnow) {
@@ -54,5 +209,5 @@ namespace MFM {
 
     return msnow;
   }
-  
+
 }
@@ -8,6 +8,9 @@ namespace MFM {
     : mTimeMS(0)
     , mNonce(0)
     , mOnTQ(0)
+    , mTQNext(0)
+    , mTQPrev(0)
+    , mTQBucket(0)
   {
   }
 
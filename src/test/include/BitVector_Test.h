@@ -35,6 +35,12 @@ namespace MFM {
 
     static void Test_bitVectorPopulationCount();
 
+    static void Test_bitVectorBulkOps();
+
+    static void Test_bitVectorFixedFields();
+
+    static void Test_bitVectorWideKernels();
+
   };
 } /* namespace MFM */
 #endif /*BITVECTOR_TEST_H*/
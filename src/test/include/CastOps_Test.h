@@ -0,0 +1,26 @@
+#ifndef CASTOPS_TEST_H      /* -*- C++ -*- */
+#define CASTOPS_TEST_H
+
+#include "CastOps.h"
+
+namespace MFM {
+
+  /**
+   * Tests that the compile-time width CastOps agree with the
+   * runtime-width ones.
+   */
+  class CastOps_Test
+  {
+  private:
+    template <u32 WIDTH>
+    static void Test_CastOpsWidth32();
+
+    template <u32 WIDTH>
+    static void Test_CastOpsWidth64();
+
+  public:
+    static void Test_RunTests();
+  };
+
+} /* namespace MFM */
+#endif /*CASTOPS_TEST_H*/
@@ -13,6 +13,7 @@ namespace MFM {
   private:
     static void Test_colorMapSelected();
     static void Test_colorMapInterpolated();
+    static void Test_colorMapLUT();
 
   public:
     static void Test_RunTests();
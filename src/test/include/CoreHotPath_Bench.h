@@ -0,0 +1,22 @@
+#ifndef COREHOTPATH_BENCH_H      /* -*- C++ -*- */
+#define COREHOTPATH_BENCH_H
+
+#include "Test_Common.h"
+#include "Microbench.h"
+
+namespace MFM {
+
+  /**
+     Timings of the core per-event hot paths, one line each as
+     written by Microbench::Report.  Run by 'mfmtest --bench [WxH]',
+     where a WxH adds whole-event timings on a DynamicTile of that
+     size.
+   */
+  class CoreHotPath_Bench
+  {
+  public:
+    static void Bench_RunBenches(ByteSink & out);
+    static void Bench_RunBenches(ByteSink & out, u32 tileWidth, u32 tileHeight);
+  };
+} /* namespace MFM */
+#endif /*COREHOTPATH_BENCH_H*/
@@ -0,0 +1,18 @@
+#ifndef DATUMSTREAMER_TEST_H      /* -*- C++ -*- */
+#define DATUMSTREAMER_TEST_H
+
+#include "DatumStreamer.h"
+
+namespace MFM {
+  class DatumStreamer_Test
+  {
+  private:
+    static void Test_queuesClaims();
+    static void Test_queuesBatches();
+    static void Test_streamerFileToFile();
+
+  public:
+    static void Test_RunTests();
+  };
+}
+#endif /*DATUMSTREAMER_TEST_H*/
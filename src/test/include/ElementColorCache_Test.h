@@ -0,0 +1,21 @@
+#ifndef ELEMENTCOLORCACHE_TEST_H      /* -*- C++ -*- */
+#define ELEMENTCOLORCACHE_TEST_H
+
+#include "ElementColorCache.h"
+
+namespace MFM {
+
+  class ElementColorCache_Test
+  {
+  public:
+    static void Test_RunTests();
+
+    static void Test_colorCacheHits();
+
+    static void Test_colorCacheUndeclared();
+
+    static void Test_colorCacheClear();
+
+  };
+} /* namespace MFM */
+#endif /*ELEMENTCOLORCACHE_TEST_H*/
@@ -0,0 +1,23 @@
+#ifndef ELEMENTPROFILE_TEST_H      /* -*- C++ -*- */
+#define ELEMENTPROFILE_TEST_H
+
+#include "ElementProfile.h"
+
+namespace MFM {
+
+  class ElementProfile_Test
+  {
+  public:
+    static void Test_RunTests();
+
+    static void Test_profileRecord();
+
+    static void Test_profileAdd();
+
+    static void Test_profileTopByTicks();
+
+    static void Test_profileOverflow();
+
+  };
+} /* namespace MFM */
+#endif /*ELEMENTPROFILE_TEST_H*/
@@ -0,0 +1,24 @@
+#ifndef ELEMENTTABLE_TEST_H      /* -*- C++ -*- */
+#define ELEMENTTABLE_TEST_H
+
+#include "Test_Common.h"
+
+namespace MFM {
+
+  /**
+   * Tests for the ElementTable class
+   */
+  class ElementTable_Test
+  {
+  private:
+    static void Test_elementTableFreeze();
+    static void Test_elementTableData();
+    static void Test_elementTableReplace();
+
+    static void Test_elementParameterCache();
+
+  public:
+    static void Test_RunTests();
+  };
+} /* namespace MFM */
+#endif /*ELEMENTTABLE_TEST_H*/
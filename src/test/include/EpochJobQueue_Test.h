@@ -0,0 +1,20 @@
+#ifndef EPOCHJOBQUEUE_TEST_H      /* -*- C++ -*- */
+#define EPOCHJOBQUEUE_TEST_H
+
+#include "EpochJobQueue.h"
+
+namespace MFM {
+
+  class EpochJobQueue_Test
+  {
+  private:
+    static void Test_Replace();
+    static void Test_AppendHeaderOnce();
+    static void Test_Failure();
+
+  public:
+    static void Test_RunTests();
+
+  };
+} /* namespace MFM */
+#endif /*EPOCHJOBQUEUE_TEST_H*/
@@ -16,6 +16,20 @@ public:
 
   static void Test_EventWindowWrite();
 
+  static void Test_EventWindowLoadGather();
+
+  static void Test_EventWindowHistory();
+
+  static void Test_EventWindowHistoryKeyframes();
+
+  static void Test_EventWindowInertCenter();
+
+  static void Test_EventWindowTypeSites();
+
+  static void Test_EventWindowWrittenSites();
+
+  static void Test_EventWindowDiffuse();
+
   static void Test_RunTests();
 };
 } /* namespace MFM */
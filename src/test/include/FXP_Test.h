@@ -15,6 +15,8 @@ namespace MFM {
     static void Test_FXPOps();
     static void Test_FXPCloser();
     static void Test_FXPFarther();
+    static void Test_FXPBatch();
+    static void Test_FXPFastApprox();
 
   public:
     static void Test_RunTests();
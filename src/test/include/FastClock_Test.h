@@ -0,0 +1,19 @@
+#ifndef FASTCLOCK_TEST_H      /* -*- C++ -*- */
+#define FASTCLOCK_TEST_H
+
+#include "FastClock.h"
+
+namespace MFM {
+
+  class FastClock_Test
+  {
+  public:
+    static void Test_RunTests();
+
+    static void Test_clockTracksSystem();
+
+    static void Test_clockFallback();
+
+  };
+} /* namespace MFM */
+#endif /*FASTCLOCK_TEST_H*/
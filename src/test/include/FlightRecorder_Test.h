@@ -0,0 +1,17 @@
+#ifndef FLIGHTRECORDER_TEST_H      /* -*- C++ -*- */
+#define FLIGHTRECORDER_TEST_H
+
+#include "FlightRecorder.h"
+
+namespace MFM {
+  class FlightRecorder_Test
+  {
+  private:
+    static void Test_flightRecorderRing();
+    static void Test_flightRecorderTileEvents();
+
+  public:
+    static void Test_RunTests();
+  };
+}
+#endif /*FLIGHTRECORDER_TEST_H*/
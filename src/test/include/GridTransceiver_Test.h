@@ -12,6 +12,8 @@ namespace MFM {
   public:
     static void Test_Basic();
     static void Test_DataRates();
+    static void Test_DirectMode();
+    static void Test_Spans();
 
     static void Test_RunTests();
 
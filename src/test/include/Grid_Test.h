@@ -15,6 +15,45 @@ namespace MFM {
   {
   public:
     static void Test_gridPlaceAtom();
+    static void Test_gridTilePool();
+    static void Test_gridCacheBatch();
+    static void Test_gridCompactCache();
+    static void Test_gridDirectChannels();
+
+    static void Test_gridCacheRedundancy();
+
+    static void Test_gridNUMAPlacement();
+    static void Test_gridHugePages();
+    static void Test_gridOrderedTileControl();
+    static void Test_gridLockSpin();
+    static void Test_gridSparseEvents();
+    static void Test_gridAgedEvents();
+    static void Test_gridQuiescentSleep();
+    static void Test_gridAtomCountsWhileRunning();
+    static void Test_gridActivityScheduling();
+    static void Test_gridMemoryAccount();
+    static void Test_gridParallelInit();
+    static void Test_gridEventBatches();
+    static void Test_gridEventWorkers();
+    static void Test_gridOptimisticEvents();
+    static void Test_gridSnapshot();
+    static void Test_gridSnapshotAsync();
+    static void Test_gridSnapshotCompressed();
+    static void Test_gridCheckpoint();
+    static void Test_gridDiff();
+    static void Test_gridEnsemble();
+    static void Test_gridReseed();
+    static void Test_gridEventBins();
+    static void Test_gridTileJobs();
+    static void Test_gridDeterministicSteps();
+    static void Test_gridDumpAtoms();
+    static void Test_gridVisibleSites();
+    static void Test_gridPlaceAtomsInRect();
+    static void Test_gridPattern();
+    static void Test_gridTileStats();
+    static void Test_gridSortingWork();
+    static void Test_gridCoordMapping();
+    static void Test_gridRuntimeTileSize();
   };
 } /* namespace MFM */
 #endif /*GRID_TEST_H*/
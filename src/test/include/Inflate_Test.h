@@ -0,0 +1,18 @@
+#ifndef INFLATE_TEST_H      /* -*- C++ -*- */
+#define INFLATE_TEST_H
+
+#include "Inflate.h"
+
+namespace MFM {
+  class Inflate_Test
+  {
+  private:
+    static void Test_inflateBlockTypes();
+    static void Test_inflateRejectsDamage();
+    static void Test_inflateCRC32();
+
+  public:
+    static void Test_RunTests();
+  };
+}
+#endif /*INFLATE_TEST_H*/
@@ -0,0 +1,17 @@
+#ifndef LZBLOCK_TEST_H      /* -*- C++ -*- */
+#define LZBLOCK_TEST_H
+
+#include "LZBlock.h"
+
+namespace MFM {
+  class LZBlock_Test
+  {
+  private:
+    static void Test_lzBlockRoundTrips();
+    static void Test_lzBlockRejectsDamage();
+
+  public:
+    static void Test_RunTests();
+  };
+}
+#endif /*LZBLOCK_TEST_H*/
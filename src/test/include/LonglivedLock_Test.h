@@ -0,0 +1,19 @@
+#ifndef LONGLIVEDLOCK_TEST_H      /* -*- C++ -*- */
+#define LONGLIVEDLOCK_TEST_H
+
+#include "LonglivedLock.h"
+
+namespace MFM {
+  class LonglivedLock_Test
+  {
+  private:
+    static void Test_lockUnlock();
+    static void Test_lockMisuse();
+    static void Test_lockCounts();
+    static void Test_lockThreads();
+
+  public:
+    static void Test_RunTests();
+  };
+}
+#endif /*LONGLIVEDLOCK_TEST_H*/
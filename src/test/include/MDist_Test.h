@@ -12,6 +12,10 @@ namespace MFM {
   {
   public:
     static void Test_MDistConversion();
+
+    static void Test_MDistSymmetryTables();
+
+    static void Test_MDistPrecompiledTables();
   };
 } /* namespace MFM */
 #endif /*MDIST_TEST_H*/
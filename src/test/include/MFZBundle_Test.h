@@ -0,0 +1,18 @@
+#ifndef MFZBUNDLE_TEST_H      /* -*- C++ -*- */
+#define MFZBUNDLE_TEST_H
+
+#include "MFZBundle.h"
+
+namespace MFM {
+  class MFZBundle_Test
+  {
+  private:
+    static void Test_mfzBundleIndexesMembers();
+    static void Test_mfzBundleExtractsOnce();
+    static void Test_mfzBundleRejectsDamage();
+
+  public:
+    static void Test_RunTests();
+  };
+}
+#endif /*MFZBUNDLE_TEST_H*/
@@ -0,0 +1,19 @@
+#ifndef METRICSSERVER_TEST_H      /* -*- C++ -*- */
+#define METRICSSERVER_TEST_H
+
+#include "MetricsServer.h"
+
+namespace MFM {
+
+  class MetricsServer_Test
+  {
+  private:
+    static void Test_Page();
+    static void Test_Scrape();
+
+  public:
+    static void Test_RunTests();
+
+  };
+} /* namespace MFM */
+#endif /*METRICSSERVER_TEST_H*/
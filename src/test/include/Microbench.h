@@ -0,0 +1,65 @@
+#ifndef MICROBENCH_H      /* -*- C++ -*- */
+#define MICROBENCH_H
+
+#include "itype.h"
+#include "ByteSink.h"
+
+namespace MFM {
+
+  /**
+     A minimal timing harness for hot-path microbenchmarks.  A body
+     function is run for some untimed warmup samples and then for a
+     number of timed samples of a fixed iteration count each; the
+     per-iteration times of the samples are reported as a median and
+     a 99th percentile, which are far steadier from run to run than a
+     mean.  Bodies return a checksum of their work, which Microbench
+     accumulates so the compiler cannot discard it.
+   */
+  class Microbench
+  {
+  public:
+
+    typedef u32 (*Body)(void * arg, u32 iterations);
+
+    enum { MAX_SAMPLES = 1001 };
+
+    struct Stats
+    {
+      double m_medianNS;  ///< Median nanoseconds per iteration
+      double m_p99NS;     ///< 99th percentile nanoseconds per iteration
+      double m_minNS;     ///< Fastest sample, nanoseconds per iteration
+    };
+
+    Microbench(u32 warmups = 10, u32 samples = 101, u32 iterations = 10000) ;
+
+    /**
+       Time \a body on \a arg, filling \a stats.
+     */
+    void Measure(Body body, void * arg, Stats & stats) ;
+
+    /**
+       Time \a body on \a arg and print one line of the form
+       'bench,NAME,MEDIAN_NS,P99_NS,MIN_NS' to \a out.
+     */
+    void Report(ByteSink & out, const char * name, Body body, void * arg) ;
+
+    /**
+       Sort \a count > 0 samples in place and summarize them into
+       \a stats.  The percentile is nearest-rank.
+     */
+    static void ComputeStats(double * samples, u32 count, Stats & stats) ;
+
+    u32 GetChecksum() const
+    {
+      return m_checksum;
+    }
+
+  private:
+    u32 m_warmups;
+    u32 m_samples;
+    u32 m_iterations;
+    u32 m_checksum;
+    double m_sampleNS[MAX_SAMPLES];
+  };
+} /* namespace MFM */
+#endif /*MICROBENCH_H*/
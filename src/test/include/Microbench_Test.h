@@ -0,0 +1,19 @@
+#ifndef MICROBENCH_TEST_H      /* -*- C++ -*- */
+#define MICROBENCH_TEST_H
+
+#include "Microbench.h"
+
+namespace MFM {
+
+  class Microbench_Test
+  {
+  public:
+    static void Test_RunTests();
+
+    static void Test_microbenchStats();
+
+    static void Test_microbenchMeasure();
+
+  };
+} /* namespace MFM */
+#endif /*MICROBENCH_TEST_H*/
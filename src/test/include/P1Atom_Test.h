@@ -0,0 +1,21 @@
+#ifndef P1ATOM_TEST_H      /* -*- C++ -*- */
+#define P1ATOM_TEST_H
+
+#include "P1Atom.h"
+
+namespace MFM {
+
+  /**
+   * Tests for the 64 bit P1Atom.
+   */
+  class P1Atom_Test
+  {
+  private:
+
+  public:
+    static void Test_RunTests();
+
+  };
+} /* namespace MFM */
+#endif /*P1ATOM_TEST_H*/
+
@@ -2,6 +2,7 @@
 #define RANDOM_TEST_H
 
 #include "Random.h"
+#include "XoshiroRand.h"
 
 namespace MFM {
   class Random_Test
@@ -10,6 +11,8 @@ namespace MFM {
     static Random & setup();
     static void Test_randomSetSeed();
     static void Test_randomDeterministics();
+    static void Test_randomXoshiro();
+    static void Test_randomGeometricSkip();
 
   public:
     static void Test_RunTests();
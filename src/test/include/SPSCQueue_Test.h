@@ -0,0 +1,20 @@
+#ifndef SPSCQUEUE_TEST_H      /* -*- C++ -*- */
+#define SPSCQUEUE_TEST_H
+
+#include "SPSCQueue.h"
+
+namespace MFM {
+  class SPSCQueue_Test
+  {
+  private:
+    static void Test_queueWrapAround();
+    static void Test_queueAllOrNothing();
+    static void Test_queueNonBlockingRead();
+    static void Test_queueBlockingRead();
+    static void Test_queueBlockingWrite();
+
+  public:
+    static void Test_RunTests();
+  };
+}
+#endif /*SPSCQUEUE_TEST_H*/
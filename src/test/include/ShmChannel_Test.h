@@ -0,0 +1,21 @@
+#ifndef SHMCHANNEL_TEST_H      /* -*- C++ -*- */
+#define SHMCHANNEL_TEST_H
+
+#include "ShmChannel.h"
+
+namespace MFM {
+
+  class ShmChannel_Test
+  {
+  private:
+
+  public:
+    static void Test_Basic();
+    static void Test_Spans();
+    static void Test_Processes();
+
+    static void Test_RunTests();
+
+  };
+} /* namespace MFM */
+#endif /*SHMCHANNEL_TEST_H*/
@@ -0,0 +1,21 @@
+#ifndef SOCKETCHANNEL_TEST_H      /* -*- C++ -*- */
+#define SOCKETCHANNEL_TEST_H
+
+#include "SocketChannel.h"
+
+namespace MFM {
+
+  class SocketChannel_Test
+  {
+  private:
+
+  public:
+    static void Test_Basic();
+    static void Test_Spans();
+    static void Test_Closed();
+
+    static void Test_RunTests();
+
+  };
+} /* namespace MFM */
+#endif /*SOCKETCHANNEL_TEST_H*/
@@ -0,0 +1,19 @@
+#ifndef STATISTICSRING_TEST_H      /* -*- C++ -*- */
+#define STATISTICSRING_TEST_H
+
+#include "StatisticsRing.h"
+
+namespace MFM {
+
+  class StatisticsRing_Test
+  {
+  public:
+    static void Test_RunTests();
+
+    static void Test_ringAppendGet();
+
+    static void Test_ringOverwrite();
+
+  };
+} /* namespace MFM */
+#endif /*STATISTICSRING_TEST_H*/
@@ -23,6 +23,14 @@ namespace MFM {
   typedef Grid<TestGridConfig> TestGrid;
   typedef TestGrid::GridTile TestTile;
 
+  typedef Site<P3AtomConfig, SITE_LAYOUT_PLANAR> TestPlanarSite;
+  typedef EventConfig<TestPlanarSite, 4> TestPlanarEventConfig;
+  typedef SizedTile<TestPlanarEventConfig,40,40,1000> TestPlanarTile;
+
+  typedef Site<P3AtomConfig, SITE_LAYOUT_INTERLEAVED, SITE_FEATURES_NONE> TestLeanSite;
+  typedef EventConfig<TestLeanSite, 4> TestLeanEventConfig;
+  typedef SizedTile<TestLeanEventConfig,40,40,1000> TestLeanTile;
+
   typedef ElementTable<TestEventConfig> TestElementTable;
   typedef EventWindow<TestEventConfig> TestEventWindow;
 
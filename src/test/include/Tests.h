@@ -8,7 +8,13 @@
 #include "BitRef_Test.h"
 #include "UlamElement_Test.h"
 #include "GridTransceiver_Test.h"
+#include "SocketChannel_Test.h"
+#include "MetricsServer_Test.h"
+#include "EpochJobQueue_Test.h"
+#include "ViewServer_Test.h"
+#include "ShmChannel_Test.h"
 #include "ElementRegistry_Test.h"
+#include "ElementTable_Test.h"
 #include "ByteSource_Test.h"
 #include "LineTailByteSink_Test.h"
 #include "OverflowableCharBufferByteSink_Test.h"
@@ -19,16 +25,32 @@
 #include "Parity2D_4x4_Test.h"
 #include "PSym_Test.h"
 #include "Fail_Test.h"
+#include "LonglivedLock_Test.h"
+#include "SPSCQueue_Test.h"
+#include "TileStatsTree_Test.h"
+#include "DatumStreamer_Test.h"
+#include "LZBlock_Test.h"
+#include "Inflate_Test.h"
+#include "MFZBundle_Test.h"
+#include "FlightRecorder_Test.h"
 #include "MDist_Test.h"
 #include "BitVector_Test.h"
 #include "Point_Test.h"
-//XXX Deprecated #include "P1Atom_Test.h"
+#include "P1Atom_Test.h"
 #include "Tile_Test.h"
 #include "Grid_Test.h"
 #include "EventWindow_Test.h"
 #include "Random_Test.h"
 #include "ColorMap_Test.h"
 #include "FXP_Test.h"
+#include "CastOps_Test.h"
 #include "ExternalConfig_Test.h"
+#include "Microbench_Test.h"
+#include "UlamTransientArena_Test.h"
+#include "ElementProfile_Test.h"
+#include "ElementColorCache_Test.h"
+#include "StatisticsRing_Test.h"
+#include "FastClock_Test.h"
+#include "CoreHotPath_Bench.h"
 
 #endif /*TESTS_H*/
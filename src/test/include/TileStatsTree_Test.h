@@ -0,0 +1,18 @@
+#ifndef TILESTATSTREE_TEST_H      /* -*- C++ -*- */
+#define TILESTATSTREE_TEST_H
+
+#include "TileStatsTree.h"
+
+namespace MFM {
+  class TileStatsTree_Test
+  {
+  private:
+    static void Test_treeShape();
+    static void Test_treeTotals();
+    static void Test_treeConcurrentPublish();
+
+  public:
+    static void Test_RunTests();
+  };
+}
+#endif /*TILESTATSTREE_TEST_H*/
@@ -15,6 +15,19 @@ namespace MFM {
 
     static void Test_tilePlaceAtom();
     static void Test_tileSquareDistances();
+    static void Test_tileSiteLayouts();
+    static void Test_tileSiteFeatures();
+    static void Test_tileBaseLayer();
+    static void Test_tileAtomCounts();
+    static void Test_tileChangeStamps();
+    static void Test_tileAgedEvents();
+    static void Test_tileSizedGeometry();
+    static void Test_tileDynamic();
+    static void Test_tileParameterSource();
+    static void Test_tileSiteOwners();
+    static void Test_tileSiteSpans();
+    static void Test_tileRegionAtReach();
+    static void Test_tileSweeper();
   };
 } /* namespace MFM */
 
@@ -30,6 +30,12 @@ namespace MFM {
 
     static void Test_UlamRefWriteBV();
 
+    static void Test_UlamRefVirtualCallCache();
+
+    static void Test_UlamRefFinalHints();
+
+    static void Test_UlamRefBitStorageCopy();
+
   };
 } /* namespace MFM */
 #endif /*ULAMREF_TEST_H*/
@@ -0,0 +1,21 @@
+#ifndef ULAMTRANSIENTARENA_TEST_H      /* -*- C++ -*- */
+#define ULAMTRANSIENTARENA_TEST_H
+
+#include "UlamTransientArena.h"
+
+namespace MFM {
+
+  class UlamTransientArena_Test
+  {
+  public:
+    static void Test_RunTests();
+
+    static void Test_arenaAllocate();
+
+    static void Test_arenaMarkRelease();
+
+    static void Test_arenaBitStorage();
+
+  };
+} /* namespace MFM */
+#endif /*ULAMTRANSIENTARENA_TEST_H*/
@@ -0,0 +1,20 @@
+#ifndef VIEWSERVER_TEST_H      /* -*- C++ -*- */
+#define VIEWSERVER_TEST_H
+
+#include "ViewServer.h"
+#include "ViewClient.h"
+
+namespace MFM {
+
+  class ViewServer_Test
+  {
+  private:
+    static void Test_Codec();
+    static void Test_Stream();
+
+  public:
+    static void Test_RunTests();
+
+  };
+} /* namespace MFM */
+#endif /*VIEWSERVER_TEST_H*/
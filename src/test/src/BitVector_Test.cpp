@@ -1,6 +1,7 @@
 #include "assert.h"
 #include "BitVector_Test.h"
 #include "itype.h"
+#include "Random.h"
 
 namespace MFM {
   const u32 vals[8] =
@@ -36,6 +37,9 @@ namespace MFM {
     Test_bitVectorStoreBits();
     Test_bitVectorReadWriteBV();
     Test_bitVectorPopulationCount();
+    Test_bitVectorBulkOps();
+    Test_bitVectorFixedFields();
+    Test_bitVectorWideKernels();
   }
 
   static BitVector<256> bits(vals);
@@ -503,4 +507,129 @@ namespace MFM {
     }
   }
 
+
+  // Exercise the vector and the scalar tail paths on one size
+  template <u32 B>
+  static void TestBulkOpsAtSize()
+  {
+    BitVector<B> a, b, diff, mask;
+    for (u32 i = 0; i < B; i += 3) a.SetBit(i);
+    b = a;
+    assert(a == b);
+    assert(!(a != b));
+    assert(!a.XorDiff(b, diff));
+    assert(diff.PopulationCount() == 0);
+
+    // A difference in every unit, and one in the last bit
+    for (u32 i = 1; i < B; i += BitVector<B>::BITS_PER_UNIT) b.ToggleBit(i);
+    b.ToggleBit(B - 1);
+    assert(a != b);
+    assert(a.XorDiff(b, diff));
+    for (u32 i = 0; i < B; ++i)
+      assert(diff.ReadBit(i) == (a.ReadBit(i) != b.ReadBit(i)));
+
+    // Whole-vector population count agrees with per-bit counting
+    u32 ones = 0;
+    for (u32 i = 0; i < B; ++i) if (b.ReadBit(i)) ++ones;
+    assert(b.PopulationCount() == ones);
+    assert(b.PopulationCount(1) == ones - (b.ReadBit(0) ? 1 : 0));
+
+    // Masked copy of the differences turns a into b
+    BitVector<B> c = a;
+    c.MaskedCopy(b, diff);
+    assert(c == b);
+
+    // Masked copy under an empty mask changes nothing
+    c = a;
+    c.MaskedCopy(b, mask);
+    assert(c == a);
+
+    // And under a partial mask, only masked bits move
+    mask.SetBits(0, B / 2);
+    c = a;
+    c.MaskedCopy(b, mask);
+    for (u32 i = 0; i < B; ++i)
+      assert(c.ReadBit(i) == (i < B / 2 ? b.ReadBit(i) : a.ReadBit(i)));
+  }
+
+  void BitVector_Test::Test_bitVectorBulkOps()
+  {
+    TestBulkOpsAtSize<32>();
+    TestBulkOpsAtSize<96>();
+    TestBulkOpsAtSize<256>();
+    TestBulkOpsAtSize<416>();
+  }
+
+  // ReadFixed/WriteFixed must agree with Read/Write, and touch
+  // nothing outside the field
+  template <u32 START, u32 LENGTH>
+  static void TestFixedField(const BitVector<256> & init)
+  {
+    BitVector<256> a = init;
+    assert((a.ReadFixed<START,LENGTH>()) == a.Read(START, LENGTH));
+
+    const u32 val = 0xdeadbeef;
+    BitVector<256> b = init;
+    a.WriteFixed<START,LENGTH>(val);
+    b.Write(START, LENGTH, val);
+    assert(a == b);
+    assert((a.ReadFixed<START,LENGTH>()) == (val & MakeMaskClip(LENGTH)));
+  }
+
+  void BitVector_Test::Test_bitVectorFixedFields()
+  {
+    BitVector<256> & init = *setup();
+
+    TestFixedField<0,0>(init);
+    TestFixedField<0,1>(init);
+    TestFixedField<0,32>(init);     // Exactly one unit
+    TestFixedField<3,7>(init);
+    TestFixedField<25,7>(init);     // Ends on a unit boundary
+    TestFixedField<28,8>(init);     // Split across units
+    TestFixedField<33,32>(init);    // Full-length split
+    TestFixedField<224,32>(init);   // Last unit
+    TestFixedField<250,6>(init);    // Last bits
+  }
+
+  void BitVector_Test::Test_bitVectorWideKernels()
+  {
+    // Check the u64-at-a-time paths against bit-at-a-time truth, at
+    // every alignment and length
+    Random random(2718);
+    BitVector<256> src, dst, truth;
+    for (u32 trial = 0; trial < 2000; ++trial)
+    {
+      for (u32 i = 0; i < 8; ++i) {
+        src.Write(i * 32, 32, random.Create());
+        dst.Write(i * 32, 32, random.Create());
+      }
+      truth = dst;
+
+      const u32 len = random.Create(65);
+      const u32 from = random.Create(257 - len);
+      const u32 to = random.Create(257 - len);
+
+      u64 expect = 0;
+      for (u32 b = 0; b < len; ++b)
+        expect = (expect << 1) | (src.ReadBit(from + b) ? 1 : 0);
+      assert(src.ReadLong(from, len) == expect);
+
+      dst.WriteLong(to, len, expect);
+      for (u32 b = 0; b < len; ++b)
+        truth.WriteBit(to + b, src.ReadBit(from + b));
+      assert(dst == truth);
+
+      const u32 clen = random.Create(257 - (from > to ? from : to));
+      src.CopyBV(from, to, clen, dst);
+      for (u32 b = 0; b < clen; ++b)
+        truth.WriteBit(to + b, src.ReadBit(from + b));
+      assert(dst == truth);
+      assert(src.EqualsBV(from, to, clen, dst));
+      if (clen > 0) {
+        const u32 flip = to + random.Create(clen);
+        dst.ToggleBit(flip);
+        assert(!src.EqualsBV(from, to, clen, dst));
+      }
+    }
+  }
 } /* namespace MFM */
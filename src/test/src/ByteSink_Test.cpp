@@ -3,6 +3,10 @@
 #include "Util.h"
 #include "CharBufferByteSink.h"
 #include "ByteSerializable.h"
+#include "FileByteSink.h"
+#include <stdio.h>
+#include <string.h>        /* For memcmp */
+#include <unistd.h>        /* For unlink */
 #include <stdlib.h>        /* For strtol */
 
 namespace MFM {
@@ -203,6 +207,53 @@ namespace MFM {
 
   }
 
+  static void Test_FileBuffered() {
+    const char * path = "/tmp/mfm-bytesink-test.txt";
+    const u32 LINES = 2000;
+
+    for (u32 mode = 0; mode < 2; ++mode)
+    {
+      FILE * fp = fopen(path, "w");
+      assert(fp);
+      FileByteSink fbs(fp);
+      fbs.SetBufferBytes(100);  // Smaller than some writes
+      assert(fbs.GetBufferBytes() == 100);
+      if (mode == 1)
+      {
+        /* May be unsupported here; then it's just buffered */
+        if (fbs.SetDirectIO(true))
+        {
+          assert(fbs.IsDirectIO());
+          assert(fbs.GetBufferBytes() % FileByteSink::DIRECT_IO_ALIGN == 0);
+        }
+      }
+      for (u32 i = 0; i < LINES; ++i)
+      {
+        fbs.Printf("%08d %s\n", i, i % 7 ? "x" :
+                   "a line long enough to overrun the whole of the small buffer"
+                   " that it is being written through, in one piece");
+      }
+      fbs.Close();
+      assert(!fbs.IsDirectIO());
+
+      fp = fopen(path, "r");
+      assert(fp);
+      char line[200];
+      for (u32 i = 0; i < LINES; ++i)
+      {
+        assert(fgets(line, sizeof(line), fp));
+        char expected[200];
+        snprintf(expected, sizeof(expected), "%08d %s\n", i, i % 7 ? "x" :
+                 "a line long enough to overrun the whole of the small buffer"
+                 " that it is being written through, in one piece");
+        assert(!strcmp(line, expected));
+      }
+      assert(!fgets(line, sizeof(line), fp));
+      fclose(fp);
+      unlink(path);
+    }
+  }
+
   void ByteSink_Test::Test_RunTests() {
     Test_Numbers();
     Test_Bytes();
@@ -210,6 +261,7 @@ namespace MFM {
     Test_Printf();
     Test_PrintfWidths();
     Test_Sinkable();
+    Test_FileBuffered();
   }
 
 } /* namespace MFM */
@@ -2,8 +2,14 @@
 #include "ByteSource_Test.h"
 
 #include "ZStringByteSource.h"
+#include "CharBufferByteSource.h"
+#include "LineCountingByteSource.h"
+#include "FileByteSource.h"
 #include "CharBufferByteSink.h"
 #include "UUID.h"
+#include "Util.h"
+#include <stdio.h>
+#include <unistd.h>        /* For unlink */
 
 namespace MFM {
 
@@ -345,6 +351,124 @@ namespace MFM {
     //                             "(%[\t\n ]%[^,\t\n ]%[^\t\n ],
   }
 
+  static void Test_ReadSpans() {
+    u8 buf[10];
+
+    tester.Reset("abcdef");
+    const u32 before = tester.GetBytesRead();
+    assert(tester.Read() == 'a');
+    tester.Unread();
+    assert(tester.Read(buf, 3) == 3);   // Includes the unread byte
+    assert(!memcmp(buf, "abc", 3));
+    assert(tester.GetBytesRead() == before + 3);
+    tester.Unread();
+    assert(tester.Read() == 'c');
+
+    assert(tester.Read(buf, 10) == 3);  // Short at end of input
+    assert(!memcmp(buf, "def", 3));
+    tester.Unread();
+    assert(tester.Read() == -1);
+    assert(tester.Read(buf, 10) == 0);
+
+    const char text[] = "ab\ncd\nef";
+    CharBufferByteSource cbs(text, sizeof(text) - 1);
+    LineCountingByteSource lcbs;
+    lcbs.SetByteSource(cbs);
+    assert(lcbs.Read(buf, 4) == 4);
+    assert(!memcmp(buf, "ab\nc", 4));
+    assert(lcbs.GetLineNum() == 2);
+    assert(lcbs.GetByteNum() == 1);
+    assert(lcbs.Read(buf, 10) == 4);
+    assert(lcbs.GetLineNum() == 3);
+    assert(lcbs.GetByteNum() == 2);
+  }
+
+  static void Test_Scan64RoundTrip() {
+    const u64 values[] = {
+      0, 1, 9, 10, 0xfff, 123456789, HexU64(0, 0xffffffff), HexU64(0x12, 0x3456789a),
+      HexU64(0xe8, 0xd4a51000), HexU64(0xfedcba98, 0x76543210), U64_MAX
+    };
+    const u32 count = sizeof(values) / sizeof(values[0]);
+    const Format::Type codes[] = { Format::LEX64, Format::LXX64, Format::BEU64 };
+
+    for (u32 c = 0; c < sizeof(codes) / sizeof(codes[0]); ++c)
+    {
+      CharBufferByteSink<512> out;
+      for (u32 i = 0; i < count; ++i)
+      {
+        out.Print(values[i], codes[c]);
+      }
+      out.Print(values[3], codes[c], 12, '0');  // Padded field
+
+      CharBufferByteSource cbs(out.GetZString(), out.GetLength());
+      LineCountingByteSource lcbs;
+      lcbs.SetByteSource(cbs);
+      for (u32 i = 0; i < count; ++i)
+      {
+        u64 num = 0;
+        assert(lcbs.Scan(num, codes[c]));
+        assert(num == values[i]);
+      }
+      u64 num = 0;
+      assert(lcbs.Scan(num, codes[c]));
+      assert(num == values[3]);
+      assert(lcbs.Read() == -1);
+      assert(lcbs.GetBytesRead() == out.GetLength() + 1);
+    }
+
+    u64 num;
+    tester.Reset("8123456789");  // A lex 8 digit number is 8 digits
+    assert(tester.Scan(num, Format::LEX64));
+    assert(num == 12345678);
+
+    tester.Reset("3a9");         // Not decimal
+    assert(!tester.Scan(num, Format::LEX64));
+
+    tester.Reset("9212123456789abc");
+    assert(tester.Scan(num, Format::LXX64));
+    assert(num == HexU64(0x1234, 0x56789abc));
+  }
+
+  static void Test_FileSource() {
+    const char * path = "/tmp/mfm-bytesource-test.txt";
+    const u32 LINES = 40000;  // Spans a few buffer refills
+
+    FILE * fp = fopen(path, "w");
+    assert(fp);
+    for (u32 i = 0; i < LINES; ++i)
+    {
+      fprintf(fp, "%06d\n", i);
+    }
+    fclose(fp);
+
+    FileByteSource fbs(path);
+    assert(fbs.IsOpen());
+    LineCountingByteSource lcbs;
+    lcbs.SetByteSource(fbs);
+    for (u32 i = 0; i < LINES; ++i)
+    {
+      s32 num;
+      assert(lcbs.Scanf("%d\n", &num) == 2);
+      assert((u32) num == i);
+    }
+    assert(lcbs.Read() < 0);
+    assert(lcbs.GetLineNum() == LINES + 1);
+
+    /* Positions stay true across refills */
+    const long at = 7 * (FileByteSource::BUFFER_BYTES / 7 - 1);
+    assert(fbs.Seek(at, SEEK_SET));
+    assert(fbs.Tell() == at);
+    u8 buf[21];
+    assert(fbs.ReadBytes(buf, 21) == 21);
+    assert(fbs.Tell() == at + 21);
+    assert(buf[6] == '\n' && buf[13] == '\n' && buf[20] == '\n');
+    assert(fbs.Seek(-7, SEEK_CUR));
+    assert(fbs.GetByte() == buf[14]);
+
+    fbs.Close();
+    unlink(path);
+  }
+
   void ByteSource_Test::Test_RunTests() {
     Test_Basic();
     Test_Unread();
@@ -354,6 +478,9 @@ namespace MFM {
     Test_ScanFieldwidths();
     Test_ScanfSimple();
     Test_ScanfComplex();
+    Test_ReadSpans();
+    Test_Scan64RoundTrip();
+    Test_FileSource();
   }
 
 } /* namespace MFM */
@@ -0,0 +1,102 @@
+#include <assert.h>
+#include "CastOps_Test.h"
+
+namespace MFM {
+
+  /* Operands near zero and near every width's limits */
+  static const u32 SAMPLES32[] = {
+    0, 1, 2, 3, 5, 0x7, 0x8, 0x1f, 0x20, 0x7f, 0x80, 0xff, 0x7fff, 0x8000,
+    0xffff, 0x12345, 0x7fffffff, 0x80000000, 0x80000001, 0xfffffffe, 0xffffffff
+  };
+  static const u32 SAMPLE_COUNT = sizeof(SAMPLES32) / sizeof(SAMPLES32[0]);
+
+  template <u32 WIDTH>
+  void CastOps_Test::Test_CastOpsWidth32()
+  {
+    for (u32 i = 0; i < SAMPLE_COUNT; ++i)
+    {
+      const u32 a = SAMPLES32[i] & _GetNOnes32(WIDTH);
+      const s32 ca = (s32) SAMPLES32[i];
+
+      assert(_Int32ToCs32<WIDTH>(a) == _Int32ToCs32(a, WIDTH));
+      assert(_Cs32ToInt32<WIDTH>(ca) == _Cs32ToInt32(ca, WIDTH));
+      assert(_Cu32ToUnsigned32<WIDTH>(SAMPLES32[i]) == _Cu32ToUnsigned32(SAMPLES32[i], WIDTH));
+      assert(_Cs32ToUnsigned32<WIDTH>(ca) == _Cs32ToUnsigned32(ca, WIDTH));
+      assert((_Int32ToInt32<WIDTH,7>(a)) == _Int32ToInt32(a, WIDTH, 7));
+      assert((_Int32ToInt32<7,WIDTH>(a & 0x7f)) == _Int32ToInt32(a & 0x7f, 7, WIDTH));
+      assert((_Int32ToUnsigned32<WIDTH,5>(a)) == _Int32ToUnsigned32(a, WIDTH, 5));
+      assert((_Unsigned32ToUnsigned32<WIDTH,6>(a)) == _Unsigned32ToUnsigned32(a, WIDTH, 6));
+      assert((_Unsigned32ToInt32<WIDTH,4>(a)) == _Unsigned32ToInt32(a, WIDTH, 4));
+
+      for (u32 j = 0; j < SAMPLE_COUNT; ++j)
+      {
+        const u32 b = SAMPLES32[j] & _GetNOnes32(WIDTH);
+        assert(_BinOpAddInt32<WIDTH>(a, b) == _BinOpAddInt32(a, b, WIDTH));
+        assert(_BinOpSubtractInt32<WIDTH>(a, b) == _BinOpSubtractInt32(a, b, WIDTH));
+        assert(_BinOpAddUnsigned32<WIDTH>(a, b) == _BinOpAddUnsigned32(a, b, WIDTH));
+        assert(_BinOpSubtractUnsigned32<WIDTH>(a, b) == _BinOpSubtractUnsigned32(a, b, WIDTH));
+
+        // The runtime multiplies overflow their C type first above
+        // these widths; check the saturation directly there
+        if (WIDTH <= 15 || WIDTH == 32)
+          assert(_BinOpMultiplyInt32<WIDTH>(a, b) == _BinOpMultiplyInt32(a, b, WIDTH));
+        if (WIDTH <= 16 || WIDTH == 32)
+          assert(_BinOpMultiplyUnsigned32<WIDTH>(a, b) == _BinOpMultiplyUnsigned32(a, b, WIDTH));
+      }
+    }
+
+    if (WIDTH > 1)
+    {
+      const u32 max = _GetNOnes32(WIDTH - 1);
+      assert(_BinOpMultiplyInt32<WIDTH>(max, max) == max);
+      assert(_BinOpMultiplyInt32<WIDTH>(max, _Cs32ToInt32(-1, WIDTH)) ==
+             _Cs32ToInt32(-(s32) max, WIDTH));
+    }
+    assert(_BinOpMultiplyUnsigned32<WIDTH>(_GetNOnes32(WIDTH), _GetNOnes32(WIDTH)) ==
+           _GetNOnes32(WIDTH));
+  }
+
+  template <u32 WIDTH>
+  void CastOps_Test::Test_CastOpsWidth64()
+  {
+    for (u32 i = 0; i < SAMPLE_COUNT; ++i)
+    {
+      for (u32 j = 0; j < SAMPLE_COUNT; ++j)
+      {
+        const u64 raw = (((u64) SAMPLES32[i]) << 32) | SAMPLES32[j];
+        const u64 a = raw & _GetNOnes64(WIDTH);
+        const s64 ca = (s64) raw;
+        const u64 b = (((u64) SAMPLES32[j]) << 32 | SAMPLES32[i]) & _GetNOnes64(WIDTH);
+
+        assert(_Int64ToCs64<WIDTH>(a) == _Int64ToCs64(a, WIDTH));
+        assert(_Cs64ToInt64<WIDTH>(ca) == _Cs64ToInt64(ca, WIDTH));
+        assert(_Cu64ToUnsigned64<WIDTH>(raw) == _Cu64ToUnsigned64(raw, WIDTH));
+        assert(_Cs64ToUnsigned64<WIDTH>(ca) == _Cs64ToUnsigned64(ca, WIDTH));
+        assert((_Int64ToInt64<WIDTH,40>(a)) == _Int64ToInt64(a, WIDTH, 40));
+        assert(_BinOpAddInt64<WIDTH>(a, b) == _BinOpAddInt64(a, b, WIDTH));
+        assert(_BinOpSubtractInt64<WIDTH>(a, b) == _BinOpSubtractInt64(a, b, WIDTH));
+        assert(_BinOpAddUnsigned64<WIDTH>(a, b) == _BinOpAddUnsigned64(a, b, WIDTH));
+        assert(_BinOpSubtractUnsigned64<WIDTH>(a, b) == _BinOpSubtractUnsigned64(a, b, WIDTH));
+      }
+    }
+  }
+
+  void CastOps_Test::Test_RunTests()
+  {
+    Test_CastOpsWidth32<1>();
+    Test_CastOpsWidth32<2>();
+    Test_CastOpsWidth32<7>();
+    Test_CastOpsWidth32<8>();
+    Test_CastOpsWidth32<15>();
+    Test_CastOpsWidth32<16>();
+    Test_CastOpsWidth32<17>();
+    Test_CastOpsWidth32<31>();
+    Test_CastOpsWidth32<32>();
+
+    Test_CastOpsWidth64<33>();
+    Test_CastOpsWidth64<40>();
+    Test_CastOpsWidth64<63>();
+    Test_CastOpsWidth64<64>();
+  }
+
+} /* namespace MFM */
@@ -16,6 +16,7 @@ namespace MFM {
   void ColorMap_Test::Test_RunTests() {
     Test_colorMapSelected();
     Test_colorMapInterpolated();
+    Test_colorMapLUT();
   }
 
   void ColorMap_Test::Test_colorMapSelected()
@@ -84,4 +85,24 @@ namespace MFM {
     }
   }
 
+  void ColorMap_Test::Test_colorMapLUT()
+  {
+    const ColorMap & cm = ColorMap_DBG5_BKWH::THE_INSTANCE;
+    const u32 last = ColorMap::LUT_SIZE - 1;
+    assert(cm.GetLUTColor(0) == 0xff000000);
+    assert(cm.GetLUTColor(last) == 0xffffffff);
+    assert(cm.GetLUTColor(last + 100) == 0xffffffff);
+    assertColorsClose(cm.GetLUTColor(last / 2), 0xff808080);
+
+    // Quantized lookups agree with the float interface
+    for (u32 i = 0; i <= last; i += 31) {
+      assert(cm.GetLUTColor(i) == cm.GetInterpolatedColor(i, 0, last, 0xffff0000));
+    }
+
+    // Multi-color maps run from their first color to their last
+    const ColorMap & ch = ColorMap_CubeHelix::THE_INSTANCE;
+    assert(ch.GetLUTColor(0) == ch.GetSelectedColor(0, 0, 1, 0xffff0000));
+    assert(ch.GetLUTColor(last) == ch.GetSelectedColor(1, 0, 1, 0xffff0000));
+  }
+
 } /* namespace MFM */
@@ -0,0 +1,349 @@
+#include "CoreHotPath_Bench.h"
+#include "MDist.h"
+#include "PSym.h"
+#include "UlamRef.h"
+#include "Packet.h"
+#include "CharBufferByteSource.h"
+#include "Element_Empty.h"
+#include "Element_Res.h"
+#include "Element_Wall.h"
+#include "Element_Dreg.h"
+#include "DynamicTile.h"
+#include "CastOps.h"
+#include "TileSweeper.h"
+
+namespace MFM {
+
+  typedef UlamRef<TestEventConfig> TestUlamRef;
+  typedef UlamContext<TestEventConfig> TestUlamContext;
+
+  static u32 BenchBitVectorRead(void * arg, u32 iterations)
+  {
+    const BitVector<96> & bv = *(const BitVector<96> *) arg;
+    u32 sum = 0;
+    for (u32 i = 0; i < iterations; ++i)
+    {
+      sum += bv.Read(i % 64, 1 + (i & 31));
+    }
+    return sum;
+  }
+
+  static u32 BenchBitVectorWrite(void * arg, u32 iterations)
+  {
+    BitVector<96> & bv = *(BitVector<96> *) arg;
+    for (u32 i = 0; i < iterations; ++i)
+    {
+      bv.Write(i % 64, 1 + (i & 31), i);
+    }
+    return bv.Read(0, 32);
+  }
+
+  static u32 BenchMDistLookup(void * arg, u32 iterations)
+  {
+    const MDist<4> & md = MDist<4>::get();
+    const u32 sites = EVENT_WINDOW_SITES(4);
+    u32 sum = 0;
+    for (u32 i = 0; i < iterations; ++i)
+    {
+      const SPoint & pt = md.GetPoint(i % sites);
+      sum += md.FromPoint(pt, 4) + pt.GetX();
+    }
+    return sum;
+  }
+
+  static u32 BenchPSymMapping(void * arg, u32 iterations)
+  {
+    const TestEventWindow & ew = *(const TestEventWindow *) arg;
+    const MDist<4> & md = MDist<4>::get();
+    const u32 sites = EVENT_WINDOW_SITES(4);
+    u32 sum = 0;
+    for (u32 i = 0; i < iterations; ++i)
+    {
+      sum += ew.MapToIndexSymValid(md.GetPoint(i % sites), (PointSymmetry) (i & 7));
+    }
+    return sum;
+  }
+
+  static u32 BenchInitForEvent(void * arg, u32 iterations)
+  {
+    TestEventWindow & ew = *(TestEventWindow *) arg;
+    const SPoint center(15, 20);  // Hitting no caches
+    u32 sum = 0;
+    for (u32 i = 0; i < iterations; ++i)
+    {
+      sum += ew.InitForEvent(center, false);
+      ew.SetFree();
+    }
+    return sum;
+  }
+
+  struct ElementTableBenchArg
+  {
+    TestElementTable * m_table;
+    u32 m_types[4];
+  };
+
+  static u32 BenchElementTableLookup(void * arg, u32 iterations)
+  {
+    const ElementTableBenchArg & eta = *(const ElementTableBenchArg *) arg;
+    u32 sum = 0;
+    for (u32 i = 0; i < iterations; ++i)
+    {
+      sum += eta.m_table->Lookup(eta.m_types[i & 3]) != 0;
+    }
+    return sum;
+  }
+
+  static u32 BenchUlamRefRead(void * arg, u32 iterations)
+  {
+    const TestUlamRef & ur = *(const TestUlamRef *) arg;
+    u32 sum = 0;
+    for (u32 i = 0; i < iterations; ++i)
+    {
+      sum += ur.Read();
+    }
+    return sum;
+  }
+
+  static u32 BenchUlamRefWrite(void * arg, u32 iterations)
+  {
+    TestUlamRef & ur = *(TestUlamRef *) arg;
+    for (u32 i = 0; i < iterations; ++i)
+    {
+      ur.Write(i);
+    }
+    return ur.Read();
+  }
+
+  /* PacketIO needs a live CacheProcessor to send or receive, so these
+     time the same wire encoding that PacketIO::SendAtom and
+     PacketIO::ReceiveAtom perform, minus the shipping. */
+  static u32 BenchPacketEncode(void * arg, u32 iterations)
+  {
+    const TestAtom & atom = *(const TestAtom *) arg;
+    PacketBuffer buf;
+    u32 sum = 0;
+    for (u32 i = 0; i < iterations; ++i)
+    {
+      buf.Reset();
+      buf.Printf("%c%c", PacketType::UPDATE, i & 0x1f);
+      atom.GetBits().PrintBytes(buf);
+      sum += buf.GetLength();
+    }
+    return sum;
+  }
+
+  static u32 BenchPacketDecode(void * arg, u32 iterations)
+  {
+    const PacketBuffer & buf = *(const PacketBuffer *) arg;
+    u32 sum = 0;
+    for (u32 i = 0; i < iterations; ++i)
+    {
+      CharBufferByteSource cbs = buf.AsByteSource();
+      u8 ptype, site;
+      TestAtom atom;
+      if (cbs.Scanf("%c%c", &ptype, &site) == 2 && atom.GetBits().ReadBytes(cbs))
+      {
+        sum += site + atom.GetType();
+      }
+    }
+    return sum;
+  }
+
+  /* Whole events, as Tile::AdvanceComputation runs them, on a lone
+     tile seeded with a few Dregs.  Same seed, same events, whatever
+     kind of tile it is. */
+  static void SeedTileBench(Tile<TestEventConfig> & tile)
+  {
+    tile.RegisterElement(Element_Res<TestEventConfig>::THE_INSTANCE);
+    tile.RegisterElement(Element_Dreg<TestEventConfig>::THE_INSTANCE);
+    tile.GetRandom().SetSeed(1);
+    const TestAtom dreg(Element_Dreg<TestEventConfig>::THE_INSTANCE.GetDefaultAtom());
+    for (u32 i = 0; i < 8; ++i)
+    {
+      tile.PlaceAtom(dreg, tile.GetRandomOwnedCoord());
+    }
+  }
+
+  static u32 BenchTileEvents(void * arg, u32 iterations)
+  {
+    Tile<TestEventConfig> & tile = *(Tile<TestEventConfig> *) arg;
+    TestEventWindow & ew = tile.GetEventWindow();
+    u32 sum = 0;
+    for (u32 i = 0; i < iterations; ++i)
+    {
+      sum += ew.TryEventAtForTesting(tile.GetRandomOwnedCoord());
+    }
+    return sum;
+  }
+
+  /* The same tile's events as TileSweeper phases, with Dreg and Res
+     run by the sweep kernel.  Counts events, not calls. */
+  struct TileSweepBenchArg
+  {
+    Tile<TestEventConfig> * m_tile;
+    TileSweeper<TestEventConfig> m_sweeper;
+    u32 m_phase;
+  };
+
+  static u32 BenchTileSweep(void * arg, u32 iterations)
+  {
+    TileSweepBenchArg & tsa = *(TileSweepBenchArg *) arg;
+    u32 events = 0;
+    while (events < iterations)
+    {
+      const u32 phase = tsa.m_phase % TileSweeper<TestEventConfig>::PHASES;
+      events += tsa.m_sweeper.SweepPhase(*tsa.m_tile, tsa.m_phase, phase);
+      ++tsa.m_phase;
+    }
+    return events;
+  }
+
+  /* A typical generated-ulam step -- an Int(7) accumulator, an
+     Unsigned(6) counter, and a narrowing cast -- with the widths read
+     from memory, as the runtime-width CastOps see them when not
+     inlined with constants, versus the same step with template
+     widths. */
+  struct CastOpsBenchArg
+  {
+    u32 m_intWidth;
+    u32 m_unsignedWidth;
+    u32 m_narrowWidth;
+  };
+
+  static u32 BenchCastOpsRuntimeWidth(void * arg, u32 iterations)
+  {
+    const CastOpsBenchArg & coa = *(const CastOpsBenchArg *) arg;
+    u32 acc = 0, count = 0, sum = 0;
+    for (u32 i = 0; i < iterations; ++i)
+    {
+      const u32 step = _Cs32ToInt32((s32) (i & 15) - 8, coa.m_intWidth);
+      acc = _BinOpAddInt32(acc, step, coa.m_intWidth);
+      count = _BinOpAddUnsigned32(count, i & 3, coa.m_unsignedWidth);
+      count = _BinOpSubtractUnsigned32(count, (i >> 2) & 3, coa.m_unsignedWidth);
+      sum += _Int32ToUnsigned32(acc, coa.m_intWidth, coa.m_narrowWidth) + count;
+    }
+    return sum;
+  }
+
+  static u32 BenchCastOpsTemplateWidth(void * arg, u32 iterations)
+  {
+    u32 acc = 0, count = 0, sum = 0;
+    for (u32 i = 0; i < iterations; ++i)
+    {
+      const u32 step = _Cs32ToInt32<7>((s32) (i & 15) - 8);
+      acc = _BinOpAddInt32<7>(acc, step);
+      count = _BinOpAddUnsigned32<6>(count, i & 3);
+      count = _BinOpSubtractUnsigned32<6>(count, (i >> 2) & 3);
+      sum += _Int32ToUnsigned32<7,4>(acc) + count;
+    }
+    return sum;
+  }
+
+  void CoreHotPath_Bench::Bench_RunBenches(ByteSink & out)
+  {
+    Bench_RunBenches(out, 0, 0);
+  }
+
+  void CoreHotPath_Bench::Bench_RunBenches(ByteSink & out, u32 tileWidth, u32 tileHeight)
+  {
+    Microbench mb;
+
+    BitVector<96> bv;
+    for (u32 i = 0; i < 3; ++i)
+    {
+      bv.Write(i * 32, 32, 0x87654321 * (i + 1));
+    }
+    mb.Report(out, "BitVector::Read", BenchBitVectorRead, &bv);
+    mb.Report(out, "BitVector::Write", BenchBitVectorWrite, &bv);
+
+    mb.Report(out, "MDist::GetPoint+FromPoint", BenchMDistLookup, 0);
+
+    static TestTile tile;  // Sizable; keep it off the stack
+    ElementTypeNumberMap<TestEventConfig> etnm;
+    Element_Dreg<TestEventConfig>::THE_INSTANCE.AllocateTypeForTesting(etnm);
+    tile.RegisterElement(Element_Dreg<TestEventConfig>::THE_INSTANCE);
+    tile.PlaceAtom(Element_Dreg<TestEventConfig>::THE_INSTANCE.GetDefaultAtom(), SPoint(15, 20));
+
+    TestEventWindow & ew = tile.GetEventWindow();
+    ew.SetBoundary(TestEventConfig::EVENT_WINDOW_RADIUS + 1);  // The whole window
+    mb.Report(out, "EventWindow::MapToIndexSymValid", BenchPSymMapping, &ew);
+    mb.Report(out, "EventWindow::InitForEvent", BenchInitForEvent, &ew);
+
+    static TestElementTable et;  // Sizable; keep it off the stack
+    et.Reinit();
+    Element<TestEventConfig> * elts[] = {
+      &Element_Empty<TestEventConfig>::THE_INSTANCE,
+      &Element_Res<TestEventConfig>::THE_INSTANCE,
+      &Element_Wall<TestEventConfig>::THE_INSTANCE,
+      &Element_Dreg<TestEventConfig>::THE_INSTANCE
+    };
+    ElementTableBenchArg eta;
+    eta.m_table = &et;
+    Element_Empty<TestEventConfig>::THE_INSTANCE.AllocateEmptyType();
+    for (u32 i = 0; i < 4; ++i)
+    {
+      if (i > 0)
+      {
+        elts[i]->AllocateType();
+      }
+      et.RegisterElement(*elts[i]);
+      eta.m_types[i] = elts[i]->GetType();
+    }
+    et.Freeze();
+    mb.Report(out, "ElementTable::Lookup", BenchElementTableLookup, &eta);
+
+    TestUlamContext tuc(et);
+    AtomBitStorage<TestEventConfig> abs(Element_Dreg<TestEventConfig>::THE_INSTANCE.GetDefaultAtom());
+    TestUlamRef ur(29, 20, abs, 0, TestUlamRef::PRIMITIVE, tuc);
+    mb.Report(out, "UlamRef::Read", BenchUlamRefRead, &ur);
+    mb.Report(out, "UlamRef::Write", BenchUlamRefWrite, &ur);
+
+    CastOpsBenchArg coa;
+    coa.m_intWidth = 7;
+    coa.m_unsignedWidth = 6;
+    coa.m_narrowWidth = 4;
+    mb.Report(out, "CastOps runtime width", BenchCastOpsRuntimeWidth, &coa);
+    mb.Report(out, "CastOps template width", BenchCastOpsTemplateWidth, 0);
+
+    TestAtom atom(Element_Dreg<TestEventConfig>::THE_INSTANCE.GetDefaultAtom());
+    mb.Report(out, "PacketIO::SendAtom encode", BenchPacketEncode, &atom);
+
+    PacketBuffer buf;
+    buf.Printf("%c%c", PacketType::UPDATE, 7);
+    atom.GetBits().PrintBytes(buf);
+    mb.Report(out, "PacketIO::ReceiveAtom decode", BenchPacketDecode, &buf);
+
+    // Runtime tile sizes must not cost the event path: compare a
+    // DynamicTile against the SizedTile of the same size
+    static TestTile sizedTile;
+    SeedTileBench(sizedTile);
+    mb.Report(out, "Tile event (SizedTile 40x40)", BenchTileEvents, &sizedTile);
+
+    DynamicTile<TestEventConfig> dynamicTile(TestTile::TILE_WIDTH, TestTile::TILE_HEIGHT);
+    SeedTileBench(dynamicTile);
+    mb.Report(out, "Tile event (DynamicTile 40x40)", BenchTileEvents, &dynamicTile);
+
+    // The same Dregs and Res as the sweep kernel runs them, against
+    // the SizedTile's ordinary events
+    static TestTile sweptTile;
+    SeedTileBench(sweptTile);
+    static TileSweepBenchArg tsa;  // Sizable too
+    tsa.m_tile = &sweptTile;
+    tsa.m_phase = 0;
+    tsa.m_sweeper.Prepare(sweptTile);
+    mb.Report(out, "Tile sweep (Dreg/Res 40x40)", BenchTileSweep, &tsa);
+
+    if (tileWidth > 0 && tileHeight > 0)
+    {
+      DynamicTile<TestEventConfig> userTile(tileWidth, tileHeight);
+      SeedTileBench(userTile);
+      OString64 name;
+      name.Printf("Tile event (DynamicTile %dx%d)", tileWidth, tileHeight);
+      mb.Report(out, name.GetZString(), BenchTileEvents, &userTile);
+    }
+
+    out.Printf("bench-checksum,%08x\n", mb.GetChecksum());
+  }
+
+} /* namespace MFM */
@@ -0,0 +1,159 @@
+#include "assert.h"
+#include "DatumStreamer_Test.h"
+#include "itype.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+namespace MFM {
+
+  void DatumStreamer_Test::Test_RunTests() {
+    Test_queuesClaims();
+    Test_queuesBatches();
+    Test_streamerFileToFile();
+  }
+
+  void DatumStreamer_Test::Test_queuesClaims()
+  {
+    DatumQueues dq;
+    assert(!dq.IsFed());
+    dq.SetFed(true);
+    assert(dq.IsFed());
+
+    u32 datum = 99;
+    assert(!dq.TakeInput(datum));
+    assert(datum == 99);
+    assert(dq.GetInputTaken() == 0);
+
+    const u32 in[3] = { 7, 0, 123456 };
+    assert(dq.FeedInput(in, 3) == 3);
+    for (u32 i = 0; i < 3; ++i)
+    {
+      assert(dq.TakeInput(datum));
+      assert(datum == in[i]);
+    }
+    assert(!dq.TakeInput(datum));
+    assert(dq.GetInputTaken() == 3);
+
+    dq.RejectInput();
+    assert(dq.GetInputRejected() == 1);
+
+    assert(dq.PutOutput(42));
+    assert(dq.PutOutput(43));
+    u32 out[4];
+    assert(dq.DrainOutput(out, 4) == 2);
+    assert(out[0] == 42 && out[1] == 43);
+    assert(dq.DrainOutput(out, 4) == 0);
+    assert(dq.GetOutputPut() == 2);
+    assert(dq.GetOutputDropped() == 0);
+  }
+
+  void DatumStreamer_Test::Test_queuesBatches()
+  {
+    DatumQueues dq;
+    enum { CAP = DatumQueues::QUEUE_BYTES / sizeof(u32) };
+    u32 in[CAP + 10];
+    for (u32 i = 0; i < CAP + 10; ++i) in[i] = i * 3;
+
+    // Feeding takes what fits and no more
+    assert(dq.FeedInput(in, CAP + 10) == CAP);
+    assert(dq.FeedInput(in, 1) == 0);
+    u32 datum;
+    assert(dq.TakeInput(datum) && datum == 0);
+    assert(dq.FeedInput(&in[CAP], 10) == 1);
+
+    // A full output queue drops, and counts it
+    for (u32 i = 0; i < CAP; ++i) assert(dq.PutOutput(i));
+    assert(!dq.PutOutput(CAP));
+    assert(dq.GetOutputPut() == CAP);
+    assert(dq.GetOutputDropped() == 1);
+
+    u32 out[CAP];
+    assert(dq.DrainOutput(out, 100) == 100);
+    assert(dq.DrainOutput(&out[100], CAP) == CAP - 100);
+    for (u32 i = 0; i < CAP; ++i) assert(out[i] == i);
+  }
+
+  static void TempPath(char * path, u32 size, const char * name)
+  {
+    snprintf(path, size, "/tmp/mfm-datums-%d-%s", (s32) getpid(), name);
+  }
+
+  void DatumStreamer_Test::Test_streamerFileToFile()
+  {
+    enum { DATUMS = 5000 };
+    char inPath[100], outPath[100];
+    TempPath(inPath, sizeof(inPath), "in");
+    TempPath(outPath, sizeof(outPath), "out");
+
+    // Odd spacing, and no newline after the last datum
+    FILE * fp = fopen(inPath, "w");
+    assert(fp);
+    u64 sumIn = 0;
+    for (u32 i = 0; i < DATUMS; ++i)
+    {
+      const u32 datum = i * 7919 % 100003;
+      sumIn += datum;
+      fprintf(fp, i % 3 ? " %u" : "\n%u ", datum);
+    }
+    fclose(fp);
+
+    DatumStreamer ds;
+    DatumQueues & a = ds.AddQueues();
+    DatumQueues & b = ds.AddQueues();
+    ds.Start(inPath, outPath);
+    assert(ds.IsRunning());
+    assert(a.IsFed() && b.IsFed());
+
+    // Play both tiles: pass every datum taken straight through
+    u32 passed = 0;
+    for (u32 spins = 0; spins < 100000 && passed < DATUMS; ++spins)
+    {
+      u32 datum;
+      bool any = false;
+      while (a.TakeInput(datum))
+      {
+        assert(a.PutOutput(datum) || a.GetOutputDropped() == 0);
+        ++passed;
+        any = true;
+      }
+      while (b.TakeInput(datum))
+      {
+        assert(b.PutOutput(datum) || b.GetOutputDropped() == 0);
+        ++passed;
+        any = true;
+      }
+      if (!any) usleep(1000);
+    }
+    assert(passed == DATUMS);
+    for (u32 spins = 0; spins < 1000 && !ds.IsInputDone(); ++spins) usleep(1000);
+    assert(ds.IsInputDone());
+
+    ds.Stop();
+    assert(!ds.IsRunning());
+    assert(!a.IsFed() && !b.IsFed());
+    assert(ds.GetDatumsRead() == DATUMS);
+    assert(ds.GetDatumsWritten() == DATUMS);
+    assert(a.GetInputTaken() + b.GetInputTaken() == DATUMS);
+    assert(a.GetInputTaken() > 0 && b.GetInputTaken() > 0);
+
+    // Round robin scrambles the order, but not the datums
+    fp = fopen(outPath, "r");
+    assert(fp);
+    u64 sumOut = 0;
+    u32 count = 0;
+    unsigned int datum;
+    while (fscanf(fp, "%u", &datum) == 1)
+    {
+      sumOut += datum;
+      ++count;
+    }
+    fclose(fp);
+    assert(count == DATUMS);
+    assert(sumOut == sumIn);
+
+    unlink(inPath);
+    unlink(outPath);
+  }
+}
@@ -0,0 +1,93 @@
+#include "assert.h"
+#include "ElementColorCache_Test.h"
+#include "Test_Common.h"
+#include "Element_AntiForkBomb.h"
+#include "Element_Res.h"
+
+namespace MFM {
+
+  typedef Element_AntiForkBomb<TestEventConfig> TestAFB;
+  typedef Element_Res<TestEventConfig> TestRes;
+
+  static TestTile & GetColorTestTile()
+  {
+    static TestTile tile;
+    static bool initted = false;
+    if (!initted)
+    {
+      ElementTypeNumberMap<TestEventConfig> etnm;
+      TestAFB::THE_INSTANCE.AllocateType(etnm);
+      TestRes::THE_INSTANCE.AllocateType(etnm);
+      tile.RegisterElement(TestAFB::THE_INSTANCE);
+      tile.RegisterElement(TestRes::THE_INSTANCE);
+      initted = true;
+    }
+    return tile;
+  }
+
+  static TestAtom MakeInflamed(u32 level)
+  {
+    TestAtom atom(TestAFB::THE_INSTANCE.GetDefaultAtom());
+    TestAFB::AFInflammationLevel::Write(TestAFB::GetBits(atom), level);
+    return atom;
+  }
+
+  void ElementColorCache_Test::Test_RunTests()
+  {
+    Test_colorCacheHits();
+    Test_colorCacheUndeclared();
+    Test_colorCacheClear();
+  }
+
+  void ElementColorCache_Test::Test_colorCacheHits()
+  {
+    TestTile & tile = GetColorTestTile();
+    const TestAFB & afb = TestAFB::THE_INSTANCE;
+    ElementColorCache<TestEventConfig> cache;
+
+    for (u32 pass = 0; pass < 3; ++pass)
+    {
+      for (u32 level = 0; level < 4; ++level)
+      {
+        const TestAtom atom = MakeInflamed(level);
+        const u32 expected = afb.GetDynamicColor(tile.GetElementTable(), tile.GetUlamClassRegistry(), atom, 1);
+        assert(cache.GetColor(tile.GetElementTable(), tile.GetUlamClassRegistry(), afb, atom, 1) == expected);
+      }
+    }
+    assert(cache.GetMisses() == 4);  // Once per inflammation level
+    assert(cache.GetHits() == 8);
+  }
+
+  void ElementColorCache_Test::Test_colorCacheUndeclared()
+  {
+    TestTile & tile = GetColorTestTile();
+    const TestRes & res = TestRes::THE_INSTANCE;
+    ElementColorCache<TestEventConfig> cache;
+
+    const TestAtom atom(res.GetDefaultAtom());
+    for (u32 i = 0; i < 5; ++i)
+      assert(cache.GetColor(tile.GetElementTable(), tile.GetUlamClassRegistry(), res, atom, 1) ==
+             res.GetDynamicColor(tile.GetElementTable(), tile.GetUlamClassRegistry(), atom, 1));
+    assert(cache.GetHits() == 0);    // Res makes no promises
+    assert(cache.GetMisses() == 0);
+  }
+
+  void ElementColorCache_Test::Test_colorCacheClear()
+  {
+    TestTile & tile = GetColorTestTile();
+    TestAFB & afb = TestAFB::THE_INSTANCE;
+    ElementColorCache<TestEventConfig> cache;
+
+    const TestAtom atom = MakeInflamed(2);
+    const u32 normal = cache.GetColor(tile.GetElementTable(), tile.GetUlamClassRegistry(), afb, atom, 1);
+    afb.ToggleLowlightPhysicsColor();
+    assert(cache.GetColor(tile.GetElementTable(), tile.GetUlamClassRegistry(), afb, atom, 1) == normal);
+
+    cache.Clear();
+    const u32 lowlit = cache.GetColor(tile.GetElementTable(), tile.GetUlamClassRegistry(), afb, atom, 1);
+    assert(lowlit != normal);
+    assert(lowlit == afb.GetDynamicColor(tile.GetElementTable(), tile.GetUlamClassRegistry(), atom, 1));
+    afb.ToggleLowlightPhysicsColor();
+  }
+
+} /* namespace MFM */
@@ -0,0 +1,93 @@
+#include "assert.h"
+#include "ElementProfile_Test.h"
+
+namespace MFM {
+
+  void ElementProfile_Test::Test_RunTests()
+  {
+    Test_profileRecord();
+    Test_profileAdd();
+    Test_profileTopByTicks();
+    Test_profileOverflow();
+  }
+
+  void ElementProfile_Test::Test_profileRecord()
+  {
+    ElementProfile prof;
+    assert(prof.GetEntryCount() == 0);
+    assert(prof.Find(0xce0f) == 0);
+
+    prof.Record(0xce0f, 100, 2);
+    prof.Record(0xce0f, 300, 0);
+    prof.Record(0x0001, 50, 1);
+
+    assert(prof.GetEntryCount() == 2);
+    const ElementProfile::Entry * e = prof.Find(0xce0f);
+    assert(e != 0);
+    assert(e->m_type == 0xce0f);
+    assert(e->m_calls == 2);
+    assert(e->m_totalTicks == 400);
+    assert(e->m_maxTicks == 300);
+    assert(e->m_sitesWritten == 2);
+    assert(e->GetMeanTicks() == 200);
+    assert(prof.GetTotalTicks() == 450);
+
+    prof.Reset();
+    assert(prof.GetEntryCount() == 0);
+    assert(prof.Find(0xce0f) == 0);
+  }
+
+  void ElementProfile_Test::Test_profileAdd()
+  {
+    ElementProfile a, b;
+    a.Record(7, 10, 1);
+    b.Record(7, 30, 2);
+    b.Record(9, 5, 0);
+
+    a.Add(b);
+    assert(a.GetEntryCount() == 2);
+    const ElementProfile::Entry * e = a.Find(7);
+    assert(e && e->m_calls == 2 && e->m_totalTicks == 40);
+    assert(e->m_maxTicks == 30 && e->m_sitesWritten == 3);
+    e = a.Find(9);
+    assert(e && e->m_calls == 1 && e->m_maxTicks == 5);
+  }
+
+  void ElementProfile_Test::Test_profileTopByTicks()
+  {
+    ElementProfile prof;
+    const u32 ticks[] = { 30, 10, 50, 20, 40 };
+    for (u32 i = 0; i < sizeof(ticks)/sizeof(ticks[0]); ++i)
+    {
+      prof.Record(0x100 + i, ticks[i], 0);
+    }
+
+    const ElementProfile::Entry * (top[3]);
+    assert(prof.GetTopByTicks(top, 3) == 3);
+    assert(top[0]->m_type == 0x102);
+    assert(top[1]->m_type == 0x104);
+    assert(top[2]->m_type == 0x100);
+
+    const ElementProfile::Entry * (all[ElementProfile::SLOT_COUNT]);
+    assert(prof.GetTopByTicks(all, ElementProfile::SLOT_COUNT) == 5);
+    for (u32 i = 1; i < 5; ++i)
+    {
+      assert(all[i-1]->m_totalTicks >= all[i]->m_totalTicks);
+    }
+  }
+
+  void ElementProfile_Test::Test_profileOverflow()
+  {
+    ElementProfile prof;
+    for (u32 t = 0; t < ElementProfile::SLOT_COUNT + 3; ++t)
+    {
+      prof.Record(t * 977, 1, 0);
+    }
+    assert(prof.GetEntryCount() == ElementProfile::SLOT_COUNT);
+    assert(prof.GetUnrecorded() == 3);
+
+    // Known types still count once the table is full
+    prof.Record(0, 1, 0);
+    assert(prof.Find(0)->m_calls == 2);
+  }
+} /* namespace MFM */
@@ -0,0 +1,196 @@
+#include "assert.h"
+#include "ElementTable_Test.h"
+#include "Element_Empty.h"
+#include "Element_Res.h"
+#include "Element_Wall.h"
+#include "Element_Dreg.h"
+#include "Element_Fish.h"
+
+namespace MFM {
+
+  void ElementTable_Test::Test_RunTests()
+  {
+    Test_elementTableFreeze();
+    Test_elementTableData();
+    Test_elementTableReplace();
+    Test_elementParameterCache();
+  }
+
+  void ElementTable_Test::Test_elementTableFreeze()
+  {
+    static TestElementTable et;  // Sizable; keep it off the stack
+    et.Reinit();
+
+    const Element<TestEventConfig> * elts[] = {
+      &Element_Empty<TestEventConfig>::THE_INSTANCE,
+      &Element_Res<TestEventConfig>::THE_INSTANCE,
+      &Element_Wall<TestEventConfig>::THE_INSTANCE
+    };
+    const u32 COUNT = sizeof(elts)/sizeof(elts[0]);
+
+    Element_Empty<TestEventConfig>::THE_INSTANCE.AllocateEmptyType();
+    Element_Res<TestEventConfig>::THE_INSTANCE.AllocateType();
+    Element_Wall<TestEventConfig>::THE_INSTANCE.AllocateType();
+    Element_Dreg<TestEventConfig>::THE_INSTANCE.AllocateType();
+    for (u32 i = 0; i < COUNT; ++i)
+    {
+      et.RegisterElement(*elts[i]);
+    }
+
+    // Unrelated types miss either way
+    const u32 MISSING = Element_Dreg<TestEventConfig>::THE_INSTANCE.GetType();
+    assert(et.Lookup(MISSING) == 0);
+
+    assert(!et.IsFrozen());
+    assert(et.Freeze());
+    assert(et.IsFrozen());
+
+    for (u32 i = 0; i < COUNT; ++i)
+    {
+      assert(et.Lookup(elts[i]->GetType()) == elts[i]);
+    }
+    assert(et.Lookup(MISSING) == 0);
+    for (u32 t = 1; t < 2000; t += 7)
+    {
+      const Element<TestEventConfig> * elt = et.Lookup(t);
+      assert(elt == 0 || elt->GetType() == t);
+    }
+
+    // Late registration refreezes
+    et.RegisterElement(Element_Dreg<TestEventConfig>::THE_INSTANCE);
+    assert(et.IsFrozen());
+    assert(et.Lookup(MISSING) == &Element_Dreg<TestEventConfig>::THE_INSTANCE);
+
+    et.Reinit();
+    assert(!et.IsFrozen());
+    assert(et.Lookup(MISSING) == 0);
+  }
+
+  // Template arguments can't be local types in C++98
+  struct WallData { u64 m_count; u64 m_sum; u64 m_max; };
+
+  void ElementTable_Test::Test_elementTableData()
+  {
+    static TestElementTable et;
+    et.Reinit();
+
+    Element_Res<TestEventConfig>::THE_INSTANCE.AllocateType();
+    Element_Wall<TestEventConfig>::THE_INSTANCE.AllocateType();
+    Element_Dreg<TestEventConfig>::THE_INSTANCE.AllocateType();
+    const u32 RES = Element_Res<TestEventConfig>::THE_INSTANCE.GetType();
+    const u32 WALL = Element_Wall<TestEventConfig>::THE_INSTANCE.GetType();
+    const u32 DREG = Element_Dreg<TestEventConfig>::THE_INSTANCE.GetType();
+    et.RegisterElement(Element_Res<TestEventConfig>::THE_INSTANCE);
+    et.RegisterElement(Element_Wall<TestEventConfig>::THE_INSTANCE);
+
+    // Unregistered types have no data
+    assert(!et.AllocateElementDataSlotsFromType(DREG, 1));
+    assert(et.GetDataIfRegistered(DREG, 1) == 0);
+
+    // Too many slots, or a different count later, is refused
+    assert(!et.AllocateElementDataSlotsFromType(RES, TestElementTable::ELEMENT_DATA_SLOTS + 1));
+    u64 * res = et.GetDataAndRegister(RES, 2);
+    assert(res && res[0] == 0 && res[1] == 0);
+    assert(!et.AllocateElementDataSlotsFromType(RES, 3));
+    assert(et.GetDataIfRegistered(RES, 3) == 0);
+    res[1] = 42;
+
+    WallData & wd = et.GetElementData<WallData>(WALL);
+    assert(wd.m_count == 0 && wd.m_sum == 0 && wd.m_max == 0);
+    wd.m_sum = 7;
+    assert(et.GetDataIfRegistered(WALL, 3) == (u64 *) &wd);
+
+    // Freezing, and refreezing, leave the data where it was
+    assert(et.Freeze());
+    assert(et.GetDataIfRegistered(RES, 2) == res);
+    assert(&et.GetElementDataSlot(RES, 1) == &res[1]);
+    assert(et.GetElementDataSlot(RES, 1) == 42);
+    assert(et.GetElementDataSlot(WALL, 1) == 7);
+    et.RegisterElement(Element_Dreg<TestEventConfig>::THE_INSTANCE);
+    assert(et.IsFrozen());
+    assert(et.GetDataIfRegistered(RES, 2) == res);
+    assert(&et.GetElementData<WallData>(WALL) == &wd);
+    assert(et.GetDataIfRegistered(DREG, 1) == 0);
+
+    et.Reinit();
+    et.RegisterElement(Element_Res<TestEventConfig>::THE_INSTANCE);
+    assert(et.GetDataIfRegistered(RES, 2) == 0);
+  }
+
+  void ElementTable_Test::Test_elementTableReplace()
+  {
+    static TestElementTable et;
+    static Element_Res<TestEventConfig> newRes;  // As from a reloaded library
+    et.Reinit();
+
+    Element_Res<TestEventConfig> & oldRes = Element_Res<TestEventConfig>::THE_INSTANCE;
+    Element_Wall<TestEventConfig> & wall = Element_Wall<TestEventConfig>::THE_INSTANCE;
+    Element_Dreg<TestEventConfig> & dreg = Element_Dreg<TestEventConfig>::THE_INSTANCE;
+    oldRes.AllocateType();
+    newRes.AllocateType();
+    wall.AllocateType();
+    dreg.AllocateType();
+    const u32 RES = oldRes.GetType();
+    const u32 WALL = wall.GetType();
+    et.RegisterElement(oldRes);
+    et.RegisterElement(wall);
+    et.GetDataAndRegister(RES, 2)[1] = 42;
+    assert(et.Freeze());
+
+    // The replacement takes over the old one's type and data
+    const Element<TestEventConfig> * olds[] = { &oldRes, &dreg };
+    const Element<TestEventConfig> * news[] = { &newRes, &dreg };
+    et.ReplaceElements(olds, news, 2);
+    assert(et.IsFrozen());
+    assert(et.Lookup(RES) == &newRes);
+    assert(et.Lookup(WALL) == &wall);
+    assert(et.Lookup(dreg.GetType()) == 0);   // Unregistered olds are ignored
+    assert(et.GetElementDataSlot(RES, 1) == 42);
+
+    // Two elements of one type are refused, leaving the table as it was
+    const Element<TestEventConfig> * clash[] = { &wall };
+    const Element<TestEventConfig> * withRes[] = { &oldRes };
+    bool failed = false;
+    unwind_protect({
+        failed = MFMThrownFailCode == MFM_FAIL_CODE_NUMBER(DUPLICATE_ENTRY);
+      },{
+        et.ReplaceElements(clash, withRes, 1);
+      });
+    assert(failed);
+    assert(et.IsFrozen());
+    assert(et.Lookup(RES) == &newRes);
+    assert(et.Lookup(WALL) == &wall);
+    assert(et.GetElementDataSlot(RES, 1) == 42);
+  }
+
+  void ElementTable_Test::Test_elementParameterCache()
+  {
+    ElementParameterS32<TestEventConfig> & age =
+      Element_Fish<TestEventConfig>::THE_INSTANCE.m_fishBirthAge;
+    const s32 original = age.GetValue();
+
+    // A zeroed cache is stale, and is refreshed on first read
+    ParameterCache<s32> cache;
+    cache.m_generation = 0;
+    cache.m_value = 0;
+    assert(age.GetValue(cache) == original);
+    assert(cache.m_generation == age.GetGeneration());
+
+    // Later reads need no refresh until the value changes
+    cache.m_value = -1;
+    assert(age.GetValue(cache) == -1);
+
+    age.SetValue(original + 1);
+    assert(cache.m_generation != age.GetGeneration());
+    assert(age.GetValue(cache) == original + 1);
+
+    // Changes through the atom-based setters count too
+    age.SetValueIntoType(age.GetAtom(), (u32) original);
+    assert(age.GetValue(cache) == original);
+
+    age.Reset();
+    assert(age.GetValue(cache) == age.GetDefault());
+    age.SetValue(original);
+  }
+
+} /* namespace MFM */
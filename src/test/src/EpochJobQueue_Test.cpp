@@ -0,0 +1,83 @@
+#include "assert.h"
+#include "EpochJobQueue_Test.h"
+#include "itype.h"
+#include <stdio.h>          // For fopen, fread, snprintf
+#include <string.h>         // For strcmp
+#include <unistd.h>         // For unlink, getpid
+
+namespace MFM {
+
+  void EpochJobQueue_Test::Test_RunTests() {
+    Test_Replace();
+    Test_AppendHeaderOnce();
+    Test_Failure();
+  }
+
+  static void TempPath(char * path, u32 size, const char * name) {
+    snprintf(path, size, "/tmp/mfm-epochjobs-%d-%s", (s32) getpid(), name);
+    unlink(path);
+  }
+
+  static u32 ReadBack(const char * path, char * buf, u32 size) {
+    FILE * fp = fopen(path, "r");
+    assert(fp);
+    u32 got = fread(buf, 1, size - 1, fp);
+    buf[got] = '\0';
+    fclose(fp);
+    return got;
+  }
+
+  void EpochJobQueue_Test::Test_Replace() {
+    char path[128];
+    TempPath(path, sizeof(path), "replace");
+    char buf[64];
+
+    EpochJobQueue q;
+    q.BeginFile(path, false);
+    q.GetSink().Printf("first %d\n", 1);
+    q.EndFile();
+    q.Finish();
+    assert(q.GetPendingCount() == 0);
+    assert(ReadBack(path, buf, sizeof(buf)) == 8);
+    assert(!strcmp(buf, "first 1\n"));
+
+    q.BeginFile(path, false);
+    q.GetSink().Printf("second\n");
+    q.EndFile();
+    q.Finish();
+    assert(!strcmp((ReadBack(path, buf, sizeof(buf)), buf), "second\n"));
+    assert(q.GetWrittenCount() == 2);
+    unlink(path);
+  }
+
+  void EpochJobQueue_Test::Test_AppendHeaderOnce() {
+    char path[128];
+    TempPath(path, sizeof(path), "append");
+    char buf[512];
+
+    {
+      EpochJobQueue q;
+      for (u32 i = 0; i < 3 * EpochJobQueue::MAX_PENDING_FILES; ++i) {
+        q.BeginFile(path, true);
+        q.GetHeaderSink().Printf("# n\n");
+        q.GetSink().Printf("%d\n", i % 10);
+        q.EndFile();
+      }
+      // Destruction writes whatever's still queued
+    }
+    const u32 lines = 3 * EpochJobQueue::MAX_PENDING_FILES;
+    assert(ReadBack(path, buf, sizeof(buf)) == 4 + 2 * lines);
+    assert(!strncmp(buf, "# n\n0\n1\n2\n", 10));
+    unlink(path);
+  }
+
+  void EpochJobQueue_Test::Test_Failure() {
+    EpochJobQueue q;
+    q.BeginFile("/nonexistent-mfm-dir/x.dat", false);
+    q.GetSink().Printf("lost\n");
+    q.EndFile();
+    q.Finish();
+    assert(q.GetFailedCount() == 1);
+    assert(q.GetWrittenCount() == 0);
+  }
+} /* namespace MFM */
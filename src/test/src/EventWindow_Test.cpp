@@ -5,6 +5,8 @@
 #include "assert.h"
 #include "EventWindow_Test.h"
 #include "EventWindow.h"
+#include "WindowScanner.h"
+#include "EventHistoryBuffer.h"
 #include "Point.h"
 
 namespace MFM {
@@ -14,6 +16,13 @@ namespace MFM {
     Test_EventWindowConstruction();
     Test_EventWindowNoLockOpen();
     Test_EventWindowWrite();
+    Test_EventWindowLoadGather();
+    Test_EventWindowHistory();
+    Test_EventWindowHistoryKeyframes();
+    Test_EventWindowInertCenter();
+    Test_EventWindowTypeSites();
+    Test_EventWindowWrittenSites();
+    Test_EventWindowDiffuse();
   }
 
   void EventWindow_Test::Test_EventWindowConstruction()
@@ -39,7 +48,7 @@ namespace MFM {
 
     ew.SetEventWindowsExecuted(1000000); // make event 0 look very old to avoid recency reject
 
-    bool success = ew.TryEventAt(center);
+    bool success = ew.InitForEvent(center);
     assert(success);
 
     TestAtom catom = ew.GetCenterAtomDirect();
@@ -90,7 +99,7 @@ namespace MFM {
     TestEventWindow & ew = tile.GetEventWindow();
     ew.SetEventWindowsExecuted(1000000); // make event 0 look very old to avoid recency reject
 
-    bool res = ew.TryEventAt(center);
+    bool res = ew.InitForEvent(center);
     assert(res);
 
     ew.SetBoundary(4);
@@ -101,10 +110,456 @@ namespace MFM {
     assert(erased2->GetType() == EMPTY_TYPE);
 
     ew.StoreToTile();
+    ew.SetFree();
 
     assert(erased1->GetType() == DREG_TYPE);
     assert(erased2->GetType() == RES_TYPE);
 
   }
 
+
+  void EventWindow_Test::Test_EventWindowLoadGather()
+  {
+    TestTile tile;
+    ElementTypeNumberMap<TestEventConfig> etnm;
+    Element_Wall<TestEventConfig>::THE_INSTANCE.AllocateTypeForTesting(etnm);
+    tile.RegisterElement(Element_Wall<TestEventConfig>::THE_INSTANCE);
+    const u32 WALL_TYPE = Element_Wall<TestEventConfig>::THE_INSTANCE.GetType();
+    const MDist<4> & md = MDist<4>::get();
+
+    // One center whose window is all owned, one whose window reaches
+    // into the (unconnected, so dead) cache
+    const SPoint centers[] = { SPoint(15, 20), SPoint(4, 5) };
+    for (u32 c = 0; c < sizeof(centers)/sizeof(centers[0]); ++c)
+    {
+      const SPoint center = centers[c];
+      tile.ClearAtoms();
+      for (u32 i = 0; i < TestEventWindow::SITE_COUNT; i += 3)
+      {
+        const SPoint pt = center + md.GetPoint(i);
+        if (tile.IsOwnedSite(pt))
+        {
+          *(tile.GetWritableAtom(pt)) = TestAtom(WALL_TYPE,0,0,0);
+        }
+      }
+
+      TestEventWindow & ew = tile.GetEventWindow();
+      ew.SetEventWindowsExecuted(1000000); // make event 0 look very old to avoid recency reject
+      bool success = ew.InitForEvent(center);
+      assert(success);
+
+      assert(ew.GetBoundedSiteCount() > 1);
+      for (u32 i = 0; i < ew.GetBoundedSiteCount(); ++i)
+      {
+        const SPoint pt = center + md.GetPoint(i);
+        assert(ew.GetAtomDirect(i).GetType() == tile.GetAtom(pt)->GetType());
+        assert(ew.IsLiveSiteDirect(i) == tile.IsLiveSite(pt));
+      }
+      ew.SetFree();
+    }
+  }
+
+  void EventWindow_Test::Test_EventWindowHistory()
+  {
+    TestTile tile;
+    ElementTypeNumberMap<TestEventConfig> etnm;
+    Element_Dreg<TestEventConfig>::THE_INSTANCE.AllocateTypeForTesting(etnm);
+    Element_Wall<TestEventConfig>::THE_INSTANCE.AllocateTypeForTesting(etnm);
+    tile.RegisterElement(Element_Dreg<TestEventConfig>::THE_INSTANCE);
+    tile.RegisterElement(Element_Wall<TestEventConfig>::THE_INSTANCE);
+
+    SPoint center(10, 12);
+    SPoint east(1, 0);
+    const u32 WALL_TYPE = Element_Wall<TestEventConfig>::THE_INSTANCE.GetType();
+    const u32 DREG_TYPE = Element_Dreg<TestEventConfig>::THE_INSTANCE.GetType();
+    const u32 EMPTY_TYPE = Element_Empty<TestEventConfig>::THE_INSTANCE.GetType();
+
+    *(tile.GetWritableAtom(center)) = TestAtom(WALL_TYPE,0,0,0);
+    const TestAtom * atCenter = tile.GetAtom(center);
+    const TestAtom * atEast = tile.GetAtom(center + east);
+
+    TestEventWindow & ew = tile.GetEventWindow();
+    ew.SetEventWindowsExecuted(1000000); // make event 0 look very old to avoid recency reject
+
+    EventHistoryBuffer<TestEventConfig> & ehb = tile.GetEventHistoryBuffer();
+    const u32 eventsBefore = ehb.CountEventsInHistory();
+    assert(!ehb.HasHistoryStorage());  // Not until something is recorded
+
+    // An event that changes nothing leaves no record
+    assert(ew.InitForEvent(center));
+    ew.SetBoundary(4);
+    ew.StoreToTile();
+    ew.SetFree();
+    assert(ehb.CountEventsInHistory() == eventsBefore);
+
+    ew.SetEventWindowsExecuted(2000000); // and again for the next events
+    assert(ew.InitForEvent(center));
+    ew.SetBoundary(4);
+    ew.SetRelativeAtomDirect(SPoint(0, 0), TestAtom(DREG_TYPE,0,0,0));
+    ew.SetRelativeAtomDirect(east, TestAtom(WALL_TYPE,0,0,0));
+    ew.StoreToTile();
+    ew.SetFree();
+    assert(ehb.CountEventsInHistory() == eventsBefore + 1);
+
+    // Rewinding and replaying walk the recorded deltas
+    assert(ehb.MoveCursorOlder());
+    assert(atCenter->GetType() == WALL_TYPE);
+    assert(atEast->GetType() == EMPTY_TYPE);
+
+    assert(ehb.MoveCursorNewer());
+    assert(atCenter->GetType() == DREG_TYPE);
+    assert(atEast->GetType() == WALL_TYPE);
+
+    // With history off, StoreToTile records nothing
+    ehb.SetHistoryActive(false);
+    ew.SetEventWindowsExecuted(3000000);
+    assert(ew.InitForEvent(center));
+    ew.SetBoundary(4);
+    ew.SetRelativeAtomDirect(east, TestAtom(DREG_TYPE,0,0,0));
+    ew.StoreToTile();
+    ew.SetFree();
+    assert(atEast->GetType() == DREG_TYPE);
+    ehb.SetHistoryActive(true);
+    assert(ehb.CountEventsInHistory() == eventsBefore + 1);
+    assert(ehb.HasHistoryStorage());
+
+    // Releasing frees the storage and forgets the events
+    ehb.ReleaseHistory();
+    assert(!ehb.IsHistoryActive() && !ehb.HasHistoryStorage());
+    assert(!ehb.MoveCursorOlder());
+    ew.SetEventWindowsExecuted(4000000);
+    assert(ew.InitForEvent(center));
+    ew.SetBoundary(4);
+    ew.SetRelativeAtomDirect(east, TestAtom(WALL_TYPE,0,0,0));
+    ew.StoreToTile();
+    ew.SetFree();
+    assert(!ehb.HasHistoryStorage());
+
+    // Reactivating starts over, allocating at the next change
+    ehb.SetHistoryActive(true);
+    assert(ehb.CountEventsInHistory() == 0);
+    ew.SetEventWindowsExecuted(5000000);
+    assert(ew.InitForEvent(center));
+    ew.SetBoundary(4);
+    ew.SetRelativeAtomDirect(east, TestAtom(DREG_TYPE,0,0,0));
+    ew.StoreToTile();
+    ew.SetFree();
+    assert(ehb.HasHistoryStorage());
+    assert(ehb.CountEventsInHistory() == 1);
+  }
+
+  static u32 TileChecksum(const TestTile & tile)
+  {
+    u32 sum = 0;
+    for (s32 x = 0; x < 40; ++x)
+    {
+      for (s32 y = 0; y < 40; ++y)
+      {
+        const TestAtom * atom = tile.GetAtom(SPoint(x, y));
+        for (u32 w = 0; w < 3; ++w)
+        {
+          sum = sum * 31 + atom->GetBits().Read(w * 32, 32);
+        }
+      }
+    }
+    return sum;
+  }
+
+  void EventWindow_Test::Test_EventWindowHistoryKeyframes()
+  {
+    TestTile tile;
+    ElementTypeNumberMap<TestEventConfig> etnm;
+    Element_Dreg<TestEventConfig>::THE_INSTANCE.AllocateTypeForTesting(etnm);
+    Element_Wall<TestEventConfig>::THE_INSTANCE.AllocateTypeForTesting(etnm);
+    tile.RegisterElement(Element_Dreg<TestEventConfig>::THE_INSTANCE);
+    tile.RegisterElement(Element_Wall<TestEventConfig>::THE_INSTANCE);
+
+    const u32 TYPES[3] = {
+      Element_Wall<TestEventConfig>::THE_INSTANCE.GetType(),
+      Element_Dreg<TestEventConfig>::THE_INSTANCE.GetType(),
+      Element_Empty<TestEventConfig>::THE_INSTANCE.GetType()
+    };
+    SPoint center(10, 12);
+    *(tile.GetWritableAtom(center)) = TestAtom(TYPES[0],0,0,0);
+
+    // Enough events to roll the oldest ones, and their keyframes, out
+    // of the history
+    const MDist<4> & md = MDist<4>::get();
+    TestEventWindow & ew = tile.GetEventWindow();
+    EventHistoryBuffer<TestEventConfig> & ehb = tile.GetEventHistoryBuffer();
+    const u32 EVENTS = 400;
+    for (u32 i = 0; i < EVENTS; ++i)
+    {
+      ew.SetEventWindowsExecuted(1000000 * (i + 1));
+      assert(ew.InitForEvent(center));
+      ew.SetBoundary(4);
+      ew.SetRelativeAtomDirect(md.GetPoint(1 + i % 20), TestAtom(TYPES[(i / 20) % 3],0,0,0));
+      ew.StoreToTile();
+      ew.SetFree();
+    }
+    assert(ehb.GetKeyframeCount() > 0);
+
+    // Step back one at a time, noting the tile at each position
+    const u32 MAX_POSITIONS = 2 * EVENTS + 2;
+    u32 sums[MAX_POSITIONS];
+    u32 positions = 0;
+    sums[0] = TileChecksum(tile);
+    while (ehb.MoveCursorOlder())
+    {
+      assert(++positions < MAX_POSITIONS);
+      sums[positions] = TileChecksum(tile);
+    }
+    assert(positions > 4 * (u32) EventHistoryBuffer<TestEventConfig>::KEYFRAME_EVENTS);
+
+    // Long moves, jumping by keyframes, land just where stepping did
+    assert(ehb.MoveCursorToNewest());
+    assert(TileChecksum(tile) == sums[0]);
+    const s32 moves[] = { -200, -7, -150, 90, 1, -(s32) positions / 2, 250, -1, 70, -3 };
+    u32 at = 0;
+    for (u32 i = 0; i < sizeof(moves) / sizeof(moves[0]); ++i)
+    {
+      const s32 next = (s32) at - moves[i];
+      if (next < 0 || next > (s32) positions) continue;
+      assert(ehb.MoveCursor(moves[i]));
+      at = (u32) next;
+      assert(TileChecksum(tile) == sums[at]);
+    }
+
+    // Running out of history stops at the end of it
+    assert(!ehb.MoveCursor(-(s32) (positions + 5)));
+    assert(TileChecksum(tile) == sums[positions]);
+    assert(ehb.MoveCursorToNewest());
+    assert(TileChecksum(tile) == sums[0]);
+    assert(ehb.MoveCursorToOldest());
+    assert(TileChecksum(tile) == sums[positions]);
+  }
+
+  void EventWindow_Test::Test_EventWindowWrittenSites()
+  {
+    TestTile tile;
+    ElementTypeNumberMap<TestEventConfig> etnm;
+    Element_Wall<TestEventConfig>::THE_INSTANCE.AllocateTypeForTesting(etnm);
+    tile.RegisterElement(Element_Wall<TestEventConfig>::THE_INSTANCE);
+
+    SPoint center(10, 12);
+    const u32 WALL_TYPE = Element_Wall<TestEventConfig>::THE_INSTANCE.GetType();
+    const u32 EMPTY_TYPE = Element_Empty<TestEventConfig>::THE_INSTANCE.GetType();
+
+    *(tile.GetWritableAtom(center)) = TestAtom(WALL_TYPE,0,0,0);
+    const TestAtom * atEast = tile.GetAtom(center + SPoint(1, 0));
+    const TestAtom * atWest = tile.GetAtom(center + SPoint(-1, 0));
+
+    TestEventWindow & ew = tile.GetEventWindow();
+    ew.SetEventWindowsExecuted(1000000); // make event 0 look very old to avoid recency reject
+
+    // Nothing written, nothing stored
+    assert(ew.InitForEvent(center));
+    assert(ew.m_writtenSites == 0);
+    ew.StoreToTile();
+    ew.SetFree();
+    assert(ew.m_sitesWritten == 0);
+
+    // Writes that leave a site as it was are marked but not stored
+    ew.SetEventWindowsExecuted(2000000);
+    assert(ew.InitForEvent(center));
+    const TestAtom wall(WALL_TYPE,0,0,0);
+    ew.SetRelativeAtomDirect(SPoint(0, 0), wall);
+    ew.SwapAtomsDirect(SPoint(0, 1), SPoint(0, -1));  // Both empty
+    ew.SetRelativeAtomDirect(SPoint(1, 0), wall);
+    assert(PopCount64(ew.m_writtenSites) == 4);
+    ew.StoreToTile();
+    ew.SetFree();
+    assert(ew.m_sitesWritten == 1);
+    assert(ew.m_writtenSites == 0);
+    assert(atEast->GetType() == WALL_TYPE);
+
+    // Writes through a modifiable bit storage count too
+    ew.SetEventWindowsExecuted(3000000);
+    assert(ew.InitForEvent(center));
+    const u32 westSite = ew.MapToIndexDirectValid(SPoint(-1, 0));
+    ew.GetAtomBitStorage(westSite).WriteAtom(wall);
+    ew.StoreToTile();
+    ew.SetFree();
+    assert(ew.m_sitesWritten == 1);
+    assert(atWest->GetType() == WALL_TYPE);
+    assert(atEast->GetType() == WALL_TYPE);
+    assert(tile.GetAtom(center + SPoint(0, 1))->GetType() == EMPTY_TYPE);
+  }
+
+  void EventWindow_Test::Test_EventWindowInertCenter()
+  {
+    TestTile tile;
+    ElementTypeNumberMap<TestEventConfig> etnm;
+    Element_Wall<TestEventConfig>::THE_INSTANCE.AllocateTypeForTesting(etnm);
+    Element_Res<TestEventConfig>::THE_INSTANCE.AllocateTypeForTesting(etnm);
+    tile.RegisterElement(Element_Wall<TestEventConfig>::THE_INSTANCE);
+    tile.RegisterElement(Element_Res<TestEventConfig>::THE_INSTANCE);
+    assert(Element_Wall<TestEventConfig>::THE_INSTANCE.IsInert());
+    assert(!Element_Res<TestEventConfig>::THE_INSTANCE.IsInert());
+
+    const SPoint center(15, 20);
+    const u32 WALL_TYPE = Element_Wall<TestEventConfig>::THE_INSTANCE.GetType();
+    const u32 RES_TYPE = Element_Res<TestEventConfig>::THE_INSTANCE.GetType();
+    tile.PlaceAtom(TestAtom(WALL_TYPE,0,0,0), center);
+
+    TestEventWindow & ew = tile.GetEventWindow();
+    ew.SetEventWindowsExecuted(1000000); // make event 0 look very old to avoid recency reject
+
+    // An inert center's event counts, but never takes the window
+    const u64 sitesBefore = ew.GetSitesAccessed();
+    assert(ew.TryEventAt(center));
+    assert(ew.IsFree());
+    assert(ew.GetEventWindowsExecuted() == 1000001);
+    assert(ew.GetInertEvents() == 1);
+    assert(ew.GetSitesAccessed() == sitesBefore);
+    assert(tile.GetSite(center).GetEventCount() == 1);
+
+    // Others run as always
+    tile.PlaceAtom(TestAtom(RES_TYPE,0,0,0), center);
+    ew.SetEventWindowsExecuted(2000000);
+    assert(ew.TryEventAt(center));
+    assert(ew.GetEventWindowsExecuted() == 2000001);
+    assert(ew.GetInertEvents() == 1);
+    assert(ew.GetSitesAccessed() > sitesBefore);
+  }
+
+  void EventWindow_Test::Test_EventWindowTypeSites()
+  {
+    TestTile tile;
+    ElementTypeNumberMap<TestEventConfig> etnm;
+    Element_Dreg<TestEventConfig>::THE_INSTANCE.AllocateTypeForTesting(etnm);
+    Element_Res<TestEventConfig>::THE_INSTANCE.AllocateTypeForTesting(etnm);
+    tile.RegisterElement(Element_Dreg<TestEventConfig>::THE_INSTANCE);
+    tile.RegisterElement(Element_Res<TestEventConfig>::THE_INSTANCE);
+
+    const SPoint center(15, 20);
+    const SPoint east(1, 0);
+    const SPoint south2(0, 2);
+    const u32 DREG_TYPE = Element_Dreg<TestEventConfig>::THE_INSTANCE.GetType();
+    const u32 RES_TYPE = Element_Res<TestEventConfig>::THE_INSTANCE.GetType();
+    const u32 EMPTY_TYPE = Element_Empty<TestEventConfig>::THE_INSTANCE.GetType();
+    tile.PlaceAtom(TestAtom(DREG_TYPE,0,0,0), center);
+    tile.PlaceAtom(TestAtom(RES_TYPE,0,0,0), center + east);
+    tile.PlaceAtom(TestAtom(RES_TYPE,0,0,0), center + south2);
+    tile.PlaceAtom(TestAtom(DREG_TYPE,0,0,0), center + SPoint(-3, 0));
+
+    TestEventWindow & ew = tile.GetEventWindow();
+    assert(ew.InitForEvent(center));
+    assert(ew.GetTypeSitesDirect(DREG_TYPE) & 1);  // The center
+
+    WindowScanner<TestEventConfig> scanner(ew);
+    assert(scanner.CountAtomsOfType(RES_TYPE, 1) == 1);
+    assert(scanner.CountAtomsOfType(RES_TYPE, 2) == 2);
+    assert(!scanner.CanSeeAtomOfType(DREG_TYPE, 2));   // Never the center
+    assert(scanner.CanSeeAtomOfType(DREG_TYPE, 3));
+    assert(scanner.CountEmptyAtoms(4) == ew.GetBoundedSiteCount() - 4);
+    assert(scanner.CountMooreNeighbors(RES_TYPE) == 1);
+    assert(scanner.IsBorderingVonNeumann(RES_TYPE));
+
+    for (u32 i = 0; i < 20; ++i)
+    {
+      SPoint pt;
+      assert(scanner.FindRandomLocationOfType(RES_TYPE, 2, pt) == 2);
+      assert(pt == east || pt == south2);
+    }
+
+    SPoint sum;
+    assert(scanner.SumLocationsOfType(RES_TYPE, 1, sum) == 1);
+    assert(sum == east);
+    assert(scanner.SumLocationsOfType(RES_TYPE, 4, sum) == 2);
+    assert(sum == east + south2);
+    assert(scanner.SumLocationsOfType(DREG_TYPE, 2, sum) == 0);
+    assert(sum == SPoint(0, 0));
+    assert(scanner.GetNearestDistanceOfType(RES_TYPE, 4) == 1);
+    assert(scanner.GetNearestDistanceOfType(DREG_TYPE, 4) == 3);
+    assert(scanner.GetNearestDistanceOfType(DREG_TYPE, 2) == 0);
+
+    // Writes show up in later searches
+    ew.SetRelativeAtomDirect(east, TestAtom(EMPTY_TYPE,0,0,0));
+    assert(scanner.CountAtomsOfType(RES_TYPE, 2) == 1);
+    assert(!scanner.IsBorderingMoore(RES_TYPE));
+
+    // FindRandomAtoms answers in symmetry-mapped coordinates
+    ew.SetSymmetry(PSYM_DEG090L);
+    SPoint resPt;
+    u32 resCount;
+    scanner.FindRandomAtoms(2, 1, &resPt, RES_TYPE, &resCount);
+    assert(resCount == 1);
+    assert(ew.GetRelativeAtomSym(resPt).GetType() == RES_TYPE);
+    assert(scanner.SumLocationsOfType(RES_TYPE, 2, sum) == 1);
+    assert(sum == resPt);
+
+    ew.SetFree();
+  }
+
+  void EventWindow_Test::Test_EventWindowDiffuse()
+  {
+    // The site number table matches the points FillRandomSingleDir draws
+    const MDist<4> & md = MDist<4>::get();
+    for (u32 dir = 0; dir < 4; ++dir)
+    {
+      Random r1(dir + 1), r2(dir + 1);
+      SPoint sp;
+      md.FillRandomSingleDir(sp, r1);
+      const SPoint back = md.GetPoint(md.GetSingleDirSiteNumber(r2.Create(4)));
+      assert(sp == back);
+      SPoint opposite = md.GetPoint(md.GetSingleDirSiteNumber(dir ^ 1));
+      opposite *= -1;
+      assert(md.GetPoint(md.GetSingleDirSiteNumber(dir)) == opposite);
+    }
+
+    TestTile tile;
+    ElementTypeNumberMap<TestEventConfig> etnm;
+    Element_Wall<TestEventConfig>::THE_INSTANCE.AllocateTypeForTesting(etnm);
+    Element_Res<TestEventConfig>::THE_INSTANCE.AllocateTypeForTesting(etnm);
+    tile.RegisterElement(Element_Wall<TestEventConfig>::THE_INSTANCE);
+    tile.RegisterElement(Element_Res<TestEventConfig>::THE_INSTANCE);
+    assert(Element_Res<TestEventConfig>::THE_INSTANCE.IsAlwaysDiffusable());
+    assert(Element_Empty<TestEventConfig>::THE_INSTANCE.IsAlwaysDiffusable());
+    assert(!Element_Wall<TestEventConfig>::THE_INSTANCE.IsAlwaysDiffusable());
+
+    const SPoint center(15, 20);
+    const u32 WALL_TYPE = Element_Wall<TestEventConfig>::THE_INSTANCE.GetType();
+    const u32 RES_TYPE = Element_Res<TestEventConfig>::THE_INSTANCE.GetType();
+    const u32 EMPTY_TYPE = Element_Empty<TestEventConfig>::THE_INSTANCE.GetType();
+    tile.PlaceAtom(TestAtom(RES_TYPE,0,0,0), center);
+
+    TestEventWindow & ew = tile.GetEventWindow();
+
+    // Res and Empty always diffuse, to one of the four neighbors
+    ew.SetEventWindowsExecuted(1000000);
+    assert(ew.InitForEvent(center));
+    ew.Diffuse();
+    assert(ew.GetCenterAtomDirect().GetType() == EMPTY_TYPE);
+    ew.StoreToTile();
+    ew.SetFree();
+    assert(tile.GetAtom(center)->GetType() == EMPTY_TYPE);
+    u32 found = 0;
+    for (u32 dir = 0; dir < 4; ++dir)
+    {
+      const SPoint at = center + md.GetPoint(md.GetSingleDirSiteNumber(dir));
+      if (tile.GetAtom(at)->GetType() == RES_TYPE)
+      {
+        ++found;
+      }
+    }
+    assert(found == 1);
+
+    // Walls still get asked, and say no
+    tile.PlaceAtom(TestAtom(RES_TYPE,0,0,0), center);
+    for (u32 dir = 0; dir < 4; ++dir)
+    {
+      tile.PlaceAtom(TestAtom(WALL_TYPE,0,0,0), center + md.GetPoint(md.GetSingleDirSiteNumber(dir)));
+    }
+    ew.SetEventWindowsExecuted(2000000);
+    assert(ew.InitForEvent(center));
+    for (u32 i = 0; i < 20; ++i)
+    {
+      ew.Diffuse();
+    }
+    assert(ew.GetCenterAtomDirect().GetType() == RES_TYPE);
+    ew.StoreToTile();
+    ew.SetFree();
+  }
+
 } /* namespace MFM */
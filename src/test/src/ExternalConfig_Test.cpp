@@ -7,6 +7,8 @@
 #include "FileByteSink.h"  /* For STDERR */
 #include "Element_Dreg.h"
 #include "AbstractDriver.h"
+#include "CharBufferByteSource.h"
+#include <stdlib.h>  /* For free */
 
 namespace MFM
 {
@@ -47,8 +49,80 @@ namespace MFM
 
   }
 
+  /* Write grid's config with \a siteThreads into a malloced buffer */
+  static char * WriteGridConfig(ExternalConfig<TestGridConfig> & cfg,
+                                ExternalConfigSectionGrid<TestGridConfig> & ecsg,
+                                u32 siteThreads, size_t & length)
+  {
+    char * text = 0;
+    FILE * fp = open_memstream(&text, &length);
+    assert(fp);
+    {
+      FileByteSink fbs(fp);
+      ecsg.SetSiteThreads(siteThreads);
+      cfg.Write(fbs);
+    }
+    fclose(fp);
+    return text;
+  }
+
+  static void TestSiteThreads()
+  {
+    ElementRegistry<TestEventConfig> ereg;
+    ereg.RegisterElement(Element_Empty<TestEventConfig>::THE_INSTANCE);
+    ereg.RegisterElement(Element_Dreg<TestEventConfig>::THE_INSTANCE);
+
+    Grid<TestGridConfig> grid(ereg,4,3,GRID_LAYOUT_CHECKERBOARD);
+    grid.SetSeed(1);
+    grid.Init();
+    grid.Needed(Element_Dreg<TestEventConfig>::THE_INSTANCE);
+
+    const TestAtom dreg(Element_Dreg<TestEventConfig>::THE_INSTANCE.GetDefaultAtom());
+    for (u32 i = 0; i < 200; ++i)
+      grid.PlaceAtom(dreg, SPoint((i * 37) % grid.GetWidthSites(), (i * 11) % grid.GetHeightSites()));
+
+    TestDriver td;
+    ExternalConfig<TestGridConfig> cfg(td);
+    ExternalConfigSectionGrid<TestGridConfig> ecsg(cfg, grid);
+    cfg.RegisterSection(ecsg);
+
+    size_t serialLength, parallelLength;
+    char * serial = WriteGridConfig(cfg, ecsg, 1, serialLength);
+    char * parallel = WriteGridConfig(cfg, ecsg, 3, parallelLength);
+    assert(serialLength == parallelLength);
+    assert(!memcmp(serial, parallel, serialLength));
+
+    // Read it back by tiles, and it writes out the same again
+    Grid<TestGridConfig> grid2(ereg,4,3,GRID_LAYOUT_CHECKERBOARD);
+    grid2.SetSeed(2);
+    grid2.Init();
+    grid2.Needed(Element_Dreg<TestEventConfig>::THE_INSTANCE);
+    ExternalConfig<TestGridConfig> cfg2(td);
+    ExternalConfigSectionGrid<TestGridConfig> ecsg2(cfg2, grid2);
+    cfg2.RegisterSection(ecsg2);
+    OverflowableCharBufferByteSink<1024> errs;
+    cfg2.SetErrorByteSink(errs);
+
+    CharBufferByteSource cbs(serial, (u32) serialLength);
+    cfg2.SetByteSource(cbs, "TestSiteThreads");
+    ecsg2.SetSiteThreads(4);
+    assert(cfg2.Read());
+    assert(grid2.GetAtomCount(Element_Dreg<TestEventConfig>::THE_INSTANCE.GetType()) ==
+           grid.GetAtomCount(Element_Dreg<TestEventConfig>::THE_INSTANCE.GetType()));
+
+    size_t reloadedLength;
+    char * reloaded = WriteGridConfig(cfg2, ecsg2, 1, reloadedLength);
+    assert(reloadedLength == serialLength);
+    assert(!memcmp(reloaded, serial, serialLength));
+
+    free(reloaded);
+    free(parallel);
+    free(serial);
+  }
+
   void ExternalConfig_Test::Test_RunTests()
   {
     TestBasic();
+    TestSiteThreads();
   }
 }
@@ -11,6 +11,8 @@ namespace MFM {
     Test_FXPOps();
     Test_FXPCloser();
     Test_FXPFarther();
+    Test_FXPBatch();
+    Test_FXPFastApprox();
   }
 
   void FXP_Test::Test_FXPCtors()
@@ -256,4 +258,84 @@ namespace MFM {
 
   }
 
+  static s32 NextTestValue(u32 & seed)
+  {
+    seed = seed * 1664525u + 1013904223u;
+    return (s32) seed;
+  }
+
+  void FXP_Test::Test_FXPBatch()
+  {
+    enum { COUNT = 37 };  // Not a multiple of any vector width
+    FXP16 a[COUNT], b[COUNT], out[COUNT];
+    u32 seed = 1;
+    for (u32 i = 0; i < COUNT; ++i) {
+      a[i].intValue = NextTestValue(seed) >> 9;
+      b[i].intValue = NextTestValue(seed) >> 13;
+      if (b[i].intValue == 0) b[i].intValue = 1;
+    }
+
+    AddBatch(a, b, out, COUNT);
+    for (u32 i = 0; i < COUNT; ++i) assert(out[i] == a[i] + b[i]);
+
+    SubBatch(a, b, out, COUNT);
+    for (u32 i = 0; i < COUNT; ++i) assert(out[i] == a[i] - b[i]);
+
+    MulBatch(a, b, out, COUNT);
+    for (u32 i = 0; i < COUNT; ++i) assert(out[i] == a[i] * b[i]);
+
+    MulBatch(a, b[3], out, COUNT);
+    for (u32 i = 0; i < COUNT; ++i) assert(out[i] == a[i] * b[3]);
+
+    DivBatch(a, b, out, COUNT);
+    for (u32 i = 0; i < COUNT; ++i) assert(out[i] == a[i] / b[i]);
+
+    // In place
+    for (u32 i = 0; i < COUNT; ++i) out[i] = a[i];
+    AddBatch(out, b, out, COUNT);
+    for (u32 i = 0; i < COUNT; ++i) assert(out[i] == a[i] + b[i]);
+
+    // Empty
+    out[0] = 17;
+    AddBatch(a, b, out, 0);
+    assert(out[0] == 17);
+  }
+
+  void FXP_Test::Test_FXPFastApprox()
+  {
+    enum { COUNT = 1000 };
+    FXP16 a[COUNT], out[COUNT], cout[COUNT];
+
+    // Sqrt: relative 2^-16 plus one ulp, over the whole positive range
+    u32 seed = 2;
+    for (u32 i = 0; i < COUNT; ++i) {
+      s32 v = NextTestValue(seed) & 0x7fffffff;
+      a[i].intValue = v >> (i % 31);
+    }
+    a[0].intValue = 1;
+    a[1].intValue = 0x7fffffff;
+    a[2].intValue = 1<<16;
+    SqrtBatch(a, out, COUNT);
+    for (u32 i = 0; i < COUNT; ++i) {
+      assert(out[i] == FastSqrt(a[i]));
+      const double exact = sqrt(a[i].toDouble()) * 65536.0;
+      const double err = fabs(out[i].intValue - exact);
+      assert(err <= exact / 65536.0 + 1.0);
+    }
+    assert(FastSqrt(FXP16(4)) == FXP16(2));
+    assert(FastSqrt(FXP16(0)) == 0);
+    assert(FastSqrt(FXP16(-3)) == 0);
+
+    // Sin and Cos: absolute 2^-9, at any angle
+    for (u32 i = 0; i < COUNT; ++i)
+      a[i].intValue = NextTestValue(seed) >> (i % 16);
+    SinBatch(a, out, COUNT);
+    CosBatch(a, cout, COUNT);
+    for (u32 i = 0; i < COUNT; ++i) {
+      const double x = a[i].toDouble();
+      assert(fabs(out[i].toDouble() - sin(x)) <= 1.0 / 512);
+      assert(fabs(cout[i].toDouble() - cos(x)) <= 1.0 / 512);
+    }
+  }
+
 } /* namespace MFM */
@@ -0,0 +1,59 @@
+#include "assert.h"
+#include "FastClock_Test.h"
+#include "Logger.h"
+
+namespace MFM {
+
+  void FastClock_Test::Test_RunTests()
+  {
+    Test_clockTracksSystem();
+    Test_clockFallback();
+  }
+
+  /* Within this many nanoseconds of clock_gettime, allowing for a
+     preempted test thread */
+  static const u64 SLOP = 20000000;
+
+  static bool Near(u64 a, u64 b)
+  {
+    return (a > b ? a - b : b - a) < SLOP;
+  }
+
+  void FastClock_Test::Test_clockTracksSystem()
+  {
+    LOG.Message("FastClock: %s, %D Hz",
+                FastClock::IsCounterInUse() ? "counter" : "clock_gettime",
+                (u32) (FastClock::GetCounterHz() / 1000) * 1000);
+
+    u64 last = FastClock::MonotonicNanos();
+    for (u32 i = 0; i < 100000; ++i)
+    {
+      const u64 now = FastClock::MonotonicNanos();
+      assert(now >= last);
+      last = now;
+    }
+
+    // Still in step after a while
+    struct timespec pause = { 0, 30000000 };
+    nanosleep(&pause, 0);
+    assert(Near(FastClock::MonotonicNanos(), FastClock::ReadSystemNanos(CLOCK_MONOTONIC)));
+    assert(Near(FastClock::RealtimeNanos(), FastClock::ReadSystemNanos(CLOCK_REALTIME)));
+
+    struct timespec ts;
+    FastClock::Realtime(ts);
+    assert(ts.tv_nsec >= 0 && ts.tv_nsec < 1000000000);
+    assert(Near(((u64) ts.tv_sec) * 1000000000 + ts.tv_nsec,
+                FastClock::ReadSystemNanos(CLOCK_REALTIME)));
+  }
+
+  void FastClock_Test::Test_clockFallback()
+  {
+    const bool had = FastClock::IsCounterInUse();
+    FastClock::SetCounterEnabled(false);
+    assert(!FastClock::IsCounterInUse());
+    assert(Near(FastClock::MonotonicNanos(), FastClock::ReadSystemNanos(CLOCK_MONOTONIC)));
+    FastClock::SetCounterEnabled(true);
+    assert(FastClock::IsCounterInUse() == had);
+  }
+
+} /* namespace MFM */
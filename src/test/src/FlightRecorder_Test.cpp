@@ -0,0 +1,109 @@
+#include "assert.h"
+#include "FlightRecorder_Test.h"
+#include "Test_Common.h"
+#include "DynamicTile.h"
+#include "Element_Dreg.h"
+#include "Dirs.h"
+#include <stdio.h>   /* For tmpfile */
+#include <string.h>
+#include <unistd.h>
+
+namespace MFM {
+
+  void FlightRecorder_Test::Test_RunTests() {
+    Test_flightRecorderRing();
+    Test_flightRecorderTileEvents();
+  }
+
+  /* Dump fr into buf, returning the lines written */
+  static u32 DumpToBuffer(const FlightRecorder & fr, char * buf, u32 size)
+  {
+    FILE * file = tmpfile();
+    assert(file);
+    fr.Dump(fileno(file));
+    rewind(file);
+    const size_t got = fread(buf, 1, size - 1, file);
+    fclose(file);
+    buf[got] = 0;
+    u32 lines = 0;
+    for (const char * p = buf; *p; ++p)
+      if (*p == '\n') ++lines;
+    return lines;
+  }
+
+  void FlightRecorder_Test::Test_flightRecorderRing()
+  {
+    FlightRecorder fr;
+    fr.SetLabel("ring");
+    assert(fr.GetBegun() == 0);
+
+    const u32 events = FlightRecorder::RECORDS + 44;
+    for (u32 i = 0; i < events; ++i)
+    {
+      FlightRecorder::Record & r =
+        fr.Begin(SPoint(i % 50, i / 50), i, 1 << (i % Dirs::DIR_COUNT), 1000 + 10 * i);
+      r.m_outcome = i % 3 == 0 ? FlightRecorder::FAILED : FlightRecorder::DONE;
+    }
+    assert(fr.GetBegun() == events);
+
+    // The newest overwrote the oldest
+    const FlightRecorder::Record & newest = fr.GetRecent(0);
+    assert(newest.m_type == events - 1);
+    assert(newest.m_x == (events - 1) % 50 && newest.m_y == (events - 1) / 50);
+    assert(newest.m_stamp == 1000 + 10 * (events - 1));
+    const FlightRecorder::Record & oldest = fr.GetRecent(FlightRecorder::RECORDS - 1);
+    assert(oldest.m_type == 44);
+
+    // A dump has a header and a line per kept record, oldest first
+    static char buf[64 * 1024];
+    assert(DumpToBuffer(fr, buf, sizeof(buf)) == FlightRecorder::RECORDS + 1);
+    assert(strstr(buf, "Flight recorder, tile ring: last 256 of 300 events"));
+    assert(strstr(buf, "\n  -2550 (44,0) type 0x002c locks ST done\n"));
+    assert(strstr(buf, "\n  -0 (49,5) type 0x012b locks SE done\n"));
+    assert(!strstr(buf, "type 0x002b"));
+
+    // One that's begun but not ended says where it died
+    fr.Begin(SPoint(3, 4), 0xbeef, 0, 5000);
+    assert(DumpToBuffer(fr, buf, sizeof(buf)) == FlightRecorder::RECORDS + 1);
+    assert(strstr(buf, "(3,4) type 0xbeef locks none behaving\n"));
+  }
+
+  void FlightRecorder_Test::Test_flightRecorderTileEvents()
+  {
+    const u32 R = TestEventConfig::EVENT_WINDOW_RADIUS;
+    DynamicTile<TestEventConfig> tile(40, 30);
+    tile.SetLabel("FR");
+    tile.SetWarpFactor(10);  // So RejectOnRecency never turns an event down
+
+    ElementTypeNumberMap<TestEventConfig> etnm;
+    Element_Dreg<TestEventConfig>::THE_INSTANCE.AllocateType(etnm);
+    tile.RegisterElement(Element_Dreg<TestEventConfig>::THE_INSTANCE);
+    const TestAtom dreg(Element_Dreg<TestEventConfig>::THE_INSTANCE.GetDefaultAtom());
+    const u32 dregType = dreg.GetType();
+
+    // Every event the tile runs goes in, without asking
+    const FlightRecorder & fr = tile.GetFlightRecorder();
+    const SPoint corner(R, R);
+    tile.PlaceAtom(dreg, corner);
+    TestEventWindow & ew = tile.GetEventWindow();
+    assert(ew.TryEventAtForTesting(corner));
+    assert(fr.GetBegun() == 1);
+
+    const FlightRecorder::Record & r = fr.GetRecent(0);
+    assert(r.m_x == R && r.m_y == R);
+    assert(r.m_type == dregType);
+    assert(r.m_outcome == FlightRecorder::DONE);
+    assert(r.m_lockDirs == ((1 << Dirs::NORTHWEST) | (1 << Dirs::WEST) | (1 << Dirs::NORTH)));
+
+    for (u32 i = 0; i < 1000; ++i)
+    {
+      ew.TryEventAtForTesting(tile.GetRandomOwnedCoord());
+    }
+    assert(fr.GetBegun() > 1);
+    assert(fr.GetRecent(0).m_outcome == FlightRecorder::DONE);
+
+    static char buf[64 * 1024];
+    DumpToBuffer(fr, buf, sizeof(buf));
+    assert(!strncmp(buf, "Flight recorder, tile FR: last ", 31));
+  }
+}
@@ -222,9 +222,113 @@ namespace MFM {
     assert(pt.CanRead(false) == 13 + 11);
   }
 
+  void GridTransceiver_Test::Test_DirectMode() {
+    GridTransceiver pt;
+    assert(!pt.IsDirectMode());
+    pt.SetDirectMode(true);
+    assert(pt.IsDirectMode());
+    pt.SetEnabled(true);
+
+    const char * aWrite = "foo";
+    const u32 aLen = strlen(aWrite);
+
+    // Written bytes are readable at once, with nothing in transit
+    assert(pt.Write(true, (const u8 *) aWrite, aLen) == aLen);
+    assert(pt.CanXmit(true) == 0);
+    assert(pt.CanRcv(false) == 0);
+    assert(pt.CanRead(false) == aLen);
+    assert(pt.CanRead(true) == 0);
+
+    // And advancing time changes nothing
+    assert(!pt.Advance(1000000000));
+    assert(pt.CanRead(false) == aLen);
+
+    u8 buf[10];
+    assert(pt.Read(false, buf, sizeof(buf)) == aLen);
+    assert(!memcmp(buf, aWrite, aLen));
+    assert(pt.CanRead(false) == 0);
+    assert(pt.CanWrite(true) == GridTransceiver::BUFFER_SIZE - 1);
+
+    // Can't leave direct mode with bytes in transit
+    pt.SetDirectMode(false);
+    assert(pt.Write(true, (const u8 *) aWrite, aLen) == aLen);
+    bool failed = false;
+    unwind_protect({failed = true;},{
+        pt.SetDirectMode(true);
+      });
+    assert(failed);
+    assert(!pt.IsDirectMode());
+  }
+
+  void GridTransceiver_Test::Test_Spans() {
+    GridTransceiver pt;
+    pt.SetDirectMode(true);
+    pt.SetEnabled(true);
+
+    // Walk the indices around the ring so spans must wrap
+    const u32 CHUNK = 300;
+    u8 out[CHUNK], in[CHUNK];
+    for (u32 round = 0; round < 3 * GridTransceiver::BUFFER_SIZE / CHUNK; ++round)
+    {
+      for (u32 i = 0; i < CHUNK; ++i)
+      {
+        out[i] = (u8) (round * CHUNK + i);
+      }
+
+      // Serialize in place, as far as the first span allows
+      u8 * wspan;
+      u32 wlen = pt.ReserveWrite(true, wspan);
+      assert(wlen > 0);
+      u32 first = wlen < CHUNK ? wlen : CHUNK;
+      memcpy(wspan, out, first);
+      pt.CommitWrite(true, first);
+      assert(pt.Write(true, out + first, CHUNK - first) == CHUNK - first);
+      assert(pt.CanRead(false) == CHUNK);
+
+      // Parse in place, likewise
+      const u8 * rspan;
+      u32 rlen = pt.PeekRead(false, rspan);
+      assert(rlen > 0);
+      first = rlen < CHUNK ? rlen : CHUNK;
+      memcpy(in, rspan, first);
+      pt.ConsumeRead(false, first);
+      assert(pt.Read(false, in + first, CHUNK - first) == CHUNK - first);
+      assert(!memcmp(in, out, CHUNK));
+    }
+
+    // Committing past the reserved span FAILs
+    u8 * wspan;
+    u32 wlen = pt.ReserveWrite(false, wspan);
+    bool failed = false;
+    unwind_protect({failed = true;},{
+        pt.CommitWrite(false, wlen + 1);
+      });
+    assert(failed);
+    assert(pt.CanRead(true) == 0);
+
+    // Spans also work, mutex-protected, in simulated mode
+    GridTransceiver st;
+    st.SetEnabled(true);
+    st.SetMaxInFlight(0);
+    wlen = st.ReserveWrite(true, wspan);
+    assert(wlen == GridTransceiver::BUFFER_SIZE - 1);
+    memcpy(wspan, "bar", 3);
+    st.CommitWrite(true, 3);
+    assert(st.CanXmit(true) == 3);
+    const u8 * rspan;
+    assert(st.PeekRead(false, rspan) == 0);
+    st.Advance(1000000000);
+    assert(st.PeekRead(false, rspan) == 3);
+    assert(!memcmp(rspan, "bar", 3));
+    st.ConsumeRead(false, 3);
+    assert(st.CanRead(false) == 0);
+  }
+
   void GridTransceiver_Test::Test_RunTests() {
     Test_Basic();
     Test_DataRates();
+    Test_DirectMode();
+    Test_Spans();
   }
 
 } /* namespace MFM */
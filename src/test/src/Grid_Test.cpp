@@ -1,7 +1,20 @@
 #include "assert.h"
 #include "Grid.h"
 #include "Grid_Test.h"
+#include "GridSnapshot.h"
+#include "GridCheckpoint.h"
+#include "GridDiff.h"
+#include "GridEnsemble.h"
+#include "GridPattern.h"
+#include "CharBufferByteSource.h"
+#include "Element_Dreg.h"
 #include "Element_Res.h"
+#include "Element_Wall.h"
+#include "EventWindowBatch.h"
+#include "SortingWork.h"
+#include <stdio.h>   /* For snprintf */
+#include <stdlib.h>  /* For atoi */
+#include <unistd.h>  /* For getpid, unlink */
 
 namespace MFM {
 
@@ -27,4 +40,1965 @@ namespace MFM {
     assert(out->GetType() == atom.GetType());
 
   }
+
+  void Grid_Test::Test_gridTilePool()
+  {
+    ElementRegistry<TestEventConfig> ereg;
+    TestGrid grid(ereg,4,3, (GridLayoutPattern) GRID_LAYOUT_CHECKERBOARD);
+
+    grid.SetSeed(1);
+    grid.SetTilePool(true, 3);
+    grid.Init();
+    grid.InitThreads();
+
+    assert(grid.IsUsingTilePool());
+    assert(grid.GetTilePoolWorkerCount() == 3);
+
+    grid.Unpause();
+    SleepMsec(50);
+    grid.Pause();
+
+    u64 events = grid.GetTotalEventsExecuted();
+    assert(events > 0);
+
+    // Paused tiles stay put
+    SleepMsec(10);
+    assert(grid.GetTotalEventsExecuted() == events);
+
+    // And publish their stats once they see they're paused
+    for (u32 i = 0; i < 100 && grid.GetPublishedTotal(TileStatsTree::EVENTS) != events; ++i)
+    {
+      SleepMsec(10);
+    }
+    assert(grid.GetPublishedTotal(TileStatsTree::EVENTS) == events);
+
+    grid.ShutdownTileThreads();
+  }
+
+  static void RunCacheGrid(u32 batchLimit, bool direct,
+                           u64 & events, u64 & packets, u64 & bytes)
+  {
+    ElementRegistry<TestEventConfig> ereg;
+    TestGrid grid(ereg,2,2, (GridLayoutPattern) GRID_LAYOUT_CHECKERBOARD);
+
+    grid.SetSeed(1);
+    grid.SetCacheBatchLimit(batchLimit);
+    grid.SetDirectChannels(direct);
+    grid.Init();
+    grid.InitThreads();
+    SleepMsec(10);  // Let the tile threads go passive
+
+    grid.Unpause();
+    SleepMsec(50);
+    grid.Pause();
+
+    events = grid.GetTotalEventsExecuted();
+    grid.GetCacheShippedCounts(packets, bytes);
+
+    grid.ShutdownTileThreads();
+  }
+
+  void Grid_Test::Test_gridCacheBatch()
+  {
+    u64 events, packets, bytes;
+    RunCacheGrid(0, false, events, packets, bytes);
+    assert(events > 0 && packets > 0);
+    const double unbatchedPerEvent = ((double) packets) / events;
+
+    RunCacheGrid(EVENT_WINDOW_SITES(TestEventConfig::EVENT_WINDOW_RADIUS), false, events, packets, bytes);
+    assert(events > 0 && packets > 0);
+    const double batchedPerEvent = ((double) packets) / events;
+
+    // Folding begin, sites, and end into shared packets must help
+    assert(batchedPerEvent < unbatchedPerEvent);
+  }
+
+  static double RunCompactGrid(bool compact)
+  {
+    ElementRegistry<TestEventConfig> ereg;
+    TestGrid grid(ereg,2,2, (GridLayoutPattern) GRID_LAYOUT_CHECKERBOARD);
+
+    grid.SetSeed(1);
+    grid.SetCacheBatchLimit(EVENT_WINDOW_SITES(TestEventConfig::EVENT_WINDOW_RADIUS));
+    grid.SetCompactCache(compact);
+    grid.Init();
+
+    // Spot check every visible site, so reconstruction is checked too
+    grid.SetCacheRedundancy(CacheProcessor<TestEventConfig>::MIN);
+    grid.Needed(Element_Res<TestEventConfig>::THE_INSTANCE);
+
+    // Some diffusing Res, so updates carry changes as well as checks
+    TestAtom atom(Element_Res<TestEventConfig>::THE_INSTANCE.GetDefaultAtom());
+    u32 resCount = 0;
+    for (u32 y = 1; y < grid.GetHeightSites(); y += 5)
+    {
+      for (u32 x = 1; x < grid.GetWidthSites(); x += 5)
+      {
+        grid.PlaceAtom(atom, SPoint(x, y));
+        ++resCount;
+      }
+    }
+
+    grid.InitThreads();
+    SleepMsec(10);  // Let the tile threads go passive
+
+    grid.Unpause();
+    SleepMsec(100);
+    grid.Pause();
+
+    const u64 events = grid.GetTotalEventsExecuted();
+    u64 packets, bytes;
+    grid.GetCacheShippedCounts(packets, bytes);
+    assert(events > 0 && bytes > 0);
+
+    // Both ends must have rebuilt every atom as shipped
+    for (TestGrid::iterator_type i = grid.begin(); i != grid.end(); ++i)
+    {
+      i->NeedAtomRecount();
+    }
+    for (u32 d = Dirs::NORTH; d <= Dirs::NORTHWEST; ++d)
+    {
+      u64 checkAtoms, checkBytes, clean, failed;
+      grid.GetCacheCheckCounts((Dir) d, checkAtoms, checkBytes, clean, failed);
+      assert(failed == 0);
+    }
+    assert(grid.GetAtomCount(Element_Res<TestEventConfig>::THE_INSTANCE.GetType()) == resCount);
+
+    grid.ShutdownTileThreads();
+    return ((double) bytes) / events;
+  }
+
+  void Grid_Test::Test_gridCompactCache()
+  {
+    const double batchedPerEvent = RunCompactGrid(false);
+    const double compactPerEvent = RunCompactGrid(true);
+
+    // Mostly empty and unchanged sites must ship far smaller
+    assert(compactPerEvent < batchedPerEvent / 2);
+  }
+
+  void Grid_Test::Test_gridDirectChannels()
+  {
+    u64 events, packets, bytes;
+    RunCacheGrid(0, true, events, packets, bytes);
+    assert(events > 0 && packets > 0);
+
+    RunCacheGrid(EVENT_WINDOW_SITES(TestEventConfig::EVENT_WINDOW_RADIUS), true, events, packets, bytes);
+    assert(events > 0 && packets > 0);
+  }
+
+  void Grid_Test::Test_gridNUMAPlacement()
+  {
+    NUMAPlacement numa;
+    assert(numa.Discover());
+    assert(numa.GetNodeCount() > 0);
+    for (u32 n = 0; n < numa.GetNodeCount(); ++n)
+    {
+      assert(numa.GetCPUCount(n) > 0);
+    }
+
+    // Bands: neighbors along the long axis mostly share a node
+    assert(numa.GetNodeForTile(0, 0, 4, 3) == 0);
+    assert(numa.GetNodeForTile(0, 2, 4, 3) == 0);
+    assert(numa.GetNodeForTile(3, 1, 4, 3) == numa.GetNodeCount() * 3 / 4);
+
+    for (u32 pool = 0; pool < 2; ++pool)
+    {
+      ElementRegistry<TestEventConfig> ereg;
+      TestGrid grid(ereg,2,2, (GridLayoutPattern) GRID_LAYOUT_CHECKERBOARD);
+
+      grid.SetSeed(1);
+      if (pool)
+      {
+        grid.SetTilePool(true, 2);
+      }
+      grid.SetNUMAPlacement(true);
+      grid.Init();
+      grid.InitThreads();
+      SleepMsec(10);  // Let the tile threads go passive
+      assert(grid.IsUsingNUMAPlacement());
+
+      grid.Unpause();
+      SleepMsec(50);
+      grid.Pause();
+      assert(grid.GetTotalEventsExecuted() > 0);
+
+      grid.ShutdownTileThreads();
+    }
+  }
+
+  void Grid_Test::Test_gridHugePages()
+  {
+    ElementRegistry<TestEventConfig> ereg;
+    TestGrid grid(ereg,2,2, (GridLayoutPattern) GRID_LAYOUT_CHECKERBOARD);
+
+    // Tiles start on a huge page boundary whether or not they use them
+    const TestGrid::GridTile * tiles =
+      &static_cast<const TestGrid::GridTile &>(grid.Get00Tile());
+    assert(((u64) tiles) % HugePageMemory::HUGE_PAGE_SIZE == 0);
+
+    u64 resident, huge;
+    assert(HugePageMemory::GetResidency(tiles, 4 * sizeof(TestGrid::GridTile),
+                                        resident, huge));
+    assert(resident > 0);
+    assert(huge <= resident);
+
+    grid.SetSeed(1);
+    grid.SetHugePages(true);
+    grid.Init();
+    grid.InitThreads();
+    SleepMsec(10);  // Let the tile threads go passive
+
+    grid.Unpause();
+    SleepMsec(50);
+    grid.Pause();
+    assert(grid.GetTotalEventsExecuted() > 0);
+
+    grid.ShutdownTileThreads();
+  }
+
+  void Grid_Test::Test_gridOrderedTileControl()
+  {
+    ElementRegistry<TestEventConfig> ereg;
+    TestGrid grid(ereg,4,3, (GridLayoutPattern) GRID_LAYOUT_CHECKERBOARD);
+
+    // Morton order: every tile once, each 2x2 block together
+    const u32 expected[] = { 0, 1, 4, 5, 2, 3, 6, 7, 8, 9, 10, 11 };
+    u32 count = 0;
+    for (grid.m_ogi.Reset(); grid.m_ogi.HasNext(); ++count)
+    {
+      assert(count < 12);
+      assert(grid.m_ogi.Next() == expected[count]);
+    }
+    assert(count == 12);
+
+    grid.SetSeed(1);
+    grid.SetOrderedTileControl(true);
+    assert(grid.IsUsingOrderedTileControl());
+    grid.Init();
+    grid.InitThreads();
+    SleepMsec(10);  // Let the tile threads go passive
+
+    grid.Unpause();
+    SleepMsec(50);
+    grid.Pause();
+    assert(grid.GetTotalEventsExecuted() > 0);
+
+    grid.ShutdownTileThreads();
+  }
+
+  void Grid_Test::Test_gridLockSpin()
+  {
+    ElementRegistry<TestEventConfig> ereg;
+    TestGrid grid(ereg,2,2, (GridLayoutPattern) GRID_LAYOUT_CHECKERBOARD);
+
+    grid.SetSeed(1);
+    grid.Init();
+    grid.SetLockSpinCount(20);
+
+    Tile<TestEventConfig> & tile = grid.GetTile(SPoint(0,0));
+    assert(tile.GetLockSpinCount() == 20);
+    CacheProcessor<TestEventConfig> & cp = tile.GetCacheProcessor(Dirs::EAST);
+    assert(cp.IsConnected());
+
+    // A lock nobody releases: spinning gives up, and it's counted
+    u32 other;
+    LonglivedLock & lock = cp.GetLonglivedLock();
+    assert(lock.TryLock(&other));
+    THREEDIR regions = { Dirs::EAST, Dirs::EAST, Dirs::EAST };
+    assert(!cp.TryLock(1, regions, tile.GetLockSpinCount()));
+    assert(cp.GetLockFailures() == 1 && cp.GetLockSpinWins() == 0);
+    assert(lock.Unlock(&other));
+
+    assert(cp.TryLock(1, regions, tile.GetLockSpinCount()));
+    cp.Unlock();
+    assert(cp.GetLockFailures() == 1);
+
+    u64 failures, spinWins;
+    grid.GetLockFailureCounts(failures, spinWins);
+    assert(failures == 1 && spinWins == 0);
+
+    // And events still run, spinning
+    grid.InitThreads();
+    SleepMsec(10);  // Let the tile threads go passive
+    grid.Unpause();
+    SleepMsec(50);
+    grid.Pause();
+    assert(grid.GetTotalEventsExecuted() > 0);
+
+    grid.ShutdownTileThreads();
+  }
+
+  void Grid_Test::Test_gridVisibleSites()
+  {
+    ElementRegistry<TestEventConfig> ereg;
+    TestGrid grid(ereg,2,2, (GridLayoutPattern) GRID_LAYOUT_CHECKERBOARD);
+
+    grid.SetSeed(1);
+    grid.Init();
+
+    // The precomputed masks must agree with mapping each site over
+    const u32 R = TestEventConfig::EVENT_WINDOW_RADIUS;
+    const MDist<R> & md = MDist<R>::get();
+    Tile<TestEventConfig> & tile = grid.GetTile(SPoint(0,0));
+    u32 checked = 0;
+    for (u32 d = Dirs::NORTH; d <= Dirs::NORTHWEST; ++d)
+    {
+      CacheProcessor<TestEventConfig> & cp = tile.GetCacheProcessor((Dir) d);
+      if (!cp.IsConnected())
+      {
+        continue;
+      }
+      for (s32 y = R; y < (s32) (tile.TILE_HEIGHT - R); ++y)
+      {
+        for (s32 x = R; x < (s32) (tile.TILE_WIDTH - R); ++x)
+        {
+          const SPoint center(x, y);
+          cp.Activate();
+          cp.StartLoading(center);
+          const u64 visible = cp.GetVisibleSites();
+          cp.SetIdle();
+
+          for (u32 i = 0; i < EVENT_WINDOW_SITES(R); ++i)
+          {
+            const bool expected = tile.IsInTile(cp.LocalToRemote(md.GetPoint(i) + center));
+            assert(expected == (((visible >> i) & 1) != 0));
+          }
+          ++checked;
+        }
+      }
+    }
+    assert(checked > 0);
+  }
+
+  void Grid_Test::Test_gridCacheRedundancy()
+  {
+    ElementRegistry<TestEventConfig> ereg;
+    TestGrid grid(ereg,2,2, (GridLayoutPattern) GRID_LAYOUT_CHECKERBOARD);
+
+    grid.SetSeed(1);
+    grid.Init();
+    grid.Needed(Element_Res<TestEventConfig>::THE_INSTANCE);
+
+    // Scatter diffusing Res everywhere so every link carries updates
+    TestAtom atom(Element_Res<TestEventConfig>::THE_INSTANCE.GetDefaultAtom());
+    for (u32 y = 1; y < grid.GetHeightSites(); y += 4)
+    {
+      for (u32 x = 1; x < grid.GetWidthSites(); x += 4)
+      {
+        grid.PlaceAtom(atom, SPoint(x, y));
+      }
+    }
+
+    grid.InitThreads();
+    SleepMsec(10);  // Let the tile threads go passive
+
+    // Every link starts out checking every unchanged atom
+    assert(grid.GetAverageCacheRedundancy() == 100.0);
+
+    grid.Unpause();
+    SleepMsec(200);
+    grid.Pause();
+
+    u64 totalChecks = 0;
+    for (u32 d = Dirs::NORTH; d <= Dirs::NORTHWEST; ++d)
+    {
+      u64 atoms, bytes, clean, failed;
+      grid.GetCacheCheckCounts((Dir) d, atoms, bytes, clean, failed);
+      assert(failed == 0);        // Nothing should ever corrupt a cache here
+      assert(bytes >= atoms);
+      totalChecks += atoms;
+    }
+    assert(totalChecks > 0);
+
+    // Clean links must have backed off well past the initial odds
+    const double redundancy = grid.GetAverageCacheRedundancy();
+    assert(redundancy > 0 && redundancy < 100.0 / 4);
+
+    grid.SetCacheRedundancy(CacheProcessor<TestEventConfig>::MAX);
+    assert(grid.GetAverageCacheRedundancy() == 100.0 / 256);
+
+    grid.ShutdownTileThreads();
+  }
+
+  void Grid_Test::Test_gridSparseEvents()
+  {
+    ElementRegistry<TestEventConfig> ereg;
+    TestGrid grid(ereg,2,2, (GridLayoutPattern) GRID_LAYOUT_CHECKERBOARD);
+
+    grid.SetSeed(1);
+    grid.SetSparseEvents(true);
+    grid.Init();
+    grid.Needed(Element_Res<TestEventConfig>::THE_INSTANCE);
+
+    TestAtom atom(Element_Res<TestEventConfig>::THE_INSTANCE.GetDefaultAtom());
+    const u32 RES_COUNT = 5;
+    for (u32 i = 0; i < RES_COUNT; ++i)
+    {
+      grid.PlaceAtom(atom, SPoint(5 + 9 * i, 10));
+    }
+
+    grid.InitThreads();
+    SleepMsec(10);  // Let the tile threads go passive
+
+    grid.Unpause();
+    SleepMsec(50);
+    grid.Pause();
+
+    // Nearly every site is empty, so nearly every credited event was skipped
+    const u64 events = grid.GetTotalEventsExecuted();
+    const u64 skipped = grid.GetTotalSkippedEmptyEvents();
+    assert(skipped > 0 && skipped < events);
+
+    // The incrementally maintained index matches a fresh scan
+    u32 occupied = 0;
+    for (TestGrid::iterator_type i = grid.begin(); i != grid.end(); ++i)
+    {
+      u32 incremental = i->GetOccupiedSiteCount();
+      i->NeedAtomRecount();
+      assert(i->GetOccupiedSiteCount() == incremental);
+      occupied += incremental;
+    }
+    assert(occupied == RES_COUNT);
+
+    grid.ShutdownTileThreads();
+  }
+
+  void Grid_Test::Test_gridAgedEvents()
+  {
+    ElementRegistry<TestEventConfig> ereg;
+    TestGrid grid(ereg,2,2, (GridLayoutPattern) GRID_LAYOUT_CHECKERBOARD);
+
+    grid.SetSeed(1);
+    grid.SetAgedEvents(true);
+    grid.Init();
+    grid.Needed(Element_Res<TestEventConfig>::THE_INSTANCE);
+
+    TestAtom atom(Element_Res<TestEventConfig>::THE_INSTANCE.GetDefaultAtom());
+    for (u32 i = 0; i < 5; ++i)
+    {
+      grid.PlaceAtom(atom, SPoint(5 + 9 * i, 10));
+    }
+
+    grid.InitThreads();
+    SleepMsec(10);  // Let the tile threads go passive
+
+    grid.Unpause();
+    SleepMsec(50);
+    grid.Pause();
+
+    // Nothing to reject on recency, so nearly every attempt ran
+    u64 attempted = 0;
+    for (TestGrid::iterator_type i = grid.begin(); i != grid.end(); ++i)
+    {
+      assert(i->IsUsingAgedEvents());
+      attempted += i->GetEventWindow().GetEventWindowsAttempted();
+    }
+    const u64 executed = grid.GetTotalEventsExecuted();
+    assert(executed > 0 && executed * 10 > attempted * 8);
+
+    grid.ShutdownTileThreads();
+  }
+
+  void Grid_Test::Test_gridQuiescentSleep()
+  {
+    ElementRegistry<TestEventConfig> ereg;
+    TestGrid grid(ereg,2,2, (GridLayoutPattern) GRID_LAYOUT_CHECKERBOARD);
+
+    grid.SetSeed(1);
+    grid.SetQuiescentSleep(true);
+    grid.Init();
+    grid.Needed(Element_Res<TestEventConfig>::THE_INSTANCE);
+
+    grid.InitThreads();
+    SleepMsec(10);  // Let the tile threads go passive
+
+    // Empty tiles soon fall asleep, and keep being credited events
+    grid.Unpause();
+    for (u32 i = 0; i < 200 && grid.GetQuiescentTileCount() < 4; ++i)
+    {
+      SleepMsec(10);
+    }
+    assert(grid.GetQuiescentTileCount() == 4);
+    const u64 credited = grid.GetTotalQuiescentEvents();
+    SleepMsec(50);
+    assert(grid.GetTotalQuiescentEvents() > credited);
+    grid.Pause();
+    assert(grid.GetTotalEventsExecuted() >= grid.GetTotalQuiescentEvents());
+
+    // Pausing woke them all; a tile with live atoms stays awake
+    assert(grid.GetQuiescentTileCount() == 0);
+    TestAtom atom(Element_Res<TestEventConfig>::THE_INSTANCE.GetDefaultAtom());
+    grid.PlaceAtom(atom, SPoint(10, 10));
+    grid.Unpause();
+    for (u32 i = 0; i < 200 && grid.GetQuiescentTileCount() < 3; ++i)
+    {
+      // Recounts demanded from here don't let it doze off, either
+      for (TestGrid::iterator_type it = grid.begin(); it != grid.end(); ++it)
+      {
+        it->NeedAtomRecount();
+      }
+      SleepMsec(10);
+    }
+    SleepMsec(50);
+    assert(grid.GetQuiescentTileCount() < 4);
+    grid.Pause();
+
+    grid.ShutdownTileThreads();
+  }
+
+  void Grid_Test::Test_gridAtomCountsWhileRunning()
+  {
+    ElementRegistry<TestEventConfig> ereg;
+    TestGrid grid(ereg,2,2, (GridLayoutPattern) GRID_LAYOUT_CHECKERBOARD);
+
+    grid.SetSeed(1);
+    grid.Init();
+    grid.Needed(Element_Dreg<TestEventConfig>::THE_INSTANCE);
+    grid.Needed(Element_Res<TestEventConfig>::THE_INSTANCE);
+
+    const u32 types[] = {
+      Element_Empty<TestEventConfig>::THE_INSTANCE.GetType(),
+      Element_Dreg<TestEventConfig>::THE_INSTANCE.GetType(),
+      Element_Res<TestEventConfig>::THE_INSTANCE.GetType()
+    };
+    const u32 TYPES = sizeof(types) / sizeof(types[0]);
+
+    TestAtom dreg(Element_Dreg<TestEventConfig>::THE_INSTANCE.GetDefaultAtom());
+    for (u32 i = 0; i < 8; ++i)
+    {
+      grid.PlaceAtom(dreg, SPoint(7 * i + 3, 5 * i + 2));
+    }
+
+    grid.InitThreads();
+    SleepMsec(10);  // Let the tile threads go passive
+
+    // Dregs churn every tile while we read its counts, demanding a
+    // recount from here now and then, and then leaving the tile
+    // threads to keep the counts as they go
+    grid.Unpause();
+    const u32 sites = grid.GetWidthSites() * grid.GetHeightSites();
+    for (u32 i = 0; i < 200; ++i)
+    {
+      for (u32 t = 0; t < TYPES; ++t)
+      {
+        assert(grid.GetAtomCount(types[t]) <= sites);
+      }
+      if (i < 100 && i % 10 == 0)
+      {
+        for (TestGrid::iterator_type it = grid.begin(); it != grid.end(); ++it)
+        {
+          it->NeedAtomRecount();
+        }
+      }
+      SleepMsec(1);
+    }
+    grid.Pause();
+    assert(grid.GetTotalEventsExecuted() > 0);
+
+    // Whatever overlapped, the counts agree with the sites themselves
+    u32 counted[TYPES] = { 0 };
+    for (u32 y = 0; y < grid.GetHeightSites(); ++y)
+    {
+      for (u32 x = 0; x < grid.GetWidthSites(); ++x)
+      {
+        SPoint at(x, y);
+        for (u32 t = 0; t < TYPES; ++t)
+        {
+          if (grid.GetAtom(at)->GetType() == types[t])
+            ++counted[t];
+        }
+      }
+    }
+    for (u32 t = 0; t < TYPES; ++t)
+    {
+      assert(grid.GetAtomCount(types[t]) == counted[t]);
+    }
+    assert(counted[1] > 0 && counted[2] > 0);
+
+    grid.ShutdownTileThreads();
+  }
+
+  void Grid_Test::Test_gridActivityScheduling()
+  {
+    for (u32 pooled = 0; pooled < 2; ++pooled)
+    {
+      ElementRegistry<TestEventConfig> ereg;
+      TestGrid grid(ereg,3,1, (GridLayoutPattern) GRID_LAYOUT_CHECKERBOARD);
+
+      grid.SetSeed(1);
+      grid.SetTilePool(pooled, 2);
+      grid.SetActivityScheduling(true);
+      grid.Init();
+      grid.Needed(Element_Res<TestEventConfig>::THE_INSTANCE);
+      assert(grid.IsUsingActivityScheduling());
+
+      // Tiles start out presumed busy
+      assert(grid.GetTileActivity(SPoint(0, 0)) == TestGrid::ACTIVITY_ONE);
+
+      // Crowd the first tile; the last stays out of reach
+      TestAtom atom(Element_Res<TestEventConfig>::THE_INSTANCE.GetDefaultAtom());
+      for (s32 y = 0; y < 20; ++y)
+      {
+        for (s32 x = 0; x < 20; ++x)
+        {
+          grid.PlaceAtom(atom, SPoint(x + 6, y + 6));
+        }
+      }
+
+      grid.InitThreads();
+      SleepMsec(10);  // Let the tile threads go passive
+      grid.Unpause();
+      SleepMsec(100);
+      grid.Pause();
+
+      const u32 busy = grid.GetTileActivity(SPoint(0, 0));
+      const u32 idle = grid.GetTileActivity(SPoint(2, 0));
+      assert(busy > idle);
+      assert(idle < TestGrid::ACTIVITY_ONE / 4);
+      assert(grid.GetTotalEventsExecuted() > 0);
+
+      grid.ShutdownTileThreads();
+    }
+  }
+
+  void Grid_Test::Test_gridMemoryAccount()
+  {
+    ElementRegistry<TestEventConfig> ereg;
+    TestGrid grid(ereg,2,1, (GridLayoutPattern) GRID_LAYOUT_CHECKERBOARD);
+
+    grid.SetSeed(1);
+    grid.Init();
+    grid.Needed(Element_Res<TestEventConfig>::THE_INSTANCE);
+
+    MemoryAccount before;
+    grid.AccountMemory(before);
+
+    // Two tiles and the hero tile, at least a site each
+    const u64 siteBytes = (u64) TestGrid::OWNED_WIDTH * TestGrid::OWNED_HEIGHT * sizeof(TestAtom);
+    assert(before.GetBytes(MemoryAccount::SITES) >= 3 * siteBytes);
+    assert(before.GetBytes(MemoryAccount::CACHE_PROCESSORS) > 0);
+    assert(before.GetBytes(MemoryAccount::TRANSCEIVERS) > 0);
+    assert(before.GetBytes(MemoryAccount::ELEMENTS) > 0);
+    assert(before.GetBytes(MemoryAccount::SURFACES) == 0);
+    {
+      u64 sum = 0;
+      for (u32 s = 0; s < MemoryAccount::SUBSYSTEM_COUNT; ++s)
+      {
+        sum += before.GetBytes(s);
+      }
+      assert(sum == before.GetTotalBytes());
+    }
+
+    // Sparse event indexes are allocated when asked for
+    grid.SetSparseEvents(true);
+    {
+      MemoryAccount sparse;
+      grid.AccountMemory(sparse);
+      assert(sparse.GetBytes(MemoryAccount::TILE_INDEXES) >
+             before.GetBytes(MemoryAccount::TILE_INDEXES));
+      assert(sparse.GetBytes(MemoryAccount::SITES) == before.GetBytes(MemoryAccount::SITES));
+    }
+
+    // Event history storage shows up once events are recorded
+    TestAtom atom(Element_Res<TestEventConfig>::THE_INSTANCE.GetDefaultAtom());
+    for (s32 x = 0; x < 10; ++x)
+    {
+      grid.PlaceAtom(atom, SPoint(x + 6, 6));
+    }
+    grid.InitThreads();
+    grid.Unpause();
+    SleepMsec(50);
+    grid.Pause();
+    grid.ShutdownTileThreads();
+    assert(grid.GetTotalEventsExecuted() > 0);
+
+    MemoryAccount after;
+    grid.AccountMemory(after);
+    assert(after.GetBytes(MemoryAccount::EVENT_HISTORY) >
+           before.GetBytes(MemoryAccount::EVENT_HISTORY));
+
+    grid.ReleaseEventHistory();
+    MemoryAccount released;
+    grid.AccountMemory(released);
+    assert(released.GetBytes(MemoryAccount::EVENT_HISTORY) ==
+           before.GetBytes(MemoryAccount::EVENT_HISTORY));
+
+    MemoryAccount total;
+    total.Add(before);
+    total.Add(after);
+    assert(total.GetTotalBytes() == before.GetTotalBytes() + after.GetTotalBytes());
+  }
+
+  void Grid_Test::Test_gridParallelInit()
+  {
+    ElementRegistry<TestEventConfig> ereg;
+    TestGrid serial(ereg,4,3, (GridLayoutPattern) GRID_LAYOUT_CHECKERBOARD);
+    TestGrid parallel(ereg,4,3, (GridLayoutPattern) GRID_LAYOUT_CHECKERBOARD);
+
+    serial.SetSeed(7);
+    serial.SetInitThreads(1);
+    serial.Init();
+
+    parallel.SetSeed(7);
+    parallel.SetInitThreads(4);
+    assert(parallel.GetInitThreads() == 4);
+    parallel.Init();
+
+    // Each tile's initialization draws only on its own generator, so
+    // the order the threads got to them in doesn't show
+    for (u32 x = 0; x < 4; ++x)
+    {
+      for (u32 y = 0; y < 3; ++y)
+      {
+        Tile<TestEventConfig> & st = serial.GetTile(x, y);
+        Tile<TestEventConfig> & pt = parallel.GetTile(x, y);
+        OString16 label;
+        label.Printf("[%d,%d]", x, y);
+        assert(!strcmp(pt.GetLabel(), label.GetZString()));
+        assert(pt.GetRandom().Create() == st.GetRandom().Create());
+      }
+    }
+
+    // And the tiles are connected as before
+    TestAtom atom(Element_Res<TestEventConfig>::THE_INSTANCE.GetDefaultAtom());
+    parallel.Needed(Element_Res<TestEventConfig>::THE_INSTANCE);
+    parallel.PlaceAtom(atom, SPoint(30, 20));
+    assert(parallel.GetAtomCount(Element_Res<TestEventConfig>::THE_INSTANCE.GetType()) == 1);
+  }
+
+  void Grid_Test::Test_gridEventBatches()
+  {
+    ElementRegistry<TestEventConfig> ereg;
+    TestGrid grid(ereg,2,2, (GridLayoutPattern) GRID_LAYOUT_CHECKERBOARD);
+
+    grid.SetSeed(1);
+    grid.SetEventBatchSize(EventWindowBatch<TestEventConfig>::MAX_EVENTS);
+    grid.Init();
+    grid.Needed(Element_Res<TestEventConfig>::THE_INSTANCE);
+    grid.Needed(Element_Wall<TestEventConfig>::THE_INSTANCE);
+
+    // Batchable elements everywhere, so batches form
+    TestAtom res(Element_Res<TestEventConfig>::THE_INSTANCE.GetDefaultAtom());
+    TestAtom wall(Element_Wall<TestEventConfig>::THE_INSTANCE.GetDefaultAtom());
+    u32 resCount = 0, wallCount = 0;
+    for (u32 x = 0; x < grid.GetWidthSites(); x += 3)
+    {
+      for (u32 y = 0; y < grid.GetHeightSites(); y += 3)
+      {
+        const bool isWall = (x + y) % 2 == 0;
+        grid.PlaceAtom(isWall ? wall : res, SPoint(x, y));
+        ++(isWall ? wallCount : resCount);
+      }
+    }
+
+    grid.InitThreads();
+    SleepMsec(10);  // Let the tile threads go passive
+
+    grid.Unpause();
+    SleepMsec(50);
+    grid.Pause();
+    assert(grid.GetTotalEventsExecuted() > 0);
+
+    // Res moved around but, like Wall, was neither made nor lost
+    for (TestGrid::iterator_type i = grid.begin(); i != grid.end(); ++i)
+    {
+      i->NeedAtomRecount();
+    }
+    assert(grid.GetAtomCount(Element_Res<TestEventConfig>::THE_INSTANCE.GetType()) == resCount);
+    assert(grid.GetAtomCount(Element_Wall<TestEventConfig>::THE_INSTANCE.GetType()) == wallCount);
+
+    grid.ShutdownTileThreads();
+  }
+
+  void Grid_Test::Test_gridEventWorkers()
+  {
+    ElementRegistry<TestEventConfig> ereg;
+    TestGrid grid(ereg,2,2, (GridLayoutPattern) GRID_LAYOUT_CHECKERBOARD);
+
+    grid.SetSeed(1);
+    grid.Init();
+    grid.SetEventWorkers(4);
+    grid.Needed(Element_Res<TestEventConfig>::THE_INSTANCE);
+    grid.Needed(Element_Wall<TestEventConfig>::THE_INSTANCE);
+
+    TestAtom res(Element_Res<TestEventConfig>::THE_INSTANCE.GetDefaultAtom());
+    TestAtom wall(Element_Wall<TestEventConfig>::THE_INSTANCE.GetDefaultAtom());
+    u32 resCount = 0, wallCount = 0;
+    for (u32 x = 0; x < grid.GetWidthSites(); x += 3)
+    {
+      for (u32 y = 0; y < grid.GetHeightSites(); y += 3)
+      {
+        const bool isWall = (x + y) % 2 == 0;
+        grid.PlaceAtom(isWall ? wall : res, SPoint(x, y));
+        ++(isWall ? wallCount : resCount);
+      }
+    }
+
+    grid.InitThreads();
+    SleepMsec(10);  // Let the tile threads go passive
+
+    grid.Unpause();
+    SleepMsec(100);
+    grid.Pause();
+
+    u64 helperEvents = 0;
+    for (TestGrid::iterator_type i = grid.begin(); i != grid.end(); ++i)
+    {
+      assert(i->GetEventWorkers() == 4);
+      helperEvents += i->GetHelperEvents();
+      i->NeedAtomRecount();
+    }
+    assert(helperEvents > 0);
+    assert(grid.GetTotalEventsExecuted() > helperEvents);  // The edges ran too
+
+    // Overlapping windows would have made or lost atoms
+    assert(grid.GetAtomCount(Element_Res<TestEventConfig>::THE_INSTANCE.GetType()) == resCount);
+    assert(grid.GetAtomCount(Element_Wall<TestEventConfig>::THE_INSTANCE.GetType()) == wallCount);
+
+    grid.ShutdownTileThreads();
+  }
+
+  void Grid_Test::Test_gridOptimisticEvents()
+  {
+    ElementRegistry<TestEventConfig> ereg;
+    TestGrid grid(ereg,2,2, (GridLayoutPattern) GRID_LAYOUT_CHECKERBOARD);
+
+    grid.SetSeed(1);
+    grid.Init();
+    grid.SetOptimisticEvents(true);
+    grid.Needed(Element_Res<TestEventConfig>::THE_INSTANCE);
+
+    // Diffusing Res everywhere, so every link is busy
+    TestAtom atom(Element_Res<TestEventConfig>::THE_INSTANCE.GetDefaultAtom());
+    u32 resCount = 0;
+    for (u32 y = 1; y < grid.GetHeightSites(); y += 3)
+    {
+      for (u32 x = 1; x < grid.GetWidthSites(); x += 3)
+      {
+        grid.PlaceAtom(atom, SPoint(x, y));
+        ++resCount;
+      }
+    }
+
+    grid.InitThreads();
+    SleepMsec(10);  // Let the tile threads go passive
+
+    grid.Unpause();
+    SleepMsec(200);
+    grid.Pause();
+
+    u64 commits = 0;
+    for (TestGrid::iterator_type i = grid.begin(); i != grid.end(); ++i)
+    {
+      assert(i->IsOptimisticEvents());
+      commits += i->GetOptimisticCommits();
+      i->NeedAtomRecount();
+    }
+    assert(commits > 0);
+
+    // A stale commit would have shown up as a cache mismatch, or a
+    // made or lost atom
+    for (u32 d = Dirs::NORTH; d <= Dirs::NORTHWEST; ++d)
+    {
+      u64 atoms, bytes, clean, failed;
+      grid.GetCacheCheckCounts((Dir) d, atoms, bytes, clean, failed);
+      assert(failed == 0);
+    }
+    assert(grid.GetAtomCount(Element_Res<TestEventConfig>::THE_INSTANCE.GetType()) == resCount);
+
+    grid.ShutdownTileThreads();
+  }
+
+  void Grid_Test::Test_gridSnapshot()
+  {
+    ElementRegistry<TestEventConfig> ereg;
+    TestGrid grid(ereg,2,2, (GridLayoutPattern) GRID_LAYOUT_CHECKERBOARD);
+
+    grid.SetSeed(1);
+    grid.Init();
+    grid.Needed(Element_Res<TestEventConfig>::THE_INSTANCE);
+
+    TestAtom atom(Element_Res<TestEventConfig>::THE_INSTANCE.GetDefaultAtom());
+    for (u32 i = 0; i < 7; ++i)
+    {
+      grid.PlaceAtom(atom, SPoint(3 + 9 * i, 5 + 7 * i));
+    }
+    grid.GetTile(SPoint(1,0)).GetEventWindow().SetEventWindowsExecuted(1234);
+
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/mfm-grid-snapshot-%d.mfb", (int) getpid());
+    assert(GridSnapshot<TestGridConfig>::Save(grid, path));
+
+    TestGrid copy(ereg,2,2, (GridLayoutPattern) GRID_LAYOUT_CHECKERBOARD);
+    copy.SetSeed(2);
+    copy.Init();
+    copy.Needed(Element_Res<TestEventConfig>::THE_INSTANCE);
+    assert(GridSnapshot<TestGridConfig>::Load(copy, path));
+
+    for (u32 y = 0; y < grid.GetHeightSites(); ++y)
+    {
+      for (u32 x = 0; x < grid.GetWidthSites(); ++x)
+      {
+        SPoint site(x, y);
+        assert(copy.GetAtom(site)->GetBits() == grid.GetAtom(site)->GetBits());
+      }
+    }
+    assert(copy.GetTile(SPoint(1,0)).GetEventWindow().GetEventWindowsExecuted() == 1234);
+    assert(copy.GetAtomCount(Element_Res<TestEventConfig>::THE_INSTANCE.GetType()) == 7);
+
+    // A grid of another shape refuses the snapshot and is left alone
+    TestGrid other(ereg,1,2, (GridLayoutPattern) GRID_LAYOUT_CHECKERBOARD);
+    other.SetSeed(3);
+    other.Init();
+    assert(!GridSnapshot<TestGridConfig>::Load(other, path));
+
+    // So does a snapshot missing a tile, or holding one twice
+    FILE * file = fopen(path, "rb");
+    assert(file);
+    fseek(file, 0, SEEK_END);
+    const u32 imageBytes = (u32) ftell(file);
+    fseek(file, 0, SEEK_SET);
+    u8 * image = new u8[imageBytes];
+    const u32 readBytes = fread(image, 1, imageBytes, file);
+    fclose(file);
+    assert(readBytes == imageBytes);
+
+    const TestTile & tile = grid.GetGridTile(SPoint(0,0));
+    const u32 recordBytes = 24 + 2 * tile.TILE_WIDTH * tile.TILE_HEIGHT * sizeof(TestAtom);
+    const u32 lastRecord = imageBytes - recordBytes;
+    const u32 tileCountAt = 8 * sizeof(u32);  // In the file header
+    u32 tileCount;
+    memcpy(&tileCount, image + tileCountAt, sizeof(tileCount));
+    assert(tileCount == 4);
+
+    char damagedPath[64];
+    snprintf(damagedPath, sizeof(damagedPath), "/tmp/mfm-grid-snapshot-%d-damaged.mfb", (int) getpid());
+
+    --tileCount;
+    memcpy(image + tileCountAt, &tileCount, sizeof(tileCount));
+    file = fopen(damagedPath, "wb");
+    assert(file);
+    u32 wroteBytes = fwrite(image, 1, lastRecord, file);
+    fclose(file);
+    assert(wroteBytes == lastRecord);
+    assert(!GridSnapshot<TestGridConfig>::Load(copy, damagedPath));
+
+    ++tileCount;
+    memcpy(image + tileCountAt, &tileCount, sizeof(tileCount));
+    memcpy(image + lastRecord, image + lastRecord - recordBytes, 2 * sizeof(u32));
+    file = fopen(damagedPath, "wb");
+    assert(file);
+    wroteBytes = fwrite(image, 1, imageBytes, file);
+    fclose(file);
+    assert(wroteBytes == imageBytes);
+    assert(!GridSnapshot<TestGridConfig>::Load(copy, damagedPath));
+    assert(copy.GetTile(SPoint(1,0)).GetEventWindow().GetEventWindowsExecuted() == 1234);
+
+    delete [] image;
+    unlink(damagedPath);
+    unlink(path);
+  }
+
+  void Grid_Test::Test_gridCheckpoint()
+  {
+    ElementRegistry<TestEventConfig> ereg;
+    TestGrid grid(ereg,2,2, (GridLayoutPattern) GRID_LAYOUT_CHECKERBOARD);
+
+    grid.SetSeed(1);
+    grid.Init();
+    grid.Needed(Element_Res<TestEventConfig>::THE_INSTANCE);
+    grid.Needed(Element_Wall<TestEventConfig>::THE_INSTANCE);
+
+    TestAtom res(Element_Res<TestEventConfig>::THE_INSTANCE.GetDefaultAtom());
+    TestAtom wall(Element_Wall<TestEventConfig>::THE_INSTANCE.GetDefaultAtom());
+    for (u32 i = 0; i < 7; ++i)
+    {
+      grid.PlaceAtom(res, SPoint(3 + 9 * i, 5 + 7 * i));
+    }
+
+    char basePath[64], delta1Path[64], delta2Path[64], delta3Path[64];
+    snprintf(basePath, sizeof(basePath), "/tmp/mfm-grid-chain-%d.mfb", (int) getpid());
+    snprintf(delta1Path, sizeof(delta1Path), "/tmp/mfm-grid-chain-%d-1.mfd", (int) getpid());
+    snprintf(delta2Path, sizeof(delta2Path), "/tmp/mfm-grid-chain-%d-2.mfd", (int) getpid());
+    snprintf(delta3Path, sizeof(delta3Path), "/tmp/mfm-grid-chain-%d-3.mfd", (int) getpid());
+
+    GridCheckpoint<TestGridConfig> checkpoint;
+    assert(!checkpoint.HasChain());
+    assert(checkpoint.SaveBase(grid, basePath));
+    assert(checkpoint.HasChain());
+
+    // Nothing changed: only event counts go out
+    assert(checkpoint.SaveDelta(grid, delta1Path));
+    assert(checkpoint.GetLastBlocksSaved() == 0);
+
+    // One owned site changed: its block, and maybe a neighbor's cache copy
+    grid.PlaceAtom(wall, SPoint(20, 20));
+    grid.GetTile(SPoint(1,1)).GetEventWindow().SetEventWindowsExecuted(4321);
+    assert(checkpoint.SaveDelta(grid, delta2Path));
+    assert(checkpoint.GetLastBlocksSaved() >= 1);
+    assert(checkpoint.GetLastBlocksSaved() <= 4);
+    assert(checkpoint.GetLastBlocksSaved() < checkpoint.GetBlockCount());
+    assert(checkpoint.GetChainLength() == 2);
+
+    TestGrid copy(ereg,2,2, (GridLayoutPattern) GRID_LAYOUT_CHECKERBOARD);
+    copy.SetSeed(2);
+    copy.Init();
+    copy.Needed(Element_Res<TestEventConfig>::THE_INSTANCE);
+    copy.Needed(Element_Wall<TestEventConfig>::THE_INSTANCE);
+
+    GridCheckpoint<TestGridConfig> restorer;
+    assert(restorer.Restore(copy, delta2Path));
+    assert(restorer.GetChainLength() == 2);
+    for (u32 y = 0; y < grid.GetHeightSites(); ++y)
+    {
+      for (u32 x = 0; x < grid.GetWidthSites(); ++x)
+      {
+        SPoint site(x, y);
+        assert(copy.GetAtom(site)->GetBits() == grid.GetAtom(site)->GetBits());
+      }
+    }
+    assert(copy.GetTile(SPoint(1,1)).GetEventWindow().GetEventWindowsExecuted() == 4321);
+    assert(copy.GetAtomCount(Element_Wall<TestEventConfig>::THE_INSTANCE.GetType()) == 1);
+    assert(copy.GetAtomCount(Element_Res<TestEventConfig>::THE_INSTANCE.GetType()) == 7);
+
+    // The restored chain carries on
+    copy.PlaceAtom(wall, SPoint(2, 2));
+    assert(restorer.SaveDelta(copy, delta3Path));
+    assert(restorer.GetChainLength() == 3);
+    assert(restorer.Restore(grid, delta3Path));
+    assert(grid.GetAtomCount(Element_Wall<TestEventConfig>::THE_INSTANCE.GetType()) == 2);
+
+    // A broken chain refuses to restore
+    unlink(basePath);
+    assert(!restorer.Restore(copy, delta2Path));
+    assert(!restorer.HasChain());
+
+    unlink(delta1Path);
+    unlink(delta2Path);
+    unlink(delta3Path);
+  }
+
+  void Grid_Test::Test_gridDiff()
+  {
+    typedef GridDiff<TestGridConfig>::TileReport TileReport;
+    ElementRegistry<TestEventConfig> ereg;
+    TestGrid grid(ereg,2,2, (GridLayoutPattern) GRID_LAYOUT_CHECKERBOARD);
+
+    grid.SetSeed(1);
+    grid.Init();
+    grid.Needed(Element_Res<TestEventConfig>::THE_INSTANCE);
+    grid.Needed(Element_Wall<TestEventConfig>::THE_INSTANCE);
+    const u32 RES = Element_Res<TestEventConfig>::THE_INSTANCE.GetType();
+    const u32 WALL = Element_Wall<TestEventConfig>::THE_INSTANCE.GetType();
+    const u32 EMPTY = Element_Empty<TestEventConfig>::THE_INSTANCE.GetType();
+
+    const TestAtom res(Element_Res<TestEventConfig>::THE_INSTANCE.GetDefaultAtom());
+    const TestAtom wall(Element_Wall<TestEventConfig>::THE_INSTANCE.GetDefaultAtom());
+    for (u32 i = 0; i < 7; ++i)
+    {
+      grid.PlaceAtom(res, SPoint(3 + 9 * i, 5 + 7 * i));
+    }
+
+    GridDiff<TestGridConfig> diff;
+    diff.Capture(grid, 2);
+
+    // No change, no differences, and the hashes agree
+    assert(diff.Compare(grid, 2) == 0);
+    const TileReport & same = diff.GetTileReport(SPoint(0, 0));
+    assert(same.m_hashBefore == same.m_hashAfter);
+    assert(diff.GetTypeDelta(RES) == 0);
+
+    // One Res turned to Wall, and one new Wall
+    grid.PlaceAtom(wall, SPoint(3, 5));
+    grid.PlaceAtom(wall, SPoint(4, 4));
+    assert(diff.Compare(grid, 0) == 2);
+    assert(diff.GetTypeDelta(RES) == -1);
+    assert(diff.GetTypeDelta(WALL) == 2);
+    assert(diff.GetTypeDelta(EMPTY) == -1);
+
+    const TileReport & changed = diff.GetTileReport(SPoint(0, 0));
+    assert(changed.m_differing == 2);
+    assert(changed.m_hashBefore != changed.m_hashAfter);
+    assert(changed.m_firstSite.Equals(SPoint(4, 4)));
+
+    OString4096 report;
+    diff.Print(grid, report, 10);
+    assert(strstr(report.GetZString(), "2 differing sites"));
+    assert(strstr(report.GetZString(), "site (3,5) "));
+
+    // Putting things back undoes the differences
+    grid.PlaceAtom(res, SPoint(3, 5));
+    grid.PlaceAtom(Element_Empty<TestEventConfig>::THE_INSTANCE.GetDefaultAtom(), SPoint(4, 4));
+    assert(diff.Compare(grid, 1) == 0);
+  }
+
+  /** Res sprinkled over an otherwise empty grid, for Test_gridEnsemble */
+  struct TestResEnsemble : public GridEnsemble<TestGridConfig>
+  {
+    TestResEnsemble(ElementRegistry<TestEventConfig> & ereg)
+      : GridEnsemble<TestGridConfig>(ereg, 2, 2, (GridLayoutPattern) GRID_LAYOUT_CHECKERBOARD)
+    { }
+
+    virtual void SetUpGrid(Grid<TestGridConfig> & grid)
+    {
+      grid.Needed(Element_Res<TestEventConfig>::THE_INSTANCE);
+      const TestAtom res(Element_Res<TestEventConfig>::THE_INSTANCE.GetDefaultAtom());
+      const u32 gw = grid.GetWidth() * TestGrid::OWNED_WIDTH;
+      const u32 gh = grid.GetHeight() * TestGrid::OWNED_HEIGHT;
+      for (u32 i = 0; i < 20; ++i)
+      {
+        grid.PlaceAtom(res, SPoint((7 * i) % gw, (5 * i) % gh));
+      }
+    }
+  };
+
+  void Grid_Test::Test_gridEnsemble()
+  {
+    typedef GridEnsemble<TestGridConfig>::Run Run;
+    ElementRegistry<TestEventConfig> ereg;
+    TestResEnsemble ensemble(ereg);
+    ensemble.SetEventsPerStep(100);
+
+    assert(ensemble.AddRun(1, 3, 0));
+    assert(ensemble.AddRun(2, 3, 0));
+    assert(ensemble.AddRun(1, 3, ""));
+    assert(ensemble.AddRun(1, 0, 0));
+    assert(ensemble.AddRun(1, 3, "/nonexistent/ensemble.mfb"));
+
+    OString4096 results;
+    assert(ensemble.RunAll(2, &results) == 1);
+
+    // Same seed, same run, whichever thread it landed on
+    const Run & first = ensemble.GetRun(0);
+    const u32 tileSites = TestGrid::OWNED_WIDTH * TestGrid::OWNED_HEIGHT;
+    assert(first.m_ok && first.m_done);
+    assert(first.m_steps == (3 * tileSites + 99) / 100);
+    assert(first.m_events > 0);
+    assert(first.m_atoms == 20);
+    assert(ensemble.GetRun(2).m_hash == first.m_hash);
+    assert(ensemble.GetRun(2).m_events == first.m_events);
+
+    // While other seeds, and no steps at all, end up elsewhere
+    assert(ensemble.GetRun(1).m_ok);
+    assert(ensemble.GetRun(1).m_hash != first.m_hash);
+    assert(ensemble.GetRun(3).m_ok);
+    assert(ensemble.GetRun(3).m_steps == 0);
+    assert(ensemble.GetRun(3).m_hash != first.m_hash);
+
+    // A missing configuration fails just its own run
+    assert(!ensemble.GetRun(4).m_ok);
+    assert(strstr(results.GetZString(), "run 0 seed 1 aeps 3 ok "));
+    assert(strstr(results.GetZString(), "run 4 seed 1 aeps 3 FAILED "));
+
+    // Runs can be read from a file, and only the new ones get run
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/mfm-ensemble-%d.txt", (s32) getpid());
+    FILE * fp = fopen(path, "w");
+    assert(fp);
+    fprintf(fp, "# seed aeps config\n7 2\n\n   8 1 # trailing\n");
+    fclose(fp);
+    assert(ensemble.ReadRuns(path));
+    assert(ensemble.GetRunCount() == 7);
+    assert(ensemble.GetRun(5).m_seed == 7 && ensemble.GetRun(5).m_aeps == 2);
+    assert(ensemble.GetRun(6).m_seed == 8 && ensemble.GetRun(6).m_configPath.GetLength() == 0);
+
+    results.Reset();
+    assert(ensemble.RunAll(0, &results) == 0);
+    assert(ensemble.GetRun(6).m_ok);
+    assert(!strstr(results.GetZString(), "run 0 "));
+    assert(strstr(results.GetZString(), "run 5 seed 7 aeps 2 ok "));
+
+    // Seed 0 isn't a seed
+    fp = fopen(path, "w");
+    assert(fp);
+    fprintf(fp, "0 5\n");
+    fclose(fp);
+    assert(!ensemble.ReadRuns(path));
+    unlink(path);
+  }
+
+  void Grid_Test::Test_gridReseed()
+  {
+    ElementRegistry<TestEventConfig> ereg;
+    TestGrid reseeded(ereg,2,2, (GridLayoutPattern) GRID_LAYOUT_CHECKERBOARD);
+    TestGrid seeded(ereg,2,2, (GridLayoutPattern) GRID_LAYOUT_CHECKERBOARD);
+
+    reseeded.SetSeed(1);
+    reseeded.Init();
+    seeded.SetSeed(2);
+    seeded.Init();
+    assert(reseeded.GetTile(0, 0).GetRandom().Create() !=
+           seeded.GetTile(0, 0).GetRandom().Create());
+
+    // Reseeded alike, Init'ed grids' tiles draw alike
+    reseeded.Reseed(5);
+    seeded.Reseed(5);
+    assert(reseeded.GetSeed() == 5);
+    for (u32 y = 0; y < 2; ++y)
+    {
+      for (u32 x = 0; x < 2; ++x)
+      {
+        assert(reseeded.GetTile(x, y).GetRandom().Create() ==
+               seeded.GetTile(x, y).GetRandom().Create());
+      }
+    }
+  }
+
+  void Grid_Test::Test_gridSnapshotAsync()
+  {
+    ElementRegistry<TestEventConfig> ereg;
+    TestGrid grid(ereg,2,2, (GridLayoutPattern) GRID_LAYOUT_CHECKERBOARD);
+
+    grid.SetSeed(1);
+    grid.Init();
+    grid.Needed(Element_Res<TestEventConfig>::THE_INSTANCE);
+
+    TestAtom atom(Element_Res<TestEventConfig>::THE_INSTANCE.GetDefaultAtom());
+    for (u32 i = 0; i < 5; ++i)
+    {
+      grid.PlaceAtom(atom, SPoint(4 + 10 * i, 30));
+    }
+
+    char syncPath[64], asyncPath[64];
+    snprintf(syncPath, sizeof(syncPath), "/tmp/mfm-grid-snapshot-%d-sync.mfb", (int) getpid());
+    snprintf(asyncPath, sizeof(asyncPath), "/tmp/mfm-grid-snapshot-%d-async.mfb", (int) getpid());
+    assert(GridSnapshot<TestGridConfig>::Save(grid, syncPath));
+
+    GridSnapshotWriter writer;
+    u32 bytes;
+    assert(GridSnapshot<TestGridConfig>::Capture(grid, writer, bytes));
+    writer.StartWrite(asyncPath, bytes);
+
+    // The grid is free to change once captured
+    grid.PlaceAtom(atom, SPoint(20, 20));
+    assert(writer.Finish());
+
+    // The background write is byte-for-byte a synchronous save
+    {
+      FILE * fs = fopen(syncPath, "r");
+      FILE * fa = fopen(asyncPath, "r");
+      assert(fs && fa);
+      s32 cs, ca;
+      u32 len = 0;
+      do
+      {
+        cs = fgetc(fs);
+        ca = fgetc(fa);
+        assert(cs == ca);
+        ++len;
+      } while (cs != EOF);
+      assert(len == bytes + 1);
+      fclose(fs);
+      fclose(fa);
+    }
+
+    TestGrid copy(ereg,2,2, (GridLayoutPattern) GRID_LAYOUT_CHECKERBOARD);
+    copy.SetSeed(2);
+    copy.Init();
+    copy.Needed(Element_Res<TestEventConfig>::THE_INSTANCE);
+    assert(GridSnapshot<TestGridConfig>::Load(copy, asyncPath));
+    assert(copy.GetAtomCount(Element_Res<TestEventConfig>::THE_INSTANCE.GetType()) == 5);
+
+    unlink(syncPath);
+    unlink(asyncPath);
+  }
+
+  void Grid_Test::Test_gridSnapshotCompressed()
+  {
+    ElementRegistry<TestEventConfig> ereg;
+    TestGrid grid(ereg,2,2, (GridLayoutPattern) GRID_LAYOUT_CHECKERBOARD);
+
+    grid.SetSeed(1);
+    grid.Init();
+    grid.Needed(Element_Res<TestEventConfig>::THE_INSTANCE);
+    const u32 resType = Element_Res<TestEventConfig>::THE_INSTANCE.GetType();
+
+    TestAtom atom(Element_Res<TestEventConfig>::THE_INSTANCE.GetDefaultAtom());
+    for (u32 i = 0; i < 5; ++i)
+    {
+      grid.PlaceAtom(atom, SPoint(4 + 10 * i, 30));
+    }
+
+    char rawPath[64], packedPath[64];
+    snprintf(rawPath, sizeof(rawPath), "/tmp/mfm-grid-snapshot-%d.mfb", (int) getpid());
+    snprintf(packedPath, sizeof(packedPath), "/tmp/mfm-grid-snapshot-%d.mfz", (int) getpid());
+    assert(GridSnapshot<TestGridConfig>::Save(grid, rawPath));
+
+    GridSnapshotWriter writer;
+    assert(GridSnapshot<TestGridConfig>::StartCompressedSave(grid, writer, packedPath));
+    grid.PlaceAtom(atom, SPoint(20, 20));  // Free to change once captured
+    assert(writer.Finish());
+
+    // A mostly empty grid shrinks a lot
+    FILE * fp = fopen(rawPath, "r");
+    assert(fp);
+    fseek(fp, 0, SEEK_END);
+    const u64 rawBytes = (u64) ftell(fp);
+    fclose(fp);
+    assert(writer.GetLastRawBytes() == rawBytes);
+    assert(writer.GetLastFileBytes() < rawBytes / 4);
+
+    TestGrid copy(ereg,2,2, (GridLayoutPattern) GRID_LAYOUT_CHECKERBOARD);
+    copy.SetSeed(2);
+    copy.Init();
+    copy.Needed(Element_Res<TestEventConfig>::THE_INSTANCE);
+    assert(GridSnapshot<TestGridConfig>::Load(copy, packedPath));
+    assert(copy.GetAtomCount(resType) == 5);
+    for (u32 i = 0; i < 5; ++i)
+    {
+      SPoint at(4 + 10 * i, 30);
+      assert(copy.GetAtom(at)->GetType() == resType);
+    }
+
+    // Restoring one tile restores just its atoms, from either format
+    SPoint first(4, 30), tileInGrid, siteInTile;
+    assert(grid.MapGridToUncachedTile(first, tileInGrid, siteInTile));
+    const char * paths[2] = { rawPath, packedPath };
+    for (u32 p = 0; p < 2; ++p)
+    {
+      TestGrid one(ereg,2,2, (GridLayoutPattern) GRID_LAYOUT_CHECKERBOARD);
+      one.SetSeed(3);
+      one.Init();
+      one.Needed(Element_Res<TestEventConfig>::THE_INSTANCE);
+      assert(GridSnapshot<TestGridConfig>::LoadTile(one, paths[p], tileInGrid));
+      assert(one.GetAtom(first)->GetType() == resType);
+      assert(one.GetAtomCount(resType) > 0);
+      assert(one.GetAtomCount(resType) < 5);
+    }
+
+    // A damaged block is caught before the grid is touched
+    const s32 truncated = truncate(packedPath, writer.GetLastFileBytes() - 8);
+    assert(truncated == 0);
+    TestGrid damaged(ereg,2,2, (GridLayoutPattern) GRID_LAYOUT_CHECKERBOARD);
+    damaged.SetSeed(4);
+    damaged.Init();
+    damaged.Needed(Element_Res<TestEventConfig>::THE_INSTANCE);
+    damaged.PlaceAtom(atom, SPoint(20, 20));
+    assert(!GridSnapshot<TestGridConfig>::Load(damaged, packedPath));
+    assert(damaged.GetAtomCount(resType) == 1);
+
+    unlink(rawPath);
+    unlink(packedPath);
+  }
+  void Grid_Test::Test_gridEventBins()
+  {
+    ElementRegistry<TestEventConfig> ereg;
+    TestGrid grid(ereg,2,2, (GridLayoutPattern) GRID_LAYOUT_CHECKERBOARD);
+
+    grid.SetSeed(1);
+    grid.Init();
+    grid.Needed(Element_Res<TestEventConfig>::THE_INSTANCE);
+
+    TestAtom atom(Element_Res<TestEventConfig>::THE_INSTANCE.GetDefaultAtom());
+    for (u32 i = 0; i < 5; ++i)
+    {
+      grid.PlaceAtom(atom, SPoint(4 + 10 * i, 30));
+    }
+
+    grid.InitThreads();
+    SleepMsec(10);  // Let the tile threads go passive
+
+    grid.Unpause();
+    SleepMsec(50);
+    grid.Pause();
+
+    // The bins account for every event recorded at a site
+    u64 siteEvents = 0;
+    for (u32 y = 0; y < grid.GetHeightSites(); ++y)
+    {
+      for (u32 x = 0; x < grid.GetWidthSites(); ++x)
+      {
+        SPoint siteInGrid(x, y), tileInGrid, siteInTile;
+        assert(grid.MapGridToUncachedTile(siteInGrid, tileInGrid, siteInTile));
+        siteEvents += grid.GetTile(tileInGrid).GetUncachedSiteEvents(siteInTile);
+      }
+    }
+    u64 binEvents = 0;
+    const u32 binsWide = grid.GetEventBinsWide();
+    const u32 binsHigh = grid.GetEventBinsHigh();
+    for (u32 y = 0; y < binsHigh; ++y)
+    {
+      for (u32 x = 0; x < binsWide; ++x)
+      {
+        binEvents += grid.GetEventBinEvents(x, y);
+      }
+    }
+    assert(siteEvents > 0);
+    assert(binEvents == siteEvents);
+
+    // A record is a 10 byte header and a BEU32 per bin
+    OString4096 record;
+    grid.WriteEventBinsRecord(record, 77);
+    assert(record.GetLength() == 10 + 4 * binsWide * binsHigh);
+    const u8 * bytes = (const u8 *) record.GetZString();
+    assert(bytes[3] == 77 && bytes[5] == binsWide && bytes[7] == binsHigh);
+    assert(bytes[9] == Tile<TestEventConfig>::EVENT_BIN_SIDE);
+
+    grid.ResetEPSCounts();
+    for (u32 y = 0; y < binsHigh; ++y)
+    {
+      for (u32 x = 0; x < binsWide; ++x)
+      {
+        assert(grid.GetEventBinEvents(x, y) == 0);
+      }
+    }
+
+    grid.ShutdownTileThreads();
+  }
+
+  void Grid_Test::Test_gridTileJobs()
+  {
+    for (u32 pooled = 0; pooled < 2; ++pooled)
+    {
+      ElementRegistry<TestEventConfig> ereg;
+      TestGrid grid(ereg,4,3, (GridLayoutPattern) GRID_LAYOUT_CHECKERBOARD);
+
+      grid.SetSeed(1);
+      grid.SetTilePool(pooled, 2);
+      grid.Init();
+      grid.Needed(Element_Res<TestEventConfig>::THE_INSTANCE);
+      const ElementType resType = Element_Res<TestEventConfig>::THE_INSTANCE.GetType();
+      TestAtom atom(Element_Res<TestEventConfig>::THE_INSTANCE.GetDefaultAtom());
+
+      grid.InitThreads();
+      SleepMsec(10);  // Let the tile threads go passive
+
+      // Put a Res on the east edge of tile (0,0) without touching the
+      // cache of tile (1,0), and let the tile threads refresh it
+      const u32 R = TestTile::EVENT_WINDOW_RADIUS;
+      const u32 OW = TestGrid::OWNED_WIDTH;
+      const SPoint owned(R + OW - 1, R + 5);
+      const SPoint cached(R - 1, R + 5);
+      grid.GetTile(SPoint(0,0)).PlaceAtom(atom, owned);
+      assert(grid.GetTile(SPoint(1,0)).GetAtom(cached)->GetType() != resType);
+      grid.RefreshAllCaches();
+      assert(grid.GetTile(SPoint(1,0)).GetAtom(cached)->GetType() == resType);
+      grid.CheckCaches();
+
+      for (u32 i = 0; i < 20; ++i)
+      {
+        grid.PlaceAtom(atom, SPoint(6 * i + 3, 4 * i + 2));
+      }
+      grid.RecountAtoms();
+      assert(grid.GetAtomCount(resType) == 21);
+
+      grid.Clear();
+      grid.RecountAtoms();
+      assert(grid.GetAtomCount(resType) == 0);
+      assert(grid.GetTile(SPoint(1,0)).GetAtom(cached)->GetType() != resType);
+
+      // And the grid still runs afterwards
+      grid.Unpause();
+      SleepMsec(20);
+      grid.Pause();
+
+      grid.ShutdownTileThreads();
+    }
+  }
+
+  /**
+     Seed a grid with Res, run it for some deterministic steps on
+     \c threads (0: the calling thread; else a tile pool of that
+     many), and \returns a hash of where everything ended up
+   */
+  template <class GC>
+  static u64 RunDeterministicGrid(u32 threads, u32 seed,
+                                  u32 tileWidth = GC::TILE_WIDTH, u32 tileHeight = GC::TILE_HEIGHT)
+  {
+    ElementRegistry<TestEventConfig> ereg;
+    Grid<GC> grid(ereg,3,2, (GridLayoutPattern) GRID_LAYOUT_CHECKERBOARD, tileWidth, tileHeight);
+
+    grid.SetSeed(seed);
+    if (threads > 0)
+      grid.SetTilePool(true, threads);
+    grid.Init();
+    grid.Needed(Element_Res<TestEventConfig>::THE_INSTANCE);
+    const ElementType resType = Element_Res<TestEventConfig>::THE_INSTANCE.GetType();
+    TestAtom atom(Element_Res<TestEventConfig>::THE_INSTANCE.GetDefaultAtom());
+
+    if (threads > 0)
+    {
+      grid.InitThreads();
+      SleepMsec(10);  // Let the tile threads go passive
+    }
+
+    const u32 gw = grid.GetWidth() * grid.GetOwnedWidth();
+    const u32 gh = grid.GetHeight() * grid.GetOwnedHeight();
+    for (u32 i = 0; i < 60; ++i)
+    {
+      grid.PlaceAtom(atom, SPoint((7 * i) % gw, (5 * i) % gh));
+    }
+
+    for (u32 step = 0; step < 20; ++step)
+    {
+      grid.RunDeterministicStep(100);
+    }
+    assert(grid.GetDeterministicStep() == 20);
+    grid.CheckCaches();
+
+    u64 hash = grid.GetTotalEventsExecuted();
+    for (u32 y = 0; y < gh; ++y)
+    {
+      for (u32 x = 0; x < gw; ++x)
+      {
+        SPoint siteInGrid(x, y);
+        if (grid.IsGridCoord(siteInGrid) && grid.GetAtom(siteInGrid)->GetType() == resType)
+          hash = hash * 1000003 + y * gw + x;
+      }
+    }
+
+    if (threads > 0)
+      grid.ShutdownTileThreads();
+    return hash;
+  }
+
+  void Grid_Test::Test_gridDeterministicSteps()
+  {
+    const u64 unthreaded = RunDeterministicGrid<TestGridConfig>(0, 1);
+    assert(RunDeterministicGrid<TestGridConfig>(0, 1) == unthreaded);
+    assert(RunDeterministicGrid<TestGridConfig>(2, 1) == unthreaded);
+    assert(RunDeterministicGrid<TestGridConfig>(4, 1) == unthreaded);
+
+    // While a different seed goes its own way
+    assert(RunDeterministicGrid<TestGridConfig>(0, 2) != unthreaded);
+  }
+
+  void Grid_Test::Test_gridRuntimeTileSize()
+  {
+    typedef GridConfig<TestEventConfig,0,0,1000> RuntimeGridConfig;
+    typedef Grid<RuntimeGridConfig> RuntimeGrid;
+
+    // DynamicTiles the size of TestGrid's go exactly the same way
+    assert(RunDeterministicGrid<RuntimeGridConfig>(0, 1, 40, 40) ==
+           RunDeterministicGrid<TestGridConfig>(0, 1));
+    assert(RunDeterministicGrid<RuntimeGridConfig>(2, 1, 40, 40) ==
+           RunDeterministicGrid<TestGridConfig>(0, 1));
+
+    // And sizes no GridConfig names work too, staggered or not
+    for (u32 s = 0; s < 2; ++s)
+    {
+      ElementRegistry<TestEventConfig> ereg;
+      RuntimeGrid grid(ereg,3,3, s ? GRID_LAYOUT_STAGGERED : GRID_LAYOUT_CHECKERBOARD, 44, 36);
+      assert(grid.GetTileWidth() == 44 && grid.GetTileHeight() == 36);
+      assert(grid.GetOwnedWidth() == 36 && grid.GetOwnedHeight() == 28);
+      assert(grid.GetGridTile(SPoint(1, 1)).TILE_WIDTH == 44);
+      assert(grid.GetWidthSites() == (s ? 3 * 36 + 18 : 3 * 36) && grid.GetHeightSites() == 3 * 28);
+
+      grid.SetSeed(1);
+      grid.Init();
+      grid.Needed(Element_Res<TestEventConfig>::THE_INSTANCE);
+      TestAtom atom(Element_Res<TestEventConfig>::THE_INSTANCE.GetDefaultAtom());
+      const ElementType resType = atom.GetType();
+
+      // The last site of the middle tile row, where the stagger shows
+      SPoint last(grid.GetWidthSites() - 1, 28 + 27);
+      SPoint tileInGrid, siteInTile;
+      assert(grid.MapGridToTile(last, tileInGrid, siteInTile));
+      assert(tileInGrid == SPoint(2, 1) && siteInTile == SPoint(35 + 4, 27 + 4));
+      grid.PlaceAtom(atom, last);
+      assert(grid.GetAtom(last)->GetType() == resType);
+
+      for (u32 step = 0; step < 10; ++step)
+      {
+        grid.RunDeterministicStep(100);
+      }
+      grid.CheckCaches();
+    }
+  }
+
+  void Grid_Test::Test_gridDumpAtoms()
+  {
+    ElementRegistry<TestEventConfig> ereg;
+    TestGrid grid(ereg,2,2, (GridLayoutPattern) GRID_LAYOUT_CHECKERBOARD);
+
+    grid.SetSeed(1);
+    grid.Init();
+    grid.Needed(Element_Res<TestEventConfig>::THE_INSTANCE);
+
+    TestAtom atom(Element_Res<TestEventConfig>::THE_INSTANCE.GetDefaultAtom());
+    grid.PlaceAtom(atom, SPoint(5, 6));
+
+    // Clipped to the grid, so just the 2x2 in its corner
+    OverflowableCharBufferByteSink<2048> dump;
+    assert(grid.DumpAtoms(dump, Rect(-1, -1, 3, 3)) == 4);
+    dump.Reset();
+    assert(grid.DumpAtoms(dump, Rect(4, 6, 3, 1)) == 3);
+    assert(!dump.HasOverflowed());
+
+    OString1024 text;
+    assert(AtomDumpReader<TestEventConfig>::Print((const u8 *) dump.GetZString(), dump.GetLength(),
+                                                  text, grid.GetUlamClassRegistry(), 0));
+    const char * res = strstr(text.GetZString(), "(5,6) Res");
+    assert(res);
+    assert(strstr(text.GetZString(), "(4,6) Empty"));
+    assert(strstr(text.GetZString(), "(6,6) Empty"));
+
+    // Truncated dumps are refused
+    OString1024 none;
+    assert(!AtomDumpReader<TestEventConfig>::Print((const u8 *) dump.GetZString(), dump.GetLength() - 4,
+                                                   none, grid.GetUlamClassRegistry(), 0));
+    assert(none.GetLength() == 0);
+  }
+
+  static void CheckPlaceAtomsInRect(GridLayoutPattern layout, const Rect & rect)
+  {
+    ElementRegistry<TestEventConfig> ereg;
+    TestGrid bulk(ereg,3,3, layout);
+    TestGrid single(ereg,3,3, layout);
+    bulk.SetSeed(1);
+    single.SetSeed(1);
+    bulk.Init();
+    single.Init();
+    bulk.Needed(Element_Res<TestEventConfig>::THE_INSTANCE);
+    single.Needed(Element_Res<TestEventConfig>::THE_INSTANCE);
+
+    TestAtom atom(Element_Res<TestEventConfig>::THE_INSTANCE.GetDefaultAtom());
+    const u32 placed = bulk.PlaceAtomsInRect(false, atom, rect);
+
+    u32 expected = 0;
+    for (s32 y = rect.GetY(); y < rect.GetY() + (s32) rect.GetHeight(); ++y)
+    {
+      for (s32 x = rect.GetX(); x < rect.GetX() + (s32) rect.GetWidth(); ++x)
+      {
+        if (!single.IsGridCoord(SPoint(x, y))) continue;
+        single.PlaceAtom(atom, SPoint(x, y));
+        ++expected;
+      }
+    }
+    assert(placed == expected);
+
+    // Same atoms everywhere, caches included
+    for (u32 ty = 0; ty < bulk.GetHeight(); ++ty)
+    {
+      for (u32 tx = 0; tx < bulk.GetWidth(); ++tx)
+      {
+        const SPoint tileInGrid(tx, ty);
+        Tile<TestEventConfig> & bt = bulk.GetTile(tileInGrid);
+        Tile<TestEventConfig> & st = single.GetTile(tileInGrid);
+        if (bt.IsDummyTile()) continue;
+        for (s32 y = 0; y < TestGrid::TILE_HEIGHT; ++y)
+          for (s32 x = 0; x < TestGrid::TILE_WIDTH; ++x)
+            assert(bt.GetAtom(SPoint(x, y))->GetType() == st.GetAtom(SPoint(x, y))->GetType());
+      }
+    }
+  }
+
+  void Grid_Test::Test_gridPlaceAtomsInRect()
+  {
+    const s32 ow = TestGrid::OWNED_WIDTH;
+    const s32 oh = TestGrid::OWNED_HEIGHT;
+
+    // Across tile corners, clipped at the grid's edges
+    CheckPlaceAtomsInRect(GRID_LAYOUT_CHECKERBOARD, Rect(ow - 5, oh - 3, ow + 10, oh + 6));
+    CheckPlaceAtomsInRect(GRID_LAYOUT_CHECKERBOARD, Rect(-4, -4, 3 * ow + 8, 9));
+    CheckPlaceAtomsInRect(GRID_LAYOUT_CHECKERBOARD, Rect(5, 5, 0, 4));
+
+    // A staggered grid's odd rows start half a tile over
+    CheckPlaceAtomsInRect(GRID_LAYOUT_STAGGERED, Rect(0, oh - 4, 3 * ow + ow / 2, 8));
+    CheckPlaceAtomsInRect(GRID_LAYOUT_STAGGERED, Rect(ow / 2 - 3, 0, 2 * ow, 3 * oh));
+  }
+
+  /* Names atom types by number, as the .mfs writer does */
+  struct TestTypeFormatter : public AtomTypeFormatter<P3AtomConfig>
+  {
+    TestGrid & m_grid;
+    TestTypeFormatter(TestGrid & grid) : m_grid(grid) { }
+
+    virtual bool ParseAtomType(LineCountingByteSource & bs, TestAtom & dest)
+    {
+      u32 type;
+      if (2 != bs.Scanf("T%x", &type)) return false;
+      const Element<TestEventConfig> * elt = m_grid.LookupElement(type);
+      if (!elt) return false;
+      dest = elt->GetDefaultAtom();
+      return true;
+    }
+
+    virtual void PrintAtomType(const TestAtom & atom, ByteSink & bs)
+    {
+      bs.Printf("T%04x", atom.GetType());
+    }
+  };
+
+  void Grid_Test::Test_gridPattern()
+  {
+    ElementRegistry<TestEventConfig> ereg;
+    TestGrid grid(ereg,2,2, (GridLayoutPattern) GRID_LAYOUT_CHECKERBOARD);
+    grid.SetSeed(1);
+    grid.Init();
+    grid.Needed(Element_Res<TestEventConfig>::THE_INSTANCE);
+    grid.Needed(Element_Wall<TestEventConfig>::THE_INSTANCE);
+
+    const u32 resType = Element_Res<TestEventConfig>::THE_INSTANCE.GetType();
+    const u32 wallType = Element_Wall<TestEventConfig>::THE_INSTANCE.GetType();
+    const u32 emptyType = Element_Empty<TestEventConfig>::THE_INSTANCE.GetType();
+    TestAtom res(Element_Res<TestEventConfig>::THE_INSTANCE.GetDefaultAtom());
+    TestAtom wall(Element_Wall<TestEventConfig>::THE_INSTANCE.GetDefaultAtom());
+
+    // A 3x2 pattern: Res, Empty, Wall over Empty, Wall, Res
+    grid.PlaceAtom(res, SPoint(4, 4));
+    grid.PlaceAtom(wall, SPoint(6, 4));
+    grid.PlaceAtom(wall, SPoint(5, 5));
+    grid.PlaceAtom(res, SPoint(6, 5));
+    const u32 expect[2][3] = { { resType, emptyType, wallType },
+                               { emptyType, wallType, resType } };
+
+    GridPattern<TestGridConfig> pattern;
+    assert(pattern.Capture(grid, Rect(4, 4, 3, 2)) == 6);
+    assert(pattern.GetWidth() == 3 && pattern.GetHeight() == 2);
+
+    // Tile it over the whole grid, and compare with per-site placement
+    TestGrid stamped(ereg,2,2, (GridLayoutPattern) GRID_LAYOUT_CHECKERBOARD);
+    TestGrid single(ereg,2,2, (GridLayoutPattern) GRID_LAYOUT_CHECKERBOARD);
+    stamped.SetSeed(1);
+    single.SetSeed(1);
+    stamped.Init();
+    single.Init();
+    stamped.Needed(Element_Res<TestEventConfig>::THE_INSTANCE);
+    stamped.Needed(Element_Wall<TestEventConfig>::THE_INSTANCE);
+    single.Needed(Element_Res<TestEventConfig>::THE_INSTANCE);
+    single.Needed(Element_Wall<TestEventConfig>::THE_INSTANCE);
+    const u32 w = stamped.GetWidthSites();
+    const u32 h = stamped.GetHeightSites();
+    assert(pattern.StampTiled(stamped, Rect(0, 0, w, h)) == w * h);
+    for (u32 y = 0; y < h; ++y)
+    {
+      for (u32 x = 0; x < w; ++x)
+      {
+        SPoint site(x, y);
+        assert(stamped.GetAtom(site)->GetType() == expect[y % 2][x % 3]);
+        single.PlaceAtom(pattern.GetAtom(x % 3, y % 2), site);
+      }
+    }
+    for (u32 ty = 0; ty < 2; ++ty)
+    {
+      for (u32 tx = 0; tx < 2; ++tx)
+      {
+        Tile<TestEventConfig> & a = stamped.GetTile(SPoint(tx, ty));
+        Tile<TestEventConfig> & b = single.GetTile(SPoint(tx, ty));
+        for (s32 y = 0; y < TestGrid::TILE_HEIGHT; ++y)
+          for (s32 x = 0; x < TestGrid::TILE_WIDTH; ++x)
+            assert(a.GetAtom(SPoint(x, y))->GetType() == b.GetAtom(SPoint(x, y))->GetType());
+      }
+    }
+
+    // Off-grid parts are absent, and stamping leaves them be
+    GridPattern<TestGridConfig> corner;
+    assert(corner.Capture(grid, Rect(-2, -2, 4, 4)) == 4);
+    assert(!corner.IsPresent(1, 1) && corner.IsPresent(2, 2));
+    SPoint origin(0, 0);
+    stamped.PlaceAtom(wall, origin);
+    assert(corner.Stamp(stamped, SPoint(-1, -1)) == 4);
+    assert(stamped.GetAtom(origin)->GetType() == wallType);
+
+    // Round trip through text
+    TestTypeFormatter ttf(grid);
+    OString4096 text;
+    pattern.Save(text, ttf);
+    assert(!text.HasOverflowed());
+    CharBufferByteSource cbs(text.GetZString(), text.GetLength());
+    LineCountingByteSource in;
+    in.SetByteSource(cbs);
+    GridPattern<TestGridConfig> loaded;
+    assert(loaded.Load(in, ttf));
+    assert(loaded.GetWidth() == 3 && loaded.GetHeight() == 2 && loaded.GetPresentCount() == 6);
+    for (u32 y = 0; y < 2; ++y)
+      for (u32 x = 0; x < 3; ++x)
+        assert(loaded.GetAtom(x, y) == pattern.GetAtom(x, y));
+  }
+
+  static u32 SumTileStatsColumn(const char * csv, u32 column, u32 & lines)
+  {
+    u32 sum = 0;
+    lines = 0;
+    for (const char * p = csv; *p; ++lines)
+    {
+      for (u32 c = 0; c < column; ++c)
+      {
+        p = strchr(p, ',') + 1;
+      }
+      sum += atoi(p);
+      p = strchr(p, '\n') + 1;
+    }
+    return sum;
+  }
+
+  void Grid_Test::Test_gridTileStats()
+  {
+    ElementRegistry<TestEventConfig> ereg;
+    TestGrid grid(ereg,2,2, (GridLayoutPattern) GRID_LAYOUT_CHECKERBOARD);
+    grid.SetSeed(1);
+    grid.Init();
+    grid.Needed(Element_Res<TestEventConfig>::THE_INSTANCE);
+
+    OverflowableCharBufferByteSink<2048> header;
+    TestGrid::WriteTileStatsHeader(header);
+    assert(!strcmp(header.GetZString(),
+                   "aeps,tileX,tileY,events,advances,idleAdvances,lockFailures,lockSpinWins\n"));
+
+    TestAtom atom(Element_Res<TestEventConfig>::THE_INSTANCE.GetDefaultAtom());
+    grid.PlaceAtom(atom, SPoint(5, 6));
+    grid.RunDeterministicStep(100);
+
+    // A tile that isn't running does nothing when advanced
+    Tile<TestEventConfig> & tile = grid.GetTile(1, 0);
+    tile.Advance();
+    tile.Advance();
+    assert(tile.GetAdvanceCount() == 2);
+    assert(tile.GetIdleAdvanceCount() == 2);
+
+    OverflowableCharBufferByteSink<2048> csv;
+    grid.WriteTileStatsRecord(csv, 7);
+    assert(!csv.HasOverflowed());
+    assert(!strncmp(csv.GetZString(), "7,0,0,", 6));
+    u32 lines;
+    assert(SumTileStatsColumn(csv.GetZString(), 3, lines) == grid.GetTotalEventsExecuted());
+    assert(lines == 4);
+    assert(SumTileStatsColumn(csv.GetZString(), 4, lines) == 2);
+    assert(SumTileStatsColumn(csv.GetZString(), 5, lines) == 2);
+    assert(strstr(csv.GetZString(), "7,1,0,100,2,2,0,0\n"));
+
+    // Each record counts only what happened since the last
+    csv.Reset();
+    grid.RunDeterministicStep(10);
+    grid.WriteTileStatsRecord(csv, 8);
+    assert(SumTileStatsColumn(csv.GetZString(), 3, lines) == 40);
+    assert(SumTileStatsColumn(csv.GetZString(), 4, lines) == 0);
+
+    // Without tile threads, stats are published on request
+    const u32 resType = atom.GetType();
+    assert(grid.GetPublishedTotal(TileStatsTree::EVENTS) == 0);
+    grid.PublishAllTileStats();
+    assert(grid.GetPublishedTotal(TileStatsTree::EVENTS) == grid.GetTotalEventsExecuted());
+    assert(grid.GetPublishedTotal(TileStatsTree::ADVANCES) == 2);
+    assert(grid.GetPublishedTotal(TileStatsTree::IDLE_ADVANCES) == 2);
+    assert(grid.GetPublishedAtomCount(resType) == grid.GetAtomCount(resType));
+    assert(grid.GetPublishedAtomCount(resType) > 0);
+  }
+
+  void Grid_Test::Test_gridCoordMapping()
+  {
+    const s32 R = TestGrid::R;
+    const s32 ow = TestGrid::OWNED_WIDTH, oh = TestGrid::OWNED_HEIGHT;
+    for (u32 s = 0; s < 2; ++s)
+    {
+      const bool staggered = s != 0;
+      ElementRegistry<TestEventConfig> ereg;
+      TestGrid grid(ereg,3,3, staggered ? GRID_LAYOUT_STAGGERED : GRID_LAYOUT_CHECKERBOARD);
+      grid.SetSeed(1);
+      grid.Init();
+
+      const s32 w = grid.GetWidthSites(), h = grid.GetHeightSites();
+      SPoint row[4 * TestGrid::OWNED_WIDTH + 8], tiles[4 * TestGrid::OWNED_WIDTH + 8];
+      SPoint sites[4 * TestGrid::OWNED_WIDTH + 8];
+      for (s32 y = -2; y < h + 2; ++y)
+      {
+        TestGrid::SiteCursor cursor(grid, SPoint(-4, y));
+        u32 expected = 0;
+        for (s32 x = -4; x < w + 4; ++x, cursor.Move(1, 0))
+        {
+          // The mapping as it was, dividing it all out
+          const SPoint site(x, y);
+          const bool odd = y >= 0 && (y / oh) % 2 > 0;
+          const SPoint t = site + SPoint(staggered && odd ? -ow/2 : 0, 0);
+          const bool in = x >= 0 && y >= 0 && t.GetX() >= 0 && t.GetX() / ow < 3 && y / oh < 3
+            && !grid.GetTile(SPoint(t.GetX() / ow, y / oh)).IsDummyTile();
+
+          SPoint tileInGrid, siteInTile;
+          assert(grid.MapGridToTile(site, tileInGrid, siteInTile) == in);
+          assert(grid.IsGridCoord(site) == in);
+          assert(cursor.IsValid() == in && cursor.GetSiteInGrid() == site);
+          if (in)
+          {
+            assert(tileInGrid == SPoint(t.GetX() / ow, y / oh));
+            assert(siteInTile == SPoint(t.GetX() % ow + R, y % oh + R));
+            assert(cursor.GetTileInGrid() == tileInGrid && cursor.GetSiteInTile() == siteInTile);
+            assert(&cursor.GetTile() == &grid.GetTile(tileInGrid));
+            ++expected;
+          }
+          row[x + 4] = site;
+        }
+
+        // The batched mapping agrees, row at a time
+        assert(grid.MapGridToTiles(row, w + 8, tiles, sites) == expected);
+        for (s32 x = -4; x < w + 4; ++x)
+        {
+          SPoint tileInGrid, siteInTile;
+          if (grid.MapGridToTile(row[x + 4], tileInGrid, siteInTile))
+          {
+            assert(tiles[x + 4] == tileInGrid && sites[x + 4] == siteInTile);
+          }
+          else
+          {
+            assert(tiles[x + 4] == SPoint(-1, -1));
+          }
+        }
+      }
+
+      // Vertical steps cross tile rows, and the stagger, too
+      TestGrid::SiteCursor cursor(grid, SPoint(ow, 0));
+      for (s32 y = 0; y < h; ++y, cursor.Move(0, 1))
+      {
+        assert(cursor.IsValid() == grid.IsGridCoord(SPoint(ow, y)));
+        if (cursor.IsValid())
+        {
+          SPoint at(ow, y);
+          assert(cursor.GetAtom() == grid.GetAtom(at));
+        }
+      }
+    }
+  }
+
+  void Grid_Test::Test_gridSortingWork()
+  {
+    ElementRegistry<TestEventConfig> ereg;
+    TestGrid grid(ereg,2,1, (GridLayoutPattern) GRID_LAYOUT_CHECKERBOARD);
+    grid.SetSeed(1);
+    grid.Init();
+    grid.Needed(Element_Dreg<TestEventConfig>::THE_INSTANCE);
+    grid.Needed(Element_Res<TestEventConfig>::THE_INSTANCE);
+    grid.Needed(Element_Sorter<TestEventConfig>::THE_INSTANCE);
+    grid.Needed(Element_Data<TestEventConfig>::THE_INSTANCE);
+    grid.Needed(Element_Emitter<TestEventConfig>::THE_INSTANCE);
+    grid.Needed(Element_Consumer<TestEventConfig>::THE_INSTANCE);
+
+    // Element data sums over the tiles that registered it
+    const u32 resType = Element_Res<TestEventConfig>::THE_INSTANCE.GetType();
+    assert(grid.GetElementDataTotal(resType, 1, 2) == 0);
+    grid.GetTile(0, 0).GetElementTable().GetDataAndRegister(resType, 2)[1] = 5;
+    grid.GetTile(1, 0).GetElementTable().GetDataAndRegister(resType, 2)[1] = 7;
+    assert(grid.GetElementDataTotal(resType, 1, 2) == 12);
+    assert(grid.GetElementDataTotal(resType, 0, 2) == 0);
+    assert(grid.GetElementDataTotal(resType, 1, 3) == 0);  // Other layouts don't count
+
+    SortingWork<TestGridConfig> work;
+    work.Capture(grid);
+    assert(work.GetEmitted() == 0);
+    assert(work.GetSortError() == 0.0);
+
+    SortingWork<TestGridConfig>::Seed(grid);
+    const u32 sorterType = Element_Sorter<TestEventConfig>::THE_INSTANCE.GetType();
+    const u32 dregType = Element_Dreg<TestEventConfig>::THE_INSTANCE.GetType();
+    assert(grid.GetAtomCount(sorterType) == 8);
+    assert(grid.GetAtomCount(dregType) == 8);
+    assert(grid.GetAtomCount(Element_Emitter<TestEventConfig>::THE_INSTANCE.GetType()) == 1);
+    assert(grid.GetAtomCount(Element_Consumer<TestEventConfig>::THE_INSTANCE.GetType()) == 1);
+
+    for (u32 i = 0; i < 20; ++i)
+    {
+      grid.RunDeterministicStep(1000);
+    }
+    SortingWork<TestGridConfig> later;
+    later.Capture(grid);
+    assert(later.GetEmitted() > 0);
+    assert(later.GetRejected() <= later.GetEmitted());
+    assert(later.GetConsumed() <= later.GetEmitted());
+
+    const SortingWork<TestGridConfig> none = later.Since(later);
+    assert(none.GetEmitted() == 0);
+    assert(none.GetSorted() == 0);
+    assert(later.Since(work).GetEmitted() == later.GetEmitted());
+  }
+
 } /* namespace MFM */
@@ -0,0 +1,126 @@
+#include "assert.h"
+#include "Inflate_Test.h"
+#include "Random.h"
+#include "itype.h"
+#include <stdio.h>   /* For snprintf */
+#include <string.h>
+
+namespace MFM {
+
+  void Inflate_Test::Test_RunTests() {
+    Test_inflateBlockTypes();
+    Test_inflateRejectsDamage();
+    Test_inflateCRC32();
+  }
+
+  /* Made by zlib, as raw deflate streams */
+  static const char HELLO[] = "Hello, hello, hello, MFM!";
+
+  static const u8 HELLO_STORED[] = {
+    0x01, 0x19, 0x00, 0xe6, 0xff, 0x48, 0x65, 0x6c, 0x6c, 0x6f, 0x2c, 0x20,
+    0x68, 0x65, 0x6c, 0x6c, 0x6f, 0x2c, 0x20, 0x68, 0x65, 0x6c, 0x6c, 0x6f,
+    0x2c, 0x20, 0x4d, 0x46, 0x4d, 0x21
+  };
+
+  static const u8 HELLO_FIXED[] = {
+    0xf3, 0x48, 0xcd, 0xc9, 0xc9, 0xd7, 0x51, 0xc8, 0x40, 0xa1, 0x7c, 0xdd,
+    0x7c, 0x15, 0x01
+  };
+
+  /* The MakeElements text, with dynamic Huffman codes */
+  static const u8 ELEMENTS_DYNAMIC[] = {
+    0x8d, 0xd1, 0x3d, 0x0a, 0x80, 0x30, 0x0c, 0x05, 0xe0, 0xdd, 0x53, 0xe4,
+    0x08, 0x4d, 0xd5, 0xaa, 0xb3, 0xf6, 0x02, 0x7a, 0x00, 0x71, 0x08, 0x22,
+    0x58, 0x85, 0x5a, 0xef, 0x2f, 0x82, 0xa4, 0x8e, 0x6f, 0x4c, 0xe0, 0x23,
+    0x3f, 0xcf, 0xef, 0x12, 0xe4, 0x48, 0xb3, 0xa1, 0xe9, 0x8c, 0x49, 0x22,
+    0x0d, 0x4b, 0x5a, 0xc8, 0x87, 0x2d, 0xbd, 0x45, 0x7f, 0x1e, 0xd7, 0x1d,
+    0xde, 0x6e, 0x94, 0x95, 0x46, 0xb9, 0xc8, 0x14, 0xfe, 0x13, 0x0c, 0x0a,
+    0x56, 0x61, 0x41, 0x51, 0xa9, 0x28, 0x41, 0xd1, 0xa9, 0xa8, 0xd0, 0xad,
+    0x9c, 0x92, 0x1a, 0x24, 0xb6, 0x56, 0xe2, 0x40, 0x52, 0xe6, 0x29, 0x0d,
+    0x7a, 0x7c, 0xbe, 0xa5, 0x05, 0x89, 0xcb, 0x0f, 0xeb, 0x40, 0xd2, 0xe6,
+    0x54, 0x18, 0x8d, 0x9e, 0xcd, 0x2f, 0x7c, 0x38, 0x7d, 0xcb, 0xc5, 0x03
+  };
+
+  enum { ELEMENTS_BYTES = 612 };
+
+  static void MakeElements(char * text)
+  {
+    u32 at = 0;
+    for (u32 i = 0; i < 12; ++i)
+    {
+      at += snprintf(text + at, ELEMENTS_BYTES + 1 - at,
+                     "Element_%d Sorter Data Emitter Consumer Dreg Res %d\n", i, i * i);
+    }
+    assert(at == ELEMENTS_BYTES);
+  }
+
+  void Inflate_Test::Test_inflateBlockTypes()
+  {
+    const u32 helloBytes = strlen(HELLO);
+    u8 back[ELEMENTS_BYTES];
+
+    memset(back, 0xa5, sizeof(back));
+    assert(Inflate::Decompress(HELLO_STORED, sizeof(HELLO_STORED), back, helloBytes));
+    assert(!memcmp(back, HELLO, helloBytes));
+
+    memset(back, 0xa5, sizeof(back));
+    assert(Inflate::Decompress(HELLO_FIXED, sizeof(HELLO_FIXED), back, helloBytes));
+    assert(!memcmp(back, HELLO, helloBytes));
+
+    char elements[ELEMENTS_BYTES + 1];
+    MakeElements(elements);
+    memset(back, 0xa5, sizeof(back));
+    assert(Inflate::Decompress(ELEMENTS_DYNAMIC, sizeof(ELEMENTS_DYNAMIC), back, ELEMENTS_BYTES));
+    assert(!memcmp(back, elements, ELEMENTS_BYTES));
+
+    // An empty final stored block is nothing at all
+    const u8 empty[] = { 0x01, 0x00, 0x00, 0xff, 0xff };
+    assert(Inflate::Decompress(empty, sizeof(empty), back, 0));
+  }
+
+  void Inflate_Test::Test_inflateRejectsDamage()
+  {
+    const u32 helloBytes = strlen(HELLO);
+    u8 back[ELEMENTS_BYTES];
+
+    // Wrong size either way, and a truncated stream
+    assert(!Inflate::Decompress(HELLO_FIXED, sizeof(HELLO_FIXED), back, helloBytes - 1));
+    assert(!Inflate::Decompress(HELLO_FIXED, sizeof(HELLO_FIXED), back, helloBytes + 1));
+    assert(!Inflate::Decompress(HELLO_FIXED, sizeof(HELLO_FIXED) - 2, back, helloBytes));
+    assert(!Inflate::Decompress(ELEMENTS_DYNAMIC, sizeof(ELEMENTS_DYNAMIC) / 2, back, ELEMENTS_BYTES));
+
+    // A stored block whose length check doesn't match
+    u8 bad[sizeof(ELEMENTS_DYNAMIC)];
+    memcpy(bad, HELLO_STORED, sizeof(HELLO_STORED));
+    bad[3] ^= 1;
+    assert(!Inflate::Decompress(bad, sizeof(HELLO_STORED), back, helloBytes));
+
+    // The reserved block type
+    const u8 reserved[] = { 0x07, 0x00 };
+    assert(!Inflate::Decompress(reserved, sizeof(reserved), back, 0));
+
+    // Damage may go unnoticed -- in a literal, say -- but never
+    // reads or writes out of bounds
+    Random random(3);
+    for (u32 trial = 0; trial < 2000; ++trial)
+    {
+      memcpy(bad, ELEMENTS_DYNAMIC, sizeof(ELEMENTS_DYNAMIC));
+      bad[random.Create(sizeof(bad))] = (u8) random.Create();
+      Inflate::Decompress(bad, sizeof(bad), back, ELEMENTS_BYTES);
+    }
+  }
+
+  void Inflate_Test::Test_inflateCRC32()
+  {
+    assert(Inflate::CRC32(0, (const u8 *) "123456789", 9) == 0xcbf43926);
+    assert(Inflate::CRC32(0, (const u8 *) HELLO, strlen(HELLO)) == 0x13c272ef);
+    assert(Inflate::CRC32(0, 0, 0) == 0);
+
+    // CRCs continue across pieces
+    char elements[ELEMENTS_BYTES + 1];
+    MakeElements(elements);
+    const u8 * bytes = (const u8 *) elements;
+    assert(Inflate::CRC32(0, bytes, ELEMENTS_BYTES) == 0x5ec77646);
+    assert(Inflate::CRC32(Inflate::CRC32(0, bytes, 100), bytes + 100, ELEMENTS_BYTES - 100) == 0x5ec77646);
+  }
+}
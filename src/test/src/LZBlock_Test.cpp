@@ -0,0 +1,95 @@
+#include "assert.h"
+#include "LZBlock_Test.h"
+#include "Random.h"
+#include "itype.h"
+#include <string.h>
+
+namespace MFM {
+
+  void LZBlock_Test::Test_RunTests() {
+    Test_lzBlockRoundTrips();
+    Test_lzBlockRejectsDamage();
+  }
+
+  enum { BLOCK_BYTES = 20000 };
+
+  static u32 RoundTrip(const u8 * raw, u32 rawBytes)
+  {
+    static u8 packed[BLOCK_BYTES + BLOCK_BYTES / 255 + 16];
+    static u8 back[BLOCK_BYTES];
+    assert(LZBlock::GetMaxCompressedBytes(rawBytes) <= sizeof(packed));
+
+    const u32 packedBytes = LZBlock::Compress(raw, rawBytes, packed);
+    assert(packedBytes <= LZBlock::GetMaxCompressedBytes(rawBytes));
+    memset(back, 0xa5, sizeof(back));
+    assert(LZBlock::Decompress(packed, packedBytes, back, rawBytes));
+    assert(!memcmp(raw, back, rawBytes));
+    return packedBytes;
+  }
+
+  void LZBlock_Test::Test_lzBlockRoundTrips()
+  {
+    static u8 raw[BLOCK_BYTES];
+
+    // Tiny blocks are all literals
+    for (u32 len = 0; len < 20; ++len)
+    {
+      for (u32 i = 0; i < len; ++i) raw[i] = (u8) (i * 37);
+      RoundTrip(raw, len);
+    }
+
+    // Empty space shrinks to almost nothing, long runs and all
+    memset(raw, 0, BLOCK_BYTES);
+    assert(RoundTrip(raw, BLOCK_BYTES) < BLOCK_BYTES / 100);
+
+    // Sparse atoms in empty space, like a quiet tile
+    for (u32 i = 0; i < BLOCK_BYTES; i += 997)
+    {
+      raw[i] = (u8) i;
+      raw[i + 1] = 0x42;
+    }
+    assert(RoundTrip(raw, BLOCK_BYTES) < BLOCK_BYTES / 10);
+
+    // A repeating pattern, with overlapping matches
+    for (u32 i = 0; i < BLOCK_BYTES; ++i) raw[i] = (u8) "abcabd"[i % 6];
+    assert(RoundTrip(raw, BLOCK_BYTES) < BLOCK_BYTES / 50);
+
+    // Noise doesn't compress, but doesn't grow past the bound either
+    Random random(12345);
+    for (u32 i = 0; i < BLOCK_BYTES; ++i) raw[i] = (u8) random.Create();
+    assert(RoundTrip(raw, BLOCK_BYTES) > BLOCK_BYTES);
+
+    // Long literal runs between matches
+    for (u32 i = 0; i < BLOCK_BYTES; i += 1000)
+    {
+      memset(raw + i, 0, 100);
+    }
+    RoundTrip(raw, BLOCK_BYTES);
+  }
+
+  void LZBlock_Test::Test_lzBlockRejectsDamage()
+  {
+    u8 raw[1000], packed[1100], back[1000];
+    for (u32 i = 0; i < sizeof(raw); ++i) raw[i] = (u8) (i % 10 == 0 ? i : 0);
+    const u32 packedBytes = LZBlock::Compress(raw, sizeof(raw), packed);
+
+    // Wrong size either way
+    assert(!LZBlock::Decompress(packed, packedBytes, back, sizeof(raw) - 1));
+    assert(!LZBlock::Decompress(packed, packedBytes - 1, back, sizeof(raw)));
+
+    // Damage may go unnoticed -- in a literal, say -- but never
+    // reads or writes out of bounds
+    Random random(2);
+    for (u32 trial = 0; trial < 2000; ++trial)
+    {
+      u8 bad[1100];
+      memcpy(bad, packed, packedBytes);
+      bad[random.Create(packedBytes)] = (u8) random.Create();
+      LZBlock::Decompress(bad, packedBytes, back, sizeof(raw));
+    }
+
+    // An offset reaching before the start of the block
+    const u8 backwards[] = { 0x10, 'x', 0x05, 0x00, 0x00 };
+    assert(!LZBlock::Decompress(backwards, sizeof(backwards), back, 5));
+  }
+}
@@ -79,9 +79,59 @@ namespace MFM {
     }
   }
 
+  static void Test_RecordQueue() {
+    static LogRecordQueue q;
+    assert(q.Front() == 0);
+
+    for (u32 i = 0; i < LogRecordQueue::RECORD_COUNT; ++i)
+      assert(q.Push(Logger::DEBUG, Logger::INCLUDE_TEXT, "0123456789", i % 10 + 1));
+    assert(!q.Push(Logger::DEBUG, Logger::INCLUDE_TEXT, "full", 4));
+    assert(q.GetDroppedCount() == 1);
+
+    for (u32 i = 0; i < LogRecordQueue::RECORD_COUNT; ++i)
+    {
+      const LogRecordQueue::Record * r = q.Front();
+      assert(r != 0);
+      assert(r->m_level == Logger::DEBUG);
+      assert(r->m_length == i % 10 + 1);
+      assert(!memcmp(r->m_text, "0123456789", r->m_length));
+      q.Pop();
+    }
+    assert(q.Front() == 0);
+
+    // And around again, past the wrap
+    assert(q.Push(Logger::ERROR, 0, "again", 5));
+    assert(q.Front() != 0 && q.Front()->m_length == 5);
+    q.Pop();
+    assert(q.Front() == 0);
+  }
+
+  static void Test_Async() {
+    tbuf.Reset();
+    Logger log(tbuf,Logger::MESSAGE);
+    log.SetAsync(true);
+    assert(log.IsAsync());
+    log.Debug("%d captains: %s vs %s", 2, "Scarlet", "Kirk");
+    log.Message("This is %s", "Captain Black");
+    log.Warning("We know that you can %s us, %s","hear","Earthman");
+    log.Flush();
+    assert(!strcmp("11: MSG: This is Captain Black\n12: WRN: We know that you can hear us, Earthman\n",
+                   tbuf.GetZString()));
+    log.Message("Queued");
+    log.Error("Must sterilize");  // Drains ahead of itself
+    log.SetAsync(false);
+    assert(!log.IsAsync());
+    assert(!strcmp("11: MSG: This is Captain Black\n12: WRN: We know that you can hear us, Earthman\n"
+                   "13: MSG: Queued\n14: ERR: Must sterilize\n",
+                   tbuf.GetZString()));
+    assert(log.GetDroppedCount() == 0);
+  }
+
   void Logger_Test::Test_RunTests() {
     Test_Basic();
     Test_IfLog();
+    Test_RecordQueue();
+    Test_Async();
   }
 
 } /* namespace MFM */
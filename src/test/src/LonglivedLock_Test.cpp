@@ -0,0 +1,145 @@
+#include "assert.h"
+#include "LonglivedLock_Test.h"
+#include "itype.h"
+#include <pthread.h>
+
+namespace MFM {
+
+  void LonglivedLock_Test::Test_RunTests() {
+    Test_lockUnlock();
+    Test_lockMisuse();
+    Test_lockCounts();
+    Test_lockThreads();
+  }
+
+  static int ownerA, ownerB;
+
+  void LonglivedLock_Test::Test_lockUnlock()
+  {
+    LonglivedLock lock;
+    assert(lock.GetOwnerIndex() == 0);
+
+    assert(lock.TryLock(&ownerA));
+    assert(lock.GetOwnerIndex() == &ownerA);
+
+    assert(!lock.TryLock(&ownerB));
+    assert(lock.GetOwnerIndex() == &ownerA);
+
+    assert(lock.Unlock(&ownerA));
+    assert(lock.GetOwnerIndex() == 0);
+
+    assert(lock.TryLock(&ownerB));
+    assert(lock.GetOwnerIndex() == &ownerB);
+    assert(lock.Unlock(&ownerB));
+  }
+
+  void LonglivedLock_Test::Test_lockMisuse()
+  {
+    LonglivedLock lock;
+    assert(lock.TryLock(&ownerA));
+
+    // Relocking by the owner FAILs
+    {
+      bool failed = false;
+      unwind_protect({failed = true;},{
+          lock.TryLock(&ownerA);
+        });
+      assert(failed);
+    }
+
+    // Unlocking by a non-owner FAILs and leaves the lock held
+    {
+      bool failed = false;
+      unwind_protect({failed = true;},{
+          lock.Unlock(&ownerB);
+        });
+      assert(failed);
+      assert(lock.GetOwnerIndex() == &ownerA);
+    }
+
+    assert(lock.Unlock(&ownerA));
+
+    // Unlocking a free lock FAILs
+    {
+      bool failed = false;
+      unwind_protect({failed = true;},{
+          lock.Unlock(&ownerA);
+        });
+      assert(failed);
+    }
+  }
+
+  void LonglivedLock_Test::Test_lockCounts()
+  {
+    LonglivedLock lock;
+    assert(lock.GetLockAttempts() == 0);
+    assert(lock.GetLockContended() == 0);
+
+    assert(lock.TryLock(&ownerA));
+    assert(!lock.TryLock(&ownerB));
+    assert(!lock.TryLock(&ownerB));
+    assert(lock.GetLockAttempts() == 3);
+    assert(lock.GetLockContended() == 2);
+
+    lock.ResetLockCounts();
+    assert(lock.GetLockAttempts() == 0);
+    assert(lock.GetLockContended() == 0);
+    assert(lock.GetOwnerIndex() == &ownerA);
+    assert(lock.Unlock(&ownerA));
+  }
+
+  enum { LOCK_THREADS = 4, LOCK_ROUNDS = 20000 };
+
+  struct LockThreadArgs {
+    LonglivedLock * m_lock;
+    u32 * m_shared;
+    u32 m_acquired;
+  };
+
+  static void * LockThreadRunner(void * arg)
+  {
+    LockThreadArgs & lta = *(LockThreadArgs *) arg;
+    lta.m_acquired = 0;
+    for (u32 i = 0; i < LOCK_ROUNDS; ++i)
+    {
+      if (lta.m_lock->TryLock(&lta))
+      {
+        // Non-atomic update: only safe if the lock is exclusive
+        u32 v = *lta.m_shared;
+        *lta.m_shared = v + 1;
+        ++lta.m_acquired;
+        lta.m_lock->Unlock(&lta);
+      }
+    }
+    return 0;
+  }
+
+  void LonglivedLock_Test::Test_lockThreads()
+  {
+    LonglivedLock lock;
+    u32 shared = 0;
+    LockThreadArgs args[LOCK_THREADS];
+    pthread_t threads[LOCK_THREADS];
+
+    for (u32 i = 0; i < LOCK_THREADS; ++i)
+    {
+      args[i].m_lock = &lock;
+      args[i].m_shared = &shared;
+      const s32 created = pthread_create(&threads[i], 0, LockThreadRunner, &args[i]);
+      assert(created == 0);
+    }
+
+    u32 acquired = 0;
+    for (u32 i = 0; i < LOCK_THREADS; ++i)
+    {
+      const s32 joined = pthread_join(threads[i], 0);
+      assert(joined == 0);
+      acquired += args[i].m_acquired;
+    }
+
+    assert(shared == acquired);
+    assert(lock.GetOwnerIndex() == 0);
+    assert(lock.GetLockAttempts() == LOCK_THREADS * LOCK_ROUNDS);
+    assert(lock.GetLockContended() == LOCK_THREADS * LOCK_ROUNDS - acquired);
+  }
+}
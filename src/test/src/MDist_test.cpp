@@ -23,4 +23,58 @@ void MDist_Test::Test_MDistConversion()
   assert(out.GetX() == 1);
   assert(out.GetY() == -1);
 }
+
+void MDist_Test::Test_MDistSymmetryTables()
+{
+  const MDist<4> & md = MDist<4>::get();
+  for (u32 psym = 0; psym < PSYM_SYMMETRY_COUNT; ++psym)
+  {
+    for (u32 i = 0; i < md.GetSiteCount(); ++i)
+    {
+      const SPoint & p = md.GetPoint(i);
+      const SPoint mapped = SymMap(p, (PointSymmetry) psym, p);
+      const u32 sn = md.GetSymSiteNumber(i, (PointSymmetry) psym);
+      assert(md.GetPoint(sn) == mapped);
+
+      // The inverse symmetry's table undoes this one
+      assert(md.GetSymSiteNumber(sn, SymInverse((PointSymmetry) psym)) == i);
+    }
+  }
+  assert(md.GetSymSiteNumber(0, PSYM_DEG090L) == 0);
+}
+
+void MDist_Test::Test_MDistPrecompiledTables()
+{
+  const MDist<4> & md = MDist<4>::get();
+  assert(md.GetSiteCount() == EVENT_WINDOW_SITES(4));
+  assert(md.GetFirstIndex(0) == 0);
+  assert(md.GetFirstIndex(5) == md.GetSiteCount());
+
+  for (u32 i = 0; i < md.GetSiteCount(); ++i)
+  {
+    const SPoint p = md.GetPoint(i);
+
+    // Site numbers and points invert, sorted by Manhattan length
+    assert(md.GetSiteNumber(p) == (s32) i);
+    const u32 len = p.GetManhattanLength();
+    assert(i >= md.GetFirstIndex(len) && i <= md.GetLastIndex(len));
+    assert(md.FromPoint(p, len) == (s32) i);
+    if (len > 0)
+    {
+      assert(md.FromPoint(p, len - 1) < 0);
+    }
+
+    // Raster order round-trips
+    s32 raster = md.GetRasterIndexFromSiteNumber(i);
+    assert(raster >= 0);
+    assert(md.GetSiteNumberFromRasterIndex((u32) raster) == (s32) i);
+  }
+
+  assert(md.GetSiteNumber(SPoint(3,2)) < 0);  // Outside the window
+  assert(md.GetSiteNumber(SPoint(5,0)) < 0);
+
+  assert(md.GetFirstESLIndex(0) == 0);
+  assert(md.GetFirstESLIndex(1) == 1);
+  assert(md.GetLastESLIndex(2) == 8);          // Through the Moore neighborhood
+}
 } /* namespace MFM */
@@ -0,0 +1,277 @@
+#include "assert.h"
+#include "MFZBundle_Test.h"
+#include "Inflate.h"
+#include "itype.h"
+#include <stdio.h>      /* For snprintf, fopen */
+#include <string.h>
+#include <unistd.h>     /* For getpid, unlink, rmdir */
+#include <sys/stat.h>   /* For stat */
+
+namespace MFM {
+
+  void MFZBundle_Test::Test_RunTests() {
+    Test_mfzBundleIndexesMembers();
+    Test_mfzBundleExtractsOnce();
+    Test_mfzBundleRejectsDamage();
+  }
+
+  /* Just as much of a zip writer as it takes to make bundles */
+  struct TestZip
+  {
+    u8 m_bytes[4096];
+    u32 m_length;
+    u8 m_dir[1024];
+    u32 m_dirLength;
+    u32 m_entries;
+
+    TestZip() : m_length(0), m_dirLength(0), m_entries(0) { }
+
+    static void Put(u8 * to, u32 & at, u32 value, u32 bytes)
+    {
+      for (u32 i = 0; i < bytes; ++i)
+      {
+        to[at++] = (u8) (value >> (8 * i));
+      }
+    }
+
+    void Add(const char * name, u32 method, const u8 * packed, u32 packedBytes,
+             const u8 * raw, u32 rawBytes)
+    {
+      const u32 crc = Inflate::CRC32(0, raw, rawBytes);
+      const u32 nameBytes = strlen(name);
+      const u32 local = m_length;
+      assert(local + 30 + nameBytes + packedBytes <= sizeof(m_bytes));
+      assert(m_dirLength + 46 + nameBytes <= sizeof(m_dir));
+
+      Put(m_bytes, m_length, 0x04034b50, 4);
+      Put(m_bytes, m_length, 20, 2);              // Version needed
+      Put(m_bytes, m_length, 0, 2);               // Flags
+      Put(m_bytes, m_length, method, 2);
+      Put(m_bytes, m_length, 0, 4);               // Time and date
+      Put(m_bytes, m_length, crc, 4);
+      Put(m_bytes, m_length, packedBytes, 4);
+      Put(m_bytes, m_length, rawBytes, 4);
+      Put(m_bytes, m_length, nameBytes, 2);
+      Put(m_bytes, m_length, 0, 2);               // Extra
+      memcpy(m_bytes + m_length, name, nameBytes);
+      m_length += nameBytes;
+      memcpy(m_bytes + m_length, packed, packedBytes);
+      m_length += packedBytes;
+
+      Put(m_dir, m_dirLength, 0x02014b50, 4);
+      Put(m_dir, m_dirLength, 20, 2);             // Version made by
+      Put(m_dir, m_dirLength, 20, 2);             // Version needed
+      Put(m_dir, m_dirLength, 0, 2);              // Flags
+      Put(m_dir, m_dirLength, method, 2);
+      Put(m_dir, m_dirLength, 0, 4);              // Time and date
+      Put(m_dir, m_dirLength, crc, 4);
+      Put(m_dir, m_dirLength, packedBytes, 4);
+      Put(m_dir, m_dirLength, rawBytes, 4);
+      Put(m_dir, m_dirLength, nameBytes, 2);
+      Put(m_dir, m_dirLength, 0, 2);              // Extra
+      Put(m_dir, m_dirLength, 0, 2);              // Comment
+      Put(m_dir, m_dirLength, 0, 2);              // Disk
+      Put(m_dir, m_dirLength, 0, 2);              // Internal attributes
+      Put(m_dir, m_dirLength, 0, 4);              // External attributes
+      Put(m_dir, m_dirLength, local, 4);
+      memcpy(m_dir + m_dirLength, name, nameBytes);
+      m_dirLength += nameBytes;
+      ++m_entries;
+    }
+
+    void AddStored(const char * name, const char * text)
+    {
+      Add(name, 0, (const u8 *) text, strlen(text), (const u8 *) text, strlen(text));
+    }
+
+    /* Append the directory; returns the zip's length */
+    u32 Finish()
+    {
+      const u32 dirStart = m_length;
+      assert(m_length + m_dirLength + 22 <= sizeof(m_bytes));
+      memcpy(m_bytes + m_length, m_dir, m_dirLength);
+      m_length += m_dirLength;
+      Put(m_bytes, m_length, 0x06054b50, 4);
+      Put(m_bytes, m_length, 0, 4);               // Disks
+      Put(m_bytes, m_length, m_entries, 2);
+      Put(m_bytes, m_length, m_entries, 2);
+      Put(m_bytes, m_length, m_dirLength, 4);
+      Put(m_bytes, m_length, dirStart, 4);
+      Put(m_bytes, m_length, 0, 2);               // Comment
+      return m_length;
+    }
+  };
+
+  static const char HELLO[] = "Hello, hello, hello, MFM!";
+
+  static const u8 HELLO_FIXED[] = {
+    0xf3, 0x48, 0xcd, 0xc9, 0xc9, 0xd7, 0x51, 0xc8, 0x40, 0xa1, 0x7c, 0xdd,
+    0x7c, 0x15, 0x01
+  };
+
+  static const char DEMO_MFS[] = "RegisterElement(Dreg)\nSite(3,4,Dreg)\n";
+
+  static void TestPath(char * path, u32 size, const char * name)
+  {
+    snprintf(path, size, "/tmp/mfm-mfzbundle-%d-%s", (s32) getpid(), name);
+  }
+
+  /* Write a bundle as mfzmake would pack it, with its library
+     deflated, to path, damaging the byte at damage if it's set */
+  static void WriteBundle(const char * path, s32 damage)
+  {
+    TestZip inner;
+    inner.AddStored("MFZPUBKEY.DAT", "test-handle\nnot-really-a-key\n");
+    inner.AddStored("MFZNAME.DAT", "demo.mfz");
+    inner.AddStored("home/t2/demo/demo.mfs", DEMO_MFS);
+    inner.Add("home/t2/demo/libcue.so", 8, HELLO_FIXED, sizeof(HELLO_FIXED),
+              (const u8 *) HELLO, strlen(HELLO));
+    const u32 innerBytes = inner.Finish();
+
+    TestZip outer;
+    outer.AddStored("MFZSIG.DAT", "not-really-a-signature");
+    outer.Add("MFZ.ZIP", 0, inner.m_bytes, innerBytes, inner.m_bytes, innerBytes);
+    const u32 outerBytes = outer.Finish();
+    if (damage >= 0)
+    {
+      outer.m_bytes[damage] ^= 0x40;
+    }
+
+    FILE * fp = fopen(path, "wb");
+    assert(fp);
+    fputs("MFZ(1.0)\n", fp);
+    const u32 wrote = fwrite(outer.m_bytes, 1, outerBytes, fp);
+    const s32 closed = fclose(fp);
+    assert(wrote == outerBytes);
+    assert(closed == 0);
+  }
+
+  void MFZBundle_Test::Test_mfzBundleIndexesMembers()
+  {
+    char path[100];
+    TestPath(path, sizeof(path), "index.mfz");
+    WriteBundle(path, -1);
+    assert(MFZBundle::IsBundle(path));
+
+    MFZBundle bundle;
+    assert(!bundle.IsOpen());
+    assert(!bundle.Open(path));
+    assert(bundle.IsOpen());
+    assert(!strcmp(bundle.GetPath(), path));
+    assert(!strcmp(bundle.GetBundleName(), "demo.mfz"));
+    assert(bundle.GetMemberCount() == 4);
+
+    // By whole path or base name
+    const s32 mfs = bundle.FindMember("demo.mfs");
+    assert(mfs == 2);
+    assert(bundle.FindMember("home/t2/demo/demo.mfs") == mfs);
+    assert(bundle.FindMember("MFZSIG.DAT") < 0);  // Outer members aren't listed
+    assert(bundle.FindMember("nonesuch") < 0);
+    assert(!strcmp(bundle.GetMemberName(mfs), "home/t2/demo/demo.mfs"));
+    assert(!strcmp(bundle.GetMemberBaseName(mfs), "demo.mfs"));
+    assert(bundle.GetMemberBytes(mfs) == strlen(DEMO_MFS));
+
+    const u8 * text = bundle.GetMemberData(mfs);
+    assert(text && !memcmp(text, DEMO_MFS, strlen(DEMO_MFS)));
+
+    // Inflated on first use, and kept
+    const s32 lib = bundle.FindMember("libcue.so");
+    assert(lib == 3);
+    assert(bundle.GetMemberCRC(lib) == Inflate::CRC32(0, (const u8 *) HELLO, strlen(HELLO)));
+    const u8 * hello = bundle.GetMemberData(lib);
+    assert(hello && !memcmp(hello, HELLO, strlen(HELLO)));
+    assert(bundle.GetMemberData(lib) == hello);
+
+    bundle.Close();
+    assert(!bundle.IsOpen());
+    assert(bundle.GetMemberCount() == 0);
+    unlink(path);
+  }
+
+  void MFZBundle_Test::Test_mfzBundleExtractsOnce()
+  {
+    char path[100], cacheDir[100];
+    TestPath(path, sizeof(path), "extract.mfz");
+    TestPath(cacheDir, sizeof(cacheDir), "cache/sub");
+    WriteBundle(path, -1);
+
+    MFZBundle bundle;
+    assert(!bundle.Open(path));
+    const u32 lib = (u32) bundle.FindMember("libcue.so");
+
+    OString256 cached;
+    assert(!bundle.ExtractMember(lib, cacheDir, cached));
+    assert(strstr(cached.GetZString(), cacheDir) == cached.GetZString());
+    assert(strstr(cached.GetZString(), "-libcue.so"));
+
+    char back[100];
+    FILE * fp = fopen(cached.GetZString(), "rb");
+    assert(fp);
+    const u32 read = fread(back, 1, sizeof(back), fp);
+    fclose(fp);
+    assert(read == strlen(HELLO));
+    assert(!memcmp(back, HELLO, strlen(HELLO)));
+
+    // Already there -- so, to prove it, not rewritten -- for the
+    // same bundle, or another one opened from the same file
+    fp = fopen(cached.GetZString(), "r+b");
+    assert(fp);
+    fputc('J', fp);
+    fclose(fp);
+    MFZBundle again;
+    assert(!again.Open(path));
+    OString256 cachedAgain;
+    assert(!again.ExtractMember(lib, cacheDir, cachedAgain));
+    assert(!strcmp(cached.GetZString(), cachedAgain.GetZString()));
+    fp = fopen(cached.GetZString(), "rb");
+    assert(fp && fgetc(fp) == 'J');
+    fclose(fp);
+
+    unlink(cached.GetZString());
+    rmdir(cacheDir);
+    TestPath(cacheDir, sizeof(cacheDir), "cache");
+    rmdir(cacheDir);
+    unlink(path);
+  }
+
+  void MFZBundle_Test::Test_mfzBundleRejectsDamage()
+  {
+    char path[100];
+    TestPath(path, sizeof(path), "damage.mfz");
+    MFZBundle bundle;
+
+    // Not there, not a bundle
+    assert(bundle.Open(path));
+    assert(!MFZBundle::IsBundle(path));
+    FILE * fp = fopen(path, "wb");
+    assert(fp);
+    fputs("MFS(1.0)\nRegisterElement(Dreg)\n", fp);
+    fclose(fp);
+    assert(!MFZBundle::IsBundle(path));
+    assert(bundle.Open(path));
+    assert(!bundle.IsOpen());
+
+    // Damage in a member's data is found when it's first used; the
+    // library's deflated bytes end the inner zip's last local entry
+    const u32 innerStart = 30 + strlen("MFZSIG.DAT") + strlen("not-really-a-signature") +
+      30 + strlen("MFZ.ZIP");
+    const u32 libData = innerStart + 3 * 30 + strlen("MFZPUBKEY.DAT") + strlen("test-handle\nnot-really-a-key\n") +
+      strlen("MFZNAME.DAT") + strlen("demo.mfz") +
+      strlen("home/t2/demo/demo.mfs") + strlen(DEMO_MFS) +
+      30 + strlen("home/t2/demo/libcue.so");
+    WriteBundle(path, (s32) libData + 3);
+    assert(!bundle.Open(path));
+    assert(bundle.GetMemberData((u32) bundle.FindMember("demo.mfs")));
+    assert(!bundle.GetMemberData((u32) bundle.FindMember("libcue.so")));
+    OString256 cached;
+    assert(bundle.ExtractMember((u32) bundle.FindMember("libcue.so"), "/tmp", cached));
+    assert(cached.GetLength() == 0);
+
+    // Damage to the directory is found when it's opened
+    WriteBundle(path, (s32) innerStart + 2);   // MFZ.ZIP's first local header
+    assert(bundle.Open(path));
+    assert(!bundle.IsOpen());
+
+    unlink(path);
+  }
+}
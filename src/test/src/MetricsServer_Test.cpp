@@ -0,0 +1,82 @@
+#include "assert.h"
+#include "MetricsServer_Test.h"
+#include "SocketChannel.h"  // For ConnectTCP
+#include "itype.h"
+#include <string.h>         // For strlen, strcmp, strstr
+#include <unistd.h>         // For close
+#include <sys/socket.h>     // For send, recv
+
+namespace MFM {
+
+  void MetricsServer_Test::Test_RunTests() {
+    Test_Page();
+    Test_Scrape();
+  }
+
+  void MetricsServer_Test::Test_Page() {
+    MetricsServer ms;
+    char buf[64];
+    assert(ms.CopyPage(buf, sizeof(buf)) == 0);
+    assert(buf[0] == '\0');
+
+    ms.BeginUpdate();
+    ms.GetUpdateSink().Printf("mfm_aeps %d\n", 17);
+    assert(ms.CopyPage(buf, sizeof(buf)) == 0);  // Not published yet
+    ms.EndUpdate();
+    assert(ms.CopyPage(buf, sizeof(buf)) == 12);
+    assert(!strcmp(buf, "mfm_aeps 17\n"));
+
+    // Short buffers get what fits
+    char tiny[5];
+    assert(ms.CopyPage(tiny, sizeof(tiny)) == 4);
+    assert(!strcmp(tiny, "mfm_"));
+  }
+
+  static u32 Fetch(u16 port, const char * request, char * reply, u32 size) {
+    s32 fd = SocketChannel::ConnectTCP("127.0.0.1", port);
+    assert((u32) send(fd, request, strlen(request), 0) == strlen(request));
+    u32 got = 0;
+    while (got < size - 1) {
+      ssize_t n = recv(fd, reply + got, size - 1 - got, 0);
+      if (n <= 0) break;
+      got += n;
+    }
+    reply[got] = '\0';
+    close(fd);
+    return got;
+  }
+
+  void MetricsServer_Test::Test_Scrape() {
+    MetricsServer ms;
+    ms.Start(0);
+    assert(ms.IsRunning());
+    assert(ms.GetPort() != 0);
+
+    ms.BeginUpdate();
+    ms.GetUpdateSink().Printf("# TYPE mfm_epochs counter\nmfm_epochs %d\n", 3);
+    ms.EndUpdate();
+
+    char reply[1024];
+    Fetch(ms.GetPort(), "GET /metrics HTTP/1.1\r\nHost: x\r\n\r\n", reply, sizeof(reply));
+    assert(!strncmp(reply, "HTTP/1.0 200 OK\r\n", 17));
+    assert(strstr(reply, "Content-Length: 39\r\n"));
+    const char * body = strstr(reply, "\r\n\r\n");
+    assert(body && !strcmp(body + 4, "# TYPE mfm_epochs counter\nmfm_epochs 3\n"));
+    assert(ms.GetScrapeCount() == 1);
+
+    // Later updates show up in later scrapes
+    ms.BeginUpdate();
+    ms.GetUpdateSink().Printf("mfm_epochs %d\n", 4);
+    ms.EndUpdate();
+    Fetch(ms.GetPort(), "GET / HTTP/1.0\r\n\r\n", reply, sizeof(reply));
+    assert(strstr(reply, "\r\n\r\nmfm_epochs 4\n"));
+
+    Fetch(ms.GetPort(), "POST / HTTP/1.0\r\n\r\n", reply, sizeof(reply));
+    assert(!strncmp(reply, "HTTP/1.0 405", 12));
+    assert(ms.GetScrapeCount() == 2);
+
+    ms.Stop();
+    assert(!ms.IsRunning());
+  }
+
+} /* namespace MFM */
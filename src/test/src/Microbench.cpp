@@ -0,0 +1,74 @@
+#include <time.h>    /* For clock_gettime */
+#include "Microbench.h"
+#include "Fail.h"
+
+namespace MFM {
+
+  static u64 GetNowNS()
+  {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((u64) ts.tv_sec) * 1000000000 + ts.tv_nsec;
+  }
+
+  Microbench::Microbench(u32 warmups, u32 samples, u32 iterations)
+    : m_warmups(warmups)
+    , m_samples(samples)
+    , m_iterations(iterations)
+    , m_checksum(0)
+  {
+    if (samples == 0 || samples > MAX_SAMPLES || iterations == 0)
+    {
+      FAIL(ILLEGAL_ARGUMENT);
+    }
+  }
+
+  void Microbench::Measure(Body body, void * arg, Stats & stats)
+  {
+    for (u32 i = 0; i < m_warmups; ++i)
+    {
+      m_checksum += body(arg, m_iterations);
+    }
+
+    for (u32 i = 0; i < m_samples; ++i)
+    {
+      const u64 start = GetNowNS();
+      m_checksum += body(arg, m_iterations);
+      const u64 stop = GetNowNS();
+      m_sampleNS[i] = ((double) (stop - start)) / m_iterations;
+    }
+
+    ComputeStats(m_sampleNS, m_samples, stats);
+  }
+
+  void Microbench::Report(ByteSink & out, const char * name, Body body, void * arg)
+  {
+    Stats stats;
+    Measure(body, arg, stats);
+    out.Printf("bench,%s,%f,%f,%f\n", name, stats.m_medianNS, stats.m_p99NS, stats.m_minNS);
+  }
+
+  void Microbench::ComputeStats(double * samples, u32 count, Stats & stats)
+  {
+    if (count == 0)
+    {
+      FAIL(ILLEGAL_ARGUMENT);
+    }
+
+    for (u32 i = 1; i < count; ++i)  // Insertion sort; counts are small
+    {
+      const double v = samples[i];
+      u32 j = i;
+      for (; j > 0 && samples[j - 1] > v; --j)
+      {
+        samples[j] = samples[j - 1];
+      }
+      samples[j] = v;
+    }
+
+    stats.m_minNS = samples[0];
+    stats.m_medianNS = samples[count / 2];
+    stats.m_p99NS = samples[(count * 99 + 99) / 100 - 1];
+  }
+
+} /* namespace MFM */
@@ -0,0 +1,55 @@
+#include "assert.h"
+#include "Microbench_Test.h"
+
+namespace MFM {
+
+  void Microbench_Test::Test_RunTests()
+  {
+    Test_microbenchStats();
+    Test_microbenchMeasure();
+  }
+
+  void Microbench_Test::Test_microbenchStats()
+  {
+    double one[1] = { 5.0 };
+    Microbench::Stats stats;
+    Microbench::ComputeStats(one, 1, stats);
+    assert(stats.m_minNS == 5.0 && stats.m_medianNS == 5.0 && stats.m_p99NS == 5.0);
+
+    // 200 down to 1: median is the 101st smallest, p99 the 198th
+    double samples[200];
+    for (u32 i = 0; i < 200; ++i)
+    {
+      samples[i] = 200.0 - i;
+    }
+    Microbench::ComputeStats(samples, 200, stats);
+    for (u32 i = 1; i < 200; ++i)
+    {
+      assert(samples[i - 1] <= samples[i]);
+    }
+    assert(stats.m_minNS == 1.0);
+    assert(stats.m_medianNS == 101.0);
+    assert(stats.m_p99NS == 198.0);
+  }
+
+  static u32 CountCalls(void * arg, u32 iterations)
+  {
+    u32 & calls = *(u32 *) arg;
+    ++calls;
+    return iterations;
+  }
+
+  void Microbench_Test::Test_microbenchMeasure()
+  {
+    Microbench mb(3, 11, 7);
+    u32 calls = 0;
+    Microbench::Stats stats;
+    mb.Measure(CountCalls, &calls, stats);
+
+    assert(calls == 3 + 11);
+    assert(mb.GetChecksum() == (3 + 11) * 7);
+    assert(stats.m_minNS >= 0.0);
+    assert(stats.m_minNS <= stats.m_medianNS && stats.m_medianNS <= stats.m_p99NS);
+  }
+
+} /* namespace MFM */
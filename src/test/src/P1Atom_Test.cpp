@@ -0,0 +1,71 @@
+#include "assert.h"
+#include "P1Atom_Test.h"
+#include "StdEventConfig.h"
+
+namespace MFM {
+
+  static void Test_Size() {
+    assert(sizeof(P1Atom) == sizeof(u64));
+    assert(P1Atom::P1_STATE_BITS_LEN == 39);
+
+    // A planar tile's atom plane is a plain array of words
+    StdCompactAtom plane[4];
+    assert(sizeof(plane) == 4 * sizeof(u64));
+  }
+
+  static void Test_Type() {
+    P1Atom empty;
+    assert(empty.GetType() == P1Atom::ATOM_EMPTY_TYPE);
+    assert(empty.IsSane());
+
+    P1Atom atom(0xCE01);
+    assert(atom.GetType() == 0xCE01);
+    assert(atom.IsSane());
+    assert(atom != empty);
+
+    atom.SetEmpty();
+    assert(atom == empty);
+  }
+
+  static void Test_State() {
+    P1Atom atom(0xCE02);
+    assert(atom.GetStateField(0, 32) == 0);
+
+    // Fields straddling the middle of the word, and the last bit
+    atom.SetStateField(0, 32, 0xdeadbeef);
+    atom.SetStateField(32, 7, 0x5a);
+    assert(atom.GetStateField(0, 32) == 0xdeadbeef);
+    assert(atom.GetStateField(32, 7) == 0x5a);
+    assert(atom.GetStateField(38, 1) == 0);
+    atom.SetStateField(38, 1, 1);
+    assert(atom.GetStateField(38, 1) == 1);
+    assert(atom.GetType() == 0xCE02);
+    assert(atom.IsSane());
+
+    // Atoms differing only in the high half compare unequal
+    P1Atom other(atom);
+    assert(other == atom);
+    other.SetStateField(38, 1, 0);
+    assert(other != atom);
+  }
+
+  static void Test_Repair() {
+    P1Atom atom(0xCE03);
+    atom.SetStateField(0, 16, 0x1234);
+
+    BitVector<64> & bits = atom.GetBits();
+    bits.ToggleBit(P1Atom::P1_TYPE_BITS_POS + 3);
+    assert(!atom.IsSane());
+    assert(atom.HasBeenRepaired());
+    assert(atom.IsSane());
+    assert(atom.GetType() == 0xCE03);
+    assert(atom.GetStateField(0, 16) == 0x1234);
+  }
+
+  void P1Atom_Test::Test_RunTests() {
+    Test_Size();
+    Test_Type();
+    Test_State();
+    Test_Repair();
+  }
+} /* namespace MFM */
@@ -55,6 +55,23 @@ namespace MFM {
       // Let's say 'most' means 'more than 70%'
       assert(tripleFailures * 100 > tripleCases * 70);
     }
+
+    // Batch checking must agree with one at a time
+    const u32 N = 64;
+    u32 batch[N], orig[N];
+    for (u32 i = 0; i < N; ++i)
+      batch[i] = orig[i] = Parity2D_4x4::Add2DParity(i * 0x3b1u);
+    assert(Parity2D_4x4::Count2DParityErrors(batch, N) == 0);
+    assert(Parity2D_4x4::CheckAndCorrect2DParityBatch(batch, N) == 0);
+
+    batch[3] ^= 1<<5;                      // Correctable
+    batch[40] ^= 1<<20;                    // Correctable, in the ECC
+    batch[17] ^= (1<<2) | (1<<9);          // Not
+    assert(Parity2D_4x4::Count2DParityErrors(batch, N) == 3);
+    const u32 bad17 = batch[17];
+    assert(Parity2D_4x4::CheckAndCorrect2DParityBatch(batch, N) == 1);
+    for (u32 i = 0; i < N; ++i)
+      assert(batch[i] == (i == 17 ? bad17 : orig[i]));
   }
 
 } /* namespace MFM */
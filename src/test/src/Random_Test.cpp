@@ -7,6 +7,8 @@ namespace MFM {
   void Random_Test::Test_RunTests() {
     Test_randomSetSeed();
     Test_randomDeterministics();
+    Test_randomXoshiro();
+    Test_randomGeometricSkip();
   }
 
   Random & Random_Test::setup()
@@ -70,4 +72,77 @@ namespace MFM {
     }
   }
 
+  void Random_Test::Test_randomXoshiro()
+  {
+    XoshiroRand x(1);
+
+    // Reference values from the published xoshiro128** step,
+    // splitmix64-seeded, lanes interleaved
+    const u32 expected[] = { 0xb526f986, 0xec80c70b, 0xa678c2da, 0x4454816a };
+    for (u32 i = 0; i < sizeof(expected)/sizeof(expected[0]); ++i) {
+      assert(x.Next() == expected[i]);
+    }
+
+    // Crossing into the second batch
+    for (u32 i = 4; i < XoshiroRand::BATCH_SIZE; ++i) {
+      x.Next();
+    }
+    assert(x.Next() == 0xec9745c5);
+    assert(x.Next() == 0x37109df9);
+
+    // Reseeding restarts the sequence
+    x.Seed(1);
+    assert(x.Next() == expected[0]);
+
+    // Sequential seeds diverge
+    XoshiroRand y(2);
+    x.Seed(1);
+    u32 countSame = 0;
+    for (u32 i = 0; i < 100; ++i) {
+      if (x.Next() == y.Next()) ++countSame;
+    }
+    assert(countSame < 100);
+
+    // Bounded draws cover small ranges evenly
+    Random & random = setup();
+    u32 counts[3] = { 0, 0, 0 };
+    for (u32 i = 0; i < 3000; ++i) {
+      ++counts[random.Create(3)];
+    }
+    for (u32 i = 0; i < 3; ++i) {
+      assert(counts[i] > 800 && counts[i] < 1200);
+    }
+    assert(random.Create(0xffffffff) < 0xffffffff);
+  }
+
+  void Random_Test::Test_randomGeometricSkip()
+  {
+    Random & random = setup();
+    assert(random.GeometricSkip(1) == 0);
+
+    // Hits per 100000 trials should match OneIn(100)'s thousand
+    const u32 TRIALS = 100000;
+    u32 hits = 0;
+    for (u32 k = random.GeometricSkip(100); k < TRIALS; k += random.GeometricSkip(100) + 1) {
+      ++hits;
+    }
+    assert(hits > 900 && hits < 1100);
+
+    // Huge odds mostly skip everything
+    u32 near = 0;
+    for (u32 i = 0; i < 100; ++i) {
+      if (random.GeometricSkip(0xffffffff) < TRIALS) ++near;
+    }
+    assert(near < 5);
+
+    // Fractional odds: 3 in 7 hit about 42857 of 100000
+    assert(random.GeometricSkip(7, 7) == 0);
+    assert(random.GeometricSkip(0, 7) == 0xffffffff);
+    hits = 0;
+    for (u32 k = random.GeometricSkip(3, 7); k < TRIALS; k += random.GeometricSkip(3, 7) + 1) {
+      ++hits;
+    }
+    assert(hits > 41500 && hits < 44200);
+  }
+
 } /* namespace MFM */
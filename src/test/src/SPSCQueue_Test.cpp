@@ -0,0 +1,178 @@
+#include "assert.h"
+#include "SPSCQueue_Test.h"
+#include "itype.h"
+#include <pthread.h>
+#include <unistd.h>
+
+namespace MFM {
+
+  void SPSCQueue_Test::Test_RunTests() {
+    Test_queueWrapAround();
+    Test_queueAllOrNothing();
+    Test_queueNonBlockingRead();
+    Test_queueBlockingRead();
+    Test_queueBlockingWrite();
+  }
+
+  typedef SPSCQueue<128> TestQueue;
+
+  enum { STREAM_BYTES = 100000 };
+
+  static u8 StreamByte(u32 i)
+  {
+    return (u8) (i * 7 + (i >> 8));
+  }
+
+  void SPSCQueue_Test::Test_queueWrapAround()
+  {
+    TestQueue q;
+    assert(q.GetCapacity() == 128);
+    assert(q.GetReadable() == 0);
+    assert(q.GetWritable() == 128);
+
+    u8 in[100], out[100];
+    for (u32 i = 0; i < 100; ++i) in[i] = StreamByte(i);
+
+    // Walk the indices around the ring several times, at an odd
+    // stride, so batches straddle the end of the buffer
+    for (u32 round = 0; round < 20; ++round)
+    {
+      const u32 len = 37 + round;
+      assert(q.Write(in, len) == len);
+      assert(q.GetReadable() == len);
+      assert(q.GetWritable() == 128 - len);
+      assert(q.Read(out, len) == len);
+      for (u32 i = 0; i < len; ++i) assert(out[i] == in[i]);
+    }
+    assert(q.GetReadable() == 0);
+
+    // Write stops at capacity, Read at what's there
+    u8 big[200];
+    for (u32 i = 0; i < 200; ++i) big[i] = StreamByte(i);
+    assert(q.Write(big, 200) == 128);
+    assert(q.Write(big, 1) == 0);
+    assert(q.GetWritable() == 0);
+    u8 back[200];
+    assert(q.Read(back, 200) == 128);
+    for (u32 i = 0; i < 128; ++i) assert(back[i] == big[i]);
+    assert(q.Read(back, 1) == 0);
+  }
+
+  void SPSCQueue_Test::Test_queueAllOrNothing()
+  {
+    TestQueue q;
+    u8 buf[128];
+    for (u32 i = 0; i < 128; ++i) buf[i] = StreamByte(i);
+
+    assert(q.WriteAll(buf, 100));
+    assert(!q.WriteAll(buf, 29));      // 28 free
+    assert(q.GetReadable() == 100);
+    assert(q.WriteAll(buf, 28));
+    assert(!q.WriteAll(buf, 1));
+
+    u8 out[128];
+    assert(!q.ReadAll(out, 129));
+    assert(q.GetReadable() == 128);
+    assert(q.ReadAll(out, 100));
+    for (u32 i = 0; i < 100; ++i) assert(out[i] == buf[i]);
+    assert(!q.ReadAll(out, 29));
+    assert(q.ReadAll(out, 28));
+    for (u32 i = 0; i < 28; ++i) assert(out[i] == buf[i]);
+    assert(q.GetReadable() == 0);
+  }
+
+  struct QueueStreamArgs {
+    TestQueue * queue;
+    u32 chunk;
+    bool blocking;
+    bool nap;
+  };
+
+  static void * WriteStream(void * arg)
+  {
+    QueueStreamArgs & a = *(QueueStreamArgs *) arg;
+    u8 buf[512];
+    for (u32 at = 0; at < STREAM_BYTES; )
+    {
+      u32 len = STREAM_BYTES - at;
+      if (len > a.chunk) len = a.chunk;
+      for (u32 i = 0; i < len; ++i) buf[i] = StreamByte(at + i);
+      if (a.blocking)
+      {
+        a.queue->WriteBlocking(buf, len);
+        at += len;
+      }
+      else
+      {
+        at += a.queue->Write(buf, len);
+      }
+      if (a.nap && (at & 0xfff) < len) usleep(100);
+    }
+    return 0;
+  }
+
+  static void ReadStream(TestQueue & q, u32 chunk, bool blocking, bool nap)
+  {
+    u8 buf[512];
+    for (u32 at = 0; at < STREAM_BYTES; )
+    {
+      u32 len = STREAM_BYTES - at;
+      if (len > chunk) len = chunk;
+      u32 got;
+      if (blocking)
+      {
+        q.ReadBlocking(buf, len);
+        got = len;
+      }
+      else
+      {
+        got = q.Read(buf, len);
+      }
+      for (u32 i = 0; i < got; ++i) assert(buf[i] == StreamByte(at + i));
+      at += got;
+      if (nap && (at & 0xfff) < got) usleep(100);
+    }
+  }
+
+  static void RunStream(u32 writeChunk, bool writeBlocking, bool writeNap,
+                        u32 readChunk, bool readBlocking, bool readNap)
+  {
+    TestQueue q;
+    QueueStreamArgs a;
+    a.queue = &q;
+    a.chunk = writeChunk;
+    a.blocking = writeBlocking;
+    a.nap = writeNap;
+
+    pthread_t writer;
+    const s32 created = pthread_create(&writer, NULL, WriteStream, &a);
+    assert(created == 0);
+    ReadStream(q, readChunk, readBlocking, readNap);
+    const s32 joined = pthread_join(writer, NULL);
+    assert(joined == 0);
+    assert(q.GetReadable() == 0);
+  }
+
+  void SPSCQueue_Test::Test_queueNonBlockingRead()
+  {
+    // Both sides spin, in mismatched batch sizes
+    RunStream(8, false, false, 13, false, false);
+    RunStream(100, false, false, 3, false, false);
+  }
+
+  void SPSCQueue_Test::Test_queueBlockingRead()
+  {
+    // A slow writer in 8-byte chunks, as in the thdque spike, and a
+    // reader that must sleep for them
+    RunStream(8, false, true, 8, true, false);
+    // Reads bigger than the whole queue
+    RunStream(64, false, false, 300, true, false);
+  }
+
+  void SPSCQueue_Test::Test_queueBlockingWrite()
+  {
+    // A slow reader, so the writer must sleep for room
+    RunStream(300, true, false, 17, false, true);
+    RunStream(29, true, false, 31, true, false);
+  }
+}
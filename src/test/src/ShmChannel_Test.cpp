@@ -0,0 +1,117 @@
+#include "assert.h"
+#include "ShmChannel_Test.h"
+#include "itype.h"
+#include <string.h>     // For memcmp
+#include <stdio.h>      // For snprintf
+#include <unistd.h>     // For fork, getpid, _exit
+#include <sys/wait.h>   // For waitpid
+
+namespace MFM {
+
+  static void MakeName(char * buf, u32 size, const char * tag) {
+    snprintf(buf, size, "/mfmtest-%s-%d", tag, (int) getpid());
+  }
+
+  void ShmChannel_Test::Test_Basic() {
+    char name[64];
+    MakeName(name, sizeof(name), "basic");
+    ShmChannel sa(name, true);    // The A side lives here..
+    ShmChannel sb(name, false);   // ..and B 'in another process'
+    sa.Unlink();
+
+    assert(sa.CanRead(true) == 0);
+    assert(sa.CanWrite(true) == ShmChannel::BUFFER_SIZE - 1);
+
+    const char * msg = "Sconnected";
+    const u32 len = strlen(msg);
+    assert(sa.Write(true, (const u8 *) msg, len) == len);
+    assert(sb.CanRead(false) == len);   // No pumping needed
+
+    u8 buf[100];
+    assert(sb.Read(false, buf, sizeof(buf)) == len);
+    assert(!memcmp(buf, msg, len));
+    assert(sb.CanRead(false) == 0);
+
+    // And back, crossing the ring's end a few times
+    for (u32 round = 0; round < 5; ++round) {
+      u8 out[3000];
+      for (u32 i = 0; i < sizeof(out); ++i) out[i] = (u8) (i * 7 + round);
+      assert(sb.Write(false, out, sizeof(out)) == sizeof(out));
+
+      u8 in[3000];
+      assert(sa.Read(true, in, sizeof(in)) == sizeof(in));
+      assert(!memcmp(in, out, sizeof(out)));
+    }
+
+    // Full is full
+    u8 big[ShmChannel::BUFFER_SIZE];
+    memset(big, 0, sizeof(big));
+    assert(sa.Write(true, big, sizeof(big)) == ShmChannel::BUFFER_SIZE - 1);
+    assert(sa.CanWrite(true) == 0);
+  }
+
+  void ShmChannel_Test::Test_Spans() {
+    char name[64];
+    MakeName(name, sizeof(name), "spans");
+    ShmChannel sa(name, true);
+    ShmChannel sb(name, false);
+    sa.Unlink();
+
+    u8 * wspan;
+    u32 room = sa.ReserveWrite(true, wspan);
+    assert(room > 4);
+    memcpy(wspan, "abcd", 4);
+    sa.CommitWrite(true, 4);
+
+    const u8 * rspan;
+    assert(sb.PeekRead(false, rspan) == 4);
+    assert(!memcmp(rspan, "abcd", 4));
+    sb.ConsumeRead(false, 2);
+    assert(sb.CanRead(false) == 2);
+    assert(sb.PeekRead(false, rspan) == 2 && rspan[0] == 'c');
+    sb.ConsumeRead(false, 2);
+    assert(sb.CanRead(false) == 0);
+
+    // Nothing arriving: the wait times out empty
+    assert(sb.WaitForInput(false, 1000) == 0);
+  }
+
+  void ShmChannel_Test::Test_Processes() {
+    char name[64];
+    MakeName(name, sizeof(name), "procs");
+    ShmChannel sa(name, true);
+
+    pid_t pid = fork();
+    assert(pid >= 0);
+    if (pid == 0) {
+      // Child: be side B, echo one message back doubled, and leave
+      ShmChannel sb(name, false);
+      while (sb.WaitForInput(false, 1000000) < 4) { }
+      u8 buf[4];
+      sb.Read(false, buf, sizeof(buf));
+      for (u32 i = 0; i < 2; ++i) sb.Write(false, buf, sizeof(buf));
+      _exit(0);
+    }
+
+    sa.Write(true, (const u8 *) "ping", 4);
+    u8 back[8];
+    u32 got = 0;
+    while (got < sizeof(back)) {
+      sa.WaitForInput(true, 1000000);
+      got += sa.Read(true, back + got, sizeof(back) - got);
+    }
+    assert(!memcmp(back, "pingping", 8));
+
+    int status;
+    assert(waitpid(pid, &status, 0) == pid);
+    assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    sa.Unlink();
+  }
+
+  void ShmChannel_Test::Test_RunTests() {
+    Test_Basic();
+    Test_Spans();
+    Test_Processes();
+  }
+
+} /* namespace MFM */
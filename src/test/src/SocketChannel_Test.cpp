@@ -0,0 +1,100 @@
+#include "assert.h"
+#include "SocketChannel_Test.h"
+#include "itype.h"
+#include <string.h>     // For memcmp
+#include <sys/socket.h> // For socketpair
+
+namespace MFM {
+
+  static void MakePair(s32 & a, s32 & b) {
+    int fds[2];
+    assert(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+    a = fds[0];
+    b = fds[1];
+  }
+
+  void SocketChannel_Test::Test_Basic() {
+    s32 fa, fb;
+    MakePair(fa, fb);
+    SocketChannel sa(fa, true);   // The A side lives here..
+    SocketChannel sb(fb, false);  // ..and B 'in another process'
+
+    assert(sa.IsOpen() && sb.IsOpen());
+    assert(sa.CanRead(true) == 0);
+    assert(sa.CanWrite(true) == SocketChannel::BUFFER_SIZE - 1);
+
+    const char * msg = "Sconnected";
+    const u32 len = strlen(msg);
+    assert(sa.Write(true, (const u8 *) msg, len) == len);
+    assert(sb.CanRead(false) == 0);   // Nothing moves until pumped
+
+    assert(sa.Pump());
+    assert(sb.Pump());
+    assert(sb.CanRead(false) == len);
+
+    u8 buf[100];
+    assert(sb.Read(false, buf, sizeof(buf)) == len);
+    assert(!memcmp(buf, msg, len));
+    assert(sa.GetBytesSent() == len && sb.GetBytesReceived() == len);
+
+    // And back, crossing the ring's end a few times
+    for (u32 round = 0; round < 5; ++round) {
+      u8 out[3000];
+      for (u32 i = 0; i < sizeof(out); ++i) out[i] = (u8) (i * 7 + round);
+      assert(sb.Write(false, out, sizeof(out)) == sizeof(out));
+      assert(sb.Pump());
+      sa.Pump();
+
+      u8 in[3000];
+      u32 got = 0;
+      while (got < sizeof(in)) {
+        got += sa.Read(true, in + got, sizeof(in) - got);
+        if (got < sizeof(in)) sa.Pump();
+      }
+      assert(!memcmp(in, out, sizeof(out)));
+    }
+  }
+
+  void SocketChannel_Test::Test_Spans() {
+    s32 fa, fb;
+    MakePair(fa, fb);
+    SocketChannel sa(fa, true);
+    SocketChannel sb(fb, false);
+
+    u8 * wspan;
+    u32 room = sa.ReserveWrite(true, wspan);
+    assert(room > 4);
+    memcpy(wspan, "abcd", 4);
+    sa.CommitWrite(true, 4);
+    sa.Pump();
+    sb.Pump();
+
+    const u8 * rspan;
+    assert(sb.PeekRead(false, rspan) == 4);
+    assert(!memcmp(rspan, "abcd", 4));
+    sb.ConsumeRead(false, 2);
+    assert(sb.CanRead(false) == 2);
+    assert(sb.PeekRead(false, rspan) == 2 && rspan[0] == 'c');
+    sb.ConsumeRead(false, 2);
+    assert(sb.CanRead(false) == 0);
+  }
+
+  void SocketChannel_Test::Test_Closed() {
+    s32 fa, fb;
+    MakePair(fa, fb);
+    SocketChannel * sa = new SocketChannel(fa, true);
+    SocketChannel sb(fb, false);
+    delete sa;
+
+    assert(!sb.Pump());
+    assert(!sb.IsOpen());
+    assert(!sb.Pump());   // Stays quietly closed
+  }
+
+  void SocketChannel_Test::Test_RunTests() {
+    Test_Basic();
+    Test_Spans();
+    Test_Closed();
+  }
+
+} /* namespace MFM */
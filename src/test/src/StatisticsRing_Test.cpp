@@ -0,0 +1,63 @@
+#include "assert.h"
+#include "StatisticsRing_Test.h"
+#include "Test_Common.h"
+
+namespace MFM {
+
+  void StatisticsRing_Test::Test_RunTests()
+  {
+    Test_ringAppendGet();
+    Test_ringOverwrite();
+  }
+
+  void StatisticsRing_Test::Test_ringAppendGet()
+  {
+    StatisticsRing<4, 3> ring;
+    assert(ring.GetCount() == 0);
+
+    u64 * a = ring.Append(3);
+    a[0] = 10; a[1] = 11; a[2] = 12;
+    u64 * b = ring.Append(1);
+    assert(b[0] == 0);   // Starts out zero
+    b[0] = 20;
+    assert(ring.GetCount() == 2);
+    assert(!ring.IsFull());
+
+    u32 n;
+    const u64 * s = ring.Get(0, n);
+    assert(n == 3 && s[0] == 10 && s[2] == 12);
+    s = ring.Get(1, n);
+    assert(n == 1 && s[0] == 20);
+
+    unwind_protect(
+    {
+      assert(MFMThrownFailCode == MFM_FAIL_CODE_NUMBER(ILLEGAL_ARGUMENT));
+    },
+    {
+      ring.Append(4);
+      assert(0);
+    });
+
+    ring.Clear();
+    assert(ring.GetCount() == 0);
+    assert(ring.GetDroppedCount() == 0);
+  }
+
+  void StatisticsRing_Test::Test_ringOverwrite()
+  {
+    StatisticsRing<3, 1> ring;
+    for (u32 i = 0; i < 5; ++i)
+    {
+      ring.Append(1)[0] = i;
+    }
+    assert(ring.IsFull());
+    assert(ring.GetDroppedCount() == 2);
+
+    // The oldest two were overwritten
+    for (u32 i = 0; i < 3; ++i)
+    {
+      u32 n;
+      assert(ring.Get(i, n)[0] == i + 2);
+    }
+  }
+} /* namespace MFM */
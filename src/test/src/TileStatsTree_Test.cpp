@@ -0,0 +1,123 @@
+#include "assert.h"
+#include "TileStatsTree_Test.h"
+#include "itype.h"
+#include <pthread.h>
+
+namespace MFM {
+
+  void TileStatsTree_Test::Test_RunTests() {
+    Test_treeShape();
+    Test_treeTotals();
+    Test_treeConcurrentPublish();
+  }
+
+  void TileStatsTree_Test::Test_treeShape()
+  {
+    TileStatsTree t;
+    t.Init(1, 0);
+    assert(t.GetLeafCount() == 1);
+    assert(t.GetDepth() == 1);  // The leaf is the root
+    assert(t.GetCounterCount() == TileStatsTree::STANDARD_COUNTERS);
+
+    t.Init(TileStatsTree::FANOUT, 3);
+    assert(t.GetDepth() == 2);
+    assert(t.GetCounterCount() == TileStatsTree::STANDARD_COUNTERS + 3);
+
+    t.Init(TileStatsTree::FANOUT * TileStatsTree::FANOUT + 1, 0);
+    assert(t.GetDepth() == 4);
+  }
+
+  void TileStatsTree_Test::Test_treeTotals()
+  {
+    TileStatsTree t;
+    t.Init(20, 2);
+    const u32 n = t.GetCounterCount();
+    u64 values[TileStatsTree::STANDARD_COUNTERS + 2] = { 0 };
+
+    for (u32 c = 0; c < n; ++c)
+    {
+      assert(t.GetTotal(c) == 0);
+    }
+
+    // Totals follow the leaves' latest values, not their sum over time
+    for (u32 leaf = 0; leaf < 20; ++leaf)
+    {
+      values[TileStatsTree::EVENTS] = leaf;
+      values[n - 1] = 5;
+      t.Publish(leaf, values);
+    }
+    assert(t.GetTotal(TileStatsTree::EVENTS) == 190);
+    assert(t.GetTotal(n - 1) == 100);
+    assert(t.GetLeafValue(7, TileStatsTree::EVENTS) == 7);
+
+    values[TileStatsTree::EVENTS] = 1007;
+    values[n - 1] = 5;
+    t.Publish(7, values);
+    assert(t.GetTotal(TileStatsTree::EVENTS) == 1190);
+    assert(t.GetTotal(n - 1) == 100);
+
+    // Counters can go down
+    values[n - 1] = 0;
+    t.Publish(7, values);
+    assert(t.GetTotal(n - 1) == 95);
+
+    // Init starts over
+    t.Init(20, 2);
+    assert(t.GetTotal(TileStatsTree::EVENTS) == 0);
+  }
+
+  enum { PUBLISHERS = 12, PUBLISHES = 20000 };
+
+  struct PublisherArg
+  {
+    TileStatsTree * m_tree;
+    u32 m_leaf;
+  };
+
+  static void * Publisher(void * arg)
+  {
+    PublisherArg & pa = *(PublisherArg *) arg;
+    u64 values[TileStatsTree::STANDARD_COUNTERS] = { 0 };
+    for (u32 i = 1; i <= PUBLISHES; ++i)
+    {
+      values[TileStatsTree::EVENTS] = i;
+      values[TileStatsTree::ADVANCES] = 2 * i;
+      pa.m_tree->Publish(pa.m_leaf, values);
+    }
+    return 0;
+  }
+
+  void TileStatsTree_Test::Test_treeConcurrentPublish()
+  {
+    TileStatsTree t;
+    t.Init(PUBLISHERS, 0);
+
+    PublisherArg args[PUBLISHERS];
+    pthread_t threads[PUBLISHERS];
+    for (u32 i = 0; i < PUBLISHERS; ++i)
+    {
+      args[i].m_tree = &t;
+      args[i].m_leaf = i;
+      const s32 created = pthread_create(&threads[i], NULL, Publisher, &args[i]);
+      assert(created == 0);
+    }
+
+    // Totals read mid-flight never run ahead of what was published
+    u64 last = 0;
+    for (u32 i = 0; i < 1000; ++i)
+    {
+      const u64 now = t.GetTotal(TileStatsTree::EVENTS);
+      assert(now >= last);
+      assert(now <= (u64) PUBLISHERS * PUBLISHES);
+      last = now;
+    }
+
+    for (u32 i = 0; i < PUBLISHERS; ++i)
+    {
+      const s32 joined = pthread_join(threads[i], NULL);
+      assert(joined == 0);
+    }
+    assert(t.GetTotal(TileStatsTree::EVENTS) == (u64) PUBLISHERS * PUBLISHES);
+    assert(t.GetTotal(TileStatsTree::ADVANCES) == 2 * (u64) PUBLISHERS * PUBLISHES);
+  }
+}
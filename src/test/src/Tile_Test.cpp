@@ -3,12 +3,252 @@
 #include "Point.h"
 #include "Tile_Test.h"
 #include "Element_Res.h"
+#include "Element_Dreg.h"
+#include "DynamicTile.h"
+#include "EventAgeIndex.h"
+#include "TileSiteOwners.h"
+#include "TileSweeper.h"
+#include <time.h>  /* For clock_gettime */
 
 namespace MFM {
 
   void Tile_Test::Test_RunTests() {
     Test_tileSquareDistances();
     Test_tilePlaceAtom();
+    Test_tileSiteLayouts();
+    Test_tileSiteFeatures();
+    Test_tileBaseLayer();
+    Test_tileAtomCounts();
+    Test_tileChangeStamps();
+    Test_tileAgedEvents();
+    Test_tileSizedGeometry();
+    Test_tileDynamic();
+    Test_tileParameterSource();
+    Test_tileSiteOwners();
+    Test_tileSiteSpans();
+    Test_tileRegionAtReach();
+    Test_tileSweeper();
+  }
+
+  /* The directions RegionAtReach reported before it used tables */
+  static u32 ReferenceRegionAtReach(u32 x, u32 y, u32 w, u32 h, u32 reach,
+                                    bool staggered, THREEDIR & dirs)
+  {
+    u32 count = 0;
+    const bool north = y < reach, south = y >= h - reach;
+    if (x < reach || x >= w - reach)
+    {
+      const bool west = x < reach;
+      if (north || south)
+      {
+        dirs[count++] = west ? (north ? Dirs::NORTHWEST : Dirs::SOUTHWEST)
+                             : (north ? Dirs::NORTHEAST : Dirs::SOUTHEAST);
+      }
+      dirs[count++] = west ? Dirs::WEST : Dirs::EAST;
+      if ((north || south) && !staggered)
+      {
+        dirs[count++] = north ? Dirs::NORTH : Dirs::SOUTH;
+      }
+    }
+    else if (!staggered)
+    {
+      if (north || south) dirs[count++] = north ? Dirs::NORTH : Dirs::SOUTH;
+    }
+    else if (north || south)
+    {
+      const bool center = x >= w/2 - reach && x < w/2 + reach;
+      if (center || x < w/2)
+        dirs[count++] = north ? Dirs::NORTHWEST : Dirs::SOUTHWEST;
+      if (center || x >= w/2)
+        dirs[count++] = north ? Dirs::NORTHEAST : Dirs::SOUTHEAST;
+    }
+    return count;
+  }
+
+  void Tile_Test::Test_tileSiteSpans()
+  {
+    const u32 R = TestEventConfig::EVENT_WINDOW_RADIUS;
+    DynamicTile<TestEventConfig> tile(40, 30);
+    const Tile<TestEventConfig> & ctile = tile;
+
+    ElementTypeNumberMap<TestEventConfig> etnm;
+    Element_Dreg<TestEventConfig>::THE_INSTANCE.AllocateType(etnm);
+    tile.RegisterElement(Element_Dreg<TestEventConfig>::THE_INSTANCE);
+    const TestAtom dreg(Element_Dreg<TestEventConfig>::THE_INSTANCE.GetDefaultAtom());
+
+    // Spans cover exactly the sites the iterators visit, in order
+    for (u32 all = 0; all < 2; ++all)
+    {
+      Tile<TestEventConfig>::const_iterator_type i = ctile.begin(all);
+      const Tile<TestEventConfig>::const_iterator_type end = ctile.end(all);
+      assert(ctile.GetSiteSpanCount(all) == (all ? 30 : 30 - 2 * R));
+      for (u32 row = 0; row < ctile.GetSiteSpanCount(all); ++row)
+      {
+        u32 length;
+        const TestSite * sites = ctile.GetSiteSpan(row, all, length);
+        assert(length == (all ? 40 : 40 - 2 * R));
+        assert(ctile.GetSiteSpanOrigin(row, all) == i.AtSite());
+        for (u32 x = 0; x < length; ++x, ++i)
+        {
+          assert(i != end);
+          assert(&sites[x] == &*i);
+        }
+      }
+      assert(!(i != end));
+    }
+    assert(ctile.GetAllSites() == &ctile.GetSite(SPoint(0, 0)));
+    assert(ctile.GetAllSites() + 40 * 30 - 1 == &ctile.GetSite(SPoint(39, 29)));
+
+    // Span sweeps see the same atoms as site lookups
+    tile.PlaceAtom(dreg, SPoint(R, R));
+    tile.PlaceAtom(dreg, SPoint(40 - R - 1, 30 - R - 1));
+    tile.PlaceAtom(dreg, SPoint(20, 15));
+    assert(tile.GetAtomCount(dreg.GetType()) == 3);
+    u32 length;
+    assert(tile.GetSiteSpan(0, false, length)[0].GetAtom().GetType() == dreg.GetType());
+    assert(tile.GetSiteSpan(15 - R, false, length)[20 - R].GetAtom().GetType() == dreg.GetType());
+
+    tile.Thin(1);
+    assert(tile.GetAtomCount(dreg.GetType()) == 0);
+    tile.PlaceAtom(dreg, SPoint(20, 15));
+    tile.ClearAtoms();
+    assert(tile.GetAtomCount(dreg.GetType()) == 0);
+  }
+
+  void Tile_Test::Test_tileSweeper()
+  {
+    const u32 R = TestEventConfig::EVENT_WINDOW_RADIUS;
+    DynamicTile<TestEventConfig> tile(40, 30);
+
+    ElementTypeNumberMap<TestEventConfig> etnm;
+    Element_Res<TestEventConfig>::THE_INSTANCE.AllocateType(etnm);
+    Element_Dreg<TestEventConfig>::THE_INSTANCE.AllocateType(etnm);
+    tile.RegisterElement(Element_Res<TestEventConfig>::THE_INSTANCE);
+    tile.RegisterElement(Element_Dreg<TestEventConfig>::THE_INSTANCE);
+    const TestAtom res(Element_Res<TestEventConfig>::THE_INSTANCE.GetDefaultAtom());
+
+    TileSweeper<TestEventConfig> sweeper;
+    assert(sweeper.Prepare(tile) == 3);  // Empty, Res and Dreg
+
+    // One event per owned site, all run by the kernel
+    const u32 owned = (40 - 2 * R) * (30 - 2 * R);
+    const SPoint start(20, 15);
+    tile.PlaceAtom(res, start);
+    for (u32 i = 0; i < 10; ++i)
+    {
+      assert(sweeper.Sweep(tile, i) == owned);
+    }
+    assert(sweeper.GetKernelEvents() == 10 * owned);
+    assert(sweeper.GetFallbackEvents() == 0);
+    assert(tile.GetSweptEvents() == 10 * owned);
+
+    // Res only diffuses: it's still here, somewhere else
+    assert(tile.GetAtomCount(res.GetType()) == 1);
+    assert(tile.GetAtom(start)->GetType() != res.GetType());
+
+    // Kernel draws are a function of their arguments alone
+    assert(TileSweeper<TestEventConfig>::Draw(1, 2, 3) ==
+           TileSweeper<TestEventConfig>::Draw(1, 2, 3));
+    assert(TileSweeper<TestEventConfig>::Draw(1, 2, 3) !=
+           TileSweeper<TestEventConfig>::Draw(1, 2, 4));
+  }
+
+  void Tile_Test::Test_tileRegionAtReach()
+  {
+    const u32 R = TestEventConfig::EVENT_WINDOW_RADIUS;
+    const u32 W = 40, H = 30;
+    for (u32 s = 0; s < 2; ++s)
+    {
+      DynamicTile<TestEventConfig> tile(W, H, s ? GRID_LAYOUT_STAGGERED : GRID_LAYOUT_CHECKERBOARD);
+      // The tabled reaches, and a couple that aren't
+      for (u32 reach = R; reach <= 3 * R + 1; ++reach)
+      {
+        for (u32 y = 0; y < H; ++y)
+        {
+          for (u32 x = 0; x < W; ++x)
+          {
+            THREEDIR got, want;
+            const u32 count = tile.RegionAtReach(SPoint(x, y), reach, got, false);
+            assert(count == ReferenceRegionAtReach(x, y, W, H, reach, s != 0, want));
+            for (u32 i = 0; i < count; ++i)
+            {
+              assert(got[i] == want[i]);
+            }
+
+            // Nothing is connected in a lone tile
+            assert(tile.RegionAtReach(SPoint(x, y), reach, got, true) == 0);
+          }
+        }
+      }
+      THREEDIR dirs;
+      assert(tile.GetAllLockDirections(SPoint(0, 0), 1, dirs) == (s ? 2u : 3u));
+      assert(dirs[0] == Dirs::NORTHWEST && dirs[1] == Dirs::WEST);
+      assert(tile.GetLockDirections(SPoint(0, 0), 1, dirs) == 0);
+    }
+  }
+
+  void Tile_Test::Test_tileDynamic()
+  {
+    const u32 R = TestEventConfig::EVENT_WINDOW_RADIUS;
+    DynamicTile<TestEventConfig> tile(64, 48);
+    assert(tile.TILE_WIDTH == 64 && tile.TILE_HEIGHT == 48);
+    assert(tile.OWNED_WIDTH == 64 - 2 * R && tile.OWNED_HEIGHT == 48 - 2 * R);
+    assert(tile.GetSites() == tile.OWNED_WIDTH * tile.OWNED_HEIGHT);
+    assert(tile.IsInHidden(SPoint(32, 24)) && tile.IsInCache(SPoint(63, 24)));
+
+    ElementTypeNumberMap<TestEventConfig> etnm;
+    Element_Dreg<TestEventConfig>::THE_INSTANCE.AllocateType(etnm);
+    Element_Res<TestEventConfig>::THE_INSTANCE.AllocateType(etnm);
+    tile.RegisterElement(Element_Dreg<TestEventConfig>::THE_INSTANCE);
+    tile.RegisterElement(Element_Res<TestEventConfig>::THE_INSTANCE);
+    const TestAtom dreg(Element_Dreg<TestEventConfig>::THE_INSTANCE.GetDefaultAtom());
+
+    // The far corner of the owned sites is a real site
+    const SPoint corner(64 - R - 1, 48 - R - 1);
+    tile.PlaceAtom(dreg, corner);
+    assert(tile.GetAtom(corner)->GetType() == dreg.GetType());
+    assert(&tile.GetSite(corner) == &tile.GetUncachedSite(corner - SPoint(R, R)));
+
+    // And events run all over it
+    TestEventWindow & ew = tile.GetEventWindow();
+    for (u32 i = 0; i < 10000; ++i)
+    {
+      ew.TryEventAtForTesting(tile.GetRandomOwnedCoord());
+    }
+    assert(ew.GetEventWindowsExecuted() > 0);
+  }
+
+  void Tile_Test::Test_tileSizedGeometry()
+  {
+    TestTile * tile = new TestTile();
+    Tile<TestEventConfig> & base = *tile;
+
+    assert(TestTile::OWNED_WIDTH == base.OWNED_WIDTH);
+    assert(TestTile::OWNED_HEIGHT == base.OWNED_HEIGHT);
+
+    // The compile-time answers must match the runtime ones everywhere
+    for (s32 y = -1; y <= (s32) TestTile::TILE_HEIGHT; ++y)
+    {
+      for (s32 x = -1; x <= (s32) TestTile::TILE_WIDTH; ++x)
+      {
+        const SPoint pt(x, y);
+        assert(TestTile::IsInTile(pt) == base.IsInTile(pt));
+        assert(TestTile::IsInUncachedTile(pt) == base.IsInUncachedTile(pt));
+        if (!base.IsInTile(pt)) continue;
+
+        assert(TestTile::IsInCache(pt) == base.IsInCache(pt));
+        assert(TestTile::IsInShared(pt) == base.IsInShared(pt));
+        assert(TestTile::IsInHidden(pt) == base.IsInHidden(pt));
+        assert(TestTile::IsOwnedSite(pt) == base.IsOwnedSite(pt));
+        assert(TestTile::RegionIn(pt) == base.RegionIn(pt));
+
+        const u32 sn = TestTile::GetSiteInTileNumber(pt);
+        assert(sn == base.GetSiteInTileNumber(pt));
+        assert(TestTile::GetCoordOfSiteInTileNumber(sn) == base.GetCoordOfSiteInTileNumber(sn));
+        assert(&tile->GetSite(pt) == &base.GetSite(pt));
+      }
+    }
+    delete tile;
   }
 
   void Tile_Test::Test_tileSquareDistances()
@@ -58,4 +298,341 @@ namespace MFM {
 
     assert(other.GetType() == atom.GetType());
   }
+
+  /**
+     Fill every other owned site of \c tile with Res, then load
+     seeded-random event windows; return the seconds taken and sum
+     the loaded atom types into \c checksum.
+   */
+  template <class EC, class TILE>
+  static double TimeWindowLoads(TILE & tile, u32 events, u32 & checksum)
+  {
+    typedef typename EC::ATOM_CONFIG::ATOM_TYPE T;
+    ElementTypeNumberMap<EC> etnm;
+    Element_Res<EC>::THE_INSTANCE.AllocateType(etnm);
+    tile.RegisterElement(Element_Res<EC>::THE_INSTANCE);
+
+    const T res(Element_Res<EC>::THE_INSTANCE.GetDefaultAtom());
+    for (u32 i = 0; i < tile.GetSites(); i += 2)
+    {
+      tile.PlaceInternalAtom(res, SPoint(i % tile.OWNED_WIDTH, i / tile.OWNED_WIDTH));
+    }
+
+    EventWindow<EC> & ew = tile.GetEventWindow();
+    Random random(1);
+    tile.GetRandom().SetSeed(1);
+    checksum = 0;
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (u32 e = 0; e < events; ++e)
+    {
+      SPoint center = Tile<EC>::OwnedCoordToTile(SPoint(random, tile.OWNED_WIDTH, tile.OWNED_HEIGHT));
+      if (ew.TryEventAtForProfiling(center))
+      {
+        for (u32 i = 0; i < ew.GetBoundedSiteCount(); ++i)
+        {
+          checksum += ew.GetAtomDirect(i).GetType();
+        }
+      }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1.0e9;
+  }
+
+  void Tile_Test::Test_tileSiteLayouts()
+  {
+    // Tiles are big; keep them off the stack
+    static TestTile interleaved;
+    static TestPlanarTile planar;
+
+    // Same API, same results
+    const u32 EVENTS = 200000;
+    u32 interleavedSum, planarSum;
+    double interleavedSecs = TimeWindowLoads<TestEventConfig>(interleaved, EVENTS, interleavedSum);
+    double planarSecs = TimeWindowLoads<TestPlanarEventConfig>(planar, EVENTS, planarSum);
+    assert(interleavedSum == planarSum);
+
+    SPoint loc(10, 10);
+    assert(planar.GetAtom(loc)->GetType() == interleaved.GetAtom(loc)->GetType());
+    TestAtom empty;
+    planar.PlaceAtom(empty, loc);
+    assert(planar.GetAtom(loc)->GetType() == empty.GetType());
+
+    // Report, not assert: timing depends on the host
+    LOG.Message("Window loads: interleaved %d-byte sites %dns/event, planar %d-byte atoms %dns/event",
+                (u32) sizeof(TestSite), (u32) (interleavedSecs * 1.0e9 / EVENTS),
+                (u32) sizeof(TestAtom), (u32) (planarSecs * 1.0e9 / EVENTS));
+  }
+
+  void Tile_Test::Test_tileSiteFeatures()
+  {
+    // Leaving out the bookkeeping saves its memory...
+    assert(sizeof(TestLeanSite) < sizeof(TestSite));
+    assert(sizeof(TestLeanSite::BASE) < sizeof(TestSite::BASE));
+    assert((u32) TestLeanEventConfig::SITE_FEATURES == (u32) SITE_FEATURES_NONE);
+    assert((u32) TestEventConfig::SITE_FEATURES == (u32) SITE_FEATURES_ALL);
+
+    // ...and its stores, which read back as defaults
+    TestLeanSite lean;
+    TestSite full;
+    lean.RecordEventAtSite(17);
+    full.RecordEventAtSite(17);
+    assert(lean.GetEventCount() == 0 && lean.GetLastEventNumber() == 0);
+    assert(full.GetEventCount() == 1 && full.GetLastEventNumber() == 17);
+    lean.Sense(TOUCH_TYPE_HEAVY);
+    full.Sense(TOUCH_TYPE_HEAVY);
+    assert(lean.RecentTouch() == TOUCH_TYPE_NONE);
+    assert(full.RecentTouch() == TOUCH_TYPE_HEAVY);
+    lean.SetPaint(0xff123456);
+    full.SetPaint(0xff123456);
+    assert(lean.GetPaint() == 0xff000000);
+    assert(full.GetPaint() == 0xff123456);
+
+    // Events themselves don't change
+    static TestTile fullTile;
+    static TestLeanTile leanTile;
+    const u32 EVENTS = 20000;
+    u32 fullSum, leanSum;
+    TimeWindowLoads<TestEventConfig>(fullTile, EVENTS, fullSum);
+    TimeWindowLoads<TestLeanEventConfig>(leanTile, EVENTS, leanSum);
+    assert(fullSum == leanSum);
+  }
+
+  void Tile_Test::Test_tileBaseLayer()
+  {
+    typedef EventWindow<TestPlanarEventConfig> PlanarEventWindow;
+    DynamicTile<TestPlanarEventConfig> tile(32, 32);
+    ElementTypeNumberMap<TestPlanarEventConfig> etnm;
+    Element_Dreg<TestPlanarEventConfig>::THE_INSTANCE.AllocateType(etnm);
+    Element_Res<TestPlanarEventConfig>::THE_INSTANCE.AllocateType(etnm);
+    tile.RegisterElement(Element_Dreg<TestPlanarEventConfig>::THE_INSTANCE);
+    tile.RegisterElement(Element_Res<TestPlanarEventConfig>::THE_INSTANCE);
+    const TestAtom dreg(Element_Dreg<TestPlanarEventConfig>::THE_INSTANCE.GetDefaultAtom());
+
+    const SPoint loc(12, 12);
+    const TestPlanarSite & site = tile.GetSite(loc);
+    assert(!site.HasOwnBase());
+    assert(site.GetPaint() == 0xff000000);
+
+    // Atom-only events never write a Base, so never allocate any
+    tile.PlaceAtom(dreg, loc);
+    PlanarEventWindow & ew = tile.GetEventWindow();
+    for (u32 i = 0; i < 10000; ++i)
+    {
+      ew.TryEventAtForTesting(tile.GetRandomOwnedCoord());
+    }
+    assert(ew.GetEventWindowsExecuted() > 0);
+    assert(!site.HasOwnBase());
+
+    // The first write gives every site of the tile its own copy
+    tile.GetSite(loc).SetPaint(0xff123456);
+    assert(site.HasOwnBase());
+    assert(site.GetPaint() == 0xff123456);
+    assert(tile.GetSite(SPoint(13, 12)).GetPaint() == 0xff000000);
+
+    // And events carry it along
+    for (u32 i = 0; i < 10000; ++i)
+    {
+      ew.TryEventAtForTesting(tile.GetRandomOwnedCoord());
+    }
+    assert(site.GetPaint() == 0xff123456);
+  }
+
+  void Tile_Test::Test_tileAtomCounts()
+  {
+    TestTile tile;
+    ElementTypeNumberMap<TestEventConfig> etnm;
+    Element_Res<TestEventConfig>::THE_INSTANCE.AllocateType(etnm);
+    Element_Dreg<TestEventConfig>::THE_INSTANCE.AllocateType(etnm);
+    tile.RegisterElement(Element_Res<TestEventConfig>::THE_INSTANCE);
+    tile.RegisterElement(Element_Dreg<TestEventConfig>::THE_INSTANCE);
+
+    const u32 RES_TYPE = Element_Res<TestEventConfig>::THE_INSTANCE.GetType();
+    const u32 DREG_TYPE = Element_Dreg<TestEventConfig>::THE_INSTANCE.GetType();
+    const u32 EMPTY_TYPE = Element_Empty<TestEventConfig>::THE_INSTANCE.GetType();
+    const TestAtom res(Element_Res<TestEventConfig>::THE_INSTANCE.GetDefaultAtom());
+    const TestAtom dreg(Element_Dreg<TestEventConfig>::THE_INSTANCE.GetDefaultAtom());
+
+    const u32 OWNED = tile.OWNED_WIDTH * tile.OWNED_HEIGHT;
+    assert(tile.GetAtomCount(EMPTY_TYPE) == OWNED);  // The first query counts from scratch
+
+    // Placements into owned sites are tallied as they happen
+    for (u32 i = 0; i < 10; ++i)
+    {
+      tile.PlaceAtom(res, SPoint(10 + i, 10));
+    }
+    tile.PlaceAtom(dreg, SPoint(10, 10));  // Replaces a Res
+    tile.PlaceAtom(dreg, SPoint(10, 10));  // No change
+    assert(tile.GetAtomCount(RES_TYPE) == 9);
+    assert(tile.GetAtomCount(DREG_TYPE) == 1);
+    assert(tile.GetAtomCount(EMPTY_TYPE) == OWNED - 10);
+
+    // Cache sites are not owned, so not counted
+    tile.PlaceAtom(res, SPoint(1, 10));
+    assert(tile.GetAtomCount(RES_TYPE) == 9);
+
+    // A write the tile can't see forces a rescan, which agrees
+    *tile.GetWritableAtom(SPoint(20, 20)) = dreg;
+    assert(tile.GetAtomCount(DREG_TYPE) == 2);
+    assert(tile.GetAtomCount(EMPTY_TYPE) == OWNED - 11);
+
+    tile.ClearAtoms();
+    assert(tile.GetAtomCount(EMPTY_TYPE) == OWNED);
+    assert(tile.GetAtomCount(RES_TYPE) == 0);
+  }
+
+  void Tile_Test::Test_tileAgedEvents()
+  {
+    const u32 SITES = 100, WARP = 3;
+    EventAgeIndex ages;
+    ages.Init(SITES, WARP);
+
+    // One event at each site in turn, so site s is now 99-s events old
+    for (u32 s = 0; s < SITES; ++s)
+    {
+      ages.RecordEvent(s, s + 1);
+    }
+    assert(ages.GetNow() == SITES);
+    assert(ages.GetWeight(SITES - 1) == WARP * SITES);
+    assert(ages.GetWeight(0) == WARP * SITES + SITES - 1);
+
+    // Picks follow the weights, and few are turned down
+    Random random(1);
+    const u32 PICKS = 200000;
+    u32 kept = 0, oldest = 0, newest = 0;
+    for (u32 i = 0; i < PICKS; ++i)
+    {
+      u32 site;
+      if (!ages.Pick(random, SITES, site)) continue;
+      ++kept;
+      if (site < 10) ++oldest;
+      if (site >= SITES - 10) ++newest;
+    }
+    assert(kept > PICKS * 9 / 10);
+    // Expect the ten oldest to weigh 3945 against the newest's 3045
+    assert(oldest * 100 > newest * 115 && oldest * 100 < newest * 145);
+
+    // Long enough after, every site weighs the cap
+    for (u32 i = 0; i < 1000; ++i)
+    {
+      u32 site;
+      assert(ages.Pick(random, 100 * SITES, site));
+    }
+    for (u32 s = 0; s < SITES; ++s)
+    {
+      assert(ages.GetWeight(s) == EventAgeIndex::MAX_WARP * SITES);
+    }
+
+    // A fresh event moves a site back down, and a rebuild agrees
+    ages.RecordEvent(42, 100 * SITES + 1);
+    assert(ages.GetWeight(42) == WARP * SITES);
+    assert(ages.GetWeight(41) == EventAgeIndex::MAX_WARP * SITES);
+    ages.Rebuild(EventAgeIndex::MAX_WARP, ages.GetNow());
+    assert(ages.GetWeight(42) == EventAgeIndex::MAX_WARP * SITES);
+    assert(ages.GetLastEvent(42) == 100 * SITES + 1);
+
+    // Tiles index their owned sites
+    TestTile tile;
+    assert(!tile.IsUsingAgedEvents());
+    tile.SetAgedEvents(true);
+    assert(tile.IsUsingAgedEvents());
+  }
+
+  void Tile_Test::Test_tileChangeStamps()
+  {
+    TestTile tile;
+    ElementTypeNumberMap<TestEventConfig> etnm;
+    Element_Res<TestEventConfig>::THE_INSTANCE.AllocateType(etnm);
+    tile.RegisterElement(Element_Res<TestEventConfig>::THE_INSTANCE);
+    const TestAtom res(Element_Res<TestEventConfig>::THE_INSTANCE.GetDefaultAtom());
+
+    const u32 SIDE = TestTile::CHANGE_BLOCK_SIDE;
+    const u32 BLOCKS = tile.GetChangeBlockCount();
+    assert(tile.GetChangeBlocksWide() * SIDE >= tile.TILE_WIDTH);
+    assert(tile.GetChangeBlocksHigh() * SIDE >= tile.TILE_HEIGHT);
+
+    u32 before[256];
+    assert(BLOCKS <= 256);
+    for (u32 b = 0; b < BLOCKS; ++b) before[b] = tile.GetChangeBlockStamp(b);
+    const u32 tileBefore = tile.GetChangeStamp();
+
+    // A change bumps just its own block
+    const SPoint loc(SIDE + 2, 2 * SIDE + 1);
+    const u32 block = 2 * tile.GetChangeBlocksWide() + 1;
+    tile.PlaceAtom(res, loc);
+    for (u32 b = 0; b < BLOCKS; ++b)
+      assert((tile.GetChangeBlockStamp(b) != before[b]) == (b == block));
+    assert(tile.GetChangeStamp() == tileBefore);
+
+    // Placing the same atom again is no change
+    const u32 stamp = tile.GetChangeBlockStamp(block);
+    tile.PlaceAtom(res, loc);
+    assert(tile.GetChangeBlockStamp(block) == stamp);
+
+    // Wholesale edits bump the tile stamp instead
+    tile.ClearAtoms();
+    assert(tile.GetChangeStamp() != tileBefore);
+  }
+
+  void Tile_Test::Test_tileParameterSource()
+  {
+    TestTile tile;
+    TileParameterPublisher pub;
+    pub.Set(3, 42);
+
+    // Unsourced, the tile keeps what it's told
+    tile.SetTileParameter(3, 7);
+    assert(tile.GetTileParameter(3) == 7);
+
+    // Sourced, it takes the published block at once..
+    tile.SetTileParameterSource(&pub);
+    assert(tile.GetTileParameter(3) == 42);
+    assert(tile.GetTileParameter(0) == S32_MIN);
+
+    // ..and later blocks only when it next refreshes
+    const TileParameterBlock * old = pub.GetCurrent();
+    pub.Set(0, -5);
+    assert(pub.GetCurrent() != old);
+    assert(old->m_values[0] == S32_MIN);  // Published blocks never change
+    assert(tile.GetTileParameter(0) == S32_MIN);
+    tile.RefreshTileParameters();
+    assert(tile.GetTileParameter(0) == -5);
+    assert(tile.GetTileParameter(3) == 42);
+
+    tile.SetTileParameterSource(0);
+  }
+
+  void Tile_Test::Test_tileSiteOwners()
+  {
+    const u32 R = TestEventConfig::EVENT_WINDOW_RADIUS;
+    const u32 SITES = EVENT_WINDOW_SITES(R);
+    TileSiteOwners owners(100, 40);
+
+    assert(owners.TryClaim(SPoint(10,10), R));
+    assert(owners.GetOwnedCount() == SITES);
+    assert(owners.IsOwned(SPoint(14,10)));
+    assert(!owners.IsOwned(SPoint(15,10)));
+    assert(!owners.IsOwned(SPoint(13,13)));
+
+    // Sharing just (14,10) is enough to be refused
+    assert(!owners.TryClaim(SPoint(18,10), R));
+    assert(owners.GetOwnedCount() == SITES);
+    assert(owners.TryClaim(SPoint(19,10), R));
+
+    // Straddling a word boundary, and clipped at the corner
+    assert(owners.TryClaim(SPoint(64,20), R));
+    assert(owners.IsOwned(SPoint(63,20)) && owners.IsOwned(SPoint(60,20)) && owners.IsOwned(SPoint(68,20)));
+    assert(owners.TryClaim(SPoint(98,1), R));
+    assert(owners.GetOwnedCount() == 3 * SITES + 24);
+
+    owners.Release(SPoint(10,10), R);
+    owners.Release(SPoint(19,10), R);
+    owners.Release(SPoint(64,20), R);
+    owners.Release(SPoint(98,1), R);
+    assert(owners.GetOwnedCount() == 0);
+    assert(owners.TryClaim(SPoint(18,10), R));
+    owners.Release(SPoint(18,10), R);
+  }
+
 } /* namespace MFM */
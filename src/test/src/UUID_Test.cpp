@@ -105,10 +105,33 @@ namespace MFM {
     Test_Vprintf_Read(UUID("X", 1, 2, 3, 4));
   }
 
+  static void Test_Handle() {
+    UUID u1("Handled", 1, 0x20140516, 0x191339, 4);
+    UUID u2("Handled", 1, 0x20140516, 0x191339, 5);
+    UUID u3("Handled", 2, 0x20140516, 0x191339, 4);
+
+    const u32 h1 = u1.GetHandle();
+    assert(h1 != 0);
+    assert(u2.GetHandle() == h1);     // Config code isn't compared
+    assert(u3.GetHandle() != h1);
+    assert(u1 == u2);
+    assert(!(u1 == u3));
+
+    UUID copy = u3;
+    assert(copy.GetHandle() == u3.GetHandle());
+
+    tbuf.Reset();
+    tbuf.Printf("%@", &u1);
+    fbuf.Reset(tbuf.GetZString());
+    copy.Read(fbuf);
+    assert(copy.GetHandle() == h1);   // Re-interned after Read
+  }
+
   void UUID_Test::Test_RunTests() {
     Test_Basic();
     Test_Print();
     Test_Read();
+    Test_Handle();
   }
 
 } /* namespace MFM */
@@ -1,6 +1,8 @@
 #include "assert.h"
 #include "UlamElement_Test.h"
 #include "itype.h"
+#include "Test_Common.h"
+#include "UlamQuark.h"
 
 namespace MFM {
 
@@ -52,6 +54,55 @@ namespace MFM {
       utin.PrintPretty(os,false);
       assert(!strcmp(allCases[i].pretty,os.GetZString()));
     }
+
+    Test_UlamClassMemberFormats();
+  }
+
+  /* A quark with an Unsigned(6) and a Bool, as culam might make it */
+  struct TestQuarkXOk : public UlamQuark<TestEventConfig>
+  {
+    const UlamClassDataMemberInfo m_x;
+    const UlamClassDataMemberInfo m_ok;
+
+    TestQuarkXOk()
+      : m_x("Ut_10161u", "x", "Uq_10104Fail10", 0)
+      , m_ok("Ut_10111b", "ok", "Uq_10104Fail10", 6)
+    { }
+
+    virtual const char * GetMangledClassName() const { return "Uq_10104Fail10"; }
+    virtual u32 GetMangledClassNameAsStringIndex() const { return 0; }
+    virtual u32 GetUlamClassNameAsStringIndex(bool, bool) const { return 0; }
+    virtual u32 GetRegistrationNumber() const { return 0; }
+    virtual u64 getDefaultQuark() const { return 0; }
+    virtual s32 GetDataMemberCount() const { return 2; }
+    virtual const UlamClassDataMemberInfo & GetDataMemberInfo(u32 i) const { return i ? m_ok : m_x; }
+  };
+
+  void UlamElement_Test::Test_UlamClassMemberFormats()
+  {
+    const u32 FLAGS =
+      UlamClassPrintFlags::PRINT_MEMBER_NAMES |
+      UlamClassPrintFlags::PRINT_MEMBER_VALUES |
+      UlamClassPrintFlags::PRINT_MEMBER_TYPES;
+    const u32 BASE = TestAtom::ATOM_FIRST_STATE_BIT;
+
+    TestQuarkXOk quark;
+    UlamClassRegistry<TestEventConfig> ucr;
+    TestAtom atom;
+    atom.GetBits().Write(BASE, 6, 37);
+    atom.GetBits().Write(BASE + 6, 1, 1);
+
+    OString256 parsed;
+    assert(!quark.HasCachedMemberFormats());
+    quark.PrintClassMembers(ucr, parsed, atom, FLAGS, BASE);
+    assert(!strcmp(parsed.GetZString(), "(Unsigned(6) Fail(x=37,Bool ok=true)"));
+
+    // Cached formats print just the same
+    quark.CacheMemberFormats();
+    assert(quark.HasCachedMemberFormats());
+    OString256 cached;
+    quark.PrintClassMembers(ucr, cached, atom, FLAGS, BASE);
+    assert(cached.Equals(parsed));
   }
 
 
@@ -1,5 +1,6 @@
 #include "assert.h"
 #include "UlamRef_Test.h"
+#include "UlamQuark.h"
 #include "itype.h"
 
 namespace MFM {
@@ -43,6 +44,9 @@ namespace MFM {
     Test_UlamRefWrite();
     Test_UlamRefWriteLong();
     Test_UlamRefEffSelf();
+    Test_UlamRefVirtualCallCache();
+    Test_UlamRefFinalHints();
+    Test_UlamRefBitStorageCopy();
   }
 
   void UlamRef_Test::Test_UlamRefRead()
@@ -495,4 +499,107 @@ namespace MFM {
 
 
 
+  void UlamRef_Test::Test_UlamRefVirtualCallCache()
+  {
+    UlamVirtualCallCache vcc;
+    UlamVirtualCallCache::Key key;
+    key.m_effself = 12;
+    key.m_origclass = 3;
+    key.m_funcidx = 2;
+    assert(key.AddChain(12));
+    assert(key.AddChain(5));
+
+    assert(vcc.Find(key) == 0);
+    assert(vcc.GetMisses() == 1);
+
+    UlamVirtualCallCache::Resolution res;
+    res.m_vfunc = 0;
+    res.m_ovclassrelpos = 25;
+    res.m_ovclasslen = 41;
+    res.m_elemental = false;
+    vcc.Insert(key, res);
+
+    const UlamVirtualCallCache::Resolution * hit = vcc.Find(key);
+    assert(hit != 0);
+    assert(hit->m_ovclassrelpos == 25);
+    assert(hit->m_ovclasslen == 41);
+    assert(!hit->m_elemental);
+    assert(vcc.GetHits() == 1);
+
+    // A different callstack is a different key
+    UlamVirtualCallCache::Key other = key;
+    other.m_chain[1] = 6;
+    assert(!(other == key));
+    assert(vcc.Find(other) == 0);
+
+    // And so is naming the same vtable class explicitly
+    other = key;
+    other.m_explicit = true;
+    assert(vcc.Find(other) == 0);
+
+    // Chains beyond MAX_CHAIN are refused
+    other = key;
+    while (other.m_chainlen < UlamVirtualCallCache::MAX_CHAIN)
+      assert(other.AddChain(7));
+    assert(!other.AddChain(7));
+
+    vcc.Clear();
+    assert(vcc.Find(key) == 0);
+  }
+  struct TestQuarkFinal : public UlamQuark<TestEventConfig>
+  {
+    virtual const char * GetMangledClassName() const { return "Uq_10105Final10"; }
+    virtual u32 GetMangledClassNameAsStringIndex() const { return 0; }
+    virtual u32 GetUlamClassNameAsStringIndex(bool, bool) const { return 0; }
+    virtual u32 GetRegistrationNumber() const { return 0; }
+    virtual u64 getDefaultQuark() const { return 0; }
+  };
+
+  void UlamRef_Test::Test_UlamRefFinalHints()
+  {
+    TestQuarkFinal quark;
+    assert(!quark.IsFinalClass());
+    assert(!quark.IsFinalFunction(0));
+
+    // Functions are final one by one
+    quark.SetFinalFunction(3);
+    assert(quark.IsFinalFunction(3));
+    assert(!quark.IsFinalFunction(2));
+    assert(!quark.IsFinalFunction(4));
+    quark.SetFinalFunction(TestQuarkFinal::MAX_FINAL_FUNCTIONS - 1);
+    assert(quark.IsFinalFunction(TestQuarkFinal::MAX_FINAL_FUNCTIONS - 1));
+    assert(!quark.IsFinalFunction(TestQuarkFinal::MAX_FINAL_FUNCTIONS));
+
+    // Past the bitmask, only a final class makes them final
+    bool failed = false;
+    unwind_protect({ failed = true; }, { quark.SetFinalFunction(TestQuarkFinal::MAX_FINAL_FUNCTIONS); });
+    assert(failed);
+
+    // A final class's own functions all are final
+    quark.SetFinalClass();
+    assert(quark.IsFinalClass());
+    assert(quark.IsFinalFunction(2));
+    assert(quark.IsFinalFunction(TestQuarkFinal::MAX_FINAL_FUNCTIONS + 10));
+  }
+
+  void UlamRef_Test::Test_UlamRefBitStorageCopy()
+  {
+    TestAtom t = setup();
+    AtomBitStorage<TestEventConfig> abs(t);
+    BitVectorBitStorage<TestEventConfig, BitVector<200> > bvbs;
+
+    // Known types on both sides
+    BitStorageCopy(abs, 25, bvbs, 101, 71);
+    assert(BitStorageEquals(abs, 25, bvbs, 101, 71));
+    assert(bvbs.Read(101, 32) == abs.Read(25, 32));
+    assert(bvbs.Read(101 + 64, 7) == abs.Read(25 + 64, 7));
+    assert(!BitStorageEquals(abs, 25, bvbs, 100, 71));
+
+    // Through the base class
+    BitVectorBitStorage<TestEventConfig, BitVector<200> > other;
+    BitStorage<TestEventConfig>::CopyBits(bvbs, 101, other, 3, 71);
+    assert(BitStorageEquals(bvbs, 101, other, 3, 71));
+    assert(other.ReadLong(3 + 7, 64) == abs.ReadLong(25 + 7, 64));
+  }
+
 } /* namespace MFM */
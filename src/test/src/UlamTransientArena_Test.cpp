@@ -0,0 +1,73 @@
+#include "assert.h"
+#include "UlamTransientArena_Test.h"
+#include "Test_Common.h"
+#include "BitStorage.h"
+
+namespace MFM {
+
+  void UlamTransientArena_Test::Test_RunTests()
+  {
+    Test_arenaAllocate();
+    Test_arenaMarkRelease();
+    Test_arenaBitStorage();
+  }
+
+  void UlamTransientArena_Test::Test_arenaAllocate()
+  {
+    UlamTransientArena arena;
+    assert(arena.GetUsedBytes() == 0);
+
+    u8 * a = (u8 *) arena.Allocate(1);
+    u8 * b = (u8 *) arena.Allocate(13);
+    assert(b - a == UlamTransientArena::ALIGN_BYTES); // Rounded up
+    assert(((size_t) b) % UlamTransientArena::ALIGN_BYTES == 0);
+    assert(arena.GetUsedBytes() == 3 * UlamTransientArena::ALIGN_BYTES);
+
+    arena.Reset();
+    assert(arena.GetUsedBytes() == 0);
+    assert(arena.Allocate(1) == a);    // Same storage again
+    assert(arena.GetHighWaterBytes() == 3 * UlamTransientArena::ALIGN_BYTES);
+
+    arena.Reset();
+    assert(arena.HasRoom(UlamTransientArena::ARENA_BYTES));
+    arena.Allocate(UlamTransientArena::ARENA_BYTES);
+    assert(!arena.HasRoom(1));
+    unwind_protect(
+    {
+      assert(MFMThrownFailCode == MFM_FAIL_CODE_NUMBER(OUT_OF_ROOM));
+    },
+    {
+      arena.Allocate(1);
+      assert(0);
+    });
+  }
+
+  void UlamTransientArena_Test::Test_arenaMarkRelease()
+  {
+    UlamTransientArena arena;
+    arena.Allocate(100);
+    const u32 mark = arena.GetMark();
+    void * inner = arena.Allocate(200);
+    arena.Allocate(300);
+    arena.ReleaseTo(mark);
+    assert(arena.GetUsedBytes() == mark);
+    assert(arena.Allocate(8) == inner);
+  }
+
+  void UlamTransientArena_Test::Test_arenaBitStorage()
+  {
+    typedef BitVectorBitStorage<TestEventConfig, BitVector<4096> > BigStorage;
+    UlamTransientArena arena;
+
+    BigStorage & bs = arena.New<BigStorage>();
+    assert(bs.GetBitSize() == 4096);
+    assert(bs.Read(4000, 32) == 0);
+    bs.Write(4000, 32, 0xfeedface);
+    assert(bs.Read(4000, 32) == 0xfeedface);
+
+    BigStorage & copy = arena.New<BigStorage>(bs);
+    assert(copy.Read(4000, 32) == 0xfeedface);
+    assert((u8 *) &copy - (u8 *) &bs >= (s32) sizeof(BigStorage));
+  }
+
+} /* namespace MFM */
@@ -0,0 +1,106 @@
+#include "assert.h"
+#include "ViewServer_Test.h"
+#include "itype.h"
+#include <string.h>         // For memcmp
+#include <unistd.h>         // For usleep
+
+namespace MFM {
+
+  void ViewServer_Test::Test_RunTests() {
+    Test_Codec();
+    Test_Stream();
+  }
+
+  enum { W = 40, H = 30, SITES = W * H };
+
+  void ViewServer_Test::Test_Codec() {
+    u16 types[SITES];
+    for (u32 i = 0; i < SITES; ++i) types[i] = ViewFrame::BLANK_TYPE;
+    for (u32 i = 100; i < 300; ++i) types[i] = 7;          // A repeat
+    for (u32 i = 500; i < 520; ++i) types[i] = (u16) i;    // Literals
+
+    ViewFrameEncoder enc;
+    ViewFrameDecoder dec;
+    assert(!dec.HasFrame());
+
+    const u8 * data = enc.Encode(types, W, H, 1, false);  // First is a keyframe anyway
+    u32 length = enc.GetEncodedLength();
+    assert(length < 80);
+    assert(data[12] & ViewFrame::FLAG_KEYFRAME);
+
+    // Only whole frames have a length
+    assert(ViewFrameDecoder::GetFrameLength(data, length - 1) == 0);
+    assert(ViewFrameDecoder::GetFrameLength(data, length) == length);
+
+    dec.Decode(data, length);
+    assert(dec.HasFrame() && dec.GetWidth() == W && dec.GetHeight() == H);
+    assert(dec.GetFrameNumber() == 1);
+    assert(!memcmp(dec.GetTypes(), types, sizeof(types)));
+
+    // A delta codes just the change
+    types[1000] = 3;
+    types[200] = ViewFrame::BLANK_TYPE;
+    data = enc.Encode(types, W, H, 2, false);
+    length = enc.GetEncodedLength();
+    assert(!(data[12] & ViewFrame::FLAG_KEYFRAME));
+    assert(length == ViewFrame::HEADER_BYTES + 2 * (2 + 1 + 2));  // Skips of 200 and 799
+    dec.Decode(data, length);
+    assert(dec.GetFrameNumber() == 2);
+    assert(!memcmp(dec.GetTypes(), types, sizeof(types)));
+
+    // Nothing changed, nothing to say
+    enc.Encode(types, W, H, 3, false);
+    assert(enc.GetEncodedLength() == ViewFrame::HEADER_BYTES);
+
+    // A fresh decoder can't start on a delta, but can on a keyframe
+    ViewFrameDecoder late;
+    types[0] = 9;
+    data = enc.Encode(types, W, H, 4, false);
+    length = enc.GetEncodedLength();
+    unwind_protect({ assert(MFMThrownFailCode == MFM_FAIL_CODE_NUMBER(ILLEGAL_STATE)); },
+                   { late.Decode(data, length); assert(0); });
+    data = enc.Encode(types, W, H, 5, true);
+    late.Decode(data, enc.GetEncodedLength());
+    assert(!memcmp(late.GetTypes(), types, sizeof(types)));
+  }
+
+  void ViewServer_Test::Test_Stream() {
+    ViewServer vs;
+    vs.Start(0);
+    assert(vs.IsRunning() && vs.GetPort() != 0);
+
+    ViewClient vc;
+    vc.Connect("127.0.0.1", vs.GetPort());
+    for (u32 tries = 0; vs.GetViewerCount() == 0; ++tries) {
+      assert(tries < 100);
+      vc.Poll(20);
+    }
+
+    for (u32 frame = 1; frame <= 3; ++frame) {
+      u16 * types = vs.BeginPublish(W, H);
+      for (u32 i = 0; i < SITES; ++i)
+        types[i] = (u16) (i % 97 < frame ? frame : ViewFrame::BLANK_TYPE);
+      vs.EndPublish();
+
+      for (u32 tries = 0; vc.GetDecoder().GetFrameNumber() != frame; ++tries) {
+        assert(tries < 100);
+        vc.Poll(20);
+      }
+      const u16 * got = vc.GetDecoder().GetTypes();
+      for (u32 i = 0; i < SITES; ++i)
+        assert(got[i] == (i % 97 < frame ? frame : ViewFrame::BLANK_TYPE));
+    }
+    assert(vs.GetFramesSent() == 3);
+    assert(vc.GetBytesReceived() == vs.GetBytesSent());
+
+    // Viewers that leave are noticed
+    vc.Close();
+    for (u32 tries = 0; vs.GetViewerCount() != 0; ++tries) {
+      assert(tries < 100);
+      usleep(20000);
+    }
+
+    vs.Stop();
+    assert(!vs.IsRunning());
+  }
+} /* namespace MFM */
@@ -0,0 +1,390 @@
+/*
+  MakeMDistTables.cpp Generate src/core/include/MDistTables.h
+  Copyright (C) 2014-2016 The Regents of the University of New Mexico.  All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301
+  USA
+*/
+
+/*
+  Precompiles the MDist<R> site tables that used to be built at
+  startup.  Standalone on purpose, so it needs no MFM build:
+
+    g++ -o MakeMDistTables MakeMDistTables.cpp
+    ./MakeMDistTables 4 > ../../src/core/include/MDistTables.h
+
+  The algorithms are the original once-only MDist initializers --
+  unbelievably slow and obvious, still -- so the orderings they pick
+  (in particular the escape and horizon orders) are unchanged.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace
+{
+  struct Pt
+  {
+    int x, y;
+    Pt() : x(0), y(0) { }
+    Pt(int ax, int ay) : x(ax), y(ay) { }
+    Pt operator+(const Pt & o) const { return Pt(x + o.x, y + o.y); }
+    Pt operator*(int s) const { return Pt(x * s, y * s); }
+    int Manhattan() const { return abs(x) + abs(y); }
+    int Maximum() const { return abs(x) > abs(y) ? abs(x) : abs(y); }
+  };
+
+  enum { MAX_R = 7, MAX_D = 2*MAX_R+1, MAX_SITES = MAX_D*MAX_D/2+1, DIR_COUNT = 8, PSYM_COUNT = 8 };
+
+  int R, D, SITES;
+
+  Pt indexToPoint[MAX_SITES];
+  int pointToIndex[MAX_D][MAX_D];
+  int firstIndex[MAX_R+2];
+  int rasterToSiteNum[MAX_SITES], siteNumToRaster[MAX_SITES];
+  int siteNumToESLNum[MAX_SITES], eslNumToSiteNum[MAX_SITES];
+  int firstESLValue[2*MAX_R+2], firstESLIndex[2*MAX_R+2];
+  int escapesByDirection[DIR_COUNT][MAX_SITES];
+  int horizonsByDirection[DIR_COUNT][MAX_SITES];
+  int symSiteNum[PSYM_COUNT][MAX_SITES];
+
+  void Die(const char * msg)
+  {
+    fprintf(stderr, "MakeMDistTables: %s\n", msg);
+    exit(1);
+  }
+
+  int GetSiteNumber(const Pt & p)
+  {
+    int x = p.x + R, y = p.y + R;
+    if (x < 0 || y < 0 || x >= D || y >= D) return -1;
+    return pointToIndex[x][y];
+  }
+
+  /* As Dirs::FillDirCheckerboard, halved */
+  Pt DirDelta(int d)
+  {
+    static const int dx[DIR_COUNT] = { 0, 1, 1, 1, 0, -1, -1, -1 };
+    static const int dy[DIR_COUNT] = { -1, -1, 0, 1, 1, 1, 0, -1 };
+    return Pt(dx[d], dy[d]);
+  }
+
+  /* As SymMap, PSYM_DEG000L .. PSYM_DEG270R */
+  Pt Sym(const Pt & in, int psym)
+  {
+    switch (psym)
+    {
+    case 0: return Pt( in.x, in.y);
+    case 1: return Pt(-in.y, in.x);
+    case 2: return Pt(-in.x,-in.y);
+    case 3: return Pt( in.y,-in.x);
+    case 4: return Pt( in.x,-in.y);
+    case 5: return Pt( in.y, in.x);
+    case 6: return Pt(-in.x, in.y);
+    default: return Pt(-in.y,-in.x);
+    }
+  }
+
+  void InitPoints()
+  {
+    for (int x = 0; x < D; ++x)
+      for (int y = 0; y < D; ++y)
+        pointToIndex[x][y] = -1;
+
+    int next = 0;
+    const Pt center(R,R);
+    for (int length = 0; length <= R; ++length)
+    {
+      firstIndex[length] = next;
+      for (int max = 0; max <= length; ++max)
+      {
+        for (int x = 0; x < D; ++x)
+        {
+          for (int y = 0; y < D; ++y)
+          {
+            Pt p(x - center.x, y - center.y);
+            if (pointToIndex[x][y] < 0 && p.Manhattan() <= length && p.Maximum() <= max)
+            {
+              indexToPoint[next] = p;
+              pointToIndex[x][y] = next;
+              ++next;
+            }
+          }
+        }
+      }
+    }
+    firstIndex[R+1] = next;
+    if (next != SITES) Die("site count mismatch");
+  }
+
+  void InitRasterTables()
+  {
+    int rasterIndex = 0;
+    for (int y = -R; y <= R; ++y)
+      for (int x = -R; x <= R; ++x)
+      {
+        int sn = GetSiteNumber(Pt(x,y));
+        if (sn >= 0)
+          rasterToSiteNum[rasterIndex++] = sn;
+      }
+    if (rasterIndex != SITES) Die("raster count mismatch");
+    for (int i = 0; i < SITES; ++i)
+      siteNumToRaster[rasterToSiteNum[i]] = i;
+  }
+
+  void InitESLTables()
+  {
+    int eslIndex = 0;
+    int currentESL = -1;
+    int firstESLIdx = 0;
+    for (int esl = 0; esl <= 2*R*R; ++esl)
+    {
+      for (int x = -R; x <= R; ++x)
+      {
+        for (int y = -R; y <= R; ++y)
+        {
+          int sn = GetSiteNumber(Pt(x,y));
+          if (sn < 0) continue;
+          int thisESL = x*x + y*y;
+          if (thisESL != esl) continue;
+          if (currentESL != thisESL)
+          {
+            firstESLIndex[firstESLIdx] = eslIndex;
+            firstESLValue[firstESLIdx] = thisESL;
+            currentESL = thisESL;
+            ++firstESLIdx;
+          }
+          eslNumToSiteNum[eslIndex++] = sn;
+        }
+      }
+    }
+    if (eslIndex != SITES) Die("ESL count mismatch");
+    if (firstESLIdx != 2*R+1) Die("MDist needs exactly 2R+1 distinct ESLs at this radius");
+    firstESLIndex[firstESLIdx] = SITES;
+    firstESLValue[firstESLIdx] = 255;
+    for (int i = 0; i < SITES; ++i)
+      siteNumToESLNum[eslNumToSiteNum[i]] = i;
+  }
+
+  void InitEscapesByDirTable()
+  {
+    for (int d = 0; d < DIR_COUNT; ++d)
+    {
+      const Pt dirDelta = DirDelta(d);
+      int countInDir = 0;
+      int deltasToEscape = 0;
+      while (countInDir < SITES)
+      {
+        ++deltasToEscape;
+        for (int idx = 0; idx < SITES; ++idx)
+        {
+          const Pt rel = indexToPoint[idx];
+          int deltas;
+          for (deltas = 1; deltas <= 2*R; ++deltas)
+          {
+            if ((rel + dirDelta * deltas).Manhattan() > R)
+              break;
+          }
+          if (deltas == deltasToEscape)
+            escapesByDirection[d][countInDir++] = idx;
+        }
+      }
+    }
+  }
+
+  void InitHorizonsByDirTable()
+  {
+    for (int d = 0; d < DIR_COUNT; ++d)
+    {
+      const Pt dirDelta = DirDelta(d);
+      int countInDir = 0;
+      int deltasToHorizon = 0;
+      while (countInDir < SITES)
+      {
+        ++deltasToHorizon;
+        for (int horizon = R + dirDelta.Manhattan(); horizon >= R + 1; --horizon)
+        {
+          for (int idx = 0; idx < SITES; ++idx)
+          {
+            const Pt rel = indexToPoint[idx];
+            int deltas;
+            for (deltas = 1; deltas <= 2*R; ++deltas)
+            {
+              Pt off(rel.x * abs(dirDelta.x), rel.y * abs(dirDelta.y));
+              off = off + dirDelta * deltas;
+              if (off.Manhattan() == horizon)
+                break;
+            }
+            if (deltas == deltasToHorizon)
+              horizonsByDirection[d][countInDir++] = idx;
+          }
+        }
+      }
+    }
+  }
+
+  void InitSymmetryTables()
+  {
+    for (int psym = 0; psym < PSYM_COUNT; ++psym)
+      for (int i = 0; i < SITES; ++i)
+      {
+        int sn = GetSiteNumber(Sym(indexToPoint[i], psym));
+        if (sn < 0) Die("symmetry left the window");
+        symSiteNum[psym][i] = sn;
+      }
+  }
+
+  void PrintRow(const int * vals, int count, const char * indent)
+  {
+    printf("%s{ ", indent);
+    for (int i = 0; i < count; ++i)
+    {
+      if (i && i % 16 == 0) printf(",\n%s  ", indent);
+      else if (i) printf(", ");
+      printf("%d", vals[i]);
+    }
+    printf(" }");
+  }
+
+  void Print1D(const char * type, const char * name, const char * dims, const int * vals, int count)
+  {
+    printf("  template <class DUMMY>\n");
+    printf("  const %s MDistTables<%d,DUMMY>::%s%s =\n", type, R, name, dims);
+    PrintRow(vals, count, "  ");
+    printf(";\n\n");
+  }
+
+  void Print2D(const char * type, const char * name, const char * dims, const int * vals, int rows, int stride, int cols)
+  {
+    printf("  template <class DUMMY>\n");
+    printf("  const %s MDistTables<%d,DUMMY>::%s%s =\n  {\n", type, R, name, dims);
+    for (int r = 0; r < rows; ++r)
+    {
+      PrintRow(vals + r * stride, cols, "    ");
+      printf("%s\n", r + 1 < rows ? "," : "");
+    }
+    printf("  };\n\n");
+  }
+
+  void PrintHeader()
+  {
+    int points[MAX_SITES * 2];
+    for (int i = 0; i < SITES; ++i)
+    {
+      points[2*i] = indexToPoint[i].x;
+      points[2*i+1] = indexToPoint[i].y;
+    }
+    int ptoi[MAX_D * MAX_D];
+    for (int x = 0; x < D; ++x)
+      for (int y = 0; y < D; ++y)
+        ptoi[x*D + y] = pointToIndex[x][y];
+
+    char sites[32], diam[32], rows[32], rowsx[32], fi[32], esl[32];
+    sprintf(sites, "[%d]", SITES);
+    sprintf(diam, "[%d][%d]", D, D);
+    sprintf(rows, "[%d][%d]", DIR_COUNT, SITES);
+    sprintf(rowsx, "[%d][%d]", PSYM_COUNT, SITES);
+    sprintf(fi, "[%d]", R+2);
+    sprintf(esl, "[%d]", 2*R+2);
+
+    printf("/*                                              -*- mode:C++ -*-\n");
+    printf("  MDistTables.h Precompiled MDist site tables\n");
+    printf("  Copyright (C) 2014-2016 The Regents of the University of New Mexico.  All rights reserved.\n");
+    printf("\n");
+    printf("  This library is free software; you can redistribute it and/or\n");
+    printf("  modify it under the terms of the GNU Lesser General Public\n");
+    printf("  License as published by the Free Software Foundation; either\n");
+    printf("  version 2.1 of the License, or (at your option) any later version.\n");
+    printf("\n");
+    printf("  This library is distributed in the hope that it will be useful,\n");
+    printf("  but WITHOUT ANY WARRANTY; without even the implied warranty of\n");
+    printf("  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU\n");
+    printf("  Lesser General Public License for more details.\n");
+    printf("\n");
+    printf("  You should have received a copy of the GNU General Public License\n");
+    printf("  along with this library; if not, write to the Free Software\n");
+    printf("  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301\n");
+    printf("  USA\n");
+    printf("*/\n\n");
+    printf("/**\n");
+    printf("  \\file MDistTables.h Precompiled MDist site tables\n");
+    printf("  \\date (C) 2014-2016 All rights reserved.\n");
+    printf("  \\lgpl\n");
+    printf(" */\n\n");
+    printf("/* GENERATED by tools/MakeMDistTables/MakeMDistTables.cpp %d -- DO NOT EDIT */\n\n", R);
+    printf("#ifndef MDISTTABLES_H\n#define MDISTTABLES_H\n\n#include \"itype.h\"\n\n");
+    printf("namespace MFM\n{\n");
+    printf("  /**\n");
+    printf("     Read-only site tables for MDist<R>.  Only the radii generated\n");
+    printf("     below exist; using MDist at any other radius fails to compile.\n");
+    printf("     DUMMY only makes these template members, so their values can\n");
+    printf("     live in this header, visible to the optimizer, without\n");
+    printf("     multiple definitions.\n");
+    printf("   */\n");
+    printf("  template <u32 R, class DUMMY = void> struct MDistTables;\n\n");
+    printf("#define MDIST_TABLE_ALIGN __attribute__ ((aligned (64)))\n\n");
+    printf("  template <class DUMMY>\n");
+    printf("  struct MDistTables<%d, DUMMY>\n  {\n", R);
+    printf("    static const s8 INDEX_TO_POINT[%d][2] MDIST_TABLE_ALIGN;     // (x,y) by site number\n", SITES);
+    printf("    static const s8 POINT_TO_INDEX%s MDIST_TABLE_ALIGN;      // [x+R][y+R], or -1\n", diam);
+    printf("    static const u8 FIRST_INDEX%s;                               // By Manhattan length; [R+1] is the site count\n", fi);
+    printf("    static const u8 RASTER_TO_SITE_NUM%s;\n", sites);
+    printf("    static const u8 SITE_NUM_TO_RASTER%s;\n", sites);
+    printf("    static const u8 SITE_NUM_TO_ESL_NUM%s;\n", sites);
+    printf("    static const u8 ESL_NUM_TO_SITE_NUM%s;\n", sites);
+    printf("    static const u8 FIRST_ESL_VALUE%s;                          // Cutoff distances for ESL rings\n", esl);
+    printf("    static const u8 FIRST_ESL_INDEX%s;\n", esl);
+    printf("    static const u8 ESCAPES_BY_DIRECTION%s MDIST_TABLE_ALIGN;\n", rows);
+    printf("    static const u8 HORIZONS_BY_DIRECTION%s MDIST_TABLE_ALIGN;\n", rows);
+    printf("    static const u8 SYM_SITE_NUM%s MDIST_TABLE_ALIGN;            // [psym][site number]\n", rowsx);
+    printf("  };\n\n");
+    printf("#undef MDIST_TABLE_ALIGN\n\n");
+
+    char ptdims[32];
+    sprintf(ptdims, "[%d][2]", SITES);
+    Print2D("s8", "INDEX_TO_POINT", ptdims, points, SITES, 2, 2);
+    Print2D("s8", "POINT_TO_INDEX", diam, ptoi, D, D, D);
+    Print1D("u8", "FIRST_INDEX", fi, firstIndex, R+2);
+    Print1D("u8", "RASTER_TO_SITE_NUM", sites, rasterToSiteNum, SITES);
+    Print1D("u8", "SITE_NUM_TO_RASTER", sites, siteNumToRaster, SITES);
+    Print1D("u8", "SITE_NUM_TO_ESL_NUM", sites, siteNumToESLNum, SITES);
+    Print1D("u8", "ESL_NUM_TO_SITE_NUM", sites, eslNumToSiteNum, SITES);
+    Print1D("u8", "FIRST_ESL_VALUE", esl, firstESLValue, 2*R+2);
+    Print1D("u8", "FIRST_ESL_INDEX", esl, firstESLIndex, 2*R+2);
+    Print2D("u8", "ESCAPES_BY_DIRECTION", rows, &escapesByDirection[0][0], DIR_COUNT, MAX_SITES, SITES);
+    Print2D("u8", "HORIZONS_BY_DIRECTION", rows, &horizonsByDirection[0][0], DIR_COUNT, MAX_SITES, SITES);
+    Print2D("u8", "SYM_SITE_NUM", rowsx, &symSiteNum[0][0], PSYM_COUNT, MAX_SITES, SITES);
+
+    printf("} /* namespace MFM */\n\n#endif /* MDISTTABLES_H */\n");
+  }
+}
+
+int main(int argc, char ** argv)
+{
+  R = argc > 1 ? atoi(argv[1]) : 4;
+  if (R < 1 || R > MAX_R) Die("radius out of range");
+  D = 2*R+1;
+  SITES = D*D/2+1;
+
+  InitPoints();
+  InitRasterTables();
+  InitESLTables();
+  InitEscapesByDirTable();
+  InitHorizonsByDirTable();
+  InitSymmetryTables();
+  PrintHeader();
+  return 0;
+}